@@ -46,6 +46,12 @@ struct vdso_data {
 	u64 xtime_clock_snsec;	/* CLOCK_REALTIME sub-ns base */
 	u32 tz_minuteswest;	/* timezone info for gettimeofday(2) */
 	u32 tz_dsttime;
+
+	u32 btm_clock_sec;	/* monotonic to boot time offset */
+	u32 btm_clock_nsec;
+	u32 raw_time_sec;	/* CLOCK_MONOTONIC_RAW base */
+	u32 raw_time_nsec;
+	u32 cs_raw_mult;	/* raw clocksource multiplier */
 };
 
 union vdso_data_store {
@@ -298,6 +298,7 @@ static bool tk_is_cntvct(const struct timekeeper *tk)
 void update_vsyscall(struct timekeeper *tk)
 {
 	struct timespec64 *wtm = &tk->wall_to_monotonic;
+	struct timespec64 btm;
 
 	if (!cntvct_ok) {
 		/* The entry points have been zeroed, so there is no
@@ -322,6 +323,13 @@ void update_vsyscall(struct timekeeper *tk)
 		vdso_data->cs_mult		= tk->tkr_mono.mult;
 		vdso_data->cs_shift		= tk->tkr_mono.shift;
 		vdso_data->cs_mask		= tk->tkr_mono.mask;
+		btm = ktime_to_timespec64(tk->offs_boot);
+		/* tkr_raw shares cycle_last and shift, its xtime_nsec is 0 */
+		vdso_data->raw_time_sec		= tk->raw_time.tv_sec;
+		vdso_data->raw_time_nsec	= tk->raw_time.tv_nsec;
+		vdso_data->cs_raw_mult		= tk->tkr_raw.mult;
+		vdso_data->btm_clock_sec	= btm.tv_sec;
+		vdso_data->btm_clock_nsec	= btm.tv_nsec;
 	}
 
 	vdso_write_end(vdso_data);
@@ -133,6 +133,21 @@ static notrace u64 get_ns(struct vdso_data *vdata)
 	return nsec;
 }
 
+static notrace u64 get_raw_ns(struct vdso_data *vdata)
+{
+	u64 cycle_delta;
+	u64 cycle_now;
+	u64 nsec;
+
+	cycle_now = arch_counter_get_cntvct();
+
+	cycle_delta = (cycle_now - vdata->cs_cycle_last) & vdata->cs_mask;
+
+	nsec = (cycle_delta * vdata->cs_raw_mult) >> vdata->cs_shift;
+
+	return nsec + vdata->raw_time_nsec;
+}
+
 static notrace int do_realtime(struct timespec *ts, struct vdso_data *vdata)
 {
 	u64 nsecs;
@@ -182,6 +197,58 @@ static notrace int do_monotonic(struct timespec *ts, struct vdso_data *vdata)
 	return 0;
 }
 
+static notrace int do_boottime(struct timespec *ts, struct vdso_data *vdata)
+{
+	struct timespec tomono, toboot;
+	u64 nsecs;
+	u32 seq;
+
+	do {
+		seq = vdso_read_begin(vdata);
+
+		if (!vdata->tk_is_cntvct)
+			return -1;
+
+		ts->tv_sec = vdata->xtime_clock_sec;
+		nsecs = get_ns(vdata);
+
+		tomono.tv_sec = vdata->wtm_clock_sec;
+		tomono.tv_nsec = vdata->wtm_clock_nsec;
+		toboot.tv_sec = vdata->btm_clock_sec;
+		toboot.tv_nsec = vdata->btm_clock_nsec;
+
+	} while (vdso_read_retry(vdata, seq));
+
+	ts->tv_sec += tomono.tv_sec + toboot.tv_sec;
+	ts->tv_nsec = 0;
+	timespec_add_ns(ts, nsecs + tomono.tv_nsec + toboot.tv_nsec);
+
+	return 0;
+}
+
+static notrace int do_monotonic_raw(struct timespec *ts,
+				    struct vdso_data *vdata)
+{
+	u64 nsecs;
+	u32 seq;
+
+	do {
+		seq = vdso_read_begin(vdata);
+
+		if (!vdata->tk_is_cntvct)
+			return -1;
+
+		ts->tv_sec = vdata->raw_time_sec;
+		nsecs = get_raw_ns(vdata);
+
+	} while (vdso_read_retry(vdata, seq));
+
+	ts->tv_nsec = 0;
+	timespec_add_ns(ts, nsecs);
+
+	return 0;
+}
+
 #else /* CONFIG_ARM_ARCH_TIMER */
 
 static notrace int do_realtime(struct timespec *ts, struct vdso_data *vdata)
@@ -194,6 +261,17 @@ static notrace int do_monotonic(struct timespec *ts, struct vdso_data *vdata)
 	return -1;
 }
 
+static notrace int do_boottime(struct timespec *ts, struct vdso_data *vdata)
+{
+	return -1;
+}
+
+static notrace int do_monotonic_raw(struct timespec *ts,
+				    struct vdso_data *vdata)
+{
+	return -1;
+}
+
 #endif /* CONFIG_ARM_ARCH_TIMER */
 
 notrace int __vdso_clock_gettime(clockid_t clkid, struct timespec *ts)
@@ -216,6 +294,12 @@ notrace int __vdso_clock_gettime(clockid_t clkid, struct timespec *ts)
 	case CLOCK_MONOTONIC:
 		ret = do_monotonic(ts, vdata);
 		break;
+	case CLOCK_BOOTTIME:
+		ret = do_boottime(ts, vdata);
+		break;
+	case CLOCK_MONOTONIC_RAW:
+		ret = do_monotonic_raw(ts, vdata);
+		break;
 	default:
 		break;
 	}
@@ -30,6 +30,7 @@
 #define ARM64_HAS_UAO				5
 #define ARM64_ALT_PAN_NOT_UAO			6
 #define ARM64_HARDEN_BRANCH_PREDICTOR		7
+#define ARM64_COPY_PREFETCH			8
 #define ARM64_UNMAP_KERNEL_AT_EL0		23
 
 #define ARM64_NCAPS				24
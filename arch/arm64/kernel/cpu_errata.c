@@ -231,6 +231,20 @@ const struct arm64_cpu_capabilities arm64_errata[] = {
 		MIDR_RANGE(MIDR_KRYO2XX_SILVER, 0xA00004, 0xA00004),
 	},
 #endif
+	{
+	/*
+	 * The in-order A53 and its derivatives only find streams late;
+	 * the copy routines prefetch the source a few lines ahead.
+	 */
+		.desc = "Cortex-A53 copy prefetch",
+		.capability = ARM64_COPY_PREFETCH,
+		MIDR_ALL_VERSIONS(MIDR_CORTEX_A53),
+	},
+	{
+		.desc = "Kryo2xx Silver copy prefetch",
+		.capability = ARM64_COPY_PREFETCH,
+		MIDR_ALL_VERSIONS(MIDR_KRYO2XX_SILVER),
+	},
 #ifdef CONFIG_HARDEN_BRANCH_PREDICTOR
 	{
 		.capability = ARM64_HARDEN_BRANCH_PREDICTOR,
@@ -199,7 +199,7 @@ up_fail:
  */
 void update_vsyscall(struct timekeeper *tk)
 {
-	struct timespec xtime_coarse;
+	struct timespec xtime_coarse, btm;
 	u32 use_syscall = strcmp(tk->tkr_mono.clock->name, "arch_sys_counter");
 
 	++vdso_data->tb_seq_count;
@@ -211,6 +211,9 @@ void update_vsyscall(struct timekeeper *tk)
 	vdso_data->xtime_coarse_nsec		= xtime_coarse.tv_nsec;
 	vdso_data->wtm_clock_sec		= tk->wall_to_monotonic.tv_sec;
 	vdso_data->wtm_clock_nsec		= tk->wall_to_monotonic.tv_nsec;
+	btm = ktime_to_timespec(tk->offs_boot);
+	vdso_data->btm_sec			= btm.tv_sec;
+	vdso_data->btm_nsec			= btm.tv_nsec;
 
 	if (!use_syscall) {
 		/* tkr_mono.cycle_last == tkr_raw.cycle_last */
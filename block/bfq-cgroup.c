@@ -44,6 +44,44 @@ static struct bfqio_cgroup *css_to_bfqio(struct cgroup_subsys_state *css)
 	return css ? container_of(css, struct bfqio_cgroup, css) : NULL;
 }
 
+static inline struct bfqio_cgroup *bfqq_to_bfqio(struct bfq_queue *bfqq)
+{
+	struct bfq_group *bfqg = container_of(bfqq->entity.sched_data,
+					      struct bfq_group, sched_data);
+
+	return bfqg->bgrp;
+}
+
+static inline bool bfq_bfqq_foreground(struct bfq_queue *bfqq)
+{
+	return ACCESS_ONCE(bfqq_to_bfqio(bfqq)->foreground);
+}
+
+static inline bool bfq_bfqq_background(struct bfq_queue *bfqq)
+{
+	return ACCESS_ONCE(bfqq_to_bfqio(bfqq)->background);
+}
+
+/*
+ * Account the latency of a completed read, from its allocation to its
+ * completion, in the histogram of the cgroup bfqq belongs to.
+ */
+static void bfq_account_read_latency(struct bfq_queue *bfqq,
+				     struct request *rq)
+{
+	struct bfqio_cgroup *bgrp = bfqq_to_bfqio(bfqq);
+	unsigned long lat;
+	int i;
+
+#ifdef CONFIG_BLK_CGROUP
+	lat = div_u64(sched_clock() - rq_start_time_ns(rq), NSEC_PER_USEC);
+#else
+	lat = jiffies_to_usecs(jiffies - rq->start_time);
+#endif
+	i = lat < 128 ? 0 : min(ilog2(lat) - 6, BFQ_LAT_BUCKETS - 1);
+	atomic_long_inc(&bgrp->read_lat[i]);
+}
+
 /*
  * Search the bfq_group for bfqd into the hash table (by now only a list)
  * of bgrp.  Must be called under rcu_read_lock().
@@ -205,6 +243,7 @@ static void bfq_group_chain_link(struct bfq_data *bfqd,
 
 		spin_lock_irqsave(&bgrp->lock, flags);
 
+		leaf->bgrp = bgrp;
 		rcu_assign_pointer(leaf->bfqd, bfqd);
 		hlist_add_head_rcu(&leaf->group_node, &bgrp->group_data);
 		hlist_add_head(&leaf->bfqd_node, &bfqd->group_list);
@@ -628,6 +667,7 @@ static struct bfq_group *bfq_alloc_root_group(struct bfq_data *bfqd, int node)
 		bfqg->sched_data.service_tree[i] = BFQ_SERVICE_TREE_INIT;
 
 	bgrp = &bfqio_root_cgroup;
+	bfqg->bgrp = bgrp;
 	spin_lock_irq(&bgrp->lock);
 	rcu_assign_pointer(bfqg->bfqd, bfqd);
 	hlist_add_head_rcu(&bfqg->group_node, &bgrp->group_data);
@@ -721,6 +761,69 @@ STORE_FUNCTION(ioprio, 0, IOPRIO_BE_NR - 1);
 STORE_FUNCTION(ioprio_class, IOPRIO_CLASS_RT, IOPRIO_CLASS_IDLE);
 #undef STORE_FUNCTION
 
+#define FLAG_FUNCTIONS(__VAR)						\
+static u64 bfqio_cgroup_##__VAR##_read(struct cgroup_subsys_state *css, \
+				       struct cftype *cftype)		\
+{									\
+	return ACCESS_ONCE(css_to_bfqio(css)->__VAR);			\
+}									\
+									\
+static int bfqio_cgroup_##__VAR##_write(struct cgroup_subsys_state *css,\
+					struct cftype *cftype,		\
+					u64 val)			\
+{									\
+	struct bfqio_cgroup *bgrp = css_to_bfqio(css);			\
+	int ret = -EINVAL;						\
+									\
+	if (val > 1)							\
+		return ret;						\
+									\
+	ret = -ENODEV;							\
+	mutex_lock(&bfqio_mutex);					\
+	if (bfqio_is_removed(bgrp))					\
+		goto out_unlock;					\
+	ret = 0;							\
+									\
+	spin_lock_irq(&bgrp->lock);					\
+	bgrp->__VAR = val;						\
+	spin_unlock_irq(&bgrp->lock);					\
+									\
+out_unlock:								\
+	mutex_unlock(&bfqio_mutex);					\
+	return ret;							\
+}
+
+FLAG_FUNCTIONS(foreground);
+FLAG_FUNCTIONS(background);
+#undef FLAG_FUNCTIONS
+
+static int bfqio_cgroup_read_latency_show(struct seq_file *sf, void *v)
+{
+	struct bfqio_cgroup *bgrp = css_to_bfqio(seq_css(sf));
+	int i;
+
+	for (i = 0; i < BFQ_LAT_BUCKETS - 1; i++)
+		seq_printf(sf, "<%uus %ld\n", 128U << i,
+			   atomic_long_read(&bgrp->read_lat[i]));
+	seq_printf(sf, ">=%uus %ld\n", 128U << (BFQ_LAT_BUCKETS - 2),
+		   atomic_long_read(&bgrp->read_lat[i]));
+
+	return 0;
+}
+
+/* Writing any value clears the histogram. */
+static int bfqio_cgroup_read_latency_write(struct cgroup_subsys_state *css,
+					   struct cftype *cftype, u64 val)
+{
+	struct bfqio_cgroup *bgrp = css_to_bfqio(css);
+	int i;
+
+	for (i = 0; i < BFQ_LAT_BUCKETS; i++)
+		atomic_long_set(&bgrp->read_lat[i], 0);
+
+	return 0;
+}
+
 static struct cftype bfqio_files[] = {
 	{
 		.name = "weight",
@@ -737,6 +840,21 @@ static struct cftype bfqio_files[] = {
 		.read_u64 = bfqio_cgroup_ioprio_class_read,
 		.write_u64 = bfqio_cgroup_ioprio_class_write,
 	},
+	{
+		.name = "foreground",
+		.read_u64 = bfqio_cgroup_foreground_read,
+		.write_u64 = bfqio_cgroup_foreground_write,
+	},
+	{
+		.name = "background",
+		.read_u64 = bfqio_cgroup_background_read,
+		.write_u64 = bfqio_cgroup_background_write,
+	},
+	{
+		.name = "read_latency",
+		.seq_show = bfqio_cgroup_read_latency_show,
+		.write_u64 = bfqio_cgroup_read_latency_write,
+	},
 	{ },	/* terminate */
 };
 
@@ -880,6 +998,21 @@ struct cgroup_subsys bfqio_cgrp_subsys = {
 	.legacy_cftypes = bfqio_files,
 };
 #else
+static inline bool bfq_bfqq_foreground(struct bfq_queue *bfqq)
+{
+	return false;
+}
+
+static inline bool bfq_bfqq_background(struct bfq_queue *bfqq)
+{
+	return false;
+}
+
+static inline void bfq_account_read_latency(struct bfq_queue *bfqq,
+					    struct request *rq)
+{
+}
+
 static inline void bfq_init_entity(struct bfq_entity *entity,
 				   struct bfq_group *bfqg)
 {
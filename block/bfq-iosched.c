@@ -93,6 +93,13 @@ static const int bfq_max_budget_async_rq = 4;
  */
 static const int bfq_async_charge_factor = 10;
 
+/*
+ * Additional factor applied to the service charged to the async queues
+ * of a background cgroup, so that their writes get a smaller share of the
+ * device than the sync I/O of the other cgroups.
+ */
+static const int bfq_bg_async_charge_factor = 4;
+
 /* Default timeout values, in jiffies, approximating CFQ defaults. */
 static const int bfq_timeout_sync = HZ / 8;
 static int bfq_timeout_async = HZ / 25;
@@ -513,9 +520,14 @@ static struct request *bfq_find_next_rq(struct bfq_data *bfqd,
 static inline unsigned long bfq_serv_to_charge(struct request *rq,
 					       struct bfq_queue *bfqq)
 {
-	return blk_rq_sectors(rq) *
+	unsigned long charge = blk_rq_sectors(rq) *
 		(1 + ((!bfq_bfqq_sync(bfqq)) * (bfqq->wr_coeff == 1) *
 		bfq_async_charge_factor));
+
+	if (!bfq_bfqq_sync(bfqq) && bfq_bfqq_background(bfqq))
+		charge *= bfq_bg_async_charge_factor;
+
+	return charge;
 }
 
 /**
@@ -892,12 +904,21 @@ static void bfq_add_request(struct request *rq)
 				bfqd->last_ins_in_burst = jiffies;
 		}
 
+		/*
+		 * The async queues of a background cgroup are treated as
+		 * if in a large burst, so that they never get raised. The
+		 * sync queues of a foreground cgroup are deemed
+		 * interactive anyway, as in a burst of queues created by an
+		 * application start is exactly where they need the boost.
+		 */
 		coop_or_in_burst = bfq_bfqq_in_large_burst(bfqq) ||
-			bfq_bfqq_cooperations(bfqq) >= bfqd->bfq_coop_thresh;
+			bfq_bfqq_cooperations(bfqq) >= bfqd->bfq_coop_thresh ||
+			(!bfq_bfqq_sync(bfqq) && bfq_bfqq_background(bfqq));
 		soft_rt = bfqd->bfq_wr_max_softrt_rate > 0 &&
 			!coop_or_in_burst &&
 			time_is_before_jiffies(bfqq->soft_rt_next_start);
-		interactive = !coop_or_in_burst && idle_for_long_time;
+		interactive = (!coop_or_in_burst && idle_for_long_time) ||
+			(bfq_bfqq_sync(bfqq) && bfq_bfqq_foreground(bfqq));
 		entity->budget = max_t(unsigned long, bfqq->max_budget,
 				       bfq_serv_to_charge(next_rq, bfqq));
 
@@ -1018,6 +1039,7 @@ add_bfqq_busy:
 		bfq_add_bfqq_busy(bfqd, bfqq);
 	} else {
 		if (bfqd->low_latency && old_wr_coeff == 1 && !rq_is_sync(rq) &&
+		    !bfq_bfqq_background(bfqq) &&
 		    time_is_before_jiffies(
 				bfqq->last_wr_start_finish +
 				bfqd->bfq_wr_min_inter_arr_async)) {
@@ -3438,6 +3460,9 @@ static void bfq_completed_request(struct request_queue *q, struct request *rq)
 		RQ_BIC(rq)->ttime.last_end_request = jiffies;
 	}
 
+	if (rq_data_dir(rq) == READ)
+		bfq_account_read_latency(bfqq, rq);
+
 	/*
 	 * If we are waiting to discover whether the request pattern of the
 	 * task associated with the queue is actually isochronous, and
@@ -663,6 +663,7 @@ enum bfqq_expiration {
  *                   are groups with more than one active @bfq_entity
  *                   (see the comments to the function
  *                   bfq_bfqq_must_not_expire()).
+ * @bgrp: the bfqio_cgroup this group belongs to.
  *
  * Each (device, cgroup) pair has its own bfq_group, i.e., for each cgroup
  * there is a set of bfq_groups, each one collecting the lower-level
@@ -690,8 +691,13 @@ struct bfq_group {
 	struct bfq_entity *my_entity;
 
 	int active_entities;
+
+	struct bfqio_cgroup *bgrp;
 };
 
+/* Number of buckets of the per-cgroup read latency histogram. */
+#define BFQ_LAT_BUCKETS		14
+
 /**
  * struct bfqio_cgroup - bfq cgroup data structure.
  * @css: subsystem state for bfq in the containing cgroup.
@@ -701,18 +707,29 @@ struct bfq_group {
  * @ioprio_class: cgroup ioprio_class.
  * @lock: spinlock that protects @ioprio, @ioprio_class and @group_data.
  * @group_data: list containing the bfq_group belonging to this cgroup.
+ * @foreground: weight-raise the sync queues of the cgroup whenever they
+ *              become backlogged, as if they were interactive.
+ * @background: never weight-raise the async queues of the cgroup and
+ *              charge them more for the service they receive.
+ * @read_lat: histogram of the completion latency of the read requests
+ *            issued by the cgroup, bucket i counting latencies below
+ *            128 << i us.
  *
  * @group_data is accessed using RCU, with @lock protecting the updates,
- * @ioprio and @ioprio_class are protected by @lock.
+ * @ioprio and @ioprio_class are protected by @lock. @foreground and
+ * @background are written under @lock and read locklessly.
  */
 struct bfqio_cgroup {
 	struct cgroup_subsys_state css;
 	bool online;
 
 	unsigned short weight, ioprio, ioprio_class;
+	bool foreground, background;
 
 	spinlock_t lock;
 	struct hlist_head group_data;
+
+	atomic_long_t read_lat[BFQ_LAT_BUCKETS];
 };
 #else
 struct bfq_group {
@@ -32,6 +32,7 @@
 #include <linux/delay.h>
 #include <linux/ratelimit.h>
 #include <linux/pm_runtime.h>
+#include <linux/blktrace_api.h>
 
 #define CREATE_TRACE_POINTS
 #include <trace/events/block.h>
@@ -847,6 +848,63 @@ static void freed_request(struct request_list *rl, unsigned int flags)
 		__freed_request(rl, sync ^ 1);
 }
 
+/*
+ * Writeback throttling. While the bdi has a latency target, the number of
+ * async write requests allocated is capped at ->wb_depth. The cap is
+ * halved after every window in which the fastest sync request took longer
+ * than the target, and doubled back after every window in which one made
+ * it, or in which there was no sync request to protect. Like CoDel, using
+ * the minimum tells a queue that stays deep from a burst that drains.
+ */
+#define BLK_WB_WINDOW_NS	(100 * NSEC_PER_MSEC)
+
+static bool blk_wb_throttled(struct request_queue *q)
+{
+	return q->backing_dev_info.wb_lat_target_us && q->wb_depth &&
+		q->nr_rqs[BLK_RW_ASYNC] >= q->wb_depth;
+}
+
+static void blk_wb_done(struct request_queue *q, struct request *rq)
+{
+	u64 target = (u64)q->backing_dev_info.wb_lat_target_us * NSEC_PER_USEC;
+	unsigned int depth = q->wb_depth;
+	u64 now;
+
+	if (!target) {
+		q->wb_depth = 0;
+		return;
+	}
+	if (!rq->issue_time_ns)
+		return;
+
+	now = ktime_get_ns();
+	if (rw_is_sync(rq->cmd_flags)) {
+		u64 lat = now - rq->issue_time_ns;
+
+		if (!q->wb_win_samples++ || lat < q->wb_win_min_lat)
+			q->wb_win_min_lat = lat;
+	}
+
+	if (now - q->wb_win_start < BLK_WB_WINDOW_NS)
+		return;
+
+	if (!depth)
+		depth = q->nr_requests;
+	if (q->wb_win_samples && q->wb_win_min_lat > target)
+		depth = max(depth / 2, 1U);
+	else
+		depth = min_t(unsigned long, depth * 2, q->nr_requests);
+
+	if (depth != q->wb_depth)
+		blk_add_trace_msg(q, "wb depth %u min_lat_us %llu", depth,
+				  q->wb_win_samples ?
+				  div_u64(q->wb_win_min_lat, NSEC_PER_USEC) : 0);
+
+	q->wb_depth = depth;
+	q->wb_win_start = now;
+	q->wb_win_samples = 0;
+}
+
 int blk_update_nr_requests(struct request_queue *q, unsigned int nr)
 {
 	struct request_list *rl;
@@ -854,6 +912,7 @@ int blk_update_nr_requests(struct request_queue *q, unsigned int nr)
 	spin_lock_irq(q->queue_lock);
 	q->nr_requests = nr;
 	blk_queue_congestion_threshold(q);
+	q->wb_depth = min_t(unsigned long, q->wb_depth, nr);
 
 	/* congestion isn't cgroup aware and follows root blkcg for now */
 	rl = &q->root_rl;
@@ -955,6 +1014,10 @@ static struct request *__get_request(struct request_list *rl, int rw_flags,
 	if (may_queue == ELV_MQUEUE_NO)
 		goto rq_starved;
 
+	/* sleeps in get_request() until an async write completes */
+	if (!is_sync && may_queue != ELV_MQUEUE_MUST && blk_wb_throttled(q))
+		return ERR_PTR(-ENOMEM);
+
 	if (rl->count[is_sync]+1 >= queue_congestion_on_threshold(q)) {
 		if (rl->count[is_sync]+1 >= q->nr_requests) {
 			/*
@@ -2376,6 +2439,10 @@ void blk_start_request(struct request *req)
 
 	BUG_ON(test_bit(REQ_ATOM_COMPLETE, &req->atomic_flags));
 	blk_add_timer(req);
+
+	if (req->q->backing_dev_info.wb_lat_target_us &&
+	    req->cmd_type == REQ_TYPE_FS)
+		req->issue_time_ns = ktime_get_ns();
 }
 EXPORT_SYMBOL(blk_start_request);
 
@@ -2608,6 +2675,7 @@ void blk_finish_request(struct request *req, int error)
 		blk_unprep_request(req);
 
 	blk_account_io_done(req);
+	blk_wb_done(req->q, req);
 
 	if (req->end_io)
 		req->end_io(req, error);
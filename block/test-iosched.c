@@ -28,6 +28,8 @@
 #include <linux/debugfs.h>
 #include <linux/test-iosched.h>
 #include <linux/delay.h>
+#include <linux/random.h>
+#include <linux/seq_file.h>
 #include "blk.h"
 
 #define MODULE_NAME "test-iosched"
@@ -35,6 +37,10 @@
 #define UNIQUE_START_REQ_ID 5678
 #define TIMEOUT_TIMER_MS 40000
 #define TEST_MAX_TESTCASE_ROUNDS 15
+#define BENCH_TIMEOUT_MS 120000
+#define BENCH_DEF_NR_REQS 256
+/* stay well below the 128 requests of the queue request pool */
+#define BENCH_MAX_QUEUE_DEPTH 64
 
 
 static DEFINE_MUTEX(blk_dev_test_list_lock);
@@ -881,6 +887,320 @@ void test_iosched_set_ignore_round(struct test_iosched *tios,
 }
 EXPORT_SYMBOL(test_iosched_set_ignore_round);
 
+/* Latency histogram bucket of a @us usec request */
+static unsigned int bench_lat_bucket(u64 us)
+{
+	unsigned int msb;
+
+	if (us < TEST_BENCH_LAT_LINEAR)
+		return us;
+
+	msb = fls64(us) - 1;
+	us = (us >> (msb - TEST_BENCH_LAT_SUB_BITS)) &
+		((1 << TEST_BENCH_LAT_SUB_BITS) - 1);
+	msb -= ilog2(TEST_BENCH_LAT_LINEAR);
+
+	return min_t(unsigned int, TEST_BENCH_LAT_BUCKETS - 1,
+		TEST_BENCH_LAT_LINEAR + (msb << TEST_BENCH_LAT_SUB_BITS) + us);
+}
+
+/* Highest latency (in usec) accounted in bucket @idx */
+static u64 bench_lat_bucket_max(unsigned int idx)
+{
+	unsigned int msb, sub;
+
+	if (idx < TEST_BENCH_LAT_LINEAR)
+		return idx;
+
+	idx -= TEST_BENCH_LAT_LINEAR;
+	msb = (idx >> TEST_BENCH_LAT_SUB_BITS) + ilog2(TEST_BENCH_LAT_LINEAR);
+	sub = idx & ((1 << TEST_BENCH_LAT_SUB_BITS) - 1);
+
+	return (((u64)(1 << TEST_BENCH_LAT_SUB_BITS) + sub + 1) <<
+		(msb - TEST_BENCH_LAT_SUB_BITS)) - 1;
+}
+
+/* Latency (in usec) under which @permille of the requests completed */
+static u64 bench_percentile(struct test_bench_hist *h, unsigned int permille)
+{
+	u64 target, seen = 0;
+	int i;
+
+	if (!h->count)
+		return 0;
+
+	target = DIV_ROUND_UP_ULL(h->count * permille, 1000);
+	for (i = 0; i < TEST_BENCH_LAT_BUCKETS; i++) {
+		seen += h->bucket[i];
+		if (seen >= target)
+			return min(bench_lat_bucket_max(i), h->max_us);
+	}
+
+	return h->max_us;
+}
+
+/*
+ * Benchmark request completion: account the request latency and free it,
+ * so that a round is not bounded by the size of the request pool.
+ * Called with the queue lock held.
+ */
+static void bench_end_req(struct request *rq, int err)
+{
+	struct test_request *test_rq = rq->elv.priv[0];
+	struct test_iosched *tios = rq->q->elevator->elevator_data;
+	struct test_bench *bench = &tios->bench;
+	struct test_bench_hist *h;
+	unsigned long flags;
+	u64 us;
+
+	BUG_ON(!test_rq);
+
+	if (!err) {
+		us = ktime_us_delta(ktime_get(), test_rq->dispatch_time);
+		h = &bench->hist[rq_data_dir(rq)];
+		h->bucket[bench_lat_bucket(us)]++;
+		h->count++;
+		h->bytes += test_rq->buf_size;
+		if (us > h->max_us)
+			h->max_us = us;
+	} else {
+		pr_err("%s: request %d failed, err=%d", __func__,
+			test_rq->req_id, err);
+		tios->test_result = TEST_FAILED;
+	}
+
+	spin_lock_irqsave(&tios->lock, flags);
+	list_del_init(&test_rq->queuelist);
+	tios->dispatched_count--;
+	__blk_put_request(tios->req_q, test_rq->rq);
+	spin_unlock_irqrestore(&tios->lock, flags);
+
+	test_iosched_free_test_req_data_buffer(test_rq);
+	kfree(test_rq);
+
+	atomic_dec(&bench->outstanding);
+	wake_up(&tios->wait_q);
+
+	check_test_completion(tios);
+}
+
+static bool bench_check_completion(struct test_iosched *tios)
+{
+	return tios->bench.issued == tios->bench.nr_reqs;
+}
+
+static int bench_check_result(struct test_iosched *tios)
+{
+	return tios->test_result == TEST_FAILED ? -EIO : 0;
+}
+
+/*
+ * Issue the requests of a benchmark round, keeping at most
+ * bench.queue_depth of them outstanding.
+ */
+static int bench_run(struct test_iosched *tios)
+{
+	struct test_bench *bench = &tios->bench;
+	struct test_request *test_rq;
+	u32 nr_sects = bench->req_pages * (TEST_BIO_SIZE >> 9);
+	u32 nr_slots = tios->sector_range / nr_sects;
+	unsigned long timeout = msecs_to_jiffies(TIMEOUT_TIMER_MS);
+	unsigned long flags;
+	u32 sector;
+	int direction;
+
+	if (!nr_slots) {
+		pr_err("%s: sector_range is smaller than a request", __func__);
+		return -EINVAL;
+	}
+
+	bench->issued = 0;
+	bench->next_sector = 0;
+	atomic_set(&bench->outstanding, 0);
+
+	while (bench->issued < bench->nr_reqs) {
+		if (!wait_event_timeout(tios->wait_q,
+			atomic_read(&bench->outstanding) < bench->queue_depth,
+			timeout)) {
+			pr_err("%s: timeout, %d requests outstanding",
+				__func__, atomic_read(&bench->outstanding));
+			return -ETIMEDOUT;
+		}
+
+		if (bench->random) {
+			sector = prandom_u32_max(nr_slots) * nr_sects;
+		} else {
+			sector = bench->next_sector;
+			bench->next_sector += nr_sects;
+			if (bench->next_sector >= nr_slots * nr_sects)
+				bench->next_sector = 0;
+		}
+		direction = prandom_u32_max(100) < bench->read_pct ?
+			READ : WRITE;
+
+		test_rq = test_iosched_create_test_req(tios, 0, direction,
+			tios->start_sector + sector, bench->req_pages,
+			TEST_NO_PATTERN, bench_end_req);
+		if (!test_rq) {
+			pr_err("%s: failed to create request %u", __func__,
+				bench->issued);
+			return -ENOMEM;
+		}
+		if (direction == WRITE && bench->sync)
+			test_rq->rq->cmd_flags |= REQ_SYNC;
+
+		atomic_inc(&bench->outstanding);
+		spin_lock_irqsave(tios->req_q->queue_lock, flags);
+		list_add_tail(&test_rq->queuelist, &tios->test_queue);
+		tios->test_count++;
+		bench->issued++;
+		spin_unlock_irqrestore(tios->req_q->queue_lock, flags);
+
+		blk_run_queue(tios->req_q);
+	}
+
+	return 0;
+}
+
+/**
+ * test_iosched_start_bench() - Run one round of the latency
+ * benchmark configured through the "bench" debugfs directory.
+ * @t_info:	the block device test callbacks. The run and
+ *		completion callbacks are set by this function.
+ *
+ * The request latencies and the round duration are accumulated
+ * in tios->bench until the results are reset.
+ */
+int test_iosched_start_bench(struct test_iosched *tios,
+	struct test_info *t_info)
+{
+	struct test_bench *bench;
+	int ret;
+
+	if (!tios || !t_info)
+		return -EINVAL;
+
+	bench = &tios->bench;
+	if (!bench->nr_reqs || !bench->queue_depth ||
+	    bench->queue_depth > BENCH_MAX_QUEUE_DEPTH ||
+	    !bench->req_pages || bench->req_pages > BLK_MAX_SEGMENTS ||
+	    bench->read_pct > 100) {
+		pr_err("%s: invalid benchmark configuration", __func__);
+		return -EINVAL;
+	}
+
+	t_info->run_test_fn = bench_run;
+	t_info->check_test_completion_fn = bench_check_completion;
+	if (!t_info->check_test_result_fn)
+		t_info->check_test_result_fn = bench_check_result;
+	if (!t_info->timeout_msec)
+		t_info->timeout_msec = BENCH_TIMEOUT_MS;
+
+	ret = test_iosched_start_test(tios, t_info);
+	if (ret)
+		return ret;
+
+	bench->duration_us += ktime_to_us(t_info->test_duration);
+	bench->rounds++;
+
+	return 0;
+}
+EXPORT_SYMBOL(test_iosched_start_bench);
+
+static void bench_show_hist(struct seq_file *s, const char *name,
+	struct test_bench_hist *h)
+{
+	seq_printf(s, "%s: reqs %llu bytes %llu p50 %lluus p99 %lluus p999 %lluus max %lluus\n",
+		   name, h->count, h->bytes, bench_percentile(h, 500),
+		   bench_percentile(h, 990), bench_percentile(h, 999),
+		   h->max_us);
+}
+
+static int bench_results_show(struct seq_file *s, void *data)
+{
+	struct test_iosched *tios = s->private;
+	struct test_bench *bench = &tios->bench;
+	u64 count = bench->hist[READ].count + bench->hist[WRITE].count;
+	u64 bytes = bench->hist[READ].bytes + bench->hist[WRITE].bytes;
+	u64 kbps = 0, iops = 0;
+
+	if (bench->duration_us) {
+		kbps = div64_u64(bytes * USEC_PER_SEC,
+				 bench->duration_us * 1024);
+		iops = div64_u64(count * USEC_PER_SEC, bench->duration_us);
+	}
+
+	seq_printf(s, "config: read_pct %u random %u queue_depth %u sync %u req_pages %u nr_reqs %u\n",
+		   bench->read_pct, bench->random, bench->queue_depth,
+		   bench->sync, bench->req_pages, bench->nr_reqs);
+	bench_show_hist(s, "read", &bench->hist[READ]);
+	bench_show_hist(s, "write", &bench->hist[WRITE]);
+	seq_printf(s, "total: rounds %llu time %lluus throughput %lluKiB/s iops %llu\n",
+		   bench->rounds, bench->duration_us, kbps, iops);
+
+	return 0;
+}
+
+static int bench_results_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, bench_results_show, inode->i_private);
+}
+
+/* Any write resets the accumulated results */
+static ssize_t bench_results_write(struct file *file, const char __user *buf,
+	size_t count, loff_t *ppos)
+{
+	struct seq_file *s = file->private_data;
+	struct test_iosched *tios = s->private;
+	struct test_bench *bench = &tios->bench;
+
+	if (tios->test_state != TEST_IDLE)
+		return -EBUSY;
+
+	memset(bench->hist, 0, sizeof(bench->hist));
+	bench->duration_us = 0;
+	bench->rounds = 0;
+
+	return count;
+}
+
+static const struct file_operations bench_results_fops = {
+	.open = bench_results_open,
+	.read = seq_read,
+	.write = bench_results_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static int bench_debugfs_init(struct test_iosched *tios)
+{
+	struct test_bench *bench = &tios->bench;
+	struct dentry *root;
+
+	root = debugfs_create_dir("bench", tios->debug.debug_root);
+	if (!root)
+		return -ENOENT;
+	bench->debug_root = root;
+
+	if (!debugfs_create_u32("read_pct", S_IRUGO | S_IWUSR, root,
+				&bench->read_pct) ||
+	    !debugfs_create_u32("random", S_IRUGO | S_IWUSR, root,
+				&bench->random) ||
+	    !debugfs_create_u32("queue_depth", S_IRUGO | S_IWUSR, root,
+				&bench->queue_depth) ||
+	    !debugfs_create_u32("sync", S_IRUGO | S_IWUSR, root,
+				&bench->sync) ||
+	    !debugfs_create_u32("req_pages", S_IRUGO | S_IWUSR, root,
+				&bench->req_pages) ||
+	    !debugfs_create_u32("nr_reqs", S_IRUGO | S_IWUSR, root,
+				&bench->nr_reqs) ||
+	    !debugfs_create_file("results", S_IRUGO | S_IWUSR, root,
+				 tios, &bench_results_fops))
+		return -ENOENT;
+
+	return 0;
+}
+
 static int test_debugfs_init(struct test_iosched *tios)
 {
 	char name[2*BDEVNAME_SIZE];
@@ -928,6 +1248,9 @@ static int test_debugfs_init(struct test_iosched *tios)
 	if (!tios->debug.sector_range)
 		goto err;
 
+	if (bench_debugfs_init(tios))
+		goto err;
+
 	return 0;
 
 err:
@@ -1004,6 +1327,8 @@ static int test_dispatch_from(struct request_queue *q,
 		(*count)--;
 		spin_unlock_irqrestore(&tios->lock, flags);
 
+		test_rq->dispatch_time = ktime_get();
+
 		print_req(rq);
 		elv_dispatch_sort(q, rq);
 		tios->test_info.test_byte_count += test_rq->buf_size;
@@ -1139,6 +1464,13 @@ static int test_init_queue(struct request_queue *q, struct elevator_type *e)
 
 	spin_lock_init(&tios->lock);
 
+	tios->bench.read_pct = 100;
+	tios->bench.random = 1;
+	tios->bench.queue_depth = 1;
+	tios->bench.sync = 1;
+	tios->bench.req_pages = 1;
+	tios->bench.nr_reqs = BENCH_DEF_NR_REQS;
+
 	ret = test_debugfs_init(tios);
 	if (ret) {
 		pr_err("%s: Failed to create debugfs files, ret=%d",
@@ -253,16 +253,59 @@ static ssize_t __ref store_sched_static_cluster_pwr_cost(struct device *dev,
 	return err;
 }
 
+static ssize_t show_sched_cluster_migration_cost(struct device *dev,
+				struct device_attribute *attr, char *buf)
+{
+	struct cpu *cpu = container_of(dev, struct cpu, dev);
+	int cpuid = cpu->dev.id;
+	ssize_t rc = 0;
+	int i, cost;
+
+	for (i = 0; (cost = sched_get_cluster_migration_cost(cpuid, i)) >= 0;
+	     i++)
+		rc += snprintf(buf + rc, PAGE_SIZE - rc - 2, "%d:%d ", i, cost);
+
+	rc += snprintf(buf + rc, PAGE_SIZE - rc, "\n");
+
+	return rc;
+}
+
+/* Accepts "<destination cluster id> <cost in ns>" */
+static ssize_t __ref store_sched_cluster_migration_cost(struct device *dev,
+				struct device_attribute *attr,
+				const char *buf, size_t count)
+{
+	struct cpu *cpu = container_of(dev, struct cpu, dev);
+	int err;
+	int cpuid = cpu->dev.id;
+	int dst_cluster;
+	unsigned int cost;
+
+	if (sscanf(buf, "%d %u", &dst_cluster, &cost) != 2)
+		return -EINVAL;
+
+	err = sched_set_cluster_migration_cost(cpuid, dst_cluster, cost);
+
+	if (err >= 0)
+		err = count;
+
+	return err;
+}
+
 static DEVICE_ATTR(sched_static_cpu_pwr_cost, 0644,
 					show_sched_static_cpu_pwr_cost,
 					store_sched_static_cpu_pwr_cost);
 static DEVICE_ATTR(sched_static_cluster_pwr_cost, 0644,
 					show_sched_static_cluster_pwr_cost,
 					store_sched_static_cluster_pwr_cost);
+static DEVICE_ATTR(sched_cluster_migration_cost, 0644,
+					show_sched_cluster_migration_cost,
+					store_sched_cluster_migration_cost);
 
 static struct attribute *hmp_sched_cpu_attrs[] = {
 	&dev_attr_sched_static_cpu_pwr_cost.attr,
 	&dev_attr_sched_static_cluster_pwr_cost.attr,
+	&dev_attr_sched_cluster_migration_cost.attr,
 	NULL
 };
 
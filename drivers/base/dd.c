@@ -18,6 +18,7 @@
  */
 
 #include <linux/device.h>
+#include <linux/ctype.h>
 #include <linux/delay.h>
 #include <linux/module.h>
 #include <linux/kthread.h>
@@ -25,6 +26,10 @@
 #include <linux/async.h>
 #include <linux/pm_runtime.h>
 #include <linux/pinctrl/devinfo.h>
+#include <linux/of.h>
+#include <linux/of_platform.h>
+#include <linux/slab.h>
+#include <soc/qcom/boot_timeline.h>
 
 #include "base.h"
 #include "power/power.h"
@@ -54,6 +59,136 @@ static LIST_HEAD(deferred_probe_active_list);
 static struct workqueue_struct *deferred_wq;
 static atomic_t deferred_trigger_count = ATOMIC_INIT(0);
 
+/*
+ * Device tree driven probing, enabled with "dt_async_probe" on the command
+ * line. A device whose suppliers, i.e. the nodes its phandle properties
+ * point at, are all bound already is probed asynchronously, unless its
+ * driver insists on synchronous probing. And until late_initcall, binding
+ * a device only retries the deferred devices that point at it; the full
+ * retries at the end of each initcall level catch anything else.
+ */
+static bool dt_async_probe;
+static bool dt_targeted_deferral;
+
+static int __init dt_async_probe_setup(char *str)
+{
+	dt_async_probe = true;
+	dt_targeted_deferral = true;
+	return 1;
+}
+__setup("dt_async_probe", dt_async_probe_setup);
+
+#ifdef CONFIG_OF
+static bool dt_is_supplier_prop(const char *name)
+{
+	static const char * const lists[] = {
+		"clocks", "interrupt-parent", "interrupts-extended",
+		"power-domains", "iommus", "mboxes", "dmas", "resets",
+		"phys", "io-channels", "gpios",
+	};
+	static const char * const suffixes[] = {
+		"-supply", "-gpios", "-gpio",
+	};
+	size_t len = strlen(name);
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(lists); i++)
+		if (!strcmp(name, lists[i]))
+			return true;
+	for (i = 0; i < ARRAY_SIZE(suffixes); i++) {
+		size_t slen = strlen(suffixes[i]);
+
+		if (len > slen && !strcmp(name + len - slen, suffixes[i]))
+			return true;
+	}
+	return !strncmp(name, "pinctrl-", 8) && isdigit(name[8]);
+}
+
+/*
+ * Calls fn on the supplier nodes of np until it returns non-zero. Every
+ * cell of a supplier property is tried as a phandle; an argument cell that
+ * happens to match one only makes the result more conservative.
+ */
+static int dt_for_each_supplier(struct device_node *np,
+				int (*fn)(struct device_node *, void *),
+				void *data)
+{
+	struct property *prop;
+	int ret = 0;
+
+	for_each_property_of_node(np, prop) {
+		const __be32 *cell = prop->value;
+		int i, n = prop->length / sizeof(*cell);
+
+		if (!dt_is_supplier_prop(prop->name))
+			continue;
+		for (i = 0; i < n && !ret; i++) {
+			struct device_node *sup;
+
+			sup = of_find_node_by_phandle(be32_to_cpup(cell + i));
+			if (!sup)
+				continue;
+			ret = fn(sup, data);
+			of_node_put(sup);
+		}
+		if (ret)
+			break;
+	}
+	return ret;
+}
+
+/* The supplier is provided by the closest platform device above it */
+static int dt_supplier_unbound(struct device_node *sup, void *unused)
+{
+	struct device_node *np = of_node_get(sup);
+	int unbound = 0;
+
+	while (np) {
+		struct platform_device *pdev = of_find_device_by_node(np);
+
+		if (pdev) {
+			unbound = !pdev->dev.driver;
+			put_device(&pdev->dev);
+			break;
+		}
+		np = of_get_next_parent(np);
+	}
+	of_node_put(np);
+	return unbound;
+}
+
+static bool dt_suppliers_bound(struct device *dev)
+{
+	return !dt_for_each_supplier(dev->of_node, dt_supplier_unbound, NULL);
+}
+
+static int dt_supplier_is(struct device_node *sup, void *data)
+{
+	struct device_node *np;
+
+	for (np = sup; np; np = np->parent)
+		if (np == data)
+			return 1;
+	return 0;
+}
+
+static bool dt_depends_on(struct device *dev, struct device *supplier)
+{
+	return dt_for_each_supplier(dev->of_node, dt_supplier_is,
+				    supplier->of_node);
+}
+#else
+static bool dt_suppliers_bound(struct device *dev)
+{
+	return false;
+}
+
+static bool dt_depends_on(struct device *dev, struct device *supplier)
+{
+	return true;
+}
+#endif
+
 /*
  * deferred_probe_work_func() - Retry probing devices in the active list.
  */
@@ -61,6 +196,12 @@ static void deferred_probe_work_func(struct work_struct *work)
 {
 	struct device *dev;
 	struct device_private *private;
+	static int round;
+	char tl_name[32];
+	int tl_id;
+
+	snprintf(tl_name, sizeof(tl_name), "deferred round %d", ++round);
+	tl_id = boot_timeline_begin(BOOT_TL_DEFERRED_PROBE, tl_name);
 	/*
 	 * This block processes every device in the deferred 'active' list.
 	 * Each device is removed from the active list and passed to
@@ -106,6 +247,7 @@ static void deferred_probe_work_func(struct work_struct *work)
 		put_device(dev);
 	}
 	mutex_unlock(&deferred_probe_mutex);
+	boot_timeline_end(tl_id);
 }
 static DECLARE_WORK(deferred_probe_work, deferred_probe_work_func);
 
@@ -171,8 +313,45 @@ static void driver_deferred_probe_trigger(void)
 	queue_work(deferred_wq, &deferred_probe_work);
 }
 
+/*
+ * Like driver_deferred_probe_trigger(), for the binding of @supplier: with
+ * dt_async_probe during boot, only the pending devices that may depend on
+ * it are retried.
+ */
+static void driver_deferred_probe_trigger_for(struct device *supplier)
+{
+	struct device_private *p, *n;
+	bool queued = false;
+
+	if (!ACCESS_ONCE(dt_targeted_deferral) || !supplier->of_node) {
+		driver_deferred_probe_trigger();
+		return;
+	}
+	if (!driver_deferred_probe_enable)
+		return;
+
+	mutex_lock(&deferred_probe_mutex);
+	atomic_inc(&deferred_trigger_count);
+	list_for_each_entry_safe(p, n, &deferred_probe_pending_list,
+				 deferred_probe) {
+		if (p->device->of_node &&
+		    !dt_depends_on(p->device, supplier))
+			continue;
+		list_move_tail(&p->deferred_probe, &deferred_probe_active_list);
+		queued = true;
+	}
+	mutex_unlock(&deferred_probe_mutex);
+
+	if (queued)
+		queue_work(deferred_wq, &deferred_probe_work);
+}
+
 static void enable_trigger_defer_cycle(void)
 {
+	/* whatever the asynchronous probes bind counts for this level */
+	if (dt_async_probe)
+		async_synchronize_full();
+
 	driver_deferred_probe_enable = true;
 	driver_deferred_probe_trigger();
 	/*
@@ -209,6 +388,9 @@ device_initcall_sync(deferred_probe_initcall);
 
 static int deferred_probe_enable_fn(void)
 {
+	/* From here on, any binding may be what a deferred device waits for */
+	dt_targeted_deferral = false;
+
 	/* Enable deferred probing for all time */
 	enable_trigger_defer_cycle();
 	return 0;
@@ -233,7 +415,7 @@ static void driver_bound(struct device *dev)
 	 * kick off retrying all pending devices
 	 */
 	driver_deferred_probe_del(dev);
-	driver_deferred_probe_trigger();
+	driver_deferred_probe_trigger_for(dev);
 
 	if (dev->bus)
 		blocking_notifier_call_chain(&dev->bus->p->bus_notifier,
@@ -302,11 +484,13 @@ static int really_probe(struct device *dev, struct device_driver *drv)
 {
 	int ret = 0;
 	int local_trigger_count = atomic_read(&deferred_trigger_count);
+	int tl_id;
 
 	atomic_inc(&probe_count);
 	pr_debug("bus: '%s': %s: probing driver %s with device %s\n",
 		 drv->bus->name, __func__, drv->name, dev_name(dev));
 	WARN_ON(!list_empty(&dev->devres_head));
+	tl_id = boot_timeline_begin(BOOT_TL_PROBE, dev_name(dev));
 
 	dev->driver = drv;
 
@@ -365,6 +549,7 @@ probe_failed:
 	 */
 	ret = 0;
 done:
+	boot_timeline_end(tl_id);
 	atomic_dec(&probe_count);
 	wake_up(&probe_waitqueue);
 	return ret;
@@ -442,6 +627,17 @@ bool driver_allows_async_probing(struct device_driver *drv)
 	}
 }
 
+static bool device_allows_async_probing(struct device_driver *drv,
+					struct device *dev)
+{
+	if (driver_allows_async_probing(drv))
+		return true;
+
+	return dt_async_probe && dev->of_node &&
+		drv->probe_type != PROBE_FORCE_SYNCHRONOUS &&
+		dt_suppliers_bound(dev);
+}
+
 struct device_attach_data {
 	struct device *dev;
 
@@ -493,7 +689,7 @@ static int __device_attach_driver(struct device_driver *drv, void *_data)
 	if (!driver_match_device(drv, dev))
 		return 0;
 
-	async_allowed = driver_allows_async_probing(drv);
+	async_allowed = device_allows_async_probing(drv, dev);
 
 	if (async_allowed)
 		data->have_async = true;
@@ -596,6 +792,53 @@ void device_initial_probe(struct device *dev)
 	__device_attach(dev, true);
 }
 
+struct driver_attach_async_data {
+	struct device *dev;
+	struct device_driver *drv;
+};
+
+static void __driver_attach_async_helper(void *_data, async_cookie_t cookie)
+{
+	struct driver_attach_async_data *data = _data;
+	struct device *dev = data->dev;
+
+	if (dev->parent)
+		device_lock(dev->parent);
+	device_lock(dev);
+	if (!dev->driver)
+		driver_probe_device(data->drv, dev);
+	device_unlock(dev);
+	if (dev->parent)
+		device_unlock(dev->parent);
+
+	put_device(dev);
+	kfree(data);
+}
+
+/*
+ * A driver that is not asynchronous itself still gets the devices whose
+ * suppliers are ready probed asynchronously with dt_async_probe.
+ * driver_detach() waits for these before the driver may go away.
+ */
+static bool driver_attach_async(struct device_driver *drv, struct device *dev)
+{
+	struct driver_attach_async_data *data;
+
+	if (!dt_async_probe || driver_allows_async_probing(drv) ||
+	    !device_allows_async_probing(drv, dev))
+		return false;
+
+	data = kmalloc(sizeof(*data), GFP_KERNEL);
+	if (!data)
+		return false;
+
+	data->dev = get_device(dev);
+	data->drv = drv;
+	dev_dbg(dev, "scheduling asynchronous probe\n");
+	async_schedule(__driver_attach_async_helper, data);
+	return true;
+}
+
 static int __driver_attach(struct device *dev, void *data)
 {
 	struct device_driver *drv = data;
@@ -613,6 +856,9 @@ static int __driver_attach(struct device *dev, void *data)
 	if (!driver_match_device(drv, dev))
 		return 0;
 
+	if (!dev->driver && driver_attach_async(drv, dev))
+		return 0;
+
 	if (dev->parent)	/* Needed for USB */
 		device_lock(dev->parent);
 	device_lock(dev);
@@ -709,6 +955,10 @@ void driver_detach(struct device_driver *drv)
 	struct device_private *dev_prv;
 	struct device *dev;
 
+	/* an asynchronous probe may still be about to bind one */
+	if (dt_async_probe)
+		async_synchronize_full();
+
 	for (;;) {
 		spin_lock(&drv->p->klist_devices.k_lock);
 		if (list_empty(&drv->p->klist_devices.k_list)) {
@@ -33,6 +33,7 @@
 #include <linux/cpuidle.h>
 #include <linux/timer.h>
 #include <linux/wakeup_reason.h>
+#include <linux/seq_file.h>
 
 #include "../base.h"
 #include "power.h"
@@ -734,6 +735,142 @@ void dpm_resume_start(pm_message_t state)
 }
 EXPORT_SYMBOL_GPL(dpm_resume_start);
 
+/*
+ * Resume timing breakdown. Every device whose "resume" callback runs during
+ * dpm_resume() gets a record. Records are appended as devices complete, so
+ * the table is ordered by end time, and each one points at the record that
+ * gated its start: the nearest recorded ancestor, or for a synchronous device
+ * the previous synchronous one, whichever finished last. Following those links
+ * back from the last device gives the critical path of the resume.
+ */
+#define DPM_RESUME_RECS		256
+
+struct dpm_resume_rec {
+	const struct device *dev;	/* Identity only, never dereferenced */
+	char name[32];
+	bool async;
+	int error;
+	int pred;
+	s64 queued;			/* usecs since dpm_resume() started */
+	s64 start;
+	s64 end;
+};
+
+static struct dpm_resume_rec dpm_resume_recs[DPM_RESUME_RECS];
+static unsigned int dpm_resume_nr_recs;
+static unsigned int dpm_resume_dropped;
+static int dpm_resume_last_sync;
+static ktime_t dpm_resume_base;
+static s64 dpm_resume_total;
+static DEFINE_MUTEX(dpm_resume_recs_mtx);
+
+static void dpm_resume_times_start(ktime_t base)
+{
+	mutex_lock(&dpm_resume_recs_mtx);
+	dpm_resume_base = base;
+	dpm_resume_nr_recs = 0;
+	dpm_resume_dropped = 0;
+	dpm_resume_last_sync = -1;
+	dpm_resume_total = 0;
+	mutex_unlock(&dpm_resume_recs_mtx);
+}
+
+static void dpm_resume_times_end(void)
+{
+	mutex_lock(&dpm_resume_recs_mtx);
+	dpm_resume_total = ktime_to_us(ktime_sub(ktime_get(), dpm_resume_base));
+	mutex_unlock(&dpm_resume_recs_mtx);
+}
+
+static int dpm_resume_find_rec(const struct device *dev)
+{
+	int i;
+
+	for (i = dpm_resume_nr_recs - 1; i >= 0; i--)
+		if (dpm_resume_recs[i].dev == dev)
+			return i;
+
+	return -1;
+}
+
+/*
+ * Must be called before the device's completion is signalled, so that the
+ * records of all ancestors exist by the time a child is recorded.
+ */
+static void dpm_resume_record(struct device *dev, bool async, int error,
+			      ktime_t queued, ktime_t start)
+{
+	struct dpm_resume_rec *rec;
+	struct device *parent;
+	ktime_t end = ktime_get();
+	int pred = -1;
+
+	mutex_lock(&dpm_resume_recs_mtx);
+	if (dpm_resume_nr_recs >= DPM_RESUME_RECS) {
+		dpm_resume_dropped++;
+		goto out;
+	}
+
+	for (parent = dev->parent; parent && pred < 0; parent = parent->parent)
+		pred = dpm_resume_find_rec(parent);
+	if (!async && dpm_resume_last_sync > pred)
+		pred = dpm_resume_last_sync;
+
+	rec = &dpm_resume_recs[dpm_resume_nr_recs];
+	rec->dev = dev;
+	strlcpy(rec->name, dev_name(dev), sizeof(rec->name));
+	rec->async = async;
+	rec->error = error;
+	rec->pred = pred;
+	rec->queued = ktime_to_us(ktime_sub(queued, dpm_resume_base));
+	rec->start = ktime_to_us(ktime_sub(start, dpm_resume_base));
+	rec->end = ktime_to_us(ktime_sub(end, dpm_resume_base));
+	if (!async)
+		dpm_resume_last_sync = dpm_resume_nr_recs;
+	dpm_resume_nr_recs++;
+ out:
+	mutex_unlock(&dpm_resume_recs_mtx);
+}
+
+static void dpm_resume_show_rec(struct seq_file *m,
+				const struct dpm_resume_rec *rec)
+{
+	seq_printf(m, "%-32s %-5s %8lld %8lld %8lld %8lld %d\n",
+		   rec->name, rec->async ? "async" : "sync", rec->queued,
+		   rec->start, rec->end, rec->end - rec->start, rec->error);
+}
+
+/**
+ * dpm_show_resume_times - Print the timing breakdown of the last resume.
+ * @m: seq_file to print to.
+ *
+ * All times are in microseconds since the start of dpm_resume().
+ */
+int dpm_show_resume_times(struct seq_file *m)
+{
+	static const char hdr[] = "%-32s %-5s %8s %8s %8s %8s %s\n";
+	int i;
+
+	mutex_lock(&dpm_resume_recs_mtx);
+	seq_printf(m, "total: %lld us, devices: %u, dropped: %u\n\n",
+		   dpm_resume_total, dpm_resume_nr_recs, dpm_resume_dropped);
+
+	seq_puts(m, "critical path (last device first):\n");
+	seq_printf(m, hdr, "device", "mode", "queued", "start", "end",
+		   "duration", "error");
+	for (i = dpm_resume_nr_recs - 1; i >= 0; i = dpm_resume_recs[i].pred)
+		dpm_resume_show_rec(m, &dpm_resume_recs[i]);
+
+	seq_puts(m, "\nall devices (by end time):\n");
+	seq_printf(m, hdr, "device", "mode", "queued", "start", "end",
+		   "duration", "error");
+	for (i = 0; i < dpm_resume_nr_recs; i++)
+		dpm_resume_show_rec(m, &dpm_resume_recs[i]);
+	mutex_unlock(&dpm_resume_recs_mtx);
+
+	return 0;
+}
+
 /**
  * device_resume - Execute "resume" callbacks for given device.
  * @dev: Device to handle.
@@ -745,6 +882,7 @@ static int device_resume(struct device *dev, pm_message_t state, bool async)
 	pm_callback_t callback = NULL;
 	char *info = NULL;
 	int error = 0;
+	ktime_t queued = ktime_get(), start = queued;
 	DECLARE_DPM_WATCHDOG_ON_STACK(wd);
 
 	TRACE_DEVICE(dev);
@@ -760,6 +898,7 @@ static int device_resume(struct device *dev, pm_message_t state, bool async)
 	}
 
 	dpm_wait(dev->parent, async);
+	start = ktime_get();
 	dpm_watchdog_set(&wd, dev);
 	device_lock(dev);
 
@@ -816,6 +955,8 @@ static int device_resume(struct device *dev, pm_message_t state, bool async)
  End:
 	error = dpm_run_callback(callback, dev, state, info);
 	dev->power.is_suspended = false;
+	if (callback)
+		dpm_resume_record(dev, async, error, queued, start);
 
  Unlock:
 	device_unlock(dev);
@@ -855,6 +996,7 @@ void dpm_resume(pm_message_t state)
 	trace_suspend_resume(TPS("dpm_resume"), state.event, true);
 	might_sleep();
 
+	dpm_resume_times_start(starttime);
 	mutex_lock(&dpm_list_mtx);
 	pm_transition = state;
 	async_error = 0;
@@ -891,6 +1033,7 @@ void dpm_resume(pm_message_t state)
 	}
 	mutex_unlock(&dpm_list_mtx);
 	async_synchronize_full();
+	dpm_resume_times_end();
 	dpm_show_time(starttime, state, NULL);
 
 	cpufreq_resume();
@@ -1636,6 +1779,11 @@ int dpm_prepare(pm_message_t state)
 	while (!list_empty(&dpm_list)) {
 		struct device *dev = to_device(dpm_list.next);
 
+		if (pm_wakeup_pending()) {
+			error = -EBUSY;
+			break;
+		}
+
 		get_device(dev);
 		mutex_unlock(&dpm_list_mtx);
 
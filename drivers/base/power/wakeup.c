@@ -755,6 +755,66 @@ void pm_print_active_wakeup_sources(void)
 }
 EXPORT_SYMBOL_GPL(pm_print_active_wakeup_sources);
 
+/*
+ * Blame the wakeup sources that are aborting the current suspend attempt: the
+ * active ones or, if there are none, the one that was active most recently.
+ * The cost of the attempt is charged to them by pm_wakeup_account_abort().
+ */
+static void pm_wakeup_mark_abort(void)
+{
+	struct wakeup_source *ws, *last_activity_ws = NULL;
+	unsigned long flags;
+	bool active = false;
+
+	rcu_read_lock();
+	list_for_each_entry_rcu(ws, &wakeup_sources, entry) {
+		if (ws->active) {
+			spin_lock_irqsave(&ws->lock, flags);
+			ws->abort_pending = true;
+			spin_unlock_irqrestore(&ws->lock, flags);
+			active = true;
+		} else if (!active &&
+			   (!last_activity_ws ||
+			    ktime_to_ns(ws->last_time) >
+			    ktime_to_ns(last_activity_ws->last_time))) {
+			last_activity_ws = ws;
+		}
+	}
+
+	if (!active && last_activity_ws) {
+		spin_lock_irqsave(&last_activity_ws->lock, flags);
+		last_activity_ws->abort_pending = true;
+		spin_unlock_irqrestore(&last_activity_ws->lock, flags);
+	}
+	rcu_read_unlock();
+}
+
+/**
+ * pm_wakeup_account_abort - Charge an aborted suspend attempt to its culprits.
+ * @cost: Time spent in the attempt, including unwinding it.
+ *
+ * Every wakeup source blamed for the abort is charged the full @cost. Does
+ * nothing if the attempt was not aborted by a wakeup event.
+ */
+void pm_wakeup_account_abort(ktime_t cost)
+{
+	struct wakeup_source *ws;
+	unsigned long flags;
+
+	rcu_read_lock();
+	list_for_each_entry_rcu(ws, &wakeup_sources, entry) {
+		if (!ws->abort_pending)
+			continue;
+
+		spin_lock_irqsave(&ws->lock, flags);
+		ws->abort_pending = false;
+		ws->abort_count++;
+		ws->abort_time = ktime_add(ws->abort_time, cost);
+		spin_unlock_irqrestore(&ws->lock, flags);
+	}
+	rcu_read_unlock();
+}
+
 /**
  * pm_wakeup_pending - Check if power transition in progress should be aborted.
  *
@@ -781,6 +841,7 @@ bool pm_wakeup_pending(void)
 	if (ret) {
 		pr_info("PM: Wakeup pending, aborting suspend\n");
 		pm_print_active_wakeup_sources();
+		pm_wakeup_mark_abort();
 	}
 
 	return ret || pm_abort_suspend;
@@ -927,12 +988,14 @@ static int print_wakeup_source_stats(struct seq_file *m,
 	}
 
 	ret = seq_printf(m, "%-32s\t%lu\t\t%lu\t\t%lu\t\t%lu\t\t"
-			"%lld\t\t%lld\t\t%lld\t\t%lld\t\t%lld\n",
+			"%lld\t\t%lld\t\t%lld\t\t%lld\t\t%lld\t\t"
+			"%lu\t\t%lld\n",
 			ws->name, active_count, ws->event_count,
 			ws->wakeup_count, ws->expire_count,
 			ktime_to_ms(active_time), ktime_to_ms(total_time),
 			ktime_to_ms(max_time), ktime_to_ms(ws->last_time),
-			ktime_to_ms(prevent_sleep_time));
+			ktime_to_ms(prevent_sleep_time),
+			ws->abort_count, ktime_to_ms(ws->abort_time));
 
 	spin_unlock_irqrestore(&ws->lock, flags);
 
@@ -949,7 +1012,8 @@ static int wakeup_sources_stats_show(struct seq_file *m, void *unused)
 
 	seq_puts(m, "name\t\t\t\t\tactive_count\tevent_count\twakeup_count\t"
 		"expire_count\tactive_since\ttotal_time\tmax_time\t"
-		"last_change\tprevent_suspend_time\n");
+		"last_change\tprevent_suspend_time\tabort_count\t"
+		"abort_time\n");
 
 	rcu_read_lock();
 	list_for_each_entry_rcu(ws, &wakeup_sources, entry)
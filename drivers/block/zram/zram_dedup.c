@@ -0,0 +1,177 @@
+/*
+ * Compressed RAM block device - content based deduplication
+ *
+ * Released under the terms of 3-clause BSD License
+ * Released under the terms of GNU General Public License Version 2.0
+ *
+ */
+
+#define KMSG_COMPONENT "zram"
+#define pr_fmt(fmt) KMSG_COMPONENT ": " fmt
+
+#include <linux/kernel.h>
+#include <linux/jhash.h>
+#include <linux/log2.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/vmalloc.h>
+
+#include "zram_drv.h"
+#include "zram_dedup.h"
+
+/* One hash bucket per this many pages of disksize */
+#define ZRAM_DEDUP_PAGES_PER_BUCKET	8
+
+u32 zram_dedup_checksum(unsigned char *mem)
+{
+	return jhash2((const u32 *)mem, PAGE_SIZE / sizeof(u32), 0);
+}
+
+static struct zram_hash *zram_dedup_bucket(struct zram_meta *meta,
+					   u32 checksum)
+{
+	return &meta->hash[checksum & (meta->hash_size - 1)];
+}
+
+/* Compare @mem against the object behind @entry, @buf is a scratch page */
+static bool zram_dedup_match(struct zram *zram, struct zram_dedup_entry *entry,
+			     unsigned char *mem, unsigned char *buf)
+{
+	struct zram_meta *meta = zram->meta;
+	unsigned char *cmem;
+	bool match;
+
+	cmem = zs_map_object(meta->mem_pool, entry->handle, ZS_MM_RO);
+	if (entry->len == PAGE_SIZE)
+		match = !memcmp(cmem, mem, PAGE_SIZE);
+	else
+		match = !zcomp_decompress(zram->comp, cmem, entry->len, buf) &&
+			!memcmp(buf, mem, PAGE_SIZE);
+	zs_unmap_object(meta->mem_pool, entry->handle);
+
+	return match;
+}
+
+/*
+ * Look up an object holding the same data as @mem. On success a reference
+ * to the returned entry is held for the caller. Only the first entry with
+ * a matching checksum is compared, a collision is simply a miss.
+ */
+struct zram_dedup_entry *zram_dedup_find(struct zram *zram,
+		unsigned char *mem, u32 checksum, unsigned char *buf)
+{
+	struct zram_hash *hash = zram_dedup_bucket(zram->meta, checksum);
+	struct zram_dedup_entry *entry;
+
+	spin_lock(&hash->lock);
+	hlist_for_each_entry(entry, &hash->head, node) {
+		if (entry->checksum != checksum)
+			continue;
+		entry->refcount++;
+		spin_unlock(&hash->lock);
+
+		if (zram_dedup_match(zram, entry, mem, buf)) {
+			atomic64_inc(&zram->stats.dedup_hits);
+			return entry;
+		}
+		zram_dedup_put(zram, entry);
+		return NULL;
+	}
+	spin_unlock(&hash->lock);
+
+	return NULL;
+}
+
+/* Publish a freshly stored object, the caller owns the first reference */
+struct zram_dedup_entry *zram_dedup_insert(struct zram *zram,
+		unsigned long handle, size_t len, u32 checksum)
+{
+	struct zram_hash *hash = zram_dedup_bucket(zram->meta, checksum);
+	struct zram_dedup_entry *entry;
+
+	entry = kmalloc(sizeof(*entry), GFP_NOIO | __GFP_NOWARN);
+	if (!entry)
+		return NULL;
+
+	entry->handle = handle;
+	entry->len = len;
+	entry->checksum = checksum;
+	entry->refcount = 1;
+
+	spin_lock(&hash->lock);
+	hlist_add_head(&entry->node, &hash->head);
+	spin_unlock(&hash->lock);
+
+	atomic64_add(sizeof(*entry), &zram->stats.meta_data_size);
+	return entry;
+}
+
+/*
+ * Drop a reference. The object is freed along with the last one, until
+ * then the slot going away only stops counting as duplicated data.
+ */
+void zram_dedup_put(struct zram *zram, struct zram_dedup_entry *entry)
+{
+	struct zram_meta *meta = zram->meta;
+	struct zram_hash *hash = zram_dedup_bucket(meta, entry->checksum);
+	int refcount;
+
+	spin_lock(&hash->lock);
+	refcount = --entry->refcount;
+	if (!refcount)
+		hlist_del(&entry->node);
+	spin_unlock(&hash->lock);
+
+	if (refcount) {
+		atomic64_sub(entry->len, &zram->stats.dup_data_size);
+		return;
+	}
+
+	zs_free(meta->mem_pool, entry->handle);
+	atomic64_sub(entry->len, &zram->stats.compr_data_size);
+	atomic64_sub(sizeof(*entry), &zram->stats.meta_data_size);
+	kfree(entry);
+}
+
+int zram_dedup_init(struct zram_meta *meta, size_t num_pages)
+{
+	size_t i;
+
+	meta->hash_size = roundup_pow_of_two(
+			max_t(size_t, num_pages / ZRAM_DEDUP_PAGES_PER_BUCKET, 1));
+	meta->hash = vzalloc(meta->hash_size * sizeof(*meta->hash));
+	if (!meta->hash) {
+		pr_err("Error allocating zram dedup hash\n");
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < meta->hash_size; i++) {
+		spin_lock_init(&meta->hash[i].lock);
+		INIT_HLIST_HEAD(&meta->hash[i].head);
+	}
+
+	return 0;
+}
+
+/* Free every shared object, the table slots pointing at them are gone */
+void zram_dedup_fini(struct zram_meta *meta)
+{
+	struct zram_dedup_entry *entry;
+	struct hlist_node *tmp;
+	size_t i;
+
+	if (!meta->hash)
+		return;
+
+	for (i = 0; i < meta->hash_size; i++) {
+		hlist_for_each_entry_safe(entry, tmp, &meta->hash[i].head,
+					  node) {
+			hlist_del(&entry->node);
+			zs_free(meta->mem_pool, entry->handle);
+			kfree(entry);
+		}
+	}
+
+	vfree(meta->hash);
+	meta->hash = NULL;
+}
@@ -32,8 +32,13 @@
 #include <linux/ratelimit.h>
 #include <linux/idr.h>
 #include <linux/sysfs.h>
+#include <linux/file.h>
+#include <linux/fs.h>
+#include <linux/workqueue.h>
+#include <linux/sched.h>
 
 #include "zram_drv.h"
+#include "zram_dedup.h"
 
 static DEFINE_IDR(zram_index_idr);
 /* idr index must be protected */
@@ -237,6 +242,256 @@ static void handle_zero_page(struct bio_vec *bvec)
 	flush_dcache_page(page);
 }
 
+#ifdef CONFIG_ZRAM_WRITEBACK
+#define ZRAM_WB_IDLE	1
+#define ZRAM_WB_HUGE	2
+
+static void reset_bdev(struct zram *zram)
+{
+	struct block_device *bdev;
+
+	if (!zram->backing_dev)
+		return;
+
+	bdev = zram->bdev;
+	if (zram->old_block_size)
+		set_blocksize(bdev, zram->old_block_size);
+	blkdev_put(bdev, FMODE_READ | FMODE_WRITE | FMODE_EXCL);
+	/* hope filp_close flush all of IO */
+	filp_close(zram->backing_dev, NULL);
+	zram->backing_dev = NULL;
+	zram->old_block_size = 0;
+	zram->bdev = NULL;
+
+	vfree(zram->bitmap);
+	zram->bitmap = NULL;
+}
+
+static ssize_t backing_dev_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+	struct file *file;
+	char *p;
+	ssize_t ret;
+
+	down_read(&zram->init_lock);
+	file = zram->backing_dev;
+	if (!file) {
+		memcpy(buf, "none\n", 5);
+		up_read(&zram->init_lock);
+		return 5;
+	}
+
+	p = d_path(&file->f_path, buf, PAGE_SIZE - 1);
+	if (IS_ERR(p)) {
+		ret = PTR_ERR(p);
+		goto out;
+	}
+
+	ret = strlen(p);
+	memmove(buf, p, ret);
+	buf[ret++] = '\n';
+out:
+	up_read(&zram->init_lock);
+	return ret;
+}
+
+static ssize_t backing_dev_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	char *file_name;
+	size_t sz;
+	struct file *backing_dev = NULL;
+	struct inode *inode;
+	struct address_space *mapping;
+	unsigned int bitmap_sz, old_block_size = 0;
+	unsigned long nr_pages, *bitmap = NULL;
+	struct block_device *bdev = NULL;
+	int err;
+	struct zram *zram = dev_to_zram(dev);
+
+	file_name = kmalloc(PATH_MAX, GFP_KERNEL);
+	if (!file_name)
+		return -ENOMEM;
+
+	down_write(&zram->init_lock);
+	if (init_done(zram)) {
+		pr_info("Can't setup backing device for initialized device\n");
+		err = -EBUSY;
+		goto out;
+	}
+
+	strlcpy(file_name, buf, PATH_MAX);
+	/* ignore trailing newline */
+	sz = strlen(file_name);
+	if (sz > 0 && file_name[sz - 1] == '\n')
+		file_name[sz - 1] = 0x00;
+
+	backing_dev = filp_open(file_name, O_RDWR|O_LARGEFILE, 0);
+	if (IS_ERR(backing_dev)) {
+		err = PTR_ERR(backing_dev);
+		backing_dev = NULL;
+		goto out;
+	}
+
+	mapping = backing_dev->f_mapping;
+	inode = mapping->host;
+
+	/* Support only block device in this moment */
+	if (!S_ISBLK(inode->i_mode)) {
+		err = -ENOTBLK;
+		goto out;
+	}
+
+	bdev = bdgrab(I_BDEV(inode));
+	err = blkdev_get(bdev, FMODE_READ | FMODE_WRITE | FMODE_EXCL, zram);
+	if (err < 0) {
+		bdev = NULL;
+		goto out;
+	}
+
+	nr_pages = i_size_read(inode) >> PAGE_SHIFT;
+	bitmap_sz = BITS_TO_LONGS(nr_pages) * sizeof(long);
+	bitmap = vzalloc(bitmap_sz);
+	if (!bitmap) {
+		err = -ENOMEM;
+		goto out;
+	}
+
+	old_block_size = block_size(bdev);
+	err = set_blocksize(bdev, PAGE_SIZE);
+	if (err)
+		goto out;
+
+	reset_bdev(zram);
+
+	zram->old_block_size = old_block_size;
+	zram->bdev = bdev;
+	zram->backing_dev = backing_dev;
+	zram->bitmap = bitmap;
+	zram->nr_pages = nr_pages;
+	up_write(&zram->init_lock);
+
+	pr_info("setup backing device %s\n", file_name);
+	kfree(file_name);
+
+	return len;
+out:
+	if (bitmap)
+		vfree(bitmap);
+
+	if (bdev)
+		blkdev_put(bdev, FMODE_READ | FMODE_WRITE | FMODE_EXCL);
+
+	if (backing_dev)
+		filp_close(backing_dev, NULL);
+
+	up_write(&zram->init_lock);
+
+	kfree(file_name);
+
+	return err;
+}
+
+static unsigned long alloc_block_bdev(struct zram *zram)
+{
+	unsigned long blk_idx = 1;
+retry:
+	/* skip 0 bit to confuse zram.handle = 0 */
+	blk_idx = find_next_zero_bit(zram->bitmap, zram->nr_pages, blk_idx);
+	if (blk_idx == zram->nr_pages)
+		return 0;
+
+	if (test_and_set_bit(blk_idx, zram->bitmap))
+		goto retry;
+
+	atomic64_inc(&zram->stats.bd_count);
+	return blk_idx;
+}
+
+static void free_block_bdev(struct zram *zram, unsigned long blk_idx)
+{
+	int was_set;
+
+	was_set = test_and_clear_bit(blk_idx, zram->bitmap);
+	WARN_ON_ONCE(!was_set);
+	atomic64_dec(&zram->stats.bd_count);
+}
+
+static int zram_bdev_rw_page(struct zram *zram, struct page *page,
+			     unsigned long entry, int rw)
+{
+	struct bio *bio;
+	int ret;
+
+	bio = bio_alloc(GFP_NOIO, 1);
+	if (!bio)
+		return -ENOMEM;
+
+	bio->bi_iter.bi_sector = entry * (PAGE_SIZE >> 9);
+	bio->bi_bdev = zram->bdev;
+	if (!bio_add_page(bio, page, PAGE_SIZE, 0)) {
+		bio_put(bio);
+		return -EIO;
+	}
+
+	ret = submit_bio_wait(rw, bio);
+	bio_put(bio);
+	return ret;
+}
+
+struct zram_work {
+	struct work_struct work;
+	struct zram *zram;
+	unsigned long entry;
+	struct page *page;
+	int ret;
+};
+
+static void zram_sync_read(struct work_struct *work)
+{
+	struct zram_work *zw = container_of(work, struct zram_work, work);
+
+	zw->ret = zram_bdev_rw_page(zw->zram, zw->page, zw->entry, READ);
+}
+
+/*
+ * Block layer wants one ->make_request_fn to be active at a time, so
+ * waiting for a bio to the backing device from within our own
+ * make_request would deadlock. In that case do the read from a worker.
+ */
+static int read_from_bdev(struct zram *zram, struct page *page,
+			  unsigned long entry)
+{
+	struct zram_work work;
+
+	atomic64_inc(&zram->stats.bd_reads);
+	if (!current->bio_list)
+		return zram_bdev_rw_page(zram, page, entry, READ);
+
+	work.zram = zram;
+	work.page = page;
+	work.entry = entry;
+
+	INIT_WORK_ONSTACK(&work.work, zram_sync_read);
+	queue_work(system_unbound_wq, &work.work);
+	flush_work(&work.work);
+	destroy_work_on_stack(&work.work);
+
+	return work.ret;
+}
+#else
+static inline void reset_bdev(struct zram *zram) {};
+static inline void free_block_bdev(struct zram *zram,
+				   unsigned long blk_idx) {};
+static inline int read_from_bdev(struct zram *zram, struct page *page,
+				 unsigned long entry)
+{
+	return -EIO;
+}
+#endif
+
 static ssize_t initstate_show(struct device *dev,
 		struct device_attribute *attr, char *buf)
 {
@@ -435,6 +690,126 @@ static ssize_t comp_algorithm_store(struct device *dev,
 	return len;
 }
 
+static ssize_t recomp_algorithm_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	size_t sz;
+	struct zram *zram = dev_to_zram(dev);
+
+	down_read(&zram->init_lock);
+	sz = zcomp_available_show(zram->recomp_compressor, buf);
+	up_read(&zram->init_lock);
+
+	return sz;
+}
+
+static ssize_t recomp_algorithm_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	size_t sz;
+
+	down_write(&zram->init_lock);
+	if (init_done(zram)) {
+		up_write(&zram->init_lock);
+		pr_info("Can't change algorithm for initialized device\n");
+		return -EBUSY;
+	}
+	strlcpy(zram->recomp_compressor, buf, sizeof(zram->recomp_compressor));
+
+	/* ignore trailing newline */
+	sz = strlen(zram->recomp_compressor);
+	if (sz > 0 && zram->recomp_compressor[sz - 1] == '\n')
+		zram->recomp_compressor[sz - 1] = 0x00;
+
+	/* an empty string disables recompression */
+	if (zram->recomp_compressor[0] &&
+	    !zcomp_available_algorithm(zram->recomp_compressor)) {
+		zram->recomp_compressor[0] = 0x00;
+		len = -EINVAL;
+	}
+
+	up_write(&zram->init_lock);
+	return len;
+}
+
+static ssize_t recomp_threshold_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+
+	return scnprintf(buf, PAGE_SIZE, "%u\n", zram->recomp_threshold);
+}
+
+static ssize_t recomp_threshold_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	unsigned int val;
+	int ret;
+
+	ret = kstrtouint(buf, 0, &val);
+	if (ret || val > PAGE_SIZE)
+		return -EINVAL;
+
+	zram->recomp_threshold = val;
+	return len;
+}
+
+#ifdef CONFIG_ZRAM_DEDUP
+static ssize_t use_dedup_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+	bool val;
+
+	down_read(&zram->init_lock);
+	val = zram->use_dedup;
+	up_read(&zram->init_lock);
+
+	return scnprintf(buf, PAGE_SIZE, "%d\n", (int)val);
+}
+
+static ssize_t use_dedup_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	bool val;
+
+	if (strtobool(buf, &val))
+		return -EINVAL;
+
+	down_write(&zram->init_lock);
+	if (init_done(zram)) {
+		up_write(&zram->init_lock);
+		pr_info("Can't change dedup usage for initialized device\n");
+		return -EBUSY;
+	}
+	zram->use_dedup = val;
+	up_write(&zram->init_lock);
+
+	return len;
+}
+
+static ssize_t dedup_stat_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+	ssize_t ret;
+
+	down_read(&zram->init_lock);
+	ret = scnprintf(buf, PAGE_SIZE,
+		"%8llu %8llu %8llu %8llu\n",
+		(u64)atomic64_read(&zram->stats.dup_data_size),
+		(u64)atomic64_read(&zram->stats.meta_data_size),
+		(u64)atomic64_read(&zram->stats.dedup_hits),
+		(u64)atomic64_read(&zram->stats.dedup_ns));
+	up_read(&zram->init_lock);
+
+	return ret;
+}
+#endif
+
 static ssize_t compact_store(struct device *dev,
 		struct device_attribute *attr, const char *buf, size_t len)
 {
@@ -493,14 +868,15 @@ static ssize_t mm_stat_show(struct device *dev,
 	max_used = atomic_long_read(&zram->stats.max_used_pages);
 
 	ret = scnprintf(buf, PAGE_SIZE,
-			"%8llu %8llu %8llu %8lu %8ld %8llu %8lu %8lu\n",
+			"%8llu %8llu %8llu %8lu %8ld %8llu %8lu %8lu %8lu\n",
 			orig_size << PAGE_SHIFT,
 			(u64)atomic64_read(&zram->stats.compr_data_size),
 			mem_used << PAGE_SHIFT,
 			zram->limit_pages << PAGE_SHIFT,
 			max_used << PAGE_SHIFT,
 			(u64)atomic64_read(&zram->stats.zero_pages),
-			pool_stats.pages_compacted, pool_stats.pages_moved);
+			pool_stats.pages_compacted, pool_stats.pages_moved,
+			pool_stats.compact_time_ms);
 	up_read(&zram->init_lock);
 
 	return ret;
@@ -538,12 +914,18 @@ static void zram_meta_free(struct zram_meta *meta, u64 disksize)
 	for (index = 0; index < num_pages; index++) {
 		unsigned long handle = meta->table[index].handle;
 
-		if (!handle)
+		/*
+		 * Backing device blocks go away with the bitmap and shared
+		 * objects with the dedup hash.
+		 */
+		if (!handle || zram_test_flag(meta, index, ZRAM_WB) ||
+		    zram_test_flag(meta, index, ZRAM_DEDUP))
 			continue;
 
 		zs_free(meta->mem_pool, handle);
 	}
 
+	zram_dedup_fini(meta);
 	zs_destroy_pool(meta->mem_pool);
 	vfree(meta->table);
 	kfree(meta);
@@ -557,6 +939,9 @@ static struct zram_meta *zram_meta_alloc(char *pool_name, u64 disksize)
 	if (!meta)
 		return NULL;
 
+#ifdef CONFIG_ZRAM_DEDUP
+	meta->hash = NULL;
+#endif
 	num_pages = disksize >> PAGE_SHIFT;
 	meta->table = vzalloc(num_pages * sizeof(*meta->table));
 	if (!meta->table) {
@@ -589,6 +974,27 @@ static void zram_free_page(struct zram *zram, size_t index)
 	struct zram_meta *meta = zram->meta;
 	unsigned long handle = meta->table[index].handle;
 
+	zram_clear_flag(meta, index, ZRAM_IDLE);
+	zram_clear_flag(meta, index, ZRAM_HUGE);
+	zram_clear_flag(meta, index, ZRAM_RECOMP);
+
+	if (zram_test_flag(meta, index, ZRAM_WB)) {
+		zram_clear_flag(meta, index, ZRAM_WB);
+		free_block_bdev(zram, handle);
+		atomic64_dec(&zram->stats.pages_stored);
+		meta->table[index].handle = 0;
+		return;
+	}
+
+	if (zram_test_flag(meta, index, ZRAM_DEDUP)) {
+		zram_clear_flag(meta, index, ZRAM_DEDUP);
+		zram_dedup_put(zram, (struct zram_dedup_entry *)handle);
+		atomic64_dec(&zram->stats.pages_stored);
+		meta->table[index].handle = 0;
+		zram_set_obj_size(meta, index, 0);
+		return;
+	}
+
 	if (unlikely(!handle)) {
 		/*
 		 * No memory is allocated for zero filled pages.
@@ -611,29 +1017,91 @@ static void zram_free_page(struct zram *zram, size_t index)
 	zram_set_obj_size(meta, index, 0);
 }
 
+/* Read a written back slot into @mem, may sleep */
+static int zram_read_wb_page(struct zram *zram, char *mem, unsigned long entry)
+{
+	struct page *page;
+	void *src;
+	int ret;
+
+	page = alloc_page(GFP_NOIO);
+	if (!page)
+		return -ENOMEM;
+
+	ret = read_from_bdev(zram, page, entry);
+	if (!ret) {
+		src = kmap_atomic(page);
+		memcpy(mem, src, PAGE_SIZE);
+		kunmap_atomic(src);
+	}
+	__free_page(page);
+	return ret;
+}
+
+static inline void zram_account_comp(struct zram *zram, int id,
+				     size_t clen, u64 start)
+{
+	struct zram_comp_stats *stats = &zram->stats.comp[id];
+
+	atomic64_inc(&stats->nr_comp);
+	atomic64_add(clen, &stats->compr_size);
+	atomic64_add(local_clock() - start, &stats->comp_ns);
+}
+
+static inline void zram_account_decomp(struct zram *zram, int id, u64 start)
+{
+	struct zram_comp_stats *stats = &zram->stats.comp[id];
+
+	atomic64_inc(&stats->nr_decomp);
+	atomic64_add(local_clock() - start, &stats->decomp_ns);
+}
+
+static inline void zram_account_dedup(struct zram *zram, u64 start)
+{
+	atomic64_add(local_clock() - start, &zram->stats.dedup_ns);
+}
+
 static int zram_decompress_page(struct zram *zram, char *mem, u32 index)
 {
 	int ret = 0;
 	unsigned char *cmem;
 	struct zram_meta *meta = zram->meta;
+	struct zcomp *comp = zram->comp;
+	int id = ZRAM_PRIMARY_COMP;
 	unsigned long handle;
 	size_t size;
+	u64 start;
 
 	bit_spin_lock(ZRAM_ACCESS, &meta->table[index].value);
 	handle = meta->table[index].handle;
 	size = zram_get_obj_size(meta, index);
 
+	if (zram_test_flag(meta, index, ZRAM_WB)) {
+		bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
+		return zram_read_wb_page(zram, mem, handle);
+	}
+
 	if (!handle || zram_test_flag(meta, index, ZRAM_ZERO)) {
 		bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
 		memset(mem, 0, PAGE_SIZE);
 		return 0;
 	}
 
+	if (zram_test_flag(meta, index, ZRAM_RECOMP)) {
+		comp = zram->recomp;
+		id = ZRAM_SECONDARY_COMP;
+	}
+	if (zram_test_flag(meta, index, ZRAM_DEDUP))
+		handle = zram_dedup_handle(handle);
+
 	cmem = zs_map_object(meta->mem_pool, handle, ZS_MM_RO);
-	if (size == PAGE_SIZE)
+	if (size == PAGE_SIZE) {
 		memcpy(mem, cmem, PAGE_SIZE);
-	else
-		ret = zcomp_decompress(zram->comp, cmem, size, mem);
+	} else {
+		start = local_clock();
+		ret = zcomp_decompress(comp, cmem, size, mem);
+		zram_account_decomp(zram, id, start);
+	}
 	zs_unmap_object(meta->mem_pool, handle);
 	bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
 
@@ -656,6 +1124,7 @@ static int zram_bvec_read(struct zram *zram, struct bio_vec *bvec,
 	page = bvec->bv_page;
 
 	bit_spin_lock(ZRAM_ACCESS, &meta->table[index].value);
+	zram_clear_flag(meta, index, ZRAM_IDLE);
 	if (unlikely(!meta->table[index].handle) ||
 			zram_test_flag(meta, index, ZRAM_ZERO)) {
 		bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
@@ -668,7 +1137,11 @@ static int zram_bvec_read(struct zram *zram, struct bio_vec *bvec,
 		/* Use  a temporary buffer to decompress the page */
 		uncmem = kmalloc(PAGE_SIZE, GFP_NOIO);
 
-	user_mem = kmap_atomic(page);
+	/*
+	 * Not kmap_atomic(): a written back slot is read from the backing
+	 * device, which sleeps.
+	 */
+	user_mem = kmap(page);
 	if (!is_partial_io(bvec))
 		uncmem = user_mem;
 
@@ -690,7 +1163,7 @@ static int zram_bvec_read(struct zram *zram, struct bio_vec *bvec,
 	flush_dcache_page(page);
 	ret = 0;
 out_cleanup:
-	kunmap_atomic(user_mem);
+	kunmap(page);
 	if (is_partial_io(bvec))
 		kfree(uncmem);
 	return ret;
@@ -706,8 +1179,11 @@ static int zram_bvec_write(struct zram *zram, struct bio_vec *bvec, u32 index,
 	unsigned char *user_mem, *cmem, *src, *uncmem = NULL;
 	struct zram_meta *meta = zram->meta;
 	struct zcomp_strm *zstrm = NULL;
+	struct zram_dedup_entry *entry = NULL;
 	unsigned long alloced_pages;
 	static unsigned long zram_rs_time;
+	u32 checksum = 0;
+	u64 start;
 
 	page = bvec->bv_page;
 	if (is_partial_io(bvec)) {
@@ -751,7 +1227,33 @@ static int zram_bvec_write(struct zram *zram, struct bio_vec *bvec, u32 index,
 		goto out;
 	}
 
+	if (zram_dedup_enabled(meta)) {
+		start = local_clock();
+		checksum = zram_dedup_checksum(uncmem);
+		entry = zram_dedup_find(zram, uncmem, checksum, zstrm->buffer);
+		zram_account_dedup(zram, start);
+	}
+
+	if (entry) {
+		if (user_mem)
+			kunmap_atomic(user_mem);
+		bit_spin_lock(ZRAM_ACCESS, &meta->table[index].value);
+		zram_free_page(zram, index);
+		meta->table[index].handle = (unsigned long)entry;
+		zram_set_obj_size(meta, index, entry->len);
+		zram_set_flag(meta, index, ZRAM_DEDUP);
+		bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
+
+		atomic64_add(entry->len, &zram->stats.dup_data_size);
+		atomic64_inc(&zram->stats.pages_stored);
+		ret = 0;
+		goto out;
+	}
+
+	start = local_clock();
 	ret = zcomp_compress(zram->comp, zstrm, uncmem, &clen);
+	if (!ret)
+		zram_account_comp(zram, ZRAM_PRIMARY_COMP, clen, start);
 	if (!is_partial_io(bvec)) {
 		kunmap_atomic(user_mem);
 		user_mem = NULL;
@@ -803,6 +1305,9 @@ static int zram_bvec_write(struct zram *zram, struct bio_vec *bvec, u32 index,
 	zstrm = NULL;
 	zs_unmap_object(meta->mem_pool, handle);
 
+	if (zram_dedup_enabled(meta))
+		entry = zram_dedup_insert(zram, handle, clen, checksum);
+
 	/*
 	 * Free memory associated with this sector
 	 * before overwriting unused sectors.
@@ -810,7 +1315,14 @@ static int zram_bvec_write(struct zram *zram, struct bio_vec *bvec, u32 index,
 	bit_spin_lock(ZRAM_ACCESS, &meta->table[index].value);
 	zram_free_page(zram, index);
 
-	meta->table[index].handle = handle;
+	if (entry) {
+		meta->table[index].handle = (unsigned long)entry;
+		zram_set_flag(meta, index, ZRAM_DEDUP);
+	} else {
+		meta->table[index].handle = handle;
+		if (clen == PAGE_SIZE)
+			zram_set_flag(meta, index, ZRAM_HUGE);
+	}
 	zram_set_obj_size(meta, index, clen);
 	bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
 
@@ -825,6 +1337,359 @@ out:
 	return ret;
 }
 
+#ifdef CONFIG_ZRAM_WRITEBACK
+/* Slot must be held locked. Huge and idle modes select either kind */
+static bool zram_wb_eligible(struct zram_meta *meta, u32 index, int mode)
+{
+	if (!meta->table[index].handle ||
+	    zram_test_flag(meta, index, ZRAM_WB) ||
+	    zram_test_flag(meta, index, ZRAM_ZERO) ||
+	    zram_test_flag(meta, index, ZRAM_DEDUP))
+		return false;
+
+	return ((mode & ZRAM_WB_IDLE) &&
+		zram_test_flag(meta, index, ZRAM_IDLE)) ||
+	       ((mode & ZRAM_WB_HUGE) &&
+		zram_test_flag(meta, index, ZRAM_HUGE));
+}
+
+/*
+ * Write one slot out to the backing device. The slot is decompressed and
+ * written without holding its lock and only switched over to the backing
+ * block if nobody rewrote or freed it in the meantime.
+ */
+static int zram_writeback_slot(struct zram *zram, struct page *page,
+			       u32 index, int mode)
+{
+	struct zram_meta *meta = zram->meta;
+	unsigned long handle, blk_idx;
+	void *mem;
+	int ret;
+
+	bit_spin_lock(ZRAM_ACCESS, &meta->table[index].value);
+	handle = meta->table[index].handle;
+	if (!zram_wb_eligible(meta, index, mode)) {
+		bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
+		return 0;
+	}
+	bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
+
+	blk_idx = alloc_block_bdev(zram);
+	if (!blk_idx)
+		return -ENOSPC;
+
+	mem = kmap(page);
+	ret = zram_decompress_page(zram, mem, index);
+	kunmap(page);
+	if (ret)
+		goto out_free_block;
+
+	ret = zram_bdev_rw_page(zram, page, blk_idx, WRITE | REQ_SYNC);
+	if (ret)
+		goto out_free_block;
+	atomic64_inc(&zram->stats.bd_writes);
+
+	bit_spin_lock(ZRAM_ACCESS, &meta->table[index].value);
+	if (meta->table[index].handle != handle ||
+	    !zram_wb_eligible(meta, index, mode)) {
+		bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
+		goto out_free_block;
+	}
+	zram_free_page(zram, index);
+	zram_set_flag(meta, index, ZRAM_WB);
+	meta->table[index].handle = blk_idx;
+	atomic64_inc(&zram->stats.pages_stored);
+	bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
+	return 0;
+
+out_free_block:
+	free_block_bdev(zram, blk_idx);
+	return ret;
+}
+
+static void zram_writeback_work(struct work_struct *work)
+{
+	struct zram *zram = container_of(work, struct zram, wb_work);
+	unsigned long nr_pages, index;
+	struct page *page;
+
+	page = alloc_page(GFP_KERNEL);
+	if (!page)
+		return;
+
+	down_read(&zram->init_lock);
+	if (!init_done(zram) || !zram->backing_dev)
+		goto out;
+
+	nr_pages = zram->disksize >> PAGE_SHIFT;
+	for (index = 0; index < nr_pages; index++) {
+		if (zram_writeback_slot(zram, page, index, zram->wb_mode) ==
+		    -ENOSPC)
+			break;
+		cond_resched();
+	}
+out:
+	up_read(&zram->init_lock);
+	__free_page(page);
+}
+
+static ssize_t writeback_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	ssize_t ret = len;
+	int mode;
+
+	if (sysfs_streq(buf, "idle"))
+		mode = ZRAM_WB_IDLE;
+	else if (sysfs_streq(buf, "huge"))
+		mode = ZRAM_WB_HUGE;
+	else if (sysfs_streq(buf, "idle_huge"))
+		mode = ZRAM_WB_IDLE | ZRAM_WB_HUGE;
+	else
+		return -EINVAL;
+
+	down_read(&zram->init_lock);
+	if (!init_done(zram) || !zram->backing_dev) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	zram->wb_mode = mode;
+	if (!queue_work(system_unbound_wq, &zram->wb_work))
+		ret = -EBUSY;
+out:
+	up_read(&zram->init_lock);
+	return ret;
+}
+
+static ssize_t bd_stat_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+	ssize_t ret;
+
+	down_read(&zram->init_lock);
+	ret = scnprintf(buf, PAGE_SIZE,
+		"%8llu %8llu %8llu\n",
+		(u64)atomic64_read(&zram->stats.bd_count) << PAGE_SHIFT,
+		(u64)atomic64_read(&zram->stats.bd_reads),
+		(u64)atomic64_read(&zram->stats.bd_writes));
+	up_read(&zram->init_lock);
+
+	return ret;
+}
+#endif
+
+static ssize_t idle_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	struct zram_meta *meta;
+	unsigned long nr_pages, index;
+
+	if (!sysfs_streq(buf, "all"))
+		return -EINVAL;
+
+	down_read(&zram->init_lock);
+	if (!init_done(zram)) {
+		up_read(&zram->init_lock);
+		return -EINVAL;
+	}
+
+	meta = zram->meta;
+	nr_pages = zram->disksize >> PAGE_SHIFT;
+	for (index = 0; index < nr_pages; index++) {
+		bit_spin_lock(ZRAM_ACCESS, &meta->table[index].value);
+		if (meta->table[index].handle &&
+		    !zram_test_flag(meta, index, ZRAM_WB))
+			zram_set_flag(meta, index, ZRAM_IDLE);
+		bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
+	}
+	up_read(&zram->init_lock);
+
+	return len;
+}
+
+#define ZRAM_RECOMP_IDLE	1
+#define ZRAM_RECOMP_ALL		2
+
+/*
+ * Recompress one slot with the secondary algorithm. As with writeback the
+ * slot is only swapped over if it is unchanged once the new object is ready,
+ * and the result is kept only when it is smaller than what is stored.
+ */
+static int zram_recompress_slot(struct zram *zram, struct page *page,
+				u32 index, int mode)
+{
+	struct zram_meta *meta = zram->meta;
+	struct zcomp_strm *zstrm;
+	unsigned long handle, new_handle;
+	size_t size, clen;
+	void *mem, *cmem;
+	bool idle;
+	u64 start;
+	int ret;
+
+	bit_spin_lock(ZRAM_ACCESS, &meta->table[index].value);
+	handle = meta->table[index].handle;
+	size = zram_get_obj_size(meta, index);
+	if (!handle || size < zram->recomp_threshold ||
+	    zram_test_flag(meta, index, ZRAM_WB) ||
+	    zram_test_flag(meta, index, ZRAM_ZERO) ||
+	    zram_test_flag(meta, index, ZRAM_RECOMP) ||
+	    zram_test_flag(meta, index, ZRAM_DEDUP) ||
+	    (mode == ZRAM_RECOMP_IDLE &&
+	     !zram_test_flag(meta, index, ZRAM_IDLE))) {
+		bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
+		return 0;
+	}
+	bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
+
+	mem = kmap(page);
+	ret = zram_decompress_page(zram, mem, index);
+	if (ret) {
+		kunmap(page);
+		return ret;
+	}
+
+	zstrm = zcomp_strm_find(zram->recomp);
+	start = local_clock();
+	ret = zcomp_compress(zram->recomp, zstrm, mem, &clen);
+	kunmap(page);
+	if (ret)
+		goto out;
+	zram_account_comp(zram, ZRAM_SECONDARY_COMP, clen, start);
+
+	if (clen >= size)
+		goto out;
+
+	new_handle = zs_malloc(meta->mem_pool, clen);
+	if (!new_handle) {
+		ret = -ENOMEM;
+		goto out;
+	}
+	cmem = zs_map_object(meta->mem_pool, new_handle, ZS_MM_WO);
+	memcpy(cmem, zstrm->buffer, clen);
+	zs_unmap_object(meta->mem_pool, new_handle);
+	zcomp_strm_release(zram->recomp, zstrm);
+
+	bit_spin_lock(ZRAM_ACCESS, &meta->table[index].value);
+	if (meta->table[index].handle != handle ||
+	    zram_test_flag(meta, index, ZRAM_WB) ||
+	    zram_test_flag(meta, index, ZRAM_RECOMP) ||
+	    zram_test_flag(meta, index, ZRAM_DEDUP)) {
+		bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
+		zs_free(meta->mem_pool, new_handle);
+		return 0;
+	}
+	idle = zram_test_flag(meta, index, ZRAM_IDLE);
+	zram_free_page(zram, index);
+	meta->table[index].handle = new_handle;
+	zram_set_obj_size(meta, index, clen);
+	zram_set_flag(meta, index, ZRAM_RECOMP);
+	if (idle)
+		zram_set_flag(meta, index, ZRAM_IDLE);
+	bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
+
+	atomic64_add(clen, &zram->stats.compr_data_size);
+	atomic64_inc(&zram->stats.pages_stored);
+	atomic64_inc(&zram->stats.recomp_pages);
+	atomic64_add(size - clen, &zram->stats.recomp_saved);
+	update_used_max(zram, zs_get_total_pages(meta->mem_pool));
+	return 0;
+
+out:
+	zcomp_strm_release(zram->recomp, zstrm);
+	return ret;
+}
+
+static void zram_recompress_work(struct work_struct *work)
+{
+	struct zram *zram = container_of(work, struct zram, recomp_work);
+	unsigned long nr_pages, index;
+	struct page *page;
+
+	page = alloc_page(GFP_KERNEL);
+	if (!page)
+		return;
+
+	down_read(&zram->init_lock);
+	if (!init_done(zram) || !zram->recomp)
+		goto out;
+
+	nr_pages = zram->disksize >> PAGE_SHIFT;
+	for (index = 0; index < nr_pages; index++) {
+		if (zram_recompress_slot(zram, page, index,
+					 zram->recomp_mode) == -ENOMEM)
+			break;
+		cond_resched();
+	}
+out:
+	up_read(&zram->init_lock);
+	__free_page(page);
+}
+
+static ssize_t recompress_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	ssize_t ret = len;
+	int mode;
+
+	if (sysfs_streq(buf, "idle"))
+		mode = ZRAM_RECOMP_IDLE;
+	else if (sysfs_streq(buf, "all"))
+		mode = ZRAM_RECOMP_ALL;
+	else
+		return -EINVAL;
+
+	down_read(&zram->init_lock);
+	if (!init_done(zram) || !zram->recomp) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	zram->recomp_mode = mode;
+	if (!queue_work(system_unbound_wq, &zram->recomp_work))
+		ret = -EBUSY;
+out:
+	up_read(&zram->init_lock);
+	return ret;
+}
+
+static ssize_t comp_stat_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+	struct zram_comp_stats *stats;
+	ssize_t ret = 0;
+	int id;
+
+	down_read(&zram->init_lock);
+	for (id = 0; id < ZRAM_MAX_COMPS; id++) {
+		const char *name = id == ZRAM_PRIMARY_COMP ?
+			zram->compressor : zram->recomp_compressor;
+
+		if (!name[0])
+			continue;
+		stats = &zram->stats.comp[id];
+		ret += scnprintf(buf + ret, PAGE_SIZE - ret,
+			"%-8s %8llu %8llu %8llu %8llu %8llu\n", name,
+			(u64)atomic64_read(&stats->nr_comp),
+			(u64)atomic64_read(&stats->compr_size),
+			(u64)atomic64_read(&stats->comp_ns),
+			(u64)atomic64_read(&stats->nr_decomp),
+			(u64)atomic64_read(&stats->decomp_ns));
+	}
+	ret += scnprintf(buf + ret, PAGE_SIZE - ret, "recomp   %8llu %8llu\n",
+			(u64)atomic64_read(&zram->stats.recomp_pages),
+			(u64)atomic64_read(&zram->stats.recomp_saved));
+	up_read(&zram->init_lock);
+
+	return ret;
+}
+
 /*
  * zram_bio_discard - handler on discard request
  * @index: physical block index in PAGE_SIZE units
@@ -1026,7 +1891,7 @@ out:
 static void zram_reset_device(struct zram *zram)
 {
 	struct zram_meta *meta;
-	struct zcomp *comp;
+	struct zcomp *comp, *recomp;
 	u64 disksize;
 
 	down_write(&zram->init_lock);
@@ -1040,6 +1905,7 @@ static void zram_reset_device(struct zram *zram)
 
 	meta = zram->meta;
 	comp = zram->comp;
+	recomp = zram->recomp;
 	disksize = zram->disksize;
 	/*
 	 * Refcount will go down to 0 eventually and r/w handler
@@ -1062,16 +1928,27 @@ static void zram_reset_device(struct zram *zram)
 	part_stat_set_all(&zram->disk->part0, 0);
 
 	up_write(&zram->init_lock);
+#ifdef CONFIG_ZRAM_WRITEBACK
+	/* A queued writeback sees !init_done and bails out */
+	flush_work(&zram->wb_work);
+#endif
+	flush_work(&zram->recomp_work);
 	/* I/O operation under all of CPU are done so let's free */
 	zram_meta_free(meta, disksize);
 	zcomp_destroy(comp);
+	if (recomp)
+		zcomp_destroy(recomp);
+	zram->recomp = NULL;
+	down_write(&zram->init_lock);
+	reset_bdev(zram);
+	up_write(&zram->init_lock);
 }
 
 static ssize_t disksize_store(struct device *dev,
 		struct device_attribute *attr, const char *buf, size_t len)
 {
 	u64 disksize;
-	struct zcomp *comp;
+	struct zcomp *comp, *recomp = NULL;
 	struct zram_meta *meta;
 	struct zram *zram = dev_to_zram(dev);
 	int err;
@@ -1085,6 +1962,14 @@ static ssize_t disksize_store(struct device *dev,
 	if (!meta)
 		return -ENOMEM;
 
+#ifdef CONFIG_ZRAM_DEDUP
+	if (zram->use_dedup) {
+		err = zram_dedup_init(meta, disksize >> PAGE_SHIFT);
+		if (err)
+			goto out_free_meta;
+	}
+#endif
+
 	comp = zcomp_create(zram->compressor, zram->max_comp_streams);
 	if (IS_ERR(comp)) {
 		pr_err("Cannot initialise %s compressing backend\n",
@@ -1093,6 +1978,18 @@ static ssize_t disksize_store(struct device *dev,
 		goto out_free_meta;
 	}
 
+	if (zram->recomp_compressor[0]) {
+		/* recompression runs from a single worker, one stream is enough */
+		recomp = zcomp_create(zram->recomp_compressor, 1);
+		if (IS_ERR(recomp)) {
+			pr_err("Cannot initialise %s compressing backend\n",
+					zram->recomp_compressor);
+			err = PTR_ERR(recomp);
+			recomp = NULL;
+			goto out_destroy_comp_unlocked;
+		}
+	}
+
 	down_write(&zram->init_lock);
 	if (init_done(zram)) {
 		pr_info("Cannot change disksize for initialized device\n");
@@ -1104,6 +2001,7 @@ static ssize_t disksize_store(struct device *dev,
 	atomic_set(&zram->refcount, 1);
 	zram->meta = meta;
 	zram->comp = comp;
+	zram->recomp = recomp;
 	zram->disksize = disksize;
 	set_capacity(zram->disk, zram->disksize >> SECTOR_SHIFT);
 	up_write(&zram->init_lock);
@@ -1119,6 +2017,9 @@ static ssize_t disksize_store(struct device *dev,
 
 out_destroy_comp:
 	up_write(&zram->init_lock);
+out_destroy_comp_unlocked:
+	if (recomp)
+		zcomp_destroy(recomp);
 	zcomp_destroy(comp);
 out_free_meta:
 	zram_meta_free(meta, disksize);
@@ -1202,6 +2103,20 @@ static DEVICE_ATTR_RW(mem_limit);
 static DEVICE_ATTR_RW(mem_used_max);
 static DEVICE_ATTR_RW(max_comp_streams);
 static DEVICE_ATTR_RW(comp_algorithm);
+static DEVICE_ATTR_RW(recomp_algorithm);
+static DEVICE_ATTR_RW(recomp_threshold);
+static DEVICE_ATTR_WO(recompress);
+static DEVICE_ATTR_RO(comp_stat);
+static DEVICE_ATTR_WO(idle);
+#ifdef CONFIG_ZRAM_WRITEBACK
+static DEVICE_ATTR_RW(backing_dev);
+static DEVICE_ATTR_WO(writeback);
+static DEVICE_ATTR_RO(bd_stat);
+#endif
+#ifdef CONFIG_ZRAM_DEDUP
+static DEVICE_ATTR_RW(use_dedup);
+static DEVICE_ATTR_RO(dedup_stat);
+#endif
 
 static struct attribute *zram_disk_attrs[] = {
 	&dev_attr_disksize.attr,
@@ -1224,6 +2139,20 @@ static struct attribute *zram_disk_attrs[] = {
 	&dev_attr_comp_algorithm.attr,
 	&dev_attr_io_stat.attr,
 	&dev_attr_mm_stat.attr,
+	&dev_attr_recomp_algorithm.attr,
+	&dev_attr_recomp_threshold.attr,
+	&dev_attr_recompress.attr,
+	&dev_attr_comp_stat.attr,
+	&dev_attr_idle.attr,
+#ifdef CONFIG_ZRAM_WRITEBACK
+	&dev_attr_backing_dev.attr,
+	&dev_attr_writeback.attr,
+	&dev_attr_bd_stat.attr,
+#endif
+#ifdef CONFIG_ZRAM_DEDUP
+	&dev_attr_use_dedup.attr,
+	&dev_attr_dedup_stat.attr,
+#endif
 	NULL,
 };
 
@@ -1251,6 +2180,11 @@ static int zram_add(void)
 	device_id = ret;
 
 	init_rwsem(&zram->init_lock);
+#ifdef CONFIG_ZRAM_WRITEBACK
+	INIT_WORK(&zram->wb_work, zram_writeback_work);
+#endif
+	INIT_WORK(&zram->recomp_work, zram_recompress_work);
+	zram->recomp_threshold = PAGE_SIZE / 2;
 
 	queue = blk_alloc_queue(GFP_KERNEL);
 	if (!queue) {
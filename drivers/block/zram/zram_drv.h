@@ -62,18 +62,53 @@ enum zram_pageflags {
 	/* Page consists entirely of zeros */
 	ZRAM_ZERO = ZRAM_FLAG_SHIFT,
 	ZRAM_ACCESS,	/* page is now accessed */
+	ZRAM_WB,	/* page is stored on backing_device */
+	ZRAM_IDLE,	/* not accessed page since last idle marking */
+	ZRAM_HUGE,	/* incompressible page stored uncompressed */
+	ZRAM_RECOMP,	/* compressed with the secondary algorithm */
+	ZRAM_DEDUP,	/* handle is a shared struct zram_dedup_entry */
 
 	__NR_ZRAM_PAGEFLAGS,
 };
 
 /*-- Data structures */
 
+/* Index of the algorithm used for a slot, ZRAM_RECOMP selects the second */
+enum zram_comp_id {
+	ZRAM_PRIMARY_COMP,
+	ZRAM_SECONDARY_COMP,
+	ZRAM_MAX_COMPS,
+};
+
+/* Per-algorithm counters, to weigh memory saved against CPU spent */
+struct zram_comp_stats {
+	atomic64_t nr_comp;		/* no. of pages compressed */
+	atomic64_t compr_size;		/* bytes those pages compressed to */
+	atomic64_t comp_ns;		/* time spent compressing */
+	atomic64_t nr_decomp;		/* no. of pages decompressed */
+	atomic64_t decomp_ns;		/* time spent decompressing */
+};
+
 /* Allocated for each disk page */
 struct zram_table_entry {
 	unsigned long handle;
 	unsigned long value;
 };
 
+/* An object shared by every slot holding the same data */
+struct zram_dedup_entry {
+	struct hlist_node node;
+	unsigned long handle;
+	size_t len;
+	u32 checksum;
+	int refcount;		/* protected by the bucket lock */
+};
+
+struct zram_hash {
+	spinlock_t lock;
+	struct hlist_head head;
+};
+
 struct zram_stats {
 	atomic64_t compr_data_size;	/* compressed size of pages stored */
 	atomic64_t num_reads;	/* failed + successful */
@@ -85,11 +120,27 @@ struct zram_stats {
 	atomic64_t zero_pages;		/* no. of zero filled pages */
 	atomic64_t pages_stored;	/* no. of pages currently stored */
 	atomic_long_t max_used_pages;	/* no. of maximum pages stored */
+	atomic64_t recomp_pages;	/* no. of slots recompressed */
+	atomic64_t recomp_saved;	/* bytes saved by recompression */
+	struct zram_comp_stats comp[ZRAM_MAX_COMPS];
+	atomic64_t dup_data_size;	/* bytes saved by sharing objects */
+	atomic64_t meta_data_size;	/* bytes spent on dedup entries */
+	atomic64_t dedup_hits;		/* no. of writes that found a twin */
+	atomic64_t dedup_ns;		/* time spent hashing and comparing */
+#ifdef CONFIG_ZRAM_WRITEBACK
+	atomic64_t bd_count;		/* no. of pages in backing device */
+	atomic64_t bd_reads;		/* no. of reads from backing device */
+	atomic64_t bd_writes;		/* no. of writes from backing device */
+#endif
 };
 
 struct zram_meta {
 	struct zram_table_entry *table;
 	struct zs_pool *mem_pool;
+#ifdef CONFIG_ZRAM_DEDUP
+	struct zram_hash *hash;
+	size_t hash_size;
+#endif
 };
 
 struct zram {
@@ -114,9 +165,29 @@ struct zram {
 	 */
 	u64 disksize;	/* bytes */
 	char compressor[10];
+	/* optional secondary algorithm for recompressing cold slots */
+	char recomp_compressor[10];
+	struct zcomp *recomp;
+	/* slots compressed to at least this many bytes get recompressed */
+	unsigned int recomp_threshold;
+	struct work_struct recomp_work;
+	int recomp_mode;
+#ifdef CONFIG_ZRAM_DEDUP
+	bool use_dedup;
+#endif
 	/*
 	 * zram is claimed so open request will be failed
 	 */
 	bool claim; /* Protected by bdev->bd_mutex */
+#ifdef CONFIG_ZRAM_WRITEBACK
+	struct file *backing_dev;
+	struct block_device *bdev;
+	unsigned int old_block_size;
+	unsigned long *bitmap;
+	unsigned long nr_pages;
+	/* background writeback of idle/huge slots kicked from sysfs */
+	struct work_struct wb_work;
+	int wb_mode;
+#endif
 };
 #endif
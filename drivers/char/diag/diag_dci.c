@@ -638,60 +638,95 @@ void diag_dci_process_peripheral_data(struct diagfwd_info *p_info, void *buf,
 	return;
 }
 
-int diag_dci_query_log_mask(struct diag_dci_client_tbl *entry,
-			    uint16_t log_code)
+/*
+ * The log masks are laid out as DCI_MAX_LOG_CODES blocks of 514 bytes, one
+ * per equipment id: the equipment id, a dirty byte and a bitmap of the
+ * items. The event masks are a plain bitmap of the event ids.
+ */
+static int dci_log_mask_test(unsigned char *mask, uint16_t log_code)
 {
 	uint16_t item_num;
-	uint8_t equip_id, *log_mask_ptr, byte_mask;
+	uint8_t equip_id, byte_mask;
 	int byte_index, offset;
 
-	if (!entry) {
-		pr_err("diag: In %s, invalid client entry\n", __func__);
-		return 0;
-	}
-
 	equip_id = LOG_GET_EQUIP_ID(log_code);
 	item_num = LOG_GET_ITEM_NUM(log_code);
 	byte_index = item_num/8 + 2;
 	byte_mask = 0x01 << (item_num % 8);
 	offset = equip_id * 514;
 
-	if (offset + byte_index > DCI_LOG_MASK_SIZE) {
+	if (offset + byte_index >= DCI_LOG_MASK_SIZE) {
 		pr_err("diag: In %s, invalid offset: %d, log_code: %d, byte_index: %d\n",
 				__func__, offset, log_code, byte_index);
 		return 0;
 	}
 
-	log_mask_ptr = entry->dci_log_mask;
-	log_mask_ptr = log_mask_ptr + offset + byte_index;
-	return ((*log_mask_ptr & byte_mask) == byte_mask) ? 1 : 0;
-
+	return ((mask[offset + byte_index] & byte_mask) == byte_mask) ? 1 : 0;
 }
 
-int diag_dci_query_event_mask(struct diag_dci_client_tbl *entry,
-			      uint16_t event_id)
+static int dci_event_mask_test(unsigned char *mask, uint16_t event_id)
 {
-	uint8_t *event_mask_ptr, byte_mask;
+	uint8_t byte_mask;
 	int byte_index, bit_index;
 
-	if (!entry) {
-		pr_err("diag: In %s, invalid client entry\n", __func__);
-		return 0;
-	}
-
 	byte_index = event_id/8;
 	bit_index = event_id % 8;
 	byte_mask = 0x1 << bit_index;
 
-	if (byte_index > DCI_EVENT_MASK_SIZE) {
+	if (byte_index >= DCI_EVENT_MASK_SIZE) {
 		pr_err("diag: In %s, invalid, event_id: %d, byte_index: %d\n",
 				__func__, event_id, byte_index);
 		return 0;
 	}
 
-	event_mask_ptr = entry->dci_event_mask;
-	event_mask_ptr = event_mask_ptr + byte_index;
-	return ((*event_mask_ptr & byte_mask) == byte_mask) ? 1 : 0;
+	return ((mask[byte_index] & byte_mask) == byte_mask) ? 1 : 0;
+}
+
+int diag_dci_query_log_mask(struct diag_dci_client_tbl *entry,
+			    uint16_t log_code)
+{
+	if (!entry) {
+		pr_err("diag: In %s, invalid client entry\n", __func__);
+		return 0;
+	}
+
+	return dci_log_mask_test(entry->dci_log_mask, log_code);
+}
+
+int diag_dci_query_event_mask(struct diag_dci_client_tbl *entry,
+			      uint16_t event_id)
+{
+	if (!entry) {
+		pr_err("diag: In %s, invalid client entry\n", __func__);
+		return 0;
+	}
+
+	return dci_event_mask_test(entry->dci_event_mask, event_id);
+}
+
+/*
+ * The composite masks are the union of the masks of all the clients of a
+ * proc. They are checked first so that the packets no client asked for are
+ * dropped without walking the client list. The composite masks are
+ * updated under their own mutex after the client masks, a packet racing
+ * with a mask update may be dropped as if it arrived before the update.
+ */
+static int diag_dci_query_cumulative_log_mask(int token, uint16_t log_code)
+{
+	if (token < 0 || token >= NUM_DCI_PROC)
+		return 0;
+
+	return dci_log_mask_test(dci_ops_tbl[token].log_mask_composite,
+				 log_code);
+}
+
+static int diag_dci_query_cumulative_event_mask(int token, uint16_t event_id)
+{
+	if (token < 0 || token >= NUM_DCI_PROC)
+		return 0;
+
+	return dci_event_mask_test(dci_ops_tbl[token].event_mask_composite,
+				   event_id);
 }
 
 static int diag_dci_filter_commands(struct diag_pkt_header_t *header)
@@ -1229,6 +1264,8 @@ void extract_dci_events(unsigned char *buf, int len, int data_source, int token)
 		/* 2 bytes for the event length field which is added to
 		   the event data */
 		total_event_len = 2 + 10 + payload_len_field + payload_len;
+		if (!diag_dci_query_cumulative_event_mask(token, event_id))
+			continue;
 		/* parse through event mask tbl of each client and check mask */
 		mutex_lock(&driver->dci_mutex);
 		list_for_each_safe(start, temp, &driver->dci_client_list) {
@@ -1333,6 +1370,9 @@ void extract_dci_log(unsigned char *buf, int len, int data_source, int token)
 	log_code = *(uint16_t *)(buf + 6);
 	read_bytes += sizeof(uint16_t) + 6;
 
+	if (!diag_dci_query_cumulative_log_mask(token, log_code))
+		return;
+
 	/* parse through log mask table of each client and check mask */
 	mutex_lock(&driver->dci_mutex);
 	list_for_each_safe(start, temp, &driver->dci_client_list) {
@@ -441,6 +441,8 @@ static ssize_t diag_dbgfs_read_usbinfo(struct file *file, char __user *ubuf,
 			"read pending: %d\n"
 			"read count: %lu\n"
 			"write count: %lu\n"
+			"aggregated packets: %lu\n"
+			"aggregated writes: %lu\n"
 			"read work pending: %d\n"
 			"read done work pending: %d\n"
 			"connect work pending: %d\n"
@@ -456,6 +458,8 @@ static ssize_t diag_dbgfs_read_usbinfo(struct file *file, char __user *ubuf,
 			atomic_read(&usb_info->read_pending),
 			usb_info->read_cnt,
 			usb_info->write_cnt,
+			usb_info->aggr_pkt_cnt,
+			usb_info->aggr_write_cnt,
 			work_pending(&usb_info->read_work),
 			work_pending(&usb_info->read_done_work),
 			work_pending(&usb_info->connect_work),
@@ -67,6 +67,25 @@ struct diag_md_info diag_md[NUM_DIAG_MD_DEV] = {
 #endif
 };
 
+static void diag_md_buf_done(struct diag_md_info *ch,
+			     struct diag_buf_tbl_t *entry)
+{
+	if (GET_BUF_NUM(entry->ctx) == DIAG_MUX_AGGR_BUF_NUM)
+		diagmem_free(driver, entry->buf, POOL_TYPE_MUX_AGGR);
+	else if (ch->ops && ch->ops->write_done)
+		ch->ops->write_done(entry->buf, entry->len, entry->ctx,
+				    DIAG_MEMORY_DEVICE_MODE);
+}
+
+static void diag_md_aggr_drop(struct diag_md_info *ch, uint8_t peripheral)
+{
+	struct diag_md_aggr_t *aggr = &ch->aggr[peripheral];
+
+	diagmem_free(driver, aggr->buf, POOL_TYPE_MUX_AGGR);
+	aggr->buf = NULL;
+	aggr->len = 0;
+}
+
 int diag_md_register(int id, int ctx, struct diag_mux_ops *ops)
 {
 	if (id < 0 || id >= NUM_DIAG_MD_DEV || !ops)
@@ -104,6 +123,11 @@ void diag_md_close_all()
 		if (ch->ops && ch->ops->close)
 			ch->ops->close(ch->ctx, DIAG_MEMORY_DEVICE_MODE);
 
+		spin_lock_irqsave(&ch->aggr_lock, flags);
+		for (j = 0; j < NUM_PERIPHERALS; j++)
+			diag_md_aggr_drop(ch, j);
+		spin_unlock_irqrestore(&ch->aggr_lock, flags);
+
 		/*
 		 * When we close the Memory device mode, make sure we flush the
 		 * internal buffers in the table so that there are no stale
@@ -114,10 +138,7 @@ void diag_md_close_all()
 			entry = &ch->tbl[j];
 			if (entry->len <= 0)
 				continue;
-			if (ch->ops && ch->ops->write_done)
-				ch->ops->write_done(entry->buf, entry->len,
-						    entry->ctx,
-						    DIAG_MEMORY_DEVICE_MODE);
+			diag_md_buf_done(ch, entry);
 			entry->buf = NULL;
 			entry->len = 0;
 			entry->ctx = 0;
@@ -128,30 +149,16 @@ void diag_md_close_all()
 	diag_ws_reset(DIAG_WS_MUX);
 }
 
-int diag_md_write(int id, unsigned char *buf, int len, int ctx)
+/*
+ * Adds a buffer to the table of buffers waiting for the logging process.
+ * Called with aggr_lock held for batched buffers.
+ */
+static int diag_md_tbl_add(struct diag_md_info *ch, unsigned char *buf,
+			   int len, int ctx)
 {
 	int i;
 	uint8_t found = 0;
 	unsigned long flags;
-	struct diag_md_info *ch = NULL;
-	uint8_t peripheral;
-	struct diag_md_session_t *session_info = NULL;
-
-	if (id < 0 || id >= NUM_DIAG_MD_DEV || id >= DIAG_NUM_PROC)
-		return -EINVAL;
-
-	if (!buf || len < 0)
-		return -EINVAL;
-
-	peripheral = GET_BUF_PERIPHERAL(ctx);
-	if (peripheral > NUM_PERIPHERALS)
-		return -EINVAL;
-
-	session_info = diag_md_session_get_peripheral(peripheral);
-	if (!session_info)
-		return -EIO;
-
-	ch = &diag_md[id];
 
 	spin_lock_irqsave(&ch->lock, flags);
 	for (i = 0; i < ch->num_tbl_entries && !found; i++) {
@@ -160,7 +167,7 @@ int diag_md_write(int id, unsigned char *buf, int len, int ctx)
 		found = 1;
 		pr_err_ratelimited("diag: trying to write the same buffer buf: %pK, ctxt: %d len: %d at i: %d back to the table, proc: %d, mode: %d\n",
 				   buf, ctx, ch->tbl[i].len,
-				   i, id, driver->logging_mode);
+				   i, ch->id, driver->logging_mode);
 	}
 	spin_unlock_irqrestore(&ch->lock, flags);
 
@@ -181,11 +188,18 @@ int diag_md_write(int id, unsigned char *buf, int len, int ctx)
 
 	if (!found) {
 		pr_err_ratelimited("diag: Unable to find an empty space in table, please reduce logging rate, proc: %d\n",
-				   id);
+				   ch->id);
 		return -ENOMEM;
 	}
 
-	found = 0;
+	return 0;
+}
+
+static int diag_md_wake_client(struct diag_md_session_t *session_info)
+{
+	int i;
+	uint8_t found = 0;
+
 	for (i = 0; i < driver->num_clients && !found; i++) {
 		if ((driver->client_map[i].pid !=
 		     session_info->pid) ||
@@ -204,6 +218,141 @@ int diag_md_write(int id, unsigned char *buf, int len, int ctx)
 	return 0;
 }
 
+/*
+ * Moves the batch pending for a peripheral to the table and wakes up the
+ * logging process. The batch is dropped if it can't be queued. Called
+ * with aggr_lock held.
+ */
+static int diag_md_aggr_flush(struct diag_md_info *ch, uint8_t peripheral)
+{
+	int err = 0;
+	struct diag_md_aggr_t *aggr = &ch->aggr[peripheral];
+	struct diag_md_session_t *session_info = NULL;
+	unsigned char *buf = aggr->buf;
+	int len = aggr->len;
+
+	if (!buf)
+		return 0;
+
+	aggr->buf = NULL;
+	aggr->len = 0;
+
+	session_info = diag_md_session_get_peripheral(peripheral);
+	if (!session_info) {
+		err = -EIO;
+		goto fail;
+	}
+
+	err = diag_md_tbl_add(ch, buf, len,
+			      SET_BUF_CTXT(peripheral, TYPE_DATA,
+					   DIAG_MUX_AGGR_BUF_NUM));
+	if (err)
+		goto fail;
+
+	return diag_md_wake_client(session_info);
+
+fail:
+	diagmem_free(driver, buf, POOL_TYPE_MUX_AGGR);
+	return err;
+}
+
+static void diag_md_aggr_timer_fn(unsigned long data)
+{
+	int i;
+	unsigned long flags;
+	struct diag_md_info *ch = (struct diag_md_info *)data;
+
+	spin_lock_irqsave(&ch->aggr_lock, flags);
+	for (i = 0; i < NUM_PERIPHERALS; i++)
+		diag_md_aggr_flush(ch, i);
+	spin_unlock_irqrestore(&ch->aggr_lock, flags);
+}
+
+/*
+ * Copies a small packet into the batch of its peripheral and releases the
+ * source buffer right away. Batches are kept per peripheral as each
+ * peripheral may belong to a different logging session. Returns -EAGAIN
+ * if no aggregation buffer is available; the packet should then be
+ * queued as is.
+ */
+static int diag_md_write_aggr(struct diag_md_info *ch, unsigned char *buf,
+			      int len, int ctx)
+{
+	unsigned long flags;
+	uint8_t peripheral = GET_BUF_PERIPHERAL(ctx);
+	struct diag_md_aggr_t *aggr = &ch->aggr[peripheral];
+
+	spin_lock_irqsave(&ch->aggr_lock, flags);
+	if (aggr->buf && aggr->len + len > DIAG_MUX_AGGR_BUF_SIZE)
+		diag_md_aggr_flush(ch, peripheral);
+
+	if (!aggr->buf) {
+		aggr->buf = diagmem_alloc(driver, DIAG_MUX_AGGR_BUF_SIZE,
+					  POOL_TYPE_MUX_AGGR);
+		if (!aggr->buf) {
+			spin_unlock_irqrestore(&ch->aggr_lock, flags);
+			return -EAGAIN;
+		}
+		aggr->len = 0;
+		if (!timer_pending(&ch->aggr_timer))
+			mod_timer(&ch->aggr_timer,
+				  jiffies + diag_mux_aggr_timeout());
+	}
+
+	memcpy(aggr->buf + aggr->len, buf, len);
+	aggr->len += len;
+	spin_unlock_irqrestore(&ch->aggr_lock, flags);
+
+	if (ch->ops && ch->ops->write_done)
+		ch->ops->write_done(buf, len, ctx, DIAG_MEMORY_DEVICE_MODE);
+
+	return 0;
+}
+
+int diag_md_write(int id, unsigned char *buf, int len, int ctx)
+{
+	int err = 0;
+	unsigned long flags;
+	struct diag_md_info *ch = NULL;
+	uint8_t peripheral;
+	struct diag_md_session_t *session_info = NULL;
+
+	if (id < 0 || id >= NUM_DIAG_MD_DEV || id >= DIAG_NUM_PROC)
+		return -EINVAL;
+
+	if (!buf || len < 0)
+		return -EINVAL;
+
+	peripheral = GET_BUF_PERIPHERAL(ctx);
+	if (peripheral > NUM_PERIPHERALS)
+		return -EINVAL;
+
+	session_info = diag_md_session_get_peripheral(peripheral);
+	if (!session_info)
+		return -EIO;
+
+	ch = &diag_md[id];
+
+	if (id == DIAG_MD_LOCAL && diag_mux_aggr_eligible(len, ctx)) {
+		err = diag_md_write_aggr(ch, buf, len, ctx);
+		if (err != -EAGAIN)
+			return err;
+	}
+
+	if (id == DIAG_MD_LOCAL && peripheral < NUM_PERIPHERALS) {
+		/* Keep the order of the packets batched so far */
+		spin_lock_irqsave(&ch->aggr_lock, flags);
+		diag_md_aggr_flush(ch, peripheral);
+		spin_unlock_irqrestore(&ch->aggr_lock, flags);
+	}
+
+	err = diag_md_tbl_add(ch, buf, len, ctx);
+	if (err)
+		return err;
+
+	return diag_md_wake_client(session_info);
+}
+
 int diag_md_copy_to_user(char __user *buf, int *pret, size_t buf_size,
 			struct diag_md_session_t *info)
 {
@@ -285,10 +434,7 @@ int diag_md_copy_to_user(char __user *buf, int *pret, size_t buf_size,
 			num_data++;
 drop_data:
 			spin_lock_irqsave(&ch->lock, flags);
-			if (ch->ops && ch->ops->write_done)
-				ch->ops->write_done(entry->buf, entry->len,
-						    entry->ctx,
-						    DIAG_MEMORY_DEVICE_MODE);
+			diag_md_buf_done(ch, entry);
 			diag_ws_on_copy(DIAG_WS_MUX);
 			entry->buf = NULL;
 			entry->len = 0;
@@ -319,20 +465,22 @@ int diag_md_close_peripheral(int id, uint8_t peripheral)
 
 	ch = &diag_md[id];
 
+	if (peripheral < NUM_PERIPHERALS) {
+		spin_lock_irqsave(&ch->aggr_lock, flags);
+		diag_md_aggr_drop(ch, peripheral);
+		spin_unlock_irqrestore(&ch->aggr_lock, flags);
+	}
+
 	spin_lock_irqsave(&ch->lock, flags);
 	for (i = 0; i < ch->num_tbl_entries && !found; i++) {
 		entry = &ch->tbl[i];
 		if (GET_BUF_PERIPHERAL(entry->ctx) != peripheral)
 			continue;
 		found = 1;
-		if (ch->ops && ch->ops->write_done) {
-			ch->ops->write_done(entry->buf, entry->len,
-					    entry->ctx,
-					    DIAG_MEMORY_DEVICE_MODE);
-			entry->buf = NULL;
-			entry->len = 0;
-			entry->ctx = 0;
-		}
+		diag_md_buf_done(ch, entry);
+		entry->buf = NULL;
+		entry->len = 0;
+		entry->ctx = 0;
 	}
 	spin_unlock_irqrestore(&ch->lock, flags);
 	return 0;
@@ -345,6 +493,9 @@ int diag_md_init()
 
 	for (i = 0; i < NUM_DIAG_MD_DEV; i++) {
 		ch = &diag_md[i];
+		spin_lock_init(&ch->aggr_lock);
+		setup_timer(&ch->aggr_timer, diag_md_aggr_timer_fn,
+			    (unsigned long)ch);
 		ch->num_tbl_entries = diag_mempools[ch->mempool].poolsize;
 		ch->tbl = kzalloc(ch->num_tbl_entries *
 				  sizeof(struct diag_buf_tbl_t),
@@ -369,12 +520,18 @@ fail:
 
 void diag_md_exit()
 {
-	int i;
+	int i, j;
 	struct diag_md_info *ch = NULL;
 
 	for (i = 0; i < NUM_DIAG_MD_DEV; i++) {
 		ch = &diag_md[i];
+		if (ch->tbl) {
+			del_timer_sync(&ch->aggr_timer);
+			for (j = 0; j < NUM_PERIPHERALS; j++)
+				diag_md_aggr_drop(ch, j);
+		}
 		kfree(ch->tbl);
+		ch->tbl = NULL;
 		ch->num_tbl_entries = 0;
 		ch->ops = NULL;
 	}
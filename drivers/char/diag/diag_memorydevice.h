@@ -13,6 +13,9 @@
 #ifndef DIAG_MEMORYDEVICE_H
 #define DIAG_MEMORYDEVICE_H
 
+#include <linux/timer.h>
+#include "diagchar.h"
+
 #define DIAG_MD_LOCAL		0
 #define DIAG_MD_LOCAL_LAST	1
 #define DIAG_MD_BRIDGE_BASE	DIAG_MD_LOCAL_LAST
@@ -33,6 +36,11 @@ struct diag_buf_tbl_t {
 	int ctx;
 };
 
+struct diag_md_aggr_t {
+	unsigned char *buf;
+	int len;
+};
+
 struct diag_md_info {
 	int id;
 	int ctx;
@@ -41,6 +49,9 @@ struct diag_md_info {
 	spinlock_t lock;
 	struct diag_buf_tbl_t *tbl;
 	struct diag_mux_ops *ops;
+	spinlock_t aggr_lock;
+	struct diag_md_aggr_t aggr[NUM_PERIPHERALS];
+	struct timer_list aggr_timer;
 };
 
 extern struct diag_md_info diag_md[NUM_DIAG_MD_DEV];
@@ -12,6 +12,7 @@
 
 #include <linux/slab.h>
 #include <linux/init.h>
+#include <linux/module.h>
 #include <linux/uaccess.h>
 #include <linux/diagchar.h>
 #include <linux/sched.h>
@@ -27,9 +28,20 @@
 #include "diag_mux.h"
 #include "diag_usb.h"
 #include "diag_memorydevice.h"
+#include "diagmem.h"
 
 
 struct diag_mux_state_t *diag_mux;
+
+/*
+ * Data packets up to this size are batched into aggregation buffers,
+ * 0 disables aggregation. A partially filled batch is flushed after
+ * mux_aggr_timeout_ms.
+ */
+static unsigned int mux_aggr_pkt_size = 2048;
+module_param(mux_aggr_pkt_size, uint, S_IRUGO | S_IWUSR);
+static unsigned int mux_aggr_timeout_ms = 5;
+module_param(mux_aggr_timeout_ms, uint, S_IRUGO | S_IWUSR);
 static struct diag_logger_t usb_logger;
 static struct diag_logger_t md_logger;
 
@@ -62,6 +74,7 @@ int diag_mux_init()
 
 	md_logger.mode = DIAG_MEMORY_DEVICE_MODE;
 	md_logger.log_ops = &md_log_ops;
+	diagmem_init(driver, POOL_TYPE_MUX_AGGR);
 	diag_md_init();
 
 	/*
@@ -78,9 +91,33 @@ int diag_mux_init()
 
 void diag_mux_exit()
 {
+	diagmem_exit(driver, POOL_TYPE_MUX_AGGR);
 	kfree(diag_mux);
 }
 
+/*
+ * Only data channel packets are batched. Their buffers are released as
+ * soon as they are copied, which other buffer types don't expect.
+ */
+int diag_mux_aggr_eligible(int len, int ctx)
+{
+	unsigned int pkt_size = ACCESS_ONCE(mux_aggr_pkt_size);
+
+	if (len <= 0 || len > pkt_size || len > DIAG_MUX_AGGR_BUF_SIZE)
+		return 0;
+
+	if (GET_BUF_PERIPHERAL(ctx) >= NUM_PERIPHERALS ||
+	    GET_BUF_TYPE(ctx) != TYPE_DATA)
+		return 0;
+
+	return 1;
+}
+
+unsigned long diag_mux_aggr_timeout(void)
+{
+	return msecs_to_jiffies(ACCESS_ONCE(mux_aggr_timeout_ms));
+}
+
 int diag_mux_register(int proc, int ctx, struct diag_mux_ops *ops)
 {
 	int err = 0;
@@ -34,6 +34,14 @@ struct diag_mux_ops {
 #define DIAG_NO_LOGGING_MODE		2
 #define DIAG_MULTI_MODE			3
 
+/*
+ * Small data packets from the peripherals are copied into buffers from
+ * POOL_TYPE_MUX_AGGR and forwarded in batches. A batch is identified by
+ * DIAG_MUX_AGGR_BUF_NUM in the buffer number of its context.
+ */
+#define DIAG_MUX_AGGR_BUF_SIZE		16384
+#define DIAG_MUX_AGGR_BUF_NUM		0xFF
+
 #define DIAG_MUX_LOCAL		0
 #define DIAG_MUX_LOCAL_LAST	1
 #define DIAG_MUX_BRIDGE_BASE	DIAG_MUX_LOCAL_LAST
@@ -73,4 +81,6 @@ int diag_mux_close_peripheral(int proc, uint8_t peripheral);
 int diag_mux_open_all(struct diag_logger_t *logger);
 int diag_mux_close_all(void);
 int diag_mux_switch_logging(int *new_mode, int *peripheral_mask);
+int diag_mux_aggr_eligible(int len, int ctx);
+unsigned long diag_mux_aggr_timeout(void);
 #endif
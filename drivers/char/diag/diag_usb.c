@@ -29,10 +29,13 @@
 #include "diag_usb.h"
 #include "diag_mux.h"
 #include "diagmem.h"
+#include "diagfwd.h"
 #include "diag_ipc_logging.h"
 
 #define DIAG_USB_STRING_SZ	10
 #define DIAG_USB_MAX_SIZE	16384
+#define DIAG_USB_AGGR_CTXT	\
+	SET_BUF_CTXT(APPS_DATA, TYPE_DATA, DIAG_MUX_AGGR_BUF_NUM)
 
 struct diag_usb_info diag_usb[NUM_DIAG_USB_DEV] = {
 	{
@@ -48,6 +51,7 @@ struct diag_usb_info diag_usb[NUM_DIAG_USB_DEV] = {
 		.read_cnt = 0,
 		.write_cnt = 0,
 		.max_size = DIAG_USB_MAX_SIZE,
+		.aggr = 1,
 	},
 #ifdef CONFIG_DIAGFWD_BRIDGE_CODE
 	{
@@ -63,6 +67,7 @@ struct diag_usb_info diag_usb[NUM_DIAG_USB_DEV] = {
 		.read_cnt = 0,
 		.write_cnt = 0,
 		.max_size = DIAG_USB_MAX_SIZE,
+		.aggr = 0,
 	},
 	{
 		.id = DIAG_USB_MDM2,
@@ -77,6 +82,7 @@ struct diag_usb_info diag_usb[NUM_DIAG_USB_DEV] = {
 		.read_cnt = 0,
 		.write_cnt = 0,
 		.max_size = DIAG_USB_MAX_SIZE,
+		.aggr = 0,
 	},
 	{
 		.id = DIAG_USB_QSC,
@@ -91,6 +97,7 @@ struct diag_usb_info diag_usb[NUM_DIAG_USB_DEV] = {
 		.read_cnt = 0,
 		.write_cnt = 0,
 		.max_size = DIAG_USB_MAX_SIZE,
+		.aggr = 0,
 	}
 #endif
 };
@@ -214,11 +221,20 @@ static void usb_connect_work_fn(struct work_struct *work)
  * and synchronously when Diag wants to disconnect from USB
  * explicitly.
  */
+static int diag_usb_aggr_flush(struct diag_usb_info *usb_info);
+
 static void usb_disconnect(struct diag_usb_info *ch)
 {
+	unsigned long flags;
+
 	if (!ch)
 		return;
 
+	/* The channel is no longer usable, this drops any pending batch */
+	spin_lock_irqsave(&ch->write_lock, flags);
+	diag_usb_aggr_flush(ch);
+	spin_unlock_irqrestore(&ch->write_lock, flags);
+
 	if (!atomic_read(&ch->connected) &&
 		driver->usb_connected && diag_mask_param())
 		diag_clear_masks(NULL);
@@ -334,7 +350,9 @@ static void diag_usb_write_done(struct diag_usb_info *ch,
 	kfree(entry);
 	diag_ws_on_copy_complete(DIAG_WS_MUX);
 
-	if (ch->ops && ch->ops->write_done)
+	if (ctxt == DIAG_USB_AGGR_CTXT)
+		diagmem_free(driver, buf, POOL_TYPE_MUX_AGGR);
+	else if (ch->ops && ch->ops->write_done)
 		ch->ops->write_done(buf, len, ctxt, DIAG_USB_MODE);
 	buf = NULL;
 	len = 0;
@@ -401,6 +419,126 @@ int diag_usb_queue_read(int id)
 	return 0;
 }
 
+/*
+ * Hands the pending aggregation buffer over to USB. The buffer is dropped
+ * if it can't be written, its packets were already released to their
+ * owners. Called with write_lock held.
+ */
+static int diag_usb_aggr_flush(struct diag_usb_info *usb_info)
+{
+	int err = 0;
+	int len = usb_info->aggr_len;
+	unsigned char *buf = usb_info->aggr_buf;
+	struct diag_request *req = NULL;
+
+	if (!buf)
+		return 0;
+
+	usb_info->aggr_buf = NULL;
+	usb_info->aggr_len = 0;
+
+	if (!usb_info->hdl || !atomic_read(&usb_info->connected) ||
+	    !atomic_read(&usb_info->diag_state)) {
+		err = -ENODEV;
+		goto fail;
+	}
+
+	req = diagmem_alloc(driver, sizeof(struct diag_request),
+			    usb_info->mempool);
+	if (!req) {
+		pr_err_ratelimited("diag: In %s, cannot retrieve USB write ptrs for USB channel %s\n",
+				   __func__, usb_info->name);
+		err = -ENOMEM;
+		goto fail;
+	}
+
+	req->buf = buf;
+	req->length = len;
+	req->context = (void *)buf;
+
+	err = diag_usb_buf_tbl_add(usb_info, buf, len, DIAG_USB_AGGR_CTXT);
+	if (err)
+		goto fail_req;
+
+	usb_info->aggr_write_cnt++;
+	err = usb_diag_write(usb_info->hdl, req);
+	if (err) {
+		pr_err_ratelimited("diag: In %s, error writing to usb channel %s, err: %d\n",
+				   __func__, usb_info->name, err);
+		diag_usb_buf_tbl_remove(usb_info, buf);
+		goto fail_req;
+	}
+
+	return 0;
+
+fail_req:
+	diagmem_free(driver, req, usb_info->mempool);
+fail:
+	diag_ws_on_copy_complete(DIAG_WS_MUX);
+	diagmem_free(driver, buf, POOL_TYPE_MUX_AGGR);
+	return err;
+}
+
+static void diag_usb_aggr_timer_fn(unsigned long data)
+{
+	unsigned long flags;
+	struct diag_usb_info *usb_info = (struct diag_usb_info *)data;
+
+	spin_lock_irqsave(&usb_info->write_lock, flags);
+	diag_usb_aggr_flush(usb_info);
+	spin_unlock_irqrestore(&usb_info->write_lock, flags);
+}
+
+/*
+ * Copies a small packet into the aggregation buffer and releases the
+ * source buffer right away. The batch is written to USB once the next
+ * packet doesn't fit or the aggregation timer expires. Returns -EAGAIN
+ * if no aggregation buffer is available; the packet should then be
+ * written as is.
+ */
+static int diag_usb_write_aggr(struct diag_usb_info *usb_info,
+			       unsigned char *buf, int len, int ctxt)
+{
+	unsigned long flags;
+	int size = min_t(int, usb_info->max_size, DIAG_MUX_AGGR_BUF_SIZE);
+
+	if (!usb_info->hdl || !atomic_read(&usb_info->connected) ||
+	    !atomic_read(&usb_info->diag_state)) {
+		pr_debug_ratelimited("diag: USB ch %s is not connected\n",
+				     usb_info->name);
+		return -ENODEV;
+	}
+
+	spin_lock_irqsave(&usb_info->write_lock, flags);
+	if (usb_info->aggr_buf && usb_info->aggr_len + len > size)
+		diag_usb_aggr_flush(usb_info);
+
+	if (!usb_info->aggr_buf) {
+		usb_info->aggr_buf = diagmem_alloc(driver,
+						   DIAG_MUX_AGGR_BUF_SIZE,
+						   POOL_TYPE_MUX_AGGR);
+		if (!usb_info->aggr_buf) {
+			spin_unlock_irqrestore(&usb_info->write_lock, flags);
+			return -EAGAIN;
+		}
+		usb_info->aggr_len = 0;
+		mod_timer(&usb_info->aggr_timer,
+			  jiffies + diag_mux_aggr_timeout());
+	}
+
+	memcpy(usb_info->aggr_buf + usb_info->aggr_len, buf, len);
+	usb_info->aggr_len += len;
+	usb_info->aggr_pkt_cnt++;
+	diag_ws_on_read(DIAG_WS_MUX, len);
+	diag_ws_on_copy(DIAG_WS_MUX);
+	spin_unlock_irqrestore(&usb_info->write_lock, flags);
+
+	if (usb_info->ops && usb_info->ops->write_done)
+		usb_info->ops->write_done(buf, len, ctxt, DIAG_USB_MODE);
+
+	return 0;
+}
+
 static int diag_usb_write_ext(struct diag_usb_info *usb_info,
 			      unsigned char *buf, int len, int ctxt)
 {
@@ -418,6 +556,8 @@ static int diag_usb_write_ext(struct diag_usb_info *usb_info,
 	}
 
 	spin_lock_irqsave(&usb_info->write_lock, flags);
+	/* Keep the order of the packets batched so far */
+	diag_usb_aggr_flush(usb_info);
 	while (bytes_remaining > 0) {
 		req = diagmem_alloc(driver, sizeof(struct diag_request),
 				    usb_info->mempool);
@@ -504,6 +644,14 @@ int diag_usb_write(int id, unsigned char *buf, int len, int ctxt)
 		return diag_usb_write_ext(usb_info, buf, len, ctxt);
 	}
 
+	if (usb_info->aggr && len <= usb_info->max_size &&
+	    diag_mux_aggr_eligible(len, ctxt)) {
+		err = diag_usb_write_aggr(usb_info, buf, len, ctxt);
+		if (err != -EAGAIN)
+			return err;
+		err = 0;
+	}
+
 	req = diagmem_alloc(driver, sizeof(struct diag_request),
 			    usb_info->mempool);
 	if (!req) {
@@ -531,6 +679,8 @@ int diag_usb_write(int id, unsigned char *buf, int len, int ctxt)
 	}
 
 	spin_lock_irqsave(&usb_info->write_lock, flags);
+	/* Keep the order of the packets batched so far */
+	diag_usb_aggr_flush(usb_info);
 	if (diag_usb_buf_tbl_add(usb_info, buf, len, ctxt)) {
 		DIAG_LOG(DIAG_DEBUG_MUX,
 					"ERR! unable to add buf %pK to table\n",
@@ -615,6 +765,8 @@ int diag_usb_register(int id, int ctxt, struct diag_mux_ops *ops)
 	ch->ctxt = ctxt;
 	spin_lock_init(&ch->lock);
 	spin_lock_init(&ch->write_lock);
+	setup_timer(&ch->aggr_timer, diag_usb_aggr_timer_fn,
+		    (unsigned long)ch);
 	ch->read_buf = kzalloc(USB_MAX_OUT_BUF, GFP_KERNEL);
 	if (!ch->read_buf)
 		goto err;
@@ -660,6 +812,7 @@ err:
 
 void diag_usb_exit(int id)
 {
+	unsigned long flags;
 	struct diag_usb_info *ch = NULL;
 
 	if (id < 0 || id >= NUM_DIAG_USB_DEV) {
@@ -676,6 +829,12 @@ void diag_usb_exit(int id)
 	ch->ctxt = 0;
 	ch->read_cnt = 0;
 	ch->write_cnt = 0;
+	del_timer_sync(&ch->aggr_timer);
+	spin_lock_irqsave(&ch->write_lock, flags);
+	diag_usb_aggr_flush(ch);
+	spin_unlock_irqrestore(&ch->write_lock, flags);
+	ch->aggr_pkt_cnt = 0;
+	ch->aggr_write_cnt = 0;
 	diagmem_exit(driver, ch->mempool);
 	ch->mempool = 0;
 	if (ch->hdl) {
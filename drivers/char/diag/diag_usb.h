@@ -13,6 +13,7 @@
 #ifndef DIAGUSB_H
 #define DIAGUSB_H
 
+#include <linux/timer.h>
 #ifdef CONFIG_DIAG_OVER_USB
 #include <linux/usb/usbdiag.h>
 #endif
@@ -56,9 +57,15 @@ struct diag_usb_info {
 	int enabled;
 	int mempool;
 	int max_size;
+	int aggr;
+	unsigned char *aggr_buf;
+	int aggr_len;
+	struct timer_list aggr_timer;
 	struct list_head buf_tbl;
 	unsigned long read_cnt;
 	unsigned long write_cnt;
+	unsigned long aggr_pkt_cnt;
+	unsigned long aggr_write_cnt;
 	spinlock_t lock;
 	spinlock_t write_lock;
 	struct usb_diag_ch *hdl;
@@ -91,6 +91,15 @@ static unsigned int itemsize_usb_apps = sizeof(struct diag_request);
 static unsigned int poolsize_usb_apps = 10;
 module_param(poolsize_usb_apps, uint, 0);
 
+/*
+ * Buffers used by the MUX layer to batch small peripheral data packets
+ * before handing them to USB or the memory device. Don't expose itemsize
+ * as it is constant.
+ */
+static unsigned int itemsize_mux_aggr = DIAG_MUX_AGGR_BUF_SIZE;
+static unsigned int poolsize_mux_aggr = 8;
+module_param(poolsize_mux_aggr, uint, 0);
+
 /* Used for DCI client buffers. Don't expose itemsize as it is constant. */
 static unsigned int poolsize_dci = 10;
 module_param(poolsize_dci, uint, 0);
@@ -3505,6 +3514,8 @@ static int __init diagchar_init(void)
 	 */
 	diagmem_setsize(POOL_TYPE_MUX_APPS, itemsize_usb_apps,
 			poolsize_usb_apps + 1 + (NUM_PERIPHERALS * 6));
+	diagmem_setsize(POOL_TYPE_MUX_AGGR, itemsize_mux_aggr,
+			poolsize_mux_aggr);
 	driver->num_clients = max_clients;
 	driver->logging_mode = DIAG_USB_MODE;
 	driver->mask_check = 0;
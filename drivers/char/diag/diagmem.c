@@ -67,6 +67,14 @@ struct diag_mempool_t diag_mempools[NUM_MEMORY_POOLS] = {
 		.poolsize = 0,
 		.count = 0
 	},
+	{
+		.id = POOL_TYPE_MUX_AGGR,
+		.name = "POOL_MUX_AGGR",
+		.pool = NULL,
+		.itemsize = 0,
+		.poolsize = 0,
+		.count = 0
+	},
 #ifdef CONFIG_DIAGFWD_BRIDGE_CODE
 	{
 		.id = POOL_TYPE_MDM,
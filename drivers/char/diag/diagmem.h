@@ -19,7 +19,8 @@
 #define POOL_TYPE_USER			2
 #define POOL_TYPE_MUX_APPS		3
 #define POOL_TYPE_DCI			4
-#define POOL_TYPE_LOCAL_LAST		5
+#define POOL_TYPE_MUX_AGGR		5
+#define POOL_TYPE_LOCAL_LAST		6
 
 #define POOL_TYPE_REMOTE_BASE		POOL_TYPE_LOCAL_LAST
 #define POOL_TYPE_MDM			POOL_TYPE_REMOTE_BASE
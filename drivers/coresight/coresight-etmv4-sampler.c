@@ -0,0 +1,664 @@
+/* Copyright (c) 2016, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/types.h>
+#include <linux/err.h>
+#include <linux/cpumask.h>
+#include <linux/debugfs.h>
+#include <linux/delay.h>
+#include <linux/fs.h>
+#include <linux/hash.h>
+#include <linux/kallsyms.h>
+#include <linux/mutex.h>
+#include <linux/seq_file.h>
+#include <linux/sizes.h>
+#include <linux/slab.h>
+#include <linux/sort.h>
+#include <linux/uaccess.h>
+#include <linux/vmalloc.h>
+#include <linux/workqueue.h>
+#include <linux/coresight.h>
+
+#include "coresight-priv.h"
+
+#define SAMPLER_BUF_SIZE	SZ_1M
+#define SAMPLER_HIST_BITS	10
+#define SAMPLER_HIST_SIZE	(1 << SAMPLER_HIST_BITS)
+#define SAMPLER_HIST_PROBES	32
+#define SAMPLER_MIN_BURST_US	10
+#define SAMPLER_MAX_BURST_US	100000
+#define SAMPLER_MIN_PERIOD_MS	10
+
+#define FRAME_SIZE		16
+#define ASYNC_ZEROS		11
+
+struct etm_sampler_ent {
+	unsigned long		fn;
+	unsigned int		count;
+};
+
+/*
+ * Every so often the ETMs of the selected CPUs are lent out by the ETMv4
+ * driver and turned on together for a short burst. What they left in the
+ * ETR is then split by trace ID and decoded just far enough to find the
+ * address packets, i.e. the branch targets, which are counted against the
+ * kernel function they fall in.
+ */
+struct etm_sampler {
+	struct mutex		lock;
+	struct delayed_work	work;
+	bool			enable;
+	cpumask_t		cpus;
+	unsigned int		burst_us;
+	unsigned int		period_ms;
+	struct coresight_device	*csdev[NR_CPUS];
+	uint8_t			trcid[NR_CPUS];
+	u8			*trace;
+	u8			*stream;
+	struct etm_sampler_ent	hist[SAMPLER_HIST_SIZE];
+	unsigned long		nr_bursts;
+	unsigned long		nr_samples;
+	unsigned long		nr_user;
+	unsigned long		nr_unknown;
+	unsigned long		nr_dropped;
+	unsigned long		nr_resync;
+};
+
+/* the ETR may hold several sources; keep the bytes of trace ID @id only */
+static size_t etm_sampler_deformat(const u8 *in, size_t len, uint8_t id,
+				   u8 *out)
+{
+	size_t f, n = 0;
+	uint8_t cur = 0;
+	int i;
+
+	for (f = 0; f + FRAME_SIZE <= len; f += FRAME_SIZE) {
+		const u8 *fr = in + f;
+		u8 aux = fr[FRAME_SIZE - 1];
+
+		for (i = 0; i < FRAME_SIZE - 1; i++) {
+			u8 b = fr[i];
+
+			if (i & 1) {
+				if (cur == id)
+					out[n++] = b;
+				continue;
+			}
+			if (!(b & 1)) {
+				b |= (aux >> (i / 2)) & 1;
+				if (cur == id)
+					out[n++] = b;
+				continue;
+			}
+			/* ID change, one byte late if the aux bit is set */
+			if ((aux & BIT(i / 2)) && i < FRAME_SIZE - 2) {
+				if (cur == id)
+					out[n++] = fr[i + 1];
+				i++;
+			}
+			cur = b >> 1;
+		}
+	}
+	return n;
+}
+
+static const u8 *etm_find_async(const u8 *p, const u8 *end)
+{
+	int zeros = 0;
+
+	for (; p < end; p++) {
+		if (*p == 0x00)
+			zeros++;
+		else if (*p == 0x80 && zeros >= ASYNC_ZEROS)
+			return p + 1;
+		else
+			zeros = 0;
+	}
+	return NULL;
+}
+
+/* skips a field of up to @max bytes, each but the last with bit 7 set */
+static const u8 *etm_skip_cont(const u8 *p, const u8 *end, int max)
+{
+	while (max--) {
+		if (p >= end)
+			return NULL;
+		if (!(*p++ & 0x80))
+			return p;
+	}
+	return p;
+}
+
+static const u8 *etm_skip_context(const u8 *p, const u8 *end)
+{
+	u8 info;
+
+	if (p >= end)
+		return NULL;
+	info = *p++;
+	if (info & BIT(6))
+		p++;		/* VMID */
+	if (info & BIT(7))
+		p += 4;		/* CONTEXTID */
+	return p <= end ? p : NULL;
+}
+
+static u64 etm_addr_long(const u8 *p, bool is1, int nbytes, u64 last)
+{
+	u64 addr;
+	int i;
+
+	if (is1)
+		addr = (p[0] & 0x7f) << 1 | p[1] << 8;
+	else
+		addr = (p[0] & 0x7f) << 2 | (p[1] & 0x7f) << 9;
+	for (i = 2; i < nbytes; i++)
+		addr |= (u64)p[i] << (8 * i);
+	if (nbytes == 4)
+		addr |= last & ~0xffffffffULL;
+	return addr;
+}
+
+static const u8 *etm_addr_short(const u8 *p, const u8 *end, bool is1,
+				u64 *addr)
+{
+	int shift = is1 ? 1 : 2;
+	u64 val, mask;
+
+	if (p >= end)
+		return NULL;
+	val = (u64)(p[0] & 0x7f) << shift;
+	mask = (0x80ULL << shift) - 1;
+	if (p[0] & 0x80) {
+		if (p + 1 >= end)
+			return NULL;
+		val |= (u64)p[1] << (7 + shift);
+		mask = (0x8000ULL << shift) - 1;
+		p++;
+	}
+	*addr = (*addr & ~mask) | val;
+	return p + 1;
+}
+
+static void etm_sampler_account(struct etm_sampler *s, u64 addr,
+				unsigned long *start, unsigned long *end,
+				int *slot)
+{
+	unsigned long size, offset, fn;
+	unsigned int h;
+	int i;
+
+	s->nr_samples++;
+	if (*slot >= 0 && addr >= *start && addr < *end) {
+		s->hist[*slot].count++;
+		return;
+	}
+
+	if (addr < TASK_SIZE) {
+		s->nr_user++;
+		return;
+	}
+	if (!kallsyms_lookup_size_offset(addr, &size, &offset)) {
+		s->nr_unknown++;
+		return;
+	}
+
+	fn = addr - offset;
+	h = hash_long(fn, SAMPLER_HIST_BITS);
+	for (i = 0; i < SAMPLER_HIST_PROBES; i++) {
+		struct etm_sampler_ent *e;
+
+		e = &s->hist[(h + i) & (SAMPLER_HIST_SIZE - 1)];
+		if (e->count && e->fn != fn)
+			continue;
+		e->fn = fn;
+		e->count++;
+		/* branches mostly stay within a function, skip the lookup */
+		*slot = e - s->hist;
+		*start = fn;
+		*end = fn + size;
+		return;
+	}
+	s->nr_dropped++;
+}
+
+/*
+ * Only as much of the ETMv4 instruction trace protocol as the sampler's
+ * own configuration produces is understood: no cycle counts, data trace,
+ * conditional or Q elements. Anything else makes the decoder drop to the
+ * next alignment sync.
+ */
+static void etm_sampler_decode(struct etm_sampler *s, const u8 *p, size_t len)
+{
+	const u8 *end = p + len;
+	unsigned long start = 0, stop = 0;
+	u64 hist[3], addr;
+	int slot = -1;
+	u8 hdr;
+
+	p = etm_find_async(p, end);
+	memset(hist, 0, sizeof(hist));
+
+	while (p && p < end) {
+		hdr = *p++;
+		switch (hdr) {
+		case 0x00:		/* extension */
+			if (p >= end)
+				return;
+			if (*p == 0x00) {
+				p = etm_find_async(p - 1, end);
+				memset(hist, 0, sizeof(hist));
+			} else if (*p == 0x03 || *p == 0x05) {
+				p++;	/* discard, overflow */
+			} else {
+				goto resync;
+			}
+			continue;
+		case 0x01:		/* trace info */
+			if (p >= end)
+				return;
+			hdr = *p;
+			p = etm_skip_cont(p, end, 1);
+			if (p && (hdr & BIT(0)))
+				p = etm_skip_cont(p, end, 1);
+			if (p && (hdr & BIT(1)))
+				p = etm_skip_cont(p, end, 5);
+			if (p && (hdr & BIT(2)))
+				p = etm_skip_cont(p, end, 5);
+			if (p && (hdr & BIT(3)))
+				p = etm_skip_cont(p, end, 3);
+			memset(hist, 0, sizeof(hist));
+			continue;
+		case 0x02:		/* timestamp */
+		case 0x03:
+			p = etm_skip_cont(p, end, 9);
+			if (p && hdr == 0x03)
+				p = etm_skip_cont(p, end, 3);
+			continue;
+		case 0x04:		/* trace on */
+		case 0x07:		/* exception return */
+		case 0x70:		/* ignore */
+			continue;
+		case 0x06:		/* exception */
+			p = etm_skip_cont(p, end, 2);
+			continue;
+		case 0x2d:		/* commit */
+		case 0x2e:		/* cancel */
+		case 0x2f:
+			p = etm_skip_cont(p, end, 5);
+			continue;
+		case 0x80:		/* context */
+			continue;
+		case 0x81:
+			p = etm_skip_context(p, end);
+			continue;
+		case 0x90:		/* exact match */
+		case 0x91:
+		case 0x92:
+			etm_sampler_account(s, hist[hdr & 0x3], &start, &stop,
+					    &slot);
+			continue;
+		case 0x95:		/* short address */
+		case 0x96:
+			addr = hist[0];
+			p = etm_addr_short(p, end, hdr == 0x96, &addr);
+			if (!p)
+				return;
+			break;
+		case 0x82:		/* long address with context */
+		case 0x83:
+		case 0x9a:		/* long address */
+		case 0x9b:
+			if (end - p < 4)
+				return;
+			addr = etm_addr_long(p, hdr & 1, 4, hist[0]);
+			p += 4;
+			if (hdr < 0x90)
+				p = etm_skip_context(p, end);
+			break;
+		case 0x85:
+		case 0x86:
+		case 0x9d:
+		case 0x9e:
+			if (end - p < 8)
+				return;
+			addr = etm_addr_long(p, hdr == 0x86 || hdr == 0x9e, 8,
+					     hist[0]);
+			p += 8;
+			if (hdr < 0x90)
+				p = etm_skip_context(p, end);
+			break;
+		default:
+			/* atoms, mispredict, cancel format 2/3, events */
+			if (hdr >= 0xc0 || (hdr >= 0x30 && hdr <= 0x3f) ||
+			    (hdr >= 0x71 && hdr <= 0x7f))
+				continue;
+			goto resync;
+		}
+
+		hist[2] = hist[1];
+		hist[1] = hist[0];
+		hist[0] = addr;
+		etm_sampler_account(s, addr, &start, &stop, &slot);
+		continue;
+resync:
+		s->nr_resync++;
+		p = etm_find_async(p, end);
+		memset(hist, 0, sizeof(hist));
+	}
+}
+
+static void etm_sampler_work(struct work_struct *work)
+{
+	struct etm_sampler *s = container_of(to_delayed_work(work),
+					     struct etm_sampler, work);
+	cpumask_t used;
+	ssize_t len;
+	size_t n;
+	int cpu;
+
+	mutex_lock(&s->lock);
+	if (!s->enable)
+		goto out;
+
+	cpumask_clear(&used);
+	for_each_cpu(cpu, &s->cpus) {
+		struct coresight_device *csdev;
+
+		if (!cpu_online(cpu))
+			continue;
+		csdev = etm4_sampler_get(cpu, &s->trcid[cpu]);
+		if (IS_ERR(csdev))
+			continue;
+		if (coresight_enable(csdev)) {
+			etm4_sampler_put(cpu);
+			continue;
+		}
+		s->csdev[cpu] = csdev;
+		cpumask_set_cpu(cpu, &used);
+	}
+	if (cpumask_empty(&used))
+		goto rearm;
+
+	usleep_range(s->burst_us, s->burst_us + s->burst_us / 4);
+
+	for_each_cpu(cpu, &used) {
+		coresight_disable(s->csdev[cpu]);
+		etm4_sampler_put(cpu);
+	}
+
+	len = tmc_etr_copy_trace(s->trace, SAMPLER_BUF_SIZE);
+	if (len <= 0)
+		goto rearm;
+
+	s->nr_bursts++;
+	for_each_cpu(cpu, &used) {
+		n = etm_sampler_deformat(s->trace, len, s->trcid[cpu],
+					 s->stream);
+		etm_sampler_decode(s, s->stream, n);
+	}
+rearm:
+	queue_delayed_work(system_unbound_wq, &s->work,
+			   msecs_to_jiffies(s->period_ms));
+out:
+	mutex_unlock(&s->lock);
+}
+
+static int etm_sampler_enable_get(void *data, u64 *val)
+{
+	struct etm_sampler *s = data;
+
+	*val = s->enable;
+	return 0;
+}
+
+static int etm_sampler_enable_set(void *data, u64 val)
+{
+	struct etm_sampler *s = data;
+
+	mutex_lock(&s->lock);
+	if (val && !s->enable) {
+		if (!s->trace)
+			s->trace = vmalloc(SAMPLER_BUF_SIZE);
+		if (!s->stream)
+			s->stream = vmalloc(SAMPLER_BUF_SIZE);
+		if (!s->trace || !s->stream) {
+			mutex_unlock(&s->lock);
+			return -ENOMEM;
+		}
+		s->enable = true;
+		queue_delayed_work(system_unbound_wq, &s->work, 0);
+	} else if (!val) {
+		s->enable = false;
+	}
+	mutex_unlock(&s->lock);
+
+	/* the work does not re-arm once enable is clear */
+	if (!val)
+		cancel_delayed_work_sync(&s->work);
+	return 0;
+}
+DEFINE_SIMPLE_ATTRIBUTE(etm_sampler_enable_fops, etm_sampler_enable_get,
+			etm_sampler_enable_set, "%llu\n");
+
+static int etm_sampler_burst_get(void *data, u64 *val)
+{
+	struct etm_sampler *s = data;
+
+	*val = s->burst_us;
+	return 0;
+}
+
+static int etm_sampler_burst_set(void *data, u64 val)
+{
+	struct etm_sampler *s = data;
+
+	if (val < SAMPLER_MIN_BURST_US || val > SAMPLER_MAX_BURST_US)
+		return -EINVAL;
+
+	mutex_lock(&s->lock);
+	s->burst_us = val;
+	mutex_unlock(&s->lock);
+	return 0;
+}
+DEFINE_SIMPLE_ATTRIBUTE(etm_sampler_burst_fops, etm_sampler_burst_get,
+			etm_sampler_burst_set, "%llu\n");
+
+static int etm_sampler_period_get(void *data, u64 *val)
+{
+	struct etm_sampler *s = data;
+
+	*val = s->period_ms;
+	return 0;
+}
+
+static int etm_sampler_period_set(void *data, u64 val)
+{
+	struct etm_sampler *s = data;
+
+	if (val < SAMPLER_MIN_PERIOD_MS || val > MSEC_PER_SEC * 60)
+		return -EINVAL;
+
+	mutex_lock(&s->lock);
+	s->period_ms = val;
+	mutex_unlock(&s->lock);
+	return 0;
+}
+DEFINE_SIMPLE_ATTRIBUTE(etm_sampler_period_fops, etm_sampler_period_get,
+			etm_sampler_period_set, "%llu\n");
+
+static ssize_t etm_sampler_cpus_read(struct file *file, char __user *ubuf,
+				     size_t count, loff_t *ppos)
+{
+	struct etm_sampler *s = file->private_data;
+	char buf[64];
+	int len;
+
+	mutex_lock(&s->lock);
+	len = cpulist_scnprintf(buf, sizeof(buf) - 1, &s->cpus);
+	mutex_unlock(&s->lock);
+	buf[len++] = '\n';
+
+	return simple_read_from_buffer(ubuf, count, ppos, buf, len);
+}
+
+static ssize_t etm_sampler_cpus_write(struct file *file,
+				      const char __user *ubuf, size_t count,
+				      loff_t *ppos)
+{
+	struct etm_sampler *s = file->private_data;
+	cpumask_t cpus;
+	char buf[64];
+	int ret;
+
+	if (count >= sizeof(buf))
+		return -EINVAL;
+	if (copy_from_user(buf, ubuf, count))
+		return -EFAULT;
+	buf[count] = '\0';
+
+	ret = cpulist_parse(strim(buf), &cpus);
+	if (ret)
+		return ret;
+
+	mutex_lock(&s->lock);
+	cpumask_and(&s->cpus, &cpus, cpu_possible_mask);
+	mutex_unlock(&s->lock);
+	return count;
+}
+
+static const struct file_operations etm_sampler_cpus_fops = {
+	.open		= simple_open,
+	.read		= etm_sampler_cpus_read,
+	.write		= etm_sampler_cpus_write,
+	.llseek		= default_llseek,
+};
+
+static int etm_sampler_cmp(const void *a, const void *b)
+{
+	const struct etm_sampler_ent *x = a, *y = b;
+
+	if (x->count != y->count)
+		return x->count > y->count ? -1 : 1;
+	return 0;
+}
+
+static int etm_sampler_hist_show(struct seq_file *m, void *data)
+{
+	struct etm_sampler *s = m->private;
+	struct etm_sampler_ent *ents;
+	unsigned long total;
+	int i, n = 0;
+
+	ents = vmalloc(sizeof(s->hist));
+	if (!ents)
+		return -ENOMEM;
+
+	mutex_lock(&s->lock);
+	for (i = 0; i < SAMPLER_HIST_SIZE; i++)
+		if (s->hist[i].count)
+			ents[n++] = s->hist[i];
+	seq_printf(m, "bursts %lu samples %lu user %lu unknown %lu ",
+		   s->nr_bursts, s->nr_samples, s->nr_user, s->nr_unknown);
+	seq_printf(m, "dropped %lu resync %lu\n", s->nr_dropped, s->nr_resync);
+	total = max(s->nr_samples, 1UL);
+	mutex_unlock(&s->lock);
+
+	sort(ents, n, sizeof(*ents), etm_sampler_cmp, NULL);
+	for (i = 0; i < n; i++) {
+		unsigned int pct = div64_u64((u64)ents[i].count * 10000,
+					     total);
+
+		seq_printf(m, "%10u %3u.%02u%% %ps\n", ents[i].count,
+			   pct / 100, pct % 100, (void *)ents[i].fn);
+	}
+
+	vfree(ents);
+	return 0;
+}
+
+static int etm_sampler_hist_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, etm_sampler_hist_show, inode->i_private);
+}
+
+/* any write clears the histogram and the counters */
+static ssize_t etm_sampler_hist_write(struct file *file,
+				      const char __user *ubuf, size_t count,
+				      loff_t *ppos)
+{
+	struct seq_file *m = file->private_data;
+	struct etm_sampler *s = m->private;
+
+	mutex_lock(&s->lock);
+	memset(s->hist, 0, sizeof(s->hist));
+	s->nr_bursts = 0;
+	s->nr_samples = 0;
+	s->nr_user = 0;
+	s->nr_unknown = 0;
+	s->nr_dropped = 0;
+	s->nr_resync = 0;
+	mutex_unlock(&s->lock);
+	return count;
+}
+
+static const struct file_operations etm_sampler_hist_fops = {
+	.open		= etm_sampler_hist_open,
+	.read		= seq_read,
+	.write		= etm_sampler_hist_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init etm_sampler_init(void)
+{
+	struct etm_sampler *s;
+	struct dentry *dent;
+
+	s = kzalloc(sizeof(*s), GFP_KERNEL);
+	if (!s)
+		return -ENOMEM;
+
+	mutex_init(&s->lock);
+	INIT_DELAYED_WORK(&s->work, etm_sampler_work);
+	cpumask_copy(&s->cpus, cpu_possible_mask);
+	s->burst_us = 500;
+	s->period_ms = 100;
+
+	dent = debugfs_create_dir("etm_sampler", NULL);
+	if (IS_ERR_OR_NULL(dent))
+		goto err;
+
+	if (!debugfs_create_file("enable", S_IRUGO | S_IWUSR, dent, s,
+				 &etm_sampler_enable_fops) ||
+	    !debugfs_create_file("cpus", S_IRUGO | S_IWUSR, dent, s,
+				 &etm_sampler_cpus_fops) ||
+	    !debugfs_create_file("burst_us", S_IRUGO | S_IWUSR, dent, s,
+				 &etm_sampler_burst_fops) ||
+	    !debugfs_create_file("period_ms", S_IRUGO | S_IWUSR, dent, s,
+				 &etm_sampler_period_fops) ||
+	    !debugfs_create_file("hist", S_IRUGO | S_IWUSR, dent, s,
+				 &etm_sampler_hist_fops)) {
+		debugfs_remove_recursive(dent);
+		goto err;
+	}
+
+	return 0;
+err:
+	pr_err("etm_sampler: Could not create debugfs files\n");
+	kfree(s);
+	return -ENODEV;
+}
+late_initcall(etm_sampler_init);
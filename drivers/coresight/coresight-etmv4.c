@@ -399,6 +399,9 @@ struct etm_drvdata {
 	uint32_t			ext_inp;
 	struct msm_dump_data		reg_data;
 	struct etm_cgc_data		*cgc_data;
+	bool				sampling;
+	uint32_t			saved_cfg;
+	uint32_t			saved_bb_ctrl;
 };
 
 /* support max 2 clusters now */
@@ -788,7 +791,7 @@ static int etm_enable(struct coresight_device *csdev)
 
 	pm_relax(drvdata->dev);
 
-	dev_info(drvdata->dev, "ETMv4 tracing enabled\n");
+	dev_dbg(drvdata->dev, "ETMv4 tracing enabled\n");
 	return 0;
 err:
 	spin_unlock(&drvdata->spinlock);
@@ -845,7 +848,7 @@ static void etm_disable(struct coresight_device *csdev)
 
 	pm_relax(drvdata->dev);
 
-	dev_info(drvdata->dev, "ETM tracing disabled\n");
+	dev_dbg(drvdata->dev, "ETM tracing disabled\n");
 }
 
 static const struct coresight_ops_source etm_source_ops = {
@@ -3051,6 +3054,56 @@ int coresight_etm_get_funnel_port(int cpu)
 }
 EXPORT_SYMBOL(coresight_etm_get_funnel_port);
 
+#ifdef CONFIG_CORESIGHT_ETMV4_SAMPLER
+/*
+ * Lends the ETM of @cpu to the sampler for one burst. While lent it
+ * traces instructions only, with branch broadcast where supported so
+ * that every taken branch gives an address packet. The user settings
+ * are put back by etm4_sampler_put().
+ */
+struct coresight_device *etm4_sampler_get(int cpu, uint8_t *trcid)
+{
+	struct etm_drvdata *drvdata = etmdrvdata[cpu];
+
+	if (!drvdata || !drvdata->init)
+		return ERR_PTR(-ENODEV);
+
+	spin_lock(&drvdata->spinlock);
+	if (drvdata->enable || drvdata->sampling) {
+		spin_unlock(&drvdata->spinlock);
+		return ERR_PTR(-EBUSY);
+	}
+	drvdata->sampling = true;
+	drvdata->saved_cfg = drvdata->cfg;
+	drvdata->saved_bb_ctrl = drvdata->bb_ctrl;
+	drvdata->cfg = drvdata->trc_bb_support ? BIT(3) : 0;
+	/* no ranges in exclude mode: broadcast everywhere */
+	drvdata->bb_ctrl = 0x0;
+	*trcid = drvdata->trcid;
+	spin_unlock(&drvdata->spinlock);
+
+	return drvdata->csdev;
+}
+EXPORT_SYMBOL(etm4_sampler_get);
+
+void etm4_sampler_put(int cpu)
+{
+	struct etm_drvdata *drvdata = etmdrvdata[cpu];
+
+	if (!drvdata)
+		return;
+
+	spin_lock(&drvdata->spinlock);
+	if (drvdata->sampling) {
+		drvdata->cfg = drvdata->saved_cfg;
+		drvdata->bb_ctrl = drvdata->saved_bb_ctrl;
+		drvdata->sampling = false;
+	}
+	spin_unlock(&drvdata->spinlock);
+}
+EXPORT_SYMBOL(etm4_sampler_put);
+#endif
+
 static void etm_init_arch_data(void *info)
 {
 	uint32_t etmidr0;
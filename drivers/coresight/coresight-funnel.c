@@ -101,7 +101,7 @@ static int funnel_enable(struct coresight_device *csdev, int inport,
 	__set_bit(inport, drvdata->inport);
 	spin_unlock(&drvdata->spinlock);
 
-	dev_info(drvdata->dev, "FUNNEL inport %d enabled\n", inport);
+	dev_dbg(drvdata->dev, "FUNNEL inport %d enabled\n", inport);
 	return 0;
 }
 
@@ -154,7 +154,7 @@ static void funnel_disable(struct coresight_device *csdev, int inport,
 
 	clk_disable_unprepare(drvdata->clk);
 
-	dev_info(drvdata->dev, "FUNNEL inport %d disabled\n", inport);
+	dev_dbg(drvdata->dev, "FUNNEL inport %d disabled\n", inport);
 }
 
 static int funnel_disable_cpu_port(struct notifier_block *this,
@@ -74,5 +74,10 @@ extern int coresight_etm_get_funnel_port(int cpu);
 #else
 static inline int coresight_etm_get_funnel_port(int cpu) { return -ENOSYS; }
 #endif
+#ifdef CONFIG_CORESIGHT_ETMV4_SAMPLER
+extern struct coresight_device *etm4_sampler_get(int cpu, uint8_t *trcid);
+extern void etm4_sampler_put(int cpu);
+extern ssize_t tmc_etr_copy_trace(void *dst, size_t len);
+#endif
 
 #endif
@@ -79,7 +79,7 @@ static int replicator_enable(struct coresight_device *csdev, int inport,
 
 	__replicator_enable(drvdata, outport);
 
-	dev_info(drvdata->dev, "REPLICATOR enabled\n");
+	dev_dbg(drvdata->dev, "REPLICATOR enabled\n");
 	return 0;
 }
 
@@ -105,7 +105,7 @@ static void replicator_disable(struct coresight_device *csdev, int inport,
 
 	clk_disable_unprepare(drvdata->clk);
 
-	dev_info(drvdata->dev, "REPLICATOR disabled\n");
+	dev_dbg(drvdata->dev, "REPLICATOR disabled\n");
 }
 
 static const struct coresight_ops_link replicator_link_ops = {
@@ -215,8 +215,13 @@ struct tmc_drvdata {
 	int			sg_blk_num;
 	bool			notify;
 	struct notifier_block	jtag_save_blk;
+	uint32_t		trace_len;
 };
 
+#ifdef CONFIG_CORESIGHT_ETMV4_SAMPLER
+static struct tmc_drvdata *tmc_etr_drvdata;
+#endif
+
 static void __tmc_reg_dump(struct tmc_drvdata *drvdata);
 static void tmc_wait_for_flush(struct tmc_drvdata *drvdata)
 {
@@ -930,7 +935,7 @@ static int tmc_enable(struct tmc_drvdata *drvdata, enum tmc_mode mode)
 	spin_unlock_irqrestore(&drvdata->spinlock, flags);
 	mutex_unlock(&drvdata->usb_lock);
 
-	dev_info(drvdata->dev, "TMC enabled\n");
+	dev_dbg(drvdata->dev, "TMC enabled\n");
 	return 0;
 err0:
 	mutex_unlock(&drvdata->usb_lock);
@@ -1143,10 +1148,13 @@ static void __tmc_etr_dump(struct tmc_drvdata *drvdata)
 	rwphi = tmc_readl(drvdata, TMC_RWPHI);
 
 	if (drvdata->memtype == TMC_ETR_MEM_TYPE_CONTIG) {
-		if (BVAL(tmc_readl(drvdata, TMC_STS), 0))
+		if (BVAL(tmc_readl(drvdata, TMC_STS), 0)) {
 			drvdata->buf = drvdata->vaddr + rwp - drvdata->paddr;
-		else
+			drvdata->trace_len = drvdata->size;
+		} else {
 			drvdata->buf = drvdata->vaddr;
+			drvdata->trace_len = rwp - drvdata->paddr;
+		}
 	} else {
 		/*
 		 * Reset these variables before computing since we
@@ -1162,6 +1170,51 @@ static void __tmc_etr_dump(struct tmc_drvdata *drvdata)
 	}
 }
 
+#ifdef CONFIG_CORESIGHT_ETMV4_SAMPLER
+/*
+ * Copies out the most recent trace left in the ETR by the last session,
+ * in whole formatter frames, and consumes it so it is only handed out
+ * once. Only contiguous memory mode is supported.
+ */
+ssize_t tmc_etr_copy_trace(void *dst, size_t len)
+{
+	struct tmc_drvdata *drvdata = tmc_etr_drvdata;
+	unsigned long flags;
+	char *end;
+	size_t tail;
+	ssize_t ret;
+
+	if (!drvdata)
+		return -ENODEV;
+
+	spin_lock_irqsave(&drvdata->spinlock, flags);
+	if (drvdata->enable || drvdata->reading ||
+	    drvdata->out_mode != TMC_ETR_OUT_MODE_MEM ||
+	    drvdata->memtype != TMC_ETR_MEM_TYPE_CONTIG) {
+		ret = -EBUSY;
+		goto out;
+	}
+
+	len = min_t(size_t, len, drvdata->trace_len) & ~(size_t)0xF;
+	end = drvdata->buf + drvdata->trace_len;
+	if (end > (char *)drvdata->vaddr + drvdata->size)
+		end -= drvdata->size;
+
+	/* oldest data first, the buffer may have wrapped */
+	tail = min_t(size_t, len, end - (char *)drvdata->vaddr);
+	memcpy(dst, (char *)drvdata->vaddr + drvdata->size - (len - tail),
+	       len - tail);
+	memcpy(dst + len - tail, end - tail, tail);
+
+	drvdata->trace_len = 0;
+	ret = len;
+out:
+	spin_unlock_irqrestore(&drvdata->spinlock, flags);
+	return ret;
+}
+EXPORT_SYMBOL(tmc_etr_copy_trace);
+#endif
+
 static void __tmc_etr_disable_to_mem(struct tmc_drvdata *drvdata)
 {
 	TMC_UNLOCK(drvdata);
@@ -1233,7 +1286,7 @@ static void tmc_disable(struct tmc_drvdata *drvdata, enum tmc_mode mode)
 
 	clk_disable_unprepare(drvdata->clk);
 
-	dev_info(drvdata->dev, "TMC disabled\n");
+	dev_dbg(drvdata->dev, "TMC disabled\n");
 	return;
 out:
 	drvdata->enable = false;
@@ -1242,7 +1295,7 @@ out:
 
 	clk_disable_unprepare(drvdata->clk);
 
-	dev_info(drvdata->dev, "TMC disabled\n");
+	dev_dbg(drvdata->dev, "TMC disabled\n");
 }
 
 static void tmc_disable_sink(struct coresight_device *csdev)
@@ -2575,6 +2628,9 @@ static int tmc_probe(struct platform_device *pdev)
 			ret = PTR_ERR(drvdata->csdev);
 			goto err2;
 		}
+#ifdef CONFIG_CORESIGHT_ETMV4_SAMPLER
+		tmc_etr_drvdata = drvdata;
+#endif
 	} else {
 		desc->type = CORESIGHT_DEV_TYPE_LINKSINK;
 		desc->subtype.sink_subtype = CORESIGHT_DEV_SUBTYPE_SINK_BUFFER;
@@ -2631,6 +2687,10 @@ static int tmc_remove(struct platform_device *pdev)
 		msm_jtag_save_unregister(&drvdata->jtag_save_blk);
 	tmc_etr_byte_cntr_exit(drvdata);
 	misc_deregister(&drvdata->miscdev);
+#ifdef CONFIG_CORESIGHT_ETMV4_SAMPLER
+	if (tmc_etr_drvdata == drvdata)
+		tmc_etr_drvdata = NULL;
+#endif
 	coresight_unregister(drvdata->csdev);
 	tmc_etr_bam_exit(drvdata);
 	tmc_etr_free_mem(drvdata);
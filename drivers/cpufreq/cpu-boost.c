@@ -22,6 +22,9 @@
 #include <linux/slab.h>
 #include <linux/input.h>
 #include <linux/time.h>
+#include <linux/sched/core_ctl.h>
+#include <linux/notifier.h>
+#include <trace/events/power.h>
 
 struct cpu_sync {
 	int cpu;
@@ -35,6 +38,57 @@ static struct workqueue_struct *cpu_boost_wq;
 static struct work_struct input_boost_work;
 static bool input_boost_enabled;
 
+/*
+ * Boost profiles, keyed by the class of the input device and the kind of
+ * event (finger/key down, a stream of moves or repeats, release), plus a
+ * "launch" profile that userspace fires through boost_trigger. A class
+ * without any profile keeps using input_boost_freq / input_boost_ms for
+ * every event.
+ */
+enum boost_class {
+	BOOST_CLASS_TOUCHSCREEN,
+	BOOST_CLASS_TOUCHPAD,
+	BOOST_CLASS_KEYPAD,
+	NR_BOOST_CLASSES,
+};
+
+enum boost_event {
+	BOOST_EVENT_DOWN,
+	BOOST_EVENT_MOVE,
+	BOOST_EVENT_UP,
+	NR_BOOST_EVENTS,
+};
+
+#define BOOST_PROFILE(class, event)	((class) * NR_BOOST_EVENTS + (event))
+#define BOOST_PROFILE_LAUNCH		(NR_BOOST_CLASSES * NR_BOOST_EVENTS)
+#define BOOST_PROFILE_LEGACY		(BOOST_PROFILE_LAUNCH + 1)
+#define NR_BOOST_PROFILES		(BOOST_PROFILE_LEGACY + 1)
+
+static const char * const boost_profile_names[BOOST_PROFILE_LEGACY] = {
+	"touchscreen_down", "touchscreen_move", "touchscreen_up",
+	"touchpad_down", "touchpad_move", "touchpad_up",
+	"keypad_down", "keypad_move", "keypad_up",
+	"launch",
+};
+
+struct boost_profile {
+	unsigned int freq[NR_CPUS];
+	unsigned int ms;
+	unsigned int min_cpus;
+	u64 last_time;
+};
+
+/* Protects boost_profiles, class_has_profile and pending_profiles */
+static DEFINE_SPINLOCK(boost_lock);
+static struct boost_profile boost_profiles[BOOST_PROFILE_LEGACY];
+static bool class_has_profile[NR_BOOST_CLASSES];
+static unsigned long pending_profiles;
+
+/* Serializes applying and removing boosts, protects boost_end */
+static DEFINE_MUTEX(boost_mutex);
+static unsigned long boost_end;
+static DEFINE_PER_CPU(unsigned int, boost_min_cpus);
+
 static unsigned int input_boost_ms = 40;
 module_param(input_boost_ms, uint, 0644);
 
@@ -47,6 +101,16 @@ static struct delayed_work input_boost_rem;
 static u64 last_input_time;
 #define MIN_INPUT_INTERVAL (150 * USEC_PER_MSEC)
 
+/* Boost as a touchscreen down event as soon as a touch IRQ fires */
+static bool boost_on_hint = true;
+module_param(boost_on_hint, bool, 0644);
+
+/*
+ * Timestamps of the last interaction hint, of the first input event and of
+ * the boost that followed it, in ns. Protected by boost_lock.
+ */
+static u64 hint_ns, hint_event_ns, hint_boost_ns;
+
 static int set_input_boost_freq(const char *buf, const struct kernel_param *kp)
 {
 	int i, ntokens = 0;
@@ -114,6 +178,158 @@ static const struct kernel_param_ops param_ops_input_boost_freq = {
 };
 module_param_cb(input_boost_freq, &param_ops_input_boost_freq, NULL, 0644);
 
+static int boost_profile_lookup(const char *name)
+{
+	int i;
+
+	for (i = 0; i < BOOST_PROFILE_LEGACY; i++)
+		if (!strcmp(name, boost_profile_names[i]))
+			return i;
+
+	return -EINVAL;
+}
+
+/*
+ * Format: "<profile> <ms> [<min_cpus>] [<cpu>:<freq> ...]". An <ms> of 0
+ * removes the profile.
+ */
+static int set_input_boost_profile(const char *buf,
+				   const struct kernel_param *kp)
+{
+	struct boost_profile prof = { };
+	char *str, *cur, *tok;
+	unsigned int cpu, val;
+	unsigned long flags;
+	int idx, i, ret = -EINVAL;
+
+	str = kstrdup(buf, GFP_KERNEL);
+	if (!str)
+		return -ENOMEM;
+	cur = strim(str);
+
+	tok = strsep(&cur, " ");
+	idx = boost_profile_lookup(tok);
+	if (idx < 0)
+		goto out;
+
+	tok = strsep(&cur, " ");
+	if (!tok || kstrtouint(tok, 10, &prof.ms))
+		goto out;
+
+	while ((tok = strsep(&cur, " "))) {
+		if (!*tok)
+			continue;
+		if (!strchr(tok, ':')) {
+			if (kstrtouint(tok, 10, &prof.min_cpus))
+				goto out;
+			continue;
+		}
+		if (sscanf(tok, "%u:%u", &cpu, &val) != 2 ||
+		    cpu >= nr_cpu_ids)
+			goto out;
+		prof.freq[cpu] = val;
+	}
+
+	spin_lock_irqsave(&boost_lock, flags);
+	boost_profiles[idx] = prof;
+	for (i = 0; i < NR_BOOST_CLASSES; i++)
+		class_has_profile[i] =
+			boost_profiles[BOOST_PROFILE(i, BOOST_EVENT_DOWN)].ms ||
+			boost_profiles[BOOST_PROFILE(i, BOOST_EVENT_MOVE)].ms ||
+			boost_profiles[BOOST_PROFILE(i, BOOST_EVENT_UP)].ms;
+	spin_unlock_irqrestore(&boost_lock, flags);
+	ret = 0;
+out:
+	kfree(str);
+	return ret;
+}
+
+static int get_input_boost_profile(char *buf, const struct kernel_param *kp)
+{
+	struct boost_profile *prof;
+	unsigned long flags;
+	int cnt = 0, i, cpu;
+
+	spin_lock_irqsave(&boost_lock, flags);
+	for (i = 0; i < BOOST_PROFILE_LEGACY; i++) {
+		prof = &boost_profiles[i];
+		if (!prof->ms)
+			continue;
+		cnt += snprintf(buf + cnt, PAGE_SIZE - cnt, "%s %u %u",
+				boost_profile_names[i], prof->ms,
+				prof->min_cpus);
+		for_each_possible_cpu(cpu)
+			if (prof->freq[cpu])
+				cnt += snprintf(buf + cnt, PAGE_SIZE - cnt,
+						" %d:%u", cpu, prof->freq[cpu]);
+		cnt += snprintf(buf + cnt, PAGE_SIZE - cnt, "\n");
+	}
+	spin_unlock_irqrestore(&boost_lock, flags);
+
+	return cnt;
+}
+
+static const struct kernel_param_ops param_ops_input_boost_profile = {
+	.set = set_input_boost_profile,
+	.get = get_input_boost_profile,
+};
+module_param_cb(input_boost_profile, &param_ops_input_boost_profile, NULL,
+		0644);
+
+/* Called with boost_lock held */
+static void trace_hint_latency(void)
+{
+	if (!hint_ns || !hint_event_ns || !hint_boost_ns)
+		return;
+
+	trace_input_boost_latency(div_s64(hint_event_ns - hint_ns,
+					  NSEC_PER_USEC),
+				  div_s64(hint_boost_ns - hint_ns,
+					  NSEC_PER_USEC));
+	hint_ns = 0;
+}
+
+static void queue_boost_profile(int idx)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&boost_lock, flags);
+	__set_bit(idx, &pending_profiles);
+	spin_unlock_irqrestore(&boost_lock, flags);
+
+	queue_work(cpu_boost_wq, &input_boost_work);
+}
+
+/* Fire a boost profile by name, e.g. "launch" when an app starts */
+static int set_boost_trigger(const char *buf, const struct kernel_param *kp)
+{
+	char name[20];
+	unsigned long flags;
+	bool configured;
+	int idx;
+
+	if (sscanf(buf, "%19s", name) != 1)
+		return -EINVAL;
+
+	idx = boost_profile_lookup(name);
+	if (idx < 0)
+		return idx;
+
+	spin_lock_irqsave(&boost_lock, flags);
+	configured = boost_profiles[idx].ms;
+	spin_unlock_irqrestore(&boost_lock, flags);
+	if (!configured)
+		return -ENOENT;
+
+	queue_boost_profile(idx);
+	return 0;
+}
+
+static const struct kernel_param_ops param_ops_boost_trigger = {
+	.set = set_boost_trigger,
+};
+module_param_cb(boost_trigger, &param_ops_boost_trigger, NULL, 0200);
+
 /*
  * The CPUFREQ_ADJUST notifier is used to override the current policy min to
  * make sure policy min >= boost_min. The cpufreq framework then does the job
@@ -174,11 +390,17 @@ static void do_input_boost_rem(struct work_struct *work)
 	unsigned int i, ret;
 	struct cpu_sync *i_sync_info;
 
+	mutex_lock(&boost_mutex);
+
 	/* Reset the input_boost_min for all CPUs in the system */
 	pr_debug("Resetting input boost min for all CPUs\n");
 	for_each_possible_cpu(i) {
 		i_sync_info = &per_cpu(sync_info, i);
 		i_sync_info->input_boost_min = 0;
+		if (per_cpu(boost_min_cpus, i)) {
+			per_cpu(boost_min_cpus, i) = 0;
+			core_ctl_set_boost_min_cpus(i, 0);
+		}
 	}
 
 	/* Update policies for all online CPUs */
@@ -190,31 +412,68 @@ static void do_input_boost_rem(struct work_struct *work)
 			pr_err("cpu-boost: HMP boost disable failed\n");
 		sched_boost_active = false;
 	}
+
+	mutex_unlock(&boost_mutex);
 }
 
+/*
+ * Apply every pending profile. Overlapping boosts are merged: each CPU
+ * gets the highest requested frequency and the boost lasts until the
+ * latest requested end.
+ */
 static void do_input_boost(struct work_struct *work)
 {
-	unsigned int i, ret;
+	unsigned int freq[NR_CPUS] = { }, min_cpus[NR_CPUS] = { };
+	unsigned int i, ret, ms = 0;
 	struct cpu_sync *i_sync_info;
+	struct boost_profile *prof;
+	unsigned long pending, flags, end;
+	int idx;
+
+	spin_lock_irqsave(&boost_lock, flags);
+	pending = pending_profiles;
+	pending_profiles = 0;
+	for_each_set_bit(idx, &pending, NR_BOOST_PROFILES) {
+		if (idx == BOOST_PROFILE_LEGACY) {
+			for_each_possible_cpu(i)
+				freq[i] = max(freq[i],
+				      per_cpu(sync_info, i).input_boost_freq);
+			ms = max(ms, input_boost_ms);
+			continue;
+		}
 
-	cancel_delayed_work_sync(&input_boost_rem);
-	if (sched_boost_active) {
-		sched_set_boost(0);
-		sched_boost_active = false;
+		prof = &boost_profiles[idx];
+		for_each_possible_cpu(i) {
+			freq[i] = max(freq[i], prof->freq[i]);
+			if (prof->freq[i])
+				min_cpus[i] = max(min_cpus[i], prof->min_cpus);
+		}
+		ms = max(ms, prof->ms);
 	}
+	spin_unlock_irqrestore(&boost_lock, flags);
+
+	if (!ms)
+		return;
+
+	mutex_lock(&boost_mutex);
 
 	/* Set the input_boost_min for all CPUs in the system */
 	pr_debug("Setting input boost min for all CPUs\n");
 	for_each_possible_cpu(i) {
 		i_sync_info = &per_cpu(sync_info, i);
-		i_sync_info->input_boost_min = i_sync_info->input_boost_freq;
+		i_sync_info->input_boost_min = max(i_sync_info->input_boost_min,
+						   freq[i]);
+		if (min_cpus[i] > per_cpu(boost_min_cpus, i)) {
+			per_cpu(boost_min_cpus, i) = min_cpus[i];
+			core_ctl_set_boost_min_cpus(i, min_cpus[i]);
+		}
 	}
 
 	/* Update policies for all online CPUs */
 	update_policy_online();
 
 	/* Enable scheduler boost to migrate tasks to big cluster */
-	if (sched_boost_on_input) {
+	if (sched_boost_on_input && !sched_boost_active) {
 		ret = sched_set_boost(1);
 		if (ret)
 			pr_err("cpu-boost: HMP boost enable failed\n");
@@ -222,29 +481,145 @@ static void do_input_boost(struct work_struct *work)
 			sched_boost_active = true;
 	}
 
-	queue_delayed_work(cpu_boost_wq, &input_boost_rem,
-					msecs_to_jiffies(input_boost_ms));
+	end = jiffies + msecs_to_jiffies(ms);
+	if (!delayed_work_pending(&input_boost_rem) ||
+	    time_after(end, boost_end)) {
+		boost_end = end;
+		mod_delayed_work(cpu_boost_wq, &input_boost_rem,
+				 msecs_to_jiffies(ms));
+	}
+
+	mutex_unlock(&boost_mutex);
+
+	spin_lock_irqsave(&boost_lock, flags);
+	if (hint_ns && !hint_boost_ns) {
+		hint_boost_ns = ktime_get_ns();
+		trace_hint_latency();
+	}
+	spin_unlock_irqrestore(&boost_lock, flags);
 }
 
-static void cpuboost_input_event(struct input_handle *handle,
-		unsigned int type, unsigned int code, int value)
+static int boost_event_type(unsigned int type, unsigned int code, int value)
+{
+	switch (type) {
+	case EV_KEY:
+		if (value == 2)
+			return BOOST_EVENT_MOVE;
+		return value ? BOOST_EVENT_DOWN : BOOST_EVENT_UP;
+	case EV_ABS:
+		if (code == ABS_MT_TRACKING_ID)
+			return value < 0 ? BOOST_EVENT_UP : BOOST_EVENT_DOWN;
+		return BOOST_EVENT_MOVE;
+	case EV_REL:
+		return BOOST_EVENT_MOVE;
+	}
+
+	return -EINVAL;
+}
+
+/*
+ * Queue the boost for an event of the given class, subject to rate
+ * limiting. Returns true if a boost was queued.
+ */
+static bool cpuboost_kick(int class, int event, u64 now)
 {
-	u64 now;
+	struct boost_profile *prof;
+	unsigned long flags;
+	int idx;
+
+	if (class_has_profile[class]) {
+		idx = BOOST_PROFILE(class, event);
+
+		spin_lock_irqsave(&boost_lock, flags);
+		prof = &boost_profiles[idx];
+		if (!prof->ms || now - prof->last_time < MIN_INPUT_INTERVAL) {
+			spin_unlock_irqrestore(&boost_lock, flags);
+			return false;
+		}
+		prof->last_time = now;
+		spin_unlock_irqrestore(&boost_lock, flags);
+
+		queue_boost_profile(idx);
+		return true;
+	}
 
 	if (!input_boost_enabled)
-		return;
+		return false;
 
-	now = ktime_to_us(ktime_get());
 	if (now - last_input_time < MIN_INPUT_INTERVAL)
-		return;
+		return false;
 
 	if (work_pending(&input_boost_work))
-		return;
+		return false;
 
-	queue_work(cpu_boost_wq, &input_boost_work);
+	queue_boost_profile(BOOST_PROFILE_LEGACY);
 	last_input_time = ktime_to_us(ktime_get());
+	return true;
 }
 
+static void cpuboost_input_event(struct input_handle *handle,
+		unsigned int type, unsigned int code, int value)
+{
+	int class = (long)handle->private;
+	unsigned long flags;
+	int event;
+
+	if (ACCESS_ONCE(hint_ns) && !ACCESS_ONCE(hint_event_ns)) {
+		spin_lock_irqsave(&boost_lock, flags);
+		if (hint_ns && !hint_event_ns) {
+			hint_event_ns = ktime_get_ns();
+			trace_hint_latency();
+		}
+		spin_unlock_irqrestore(&boost_lock, flags);
+	}
+
+	event = boost_event_type(type, code, value);
+	if (class_has_profile[class] && event < 0)
+		return;
+
+	cpuboost_kick(class, event, ktime_to_us(ktime_get()));
+}
+
+/*
+ * Interaction hint from a touchscreen hard IRQ: boost right away instead
+ * of waiting for the driver to read the touch data and report events.
+ */
+static int cpuboost_interaction_notify(struct notifier_block *nb,
+				       unsigned long val, void *data)
+{
+	u64 now = ktime_to_ns(*(ktime_t *)data);
+	unsigned long flags;
+
+	if (!boost_on_hint)
+		return NOTIFY_DONE;
+
+	spin_lock_irqsave(&boost_lock, flags);
+	hint_ns = now;
+	hint_event_ns = 0;
+	hint_boost_ns = 0;
+	spin_unlock_irqrestore(&boost_lock, flags);
+
+	if (cpuboost_kick(BOOST_CLASS_TOUCHSCREEN, BOOST_EVENT_DOWN,
+			  div_u64(now, NSEC_PER_USEC)))
+		return NOTIFY_OK;
+
+	/* Nothing queued: either already boosted or boosting is off */
+	spin_lock_irqsave(&boost_lock, flags);
+	if (!work_pending(&input_boost_work)) {
+		if (delayed_work_pending(&input_boost_rem))
+			hint_boost_ns = hint_ns;
+		else
+			hint_ns = 0;
+	}
+	spin_unlock_irqrestore(&boost_lock, flags);
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block cpuboost_interaction_nb = {
+	.notifier_call = cpuboost_interaction_notify,
+};
+
 static int cpuboost_input_connect(struct input_handler *handler,
 		struct input_dev *dev, const struct input_device_id *id)
 {
@@ -258,6 +633,7 @@ static int cpuboost_input_connect(struct input_handler *handler,
 	handle->dev = dev;
 	handle->handler = handler;
 	handle->name = "cpufreq";
+	handle->private = (void *)id->driver_info;
 
 	error = input_register_handle(handle);
 	if (error)
@@ -291,6 +667,7 @@ static const struct input_device_id cpuboost_ids[] = {
 		.absbit = { [BIT_WORD(ABS_MT_POSITION_X)] =
 			BIT_MASK(ABS_MT_POSITION_X) |
 			BIT_MASK(ABS_MT_POSITION_Y) },
+		.driver_info = BOOST_CLASS_TOUCHSCREEN,
 	},
 	/* touchpad */
 	{
@@ -299,11 +676,13 @@ static const struct input_device_id cpuboost_ids[] = {
 		.keybit = { [BIT_WORD(BTN_TOUCH)] = BIT_MASK(BTN_TOUCH) },
 		.absbit = { [BIT_WORD(ABS_X)] =
 			BIT_MASK(ABS_X) | BIT_MASK(ABS_Y) },
+		.driver_info = BOOST_CLASS_TOUCHPAD,
 	},
 	/* Keypad */
 	{
 		.flags = INPUT_DEVICE_ID_MATCH_EVBIT,
 		.evbit = { BIT_MASK(EV_KEY) },
+		.driver_info = BOOST_CLASS_KEYPAD,
 	},
 	{ },
 };
@@ -334,6 +713,8 @@ static int cpu_boost_init(void)
 	}
 	cpufreq_register_notifier(&boost_adjust_nb, CPUFREQ_POLICY_NOTIFIER);
 	ret = input_register_handler(&cpuboost_input_handler);
+	if (!ret)
+		input_register_interaction_notifier(&cpuboost_interaction_nb);
 
 	return ret;
 }
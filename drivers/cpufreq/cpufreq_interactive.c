@@ -139,6 +139,12 @@ struct cpufreq_interactive_tunables {
 	bool use_sched_load;
 	bool use_migration_notif;
 
+	/*
+	 * Evaluate load as soon as the scheduler rolls over a window rather
+	 * than from policy_timer, which then only covers idle CPUs.
+	 */
+	bool use_window_notif;
+
 	/*
 	 * Whether to align timer windows across all CPUs. When
 	 * use_sched_load is true, this flag is ignored and windows
@@ -185,6 +191,28 @@ static u64 round_to_nw_start(u64 jif,
 	return ret;
 }
 
+static inline bool use_load_notif(
+			struct cpufreq_interactive_tunables *tunables)
+{
+	return tunables->use_migration_notif || tunables->use_window_notif;
+}
+
+/*
+ * Expiry of the next policy_timer evaluation. With window notifications
+ * busy CPUs are evaluated on each window rollover, so the timer is pushed
+ * out by an extra window and only fires once the policy has gone idle.
+ */
+static u64 policy_timer_expires(u64 jif,
+			     struct cpufreq_interactive_tunables *tunables)
+{
+	u64 expires = round_to_nw_start(jif, tunables);
+
+	if (tunables->use_sched_load && tunables->use_window_notif)
+		expires += usecs_to_jiffies(tunables->timer_rate);
+
+	return expires;
+}
+
 static inline int set_window_helper(
 			struct cpufreq_interactive_tunables *tunables)
 {
@@ -204,7 +232,7 @@ static void cpufreq_interactive_timer_resched(unsigned long cpu,
 	int i;
 
 	spin_lock_irqsave(&ppol->load_lock, flags);
-	expires = round_to_nw_start(ppol->last_evaluated_jiffy, tunables);
+	expires = policy_timer_expires(ppol->last_evaluated_jiffy, tunables);
 	if (!slack_only) {
 		for_each_cpu(i, ppol->policy->cpus) {
 			pcpu = &per_cpu(cpuinfo, i);
@@ -240,7 +268,8 @@ static void cpufreq_interactive_timer_start(
 {
 	struct cpufreq_interactive_policyinfo *ppol = per_cpu(polinfo, cpu);
 	struct cpufreq_interactive_cpuinfo *pcpu;
-	u64 expires = round_to_nw_start(ppol->last_evaluated_jiffy, tunables);
+	u64 expires = policy_timer_expires(ppol->last_evaluated_jiffy,
+					   tunables);
 	unsigned long flags;
 	int i;
 
@@ -802,7 +831,28 @@ static int load_change_callback(struct notifier_block *nb, unsigned long val,
 		goto exit;
 
 	tunables = ppol->policy->governor_data;
-	if (!tunables->use_sched_load || !tunables->use_migration_notif)
+	if (!tunables->use_sched_load)
+		goto exit;
+
+	if (val == LOAD_ALERT_WINDOW_ROLLOVER) {
+		if (!tunables->use_window_notif)
+			goto exit;
+
+		/*
+		 * All CPUs of the policy roll over on the same tick, evaluate
+		 * the completed window once for the whole policy.
+		 */
+		if (ppol->last_evaluated_jiffy == get_jiffies_64())
+			goto exit;
+
+		trace_cpufreq_interactive_load_change(cpu);
+		del_timer(&ppol->policy_timer);
+		del_timer(&ppol->policy_slack_timer);
+		cpufreq_interactive_timer(cpu);
+		goto exit;
+	}
+
+	if (!tunables->use_migration_notif)
 		goto exit;
 
 	spin_lock_irqsave(&ppol->target_freq_lock, flags);
@@ -1283,7 +1333,7 @@ static int cpufreq_interactive_enable_sched_input(
 		sched_set_io_is_busy(tunables->io_is_busy);
 	}
 
-	if (!tunables->use_migration_notif)
+	if (!use_load_notif(tunables))
 		goto out;
 
 	migration_register_count++;
@@ -1302,7 +1352,7 @@ static int cpufreq_interactive_disable_sched_input(
 {
 	mutex_lock(&sched_lock);
 
-	if (tunables->use_migration_notif) {
+	if (use_load_notif(tunables)) {
 		migration_register_count--;
 		if (migration_register_count < 1)
 			atomic_notifier_chain_unregister(
@@ -1350,6 +1400,39 @@ static ssize_t store_use_sched_load(
 	return count;
 }
 
+/*
+ * Update one of the load notification flags, registering for scheduler
+ * notifications when the first one is set and unregistering when the
+ * last one is cleared.
+ */
+static void set_load_notif(struct cpufreq_interactive_tunables *tunables,
+			   bool *flag, bool val)
+{
+	bool was_registered = use_load_notif(tunables);
+
+	*flag = val;
+
+	if (!tunables->use_sched_load ||
+	    was_registered == use_load_notif(tunables))
+		return;
+
+	mutex_lock(&sched_lock);
+	if (!was_registered) {
+		migration_register_count++;
+		if (migration_register_count == 1)
+			atomic_notifier_chain_register(
+					&load_alert_notifier_head,
+					&load_notifier_block);
+	} else {
+		migration_register_count--;
+		if (!migration_register_count)
+			atomic_notifier_chain_unregister(
+					&load_alert_notifier_head,
+					&load_notifier_block);
+	}
+	mutex_unlock(&sched_lock);
+}
+
 static ssize_t show_use_migration_notif(
 		struct cpufreq_interactive_tunables *tunables, char *buf)
 {
@@ -1370,27 +1453,33 @@ static ssize_t store_use_migration_notif(
 
 	if (tunables->use_migration_notif == (bool) val)
 		return count;
-	tunables->use_migration_notif = val;
 
-	if (!tunables->use_sched_load)
-		return count;
+	set_load_notif(tunables, &tunables->use_migration_notif, val);
+	return count;
+}
 
-	mutex_lock(&sched_lock);
-	if (val) {
-		migration_register_count++;
-		if (migration_register_count == 1)
-			atomic_notifier_chain_register(
-					&load_alert_notifier_head,
-					&load_notifier_block);
-	} else {
-		migration_register_count--;
-		if (!migration_register_count)
-			atomic_notifier_chain_unregister(
-					&load_alert_notifier_head,
-					&load_notifier_block);
-	}
-	mutex_unlock(&sched_lock);
+static ssize_t show_use_window_notif(
+		struct cpufreq_interactive_tunables *tunables, char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%d\n",
+			tunables->use_window_notif);
+}
+
+static ssize_t store_use_window_notif(
+			struct cpufreq_interactive_tunables *tunables,
+			const char *buf, size_t count)
+{
+	int ret;
+	unsigned long val;
+
+	ret = kstrtoul(buf, 0, &val);
+	if (ret < 0)
+		return ret;
+
+	if (tunables->use_window_notif == (bool) val)
+		return count;
 
+	set_load_notif(tunables, &tunables->use_window_notif, val);
 	return count;
 }
 
@@ -1443,6 +1532,7 @@ show_store_gov_pol_sys(boostpulse_duration);
 show_store_gov_pol_sys(io_is_busy);
 show_store_gov_pol_sys(use_sched_load);
 show_store_gov_pol_sys(use_migration_notif);
+show_store_gov_pol_sys(use_window_notif);
 show_store_gov_pol_sys(max_freq_hysteresis);
 show_store_gov_pol_sys(align_windows);
 show_store_gov_pol_sys(ignore_hispeed_on_notif);
@@ -1473,6 +1563,7 @@ gov_sys_pol_attr_rw(boostpulse_duration);
 gov_sys_pol_attr_rw(io_is_busy);
 gov_sys_pol_attr_rw(use_sched_load);
 gov_sys_pol_attr_rw(use_migration_notif);
+gov_sys_pol_attr_rw(use_window_notif);
 gov_sys_pol_attr_rw(max_freq_hysteresis);
 gov_sys_pol_attr_rw(align_windows);
 gov_sys_pol_attr_rw(ignore_hispeed_on_notif);
@@ -1500,6 +1591,7 @@ static struct attribute *interactive_attributes_gov_sys[] = {
 	&io_is_busy_gov_sys.attr,
 	&use_sched_load_gov_sys.attr,
 	&use_migration_notif_gov_sys.attr,
+	&use_window_notif_gov_sys.attr,
 	&max_freq_hysteresis_gov_sys.attr,
 	&align_windows_gov_sys.attr,
 	&ignore_hispeed_on_notif_gov_sys.attr,
@@ -1528,6 +1620,7 @@ static struct attribute *interactive_attributes_gov_pol[] = {
 	&io_is_busy_gov_pol.attr,
 	&use_sched_load_gov_pol.attr,
 	&use_migration_notif_gov_pol.attr,
+	&use_window_notif_gov_pol.attr,
 	&max_freq_hysteresis_gov_pol.attr,
 	&align_windows_gov_pol.attr,
 	&ignore_hispeed_on_notif_gov_pol.attr,
@@ -22,6 +22,7 @@
 #include <linux/seq_file.h>
 #include <linux/slab.h>
 #include <linux/sort.h>
+#include <uapi/linux/uid_time_in_state.h>
 
 #define UID_HASH_BITS 10
 
@@ -30,15 +31,20 @@ DECLARE_HASHTABLE(uid_hash_table, UID_HASH_BITS);
 static spinlock_t cpufreq_stats_lock;
 
 static DEFINE_SPINLOCK(task_time_in_state_lock); /* task->time_in_state */
-static DEFINE_RT_MUTEX(uid_lock); /* uid_hash_table */
+static DEFINE_SPINLOCK(uid_lock); /* uid_hash_table updates */
 
+/*
+ * Per-uid time in state, accumulated from the tick into per-cpu counters.
+ * Lookups are done under rcu, so neither the tick nor the readers take a
+ * lock, and uids removed through remove_uid_range are freed after a grace
+ * period.
+ */
 struct uid_entry {
 	uid_t uid;
-	unsigned int dead_max_states;
-	unsigned int alive_max_states;
-	u64 *dead_time_in_state;
-	u64 *alive_time_in_state;
+	unsigned int max_states;
+	u64 __percpu *time_in_state;
 	struct hlist_node hash;
+	struct rcu_head rcu;
 };
 
 struct cpufreq_stats {
@@ -85,44 +91,97 @@ struct cpufreq_stats_attribute {
 	ssize_t(*show) (struct cpufreq_stats *, char *);
 };
 
-/* Caller must hold uid lock */
 static struct uid_entry *find_uid_entry(uid_t uid)
 {
 	struct uid_entry *uid_entry;
 
-	hash_for_each_possible(uid_hash_table, uid_entry, hash, uid) {
+	hash_for_each_possible_rcu(uid_hash_table, uid_entry, hash, uid) {
 		if (uid_entry->uid == uid)
 			return uid_entry;
 	}
 	return NULL;
 }
 
-/* Caller must hold uid lock */
+static void uid_entry_free(struct rcu_head *rcu)
+{
+	struct uid_entry *uid_entry = container_of(rcu, struct uid_entry, rcu);
+
+	free_percpu(uid_entry->time_in_state);
+	kfree(uid_entry);
+}
+
+/*
+ * Called from the tick with the rcu read lock held. A uid seen for the
+ * first time is allocated atomically; its first tick is dropped if that
+ * fails.
+ */
 static struct uid_entry *find_or_register_uid(uid_t uid)
 {
-	struct uid_entry *uid_entry;
+	struct uid_entry *uid_entry, *new_entry;
+	unsigned long flags;
 
 	uid_entry = find_uid_entry(uid);
 	if (uid_entry)
 		return uid_entry;
 
-	uid_entry = kzalloc(sizeof(struct uid_entry), GFP_ATOMIC);
-	if (!uid_entry)
+	new_entry = kzalloc(sizeof(struct uid_entry), GFP_ATOMIC);
+	if (!new_entry)
+		return NULL;
+
+	new_entry->uid = uid;
+	new_entry->max_states = all_freq_table->table_size;
+	new_entry->time_in_state = __alloc_percpu_gfp(new_entry->max_states *
+		sizeof(u64), sizeof(u64), GFP_ATOMIC);
+	if (!new_entry->time_in_state) {
+		kfree(new_entry);
 		return NULL;
+	}
 
-	uid_entry->uid = uid;
+	spin_lock_irqsave(&uid_lock, flags);
+	uid_entry = find_uid_entry(uid);
+	if (!uid_entry) {
+		hash_add_rcu(uid_hash_table, &new_entry->hash, uid);
+		uid_entry = new_entry;
+		new_entry = NULL;
+	}
+	spin_unlock_irqrestore(&uid_lock, flags);
 
-	hash_add(uid_hash_table, &uid_entry->hash, uid);
+	if (new_entry) {
+		free_percpu(new_entry->time_in_state);
+		kfree(new_entry);
+	}
 
 	return uid_entry;
 }
 
+static u64 uid_time_in_state_sum(struct uid_entry *uid_entry, int i)
+{
+	u64 total = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		total += per_cpu_ptr(uid_entry->time_in_state, cpu)[i];
+
+	return total;
+}
+
+static void uid_time_in_state_add(struct task_struct *task, int index,
+				  cputime_t cputime)
+{
+	struct uid_entry *uid_entry;
+
+	rcu_read_lock();
+	uid_entry = find_or_register_uid(from_kuid_munged(current_user_ns(),
+		task_uid(task)));
+	if (uid_entry && index < uid_entry->max_states)
+		this_cpu_add(uid_entry->time_in_state[index], (u64)cputime);
+	rcu_read_unlock();
+}
 
 static int uid_time_in_state_show(struct seq_file *m, void *v)
 {
 	struct uid_entry *uid_entry;
-	struct task_struct *task, *temp;
-	unsigned long bkt, flags;
+	unsigned long bkt;
 	int i;
 
 	if (!all_freq_table || !cpufreq_all_freq_init)
@@ -133,77 +192,89 @@ static int uid_time_in_state_show(struct seq_file *m, void *v)
 		seq_printf(m, " %d", all_freq_table->freq_table[i]);
 	seq_putc(m, '\n');
 
-	rt_mutex_lock(&uid_lock);
-
 	rcu_read_lock();
-	do_each_thread(temp, task) {
+	hash_for_each_rcu(uid_hash_table, bkt, uid_entry, hash) {
+		seq_printf(m, "%d:", uid_entry->uid);
+		for (i = 0; i < uid_entry->max_states; ++i)
+			seq_printf(m, " %lu", (unsigned long)cputime64_to_clock_t(
+				uid_time_in_state_sum(uid_entry, i)));
+		seq_putc(m, '\n');
+	}
+	rcu_read_unlock();
 
-		uid_entry = find_or_register_uid(from_kuid_munged(
-			current_user_ns(), task_uid(task)));
-		if (!uid_entry)
-			continue;
+	return 0;
+}
 
-		if (uid_entry->alive_max_states < task->max_states) {
-			uid_entry->alive_time_in_state = krealloc(
-				uid_entry->alive_time_in_state,
-				task->max_states *
-				sizeof(uid_entry->alive_time_in_state[0]),
-				GFP_ATOMIC);
-			memset(uid_entry->alive_time_in_state +
-				uid_entry->alive_max_states,
-				0, (task->max_states -
-				uid_entry->alive_max_states) *
-				sizeof(uid_entry->alive_time_in_state[0]));
-			uid_entry->alive_max_states = task->max_states;
-		}
+/*
+ * The binary file is generated one hash bucket at a time, so that a read
+ * never needs a buffer for the whole table. Position 0 is the header.
+ */
+static void *uid_time_in_state_bin_start(struct seq_file *m, loff_t *pos)
+{
+	rcu_read_lock();
+	if (!all_freq_table || !cpufreq_all_freq_init)
+		return NULL;
+	if (!*pos)
+		return SEQ_START_TOKEN;
+	if (*pos > HASH_SIZE(uid_hash_table))
+		return NULL;
+	return &uid_hash_table[*pos - 1];
+}
 
-		spin_lock_irqsave(&task_time_in_state_lock, flags);
-		if (task->time_in_state) {
-			for (i = 0; i < task->max_states; ++i) {
-				uid_entry->alive_time_in_state[i] +=
-					atomic_read(&task->time_in_state[i]);
-			}
-		}
-		spin_unlock_irqrestore(&task_time_in_state_lock, flags);
+static void *uid_time_in_state_bin_next(struct seq_file *m, void *v,
+					loff_t *pos)
+{
+	++*pos;
+	if (*pos > HASH_SIZE(uid_hash_table))
+		return NULL;
+	return &uid_hash_table[*pos - 1];
+}
 
-	} while_each_thread(temp, task);
+static void uid_time_in_state_bin_stop(struct seq_file *m, void *v)
+{
 	rcu_read_unlock();
+}
+
+static int uid_time_in_state_bin_show(struct seq_file *m, void *v)
+{
+	struct uid_entry *uid_entry;
+	struct uid_tis_record rec = { };
+	u64 time;
+	int i;
 
-	hash_for_each(uid_hash_table, bkt, uid_entry, hash) {
-		int max_states = uid_entry->dead_max_states;
+	if (v == SEQ_START_TOKEN) {
+		struct uid_tis_header hdr = {
+			.version = UID_TIS_VERSION,
+			.nr_freqs = all_freq_table->table_size,
+		};
 
-		if (uid_entry->alive_max_states > max_states)
-			max_states = uid_entry->alive_max_states;
-		if (max_states)
-			seq_printf(m, "%d:", uid_entry->uid);
-		for (i = 0; i < max_states; ++i) {
-			u64 total_time_in_state = 0;
+		seq_write(m, &hdr, sizeof(hdr));
+		seq_write(m, all_freq_table->freq_table,
+			hdr.nr_freqs * sizeof(all_freq_table->freq_table[0]));
+		return 0;
+	}
 
-			if (uid_entry->dead_time_in_state &&
-				i < uid_entry->dead_max_states) {
-				total_time_in_state =
-					uid_entry->dead_time_in_state[i];
-			}
-			if (uid_entry->alive_time_in_state &&
-				i < uid_entry->alive_max_states) {
-				total_time_in_state +=
-					uid_entry->alive_time_in_state[i];
-			}
-			seq_printf(m, " %lu", (unsigned long)
-				cputime_to_clock_t(total_time_in_state));
+	hlist_for_each_entry_rcu(uid_entry, (struct hlist_head *)v, hash) {
+		rec.uid = uid_entry->uid;
+		seq_write(m, &rec, sizeof(rec));
+		for (i = 0; i < all_freq_table->table_size; ++i) {
+			time = (i < uid_entry->max_states) ?
+				cputime64_to_clock_t(
+				uid_time_in_state_sum(uid_entry, i)) : 0;
+			seq_write(m, &time, sizeof(time));
 		}
-		if (max_states)
-			seq_putc(m, '\n');
-
-		kfree(uid_entry->alive_time_in_state);
-		uid_entry->alive_time_in_state = NULL;
-		uid_entry->alive_max_states = 0;
 	}
 
-	rt_mutex_unlock(&uid_lock);
 	return 0;
 }
 
+static const struct seq_operations uid_time_in_state_bin_seq_ops = {
+	.start	= uid_time_in_state_bin_start,
+	.next	= uid_time_in_state_bin_next,
+	.stop	= uid_time_in_state_bin_stop,
+	.show	= uid_time_in_state_bin_show,
+};
+
 static int cpufreq_stats_update(unsigned int cpu)
 {
 	struct cpufreq_stats *stat;
@@ -354,6 +425,8 @@ void acct_update_power(struct task_struct *task, cputime_t cputime) {
 				&task->time_in_state[all_freq_i]);
 		}
 		spin_unlock_irqrestore(&task_time_in_state_lock, flags);
+
+		uid_time_in_state_add(task, all_freq_i, cputime);
 	}
 
 	powerstats = per_cpu(cpufreq_power_stats, cpu_num);
@@ -819,21 +892,19 @@ void cpufreq_task_stats_remove_uids(uid_t uid_start, uid_t uid_end)
 {
 	struct uid_entry *uid_entry;
 	struct hlist_node *tmp;
-
-	rt_mutex_lock(&uid_lock);
+	unsigned long flags;
 
 	for (; uid_start <= uid_end; uid_start++) {
+		spin_lock_irqsave(&uid_lock, flags);
 		hash_for_each_possible_safe(uid_hash_table, uid_entry, tmp,
 			hash, uid_start) {
 			if (uid_start == uid_entry->uid) {
-				hash_del(&uid_entry->hash);
-				kfree(uid_entry->dead_time_in_state);
-				kfree(uid_entry);
+				hash_del_rcu(&uid_entry->hash);
+				call_rcu(&uid_entry->rcu, uid_entry_free);
 			}
 		}
+		spin_unlock_irqrestore(&uid_lock, flags);
 	}
-
-	rt_mutex_unlock(&uid_lock);
 }
 
 static int cpufreq_stat_notifier_policy(struct notifier_block *nb,
@@ -933,50 +1004,18 @@ static int process_notifier(struct notifier_block *self,
 			unsigned long cmd, void *v)
 {
 	struct task_struct *task = v;
-	struct uid_entry *uid_entry;
 	unsigned long flags;
 	void *temp;
-	uid_t uid;
-	int i;
 
 	if (!task)
 		return NOTIFY_OK;
 
-	rt_mutex_lock(&uid_lock);
-
-	uid = from_kuid_munged(current_user_ns(), task_uid(task));
-	uid_entry = find_or_register_uid(uid);
-	if (!uid_entry) {
-		rt_mutex_unlock(&uid_lock);
-		pr_err("%s: failed to find/register uid %d\n", __func__, uid);
-		return NOTIFY_OK;
-	}
-
-	if (uid_entry->dead_max_states < task->max_states) {
-		uid_entry->dead_time_in_state = krealloc(
-			uid_entry->dead_time_in_state,
-			task->max_states *
-			sizeof(uid_entry->dead_time_in_state[0]),
-			GFP_ATOMIC);
-		memset(uid_entry->dead_time_in_state +
-			uid_entry->dead_max_states,
-			0, (task->max_states - uid_entry->dead_max_states) *
-			sizeof(uid_entry->dead_time_in_state[0]));
-		uid_entry->dead_max_states = task->max_states;
-	}
-
+	/* The uid totals already include this task's time */
 	spin_lock_irqsave(&task_time_in_state_lock, flags);
-	if (task->time_in_state) {
-		for (i = 0; i < task->max_states; ++i) {
-			uid_entry->dead_time_in_state[i] +=
-				atomic_read(&task->time_in_state[i]);
-		}
-	}
 	temp = task->time_in_state;
 	task->time_in_state = NULL;
 	spin_unlock_irqrestore(&task_time_in_state_lock, flags);
 
-	rt_mutex_unlock(&uid_lock);
 	kfree(temp);
 	return NOTIFY_OK;
 }
@@ -993,6 +1032,18 @@ static const struct file_operations uid_time_in_state_fops = {
 	.release	= single_release,
 };
 
+static int uid_time_in_state_bin_open(struct inode *inode, struct file *file)
+{
+	return seq_open(file, &uid_time_in_state_bin_seq_ops);
+}
+
+static const struct file_operations uid_time_in_state_bin_fops = {
+	.open		= uid_time_in_state_bin_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= seq_release,
+};
+
 static struct notifier_block notifier_policy_block = {
 	.notifier_call = cpufreq_stat_notifier_policy
 };
@@ -1055,6 +1106,8 @@ static int __init cpufreq_stats_init(void)
 
 	proc_create_data("uid_time_in_state", 0444, NULL,
 		&uid_time_in_state_fops, NULL);
+	proc_create_data("uid_time_in_state_bin", 0444, NULL,
+		&uid_time_in_state_bin_fops, NULL);
 
 	profile_event_register(PROFILE_TASK_EXIT, &process_notifier_block);
 
@@ -35,6 +35,8 @@
 #include <linux/moduleparam.h>
 #include <linux/sched.h>
 #include <linux/cpu_pm.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 #include <soc/qcom/spm.h>
 #include <soc/qcom/pm.h>
 #include <soc/qcom/rpm-notifier.h>
@@ -444,6 +446,309 @@ static int set_device_mode(struct lpm_cluster *cluster, int ndevice,
 		return -EINVAL;
 }
 
+/*
+ * Sleep length prediction
+ *
+ * The next timer event does not account for IRQ driven wakeups, so a CPU
+ * or cluster that keeps being woken up early by e.g. the modem would pick
+ * a deep mode on every sleep and pay its exit latency for nothing. Track
+ * the last MAXSAMPLES residencies and, when they are consistent, use
+ * their average as the expected sleep length. When they are not, but a
+ * mode was repeatedly exited before reaching its minimum residency,
+ * restrict the selection to the modes shallower than that one.
+ */
+static bool lpm_prediction = true;
+module_param_named(lpm_prediction, lpm_prediction, bool,
+	S_IRUGO | S_IWUSR | S_IWGRP);
+
+static uint32_t ref_stddev = 500;
+module_param_named(ref_stddev, ref_stddev, uint, S_IRUGO | S_IWUSR | S_IWGRP);
+
+static uint32_t tmr_add = 100;
+module_param_named(tmr_add, tmr_add, uint, S_IRUGO | S_IWUSR | S_IWGRP);
+
+static uint32_t ref_premature_cnt = 3;
+module_param_named(ref_premature_cnt, ref_premature_cnt, uint,
+	S_IRUGO | S_IWUSR | S_IWGRP);
+
+static DEFINE_PER_CPU(struct lpm_history, hist);
+static DEFINE_PER_CPU(struct lpm_pred_stats, cpu_pred_stats);
+static DEFINE_PER_CPU(struct hrtimer, histtimer);
+
+/*
+ * Minimum residency of a level: the sleep length from which it is
+ * preferred over the next shallower enabled level.
+ */
+static uint32_t cpu_min_residency(uint32_t *residency, int idx)
+{
+	int i;
+
+	for (i = idx - 1; i >= 0; i--)
+		if (residency[i])
+			return residency[i];
+
+	return 0;
+}
+
+static uint32_t cluster_min_residency(struct lpm_cluster *cluster, int idx)
+{
+	int i;
+
+	for (i = idx - 1; i >= 0; i--)
+		if (cluster->levels[i].pwr.max_residency)
+			return cluster->levels[i].pwr.max_residency;
+
+	return 0;
+}
+
+/*
+ * Returns the predicted sleep length in us, or 0 if the history is not
+ * consistent enough. In the latter case *idx_restrict is set to the
+ * shallowest mode that was repeatedly exited early, if there is one.
+ */
+static uint32_t lpm_history_predict(struct lpm_history *history,
+		const uint32_t *min_residency, int nlevels, int *idx_restrict,
+		uint32_t *idx_restrict_time)
+{
+	uint64_t avg, stddev, total;
+	uint32_t thresh = UINT_MAX, max, value;
+	int64_t diff;
+	int i, j, divisor, failed;
+
+	if (!lpm_prediction || history->nsamp < MAXSAMPLES)
+		return 0;
+
+again:
+	max = avg = divisor = stddev = 0;
+	for (i = 0; i < MAXSAMPLES; i++) {
+		value = history->resi[i];
+		if (value <= thresh) {
+			avg += value;
+			divisor++;
+			if (value > max)
+				max = value;
+		}
+	}
+	do_div(avg, divisor);
+
+	for (i = 0; i < MAXSAMPLES; i++) {
+		value = history->resi[i];
+		if (value <= thresh) {
+			diff = value - avg;
+			stddev += diff * diff;
+		}
+	}
+	do_div(stddev, divisor);
+	stddev = int_sqrt(stddev);
+
+	/*
+	 * Use the average when the samples are close to each other, or
+	 * retry without the longest sample, which is most likely a one off
+	 * timer driven wakeup among IRQ driven ones.
+	 */
+	if (((avg > stddev * 6) && (divisor >= (MAXSAMPLES - 1)))
+			|| stddev <= ref_stddev)
+		return avg;
+	else if (divisor > (MAXSAMPLES - 1)) {
+		thresh = max - 1;
+		goto again;
+	}
+
+	/* Find the shallowest mode that keeps getting exited early */
+	for (j = 1; j < nlevels; j++) {
+		failed = 0;
+		total = 0;
+		for (i = 0; i < MAXSAMPLES; i++) {
+			if (history->mode[i] == j &&
+				history->resi[i] < min_residency[j]) {
+				failed++;
+				total += history->resi[i];
+			}
+		}
+		if (failed && failed >= ref_premature_cnt) {
+			*idx_restrict = j;
+			do_div(total, failed);
+			*idx_restrict_time = total;
+			break;
+		}
+	}
+
+	return 0;
+}
+
+static void lpm_history_update(struct lpm_history *history,
+		struct lpm_pred_stats *stats, uint32_t residency, int idx,
+		uint32_t min_residency)
+{
+	uint32_t predicted = history->predicted;
+
+	history->predicted = 0;
+	if (!lpm_prediction)
+		return;
+
+	/*
+	 * A wakeup forced by the history timer is not a real sleep, merge
+	 * it with the one that follows.
+	 */
+	if (history->htmr_wkup) {
+		if (!history->hptr)
+			history->hptr = MAXSAMPLES - 1;
+		else
+			history->hptr--;
+		history->resi[history->hptr] += residency;
+		history->htmr_wkup = 0;
+	} else {
+		history->resi[history->hptr] = residency;
+	}
+	history->mode[history->hptr] = idx;
+
+	if (history->nsamp < MAXSAMPLES)
+		history->nsamp++;
+	if (++history->hptr >= MAXSAMPLES)
+		history->hptr = 0;
+
+	if (predicted) {
+		stats->nr_predicted++;
+		stats->predicted_us += predicted;
+		stats->actual_us += residency;
+		stats->error_us += abs64((int64_t)predicted - residency);
+	}
+
+	if (idx > 0 && idx < NR_LPM_LEVELS && residency < min_residency) {
+		stats->nr_early_exit[idx]++;
+		stats->early_exit_us[idx] += min_residency - residency;
+	}
+}
+
+static void invalidate_predict_history(struct lpm_history *history)
+{
+	if (!lpm_prediction)
+		return;
+
+	if (history->hinvalid) {
+		history->hinvalid = 0;
+		history->htmr_wkup = 1;
+	}
+}
+
+static void clear_cluster_history(struct lpm_cluster *cluster, bool stats)
+{
+	struct lpm_cluster *child;
+
+	spin_lock(&cluster->sync_lock);
+	memset(&cluster->history, 0, sizeof(cluster->history));
+	if (stats)
+		memset(&cluster->pred_stats, 0, sizeof(cluster->pred_stats));
+	spin_unlock(&cluster->sync_lock);
+
+	if (cluster->cpu)
+		return;
+
+	list_for_each_entry(child, &cluster->child, list)
+		clear_cluster_history(child, stats);
+}
+
+static enum hrtimer_restart histtimer_fn(struct hrtimer *h)
+{
+	int cpu = raw_smp_processor_id();
+
+	per_cpu(hist, cpu).hinvalid = 1;
+	per_cpu(cpu_pred_stats, cpu).nr_tmr_wkup++;
+
+	return HRTIMER_NORESTART;
+}
+
+static void histtimer_start(uint32_t time_us)
+{
+	ktime_t hist_ktime = ns_to_ktime((u64)time_us * NSEC_PER_USEC);
+	struct hrtimer *cpu_histtimer = this_cpu_ptr(&histtimer);
+
+	hrtimer_start(cpu_histtimer, hist_ktime, HRTIMER_MODE_REL_PINNED);
+}
+
+static void histtimer_cancel(void)
+{
+	struct hrtimer *cpu_histtimer = this_cpu_ptr(&histtimer);
+
+	hrtimer_try_to_cancel(cpu_histtimer);
+}
+
+static void lpm_pred_stats_print(struct seq_file *m, const char *name,
+		struct lpm_pred_stats *stats)
+{
+	int i;
+
+	seq_printf(m, "%s %llu %llu %llu %llu %llu %llu", name,
+		stats->nr_predicted, stats->predicted_us, stats->actual_us,
+		stats->error_us, stats->nr_restricted, stats->nr_tmr_wkup);
+	for (i = 1; i < NR_LPM_LEVELS; i++)
+		seq_printf(m, " %llu/%llu", stats->nr_early_exit[i],
+			stats->early_exit_us[i]);
+	seq_puts(m, "\n");
+}
+
+static void lpm_pred_stats_show_cluster(struct seq_file *m,
+		struct lpm_cluster *cluster)
+{
+	struct lpm_cluster *child;
+
+	lpm_pred_stats_print(m, cluster->cluster_name, &cluster->pred_stats);
+
+	if (cluster->cpu)
+		return;
+
+	list_for_each_entry(child, &cluster->child, list)
+		lpm_pred_stats_show_cluster(m, child);
+}
+
+static int lpm_pred_stats_show(struct seq_file *m, void *v)
+{
+	char name[8];
+	int cpu;
+
+	seq_puts(m, "name predicted predicted_us actual_us error_us restricted tmr_wkup early_exit/penalty_us[1..]\n");
+	for_each_possible_cpu(cpu) {
+		snprintf(name, sizeof(name), "cpu%d", cpu);
+		lpm_pred_stats_print(m, name, &per_cpu(cpu_pred_stats, cpu));
+	}
+
+	if (lpm_root_node)
+		lpm_pred_stats_show_cluster(m, lpm_root_node);
+
+	return 0;
+}
+
+static int lpm_pred_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, lpm_pred_stats_show, inode->i_private);
+}
+
+static ssize_t lpm_pred_stats_write(struct file *file,
+		const char __user *buf, size_t count, loff_t *ppos)
+{
+	int cpu;
+
+	/* Any write resets the statistics along with the history */
+	for_each_possible_cpu(cpu) {
+		memset(&per_cpu(cpu_pred_stats, cpu), 0,
+				sizeof(struct lpm_pred_stats));
+		memset(&per_cpu(hist, cpu), 0, sizeof(struct lpm_history));
+	}
+
+	if (lpm_root_node)
+		clear_cluster_history(lpm_root_node, true);
+
+	return count;
+}
+
+static const struct file_operations lpm_pred_stats_fops = {
+	.open = lpm_pred_stats_open,
+	.read = seq_read,
+	.write = lpm_pred_stats_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 static int cpu_power_select(struct cpuidle_device *dev,
 		struct lpm_cpu *cpu)
 {
@@ -456,6 +761,11 @@ static int cpu_power_select(struct cpuidle_device *dev,
 	int i;
 	uint32_t lvl_latency_us = 0;
 	uint32_t *residency = get_per_cpu_max_residency(dev->cpu);
+	struct lpm_history *history = &per_cpu(hist, dev->cpu);
+	uint32_t min_residency[NR_LPM_LEVELS];
+	uint32_t predicted = 0, expected_us, htime;
+	uint32_t idx_restrict_time = 0;
+	int idx_restrict;
 
 	if (!cpu)
 		return -EINVAL;
@@ -465,6 +775,22 @@ static int cpu_power_select(struct cpuidle_device *dev,
 
 	next_event_us = (uint32_t)(ktime_to_us(get_next_event_time(dev->cpu)));
 
+	/*
+	 * Only predict when the next timer event would allow for something
+	 * deeper than the shallowest mode, and not right after a wakeup
+	 * forced by the history timer.
+	 */
+	idx_restrict = cpu->nlevels + 1;
+	if (history->hinvalid || sleep_us <= residency[0]) {
+		invalidate_predict_history(history);
+	} else {
+		for (i = 0; i < cpu->nlevels; i++)
+			min_residency[i] = cpu_min_residency(residency, i);
+		predicted = lpm_history_predict(history, min_residency,
+				cpu->nlevels, &idx_restrict,
+				&idx_restrict_time);
+	}
+
 	for (i = 0; i < cpu->nlevels; i++) {
 		struct lpm_cpu_level *level = &cpu->levels[i];
 		struct power_params *pwr_params = &level->pwr;
@@ -491,6 +817,9 @@ static int cpu_power_select(struct cpuidle_device *dev,
 				next_wakeup_us = next_event_us - lvl_latency_us;
 		}
 
+		if (i >= idx_restrict)
+			break;
+
 		best_level = i;
 
 		if (next_event_us && next_event_us < sleep_us &&
@@ -500,13 +829,35 @@ static int cpu_power_select(struct cpuidle_device *dev,
 		else
 			modified_time_us = 0;
 
-		if (next_wakeup_us <= residency[i])
+		expected_us = predicted ? min(predicted, next_wakeup_us) :
+						next_wakeup_us;
+		if (expected_us <= residency[i])
 			break;
 	}
 
 	if (modified_time_us)
 		msm_pm_set_timer(modified_time_us);
 
+	/*
+	 * If the history made us pick a shallower mode than the timers
+	 * allow, make sure a wrong prediction does not keep the CPU there
+	 * for the whole sleep.
+	 */
+	if (best_level >= 0 && (predicted || idx_restrict <= cpu->nlevels)
+			&& best_level < cpu->nlevels - 1) {
+		if (!predicted) {
+			per_cpu(cpu_pred_stats, dev->cpu).nr_restricted++;
+			htime = idx_restrict_time + tmr_add;
+		} else {
+			history->predicted = predicted;
+			htime = min(predicted + tmr_add, residency[best_level]);
+		}
+
+		if (sleep_us > htime &&
+			(sleep_us - htime) > residency[best_level])
+			histtimer_start(htime);
+	}
+
 	trace_cpu_power_select(best_level, sleep_us, latency_us, next_event_us);
 
 	return best_level;
@@ -561,12 +912,28 @@ static int cluster_select(struct lpm_cluster *cluster, bool from_idle)
 	struct cpumask mask;
 	uint32_t latency_us = ~0U;
 	uint32_t sleep_us;
+	uint32_t min_residency[NR_LPM_LEVELS];
+	uint32_t predicted = 0, idx_restrict_time = 0;
+	int idx_restrict = cluster ? cluster->nlevels + 1 : 0;
 
 	if (!cluster)
 		return -EINVAL;
 
 	sleep_us = (uint32_t)get_cluster_sleep_time(cluster, NULL, from_idle);
 
+	if (from_idle) {
+		for (i = 0; i < cluster->nlevels; i++)
+			min_residency[i] = cluster_min_residency(cluster, i);
+		predicted = lpm_history_predict(&cluster->history,
+				min_residency, cluster->nlevels,
+				&idx_restrict, &idx_restrict_time);
+		if (predicted && predicted < sleep_us)
+			sleep_us = predicted;
+		else if (!predicted && idx_restrict <= cluster->nlevels)
+			cluster->pred_stats.nr_restricted++;
+		cluster->history.predicted = predicted;
+	}
+
 	if (cpumask_and(&mask, cpu_online_mask, &cluster->child_cpus))
 		latency_us = pm_qos_request_for_cpumask(PM_QOS_CPU_DMA_LATENCY,
 							&mask);
@@ -609,6 +976,9 @@ static int cluster_select(struct lpm_cluster *cluster, bool from_idle)
 		if (level->notify_rpm && msm_rpm_waiting_for_ack())
 			continue;
 
+		if (from_idle && i >= idx_restrict)
+			break;
+
 		best_level = i;
 
 		if (from_idle && sleep_us <= pwr_params->max_residency)
@@ -792,9 +1162,18 @@ static void cluster_unprepare(struct lpm_cluster *cluster,
 	if (!first_cpu || cluster->last_level == cluster->default_level)
 		goto unlock_return;
 
-	if (cluster->stats->sleep_time)
+	if (cluster->stats->sleep_time) {
 		cluster->stats->sleep_time = end_time -
 			cluster->stats->sleep_time;
+		if (from_idle)
+			lpm_history_update(&cluster->history,
+				&cluster->pred_stats,
+				div_u64(cluster->stats->sleep_time,
+					NSEC_PER_USEC),
+				cluster->last_level,
+				cluster_min_residency(cluster,
+					cluster->last_level));
+	}
 	lpm_stats_cluster_exit(cluster->stats, cluster->last_level, true);
 
 	level = &cluster->levels[cluster->last_level];
@@ -1076,6 +1455,7 @@ static int lpm_cpuidle_enter(struct cpuidle_device *dev,
 exit:
 	end_time = ktime_to_ns(ktime_get());
 	lpm_stats_cpu_exit(idx, end_time, success);
+	histtimer_cancel();
 
 	if (idx > 0 && cpu_clk && l2_clk)
 		trace_cpu_idle_exit_cpu_freq(dev->cpu, clk_get_rate(cpu_clk),
@@ -1087,7 +1467,11 @@ exit:
 	sched_set_cpu_cstate(smp_processor_id(), 0, 0, 0);
 	trace_cpu_idle_exit(idx, success);
 	end_time = ktime_to_ns(ktime_get()) - start_time;
-	dev->last_residency = do_div(end_time, 1000);
+	do_div(end_time, 1000);
+	dev->last_residency = end_time;
+	lpm_history_update(&per_cpu(hist, dev->cpu),
+		&per_cpu(cpu_pred_stats, dev->cpu), dev->last_residency, idx,
+		cpu_min_residency(get_per_cpu_max_residency(dev->cpu), idx));
 	local_irq_enable();
 
 	return idx;
@@ -1367,6 +1751,8 @@ static int lpm_probe(struct platform_device *pdev)
 {
 	int ret;
 	int size;
+	unsigned int cpu;
+	struct hrtimer *cpu_histtimer;
 	struct kobject *module_kobj = NULL;
 
 	get_online_cpus();
@@ -1392,6 +1778,11 @@ static int lpm_probe(struct platform_device *pdev)
 	put_cpu();
 	suspend_set_ops(&lpm_suspend_ops);
 	hrtimer_init(&lpm_hrtimer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	for_each_possible_cpu(cpu) {
+		cpu_histtimer = &per_cpu(histtimer, cpu);
+		hrtimer_init(cpu_histtimer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+		cpu_histtimer->function = histtimer_fn;
+	}
 	lpm_clk_init(pdev);
 
 	ret = remote_spin_lock_init(&scm_handoff_lock, SCM_HANDOFF_LOCK_ID);
@@ -1430,6 +1821,9 @@ static int lpm_probe(struct platform_device *pdev)
 		goto failed;
 	}
 
+	debugfs_create_file("lpm_prediction_stats", S_IRUGO | S_IWUSR, NULL,
+			NULL, &lpm_pred_stats_fops);
+
 	return 0;
 failed:
 	free_cluster_node(lpm_root_node);
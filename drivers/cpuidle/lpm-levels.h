@@ -14,6 +14,7 @@
 #include <soc/qcom/spm.h>
 
 #define NR_LPM_LEVELS 8
+#define MAXSAMPLES 5
 
 extern bool use_psci;
 
@@ -31,6 +32,29 @@ struct power_params {
 	uint32_t max_residency;
 };
 
+/* Recent residencies used to predict the next sleep length */
+struct lpm_history {
+	uint32_t resi[MAXSAMPLES];
+	int mode[MAXSAMPLES];
+	int nsamp;
+	uint32_t hptr;
+	uint32_t hinvalid;
+	uint32_t htmr_wkup;
+	uint32_t predicted;		/* Prediction used for the last sleep */
+};
+
+/* Predicted vs. actual residency statistics, exported via debugfs */
+struct lpm_pred_stats {
+	uint64_t nr_predicted;
+	uint64_t predicted_us;
+	uint64_t actual_us;
+	uint64_t error_us;		/* Sum of |predicted - actual| */
+	uint64_t nr_restricted;
+	uint64_t nr_tmr_wkup;
+	uint64_t nr_early_exit[NR_LPM_LEVELS];
+	uint64_t early_exit_us[NR_LPM_LEVELS];	/* Residency shortfall */
+};
+
 struct lpm_cpu_level {
 	const char *name;
 	enum msm_pm_sleep_mode mode;
@@ -108,6 +132,8 @@ struct lpm_cluster {
 	unsigned int psci_mode_shift;
 	unsigned int psci_mode_mask;
 	bool no_saw_devices;
+	struct lpm_history history;
+	struct lpm_pred_stats pred_stats;
 };
 
 int set_l2_mode(struct low_power_ops *ops, int mode, bool notify_rpm);
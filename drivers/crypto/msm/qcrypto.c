@@ -33,6 +33,8 @@
 #include <linux/platform_data/qcom_crypto_device.h>
 #include <linux/msm-bus.h>
 #include <linux/hardirq.h>
+#include <linux/ktime.h>
+#include <linux/random.h>
 #include <linux/qcrypto.h>
 
 #include <crypto/ctr.h>
@@ -62,6 +64,14 @@
 
 #define QCRYPTO_HIGH_BANDWIDTH_TIMEOUT 1000
 
+/*
+ * Request sizes probed when calibrating the inline AES threshold, and the
+ * number of back to back requests timed at each size.
+ */
+#define QCRYPTO_INLINE_CALIB_MIN	64
+#define QCRYPTO_INLINE_CALIB_MAX	4096
+#define QCRYPTO_INLINE_CALIB_LOOPS	16
+
 
 
 /* Status of response workq */
@@ -108,6 +118,8 @@ struct crypto_stat {
 	u64 aead_bad_msg;
 	u64 ablk_cipher_aes_enc;
 	u64 ablk_cipher_aes_dec;
+	u64 ablk_cipher_aes_inline_enc;
+	u64 ablk_cipher_aes_inline_dec;
 	u64 ablk_cipher_des_enc;
 	u64 ablk_cipher_des_dec;
 	u64 ablk_cipher_3des_enc;
@@ -133,6 +145,8 @@ struct qcrypto_req_control {
 	struct crypto_async_request *req;
 	struct qcrypto_resp_ctx *arsp;
 	int res; /* execution result */
+	ktime_t issue_time;
+	unsigned int nbytes;
 };
 
 struct crypto_engine {
@@ -173,6 +187,13 @@ struct crypto_engine {
 	bool first_engine;	/* this engine is the first engine or not */
 	unsigned int irq_cpu;	/* the cpu running the irq of this engine */
 	unsigned int max_req_used; /* debug stats */
+
+	/* per engine throughput, latency and batching stats */
+	u64 total_bytes;
+	u64 total_lat_ns;
+	u64 max_lat_ns;
+	u64 nr_batch;
+	unsigned int max_batch;
 };
 
 #define MAX_SMP_CPU    8
@@ -230,8 +251,30 @@ struct crypto_priv {
 	unsigned int max_resp_qlen;
 	unsigned int max_reorder_cnt;
 	unsigned int cpu_req[MAX_SMP_CPU+1];
+	ktime_t stats_start;	/* last reset of the debug stats */
+
+	/* spreads tfms over the engines when not statically assigned */
+	atomic_t eng_hint;
+
+	/* inline AES threshold calibration */
+	struct work_struct inline_calib_work;
+	unsigned int inline_calib_size;
+	u64 inline_calib_ce_ns;
+	u64 inline_calib_cpu_ns;
 };
 static struct crypto_priv qcrypto_dev;
+
+/*
+ * AES ecb/cbc/ctr requests of up to this many bytes are run synchronously
+ * on the CPU through the fallback cipher instead of being queued to the
+ * crypto engine, whose bus vote, BAM setup and completion interrupt cost
+ * more than the cipher itself for small requests. -1 calibrates the value
+ * once the first engine is probed, 0 sends everything to the engine.
+ */
+static int _qcrypto_inline_threshold = -1;
+module_param_named(inline_threshold, _qcrypto_inline_threshold, int, 0644);
+MODULE_PARM_DESC(inline_threshold,
+	"Max AES request size in bytes run on the CPU, -1 to calibrate");
 static struct crypto_engine *_qcrypto_static_assign_engine(
 					struct crypto_priv *cp);
 static struct crypto_engine *_avail_eng(struct crypto_priv *cp);
@@ -403,6 +446,7 @@ struct qcrypto_cipher_ctx {
 	struct crypto_engine *pengine;  /* fixed engine assigned to this tfm */
 	struct crypto_priv *cp;
 	unsigned int flags;
+	unsigned int eng_hint;		/* preferred engine of this tfm */
 
 	enum qce_hash_alg_enum  auth_alg; /* for aead */
 	u8 auth_key[QCRYPTO_MAX_KEY_SIZE];
@@ -416,7 +460,12 @@ struct qcrypto_cipher_ctx {
 
 	u8 ccm4309_nonce[QCRYPTO_CCM4309_NONCE_LEN];
 
+	/*
+	 * Software cipher used for AES-192 keys the engine can not handle,
+	 * and for requests small enough to run inline.
+	 */
 	struct crypto_ablkcipher *cipher_aes192_fb;
+	bool inline_key;	/* fallback holds the current key */
 
 	struct crypto_ahash *ahash_aead_aes192_fb;
 };
@@ -490,6 +539,7 @@ struct qcrypto_sha_ctx {
 	struct crypto_engine *pengine;  /* fixed engine assigned to this tfm */
 	struct crypto_priv *cp;
 	unsigned int flags;
+	unsigned int eng_hint;		/* preferred engine of this tfm */
 	enum qce_hash_alg_enum  alg;
 	uint32_t		diglen;
 	uint32_t		authkey_in_len;
@@ -834,6 +884,7 @@ static int _qcrypto_cipher_cra_init(struct crypto_tfm *tfm)
 			return -ENODEV;
 	} else
 		ctx->pengine = NULL;
+	ctx->eng_hint = atomic_inc_return(&ctx->cp->eng_hint);
 	INIT_LIST_HEAD(&ctx->rsp_queue);
 	ctx->auth_alg = QCE_HASH_LAST;
 	return 0;
@@ -859,6 +910,7 @@ static int _qcrypto_ahash_cra_init(struct crypto_tfm *tfm)
 			return -ENODEV;
 	} else
 		sha_ctx->pengine = NULL;
+	sha_ctx->eng_hint = atomic_inc_return(&sha_ctx->cp->eng_hint);
 	INIT_LIST_HEAD(&sha_ctx->rsp_queue);
 	return 0;
 };
@@ -1087,8 +1139,10 @@ static int _disp_stats(int id)
 	struct crypto_priv *cp = &qcrypto_dev;
 	struct crypto_engine *pe;
 	int i;
+	u64 elapsed_us;
 
 	pstat = &_qcrypto_stat;
+	elapsed_us = ktime_us_delta(ktime_get(), cp->stats_start);
 	len = scnprintf(_debug_read_buf, DEBUG_MAX_RW_BUF - 1,
 			"\nQualcomm crypto accelerator %d Statistics\n",
 				id + 1);
@@ -1099,6 +1153,12 @@ static int _disp_stats(int id)
 	len += scnprintf(_debug_read_buf + len, DEBUG_MAX_RW_BUF - len - 1,
 			"   ABLK CIPHER AES decryption          : %llu\n",
 					pstat->ablk_cipher_aes_dec);
+	len += scnprintf(_debug_read_buf + len, DEBUG_MAX_RW_BUF - len - 1,
+			"   ABLK CIPHER AES inline encryption   : %llu\n",
+					pstat->ablk_cipher_aes_inline_enc);
+	len += scnprintf(_debug_read_buf + len, DEBUG_MAX_RW_BUF - len - 1,
+			"   ABLK CIPHER AES inline decryption   : %llu\n",
+					pstat->ablk_cipher_aes_inline_dec);
 
 	len += scnprintf(_debug_read_buf + len, DEBUG_MAX_RW_BUF - len - 1,
 			"   ABLK CIPHER DES encryption          : %llu\n",
@@ -1220,6 +1280,14 @@ static int _disp_stats(int id)
 					cp->queue_work_eng3,
 					cp->queue_work_not_eng3,
 					cp->queue_work_not_eng3_nz);
+	len += scnprintf(_debug_read_buf + len, DEBUG_MAX_RW_BUF - len - 1,
+			"   inline AES threshold (bytes)        : %d\n",
+					ACCESS_ONCE(_qcrypto_inline_threshold));
+	len += scnprintf(_debug_read_buf + len, DEBUG_MAX_RW_BUF - len - 1,
+			"   inline calib size, CE ns, CPU ns    : %u %llu %llu\n",
+					cp->inline_calib_size,
+					cp->inline_calib_ce_ns,
+					cp->inline_calib_cpu_ns);
 	len += scnprintf(_debug_read_buf + len, DEBUG_MAX_RW_BUF - len - 1,
 			"\n");
 	spin_lock_irqsave(&cp->lock, flags);
@@ -1239,6 +1307,33 @@ static int _disp_stats(int id)
 			pe->unit,
 			pe->err_req
 		);
+		len += scnprintf(
+			_debug_read_buf + len,
+			DEBUG_MAX_RW_BUF - len - 1,
+			"   Engine %4d Bytes, KB/s             : %llu %llu\n",
+			pe->unit,
+			pe->total_bytes,
+			elapsed_us ? div64_u64(pe->total_bytes * 1000,
+						elapsed_us) : 0
+		);
+		len += scnprintf(
+			_debug_read_buf + len,
+			DEBUG_MAX_RW_BUF - len - 1,
+			"   Engine %4d Latency avg, max us     : %llu %llu\n",
+			pe->unit,
+			pe->total_req - pe->err_req ?
+				div64_u64(pe->total_lat_ns, (pe->total_req -
+					pe->err_req) * NSEC_PER_USEC) : 0,
+			div_u64(pe->max_lat_ns, NSEC_PER_USEC)
+		);
+		len += scnprintf(
+			_debug_read_buf + len,
+			DEBUG_MAX_RW_BUF - len - 1,
+			"   Engine %4d Batches, max batch      : %llu %u\n",
+			pe->unit,
+			pe->nr_batch,
+			pe->max_batch
+		);
 		qce_get_driver_stats(pe->qce);
 	}
 	spin_unlock_irqrestore(&cp->lock, flags);
@@ -1364,6 +1459,22 @@ static int _qcrypto_setkey_aes_192_fallback(struct crypto_ablkcipher *cipher,
 	return ret;
 }
 
+static void _qcrypto_setkey_aes_inline(struct crypto_ablkcipher *cipher,
+		const u8 *key, unsigned int len)
+{
+	struct crypto_tfm *tfm = crypto_ablkcipher_tfm(cipher);
+	struct qcrypto_cipher_ctx *ctx = crypto_tfm_ctx(tfm);
+
+	crypto_ablkcipher_clear_flags(ctx->cipher_aes192_fb,
+			CRYPTO_TFM_REQ_MASK);
+	crypto_ablkcipher_set_flags(ctx->cipher_aes192_fb,
+			crypto_ablkcipher_get_flags(cipher) &
+				CRYPTO_TFM_REQ_MASK);
+	/* a key the fallback rejects simply keeps requests on the engine */
+	ctx->inline_key = !crypto_ablkcipher_setkey(ctx->cipher_aes192_fb,
+			key, len);
+}
+
 static int _qcrypto_setkey_aes(struct crypto_ablkcipher *cipher, const u8 *key,
 		unsigned int len)
 {
@@ -1378,6 +1489,7 @@ static int _qcrypto_setkey_aes(struct crypto_ablkcipher *cipher, const u8 *key,
 					&& ctx->cipher_aes192_fb)
 		return _qcrypto_setkey_aes_192_fallback(cipher, key);
 
+	ctx->inline_key = false;
 	if (_qcrypto_check_aes_keylen(cipher, cp, len)) {
 		return -EINVAL;
 	} else {
@@ -1389,6 +1501,8 @@ static int _qcrypto_setkey_aes(struct crypto_ablkcipher *cipher, const u8 *key,
 				pr_err("%s Inavlid key pointer\n", __func__);
 				return -EINVAL;
 			}
+			if (ctx->cipher_aes192_fb)
+				_qcrypto_setkey_aes_inline(cipher, key, len);
 		}
 	}
 	return 0;
@@ -1642,12 +1756,19 @@ static void req_done(struct qcrypto_req_control *pqcrypto_req_control)
 	void *tfm_ctx = NULL;
 	unsigned int cpu;
 	int res;
+	u64 lat;
 
 	pengine = pqcrypto_req_control->pce;
 	cp = pengine->pcp;
 	areq = pqcrypto_req_control->req;
 	arsp = pqcrypto_req_control->arsp;
 	res = pqcrypto_req_control->res;
+	lat = ktime_to_ns(ktime_sub(ktime_get(),
+				pqcrypto_req_control->issue_time));
+	pengine->total_bytes += pqcrypto_req_control->nbytes;
+	pengine->total_lat_ns += lat;
+	if (lat > pengine->max_lat_ns)
+		pengine->max_lat_ns = lat;
 	qcrypto_free_req_control(pengine, pqcrypto_req_control);
 
 	if (areq) {
@@ -2367,6 +2488,8 @@ static int _start_qcrypto_process(struct crypto_priv *cp,
 	struct qcrypto_resp_ctx *arsp;
 	struct qcrypto_req_control *pqcrypto_req_control;
 	unsigned int cpu = MAX_SMP_CPU;
+	unsigned int nbytes;
+	unsigned int batch = 0;
 
 	if (ACCESS_ONCE(cp->ce_req_proc_sts) == STOPPED)
 		return 0;
@@ -2380,12 +2503,17 @@ static int _start_qcrypto_process(struct crypto_priv *cp,
 
 	pstat = &_qcrypto_stat;
 
+	/*
+	 * Keep issuing queued requests until the engine runs out of request
+	 * slots or of work, so that they are chained back to back on the BAM
+	 * pipes and qce can raise one interrupt for the whole batch.
+	 */
 again:
 	spin_lock_irqsave(&cp->lock, flags);
 	if (pengine->issue_req ||
 		atomic_read(&pengine->req_count) >= (pengine->max_req)) {
 		spin_unlock_irqrestore(&cp->lock, flags);
-		return 0;
+		goto done;
 	}
 
 	backlog_eng = crypto_get_backlog(&pengine->req_queue);
@@ -2393,7 +2521,7 @@ again:
 	/* make sure it is in high bandwidth state */
 	if (pengine->bw_state != BUS_HAS_BANDWIDTH) {
 		spin_unlock_irqrestore(&cp->lock, flags);
-		return 0;
+		goto done;
 	}
 
 	/* try to get request from request queue of the engine first */
@@ -2407,14 +2535,14 @@ again:
 		async_req = crypto_dequeue_request(&cp->req_queue);
 		if (!async_req) {
 			spin_unlock_irqrestore(&cp->lock, flags);
-			return 0;
+			goto done;
 		}
 	}
 	pqcrypto_req_control = qcrypto_alloc_req_control(pengine);
 	if (pqcrypto_req_control == NULL) {
 		pr_err("Allocation of request failed\n");
 		spin_unlock_irqrestore(&cp->lock, flags);
-		return 0;
+		goto done;
 	}
 
 	/* add associated rsp entry to tfm response queue */
@@ -2426,6 +2554,7 @@ again:
 			struct ahash_request, base);
 		ahash_rctx = ahash_request_ctx(ahash_req);
 		arsp = &ahash_rctx->rsp_entry;
+		nbytes = ahash_req->nbytes;
 		list_add_tail(
 			&arsp->list,
 			&((struct qcrypto_sha_ctx *)tfm_ctx)
@@ -2436,6 +2565,7 @@ again:
 			struct ablkcipher_request, base);
 		cipher_rctx = ablkcipher_request_ctx(ablkcipher_req);
 		arsp = &cipher_rctx->rsp_entry;
+		nbytes = ablkcipher_req->nbytes;
 		list_add_tail(
 			&arsp->list,
 			&((struct qcrypto_cipher_ctx *)tfm_ctx)
@@ -2447,6 +2577,7 @@ again:
 			struct aead_request, base);
 		cipher_rctx = aead_request_ctx(aead_req);
 		arsp = &cipher_rctx->rsp_entry;
+		nbytes = aead_req->cryptlen;
 		list_add_tail(
 			&arsp->list,
 			&((struct qcrypto_cipher_ctx *)tfm_ctx)
@@ -2459,6 +2590,8 @@ again:
 	pqcrypto_req_control->pce = pengine;
 	pqcrypto_req_control->req = async_req;
 	pqcrypto_req_control->arsp = arsp;
+	pqcrypto_req_control->nbytes = nbytes;
+	pqcrypto_req_control->issue_time = ktime_get();
 	pengine->active_seq++;
 	pengine->check_flag = true;
 
@@ -2505,7 +2638,16 @@ again:
 		_qcrypto_tfm_complete(pengine, type, tfm_ctx, arsp, ret);
 		goto again;
 	};
-	return ret;
+	batch++;
+	goto again;
+
+done:
+	if (batch) {
+		pengine->nr_batch++;
+		if (batch > pengine->max_batch)
+			pengine->max_batch = batch;
+	}
+	return 0;
 }
 
 static inline struct crypto_engine *_next_eng(struct crypto_priv *cp,
@@ -2547,6 +2689,40 @@ static struct crypto_engine *_avail_eng(struct crypto_priv *cp)
 	return q;
 }
 
+static unsigned int _qcrypto_tfm_eng_hint(struct crypto_tfm *tfm)
+{
+	if (crypto_tfm_alg_type(tfm) == CRYPTO_ALG_TYPE_AHASH)
+		return ((struct qcrypto_sha_ctx *)
+				crypto_tfm_ctx(tfm))->eng_hint;
+	return ((struct qcrypto_cipher_ctx *)crypto_tfm_ctx(tfm))->eng_hint;
+}
+
+/*
+ * Prefer the engine the tfm hints at, so that the requests of one tfm stay
+ * on one engine while different tfms spread over all of them, and fall
+ * back to any available engine when it is busy.
+ */
+static struct crypto_engine *_avail_eng_hint(struct crypto_priv *cp,
+					unsigned int hint)
+{
+	/* call this function with spinlock set */
+	struct crypto_engine *p;
+	unsigned int n;
+
+	if (cp->total_units > 1) {
+		n = hint % cp->total_units;
+		list_for_each_entry(p, &cp->engine_list, elist) {
+			if (n--)
+				continue;
+			if (!p->issue_req &&
+				atomic_read(&p->req_count) < p->max_req)
+				return p;
+			break;
+		}
+	}
+	return _avail_eng(cp);
+}
+
 static int _qcrypto_queue_req(struct crypto_priv *cp,
 				struct crypto_engine *pengine,
 				struct crypto_async_request *req)
@@ -2560,7 +2736,7 @@ static int _qcrypto_queue_req(struct crypto_priv *cp,
 		ret = crypto_enqueue_request(&pengine->req_queue, req);
 	} else {
 		ret = crypto_enqueue_request(&cp->req_queue, req);
-		pengine = _avail_eng(cp);
+		pengine = _avail_eng_hint(cp, _qcrypto_tfm_eng_hint(req->tfm));
 		if (cp->req_queue.qlen > cp->max_qlen)
 			cp->max_qlen = cp->req_queue.qlen;
 	}
@@ -2597,6 +2773,18 @@ static int _qcrypto_queue_req(struct crypto_priv *cp,
 	return ret;
 }
 
+static bool _qcrypto_aes_inline(struct qcrypto_cipher_ctx *ctx,
+					unsigned int nbytes)
+{
+	int threshold = ACCESS_ONCE(_qcrypto_inline_threshold);
+
+	if (!ctx->inline_key || threshold <= 0)
+		return false;
+	if (ctx->flags & (QCRYPTO_CTX_USE_HW_KEY | QCRYPTO_CTX_USE_PIPE_KEY))
+		return false;
+	return nbytes <= threshold;
+}
+
 static int _qcrypto_enc_aes_192_fallback(struct ablkcipher_request *req)
 {
 	struct crypto_tfm *tfm =
@@ -2644,6 +2832,11 @@ static int _qcrypto_enc_aes_ecb(struct ablkcipher_request *req)
 				ctx->cipher_aes192_fb)
 		return _qcrypto_enc_aes_192_fallback(req);
 
+	if (_qcrypto_aes_inline(ctx, req->nbytes)) {
+		pstat->ablk_cipher_aes_inline_enc++;
+		return _qcrypto_enc_aes_192_fallback(req);
+	}
+
 	rctx = ablkcipher_request_ctx(req);
 	rctx->aead = 0;
 	rctx->alg = CIPHER_ALG_AES;
@@ -2674,6 +2867,11 @@ static int _qcrypto_enc_aes_cbc(struct ablkcipher_request *req)
 				ctx->cipher_aes192_fb)
 		return _qcrypto_enc_aes_192_fallback(req);
 
+	if (_qcrypto_aes_inline(ctx, req->nbytes)) {
+		pstat->ablk_cipher_aes_inline_enc++;
+		return _qcrypto_enc_aes_192_fallback(req);
+	}
+
 	rctx = ablkcipher_request_ctx(req);
 	rctx->aead = 0;
 	rctx->alg = CIPHER_ALG_AES;
@@ -2704,6 +2902,11 @@ static int _qcrypto_enc_aes_ctr(struct ablkcipher_request *req)
 				ctx->cipher_aes192_fb)
 		return _qcrypto_enc_aes_192_fallback(req);
 
+	if (_qcrypto_aes_inline(ctx, req->nbytes)) {
+		pstat->ablk_cipher_aes_inline_enc++;
+		return _qcrypto_enc_aes_192_fallback(req);
+	}
+
 	rctx = ablkcipher_request_ctx(req);
 	rctx->aead = 0;
 	rctx->alg = CIPHER_ALG_AES;
@@ -2888,6 +3091,11 @@ static int _qcrypto_dec_aes_ecb(struct ablkcipher_request *req)
 				ctx->cipher_aes192_fb)
 		return _qcrypto_dec_aes_192_fallback(req);
 
+	if (_qcrypto_aes_inline(ctx, req->nbytes)) {
+		pstat->ablk_cipher_aes_inline_dec++;
+		return _qcrypto_dec_aes_192_fallback(req);
+	}
+
 	rctx = ablkcipher_request_ctx(req);
 	rctx->aead = 0;
 	rctx->alg = CIPHER_ALG_AES;
@@ -2918,6 +3126,11 @@ static int _qcrypto_dec_aes_cbc(struct ablkcipher_request *req)
 				ctx->cipher_aes192_fb)
 		return _qcrypto_dec_aes_192_fallback(req);
 
+	if (_qcrypto_aes_inline(ctx, req->nbytes)) {
+		pstat->ablk_cipher_aes_inline_dec++;
+		return _qcrypto_dec_aes_192_fallback(req);
+	}
+
 	rctx = ablkcipher_request_ctx(req);
 	rctx->aead = 0;
 	rctx->alg = CIPHER_ALG_AES;
@@ -2948,6 +3161,11 @@ static int _qcrypto_dec_aes_ctr(struct ablkcipher_request *req)
 				ctx->cipher_aes192_fb)
 		return _qcrypto_dec_aes_192_fallback(req);
 
+	if (_qcrypto_aes_inline(ctx, req->nbytes)) {
+		pstat->ablk_cipher_aes_inline_dec++;
+		return _qcrypto_dec_aes_192_fallback(req);
+	}
+
 	rctx = ablkcipher_request_ctx(req);
 	rctx->aead = 0;
 	rctx->alg = CIPHER_ALG_AES;
@@ -5183,6 +5401,128 @@ static struct crypto_alg _qcrypto_aead_rfc4309_ccm_algo = {
 };
 
 
+struct qcrypto_calib_result {
+	struct completion completion;
+	int err;
+};
+
+static void _qcrypto_calib_req_complete(struct crypto_async_request *req,
+					int err)
+{
+	struct qcrypto_calib_result *res = req->data;
+
+	if (err == -EINPROGRESS)
+		return;
+	res->err = err;
+	complete(&res->completion);
+}
+
+/* Time QCRYPTO_INLINE_CALIB_LOOPS back to back encryptions of nbytes */
+static s64 _qcrypto_calib_time(struct crypto_ablkcipher *tfm, void *buf,
+				unsigned int nbytes)
+{
+	struct ablkcipher_request *req;
+	struct qcrypto_calib_result res;
+	struct scatterlist sg;
+	u8 iv[AES_BLOCK_SIZE];
+	ktime_t start;
+	s64 elapsed;
+	int i, ret = 0;
+
+	req = ablkcipher_request_alloc(tfm, GFP_KERNEL);
+	if (!req)
+		return -ENOMEM;
+	init_completion(&res.completion);
+	ablkcipher_request_set_callback(req, CRYPTO_TFM_REQ_MAY_BACKLOG,
+				_qcrypto_calib_req_complete, &res);
+	memset(iv, 0, sizeof(iv));
+	sg_init_one(&sg, buf, nbytes);
+	ablkcipher_request_set_crypt(req, &sg, &sg, nbytes, iv);
+
+	start = ktime_get();
+	for (i = 0; i < QCRYPTO_INLINE_CALIB_LOOPS; i++) {
+		ret = crypto_ablkcipher_encrypt(req);
+		if (ret == -EINPROGRESS || ret == -EBUSY) {
+			wait_for_completion(&res.completion);
+			reinit_completion(&res.completion);
+			ret = res.err;
+		}
+		if (ret)
+			break;
+	}
+	elapsed = ktime_to_ns(ktime_sub(ktime_get(), start));
+	ablkcipher_request_free(req);
+
+	return ret ? ret : elapsed;
+}
+
+/*
+ * Find the largest request size, up to QCRYPTO_INLINE_CALIB_MAX, for which
+ * the fallback cipher on the CPU still beats a round trip through the
+ * engine, and use it as the inline threshold unless one was set meanwhile.
+ */
+static void _qcrypto_inline_calibrate(struct work_struct *work)
+{
+	struct crypto_priv *cp = container_of(work, struct crypto_priv,
+						inline_calib_work);
+	struct crypto_ablkcipher *ce_tfm, *cpu_tfm = NULL;
+	u8 key[AES_KEYSIZE_128];
+	unsigned int nbytes;
+	int threshold = 0;
+	s64 ce_ns, cpu_ns;
+	void *buf = NULL;
+
+	if (cp->ce_support.use_sw_aes_cbc_ecb_ctr_algo)
+		goto out;
+
+	ce_tfm = crypto_alloc_ablkcipher("qcrypto-cbc-aes", 0, 0);
+	if (IS_ERR(ce_tfm))
+		goto out;
+	cpu_tfm = crypto_alloc_ablkcipher("cbc(aes)", 0,
+			CRYPTO_ALG_ASYNC | CRYPTO_ALG_NEED_FALLBACK);
+	if (IS_ERR(cpu_tfm)) {
+		cpu_tfm = NULL;
+		goto free;
+	}
+	buf = kzalloc(QCRYPTO_INLINE_CALIB_MAX, GFP_KERNEL);
+	if (!buf)
+		goto free;
+
+	get_random_bytes(key, sizeof(key));
+	if (crypto_ablkcipher_setkey(ce_tfm, key, sizeof(key)) ||
+			crypto_ablkcipher_setkey(cpu_tfm, key, sizeof(key)))
+		goto free;
+
+	/* warm up the bus vote, clocks and caches */
+	if (_qcrypto_calib_time(ce_tfm, buf, QCRYPTO_INLINE_CALIB_MIN) < 0 ||
+		_qcrypto_calib_time(cpu_tfm, buf, QCRYPTO_INLINE_CALIB_MIN) < 0)
+		goto free;
+
+	for (nbytes = QCRYPTO_INLINE_CALIB_MIN;
+			nbytes <= QCRYPTO_INLINE_CALIB_MAX; nbytes <<= 1) {
+		ce_ns = _qcrypto_calib_time(ce_tfm, buf, nbytes);
+		cpu_ns = _qcrypto_calib_time(cpu_tfm, buf, nbytes);
+		if (ce_ns < 0 || cpu_ns < 0)
+			break;
+		cp->inline_calib_size = nbytes;
+		cp->inline_calib_ce_ns = div_u64(ce_ns,
+					QCRYPTO_INLINE_CALIB_LOOPS);
+		cp->inline_calib_cpu_ns = div_u64(cpu_ns,
+					QCRYPTO_INLINE_CALIB_LOOPS);
+		if (cpu_ns > ce_ns)
+			break;
+		threshold = nbytes;
+	}
+free:
+	kzfree(buf);
+	if (cpu_tfm)
+		crypto_free_ablkcipher(cpu_tfm);
+	crypto_free_ablkcipher(ce_tfm);
+out:
+	if (cmpxchg(&_qcrypto_inline_threshold, -1, threshold) == -1)
+		pr_info("qcrypto: inline AES threshold %d bytes\n", threshold);
+}
+
 static int  _qcrypto_probe(struct platform_device *pdev)
 {
 	int rc = 0;
@@ -5589,6 +5929,8 @@ static int  _qcrypto_probe(struct platform_device *pdev)
 
 	mutex_unlock(&cp->engine_lock);
 
+	if (ACCESS_ONCE(_qcrypto_inline_threshold) < 0)
+		queue_work(system_unbound_wq, &cp->inline_calib_work);
 
 	return 0;
 err:
@@ -5769,7 +6111,13 @@ static ssize_t _debug_stats_write(struct file *file, const char __user *buf,
 		pe->err_req = 0;
 		qce_clear_driver_stats(pe->qce);
 		pe->max_req_used = 0;
+		pe->total_bytes = 0;
+		pe->total_lat_ns = 0;
+		pe->max_lat_ns = 0;
+		pe->nr_batch = 0;
+		pe->max_batch = 0;
 	}
+	cp->stats_start = ktime_get();
 	cp->max_qlen = 0;
 	cp->resp_start = 0;
 	cp->resp_stop = 0;
@@ -5840,10 +6188,13 @@ static int __init _qcrypto_init(void)
 		return -ENOMEM;
 	}
 	INIT_WORK(&pcp->resp_work, seq_response);
+	INIT_WORK(&pcp->inline_calib_work, _qcrypto_inline_calibrate);
 	pcp->total_units = 0;
 	pcp->platform_support.bus_scale_table = NULL;
 	pcp->next_engine = NULL;
 	pcp->scheduled_eng = NULL;
+	pcp->stats_start = ktime_get();
+	atomic_set(&pcp->eng_hint, 0);
 	pcp->ce_req_proc_sts = IN_PROGRESS;
 	crypto_init_queue(&pcp->req_queue, MSM_QCRYPTO_REQ_QUEUE_LENGTH);
 	return platform_driver_register(&_qualcomm_crypto);
@@ -5853,6 +6204,7 @@ static void __exit _qcrypto_exit(void)
 {
 	pr_debug("%s Unregister QCRYPTO\n", __func__);
 	debugfs_remove_recursive(_debug_dent);
+	cancel_work_sync(&qcrypto_dev.inline_calib_work);
 	platform_driver_unregister(&_qualcomm_crypto);
 }
 
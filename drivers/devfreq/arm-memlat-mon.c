@@ -36,11 +36,15 @@ enum ev_index {
 	INST_IDX,
 	L2DM_IDX,
 	CYC_IDX,
+	L2WB_IDX,
+	STALL_IDX,
 	NUM_EVENTS
 };
 #define INST_EV		0x08
 #define L2DM_EV		0x17
 #define CYC_EV		0x11
+#define L2WB_EV		0x18
+#define STALL_EV	0x24
 
 struct event_data {
 	struct perf_event *pevent;
@@ -84,6 +88,10 @@ static inline unsigned long read_event(struct event_data *event)
 	unsigned long ev_count;
 	u64 total, enabled, running;
 
+	/* Optional events may not be supported by the PMU */
+	if (!event->pevent)
+		return 0;
+
 	total = perf_event_read_value(event->pevent, &enabled, &running);
 	if (total >= event->prev_count)
 		ev_count = total - event->prev_count;
@@ -100,7 +108,7 @@ static void read_perf_counters(int cpu, struct cpu_grp_info *cpu_grp)
 	int cpu_idx;
 	struct memlat_hwmon_data *hw_data = &per_cpu(pm_data, cpu);
 	struct memlat_hwmon *hw = &cpu_grp->hw;
-	unsigned long cyc_cnt;
+	unsigned long cyc_cnt, stall_cnt;
 
 	if (hw_data->init_pending)
 		return;
@@ -113,7 +121,13 @@ static void read_perf_counters(int cpu, struct cpu_grp_info *cpu_grp)
 	hw->core_stats[cpu_idx].mem_count =
 			read_event(&hw_data->events[L2DM_IDX]);
 
+	hw->core_stats[cpu_idx].wb_count =
+			read_event(&hw_data->events[L2WB_IDX]);
+
 	cyc_cnt = read_event(&hw_data->events[CYC_IDX]);
+	stall_cnt = read_event(&hw_data->events[STALL_IDX]);
+	hw->core_stats[cpu_idx].stall_pct = cyc_cnt ?
+			mult_frac(100, stall_cnt, cyc_cnt) : 0;
 	hw->core_stats[cpu_idx].freq = compute_freq(hw_data, cyc_cnt);
 }
 
@@ -135,7 +149,10 @@ static void delete_events(struct memlat_hwmon_data *hw_data)
 
 	for (i = 0; i < NUM_EVENTS; i++) {
 		hw_data->events[i].prev_count = 0;
+		if (!hw_data->events[i].pevent)
+			continue;
 		perf_event_release_kernel(hw_data->events[i].pevent);
+		hw_data->events[i].pevent = NULL;
 	}
 }
 
@@ -158,6 +175,8 @@ static void stop_hwmon(struct memlat_hwmon *hw)
 		idx = cpu - cpumask_first(&cpu_grp->cpus);
 		hw->core_stats[idx].inst_count = 0;
 		hw->core_stats[idx].mem_count = 0;
+		hw->core_stats[idx].wb_count = 0;
+		hw->core_stats[idx].stall_pct = 0;
 		hw->core_stats[idx].freq = 0;
 	}
 	put_online_cpus();
@@ -213,6 +232,24 @@ static int set_events(struct memlat_hwmon_data *hw_data, int cpu)
 	hw_data->events[CYC_IDX].pevent = pevent;
 	perf_event_enable(hw_data->events[CYC_IDX].pevent);
 
+	/*
+	 * Writebacks and stalls only refine the vote, carry on without them
+	 * if the PMU can't count them.
+	 */
+	attr->config = L2WB_EV;
+	pevent = perf_event_create_kernel_counter(attr, cpu, NULL, NULL, NULL);
+	if (!IS_ERR(pevent)) {
+		hw_data->events[L2WB_IDX].pevent = pevent;
+		perf_event_enable(hw_data->events[L2WB_IDX].pevent);
+	}
+
+	attr->config = STALL_EV;
+	pevent = perf_event_create_kernel_counter(attr, cpu, NULL, NULL, NULL);
+	if (!IS_ERR(pevent)) {
+		hw_data->events[STALL_IDX].pevent = pevent;
+		perf_event_enable(hw_data->events[STALL_IDX].pevent);
+	}
+
 	kfree(attr);
 	return 0;
 
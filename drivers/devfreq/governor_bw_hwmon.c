@@ -14,6 +14,7 @@
 #define pr_fmt(fmt) "bw-hwmon: " fmt
 
 #include <linux/kernel.h>
+#include <linux/log2.h>
 #include <linux/sizes.h>
 #include <linux/module.h>
 #include <linux/init.h>
@@ -34,6 +35,10 @@
 #include "governor_bw_hwmon.h"
 
 #define NUM_MBPS_ZONES		10
+#define PRED_HIST		4
+#define BW_HIST_BUCKETS		16
+#define BW_HIST_MIN_MBPS	64
+#define BW_HIST_WINDOW_MS	(60 * MSEC_PER_SEC)
 struct hwmon_node {
 	unsigned int guard_band_mbps;
 	unsigned int decay_rate;
@@ -52,6 +57,8 @@ struct hwmon_node {
 	unsigned int low_power_io_percent;
 	unsigned int low_power_delay;
 	unsigned int mbps_zones[NUM_MBPS_ZONES];
+	unsigned int predict;
+	unsigned int predict_tol;
 
 	unsigned long prev_ab;
 	unsigned long *dev_ab;
@@ -71,8 +78,25 @@ struct hwmon_node {
 	unsigned long down_wake_mbps;
 	unsigned int wake;
 	unsigned int down_cnt;
+	unsigned int pred_period_us[PRED_HIST];
+	unsigned int pred_nr_periods;
+	unsigned int pred_period;
+	unsigned long pred_peak_mbps;
+	unsigned long pred_mbps;
+	unsigned long pred_hits;
+	unsigned long pred_misses;
+	bool pred_in_burst;
+	bool pred_armed;
+	ktime_t pred_last_onset;
+	ktime_t pred_next;
 	ktime_t prev_ts;
 	ktime_t hist_max_ts;
+	u64 total_bytes;
+	u64 total_us;
+	u64 bw_hist_us[BW_HIST_BUCKETS];
+	u64 bw_win_us[BW_HIST_BUCKETS];
+	u64 bw_prev_win_us[BW_HIST_BUCKETS];
+	ktime_t bw_win_start;
 	bool sampled;
 	bool mon_started;
 	struct list_head list;
@@ -197,6 +221,40 @@ static unsigned int mbps_to_bytes(unsigned long mbps, unsigned int ms)
 	return mbps;
 }
 
+static unsigned int bw_hist_bucket(unsigned long mbps)
+{
+	if (mbps < BW_HIST_MIN_MBPS)
+		return 0;
+	return min_t(unsigned int, ilog2(mbps) - ilog2(BW_HIST_MIN_MBPS) + 1,
+		     BW_HIST_BUCKETS - 1);
+}
+
+/*
+ * Keeps every byte the monitor counted, which the governor itself only
+ * needs for the current sample, along with how long the device spent in
+ * each bandwidth band: since boot, and over the last complete window.
+ *
+ * Called with irq_lock held.
+ */
+static void bw_hwmon_account(struct hwmon_node *node, unsigned long bytes,
+			     unsigned long mbps, unsigned int us, ktime_t ts)
+{
+	unsigned int b = bw_hist_bucket(mbps);
+
+	node->total_bytes += bytes;
+	node->total_us += us;
+	node->bw_hist_us[b] += us;
+
+	if (ktime_to_ms(ktime_sub(ts, node->bw_win_start)) >=
+	    BW_HIST_WINDOW_MS) {
+		memcpy(node->bw_prev_win_us, node->bw_win_us,
+		       sizeof(node->bw_win_us));
+		memset(node->bw_win_us, 0, sizeof(node->bw_win_us));
+		node->bw_win_start = ts;
+	}
+	node->bw_win_us[b] += us;
+}
+
 static int __bw_hwmon_sample_end(struct bw_hwmon *hwmon)
 {
 	struct devfreq *df;
@@ -218,6 +276,7 @@ static int __bw_hwmon_sample_end(struct bw_hwmon *hwmon)
 
 	mbps = bytes_to_mbps(bytes, us);
 	node->max_mbps = max(node->max_mbps, mbps);
+	bw_hwmon_account(node, bytes, mbps, us, ts);
 
 	/*
 	 * If the measured bandwidth in a micro sample is greater than the
@@ -270,6 +329,93 @@ unsigned long to_mbps_zone(struct hwmon_node *node, unsigned long mbps)
 	return node->hw->df->max_freq;
 }
 
+/*
+ * Learn the period of bursts and their peak bandwidth from the onsets seen
+ * in the decision windows. Once the last PRED_HIST periods agree within
+ * predict_tol percent, return the expected peak for the window in which
+ * the next burst is due so that the vote is raised before it starts.
+ * Returns 0 when there is no prediction for this window.
+ *
+ * Called with irq_lock held.
+ */
+static unsigned long predict_bw(struct hwmon_node *node,
+				unsigned long meas_mbps, ktime_t ts)
+{
+	unsigned int polling_ms = node->hw->df->profile->polling_ms;
+	unsigned int i, period, mean, tol_us;
+	bool onset = false;
+	u64 sum = 0;
+
+	if (meas_mbps > node->idle_mbps) {
+		onset = !node->pred_in_burst;
+		node->pred_in_burst = true;
+		node->pred_peak_mbps = max(node->pred_peak_mbps, meas_mbps);
+	} else if (node->pred_in_burst) {
+		node->pred_in_burst = false;
+		node->pred_mbps = node->pred_mbps ?
+			(node->pred_mbps + node->pred_peak_mbps) / 2 :
+			node->pred_peak_mbps;
+		node->pred_peak_mbps = 0;
+	}
+
+	tol_us = (node->pred_period * node->predict_tol) / 100;
+
+	/* The expected burst never came, the pattern is broken. */
+	if (node->pred_armed && !onset &&
+	    ktime_after(ts, ktime_add_us(node->pred_next, tol_us))) {
+		node->pred_misses++;
+		node->pred_armed = false;
+		node->pred_period = 0;
+		node->pred_nr_periods = 0;
+	}
+
+	if (onset) {
+		if (node->pred_armed) {
+			if (abs(ktime_us_delta(ts, node->pred_next)) <= tol_us)
+				node->pred_hits++;
+			else
+				node->pred_misses++;
+			node->pred_armed = false;
+		}
+
+		period = ktime_us_delta(ts, node->pred_last_onset);
+		node->pred_last_onset = ts;
+		memmove(&node->pred_period_us[1], &node->pred_period_us[0],
+			(PRED_HIST - 1) * sizeof(node->pred_period_us[0]));
+		node->pred_period_us[0] = period;
+		if (node->pred_nr_periods < PRED_HIST)
+			node->pred_nr_periods++;
+
+		node->pred_period = 0;
+		if (node->pred_nr_periods == PRED_HIST) {
+			for (i = 0; i < PRED_HIST; i++)
+				sum += node->pred_period_us[i];
+			do_div(sum, PRED_HIST);
+			mean = sum;
+			tol_us = (mean * node->predict_tol) / 100;
+			for (i = 0; i < PRED_HIST; i++)
+				if (abs((int)(node->pred_period_us[i] - mean))
+								> tol_us)
+					break;
+			if (i == PRED_HIST)
+				node->pred_period = mean;
+		}
+		if (node->pred_period)
+			node->pred_next = ktime_add_us(ts, node->pred_period);
+	}
+
+	if (!node->pred_period || node->pred_in_burst)
+		return 0;
+
+	/* Raise the vote in the last window before the burst is due. */
+	if (!node->pred_armed &&
+	    ktime_after(ktime_add_us(ts, polling_ms * USEC_PER_MSEC),
+			node->pred_next))
+		node->pred_armed = true;
+
+	return node->pred_armed ? node->pred_mbps : 0;
+}
+
 #define MIN_MBPS	500UL
 #define HIST_PEAK_TOL	60
 static unsigned long get_bw_and_set_irq(struct hwmon_node *node,
@@ -392,6 +538,9 @@ static unsigned long get_bw_and_set_irq(struct hwmon_node *node,
 			req_mbps = max(req_mbps, node->hyst_mbps);
 	}
 
+	if (node->predict)
+		req_mbps = max(req_mbps, predict_bw(node, meas_mbps, ts));
+
 	/* Stretch the short sample window size, if the traffic is too low */
 	if (meas_mbps < MIN_MBPS) {
 		node->up_wake_mbps = (max(MIN_MBPS, req_mbps)
@@ -720,6 +869,79 @@ static ssize_t show_throttle_adj(struct device *dev,
 static DEVICE_ATTR(throttle_adj, 0644, show_throttle_adj,
 						store_throttle_adj);
 
+static ssize_t show_predict_stats(struct device *dev,
+			struct device_attribute *attr, char *buf)
+{
+	struct devfreq *df = to_devfreq(dev);
+	struct hwmon_node *node = df->data;
+	unsigned long hits = node->pred_hits, misses = node->pred_misses;
+
+	return snprintf(buf, PAGE_SIZE,
+			"hits=%lu misses=%lu hit_rate=%lu%% period_us=%u mbps=%lu\n",
+			hits, misses,
+			(hits + misses) ? (hits * 100) / (hits + misses) : 0,
+			node->pred_period, node->pred_mbps);
+}
+
+static DEVICE_ATTR(predict_stats, 0444, show_predict_stats, NULL);
+
+static ssize_t show_total_bytes(struct device *dev,
+			struct device_attribute *attr, char *buf)
+{
+	struct devfreq *df = to_devfreq(dev);
+	struct hwmon_node *node = df->data;
+	unsigned long flags;
+	u64 bytes;
+
+	spin_lock_irqsave(&irq_lock, flags);
+	bytes = node->total_bytes;
+	spin_unlock_irqrestore(&irq_lock, flags);
+
+	return snprintf(buf, PAGE_SIZE, "%llu\n", bytes);
+}
+
+static DEVICE_ATTR(total_bytes, 0444, show_total_bytes, NULL);
+
+static ssize_t show_bw_hist(struct device *dev,
+			struct device_attribute *attr, char *buf)
+{
+	struct devfreq *df = to_devfreq(dev);
+	struct hwmon_node *node = df->data;
+	u64 hist[BW_HIST_BUCKETS], win[BW_HIST_BUCKETS];
+	unsigned long flags;
+	u64 bytes, us;
+	unsigned int i, lo, hi;
+	ssize_t cnt;
+
+	spin_lock_irqsave(&irq_lock, flags);
+	memcpy(hist, node->bw_hist_us, sizeof(hist));
+	memcpy(win, node->bw_prev_win_us, sizeof(win));
+	bytes = node->total_bytes;
+	us = node->total_us;
+	spin_unlock_irqrestore(&irq_lock, flags);
+
+	cnt = scnprintf(buf, PAGE_SIZE, "bytes %llu ms %llu\n", bytes,
+			div_u64(us, USEC_PER_MSEC));
+	cnt += scnprintf(buf + cnt, PAGE_SIZE - cnt, "%15s %12s %12s\n",
+			 "mbps", "window_ms", "total_ms");
+	for (i = 0; i < BW_HIST_BUCKETS; i++) {
+		lo = i ? BW_HIST_MIN_MBPS << (i - 1) : 0;
+		hi = BW_HIST_MIN_MBPS << i;
+		if (i == BW_HIST_BUCKETS - 1)
+			cnt += scnprintf(buf + cnt, PAGE_SIZE - cnt,
+					 "%7u-%-7s ", lo, "");
+		else
+			cnt += scnprintf(buf + cnt, PAGE_SIZE - cnt,
+					 "%7u-%-7u ", lo, hi);
+		cnt += scnprintf(buf + cnt, PAGE_SIZE - cnt, "%12llu %12llu\n",
+				 div_u64(win[i], USEC_PER_MSEC),
+				 div_u64(hist[i], USEC_PER_MSEC));
+	}
+	return cnt;
+}
+
+static DEVICE_ATTR(bw_hist, 0444, show_bw_hist, NULL);
+
 gov_attr(guard_band_mbps, 0U, 2000U);
 gov_attr(decay_rate, 0U, 100U);
 gov_attr(io_percent, 1U, 100U);
@@ -737,6 +959,8 @@ gov_attr(low_power_ceil_mbps, 0U, 2500U);
 gov_attr(low_power_io_percent, 1U, 100U);
 gov_attr(low_power_delay, 1U, 60U);
 gov_list_attr(mbps_zones, NUM_MBPS_ZONES, 0U, UINT_MAX);
+gov_attr(predict, 0U, 1U);
+gov_attr(predict_tol, 1U, 50U);
 
 static struct attribute *dev_attr[] = {
 	&dev_attr_guard_band_mbps.attr,
@@ -757,6 +981,11 @@ static struct attribute *dev_attr[] = {
 	&dev_attr_low_power_delay.attr,
 	&dev_attr_mbps_zones.attr,
 	&dev_attr_throttle_adj.attr,
+	&dev_attr_predict.attr,
+	&dev_attr_predict_tol.attr,
+	&dev_attr_predict_stats.attr,
+	&dev_attr_total_bytes.attr,
+	&dev_attr_bw_hist.attr,
 	NULL,
 };
 
@@ -899,6 +1128,8 @@ int register_bw_hwmon(struct device *dev, struct bw_hwmon *hwmon)
 	node->hyst_length = 0;
 	node->idle_mbps = 400;
 	node->mbps_zones[0] = 0;
+	node->predict = 0;
+	node->predict_tol = 10;
 	node->hw = hwmon;
 
 	mutex_lock(&list_lock);
@@ -28,15 +28,34 @@
 #include <linux/platform_device.h>
 #include <linux/of.h>
 #include <linux/devfreq.h>
+#include <linux/jiffies.h>
+#include <linux/percpu.h>
+#include <soc/qcom/memlat.h>
 #include "governor.h"
 #include "governor_memlat.h"
 
 #include <trace/events/power.h>
 
+/*
+ * Maps the frequency of the core driving a signal to the vote for the
+ * target device. Tables are sorted by core frequency and end with a zeroed
+ * entry.
+ */
+struct core_dev_map {
+	unsigned int core_mhz;
+	unsigned int target_freq;
+};
+
 struct memlat_node {
 	unsigned int ratio_ceil;
+	unsigned int wb_ratio_ceil;
+	unsigned int stall_floor;
 	unsigned int freq_thresh_mhz;
 	unsigned int mult_factor;
+	unsigned int *core_weights;
+	struct core_dev_map *freq_map;
+	struct core_dev_map *wb_freq_map;
+	struct core_dev_map *stall_freq_map;
 	bool mon_started;
 	struct list_head list;
 	void *orig_data;
@@ -51,6 +70,55 @@ static DEFINE_MUTEX(list_lock);
 static int use_cnt;
 static DEFINE_MUTEX(state_lock);
 
+/*
+ * Last per-CPU measurements, for consumers outside devfreq that want to know
+ * whether a CPU is stalled on memory. Considered stale after STALL_EXPIRY.
+ */
+struct memlat_cpu_stat {
+	unsigned int stall_pct;
+	bool mem_bound;
+	unsigned long stamp;
+};
+static DEFINE_PER_CPU(struct memlat_cpu_stat, memlat_cpu_stats);
+#define STALL_EXPIRY	(HZ / 2)
+
+/**
+ * memlat_get_cpu_stall - Last memory stall measurement of a CPU.
+ * @cpu:	CPU to query.
+ * @stall_pct:	Percentage of cycles stalled in the backend.
+ * @mem_bound:	Instructions per memory access were at or below ratio_ceil.
+ *
+ * Returns -ENODATA if @cpu is not monitored by an active memlat device or its
+ * last measurement is stale.
+ */
+int memlat_get_cpu_stall(int cpu, unsigned int *stall_pct, bool *mem_bound)
+{
+	struct memlat_cpu_stat *st = &per_cpu(memlat_cpu_stats, cpu);
+	unsigned long stamp = ACCESS_ONCE(st->stamp);
+
+	if (!stamp || time_after(jiffies, stamp + STALL_EXPIRY))
+		return -ENODATA;
+
+	*stall_pct = ACCESS_ONCE(st->stall_pct);
+	*mem_bound = ACCESS_ONCE(st->mem_bound);
+	return 0;
+}
+EXPORT_SYMBOL(memlat_get_cpu_stall);
+
+static void memlat_publish_cpu_stall(struct memlat_node *node,
+				     struct dev_stats *stats, unsigned int ratio)
+{
+	struct memlat_cpu_stat *st;
+
+	if (stats->id < 0 || stats->id >= nr_cpu_ids)
+		return;
+
+	st = &per_cpu(memlat_cpu_stats, stats->id);
+	st->stall_pct = stats->stall_pct;
+	st->mem_bound = ratio && ratio <= node->ratio_ceil;
+	st->stamp = jiffies ?: 1;
+}
+
 #define show_attr(name) \
 static ssize_t show_##name(struct device *dev,				\
 			struct device_attribute *attr, char *buf)	\
@@ -83,45 +151,92 @@ show_attr(__attr)			\
 store_attr(__attr, min, max)		\
 static DEVICE_ATTR(__attr, 0644, show_##__attr, store_##__attr)
 
+static unsigned long core_to_dev_freq(struct memlat_node *node,
+				struct core_dev_map *map, unsigned long coref)
+{
+	if (!coref)
+		return 0;
+
+	if (!map)
+		return coref * node->mult_factor;
+
+	while (map->core_mhz && map->core_mhz < coref)
+		map++;
+	if (!map->core_mhz)
+		map--;
+
+	return map->target_freq;
+}
+
 static unsigned long compute_dev_vote(struct devfreq *df)
 {
-	int i, lat_dev;
+	int i, lat_dev = 0;
 	struct memlat_node *node = df->data;
 	struct memlat_hwmon *hw = node->hw;
-	unsigned long max_freq = 0;
-	unsigned int ratio;
+	unsigned long lat_mhz = 0, wb_mhz = 0, stall_mhz = 0;
+	unsigned long lat_vote, wb_vote, stall_vote;
+	unsigned long freq;
+	unsigned int ratio, wb_ratio, weight;
 
 	hw->get_cnt(hw);
 
 	for (i = 0; i < hw->num_cores; i++) {
 		ratio = hw->core_stats[i].inst_count;
+		wb_ratio = hw->core_stats[i].inst_count;
 
 		if (hw->core_stats[i].mem_count)
 			ratio /= hw->core_stats[i].mem_count;
+		if (hw->core_stats[i].wb_count)
+			wb_ratio /= hw->core_stats[i].wb_count;
+
+		weight = node->core_weights ? node->core_weights[i] : 100;
 
 		trace_memlat_dev_meas(dev_name(df->dev.parent),
 					hw->core_stats[i].id,
 					hw->core_stats[i].inst_count,
 					hw->core_stats[i].mem_count,
-					hw->core_stats[i].freq, ratio);
+					hw->core_stats[i].freq, ratio,
+					hw->core_stats[i].wb_count,
+					hw->core_stats[i].stall_pct, weight);
+		memlat_publish_cpu_stall(node, &hw->core_stats[i], ratio);
+
+		if (hw->core_stats[i].freq < node->freq_thresh_mhz)
+			continue;
+
+		/* The core counts for its weighted share of its frequency */
+		freq = mult_frac(hw->core_stats[i].freq, weight, 100);
 
-		if (ratio && ratio <= node->ratio_ceil
-		    && hw->core_stats[i].freq >= node->freq_thresh_mhz
-		    && hw->core_stats[i].freq > max_freq) {
+		if (ratio && ratio <= node->ratio_ceil && freq > lat_mhz) {
 			lat_dev = i;
-			max_freq = hw->core_stats[i].freq;
+			lat_mhz = freq;
 		}
+
+		if (hw->core_stats[i].wb_count && wb_ratio &&
+		    wb_ratio <= node->wb_ratio_ceil && freq > wb_mhz)
+			wb_mhz = freq;
+
+		if (node->stall_floor &&
+		    hw->core_stats[i].stall_pct >= node->stall_floor &&
+		    freq > stall_mhz)
+			stall_mhz = freq;
 	}
 
-	if (max_freq)
+	lat_vote = core_to_dev_freq(node, node->freq_map, lat_mhz);
+	wb_vote = core_to_dev_freq(node, node->wb_freq_map, wb_mhz);
+	stall_vote = core_to_dev_freq(node, node->stall_freq_map, stall_mhz);
+
+	if (lat_mhz)
 		trace_memlat_dev_update(dev_name(df->dev.parent),
 					hw->core_stats[lat_dev].id,
 					hw->core_stats[lat_dev].inst_count,
 					hw->core_stats[lat_dev].mem_count,
 					hw->core_stats[lat_dev].freq,
-					max_freq * node->mult_factor);
+					lat_vote);
+
+	trace_memlat_dev_decision(dev_name(df->dev.parent), lat_mhz, wb_mhz,
+				stall_mhz, lat_vote, wb_vote, stall_vote);
 
-	return max_freq;
+	return max3(lat_vote, wb_vote, stall_vote);
 }
 
 static struct memlat_node *find_memlat_node(struct devfreq *df)
@@ -224,21 +339,21 @@ static int devfreq_memlat_get_freq(struct devfreq *df,
 					unsigned long *freq,
 					u32 *flag)
 {
-	unsigned long mhz;
-	struct memlat_node *node = df->data;
-
-	mhz = compute_dev_vote(df);
-	*freq = mhz ? (mhz * node->mult_factor) : 0;
+	*freq = compute_dev_vote(df);
 
 	return 0;
 }
 
 gov_attr(ratio_ceil, 1U, 1000U);
+gov_attr(wb_ratio_ceil, 0U, 1000U);
+gov_attr(stall_floor, 0U, 100U);
 gov_attr(freq_thresh_mhz, 300U, 5000U);
 gov_attr(mult_factor, 1U, 10U);
 
 static struct attribute *dev_attr[] = {
 	&dev_attr_ratio_ceil.attr,
+	&dev_attr_wb_ratio_ceil.attr,
+	&dev_attr_stall_floor.attr,
 	&dev_attr_freq_thresh_mhz.attr,
 	&dev_attr_mult_factor.attr,
 	NULL,
@@ -295,6 +410,74 @@ static struct devfreq_governor devfreq_gov_memlat = {
 	.event_handler = devfreq_memlat_ev_handler,
 };
 
+#define NUM_COLS	2
+static struct core_dev_map *init_core_dev_map(struct device *dev,
+						char *prop_name)
+{
+	int len, nf, i, j;
+	u32 data;
+	struct core_dev_map *tbl;
+	int ret;
+
+	if (!dev->of_node || !of_find_property(dev->of_node, prop_name, &len))
+		return NULL;
+	len /= sizeof(data);
+
+	if (len % NUM_COLS || len == 0)
+		return NULL;
+	nf = len / NUM_COLS;
+
+	tbl = devm_kzalloc(dev, (nf + 1) * sizeof(struct core_dev_map),
+			GFP_KERNEL);
+	if (!tbl)
+		return NULL;
+
+	for (i = 0, j = 0; i < nf; i++, j += 2) {
+		ret = of_property_read_u32_index(dev->of_node, prop_name, j,
+				&data);
+		if (ret)
+			return NULL;
+		tbl[i].core_mhz = data / 1000;
+
+		ret = of_property_read_u32_index(dev->of_node, prop_name, j + 1,
+				&data);
+		if (ret)
+			return NULL;
+		tbl[i].target_freq = data;
+		pr_debug("Entry%d CPU:%u, Dev:%u\n", i, tbl[i].core_mhz,
+				tbl[i].target_freq);
+	}
+	tbl[i].core_mhz = 0;
+
+	return tbl;
+}
+
+static unsigned int *init_core_weights(struct device *dev,
+				unsigned int num_cores)
+{
+	unsigned int *weights;
+	int len;
+
+	if (!dev->of_node ||
+	    !of_find_property(dev->of_node, "qcom,core-weights", &len))
+		return NULL;
+
+	if (len != num_cores * sizeof(u32)) {
+		dev_err(dev, "qcom,core-weights needs one entry per core\n");
+		return NULL;
+	}
+
+	weights = devm_kzalloc(dev, len, GFP_KERNEL);
+	if (!weights)
+		return NULL;
+
+	if (of_property_read_u32_array(dev->of_node, "qcom,core-weights",
+				weights, num_cores))
+		return NULL;
+
+	return weights;
+}
+
 int register_memlat(struct device *dev, struct memlat_hwmon *hw)
 {
 	int ret = 0;
@@ -315,6 +498,19 @@ int register_memlat(struct device *dev, struct memlat_hwmon *hw)
 	node->mult_factor = 8;
 	node->hw = hw;
 
+	/*
+	 * The writeback and stall signals are off until tuned, either here
+	 * or through sysfs.
+	 */
+	of_property_read_u32(dev->of_node, "qcom,wb-ratio-ceil",
+				&node->wb_ratio_ceil);
+	of_property_read_u32(dev->of_node, "qcom,stall-floor",
+				&node->stall_floor);
+	node->freq_map = init_core_dev_map(dev, "qcom,core-dev-table");
+	node->wb_freq_map = init_core_dev_map(dev, "qcom,wb-dev-table");
+	node->stall_freq_map = init_core_dev_map(dev, "qcom,stall-dev-table");
+	node->core_weights = init_core_weights(dev, hw->num_cores);
+
 	mutex_lock(&list_lock);
 	list_add_tail(&node->list, &memlat_list);
 	mutex_unlock(&list_lock);
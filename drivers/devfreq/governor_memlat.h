@@ -21,6 +21,8 @@
  * struct dev_stats - Device stats
  * @inst_count:			Number of instructions executed.
  * @mem_count:			Number of memory accesses made.
+ * @wb_count:			Number of L2 writebacks made.
+ * @stall_pct:			Percentage of cycles stalled in the backend.
  * @freq:			Effective frequency of the device in the
  *				last interval.
  */
@@ -28,6 +30,8 @@ struct dev_stats {
 	int id;
 	unsigned long inst_count;
 	unsigned long mem_count;
+	unsigned long wb_count;
+	unsigned int stall_pct;
 	unsigned long freq;
 };
 
@@ -36,7 +40,8 @@ struct dev_stats {
  * @start_hwmon:		Start the HW monitoring
  * @stop_hwmon:			Stop the HW monitoring
  * @get_cnt:			Return the number of intructions executed,
- *				memory accesses and effective frequency
+ *				memory accesses, L2 writebacks, backend
+ *				stalls and effective frequency
  * @dev:			Pointer to device that this HW monitor can
  *				monitor.
  * @of_node:			OF node of device that this HW monitor can
@@ -47,7 +52,8 @@ struct dev_stats {
  * @num_cores:			Number of cores that are monitored by the
  *				hardware monitor.
  * @core_stats:			Array containing instruction count, memory
- *				accesses and effective frequency for each core.
+ *				accesses, writebacks, stalls and effective
+ *				frequency for each core.
  *
  * One of dev or of_node needs to be specified for a successful registration.
  *
@@ -43,6 +43,14 @@ static DEFINE_SPINLOCK(suspend_lock);
  * frame length, but less than the idle timer.
  */
 #define CEILING			50000
+
+/*
+ * In frame aware mode, hold the frequency for up to FRAME_HOLD usec
+ * after the last frame rather than letting the idle time between
+ * frames pull it down.
+ */
+#define FRAME_HOLD		100000
+#define FRAME_HEADROOM		10
 #define TZ_RESET_ID		0x3
 #define TZ_UPDATE_ID		0x4
 #define TZ_INIT_ID		0x6
@@ -134,7 +142,64 @@ static ssize_t suspend_time_show(struct device *dev,
 	return snprintf(buf, PAGE_SIZE, "%llu\n", time_diff);
 }
 
+static ssize_t frame_aware_show(struct device *dev,
+	struct device_attribute *attr, char *buf)
+{
+	struct devfreq_msm_adreno_tz_data *priv = to_devfreq(dev)->data;
+
+	return snprintf(buf, PAGE_SIZE, "%d\n", priv->frame.enable);
+}
+
+static ssize_t frame_aware_store(struct device *dev,
+	struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct devfreq *devfreq = to_devfreq(dev);
+	struct devfreq_msm_adreno_tz_data *priv = devfreq->data;
+	unsigned int val;
+	int ret;
+
+	ret = kstrtouint(buf, 0, &val);
+	if (ret)
+		return ret;
+
+	mutex_lock(&devfreq->lock);
+	priv->frame.enable = !!val;
+	priv->frame.last = ktime_set(0, 0);
+	mutex_unlock(&devfreq->lock);
+
+	return count;
+}
+
+static ssize_t frame_headroom_show(struct device *dev,
+	struct device_attribute *attr, char *buf)
+{
+	struct devfreq_msm_adreno_tz_data *priv = to_devfreq(dev)->data;
+
+	return snprintf(buf, PAGE_SIZE, "%u\n", priv->frame.headroom);
+}
+
+static ssize_t frame_headroom_store(struct device *dev,
+	struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct devfreq_msm_adreno_tz_data *priv = to_devfreq(dev)->data;
+	unsigned int val;
+	int ret;
+
+	ret = kstrtouint(buf, 0, &val);
+	if (ret)
+		return ret;
+
+	if (val >= 100)
+		return -EINVAL;
+
+	priv->frame.headroom = val;
+	return count;
+}
+
 static DEVICE_ATTR(gpu_load, 0444, gpu_load_show, NULL);
+static DEVICE_ATTR(frame_aware, 0644, frame_aware_show, frame_aware_store);
+static DEVICE_ATTR(frame_headroom, 0644, frame_headroom_show,
+		frame_headroom_store);
 
 static DEVICE_ATTR(suspend_time, 0444,
 		suspend_time_show,
@@ -143,6 +208,8 @@ static DEVICE_ATTR(suspend_time, 0444,
 static const struct device_attribute *adreno_tz_attr_list[] = {
 		&dev_attr_gpu_load,
 		&dev_attr_suspend_time,
+		&dev_attr_frame_aware,
+		&dev_attr_frame_headroom,
 		NULL
 };
 
@@ -338,6 +405,31 @@ static int tz_init(struct devfreq_msm_adreno_tz_data *priv,
 	return ret;
 }
 
+/*
+ * Pick the lowest level that would have finished the reported frames
+ * within their budget, less frame.headroom percent.
+ */
+static int tz_frame_level(struct devfreq *devfreq,
+		struct devfreq_msm_adreno_tz_data *priv,
+		struct msm_adreno_gpu_status *status, unsigned long cur_freq)
+{
+	s64 budget = (s64) status->frame_busy_us + status->frame_slack_us;
+	u64 required;
+	int level;
+
+	budget = div_s64(budget * (100 - priv->frame.headroom), 100);
+	if (budget <= 0)
+		return 0;
+
+	required = div64_u64((u64) cur_freq * status->frame_busy_us, budget);
+
+	for (level = devfreq->profile->max_state - 1; level > 0; level--)
+		if (devfreq->profile->freq_table[level] >= required)
+			break;
+
+	return level;
+}
+
 static int tz_get_target_freq(struct devfreq *devfreq, unsigned long *freq,
 				u32 *flag)
 {
@@ -347,6 +439,7 @@ static int tz_get_target_freq(struct devfreq *devfreq, unsigned long *freq,
 	int val, level = 0;
 	unsigned int scm_data[4];
 	int context_count = 0;
+	struct msm_adreno_gpu_status *status = NULL;
 
 	/* keeps stats.private_data == NULL   */
 	result = devfreq->profile->get_dev_status(devfreq->dev.parent, &stats);
@@ -359,11 +452,33 @@ static int tz_get_target_freq(struct devfreq *devfreq, unsigned long *freq,
 	priv->bin.total_time += stats.total_time;
 	priv->bin.busy_time += stats.busy_time;
 
-	if (stats.private_data)
-		context_count =  *((int *)stats.private_data);
+	if (stats.private_data) {
+		status = stats.private_data;
+		context_count = status->context_count;
+	}
 
 	/* Update the GPU load statistics */
 	compute_work_load(&stats, priv, devfreq);
+
+	if (priv->frame.enable && status) {
+		ktime_t now = ktime_get();
+
+		if (status->frames) {
+			priv->frame.last = now;
+			level = tz_frame_level(devfreq, priv, status,
+					stats.current_frequency);
+			priv->bin.total_time = 0;
+			priv->bin.busy_time = 0;
+			*freq = devfreq->profile->freq_table[level];
+			return 0;
+		}
+
+		if (ktime_us_delta(now, priv->frame.last) < FRAME_HOLD) {
+			priv->bin.total_time = 0;
+			priv->bin.busy_time = 0;
+			return 0;
+		}
+	}
 	/*
 	 * Do not waste CPU cycles running this algorithm if
 	 * the GPU just started, or if less than FLOOR time
@@ -464,6 +579,9 @@ static int tz_start(struct devfreq *devfreq)
 
 	priv = devfreq->data;
 	priv->nb.notifier_call = tz_notify;
+	priv->frame.enable = false;
+	priv->frame.headroom = FRAME_HEADROOM;
+	priv->frame.last = ktime_set(0, 0);
 
 	out = 1;
 	if (devfreq->profile->max_state < MSM_ADRENO_MAX_PWRLEVELS) {
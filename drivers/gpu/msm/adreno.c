@@ -1023,6 +1023,7 @@ static int adreno_probe(struct platform_device *pdev)
 
 	adreno_debugfs_init(adreno_dev);
 	adreno_profile_init(adreno_dev);
+	adreno_perfcounter_sampler_init(adreno_dev);
 
 	adreno_sysfs_init(adreno_dev);
 
@@ -1102,6 +1103,7 @@ static int adreno_remove(struct platform_device *pdev)
 
 	adreno_coresight_remove(adreno_dev);
 	adreno_profile_close(adreno_dev);
+	adreno_perfcounter_sampler_close(adreno_dev);
 
 	kgsl_pwrscale_close(device);
 
@@ -2136,6 +2138,32 @@ static int adreno_setproperty(struct kgsl_device_private *dev_priv,
 			kgsl_context_put(context);
 		}
 		break;
+	case KGSL_PROP_CONTEXT_DEADLINE: {
+			struct kgsl_context_deadline deadline;
+			struct kgsl_context *context;
+
+			if (sizebytes != sizeof(deadline))
+				break;
+
+			if (copy_from_user(&deadline, value,
+				sizeof(deadline))) {
+				status = -EFAULT;
+				break;
+			}
+
+			context = kgsl_context_get_owner(dev_priv,
+							deadline.context_id);
+
+			if (context == NULL)
+				break;
+
+			ADRENO_CONTEXT(context)->deadline_us =
+				deadline.deadline_us;
+
+			kgsl_context_put(context);
+			status = 0;
+		}
+		break;
 	default:
 		break;
 	}
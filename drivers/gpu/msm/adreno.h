@@ -231,6 +231,7 @@ enum adreno_preempt_states {
  * @work: A work struct for the preemption worker (for 5XX)
  * @token_submit: Indicates if a preempt token has been submitted in
  * current ringbuffer (for 4XX)
+ * @trigger_time: ktime at which the last preemption was triggered
  */
 struct adreno_preemption {
 	atomic_t state;
@@ -238,6 +239,7 @@ struct adreno_preemption {
 	struct timer_list timer;
 	struct work_struct work;
 	bool token_submit;
+	ktime_t trigger_time;
 };
 
 
@@ -369,6 +371,7 @@ struct adreno_gpu_core {
  * @irq_storm_work: Worker to handle possible interrupt storms
  * @active_list: List to track active contexts
  * @active_list_lock: Lock to protect active_list
+ * @sampler: Periodic performance counter sampling state
  */
 struct adreno_device {
 	struct kgsl_device dev;    /* Must be first field in this struct */
@@ -434,6 +437,7 @@ struct adreno_device {
 
 	struct list_head active_list;
 	spinlock_t active_list_lock;
+	struct adreno_perfcounter_sampler sampler;
 };
 
 /**
@@ -924,6 +928,9 @@ long adreno_ioctl_perfcounter_get(struct kgsl_device_private *dev_priv,
 long adreno_ioctl_perfcounter_put(struct kgsl_device_private *dev_priv,
 	unsigned int cmd, void *data);
 
+long adreno_ioctl_perfcounter_sample(struct kgsl_device_private *dev_priv,
+	unsigned int cmd, void *data);
+
 int adreno_efuse_map(struct adreno_device *adreno_dev);
 int adreno_efuse_read_u32(struct adreno_device *adreno_dev, unsigned int offset,
 		unsigned int *val);
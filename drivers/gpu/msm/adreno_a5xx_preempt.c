@@ -89,6 +89,8 @@ static void _a5xx_preemption_done(struct adreno_device *adreno_dev)
 	del_timer_sync(&adreno_dev->preempt.timer);
 
 	trace_adreno_preempt_done(adreno_dev->cur_rb, adreno_dev->next_rb);
+	trace_adreno_preempt_latency(adreno_dev->cur_rb, adreno_dev->next_rb,
+		ktime_us_delta(ktime_get(), adreno_dev->preempt.trigger_time));
 
 	/* Clean up all the bits */
 	adreno_dev->prev_rb = adreno_dev->cur_rb;
@@ -169,26 +171,40 @@ static void _a5xx_preemption_timer(unsigned long data)
 	queue_work(system_unbound_wq, &adreno_dev->preempt.work);
 }
 
-/* Find the highest priority active ringbuffer */
+/*
+ * Find the active ringbuffer whose deadline is the closest to being missed,
+ * or the highest priority active ringbuffer if no deadline is at risk
+ */
 static struct adreno_ringbuffer *a5xx_next_ringbuffer(
 		struct adreno_device *adreno_dev)
 {
-	struct adreno_ringbuffer *rb;
+	struct adreno_ringbuffer *rb, *next = NULL, *urgent = NULL;
+	u64 margin = (u64) adreno_dispatch_deadline_margin * NSEC_PER_MSEC;
+	u64 now = ktime_to_ns(ktime_get());
 	unsigned long flags;
 	unsigned int i;
 
 	FOR_EACH_RINGBUFFER(adreno_dev, rb, i) {
 		bool empty;
+		u64 deadline;
 
 		spin_lock_irqsave(&rb->preempt_lock, flags);
 		empty = adreno_rb_empty(rb);
 		spin_unlock_irqrestore(&rb->preempt_lock, flags);
 
-		if (empty == false)
-			return rb;
+		if (empty)
+			continue;
+
+		if (next == NULL)
+			next = rb;
+
+		deadline = ACCESS_ONCE(rb->deadline);
+		if (deadline && deadline <= now + margin &&
+			(urgent == NULL || deadline < urgent->deadline))
+			urgent = rb;
 	}
 
-	return NULL;
+	return urgent ? urgent : next;
 }
 
 void a5xx_preemption_trigger(struct adreno_device *adreno_dev)
@@ -269,6 +285,7 @@ void a5xx_preemption_trigger(struct adreno_device *adreno_dev)
 
 	trace_adreno_preempt_trigger(adreno_dev->cur_rb, adreno_dev->next_rb);
 
+	adreno_dev->preempt.trigger_time = ktime_get();
 	adreno_set_preempt_state(adreno_dev, ADRENO_PREEMPT_TRIGGERED);
 
 	/* Trigger the preemption */
@@ -304,6 +321,8 @@ void a5xx_preempt_callback(struct adreno_device *adreno_dev, int bit)
 
 	trace_adreno_preempt_done(adreno_dev->cur_rb,
 		adreno_dev->next_rb);
+	trace_adreno_preempt_latency(adreno_dev->cur_rb, adreno_dev->next_rb,
+		ktime_us_delta(ktime_get(), adreno_dev->preempt.trigger_time));
 
 	adreno_dev->prev_rb = adreno_dev->cur_rb;
 	adreno_dev->cur_rb = adreno_dev->next_rb;
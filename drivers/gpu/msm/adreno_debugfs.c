@@ -123,6 +123,37 @@ static int _active_count_get(void *data, u64 *val)
 
 DEFINE_SIMPLE_ATTRIBUTE(_active_count_fops, _active_count_get, NULL, "%llu\n");
 
+static int _coalesce_print(struct seq_file *s, void *unused)
+{
+	struct adreno_device *adreno_dev = s->private;
+	struct adreno_dispatcher *dispatcher = &adreno_dev->dispatcher;
+	u64 submissions = dispatcher->submissions;
+	u64 submitted = dispatcher->submitted;
+	u64 ratio = 0;
+
+	if (submissions)
+		ratio = div64_u64(submitted * 100, submissions);
+
+	seq_printf(s, "submissions: %llu\n", submissions);
+	seq_printf(s, "cmdbatches: %llu\n", submitted);
+	seq_printf(s, "ratio: %llu.%02llu\n", div_u64(ratio, 100),
+		ratio % 100);
+
+	return 0;
+}
+
+static int _coalesce_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, _coalesce_print, inode->i_private);
+}
+
+static const struct file_operations _coalesce_fops = {
+	.open = _coalesce_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 typedef void (*reg_read_init_t)(struct kgsl_device *device);
 typedef void (*reg_read_fill_t)(struct kgsl_device *device, int i,
 	unsigned int *vals, int linec);
@@ -292,6 +323,10 @@ static int ctx_print(struct seq_file *s, void *unused)
 		   queued, consumed, retired,
 		   drawctxt->internal_timestamp);
 
+	if (drawctxt->deadline_us)
+		seq_printf(s, "deadline: %u us missed: %u\n",
+			   drawctxt->deadline_us, drawctxt->deadline_misses);
+
 	seq_puts(s, "cmdqueue:\n");
 
 	spin_lock(&drawctxt->lock);
@@ -370,6 +405,8 @@ void adreno_debugfs_init(struct adreno_device *adreno_dev)
 
 	debugfs_create_file("active_cnt", 0444, device->d_debugfs, device,
 			    &_active_count_fops);
+	debugfs_create_file("coalesce", 0444, device->d_debugfs, adreno_dev,
+			    &_coalesce_fops);
 	adreno_dev->ctx_d_debugfs = debugfs_create_dir("ctx",
 							device->d_debugfs);
 
@@ -34,6 +34,12 @@ unsigned int adreno_dispatch_starvation_time = 2000;
 /* Amount of time in ms that a starved RB is permitted to execute for */
 unsigned int adreno_dispatch_time_slice = 25;
 
+/*
+ * Time in ms before a command deadline at which its RB is preempted in
+ * ahead of higher priority RBs
+ */
+unsigned int adreno_dispatch_deadline_margin = 4;
+
 /*
  * If set then dispatcher tries to schedule lower priority RB's after if they
  * have commands in their pipe and have been inactive for
@@ -52,6 +58,12 @@ static unsigned int _context_queue_wait = 10000;
 /* Number of command batches sent at a time from a single context */
 static unsigned int _context_cmdbatch_burst = 5;
 
+/* Maximum number of command batches to group in one submission */
+static unsigned int _cmdbatch_coalesce_count = 4;
+
+/* Only command batches with at most this many bytes of IBs are grouped */
+static unsigned int _cmdbatch_coalesce_size = 1024;
+
 /*
  * GFT throttle parameters. If GFT recovered more than
  * X times in Y ms invalidate the context and do not attempt recovery.
@@ -549,26 +561,48 @@ static void  dispatcher_queue_context(struct adreno_device *adreno_dev,
 	spin_unlock(&dispatcher->plist_lock);
 }
 
+/* Recompute the earliest deadline of the commands inflight in @rb */
+static void _update_rb_deadline(struct adreno_ringbuffer *rb)
+{
+	struct adreno_dispatcher_cmdqueue *cmdqueue = &rb->dispatch_q;
+	u64 deadline = 0;
+	unsigned int i;
+
+	for (i = cmdqueue->head; i != cmdqueue->tail;
+		i = CMDQUEUE_NEXT(i, ADRENO_DISPATCH_CMDQUEUE_SIZE)) {
+		u64 d = cmdqueue->cmd_q[i]->deadline;
+
+		if (d && (!deadline || d < deadline))
+			deadline = d;
+	}
+
+	ACCESS_ONCE(rb->deadline) = deadline;
+}
+
 /**
- * sendcmd() - Send a command batch to the GPU hardware
- * @dispatcher: Pointer to the adreno dispatcher struct
- * @cmdbatch: Pointer to the KGSL cmdbatch being sent
+ * sendcmds() - Send a group of command batches to the GPU hardware
+ * @adreno_dev: Pointer to the adreno device struct
+ * @cmdbatches: Command batches from a single context, in timestamp order
+ * @count: Number of command batches in @cmdbatches
  *
- * Send a KGSL command batch to the GPU hardware
+ * Send one or more KGSL command batches to the GPU hardware in a single
+ * ringbuffer submission. Each command batch is tracked in the dispatch queue
+ * on its own so that retire and fault handling stay per command batch.
  */
-static int sendcmd(struct adreno_device *adreno_dev,
-	struct kgsl_cmdbatch *cmdbatch)
+static int sendcmds(struct adreno_device *adreno_dev,
+	struct kgsl_cmdbatch **cmdbatches, int count)
 {
 	struct kgsl_device *device = KGSL_DEVICE(adreno_dev);
 	struct adreno_gpudev *gpudev = ADRENO_GPU_DEVICE(adreno_dev);
 	struct adreno_dispatcher *dispatcher = &adreno_dev->dispatcher;
+	struct kgsl_cmdbatch *cmdbatch = cmdbatches[0];
 	struct adreno_context *drawctxt = ADRENO_CONTEXT(cmdbatch->context);
 	struct adreno_dispatcher_cmdqueue *dispatch_q =
 				ADRENO_CMDBATCH_DISPATCH_CMDQUEUE(cmdbatch);
 	struct adreno_submit_time time;
 	uint64_t secs = 0;
 	unsigned long nsecs = 0;
-	int ret;
+	int i, ret;
 
 	mutex_lock(&device->mutex);
 	if (adreno_gpu_halt(adreno_dev) != 0) {
@@ -576,16 +610,16 @@ static int sendcmd(struct adreno_device *adreno_dev,
 		return -EBUSY;
 	}
 
-	dispatcher->inflight++;
-	dispatch_q->inflight++;
+	dispatcher->inflight += count;
+	dispatch_q->inflight += count;
 
-	if (dispatcher->inflight == 1 &&
+	if (dispatcher->inflight == count &&
 			!test_bit(ADRENO_DISPATCHER_POWER, &dispatcher->priv)) {
 		/* Time to make the donuts.  Turn on the GPU */
 		ret = kgsl_active_count_get(device);
 		if (ret) {
-			dispatcher->inflight--;
-			dispatch_q->inflight--;
+			dispatcher->inflight -= count;
+			dispatch_q->inflight -= count;
 			mutex_unlock(&device->mutex);
 			return ret;
 		}
@@ -593,22 +627,28 @@ static int sendcmd(struct adreno_device *adreno_dev,
 		set_bit(ADRENO_DISPATCHER_POWER, &dispatcher->priv);
 	}
 
-	if (test_bit(ADRENO_DEVICE_CMDBATCH_PROFILE, &adreno_dev->priv)) {
-		set_bit(CMDBATCH_FLAG_PROFILE, &cmdbatch->priv);
-		cmdbatch->profile_index = adreno_dev->cmdbatch_profile_index;
-		adreno_dev->cmdbatch_profile_index =
-			(adreno_dev->cmdbatch_profile_index + 1) %
-			ADRENO_CMDBATCH_PROFILE_COUNT;
-	}
+	if (count == 1) {
+		if (test_bit(ADRENO_DEVICE_CMDBATCH_PROFILE,
+				&adreno_dev->priv)) {
+			set_bit(CMDBATCH_FLAG_PROFILE, &cmdbatch->priv);
+			cmdbatch->profile_index =
+				adreno_dev->cmdbatch_profile_index;
+			adreno_dev->cmdbatch_profile_index =
+				(adreno_dev->cmdbatch_profile_index + 1) %
+				ADRENO_CMDBATCH_PROFILE_COUNT;
+		}
 
-	ret = adreno_ringbuffer_submitcmd(adreno_dev, cmdbatch, &time);
+		ret = adreno_ringbuffer_submitcmd(adreno_dev, cmdbatch, &time);
+	} else
+		ret = adreno_ringbuffer_submitcmds(adreno_dev, cmdbatches,
+			count, &time);
 
 	/*
 	 * On the first command, if the submission was successful, then read the
 	 * fault registers.  If it failed then turn off the GPU. Sad face.
 	 */
 
-	if (dispatcher->inflight == 1) {
+	if (dispatcher->inflight == count) {
 		if (ret == 0) {
 
 			/* Stop fault timer before reading fault registers */
@@ -630,8 +670,8 @@ static int sendcmd(struct adreno_device *adreno_dev,
 
 
 	if (ret) {
-		dispatcher->inflight--;
-		dispatch_q->inflight--;
+		dispatcher->inflight -= count;
+		dispatch_q->inflight -= count;
 
 		mutex_unlock(&device->mutex);
 
@@ -654,17 +694,36 @@ static int sendcmd(struct adreno_device *adreno_dev,
 	secs = time.ktime;
 	nsecs = do_div(secs, 1000000000);
 
-	trace_adreno_cmdbatch_submitted(cmdbatch, (int) dispatcher->inflight,
-		time.ticks, (unsigned long) secs, nsecs / 1000, drawctxt->rb,
-		adreno_get_rptr(drawctxt->rb));
+	for (i = 0; i < count; i++)
+		trace_adreno_cmdbatch_submitted(cmdbatches[i],
+			(int) dispatcher->inflight, time.ticks,
+			(unsigned long) secs, nsecs / 1000, drawctxt->rb,
+			adreno_get_rptr(drawctxt->rb));
+
+	dispatcher->submissions++;
+	dispatcher->submitted += count;
 
 	mutex_unlock(&device->mutex);
 
-	cmdbatch->submit_ticks = time.ticks;
+	for (i = 0; i < count; i++) {
+		cmdbatch = cmdbatches[i];
+		cmdbatch->submit_ticks = time.ticks;
+		cmdbatch->submit_ns = time.ktime;
+		if (time.ktime > cmdbatch->queued_ns)
+			kgsl_context_latency_add(cmdbatch->context,
+				KGSL_LATENCY_QUEUE,
+				div_u64(time.ktime - cmdbatch->queued_ns,
+					NSEC_PER_USEC));
+
+		dispatch_q->cmd_q[dispatch_q->tail] = cmdbatch;
+		dispatch_q->tail = (dispatch_q->tail + 1) %
+			ADRENO_DISPATCH_CMDQUEUE_SIZE;
 
-	dispatch_q->cmd_q[dispatch_q->tail] = cmdbatch;
-	dispatch_q->tail = (dispatch_q->tail + 1) %
-		ADRENO_DISPATCH_CMDQUEUE_SIZE;
+		if (cmdbatch->deadline && (!drawctxt->rb->deadline ||
+			cmdbatch->deadline < drawctxt->rb->deadline))
+			ACCESS_ONCE(drawctxt->rb->deadline) =
+				cmdbatch->deadline;
+	}
 
 	/*
 	 * For the first submission in any given command queue update the
@@ -673,7 +732,7 @@ static int sendcmd(struct adreno_device *adreno_dev,
 	 * it here avoids the possibilty of some race conditions with preempt
 	 */
 
-	if (dispatch_q->inflight == 1)
+	if (dispatch_q->inflight == count)
 		dispatch_q->expires = jiffies +
 			msecs_to_jiffies(adreno_cmdbatch_timeout);
 
@@ -697,6 +756,81 @@ static int sendcmd(struct adreno_device *adreno_dev,
 	return 0;
 }
 
+/**
+ * sendcmd() - Send a command batch to the GPU hardware
+ * @adreno_dev: Pointer to the adreno device struct
+ * @cmdbatch: Pointer to the KGSL cmdbatch being sent
+ *
+ * Send a KGSL command batch to the GPU hardware
+ */
+static inline int sendcmd(struct adreno_device *adreno_dev,
+	struct kgsl_cmdbatch *cmdbatch)
+{
+	return sendcmds(adreno_dev, &cmdbatch, 1);
+}
+
+/*
+ * Small command batches can share a ringbuffer submission with the ones
+ * queued behind them. Grouping is limited to plain rendering commands that
+ * need no per command batch handling in the ringbuffer.
+ */
+static bool _cmdbatch_can_coalesce(struct adreno_device *adreno_dev,
+		struct kgsl_cmdbatch *cmdbatch)
+{
+	struct adreno_context *drawctxt = ADRENO_CONTEXT(cmdbatch->context);
+	struct kgsl_memobj_node *ib;
+	uint64_t size = 0;
+
+	if (_cmdbatch_coalesce_count < 2)
+		return false;
+
+	if (cmdbatch->flags & (KGSL_CMDBATCH_MARKER | KGSL_CMDBATCH_SYNC |
+		KGSL_CMDBATCH_PROFILING))
+		return false;
+
+	if (test_bit(CMDBATCH_FLAG_SKIP, &cmdbatch->priv) ||
+		test_bit(CMDBATCH_FLAG_FORCE_PREAMBLE, &cmdbatch->priv) ||
+		test_bit(CMDBATCH_FLAG_WFI, &cmdbatch->priv))
+		return false;
+
+	if (test_bit(ADRENO_DEVICE_CMDBATCH_PROFILE, &adreno_dev->priv) ||
+		test_bit(ADRENO_CONTEXT_SKIP_CMD, &drawctxt->base.priv))
+		return false;
+
+	list_for_each_entry(ib, &cmdbatch->cmdlist, node)
+		size += ib->size;
+
+	return size && size <= _cmdbatch_coalesce_size;
+}
+
+/*
+ * Pop the command batch at the head of the context queue if it is ready to
+ * go and can be added to the submission being built
+ */
+static struct kgsl_cmdbatch *_get_coalesce_cmdbatch(
+		struct adreno_device *adreno_dev,
+		struct adreno_context *drawctxt)
+{
+	struct kgsl_cmdbatch *cmdbatch = NULL;
+
+	spin_lock(&drawctxt->lock);
+	if (drawctxt->cmdqueue_head != drawctxt->cmdqueue_tail) {
+		cmdbatch = drawctxt->cmdqueue[drawctxt->cmdqueue_head];
+
+		if (kgsl_cmdbatch_events_pending(cmdbatch) ||
+			!_cmdbatch_can_coalesce(adreno_dev, cmdbatch))
+			cmdbatch = NULL;
+		else
+			_pop_cmdbatch(drawctxt);
+	}
+	spin_unlock(&drawctxt->lock);
+
+	if (cmdbatch)
+		del_timer_sync(&cmdbatch->timer);
+
+	return cmdbatch;
+}
+
 /**
  * dispatcher_context_sendcmds() - Send commands from a context to the GPU
  * @adreno_dev: Pointer to the adreno device struct
@@ -715,6 +849,8 @@ static int dispatcher_context_sendcmds(struct adreno_device *adreno_dev,
 	int ret = 0;
 	int inflight = _cmdqueue_inflight(dispatch_q);
 	unsigned int timestamp;
+	struct kgsl_cmdbatch *batch[ADRENO_DISPATCH_COALESCE_MAX];
+	int i, n;
 
 	if (dispatch_q->inflight >= inflight) {
 		expire_markers(drawctxt);
@@ -758,28 +894,51 @@ static int dispatcher_context_sendcmds(struct adreno_device *adreno_dev,
 			continue;
 		}
 
-		timestamp = cmdbatch->timestamp;
+		/*
+		 * Gather the small command batches queued right behind this
+		 * one so that they all go out in a single submission
+		 */
+		batch[0] = cmdbatch;
+		n = 1;
+
+		if (_cmdbatch_can_coalesce(adreno_dev, cmdbatch)) {
+			while (n < _cmdbatch_coalesce_count &&
+				(dispatch_q->inflight + n < inflight)) {
+				cmdbatch = _get_coalesce_cmdbatch(adreno_dev,
+					drawctxt);
+				if (cmdbatch == NULL)
+					break;
+
+				batch[n++] = cmdbatch;
+			}
+		}
+
+		timestamp = batch[n - 1]->timestamp;
 
-		ret = sendcmd(adreno_dev, cmdbatch);
+		ret = sendcmds(adreno_dev, batch, n);
 
 		/*
-		 * On error from sendcmd() try to requeue the command batch
+		 * On error from sendcmds() try to requeue the command batches
 		 * unless we got back -ENOENT which means that the context has
 		 * been detached and there will be no more deliveries from here
 		 */
 		if (ret != 0) {
-			/* Destroy the cmdbatch on -ENOENT */
-			if (ret == -ENOENT)
-				kgsl_cmdbatch_destroy(cmdbatch);
-			else {
-				/*
-				 * If the requeue returns an error, return that
-				 * instead of whatever sendcmd() sent us
-				 */
-				int r = adreno_dispatcher_requeue_cmdbatch(
-					drawctxt, cmdbatch);
-				if (r)
-					ret = r;
+			/* Requeue in reverse order to keep the queue order */
+			for (i = n - 1; i >= 0; i--) {
+				/* Destroy the cmdbatch on -ENOENT */
+				if (ret == -ENOENT)
+					kgsl_cmdbatch_destroy(batch[i]);
+				else {
+					/*
+					 * If the requeue returns an error,
+					 * return that instead of whatever
+					 * sendcmds() sent us
+					 */
+					int r = adreno_dispatcher_requeue_cmdbatch(
+						drawctxt, batch[i]);
+					if (r)
+						ret = r;
+				}
 			}
 
 			break;
@@ -787,7 +946,7 @@ static int dispatcher_context_sendcmds(struct adreno_device *adreno_dev,
 
 		drawctxt->submitted_timestamp = timestamp;
 
-		count++;
+		count += n;
 	}
 
 	/*
@@ -1039,6 +1198,10 @@ int adreno_dispatcher_queue_cmd(struct adreno_device *adreno_dev,
 	if (drawctxt->base.flags & KGSL_CONTEXT_IFH_NOP)
 		set_bit(CMDBATCH_FLAG_SKIP, &cmdbatch->priv);
 
+	if (drawctxt->deadline_us)
+		cmdbatch->deadline = ktime_to_ns(ktime_add_us(ktime_get(),
+			drawctxt->deadline_us));
+
 	/*
 	 * If we are waiting for the end of frame and it hasn't appeared yet,
 	 * then mark the command batch as skipped.  It will still progress
@@ -1154,6 +1317,7 @@ int adreno_dispatcher_queue_cmd(struct adreno_device *adreno_dev,
 		cmdbatch->fault_policy = adreno_dev->ft_policy;
 
 	/* Put the command into the queue */
+	cmdbatch->queued_ns = local_clock();
 	drawctxt->cmdqueue[drawctxt->cmdqueue_tail] = cmdbatch;
 	drawctxt->cmdqueue_tail = (drawctxt->cmdqueue_tail + 1) %
 		ADRENO_CONTEXT_CMDQUEUE_SIZE;
@@ -2007,6 +2171,34 @@ static void cmdbatch_profile_ticks(struct adreno_device *adreno_dev,
 	*retire = entry->retired;
 }
 
+/*
+ * The GPU time comes from the alwayson counter (19.2 MHz) when the cmdbatch
+ * was profiled. Otherwise the GPU is assumed to have started on it when
+ * it was submitted or when the previous one on the RB retired, whichever
+ * is later, which overestimates by the dispatcher's retire delay.
+ */
+static void cmdbatch_latency(struct kgsl_cmdbatch *cmdbatch,
+		uint64_t start, uint64_t end)
+{
+	struct adreno_ringbuffer *rb = ADRENO_CMDBATCH_RB(cmdbatch);
+	u64 now = local_clock();
+	u64 gpu_start = max(cmdbatch->submit_ns, rb->retire_ns);
+
+	if (now > cmdbatch->submit_ns)
+		kgsl_context_latency_add(cmdbatch->context,
+			KGSL_LATENCY_RETIRE,
+			div_u64(now - cmdbatch->submit_ns, NSEC_PER_USEC));
+
+	if (end > start)
+		kgsl_context_latency_add(cmdbatch->context, KGSL_LATENCY_GPU,
+			div_u64((end - start) * 10, 192));
+	else if (now > gpu_start)
+		kgsl_context_latency_add(cmdbatch->context, KGSL_LATENCY_GPU,
+			div_u64(now - gpu_start, NSEC_PER_USEC));
+
+	rb->retire_ns = now;
+}
+
 static void retire_cmdbatch(struct adreno_device *adreno_dev,
 		struct kgsl_cmdbatch *cmdbatch)
 {
@@ -2041,6 +2233,23 @@ static void retire_cmdbatch(struct adreno_device *adreno_dev,
 				ADRENO_CMDBATCH_RB(cmdbatch),
 				adreno_get_rptr(drawctxt->rb));
 
+	if (cmdbatch->deadline) {
+		s64 late = ktime_to_ns(ktime_get()) - cmdbatch->deadline;
+
+		if (late > 0) {
+			drawctxt->deadline_misses++;
+			trace_adreno_cmdbatch_deadline_miss(cmdbatch,
+				ADRENO_CMDBATCH_RB(cmdbatch),
+				div_s64(late, NSEC_PER_USEC));
+		}
+	}
+
+	if (cmdbatch->flags & KGSL_CMDBATCH_END_OF_FRAME)
+		kgsl_pwrscale_frame_done(KGSL_DEVICE(adreno_dev),
+			drawctxt->deadline_us);
+
+	cmdbatch_latency(cmdbatch, start, end);
+
 	drawctxt->submit_retire_ticks[drawctxt->ticks_index] =
 		end - cmdbatch->submit_ticks;
 
@@ -2078,6 +2287,9 @@ static int adreno_dispatch_retire_cmdqueue(struct adreno_device *adreno_dev,
 		count++;
 	}
 
+	if (count)
+		_update_rb_deadline(CMDQUEUE_RB(cmdqueue));
+
 	return count;
 }
 
@@ -2462,6 +2674,12 @@ static DISPATCHER_UINT_ATTR(dispatch_time_slice, 0644, 0,
 	adreno_dispatch_time_slice);
 static DISPATCHER_UINT_ATTR(dispatch_starvation_time, 0644, 0,
 	adreno_dispatch_starvation_time);
+static DISPATCHER_UINT_ATTR(dispatch_deadline_margin, 0644, 0,
+	adreno_dispatch_deadline_margin);
+static DISPATCHER_UINT_ATTR(cmdbatch_coalesce_count, 0644,
+	ADRENO_DISPATCH_COALESCE_MAX, _cmdbatch_coalesce_count);
+static DISPATCHER_UINT_ATTR(cmdbatch_coalesce_size, 0644, 0,
+	_cmdbatch_coalesce_size);
 
 static struct attribute *dispatcher_attrs[] = {
 	&dispatcher_attr_inflight.attr,
@@ -2476,6 +2694,9 @@ static struct attribute *dispatcher_attrs[] = {
 	&dispatcher_attr_disp_preempt_fair_sched.attr,
 	&dispatcher_attr_dispatch_time_slice.attr,
 	&dispatcher_attr_dispatch_starvation_time.attr,
+	&dispatcher_attr_dispatch_deadline_margin.attr,
+	&dispatcher_attr_cmdbatch_coalesce_count.attr,
+	&dispatcher_attr_cmdbatch_coalesce_size.attr,
 	NULL,
 };
 
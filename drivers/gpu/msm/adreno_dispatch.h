@@ -18,6 +18,7 @@ extern unsigned int adreno_disp_preempt_fair_sched;
 extern unsigned int adreno_cmdbatch_timeout;
 extern unsigned int adreno_dispatch_starvation_time;
 extern unsigned int adreno_dispatch_time_slice;
+extern unsigned int adreno_dispatch_deadline_margin;
 
 /**
  * enum adreno_dispatcher_starve_timer_states - Starvation control states of
@@ -46,6 +47,9 @@ enum adreno_dispatcher_starve_timer_states {
 
 #define ADRENO_DISPATCH_CMDQUEUE_SIZE 128
 
+/* Maximum number of command batches grouped in a ringbuffer submission */
+#define ADRENO_DISPATCH_COALESCE_MAX 16
+
 #define CMDQUEUE_NEXT(_i, _s) (((_i) + 1) % (_s))
 
 /**
@@ -81,6 +85,8 @@ struct adreno_dispatcher_cmdqueue {
  * @disp_preempt_fair_sched: If set then dispatcher will try to be fair to
  * starving RB's by scheduling them in and enforcing a minimum time slice
  * for every RB that is scheduled to run on the device
+ * @submissions: Number of ringbuffer submissions made by the dispatcher
+ * @submitted: Number of command batches sent in those submissions
  */
 struct adreno_dispatcher {
 	struct mutex mutex;
@@ -95,6 +101,8 @@ struct adreno_dispatcher {
 	struct kobject kobj;
 	struct completion idle_gate;
 	unsigned int disp_preempt_fair_sched;
+	u64 submissions;
+	u64 submitted;
 };
 
 enum adreno_dispatcher_flags {
@@ -52,6 +52,8 @@ struct kgsl_context;
  *		 be written.
  * @active_node: Linkage for nodes in active_list
  * @active_time: Time when this context last seen
+ * @deadline_us: Frame deadline set by KGSL_PROP_CONTEXT_DEADLINE, 0 if none
+ * @deadline_misses: Number of commands that retired past their deadline
  */
 struct adreno_context {
 	struct kgsl_context base;
@@ -81,6 +83,8 @@ struct adreno_context {
 
 	struct list_head active_node;
 	unsigned long active_time;
+	unsigned int deadline_us;
+	unsigned int deadline_misses;
 };
 
 /* Flag definitions for flag field in adreno_context */
@@ -80,6 +80,20 @@ static long adreno_ioctl_perfcounter_read(struct kgsl_device_private *dev_priv,
 		read->count);
 }
 
+long adreno_ioctl_perfcounter_sample(struct kgsl_device_private *dev_priv,
+		unsigned int cmd, void *data)
+{
+	struct adreno_device *adreno_dev = ADRENO_DEVICE(dev_priv->device);
+	struct kgsl_perfcounter_sample *sample = data;
+
+	if (sample->count == 0)
+		return (long) adreno_perfcounter_sample_stop(adreno_dev,
+			dev_priv->process_priv);
+
+	return (long) adreno_perfcounter_sample_start(adreno_dev,
+		dev_priv->process_priv, sample);
+}
+
 static long adreno_ioctl_preemption_counters_query(
 		struct kgsl_device_private *dev_priv,
 		unsigned int cmd, void *data)
@@ -158,6 +172,7 @@ static struct kgsl_ioctl adreno_ioctl_funcs[] = {
 	{ IOCTL_KGSL_PERFCOUNTER_READ, adreno_ioctl_perfcounter_read },
 	{ IOCTL_KGSL_PREEMPTIONCOUNTER_QUERY,
 		adreno_ioctl_preemption_counters_query },
+	{ IOCTL_KGSL_PERFCOUNTER_SAMPLE, adreno_ioctl_perfcounter_sample },
 };
 
 long adreno_ioctl(struct kgsl_device_private *dev_priv,
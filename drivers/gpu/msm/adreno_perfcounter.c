@@ -18,6 +18,7 @@
 #include "adreno_perfcounter.h"
 #include "adreno_pm4types.h"
 #include "a5xx_reg.h"
+#include "adreno_trace.h"
 
 /* Bit flag for RBMM_PERFCTR_CTL */
 #define RBBM_PERFCTR_CTL_ENABLE		0x00000001
@@ -1030,3 +1031,331 @@ uint64_t adreno_perfcounter_read(struct adreno_device *adreno_dev,
 		return _perfcounter_read_default(adreno_dev, group, counter);
 	}
 }
+
+/* Release the counters reserved for sampling, device mutex held */
+static void _sampler_put_counters(struct adreno_device *adreno_dev,
+		unsigned int count)
+{
+	struct adreno_perfcounter_sampler *sampler = &adreno_dev->sampler;
+	unsigned int i;
+
+	for (i = 0; i < count; i++)
+		adreno_perfcounter_put(adreno_dev, sampler->groupid[i],
+			sampler->countable[i], PERFCOUNTER_FLAG_KERNEL);
+}
+
+/* Reserve the counters to sample and find their registers */
+static int _sampler_get_counters(struct adreno_device *adreno_dev)
+{
+	struct adreno_perfcounter_sampler *sampler = &adreno_dev->sampler;
+	struct kgsl_device *device = KGSL_DEVICE(adreno_dev);
+	struct adreno_perfcounters *counters = ADRENO_PERFCOUNTERS(adreno_dev);
+	struct adreno_perfcount_group *group;
+	unsigned int i, j;
+	int ret;
+
+	mutex_lock(&device->mutex);
+
+	/* See adreno_ioctl_perfcounter_get() */
+	ret = kgsl_active_count_get(device);
+	if (ret)
+		goto done;
+
+	for (i = 0; i < sampler->count; i++) {
+		ret = adreno_perfcounter_get(adreno_dev, sampler->groupid[i],
+			sampler->countable[i], NULL, NULL,
+			PERFCOUNTER_FLAG_KERNEL);
+		if (ret)
+			break;
+
+		group = &counters->groups[sampler->groupid[i]];
+
+		for (j = 0; j < group->reg_count; j++) {
+			if (group->regs[j].countable == sampler->countable[i])
+				break;
+		}
+
+		sampler->counter[i] = j;
+	}
+
+	if (ret)
+		_sampler_put_counters(adreno_dev, i);
+
+	kgsl_active_count_put(device);
+done:
+	mutex_unlock(&device->mutex);
+	return ret;
+}
+
+/* Stop sampling and drop the ring buffer, sampler lock held */
+static void _sampler_stop(struct adreno_device *adreno_dev)
+{
+	struct adreno_perfcounter_sampler *sampler = &adreno_dev->sampler;
+	struct kgsl_device *device = KGSL_DEVICE(adreno_dev);
+
+	if (sampler->entry == NULL)
+		return;
+
+	cancel_delayed_work(&sampler->work);
+
+	mutex_lock(&device->mutex);
+	_sampler_put_counters(adreno_dev, sampler->count);
+	mutex_unlock(&device->mutex);
+
+	kgsl_memdesc_unmap(&sampler->entry->memdesc);
+	kgsl_mem_entry_put(sampler->entry);
+
+	sampler->entry = NULL;
+	sampler->owner = NULL;
+	sampler->header = NULL;
+	sampler->count = 0;
+}
+
+/* Write one record into the sample ring, sampler lock held */
+static void _sampler_record(struct adreno_device *adreno_dev)
+{
+	struct adreno_perfcounter_sampler *sampler = &adreno_dev->sampler;
+	struct kgsl_device *device = KGSL_DEVICE(adreno_dev);
+	struct adreno_perfcounters *counters = ADRENO_PERFCOUNTERS(adreno_dev);
+	struct kgsl_perfcounter_sample_header *header = sampler->header;
+	struct kgsl_perfcounter_sample_record *record;
+	uint64_t *values;
+	unsigned int i;
+
+	record = (void *) (header + 1) +
+		(header->head % header->records) * header->record_size;
+	values = (uint64_t *) (record + 1);
+
+	record->ktime = ktime_get_ns();
+	record->ticks = 0;
+	record->flags = 0;
+
+	mutex_lock(&device->mutex);
+
+	/*
+	 * Don't wake the GPU just to sample it. While it is powered down the
+	 * counters hold the values saved by adreno_perfcounter_save().
+	 */
+	if (device->state == KGSL_STATE_ACTIVE ||
+		device->state == KGSL_STATE_NAP) {
+		if (kgsl_active_count_get(device)) {
+			mutex_unlock(&device->mutex);
+			header->dropped++;
+			return;
+		}
+
+		adreno_readreg64(adreno_dev,
+			ADRENO_REG_RBBM_ALWAYSON_COUNTER_LO,
+			ADRENO_REG_RBBM_ALWAYSON_COUNTER_HI, &record->ticks);
+
+		for (i = 0; i < sampler->count; i++)
+			values[i] = adreno_perfcounter_read(adreno_dev,
+				sampler->groupid[i], sampler->counter[i]);
+
+		kgsl_active_count_put(device);
+	} else {
+		record->flags = KGSL_PERFCOUNTER_SAMPLE_IDLE;
+
+		for (i = 0; i < sampler->count; i++) {
+			struct adreno_perfcount_group *group =
+				&counters->groups[sampler->groupid[i]];
+
+			values[i] = group->regs[sampler->counter[i]].value;
+		}
+	}
+
+	mutex_unlock(&device->mutex);
+
+	for (i = 0; i < sampler->count; i++)
+		trace_adreno_perfcounter_sample(sampler->groupid[i],
+			sampler->countable[i], values[i], record->ticks);
+
+	/* Make the record visible before publishing it */
+	smp_wmb();
+	header->head++;
+}
+
+static void _sampler_worker(struct work_struct *work)
+{
+	struct adreno_perfcounter_sampler *sampler = container_of(work,
+		struct adreno_perfcounter_sampler, work.work);
+	struct adreno_device *adreno_dev = container_of(sampler,
+		struct adreno_device, sampler);
+
+	mutex_lock(&sampler->lock);
+
+	if (sampler->entry == NULL)
+		goto done;
+
+	/* Stop once the ring is freed by its owner or the owner exits */
+	if (ACCESS_ONCE(sampler->entry->pending_free)) {
+		_sampler_stop(adreno_dev);
+		goto done;
+	}
+
+	_sampler_record(adreno_dev);
+
+	queue_delayed_work(kgsl_driver.workqueue, &sampler->work,
+		sampler->period);
+done:
+	mutex_unlock(&sampler->lock);
+}
+
+/**
+ * adreno_perfcounter_sample_start() - Start sampling performance counters
+ * @adreno_dev: Adreno device to sample
+ * @process: Process that owns the sample ring
+ * @sample: The counters, period and ring to use
+ *
+ * Reserve the requested counters and start writing their values into the
+ * GPU memory object @sample->id every @sample->period_us. Returns 0 on success
+ * or -EBUSY if another sampling session is active.
+ */
+int adreno_perfcounter_sample_start(struct adreno_device *adreno_dev,
+	struct kgsl_process_private *process,
+	struct kgsl_perfcounter_sample *sample)
+{
+	struct adreno_perfcounter_sampler *sampler = &adreno_dev->sampler;
+	struct adreno_perfcounters *counters = ADRENO_PERFCOUNTERS(adreno_dev);
+	struct kgsl_perfcounter_sample_header *header;
+	struct kgsl_perfcounter_read_group *list;
+	struct kgsl_mem_entry *entry;
+	unsigned int i, record_size;
+	uint64_t records;
+	int ret = 0;
+
+	if (counters == NULL)
+		return -EINVAL;
+
+	if (sample->count > KGSL_PERFCOUNTER_SAMPLE_MAX ||
+		sample->period_us == 0)
+		return -EINVAL;
+
+	list = kcalloc(sample->count, sizeof(*list), GFP_KERNEL);
+	if (list == NULL)
+		return -ENOMEM;
+
+	if (copy_from_user(list, to_user_ptr(sample->counters),
+			sample->count * sizeof(*list))) {
+		ret = -EFAULT;
+		goto free;
+	}
+
+	for (i = 0; i < sample->count; i++) {
+		if (list[i].groupid >= counters->group_count) {
+			ret = -EINVAL;
+			goto free;
+		}
+	}
+
+	entry = kgsl_sharedmem_find_id(process, sample->id);
+	if (entry == NULL) {
+		ret = -EINVAL;
+		goto free;
+	}
+
+	record_size = sizeof(struct kgsl_perfcounter_sample_record) +
+		sample->count * sizeof(uint64_t);
+
+	records = (entry->memdesc.size > sizeof(*header)) ?
+		div_u64(entry->memdesc.size - sizeof(*header), record_size) : 0;
+
+	if (records == 0 || records > UINT_MAX ||
+		kgsl_memdesc_is_secured(&entry->memdesc)) {
+		ret = -EINVAL;
+		goto put;
+	}
+
+	header = kgsl_memdesc_map(&entry->memdesc);
+	if (header == NULL) {
+		ret = -ENOMEM;
+		goto put;
+	}
+
+	mutex_lock(&sampler->lock);
+
+	if (sampler->entry != NULL) {
+		ret = -EBUSY;
+		goto unlock;
+	}
+
+	sampler->count = sample->count;
+	for (i = 0; i < sample->count; i++) {
+		sampler->groupid[i] = list[i].groupid;
+		sampler->countable[i] = list[i].countable;
+	}
+
+	ret = _sampler_get_counters(adreno_dev);
+	if (ret) {
+		sampler->count = 0;
+		goto unlock;
+	}
+
+	header->head = 0;
+	header->records = (unsigned int) records;
+	header->record_size = record_size;
+	header->count = sample->count;
+	header->dropped = 0;
+
+	sampler->entry = entry;
+	sampler->owner = process;
+	sampler->header = header;
+	sampler->period = max_t(unsigned long, 1,
+		usecs_to_jiffies(sample->period_us));
+
+	queue_delayed_work(kgsl_driver.workqueue, &sampler->work, 0);
+unlock:
+	mutex_unlock(&sampler->lock);
+	if (ret)
+		kgsl_memdesc_unmap(&entry->memdesc);
+put:
+	/* On success the reference is dropped when sampling stops */
+	if (ret)
+		kgsl_mem_entry_put(entry);
+free:
+	kfree(list);
+	return ret;
+}
+
+/**
+ * adreno_perfcounter_sample_stop() - Stop sampling performance counters
+ * @adreno_dev: Adreno device being sampled
+ * @process: Process that started the sampling
+ *
+ * Stop the sampling session started by @process and release its counters.
+ */
+int adreno_perfcounter_sample_stop(struct adreno_device *adreno_dev,
+	struct kgsl_process_private *process)
+{
+	struct adreno_perfcounter_sampler *sampler = &adreno_dev->sampler;
+	int ret = 0;
+
+	mutex_lock(&sampler->lock);
+
+	if (sampler->entry == NULL || sampler->owner != process)
+		ret = -EINVAL;
+	else
+		_sampler_stop(adreno_dev);
+
+	mutex_unlock(&sampler->lock);
+	return ret;
+}
+
+void adreno_perfcounter_sampler_init(struct adreno_device *adreno_dev)
+{
+	struct adreno_perfcounter_sampler *sampler = &adreno_dev->sampler;
+
+	mutex_init(&sampler->lock);
+	INIT_DELAYED_WORK(&sampler->work, _sampler_worker);
+}
+
+void adreno_perfcounter_sampler_close(struct adreno_device *adreno_dev)
+{
+	struct adreno_perfcounter_sampler *sampler = &adreno_dev->sampler;
+
+	mutex_lock(&sampler->lock);
+	_sampler_stop(adreno_dev);
+	mutex_unlock(&sampler->lock);
+
+	cancel_delayed_work_sync(&sampler->work);
+}
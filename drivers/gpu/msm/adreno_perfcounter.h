@@ -90,6 +90,32 @@ struct adreno_invalid_countables {
 	int num_countables;
 };
 
+/**
+ * struct adreno_perfcounter_sampler - Periodic performance counter sampling
+ * @lock: Protects the sampler state
+ * @work: Delayed work that takes a sample every @period
+ * @entry: GPU memory object holding the sample ring, NULL when stopped
+ * @owner: Process that started the sampling
+ * @header: Kernel mapping of the sample ring
+ * @period: Sampling period in jiffies
+ * @count: Number of counters sampled
+ * @groupid: Group of each sampled counter
+ * @countable: Countable of each sampled counter
+ * @counter: Register index of each sampled counter within its group
+ */
+struct adreno_perfcounter_sampler {
+	struct mutex lock;
+	struct delayed_work work;
+	struct kgsl_mem_entry *entry;
+	struct kgsl_process_private *owner;
+	struct kgsl_perfcounter_sample_header *header;
+	unsigned long period;
+	unsigned int count;
+	unsigned int groupid[KGSL_PERFCOUNTER_SAMPLE_MAX];
+	unsigned int countable[KGSL_PERFCOUNTER_SAMPLE_MAX];
+	unsigned int counter[KGSL_PERFCOUNTER_SAMPLE_MAX];
+};
+
 #define ADRENO_PERFCOUNTER_GROUP_FLAGS(core, offset, name, flags) \
 	[KGSL_PERFCOUNTER_GROUP_##offset] = { core##_perfcounters_##name, \
 	ARRAY_SIZE(core##_perfcounters_##name), __stringify(name), flags }
@@ -138,4 +164,15 @@ int adreno_perfcounter_get(struct adreno_device *adreno_dev,
 int adreno_perfcounter_put(struct adreno_device *adreno_dev,
 	unsigned int groupid, unsigned int countable, unsigned int flags);
 
+void adreno_perfcounter_sampler_init(struct adreno_device *adreno_dev);
+
+int adreno_perfcounter_sample_start(struct adreno_device *adreno_dev,
+	struct kgsl_process_private *process,
+	struct kgsl_perfcounter_sample *sample);
+
+int adreno_perfcounter_sample_stop(struct adreno_device *adreno_dev,
+	struct kgsl_process_private *process);
+
+void adreno_perfcounter_sampler_close(struct adreno_device *adreno_dev);
+
 #endif /* __ADRENO_PERFCOUNTER_H */
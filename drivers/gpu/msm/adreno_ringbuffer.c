@@ -822,6 +822,39 @@ static inline int _get_alwayson_counter(struct adreno_device *adreno_dev,
 	return (unsigned int)(p - cmds);
 }
 
+/*
+ * Emit the indirect buffers of @cmdbatch into @cmds. The preamble IB is only
+ * executed if @use_preamble is set. Returns the number of dwords written.
+ */
+static unsigned int _add_ibs(struct adreno_device *adreno_dev,
+		struct kgsl_cmdbatch *cmdbatch, unsigned int *cmds,
+		bool use_preamble)
+{
+	struct kgsl_memobj_node *ib;
+	unsigned int *start = cmds;
+
+	list_for_each_entry(ib, &cmdbatch->cmdlist, node) {
+		/*
+		 * Skip 0 sized IBs - these are presumed to have been
+		 * removed from consideration by the FT policy
+		 */
+		if (ib->priv & MEMOBJ_SKIP ||
+			(ib->priv & MEMOBJ_PREAMBLE &&
+			use_preamble == false))
+			*cmds++ = cp_mem_packet(adreno_dev, CP_NOP,
+					3, 1);
+
+		*cmds++ = cp_mem_packet(adreno_dev,
+				CP_INDIRECT_BUFFER_PFE, 2, 1);
+		cmds += cp_gpuaddr(adreno_dev, cmds, ib->gpuaddr);
+		*cmds++ = (unsigned int) ib->size >> 2;
+		/* preamble is required on only for first command */
+		use_preamble = false;
+	}
+
+	return cmds - start;
+}
+
 /* adreno_rindbuffer_submitcmd - submit userspace IBs to the GPU */
 int adreno_ringbuffer_submitcmd(struct adreno_device *adreno_dev,
 		struct kgsl_cmdbatch *cmdbatch, struct adreno_submit_time *time)
@@ -979,26 +1012,8 @@ int adreno_ringbuffer_submitcmd(struct adreno_device *adreno_dev,
 			gpu_ticks_submitted));
 	}
 
-	if (numibs) {
-		list_for_each_entry(ib, &cmdbatch->cmdlist, node) {
-			/*
-			 * Skip 0 sized IBs - these are presumed to have been
-			 * removed from consideration by the FT policy
-			 */
-			if (ib->priv & MEMOBJ_SKIP ||
-				(ib->priv & MEMOBJ_PREAMBLE &&
-				use_preamble == false))
-				*cmds++ = cp_mem_packet(adreno_dev, CP_NOP,
-						3, 1);
-
-			*cmds++ = cp_mem_packet(adreno_dev,
-					CP_INDIRECT_BUFFER_PFE, 2, 1);
-			cmds += cp_gpuaddr(adreno_dev, cmds, ib->gpuaddr);
-			*cmds++ = (unsigned int) ib->size >> 2;
-			/* preamble is required on only for first command */
-			use_preamble = false;
-		}
-	}
+	if (numibs)
+		cmds += _add_ibs(adreno_dev, cmdbatch, cmds, use_preamble);
 
 	if (gpudev->preemption_yield_enable &&
 				adreno_is_preemption_enabled(adreno_dev))
@@ -1110,6 +1125,123 @@ done:
 	return ret;
 }
 
+/**
+ * adreno_ringbuffer_submitcmds() - Submit a group of command batches at once
+ * @adreno_dev: Pointer to the adreno device struct
+ * @cmdbatches: Command batches of a single context, in timestamp order
+ * @count: Number of command batches in @cmdbatches
+ * @time: Optional pointer to a adreno_submit_time struct
+ *
+ * Put the IBs of all the command batches behind a single set of submission
+ * wrappers, a single context switch and a single timestamp, that of the last
+ * command batch. Each command batch still retires on its own since the
+ * timestamps of a context only ever move forward. The dispatcher only groups
+ * command batches that need no profiling, skipping or wait for idle.
+ */
+int adreno_ringbuffer_submitcmds(struct adreno_device *adreno_dev,
+		struct kgsl_cmdbatch **cmdbatches, int count,
+		struct adreno_submit_time *time)
+{
+	struct kgsl_device *device = KGSL_DEVICE(adreno_dev);
+	struct adreno_gpudev *gpudev = ADRENO_GPU_DEVICE(adreno_dev);
+	struct kgsl_cmdbatch *last = cmdbatches[count - 1];
+	struct kgsl_context *context = last->context;
+	struct adreno_context *drawctxt = ADRENO_CONTEXT(context);
+	struct adreno_ringbuffer *rb = drawctxt->rb;
+	struct kgsl_memobj_node *ib;
+	unsigned int numibs = 0;
+	unsigned int dwords;
+	unsigned int *link;
+	unsigned int *cmds;
+	bool use_preamble = true;
+	int flags = KGSL_CMD_FLAGS_NONE;
+	int i, ret;
+
+	for (i = 0; i < count; i++)
+		list_for_each_entry(ib, &cmdbatches[i]->cmdlist, node)
+			numibs++;
+
+	/* process any profiling results that are available into the log_buf */
+	adreno_profile_process_results(adreno_dev);
+
+	if ((drawctxt->base.flags & KGSL_CONTEXT_PREAMBLE) &&
+		(rb->drawctxt_active == drawctxt))
+		use_preamble = false;
+
+	/* 7 dwords of red tape and at most 30 dwords for each IB */
+	dwords = 7 + (numibs * 30);
+
+	if (gpudev->preemption_yield_enable &&
+				adreno_is_preemption_enabled(adreno_dev))
+		dwords += 8;
+
+	link = kzalloc(sizeof(unsigned int) *  dwords, GFP_KERNEL);
+	if (!link) {
+		ret = -ENOMEM;
+		goto done;
+	}
+
+	cmds = link;
+
+	*cmds++ = cp_packet(adreno_dev, CP_NOP, 1);
+	*cmds++ = KGSL_START_OF_IB_IDENTIFIER;
+
+	/* The context doesn't change within the group */
+	for (i = 0; i < count; i++) {
+		cmds += _add_ibs(adreno_dev, cmdbatches[i], cmds, use_preamble);
+		use_preamble = false;
+	}
+
+	if (gpudev->preemption_yield_enable &&
+				adreno_is_preemption_enabled(adreno_dev))
+		cmds += gpudev->preemption_yield_enable(cmds);
+
+	*cmds++ = cp_packet(adreno_dev, CP_NOP, 1);
+	*cmds++ = KGSL_END_OF_IB_IDENTIFIER;
+
+	/* Context switches commands should *always* be on the GPU */
+	ret = adreno_drawctxt_switch(adreno_dev, rb, drawctxt,
+		ADRENO_CONTEXT_SWITCH_FORCE_GPU);
+	if (ret) {
+		if (ret != -ENOSPC && ret != -ENOENT)
+			KGSL_DRV_ERR(device,
+				"Unable to switch draw context: %d\n", ret);
+		goto done;
+	}
+
+	if (test_and_clear_bit(ADRENO_DEVICE_PWRON, &adreno_dev->priv) &&
+		test_bit(ADRENO_DEVICE_PWRON_FIXUP, &adreno_dev->priv))
+		flags |= KGSL_CMD_FLAGS_PWRON_FIXUP;
+
+	for (i = 0; i < count; i++) {
+		adreno_ringbuffer_set_constraint(device, cmdbatches[i]);
+		kgsl_cffdump_capture_ib_desc(device, context, cmdbatches[i]);
+	}
+
+	ret = adreno_ringbuffer_addcmds(rb, flags,
+					&link[0], (cmds - link),
+					last->timestamp, time);
+
+	if (!ret) {
+		set_bit(KGSL_CONTEXT_PRIV_SUBMITTED, &context->priv);
+
+		for (i = 0; i < count; i++)
+			cmdbatches[i]->global_ts = drawctxt->internal_timestamp;
+	}
+
+	kgsl_cffdump_regpoll(device,
+		adreno_getreg(adreno_dev, ADRENO_REG_RBBM_STATUS) << 2,
+		0x00000000, 0x80000000);
+done:
+	for (i = 0; i < count; i++)
+		trace_kgsl_issueibcmds(device, context->id, cmdbatches[i],
+			numibs, cmdbatches[i]->timestamp,
+			cmdbatches[i]->flags, ret, drawctxt->type);
+
+	kfree(link);
+	return ret;
+}
+
 /**
  * adreno_ringbuffer_wait_callback() - Callback function for event registered
  * on a ringbuffer timestamp
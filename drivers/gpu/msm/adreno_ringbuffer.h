@@ -105,6 +105,10 @@ struct adreno_ringbuffer_pagetable_info {
  * or how long it has been scheduled for after preempting in
  * @starve_timer_state: Indicates the state of the wait.
  * @preempt_lock: Lock to protect the wptr pointer while it is being updated
+ * @deadline: Earliest deadline (ktime in ns) of the commands inflight in
+ * dispatch_q, 0 if none of them has one
+ * @retire_ns: local_clock() when the dispatcher last retired a command
+ * batch from this RB
  */
 struct adreno_ringbuffer {
 	uint32_t flags;
@@ -127,6 +131,8 @@ struct adreno_ringbuffer {
 	unsigned long sched_timer;
 	enum adreno_dispatcher_starve_timer_states starve_timer_state;
 	spinlock_t preempt_lock;
+	u64 deadline;
+	u64 retire_ns;
 };
 
 /* Returns the current ringbuffer */
@@ -143,6 +149,10 @@ int adreno_ringbuffer_submitcmd(struct adreno_device *adreno_dev,
 		struct kgsl_cmdbatch *cmdbatch,
 		struct adreno_submit_time *time);
 
+int adreno_ringbuffer_submitcmds(struct adreno_device *adreno_dev,
+		struct kgsl_cmdbatch **cmdbatches, int count,
+		struct adreno_submit_time *time);
+
 int adreno_ringbuffer_probe(struct adreno_device *adreno_dev, bool nopreempt);
 
 int adreno_ringbuffer_start(struct adreno_device *adreno_dev,
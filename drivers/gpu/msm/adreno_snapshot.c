@@ -182,8 +182,6 @@ static inline void parse_ib(struct kgsl_device *device,
 		struct kgsl_process_private *process,
 		uint64_t gpuaddr, uint64_t dwords)
 {
-	struct adreno_ib_object_list *ib_obj_list;
-
 	/*
 	 * Check the IB address - if it is either the last executed IB1
 	 * then push it into the static blob otherwise put it in the dynamic
@@ -198,14 +196,11 @@ static inline void parse_ib(struct kgsl_device *device,
 					gpuaddr, dwords << 2))
 		return;
 
-	if (-E2BIG == adreno_ib_create_object_list(device, process,
-				gpuaddr, dwords, snapshot->ib2base,
-				&ib_obj_list))
-		ib_max_objs = 1;
-
-	if (ib_obj_list)
-		kgsl_snapshot_add_ib_obj_list(snapshot, ib_obj_list);
-
+	/*
+	 * Walking the IB is by far the most expensive part of the snapshot.
+	 * Leave it to the snapshot worker so the GPU can be recovered first.
+	 */
+	kgsl_snapshot_add_ib(snapshot, process, gpuaddr, dwords);
 }
 
 static inline bool iommu_is_setstate_addr(struct kgsl_device *device,
@@ -310,6 +310,29 @@ TRACE_EVENT(adreno_drawctxt_switch,
 	)
 );
 
+TRACE_EVENT(adreno_perfcounter_sample,
+	TP_PROTO(unsigned int groupid, unsigned int countable, uint64_t value,
+		uint64_t ticks),
+	TP_ARGS(groupid, countable, value, ticks),
+	TP_STRUCT__entry(
+		__field(unsigned int, groupid)
+		__field(unsigned int, countable)
+		__field(uint64_t, value)
+		__field(uint64_t, ticks)
+	),
+	TP_fast_assign(
+		__entry->groupid = groupid;
+		__entry->countable = countable;
+		__entry->value = value;
+		__entry->ticks = ticks;
+	),
+	TP_printk(
+		"group=%u countable=%u value=%llu ticks=%llu",
+		__entry->groupid, __entry->countable, __entry->value,
+		__entry->ticks
+	)
+);
+
 TRACE_EVENT(adreno_gpu_fault,
 	TP_PROTO(unsigned int ctx, unsigned int ts,
 		unsigned int status, unsigned int rptr, unsigned int wptr,
@@ -600,6 +623,48 @@ TRACE_EVENT(adreno_preempt_done,
 		__entry->next->id, __entry->cur->id
 	)
 );
+TRACE_EVENT(adreno_preempt_latency,
+	TP_PROTO(struct adreno_ringbuffer *cur, struct adreno_ringbuffer *next,
+		s64 usecs),
+	TP_ARGS(cur, next, usecs),
+	TP_STRUCT__entry(
+		__field(int, cur_id)
+		__field(int, next_id)
+		__field(s64, usecs)
+	),
+	TP_fast_assign(
+		__entry->cur_id = cur->id;
+		__entry->next_id = next->id;
+		__entry->usecs = usecs;
+	),
+	TP_printk("switch from id=%d to id=%d took %lld us",
+		__entry->cur_id, __entry->next_id, __entry->usecs
+	)
+);
+
+TRACE_EVENT(adreno_cmdbatch_deadline_miss,
+	TP_PROTO(struct kgsl_cmdbatch *cmdbatch, struct adreno_ringbuffer *rb,
+		s64 late_us),
+	TP_ARGS(cmdbatch, rb, late_us),
+	TP_STRUCT__entry(
+		__field(unsigned int, id)
+		__field(unsigned int, timestamp)
+		__field(int, prio)
+		__field(int, rb_id)
+		__field(s64, late_us)
+	),
+	TP_fast_assign(
+		__entry->id = cmdbatch->context->id;
+		__entry->timestamp = cmdbatch->timestamp;
+		__entry->prio = cmdbatch->context->priority;
+		__entry->rb_id = rb->id;
+		__entry->late_us = late_us;
+	),
+	TP_printk("ctx=%u ctx_prio=%d ts=%u rb_id=%d late=%lld us",
+		__entry->id, __entry->prio, __entry->timestamp,
+		__entry->rb_id, __entry->late_us
+	)
+);
 #endif /* _ADRENO_TRACE_H */
 
 /* This part must be outside protection */
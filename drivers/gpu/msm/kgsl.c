@@ -30,6 +30,7 @@
 #include <linux/security.h>
 #include <linux/compat.h>
 #include <linux/ctype.h>
+#include <linux/eventfd.h>
 
 #include "kgsl.h"
 #include "kgsl_debugfs.h"
@@ -2941,7 +2942,8 @@ static struct kgsl_mem_entry *gpumem_alloc_entry(
 		| KGSL_MEMALIGN_MASK
 		| KGSL_MEMFLAGS_USE_CPU_MAP
 		| KGSL_MEMFLAGS_SECURE
-		| KGSL_MEMFLAGS_FORCE_32BIT;
+		| KGSL_MEMFLAGS_FORCE_32BIT
+		| KGSL_MEMFLAGS_LAZY_ALLOC;
 
 	/* Turn off SVM if the system doesn't support it */
 	if (!kgsl_mmu_use_cpu_map(&dev_priv->device->mmu))
@@ -2959,6 +2961,14 @@ static struct kgsl_mem_entry *gpumem_alloc_entry(
 	if (flags & KGSL_MEMFLAGS_SECURE)
 		flags &= ~((uint64_t) KGSL_MEMFLAGS_USE_CPU_MAP);
 
+	/*
+	 * Lazy allocations need an MMU that stalls on faults, and must be
+	 * mapped in the GPU before anything can touch them
+	 */
+	if (!MMU_FEATURE(&dev_priv->device->mmu, KGSL_MMU_LAZY_ALLOC) ||
+		(flags & (KGSL_MEMFLAGS_SECURE | KGSL_MEMFLAGS_USE_CPU_MAP)))
+		flags &= ~((uint64_t) KGSL_MEMFLAGS_LAZY_ALLOC);
+
 	/* Cap the alignment bits to the highest number we can handle */
 	align = MEMFLAGS(flags, KGSL_MEMALIGN_MASK, KGSL_MEMALIGN_SHIFT);
 	if (align >= ilog2(KGSL_MAX_ALIGN)) {
@@ -3264,6 +3274,61 @@ long kgsl_ioctl_cff_user_event(struct kgsl_device_private *dev_priv,
  * @returns 0 on success or error code on failure
  */
 
+static void kgsl_eventfd_event_cb(struct kgsl_device *device,
+		struct kgsl_event_group *group, void *priv, int result)
+{
+	struct eventfd_ctx *ctx = priv;
+
+	/* Signal on cancel too so that a waiter never blocks forever */
+	eventfd_signal(ctx, 1);
+	eventfd_ctx_put(ctx);
+}
+
+/**
+ * kgsl_add_eventfd_event - Signal an eventfd when a timestamp retires
+ * @dev_priv - pointer to the private device structure
+ * @context_id - the context that owns the timestamp
+ * @timestamp - the timestamp to wait for
+ * @data - user pointer to a struct kgsl_timestamp_event_eventfd
+ * @len - size of the buffer pointed to by @data
+ * @returns 0 on success or error code on failure
+ */
+static int kgsl_add_eventfd_event(struct kgsl_device_private *dev_priv,
+		unsigned int context_id, unsigned int timestamp,
+		void __user *data, int len)
+{
+	struct kgsl_device *device = dev_priv->device;
+	struct kgsl_timestamp_event_eventfd priv;
+	struct kgsl_context *context;
+	struct eventfd_ctx *ctx;
+	int ret;
+
+	if (len != sizeof(priv))
+		return -EINVAL;
+
+	if (copy_from_user(&priv, data, sizeof(priv)))
+		return -EFAULT;
+
+	context = kgsl_context_get_owner(dev_priv, context_id);
+	if (context == NULL)
+		return -EINVAL;
+
+	ctx = eventfd_ctx_fdget(priv.fd);
+	if (IS_ERR(ctx)) {
+		ret = PTR_ERR(ctx);
+		goto out;
+	}
+
+	ret = kgsl_add_event(device, &context->events, timestamp,
+		kgsl_eventfd_event_cb, ctx);
+	if (ret)
+		eventfd_ctx_put(ctx);
+
+out:
+	kgsl_context_put(context);
+	return ret;
+}
+
 long kgsl_ioctl_timestamp_event(struct kgsl_device_private *dev_priv,
 		unsigned int cmd, void *data)
 {
@@ -3276,6 +3341,10 @@ long kgsl_ioctl_timestamp_event(struct kgsl_device_private *dev_priv,
 			param->context_id, param->timestamp, param->priv,
 			param->len, dev_priv);
 		break;
+	case KGSL_TIMESTAMP_EVENT_EVENTFD:
+		ret = kgsl_add_eventfd_event(dev_priv, param->context_id,
+			param->timestamp, param->priv, param->len);
+		break;
 	default:
 		ret = -EINVAL;
 	}
@@ -3283,28 +3352,44 @@ long kgsl_ioctl_timestamp_event(struct kgsl_device_private *dev_priv,
 	return ret;
 }
 
+/*
+ * The memstore is mapped at its GPU address. Any page aligned window of it
+ * may be mapped so that a process can map only the page holding the
+ * timestamps of its own context.
+ */
+static bool
+kgsl_is_memstore_offset(struct kgsl_device *device, unsigned long offset)
+{
+	unsigned long base = (unsigned long) device->memstore.gpuaddr;
+
+	return offset >= base && offset - base < device->memstore.size;
+}
+
 static int
 kgsl_mmap_memstore(struct kgsl_device *device, struct vm_area_struct *vma)
 {
 	struct kgsl_memdesc *memdesc = &device->memstore;
 	int result;
 	unsigned int vma_size = vma->vm_end - vma->vm_start;
+	uint64_t offset = (vma->vm_pgoff << PAGE_SHIFT) - memdesc->gpuaddr;
 
 	/* The memstore can only be mapped as read only */
 
 	if (vma->vm_flags & VM_WRITE)
 		return -EPERM;
 
-	if (memdesc->size  !=  vma_size) {
-		KGSL_MEM_ERR(device, "memstore bad size: %d should be %llu\n",
-			     vma_size, memdesc->size);
+	if (offset + vma_size > memdesc->size) {
+		KGSL_MEM_ERR(device,
+			"memstore bad size: %d at offset %llu exceeds %llu\n",
+			vma_size, offset, memdesc->size);
 		return -EINVAL;
 	}
 
+	vma->vm_flags &= ~VM_MAYWRITE;
 	vma->vm_page_prot = pgprot_writecombine(vma->vm_page_prot);
 
 	result = remap_pfn_range(vma, vma->vm_start,
-				device->memstore.physaddr >> PAGE_SHIFT,
+				(device->memstore.physaddr + offset) >> PAGE_SHIFT,
 				 vma_size, vma->vm_page_prot);
 	if (result != 0)
 		KGSL_MEM_ERR(device, "remap_pfn_range failed: %d\n",
@@ -3600,7 +3685,7 @@ kgsl_get_unmapped_area(struct file *file, unsigned long addr,
 	struct kgsl_device *device = dev_priv->device;
 	struct kgsl_mem_entry *entry = NULL;
 
-	if (vma_offset == (unsigned long) device->memstore.gpuaddr)
+	if (kgsl_is_memstore_offset(device, vma_offset))
 		return get_unmapped_area(NULL, addr, len, pgoff, flags);
 
 	val = get_mmap_entry(private, &entry, pgoff, len);
@@ -3643,7 +3728,7 @@ static int kgsl_mmap(struct file *file, struct vm_area_struct *vma)
 
 	/* Handle leagacy behavior for memstore */
 
-	if (vma_offset == (unsigned long) device->memstore.gpuaddr)
+	if (kgsl_is_memstore_offset(device, vma_offset))
 		return kgsl_mmap_memstore(device, vma);
 
 	/*
@@ -3692,7 +3777,10 @@ static int kgsl_mmap(struct file *file, struct vm_area_struct *vma)
 
 		for (i = 0; i < m->page_count; i++) {
 				struct page *page = m->pages[i];
-				vm_insert_page(vma, addr, page);
+
+				/* Unpopulated lazy pages are faulted in */
+				if (page != NULL)
+					vm_insert_page(vma, addr, page);
 				addr += PAGE_SIZE;
 		}
 	}
@@ -3982,6 +4070,8 @@ int kgsl_device_platform_probe(struct kgsl_device *device)
 	/* Initialize common sysfs entries */
 	kgsl_pwrctrl_init_sysfs(device);
 
+	device_enable_async_suspend(&device->pdev->dev);
+
 	return 0;
 
 error_close_mmu:
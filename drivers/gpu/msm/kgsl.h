@@ -129,6 +129,8 @@ struct kgsl_driver {
 		atomic_long_t secure_max;
 		atomic_long_t mapped;
 		atomic_long_t mapped_max;
+		atomic_long_t pool_zero_inline;
+		atomic_long_t pool_zero_async;
 	} stats;
 	unsigned int full_cache_threshold;
 	struct workqueue_struct *workqueue;
@@ -168,6 +170,8 @@ struct kgsl_memdesc_ops {
 #define KGSL_MEMDESC_TZ_LOCKED BIT(7)
 /* The memdesc is allocated through contiguous memory */
 #define KGSL_MEMDESC_CONTIG BIT(8)
+/* The pages of the memdesc are allocated on first access */
+#define KGSL_MEMDESC_LAZY BIT(9)
 
 /**
  * struct kgsl_memdesc - GPU memory object descriptor
@@ -27,6 +27,7 @@
 
 #include <linux/uaccess.h>
 #include <linux/list.h>
+#include <linux/llist.h>
 #include <linux/compat.h>
 
 #include "kgsl.h"
@@ -42,6 +43,18 @@
  */
 static struct kmem_cache *memobjs_cache;
 
+/* Dedicated cache for the cmdbatch structures themselves */
+static struct kmem_cache *cmdbatch_cache;
+
+/*
+ * Command batches are released by the retire path, often several at a time.
+ * The actual freeing is batched up and done from a worker so that the
+ * dispatcher doesn't pay for it.
+ */
+static LLIST_HEAD(cmdbatch_free_list);
+static void _kgsl_cmdbatch_free_worker(struct work_struct *work);
+static DECLARE_WORK(cmdbatch_free_ws, _kgsl_cmdbatch_free_worker);
+
 /**
  * kgsl_cmdbatch_put() - Decrement the refcount for a command batch object
  * @cmdbatch: Pointer to the command batch object
@@ -158,10 +171,8 @@ void kgsl_cmdbatch_destroy_object(struct kref *kref)
 	struct kgsl_cmdbatch *cmdbatch = container_of(kref,
 		struct kgsl_cmdbatch, refcount);
 
-	kgsl_context_put(cmdbatch->context);
-
-	kfree(cmdbatch->synclist);
-	kfree(cmdbatch);
+	if (llist_add(&cmdbatch->free_node, &cmdbatch_free_list))
+		queue_work(kgsl_driver.mem_workqueue, &cmdbatch_free_ws);
 }
 EXPORT_SYMBOL(kgsl_cmdbatch_destroy_object);
 
@@ -209,17 +220,62 @@ static void kgsl_cmdbatch_sync_func(struct kgsl_device *device,
 	kgsl_cmdbatch_put(event->cmdbatch);
 }
 
-static inline void _free_memobj_list(struct list_head *list)
+static struct kgsl_memobj_node *_alloc_memobj(struct kgsl_cmdbatch *cmdbatch)
+{
+	if (cmdbatch->inline_objs_used < KGSL_CMDBATCH_INLINE_OBJS)
+		return &cmdbatch->inline_objs[cmdbatch->inline_objs_used++];
+
+	return kmem_cache_alloc(memobjs_cache, GFP_KERNEL);
+}
+
+static inline void _free_memobj_list(struct kgsl_cmdbatch *cmdbatch,
+		struct list_head *list)
 {
 	struct kgsl_memobj_node *mem, *tmpmem;
 
 	/* Free the cmd mem here */
 	list_for_each_entry_safe(mem, tmpmem, list, node) {
 		list_del_init(&mem->node);
-		kmem_cache_free(memobjs_cache, mem);
+
+		if (mem < cmdbatch->inline_objs ||
+			mem >= cmdbatch->inline_objs + KGSL_CMDBATCH_INLINE_OBJS)
+			kmem_cache_free(memobjs_cache, mem);
 	}
 }
 
+static void _kgsl_cmdbatch_free_worker(struct work_struct *work)
+{
+	struct llist_node *list = llist_del_all(&cmdbatch_free_list);
+	struct kgsl_cmdbatch *cmdbatch, *tmp;
+
+	llist_for_each_entry_safe(cmdbatch, tmp, list, free_node) {
+		kgsl_context_put(cmdbatch->context);
+
+		/* Destroy the cmdlist and the memlist we created */
+		_free_memobj_list(cmdbatch, &cmdbatch->cmdlist);
+		_free_memobj_list(cmdbatch, &cmdbatch->memlist);
+
+		if (cmdbatch->synclist != cmdbatch->inline_syncs)
+			kfree(cmdbatch->synclist);
+
+		kmem_cache_free(cmdbatch_cache, cmdbatch);
+	}
+}
+
+/* Set up the array of sync events, inline in the cmdbatch if it fits */
+static int _alloc_synclist(struct kgsl_cmdbatch *cmdbatch, int count)
+{
+	if (count <= KGSL_CMDBATCH_INLINE_SYNCS) {
+		cmdbatch->synclist = cmdbatch->inline_syncs;
+		return 0;
+	}
+
+	cmdbatch->synclist = kcalloc(count,
+		sizeof(struct kgsl_cmdbatch_sync_event), GFP_KERNEL);
+
+	return cmdbatch->synclist ? 0 : -ENOMEM;
+}
+
 /**
  * kgsl_cmdbatch_destroy() - Destroy a cmdbatch structure
  * @cmdbatch: Pointer to the command batch object to destroy
@@ -287,12 +343,6 @@ void kgsl_cmdbatch_destroy(struct kgsl_cmdbatch *cmdbatch)
 	if (cmdbatch->flags & KGSL_CMDBATCH_PROFILING)
 		kgsl_mem_entry_put(cmdbatch->profiling_buf_entry);
 
-	/* Destroy the cmdlist we created */
-	_free_memobj_list(&cmdbatch->cmdlist);
-
-	/* Destroy the memlist we created */
-	_free_memobj_list(&cmdbatch->memlist);
-
 	/*
 	 * If we cancelled an event, there's a good chance that the context is
 	 * on a dispatcher queue, so schedule to get it removed.
@@ -601,7 +651,7 @@ int kgsl_cmdbatch_add_ibdesc(struct kgsl_device *device,
 	if (cmdbatch->flags & (KGSL_CMDBATCH_SYNC | KGSL_CMDBATCH_MARKER))
 		return 0;
 
-	mem = kmem_cache_alloc(memobjs_cache, GFP_KERNEL);
+	mem = _alloc_memobj(cmdbatch);
 	if (mem == NULL)
 		return -ENOMEM;
 
@@ -640,7 +690,8 @@ int kgsl_cmdbatch_add_ibdesc(struct kgsl_device *device,
 struct kgsl_cmdbatch *kgsl_cmdbatch_create(struct kgsl_device *device,
 		struct kgsl_context *context, unsigned int flags)
 {
-	struct kgsl_cmdbatch *cmdbatch = kzalloc(sizeof(*cmdbatch), GFP_KERNEL);
+	struct kgsl_cmdbatch *cmdbatch = kmem_cache_zalloc(cmdbatch_cache,
+		GFP_KERNEL);
 	if (cmdbatch == NULL)
 		return ERR_PTR(-ENOMEM);
 
@@ -650,7 +701,7 @@ struct kgsl_cmdbatch *kgsl_cmdbatch_create(struct kgsl_device *device,
 	 */
 
 	if (!_kgsl_context_get(context)) {
-		kfree(cmdbatch);
+		kmem_cache_free(cmdbatch_cache, cmdbatch);
 		return ERR_PTR(-ENOENT);
 	}
 
@@ -786,11 +837,9 @@ int kgsl_cmdbatch_add_syncpoints(struct kgsl_device *device,
 	if (count > KGSL_MAX_SYNCPOINTS)
 		return -EINVAL;
 
-	cmdbatch->synclist = kcalloc(count,
-		sizeof(struct kgsl_cmdbatch_sync_event), GFP_KERNEL);
-
-	if (cmdbatch->synclist == NULL)
-		return -ENOMEM;
+	ret = _alloc_synclist(cmdbatch, count);
+	if (ret)
+		return ret;
 
 	if (is_compat_task())
 		return add_syncpoints_compat(device, cmdbatch, ptr, count);
@@ -811,12 +860,12 @@ int kgsl_cmdbatch_add_syncpoints(struct kgsl_device *device,
 	return 0;
 }
 
-static int kgsl_cmdbatch_add_object(struct list_head *head,
-		struct kgsl_command_object *obj)
+static int kgsl_cmdbatch_add_object(struct kgsl_cmdbatch *cmdbatch,
+		struct list_head *head, struct kgsl_command_object *obj)
 {
 	struct kgsl_memobj_node *mem;
 
-	mem = kmem_cache_alloc(memobjs_cache, GFP_KERNEL);
+	mem = _alloc_memobj(cmdbatch);
 	if (mem == NULL)
 		return -ENOMEM;
 
@@ -871,7 +920,8 @@ int kgsl_cmdbatch_add_cmdlist(struct kgsl_device *device,
 			return -EINVAL;
 		}
 
-		ret = kgsl_cmdbatch_add_object(&cmdbatch->cmdlist, &obj);
+		ret = kgsl_cmdbatch_add_object(cmdbatch, &cmdbatch->cmdlist,
+			&obj);
 		if (ret)
 			return ret;
 
@@ -915,8 +965,8 @@ int kgsl_cmdbatch_add_memlist(struct kgsl_device *device,
 			add_profiling_buffer(device, cmdbatch, obj.gpuaddr,
 				obj.size, obj.id, obj.offset);
 		else {
-			ret = kgsl_cmdbatch_add_object(&cmdbatch->memlist,
-				&obj);
+			ret = kgsl_cmdbatch_add_object(cmdbatch,
+				&cmdbatch->memlist, &obj);
 			if (ret)
 				return ret;
 		}
@@ -946,11 +996,9 @@ int kgsl_cmdbatch_add_synclist(struct kgsl_device *device,
 	if (count > KGSL_MAX_SYNCPOINTS)
 		return -EINVAL;
 
-	cmdbatch->synclist = kcalloc(count,
-		sizeof(struct kgsl_cmdbatch_sync_event), GFP_KERNEL);
-
-	if (cmdbatch->synclist == NULL)
-		return -ENOMEM;
+	ret = _alloc_synclist(cmdbatch, count);
+	if (ret)
+		return ret;
 
 	for (i = 0; i < count; i++) {
 		memset(&syncpoint, 0, sizeof(syncpoint));
@@ -975,6 +1023,11 @@ int kgsl_cmdbatch_add_synclist(struct kgsl_device *device,
 
 void kgsl_cmdbatch_exit(void)
 {
+	flush_work(&cmdbatch_free_ws);
+
+	if (cmdbatch_cache != NULL)
+		kmem_cache_destroy(cmdbatch_cache);
+
 	if (memobjs_cache != NULL)
 		kmem_cache_destroy(memobjs_cache);
 }
@@ -987,5 +1040,13 @@ int kgsl_cmdbatch_init(void)
 		return -ENOMEM;
 	}
 
+	cmdbatch_cache = KMEM_CACHE(kgsl_cmdbatch, 0);
+	if (cmdbatch_cache == NULL) {
+		KGSL_CORE_ERR("failed to create cmdbatch_cache");
+		kmem_cache_destroy(memobjs_cache);
+		memobjs_cache = NULL;
+		return -ENOMEM;
+	}
+
 	return 0;
 }
@@ -13,6 +13,8 @@
 #ifndef __KGSL_CMDBATCH_H
 #define __KGSL_CMDBATCH_H
 
+#include <linux/llist.h>
+
 #define KGSL_CMDBATCH_FLAGS \
 	{ KGSL_CMDBATCH_MARKER, "MARKER" }, \
 	{ KGSL_CMDBATCH_CTX_SWITCH, "CTX_SWITCH" }, \
@@ -21,6 +23,59 @@
 	{ KGSL_CMDBATCH_PWR_CONSTRAINT, "PWR_CONSTRAINT" }, \
 	{ KGSL_CMDBATCH_SUBMIT_IB_LIST, "IB_LIST" }
 
+/* Flag to mark the memobj_node as a preamble */
+#define MEMOBJ_PREAMBLE BIT(0)
+/* Flag to mark that the memobj_node should not go to the hadrware */
+#define MEMOBJ_SKIP BIT(1)
+
+/**
+ * struct kgsl_memobj_node - Memory object descriptor
+ * @node: Local list node for the cmdbatch
+ * @id: GPU memory ID for the object
+ * offset: Offset within the object
+ * @gpuaddr: GPU address for the object
+ * @flags: External flags passed by the user
+ * @priv: Internal flags set by the driver
+ */
+struct kgsl_memobj_node {
+	struct list_head node;
+	unsigned int id;
+	uint64_t offset;
+	uint64_t gpuaddr;
+	uint64_t size;
+	unsigned long flags;
+	unsigned long priv;
+};
+
+/**
+ * struct kgsl_cmdbatch_sync_event
+ * @id: identifer (positiion within the pending bitmap)
+ * @type: Syncpoint type
+ * @cmdbatch: Pointer to the cmdbatch that owns the sync event
+ * @context: Pointer to the KGSL context that owns the cmdbatch
+ * @timestamp: Pending timestamp for the event
+ * @handle: Pointer to a sync fence handle
+ * @handle_lock: Spin lock to protect handle
+ * @device: Pointer to the KGSL device
+ */
+struct kgsl_cmdbatch_sync_event {
+	unsigned int id;
+	int type;
+	struct kgsl_cmdbatch *cmdbatch;
+	struct kgsl_context *context;
+	unsigned int timestamp;
+	struct kgsl_sync_fence_waiter *handle;
+	spinlock_t handle_lock;
+	struct kgsl_device *device;
+};
+
+/*
+ * Most command batches only carry a handful of IBs and memory objects and at
+ * most a couple of syncpoints, so keep that many in the cmdbatch itself
+ */
+#define KGSL_CMDBATCH_INLINE_OBJS 4
+#define KGSL_CMDBATCH_INLINE_SYNCS 2
+
 /**
  * struct kgsl_cmdbatch - KGSl command descriptor
  * @device: KGSL GPU device that the command was created for
@@ -46,9 +101,17 @@
  * @profile_index: Index to store the start/stop ticks in the kernel profiling
  * buffer
  * @submit_ticks: Variable to hold ticks at the time of cmdbatch submit.
+ * @queued_ns: local_clock() when the cmdbatch was queued to its context
+ * @submit_ns: local_clock() when the cmdbatch was submitted to the ringbuffer
  * @global_ts: The ringbuffer timestamp corresponding to this cmdbatch
  * @timeout_jiffies: For a syncpoint cmdbatch the jiffies at which the
  * timer will expire
+ * @deadline: ktime (in ns) by which the cmdbatch should retire, 0 if none
+ * @inline_objs: Memory object descriptors used before falling back to the
+ * memobj cache
+ * @inline_objs_used: Number of entries of @inline_objs in use
+ * @inline_syncs: Storage for @synclist when there are only a few syncpoints
+ * @free_node: Node on the list of command batches waiting to be freed
  * This structure defines an atomic batch of command buffers issued from
  * userspace.
  */
@@ -72,30 +135,15 @@ struct kgsl_cmdbatch {
 	uint64_t profiling_buffer_gpuaddr;
 	unsigned int profile_index;
 	uint64_t submit_ticks;
+	u64 queued_ns;
+	u64 submit_ns;
 	unsigned int global_ts;
 	unsigned long timeout_jiffies;
-};
-
-/**
- * struct kgsl_cmdbatch_sync_event
- * @id: identifer (positiion within the pending bitmap)
- * @type: Syncpoint type
- * @cmdbatch: Pointer to the cmdbatch that owns the sync event
- * @context: Pointer to the KGSL context that owns the cmdbatch
- * @timestamp: Pending timestamp for the event
- * @handle: Pointer to a sync fence handle
- * @handle_lock: Spin lock to protect handle
- * @device: Pointer to the KGSL device
- */
-struct kgsl_cmdbatch_sync_event {
-	unsigned int id;
-	int type;
-	struct kgsl_cmdbatch *cmdbatch;
-	struct kgsl_context *context;
-	unsigned int timestamp;
-	struct kgsl_sync_fence_waiter *handle;
-	spinlock_t handle_lock;
-	struct kgsl_device *device;
+	u64 deadline;
+	struct kgsl_memobj_node inline_objs[KGSL_CMDBATCH_INLINE_OBJS];
+	unsigned int inline_objs_used;
+	struct kgsl_cmdbatch_sync_event inline_syncs[KGSL_CMDBATCH_INLINE_SYNCS];
+	struct llist_node free_node;
 };
 
 /**
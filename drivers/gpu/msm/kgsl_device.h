@@ -98,6 +98,9 @@ enum kgsl_event_results {
 /* Allocate 600K for the snapshot static region*/
 #define KGSL_SNAPSHOT_MEMSIZE (600 * 1024)
 
+/* Default cap on the GPU object memory saved alongside a snapshot */
+#define KGSL_SNAPSHOT_OBJMEM_MAX SZ_32M
+
 struct kgsl_device;
 struct platform_device;
 struct kgsl_device_private;
@@ -183,30 +186,6 @@ struct kgsl_ioctl {
 long kgsl_ioctl_helper(struct file *filep, unsigned int cmd, unsigned long arg,
 		const struct kgsl_ioctl *cmds, int len);
 
-/* Flag to mark the memobj_node as a preamble */
-#define MEMOBJ_PREAMBLE BIT(0)
-/* Flag to mark that the memobj_node should not go to the hadrware */
-#define MEMOBJ_SKIP BIT(1)
-
-/**
- * struct kgsl_memobj_node - Memory object descriptor
- * @node: Local list node for the cmdbatch
- * @id: GPU memory ID for the object
- * offset: Offset within the object
- * @gpuaddr: GPU address for the object
- * @flags: External flags passed by the user
- * @priv: Internal flags set by the driver
- */
-struct kgsl_memobj_node {
-	struct list_head node;
-	unsigned int id;
-	uint64_t offset;
-	uint64_t gpuaddr;
-	uint64_t size;
-	unsigned long flags;
-	unsigned long priv;
-};
-
 struct kgsl_device {
 	struct device *dev;
 	const char *name;
@@ -276,6 +255,10 @@ struct kgsl_device {
 
 	/* Use CP Crash dumper to get GPU snapshot*/
 	bool snapshot_crashdumper;
+	/* Compress the saved GPU objects until the snapshot is read */
+	bool snapshot_compress;
+	/* Maximum bytes of GPU objects saved with a snapshot */
+	u32 snapshot_objmem_max;
 
 	struct kobject snapshot_kobj;
 
@@ -338,6 +321,32 @@ enum kgsl_context_priv {
 
 struct kgsl_process_private;
 
+enum kgsl_latency_type {
+	KGSL_LATENCY_QUEUE,
+	KGSL_LATENCY_GPU,
+	KGSL_LATENCY_RETIRE,
+	KGSL_LATENCY_NR_TYPES,
+};
+
+/* bucket n counts latencies below 2^n us, the last one everything above */
+#define KGSL_LATENCY_BUCKETS	20
+
+/**
+ * struct kgsl_context_latency - Latency histograms of the command batches
+ * retired by a context
+ * @hist: Per type log2 histograms in us
+ * @total_us: Per type sum of all the latencies in @hist
+ *
+ * Queue time runs from the cmdbatch being queued to the context until it
+ * is submitted to the ringbuffer, GPU time from the submit until the GPU
+ * is done with it, and retire latency from the submit until the retire is
+ * processed. Only updated from the dispatcher.
+ */
+struct kgsl_context_latency {
+	unsigned int hist[KGSL_LATENCY_NR_TYPES][KGSL_LATENCY_BUCKETS];
+	u64 total_us[KGSL_LATENCY_NR_TYPES];
+};
+
 /**
  * struct kgsl_context - The context fields that are valid for a user defined
  * context
@@ -359,6 +368,7 @@ struct kgsl_process_private;
  * @pwr_constraint: power constraint from userspace for this context
  * @fault_count: number of times gpu hanged in last _context_throttle_time ms
  * @fault_time: time of the first gpu hang in last _context_throttle_time ms
+ * @latency: Latency histograms of the command batches of this context
  */
 struct kgsl_context {
 	struct kref refcount;
@@ -376,8 +386,19 @@ struct kgsl_context {
 	struct kgsl_pwr_constraint pwr_constraint;
 	unsigned int fault_count;
 	unsigned long fault_time;
+	struct kgsl_context_latency latency;
 };
 
+static inline void kgsl_context_latency_add(struct kgsl_context *context,
+		enum kgsl_latency_type type, u64 us)
+{
+	struct kgsl_context_latency *lat = &context->latency;
+	int bucket = min_t(int, fls64(us), KGSL_LATENCY_BUCKETS - 1);
+
+	lat->hist[type][bucket]++;
+	lat->total_us[type] += us;
+}
+
 #define _context_comm(_c) \
 	(((_c) && (_c)->proc_priv) ? (_c)->proc_priv->comm : "unknown")
 
@@ -456,8 +477,12 @@ struct kgsl_device_private {
  * @timestamp: Timestamp of the snapshot instance (in seconds since boot)
  * @mempool: Pointer to the memory pool for storing memory objects
  * @mempool_size: Size of the memory pool
+ * @mempool_z: Compressed copy of the memory pool, if it was compressed
+ * @mempool_zsize: Size of the compressed memory pool
+ * @mempool_lock: Mutex to protect decompressing the memory pool
  * @obj_list: List of frozen GPU buffers that are waiting to be dumped.
  * @cp_list: List of IB's to be dumped.
+ * @ib_list: List of IBs waiting to be parsed by the worker
  * @work: worker to dump the frozen memory
  * @dump_gate: completion gate signaled by worker when it is finished.
  * @process: the process that caused the hang, if known.
@@ -477,8 +502,12 @@ struct kgsl_snapshot {
 	unsigned long timestamp;
 	u8 *mempool;
 	size_t mempool_size;
+	u8 *mempool_z;
+	size_t mempool_zsize;
+	struct mutex mempool_lock;
 	struct list_head obj_list;
 	struct list_head cp_list;
+	struct list_head ib_list;
 	struct work_struct work;
 	struct completion dump_gate;
 	struct kgsl_process_private *process;
@@ -864,6 +893,10 @@ struct adreno_ib_object_list;
 int kgsl_snapshot_add_ib_obj_list(struct kgsl_snapshot *snapshot,
 	struct adreno_ib_object_list *ib_obj_list);
 
+int kgsl_snapshot_add_ib(struct kgsl_snapshot *snapshot,
+	struct kgsl_process_private *process, uint64_t gpuaddr,
+	uint64_t dwords);
+
 void kgsl_snapshot_add_section(struct kgsl_device *device, u16 id,
 	struct kgsl_snapshot *snapshot,
 	size_t (*func)(struct kgsl_device *, u8 *, size_t, void *),
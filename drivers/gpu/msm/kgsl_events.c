@@ -18,6 +18,7 @@
 #include <kgsl_device.h>
 
 #include "kgsl_debugfs.h"
+#include "kgsl_sync.h"
 #include "kgsl_trace.h"
 
 /*
@@ -79,6 +80,7 @@ static void _process_event_group(struct kgsl_device *device,
 	struct kgsl_event *event, *tmp;
 	unsigned int timestamp;
 	struct kgsl_context *context;
+	bool processed = false;
 
 	if (group == NULL)
 		return;
@@ -109,9 +111,15 @@ static void _process_event_group(struct kgsl_device *device,
 	}
 
 	group->processed = timestamp;
+	processed = true;
 
 out:
 	spin_unlock(&group->lock);
+
+	/* Resolve the fences waiting on the context timeline in place */
+	if (processed)
+		kgsl_sync_timeline_retire(context, timestamp, flush);
+
 	kgsl_context_put(context);
 }
 
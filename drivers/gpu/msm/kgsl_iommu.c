@@ -714,6 +714,27 @@ static bool kgsl_iommu_suppress_pagefault(uint64_t faultaddr, int write,
 	return kgsl_iommu_uche_overfetch(context->proc_priv, faultaddr);
 }
 
+/*
+ * Populate the lazy allocation of @private that @addr falls into. Returns 0
+ * if the faulting address is now backed.
+ */
+static int _iommu_lazy_fault(struct kgsl_process_private *private,
+		uint64_t addr)
+{
+	struct kgsl_mem_entry *entry = kgsl_sharedmem_find(private, addr);
+	int ret = -ENOENT;
+
+	if (entry == NULL)
+		return ret;
+
+	if (kgsl_memdesc_is_lazy(&entry->memdesc))
+		ret = kgsl_sharedmem_lazy_populate(&entry->memdesc,
+			addr - entry->memdesc.gpuaddr);
+
+	kgsl_mem_entry_put(entry);
+	return ret;
+}
+
 static int kgsl_iommu_fault_handler(struct iommu_domain *domain,
 	struct device *dev, unsigned long addr, int flags, void *token)
 {
@@ -768,6 +789,16 @@ static int kgsl_iommu_fault_handler(struct iommu_domain *domain,
 	else if (flags & IOMMU_FAULT_PERMISSION)
 		fault_type = "permission";
 
+	/*
+	 * A translation fault on a lazy allocation is not an error: back the
+	 * address and have the SMMU retry the stalled transaction.
+	 */
+	if (context != NULL && (flags & IOMMU_FAULT_TRANSLATION) &&
+		!_iommu_lazy_fault(context->proc_priv, addr)) {
+		kgsl_context_put(context);
+		return (flags & IOMMU_FAULT_TRANSACTION_STALLED) ? -EAGAIN : 0;
+	}
+
 	if (kgsl_iommu_suppress_pagefault(addr, write, context)) {
 		iommu->pagefault_suppression_count++;
 		kgsl_context_put(context);
@@ -1479,6 +1510,17 @@ done:
 	return status;
 }
 
+/*
+ * Stall on faults if the pagefault policy halts the GPU, or if faults on
+ * lazy allocations need to be retried once the pages are in.
+ */
+static bool _iommu_stall_on_fault(struct kgsl_mmu *mmu,
+		unsigned long pf_policy)
+{
+	return test_bit(KGSL_FT_PAGEFAULT_GPUHALT_ENABLE, &pf_policy) ||
+		MMU_FEATURE(mmu, KGSL_MMU_LAZY_ALLOC);
+}
+
 static int _setup_user_context(struct kgsl_mmu *mmu)
 {
 	int ret = 0;
@@ -1517,7 +1559,8 @@ static int _setup_user_context(struct kgsl_mmu *mmu)
 	sctlr_val = KGSL_IOMMU_GET_CTX_REG(ctx, SCTLR);
 
 	/*
-	 * If pagefault policy is GPUHALT_ENABLE,
+	 * If pagefault policy is GPUHALT_ENABLE or lazy allocations are
+	 * supported,
 	 * 1) Program CFCFG to 1 to enable STALL mode
 	 * 2) Program HUPCF to 0 (Stall or terminate subsequent
 	 *    transactions in the presence of an outstanding fault)
@@ -1528,8 +1571,7 @@ static int _setup_user_context(struct kgsl_mmu *mmu)
 	 */
 
 	sctlr_val = KGSL_IOMMU_GET_CTX_REG(ctx, SCTLR);
-	if (test_bit(KGSL_FT_PAGEFAULT_GPUHALT_ENABLE,
-				&adreno_dev->ft_pf_policy)) {
+	if (_iommu_stall_on_fault(mmu, adreno_dev->ft_pf_policy)) {
 		sctlr_val |= (0x1 << KGSL_IOMMU_SCTLR_CFCFG_SHIFT);
 		sctlr_val &= ~(0x1 << KGSL_IOMMU_SCTLR_HUPCF_SHIFT);
 	} else {
@@ -1626,11 +1668,46 @@ kgsl_iommu_unmap_offset(struct kgsl_pagetable *pt,
 	return _iommu_unmap_sync_pc(pt, memdesc, addr + offset, size);
 }
 
+/*
+ * Only the populated chunks of a lazy memdesc are mapped, and unmapping a
+ * range that is not fully mapped fails, so unmap it chunk by chunk.
+ */
+static int
+_iommu_unmap_lazy(struct kgsl_pagetable *pt, struct kgsl_memdesc *memdesc)
+{
+	uint64_t offset;
+	int ret = 0;
+
+	for (offset = 0; offset < memdesc->size;
+			offset += KGSL_LAZY_CHUNK_SIZE) {
+		uint64_t len = min_t(uint64_t, KGSL_LAZY_CHUNK_SIZE,
+			memdesc->size - offset);
+
+		if (memdesc->pages[offset >> PAGE_SHIFT] == NULL)
+			continue;
+
+		if (_iommu_unmap_sync_pc(pt, memdesc,
+				memdesc->gpuaddr + offset, len))
+			ret = -ENODEV;
+	}
+
+	if (kgsl_memdesc_has_guard_page(memdesc) &&
+		_iommu_unmap_sync_pc(pt, memdesc,
+			memdesc->gpuaddr + memdesc->size,
+			kgsl_memdesc_guard_page_size(pt->mmu, memdesc)))
+		ret = -ENODEV;
+
+	return ret;
+}
+
 static int
 kgsl_iommu_unmap(struct kgsl_pagetable *pt, struct kgsl_memdesc *memdesc)
 {
 	uint64_t size = memdesc->size;
 
+	if (kgsl_memdesc_is_lazy(memdesc))
+		return _iommu_unmap_lazy(pt, memdesc);
+
 	if (kgsl_memdesc_has_guard_page(memdesc))
 		size += kgsl_memdesc_guard_page_size(pt->mmu, memdesc);
 
@@ -1718,6 +1795,13 @@ kgsl_iommu_map(struct kgsl_pagetable *pt,
 	unsigned int flags = _get_protection_flags(memdesc);
 	struct sg_table *sgt = NULL;
 
+	/*
+	 * Nothing of a lazy memdesc has been populated yet. The pages get
+	 * mapped one chunk at a time by kgsl_iommu_map_pages().
+	 */
+	if (kgsl_memdesc_is_lazy(memdesc))
+		return _iommu_map_guard_page(pt, memdesc, addr + size, flags);
+
 	/*
 	 * For paged memory allocated through kgsl, memdesc->pages is not NULL.
 	 * Allocate sgt here just for its map operation. Contiguous memory
@@ -1787,6 +1871,25 @@ static int kgsl_iommu_map_offset(struct kgsl_pagetable *pt,
 	return ret;
 }
 
+static int kgsl_iommu_map_pages(struct kgsl_pagetable *pt,
+		struct kgsl_memdesc *memdesc, uint64_t offset,
+		struct page **pages, unsigned int count)
+{
+	struct sg_table sgt;
+	int ret;
+
+	ret = sg_alloc_table_from_pages(&sgt, pages, count, 0,
+			(unsigned long) count << PAGE_SHIFT, GFP_KERNEL);
+	if (ret)
+		return ret;
+
+	ret = _iommu_map_sg_sync_pc(pt, memdesc->gpuaddr + offset, memdesc,
+			sgt.sgl, sgt.nents, _get_protection_flags(memdesc));
+
+	sg_free_table(&sgt);
+	return ret;
+}
+
 /* This function must be called with context bank attached */
 static void kgsl_iommu_clear_fsr(struct kgsl_mmu *mmu)
 {
@@ -1956,7 +2059,7 @@ static int kgsl_iommu_set_pf_policy(struct kgsl_mmu *mmu,
 
 		sctlr_val = KGSL_IOMMU_GET_CTX_REG(ctx, SCTLR);
 
-		if (test_bit(KGSL_FT_PAGEFAULT_GPUHALT_ENABLE, &pf_policy)) {
+		if (_iommu_stall_on_fault(mmu, pf_policy)) {
 			sctlr_val |= (0x1 << KGSL_IOMMU_SCTLR_CFCFG_SHIFT);
 			sctlr_val &= ~(0x1 << KGSL_IOMMU_SCTLR_HUPCF_SHIFT);
 		} else {
@@ -2391,6 +2494,7 @@ static const struct {
 	{ "qcom,hyp_secure_alloc", KGSL_MMU_HYP_SECURE_ALLOC },
 	{ "qcom,force-32bit", KGSL_MMU_FORCE_32BIT },
 	{ "qcom,coherent-htw", KGSL_MMU_COHERENT_HTW },
+	{ "qcom,lazy-alloc", KGSL_MMU_LAZY_ALLOC },
 };
 
 static int _kgsl_iommu_probe(struct kgsl_device *device,
@@ -2534,4 +2638,5 @@ static struct kgsl_mmu_pt_ops iommu_pt_ops = {
 	.addr_in_range = kgsl_iommu_addr_in_range,
 	.mmu_map_offset = kgsl_iommu_map_offset,
 	.mmu_unmap_offset = kgsl_iommu_unmap_offset,
+	.mmu_map_pages = kgsl_iommu_map_pages,
 };
@@ -137,6 +137,34 @@ sysfs_show_max_mapped(struct kobject *kobj,
 	return ret;
 }
 
+static ssize_t
+sysfs_show_mapped_pgsize(struct kobject *kobj,
+		      struct kobj_attribute *attr,
+		      char *buf)
+{
+	struct kgsl_pagetable *pt;
+	int ret = 0;
+
+	pt = _get_pt_from_kobj(kobj);
+
+	if (pt) {
+		int i = KGSL_MMU_PGSIZE_4K;
+		uint64_t val;
+
+		if (!strcmp(attr->attr.name, "mapped_64k"))
+			i = KGSL_MMU_PGSIZE_64K;
+		else if (!strcmp(attr->attr.name, "mapped_2m"))
+			i = KGSL_MMU_PGSIZE_2M;
+
+		val = atomic_long_read(&pt->stats.mapped_pgsize[i]);
+
+		ret += snprintf(buf, PAGE_SIZE, "%llu\n", val);
+	}
+
+	kgsl_put_pagetable(pt);
+	return ret;
+}
+
 static struct kobj_attribute attr_entries = {
 	.attr = { .name = "entries", .mode = 0444 },
 	.show = sysfs_show_entries,
@@ -155,10 +183,31 @@ static struct kobj_attribute attr_max_mapped = {
 	.store = NULL,
 };
 
+static struct kobj_attribute attr_mapped_4k = {
+	.attr = { .name = "mapped_4k", .mode = 0444 },
+	.show = sysfs_show_mapped_pgsize,
+	.store = NULL,
+};
+
+static struct kobj_attribute attr_mapped_64k = {
+	.attr = { .name = "mapped_64k", .mode = 0444 },
+	.show = sysfs_show_mapped_pgsize,
+	.store = NULL,
+};
+
+static struct kobj_attribute attr_mapped_2m = {
+	.attr = { .name = "mapped_2m", .mode = 0444 },
+	.show = sysfs_show_mapped_pgsize,
+	.store = NULL,
+};
+
 static struct attribute *pagetable_attrs[] = {
 	&attr_entries.attr,
 	&attr_mapped.attr,
 	&attr_max_mapped.attr,
+	&attr_mapped_4k.attr,
+	&attr_mapped_64k.attr,
+	&attr_mapped_2m.attr,
 	NULL,
 };
 
@@ -293,6 +342,7 @@ kgsl_mmu_createpagetableobject(struct kgsl_mmu *mmu, unsigned int name)
 	int status = 0;
 	struct kgsl_pagetable *pagetable = NULL;
 	unsigned long flags;
+	int i;
 
 	pagetable = kzalloc(sizeof(struct kgsl_pagetable), GFP_KERNEL);
 	if (pagetable == NULL)
@@ -308,6 +358,8 @@ kgsl_mmu_createpagetableobject(struct kgsl_mmu *mmu, unsigned int name)
 	atomic_set(&pagetable->stats.entries, 0);
 	atomic_long_set(&pagetable->stats.mapped, 0);
 	atomic_long_set(&pagetable->stats.max_mapped, 0);
+	for (i = 0; i < KGSL_MMU_PGSIZE_MAX; i++)
+		atomic_long_set(&pagetable->stats.mapped_pgsize[i], 0);
 
 	if (MMU_OP_VALID(mmu, mmu_init_pt)) {
 		status = mmu->mmu_ops->mmu_init_pt(mmu, pagetable);
@@ -382,6 +434,82 @@ kgsl_mmu_get_gpuaddr(struct kgsl_pagetable *pagetable,
 }
 EXPORT_SYMBOL(kgsl_mmu_get_gpuaddr);
 
+static void _pgsize_account_run(uint64_t gpuaddr, phys_addr_t phys,
+		uint64_t len, uint64_t *sizes)
+{
+	while (len) {
+		uint64_t step = PAGE_SIZE;
+		int i = KGSL_MMU_PGSIZE_4K;
+
+		if (len >= SZ_2M && IS_ALIGNED(gpuaddr | phys, SZ_2M)) {
+			step = SZ_2M;
+			i = KGSL_MMU_PGSIZE_2M;
+		} else if (len >= SZ_64K && IS_ALIGNED(gpuaddr | phys, SZ_64K)) {
+			step = SZ_64K;
+			i = KGSL_MMU_PGSIZE_64K;
+		}
+
+		sizes[i] += step;
+		gpuaddr += step;
+		phys += step;
+		len -= step;
+	}
+}
+
+/*
+ * Update the page size breakdown of @pagetable for @memdesc. The IOMMU maps
+ * every aligned, physically contiguous 2M or 64K run with a block or a
+ * contiguous group of entries, so the breakdown can be derived from the
+ * physical layout of the memdesc. Lazy allocations are mapped a page at a
+ * time and are not accounted.
+ */
+static void _mmu_pgsize_stats(struct kgsl_pagetable *pagetable,
+		struct kgsl_memdesc *memdesc, bool add)
+{
+	uint64_t sizes[KGSL_MMU_PGSIZE_MAX] = { 0 };
+	uint64_t gpuaddr = memdesc->gpuaddr;
+	int i;
+
+	if (kgsl_memdesc_is_lazy(memdesc))
+		return;
+
+	if (memdesc->pages != NULL) {
+		i = 0;
+		while (i < memdesc->page_count) {
+			phys_addr_t phys = page_to_phys(memdesc->pages[i]);
+			int j = i + 1;
+
+			while (j < memdesc->page_count &&
+				page_to_phys(memdesc->pages[j]) ==
+				phys + ((j - i) << PAGE_SHIFT))
+				j++;
+
+			_pgsize_account_run(gpuaddr, phys,
+				(uint64_t)(j - i) << PAGE_SHIFT, sizes);
+			gpuaddr += (uint64_t)(j - i) << PAGE_SHIFT;
+			i = j;
+		}
+	} else if (memdesc->sgt != NULL) {
+		struct scatterlist *sg;
+
+		for_each_sg(memdesc->sgt->sgl, sg, memdesc->sgt->nents, i) {
+			_pgsize_account_run(gpuaddr,
+				page_to_phys(sg_page(sg)) + sg->offset,
+				sg->length, sizes);
+			gpuaddr += sg->length;
+		}
+	}
+
+	for (i = 0; i < KGSL_MMU_PGSIZE_MAX; i++) {
+		if (add)
+			atomic_long_add(sizes[i],
+				&pagetable->stats.mapped_pgsize[i]);
+		else
+			atomic_long_sub(sizes[i],
+				&pagetable->stats.mapped_pgsize[i]);
+	}
+}
+
 int
 kgsl_mmu_map(struct kgsl_pagetable *pagetable,
 				struct kgsl_memdesc *memdesc)
@@ -407,6 +535,7 @@ kgsl_mmu_map(struct kgsl_pagetable *pagetable,
 	atomic_inc(&pagetable->stats.entries);
 	KGSL_STATS_ADD(size, &pagetable->stats.mapped,
 		&pagetable->stats.max_mapped);
+	_mmu_pgsize_stats(pagetable, memdesc, true);
 
 	memdesc->priv |= KGSL_MEMDESC_MAPPED;
 
@@ -480,6 +609,7 @@ kgsl_mmu_unmap(struct kgsl_pagetable *pagetable,
 
 	atomic_dec(&pagetable->stats.entries);
 	atomic_long_sub(size, &pagetable->stats.mapped);
+	_mmu_pgsize_stats(pagetable, memdesc, false);
 
 	if (!kgsl_memdesc_is_global(memdesc))
 		memdesc->priv &= ~KGSL_MEMDESC_MAPPED;
@@ -513,6 +643,28 @@ int kgsl_mmu_unmap_offset(struct kgsl_pagetable *pagetable,
 }
 EXPORT_SYMBOL(kgsl_mmu_unmap_offset);
 
+/**
+ * kgsl_mmu_map_pages() - Map pages at an offset of a mapped memdesc
+ * @pagetable: Pagetable the memdesc is mapped in
+ * @memdesc: Memory descriptor that the pages back
+ * @offset: Offset into the memdesc at which to map the pages
+ * @pages: Array of pages to map
+ * @count: Number of entries in @pages
+ *
+ * Used to fill in the pages of a lazily allocated memdesc.
+ */
+int kgsl_mmu_map_pages(struct kgsl_pagetable *pagetable,
+		struct kgsl_memdesc *memdesc, uint64_t offset,
+		struct page **pages, unsigned int count)
+{
+	if (PT_OP_VALID(pagetable, mmu_map_pages))
+		return pagetable->pt_ops->mmu_map_pages(pagetable, memdesc,
+				offset, pages, count);
+
+	return -EINVAL;
+}
+EXPORT_SYMBOL(kgsl_mmu_map_pages);
+
 void kgsl_mmu_remove_global(struct kgsl_device *device,
 		struct kgsl_memdesc *memdesc)
 {
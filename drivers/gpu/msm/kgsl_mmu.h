@@ -34,6 +34,17 @@ enum kgsl_mmutype {
 	KGSL_MMU_TYPE_NONE
 };
 
+/*
+ * enum kgsl_mmu_pgsize - Sizes of the IOMMU entries backing a mapping. 64K
+ * regions are mapped with 4K entries that carry the contiguous hint.
+ */
+enum kgsl_mmu_pgsize {
+	KGSL_MMU_PGSIZE_4K = 0,
+	KGSL_MMU_PGSIZE_64K,
+	KGSL_MMU_PGSIZE_2M,
+	KGSL_MMU_PGSIZE_MAX,
+};
+
 struct kgsl_pagetable {
 	spinlock_t lock;
 	struct kref refcount;
@@ -45,6 +56,7 @@ struct kgsl_pagetable {
 		atomic_t entries;
 		atomic_long_t mapped;
 		atomic_long_t max_mapped;
+		atomic_long_t mapped_pgsize[KGSL_MMU_PGSIZE_MAX];
 	} stats;
 	const struct kgsl_mmu_pt_ops *pt_ops;
 	uint64_t fault_addr;
@@ -106,6 +118,9 @@ struct kgsl_mmu_pt_ops {
 	int (*mmu_unmap_offset)(struct kgsl_pagetable *pt,
 			struct kgsl_memdesc *memdesc, uint64_t addr,
 			uint64_t offset, uint64_t size);
+	int (*mmu_map_pages)(struct kgsl_pagetable *pt,
+			struct kgsl_memdesc *memdesc, uint64_t offset,
+			struct page **pages, unsigned int count);
 };
 
 /*
@@ -133,6 +148,8 @@ struct kgsl_mmu_pt_ops {
 #define KGSL_MMU_PAGED BIT(8)
 /* The device requires a guard page */
 #define KGSL_MMU_NEED_GUARD_PAGE BIT(9)
+/* The MMU stalls on faults so that lazy allocations can be populated */
+#define KGSL_MMU_LAZY_ALLOC BIT(10)
 
 /**
  * struct kgsl_mmu - Master definition for KGSL MMU devices
@@ -227,6 +244,9 @@ int kgsl_mmu_map_offset(struct kgsl_pagetable *pagetable,
 int kgsl_mmu_unmap_offset(struct kgsl_pagetable *pagetable,
 		struct kgsl_memdesc *memdesc, uint64_t addr, uint64_t offset,
 		uint64_t size);
+int kgsl_mmu_map_pages(struct kgsl_pagetable *pagetable,
+		struct kgsl_memdesc *memdesc, uint64_t offset,
+		struct page **pages, unsigned int count);
 
 struct kgsl_memdesc *kgsl_mmu_get_qdss_global_entry(struct kgsl_device *device);
 
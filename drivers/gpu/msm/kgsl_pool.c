@@ -16,6 +16,7 @@
 #include <linux/slab.h>
 #include <linux/highmem.h>
 #include <linux/version.h>
+#include <linux/workqueue.h>
 
 #include "kgsl.h"
 #include "kgsl_device.h"
@@ -28,12 +29,14 @@
 /**
  * struct kgsl_page_pool - Structure to hold information for the pool
  * @pool_order: Page order describing the size of the page
- * @page_count: Number of pages currently present in the pool
+ * @page_count: Number of pages currently present in the pool, clean or dirty
  * @reserved_pages: Number of pages reserved at init for the pool
  * @allocation_allowed: Tells if reserved pool gets exhausted, can we allocate
  * from system memory
- * @list_lock: Spinlock for page list in the pool
- * @page_list: List of pages held/reserved in this pool
+ * @list_lock: Spinlock for page lists in the pool
+ * @page_list: List of zeroed pages held/reserved in this pool
+ * @dirty_count: Number of pages on the dirty list
+ * @dirty_list: List of freed pages waiting to be zeroed by the worker
  */
 struct kgsl_page_pool {
 	unsigned int pool_order;
@@ -42,12 +45,17 @@ struct kgsl_page_pool {
 	bool allocation_allowed;
 	spinlock_t list_lock;
 	struct list_head page_list;
+	int dirty_count;
+	struct list_head dirty_list;
 };
 
 static struct kgsl_page_pool kgsl_pools[KGSL_MAX_POOLS];
 static int kgsl_num_pools;
 static int kgsl_pool_max_pages;
 
+static void kgsl_pool_zero_worker(struct work_struct *work);
+static DECLARE_WORK(kgsl_pool_zero_work, kgsl_pool_zero_worker);
+
 
 /* Returns KGSL pool corresponding to input page order*/
 static struct kgsl_page_pool *
@@ -73,41 +81,133 @@ _kgsl_pool_zero_page(struct page *p, unsigned int pool_order)
 		struct page *page = nth_page(p, i);
 		void *addr = kmap_atomic(page);
 
-		memset(addr, 0, PAGE_SIZE);
+		clear_page(addr);
 		dmac_flush_range(addr, addr + PAGE_SIZE);
 		kunmap_atomic(addr);
 	}
 }
 
-/* Add a page to specified pool */
+/* Zero a page on the allocating thread */
 static void
-_kgsl_pool_add_page(struct kgsl_page_pool *pool, struct page *p)
+_kgsl_pool_zero_page_inline(struct page *p, unsigned int order)
 {
-	_kgsl_pool_zero_page(p, pool->pool_order);
+	_kgsl_pool_zero_page(p, order);
+	atomic_long_add(1 << order, &kgsl_driver.stats.pool_zero_inline);
+}
 
+/* Add a zeroed page to specified pool */
+static void
+_kgsl_pool_add_clean_page(struct kgsl_page_pool *pool, struct page *p)
+{
 	spin_lock(&pool->list_lock);
 	list_add_tail(&p->lru, &pool->page_list);
 	pool->page_count++;
 	spin_unlock(&pool->list_lock);
 }
 
-/* Returns a page from specified pool */
+/*
+ * Add a page to specified pool. It is parked on the dirty list and zeroed
+ * later by the worker, so the freeing thread does not pay for it.
+ */
+static void
+_kgsl_pool_add_page(struct kgsl_page_pool *pool, struct page *p)
+{
+	spin_lock(&pool->list_lock);
+	list_add_tail(&p->lru, &pool->dirty_list);
+	pool->dirty_count++;
+	pool->page_count++;
+	spin_unlock(&pool->list_lock);
+
+	queue_work(system_unbound_wq, &kgsl_pool_zero_work);
+}
+
+static struct page *
+_kgsl_pool_get_dirty_page_locked(struct kgsl_page_pool *pool)
+{
+	struct page *p;
+
+	p = list_first_entry(&pool->dirty_list, struct page, lru);
+	pool->dirty_count--;
+	pool->page_count--;
+	list_del(&p->lru);
+
+	return p;
+}
+
+/*
+ * Returns a zeroed page from specified pool. Clean pages are taken first,
+ * a dirty one is only zeroed inline if the worker has not got to it yet.
+ */
 static struct page *
 _kgsl_pool_get_page(struct kgsl_page_pool *pool)
 {
 	struct page *p = NULL;
+	bool dirty = false;
 
 	spin_lock(&pool->list_lock);
-	if (pool->page_count) {
+	if (!list_empty(&pool->page_list)) {
 		p = list_first_entry(&pool->page_list, struct page, lru);
 		pool->page_count--;
 		list_del(&p->lru);
+	} else if (pool->dirty_count) {
+		p = _kgsl_pool_get_dirty_page_locked(pool);
+		dirty = true;
 	}
 	spin_unlock(&pool->list_lock);
 
+	if (dirty)
+		_kgsl_pool_zero_page_inline(p, pool->pool_order);
+
 	return p;
 }
 
+/* Returns any page from specified pool, dirty ones first, for freeing */
+static struct page *
+_kgsl_pool_remove_page(struct kgsl_page_pool *pool)
+{
+	struct page *p = NULL;
+
+	spin_lock(&pool->list_lock);
+	if (pool->dirty_count) {
+		p = _kgsl_pool_get_dirty_page_locked(pool);
+	} else if (pool->page_count) {
+		p = list_first_entry(&pool->page_list, struct page, lru);
+		pool->page_count--;
+		list_del(&p->lru);
+	}
+	spin_unlock(&pool->list_lock);
+
+	return p;
+}
+
+/* Zero the dirty pages of all pools and move them to the clean lists */
+static void kgsl_pool_zero_worker(struct work_struct *work)
+{
+	struct kgsl_page_pool *pool;
+	struct page *p;
+	int i;
+
+	for (i = 0; i < kgsl_num_pools; i++) {
+		pool = &kgsl_pools[i];
+
+		while (1) {
+			spin_lock(&pool->list_lock);
+			if (!pool->dirty_count) {
+				spin_unlock(&pool->list_lock);
+				break;
+			}
+			p = _kgsl_pool_get_dirty_page_locked(pool);
+			spin_unlock(&pool->list_lock);
+
+			_kgsl_pool_zero_page(p, pool->pool_order);
+			atomic_long_add(1 << pool->pool_order,
+					&kgsl_driver.stats.pool_zero_async);
+			_kgsl_pool_add_clean_page(pool, p);
+			cond_resched();
+		}
+	}
+}
+
 /* Returns the number of pages in specified pool */
 static int
 kgsl_pool_size(struct kgsl_page_pool *kgsl_pool)
@@ -146,7 +246,7 @@ _kgsl_pool_shrink(struct kgsl_page_pool *pool, int num_pages)
 		return pcount;
 
 	for (j = 0; j < num_pages >> pool->pool_order; j++) {
-		struct page *page = _kgsl_pool_get_page(pool);
+		struct page *page = _kgsl_pool_remove_page(pool);
 
 		if (page != NULL) {
 			__free_pages(page, pool->pool_order);
@@ -265,6 +365,12 @@ void kgsl_pool_free_pages(struct page **pages, unsigned int pcount)
 		 */
 		struct page *p = pages[i];
 
+		/* Lazy allocations may not have every page populated */
+		if (p == NULL) {
+			i++;
+			continue;
+		}
+
 		i += 1 << compound_order(p);
 		kgsl_pool_free_page(p);
 	}
@@ -329,7 +435,7 @@ int kgsl_pool_alloc_page(int *page_size, struct page **pages,
 			} else
 				return -ENOMEM;
 		}
-		_kgsl_pool_zero_page(page, order);
+		_kgsl_pool_zero_page_inline(page, order);
 		goto done;
 	}
 
@@ -349,7 +455,7 @@ int kgsl_pool_alloc_page(int *page_size, struct page **pages,
 			page = alloc_pages(gfp_mask, order);
 			if (page == NULL)
 				return -ENOMEM;
-			_kgsl_pool_zero_page(page, order);
+			_kgsl_pool_zero_page_inline(page, order);
 			goto done;
 		}
 	}
@@ -380,7 +486,7 @@ int kgsl_pool_alloc_page(int *page_size, struct page **pages,
 				return -ENOMEM;
 		}
 
-		_kgsl_pool_zero_page(page, order);
+		_kgsl_pool_zero_page_inline(page, order);
 	}
 
 done:
@@ -491,6 +597,7 @@ static void kgsl_pool_config(unsigned int order, unsigned int reserved_pages,
 	kgsl_pools[kgsl_num_pools].allocation_allowed = allocation_allowed;
 	spin_lock_init(&kgsl_pools[kgsl_num_pools].list_lock);
 	INIT_LIST_HEAD(&kgsl_pools[kgsl_num_pools].page_list);
+	INIT_LIST_HEAD(&kgsl_pools[kgsl_num_pools].dirty_list);
 	kgsl_num_pools++;
 }
 
@@ -552,6 +659,8 @@ void kgsl_init_page_pools(struct platform_device *pdev)
 
 void kgsl_exit_page_pools(void)
 {
+	cancel_work_sync(&kgsl_pool_zero_work);
+
 	/* Release all pages in pools, if any.*/
 	kgsl_pool_reduce(0, true);
 
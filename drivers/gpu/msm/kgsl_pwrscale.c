@@ -13,6 +13,7 @@
 
 #include <linux/export.h>
 #include <linux/kernel.h>
+#include <linux/input.h>
 
 #include "kgsl.h"
 #include "kgsl_pwrscale.h"
@@ -94,6 +95,13 @@ void kgsl_pwrscale_wake(struct kgsl_device *device)
 
 	psc->time = ktime_get();
 
+	spin_lock(&psc->frame_lock);
+	psc->frame_count = 0;
+	psc->frame_deadline = 0;
+	psc->frame_start = psc->time;
+	psc->frame_busy = 0;
+	spin_unlock(&psc->frame_lock);
+
 	psc->next_governor_call = ktime_add_us(psc->time,
 			KGSL_GOVERNOR_CALL_INTERVAL);
 
@@ -119,6 +127,35 @@ void kgsl_pwrscale_busy(struct kgsl_device *device)
 }
 EXPORT_SYMBOL(kgsl_pwrscale_busy);
 
+/*
+ * kgsl_pwrscale_frame_done - note the end of a frame
+ * @device: The device
+ * @deadline_us: Deadline of the context that finished the frame, or 0
+ *
+ * Called when a command batch marked as the end of a frame retires. The
+ * governor is sampled right away so that the busy time it sees lines up
+ * with the frame boundary. The device mutex does not need to be held.
+ */
+void kgsl_pwrscale_frame_done(struct kgsl_device *device,
+		unsigned int deadline_us)
+{
+	struct kgsl_pwrscale *psc = &device->pwrscale;
+
+	if (!psc->enabled || psc->devfreq_wq == NULL)
+		return;
+
+	spin_lock(&psc->frame_lock);
+	psc->frame_count++;
+	if (deadline_us && (!psc->frame_deadline ||
+		deadline_us < psc->frame_deadline))
+		psc->frame_deadline = deadline_us;
+	psc->frame_end = ktime_get();
+	spin_unlock(&psc->frame_lock);
+
+	queue_work(psc->devfreq_wq, &psc->devfreq_notify_ws);
+}
+EXPORT_SYMBOL(kgsl_pwrscale_frame_done);
+
 /**
  * kgsl_pwrscale_update_stats() - update device busy statistics
  * @device: The device
@@ -149,6 +186,7 @@ void kgsl_pwrscale_update_stats(struct kgsl_device *device)
 			stats.ram_time += y;
 		}
 		device->pwrscale.accum_stats.busy_time += stats.busy_time;
+		device->pwrscale.frame_busy += stats.busy_time;
 		device->pwrscale.accum_stats.ram_time += stats.ram_time;
 		device->pwrscale.accum_stats.ram_wait += stats.ram_wait;
 		pwrctrl->clock_times[pwrctrl->active_pwrlevel] +=
@@ -504,6 +542,53 @@ int kgsl_devfreq_target(struct device *dev, unsigned long *freq, u32 flags)
 }
 EXPORT_SYMBOL(kgsl_devfreq_target);
 
+/*
+ * Fill in the frame statistics for the frames that ended since the last
+ * sample. Called with the device mutex held, after the busy counters have
+ * been read.
+ */
+static void kgsl_pwrscale_frame_stats(struct kgsl_pwrscale *psc)
+{
+	struct msm_adreno_gpu_status *status = &psc->gpu_status;
+	unsigned int count, deadline;
+	s64 period, budget, busy;
+	ktime_t end;
+
+	spin_lock(&psc->frame_lock);
+	count = psc->frame_count;
+	deadline = psc->frame_deadline;
+	end = psc->frame_end;
+	psc->frame_count = 0;
+	psc->frame_deadline = 0;
+	spin_unlock(&psc->frame_lock);
+
+	status->frames = 0;
+	status->frame_busy_us = 0;
+	status->frame_period_us = 0;
+	status->frame_slack_us = 0;
+
+	if (count == 0)
+		return;
+
+	period = div_s64(ktime_us_delta(end, psc->frame_start), count);
+	busy = div_u64(psc->frame_busy, count);
+
+	psc->frame_start = end;
+	psc->frame_busy = 0;
+
+	if (period <= 0 || period > KGSL_FRAME_MAX_PERIOD)
+		return;
+
+	budget = period;
+	if (deadline && deadline < budget)
+		budget = deadline;
+
+	status->frames = count;
+	status->frame_busy_us = (u32) busy;
+	status->frame_period_us = (u32) period;
+	status->frame_slack_us = (s32) (budget - busy);
+}
+
 /*
  * kgsl_devfreq_get_dev_status - devfreq_dev_profile.get_dev_status callback
  * @dev: see devfreq.h
@@ -546,7 +631,9 @@ int kgsl_devfreq_get_dev_status(struct device *dev,
 
 	stat->current_frequency = kgsl_pwrctrl_active_freq(&device->pwrctrl);
 
-	stat->private_data = &device->active_context_count;
+	kgsl_pwrscale_frame_stats(pwrscale);
+	pwrscale->gpu_status.context_count = device->active_context_count;
+	stat->private_data = &pwrscale->gpu_status;
 
 	/*
 	 * keep the latest devfreq_dev_status values
@@ -745,6 +832,28 @@ int kgsl_busmon_get_cur_freq(struct device *dev, unsigned long *freq)
 }
 
 
+/*
+ * kgsl_pwrscale_input_notify - interaction hint from a touchscreen IRQ
+ *
+ * A frame usually follows a touch. If the GPU is in slumber, have it come
+ * back at the max power level instead of ramping from the default one.
+ * Runs in hard interrupt context, so only the flag is set here; it is
+ * consumed by kgsl_pwrctrl_enable() under the device mutex.
+ */
+static int kgsl_pwrscale_input_notify(struct notifier_block *nb,
+				      unsigned long val, void *data)
+{
+	struct kgsl_pwrscale *psc = container_of(nb, struct kgsl_pwrscale,
+						 input_nb);
+	struct kgsl_device *device = container_of(psc, struct kgsl_device,
+						  pwrscale);
+
+	if (psc->enabled && ACCESS_ONCE(device->state) == KGSL_STATE_SLUMBER)
+		device->pwrctrl.wakeup_maxpwrlevel = 1;
+
+	return NOTIFY_OK;
+}
+
 /*
  * kgsl_pwrscale_init - Initialize pwrscale.
  * @dev: The device
@@ -775,6 +884,7 @@ int kgsl_pwrscale_init(struct device *dev, const char *governor)
 	profile = &pwrscale->gpu_profile.profile;
 
 	srcu_init_notifier_head(&pwrscale->nh);
+	spin_lock_init(&pwrscale->frame_lock);
 
 	profile->initial_freq =
 		pwr->pwrlevels[pwr->default_pwrlevel].gpu_freq;
@@ -892,6 +1002,9 @@ int kgsl_pwrscale_init(struct device *dev, const char *governor)
 			 &pwrscale->devfreqptr->dev.kobj,
 			"available_governors", "gpu_available_governor");
 
+	pwrscale->input_nb.notifier_call = kgsl_pwrscale_input_notify;
+	input_register_interaction_notifier(&pwrscale->input_nb);
+
 	return 0;
 }
 EXPORT_SYMBOL(kgsl_pwrscale_init);
@@ -912,6 +1025,7 @@ void kgsl_pwrscale_close(struct kgsl_device *device)
 	pwrscale = &device->pwrscale;
 	if (!pwrscale->devfreqptr)
 		return;
+	input_unregister_interaction_notifier(&pwrscale->input_nb);
 	flush_workqueue(pwrscale->devfreq_wq);
 	destroy_workqueue(pwrscale->devfreq_wq);
 	devfreq_remove_device(device->pwrscale.devfreqptr);
@@ -21,6 +21,9 @@
 /* devfreq governor call window in usec */
 #define KGSL_GOVERNOR_CALL_INTERVAL 10000
 
+/* Frames longer than this in usec are not reported to the governor */
+#define KGSL_FRAME_MAX_PERIOD 100000
+
 /* Power events to be tracked with history */
 #define KGSL_PWREVENT_STATE	0
 #define KGSL_PWREVENT_GPU_FREQ	1
@@ -90,6 +93,13 @@ struct kgsl_pwr_history {
  * @history - History of power events with timestamps and durations
  * @popp_level - Current level of POPP mitigation
  * @popp_state - Control state for POPP, on/off, recently pushed, etc
+ * @frame_lock - Protects the frame boundaries reported by the dispatcher
+ * @frame_count - Number of frames that ended since the last sample
+ * @frame_deadline - Shortest context deadline of those frames in usec
+ * @frame_end - Time at which the last of those frames ended
+ * @frame_start - Time at which the first of those frames started
+ * @frame_busy - GPU busy time in usec accumulated since frame_start
+ * @gpu_status - Status passed to the governor with each sample
  */
 struct kgsl_pwrscale {
 	struct devfreq *devfreqptr;
@@ -111,6 +121,14 @@ struct kgsl_pwrscale {
 	struct kgsl_pwr_history history[KGSL_PWREVENT_MAX];
 	int popp_level;
 	unsigned long popp_state;
+	spinlock_t frame_lock;
+	unsigned int frame_count;
+	unsigned int frame_deadline;
+	ktime_t frame_end;
+	ktime_t frame_start;
+	u64 frame_busy;
+	struct msm_adreno_gpu_status gpu_status;
+	struct notifier_block input_nb;
 };
 
 int kgsl_pwrscale_init(struct device *dev, const char *governor);
@@ -121,6 +139,8 @@ void kgsl_pwrscale_update_stats(struct kgsl_device *device);
 void kgsl_pwrscale_busy(struct kgsl_device *device);
 void kgsl_pwrscale_sleep(struct kgsl_device *device);
 void kgsl_pwrscale_wake(struct kgsl_device *device);
+void kgsl_pwrscale_frame_done(struct kgsl_device *device,
+		unsigned int deadline_us);
 
 void kgsl_pwrscale_enable(struct kgsl_device *device);
 void kgsl_pwrscale_disable(struct kgsl_device *device, bool turbo);
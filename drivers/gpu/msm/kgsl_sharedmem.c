@@ -41,6 +41,9 @@ static bool sharedmem_noretry_flag;
 
 static DEFINE_MUTEX(kernel_map_global_lock);
 
+/* Serializes populating the chunks of lazy allocations */
+static DEFINE_MUTEX(lazy_populate_lock);
+
 struct cp2_mem_chunks {
 	unsigned int chunk_list;
 	unsigned int chunk_list_size;
@@ -146,6 +149,96 @@ static ssize_t mem_entry_sysfs_show(struct kobject *kobj,
 	return ret;
 }
 
+static const char * const gpu_latency_names[KGSL_LATENCY_NR_TYPES] = {
+	[KGSL_LATENCY_QUEUE] = "queue",
+	[KGSL_LATENCY_GPU] = "gpu",
+	[KGSL_LATENCY_RETIRE] = "retire",
+};
+
+static int gpu_latency_print(char *buf, int pos, const char *ctx,
+		struct kgsl_context_latency *lat)
+{
+	int type, i;
+
+	for (type = 0; type < KGSL_LATENCY_NR_TYPES; type++) {
+		unsigned int count = 0;
+
+		for (i = 0; i < KGSL_LATENCY_BUCKETS; i++)
+			count += lat->hist[type][i];
+
+		pos += scnprintf(buf + pos, PAGE_SIZE - pos, "%s %s %u %llu",
+			ctx, gpu_latency_names[type], count,
+			lat->total_us[type]);
+		for (i = 0; i < KGSL_LATENCY_BUCKETS; i++)
+			pos += scnprintf(buf + pos, PAGE_SIZE - pos, " %u",
+				lat->hist[type][i]);
+		pos += scnprintf(buf + pos, PAGE_SIZE - pos, "\n");
+	}
+
+	return pos;
+}
+
+/*
+ * Show the command batch latencies of the process: one line per context
+ * and latency type with the context id, the type, the number of command
+ * batches, their total in us and the log2 us histogram. The first lines,
+ * for context "all", are the sum over the contexts of the process.
+ */
+static ssize_t
+gpu_latency_show(struct kgsl_process_private *priv, int type, char *buf)
+{
+	struct kgsl_context_latency all;
+	struct kgsl_context *context;
+	int pos, i, t, b, id;
+
+	memset(&all, 0, sizeof(all));
+	for (i = 0; i < KGSL_DEVICE_MAX; i++) {
+		struct kgsl_device *device = kgsl_driver.devp[i];
+
+		if (device == NULL)
+			continue;
+
+		read_lock(&device->context_lock);
+		idr_for_each_entry(&device->context_idr, context, id) {
+			if (context->proc_priv != priv)
+				continue;
+			for (t = 0; t < KGSL_LATENCY_NR_TYPES; t++) {
+				for (b = 0; b < KGSL_LATENCY_BUCKETS; b++)
+					all.hist[t][b] +=
+						context->latency.hist[t][b];
+				all.total_us[t] += context->latency.total_us[t];
+			}
+		}
+		read_unlock(&device->context_lock);
+	}
+
+	pos = gpu_latency_print(buf, 0, "all", &all);
+
+	for (i = 0; i < KGSL_DEVICE_MAX; i++) {
+		struct kgsl_device *device = kgsl_driver.devp[i];
+
+		if (device == NULL)
+			continue;
+
+		read_lock(&device->context_lock);
+		idr_for_each_entry(&device->context_idr, context, id) {
+			char name[16];
+
+			if (context->proc_priv != priv)
+				continue;
+			snprintf(name, sizeof(name), "%u", context->id);
+			pos = gpu_latency_print(buf, pos, name,
+				&context->latency);
+		}
+		read_unlock(&device->context_lock);
+	}
+
+	return pos;
+}
+
+static struct kgsl_mem_entry_attribute gpu_latency_attr =
+	__MEM_ENTRY_ATTR(0, gpu_latency, gpu_latency_show);
+
 static const struct sysfs_ops mem_entry_sysfs_ops = {
 	.show = mem_entry_sysfs_show,
 };
@@ -172,6 +265,7 @@ kgsl_process_uninit_sysfs(struct kgsl_process_private *private)
 		sysfs_remove_file(&private->kobj,
 			&mem_stats[i].max_attr.attr);
 	}
+	sysfs_remove_file(&private->kobj, &gpu_latency_attr.attr);
 
 	kobject_put(&private->kobj);
 	/* Put the refcount we got in kgsl_process_init_sysfs */
@@ -217,6 +311,10 @@ void kgsl_process_init_sysfs(struct kgsl_device *device,
 				mem_stats[i].max_attr.attr.name);
 
 	}
+
+	if (sysfs_create_file(&private->kobj, &gpu_latency_attr.attr))
+		WARN(1, "Couldn't create sysfs file '%s'\n",
+			gpu_latency_attr.attr.name);
 }
 
 static ssize_t kgsl_drv_memstat_show(struct device *dev,
@@ -245,6 +343,10 @@ static ssize_t kgsl_drv_memstat_show(struct device *dev,
 		val = atomic_long_read(&kgsl_driver.stats.mapped);
 	else if (!strcmp(attr->attr.name, "mapped_max"))
 		val = atomic_long_read(&kgsl_driver.stats.mapped_max);
+	else if (!strcmp(attr->attr.name, "pool_zero_inline"))
+		val = atomic_long_read(&kgsl_driver.stats.pool_zero_inline);
+	else if (!strcmp(attr->attr.name, "pool_zero_async"))
+		val = atomic_long_read(&kgsl_driver.stats.pool_zero_async);
 
 	return snprintf(buf, PAGE_SIZE, "%llu\n", val);
 }
@@ -282,6 +384,8 @@ static DEVICE_ATTR(secure, 0444, kgsl_drv_memstat_show, NULL);
 static DEVICE_ATTR(secure_max, 0444, kgsl_drv_memstat_show, NULL);
 static DEVICE_ATTR(mapped, 0444, kgsl_drv_memstat_show, NULL);
 static DEVICE_ATTR(mapped_max, 0444, kgsl_drv_memstat_show, NULL);
+static DEVICE_ATTR(pool_zero_inline, 0444, kgsl_drv_memstat_show, NULL);
+static DEVICE_ATTR(pool_zero_async, 0444, kgsl_drv_memstat_show, NULL);
 static DEVICE_ATTR(full_cache_threshold, 0644,
 		kgsl_drv_full_cache_threshold_show,
 		kgsl_drv_full_cache_threshold_store);
@@ -297,6 +401,8 @@ static const struct device_attribute *drv_attr_list[] = {
 	&dev_attr_secure_max,
 	&dev_attr_mapped,
 	&dev_attr_mapped_max,
+	&dev_attr_pool_zero_inline,
+	&dev_attr_pool_zero_async,
 	&dev_attr_full_cache_threshold,
 	NULL
 };
@@ -365,6 +471,13 @@ static int kgsl_page_alloc_vmfault(struct kgsl_memdesc *memdesc,
 	if (pgoff < memdesc->page_count) {
 		struct page *page = memdesc->pages[pgoff];
 
+		if (page == NULL && kgsl_memdesc_is_lazy(memdesc)) {
+			if (kgsl_sharedmem_lazy_populate(memdesc, offset))
+				return VM_FAULT_OOM;
+
+			page = memdesc->pages[pgoff];
+		}
+
 		get_page(page);
 		vmf->page = page;
 
@@ -401,6 +514,19 @@ done:
 	mutex_unlock(&kernel_map_global_lock);
 }
 
+/* Return the number of bytes of a lazy memdesc that have been populated */
+static uint64_t _lazy_populated_size(struct kgsl_memdesc *memdesc)
+{
+	uint64_t size = 0;
+	unsigned int i;
+
+	for (i = 0; i < memdesc->page_count; i++)
+		if (memdesc->pages[i] != NULL)
+			size += PAGE_SIZE;
+
+	return size;
+}
+
 static void kgsl_page_alloc_free(struct kgsl_memdesc *memdesc)
 {
 	kgsl_page_alloc_unmap_kernel(memdesc);
@@ -423,6 +549,9 @@ static void kgsl_page_alloc_free(struct kgsl_memdesc *memdesc)
 		}
 
 		atomic_long_sub(memdesc->size, &kgsl_driver.stats.secure);
+	} else if (kgsl_memdesc_is_lazy(memdesc)) {
+		atomic_long_sub(_lazy_populated_size(memdesc),
+			&kgsl_driver.stats.page_alloc);
 	} else {
 		atomic_long_sub(memdesc->size, &kgsl_driver.stats.page_alloc);
 	}
@@ -460,6 +589,18 @@ static int kgsl_page_alloc_map_kernel(struct kgsl_memdesc *memdesc)
 	if (memdesc->size > ULONG_MAX)
 		return -ENOMEM;
 
+	/* vmap() needs every page, so populate what hasn't been touched yet */
+	if (kgsl_memdesc_is_lazy(memdesc) && !memdesc->hostptr) {
+		uint64_t offset;
+
+		for (offset = 0; offset < memdesc->size;
+				offset += KGSL_LAZY_CHUNK_SIZE) {
+			ret = kgsl_sharedmem_lazy_populate(memdesc, offset);
+			if (ret)
+				return ret;
+		}
+	}
+
 	mutex_lock(&kernel_map_global_lock);
 	if ((!memdesc->hostptr) && (memdesc->pages != NULL)) {
 		pgprot_t page_prot = pgprot_writecombine(PAGE_KERNEL);
@@ -620,6 +761,30 @@ static int kgsl_do_cache_op(struct page *page, void *addr,
 	return 0;
 }
 
+/*
+ * Cache operations on a lazy memdesc go page by page. Pages that were never
+ * populated have never been accessed, so there is nothing to maintain.
+ */
+static int kgsl_lazy_cache_range_op(struct kgsl_memdesc *memdesc,
+		uint64_t offset, uint64_t size, unsigned int op)
+{
+	int ret = 0;
+
+	while (size && !ret) {
+		struct page *page = memdesc->pages[offset >> PAGE_SHIFT];
+		uint64_t pg_offset = offset & ~PAGE_MASK;
+		uint64_t len = min_t(uint64_t, PAGE_SIZE - pg_offset, size);
+
+		if (page != NULL)
+			ret = kgsl_do_cache_op(page, NULL, pg_offset, len, op);
+
+		offset += len;
+		size -= len;
+	}
+
+	return ret;
+}
+
 int kgsl_cache_range_op(struct kgsl_memdesc *memdesc, uint64_t offset,
 		uint64_t size, unsigned int op)
 {
@@ -650,6 +815,9 @@ int kgsl_cache_range_op(struct kgsl_memdesc *memdesc, uint64_t offset,
 		return ret;
 	}
 
+	if (kgsl_memdesc_is_lazy(memdesc))
+		return kgsl_lazy_cache_range_op(memdesc, offset, size, op);
+
 	/*
 	 * If the buffer is not to mapped to kernel, perform cache
 	 * operations after mapping to kernel.
@@ -746,6 +914,19 @@ kgsl_sharedmem_page_alloc_user(struct kgsl_memdesc *memdesc,
 		goto done;
 	}
 
+	/*
+	 * Lazy allocations only get their page array here. The pages are
+	 * allocated a chunk at a time by kgsl_sharedmem_lazy_populate() when
+	 * the GPU or the CPU fault on them.
+	 */
+	if (memdesc->flags & KGSL_MEMFLAGS_LAZY_ALLOC) {
+		memset(memdesc->pages, 0, len_alloc * sizeof(struct page *));
+		memdesc->priv |= KGSL_MEMDESC_LAZY;
+		memdesc->size = size;
+		memdesc->page_count = len_alloc;
+		return 0;
+	}
+
 	len = size;
 
 	while (len > 0) {
@@ -858,6 +1039,80 @@ done:
 	return ret;
 }
 
+/**
+ * kgsl_sharedmem_lazy_populate() - Allocate the pages backing an offset
+ * @memdesc: Lazy memory descriptor
+ * @offset: Offset into the memdesc that needs to be backed
+ *
+ * Allocate the KGSL_LAZY_CHUNK_SIZE chunk holding @offset, if that hasn't
+ * happened yet, and map it into the GPU pagetable of the memdesc.
+ *
+ * Return: 0 on success or negative error code on failure
+ */
+int kgsl_sharedmem_lazy_populate(struct kgsl_memdesc *memdesc,
+		uint64_t offset)
+{
+	unsigned int align = kgsl_memdesc_get_align(memdesc);
+	unsigned int first, count, pcount = 0;
+	uint64_t start, len;
+	int page_size;
+	int ret = 0;
+
+	if (!kgsl_memdesc_is_lazy(memdesc) || offset >= memdesc->size)
+		return -EINVAL;
+
+	start = offset & ~((uint64_t) KGSL_LAZY_CHUNK_SIZE - 1);
+	len = min_t(uint64_t, KGSL_LAZY_CHUNK_SIZE, memdesc->size - start);
+	first = start >> PAGE_SHIFT;
+	count = len >> PAGE_SHIFT;
+
+	mutex_lock(&lazy_populate_lock);
+
+	/* Chunks are populated as a whole, so the first page tells */
+	if (memdesc->pages[first] != NULL)
+		goto out;
+
+	page_size = kgsl_get_page_size(len, align);
+
+	while (pcount < count) {
+		int page_count;
+
+		page_count = kgsl_pool_alloc_page(&page_size,
+					memdesc->pages + first + pcount,
+					count - pcount, &align);
+		if (page_count <= 0) {
+			if (page_count == -EAGAIN)
+				continue;
+
+			ret = -ENOMEM;
+			goto err;
+		}
+
+		pcount += page_count;
+		page_size = kgsl_get_page_size(
+			(size_t) (count - pcount) << PAGE_SHIFT, align);
+	}
+
+	if (memdesc->priv & KGSL_MEMDESC_MAPPED) {
+		ret = kgsl_mmu_map_pages(memdesc->pagetable, memdesc, start,
+			memdesc->pages + first, count);
+		if (ret)
+			goto err;
+	}
+
+	KGSL_STATS_ADD(len, &kgsl_driver.stats.page_alloc,
+		&kgsl_driver.stats.page_alloc_max);
+	goto out;
+
+err:
+	kgsl_pool_free_pages(memdesc->pages + first, pcount);
+	memset(memdesc->pages + first, 0, count * sizeof(struct page *));
+out:
+	mutex_unlock(&lazy_populate_lock);
+	return ret;
+}
+EXPORT_SYMBOL(kgsl_sharedmem_lazy_populate);
+
 void kgsl_sharedmem_free(struct kgsl_memdesc *memdesc)
 {
 	if (memdesc == NULL || memdesc->size == 0)
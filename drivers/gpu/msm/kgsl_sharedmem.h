@@ -73,6 +73,12 @@ void kgsl_get_memory_usage(char *str, size_t len, uint64_t memflags);
 int kgsl_sharedmem_page_alloc_user(struct kgsl_memdesc *memdesc,
 				uint64_t size);
 
+/* Lazy allocations are populated in chunks of this many bytes */
+#define KGSL_LAZY_CHUNK_SIZE SZ_64K
+
+int kgsl_sharedmem_lazy_populate(struct kgsl_memdesc *memdesc,
+				uint64_t offset);
+
 #define MEMFLAGS(_flags, _mask, _shift) \
 	((unsigned int) (((_flags) & (_mask)) >> (_shift)))
 
@@ -191,6 +197,17 @@ static inline bool kgsl_memdesc_is_secured(const struct kgsl_memdesc *memdesc)
 	return memdesc && (memdesc->priv & KGSL_MEMDESC_SECURE);
 }
 
+/*
+ * kgsl_memdesc_is_lazy - are the pages of this buffer allocated on demand?
+ * @memdesc: the memdesc
+ *
+ * Returns true if pages are only allocated on first access, false otherwise
+ */
+static inline bool kgsl_memdesc_is_lazy(const struct kgsl_memdesc *memdesc)
+{
+	return memdesc && (memdesc->priv & KGSL_MEMDESC_LAZY);
+}
+
 /*
  * kgsl_memdesc_has_guard_page - is the last page a guard page?
  * @memdesc - the memdesc
@@ -16,6 +16,8 @@
 #include <linux/utsname.h>
 #include <linux/sched.h>
 #include <linux/idr.h>
+#include <linux/vmalloc.h>
+#include <linux/zlib.h>
 
 #include "kgsl.h"
 #include "kgsl_log.h"
@@ -31,6 +33,15 @@ struct kgsl_snapshot_cp_obj {
 	struct list_head node;
 };
 
+/* An IB found during the snapshot that the worker still has to parse */
+
+struct kgsl_snapshot_pending_ib {
+	struct kgsl_process_private *process;
+	uint64_t gpuaddr;
+	uint64_t dwords;
+	struct list_head node;
+};
+
 struct snapshot_obj_itr {
 	u8 *buf;      /* Buffer pointer to write to */
 	int pos;        /* Current position in the sequence */
@@ -602,8 +613,10 @@ void kgsl_device_snapshot(struct kgsl_device *device,
 		return;
 
 	init_completion(&snapshot->dump_gate);
+	mutex_init(&snapshot->mempool_lock);
 	INIT_LIST_HEAD(&snapshot->obj_list);
 	INIT_LIST_HEAD(&snapshot->cp_list);
+	INIT_LIST_HEAD(&snapshot->ib_list);
 	INIT_WORK(&snapshot->work, kgsl_snapshot_save_frozen_objs);
 
 	snapshot->start = device->snapshot_memory.ptr;
@@ -690,6 +703,61 @@ static void kgsl_snapshot_process_ib_obj_list(struct kgsl_snapshot *snapshot)
 	}
 }
 
+/*
+ * Inflate the memory pool if it was compressed by the worker. The raw copy
+ * is kept from then on until the snapshot is released.
+ */
+static int _mempool_decompress(struct kgsl_snapshot *snapshot)
+{
+	struct z_stream_s stream;
+	u8 *mempool;
+	int ret = 0;
+
+	mutex_lock(&snapshot->mempool_lock);
+
+	if (snapshot->mempool_z == NULL)
+		goto done;
+
+	memset(&stream, 0, sizeof(stream));
+
+	mempool = vmalloc(snapshot->mempool_size);
+	stream.workspace = vmalloc(zlib_inflate_workspacesize());
+	if (mempool == NULL || stream.workspace == NULL) {
+		ret = -ENOMEM;
+		goto err;
+	}
+
+	if (zlib_inflateInit(&stream) != Z_OK) {
+		ret = -EIO;
+		goto err;
+	}
+
+	stream.next_in = snapshot->mempool_z;
+	stream.avail_in = snapshot->mempool_zsize;
+	stream.next_out = mempool;
+	stream.avail_out = snapshot->mempool_size;
+
+	if (zlib_inflate(&stream, Z_FINISH) != Z_STREAM_END ||
+		stream.total_out != snapshot->mempool_size)
+		ret = -EIO;
+
+	zlib_inflateEnd(&stream);
+
+	if (ret)
+		goto err;
+
+	vfree(snapshot->mempool_z);
+	snapshot->mempool_z = NULL;
+	snapshot->mempool = mempool;
+	mempool = NULL;
+err:
+	vfree(stream.workspace);
+	vfree(mempool);
+done:
+	mutex_unlock(&snapshot->mempool_lock);
+	return ret;
+}
+
 #define to_snapshot_attr(a) \
 container_of(a, struct kgsl_snapshot_attribute, attr)
 
@@ -726,6 +794,8 @@ static ssize_t snapshot_show(struct file *filep, struct kobject *kobj,
 	 * to allow userspace to bail if things go horribly wrong.
 	 */
 	ret = wait_for_completion_interruptible(&snapshot->dump_gate);
+	if (ret == 0)
+		ret = _mempool_decompress(snapshot);
 	if (ret) {
 		atomic_dec(&snapshot->sysfs_read);
 		return ret;
@@ -778,6 +848,7 @@ static ssize_t snapshot_show(struct file *filep, struct kobject *kobj,
 			if (snapshot->mempool)
 				vfree(snapshot->mempool);
 
+			vfree(snapshot->mempool_z);
 			kfree(snapshot);
 			KGSL_CORE_ERR("snapshot: objects released\n");
 		}
@@ -854,6 +925,48 @@ static ssize_t snapshot_crashdumper_store(struct kgsl_device *device,
 	return (ssize_t) ret < 0 ? ret : count;
 }
 
+/* Show whether saved GPU objects are compressed */
+static ssize_t snapshot_compress_show(struct kgsl_device *device, char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%d\n", device->snapshot_compress);
+}
+
+/* Enable or disable compression of the saved GPU objects */
+static ssize_t snapshot_compress_store(struct kgsl_device *device,
+	const char *buf, size_t count)
+{
+	unsigned int val = 0;
+	int ret;
+
+	ret = kgsl_sysfs_store(buf, &val);
+
+	if (!ret && device)
+		device->snapshot_compress = (bool)val;
+
+	return (ssize_t) ret < 0 ? ret : count;
+}
+
+/* Show the cap on the GPU object memory saved with a snapshot */
+static ssize_t snapshot_objmem_max_show(struct kgsl_device *device, char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%u\n", device->snapshot_objmem_max);
+}
+
+/* Set the cap on the GPU object memory saved with a snapshot */
+static ssize_t snapshot_objmem_max_store(struct kgsl_device *device,
+	const char *buf, size_t count)
+{
+	unsigned int val = 0;
+	int ret;
+
+	ret = kgsl_sysfs_store(buf, &val);
+
+	if (!ret && device)
+		device->snapshot_objmem_max = val;
+
+	return (ssize_t) ret < 0 ? ret : count;
+}
+
 /* Show the timestamp of the last collected snapshot */
 static ssize_t timestamp_show(struct kgsl_device *device, char *buf)
 {
@@ -882,6 +995,10 @@ static SNAPSHOT_ATTR(faultcount, 0644, faultcount_show, faultcount_store);
 static SNAPSHOT_ATTR(force_panic, 0644, force_panic_show, force_panic_store);
 static SNAPSHOT_ATTR(snapshot_crashdumper, 0644, snapshot_crashdumper_show,
 	snapshot_crashdumper_store);
+static SNAPSHOT_ATTR(snapshot_compress, 0644, snapshot_compress_show,
+	snapshot_compress_store);
+static SNAPSHOT_ATTR(snapshot_objmem_max, 0644, snapshot_objmem_max_show,
+	snapshot_objmem_max_store);
 
 static ssize_t snapshot_sysfs_show(struct kobject *kobj,
 	struct attribute *attr, char *buf)
@@ -963,6 +1080,8 @@ int kgsl_device_snapshot_init(struct kgsl_device *device)
 	device->snapshot_faultcount = 0;
 	device->force_panic = 0;
 	device->snapshot_crashdumper = 1;
+	device->snapshot_compress = true;
+	device->snapshot_objmem_max = KGSL_SNAPSHOT_OBJMEM_MAX;
 
 	ret = kobject_init_and_add(&device->snapshot_kobj, &ktype_snapshot,
 		&device->dev->kobj, "snapshot");
@@ -988,6 +1107,16 @@ int kgsl_device_snapshot_init(struct kgsl_device *device)
 
 	ret  = sysfs_create_file(&device->snapshot_kobj,
 			&attr_snapshot_crashdumper.attr);
+	if (ret)
+		goto done;
+
+	ret  = sysfs_create_file(&device->snapshot_kobj,
+			&attr_snapshot_compress.attr);
+	if (ret)
+		goto done;
+
+	ret  = sysfs_create_file(&device->snapshot_kobj,
+			&attr_snapshot_objmem_max.attr);
 done:
 	return ret;
 }
@@ -1014,6 +1143,8 @@ void kgsl_device_snapshot_close(struct kgsl_device *device)
 	device->snapshot_faultcount = 0;
 	device->force_panic = 0;
 	device->snapshot_crashdumper = 1;
+	device->snapshot_compress = true;
+	device->snapshot_objmem_max = KGSL_SNAPSHOT_OBJMEM_MAX;
 }
 EXPORT_SYMBOL(kgsl_device_snapshot_close);
 
@@ -1041,6 +1172,130 @@ int kgsl_snapshot_add_ib_obj_list(struct kgsl_snapshot *snapshot,
 	return 0;
 }
 
+/**
+ * kgsl_snapshot_add_ib() - Queue an IB to be parsed by the snapshot worker
+ * @snapshot: The snapshot being taken
+ * @process: The process that owns the IB
+ * @gpuaddr: GPU address of the IB
+ * @dwords: Size of the IB in dwords
+ *
+ * Record an IB whose objects need to be dumped. Since the objects are only
+ * captured once the worker runs, the IB is parsed there too rather than
+ * while the device is held for fault recovery.
+ * Returns 0 on success else -ENOMEM on error
+ */
+int kgsl_snapshot_add_ib(struct kgsl_snapshot *snapshot,
+	struct kgsl_process_private *process, uint64_t gpuaddr,
+	uint64_t dwords)
+{
+	struct kgsl_snapshot_pending_ib *ib;
+
+	if (process == NULL)
+		return 0;
+
+	/* IBs are often reused, keep the largest size seen */
+	list_for_each_entry(ib, &snapshot->ib_list, node) {
+		if (ib->process == process && ib->gpuaddr == gpuaddr) {
+			ib->dwords = max_t(uint64_t, ib->dwords, dwords);
+			return 0;
+		}
+	}
+
+	ib = kzalloc(sizeof(*ib), GFP_KERNEL);
+	if (ib == NULL)
+		return -ENOMEM;
+
+	if (!kgsl_process_private_get(process)) {
+		kfree(ib);
+		return 0;
+	}
+
+	ib->process = process;
+	ib->gpuaddr = gpuaddr;
+	ib->dwords = dwords;
+	list_add_tail(&ib->node, &snapshot->ib_list);
+	return 0;
+}
+EXPORT_SYMBOL(kgsl_snapshot_add_ib);
+
+/* Parse the IBs queued by kgsl_snapshot_add_ib() */
+static void _snapshot_parse_ibs(struct kgsl_device *device,
+		struct kgsl_snapshot *snapshot)
+{
+	struct kgsl_snapshot_pending_ib *ib, *tmp;
+	struct adreno_ib_object_list *ib_obj_list;
+	bool too_many = false;
+
+	list_for_each_entry_safe(ib, tmp, &snapshot->ib_list, node) {
+		if (!kgsl_snapshot_have_object(snapshot, ib->process,
+				ib->gpuaddr, ib->dwords << 2)) {
+			if (-E2BIG == adreno_ib_create_object_list(device,
+					ib->process, ib->gpuaddr, ib->dwords,
+					snapshot->ib2base, &ib_obj_list))
+				too_many = true;
+
+			if (ib_obj_list)
+				kgsl_snapshot_add_ib_obj_list(snapshot,
+					ib_obj_list);
+		}
+
+		list_del(&ib->node);
+		kgsl_process_private_put(ib->process);
+		kfree(ib);
+	}
+
+	if (too_many)
+		KGSL_DRV_ERR(device,
+			"snapshot: Too many objects in IB, not all dumped\n");
+}
+
+/*
+ * Compress the memory pool to save memory while the snapshot waits to be
+ * read. The raw pool is kept if compression fails or doesn't pay off.
+ */
+static void _mempool_compress(struct kgsl_snapshot *snapshot)
+{
+	struct z_stream_s stream;
+	u8 *out, *dest = NULL;
+
+	memset(&stream, 0, sizeof(stream));
+
+	stream.workspace = vmalloc(zlib_deflate_workspacesize(MAX_WBITS,
+		MAX_MEM_LEVEL));
+	if (stream.workspace == NULL)
+		return;
+
+	out = vmalloc(snapshot->mempool_size);
+	if (out == NULL)
+		goto done;
+
+	if (zlib_deflateInit(&stream, Z_BEST_SPEED) != Z_OK)
+		goto done;
+
+	stream.next_in = snapshot->mempool;
+	stream.avail_in = snapshot->mempool_size;
+	stream.next_out = out;
+	stream.avail_out = snapshot->mempool_size;
+
+	if (zlib_deflate(&stream, Z_FINISH) == Z_STREAM_END)
+		dest = vmalloc(stream.total_out);
+
+	zlib_deflateEnd(&stream);
+
+	if (dest == NULL)
+		goto done;
+
+	memcpy(dest, out, stream.total_out);
+
+	snapshot->mempool_z = dest;
+	snapshot->mempool_zsize = stream.total_out;
+	vfree(snapshot->mempool);
+	snapshot->mempool = NULL;
+done:
+	vfree(out);
+	vfree(stream.workspace);
+}
+
 static size_t _mempool_add_object(struct kgsl_snapshot *snapshot, u8 *data,
 		struct kgsl_snapshot_object *obj)
 {
@@ -1094,22 +1349,40 @@ void kgsl_snapshot_save_frozen_objs(struct work_struct *work)
 				struct kgsl_snapshot, work);
 	struct kgsl_device *device = kgsl_get_device(KGSL_DEVICE_3D0);
 	struct kgsl_snapshot_object *obj, *tmp;
-	size_t size = 0;
+	size_t size = 0, objsize;
+	unsigned int dropped = 0;
 	void *ptr;
 
 	if (IS_ERR_OR_NULL(device))
 		return;
 
+	_snapshot_parse_ibs(device, snapshot);
+
 	kgsl_snapshot_process_ib_obj_list(snapshot);
 
-	list_for_each_entry(obj, &snapshot->obj_list, node) {
+	/* Drop the objects that don't fit under the memory cap */
+	list_for_each_entry_safe(obj, tmp, &snapshot->obj_list, node) {
 		obj->size = ALIGN(obj->size, 4);
 
-		size += ((size_t) obj->size +
+		objsize = ((size_t) obj->size +
 			sizeof(struct kgsl_snapshot_gpu_object_v2) +
 			sizeof(struct kgsl_snapshot_section_header));
+
+		if (device->snapshot_objmem_max &&
+			size + objsize > device->snapshot_objmem_max) {
+			kgsl_snapshot_put_object(obj);
+			dropped++;
+			continue;
+		}
+
+		size += objsize;
 	}
 
+	if (dropped)
+		KGSL_DRV_ERR(device,
+			"snapshot: %u objects over the %u byte cap not dumped\n",
+			dropped, device->snapshot_objmem_max);
+
 	if (size == 0)
 		goto done;
 
@@ -1128,6 +1401,10 @@ void kgsl_snapshot_save_frozen_objs(struct work_struct *work)
 
 		kgsl_snapshot_put_object(obj);
 	}
+
+	if (snapshot->mempool && snapshot->mempool_size &&
+		device->snapshot_compress)
+		_mempool_compress(snapshot);
 done:
 	/*
 	 * Get rid of the process struct here, so that it doesn't sit
@@ -22,9 +22,6 @@
 
 #include "kgsl_sync.h"
 
-static void kgsl_sync_timeline_signal(struct sync_timeline *timeline,
-	unsigned int timestamp);
-
 static struct sync_pt *kgsl_sync_pt_create(struct sync_timeline *timeline,
 	struct kgsl_context *context, unsigned int timestamp)
 {
@@ -77,62 +74,68 @@ static int kgsl_sync_pt_compare(struct sync_pt *a, struct sync_pt *b)
 	return timestamp_cmp(ts_a, ts_b);
 }
 
-struct kgsl_fence_event_priv {
-	struct kgsl_context *context;
-	unsigned int timestamp;
-};
+/*
+ * Note that the timeline has a fence waiting for @timestamp. Rather than
+ * registering an event per fence, the timeline only remembers the latest
+ * timestamp it has to reach and is signalled straight from the retire
+ * path by kgsl_sync_timeline_retire().
+ */
+static void _add_fence_pending(struct kgsl_sync_timeline *ktimeline,
+	unsigned int timestamp)
+{
+	spin_lock(&ktimeline->lock);
+	if (!ktimeline->pending ||
+		timestamp_cmp(timestamp, ktimeline->pending_timestamp) > 0)
+		ktimeline->pending_timestamp = timestamp;
+	ktimeline->pending = true;
+	spin_unlock(&ktimeline->lock);
+}
 
 /**
- * kgsl_fence_event_cb - Event callback for a fence timestamp event
- * @device - The KGSL device that expired the timestamp
- * @context- Pointer to the context that owns the event
- * @priv: Private data for the callback
- * @result - Result of the event (retired or canceled)
+ * kgsl_sync_timeline_retire() - Signal the fences of a retired timestamp
+ * @context: Context whose timestamp retired
+ * @timestamp: Latest retired timestamp of the context
+ * @flush: True if the context is going away and all its fences should be
+ * signalled
  *
- * Signal a fence following the expiration of a timestamp
+ * Called from the event processing path each time the retired timestamp of
+ * the context moves. All the fences waiting on the timeline are resolved
+ * with a single pass.
  */
-
-static void kgsl_fence_event_cb(struct kgsl_device *device,
-		struct kgsl_event_group *group, void *priv, int result)
+void kgsl_sync_timeline_retire(struct kgsl_context *context,
+	unsigned int timestamp, bool flush)
 {
-	struct kgsl_fence_event_priv *ev = priv;
-	kgsl_sync_timeline_signal(ev->context->timeline, ev->timestamp);
-	kgsl_context_put(ev->context);
-	kfree(ev);
-}
+	struct kgsl_sync_timeline *ktimeline;
 
-static int _add_fence_event(struct kgsl_device *device,
-	struct kgsl_context *context, unsigned int timestamp)
-{
-	struct kgsl_fence_event_priv *event;
-	int ret;
+	if (context == NULL || context->timeline == NULL)
+		return;
 
-	event = kmalloc(sizeof(*event), GFP_KERNEL);
-	if (event == NULL)
-		return -ENOMEM;
+	ktimeline = (struct kgsl_sync_timeline *) context->timeline;
 
-	/*
-	 * Increase the refcount for the context to keep it through the
-	 * callback
-	 */
-	if (!_kgsl_context_get(context)) {
-		kfree(event);
-		return -ENOENT;
-	}
+	spin_lock(&ktimeline->lock);
 
-	event->context = context;
-	event->timestamp = timestamp;
-	event->context = context;
+	if (!ktimeline->pending) {
+		spin_unlock(&ktimeline->lock);
+		return;
+	}
 
-	ret = kgsl_add_event(device, &context->events, timestamp,
-		kgsl_fence_event_cb, event);
+	if (flush && timestamp_cmp(ktimeline->pending_timestamp,
+			timestamp) > 0)
+		timestamp = ktimeline->pending_timestamp;
 
-	if (ret) {
-		kgsl_context_put(context);
-		kfree(event);
+	if (timestamp_cmp(timestamp, ktimeline->last_timestamp) <= 0) {
+		spin_unlock(&ktimeline->lock);
+		return;
 	}
 
-	return ret;
+	ktimeline->last_timestamp = timestamp;
+
+	if (timestamp_cmp(timestamp, ktimeline->pending_timestamp) >= 0)
+		ktimeline->pending = false;
+
+	spin_unlock(&ktimeline->lock);
+
+	sync_timeline_signal(context->timeline);
 }
 
 /**
@@ -173,6 +176,15 @@ int kgsl_add_fence_event(struct kgsl_device *device,
 	if (test_bit(KGSL_CONTEXT_PRIV_INVALID, &context->priv))
 		goto out;
 
+	/* See kgsl_add_event() */
+	if (!(context->flags & KGSL_CONTEXT_USER_GENERATED_TS)) {
+		kgsl_readtimestamp(device, context, KGSL_TIMESTAMP_QUEUED,
+			&cur);
+
+		if (timestamp_cmp(timestamp, cur) > 0)
+			goto out;
+	}
+
 	pt = kgsl_sync_pt_create(context->timeline, context, timestamp);
 	if (pt == NULL) {
 		KGSL_DRV_CRIT_RATELIMIT(device, "kgsl_sync_pt_create failed\n");
@@ -204,22 +216,24 @@ int kgsl_add_fence_event(struct kgsl_device *device,
 	}
 
 	/*
-	 * If the timestamp hasn't expired yet create an event to trigger it.
-	 * Otherwise, just signal the fence - there is no reason to go through
-	 * the effort of creating a fence we don't need.
+	 * If the timestamp hasn't expired yet mark the timeline as pending so
+	 * the retire path signals it. Check the timestamp again afterwards in
+	 * case it retired before the retire path could see the pending mark.
 	 */
 
 	kgsl_readtimestamp(device, context, KGSL_TIMESTAMP_RETIRED, &cur);
 
-	if (timestamp_cmp(cur, timestamp) >= 0) {
-		ret = 0;
-		kgsl_sync_timeline_signal(context->timeline, cur);
-	} else {
-		ret = _add_fence_event(device, context, timestamp);
-		if (ret)
-			goto out;
+	if (timestamp_cmp(cur, timestamp) < 0) {
+		_add_fence_pending((struct kgsl_sync_timeline *)
+			context->timeline, timestamp);
+		kgsl_readtimestamp(device, context, KGSL_TIMESTAMP_RETIRED,
+			&cur);
 	}
 
+	ret = 0;
+	if (timestamp_cmp(cur, timestamp) >= 0)
+		kgsl_sync_timeline_retire(context, cur, false);
+
 	if (copy_to_user(data, &priv, sizeof(priv))) {
 		ret = -EFAULT;
 		goto out;
@@ -348,6 +362,8 @@ int kgsl_sync_timeline_create(struct kgsl_context *context)
 
 	ktimeline = (struct kgsl_sync_timeline *) context->timeline;
 	ktimeline->last_timestamp = 0;
+	ktimeline->pending_timestamp = 0;
+	ktimeline->pending = false;
 	ktimeline->device = context->device;
 	ktimeline->context_id = context->id;
 
@@ -355,20 +371,6 @@ int kgsl_sync_timeline_create(struct kgsl_context *context)
 	return 0;
 }
 
-static void kgsl_sync_timeline_signal(struct sync_timeline *timeline,
-	unsigned int timestamp)
-{
-	struct kgsl_sync_timeline *ktimeline =
-		(struct kgsl_sync_timeline *) timeline;
-
-	spin_lock(&ktimeline->lock);
-	if (timestamp_cmp(timestamp, ktimeline->last_timestamp) > 0)
-		ktimeline->last_timestamp = timestamp;
-	spin_unlock(&ktimeline->lock);
-
-	sync_timeline_signal(timeline);
-}
-
 void kgsl_sync_timeline_destroy(struct kgsl_context *context)
 {
 	sync_timeline_destroy(context->timeline);
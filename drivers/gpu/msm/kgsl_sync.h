@@ -16,9 +16,21 @@
 #include <linux/sync.h>
 #include "kgsl_device.h"
 
+/**
+ * struct kgsl_sync_timeline - A sync timeline for a KGSL context
+ * @timeline: The sync timeline
+ * @last_timestamp: Latest timestamp the timeline was signalled for
+ * @pending_timestamp: Latest timestamp that an exported fence waits for
+ * @pending: True if some fences on the timeline haven't been signalled yet
+ * @device: The KGSL device that owns the context
+ * @context_id: ID of the context
+ * @lock: Protects the timestamps
+ */
 struct kgsl_sync_timeline {
 	struct sync_timeline timeline;
 	unsigned int last_timestamp;
+	unsigned int pending_timestamp;
+	bool pending;
 	struct kgsl_device *device;
 	u32 context_id;
 	spinlock_t lock;
@@ -46,6 +58,8 @@ int kgsl_add_fence_event(struct kgsl_device *device,
 	struct kgsl_device_private *owner);
 int kgsl_sync_timeline_create(struct kgsl_context *context);
 void kgsl_sync_timeline_destroy(struct kgsl_context *context);
+void kgsl_sync_timeline_retire(struct kgsl_context *context,
+	unsigned int timestamp, bool flush);
 struct kgsl_sync_fence_waiter *kgsl_sync_fence_async_wait(int fd,
 	void (*func)(void *priv), void *priv);
 int kgsl_sync_fence_async_cancel(struct kgsl_sync_fence_waiter *waiter);
@@ -70,6 +84,11 @@ static inline void kgsl_sync_timeline_destroy(struct kgsl_context *context)
 {
 }
 
+static inline void kgsl_sync_timeline_retire(struct kgsl_context *context,
+	unsigned int timestamp, bool flush)
+{
+}
+
 static inline struct
 kgsl_sync_fence_waiter *kgsl_sync_fence_async_wait(int fd,
 	void (*func)(void *priv), void *priv)
@@ -27,6 +27,7 @@
 #include <linux/device.h>
 #include <linux/cdev.h>
 #include <linux/wakelock.h>
+#include <linux/eventfd.h>
 #include "input-compat.h"
 
 struct evdev {
@@ -55,10 +56,47 @@ struct evdev_client {
 	struct list_head node;
 	int clkid;
 	bool revoked;
+	struct input_ring_header *ring; /* mmap'd ring, replaces buffer */
+	struct input_ring_event *ring_events;
+	struct eventfd_ctx *ring_fd;
 	unsigned int bufsize;
 	struct input_event buffer[];
 };
 
+static size_t evdev_ring_size(struct evdev_client *client)
+{
+	return PAGE_ALIGN(sizeof(struct input_ring_header) +
+			  client->bufsize * sizeof(struct input_ring_event));
+}
+
+/*
+ * Write an event to the mmap'd ring, caller must hold client->buffer_lock.
+ * client->head is the kernel's copy of the sequence number, the one in the
+ * shared header is only informational for the reader.
+ */
+static void __evdev_ring_event(struct evdev_client *client, u16 type,
+			       u16 code, s32 value, ktime_t time)
+{
+	struct input_ring_header *hdr = client->ring;
+	unsigned int seq = client->head++;
+	struct input_ring_event *ev =
+		&client->ring_events[seq & (client->bufsize - 1)];
+
+	hdr->head = client->head;
+	smp_wmb();
+
+	ev->seq = seq;
+	ev->type = type;
+	ev->code = code;
+	ev->value = value;
+	ev->time_ns = ktime_to_ns(time);
+
+	if (type == EV_SYN && (code == SYN_REPORT || code == SYN_DROPPED)) {
+		smp_wmb();
+		hdr->published = client->head;
+	}
+}
+
 /* flush queued events of type @type, caller must hold client->buffer_lock */
 static void __evdev_flush_queue(struct evdev_client *client, unsigned int type)
 {
@@ -122,6 +160,12 @@ static void evdev_queue_syn_dropped(struct evdev_client *client)
 
 	spin_lock_irqsave(&client->buffer_lock, flags);
 
+	if (client->ring) {
+		__evdev_ring_event(client, EV_SYN, SYN_DROPPED, 0, time);
+		spin_unlock_irqrestore(&client->buffer_lock, flags);
+		return;
+	}
+
 	client->buffer[client->head++] = ev;
 	client->head &= client->bufsize - 1;
 
@@ -173,16 +217,30 @@ static void evdev_pass_values(struct evdev_client *client,
 	const struct input_value *v;
 	struct input_event event;
 	bool wakeup = false;
+	ktime_t time;
 
 	if (client->revoked)
 		return;
 
-	event.time = ktime_to_timeval(client->clkid == CLOCK_MONOTONIC ?
-				      mono : real);
+	time = client->clkid == CLOCK_MONOTONIC ? mono : real;
+	event.time = ktime_to_timeval(time);
 
 	/* Interrupts are disabled, just acquire the lock. */
 	spin_lock(&client->buffer_lock);
 
+	if (client->ring) {
+		for (v = vals; v != vals + count; v++) {
+			__evdev_ring_event(client, v->type, v->code,
+					   v->value, time);
+			if (v->type == EV_SYN && v->code == SYN_REPORT)
+				wakeup = true;
+		}
+		if (wakeup && client->ring_fd)
+			eventfd_signal(client->ring_fd, 1);
+		spin_unlock(&client->buffer_lock);
+		goto out;
+	}
+
 	for (v = vals; v != vals + count; v++) {
 		event.type = v->type;
 		event.code = v->code;
@@ -194,6 +252,7 @@ static void evdev_pass_values(struct evdev_client *client,
 
 	spin_unlock(&client->buffer_lock);
 
+ out:
 	if (wakeup)
 		wake_up_interruptible(&evdev->wait);
 }
@@ -377,6 +436,10 @@ static int evdev_release(struct inode *inode, struct file *file)
 	if (client->use_wake_lock)
 		wake_lock_destroy(&client->wake_lock);
 
+	if (client->ring_fd)
+		eventfd_ctx_put(client->ring_fd);
+	vfree(client->ring);
+
 	if (is_vmalloc_addr(client))
 		vfree(client);
 	else
@@ -503,6 +566,10 @@ static ssize_t evdev_read(struct file *file, char __user *buffer,
 	if (count != 0 && count < input_event_size())
 		return -EINVAL;
 
+	/* events of ring clients are only available through the mapping */
+	if (client->ring)
+		return -EINVAL;
+
 	for (;;) {
 		if (!evdev->exist || client->revoked)
 			return -ENODEV;
@@ -556,12 +623,92 @@ static unsigned int evdev_poll(struct file *file, poll_table *wait)
 	else
 		mask = POLLHUP | POLLERR;
 
-	if (client->packet_head != client->tail)
+	if (client->ring) {
+		if (ACCESS_ONCE(client->ring->tail) !=
+		    ACCESS_ONCE(client->ring->published))
+			mask |= POLLIN | POLLRDNORM;
+	} else if (client->packet_head != client->tail) {
 		mask |= POLLIN | POLLRDNORM;
+	}
 
 	return mask;
 }
 
+static int evdev_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct evdev_client *client = file->private_data;
+	struct evdev *evdev = client->evdev;
+	size_t size = evdev_ring_size(client);
+	struct input_ring_header *ring;
+	int error;
+
+	if (vma->vm_pgoff || vma->vm_end - vma->vm_start != size)
+		return -EINVAL;
+
+	error = mutex_lock_interruptible(&evdev->mutex);
+	if (error)
+		return error;
+
+	if (!evdev->exist || client->revoked) {
+		error = -ENODEV;
+		goto out;
+	}
+
+	if (client->ring) {
+		error = -EBUSY;
+		goto out;
+	}
+
+	ring = vmalloc_user(size);
+	if (!ring) {
+		error = -ENOMEM;
+		goto out;
+	}
+
+	ring->version = INPUT_RING_VERSION;
+	ring->nr_events = client->bufsize;
+
+	error = remap_vmalloc_range(vma, ring, 0);
+	if (error) {
+		vfree(ring);
+		goto out;
+	}
+
+	/* events still queued for read() are dropped */
+	spin_lock_irq(&client->buffer_lock);
+	if (client->use_wake_lock && client->packet_head != client->tail)
+		wake_unlock(&client->wake_lock);
+	client->head = client->tail = client->packet_head = 0;
+	client->ring_events = (struct input_ring_event *)(ring + 1);
+	client->ring = ring;
+	spin_unlock_irq(&client->buffer_lock);
+
+ out:
+	mutex_unlock(&evdev->mutex);
+	return error;
+}
+
+static int evdev_set_ring_fd(struct evdev_client *client, int fd)
+{
+	struct eventfd_ctx *ctx = NULL, *old;
+
+	if (fd >= 0) {
+		ctx = eventfd_ctx_fdget(fd);
+		if (IS_ERR(ctx))
+			return PTR_ERR(ctx);
+	}
+
+	spin_lock_irq(&client->buffer_lock);
+	old = client->ring_fd;
+	client->ring_fd = ctx;
+	spin_unlock_irq(&client->buffer_lock);
+
+	if (old)
+		eventfd_ctx_put(old);
+
+	return 0;
+}
+
 #ifdef CONFIG_COMPAT
 
 #define BITS_PER_LONG_COMPAT (sizeof(compat_long_t) * 8)
@@ -933,6 +1080,14 @@ static long evdev_do_ioctl(struct file *file, unsigned int cmd,
 		client->clkid = i;
 		return 0;
 
+	case EVIOCGRINGSIZE:
+		return put_user(evdev_ring_size(client), ip);
+
+	case EVIOCSRINGFD:
+		if (get_user(i, ip))
+			return -EFAULT;
+		return evdev_set_ring_fd(client, (int)i);
+
 	case EVIOCGKEYCODE:
 		return evdev_handle_get_keycode(dev, p);
 
@@ -1111,6 +1266,7 @@ static const struct file_operations evdev_fops = {
 	.read		= evdev_read,
 	.write		= evdev_write,
 	.poll		= evdev_poll,
+	.mmap		= evdev_mmap,
 	.open		= evdev_open,
 	.release	= evdev_release,
 	.unlocked_ioctl	= evdev_ioctl,
@@ -27,6 +27,8 @@
 #include <linux/device.h>
 #include <linux/mutex.h>
 #include <linux/rcupdate.h>
+#include <linux/notifier.h>
+#include <linux/interrupt.h>
 #include "input-compat.h"
 
 MODULE_AUTHOR("Vojtech Pavlik <vojtech@suse.cz>");
@@ -468,6 +470,62 @@ void input_inject_event(struct input_handle *handle,
 }
 EXPORT_SYMBOL(input_inject_event);
 
+static ATOMIC_NOTIFIER_HEAD(input_interaction_chain);
+
+/**
+ * input_register_interaction_notifier() - subscribe to interaction hints
+ * @nb: notifier block to register
+ *
+ * The callback receives a pointer to the ktime_t at which the hint was
+ * raised. It runs in hard interrupt context and must not sleep.
+ */
+int input_register_interaction_notifier(struct notifier_block *nb)
+{
+	return atomic_notifier_chain_register(&input_interaction_chain, nb);
+}
+EXPORT_SYMBOL(input_register_interaction_notifier);
+
+/**
+ * input_unregister_interaction_notifier() - remove an interaction notifier
+ * @nb: notifier block registered with input_register_interaction_notifier()
+ */
+int input_unregister_interaction_notifier(struct notifier_block *nb)
+{
+	return atomic_notifier_chain_unregister(&input_interaction_chain, nb);
+}
+EXPORT_SYMBOL(input_unregister_interaction_notifier);
+
+/**
+ * input_interaction_imminent() - hint that input events are on their way
+ *
+ * Called by drivers, typically touchscreens, as soon as the device raises
+ * its interrupt and before the (slow) bus transfer that produces the
+ * actual events, so that performance governors can start ramping up
+ * while the data is being read. Safe to call from hard interrupt context.
+ */
+void input_interaction_imminent(void)
+{
+	ktime_t now = ktime_get();
+
+	atomic_notifier_call_chain(&input_interaction_chain, 0, &now);
+}
+EXPORT_SYMBOL(input_interaction_imminent);
+
+/**
+ * input_interaction_hardirq() - primary handler raising an interaction hint
+ * @irq: interrupt number
+ * @dev_id: unused
+ *
+ * Drivers using a threaded interrupt may pass this instead of NULL as the
+ * primary handler of request_threaded_irq().
+ */
+irqreturn_t input_interaction_hardirq(int irq, void *dev_id)
+{
+	input_interaction_imminent();
+	return IRQ_WAKE_THREAD;
+}
+EXPORT_SYMBOL(input_interaction_hardirq);
+
 /**
  * input_alloc_absinfo - allocates array of input_absinfo structs
  * @dev: the input device emitting absolute events
@@ -251,6 +251,10 @@ struct t9_range {
 
 #define MXT_PIXELS_PER_MM	20
 
+/* Report batching */
+#define MXT_MAX_BATCH_US	20000
+#define MXT_BATCH_SLACK_US	200
+
 struct mxt_obj_patch {
 	u8 number;
 	u8 instance;
@@ -327,6 +331,13 @@ struct mxt_data {
 	u8 t6_status;
 	bool update_input;
 	u8 last_message_count;
+
+	/* Report batching, see mxt_process_messages_t44() */
+	unsigned int batch_us;
+	ktime_t irq_time;
+	ktime_t frame_time;
+	s64 frame_step_ns;
+	unsigned long frame_slots;
 	u8 num_touchids;
 	u8 num_stylusids;
 	unsigned long t15_keystatus;
@@ -1336,6 +1347,19 @@ static void mxt_input_sync(struct input_dev *input_dev)
 	input_sync(input_dev);
 }
 
+/* Close the current touch frame and move on to the next sample time */
+static void mxt_frame_sync(struct mxt_data *data)
+{
+	struct input_dev *input_dev = data->input_dev;
+
+	input_event(input_dev, EV_MSC, MSC_TIMESTAMP,
+		    (u32)ktime_to_us(data->frame_time));
+	mxt_input_sync(input_dev);
+	data->update_input = false;
+	data->frame_slots = 0;
+	data->frame_time = ktime_add_ns(data->frame_time, data->frame_step_ns);
+}
+
 static void mxt_proc_t9_message(struct mxt_data *data, u8 *message)
 {
 	struct device *dev = &data->client->dev;
@@ -1430,7 +1454,7 @@ static void mxt_proc_t100_message(struct mxt_data *data, u8 *message)
 	unsigned char number_of_fingers_actually_touching;
 	static char finger_register[32];
 #endif
-	struct timespec hw_time = ktime_to_timespec(ktime_get());
+	struct timespec hw_time;
 
 	/* do not report events if input device not yet registered */
 	if (!data->enable_reporting)
@@ -1442,6 +1466,14 @@ static void mxt_proc_t100_message(struct mxt_data *data, u8 *message)
 	if (id < 0)
 		return;
 
+	/* a slot seen twice means the FIFO held more than one scan */
+	if (id < BITS_PER_LONG) {
+		if (test_bit(id, &data->frame_slots))
+			mxt_frame_sync(data);
+		__set_bit(id, &data->frame_slots);
+	}
+
+	hw_time = ktime_to_timespec(data->frame_time);
 	input_event(input_dev, EV_SYN, SYN_TIME_SEC, hw_time.tv_sec);
 	input_event(input_dev, EV_SYN, SYN_TIME_NSEC, hw_time.tv_nsec);
 
@@ -1745,20 +1777,69 @@ static int mxt_read_and_process_messages(struct mxt_data *data, u8 count)
 	return num_valid;
 }
 
+/*
+ * Count the touch frames held in a burst of T100 messages: a new frame
+ * starts whenever a slot already reported in the current one shows up
+ * again. Mirrors the splitting done in mxt_proc_t100_message().
+ */
+static unsigned int mxt_count_frames(struct mxt_data *data, u8 *msg,
+				     u8 count)
+{
+	unsigned long slots = 0;
+	unsigned int frames = 1;
+	int i, id;
+
+	for (i = 0; i < count; i++, msg += data->T5_msg_size) {
+		if (msg[0] < data->T100_reportid_min + 2 ||
+		    msg[0] > data->T100_reportid_max)
+			continue;
+
+		id = msg[0] - data->T100_reportid_min - 2;
+		if (id >= BITS_PER_LONG)
+			continue;
+
+		if (test_bit(id, &slots)) {
+			frames++;
+			slots = 0;
+		}
+		__set_bit(id, &slots);
+	}
+
+	return frames;
+}
+
+/*
+ * Read T44 and the whole T5 FIFO in one burst, sized from the previous
+ * message count, and only go back for the rest if more messages arrived.
+ *
+ * With batch_us set the thread first waits for the controller to queue
+ * more scans, so several reports are handled per wakeup. Each scan is then
+ * emitted as its own frame; the sample times are spread evenly between the
+ * hard IRQ, when the first scan was ready, and the start of the read.
+ */
 static irqreturn_t mxt_process_messages_t44(struct mxt_data *data)
 {
 	struct device *dev = &data->client->dev;
-	int ret;
-	u8 count, num_left;
+	u8 size = data->T5_msg_size;
+	unsigned int frames;
+	ktime_t read_time;
+	int ret, i;
+	u8 count, num_read, num_valid = 0;
 
 	if (!data->msg_buf) {
 		dev_err(dev, "Message buffer not allocated!!!\n");
 		return IRQ_NONE;
 	}
 
+	if (data->batch_us && !atomic_read(&data->suspended))
+		usleep_range(data->batch_us, data->batch_us + MXT_BATCH_SLACK_US);
+	read_time = ktime_get();
+
+	num_read = clamp_t(u8, data->last_message_count, 1, data->max_reportid);
+
 	/* Read T44 and T5 together */
 	ret = __mxt_read_reg(data->client, data->T44_address,
-		data->T5_msg_size + 1, data->msg_buf);
+		size * num_read + 1, data->msg_buf);
 	if (ret) {
 		dev_err(dev, "Failed to read T44 and T5 (%d)\n", ret);
 		return IRQ_NONE;
@@ -1774,30 +1855,37 @@ static irqreturn_t mxt_process_messages_t44(struct mxt_data *data)
 		count = data->max_reportid;
 	}
 
-	/* Process first message */
-	ret = mxt_proc_message(data, data->msg_buf + 1);
-	if (ret < 0) {
-		dev_warn(dev, "Unexpected invalid message\n");
-		return IRQ_NONE;
+	/* Read remaining messages if necessary */
+	if (count > num_read) {
+		ret = __mxt_read_reg(data->client, data->T5_address,
+				size * (count - num_read),
+				data->msg_buf + 1 + size * num_read);
+		if (ret) {
+			dev_err(dev, "Failed to read %u messages (%d)\n",
+				count - num_read, ret);
+			count = num_read;
+		}
 	}
+	data->last_message_count = count;
 
-	num_left = count - 1;
-
-	/* Process remaining messages if necessary */
-	if (num_left) {
-		ret = mxt_read_and_process_messages(data, num_left);
-		if (ret < 0)
-			goto end;
-		else if (ret != num_left)
-			dev_warn(dev, "Unexpected invalid message\n");
+	if (data->batch_us && count > 1) {
+		frames = mxt_count_frames(data, data->msg_buf + 1, count);
+		data->frame_step_ns = div_s64(ktime_to_ns(ktime_sub(read_time,
+						data->irq_time)), frames);
 	}
 
-end:
-	if (data->update_input) {
-		mxt_input_sync(data->input_dev);
-		data->update_input = false;
+	for (i = 0; i < count; i++) {
+		ret = mxt_proc_message(data, data->msg_buf + 1 + size * i);
+		if (ret == 1)
+			num_valid++;
 	}
 
+	if (num_valid != count)
+		dev_warn(dev, "Unexpected invalid message\n");
+
+	if (data->update_input)
+		mxt_frame_sync(data);
+
 	return IRQ_HANDLED;
 }
 
@@ -1856,14 +1944,22 @@ static irqreturn_t mxt_process_messages(struct mxt_data *data)
 update_count:
 	data->last_message_count = total_handled;
 
-	if (data->enable_reporting && data->update_input) {
-		mxt_input_sync(data->input_dev);
-		data->update_input = false;
-	}
+	if (data->enable_reporting && data->update_input)
+		mxt_frame_sync(data);
 
 	return IRQ_HANDLED;
 }
 
+static irqreturn_t mxt_hard_interrupt(int irq, void *dev_id)
+{
+	struct mxt_data *data = dev_id;
+
+	data->irq_time = ktime_get();
+	input_interaction_imminent();
+
+	return IRQ_WAKE_THREAD;
+}
+
 static irqreturn_t mxt_interrupt(int irq, void *dev_id)
 {
 	struct mxt_data *data = dev_id;
@@ -1880,6 +1976,10 @@ static irqreturn_t mxt_interrupt(int irq, void *dev_id)
 	if (!data->object_table)
 		return IRQ_NONE;
 
+	data->frame_time = data->irq_time;
+	data->frame_step_ns = 0;
+	data->frame_slots = 0;
+
 	if (data->T44_address)
 		return mxt_process_messages_t44(data);
 	else
@@ -2734,8 +2834,9 @@ static int mxt_parse_object_table(struct mxt_data *data)
 		return -EINVAL;
 	}
 
-	data->msg_buf = kcalloc(data->max_reportid,
-				data->T5_msg_size, GFP_KERNEL);
+	/* room for the T44 count in front of a full FIFO */
+	data->msg_buf = kzalloc(data->max_reportid * data->T5_msg_size + 1,
+				GFP_KERNEL);
 	if (!data->msg_buf) {
 		dev_err(&client->dev, "Failed to allocate message buffer\n");
 		return -ENOMEM;
@@ -3214,6 +3315,7 @@ static int mxt_initialize_t100_input_device(struct mxt_data *data)
 	}
 
 	input_set_capability(input_dev, EV_KEY, KEY_POWER);
+	input_set_capability(input_dev, EV_MSC, MSC_TIMESTAMP);
 
 	return 0;
 }
@@ -3228,8 +3330,9 @@ static void mxt_request_irq(struct mxt_data *data, unsigned long flags)
 	int error;
 
 	dev_dbg(&data->client->dev, "requesting IRQ, flags: %lu\n", flags);
-	error = request_threaded_irq(data->irq, NULL, mxt_interrupt,
-				     flags, data->client->name, data);
+	error = request_threaded_irq(data->irq, mxt_hard_interrupt,
+				     mxt_interrupt, flags, data->client->name,
+				     data);
 	/* no need to stay alive, touch is not functional */
 	BUG_ON(error);
 	data->irq_enabled = true;
@@ -3852,6 +3955,29 @@ static ssize_t mxt_debug_enable_store(struct device *dev,
 	}
 }
 
+static ssize_t mxt_batch_us_show(struct device *dev,
+	struct device_attribute *attr, char *buf)
+{
+	struct mxt_data *data = dev_get_drvdata(dev);
+
+	return scnprintf(buf, PAGE_SIZE, "%u\n", data->batch_us);
+}
+
+static ssize_t mxt_batch_us_store(struct device *dev,
+	struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct mxt_data *data = dev_get_drvdata(dev);
+	unsigned int i;
+
+	if (sscanf(buf, "%u", &i) == 1 && i <= MXT_MAX_BATCH_US) {
+		data->batch_us = i;
+		return count;
+	} else {
+		dev_dbg(dev, "batch_us write error\n");
+		return -EINVAL;
+	}
+}
+
 static int mxt_check_mem_access_params(struct mxt_data *data, loff_t off,
 				       size_t *count)
 {
@@ -4422,6 +4548,8 @@ static DEVICE_ATTR(debug_notify, S_IRUGO, mxt_debug_notify_show, NULL);
 static DEVICE_ATTR(debug_enable, S_IWUSR | S_IRUSR, mxt_debug_enable_show,
 				mxt_debug_enable_store);
 static DEVICE_ATTR(tsi, S_IRUGO, mxt_ud_show, NULL);
+static DEVICE_ATTR(batch_us, S_IWUSR | S_IWGRP | S_IRUGO,
+			mxt_batch_us_show, mxt_batch_us_store);
 static DEVICE_ATTR(tsp, S_IWUSR | S_IWGRP | S_IRUGO,
 				mxt_tsp_show, mxt_tsp_store);
 
@@ -4446,6 +4574,7 @@ static struct attribute *mxt_attrs[] = {
 	&dev_attr_debug_notify.attr,
 	&dev_attr_tsi.attr,
 	&dev_attr_tsp.attr,
+	&dev_attr_batch_us.attr,
 	NULL
 };
 
@@ -5077,6 +5206,7 @@ static int mxt_probe(struct i2c_client *client,
 			error);
 #endif
 	mxt_sysfs_touchscreen(data, true);
+	device_enable_async_suspend(&client->dev);
 	return 0;
 
 err_remove_sysfs_group:
@@ -3481,7 +3481,7 @@ static int ft_ts_probe(struct i2c_client *client,
 
 	dev_dbg(&client->dev, "touch threshold = %d\n", reg_value * 4);
 
-	err = request_threaded_irq(client->irq, NULL,
+	err = request_threaded_irq(client->irq, input_interaction_hardirq,
 				ft_ts_interrupt,
 	/*
 	 * the interrupt trigger mode will be set in Device Tree with property
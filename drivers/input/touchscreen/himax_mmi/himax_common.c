@@ -1943,6 +1943,7 @@ int himax_chip_common_probe(struct i2c_client *client, const struct i2c_device_i
 	}
 #endif
 	himax_sw_reset();
+	device_enable_async_suspend(&client->dev);
 return 0;
 
 err_register_interrupt_failed:
@@ -527,12 +527,12 @@ int himax_int_register_trigger(struct i2c_client *client)
 	if(ic_data->HX_INT_IS_EDGE)
 	{
 		I("%s edge triiger falling\n ",__func__);
-		ret = request_threaded_irq(client->irq, NULL, himax_ts_thread,IRQF_TRIGGER_FALLING | IRQF_ONESHOT, client->name, ts);
+		ret = request_threaded_irq(client->irq, input_interaction_hardirq, himax_ts_thread,IRQF_TRIGGER_FALLING | IRQF_ONESHOT, client->name, ts);
 	}
 	else
 	{
 		I("%s level trigger low\n ",__func__);
-		ret = request_threaded_irq(client->irq, NULL, himax_ts_thread,IRQF_TRIGGER_LOW | IRQF_ONESHOT, client->name, ts);
+		ret = request_threaded_irq(client->irq, input_interaction_hardirq, himax_ts_thread,IRQF_TRIGGER_LOW | IRQF_ONESHOT, client->name, ts);
 	}
 	return ret;
 }
@@ -1796,7 +1796,8 @@ static int synaptics_rmi4_irq_enable(struct synaptics_rmi4_data *rmi4_data,
 		/* Process and clear interrupts */
 		synaptics_rmi4_sensor_report(rmi4_data, false);
 
-		retval = request_threaded_irq(rmi4_data->irq, NULL,
+		retval = request_threaded_irq(rmi4_data->irq,
+				input_interaction_hardirq,
 				synaptics_rmi4_irq, bdata->irq_flags,
 				PLATFORM_DRIVER_NAME, rmi4_data);
 		if (retval < 0) {
@@ -4124,6 +4125,8 @@ static int synaptics_rmi4_probe(struct platform_device *pdev)
 	synaptics_secure_touch_init(rmi4_data);
 	synaptics_secure_touch_stop(rmi4_data, true);
 
+	device_enable_async_suspend(&pdev->dev);
+
 	return retval;
 
 #ifdef FB_READY_RESET
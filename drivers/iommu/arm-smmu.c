@@ -1285,6 +1285,13 @@ static irqreturn_t arm_smmu_context_fault(int irq, void *dev)
 			"soft iova-to-phys=%pa\n", &phys_soft);
 		ret = IRQ_HANDLED;
 		resume = RESUME_TERMINATE;
+	} else if (tmp == -EAGAIN) {
+		/* The client fixed up the mapping, replay the transaction */
+		dev_dbg(smmu->dev,
+			"Context fault resolved by client: iova=0x%08lx, fsr=0x%x, cb=%d\n",
+			iova, fsr, cfg->cbndx);
+		ret = IRQ_HANDLED;
+		resume = RESUME_RETRY;
 	} else {
 		phys_addr_t phys_atos = arm_smmu_verify_fault(domain, iova,
 							      fsr);
@@ -84,6 +84,7 @@
 #define ARM_LPAE_PTE_TYPE_PAGE		3
 
 #define ARM_LPAE_PTE_NSTABLE		(((arm_lpae_iopte)1) << 63)
+#define ARM_LPAE_PTE_CONT		(((arm_lpae_iopte)1) << 52)
 #define ARM_LPAE_PTE_XN			(((arm_lpae_iopte)3) << 53)
 #define ARM_LPAE_PTE_AF			(((arm_lpae_iopte)1) << 10)
 #define ARM_LPAE_PTE_SH_NS		(((arm_lpae_iopte)0) << 8)
@@ -322,6 +323,40 @@ struct map_state {
 /* map state optimization works at level 3 (the 2nd-to-last level) */
 #define MAP_STATE_LVL 3
 
+/*
+ * With a 4K granule, 16 naturally aligned page entries that map a
+ * physically contiguous 64K region can share a single TLB entry when they
+ * all carry the contiguous hint.
+ */
+#define ARM_LPAE_CONT_PTES	16
+#define ARM_LPAE_CONT_SIZE	(ARM_LPAE_CONT_PTES * SZ_4K)
+
+static inline bool arm_lpae_cont_supported(struct arm_lpae_io_pgtable *data)
+{
+	return data->pg_shift == 12;
+}
+
+/*
+ * Drop the contiguous hint from the group of last-level entries that holds
+ * index @idx of @table. This must be done before any entry of a group is
+ * unmapped, since the hint is only valid while all 16 entries agree.
+ */
+static void arm_lpae_clear_cont(struct arm_lpae_io_pgtable *data,
+				arm_lpae_iopte *table, int idx)
+{
+	arm_lpae_iopte *ptep = table + round_down(idx, ARM_LPAE_CONT_PTES);
+	int i;
+
+	if (!arm_lpae_cont_supported(data) || !(*ptep & ARM_LPAE_PTE_CONT))
+		return;
+
+	for (i = 0; i < ARM_LPAE_CONT_PTES; i++)
+		ptep[i] &= ~ARM_LPAE_PTE_CONT;
+
+	data->iop.cfg.tlb->flush_pgtable(ptep,
+		ARM_LPAE_CONT_PTES * sizeof(*ptep), data->iop.cookie);
+}
+
 static int __arm_lpae_map(struct arm_lpae_io_pgtable *data, unsigned long iova,
 			  phys_addr_t paddr, size_t size, arm_lpae_iopte prot,
 			  int lvl, arm_lpae_iopte *ptep,
@@ -476,6 +511,8 @@ static int arm_lpae_map_sg(struct io_pgtable_ops *ops, unsigned long iova,
 	int i, ret;
 	unsigned int min_pagesz;
 	struct map_state ms;
+	unsigned long cont_end = 0;
+	bool cont = arm_lpae_cont_supported(data);
 
 	/* If no access, then nothing to do */
 	if (!(iommu_prot & (IOMMU_READ | IOMMU_WRITE)))
@@ -503,18 +540,35 @@ static int arm_lpae_map_sg(struct io_pgtable_ops *ops, unsigned long iova,
 		while (size) {
 			size_t pgsize = iommu_pgsize(
 				data->iop.cfg.pgsize_bitmap, iova | phys, size);
+			arm_lpae_iopte pte_prot = prot;
+
+			/*
+			 * Set the contiguous hint on page entries that are
+			 * part of an aligned, physically contiguous 64K run.
+			 * The run never crosses a scatterlist entry.
+			 */
+			if (cont && pgsize == SZ_4K) {
+				if (iova >= cont_end &&
+				    size >= ARM_LPAE_CONT_SIZE &&
+				    IS_ALIGNED(iova | phys, ARM_LPAE_CONT_SIZE))
+					cont_end = iova + ARM_LPAE_CONT_SIZE;
+
+				if (iova < cont_end)
+					pte_prot |= ARM_LPAE_PTE_CONT;
+			}
 
 			if (ms.pgtable && (iova < ms.iova_end)) {
 				arm_lpae_iopte *ptep = ms.pgtable +
 					ARM_LPAE_LVL_IDX(iova, MAP_STATE_LVL,
 							 data);
 				arm_lpae_init_pte(
-					data, iova, phys, prot, MAP_STATE_LVL,
-					ptep, ms.prev_pgtable, false);
+					data, iova, phys, pte_prot,
+					MAP_STATE_LVL, ptep, ms.prev_pgtable,
+					false);
 				ms.num_pte++;
 			} else {
 				ret = __arm_lpae_map(data, iova, phys, pgsize,
-						prot, lvl, ptep, NULL, &ms);
+						pte_prot, lvl, ptep, NULL, &ms);
 				if (ret)
 					goto out_err;
 			}
@@ -639,6 +693,11 @@ static int __arm_lpae_unmap(struct arm_lpae_io_pgtable *data,
 
 	/* If the size matches this level, we're in the right place */
 	if (size == blk_size) {
+		if (lvl == ARM_LPAE_MAX_LEVELS - 1)
+			arm_lpae_clear_cont(data,
+				ptep - ARM_LPAE_LVL_IDX(iova, lvl, data),
+				ARM_LPAE_LVL_IDX(iova, lvl, data));
+
 		*ptep = 0;
 		tlb->flush_pgtable(ptep, sizeof(*ptep), cookie);
 
@@ -666,6 +725,15 @@ static int __arm_lpae_unmap(struct arm_lpae_io_pgtable *data,
 		 * swoop.
 		 */
 
+		/*
+		 * Contiguous groups that are only partially unmapped keep
+		 * their remaining entries, minus the contiguous hint.
+		 */
+		if (!IS_ALIGNED(tl_offset, ARM_LPAE_CONT_PTES))
+			arm_lpae_clear_cont(data, table, tl_offset);
+		if (!IS_ALIGNED(tl_offset + entries, ARM_LPAE_CONT_PTES))
+			arm_lpae_clear_cont(data, table, tl_offset + entries);
+
 		table += tl_offset;
 
 		memset(table, 0, table_len);
@@ -17,6 +17,9 @@
 #include <linux/rbtree.h>
 #include <linux/mutex.h>
 #include <linux/err.h>
+#include <linux/atomic.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include <linux/msm_dma_iommu_mapping.h>
 
@@ -53,8 +56,21 @@ struct msm_iommu_meta {
 	void *buffer;
 };
 
+/**
+ * struct msm_iommu_map_stats - lazy mapping cache counters
+ * @hits - map requests served from an existing mapping
+ * @misses - map requests that had to create a new iommu mapping
+ * @unmaps - mappings torn down, either on unmap or when the buffer is freed
+ */
+struct msm_iommu_map_stats {
+	atomic64_t hits;
+	atomic64_t misses;
+	atomic64_t unmaps;
+};
+
 static struct rb_root iommu_root;
 static DEFINE_MUTEX(msm_iommu_map_mutex);
+static struct msm_iommu_map_stats iommu_map_stats;
 
 static void msm_iommu_meta_add(struct msm_iommu_meta *meta)
 {
@@ -201,6 +217,7 @@ static inline int __msm_dma_map_sg(struct device *dev, struct scatterlist *sg,
 			kfree(iommu_map);
 			goto out_unlock;
 		}
+		atomic64_inc(&iommu_map_stats.misses);
 
 		kref_init(&iommu_map->ref);
 		if (late_unmap)
@@ -216,6 +233,7 @@ static inline int __msm_dma_map_sg(struct device *dev, struct scatterlist *sg,
 		sg->dma_length = iommu_map->sgl.dma_length;
 
 		kref_get(&iommu_map->ref);
+		atomic64_inc(&iommu_map_stats.hits);
 		/*
 		 * Need to do cache operations here based on "dir" in the
 		 * future if we go with coherent mappings.
@@ -299,6 +317,7 @@ static void msm_iommu_map_release(struct kref *kref)
 	list_del(&map->lnode);
 	dma_unmap_sg(map->dev, &map->sgl, map->nents, map->dir);
 	kfree(map);
+	atomic64_inc(&iommu_map_stats.unmaps);
 }
 
 void msm_dma_unmap_sg(struct device *dev, struct scatterlist *sgl, int nents,
@@ -383,3 +402,46 @@ out:
 
 }
 
+#ifdef CONFIG_DEBUG_FS
+static int msm_iommu_map_stats_show(struct seq_file *s, void *unused)
+{
+	u64 hits = atomic64_read(&iommu_map_stats.hits);
+	u64 misses = atomic64_read(&iommu_map_stats.misses);
+	u64 total = hits + misses;
+
+	seq_printf(s, "hits: %llu\n", hits);
+	seq_printf(s, "misses: %llu\n", misses);
+	seq_printf(s, "unmaps: %llu\n", atomic64_read(&iommu_map_stats.unmaps));
+	seq_printf(s, "hit rate: %llu%%\n",
+		   total ? div64_u64(hits * 100, total) : 0);
+	return 0;
+}
+
+static int msm_iommu_map_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, msm_iommu_map_stats_show, NULL);
+}
+
+static const struct file_operations msm_iommu_map_stats_fops = {
+	.open = msm_iommu_map_stats_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static int __init msm_dma_iommu_mapping_debugfs_init(void)
+{
+	struct dentry *dir;
+
+	dir = debugfs_create_dir("msm_dma_iommu_mapping", NULL);
+	if (IS_ERR_OR_NULL(dir))
+		return 0;
+
+	if (!debugfs_create_file("stats", S_IRUGO, dir, NULL,
+				 &msm_iommu_map_stats_fops))
+		debugfs_remove_recursive(dir);
+
+	return 0;
+}
+late_initcall(msm_dma_iommu_mapping_debugfs_init);
+#endif
@@ -11,7 +11,14 @@
  * default prefetch value. Data are read in "prefetch_cluster" chunks from the
  * hash device. Setting this greatly improves performance when data and hash
  * are on the same disk on different partitions on devices with poor random
- * access behavior.
+ * access behavior. The cluster only applies to sequential reads, and doubles
+ * with each further sequential read up to 1 << DM_VERITY_PREFETCH_MAX_SHIFT
+ * times its value. Random reads only prefetch the hash blocks they need.
+ *
+ * In the file "/sys/module/dm_verity/parameters/parallel_blocks" you can set
+ * the number of data blocks per chunk when verifying large bios. Bios of at
+ * least two chunks are split and the chunks verified concurrently on
+ * different CPUs. Zero verifies every bio in a single work item.
  */
 
 #include "dm-verity.h"
@@ -27,6 +34,9 @@
 #define DM_VERITY_ENV_VAR_NAME		"DM_VERITY_ERR_BLOCK_NR"
 
 #define DM_VERITY_DEFAULT_PREFETCH_SIZE	262144
+#define DM_VERITY_PREFETCH_MAX_SHIFT	3
+
+#define DM_VERITY_DEFAULT_PARALLEL_BLOCKS	16
 
 #define DM_VERITY_MAX_CORRUPTED_ERRS	100
 
@@ -41,11 +51,16 @@ static unsigned dm_verity_prefetch_cluster = DM_VERITY_DEFAULT_PREFETCH_SIZE;
 
 module_param_named(prefetch_cluster, dm_verity_prefetch_cluster, uint, S_IRUGO | S_IWUSR);
 
+static unsigned dm_verity_parallel_blocks = DM_VERITY_DEFAULT_PARALLEL_BLOCKS;
+
+module_param_named(parallel_blocks, dm_verity_parallel_blocks, uint, S_IRUGO | S_IWUSR);
+
 struct dm_verity_prefetch_work {
 	struct work_struct work;
 	struct dm_verity *v;
 	sector_t block;
 	unsigned n_blocks;
+	unsigned cluster;	/* level 0 prefetch cluster in bytes */
 };
 
 /*
@@ -82,17 +97,11 @@ static void cache_timeout_cb(unsigned long data)
 static int recently_verified(struct dm_verity *v, sector_t block,
 			     unsigned n_blocks)
 {
-	unsigned b;
-
 	if (!v->verified_cache)
 		return 0;
 
-	for (b = 0; b < n_blocks; b++) {
-		if (!test_bit(block + b, v->verified_cache))
-			return 0;
-	}
-
-	return 1;
+	return find_next_zero_bit(v->verified_cache, block + n_blocks,
+				  block) >= block + n_blocks;
 }
 
 /*
@@ -390,6 +399,18 @@ out:
 	return r;
 }
 
+/*
+ * Return the bio an io belongs to. Chunks split off a large io are allocated
+ * separately and find the bio through their parent.
+ */
+static struct bio *verity_io_bio(struct dm_verity *v, struct dm_verity_io *io)
+{
+	if (io->parent)
+		io = io->parent;
+
+	return dm_bio_from_per_bio_data(io, v->ti->per_bio_data_size);
+}
+
 /*
  * Calls function process for 1 << v->data_dev_block_bits bytes in the bio_vec
  * starting from iter.
@@ -401,7 +422,7 @@ int verity_for_bv_block(struct dm_verity *v, struct dm_verity_io *io,
 				       size_t len))
 {
 	unsigned todo = 1 << v->data_dev_block_bits;
-	struct bio *bio = dm_bio_from_per_bio_data(io, v->ti->per_bio_data_size);
+	struct bio *bio = verity_io_bio(v, io);
 
 	do {
 		int r;
@@ -517,11 +538,94 @@ static void verity_finish_io(struct dm_verity_io *io, int error)
 	bio_endio_nodec(bio, error);
 }
 
+/*
+ * One chunk of an io, or the parent io itself, has been verified. The bio is
+ * completed once all chunks are done, with the first error any of them hit.
+ */
+static void verity_io_done(struct dm_verity_io *io, int error)
+{
+	struct dm_verity_io *parent = io->parent ? io->parent : io;
+
+	if (error)
+		cmpxchg(&parent->error, 0, error);
+
+	if (io != parent) {
+		verity_fec_finish_io(io);
+		kfree(io);
+	}
+
+	if (atomic_dec_and_test(&parent->pending))
+		verity_finish_io(parent, parent->error);
+}
+
+static void verity_chunk_work(struct work_struct *w)
+{
+	struct dm_verity_io *io = container_of(w, struct dm_verity_io, work);
+
+	verity_io_done(io, verity_verify_io(io));
+}
+
+/*
+ * Split a large io into chunks that are verified concurrently on the unbound
+ * workqueue. Each chunk gets its own copy of the per-bio data, so it has its
+ * own hash descriptor, digests and FEC state. Chunks are carved off the tail
+ * so that whatever could not be split off stays with the parent as a single
+ * contiguous range.
+ */
+static void verity_split_io(struct dm_verity_io *io)
+{
+	struct dm_verity *v = io->v;
+	struct bio *bio = verity_io_bio(v, io);
+	unsigned chunk = ACCESS_ONCE(dm_verity_parallel_blocks);
+	unsigned n_blocks = io->n_blocks;
+	unsigned nr, per, i;
+
+	if (!chunk || n_blocks < 2 * chunk)
+		return;
+
+	nr = min(n_blocks / chunk, num_online_cpus());
+	if (nr < 2)
+		return;
+	per = DIV_ROUND_UP(n_blocks, nr);
+
+	for (i = nr - 1; i > 0; i--) {
+		struct dm_verity_io *c;
+		unsigned start = i * per;
+
+		if (start >= n_blocks)
+			continue;
+
+		c = kmalloc(v->ti->per_bio_data_size,
+			GFP_NOIO | __GFP_NORETRY | __GFP_NOMEMALLOC | __GFP_NOWARN);
+		if (!c)
+			break;
+
+		c->v = v;
+		c->parent = io;
+		c->block = io->block + start;
+		c->n_blocks = n_blocks - start;
+		c->iter = io->iter;
+		bio_advance_iter(bio, &c->iter, start << v->data_dev_block_bits);
+		verity_fec_init_io(c);
+
+		n_blocks = start;
+		atomic_inc(&io->pending);
+		INIT_WORK(&c->work, verity_chunk_work);
+		queue_work(v->verify_wq, &c->work);
+	}
+
+	io->n_blocks = n_blocks;
+}
+
 static void verity_work(struct work_struct *w)
 {
 	struct dm_verity_io *io = container_of(w, struct dm_verity_io, work);
 
-	verity_finish_io(io, verity_verify_io(io));
+	atomic_set(&io->pending, 1);
+	io->error = 0;
+	verity_split_io(io);
+
+	verity_io_done(io, verity_verify_io(io));
 }
 
 static void verity_end_io(struct bio *bio, int error)
@@ -556,7 +660,7 @@ static void verity_prefetch_io(struct work_struct *work)
 		verity_hash_at_level(v, pw->block, i, &hash_block_start, NULL);
 		verity_hash_at_level(v, pw->block + pw->n_blocks - 1, i, &hash_block_end, NULL);
 		if (!i) {
-			unsigned cluster = ACCESS_ONCE(dm_verity_prefetch_cluster);
+			unsigned cluster = pw->cluster;
 
 			cluster >>= v->data_dev_block_bits;
 			if (unlikely(!cluster))
@@ -584,7 +688,40 @@ no_prefetch_cluster:
 	kfree(pw);
 }
 
-static void verity_submit_prefetch(struct dm_verity *v, struct dm_verity_io *io)
+/*
+ * Return the level 0 prefetch cluster for a read. Reads that start where the
+ * previous one ended use prefetch_cluster, doubled for each further read in
+ * the streak. Anything else resets the streak and disables clustering.
+ *
+ * The state is shared by all readers of the device without locking; a lost
+ * update only costs a suboptimal prefetch size.
+ */
+static unsigned verity_prefetch_cluster(struct dm_verity *v, sector_t block,
+					unsigned n_blocks)
+{
+	unsigned cluster = ACCESS_ONCE(dm_verity_prefetch_cluster);
+	unsigned streak = ACCESS_ONCE(v->seq_streak);
+
+	if (block == ACCESS_ONCE(v->last_read_end)) {
+		if (streak <= DM_VERITY_PREFETCH_MAX_SHIFT)
+			streak++;
+	} else {
+		streak = 0;
+	}
+
+	ACCESS_ONCE(v->seq_streak) = streak;
+	ACCESS_ONCE(v->last_read_end) = block + n_blocks;
+
+	if (!streak)
+		return 0;
+	if (cluster > (UINT_MAX >> (streak - 1)))
+		return cluster;
+
+	return cluster << (streak - 1);
+}
+
+static void verity_submit_prefetch(struct dm_verity *v, struct dm_verity_io *io,
+				   unsigned cluster)
 {
 	struct dm_verity_prefetch_work *pw;
 
@@ -598,6 +735,7 @@ static void verity_submit_prefetch(struct dm_verity *v, struct dm_verity_io *io)
 	pw->v = v;
 	pw->block = io->block;
 	pw->n_blocks = io->n_blocks;
+	pw->cluster = cluster;
 	queue_work(v->verify_wq, &pw->work);
 }
 
@@ -611,6 +749,7 @@ int verity_map(struct dm_target *ti, struct bio *bio)
 	struct dm_verity_io *io;
 	sector_t block;
 	unsigned n_blocks;
+	unsigned cluster;
 
 	bio->bi_bdev = v->data_dev->bdev;
 	bio->bi_iter.bi_sector = verity_map_sector(v, bio->bi_iter.bi_sector);
@@ -641,6 +780,7 @@ int verity_map(struct dm_target *ti, struct bio *bio)
 	block = bio->bi_iter.bi_sector >>
 		(v->data_dev_block_bits - SECTOR_SHIFT);
 	n_blocks = bio->bi_iter.bi_size >> v->data_dev_block_bits;
+	cluster = verity_prefetch_cluster(v, block, n_blocks);
 	if (recently_verified(v, block, n_blocks))
 		goto already_verified;
 
@@ -650,6 +790,7 @@ int verity_map(struct dm_target *ti, struct bio *bio)
 	io->orig_bi_private = bio->bi_private;
 	io->block = block;
 	io->n_blocks = n_blocks;
+	io->parent = NULL;
 
 	bio->bi_end_io = verity_end_io;
 	bio->bi_private = io;
@@ -657,7 +798,7 @@ int verity_map(struct dm_target *ti, struct bio *bio)
 
 	verity_fec_init_io(io);
 
-	verity_submit_prefetch(v, io);
+	verity_submit_prefetch(v, io, cluster);
 
 already_verified:
 	generic_make_request(bio);
@@ -65,6 +65,10 @@ struct dm_verity {
 	struct dm_verity_fec *fec;	/* forward error correction */
 	unsigned long *verified_cache;
 	struct timer_list cache_timeout;
+
+	/* sequential read detection for hash prefetch, updated racily */
+	sector_t last_read_end;	/* data block following the last read */
+	unsigned seq_streak;	/* number of back to back sequential reads */
 };
 
 struct dm_verity_io {
@@ -81,6 +85,11 @@ struct dm_verity_io {
 
 	struct work_struct work;
 
+	/* set on the chunks a large io is split into for verification */
+	struct dm_verity_io *parent;
+	atomic_t pending;	/* parent: itself plus chunks still running */
+	int error;		/* parent: first error reported by a chunk */
+
 	/*
 	 * Three variably-size fields follow this struct:
 	 *
@@ -550,6 +550,7 @@ struct msm_vfe_stats_stream {
 	uint32_t stream_id;
 	uint32_t stream_handle;
 	uint32_t composite_flag;
+	uint8_t sof_composite;
 	enum msm_isp_stats_type stats_type;
 	enum msm_vfe_stats_state state;
 	uint32_t framedrop_pattern;
@@ -569,6 +570,10 @@ struct msm_vfe_stats_shared_data {
 	atomic_t stats_comp_mask[MAX_NUM_STATS_COMP_MASK];
 	uint16_t stream_handle_cnt;
 	atomic_t stats_update;
+	/* stats of sof_composite streams waiting for the next SOF */
+	spinlock_t sof_comp_lock;
+	uint32_t sof_comp_mask;
+	struct msm_isp_event_data sof_comp_event;
 };
 
 struct msm_vfe_tasklet_queue_cmd {
@@ -142,6 +142,65 @@ buf_error:
 	return rc;
 }
 
+/* Called with sof_comp_lock held */
+static void __msm_isp_stats_flush_sof_comp(struct vfe_device *vfe_dev)
+{
+	struct msm_vfe_stats_shared_data *stats_data = &vfe_dev->stats_data;
+
+	if (!stats_data->sof_comp_mask)
+		return;
+
+	stats_data->sof_comp_event.u.stats.stats_mask =
+		stats_data->sof_comp_mask;
+	ISP_DBG("%s: vfe_id %d frameid %x, mask %x\n", __func__,
+		vfe_dev->pdev->id, stats_data->sof_comp_event.frame_id,
+		stats_data->sof_comp_mask);
+	msm_isp_send_event(vfe_dev, ISP_EVENT_COMP_STATS_NOTIFY,
+		&stats_data->sof_comp_event);
+	stats_data->sof_comp_mask = 0;
+	memset(&stats_data->sof_comp_event, 0,
+		sizeof(stats_data->sof_comp_event));
+}
+
+void msm_isp_stats_flush_sof_comp(struct vfe_device *vfe_dev)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&vfe_dev->stats_data.sof_comp_lock, flags);
+	__msm_isp_stats_flush_sof_comp(vfe_dev);
+	spin_unlock_irqrestore(&vfe_dev->stats_data.sof_comp_lock, flags);
+}
+
+/*
+ * Adds a done buffer of a sof_composite stream to the event sent on the
+ * next SOF. If a buffer of the same type is still waiting, the pending
+ * event goes out first so that no buffer index gets overwritten.
+ */
+static void msm_isp_stats_queue_sof_comp(struct vfe_device *vfe_dev,
+	struct msm_isp_event_data *buf_event, uint32_t stats_type)
+{
+	struct msm_vfe_stats_shared_data *stats_data = &vfe_dev->stats_data;
+	struct msm_isp_stats_event *comp_event =
+		&stats_data->sof_comp_event.u.stats;
+	unsigned long flags;
+
+	spin_lock_irqsave(&stats_data->sof_comp_lock, flags);
+	if (stats_data->sof_comp_mask & (1 << stats_type))
+		__msm_isp_stats_flush_sof_comp(vfe_dev);
+
+	if (!stats_data->sof_comp_mask) {
+		stats_data->sof_comp_event.timestamp = buf_event->timestamp;
+		stats_data->sof_comp_event.frame_id = buf_event->frame_id;
+		comp_event->pd_stats_idx = 0xF;
+	}
+	comp_event->stats_buf_idxs[stats_type] =
+		buf_event->u.stats.stats_buf_idxs[stats_type];
+	if (stats_type == MSM_ISP_STATS_BF)
+		comp_event->pd_stats_idx = vfe_dev->pd_buf_idx;
+	stats_data->sof_comp_mask |= 1 << stats_type;
+	spin_unlock_irqrestore(&stats_data->sof_comp_lock, flags);
+}
+
 static int32_t msm_isp_stats_buf_divert(struct vfe_device *vfe_dev,
 	struct msm_isp_timestamp *ts,
 	struct msm_isp_event_data *buf_event,
@@ -236,7 +295,10 @@ static int32_t msm_isp_stats_buf_divert(struct vfe_device *vfe_dev,
 		stats_event->stats_buf_idxs
 			[stream_info->stats_type] =
 			done_buf->buf_idx;
-		if (NULL == comp_stats_type_mask) {
+		if (stream_info->sof_composite) {
+			msm_isp_stats_queue_sof_comp(vfe_dev, buf_event,
+				stream_info->stats_type);
+		} else if (NULL == comp_stats_type_mask) {
 			stats_event->stats_mask =
 				1 << stream_info->stats_type;
 			ISP_DBG("%s: stats frameid: 0x%x %d bufq %x\n",
@@ -393,7 +455,13 @@ int msm_isp_stats_create_stream(struct vfe_device *vfe_dev,
 
 	stream_info->session_id = stream_req_cmd->session_id;
 	stream_info->stream_id = stream_req_cmd->stream_id;
-	stream_info->composite_flag = stream_req_cmd->composite_flag;
+	if (stream_req_cmd->composite_flag == MSM_ISP_STATS_COMPOSITE_SOF) {
+		stream_info->composite_flag = 0;
+		stream_info->sof_composite = 1;
+	} else {
+		stream_info->composite_flag = stream_req_cmd->composite_flag;
+		stream_info->sof_composite = 0;
+	}
 	stream_info->stats_type = stream_req_cmd->stats_type;
 	stream_info->buffer_offset = stream_req_cmd->buffer_offset;
 	stream_info->framedrop_pattern = stream_req_cmd->framedrop_pattern;
@@ -831,6 +899,9 @@ static int msm_isp_stop_stats_stream(struct vfe_device *vfe_dev,
 		}
 	}
 
+	/* Deliver what waits for SOF before the buffers get flushed */
+	msm_isp_stats_flush_sof_comp(vfe_dev);
+
 	for (i = 0; i < stream_cfg_cmd->num_streams; i++) {
 		idx = STATS_IDX(stream_cfg_cmd->stream_handle[i]);
 
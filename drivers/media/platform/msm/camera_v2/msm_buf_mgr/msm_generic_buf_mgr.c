@@ -20,6 +20,14 @@ struct v4l2_subdev *msm_buf_mngr_get_subdev(void)
 	return &msm_buf_mngr_dev->subdev.sd;
 }
 
+static inline struct msm_buf_mngr_buf_q *msm_buf_mngr_get_buf_q(
+	struct msm_buf_mngr_device *dev, uint32_t session_id,
+	uint32_t stream_id)
+{
+	return &dev->buf_q[hash_32((session_id << 16) ^ stream_id,
+		MSM_BUF_MNGR_BUF_Q_BITS)];
+}
+
 static int32_t msm_buf_mngr_hdl_cont_get_buf(struct msm_buf_mngr_device *dev,
 	struct msm_buf_mngr_info *buf_info)
 {
@@ -54,6 +62,7 @@ static int32_t msm_buf_mngr_get_buf(struct msm_buf_mngr_device *dev,
 {
 	unsigned long flags;
 	int32_t rc = 0;
+	struct msm_buf_mngr_buf_q *buf_q;
 	struct msm_buf_mngr_info *buf_info =
 		(struct msm_buf_mngr_info *)argp;
 	struct msm_get_bufs *new_entry =
@@ -74,9 +83,11 @@ static int32_t msm_buf_mngr_get_buf(struct msm_buf_mngr_device *dev,
 	new_entry->session_id = buf_info->session_id;
 	new_entry->stream_id = buf_info->stream_id;
 	new_entry->index = new_entry->vb2_buf->v4l2_buf.index;
-	spin_lock_irqsave(&dev->buf_q_spinlock, flags);
-	list_add_tail(&new_entry->entry, &dev->buf_qhead);
-	spin_unlock_irqrestore(&dev->buf_q_spinlock, flags);
+	buf_q = msm_buf_mngr_get_buf_q(dev, new_entry->session_id,
+		new_entry->stream_id);
+	spin_lock_irqsave(&buf_q->lock, flags);
+	list_add_tail(&new_entry->entry, &buf_q->head);
+	spin_unlock_irqrestore(&buf_q->lock, flags);
 	buf_info->index = new_entry->vb2_buf->v4l2_buf.index;
 	if (buf_info->type == MSM_CAMERA_BUF_MNGR_BUF_USER) {
 		mutex_lock(&dev->cont_mutex);
@@ -97,6 +108,7 @@ static int32_t msm_buf_mngr_get_buf_by_idx(struct msm_buf_mngr_device *dev,
 {
 	unsigned long flags;
 	int32_t rc = 0;
+	struct msm_buf_mngr_buf_q *buf_q;
 	struct msm_buf_mngr_info *buf_info =
 		(struct msm_buf_mngr_info *)argp;
 	struct msm_get_bufs *new_entry =
@@ -122,9 +134,11 @@ static int32_t msm_buf_mngr_get_buf_by_idx(struct msm_buf_mngr_device *dev,
 	new_entry->session_id = buf_info->session_id;
 	new_entry->stream_id = buf_info->stream_id;
 	new_entry->index = new_entry->vb2_buf->v4l2_buf.index;
-	spin_lock_irqsave(&dev->buf_q_spinlock, flags);
-	list_add_tail(&new_entry->entry, &dev->buf_qhead);
-	spin_unlock_irqrestore(&dev->buf_q_spinlock, flags);
+	buf_q = msm_buf_mngr_get_buf_q(dev, new_entry->session_id,
+		new_entry->stream_id);
+	spin_lock_irqsave(&buf_q->lock, flags);
+	list_add_tail(&new_entry->entry, &buf_q->head);
+	spin_unlock_irqrestore(&buf_q->lock, flags);
 	if (buf_info->type == MSM_CAMERA_BUF_MNGR_BUF_USER) {
 		mutex_lock(&dev->cont_mutex);
 		if (!list_empty(&dev->cont_qhead)) {
@@ -145,9 +159,11 @@ static int32_t msm_buf_mngr_buf_done(struct msm_buf_mngr_device *buf_mngr_dev,
 	unsigned long flags;
 	struct msm_get_bufs *bufs, *save;
 	int32_t ret = -EINVAL;
+	struct msm_buf_mngr_buf_q *buf_q = msm_buf_mngr_get_buf_q(buf_mngr_dev,
+		buf_info->session_id, buf_info->stream_id);
 
-	spin_lock_irqsave(&buf_mngr_dev->buf_q_spinlock, flags);
-	list_for_each_entry_safe(bufs, save, &buf_mngr_dev->buf_qhead, entry) {
+	spin_lock_irqsave(&buf_q->lock, flags);
+	list_for_each_entry_safe(bufs, save, &buf_q->head, entry) {
 		if ((bufs->session_id == buf_info->session_id) &&
 			(bufs->stream_id == buf_info->stream_id) &&
 			(bufs->index == buf_info->index)) {
@@ -163,7 +179,7 @@ static int32_t msm_buf_mngr_buf_done(struct msm_buf_mngr_device *buf_mngr_dev,
 			break;
 		}
 	}
-	spin_unlock_irqrestore(&buf_mngr_dev->buf_q_spinlock, flags);
+	spin_unlock_irqrestore(&buf_q->lock, flags);
 	return ret;
 }
 
@@ -174,9 +190,11 @@ static int32_t msm_buf_mngr_put_buf(struct msm_buf_mngr_device *buf_mngr_dev,
 	unsigned long flags;
 	struct msm_get_bufs *bufs, *save;
 	int32_t ret = -EINVAL;
+	struct msm_buf_mngr_buf_q *buf_q = msm_buf_mngr_get_buf_q(buf_mngr_dev,
+		buf_info->session_id, buf_info->stream_id);
 
-	spin_lock_irqsave(&buf_mngr_dev->buf_q_spinlock, flags);
-	list_for_each_entry_safe(bufs, save, &buf_mngr_dev->buf_qhead, entry) {
+	spin_lock_irqsave(&buf_q->lock, flags);
+	list_for_each_entry_safe(bufs, save, &buf_q->head, entry) {
 		if ((bufs->session_id == buf_info->session_id) &&
 			(bufs->stream_id == buf_info->stream_id) &&
 			(bufs->index == buf_info->index)) {
@@ -187,7 +205,7 @@ static int32_t msm_buf_mngr_put_buf(struct msm_buf_mngr_device *buf_mngr_dev,
 			break;
 		}
 	}
-	spin_unlock_irqrestore(&buf_mngr_dev->buf_q_spinlock, flags);
+	spin_unlock_irqrestore(&buf_q->lock, flags);
 	return ret;
 }
 
@@ -199,13 +217,15 @@ static int32_t msm_generic_buf_mngr_flush(
 	struct msm_get_bufs *bufs, *save;
 	int32_t ret = -EINVAL;
 	struct timeval ts;
+	struct msm_buf_mngr_buf_q *buf_q = msm_buf_mngr_get_buf_q(buf_mngr_dev,
+		buf_info->session_id, buf_info->stream_id);
 
-	spin_lock_irqsave(&buf_mngr_dev->buf_q_spinlock, flags);
+	spin_lock_irqsave(&buf_q->lock, flags);
 	/*
 	 * Sanity check on client buf list, remove buf mgr
 	 * queue entries in case any
 	 */
-	list_for_each_entry_safe(bufs, save, &buf_mngr_dev->buf_qhead, entry) {
+	list_for_each_entry_safe(bufs, save, &buf_q->head, entry) {
 		if ((bufs->session_id == buf_info->session_id) &&
 			(bufs->stream_id == buf_info->stream_id)) {
 			ret = buf_mngr_dev->vb2_ops.buf_done(bufs->vb2_buf,
@@ -218,7 +238,7 @@ static int32_t msm_generic_buf_mngr_flush(
 			kfree(bufs);
 		}
 	}
-	spin_unlock_irqrestore(&buf_mngr_dev->buf_q_spinlock, flags);
+	spin_unlock_irqrestore(&buf_q->lock, flags);
 	/* Flush the remaining vb2 buffers in stream list */
 	ret = buf_mngr_dev->vb2_ops.flush_buf(buf_info->session_id,
 			buf_info->stream_id);
@@ -289,14 +309,16 @@ static void msm_buf_mngr_sd_shutdown(struct msm_buf_mngr_device *dev,
 {
 	unsigned long flags;
 	struct msm_get_bufs *bufs, *save;
+	struct msm_buf_mngr_buf_q *buf_q;
+	int i;
 
 	BUG_ON(!dev);
 	BUG_ON(!session);
 
-	spin_lock_irqsave(&dev->buf_q_spinlock, flags);
-	if (!list_empty(&dev->buf_qhead)) {
-		list_for_each_entry_safe(bufs,
-			save, &dev->buf_qhead, entry) {
+	for (i = 0; i < MSM_BUF_MNGR_NUM_BUF_Q; i++) {
+		buf_q = &dev->buf_q[i];
+		spin_lock_irqsave(&buf_q->lock, flags);
+		list_for_each_entry_safe(bufs, save, &buf_q->head, entry) {
 			if (session->session == bufs->session_id) {
 				pr_info("%s: Delete invalid bufs =%pK, session_id=%u, bufs->ses_id=%d, str_id=%d, idx=%d\n",
 					__func__, (void *)bufs,
@@ -307,8 +329,8 @@ static void msm_buf_mngr_sd_shutdown(struct msm_buf_mngr_device *dev,
 				kfree(bufs);
 			}
 		}
+		spin_unlock_irqrestore(&buf_q->lock, flags);
 	}
-	spin_unlock_irqrestore(&dev->buf_q_spinlock, flags);
 	mutex_lock(&dev->cont_mutex);
 	if (!list_empty(&dev->cont_qhead))
 		msm_buf_mngr_contq_cleanup(dev, session);
@@ -828,6 +850,8 @@ static long msm_buf_subdev_fops_ioctl(struct file *file, unsigned int cmd,
 static int32_t __init msm_buf_mngr_init(void)
 {
 	int32_t rc = 0;
+	int i;
+
 	msm_buf_mngr_dev = kzalloc(sizeof(*msm_buf_mngr_dev),
 		GFP_KERNEL);
 	if (WARN_ON(!msm_buf_mngr_dev)) {
@@ -866,8 +890,10 @@ static int32_t __init msm_buf_mngr_init(void)
 	v4l2_subdev_notify(&msm_buf_mngr_dev->subdev.sd, MSM_SD_NOTIFY_REQ_CB,
 		&msm_buf_mngr_dev->vb2_ops);
 
-	INIT_LIST_HEAD(&msm_buf_mngr_dev->buf_qhead);
-	spin_lock_init(&msm_buf_mngr_dev->buf_q_spinlock);
+	for (i = 0; i < MSM_BUF_MNGR_NUM_BUF_Q; i++) {
+		INIT_LIST_HEAD(&msm_buf_mngr_dev->buf_q[i].head);
+		spin_lock_init(&msm_buf_mngr_dev->buf_q[i].lock);
+	}
 
 	mutex_init(&msm_buf_mngr_dev->cont_mutex);
 	INIT_LIST_HEAD(&msm_buf_mngr_dev->cont_qhead);
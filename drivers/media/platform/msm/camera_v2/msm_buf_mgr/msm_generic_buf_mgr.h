@@ -13,6 +13,7 @@
 #ifndef __MSM_BUF_GENERIC_MNGR_H__
 #define __MSM_BUF_GENERIC_MNGR_H__
 
+#include <linux/hash.h>
 #include <linux/io.h>
 #include <linux/of.h>
 #include <linux/module.h>
@@ -32,9 +33,21 @@ struct msm_get_bufs {
 	uint32_t index;
 };
 
+/*
+ * Buffers handed out to clients are tracked in one of several queues picked
+ * by session and stream, so that streams running concurrently don't all
+ * serialize on a single lock in the get/done path.
+ */
+#define MSM_BUF_MNGR_BUF_Q_BITS 4
+#define MSM_BUF_MNGR_NUM_BUF_Q (1 << MSM_BUF_MNGR_BUF_Q_BITS)
+
+struct msm_buf_mngr_buf_q {
+	struct list_head head;
+	spinlock_t lock;
+};
+
 struct msm_buf_mngr_device {
-	struct list_head buf_qhead;
-	spinlock_t buf_q_spinlock;
+	struct msm_buf_mngr_buf_q buf_q[MSM_BUF_MNGR_NUM_BUF_Q];
 	struct ion_client *ion_client;
 	struct msm_sd_subdev subdev;
 	struct msm_sd_req_vb2_q vb2_ops;
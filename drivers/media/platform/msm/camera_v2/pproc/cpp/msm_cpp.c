@@ -296,6 +296,8 @@ static void msm_enqueue(struct msm_device_queue *queue,
 
 static int msm_cpp_notify_frame_done(struct cpp_device *cpp_dev,
 	uint8_t put_buf);
+static void msm_cpp_drop_pending_frames(struct cpp_device *cpp_dev,
+	uint32_t identity, bool all);
 static int32_t cpp_load_fw(struct cpp_device *cpp_dev, char *fw_name_bin);
 static void cpp_timer_callback(unsigned long data);
 
@@ -945,6 +947,10 @@ void msm_cpp_do_tasklet(unsigned long data)
 			}
 		}
 	}
+
+	/* A slot may have freed up for frames waiting in the pending queue */
+	if (cpp_dev->pending_q.len)
+		queue_work(cpp_dev->timer_wq, &cpp_dev->pending_work);
 }
 
 static int cpp_init_hardware(struct cpp_device *cpp_dev)
@@ -1340,6 +1346,7 @@ static int cpp_close_node(struct v4l2_subdev *sd, struct v4l2_subdev_fh *fh)
 	int rc = -1;
 	struct cpp_device *cpp_dev = NULL;
 	struct msm_device_queue *processing_q = NULL;
+	struct msm_device_queue *pending_q = NULL;
 	struct msm_device_queue *eventData_q = NULL;
 
 	if (!sd) {
@@ -1356,6 +1363,7 @@ static int cpp_close_node(struct v4l2_subdev *sd, struct v4l2_subdev_fh *fh)
 	mutex_lock(&cpp_dev->mutex);
 
 	processing_q = &cpp_dev->processing_q;
+	pending_q = &cpp_dev->pending_q;
 	eventData_q = &cpp_dev->eventData_q;
 
 	if (cpp_dev->cpp_open_cnt == 0) {
@@ -1419,6 +1427,7 @@ static int cpp_close_node(struct v4l2_subdev *sd, struct v4l2_subdev_fh *fh)
 		}
 		cam_smmu_destroy_handle(cpp_dev->iommu_hdl);
 		msm_cpp_empty_list(processing_q, list_frame);
+		msm_cpp_empty_list(pending_q, list_frame);
 		msm_cpp_empty_list(eventData_q, list_eventdata);
 		cpp_dev->state = CPP_STATE_OFF;
 	}
@@ -1463,18 +1472,15 @@ static int msm_cpp_buffer_ops(struct cpp_device *cpp_dev,
 	return rc;
 }
 
-static int msm_cpp_notify_frame_done(struct cpp_device *cpp_dev,
-	uint8_t put_buf)
+static int msm_cpp_complete_frame(struct cpp_device *cpp_dev,
+	struct msm_queue_cmd *frame_qcmd, uint8_t put_buf)
 {
 	struct v4l2_event v4l2_evt;
-	struct msm_queue_cmd *frame_qcmd = NULL;
 	struct msm_queue_cmd *event_qcmd = NULL;
 	struct msm_cpp_frame_info_t *processed_frame = NULL;
-	struct msm_device_queue *queue = &cpp_dev->processing_q;
 	struct msm_buf_mngr_info buff_mgr_info;
 	int rc = 0;
 
-	frame_qcmd = msm_dequeue(queue, list_frame, POP_FRONT);
 	if (frame_qcmd) {
 		processed_frame = frame_qcmd->command;
 		do_gettimeofday(&(processed_frame->out_time));
@@ -1581,6 +1587,50 @@ NOTIFY_FRAME_DONE:
 	return rc;
 }
 
+static int msm_cpp_notify_frame_done(struct cpp_device *cpp_dev,
+	uint8_t put_buf)
+{
+	struct msm_queue_cmd *frame_qcmd;
+
+	frame_qcmd = msm_dequeue(&cpp_dev->processing_q, list_frame,
+		POP_FRONT);
+	return msm_cpp_complete_frame(cpp_dev, frame_qcmd, put_buf);
+}
+
+/*
+ * Returns the buffers of frames still waiting in the pending queue and
+ * reports them as done, either all of them or only those for identity.
+ */
+static void msm_cpp_drop_pending_frames(struct cpp_device *cpp_dev,
+	uint32_t identity, bool all)
+{
+	struct msm_device_queue *queue = &cpp_dev->pending_q;
+	struct msm_queue_cmd *qcmd, *save;
+	struct msm_cpp_frame_info_t *frame;
+	unsigned long flags;
+	LIST_HEAD(dropped);
+
+	spin_lock_irqsave(&queue->lock, flags);
+	list_for_each_entry_safe(qcmd, save, &queue->list, list_frame) {
+		frame = qcmd->command;
+		if (all || frame->identity == identity ||
+			(frame->duplicate_output &&
+			frame->duplicate_identity == identity)) {
+			list_move_tail(&qcmd->list_frame, &dropped);
+			queue->len--;
+		}
+	}
+	spin_unlock_irqrestore(&queue->lock, flags);
+
+	list_for_each_entry_safe(qcmd, save, &dropped, list_frame) {
+		list_del_init(&qcmd->list_frame);
+		frame = qcmd->command;
+		pr_warn("Dropping pending frame identity=0x%x, frame_id=%d\n",
+			frame->identity, frame->frame_id);
+		msm_cpp_complete_frame(cpp_dev, qcmd, 1);
+	}
+}
+
 #if MSM_CPP_DUMP_FRM_CMD
 static int msm_cpp_dump_frame_cmd(struct msm_cpp_frame_info_t *frame_info)
 {
@@ -1625,6 +1675,7 @@ static void msm_cpp_flush_queue_and_release_buffer(struct cpp_device *cpp_dev,
 		msm_cpp_notify_frame_done(cpp_dev, 1);
 		queue_len--;
 	}
+	msm_cpp_drop_pending_frames(cpp_dev, 0, true);
 	atomic_set(&cpp_timer.used, 0);
 	for (i = 0; i < MAX_CPP_PROCESSING_FRAME; i++)
 		cpp_timer.data.processed_frame[i] = NULL;
@@ -1826,7 +1877,7 @@ void cpp_timer_callback(unsigned long data)
 		(struct work_struct *)work);
 }
 
-static int msm_cpp_send_frame_to_hardware(struct cpp_device *cpp_dev,
+static int __msm_cpp_send_frame_to_hardware(struct cpp_device *cpp_dev,
 	struct msm_queue_cmd *frame_qcmd)
 {
 	unsigned long flags;
@@ -1941,6 +1992,67 @@ end:
 	return rc;
 }
 
+/*
+ * Moves frames from the pending queue to the microcontroller for as long as
+ * it has room for them. Called with cpp_dev->mutex held.
+ */
+static void msm_cpp_submit_pending_frames(struct cpp_device *cpp_dev)
+{
+	struct msm_queue_cmd *qcmd;
+	int rc;
+
+	while (cpp_dev->pending_q.len &&
+		cpp_dev->processing_q.len < MAX_CPP_PROCESSING_FRAME) {
+		qcmd = msm_dequeue(&cpp_dev->pending_q, list_frame, POP_FRONT);
+		if (!qcmd)
+			break;
+
+		rc = __msm_cpp_send_frame_to_hardware(cpp_dev, qcmd);
+		if (rc < 0) {
+			pr_err("%s: error sending pending frame %d\n",
+				__func__, rc);
+			msm_cpp_complete_frame(cpp_dev, qcmd, 1);
+		}
+	}
+}
+
+static void msm_cpp_pending_work(struct work_struct *work)
+{
+	struct cpp_device *cpp_dev = container_of(work, struct cpp_device,
+		pending_work);
+
+	mutex_lock(&cpp_dev->mutex);
+	if (cpp_dev->state == CPP_STATE_ACTIVE)
+		msm_cpp_submit_pending_frames(cpp_dev);
+	mutex_unlock(&cpp_dev->mutex);
+}
+
+/*
+ * The microcontroller holds up to MAX_CPP_PROCESSING_FRAME frames. Frames
+ * queued beyond that wait in the pending queue, with their payload ready,
+ * and are sent as soon as a frame done frees a slot so that the hardware
+ * doesn't idle while the next frame is being set up.
+ */
+static int msm_cpp_send_frame_to_hardware(struct cpp_device *cpp_dev,
+	struct msm_queue_cmd *frame_qcmd)
+{
+	msm_cpp_submit_pending_frames(cpp_dev);
+
+	if (!cpp_dev->pending_q.len &&
+		cpp_dev->processing_q.len < MAX_CPP_PROCESSING_FRAME)
+		return __msm_cpp_send_frame_to_hardware(cpp_dev, frame_qcmd);
+
+	if (cpp_dev->pending_q.len < MAX_CPP_PENDING_FRAME) {
+		CPP_DBG("Queue frame to pending queue, len %d\n",
+			cpp_dev->pending_q.len);
+		msm_enqueue(&cpp_dev->pending_q, &frame_qcmd->list_frame);
+		return 0;
+	}
+
+	pr_err("process queue full. drop frame\n");
+	return -EAGAIN;
+}
+
 static int msm_cpp_send_command_to_hardware(struct cpp_device *cpp_dev,
 	uint32_t *cmd_msg, uint32_t payload_size)
 {
@@ -2781,6 +2893,7 @@ void msm_cpp_clean_queue(struct cpp_device *cpp_dev)
 			kfree(processed_frame);
 		}
 	}
+	msm_cpp_drop_pending_frames(cpp_dev, 0, true);
 }
 
 #ifdef CONFIG_COMPAT
@@ -3186,6 +3299,8 @@ STREAM_BUFF_END:
 			return -EINVAL;
 		}
 
+		/* Frames of this stream not sent to hw yet must not outlive it */
+		msm_cpp_drop_pending_frames(cpp_dev, identity, false);
 		msm_cpp_dequeue_buff_info_list(cpp_dev, buff_queue_info);
 		rc = msm_cpp_free_buff_queue_entry(cpp_dev,
 			buff_queue_info->session_id,
@@ -4348,6 +4463,8 @@ static int cpp_probe(struct platform_device *pdev)
 
 	msm_queue_init(&cpp_dev->eventData_q, "eventdata");
 	msm_queue_init(&cpp_dev->processing_q, "frame");
+	msm_queue_init(&cpp_dev->pending_q, "pending");
+	INIT_WORK(&cpp_dev->pending_work, msm_cpp_pending_work);
 	INIT_LIST_HEAD(&cpp_dev->tasklet_q);
 	tasklet_init(&cpp_dev->cpp_tasklet, msm_cpp_do_tasklet,
 		(unsigned long)cpp_dev);
@@ -4444,6 +4561,7 @@ static int cpp_device_remove(struct platform_device *dev)
 	msm_camera_unregister_bus_client(CAM_BUS_CLIENT_CPP);
 	mutex_destroy(&cpp_dev->mutex);
 	kfree(cpp_dev->work);
+	cancel_work_sync(&cpp_dev->pending_work);
 	destroy_workqueue(cpp_dev->timer_wq);
 	kfree(cpp_dev->cpp_clk);
 	kfree(cpp_dev);
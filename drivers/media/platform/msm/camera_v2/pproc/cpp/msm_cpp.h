@@ -42,6 +42,7 @@
 
 #define MAX_ACTIVE_CPP_INSTANCE 8
 #define MAX_CPP_PROCESSING_FRAME 2
+#define MAX_CPP_PENDING_FRAME 4
 #define MAX_CPP_V4l2_EVENTS 30
 
 #define MSM_CPP_MICRO_BASE          0x4000
@@ -270,6 +271,12 @@ struct cpp_device {
 	 */
 	struct msm_device_queue processing_q;
 
+	/* Pending Queue
+	 * frames ready to be sent once the microcontroller has room
+	 */
+	struct msm_device_queue pending_q;
+	struct work_struct pending_work;
+
 	struct msm_cpp_buff_queue_info_t *buff_queue;
 	uint32_t num_buffq;
 	struct msm_cam_buf_mgr_req_ops buf_mgr_ops;
@@ -293,14 +293,12 @@ static int msm_comm_get_mbs_per_frame(struct msm_vidc_inst *inst)
 	return max(output_port_mbs, capture_port_mbs);
 }
 
-static int msm_comm_get_mbs_per_sec(struct msm_vidc_inst *inst)
+/* Rate at which frames are processed: the operating rate, at least fps */
+u32 msm_comm_get_operating_fps(struct msm_vidc_inst *inst)
 {
 	int rc;
 	u32 fps;
 	struct v4l2_control ctrl;
-	int mb_per_frame;
-
-	mb_per_frame = msm_comm_get_mbs_per_frame(inst);
 
 	ctrl.id = V4L2_CID_MPEG_VIDC_VIDEO_OPERATING_RATE;
 	rc = msm_comm_g_ctrl(inst, &ctrl);
@@ -310,10 +308,16 @@ static int msm_comm_get_mbs_per_sec(struct msm_vidc_inst *inst)
 		 * Check if operating rate is less than fps.
 		 * If Yes, then use fps to scale the clocks
 		*/
-		fps = fps > inst->prop.fps ? fps : inst->prop.fps;
-		return (mb_per_frame * fps);
-	} else
-		return (mb_per_frame * inst->prop.fps);
+		return fps > inst->prop.fps ? fps : inst->prop.fps;
+	}
+
+	return inst->prop.fps;
+}
+
+static int msm_comm_get_mbs_per_sec(struct msm_vidc_inst *inst)
+{
+	return msm_comm_get_mbs_per_frame(inst) *
+		msm_comm_get_operating_fps(inst);
 }
 
 int msm_comm_get_inst_load(struct msm_vidc_inst *inst,
@@ -556,6 +560,10 @@ static int msm_comm_vote_bus(struct msm_vidc_core *core)
 		else
 			vote_data[i].fps = inst->prop.fps;
 
+		if (msm_vidc_bitrate_clock_scaling &&
+			inst->load_stats.frames >= DCVS_MIN_LOAD_SAMPLES)
+			vote_data[i].bitrate = inst->load_stats.bitrate;
+
 		if (msm_comm_turbo_session(inst))
 			vote_data[i].power_mode = VIDC_POWER_TURBO;
 		else if (is_low_power_session(inst))
@@ -1832,6 +1840,7 @@ static void handle_ebd(enum hal_command_response cmd, void *data)
 		mutex_lock(&inst->bufq[OUTPUT_PORT].lock);
 		vb2_buffer_done(vb, VB2_BUF_STATE_DONE);
 		mutex_unlock(&inst->bufq[OUTPUT_PORT].lock);
+		msm_dcvs_account_ebd(inst);
 		msm_vidc_debugfs_update(inst, MSM_VIDC_DEBUGFS_EVENT_EBD);
 	}
 
@@ -2144,6 +2153,7 @@ static void handle_fbd(enum hal_command_response cmd, void *data)
 		mutex_lock(&inst->bufq[CAPTURE_PORT].lock);
 		vb2_buffer_done(vb, VB2_BUF_STATE_DONE);
 		mutex_unlock(&inst->bufq[CAPTURE_PORT].lock);
+		msm_dcvs_account_fbd(inst, fill_buf_done->filled_len1);
 		msm_vidc_debugfs_update(inst, MSM_VIDC_DEBUGFS_EVENT_FBD);
 	}
 
@@ -2279,7 +2289,7 @@ int msm_comm_scale_clocks_load(struct msm_vidc_core *core,
 	unsigned long instant_bitrate = 0;
 	int num_sessions = 0;
 	struct vidc_clk_scale_data clk_scale_data = { {0} };
-	int codec = 0;
+	int codec = 0, load, adjusted_load;
 
 	if (!core) {
 		dprintk(VIDC_ERR, "%s Invalid args: %pK\n", __func__, core);
@@ -2311,10 +2321,14 @@ int msm_comm_scale_clocks_load(struct msm_vidc_core *core,
 				VIDC_POWER_NORMAL;
 
 		if (inst->dcvs_mode)
-			clk_scale_data.load[num_sessions] = inst->dcvs.load;
+			load = inst->dcvs.load;
 		else
-			clk_scale_data.load[num_sessions] =
-				msm_comm_get_inst_load(inst, quirks);
+			load = msm_comm_get_inst_load(inst, quirks);
+
+		/* fold the measured firmware load into the total */
+		adjusted_load = msm_dcvs_adjust_load(inst, load);
+		num_mbs_per_sec += adjusted_load - load;
+		clk_scale_data.load[num_sessions] = adjusted_load;
 
 		clk_scale_data.session[num_sessions] =
 				VIDC_VOTE_DATA_SESSION_VAL(
@@ -3654,13 +3668,11 @@ static void log_frame(struct msm_vidc_inst *inst, struct vidc_frame_data *data,
 				"Sending etb (%pa) to hal: filled: %d, ts: %lld, flags = %#x\n",
 				&data->device_addr, data->filled_len,
 				data->timestamp, data->flags);
+		msm_dcvs_account_etb(inst, data->filled_len);
 		msm_vidc_debugfs_update(inst, MSM_VIDC_DEBUGFS_EVENT_ETB);
 
-		if (msm_vidc_bitrate_clock_scaling &&
-			inst->session_type == MSM_VIDC_DECODER &&
-			!inst->dcvs_mode)
-				inst->instant_bitrate =
-					data->filled_len * 8 * inst->prop.fps;
+		if (msm_vidc_bitrate_clock_scaling)
+			inst->instant_bitrate = inst->load_stats.bitrate;
 		else
 			inst->instant_bitrate = 0;
 	} else if (type == V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE) {
@@ -3676,10 +3688,8 @@ static void log_frame(struct msm_vidc_inst *inst, struct vidc_frame_data *data,
 
 	if (msm_vidc_bitrate_clock_scaling && !inst->dcvs_mode &&
 		type == V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE &&
-		inst->session_type == MSM_VIDC_DECODER)
-		if (msm_comm_scale_clocks(inst->core))
-			dprintk(VIDC_WARN,
-				"Failed to scale clocks. Performance might be impacted\n");
+		msm_dcvs_load_changed(inst))
+		msm_comm_scale_clocks_and_bus(inst);
 }
 
 static int request_seq_header(struct msm_vidc_inst *inst,
@@ -3866,27 +3876,8 @@ int msm_comm_qbuf(struct msm_vidc_inst *inst, struct vb2_buffer *vb)
 		}
 	}
 
-	if (!batch_mode && etbs.count) {
-		int c = 0;
-
-		for (c = 0; c < etbs.count; ++c) {
-			struct vidc_frame_data *frame_data = &etbs.data[c];
-
-			rc = call_hfi_op(hdev, session_etb, inst->session,
-					frame_data);
-			if (rc) {
-				dprintk(VIDC_ERR, "Failed to issue etb: %d\n",
-						rc);
-				goto err_bad_input;
-			}
-
-			log_frame(inst, frame_data,
-					V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE);
-		}
-	}
-
-	if (!batch_mode && ftbs.count) {
-		int c = 0;
+	if (!batch_mode && (etbs.count || ftbs.count)) {
+		int ftb_index = 0, c = 0;
 
 		for (c = 0; atomic_read(&inst->seq_hdr_reqs) > 0; ++c) {
 			rc = request_seq_header(inst, &ftbs.data[c]);
@@ -3900,18 +3891,28 @@ int msm_comm_qbuf(struct msm_vidc_inst *inst, struct vb2_buffer *vb)
 			atomic_dec(&inst->seq_hdr_reqs);
 		}
 
-		for (; c < ftbs.count; ++c) {
-			struct vidc_frame_data *frame_data = &ftbs.data[c];
+		/*
+		 * Everything that piled up in the pendingq (e.g. buffers the
+		 * client deferred) goes out with a single interrupt to FW.
+		 */
+		ftb_index = c;
+		rc = call_hfi_op(hdev, session_process_buffers, inst->session,
+				etbs.count, etbs.data,
+				ftbs.count - ftb_index, &ftbs.data[ftb_index]);
+		if (rc) {
+			dprintk(VIDC_ERR,
+				"Failed to queue %d ETBs and %d FTBs: %d\n",
+				etbs.count, ftbs.count - ftb_index, rc);
+			goto err_bad_input;
+		}
 
-			rc = call_hfi_op(hdev, session_ftb,
-					inst->session, frame_data);
-			if (rc) {
-				dprintk(VIDC_ERR, "Failed to issue ftb: %d\n",
-						rc);
-				goto err_bad_input;
-			}
+		for (c = 0; c < etbs.count; ++c) {
+			log_frame(inst, &etbs.data[c],
+					V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE);
+		}
 
-			log_frame(inst, frame_data,
+		for (c = ftb_index; c < ftbs.count; ++c) {
+			log_frame(inst, &ftbs.data[c],
 					V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE);
 		}
 	}
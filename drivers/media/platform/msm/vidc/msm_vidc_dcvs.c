@@ -296,6 +296,9 @@ void msm_dcvs_init(struct msm_vidc_inst *inst)
 	inst->dcvs = (struct dcvs_stats){ {0} };
 	inst->dcvs.threshold_disp_buf_high = DCVS_NOMINAL_THRESHOLD;
 	inst->dcvs.threshold_disp_buf_low = DCVS_TURBO_THRESHOLD;
+
+	inst->load_stats = (struct vidc_load_stats){ .frames = 0 };
+	spin_lock_init(&inst->load_stats.lock);
 }
 
 void msm_dcvs_monitor_buffer(struct msm_vidc_inst *inst)
@@ -700,3 +703,137 @@ void msm_dcvs_enc_set_power_save_mode(struct msm_vidc_inst *inst,
 
 	inst->dcvs.is_power_save_mode = is_power_save_mode;
 }
+
+static inline u32 msm_dcvs_ewma(u32 avg, u32 sample, u32 frames)
+{
+	return frames ? avg - (avg >> 3) + (sample >> 3) : sample;
+}
+
+/* Called with the load_stats lock held */
+static void msm_dcvs_update_bitrate(struct msm_vidc_inst *inst, u32 size,
+		u32 fps)
+{
+	struct vidc_load_stats *stats = &inst->load_stats;
+
+	stats->avg_frame_size = msm_dcvs_ewma(stats->avg_frame_size, size,
+			stats->frames);
+	stats->bitrate = (unsigned long)stats->avg_frame_size * 8 * fps;
+}
+
+/*
+ * Account an input buffer queued to firmware. For decoders its size is
+ * the compressed frame size; the firmware is considered busy from the
+ * moment it is handed work until it runs out of input again.
+ */
+void msm_dcvs_account_etb(struct msm_vidc_inst *inst, u32 size)
+{
+	struct vidc_load_stats *stats = &inst->load_stats;
+	u32 fps = msm_comm_get_operating_fps(inst);
+	unsigned long flags;
+
+	spin_lock_irqsave(&stats->lock, flags);
+	if (inst->count.etb == inst->count.ebd)
+		stats->busy_start = ktime_get();
+	if (inst->session_type == MSM_VIDC_DECODER) {
+		msm_dcvs_update_bitrate(inst, size, fps);
+		stats->frames++;
+	}
+	spin_unlock_irqrestore(&stats->lock, flags);
+}
+
+/*
+ * Account an input buffer returned by firmware. The time since the
+ * previous completion (or since the firmware became busy) is the time it
+ * spent on this buffer.
+ */
+void msm_dcvs_account_ebd(struct msm_vidc_inst *inst)
+{
+	struct vidc_load_stats *stats = &inst->load_stats;
+	unsigned long flags;
+	u32 fps = msm_comm_get_operating_fps(inst);
+	ktime_t now = ktime_get();
+	u32 frame_us;
+
+	spin_lock_irqsave(&stats->lock, flags);
+	if (ktime_to_ns(stats->busy_start)) {
+		frame_us = (u32)ktime_us_delta(now, stats->busy_start);
+		stats->avg_frame_us = msm_dcvs_ewma(stats->avg_frame_us,
+				frame_us, stats->frames > 1);
+		stats->fw_util = min_t(u32, 100 * 2,
+			DIV_ROUND_UP(stats->avg_frame_us * fps, 10000));
+	}
+	if (inst->session_type == MSM_VIDC_ENCODER)
+		stats->frames++;
+	stats->busy_start = now;
+	spin_unlock_irqrestore(&stats->lock, flags);
+}
+
+/* Account an output buffer, for encoders its size is the bitstream size */
+void msm_dcvs_account_fbd(struct msm_vidc_inst *inst, u32 size)
+{
+	struct vidc_load_stats *stats = &inst->load_stats;
+	unsigned long flags;
+	u32 fps;
+
+	if (inst->session_type != MSM_VIDC_ENCODER || !size)
+		return;
+
+	fps = msm_comm_get_operating_fps(inst);
+	spin_lock_irqsave(&stats->lock, flags);
+	msm_dcvs_update_bitrate(inst, size, fps);
+	spin_unlock_irqrestore(&stats->lock, flags);
+}
+
+/*
+ * Scale the resolution based @load of a session by the measured firmware
+ * utilisation, so the vote settles where the firmware is busy for
+ * DCVS_TARGET_FW_UTIL percent of each frame period. The correction is
+ * bounded to half and twice the estimate, and to the core maximum.
+ */
+int msm_dcvs_adjust_load(struct msm_vidc_inst *inst, int load)
+{
+	struct vidc_load_stats *stats = &inst->load_stats;
+	int max_load = inst->core->resources.max_load;
+	u32 util;
+
+	if (!msm_vidc_bitrate_clock_scaling || load <= 0 ||
+	    stats->frames < DCVS_MIN_LOAD_SAMPLES ||
+	    msm_comm_turbo_session(inst))
+		return load;
+
+	util = clamp_t(u32, ACCESS_ONCE(stats->fw_util),
+			DCVS_TARGET_FW_UTIL / 2, DCVS_TARGET_FW_UTIL * 2);
+
+	load = (int)div_u64((u64)load * util, DCVS_TARGET_FW_UTIL);
+
+	return max_load ? min(load, max_load) : load;
+}
+
+/*
+ * Returns true, and records the new values as voted, when the measured
+ * bitrate or utilisation moved far enough from the last vote that the
+ * clock and bus votes should be refreshed.
+ */
+bool msm_dcvs_load_changed(struct msm_vidc_inst *inst)
+{
+	struct vidc_load_stats *stats = &inst->load_stats;
+	unsigned long flags, delta;
+	bool changed = false;
+	u32 util_delta;
+
+	spin_lock_irqsave(&stats->lock, flags);
+	if (stats->frames < DCVS_MIN_LOAD_SAMPLES)
+		goto exit;
+
+	delta = abs((long)(stats->bitrate - stats->voted_bitrate));
+	util_delta = abs((int)(stats->fw_util - stats->voted_util));
+
+	if (delta > (stats->voted_bitrate >> 3) || util_delta > 10) {
+		stats->voted_bitrate = stats->bitrate;
+		stats->voted_util = stats->fw_util;
+		changed = true;
+	}
+exit:
+	spin_unlock_irqrestore(&stats->lock, flags);
+	return changed;
+}
@@ -31,6 +31,11 @@
 /* Considering one safeguard buffer */
 #define DCVS_BUFFER_SAFEGUARD (DCVS_DEC_EXTRA_OUTPUT_BUFFERS - 1)
 
+/* Firmware utilisation the measured load model aims for, in percent */
+#define DCVS_TARGET_FW_UTIL 85
+/* Frames needed before the measured load is trusted */
+#define DCVS_MIN_LOAD_SAMPLES 8
+
 void msm_dcvs_init(struct msm_vidc_inst *inst);
 void msm_dcvs_init_load(struct msm_vidc_inst *inst);
 void msm_dcvs_monitor_buffer(struct msm_vidc_inst *inst);
@@ -38,4 +43,9 @@ void msm_dcvs_check_and_scale_clocks(struct msm_vidc_inst *inst, bool is_etb);
 int  msm_dcvs_get_extra_buff_count(struct msm_vidc_inst *inst);
 void msm_dcvs_enc_set_power_save_mode(struct msm_vidc_inst *inst,
 		bool is_power_save_mode);
+void msm_dcvs_account_etb(struct msm_vidc_inst *inst, u32 size);
+void msm_dcvs_account_ebd(struct msm_vidc_inst *inst);
+void msm_dcvs_account_fbd(struct msm_vidc_inst *inst, u32 size);
+int msm_dcvs_adjust_load(struct msm_vidc_inst *inst, int load);
+bool msm_dcvs_load_changed(struct msm_vidc_inst *inst);
 #endif
@@ -408,6 +408,16 @@ static ssize_t inst_info_read(struct file *file, char __user *buf,
 	cur += write_str(cur, end - cur, "EBD Count: %d\n", inst->count.ebd);
 	cur += write_str(cur, end - cur, "FTB Count: %d\n", inst->count.ftb);
 	cur += write_str(cur, end - cur, "FBD Count: %d\n", inst->count.fbd);
+	cur += write_str(cur, end - cur, "-----------Load--------------\n");
+	cur += write_str(cur, end - cur, "bitrate: %lu bps\n",
+		inst->load_stats.bitrate);
+	cur += write_str(cur, end - cur, "avg frame size: %u bytes\n",
+		inst->load_stats.avg_frame_size);
+	cur += write_str(cur, end - cur, "avg fw frame time: %u us\n",
+		inst->load_stats.avg_frame_us);
+	cur += write_str(cur, end - cur, "fw utilisation: %u%%\n",
+		inst->load_stats.fw_util);
+	cur += write_str(cur, end - cur, "dcvs load: %d\n", inst->dcvs.load);
 
 	publish_unreleased_reference(inst, &cur, end);
 	len = simple_read_from_buffer(buf, count, ppos,
@@ -205,6 +205,24 @@ struct dcvs_stats {
 	u32 supported_codecs;
 };
 
+/*
+ * Measured per session load, feeding the clock and bus votes in addition
+ * to the resolution * frame rate estimate.
+ */
+struct vidc_load_stats {
+	spinlock_t lock;
+	/* running averages, weighted 1/8 per frame */
+	u32 avg_frame_size;	/* compressed bytes per frame */
+	u32 avg_frame_us;	/* firmware time per input buffer */
+	ktime_t busy_start;
+	u32 frames;
+	unsigned long bitrate;	/* compressed bits/sec at operating rate */
+	u32 fw_util;		/* percent of the frame period */
+	/* values at the last clock/bus vote */
+	unsigned long voted_bitrate;
+	u32 voted_util;
+};
+
 struct profile_data {
 	int start;
 	int stop;
@@ -280,6 +298,7 @@ struct msm_vidc_inst {
 	struct msm_vidc_debug debug;
 	struct buf_count count;
 	struct dcvs_stats dcvs;
+	struct vidc_load_stats load_stats;
 	enum msm_vidc_modes flags;
 	struct msm_vidc_capability capability;
 	u32 buffer_size_limit;
@@ -1635,6 +1635,12 @@ err_q_null:
 	return result;
 }
 
+static inline void __raise_cmdq_interrupt(struct venus_hfi_device *device)
+{
+	__write_register(device, VIDC_CPU_IC_SOFTINT,
+			1 << VIDC_CPU_IC_SOFTINT_H2A_SHFT);
+}
+
 static int __iface_cmdq_write(struct venus_hfi_device *device, void *pkt)
 {
 	bool needs_interrupt = false;
@@ -1643,14 +1649,19 @@ static int __iface_cmdq_write(struct venus_hfi_device *device, void *pkt)
 	if (!rc && needs_interrupt) {
 		/* Consumer of cmdq prefers that we raise an interrupt */
 		rc = 0;
-		__write_register(device, VIDC_CPU_IC_SOFTINT,
-				1 << VIDC_CPU_IC_SOFTINT_H2A_SHFT);
+		__raise_cmdq_interrupt(device);
 	}
 
 	return rc;
 }
 
-static int __iface_msgq_read(struct venus_hfi_device *device, void *pkt)
+/*
+ * Reads a packet from the msgq.  If the firmware is waiting for room in the
+ * queue, *requires_interrupt is set and it's up to the caller to raise the
+ * interrupt once it's done draining the queue.
+ */
+static int __iface_msgq_read(struct venus_hfi_device *device, void *pkt,
+		bool *requires_interrupt)
 {
 	u32 tx_req_is_set = 0;
 	int rc = 0;
@@ -1680,8 +1691,7 @@ static int __iface_msgq_read(struct venus_hfi_device *device, void *pkt)
 	if (!__read_queue(q_info, (u8 *)pkt, &tx_req_is_set)) {
 		__hal_sim_modify_msg_packet((u8 *)pkt, device);
 		if (tx_req_is_set)
-			__write_register(device, VIDC_CPU_IC_SOFTINT,
-				1 << VIDC_CPU_IC_SOFTINT_H2A_SHFT);
+			*requires_interrupt = true;
 		rc = 0;
 	} else
 		rc = -ENODATA;
@@ -2849,8 +2859,28 @@ static int venus_hfi_session_stop(void *session)
 	return rc;
 }
 
+/*
+ * Writes `pkt` to the cmdq.  If `requires_interrupt` is NULL the firmware
+ * is interrupted right away if it asks for it, otherwise the request is
+ * accumulated into *requires_interrupt for the caller to act on.
+ */
+static int __session_cmdq_write(struct hal_session *session, void *pkt,
+		bool *requires_interrupt)
+{
+	bool needs_interrupt = false;
+	int rc = 0;
+
+	if (!requires_interrupt)
+		return __iface_cmdq_write(session->device, pkt);
+
+	rc = __iface_cmdq_write_relaxed(session->device, pkt,
+			&needs_interrupt);
+	*requires_interrupt |= needs_interrupt;
+	return rc;
+}
+
 static int __session_etb(struct hal_session *session,
-		struct vidc_frame_data *input_frame, bool relaxed)
+		struct vidc_frame_data *input_frame, bool *requires_interrupt)
 {
 	int rc = 0;
 	struct venus_hfi_device *device = session->device;
@@ -2866,11 +2896,7 @@ static int __session_etb(struct hal_session *session,
 			goto err_create_pkt;
 		}
 
-		if (!relaxed)
-			rc = __iface_cmdq_write(session->device, &pkt);
-		else
-			rc = __iface_cmdq_write_relaxed(session->device,
-					&pkt, NULL);
+		rc = __session_cmdq_write(session, &pkt, requires_interrupt);
 		if (rc)
 			goto err_create_pkt;
 	} else {
@@ -2885,11 +2911,7 @@ static int __session_etb(struct hal_session *session,
 			goto err_create_pkt;
 		}
 
-		if (!relaxed)
-			rc = __iface_cmdq_write(session->device, &pkt);
-		else
-			rc = __iface_cmdq_write_relaxed(session->device,
-					&pkt, NULL);
+		rc = __session_cmdq_write(session, &pkt, requires_interrupt);
 		if (rc)
 			goto err_create_pkt;
 	}
@@ -2912,13 +2934,13 @@ static int venus_hfi_session_etb(void *sess,
 
 	device = session->device;
 	mutex_lock(&device->lock);
-	rc = __session_etb(session, input_frame, false);
+	rc = __session_etb(session, input_frame, NULL);
 	mutex_unlock(&device->lock);
 	return rc;
 }
 
 static int __session_ftb(struct hal_session *session,
-		struct vidc_frame_data *output_frame, bool relaxed)
+		struct vidc_frame_data *output_frame, bool *requires_interrupt)
 {
 	int rc = 0;
 	struct venus_hfi_device *device = session->device;
@@ -2931,11 +2953,7 @@ static int __session_ftb(struct hal_session *session,
 		goto err_create_pkt;
 	}
 
-	if (!relaxed)
-		rc = __iface_cmdq_write(session->device, &pkt);
-	else
-		rc = __iface_cmdq_write_relaxed(session->device,
-				&pkt, NULL);
+	rc = __session_cmdq_write(session, &pkt, requires_interrupt);
 
 err_create_pkt:
 	return rc;
@@ -2955,7 +2973,7 @@ static int venus_hfi_session_ftb(void *sess,
 
 	device = session->device;
 	mutex_lock(&device->lock);
-	rc = __session_ftb(session, output_frame, false);
+	rc = __session_ftb(session, output_frame, NULL);
 	mutex_unlock(&device->lock);
 	return rc;
 }
@@ -2968,6 +2986,8 @@ static int venus_hfi_session_process_batch(void *sess,
 	struct hal_session *session = sess;
 	struct venus_hfi_device *device;
 	struct hfi_cmd_session_sync_process_packet pkt;
+	/* The sync packet below takes care of interrupting the firmware */
+	bool requires_interrupt = false;
 
 	if (!session || !session->device) {
 		dprintk(VIDC_ERR, "%s: Invalid Params\n", __func__);
@@ -2978,7 +2998,7 @@ static int venus_hfi_session_process_batch(void *sess,
 
 	mutex_lock(&device->lock);
 	for (c = 0; c < num_ftbs; ++c) {
-		rc = __session_ftb(session, &ftbs[c], true);
+		rc = __session_ftb(session, &ftbs[c], &requires_interrupt);
 		if (rc) {
 			dprintk(VIDC_ERR, "Failed to queue batched ftb: %d\n",
 					rc);
@@ -2987,7 +3007,7 @@ static int venus_hfi_session_process_batch(void *sess,
 	}
 
 	for (c = 0; c < num_etbs; ++c) {
-		rc = __session_etb(session, &etbs[c], true);
+		rc = __session_etb(session, &etbs[c], &requires_interrupt);
 		if (rc) {
 			dprintk(VIDC_ERR, "Failed to queue batched etb: %d\n",
 					rc);
@@ -3009,6 +3029,53 @@ err_etbs_and_ftbs:
 	return rc;
 }
 
+/*
+ * Queues a set of ETBs and FTBs back to back, interrupting the firmware at
+ * most once for the lot.  Unlike venus_hfi_session_process_batch() this
+ * doesn't require the session to be in batched mode.
+ */
+static int venus_hfi_session_process_buffers(void *sess,
+		int num_etbs, struct vidc_frame_data etbs[],
+		int num_ftbs, struct vidc_frame_data ftbs[])
+{
+	int rc = 0, c = 0;
+	struct hal_session *session = sess;
+	struct venus_hfi_device *device;
+	bool requires_interrupt = false;
+
+	if (!session || !session->device) {
+		dprintk(VIDC_ERR, "%s: Invalid Params\n", __func__);
+		return -EINVAL;
+	}
+
+	device = session->device;
+
+	mutex_lock(&device->lock);
+	for (c = 0; c < num_etbs; ++c) {
+		rc = __session_etb(session, &etbs[c], &requires_interrupt);
+		if (rc) {
+			dprintk(VIDC_ERR, "Failed to queue etb: %d\n", rc);
+			goto err_etbs_and_ftbs;
+		}
+	}
+
+	for (c = 0; c < num_ftbs; ++c) {
+		rc = __session_ftb(session, &ftbs[c], &requires_interrupt);
+		if (rc) {
+			dprintk(VIDC_ERR, "Failed to queue ftb: %d\n", rc);
+			goto err_etbs_and_ftbs;
+		}
+	}
+
+err_etbs_and_ftbs:
+	/* Whatever made it into the cmdq still needs to be kicked off */
+	if (requires_interrupt)
+		__raise_cmdq_interrupt(device);
+
+	mutex_unlock(&device->lock);
+	return rc;
+}
+
 static int venus_hfi_session_parse_seq_hdr(void *sess,
 					struct vidc_seq_hdr *seq_hdr)
 {
@@ -3423,7 +3490,7 @@ static int __response_handler(struct venus_hfi_device *device)
 	struct msm_vidc_cb_info *packets;
 	int packet_count = 0;
 	u8 *raw_packet = NULL;
-	bool requeue_pm_work = true;
+	bool requeue_pm_work = true, requires_interrupt = false;
 
 	if (!device || device->state != VENUS_STATE_INIT)
 		return 0;
@@ -3462,7 +3529,7 @@ static int __response_handler(struct venus_hfi_device *device)
 	}
 
 	/* Bleed the msg queue dry of packets */
-	while (!__iface_msgq_read(device, raw_packet)) {
+	while (!__iface_msgq_read(device, raw_packet, &requires_interrupt)) {
 		void **session_id = NULL;
 		struct msm_vidc_cb_info *info = &packets[packet_count++];
 		struct vidc_hal_sys_init_done sys_init_done = {0};
@@ -3587,6 +3654,13 @@ static int __response_handler(struct venus_hfi_device *device)
 		}
 	}
 
+	/*
+	 * Let the firmware know about the room we made in the msgq once,
+	 * rather than after every packet we pulled out of it.
+	 */
+	if (requires_interrupt)
+		__raise_cmdq_interrupt(device);
+
 	if (requeue_pm_work && device->res->sw_power_collapsible) {
 		cancel_delayed_work(&venus_hfi_pm_work);
 		if (!queue_delayed_work(device->venus_pm_workq,
@@ -4729,6 +4803,7 @@ static void venus_init_hfi_callbacks(struct hfi_device *hdev)
 	hdev->session_etb = venus_hfi_session_etb;
 	hdev->session_ftb = venus_hfi_session_ftb;
 	hdev->session_process_batch = venus_hfi_session_process_batch;
+	hdev->session_process_buffers = venus_hfi_session_process_buffers;
 	hdev->session_parse_seq_hdr = venus_hfi_session_parse_seq_hdr;
 	hdev->session_get_seq_hdr = venus_hfi_session_get_seq_hdr;
 	hdev->session_get_buf_req = venus_hfi_session_get_buf_req;
@@ -1442,6 +1442,7 @@ struct vidc_bus_vote_data {
 	enum hal_uncompressed_format color_formats[2];
 	int num_formats; /* 1 = DPB-OPB unified; 2 = split */
 	int height, width, fps;
+	unsigned long bitrate; /* measured, bits/sec, 0 if unknown */
 	enum msm_vidc_power_mode power_mode;
 	struct imem_ab_table *imem_ab_tbl;
 	u32 imem_ab_tbl_size;
@@ -1502,6 +1503,9 @@ struct hfi_device {
 	int (*session_process_batch)(void *sess,
 		int num_etbs, struct vidc_frame_data etbs[],
 		int num_ftbs, struct vidc_frame_data ftbs[]);
+	int (*session_process_buffers)(void *sess,
+		int num_etbs, struct vidc_frame_data etbs[],
+		int num_ftbs, struct vidc_frame_data ftbs[]);
 	int (*session_parse_seq_hdr)(void *sess,
 			struct vidc_seq_hdr *seq_hdr);
 	int (*session_get_seq_hdr)(void *sess,
@@ -302,6 +302,8 @@ struct qseecom_client_handle {
 	char app_name[MAX_APP_NAME_SIZE];
 	u32  app_arch;
 	struct qseecom_sec_buf_fd_info sec_buf_fd[MAX_ION_FD];
+	/* Overflow sg list buffers, kept across commands until release */
+	struct qseecom_sec_buf_fd_info sg_list_buf[MAX_ION_FD];
 };
 
 struct qseecom_listener_handle {
@@ -3049,11 +3051,30 @@ int __qseecom_process_reentrancy(struct qseecom_command_scm_resp *resp,
 	}
 }
 
+/*
+ * Clean or invalidate only the part of the client shared buffer that the
+ * request and response occupy. Both have been checked to lie within the
+ * shared buffer by __validate_send_cmd_inputs().
+ */
+static int __qseecom_sb_cache_op(struct qseecom_dev_handle *data,
+				struct qseecom_send_cmd_req *req,
+				unsigned int cmd)
+{
+	uintptr_t start, end;
+
+	start = min((uintptr_t)req->cmd_req_buf, (uintptr_t)req->resp_buf);
+	end = max((uintptr_t)req->cmd_req_buf + req->cmd_req_len,
+		  (uintptr_t)req->resp_buf + req->resp_len);
+
+	return msm_ion_do_cache_op(qseecom.ion_clnt, data->client.ihandle,
+			(void *)__qseecom_uvirt_to_kvirt(data, start),
+			end - start, cmd);
+}
+
 static int __qseecom_send_cmd(struct qseecom_dev_handle *data,
 				struct qseecom_send_cmd_req *req)
 {
 	int ret = 0;
-	u32 reqd_len_sb_in = 0;
 	struct qseecom_client_send_data_ireq send_data_req = {0};
 	struct qseecom_client_send_data_64bit_ireq send_data_req_64bit = {0};
 	struct qseecom_command_scm_resp resp;
@@ -3064,7 +3085,6 @@ static int __qseecom_send_cmd(struct qseecom_dev_handle *data,
 	size_t cmd_len;
 	struct sglist_info *table = data->sglistinfo_ptr;
 
-	reqd_len_sb_in = req->cmd_req_len + req->resp_len;
 	/* find app_id & img_name from list */
 	spin_lock_irqsave(&qseecom.registered_app_list_lock, flags);
 	list_for_each_entry(ptr_app, &qseecom.registered_app_list_head,
@@ -3139,10 +3159,7 @@ static int __qseecom_send_cmd(struct qseecom_dev_handle *data,
 	else
 		*(uint32_t *)cmd_buf = QSEOS_CLIENT_SEND_DATA_COMMAND_WHITELIST;
 
-	ret = msm_ion_do_cache_op(qseecom.ion_clnt, data->client.ihandle,
-					data->client.sb_virt,
-					reqd_len_sb_in,
-					ION_IOC_CLEAN_INV_CACHES);
+	ret = __qseecom_sb_cache_op(data, req, ION_IOC_CLEAN_INV_CACHES);
 	if (ret) {
 		pr_err("cache operation failed %d\n", ret);
 		return ret;
@@ -3177,9 +3194,7 @@ static int __qseecom_send_cmd(struct qseecom_dev_handle *data,
 			}
 		}
 	}
-	ret = msm_ion_do_cache_op(qseecom.ion_clnt, data->client.ihandle,
-				data->client.sb_virt, data->client.sb_length,
-				ION_IOC_INV_CACHES);
+	ret = __qseecom_sb_cache_op(data, req, ION_IOC_INV_CACHES);
 	if (ret)
 		pr_err("cache operation failed %d\n", ret);
 	return ret;
@@ -3455,10 +3470,9 @@ static int __qseecom_allocate_sg_list_buffer(struct qseecom_dev_handle *data,
 	struct scatterlist *sg = sg_ptr->sgl;
 	struct qseecom_sg_entry_64bit *sg_entry;
 	struct qseecom_sg_list_buf_hdr_64bit *buf_hdr;
-	void *buf;
+	struct qseecom_sec_buf_fd_info *sg_buf;
 	uint i;
 	size_t size;
-	dma_addr_t coh_pmem;
 
 	if (fd_idx >= MAX_ION_FD) {
 		pr_err("fd_idx [%d] is invalid\n", fd_idx);
@@ -3466,21 +3480,35 @@ static int __qseecom_allocate_sg_list_buffer(struct qseecom_dev_handle *data,
 	}
 	buf_hdr = (struct qseecom_sg_list_buf_hdr_64bit *)field;
 	memset((void *)buf_hdr, 0, QSEECOM_SG_LIST_BUF_HDR_SZ_64BIT);
-	/* Allocate a contiguous kernel buffer */
 	size = sg_ptr->nents * SG_ENTRY_SZ_64BIT;
 	size = (size + PAGE_SIZE) & PAGE_MASK;
-	buf = dma_alloc_coherent(qseecom.pdev,
-			size, &coh_pmem, GFP_KERNEL);
-	if (buf == NULL) {
-		pr_err("failed to alloc memory for sg buf\n");
-		return -ENOMEM;
+	/*
+	 * Reuse the buffer left by an earlier command on this fd slot if it
+	 * is large enough, otherwise replace it with a bigger one.
+	 */
+	sg_buf = &data->client.sg_list_buf[fd_idx];
+	if (sg_buf->vbase && sg_buf->size < size) {
+		dma_free_coherent(qseecom.pdev, sg_buf->size,
+				sg_buf->vbase, sg_buf->pbase);
+		memset(sg_buf, 0, sizeof(*sg_buf));
+	}
+	if (!sg_buf->vbase) {
+		/* Allocate a contiguous kernel buffer */
+		sg_buf->vbase = dma_alloc_coherent(qseecom.pdev,
+				size, &sg_buf->pbase, GFP_KERNEL);
+		if (sg_buf->vbase == NULL) {
+			pr_err("failed to alloc memory for sg buf\n");
+			return -ENOMEM;
+		}
+		sg_buf->is_sec_buf_fd = true;
+		sg_buf->size = size;
 	}
 	/* update qseecom_sg_list_buf_hdr_64bit */
 	buf_hdr->version = QSEECOM_SG_LIST_BUF_FORMAT_VERSION_2;
-	buf_hdr->new_buf_phys_addr = coh_pmem;
+	buf_hdr->new_buf_phys_addr = sg_buf->pbase;
 	buf_hdr->nents_total = sg_ptr->nents;
 	/* save the left sg entries into new allocated buf */
-	sg_entry = (struct qseecom_sg_entry_64bit *)buf;
+	sg_entry = (struct qseecom_sg_entry_64bit *)sg_buf->vbase;
 	for (i = 0; i < sg_ptr->nents; i++) {
 		sg_entry->phys_addr = (uint64_t)sg_dma_address(sg);
 		sg_entry->len = sg->length;
@@ -3488,14 +3516,23 @@ static int __qseecom_allocate_sg_list_buffer(struct qseecom_dev_handle *data,
 		sg = sg_next(sg);
 	}
 
-	data->client.sec_buf_fd[fd_idx].is_sec_buf_fd = true;
-	data->client.sec_buf_fd[fd_idx].vbase = buf;
-	data->client.sec_buf_fd[fd_idx].pbase = coh_pmem;
-	data->client.sec_buf_fd[fd_idx].size = size;
-
 	return 0;
 }
 
+static void __qseecom_free_sg_list_buffers(struct qseecom_dev_handle *data)
+{
+	struct qseecom_sec_buf_fd_info *sg_buf;
+	int i;
+
+	for (i = 0; i < MAX_ION_FD; i++) {
+		sg_buf = &data->client.sg_list_buf[i];
+		if (sg_buf->vbase)
+			dma_free_coherent(qseecom.pdev, sg_buf->size,
+					sg_buf->vbase, sg_buf->pbase);
+		memset(sg_buf, 0, sizeof(*sg_buf));
+	}
+}
+
 static int __qseecom_update_cmd_buf_64(void *msg, bool cleanup,
 			struct qseecom_dev_handle *data)
 {
@@ -3568,14 +3605,7 @@ static int __qseecom_update_cmd_buf_64(void *msg, bool cleanup,
 			pr_warn("Num of scattered entries");
 			pr_warn(" (%d) is greater than %d\n",
 				sg_ptr->nents, QSEECOM_MAX_SG_ENTRY);
-			if (cleanup) {
-				if (data->client.sec_buf_fd[i].is_sec_buf_fd &&
-					data->client.sec_buf_fd[i].vbase)
-					dma_free_coherent(qseecom.pdev,
-					data->client.sec_buf_fd[i].size,
-					data->client.sec_buf_fd[i].vbase,
-					data->client.sec_buf_fd[i].pbase);
-			} else {
+			if (!cleanup) {
 				ret = __qseecom_allocate_sg_list_buffer(data,
 						field, i, sg_ptr);
 				if (ret) {
@@ -3682,13 +3712,6 @@ cleanup:
 	}
 	return ret;
 err:
-	for (i = 0; i < MAX_ION_FD; i++)
-		if (data->client.sec_buf_fd[i].is_sec_buf_fd &&
-			data->client.sec_buf_fd[i].vbase)
-			dma_free_coherent(qseecom.pdev,
-				data->client.sec_buf_fd[i].size,
-				data->client.sec_buf_fd[i].vbase,
-				data->client.sec_buf_fd[i].pbase);
 	if (!IS_ERR_OR_NULL(ihandle))
 		ion_free(qseecom.ion_clnt, ihandle);
 	return -ENOMEM;
@@ -7582,6 +7605,7 @@ static int qseecom_release(struct inode *inode, struct file *file)
 		if (data->perf_enabled == true)
 			qsee_disable_clock_vote(data, CLK_DFAB);
 	}
+	__qseecom_free_sg_list_buffers(data);
 	kfree(data);
 
 	return ret;
@@ -146,6 +146,8 @@ struct mmc_blk_data {
 	struct device_attribute power_ro_lock;
 	struct device_attribute num_wr_reqs_to_start_packing;
 	struct device_attribute no_pack_for_random;
+	struct device_attribute cmdq_async_write_limit;
+	struct device_attribute cmdq_discard_max_delay;
 	int	area_type;
 };
 
@@ -207,6 +209,8 @@ static void mmc_blk_put(struct mmc_blk_data *md)
 	if (md->usage == 0) {
 		int devidx = mmc_get_devidx(md->disk);
 		blk_cleanup_queue(md->queue.queue);
+		if (md->queue.tag_set.tags)
+			blk_mq_free_tag_set(&md->queue.tag_set);
 
 		__clear_bit(devidx, dev_use);
 
@@ -440,6 +444,113 @@ exit:
 	return ret;
 }
 
+static ssize_t
+cmdq_async_write_limit_show(struct device *dev,
+			    struct device_attribute *attr, char *buf)
+{
+	struct mmc_blk_data *md = mmc_blk_get(dev_to_disk(dev));
+	int ret;
+
+	if (!md)
+		return -EINVAL;
+	ret = snprintf(buf, PAGE_SIZE, "%d\n", md->queue.cmdq_async_wr_pct);
+
+	mmc_blk_put(md);
+	return ret;
+}
+
+static ssize_t
+cmdq_async_write_limit_store(struct device *dev,
+			     struct device_attribute *attr,
+			     const char *buf, size_t count)
+{
+	int value;
+	struct mmc_blk_data *md = mmc_blk_get(dev_to_disk(dev));
+	struct mmc_card *card;
+	int ret = count;
+
+	if (!md)
+		return -EINVAL;
+
+	card = md->queue.card;
+	if (!card) {
+		ret = -EINVAL;
+		goto exit;
+	}
+
+	if (kstrtoint(buf, 0, &value) || value < 1 || value > 100) {
+		pr_err("%s: value is not valid. old value remains = %d",
+			mmc_hostname(card->host),
+			md->queue.cmdq_async_wr_pct);
+		ret = -EINVAL;
+		goto exit;
+	}
+
+	md->queue.cmdq_async_wr_pct = value;
+
+	pr_debug("%s: cmdq_async_write_limit: new value = %d",
+		mmc_hostname(card->host),
+		md->queue.cmdq_async_wr_pct);
+
+exit:
+	mmc_blk_put(md);
+	return ret;
+}
+
+static ssize_t
+cmdq_discard_max_delay_show(struct device *dev,
+			    struct device_attribute *attr, char *buf)
+{
+	struct mmc_blk_data *md = mmc_blk_get(dev_to_disk(dev));
+	int ret;
+
+	if (!md)
+		return -EINVAL;
+	ret = snprintf(buf, PAGE_SIZE, "%u\n",
+		       md->queue.cmdq_discard_max_delay_ms);
+
+	mmc_blk_put(md);
+	return ret;
+}
+
+static ssize_t
+cmdq_discard_max_delay_store(struct device *dev,
+			     struct device_attribute *attr,
+			     const char *buf, size_t count)
+{
+	unsigned int value;
+	struct mmc_blk_data *md = mmc_blk_get(dev_to_disk(dev));
+	struct mmc_card *card;
+	int ret = count;
+
+	if (!md)
+		return -EINVAL;
+
+	card = md->queue.card;
+	if (!card) {
+		ret = -EINVAL;
+		goto exit;
+	}
+
+	if (kstrtouint(buf, 0, &value)) {
+		pr_err("%s: value is not valid. old value remains = %u",
+			mmc_hostname(card->host),
+			md->queue.cmdq_discard_max_delay_ms);
+		ret = -EINVAL;
+		goto exit;
+	}
+
+	md->queue.cmdq_discard_max_delay_ms = value;
+
+	pr_debug("%s: cmdq_discard_max_delay: new value = %u",
+		mmc_hostname(card->host),
+		md->queue.cmdq_discard_max_delay_ms);
+
+exit:
+	mmc_blk_put(md);
+	return ret;
+}
+
 static int mmc_blk_open(struct block_device *bdev, fmode_t mode)
 {
 	struct mmc_blk_data *md = mmc_blk_get(bdev->bd_disk);
@@ -1529,16 +1640,16 @@ static int mmc_blk_cmdq_issue_discard_rq(struct mmc_queue *mq,
 	struct mmc_card *card = md->queue.card;
 	struct mmc_cmdq_req *cmdq_req = NULL;
 	unsigned int from, nr, arg;
+	LIST_HEAD(merged);
 	int err = 0;
 
 	if (!mmc_can_erase(card)) {
 		err = -EOPNOTSUPP;
-		blk_end_request(req, err, blk_rq_bytes(req));
+		mmc_cmdq_end_request(req, err, blk_rq_bytes(req));
 		goto out;
 	}
 
-	from = blk_rq_pos(req);
-	nr = blk_rq_sectors(req);
+	nr = mmc_cmdq_merge_discards(mq, req, &from, &merged);
 
 	if (mmc_can_discard(card))
 		arg = MMC_DISCARD_ARG;
@@ -1562,8 +1673,9 @@ static int mmc_blk_cmdq_issue_discard_rq(struct mmc_queue *mq,
 	}
 	err = mmc_cmdq_erase(cmdq_req, card, from, nr, arg);
 clear_dcmd:
+	mmc_cmdq_end_merged_discards(mq, &merged, err);
 	mmc_host_clk_hold(card->host);
-	blk_complete_request(req);
+	mmc_cmdq_complete_request(req);
 out:
 	return err ? 1 : 0;
 }
@@ -1622,7 +1734,7 @@ static int mmc_blk_cmdq_issue_secdiscard_rq(struct mmc_queue *mq,
 
 	if (!(mmc_can_secure_erase_trim(card))) {
 		err = -EOPNOTSUPP;
-		blk_end_request(req, err, blk_rq_bytes(req));
+		mmc_cmdq_end_request(req, err, blk_rq_bytes(req));
 		goto out;
 	}
 
@@ -1669,7 +1781,7 @@ static int mmc_blk_cmdq_issue_secdiscard_rq(struct mmc_queue *mq,
 	}
 clear_dcmd:
 	mmc_host_clk_hold(card->host);
-	blk_complete_request(req);
+	mmc_cmdq_complete_request(req);
 out:
 	return err ? 1 : 0;
 }
@@ -2736,7 +2848,8 @@ static struct mmc_cmdq_req *mmc_blk_cmdq_rw_prep(
 	bool do_rel_wr = mmc_req_rel_wr(req) && (md->flags & MMC_BLK_REL_WR);
 	bool do_data_tag;
 	bool read_dir = (rq_data_dir(req) == READ);
-	bool prio = IS_RT_CLASS_REQ(req);
+	/* sync reads are what the user is waiting on, let them jump ahead */
+	bool prio = IS_RT_CLASS_REQ(req) || (read_dir && rq_is_sync(req));
 	struct mmc_cmdq_req *cmdq_rq = &mqrq->cmdq_req;
 
 	memset(&mqrq->cmdq_req, 0, sizeof(struct mmc_cmdq_req));
@@ -2827,6 +2940,11 @@ static int mmc_blk_cmdq_issue_rw_rq(struct mmc_queue *mq, struct request *req)
 	active_mqrq = &mq->mqrq_cmdq[req->tag];
 	active_mqrq->req = req;
 
+	if (mmc_cmdq_async_write(req))
+		set_bit(req->tag, &mq->cmdq_async_wr_tags);
+	else
+		clear_bit(req->tag, &mq->cmdq_async_wr_tags);
+
 	mc_rq = mmc_blk_cmdq_rw_prep(active_mqrq, mq);
 
 	if (card->quirks & MMC_QUIRK_CMDQ_EMPTY_BEFORE_DCMD) {
@@ -2949,7 +3067,7 @@ static bool is_cmdq_dcmd_req(struct request_queue *q, int tag)
 	struct mmc_queue_req *mq_rq;
 	struct mmc_cmdq_req *cmdq_req;
 
-	req = blk_queue_find_tag(q, tag);
+	req = mmc_cmdq_tag_to_rq(q->queuedata, tag);
 	if (WARN_ON(!req))
 		goto out;
 	mq_rq = req->special;
@@ -2977,6 +3095,7 @@ static void mmc_blk_cmdq_reset_all(struct mmc_host *host, int err)
 	struct mmc_card *card = host->card;
 	struct mmc_cmdq_context_info *ctx_info = &host->cmdq_ctx;
 	struct request_queue *q;
+	unsigned long active_reqs;
 	int itag = 0;
 	int ret = 0;
 
@@ -2990,6 +3109,7 @@ static void mmc_blk_cmdq_reset_all(struct mmc_host *host, int err)
 			mmc_hostname(host), __func__,
 			ctx_info->active_reqs, host->clk_requests);
 
+	active_reqs = ctx_info->active_reqs;
 	for_each_set_bit(itag, &ctx_info->active_reqs,
 			host->num_cq_slots) {
 		ret = is_cmdq_dcmd_req(q, itag);
@@ -3009,9 +3129,7 @@ static void mmc_blk_cmdq_reset_all(struct mmc_host *host, int err)
 		mmc_put_card(card);
 	}
 
-	spin_lock_irq(q->queue_lock);
-	blk_queue_invalidate_tags(q);
-	spin_unlock_irq(q->queue_lock);
+	mmc_cmdq_invalidate_tags(q->queuedata, active_reqs);
 }
 
 static void mmc_blk_cmdq_shutdown(struct mmc_queue *mq)
@@ -3206,12 +3324,12 @@ static void mmc_blk_cmdq_remove_task(struct mmc_host *host,
 	if (mrq->cmdq_req->cmdq_req_flags & DCMD) {
 		clear_bit(CMDQ_STATE_DCMD_ACTIVE,
 				&ctx_info->curr_state);
-		blk_end_request_all(rq, err);
+		mmc_cmdq_end_request(rq, err, blk_rq_bytes(rq));
 	} else {
 		WARN_ON(!test_and_clear_bit(mrq->cmdq_req->tag,
 					&ctx_info->data_active_reqs));
 		mmc_cmdq_post_req(host, mrq->cmdq_req->tag, err);
-		blk_end_request_all(rq, err);
+		mmc_cmdq_end_request(rq, err, blk_rq_bytes(rq));
 	}
 	mmc_host_clk_release(host);
 	mmc_put_card(host->card);
@@ -3442,11 +3560,11 @@ void mmc_blk_cmdq_complete_rq(struct request *rq)
 		mmc_cmdq_post_req(host, cmdq_req->tag, err);
 	if (cmdq_req->cmdq_req_flags & DCMD) {
 		clear_bit(CMDQ_STATE_DCMD_ACTIVE, &ctx_info->curr_state);
-		blk_end_request_all(rq, err);
+		mmc_cmdq_end_request(rq, err, blk_rq_bytes(rq));
 		goto out;
 	}
 
-	blk_end_request(rq, err, cmdq_req->data.bytes_xfered);
+	mmc_cmdq_end_request(rq, err, cmdq_req->data.bytes_xfered);
 
 out:
 
@@ -3460,7 +3578,8 @@ out:
 	if (!ctx_info->active_reqs)
 		wake_up_interruptible(&host->cmdq_ctx.queue_empty_wq);
 
-	if (blk_queue_stopped(mq->queue) && !ctx_info->active_reqs)
+	if ((mq->queue->mq_ops ? blk_queue_dying(mq->queue) :
+	     blk_queue_stopped(mq->queue)) && !ctx_info->active_reqs)
 		complete(&mq->cmdq_shutdown_complete);
 
 	return;
@@ -3474,7 +3593,7 @@ void mmc_blk_cmdq_req_done(struct mmc_request *mrq)
 {
 	struct request *req = mrq->req;
 
-	blk_complete_request(req);
+	mmc_cmdq_complete_request(req);
 }
 EXPORT_SYMBOL(mmc_blk_cmdq_req_done);
 
@@ -3741,6 +3860,21 @@ out:
 	return ret;
 }
 
+static void mmc_blk_clk_scaling_hint(struct mmc_host *host,
+				     struct request *req)
+{
+	unsigned int cmd_flags = req->cmd_flags;
+
+	if (cmd_flags & REQ_DISCARD)
+		return;
+
+	if ((cmd_flags & (REQ_FLUSH | REQ_BARRIER | REQ_FUA)) ||
+	    (rq_data_dir(req) == READ && !(cmd_flags & REQ_RAHEAD)))
+		mmc_clk_scaling_hint(host, MMC_CLK_SCALING_HINT_SYNC);
+	else if (rq_data_dir(req) == WRITE && !(cmd_flags & REQ_SYNC))
+		mmc_clk_scaling_hint(host, MMC_CLK_SCALING_HINT_ASYNC_WRITE);
+}
+
 static int mmc_blk_cmdq_issue_rq(struct mmc_queue *mq, struct request *req)
 {
 	int ret, err = 0;
@@ -3788,6 +3922,8 @@ static int mmc_blk_cmdq_issue_rq(struct mmc_queue *mq, struct request *req)
 		struct mmc_host *host = card->host;
 		struct mmc_cmdq_context_info *ctx = &host->cmdq_ctx;
 
+		mmc_blk_clk_scaling_hint(host, req);
+
 		if ((cmd_flags & (REQ_FLUSH | REQ_DISCARD)) &&
 		    (card->quirks & MMC_QUIRK_CMDQ_EMPTY_BEFORE_DCMD) &&
 		    ctx->active_small_sector_read_reqs) {
@@ -3828,7 +3964,7 @@ static int mmc_blk_cmdq_issue_rq(struct mmc_queue *mq, struct request *req)
 
 out:
 	if (req)
-		blk_end_request_all(req, ret);
+		mmc_cmdq_end_request(req, ret, blk_rq_bytes(req));
 	mmc_put_card(card);
 
 	return ret;
@@ -3875,6 +4011,8 @@ static int mmc_blk_issue_rq(struct mmc_queue *mq, struct request *req)
 	}
 
 	mmc_blk_write_packing_control(mq, req);
+	if (req)
+		mmc_blk_clk_scaling_hint(host, req);
 
 	clear_bit(MMC_QUEUE_NEW_REQUEST, &mq->flags);
 	if (cmd_flags & REQ_DISCARD) {
@@ -4150,8 +4288,13 @@ static void mmc_blk_remove_req(struct mmc_blk_data *md)
 		mmc_cleanup_queue(&md->queue);
 		if (md->flags & MMC_BLK_PACKED_CMD)
 			mmc_packed_clean(&md->queue);
-		if (md->flags & MMC_BLK_CMD_QUEUE)
+		if (md->flags & MMC_BLK_CMD_QUEUE) {
 			mmc_cmdq_clean(&md->queue, card);
+			device_remove_file(disk_to_dev(md->disk),
+					   &md->cmdq_discard_max_delay);
+			device_remove_file(disk_to_dev(md->disk),
+					   &md->cmdq_async_write_limit);
+		}
 		device_remove_file(disk_to_dev(md->disk),
 				   &md->num_wr_reqs_to_start_packing);
 		if (md->disk->flags & GENHD_FL_UP) {
@@ -4240,8 +4383,35 @@ static int mmc_add_disk(struct mmc_blk_data *md)
 	if (ret)
 		goto no_pack_for_random_fails;
 
+	if (md->flags & MMC_BLK_CMD_QUEUE) {
+		md->cmdq_async_write_limit.show = cmdq_async_write_limit_show;
+		md->cmdq_async_write_limit.store = cmdq_async_write_limit_store;
+		sysfs_attr_init(&md->cmdq_async_write_limit.attr);
+		md->cmdq_async_write_limit.attr.name = "cmdq_async_write_limit";
+		md->cmdq_async_write_limit.attr.mode = S_IRUGO | S_IWUSR;
+		ret = device_create_file(disk_to_dev(md->disk),
+					 &md->cmdq_async_write_limit);
+		if (ret)
+			goto cmdq_async_write_limit_fail;
+
+		md->cmdq_discard_max_delay.show = cmdq_discard_max_delay_show;
+		md->cmdq_discard_max_delay.store = cmdq_discard_max_delay_store;
+		sysfs_attr_init(&md->cmdq_discard_max_delay.attr);
+		md->cmdq_discard_max_delay.attr.name = "cmdq_discard_max_delay";
+		md->cmdq_discard_max_delay.attr.mode = S_IRUGO | S_IWUSR;
+		ret = device_create_file(disk_to_dev(md->disk),
+					 &md->cmdq_discard_max_delay);
+		if (ret)
+			goto cmdq_discard_max_delay_fail;
+	}
+
 	return ret;
 
+cmdq_discard_max_delay_fail:
+	device_remove_file(disk_to_dev(md->disk),
+			   &md->cmdq_async_write_limit);
+cmdq_async_write_limit_fail:
+	device_remove_file(disk_to_dev(md->disk), &md->no_pack_for_random);
 no_pack_for_random_fails:
 	device_remove_file(disk_to_dev(md->disk),
 			   &md->num_wr_reqs_to_start_packing);
@@ -18,6 +18,7 @@
 #include <linux/dma-mapping.h>
 #include <linux/bitops.h>
 #include <linux/delay.h>
+#include <linux/blktrace_api.h>
 
 #include <linux/mmc/card.h>
 #include <linux/mmc/host.h>
@@ -33,6 +34,18 @@
  */
 #define DEFAULT_NUM_REQS_TO_START_PACK 17
 
+/*
+ * Share of the CMDQ task slots that async writes may occupy. The rest is
+ * kept for sync reads so that they don't queue behind background writes.
+ */
+#define DEFAULT_CMDQ_ASYNC_WR_PCT 75
+
+/*
+ * Discards are issued once the card has no other work in flight, so that
+ * the erase doesn't hold up foreground I/O, but wait no longer than this.
+ */
+#define DEFAULT_CMDQ_DISCARD_MAX_DELAY_MS 500
+
 /*
  * Prepare a MMC request. This just filters out odd stuff.
  */
@@ -56,11 +69,78 @@ static int mmc_prep_request(struct request_queue *q, struct request *req)
 	return BLKPREP_OK;
 }
 
+/*
+ * Returns true if @req is an async write and issuing it would exceed the
+ * share of task slots async writes are allowed to hold.
+ */
+static bool mmc_cmdq_wr_throttled(struct mmc_queue *mq, struct request *req)
+{
+	struct mmc_cmdq_context_info *ctx = &mq->card->host->cmdq_ctx;
+	int q_depth = mq->card->ext_csd.cmdq_depth - 1;
+	int inflight, limit;
+	bool throttle;
+
+	if (!mmc_cmdq_async_write(req))
+		return false;
+
+	inflight = hweight_long(ctx->active_reqs & mq->cmdq_async_wr_tags);
+	limit = max(DIV_ROUND_UP(q_depth * mq->cmdq_async_wr_pct, 100), 1);
+	throttle = inflight >= limit;
+
+	if (throttle != mq->cmdq_wr_throttled) {
+		mq->cmdq_wr_throttled = throttle;
+		blk_add_trace_msg(mq->queue, "mmc cmdq: async writes %s (%d/%d)",
+				  throttle ? "throttled" : "unthrottled",
+				  inflight, limit);
+	}
+
+	return throttle;
+}
+
+/*
+ * Returns true if @req is a discard that should wait for the card to
+ * finish the work it has in flight.
+ */
+static bool mmc_cmdq_discard_deferred(struct mmc_queue *mq,
+				      struct request *req)
+{
+	if (!mmc_cmdq_discard_req(req))
+		return false;
+
+	return time_before(jiffies, req->start_time +
+			   msecs_to_jiffies(mq->cmdq_discard_max_delay_ms));
+}
+
 static struct request *mmc_peek_request(struct mmc_queue *mq)
 {
 	struct request_queue *q = mq->queue;
+	struct mmc_cmdq_context_info *ctx = &mq->card->host->cmdq_ctx;
+	struct request *req, *discard = NULL;
+
 	mq->cmdq_req_peeked = NULL;
 
+	if (q->mq_ops) {
+		spin_lock_irq(&mq->cmdq_mq_lock);
+		list_for_each_entry(req, &mq->cmdq_mq_list, queuelist) {
+			/* let reads pass async writes held back for slots */
+			if (mmc_cmdq_wr_throttled(mq, req))
+				continue;
+			/* and discards, until the card runs out of work */
+			if (mmc_cmdq_discard_deferred(mq, req)) {
+				if (!discard)
+					discard = req;
+				continue;
+			}
+			mq->cmdq_req_peeked = req;
+			break;
+		}
+		if (!mq->cmdq_req_peeked && discard && !ctx->active_reqs)
+			mq->cmdq_req_peeked = discard;
+		spin_unlock_irq(&mq->cmdq_mq_lock);
+
+		return mq->cmdq_req_peeked;
+	}
+
 	spin_lock_irq(q->queue_lock);
 	if (!blk_queue_stopped(q))
 		mq->cmdq_req_peeked = blk_peek_request(q);
@@ -72,8 +152,17 @@ static struct request *mmc_peek_request(struct mmc_queue *mq)
 static bool mmc_check_blk_queue_start_tag(struct request_queue *q,
 					  struct request *req)
 {
+	struct mmc_queue *mq = q->queuedata;
 	int ret;
 
+	/* blk-mq has already tagged the request, just take it off the list */
+	if (q->mq_ops) {
+		spin_lock_irq(&mq->cmdq_mq_lock);
+		list_del_init(&req->queuelist);
+		spin_unlock_irq(&mq->cmdq_mq_lock);
+		return false;
+	}
+
 	spin_lock_irq(q->queue_lock);
 	ret = blk_queue_start_tag(q, req);
 	spin_unlock_irq(q->queue_lock);
@@ -95,7 +184,8 @@ static inline void mmc_cmdq_ready_wait(struct mmc_host *host,
 	 *    be any other direct command active.
 	 * 3. cmdq state should be unhalted.
 	 * 4. cmdq state shouldn't be in error state.
-	 * 5. free tag available to process the new request.
+	 * 5. async writes are within their share of the task slots.
+	 * 6. free tag available to process the new request.
 	 */
 	wait_event(ctx->wait, kthread_should_stop()
 		|| (mmc_peek_request(mq) &&
@@ -106,6 +196,7 @@ static inline void mmc_cmdq_ready_wait(struct mmc_host *host,
 		&& !(!host->card->part_curr && mmc_host_cq_disable(host) &&
 			!mmc_card_suspended(host->card))
 		&& !test_bit(CMDQ_STATE_ERR, &ctx->curr_state)
+		&& !mmc_cmdq_wr_throttled(mq, mq->cmdq_req_peeked)
 		&& !mmc_check_blk_queue_start_tag(q, mq->cmdq_req_peeked)));
 }
 
@@ -211,6 +302,34 @@ static void mmc_cmdq_dispatch_req(struct request_queue *q)
 	wake_up(&mq->card->host->cmdq_ctx.wait);
 }
 
+/*
+ * blk-mq counterpart of mmc_cmdq_dispatch_req. This may run with
+ * preemption disabled on the submitting cpu while issuing to the CQE has
+ * to claim the host and may sleep, so the request is handed to the cmdq
+ * thread. The tag it was allocated is the CQE task slot it will use.
+ */
+static int mmc_cmdq_queue_rq(struct blk_mq_hw_ctx *hctx, struct request *req,
+			     bool last)
+{
+	struct mmc_queue *mq = hctx->queue->queuedata;
+	unsigned long flags;
+
+	if (!mq) {
+		req->cmd_flags |= REQ_QUIET;
+		return BLK_MQ_RQ_QUEUE_ERROR;
+	}
+
+	blk_mq_start_request(req);
+
+	spin_lock_irqsave(&mq->cmdq_mq_lock, flags);
+	list_add_tail(&req->queuelist, &mq->cmdq_mq_list);
+	spin_unlock_irqrestore(&mq->cmdq_mq_lock, flags);
+
+	wake_up(&mq->card->host->cmdq_ctx.wait);
+
+	return BLK_MQ_RQ_QUEUE_OK;
+}
+
 /*
  * Generic MMC request handler.  This is called for any queue on a
  * particular host.  When the host is not busy, we look for a request
@@ -311,6 +430,50 @@ void mmc_cmdq_setup_queue(struct mmc_queue *mq, struct mmc_card *card)
 	blk_queue_max_segments(mq->queue, host->max_segs);
 }
 
+static void mmc_cmdq_softirq_done(struct request *rq);
+enum blk_eh_timer_return mmc_cmdq_rq_timed_out(struct request *req);
+
+static enum blk_eh_timer_return mmc_cmdq_mq_timed_out(struct request *req,
+						      bool reserved)
+{
+	return mmc_cmdq_rq_timed_out(req);
+}
+
+static struct blk_mq_ops mmc_cmdq_mq_ops = {
+	.queue_rq	= mmc_cmdq_queue_rq,
+	.map_queue	= blk_mq_map_queue,
+	.complete	= mmc_cmdq_softirq_done,
+	.timeout	= mmc_cmdq_mq_timed_out,
+};
+
+static struct request_queue *mmc_cmdq_init_mq(struct mmc_queue *mq,
+					      struct mmc_card *card)
+{
+	struct request_queue *q;
+
+	memset(&mq->tag_set, 0, sizeof(mq->tag_set));
+	mq->tag_set.ops = &mmc_cmdq_mq_ops;
+	mq->tag_set.nr_hw_queues = 1;
+	/* one slot is reserved for dcmd requests */
+	mq->tag_set.queue_depth = card->ext_csd.cmdq_depth - 1;
+	mq->tag_set.numa_node = NUMA_NO_NODE;
+	mq->tag_set.flags = BLK_MQ_F_SHOULD_MERGE | BLK_MQ_F_SG_MERGE;
+
+	if (blk_mq_alloc_tag_set(&mq->tag_set))
+		return NULL;
+
+	q = blk_mq_init_queue(&mq->tag_set);
+	if (IS_ERR(q)) {
+		blk_mq_free_tag_set(&mq->tag_set);
+		return NULL;
+	}
+
+	INIT_LIST_HEAD(&mq->cmdq_mq_list);
+	spin_lock_init(&mq->cmdq_mq_lock);
+
+	return q;
+}
+
 /**
  * mmc_init_queue - initialise a queue structure.
  * @mq: mmc queue
@@ -335,7 +498,10 @@ int mmc_init_queue(struct mmc_queue *mq, struct mmc_card *card,
 	mq->card = card;
 	if (card->ext_csd.cmdq_support &&
 	    (area_type == MMC_BLK_DATA_AREA_MAIN)) {
-		mq->queue = blk_init_queue(mmc_cmdq_dispatch_req, lock);
+		if (IS_ENABLED(CONFIG_MMC_BLOCK_CMDQ_MQ))
+			mq->queue = mmc_cmdq_init_mq(mq, card);
+		else
+			mq->queue = blk_init_queue(mmc_cmdq_dispatch_req, lock);
 		if (!mq->queue)
 			return -ENOMEM;
 		mmc_cmdq_setup_queue(mq, card);
@@ -344,6 +510,8 @@ int mmc_init_queue(struct mmc_queue *mq, struct mmc_card *card,
 			pr_err("%s: %d: cmdq: unable to set-up\n",
 			       mmc_hostname(card->host), ret);
 			blk_cleanup_queue(mq->queue);
+			if (mq->tag_set.tags)
+				blk_mq_free_tag_set(&mq->tag_set);
 		} else {
 			sema_init(&mq->thread_sem, 1);
 			/* hook for pm qos cmdq init */
@@ -526,7 +694,10 @@ void mmc_cleanup_queue(struct mmc_queue *mq)
 	/* Empty the queue */
 	spin_lock_irqsave(q->queue_lock, flags);
 	q->queuedata = NULL;
-	blk_start_queue(q);
+	if (q->mq_ops)
+		blk_mq_start_stopped_hw_queues(q, true);
+	else
+		blk_start_queue(q);
 	spin_unlock_irqrestore(q->queue_lock, flags);
 
 	kfree(mqrq_cur->bounce_sg);
@@ -677,19 +848,25 @@ int mmc_cmdq_init(struct mmc_queue *mq, struct mmc_card *card)
 		}
 	}
 
-	ret = blk_queue_init_tags(mq->queue, q_depth, NULL);
-	if (ret) {
-		pr_warn("%s: unable to allocate cmdq tags %d\n",
-				mmc_card_name(card), q_depth);
-		goto free_mqrq_sg;
+	/* blk-mq queues get their tags and callbacks from the tag set */
+	if (!mq->queue->mq_ops) {
+		ret = blk_queue_init_tags(mq->queue, q_depth, NULL);
+		if (ret) {
+			pr_warn("%s: unable to allocate cmdq tags %d\n",
+					mmc_card_name(card), q_depth);
+			goto free_mqrq_sg;
+		}
+
+		blk_queue_softirq_done(mq->queue, mmc_cmdq_softirq_done);
+		blk_queue_rq_timed_out(mq->queue, mmc_cmdq_rq_timed_out);
 	}
 
-	blk_queue_softirq_done(mq->queue, mmc_cmdq_softirq_done);
+	mq->cmdq_async_wr_pct = DEFAULT_CMDQ_ASYNC_WR_PCT;
+	mq->cmdq_discard_max_delay_ms = DEFAULT_CMDQ_DISCARD_MAX_DELAY_MS;
 	INIT_WORK(&mq->cmdq_err_work, mmc_cmdq_error_work);
 	init_completion(&mq->cmdq_shutdown_complete);
 	init_completion(&mq->cmdq_pending_req_done);
 
-	blk_queue_rq_timed_out(mq->queue, mmc_cmdq_rq_timed_out);
 	blk_queue_rq_timeout(mq->queue, 30 * HZ);
 	card->cmdq_init = true;
 
@@ -709,9 +886,12 @@ void mmc_cmdq_clean(struct mmc_queue *mq, struct mmc_card *card)
 	int i;
 	int q_depth = card->ext_csd.cmdq_depth - 1;
 
-	blk_free_tags(mq->queue->queue_tags);
-	mq->queue->queue_tags = NULL;
-	blk_queue_free_tags(mq->queue);
+	/* the blk-mq tag set is freed along with the queue */
+	if (!mq->queue->mq_ops) {
+		blk_free_tags(mq->queue->queue_tags);
+		mq->queue->queue_tags = NULL;
+		blk_queue_free_tags(mq->queue);
+	}
 
 	for (i = 0; i < q_depth; i++)
 		kfree(mq->mqrq_cmdq[i].sg);
@@ -719,6 +899,193 @@ void mmc_cmdq_clean(struct mmc_queue *mq, struct mmc_card *card)
 	mq->mqrq_cmdq = NULL;
 }
 
+/**
+ * mmc_cmdq_end_request - end a command queue request
+ * @req: request to end
+ * @err: completion status
+ * @bytes: number of bytes completed
+ *
+ * Ends @req on either a legacy or a blk-mq queue. On blk-mq the request
+ * can't stay pending, so any bytes left over are failed.
+ */
+void mmc_cmdq_end_request(struct request *req, int err, unsigned int bytes)
+{
+	if (!req->q->mq_ops) {
+		blk_end_request(req, err, bytes);
+		return;
+	}
+
+	if (blk_update_request(req, err, bytes))
+		blk_mq_end_request(req, err ? err : -EIO);
+	else
+		__blk_mq_end_request(req, err);
+}
+
+/**
+ * mmc_cmdq_complete_request - complete a command queue request
+ * @req: request completed by the host
+ *
+ * Hands @req to the queue's completion handler.
+ */
+void mmc_cmdq_complete_request(struct request *req)
+{
+	if (req->q->mq_ops)
+		blk_mq_complete_request(req);
+	else
+		blk_complete_request(req);
+}
+
+/**
+ * mmc_cmdq_tag_to_rq - find the request issued on a command queue tag
+ * @mq: mmc queue
+ * @tag: tag of the request
+ *
+ * blk-mq reuses the tag of the original request for flush requests, so
+ * the request is looked up in the slot it was issued on instead.
+ */
+struct request *mmc_cmdq_tag_to_rq(struct mmc_queue *mq, int tag)
+{
+	if (mq->queue->mq_ops)
+		return mq->mqrq_cmdq[tag].req;
+
+	return blk_queue_find_tag(mq->queue, tag);
+}
+
+/**
+ * mmc_cmdq_invalidate_tags - requeue requests after a reset
+ * @mq: mmc queue
+ * @tags: tags that were active when the host was reset
+ */
+void mmc_cmdq_invalidate_tags(struct mmc_queue *mq, unsigned long tags)
+{
+	struct request_queue *q = mq->queue;
+	struct request *req;
+	int tag;
+
+	if (!q->mq_ops) {
+		spin_lock_irq(q->queue_lock);
+		blk_queue_invalidate_tags(q);
+		spin_unlock_irq(q->queue_lock);
+		return;
+	}
+
+	for_each_set_bit(tag, &tags, mq->card->ext_csd.cmdq_depth - 1) {
+		req = mmc_cmdq_tag_to_rq(mq, tag);
+		if (req)
+			blk_mq_requeue_request(req);
+	}
+	blk_mq_kick_requeue_list(q);
+}
+
+/**
+ * mmc_cmdq_merge_discards - merge queued discards into one erase range
+ * @mq: mmc queue
+ * @req: discard request about to be issued
+ * @from: returns the first sector of the merged range
+ * @merged: list the merged requests are moved to
+ *
+ * Requests are already started, and hence unmergeable, by the time they
+ * reach a blk-mq queue, so discards that are adjacent to @req are taken
+ * off the queue here and erased along with it, up to the discard size
+ * limit of the queue. Only contiguous ranges are merged so that no data
+ * outside the discarded ranges is lost.
+ *
+ * Returns the number of sectors of the merged range.
+ */
+unsigned int mmc_cmdq_merge_discards(struct mmc_queue *mq,
+				     struct request *req,
+				     unsigned int *from,
+				     struct list_head *merged)
+{
+	unsigned int max = mq->queue->limits.max_discard_sectors;
+	unsigned int nr = blk_rq_sectors(req);
+	struct request *rq, *tmp;
+	int nr_merged = 0;
+	bool again;
+
+	*from = blk_rq_pos(req);
+	if (!mq->queue->mq_ops)
+		return nr;
+
+	spin_lock_irq(&mq->cmdq_mq_lock);
+	do {
+		again = false;
+		list_for_each_entry_safe(rq, tmp, &mq->cmdq_mq_list,
+					 queuelist) {
+			if (!mmc_cmdq_discard_req(rq) ||
+			    nr + blk_rq_sectors(rq) > max)
+				continue;
+
+			if (blk_rq_pos(rq) + blk_rq_sectors(rq) == *from)
+				*from = blk_rq_pos(rq);
+			else if (blk_rq_pos(rq) != *from + nr)
+				continue;
+
+			nr += blk_rq_sectors(rq);
+			list_move_tail(&rq->queuelist, merged);
+			nr_merged++;
+			again = true;
+		}
+	} while (again);
+	spin_unlock_irq(&mq->cmdq_mq_lock);
+
+	if (nr_merged)
+		blk_add_trace_msg(mq->queue,
+				  "mmc cmdq: merged %d discards (%u sectors)",
+				  nr_merged, nr);
+
+	return nr;
+}
+
+/**
+ * mmc_cmdq_end_merged_discards - finish discards merged into another one
+ * @mq: mmc queue
+ * @merged: requests returned by mmc_cmdq_merge_discards()
+ * @err: result of the erase
+ *
+ * On failure the requests are put back on the queue to be issued on their
+ * own once the error has been handled.
+ */
+void mmc_cmdq_end_merged_discards(struct mmc_queue *mq,
+				  struct list_head *merged, int err)
+{
+	struct request *rq, *tmp;
+
+	if (list_empty(merged))
+		return;
+
+	if (err) {
+		spin_lock_irq(&mq->cmdq_mq_lock);
+		list_splice_init(merged, &mq->cmdq_mq_list);
+		spin_unlock_irq(&mq->cmdq_mq_lock);
+		return;
+	}
+
+	list_for_each_entry_safe(rq, tmp, merged, queuelist) {
+		list_del_init(&rq->queuelist);
+		mmc_cmdq_end_request(rq, 0, blk_rq_bytes(rq));
+	}
+}
+
+static void mmc_cmdq_mq_busy_iter(struct blk_mq_hw_ctx *hctx,
+				  struct request *req, void *data,
+				  bool reserved)
+{
+	(*(int *)data)++;
+}
+
+/* Requests allocated on a blk-mq queue, whether dispatched or not */
+static int mmc_cmdq_mq_busy(struct request_queue *q)
+{
+	struct blk_mq_hw_ctx *hctx;
+	int i, busy = 0;
+
+	queue_for_each_hw_ctx(q, hctx, i)
+		blk_mq_tag_busy_iter(hctx, mmc_cmdq_mq_busy_iter, &busy);
+
+	return busy;
+}
+
 /**
  * mmc_queue_suspend - suspend a MMC request queue
  * @mq: MMC queue to suspend
@@ -736,7 +1103,7 @@ int mmc_queue_suspend(struct mmc_queue *mq, int wait)
 	struct mmc_card *card = mq->card;
 	struct request *req;
 
-	if (card->cmdq_init && blk_queue_tagged(q)) {
+	if (card->cmdq_init && (q->mq_ops || blk_queue_tagged(q))) {
 		struct mmc_host *host = card->host;
 
 		if (test_and_set_bit(MMC_QUEUE_SUSPENDED, &mq->flags))
@@ -758,6 +1125,15 @@ int mmc_queue_suspend(struct mmc_queue *mq, int wait)
 						&mq->cmdq_shutdown_complete);
 			kthread_stop(mq->thread);
 			mq->cmdq_shutdown(mq);
+		} else if (q->mq_ops) {
+			blk_mq_stop_hw_queues(q);
+			wake_up(&host->cmdq_ctx.wait);
+			if (mmc_cmdq_mq_busy(q) || mq->cmdq_req_peeked ||
+			    host->cmdq_ctx.active_reqs) {
+				clear_bit(MMC_QUEUE_SUSPENDED, &mq->flags);
+				blk_mq_start_stopped_hw_queues(q, true);
+				rc = -EBUSY;
+			}
 		} else {
 			spin_lock_irqsave(q->queue_lock, flags);
 			blk_stop_queue(q);
@@ -818,9 +1194,14 @@ void mmc_queue_resume(struct mmc_queue *mq)
 
 	if (test_and_clear_bit(MMC_QUEUE_SUSPENDED, &mq->flags)) {
 
-		if (!(card->cmdq_init && blk_queue_tagged(q)))
+		if (!(card->cmdq_init && (q->mq_ops || blk_queue_tagged(q))))
 			up(&mq->thread_sem);
 
+		if (q->mq_ops) {
+			blk_mq_start_stopped_hw_queues(q, true);
+			return;
+		}
+
 		spin_lock_irqsave(q->queue_lock, flags);
 		blk_start_queue(q);
 		spin_unlock_irqrestore(q->queue_lock, flags);
@@ -1,6 +1,8 @@
 #ifndef MMC_QUEUE_H
 #define MMC_QUEUE_H
 
+#include <linux/blk-mq.h>
+
 #define MMC_REQ_SPECIAL_MASK	(REQ_DISCARD | REQ_FLUSH)
 
 struct request;
@@ -73,11 +75,33 @@ struct mmc_queue {
 	struct completion	cmdq_pending_req_done;
 	struct completion	cmdq_shutdown_complete;
 	struct request		*cmdq_req_peeked;
+	/* blk-mq mode: tag set and requests queued to the cmdq thread */
+	struct blk_mq_tag_set	tag_set;
+	struct list_head	cmdq_mq_list;
+	spinlock_t		cmdq_mq_lock;
+	/* tags issued for async writes and their share of the slots */
+	unsigned long		cmdq_async_wr_tags;
+	int			cmdq_async_wr_pct;
+	bool			cmdq_wr_throttled;
+	/* how long a discard may wait for the card to go idle */
+	unsigned int		cmdq_discard_max_delay_ms;
 	int (*err_check_fn) (struct mmc_card *, struct mmc_async_req *);
 	void (*packed_test_fn) (struct request_queue *, struct mmc_queue_req *);
 	void (*cmdq_shutdown)(struct mmc_queue *);
 };
 
+static inline bool mmc_cmdq_async_write(struct request *req)
+{
+	return rq_data_dir(req) == WRITE && !rq_is_sync(req) &&
+		!(req->cmd_flags & (REQ_FLUSH | REQ_DISCARD));
+}
+
+static inline bool mmc_cmdq_discard_req(struct request *req)
+{
+	return (req->cmd_flags & REQ_DISCARD) &&
+		!(req->cmd_flags & REQ_SECURE);
+}
+
 extern int mmc_init_queue(struct mmc_queue *, struct mmc_card *, spinlock_t *,
 			  const char *, int);
 extern void mmc_cleanup_queue(struct mmc_queue *);
@@ -98,5 +122,17 @@ extern void print_mmc_packing_stats(struct mmc_card *card);
 
 extern int mmc_cmdq_init(struct mmc_queue *mq, struct mmc_card *card);
 extern void mmc_cmdq_clean(struct mmc_queue *mq, struct mmc_card *card);
+extern void mmc_cmdq_end_request(struct request *req, int err,
+				 unsigned int bytes);
+extern void mmc_cmdq_complete_request(struct request *req);
+extern struct request *mmc_cmdq_tag_to_rq(struct mmc_queue *mq, int tag);
+extern void mmc_cmdq_invalidate_tags(struct mmc_queue *mq,
+				     unsigned long tags);
+extern unsigned int mmc_cmdq_merge_discards(struct mmc_queue *mq,
+					    struct request *req,
+					    unsigned int *from,
+					    struct list_head *merged);
+extern void mmc_cmdq_end_merged_discards(struct mmc_queue *mq,
+					 struct list_head *merged, int err);
 
 #endif
@@ -32,6 +32,7 @@
 #include <linux/of.h>
 #include <linux/pm.h>
 #include <linux/jiffies.h>
+#include <linux/input.h>
 
 #define CREATE_TRACE_POINTS
 #include <trace/events/mmc.h>
@@ -279,11 +280,77 @@ bool mmc_can_scale_clk(struct mmc_host *host)
 }
 EXPORT_SYMBOL(mmc_can_scale_clk);
 
+static inline bool mmc_clk_scaling_boosted(
+		struct mmc_devfeq_clk_scaling *clk_scaling)
+{
+	return clk_scaling->boost_ms &&
+		time_before(jiffies, ACCESS_ONCE(clk_scaling->boost_expires));
+}
+
+/**
+ * mmc_clk_scaling_hint() - tell clock scaling about the type of a request
+ * @host: pointer to mmc host structure
+ * @hint: type of the request about to be issued
+ *
+ * Sync requests (reads, flushes, FUA writes) have a task waiting on them, so
+ * they do not wait for the next devfreq evaluation: the highest frequency is
+ * voted right away and applied by mmc_deferred_scaling() before the next data
+ * request. Async writes are only counted, and a polling interval that saw
+ * nothing else is reported with half its busy time so that background
+ * writeback settles at a lower clock. Within the boost window that follows an
+ * input event every request votes for the highest frequency.
+ *
+ * Called from the block layer with the host claimed.
+ */
+void mmc_clk_scaling_hint(struct mmc_host *host,
+		enum mmc_clk_scaling_hint hint)
+{
+	struct mmc_devfeq_clk_scaling *clk_scaling = &host->clk_scaling;
+	unsigned long max_freq;
+
+	if (!clk_scaling->enable)
+		return;
+
+	spin_lock_bh(&clk_scaling->lock);
+
+	if (hint == MMC_CLK_SCALING_HINT_SYNC)
+		clk_scaling->nr_sync_reqs++;
+	else
+		clk_scaling->nr_async_write_reqs++;
+
+	if (hint != MMC_CLK_SCALING_HINT_SYNC &&
+	    !mmc_clk_scaling_boosted(clk_scaling))
+		goto out;
+
+	if (clk_scaling->clk_scaling_in_progress ||
+	    clk_scaling->skip_clk_scale_freq_update)
+		goto out;
+
+	max_freq = clk_scaling->freq_table[clk_scaling->freq_table_sz - 1];
+	/* honour a ceiling set through the devfreq sysfs interface */
+	if (clk_scaling->devfreq && clk_scaling->devfreq->max_freq)
+		max_freq = min(max_freq, clk_scaling->devfreq->max_freq);
+
+	if (clk_scaling->curr_freq >= max_freq)
+		goto out;
+
+	trace_mmc_clk_scaling_hint(mmc_hostname(host), hint,
+		clk_scaling->curr_freq, max_freq);
+
+	clk_scaling->need_freq_change = true;
+	clk_scaling->target_freq = max_freq;
+	clk_scaling->state = MMC_LOAD_HIGH;
+out:
+	spin_unlock_bh(&clk_scaling->lock);
+}
+EXPORT_SYMBOL(mmc_clk_scaling_hint);
+
 static int mmc_devfreq_get_dev_status(struct device *dev,
 		struct devfreq_dev_status *status)
 {
 	struct mmc_host *host = container_of(dev, struct mmc_host, class_dev);
 	struct mmc_devfeq_clk_scaling *clk_scaling;
+	bool boosted;
 
 	if (!host) {
 		pr_err("bad host parameter\n");
@@ -318,6 +385,20 @@ static int mmc_devfreq_get_dev_status(struct device *dev,
 	status->current_frequency = clk_scaling->curr_freq;
 	clk_scaling->measure_interval_start = ktime_get();
 
+	boosted = mmc_clk_scaling_boosted(clk_scaling);
+	if (boosted)
+		status->busy_time = status->total_time;
+	else if (clk_scaling->nr_async_write_reqs &&
+		 !clk_scaling->nr_sync_reqs)
+		status->busy_time /= 2;
+
+	trace_mmc_clk_scaling_status(mmc_hostname(host), status->busy_time,
+		status->total_time, status->current_frequency,
+		clk_scaling->nr_sync_reqs, clk_scaling->nr_async_write_reqs,
+		boosted);
+	clk_scaling->nr_sync_reqs = 0;
+	clk_scaling->nr_async_write_reqs = 0;
+
 	pr_debug("%s: status: load = %lu%% - total_time=%lu busy_time = %lu, clk=%lu\n",
 		mmc_hostname(host),
 		(status->busy_time*100)/status->total_time,
@@ -634,6 +715,21 @@ out:
 	return 0;
 }
 
+static int mmc_clk_scaling_input_notify(struct notifier_block *nb,
+		unsigned long action, void *data)
+{
+	struct mmc_devfeq_clk_scaling *clk_scaling =
+		container_of(nb, struct mmc_devfeq_clk_scaling, boost_nb);
+	unsigned long boost_ms = ACCESS_ONCE(clk_scaling->boost_ms);
+
+	/* hard interrupt context: the next request picks the boost up */
+	if (boost_ms)
+		clk_scaling->boost_expires = jiffies +
+			msecs_to_jiffies(boost_ms);
+
+	return NOTIFY_OK;
+}
+
 /**
  * mmc_init_devfreq_clk_scaling() - Initialize clock scaling
  * @host: pointer to mmc host structure
@@ -676,6 +772,9 @@ int mmc_init_clk_scaling(struct mmc_host *host)
 	host->clk_scaling.clk_scaling_in_progress = false;
 	host->clk_scaling.need_freq_change = false;
 	host->clk_scaling.is_busy_started = false;
+	host->clk_scaling.nr_sync_reqs = 0;
+	host->clk_scaling.nr_async_write_reqs = 0;
+	host->clk_scaling.boost_expires = jiffies;
 
 	host->clk_scaling.devfreq_profile.polling_ms =
 		host->clk_scaling.polling_delay_ms;
@@ -722,6 +821,13 @@ int mmc_init_clk_scaling(struct mmc_host *host)
 
 	host->clk_scaling.enable = true;
 
+#if IS_ENABLED(CONFIG_INPUT)
+	host->clk_scaling.boost_nb.notifier_call =
+		mmc_clk_scaling_input_notify;
+	if (input_register_interaction_notifier(&host->clk_scaling.boost_nb))
+		host->clk_scaling.boost_nb.notifier_call = NULL;
+#endif
+
 	return err;
 }
 EXPORT_SYMBOL(mmc_init_clk_scaling);
@@ -863,6 +969,14 @@ int mmc_exit_clk_scaling(struct mmc_host *host)
 		return err;
 	}
 
+#if IS_ENABLED(CONFIG_INPUT)
+	if (host->clk_scaling.boost_nb.notifier_call) {
+		input_unregister_interaction_notifier(
+			&host->clk_scaling.boost_nb);
+		host->clk_scaling.boost_nb.notifier_call = NULL;
+	}
+#endif
+
 	err = devfreq_remove_device(host->clk_scaling.devfreq);
 	if (err) {
 		pr_err("%s: remove devfreq failed (%d)\n",
@@ -952,6 +1066,7 @@ void mmc_request_done(struct mmc_host *host, struct mmc_request *mrq)
 				mrq->stop->resp[2], mrq->stop->resp[3]);
 		}
 
+		mmc_req_trace_done(host, mrq);
 		if (mrq->done)
 			mrq->done(mrq);
 
@@ -965,6 +1080,7 @@ static void __mmc_start_request(struct mmc_host *host, struct mmc_request *mrq)
 {
 	int err;
 
+	mmc_req_trace_start(mrq);
 	/* Assumes host controller has been runtime resumed by mmc_claim_host */
 	err = mmc_retune(host);
 	if (err) {
@@ -1075,6 +1191,7 @@ static void mmc_start_cmdq_request(struct mmc_host *host,
 	}
 
 	mmc_host_clk_hold(host);
+	mmc_req_trace_start(mrq);
 	if (likely(host->cmdq_ops->request))
 		host->cmdq_ops->request(host, mrq);
 	else
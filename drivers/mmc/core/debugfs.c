@@ -424,6 +424,8 @@ void mmc_add_host_debugfs(struct mmc_host *host)
 		goto err_node;
 #endif
 
+	mmc_req_trace_add_debugfs(host, root);
+
 #ifdef CONFIG_MMC_CLKGATE
 	if (!debugfs_create_u32("clk_delay", (S_IRUSR | S_IWUSR),
 				root, &host->clk_delay))
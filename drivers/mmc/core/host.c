@@ -37,6 +37,7 @@
 #define MMC_DEVFRQ_DEFAULT_UP_THRESHOLD 35
 #define MMC_DEVFRQ_DEFAULT_DOWN_THRESHOLD 5
 #define MMC_DEVFRQ_DEFAULT_POLLING_MSEC 100
+#define MMC_DEVFRQ_DEFAULT_BOOST_MSEC 200
 
 static void mmc_host_classdev_release(struct device *dev)
 {
@@ -746,6 +747,34 @@ static ssize_t store_polling(struct device *dev,
 	return count;
 }
 
+static ssize_t show_boost(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct mmc_host *host = cls_dev_to_mmc_host(dev);
+
+	if (!host)
+		return -EINVAL;
+
+	return snprintf(buf, PAGE_SIZE, "%lu milliseconds\n",
+			host->clk_scaling.boost_ms);
+}
+
+static ssize_t store_boost(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct mmc_host *host = cls_dev_to_mmc_host(dev);
+	unsigned long value;
+
+	if (!host || kstrtoul(buf, 0, &value))
+		return -EINVAL;
+
+	host->clk_scaling.boost_ms = value;
+
+	pr_debug("%s: clkscale_boost_ms set to %lu\n",
+			mmc_hostname(host), value);
+	return count;
+}
+
 DEVICE_ATTR(enable, S_IRUGO | S_IWUSR,
 		show_enable, store_enable);
 DEVICE_ATTR(polling_interval, S_IRUGO | S_IWUSR,
@@ -754,12 +783,15 @@ DEVICE_ATTR(up_threshold, S_IRUGO | S_IWUSR,
 		show_up_threshold, store_up_threshold);
 DEVICE_ATTR(down_threshold, S_IRUGO | S_IWUSR,
 		show_down_threshold, store_down_threshold);
+DEVICE_ATTR(input_boost_ms, S_IRUGO | S_IWUSR,
+		show_boost, store_boost);
 
 static struct attribute *clk_scaling_attrs[] = {
 	&dev_attr_enable.attr,
 	&dev_attr_up_threshold.attr,
 	&dev_attr_down_threshold.attr,
 	&dev_attr_polling_interval.attr,
+	&dev_attr_input_boost_ms.attr,
 	NULL,
 };
 
@@ -854,6 +886,7 @@ int mmc_add_host(struct mmc_host *host)
 	host->clk_scaling.upthreshold = MMC_DEVFRQ_DEFAULT_UP_THRESHOLD;
 	host->clk_scaling.downthreshold = MMC_DEVFRQ_DEFAULT_DOWN_THRESHOLD;
 	host->clk_scaling.polling_delay_ms = MMC_DEVFRQ_DEFAULT_POLLING_MSEC;
+	host->clk_scaling.boost_ms = MMC_DEVFRQ_DEFAULT_BOOST_MSEC;
 	host->clk_scaling.skip_clk_scale_freq_update = false;
 
 #ifdef CONFIG_DEBUG_FS
@@ -861,6 +894,7 @@ int mmc_add_host(struct mmc_host *host)
 #endif
 	mmc_host_clk_sysfs_init(host);
 	mmc_trace_init(host);
+	mmc_req_trace_init(host);
 
 	err = sysfs_create_group(&host->class_dev.kobj, &clk_scaling_attr_grp);
 	if (err)
@@ -924,6 +958,7 @@ void mmc_free_host(struct mmc_host *host)
 	spin_unlock(&mmc_host_lock);
 
 	wakeup_source_trash(&host->pm_ws);
+	mmc_req_trace_free(host);
 
 	put_device(&host->class_dev);
 }
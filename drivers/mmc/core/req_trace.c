@@ -0,0 +1,258 @@
+/*
+ * Copyright (c) 2016, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <linux/debugfs.h>
+#include <linux/fs.h>
+#include <linux/seq_file.h>
+#include <linux/uaccess.h>
+#include <linux/vmalloc.h>
+#include <linux/mmc/host.h>
+#include <linux/mmc/req_trace.h>
+
+static const char * const mmc_req_hist_names[MMC_REQ_HIST_NR_OPS] = {
+	[MMC_REQ_HIST_READ]	= "read",
+	[MMC_REQ_HIST_WRITE]	= "write",
+	[MMC_REQ_HIST_OTHER]	= "other",
+};
+
+static void mmc_req_trace_update_max(atomic_t *max, u32 val)
+{
+	int old = atomic_read(max);
+
+	while ((u32)old < val) {
+		int prev = atomic_cmpxchg(max, old, val);
+
+		if (prev == old)
+			break;
+		old = prev;
+	}
+}
+
+/*
+ * Called on completion of every request that went through
+ * mmc_req_trace_start(). Runs in the host's completion context, so it
+ * takes no locks: slots are claimed with an atomic increment and the
+ * histograms are plain atomic counters. A reader racing with a writer
+ * may see one torn record, which is acceptable for a trace.
+ */
+void mmc_req_trace_done(struct mmc_host *host, struct mmc_request *mrq)
+{
+	struct mmc_req_trace *rt = &host->req_trace;
+	struct mmc_cmdq_req *cmdq_req = mrq->cmdq_req;
+	struct mmc_req_record *rec;
+	enum mmc_req_hist_op op = MMC_REQ_HIST_OTHER;
+	unsigned int idx;
+	s64 latency;
+	u32 us;
+	int err = 0;
+
+	if (unlikely(!rt->ring) || !ktime_to_ns(mrq->io_start))
+		return;
+
+	latency = ktime_us_delta(ktime_get(), mrq->io_start);
+	us = latency > 0 ? min_t(s64, latency, U32_MAX) : 0;
+
+	idx = (atomic_inc_return(&rt->head) - 1) & (MMC_REQ_RING_SZ - 1);
+	rec = &rt->ring[idx];
+
+	rec->issue_ns = ktime_to_ns(mrq->io_start);
+	rec->latency_us = us;
+	rec->clock_khz = host->ios.clock / 1000;
+	rec->opcode = 0;
+	rec->arg = 0;
+	rec->flags = 0;
+	rec->blocks = 0;
+	rec->tag = MMC_REQ_NO_TAG;
+
+	if (cmdq_req) {
+		rec->tag = cmdq_req->tag;
+		if (cmdq_req->cmdq_req_flags & DCMD) {
+			rec->flags |= MMC_REQ_REC_DCMD;
+		} else {
+			rec->flags |= MMC_REQ_REC_CMDQ;
+			rec->opcode = MMC_REQ_OPCODE_CMDQ;
+			rec->arg = cmdq_req->blk_addr;
+		}
+	}
+	if (!(rec->flags & MMC_REQ_REC_CMDQ) && mrq->cmd) {
+		rec->opcode = mrq->cmd->opcode;
+		rec->arg = mrq->cmd->arg;
+		err = mrq->cmd->error;
+	}
+
+	if (mrq->data) {
+		rec->blocks = min_t(unsigned int, mrq->data->blocks, U16_MAX);
+		if (mrq->data->flags & MMC_DATA_READ) {
+			rec->flags |= MMC_REQ_REC_READ;
+			op = MMC_REQ_HIST_READ;
+		} else if (mrq->data->flags & MMC_DATA_WRITE) {
+			rec->flags |= MMC_REQ_REC_WRITE;
+			op = MMC_REQ_HIST_WRITE;
+		}
+		if (!err)
+			err = mrq->data->error;
+	}
+	rec->err = err;
+
+	atomic_inc(&rt->hist[op][min(fls(us), MMC_REQ_HIST_BUCKETS - 1)]);
+	atomic64_add(us, &rt->total_us[op]);
+	mmc_req_trace_update_max(&rt->max_us[op], us);
+
+	/* each request is recorded once, even if the driver completes twice */
+	mrq->io_start = ktime_set(0, 0);
+}
+EXPORT_SYMBOL(mmc_req_trace_done);
+
+void mmc_req_trace_init(struct mmc_host *host)
+{
+	BUILD_BUG_ON_NOT_POWER_OF_2(MMC_REQ_RING_SZ);
+	BUILD_BUG_ON(sizeof(struct mmc_req_record) != 32);
+
+	host->req_trace.ring = vzalloc(MMC_REQ_RING_SZ *
+				       sizeof(struct mmc_req_record));
+	if (!host->req_trace.ring) {
+		pr_err("%s: %s: Unable to allocate request trace\n",
+			mmc_hostname(host), __func__);
+		return;
+	}
+	atomic_set(&host->req_trace.head, 0);
+}
+
+void mmc_req_trace_free(struct mmc_host *host)
+{
+	vfree(host->req_trace.ring);
+	host->req_trace.ring = NULL;
+}
+
+/*
+ * "req_ring" hands out a snapshot taken at open time, so a reader never
+ * sees records overwritten halfway through its read.
+ */
+static int mmc_req_ring_open(struct inode *inode, struct file *file)
+{
+	struct mmc_host *host = inode->i_private;
+	struct mmc_req_ring_hdr *hdr;
+	size_t ring_size = MMC_REQ_RING_SZ * sizeof(struct mmc_req_record);
+
+	if (!host->req_trace.ring)
+		return -ENODEV;
+
+	hdr = vmalloc(sizeof(*hdr) + ring_size);
+	if (!hdr)
+		return -ENOMEM;
+
+	hdr->version = MMC_REQ_RING_VERSION;
+	hdr->nr_records = MMC_REQ_RING_SZ;
+	hdr->record_size = sizeof(struct mmc_req_record);
+	hdr->head = atomic_read(&host->req_trace.head);
+	memcpy(hdr + 1, host->req_trace.ring, ring_size);
+
+	file->private_data = hdr;
+	return 0;
+}
+
+static ssize_t mmc_req_ring_read(struct file *file, char __user *ubuf,
+				 size_t count, loff_t *ppos)
+{
+	return simple_read_from_buffer(ubuf, count, ppos, file->private_data,
+			sizeof(struct mmc_req_ring_hdr) +
+			MMC_REQ_RING_SZ * sizeof(struct mmc_req_record));
+}
+
+static int mmc_req_ring_release(struct inode *inode, struct file *file)
+{
+	vfree(file->private_data);
+	return 0;
+}
+
+static const struct file_operations mmc_req_ring_fops = {
+	.open		= mmc_req_ring_open,
+	.read		= mmc_req_ring_read,
+	.release	= mmc_req_ring_release,
+	.llseek		= default_llseek,
+};
+
+static int mmc_req_latency_show(struct seq_file *s, void *data)
+{
+	struct mmc_host *host = s->private;
+	struct mmc_req_trace *rt = &host->req_trace;
+	int op, i;
+
+	for (op = 0; op < MMC_REQ_HIST_NR_OPS; op++) {
+		u64 nr = 0;
+
+		for (i = 0; i < MMC_REQ_HIST_BUCKETS; i++)
+			nr += atomic_read(&rt->hist[op][i]);
+
+		seq_printf(s, "%s: count %llu total_us %lld max_us %u\n",
+			mmc_req_hist_names[op], nr,
+			(long long)atomic64_read(&rt->total_us[op]),
+			(u32)atomic_read(&rt->max_us[op]));
+		for (i = 0; i < MMC_REQ_HIST_BUCKETS; i++) {
+			unsigned int cnt = atomic_read(&rt->hist[op][i]);
+
+			if (!cnt)
+				continue;
+			if (i == MMC_REQ_HIST_BUCKETS - 1)
+				seq_printf(s, "  >=%8u us: %u\n",
+					1U << (i - 1), cnt);
+			else
+				seq_printf(s, "  < %8u us: %u\n", 1U << i, cnt);
+		}
+	}
+	return 0;
+}
+
+static int mmc_req_latency_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, mmc_req_latency_show, inode->i_private);
+}
+
+/* any write clears the histograms, the ring is left alone */
+static ssize_t mmc_req_latency_write(struct file *file,
+		const char __user *ubuf, size_t count, loff_t *ppos)
+{
+	struct seq_file *s = file->private_data;
+	struct mmc_host *host = s->private;
+	struct mmc_req_trace *rt = &host->req_trace;
+	int op, i;
+
+	for (op = 0; op < MMC_REQ_HIST_NR_OPS; op++) {
+		for (i = 0; i < MMC_REQ_HIST_BUCKETS; i++)
+			atomic_set(&rt->hist[op][i], 0);
+		atomic64_set(&rt->total_us[op], 0);
+		atomic_set(&rt->max_us[op], 0);
+	}
+	return count;
+}
+
+static const struct file_operations mmc_req_latency_fops = {
+	.open		= mmc_req_latency_open,
+	.read		= seq_read,
+	.write		= mmc_req_latency_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+void mmc_req_trace_add_debugfs(struct mmc_host *host, struct dentry *root)
+{
+	if (!debugfs_create_file("req_ring", S_IRUSR, root, host,
+				 &mmc_req_ring_fops))
+		pr_err("%s: failed to create req_ring debugfs entry\n",
+			mmc_hostname(host));
+
+	if (!debugfs_create_file("req_latency", S_IRUSR | S_IWUSR, root, host,
+				 &mmc_req_latency_fops))
+		pr_err("%s: failed to create req_latency debugfs entry\n",
+			mmc_hostname(host));
+}
@@ -28,6 +28,13 @@
 
 #include "sdio_ops.h"
 
+/*
+ * Number of handler passes the IRQ thread makes while keeping the host
+ * claimed, for functions that report more pending data via
+ * sdio_irq_more(), before letting other users of the host in.
+ */
+#define SDIO_IRQ_BURST_MAX	16
+
 static int process_sdio_pending_irqs(struct mmc_host *host)
 {
 	struct mmc_card *card = host->card;
@@ -42,6 +49,7 @@ static int process_sdio_pending_irqs(struct mmc_host *host)
 	 */
 	func = card->sdio_single_irq;
 	if (func && host->sdio_irq_pending) {
+		func->irq_more = false;
 		func->irq_handler(func);
 		return 1;
 	}
@@ -73,6 +81,7 @@ static int process_sdio_pending_irqs(struct mmc_host *host)
 					mmc_card_id(card));
 				ret = -EINVAL;
 			} else if (func->irq_handler) {
+				func->irq_more = false;
 				func->irq_handler(func);
 				count++;
 			} else {
@@ -89,6 +98,43 @@ static int process_sdio_pending_irqs(struct mmc_host *host)
 	return ret;
 }
 
+static bool sdio_irq_more_pending(struct mmc_card *card)
+{
+	struct sdio_func *func;
+	int i;
+
+	for (i = 0; i < card->sdio_funcs; i++) {
+		func = card->sdio_func[i];
+		if (func && func->irq_handler && func->irq_more)
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * Call again the handlers that reported more pending data. Their
+ * interrupt is known to be still asserted so there is no need to read
+ * SDIO_CCCR_INTx again.
+ */
+static int process_sdio_more_irqs(struct mmc_host *host)
+{
+	struct mmc_card *card = host->card;
+	struct sdio_func *func;
+	int i, count = 0;
+
+	for (i = 0; i < card->sdio_funcs; i++) {
+		func = card->sdio_func[i];
+		if (func && func->irq_handler && func->irq_more) {
+			func->irq_more = false;
+			func->irq_handler(func);
+			count++;
+		}
+	}
+
+	return count;
+}
+
 void sdio_run_irqs(struct mmc_host *host)
 {
 	mmc_claim_host(host);
@@ -105,8 +151,8 @@ static int sdio_irq_thread(void *_host)
 	struct mmc_host *host = _host;
 	struct sched_param param = { .sched_priority = 1 };
 	unsigned long period, idle_period;
-	int ret;
-	bool ws;
+	int ret, burst;
+	bool ws, more = false;
 
 	sched_setscheduler(current, SCHED_FIFO, &param);
 
@@ -151,10 +197,33 @@ static int sdio_irq_thread(void *_host)
 			pm_wakeup_event(&host->card->dev, 100);
 			ws = true;
 		}
-		ret = process_sdio_pending_irqs(host);
+		if (more)
+			ret = process_sdio_more_irqs(host);
+		else
+			ret = process_sdio_pending_irqs(host);
+
+		/*
+		 * Keep the host claimed across a burst for as long as the
+		 * function drivers report data left behind, and leave the
+		 * card interrupt masked until all of them have drained it.
+		 */
+		burst = 0;
+		while (ret > 0 && sdio_irq_more_pending(host->card) &&
+		       ++burst < SDIO_IRQ_BURST_MAX &&
+		       !atomic_read(&host->sdio_irq_thread_abort))
+			ret = process_sdio_more_irqs(host);
+		more = ret > 0 && sdio_irq_more_pending(host->card);
 		host->sdio_irq_pending = false;
 		mmc_release_host(host);
 
+		/* Budget exhausted: let others claim the host, then resume */
+		if (more) {
+			if (ws && (host->dev_status == DEV_RESUMED))
+				pm_relax(&host->card->dev);
+			cond_resched();
+			continue;
+		}
+
 		/*
 		 * Give other threads a chance to run in the presence of
 		 * errors.
@@ -323,6 +392,28 @@ int sdio_claim_irq(struct sdio_func *func, sdio_irq_handler_t *handler)
 }
 EXPORT_SYMBOL_GPL(sdio_claim_irq);
 
+/**
+ *	sdio_irq_more - report data still pending after an IRQ
+ *	@func: SDIO function
+ *
+ *	Called from the function's IRQ handler when it stopped before
+ *	draining everything the card has pending. The IRQ thread then calls
+ *	the handler again while keeping the host claimed, without re-reading
+ *	the pending register, and re-enables the card interrupt only once
+ *	no handler reports more. Has no effect on hosts without an SDIO IRQ
+ *	thread.
+ */
+void sdio_irq_more(struct sdio_func *func)
+{
+	BUG_ON(!func);
+	BUG_ON(!func->card);
+
+	WARN_ON(!func->card->host->claimed);
+
+	func->irq_more = true;
+}
+EXPORT_SYMBOL_GPL(sdio_irq_more);
+
 /**
  *	sdio_release_irq - release the IRQ for a SDIO function
  *	@func: SDIO function
@@ -341,6 +432,7 @@ int sdio_release_irq(struct sdio_func *func)
 
 	if (func->irq_handler) {
 		func->irq_handler = NULL;
+		func->irq_more = false;
 		sdio_card_irq_put(func->card);
 		sdio_single_irq_set(func->card);
 	}
@@ -813,6 +813,7 @@ static void cmdq_finish_data(struct mmc_host *mmc, unsigned int tag)
 	cmdq_runtime_pm_put(cq_host);
 	if (cq_host->ops->crypto_cfg_reset)
 		cq_host->ops->crypto_cfg_reset(mmc, tag);
+	mmc_req_trace_done(mmc, mrq);
 	mrq->done(mrq);
 }
 
@@ -182,11 +182,22 @@ int sdhci_msm_ice_cfg(struct sdhci_host *host, struct mmc_request *mrq,
 		 MASK_SDHCI_MSM_ICE_CTRL_INFO_KEY_INDEX)
 		 << OFFSET_SDHCI_MSM_ICE_CTRL_INFO_KEY_INDEX;
 
-	/* Configure data unit size of transfer request */
-	ctrl_info_val |=
-		(SDHCI_MSM_ICE_TR_DATA_UNIT_512_B &
-		 MASK_SDHCI_MSM_ICE_CTRL_INFO_CDU)
-		 << OFFSET_SDHCI_MSM_ICE_CTRL_INFO_CDU;
+	/*
+	 * Configure data unit size of transfer request. Per-file data unit
+	 * numbers count 4KB pages and replace the LBA.
+	 */
+	if (ice_set.crypto_data.dun_valid) {
+		lba = ice_set.crypto_data.dun;
+		ctrl_info_val |=
+			(SDHCI_MSM_ICE_TR_DATA_UNIT_4_KB &
+			 MASK_SDHCI_MSM_ICE_CTRL_INFO_CDU)
+			 << OFFSET_SDHCI_MSM_ICE_CTRL_INFO_CDU;
+	} else {
+		ctrl_info_val |=
+			(SDHCI_MSM_ICE_TR_DATA_UNIT_512_B &
+			 MASK_SDHCI_MSM_ICE_CTRL_INFO_CDU)
+			 << OFFSET_SDHCI_MSM_ICE_CTRL_INFO_CDU;
+	}
 
 	/* Configure ICE bypass mode */
 	ctrl_info_val |=
@@ -197,10 +197,11 @@ static int count_this_packet(void *_hdr, int len)
 	return 1;
 }
 
-/* Rx Callback, Called in Work Queue context */
+/* Rx Callback, Called in the bam_dmux rx poll (softirq) context */
 static void bam_recv_notify(void *dev, struct sk_buff *skb)
 {
 	struct rmnet_private *p = netdev_priv(dev);
+	struct napi_struct *napi;
 	unsigned long flags;
 	u32 opmode;
 
@@ -231,7 +232,10 @@ static void bam_recv_notify(void *dev, struct sk_buff *skb)
 			p->stats.rx_packets, skb->len);
 
 		/* Deliver to network stack */
-		if (pkt_threshold == 1) {
+		napi = msm_bam_dmux_rx_napi();
+		if (napi) {
+			napi_gro_receive(napi, skb);
+		} else if (pkt_threshold == 1) {
 			netif_rx_ni(skb);
 		} else {
 			/* For every nth packet, use netif_rx_ni(). */
@@ -765,6 +769,9 @@ static void rmnet_setup(struct net_device *dev)
 	dev->mtu = RMNET_DATA_LEN;
 	dev->needed_headroom = HEADROOM_FOR_BAM + HEADROOM_FOR_QOS ;
 	dev->needed_tailroom = TAILROOM;
+	/* bam_dmux sends fragments as a descriptor chain */
+	dev->features |= NETIF_F_SG;
+	dev->hw_features |= NETIF_F_SG;
 	random_ether_addr(dev->dev_addr);
 
 	dev->watchdog_timeo = 1000; /* 10 seconds? */
@@ -16,6 +16,10 @@
 #include <linux/stacktrace.h>
 #include <linux/wcnss_wlan.h>
 #include <linux/spinlock.h>
+#include <linux/llist.h>
+#include <linux/hashtable.h>
+#include <linux/workqueue.h>
+#include <linux/mm.h>
 #ifdef	CONFIG_WCNSS_SKB_PRE_ALLOC
 #include <linux/skbuff.h>
 #endif
@@ -30,6 +34,7 @@ static DEFINE_SPINLOCK(alloc_lock);
 
 #define PRE_ALLOC_DEBUGFS_DIR		"cnss-prealloc"
 #define PRE_ALLOC_DEBUGFS_FILE_OBJ	"status"
+#define PRE_ALLOC_DEBUGFS_FILE_STATS	"stats"
 
 static struct dentry *debug_base;
 
@@ -53,81 +58,58 @@ static struct wcnss_prealloc wcnss_skb_allocs[] = {
 };
 #endif
 
-/* pre-alloced mem for WLAN driver */
-static struct wcnss_prealloc wcnss_allocs[] = {
-	{0, 8  * 1024, NULL},
-	{0, 8  * 1024, NULL},
-	{0, 8  * 1024, NULL},
-	{0, 8  * 1024, NULL},
-	{0, 8  * 1024, NULL},
-	{0, 8  * 1024, NULL},
-	{0, 8  * 1024, NULL},
-	{0, 8  * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 32 * 1024, NULL},
-	{0, 32 * 1024, NULL},
-	{0, 32 * 1024, NULL},
-	{0, 32 * 1024, NULL},
-	{0, 32 * 1024, NULL},
-	{0, 32 * 1024, NULL},
-	{0, 32 * 1024, NULL},
-	{0, 32 * 1024, NULL},
-	{0, 32 * 1024, NULL},
-	{0, 32 * 1024, NULL},
-	{0, 64 * 1024, NULL},
-	{0, 64 * 1024, NULL},
-	{0, 64 * 1024, NULL},
-	{0, 64 * 1024, NULL},
-	{0, 64 * 1024, NULL},
-	{0, 64 * 1024, NULL},
-	{0, 64 * 1024, NULL},
-	{0, 64 * 1024, NULL},
-	{0, 64 * 1024, NULL},
-	{0, 128 * 1024, NULL},
-	{0, 128 * 1024, NULL},
+/*
+ * Pre-alloced mem for WLAN driver, kept in one bucket per buffer size.
+ *
+ * Each bucket starts with nr_min buffers reserved at boot. When its free
+ * count drops below nr_low, a worker grows it up to nr_max; buffers beyond
+ * the boot reservation are given back through the shrinker when they are
+ * free. Buffers are returned to the free list without taking a lock, and
+ * wcnss_prealloc_put() finds them through an RCU hash keyed by address.
+ */
+struct wcnss_prealloc_bucket {
+	unsigned int size;
+	unsigned int nr_min;
+	unsigned int nr_low;
+	unsigned int nr_max;
+	spinlock_t lock;		/* free list consumers, entries list */
+	struct llist_head free;
+	struct list_head entries;
+	atomic_t nr_free;
+	atomic_t nr_total;
+	atomic_t hits;
+	atomic_t fallbacks;
+};
+
+struct wcnss_prealloc_entry {
+	struct llist_node free_node;
+	struct list_head list;
+	struct hlist_node hnode;
+	struct rcu_head rcu;
+	struct wcnss_prealloc_bucket *bucket;
+	struct wcnss_prealloc slot;
 };
 
+#define WCNSS_PREALLOC_BUCKET(_size, _min, _low, _max)	\
+	{ .size = (_size) * 1024, .nr_min = (_min),	\
+	  .nr_low = (_low), .nr_max = (_max) }
+
+static struct wcnss_prealloc_bucket wcnss_buckets[] = {
+	WCNSS_PREALLOC_BUCKET(8, 8, 2, 16),
+	WCNSS_PREALLOC_BUCKET(16, 42, 8, 64),
+	WCNSS_PREALLOC_BUCKET(32, 10, 2, 16),
+	WCNSS_PREALLOC_BUCKET(64, 9, 2, 12),
+	WCNSS_PREALLOC_BUCKET(128, 2, 1, 4),
+};
+
+#define WCNSS_PREALLOC_HASH_BITS	7
+static DEFINE_HASHTABLE(wcnss_prealloc_hash, WCNSS_PREALLOC_HASH_BITS);
+/* protects hash insertion/removal, lookups are RCU */
+static DEFINE_SPINLOCK(wcnss_prealloc_hash_lock);
+
+static void wcnss_prealloc_grow_work(struct work_struct *work);
+static DECLARE_WORK(wcnss_prealloc_grow, wcnss_prealloc_grow_work);
+
 #ifdef CONFIG_WCNSS_SKB_PRE_ALLOC
 int cnss_skb_prealloc_init(void)
 {
@@ -150,19 +132,160 @@ int cnss_skb_prealloc_init(void)
 }
 #endif
 
-int wcnss_prealloc_init(void)
+static int wcnss_prealloc_add(struct wcnss_prealloc_bucket *b)
 {
-	int i, ret;
+	struct wcnss_prealloc_entry *e;
+	unsigned long flags;
 
-	for (i = 0; i < ARRAY_SIZE(wcnss_allocs); i++) {
-		wcnss_allocs[i].occupied = 0;
-		wcnss_allocs[i].ptr = kmalloc(wcnss_allocs[i].size, GFP_KERNEL);
-		if (wcnss_allocs[i].ptr == NULL)
-			return -ENOMEM;
+	e = kzalloc(sizeof(*e), GFP_KERNEL);
+	if (!e)
+		return -ENOMEM;
+
+	e->bucket = b;
+	e->slot.size = b->size;
+	e->slot.ptr = kmalloc(b->size, GFP_KERNEL | __GFP_NOWARN);
+	if (!e->slot.ptr) {
+		kfree(e);
+		return -ENOMEM;
+	}
+
+	spin_lock_irqsave(&wcnss_prealloc_hash_lock, flags);
+	hash_add_rcu(wcnss_prealloc_hash, &e->hnode,
+		     (unsigned long)e->slot.ptr);
+	spin_unlock_irqrestore(&wcnss_prealloc_hash_lock, flags);
+
+	spin_lock_irqsave(&b->lock, flags);
+	list_add_tail(&e->list, &b->entries);
+	spin_unlock_irqrestore(&b->lock, flags);
+
+	atomic_inc(&b->nr_total);
+	atomic_inc(&b->nr_free);
+	llist_add(&e->free_node, &b->free);
+
+	return 0;
+}
+
+/* Caller has taken @e off the free list */
+static void wcnss_prealloc_remove(struct wcnss_prealloc_bucket *b,
+				  struct wcnss_prealloc_entry *e)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&wcnss_prealloc_hash_lock, flags);
+	hash_del_rcu(&e->hnode);
+	spin_unlock_irqrestore(&wcnss_prealloc_hash_lock, flags);
+
+	spin_lock_irqsave(&b->lock, flags);
+	list_del(&e->list);
+	spin_unlock_irqrestore(&b->lock, flags);
+
+	atomic_dec(&b->nr_total);
+	kfree(e->slot.ptr);
+	kfree_rcu(e, rcu);
+}
+
+static struct wcnss_prealloc_entry *
+wcnss_prealloc_pop(struct wcnss_prealloc_bucket *b)
+{
+	struct llist_node *node;
+	unsigned long flags;
+
+	/* llist_del_first() callers must be serialized */
+	spin_lock_irqsave(&b->lock, flags);
+	node = llist_del_first(&b->free);
+	spin_unlock_irqrestore(&b->lock, flags);
+	if (!node)
+		return NULL;
+
+	atomic_dec(&b->nr_free);
+	return llist_entry(node, struct wcnss_prealloc_entry, free_node);
+}
+
+static void wcnss_prealloc_grow_work(struct work_struct *work)
+{
+	struct wcnss_prealloc_bucket *b;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(wcnss_buckets); i++) {
+		b = &wcnss_buckets[i];
+		while (atomic_read(&b->nr_free) < b->nr_low &&
+		       atomic_read(&b->nr_total) < b->nr_max)
+			if (wcnss_prealloc_add(b))
+				break;
+	}
+}
+
+static unsigned long wcnss_prealloc_shrink_count(struct shrinker *shrink,
+						 struct shrink_control *sc)
+{
+	struct wcnss_prealloc_bucket *b;
+	unsigned long count = 0;
+	int excess, i;
+
+	for (i = 0; i < ARRAY_SIZE(wcnss_buckets); i++) {
+		b = &wcnss_buckets[i];
+		excess = min(atomic_read(&b->nr_free),
+			     atomic_read(&b->nr_total) - (int)b->nr_min);
+		if (excess > 0)
+			count += excess;
+	}
+
+	return count;
+}
+
+static unsigned long wcnss_prealloc_shrink_scan(struct shrinker *shrink,
+						struct shrink_control *sc)
+{
+	struct wcnss_prealloc_bucket *b;
+	struct wcnss_prealloc_entry *e;
+	unsigned long freed = 0;
+	int i;
+
+	/* largest buckets first, they give back the most memory */
+	for (i = ARRAY_SIZE(wcnss_buckets) - 1; i >= 0; i--) {
+		b = &wcnss_buckets[i];
+		while (freed < sc->nr_to_scan &&
+		       atomic_read(&b->nr_total) > b->nr_min) {
+			e = wcnss_prealloc_pop(b);
+			if (!e)
+				break;
+			wcnss_prealloc_remove(b, e);
+			freed++;
+		}
+	}
+
+	return freed ? freed : SHRINK_STOP;
+}
+
+static struct shrinker wcnss_prealloc_shrinker = {
+	.count_objects = wcnss_prealloc_shrink_count,
+	.scan_objects = wcnss_prealloc_shrink_scan,
+	.seeks = DEFAULT_SEEKS,
+};
+
+int wcnss_prealloc_init(void)
+{
+	struct wcnss_prealloc_bucket *b;
+	int i, j, ret;
+
+	for (i = 0; i < ARRAY_SIZE(wcnss_buckets); i++) {
+		b = &wcnss_buckets[i];
+		spin_lock_init(&b->lock);
+		init_llist_head(&b->free);
+		INIT_LIST_HEAD(&b->entries);
+		for (j = 0; j < b->nr_min; j++) {
+			ret = wcnss_prealloc_add(b);
+			if (ret)
+				return ret;
+		}
 	}
 	ret = cnss_skb_prealloc_init();
+	if (ret)
+		return ret;
 
-	return ret;
+	register_shrinker(&wcnss_prealloc_shrinker);
+
+	return 0;
 }
 
 #ifdef CONFIG_WCNSS_SKB_PRE_ALLOC
@@ -181,11 +304,19 @@ void cnss_skb_prealloc_deinit(void) {}
 
 void wcnss_prealloc_deinit(void)
 {
+	struct wcnss_prealloc_bucket *b;
+	struct wcnss_prealloc_entry *e, *tmp;
 	int i = 0;
 
-	for (i = 0; i < ARRAY_SIZE(wcnss_allocs); i++) {
-		kfree(wcnss_allocs[i].ptr);
-		wcnss_allocs[i].ptr = NULL;
+	unregister_shrinker(&wcnss_prealloc_shrinker);
+	cancel_work_sync(&wcnss_prealloc_grow);
+
+	for (i = 0; i < ARRAY_SIZE(wcnss_buckets); i++) {
+		b = &wcnss_buckets[i];
+		llist_del_all(&b->free);
+		list_for_each_entry_safe(e, tmp, &b->entries, list)
+			wcnss_prealloc_remove(b, e);
+		atomic_set(&b->nr_free, 0);
 	}
 
 	cnss_skb_prealloc_deinit();
@@ -215,26 +346,38 @@ static inline void wcnss_prealloc_save_stack_trace(struct wcnss_prealloc *entry)
 
 void *wcnss_prealloc_get(unsigned int size)
 {
+	struct wcnss_prealloc_bucket *b, *fit = NULL;
+	struct wcnss_prealloc_entry *e;
 	int i = 0;
-	unsigned long flags;
 
-	spin_lock_irqsave(&alloc_lock, flags);
-	for (i = 0; i < ARRAY_SIZE(wcnss_allocs); i++) {
-		if (wcnss_allocs[i].occupied)
+	/* smallest bucket that fits, larger ones if it ran dry */
+	for (i = 0; i < ARRAY_SIZE(wcnss_buckets); i++) {
+		b = &wcnss_buckets[i];
+		if (b->size < size)
 			continue;
+		if (!fit)
+			fit = b;
 
-		if (wcnss_allocs[i].size >= size) {
-			/* we found the slot */
-			wcnss_allocs[i].occupied = 1;
-			spin_unlock_irqrestore(&alloc_lock, flags);
-			wcnss_prealloc_save_stack_trace(&wcnss_allocs[i]);
-			return wcnss_allocs[i].ptr;
-		}
+		e = wcnss_prealloc_pop(b);
+		if (!e)
+			continue;
+
+		e->slot.occupied = 1;
+		atomic_inc(&fit->hits);
+		if (atomic_read(&fit->nr_free) < fit->nr_low &&
+		    atomic_read(&fit->nr_total) < fit->nr_max)
+			schedule_work(&wcnss_prealloc_grow);
+		wcnss_prealloc_save_stack_trace(&e->slot);
+		return e->slot.ptr;
 	}
-	spin_unlock_irqrestore(&alloc_lock, flags);
 
-	pr_err("wcnss: %s: prealloc not available for size: %d\n",
-			__func__, size);
+	if (fit) {
+		atomic_inc(&fit->fallbacks);
+		schedule_work(&wcnss_prealloc_grow);
+	}
+
+	pr_err_ratelimited("wcnss: %s: prealloc not available for size: %d\n",
+			   __func__, size);
 
 	return NULL;
 }
@@ -242,20 +385,27 @@ EXPORT_SYMBOL(wcnss_prealloc_get);
 
 int wcnss_prealloc_put(void *ptr)
 {
-	int i = 0;
-	unsigned long flags;
+	struct wcnss_prealloc_entry *e;
+	struct wcnss_prealloc_bucket *b;
+	int ret = 0;
+
+	rcu_read_lock();
+	hash_for_each_possible_rcu(wcnss_prealloc_hash, e, hnode,
+				   (unsigned long)ptr) {
+		if (e->slot.ptr != ptr)
+			continue;
 
-	spin_lock_irqsave(&alloc_lock, flags);
-	for (i = 0; i < ARRAY_SIZE(wcnss_allocs); i++) {
-		if (wcnss_allocs[i].ptr == ptr) {
-			wcnss_allocs[i].occupied = 0;
-			spin_unlock_irqrestore(&alloc_lock, flags);
-			return 1;
-		}
+		ret = 1;
+		if (!xchg(&e->slot.occupied, 0))
+			break;
+		b = e->bucket;
+		llist_add(&e->free_node, &b->free);
+		atomic_inc(&b->nr_free);
+		break;
 	}
-	spin_unlock_irqrestore(&alloc_lock, flags);
+	rcu_read_unlock();
 
-	return 0;
+	return ret;
 }
 EXPORT_SYMBOL(wcnss_prealloc_put);
 
@@ -274,7 +424,7 @@ struct sk_buff *wcnss_skb_prealloc_get(unsigned int size)
 			/* we found the slot */
 			wcnss_skb_allocs[i].occupied = 1;
 			spin_unlock_irqrestore(&alloc_lock, flags);
-			wcnss_prealloc_save_stack_trace(&wcnss_allocs[i]);
+			wcnss_prealloc_save_stack_trace(&wcnss_skb_allocs[i]);
 			return wcnss_skb_allocs[i].ptr;
 		}
 	}
@@ -310,21 +460,29 @@ EXPORT_SYMBOL(wcnss_skb_prealloc_put);
 #ifdef CONFIG_SLUB_DEBUG
 void wcnss_prealloc_check_memory_leak(void)
 {
+	struct wcnss_prealloc_bucket *b;
+	struct wcnss_prealloc_entry *e;
+	unsigned long flags;
 	int i;
 	bool leak_detected = false;
 
-	for (i = 0; i < ARRAY_SIZE(wcnss_allocs); i++) {
-		if (!wcnss_allocs[i].occupied)
-			continue;
+	for (i = 0; i < ARRAY_SIZE(wcnss_buckets); i++) {
+		b = &wcnss_buckets[i];
+		spin_lock_irqsave(&b->lock, flags);
+		list_for_each_entry(e, &b->entries, list) {
+			if (!e->slot.occupied)
+				continue;
 
-		if (!leak_detected) {
-			pr_err("wcnss_prealloc: Memory leak detected\n");
-			leak_detected = true;
-		}
+			if (!leak_detected) {
+				pr_err("wcnss_prealloc: Memory leak detected\n");
+				leak_detected = true;
+			}
 
-		pr_err("Size: %u, addr: %pK, backtrace:\n",
-				wcnss_allocs[i].size, wcnss_allocs[i].ptr);
-		print_stack_trace(&wcnss_allocs[i].trace, 1);
+			pr_err("Size: %u, addr: %pK, backtrace:\n",
+					e->slot.size, e->slot.ptr);
+			print_stack_trace(&e->slot.trace, 1);
+		}
+		spin_unlock_irqrestore(&b->lock, flags);
 	}
 
 }
@@ -381,14 +539,23 @@ int wcnss_skb_pre_alloc_reset(void)
 
 int wcnss_pre_alloc_reset(void)
 {
+	struct wcnss_prealloc_bucket *b;
+	struct wcnss_prealloc_entry *e;
+	unsigned long flags;
 	int i, n = 0;
 
-	for (i = 0; i < ARRAY_SIZE(wcnss_allocs); i++) {
-		if (!wcnss_allocs[i].occupied)
-			continue;
+	for (i = 0; i < ARRAY_SIZE(wcnss_buckets); i++) {
+		b = &wcnss_buckets[i];
+		spin_lock_irqsave(&b->lock, flags);
+		list_for_each_entry(e, &b->entries, list) {
+			if (!xchg(&e->slot.occupied, 0))
+				continue;
 
-		wcnss_allocs[i].occupied = 0;
-		n++;
+			llist_add(&e->free_node, &b->free);
+			atomic_inc(&b->nr_free);
+			n++;
+		}
+		spin_unlock_irqrestore(&b->lock, flags);
 	}
 
 	return n;
@@ -396,34 +563,21 @@ int wcnss_pre_alloc_reset(void)
 
 int prealloc_memory_stats_show(struct seq_file *fp, void *data)
 {
+	struct wcnss_prealloc_bucket *b;
 	int i = 0;
-	int used_slots = 0, free_slots = 0;
-	unsigned int tsize = 0, tused = 0, size = 0;
+	int used_slots, free_slots;
+	unsigned int tsize = 0, tused = 0;
 
 	seq_puts(fp, "\nSlot_Size(Kb)\t\t[Used : Free]\n");
-	for (i = 0; i < ARRAY_SIZE(wcnss_allocs); i++) {
-		tsize += wcnss_allocs[i].size;
-		if (size != wcnss_allocs[i].size) {
-			if (size) {
-				seq_printf(
-					fp, "[%d : %d]\n",
-					used_slots, free_slots);
-			}
-
-			size = wcnss_allocs[i].size;
-			used_slots = 0;
-			free_slots = 0;
-			seq_printf(fp, "%d Kb\t\t\t", size / 1024);
-		}
-
-		if (wcnss_allocs[i].occupied) {
-			tused += wcnss_allocs[i].size;
-			++used_slots;
-		} else {
-			++free_slots;
-		}
+	for (i = 0; i < ARRAY_SIZE(wcnss_buckets); i++) {
+		b = &wcnss_buckets[i];
+		free_slots = atomic_read(&b->nr_free);
+		used_slots = atomic_read(&b->nr_total) - free_slots;
+		seq_printf(fp, "%d Kb\t\t\t[%d : %d]\n", b->size / 1024,
+			   used_slots, free_slots);
+		tsize += (used_slots + free_slots) * b->size;
+		tused += used_slots * b->size;
 	}
-	seq_printf(fp, "[%d : %d]\n", used_slots, free_slots);
 
 	/* Convert byte to Kb */
 	if (tsize)
@@ -436,6 +590,41 @@ int prealloc_memory_stats_show(struct seq_file *fp, void *data)
 	return 0;
 }
 
+static int prealloc_bucket_stats_show(struct seq_file *fp, void *data)
+{
+	struct wcnss_prealloc_bucket *b;
+	unsigned int hits, fallbacks;
+	int i;
+
+	seq_puts(fp, "Size(Kb)\tTotal\tMin\tMax\tHits\tFallbacks\tHit%\n");
+	for (i = 0; i < ARRAY_SIZE(wcnss_buckets); i++) {
+		b = &wcnss_buckets[i];
+		hits = atomic_read(&b->hits);
+		fallbacks = atomic_read(&b->fallbacks);
+		seq_printf(fp, "%u\t\t%d\t%u\t%u\t%u\t%u\t\t%u\n",
+			   b->size / 1024, atomic_read(&b->nr_total),
+			   b->nr_min, b->nr_max, hits, fallbacks,
+			   (hits + fallbacks) ?
+			   (unsigned int)div_u64(100ULL * hits,
+						 hits + fallbacks) : 100);
+	}
+
+	return 0;
+}
+
+static int prealloc_bucket_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, prealloc_bucket_stats_show, NULL);
+}
+
+static const struct file_operations prealloc_bucket_stats_fops = {
+	.owner = THIS_MODULE,
+	.open = prealloc_bucket_stats_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 int prealloc_memory_stats_open(struct inode *inode, struct file *file)
 {
 	return single_open(file, prealloc_memory_stats_show, NULL);
@@ -465,7 +654,11 @@ static int __init wcnss_pre_alloc_init(void)
 	} else if (IS_ERR_OR_NULL(debugfs_create_file(
 			PRE_ALLOC_DEBUGFS_FILE_OBJ,
 			0644, debug_base, NULL,
-			&prealloc_memory_stats_fops))) {
+			&prealloc_memory_stats_fops)) ||
+		   IS_ERR_OR_NULL(debugfs_create_file(
+			PRE_ALLOC_DEBUGFS_FILE_STATS,
+			0444, debug_base, NULL,
+			&prealloc_bucket_stats_fops))) {
 		pr_err("%s: Failed to create debugfs file\n", __func__);
 		debugfs_remove_recursive(debug_base);
 	}
@@ -153,6 +153,9 @@
 #define IPA_IOC_NAT_DMA32 _IOWR(IPA_IOC_MAGIC, \
 				IPA_IOCTL_NAT_DMA, \
 				compat_uptr_t)
+#define IPA_IOC_NAT_GET_TIMESTAMPS32 _IOWR(IPA_IOC_MAGIC, \
+				IPA_IOCTL_NAT_GET_TIMESTAMPS, \
+				compat_uptr_t)
 #define IPA_IOC_V4_DEL_NAT32 _IOWR(IPA_IOC_MAGIC, \
 				IPA_IOCTL_V4_DEL_NAT, \
 				compat_uptr_t)
@@ -860,6 +863,52 @@ static long ipa3_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 		}
 		break;
 
+	case IPA_IOC_NAT_GET_TIMESTAMPS:
+		if (copy_from_user(header, (u8 *)arg,
+					sizeof(struct ipa_ioc_nat_get_ts))) {
+			retval = -EFAULT;
+			break;
+		}
+		pre_entry =
+			((struct ipa_ioc_nat_get_ts *)header)->entries;
+		if (pre_entry > IPA_NAT_MAX_TS_ENTRIES) {
+			IPAERR_RL("too many entries %d\n", pre_entry);
+			retval = -EINVAL;
+			break;
+		}
+		pyld_sz =
+		   sizeof(struct ipa_ioc_nat_get_ts) +
+		   pre_entry * sizeof(struct ipa_ioc_nat_ts_one);
+		param = kzalloc(pyld_sz, GFP_KERNEL);
+		if (!param) {
+			retval = -ENOMEM;
+			break;
+		}
+
+		if (copy_from_user(param, (u8 *)arg, pyld_sz)) {
+			retval = -EFAULT;
+			break;
+		}
+		/* add check in case user-space module compromised */
+		if (unlikely(((struct ipa_ioc_nat_get_ts *)param)->entries
+			!= pre_entry)) {
+			IPAERR_RL("current %d pre %d\n",
+				((struct ipa_ioc_nat_get_ts *)param)->entries,
+				pre_entry);
+			retval = -EINVAL;
+			break;
+		}
+		if (ipa3_nat_get_timestamps(
+			(struct ipa_ioc_nat_get_ts *)param)) {
+			retval = -EFAULT;
+			break;
+		}
+		if (copy_to_user((u8 *)arg, param, pyld_sz)) {
+			retval = -EFAULT;
+			break;
+		}
+		break;
+
 	case IPA_IOC_V4_DEL_NAT:
 		if (copy_from_user((u8 *)&nat_del, (u8 *)arg,
 					sizeof(struct ipa_ioc_v4_nat_del))) {
@@ -1348,6 +1397,9 @@ static long ipa3_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 	case IPA_IOC_RESET_FLT:
 		retval = ipa3_reset_flt(arg);
 		break;
+	case IPA_IOC_COMMIT_FLT_RT:
+		retval = ipa3_commit_flt_rt();
+		break;
 	case IPA_IOC_GET_RT_TBL:
 		if (copy_from_user(header, (u8 *)arg,
 					sizeof(struct ipa_ioc_get_rt_tbl))) {
@@ -3476,6 +3528,9 @@ ret:
 	case IPA_IOC_NAT_DMA32:
 		cmd = IPA_IOC_NAT_DMA;
 		break;
+	case IPA_IOC_NAT_GET_TIMESTAMPS32:
+		cmd = IPA_IOC_NAT_GET_TIMESTAMPS;
+		break;
 	case IPA_IOC_V4_DEL_NAT32:
 		cmd = IPA_IOC_V4_DEL_NAT;
 		break;
@@ -3524,6 +3579,7 @@ ret:
 	case IPA_IOC_RESET_RT:
 	case IPA_IOC_COMMIT_FLT:
 	case IPA_IOC_RESET_FLT:
+	case IPA_IOC_COMMIT_FLT_RT:
 	case IPA_IOC_DUMP:
 	case IPA_IOC_PUT_RT_TBL:
 	case IPA_IOC_PUT_HDR:
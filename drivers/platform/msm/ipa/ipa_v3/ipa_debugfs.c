@@ -110,6 +110,7 @@ static struct dentry *dfile_ntn_stats;
 static struct dentry *dfile_dbg_cnt;
 static struct dentry *dfile_msg;
 static struct dentry *dfile_ip4_nat;
+static struct dentry *dfile_ip4_nat_stats;
 static struct dentry *dfile_rm_stats;
 static struct dentry *dfile_status_stats;
 static struct dentry *dfile_active_clients;
@@ -958,6 +959,9 @@ static ssize_t ipa3_read_stats(struct file *file, char __user *ubuf,
 		"wan_repl_rx_empty=%u\n"
 		"lan_rx_empty=%u\n"
 		"lan_repl_rx_empty=%u\n"
+		"wan_rx_page_hit=%u\n"
+		"wan_rx_page_miss=%u\n"
+		"wan_rx_page_hit_rate=%u%%\n"
 		"flow_enable=%u\n"
 		"flow_disable=%u\n",
 		ipa3_ctx->stats.tx_sw_pkts,
@@ -974,6 +978,13 @@ static ssize_t ipa3_read_stats(struct file *file, char __user *ubuf,
 		ipa3_ctx->stats.wan_repl_rx_empty,
 		ipa3_ctx->stats.lan_rx_empty,
 		ipa3_ctx->stats.lan_repl_rx_empty,
+		ipa3_ctx->stats.wan_rx_page_hit,
+		ipa3_ctx->stats.wan_rx_page_miss,
+		(ipa3_ctx->stats.wan_rx_page_hit +
+		 ipa3_ctx->stats.wan_rx_page_miss) ?
+		(u32)div_u64((u64)ipa3_ctx->stats.wan_rx_page_hit * 100,
+			ipa3_ctx->stats.wan_rx_page_hit +
+			ipa3_ctx->stats.wan_rx_page_miss) : 0,
 		ipa3_ctx->stats.flow_enable,
 		ipa3_ctx->stats.flow_disable);
 	cnt += nbytes;
@@ -1584,6 +1595,61 @@ static ssize_t ipa3_read_nat4(struct file *file,
 	return 0;
 }
 
+static ssize_t ipa3_read_nat4_stats(struct file *file,
+		char __user *ubuf, size_t count,
+		loff_t *ppos)
+{
+	u32 *tbl;
+	u32 i, tbl_size;
+	u32 base_used = 0, expn_used = 0, chained = 0;
+	int nbytes, cnt = 0;
+
+	if (!ipa3_ctx->nat_mem.is_sys_mem ||
+		!ipa3_ctx->nat_mem.ipv4_rules_addr) {
+		nbytes = scnprintf(dbg_buff, IPA_MAX_MSG_LEN,
+			"Not supported for local(shared) memory\n");
+		cnt += nbytes;
+		goto print_cmds;
+	}
+
+	tbl_size = ipa3_ctx->nat_mem.size_base_tables + 1;
+	tbl = (u32 *)ipa3_ctx->nat_mem.ipv4_rules_addr;
+	for (i = 0; i < tbl_size; i++, tbl += ENTRY_U32_FIELDS) {
+		if (!((tbl[4] >> 16) & NAT_ENTRY_ENABLE))
+			continue;
+		base_used++;
+		/* a next index in the base table means a hash collision */
+		if (tbl[2] & 0x0000FFFF)
+			chained++;
+	}
+
+	tbl = (u32 *)ipa3_ctx->nat_mem.ipv4_expansion_rules_addr;
+	for (i = 0; tbl && i < ipa3_ctx->nat_mem.size_expansion_tables;
+		i++, tbl += ENTRY_U32_FIELDS) {
+		if ((tbl[4] >> 16) & NAT_ENTRY_ENABLE)
+			expn_used++;
+	}
+
+	nbytes = scnprintf(dbg_buff, IPA_MAX_MSG_LEN,
+		"base_entries=%u/%u\n"
+		"expn_entries=%u/%u\n"
+		"chained_buckets=%u\n",
+		base_used, tbl_size,
+		expn_used, ipa3_ctx->nat_mem.size_expansion_tables,
+		chained);
+	cnt += nbytes;
+
+print_cmds:
+	nbytes = scnprintf(dbg_buff + cnt, IPA_MAX_MSG_LEN - cnt,
+		"nat_dma_cmds=%u\n"
+		"nat_dma_batches=%u\n",
+		ipa3_ctx->stats.nat_dma_cmds,
+		ipa3_ctx->stats.nat_dma_batches);
+	cnt += nbytes;
+
+	return simple_read_from_buffer(ubuf, count, ppos, dbg_buff, cnt);
+}
+
 static ssize_t ipa3_rm_read_stats(struct file *file, char __user *ubuf,
 		size_t count, loff_t *ppos)
 {
@@ -1820,6 +1886,10 @@ const struct file_operations ipa3_nat4_ops = {
 	.read = ipa3_read_nat4,
 };
 
+const struct file_operations ipa3_nat4_stats_ops = {
+	.read = ipa3_read_nat4_stats,
+};
+
 const struct file_operations ipa3_rm_stats = {
 	.read = ipa3_rm_read_stats,
 };
@@ -2015,6 +2085,13 @@ void ipa3_debugfs_init(void)
 		goto fail;
 	}
 
+	dfile_ip4_nat_stats = debugfs_create_file("ip4_nat_stats",
+			read_only_mode, dent, 0, &ipa3_nat4_stats_ops);
+	if (!dfile_ip4_nat_stats || IS_ERR(dfile_ip4_nat_stats)) {
+		IPAERR("fail to create file for debug_fs ip4 nat stats\n");
+		goto fail;
+	}
+
 	dfile_rm_stats = debugfs_create_file("rm_stats",
 			read_only_mode, dent, 0, &ipa3_rm_stats);
 	if (!dfile_rm_stats || IS_ERR(dfile_rm_stats)) {
@@ -72,6 +72,11 @@
 
 #define IPA_TX_SEND_COMPL_NOP_DELAY_NS (2 * 1000 * 1000)
 
+/* pages per RX descriptor, covers the ring plus the replenish cache */
+#define IPA_RX_PAGE_POOL_FACTOR 2
+/* pool entries looked at for a free page before falling back */
+#define IPA_RX_PAGE_POOL_SCAN 8
+
 static struct sk_buff *ipa3_get_skb_ipa_rx(unsigned int len, gfp_t flags);
 static void ipa3_replenish_wlan_rx_cache(struct ipa3_sys_context *sys);
 static void ipa3_replenish_rx_cache(struct ipa3_sys_context *sys);
@@ -85,6 +90,8 @@ static void ipa3_wlan_wq_rx_common(struct ipa3_sys_context *sys,
 static int ipa3_assign_policy(struct ipa_sys_connect_params *in,
 		struct ipa3_sys_context *sys);
 static void ipa3_cleanup_rx(struct ipa3_sys_context *sys);
+static void ipa3_rx_page_pool_init(struct ipa3_sys_context *sys);
+static void ipa3_rx_page_pool_destroy(struct ipa3_sys_context *sys);
 static void ipa3_wq_rx_avail(struct work_struct *work);
 static void ipa3_alloc_wlan_rx_common_cache(u32 size);
 static void ipa3_cleanup_wlan_rx_common_cache(void);
@@ -901,8 +908,12 @@ static int ipa3_handle_rx_core(struct ipa3_sys_context *sys, bool process_all,
 
 /**
  * ipa3_rx_switch_to_intr_mode() - Operate the Rx data path in interrupt mode
+ *
+ * Return codes:
+ * 0: the pipe is in interrupt mode
+ * -EAGAIN: switching failed and is retried from switch_to_intr_work
  */
-static void ipa3_rx_switch_to_intr_mode(struct ipa3_sys_context *sys)
+static int ipa3_rx_switch_to_intr_mode(struct ipa3_sys_context *sys)
 {
 	int ret;
 
@@ -928,7 +939,7 @@ static void ipa3_rx_switch_to_intr_mode(struct ipa3_sys_context *sys)
 		if (!atomic_read(&sys->curr_polling_state) &&
 			((sys->ep->connect.options & SPS_O_EOT) == SPS_O_EOT)) {
 			IPADBG("already in intr mode\n");
-			return;
+			return 0;
 		}
 		if (!atomic_read(&sys->curr_polling_state)) {
 			IPAERR("already in intr mode\n");
@@ -951,11 +962,37 @@ static void ipa3_rx_switch_to_intr_mode(struct ipa3_sys_context *sys)
 		ipa3_handle_rx_core(sys, true, false);
 		ipa3_dec_release_wakelock();
 	}
-	return;
+	return 0;
 
 fail:
 	queue_delayed_work(sys->wq, &sys->switch_to_intr_work,
 			msecs_to_jiffies(1));
+	return -EAGAIN;
+}
+
+/**
+ * ipa3_rx_start_poll() - Start polling a pipe that entered polling mode
+ * @sys: system pipe context
+ *
+ * Pipes set up with napi_enabled ask their client to schedule its NAPI poll,
+ * holding a clock vote until the pipe is back in interrupt mode. Called from
+ * interrupt context, so the vote cannot block: if the clocks are being gated
+ * the packets are handled from the work queue like on other pipes.
+ */
+static void ipa3_rx_start_poll(struct ipa3_sys_context *sys)
+{
+	struct ipa_active_client_logging_info log_info;
+
+	if (sys->napi_enabled) {
+		IPA_ACTIVE_CLIENTS_PREP_SPECIAL(log_info, "NAPI");
+		if (!ipa3_inc_client_enable_clks_no_block(&log_info)) {
+			sys->napi_clk_vote = true;
+			sys->ep->client_notify(sys->ep->priv,
+				IPA_CLIENT_START_POLL, 0);
+			return;
+		}
+	}
+	queue_work(sys->wq, &sys->work);
 }
 
 /**
@@ -1000,7 +1037,7 @@ static void ipa3_sps_irq_rx_notify(struct sps_event_notify *notify)
 			ipa3_inc_acquire_wakelock();
 			atomic_set(&sys->curr_polling_state, 1);
 			trace_intr_to_poll3(sys->ep->client);
-			queue_work(sys->wq, &sys->work);
+			ipa3_rx_start_poll(sys);
 		}
 		break;
 	default:
@@ -1070,9 +1107,62 @@ static void ipa3_switch_to_intr_rx_work_func(struct work_struct *work)
 
 	dwork = container_of(work, struct delayed_work, work);
 	sys = container_of(dwork, struct ipa3_sys_context, switch_to_intr_work);
+
+	if (sys->napi_clk_vote) {
+		/* cleared first, the next interrupt may already start a poll */
+		sys->napi_clk_vote = false;
+		if (ipa3_rx_switch_to_intr_mode(sys)) {
+			sys->napi_clk_vote = true;
+			return;
+		}
+		IPA_ACTIVE_CLIENTS_DEC_SPECIAL("NAPI");
+		return;
+	}
+
 	ipa3_handle_rx(sys);
 }
 
+/**
+ * ipa3_rx_poll() - Poll a pipe from the NAPI context of its client
+ * @clnt_hdl: [in] client handle of a pipe set up with napi_enabled
+ * @weight: [in] NAPI budget
+ *
+ * Handles up to @weight received buffers. When the budget is not used up the
+ * client is told to complete NAPI and the pipe goes back to interrupt mode.
+ *
+ * Returns: number of buffers handled
+ */
+int ipa3_rx_poll(u32 clnt_hdl, int weight)
+{
+	struct ipa3_sys_context *sys;
+	int cnt = 0;
+
+	if (clnt_hdl >= ipa3_ctx->ipa_num_pipes ||
+	    ipa3_ctx->ep[clnt_hdl].valid == 0) {
+		IPAERR("bad parm 0x%x\n", clnt_hdl);
+		return 0;
+	}
+	sys = ipa3_ctx->ep[clnt_hdl].sys;
+
+	while (cnt < weight && atomic_read(&sys->curr_polling_state)) {
+		if (!ipa3_handle_rx_core(sys, false, true))
+			break;
+		cnt++;
+
+		/* no point polling a pipe that is out of buffers */
+		if (sys->len - sys->len_pending_xfer == 0)
+			break;
+	}
+
+	if (cnt < weight) {
+		sys->ep->client_notify(sys->ep->priv, IPA_CLIENT_COMP_NAPI, 0);
+		trace_poll_to_intr3(sys->ep->client);
+		queue_delayed_work(sys->wq, &sys->switch_to_intr_work, 0);
+	}
+
+	return cnt;
+}
+
 enum hrtimer_restart ipa3_ring_doorbell_timer_fn(struct hrtimer *param)
 {
 	struct ipa3_sys_context *sys = container_of(param,
@@ -1187,6 +1277,8 @@ int ipa3_setup_sys_pipe(struct ipa_sys_connect_params *sys_in, u32 *clnt_hdl)
 	ep->client_notify = sys_in->notify;
 	ep->priv = sys_in->priv;
 	ep->keep_ipa_awake = sys_in->keep_ipa_awake;
+	ep->sys->napi_enabled = sys_in->napi_enabled &&
+		IPA_CLIENT_IS_CONS(sys_in->client);
 	atomic_set(&ep->avail_fifo_desc,
 		((sys_in->desc_fifo_sz/sizeof(struct sps_iovec))-1));
 
@@ -1299,6 +1391,9 @@ int ipa3_setup_sys_pipe(struct ipa_sys_connect_params *sys_in, u32 *clnt_hdl)
 
 	*clnt_hdl = ipa_ep_idx;
 
+	if (sys_in->client == IPA_CLIENT_APPS_WAN_CONS)
+		ipa3_rx_page_pool_init(ep->sys);
+
 	if (ep->sys->repl_hdlr == ipa3_fast_replenish_rx_cache) {
 		ep->sys->repl.capacity = ep->sys->rx_pool_sz + 1;
 		ep->sys->repl.cache = kzalloc(ep->sys->repl.capacity *
@@ -1475,8 +1570,15 @@ int ipa3_teardown_sys_pipe(u32 clnt_hdl)
 	}
 	if (ep->sys->repl_wq)
 		flush_workqueue(ep->sys->repl_wq);
-	if (IPA_CLIENT_IS_CONS(ep->client))
+	if (IPA_CLIENT_IS_CONS(ep->client)) {
 		ipa3_cleanup_rx(ep->sys);
+		ipa3_rx_page_pool_destroy(ep->sys);
+	}
+
+	if (ep->sys->napi_clk_vote) {
+		ep->sys->napi_clk_vote = false;
+		IPA_ACTIVE_CLIENTS_DEC_SPECIAL("NAPI");
+	}
 
 	if (!ep->skip_ep_cfg && IPA_CLIENT_IS_PROD(ep->client)) {
 		if (ipa3_ctx->modem_cfg_emb_pipe_flt &&
@@ -1790,6 +1892,156 @@ static void ipa3_wq_handle_rx(struct work_struct *work)
 	ipa3_handle_rx(sys);
 }
 
+/**
+ * ipa3_rx_page_pool_init() - allocate the RX page pool of a pipe
+ * @sys: system pipe context
+ *
+ * Pages are allocated and DMA mapped once here. Buffers handed to the
+ * hardware are built around them and the pages are reused once the stack
+ * has released every skb referring to them. A pipe without a pool (failed
+ * allocation) uses regular skbs only.
+ */
+static void ipa3_rx_page_pool_init(struct ipa3_sys_context *sys)
+{
+	struct ipa3_rx_page_pool *pool = &sys->page_pool;
+	struct page *page;
+	dma_addr_t dma_addr;
+	u32 size;
+	u32 i;
+
+	spin_lock_init(&pool->lock);
+	pool->order = get_order(IPA_REAL_GENERIC_RX_BUFF_SZ(sys->rx_buff_sz));
+	size = sys->rx_pool_sz * IPA_RX_PAGE_POOL_FACTOR;
+	pool->pages = kcalloc(size, sizeof(*pool->pages), GFP_KERNEL);
+	if (!pool->pages) {
+		IPAERR("fail to alloc rx page pool\n");
+		return;
+	}
+
+	for (i = 0; i < size; i++) {
+		page = alloc_pages(GFP_KERNEL | __GFP_COMP | __GFP_NOWARN,
+				   pool->order);
+		if (!page)
+			break;
+		dma_addr = dma_map_page(ipa3_ctx->pdev, page, NET_SKB_PAD,
+					sys->rx_buff_sz, DMA_FROM_DEVICE);
+		if (dma_mapping_error(ipa3_ctx->pdev, dma_addr)) {
+			__free_pages(page, pool->order);
+			break;
+		}
+		pool->pages[i].page = page;
+		pool->pages[i].dma_addr = dma_addr;
+	}
+	pool->size = i;
+	pool->next = 0;
+
+	if (!pool->size) {
+		kfree(pool->pages);
+		pool->pages = NULL;
+	}
+	IPADBG("rx page pool of %u order %u pages\n", pool->size, pool->order);
+}
+
+/**
+ * ipa3_rx_page_pool_destroy() - release the RX page pool of a pipe
+ * @sys: system pipe context
+ *
+ * Pages still referenced by skbs in the stack are freed by the stack.
+ */
+static void ipa3_rx_page_pool_destroy(struct ipa3_sys_context *sys)
+{
+	struct ipa3_rx_page_pool *pool = &sys->page_pool;
+	u32 i;
+
+	if (!pool->pages)
+		return;
+
+	for (i = 0; i < pool->size; i++) {
+		dma_unmap_page(ipa3_ctx->pdev, pool->pages[i].dma_addr,
+			       sys->rx_buff_sz, DMA_FROM_DEVICE);
+		put_page(pool->pages[i].page);
+	}
+	kfree(pool->pages);
+	pool->pages = NULL;
+	pool->size = 0;
+}
+
+/**
+ * ipa3_rx_page_pool_get() - build an RX buffer around a recycled page
+ * @sys: system pipe context
+ * @rx_pkt: wrapper to fill in
+ *
+ * Return codes:
+ * 0: @rx_pkt holds an skb built around a pool page
+ * -ENOMEM: no pool page is free, the caller allocates a regular skb
+ */
+static int ipa3_rx_page_pool_get(struct ipa3_sys_context *sys,
+	struct ipa3_rx_pkt_wrapper *rx_pkt)
+{
+	struct ipa3_rx_page_pool *pool = &sys->page_pool;
+	struct ipa3_rx_page *p = NULL;
+	struct sk_buff *skb;
+	u32 idx;
+	u32 i;
+
+	if (!pool->pages)
+		return -ENOMEM;
+
+	spin_lock_bh(&pool->lock);
+	for (i = 0; i < IPA_RX_PAGE_POOL_SCAN && i < pool->size; i++) {
+		idx = (pool->next + i) % pool->size;
+		if (page_count(pool->pages[idx].page) == 1) {
+			p = &pool->pages[idx];
+			get_page(p->page);
+			pool->next = (idx + 1) % pool->size;
+			break;
+		}
+	}
+	spin_unlock_bh(&pool->lock);
+
+	if (!p)
+		goto miss;
+
+	skb = build_skb(page_address(p->page), PAGE_SIZE << pool->order);
+	if (!skb) {
+		put_page(p->page);
+		goto miss;
+	}
+	skb_reserve(skb, NET_SKB_PAD);
+	skb_put(skb, sys->rx_buff_sz);
+
+	/* drop whatever the stack left in the cache on the way back */
+	dma_sync_single_for_device(ipa3_ctx->pdev, p->dma_addr,
+				   sys->rx_buff_sz, DMA_FROM_DEVICE);
+	rx_pkt->data.skb = skb;
+	rx_pkt->data.dma_addr = p->dma_addr;
+	rx_pkt->from_page_pool = true;
+	IPA_STATS_INC_CNT(ipa3_ctx->stats.wan_rx_page_hit);
+	return 0;
+
+miss:
+	IPA_STATS_INC_CNT(ipa3_ctx->stats.wan_rx_page_miss);
+	return -ENOMEM;
+}
+
+/**
+ * ipa3_rx_buff_unmap() - make a received buffer accessible to the CPU
+ * @sys: system pipe context
+ * @rx_pkt: wrapper of the buffer
+ *
+ * Pool pages stay mapped for their next use and are only synced.
+ */
+static void ipa3_rx_buff_unmap(struct ipa3_sys_context *sys,
+	struct ipa3_rx_pkt_wrapper *rx_pkt)
+{
+	if (rx_pkt->from_page_pool)
+		dma_sync_single_for_cpu(ipa3_ctx->pdev, rx_pkt->data.dma_addr,
+					sys->rx_buff_sz, DMA_FROM_DEVICE);
+	else
+		dma_unmap_single(ipa3_ctx->pdev, rx_pkt->data.dma_addr,
+				 sys->rx_buff_sz, DMA_FROM_DEVICE);
+}
+
 static void ipa3_wq_repl_rx(struct work_struct *work)
 {
 	struct ipa3_sys_context *sys;
@@ -1820,6 +2072,9 @@ begin:
 		INIT_WORK(&rx_pkt->work, ipa3_wq_rx_avail);
 		rx_pkt->sys = sys;
 
+		if (!ipa3_rx_page_pool_get(sys, rx_pkt))
+			goto add_to_cache;
+
 		rx_pkt->data.skb = sys->get_skb(sys->rx_buff_sz, flag);
 		if (rx_pkt->data.skb == NULL) {
 			pr_err_ratelimited("%s fail alloc skb sys=%p\n",
@@ -1837,6 +2092,7 @@ begin:
 			goto fail_dma_mapping;
 		}
 
+add_to_cache:
 		sys->repl.cache[curr] = rx_pkt;
 		curr = next;
 		/* ensure write is done before setting tail index */
@@ -2065,6 +2321,9 @@ static void ipa3_replenish_rx_cache(struct ipa3_sys_context *sys)
 		INIT_WORK(&rx_pkt->work, ipa3_wq_rx_avail);
 		rx_pkt->sys = sys;
 
+		if (!ipa3_rx_page_pool_get(sys, rx_pkt))
+			goto queue_rx_pkt;
+
 		rx_pkt->data.skb = sys->get_skb(sys->rx_buff_sz, flag);
 		if (rx_pkt->data.skb == NULL) {
 			IPAERR("failed to alloc skb\n");
@@ -2080,6 +2339,7 @@ static void ipa3_replenish_rx_cache(struct ipa3_sys_context *sys)
 			goto fail_dma_mapping;
 		}
 
+queue_rx_pkt:
 		list_add_tail(&rx_pkt->link, &sys->head_desc_list);
 		rx_len_cached = ++sys->len;
 
@@ -2127,8 +2387,7 @@ static void ipa3_replenish_rx_cache(struct ipa3_sys_context *sys)
 fail_provide_rx_buffer:
 	list_del(&rx_pkt->link);
 	rx_len_cached = --sys->len;
-	dma_unmap_single(ipa3_ctx->pdev, rx_pkt->data.dma_addr,
-			sys->rx_buff_sz, DMA_FROM_DEVICE);
+	ipa3_rx_buff_unmap(sys, rx_pkt);
 fail_dma_mapping:
 	sys->free_skb(rx_pkt->data.skb);
 fail_skb_alloc:
@@ -2360,8 +2619,7 @@ static void ipa3_cleanup_rx(struct ipa3_sys_context *sys)
 	list_for_each_entry_safe(rx_pkt, r,
 				 &sys->head_desc_list, link) {
 		list_del(&rx_pkt->link);
-		dma_unmap_single(ipa3_ctx->pdev, rx_pkt->data.dma_addr,
-			sys->rx_buff_sz, DMA_FROM_DEVICE);
+		ipa3_rx_buff_unmap(sys, rx_pkt);
 		sys->free_skb(rx_pkt->data.skb);
 		kmem_cache_free(ipa3_ctx->rx_pkt_wrapper_cache, rx_pkt);
 	}
@@ -2380,8 +2638,7 @@ static void ipa3_cleanup_rx(struct ipa3_sys_context *sys)
 		tail = atomic_read(&sys->repl.tail_idx);
 		while (head != tail) {
 			rx_pkt = sys->repl.cache[head];
-			dma_unmap_single(ipa3_ctx->pdev, rx_pkt->data.dma_addr,
-					sys->rx_buff_sz, DMA_FROM_DEVICE);
+			ipa3_rx_buff_unmap(sys, rx_pkt);
 			sys->free_skb(rx_pkt->data.skb);
 			kmem_cache_free(ipa3_ctx->rx_pkt_wrapper_cache, rx_pkt);
 			head = (head + 1) % sys->repl.capacity;
@@ -2976,8 +3233,7 @@ static void ipa3_wq_rx_common(struct ipa3_sys_context *sys, u32 size)
 		rx_pkt_expected->len = size;
 	spin_unlock_bh(&sys->spinlock);
 	rx_skb = rx_pkt_expected->data.skb;
-	dma_unmap_single(ipa3_ctx->pdev, rx_pkt_expected->data.dma_addr,
-			sys->rx_buff_sz, DMA_FROM_DEVICE);
+	ipa3_rx_buff_unmap(sys, rx_pkt_expected);
 	skb_set_tail_pointer(rx_skb, rx_pkt_expected->len);
 	rx_skb->len = rx_pkt_expected->len;
 	*(unsigned int *)rx_skb->cb = rx_skb->len;
@@ -3756,7 +4012,7 @@ static void ipa_gsi_irq_rx_notify_cb(struct gsi_chan_xfer_notify *notify)
 				GSI_CHAN_MODE_POLL);
 			ipa3_inc_acquire_wakelock();
 			atomic_set(&sys->curr_polling_state, 1);
-			queue_work(sys->wq, &sys->work);
+			ipa3_rx_start_poll(sys);
 		}
 		break;
 	default:
@@ -519,10 +519,6 @@ static int ipa_translate_flt_tbl_to_hw_fmt(enum ipa_ip_type ip,
 				goto align_err;
 			}
 
-			/* update the hdr at the right index */
-			ipa3_write_64(tbl_mem.phys_base, hdr +
-				hdr_idx * IPA_HW_TBL_HDR_WIDTH);
-
 			tbl_mem_buf = tbl_mem.base;
 			memset(tbl_mem_buf, 0, tbl_mem.size);
 
@@ -543,11 +539,27 @@ static int ipa_translate_flt_tbl_to_hw_fmt(enum ipa_ip_type ip,
 			/* write the rule-set terminator */
 			tbl_mem_buf = ipa3_write_64(0, tbl_mem_buf);
 
-			if (tbl->curr_mem[rlt].phys_base) {
-				WARN_ON(tbl->prev_mem[rlt].phys_base);
-				tbl->prev_mem[rlt] = tbl->curr_mem[rlt];
+			/*
+			 * keep the current block if the rule-set did not
+			 * change so its table header entry stays the same
+			 */
+			if (tbl->curr_mem[rlt].phys_base &&
+				tbl->curr_mem[rlt].size == tbl_mem.size &&
+				!memcmp(tbl->curr_mem[rlt].base, tbl_mem.base,
+					tbl_mem.size)) {
+				dma_free_coherent(ipa3_ctx->pdev, tbl_mem.size,
+					tbl_mem.base, tbl_mem.phys_base);
+			} else {
+				if (tbl->curr_mem[rlt].phys_base) {
+					WARN_ON(tbl->prev_mem[rlt].phys_base);
+					tbl->prev_mem[rlt] = tbl->curr_mem[rlt];
+				}
+				tbl->curr_mem[rlt] = tbl_mem;
 			}
-			tbl->curr_mem[rlt] = tbl_mem;
+
+			/* update the hdr at the right index */
+			ipa3_write_64(tbl->curr_mem[rlt].phys_base, hdr +
+				hdr_idx * IPA_HW_TBL_HDR_WIDTH);
 		} else {
 			offset = body_i - base + body_ofst;
 			if (offset & IPA_HW_TBL_LCLADDR_ALIGNMENT) {
@@ -815,11 +827,39 @@ static bool ipa_flt_skip_pipe_config(int pipe)
 	return false;
 }
 
+/**
+ * ipa_flt_hdr_changed() - check whether any flt tbl header entry of the
+ *  given rule type differs from the one in SRAM
+ * @img: the image last written to SRAM
+ * @hdr: the newly generated tbl headers
+ *
+ * Return: true if at least one entry needs to be written
+ */
+static bool ipa_flt_hdr_changed(struct ipa3_fltrt_img *img,
+	struct ipa_mem_buffer *hdr)
+{
+	int i;
+	int hdr_idx = 0;
+
+	for (i = 0; i < ipa3_ctx->ipa_num_pipes; i++) {
+		if (!ipa_is_ep_support_flt(i))
+			continue;
+		if (!ipa_flt_skip_pipe_config(i) &&
+			ipa3_fltrt_img_hdr_changed(img, hdr, hdr_idx))
+			return true;
+		hdr_idx++;
+	}
+
+	return false;
+}
+
 /**
  * __ipa_commit_flt_v3() - commit flt tables to the hw
  *  commit the headers and the bodies if are local with internal cache flushing.
  *  The headers (and local bodies) will first be created into dma buffers and
- *  then written via IC to the SRAM
+ *  then written via IC to the SRAM. Only the header entries and local bodies
+ *  that differ from what the previous commit wrote are sent, and the hash
+ *  cache is flushed only if hashable rules changed.
  * @ipt: the ip address family type
  *
  * Return: 0 on success, negative on failure
@@ -828,6 +868,8 @@ int __ipa_commit_flt_v3(enum ipa_ip_type ip)
 {
 	struct ipa_mem_buffer hash_bdy, nhash_bdy;
 	struct ipa_mem_buffer hash_hdr, nhash_hdr;
+	struct ipa3_fltrt_img *hash_img, *nhash_img;
+	bool hash_bdy_chg, nhash_bdy_chg;
 	int rc = 0;
 	struct ipa3_desc *desc;
 	struct ipahal_imm_cmd_register_write reg_write_cmd = {0};
@@ -869,6 +911,8 @@ int __ipa_commit_flt_v3(enum ipa_ip_type ip)
 		lcl_hash = ipa3_ctx->ip6_flt_tbl_hash_lcl;
 		lcl_nhash = ipa3_ctx->ip6_flt_tbl_nhash_lcl;
 	}
+	hash_img = &ipa3_ctx->flt_img[ip][IPA_RULE_HASHABLE];
+	nhash_img = &ipa3_ctx->flt_img[ip][IPA_RULE_NON_HASHABLE];
 
 	if (ipa_generate_flt_hw_tbl_img(ip,
 		&hash_hdr, &nhash_hdr, &hash_bdy, &nhash_bdy)) {
@@ -887,11 +931,25 @@ int __ipa_commit_flt_v3(enum ipa_ip_type ip)
 		goto fail_size_valid;
 	}
 
+	if (ipa3_fltrt_img_hdr_init(hash_img, ipa3_ctx->ep_flt_num) ||
+		ipa3_fltrt_img_hdr_init(nhash_img, ipa3_ctx->ep_flt_num)) {
+		IPAERR("fail to alloc flt img hdr copy. IP %d\n", ip);
+		rc = -ENOMEM;
+		goto fail_size_valid;
+	}
+	hash_bdy_chg = lcl_hash &&
+		ipa3_fltrt_img_bdy_changed(hash_img, &hash_bdy);
+	nhash_bdy_chg = lcl_nhash &&
+		ipa3_fltrt_img_bdy_changed(nhash_img, &nhash_bdy);
+
 	if (ipa_flt_alloc_cmd_buffers(ip, &desc, &cmd_pyld)) {
 		rc = -ENOMEM;
 		goto fail_size_valid;
 	}
 
+	if (!hash_bdy_chg && !ipa_flt_hdr_changed(hash_img, &hash_hdr))
+		goto skip_flush;
+
 	/* flushing ipa internal hashable flt rules cache */
 	memset(&flush, 0, sizeof(flush));
 	if (ip == IPA_IP_v4)
@@ -917,6 +975,7 @@ int __ipa_commit_flt_v3(enum ipa_ip_type ip)
 	desc[0].type = IPA_IMM_CMD_DESC;
 	num_cmd++;
 
+skip_flush:
 	hdr_idx = 0;
 	for (i = 0; i < ipa3_ctx->ipa_num_pipes; i++) {
 		if (!ipa_is_ep_support_flt(i)) {
@@ -932,6 +991,9 @@ int __ipa_commit_flt_v3(enum ipa_ip_type ip)
 		IPADBG_LOW("Prepare imm cmd for hdr at index %d for pipe %d\n",
 			hdr_idx, i);
 
+		if (!ipa3_fltrt_img_hdr_changed(nhash_img, &nhash_hdr, hdr_idx))
+			goto hash_hdr_cmd;
+
 		mem_cmd.is_read = false;
 		mem_cmd.skip_pipeline_clear = false;
 		mem_cmd.pipeline_clear_options = IPAHAL_HPS_CLEAR;
@@ -953,6 +1015,12 @@ int __ipa_commit_flt_v3(enum ipa_ip_type ip)
 		desc[num_cmd].len = cmd_pyld[num_cmd]->len;
 		desc[num_cmd++].type = IPA_IMM_CMD_DESC;
 
+hash_hdr_cmd:
+		if (!ipa3_fltrt_img_hdr_changed(hash_img, &hash_hdr, hdr_idx)) {
+			hdr_idx++;
+			continue;
+		}
+
 		mem_cmd.is_read = false;
 		mem_cmd.skip_pipeline_clear = false;
 		mem_cmd.pipeline_clear_options = IPAHAL_HPS_CLEAR;
@@ -977,7 +1045,7 @@ int __ipa_commit_flt_v3(enum ipa_ip_type ip)
 		hdr_idx++;
 	}
 
-	if (lcl_nhash) {
+	if (nhash_bdy_chg) {
 		mem_cmd.is_read = false;
 		mem_cmd.skip_pipeline_clear = false;
 		mem_cmd.pipeline_clear_options = IPAHAL_HPS_CLEAR;
@@ -997,7 +1065,7 @@ int __ipa_commit_flt_v3(enum ipa_ip_type ip)
 		desc[num_cmd].len = cmd_pyld[num_cmd]->len;
 		desc[num_cmd++].type = IPA_IMM_CMD_DESC;
 	}
-	if (lcl_hash) {
+	if (hash_bdy_chg) {
 		mem_cmd.is_read = false;
 		mem_cmd.skip_pipeline_clear = false;
 		mem_cmd.pipeline_clear_options = IPAHAL_HPS_CLEAR;
@@ -1018,12 +1086,32 @@ int __ipa_commit_flt_v3(enum ipa_ip_type ip)
 		desc[num_cmd++].type = IPA_IMM_CMD_DESC;
 	}
 
-	if (ipa3_send_cmd(num_cmd, desc)) {
+	IPADBG_LOW("flt commit ip %d: %d imm cmds\n", ip, num_cmd);
+
+	if (num_cmd && ipa3_send_cmd(num_cmd, desc)) {
 		IPAERR("fail to send immediate command\n");
+		/* SRAM content is unknown, rewrite it all next time */
+		ipa3_fltrt_img_invalidate(hash_img);
+		ipa3_fltrt_img_invalidate(nhash_img);
 		rc = -EFAULT;
 		goto fail_imm_cmd_construct;
 	}
 
+	hdr_idx = 0;
+	for (i = 0; i < ipa3_ctx->ipa_num_pipes; i++) {
+		if (!ipa_is_ep_support_flt(i))
+			continue;
+		if (!ipa_flt_skip_pipe_config(i)) {
+			ipa3_fltrt_img_hdr_set(hash_img, &hash_hdr, hdr_idx);
+			ipa3_fltrt_img_hdr_set(nhash_img, &nhash_hdr, hdr_idx);
+		}
+		hdr_idx++;
+	}
+	if (hash_bdy_chg)
+		ipa3_fltrt_img_bdy_set(hash_img, &hash_bdy);
+	if (nhash_bdy_chg)
+		ipa3_fltrt_img_bdy_set(nhash_img, &nhash_bdy);
+
 	IPADBG_LOW("Hashable HEAD\n");
 	IPA_DUMP_BUFF(hash_hdr.base, hash_hdr.phys_base, hash_hdr.size);
 
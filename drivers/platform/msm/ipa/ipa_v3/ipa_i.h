@@ -451,6 +451,27 @@ struct ipa3_flt_tbl {
 	struct idr rule_ids;
 };
 
+/**
+ * struct ipa3_fltrt_img - copy of a flt/rt image last written to SRAM
+ * @hdr: table header entries, IPA_FLTRT_IMG_HDR_INVAL if not known
+ * @hdr_num: number of entries in @hdr
+ * @bdy: local rules body
+ * @bdy_sz: size of @bdy
+ * @bdy_valid: @bdy holds what SRAM holds
+ *
+ * Lets a commit skip the immediate commands for the parts of the image
+ * that did not change since the previous commit.
+ */
+struct ipa3_fltrt_img {
+	u64 *hdr;
+	u32 hdr_num;
+	u8 *bdy;
+	u32 bdy_sz;
+	bool bdy_valid;
+};
+
+#define IPA_FLTRT_IMG_HDR_INVAL (~0ULL)
+
 /**
  * struct ipa3_rt_entry - IPA routing table entry
  * @link: entry's link in global routing table entries list
@@ -664,6 +685,32 @@ struct ipa3_repl_ctx {
 	u32 capacity;
 };
 
+/**
+ * struct ipa3_rx_page - DMA mapped page kept by an RX page pool
+ * @page: the (compound) page, one reference is owned by the pool
+ * @dma_addr: DMA address of the receive area inside the page
+ */
+struct ipa3_rx_page {
+	struct page *page;
+	dma_addr_t dma_addr;
+};
+
+/**
+ * struct ipa3_rx_page_pool - pages recycled between an RX pipe and the stack
+ * @pages: pool entries, a page is free again once only the pool holds it
+ * @size: number of entries in @pages
+ * @next: entry to look at first on the next allocation
+ * @order: allocation order of the pages
+ * @lock: protects @next and taking a page from the pool
+ */
+struct ipa3_rx_page_pool {
+	struct ipa3_rx_page *pages;
+	u32 size;
+	u32 next;
+	u32 order;
+	spinlock_t lock;
+};
+
 /**
  * struct ipa3_sys_context - IPA endpoint context for system to BAM pipes
  * @head_desc_list: header descriptors list
@@ -700,6 +747,9 @@ struct ipa3_sys_context {
 	struct work_struct repl_work;
 	void (*repl_hdlr)(struct ipa3_sys_context *sys);
 	struct ipa3_repl_ctx repl;
+	struct ipa3_rx_page_pool page_pool;
+	bool napi_enabled;
+	bool napi_clk_vote;
 
 	/* ordering is important - mutable fields go above */
 	struct ipa3_ep_context *ep;
@@ -823,6 +873,7 @@ struct ipa3_desc {
 struct ipa3_rx_pkt_wrapper {
 	struct list_head link;
 	struct ipa_rx_data data;
+	bool from_page_pool;
 	u32 len;
 	struct work_struct work;
 	struct ipa3_sys_context *sys;
@@ -910,9 +961,13 @@ struct ipa3_stats {
 	u32 wan_repl_rx_empty;
 	u32 lan_rx_empty;
 	u32 lan_repl_rx_empty;
+	u32 wan_rx_page_hit;
+	u32 wan_rx_page_miss;
 	u32 flow_enable;
 	u32 flow_disable;
 	u32 tx_non_linear;
+	u32 nat_dma_cmds;
+	u32 nat_dma_batches;
 };
 
 struct ipa3_active_clients {
@@ -1163,6 +1218,8 @@ struct ipa_cne_evt {
  * @ip4_flt_tbl_lcl: where ip4 flt tables reside 1-local; 0-system
  * @ip6_flt_tbl_lcl: where ip6 flt tables reside 1-local; 0-system
  * @empty_rt_tbl_mem: empty routing tables memory
+ * @flt_img: flt images last written to SRAM, per ip and rule type
+ * @rt_img: rt images last written to SRAM, per ip and rule type
  * @power_mgmt_wq: workqueue for power management
  * @transport_power_mgmt_wq: workqueue transport related power management
  * @tag_process_before_gating: indicates whether to start tag process before
@@ -1256,6 +1313,8 @@ struct ipa3_context {
 	bool ip6_flt_tbl_hash_lcl;
 	bool ip6_flt_tbl_nhash_lcl;
 	struct ipa_mem_buffer empty_rt_tbl_mem;
+	struct ipa3_fltrt_img flt_img[IPA_IP_MAX][IPA_RULE_TYPE_MAX];
+	struct ipa3_fltrt_img rt_img[IPA_IP_MAX][IPA_RULE_TYPE_MAX];
 	struct gen_pool *pipe_mem_pool;
 	struct dma_pool *dma_pool;
 	struct ipa3_active_clients ipa3_active_clients;
@@ -1614,6 +1673,8 @@ int ipa3_del_rt_rule(struct ipa_ioc_del_rt_rule *hdls);
 
 int ipa3_commit_rt(enum ipa_ip_type ip);
 
+int ipa3_commit_flt_rt(void);
+
 int ipa3_reset_rt(enum ipa_ip_type ip);
 
 int ipa3_get_rt_tbl(struct ipa_ioc_get_rt_tbl *lookup);
@@ -1650,6 +1711,8 @@ int ipa3_nat_init_cmd(struct ipa_ioc_v4_nat_init *init);
 
 int ipa3_nat_dma_cmd(struct ipa_ioc_nat_dma_cmd *dma);
 
+int ipa3_nat_get_timestamps(struct ipa_ioc_nat_get_ts *ts);
+
 int ipa3_nat_del_cmd(struct ipa_ioc_v4_nat_del *del);
 int ipa3_del_nat_table(struct ipa_ioc_nat_ipv6ct_table_del *del);
 
@@ -1703,6 +1766,8 @@ int ipa3_setup_sys_pipe(struct ipa_sys_connect_params *sys_in, u32 *clnt_hdl);
 
 int ipa3_teardown_sys_pipe(u32 clnt_hdl);
 
+int ipa3_rx_poll(u32 clnt_hdl, int weight);
+
 int ipa3_sys_setup(struct ipa_sys_connect_params *sys_in,
 	unsigned long *ipa_bam_hdl,
 	u32 *ipa_pipe_num, u32 *clnt_hdl, bool en_status);
@@ -1874,6 +1939,16 @@ int ipa3_generate_hw_rule(enum ipa_ip_type ip,
 			 u8 **buf,
 			 u16 *en_rule);
 u8 *ipa3_write_64(u64 w, u8 *dest);
+int ipa3_fltrt_img_hdr_init(struct ipa3_fltrt_img *img, u32 num);
+bool ipa3_fltrt_img_hdr_changed(struct ipa3_fltrt_img *img,
+	struct ipa_mem_buffer *hdr, u32 idx);
+void ipa3_fltrt_img_hdr_set(struct ipa3_fltrt_img *img,
+	struct ipa_mem_buffer *hdr, u32 idx);
+bool ipa3_fltrt_img_bdy_changed(struct ipa3_fltrt_img *img,
+	struct ipa_mem_buffer *bdy);
+void ipa3_fltrt_img_bdy_set(struct ipa3_fltrt_img *img,
+	struct ipa_mem_buffer *bdy);
+void ipa3_fltrt_img_invalidate(struct ipa3_fltrt_img *img);
 u8 *ipa3_write_32(u32 w, u8 *dest);
 u8 *ipa3_write_16(u16 hw, u8 *dest);
 u8 *ipa3_write_8(u8 b, u8 *dest);
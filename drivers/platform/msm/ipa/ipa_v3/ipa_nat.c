@@ -34,6 +34,15 @@ enum nat_table_type {
 #define NAT_TABLE_ENTRY_SIZE_BYTE 32
 #define NAT_INTEX_TABLE_ENTRY_SIZE_BYTE 4
 
+/* Layout of the rule table entry words used for aging */
+#define NAT_ENTRY_FLAGS_WORD 4
+#define NAT_ENTRY_ENABLE_BIT (0x8000 << 16)
+#define NAT_ENTRY_TS_WORD 5
+#define NAT_ENTRY_TS_MASK 0x00FFFFFF
+
+/* Max NAT_DMA commands sent behind a single NOP */
+#define IPA_NAT_DMA_MAX_BATCH 64
+
 static int ipa3_nat_vma_fault_remap(
 	 struct vm_area_struct *vma, struct vm_fault *vmf)
 {
@@ -587,19 +596,21 @@ bail:
  * ipa3_nat_dma_cmd() - Post NAT_DMA command to IPA HW
  * @dma:	[in] initialization command attributes
  *
- * Called by NAT client driver to post NAT_DMA command to IPA HW
+ * Called by NAT client driver to post NAT_DMA command to IPA HW.
+ * The commands are sent in batches of up to IPA_NAT_DMA_MAX_BATCH behind
+ * a single NOP, so deleting or updating many entries costs one round
+ * trip per batch rather than one per entry.
  *
  * Returns:	0 on success, negative on failure
  */
 int ipa3_nat_dma_cmd(struct ipa_ioc_nat_dma_cmd *dma)
 {
-#define NUM_OF_DESC 2
-
 	struct ipahal_imm_cmd_pyld *nop_cmd_pyld = NULL;
 	struct ipahal_imm_cmd_nat_dma cmd;
-	struct ipahal_imm_cmd_pyld *cmd_pyld = NULL;
+	struct ipahal_imm_cmd_pyld **cmd_pyld = NULL;
 	struct ipa3_desc *desc = NULL;
 	u16 size = 0, cnt = 0;
+	u16 num_cmd, i;
 	int ret = 0;
 
 	IPADBG("\n");
@@ -675,7 +686,7 @@ int ipa3_nat_dma_cmd(struct ipa_ioc_nat_dma_cmd *dma)
 		}
 	}
 
-	size = sizeof(struct ipa3_desc) * NUM_OF_DESC;
+	size = sizeof(struct ipa3_desc) * (IPA_NAT_DMA_MAX_BATCH + 1);
 	desc = kzalloc(size, GFP_KERNEL);
 	if (desc == NULL) {
 		IPAERR("Failed to alloc memory\n");
@@ -683,6 +694,14 @@ int ipa3_nat_dma_cmd(struct ipa_ioc_nat_dma_cmd *dma)
 		goto bail;
 	}
 
+	cmd_pyld = kcalloc(IPA_NAT_DMA_MAX_BATCH, sizeof(*cmd_pyld),
+		GFP_KERNEL);
+	if (cmd_pyld == NULL) {
+		IPAERR("Failed to alloc memory\n");
+		ret = -ENOMEM;
+		goto bail;
+	}
+
 	/* NO-OP IC for ensuring that IPA pipeline is empty */
 	nop_cmd_pyld =
 		ipahal_construct_nop_imm_cmd(false, IPAHAL_HPS_CLEAR, false);
@@ -699,32 +718,53 @@ int ipa3_nat_dma_cmd(struct ipa_ioc_nat_dma_cmd *dma)
 	desc[0].pyld = nop_cmd_pyld->data;
 	desc[0].len = nop_cmd_pyld->len;
 
-	for (cnt = 0; cnt < dma->entries; cnt++) {
-		cmd.table_index = dma->dma[cnt].table_index;
-		cmd.base_addr = dma->dma[cnt].base_addr;
-		cmd.offset = dma->dma[cnt].offset;
-		cmd.data = dma->dma[cnt].data;
-		cmd_pyld = ipahal_construct_imm_cmd(
-			IPA_IMM_CMD_NAT_DMA, &cmd, false);
-		if (!cmd_pyld) {
-			IPAERR_RL("Fail to construct nat_dma imm cmd\n");
-			continue;
+	for (cnt = 0; cnt < dma->entries; cnt += num_cmd) {
+		num_cmd = min_t(u16, dma->entries - cnt,
+			IPA_NAT_DMA_MAX_BATCH);
+
+		for (i = 0; i < num_cmd; i++) {
+			cmd.table_index = dma->dma[cnt + i].table_index;
+			cmd.base_addr = dma->dma[cnt + i].base_addr;
+			cmd.offset = dma->dma[cnt + i].offset;
+			cmd.data = dma->dma[cnt + i].data;
+			cmd_pyld[i] = ipahal_construct_imm_cmd(
+				IPA_IMM_CMD_NAT_DMA, &cmd, false);
+			if (!cmd_pyld[i]) {
+				IPAERR_RL("Fail to construct nat_dma imm cmd\n");
+				ret = -ENOMEM;
+				break;
+			}
+			desc[i + 1].type = IPA_IMM_CMD_DESC;
+			desc[i + 1].opcode =
+				ipahal_imm_cmd_get_opcode(IPA_IMM_CMD_NAT_DMA);
+			desc[i + 1].callback = NULL;
+			desc[i + 1].user1 = NULL;
+			desc[i + 1].user2 = 0;
+			desc[i + 1].pyld = cmd_pyld[i]->data;
+			desc[i + 1].len = cmd_pyld[i]->len;
+			IPA_STATS_INC_CNT(ipa3_ctx->stats.nat_dma_cmds);
 		}
-		desc[1].type = IPA_IMM_CMD_DESC;
-		desc[1].opcode = ipahal_imm_cmd_get_opcode(IPA_IMM_CMD_NAT_DMA);
-		desc[1].callback = NULL;
-		desc[1].user1 = NULL;
-		desc[1].user2 = 0;
-		desc[1].pyld = cmd_pyld->data;
-		desc[1].len = cmd_pyld->len;
 
-		ret = ipa3_send_cmd(NUM_OF_DESC, desc);
-		if (ret == -EPERM)
-			IPAERR("Fail to send immediate command %d\n", cnt);
-		ipahal_destroy_imm_cmd(cmd_pyld);
+		if (!ret) {
+			ret = ipa3_send_cmd(num_cmd + 1, desc);
+			if (ret)
+				IPAERR("Fail to send immediate command %d\n",
+					cnt);
+			else
+				IPA_STATS_INC_CNT(
+					ipa3_ctx->stats.nat_dma_batches);
+		}
+
+		while (i--)
+			ipahal_destroy_imm_cmd(cmd_pyld[i]);
+
+		if (ret)
+			goto bail;
 	}
 
 bail:
+	kfree(cmd_pyld);
+
 	if (desc != NULL)
 		kfree(desc);
 
@@ -734,6 +774,70 @@ bail:
 	return ret;
 }
 
+/**
+ * ipa3_nat_get_timestamps() - Read the time stamps of a set of NAT entries
+ * @ts:	[inout] entries to read, updated with their state and time stamp
+ *
+ * Called by NAT client driver to age the connections it tracks without
+ * sweeping the whole table. Only supported when the NAT table resides in
+ * system memory.
+ *
+ * Returns:	0 on success, negative on failure
+ */
+int ipa3_nat_get_timestamps(struct ipa_ioc_nat_get_ts *ts)
+{
+	struct ipa_ioc_nat_ts_one *one;
+	char *tbl;
+	u32 *entry;
+	u32 tbl_entries;
+	u16 cnt;
+
+	if (ts->table_index >= 1) {
+		IPAERR_RL("Invalid table index %d\n", ts->table_index);
+		return -EPERM;
+	}
+
+	if (!ipa3_ctx->nat_mem.is_sys_mem ||
+		!ipa3_ctx->nat_mem.ipv4_rules_addr) {
+		IPAERR_RL("NAT table not initialized in system memory\n");
+		return -EPERM;
+	}
+
+	for (cnt = 0; cnt < ts->entries; cnt++) {
+		one = &ts->ts[cnt];
+
+		switch (one->base_addr) {
+		case IPA_NAT_BASE_TBL:
+			tbl = ipa3_ctx->nat_mem.ipv4_rules_addr;
+			tbl_entries = ipa3_ctx->nat_mem.size_base_tables + 1;
+			break;
+
+		case IPA_NAT_EXPN_TBL:
+			tbl = ipa3_ctx->nat_mem.ipv4_expansion_rules_addr;
+			tbl_entries = ipa3_ctx->nat_mem.size_expansion_tables;
+			break;
+
+		default:
+			IPAERR_RL("Invalid base_addr %d\n", one->base_addr);
+			return -EPERM;
+		}
+
+		if (one->entry_index >= tbl_entries) {
+			IPAERR_RL("Invalid entry index %d\n", one->entry_index);
+			return -EPERM;
+		}
+
+		entry = (u32 *)(tbl + one->entry_index *
+			NAT_TABLE_ENTRY_SIZE_BYTE);
+		one->enabled = !!(ACCESS_ONCE(entry[NAT_ENTRY_FLAGS_WORD]) &
+			NAT_ENTRY_ENABLE_BIT);
+		one->timestamp = ACCESS_ONCE(entry[NAT_ENTRY_TS_WORD]) &
+			NAT_ENTRY_TS_MASK;
+	}
+
+	return 0;
+}
+
 /**
  * ipa3_nat_free_mem_and_device() - free the NAT memory and remove the device
  * @nat_ctx:	[in] the IPA NAT memory to free
@@ -186,11 +186,6 @@ static int ipa_translate_rt_tbl_to_hw_fmt(enum ipa_ip_type ip,
 				goto align_err;
 			}
 
-			/* update the hdr at the right index */
-			ipa3_write_64(tbl_mem.phys_base,
-					hdr + ((tbl->idx - apps_start_idx) *
-					IPA_HW_TBL_HDR_WIDTH));
-
 			tbl_mem_buf = tbl_mem.base;
 			memset(tbl_mem_buf, 0, tbl_mem.size);
 
@@ -213,11 +208,28 @@ static int ipa_translate_rt_tbl_to_hw_fmt(enum ipa_ip_type ip,
 			/* write the rule-set terminator */
 			tbl_mem_buf = ipa3_write_64(0, tbl_mem_buf);
 
-			if (tbl->curr_mem[rlt].phys_base) {
-				WARN_ON(tbl->prev_mem[rlt].phys_base);
-				tbl->prev_mem[rlt] = tbl->curr_mem[rlt];
+			/*
+			 * keep the current block if the rule-set did not
+			 * change so its table header entry stays the same
+			 */
+			if (tbl->curr_mem[rlt].phys_base &&
+				tbl->curr_mem[rlt].size == tbl_mem.size &&
+				!memcmp(tbl->curr_mem[rlt].base, tbl_mem.base,
+					tbl_mem.size)) {
+				dma_free_coherent(ipa3_ctx->pdev, tbl_mem.size,
+					tbl_mem.base, tbl_mem.phys_base);
+			} else {
+				if (tbl->curr_mem[rlt].phys_base) {
+					WARN_ON(tbl->prev_mem[rlt].phys_base);
+					tbl->prev_mem[rlt] = tbl->curr_mem[rlt];
+				}
+				tbl->curr_mem[rlt] = tbl_mem;
 			}
-			tbl->curr_mem[rlt] = tbl_mem;
+
+			/* update the hdr at the right index */
+			ipa3_write_64(tbl->curr_mem[rlt].phys_base,
+					hdr + ((tbl->idx - apps_start_idx) *
+					IPA_HW_TBL_HDR_WIDTH));
 		} else {
 			offset = body_i - base + body_ofst;
 			if (offset & IPA_HW_TBL_LCLADDR_ALIGNMENT) {
@@ -633,9 +645,31 @@ static bool ipa_rt_valid_lcl_tbl_size(enum ipa_ip_type ipt,
 	return false;
 }
 
+/**
+ * ipa_rt_hdr_changed() - check whether the rt tbl header differs from the
+ *  one in SRAM
+ * @img: the image last written to SRAM
+ * @hdr: the newly generated tbl header
+ *
+ * Return: true if the header needs to be written
+ */
+static bool ipa_rt_hdr_changed(struct ipa3_fltrt_img *img,
+	struct ipa_mem_buffer *hdr)
+{
+	u32 i;
+
+	for (i = 0; i < img->hdr_num; i++)
+		if (ipa3_fltrt_img_hdr_changed(img, hdr, i))
+			return true;
+
+	return false;
+}
+
 /**
  * __ipa_commit_rt_v3() - commit rt tables to the hw
- * commit the headers and the bodies if are local with internal cache flushing
+ * commit the headers and the bodies if are local with internal cache flushing.
+ * Only the headers and local bodies that differ from what the previous commit
+ * wrote are sent, and the hash cache is flushed only if hashable rules changed
  * @ipt: the ip address family type
  *
  * Return: 0 on success, negative on failure
@@ -656,10 +690,15 @@ int __ipa_commit_rt_v3(enum ipa_ip_type ip)
 	bool lcl_hash, lcl_nhash;
 	struct ipahal_reg_fltrt_hash_flush flush;
 	struct ipahal_reg_valmask valmask;
+	struct ipa3_fltrt_img *hash_img, *nhash_img;
+	bool hash_hdr_chg, nhash_hdr_chg;
+	bool hash_bdy_chg, nhash_bdy_chg;
 	int i;
 
 	memset(desc, 0, sizeof(desc));
 	memset(cmd_pyld, 0, sizeof(cmd_pyld));
+	hash_img = &ipa3_ctx->rt_img[ip][IPA_RULE_HASHABLE];
+	nhash_img = &ipa3_ctx->rt_img[ip][IPA_RULE_NON_HASHABLE];
 
 	if (ip == IPA_IP_v4) {
 		num_modem_rt_index =
@@ -712,6 +751,24 @@ int __ipa_commit_rt_v3(enum ipa_ip_type ip)
 		goto fail_size_valid;
 	}
 
+	if (ipa3_fltrt_img_hdr_init(hash_img,
+			hash_hdr.size / IPA_HW_TBL_HDR_WIDTH) ||
+		ipa3_fltrt_img_hdr_init(nhash_img,
+			nhash_hdr.size / IPA_HW_TBL_HDR_WIDTH)) {
+		IPAERR("fail to alloc rt img hdr copy. IP %d\n", ip);
+		rc = -ENOMEM;
+		goto fail_size_valid;
+	}
+	hash_hdr_chg = ipa_rt_hdr_changed(hash_img, &hash_hdr);
+	nhash_hdr_chg = ipa_rt_hdr_changed(nhash_img, &nhash_hdr);
+	hash_bdy_chg = lcl_hash &&
+		ipa3_fltrt_img_bdy_changed(hash_img, &hash_bdy);
+	nhash_bdy_chg = lcl_nhash &&
+		ipa3_fltrt_img_bdy_changed(nhash_img, &nhash_bdy);
+
+	if (!hash_hdr_chg && !hash_bdy_chg)
+		goto skip_flush;
+
 	/* flushing ipa internal hashable rt rules cache */
 	memset(&flush, 0, sizeof(flush));
 	if (ip == IPA_IP_v4)
@@ -737,45 +794,52 @@ int __ipa_commit_rt_v3(enum ipa_ip_type ip)
 	desc[num_cmd].type = IPA_IMM_CMD_DESC;
 	num_cmd++;
 
-	mem_cmd.is_read = false;
-	mem_cmd.skip_pipeline_clear = false;
-	mem_cmd.pipeline_clear_options = IPAHAL_HPS_CLEAR;
-	mem_cmd.size = nhash_hdr.size;
-	mem_cmd.system_addr = nhash_hdr.phys_base;
-	mem_cmd.local_addr = lcl_nhash_hdr;
-	cmd_pyld[num_cmd] = ipahal_construct_imm_cmd(
-		IPA_IMM_CMD_DMA_SHARED_MEM, &mem_cmd, false);
-	if (!cmd_pyld[num_cmd]) {
-		IPAERR("fail construct dma_shared_mem imm cmd. IP %d\n", ip);
-		goto fail_imm_cmd_construct;
+skip_flush:
+	if (nhash_hdr_chg) {
+		mem_cmd.is_read = false;
+		mem_cmd.skip_pipeline_clear = false;
+		mem_cmd.pipeline_clear_options = IPAHAL_HPS_CLEAR;
+		mem_cmd.size = nhash_hdr.size;
+		mem_cmd.system_addr = nhash_hdr.phys_base;
+		mem_cmd.local_addr = lcl_nhash_hdr;
+		cmd_pyld[num_cmd] = ipahal_construct_imm_cmd(
+			IPA_IMM_CMD_DMA_SHARED_MEM, &mem_cmd, false);
+		if (!cmd_pyld[num_cmd]) {
+			IPAERR("fail construct dma_shared_mem imm cmd. IP %d\n",
+				ip);
+			goto fail_imm_cmd_construct;
+		}
+		desc[num_cmd].opcode =
+			ipahal_imm_cmd_get_opcode(IPA_IMM_CMD_DMA_SHARED_MEM);
+		desc[num_cmd].pyld = cmd_pyld[num_cmd]->data;
+		desc[num_cmd].len = cmd_pyld[num_cmd]->len;
+		desc[num_cmd].type = IPA_IMM_CMD_DESC;
+		num_cmd++;
 	}
-	desc[num_cmd].opcode =
-		ipahal_imm_cmd_get_opcode(IPA_IMM_CMD_DMA_SHARED_MEM);
-	desc[num_cmd].pyld = cmd_pyld[num_cmd]->data;
-	desc[num_cmd].len = cmd_pyld[num_cmd]->len;
-	desc[num_cmd].type = IPA_IMM_CMD_DESC;
-	num_cmd++;
 
-	mem_cmd.is_read = false;
-	mem_cmd.skip_pipeline_clear = false;
-	mem_cmd.pipeline_clear_options = IPAHAL_HPS_CLEAR;
-	mem_cmd.size = hash_hdr.size;
-	mem_cmd.system_addr = hash_hdr.phys_base;
-	mem_cmd.local_addr = lcl_hash_hdr;
-	cmd_pyld[num_cmd] = ipahal_construct_imm_cmd(
-		IPA_IMM_CMD_DMA_SHARED_MEM, &mem_cmd, false);
-	if (!cmd_pyld[num_cmd]) {
-		IPAERR("fail construct dma_shared_mem imm cmd. IP %d\n", ip);
-		goto fail_imm_cmd_construct;
+	if (hash_hdr_chg) {
+		mem_cmd.is_read = false;
+		mem_cmd.skip_pipeline_clear = false;
+		mem_cmd.pipeline_clear_options = IPAHAL_HPS_CLEAR;
+		mem_cmd.size = hash_hdr.size;
+		mem_cmd.system_addr = hash_hdr.phys_base;
+		mem_cmd.local_addr = lcl_hash_hdr;
+		cmd_pyld[num_cmd] = ipahal_construct_imm_cmd(
+			IPA_IMM_CMD_DMA_SHARED_MEM, &mem_cmd, false);
+		if (!cmd_pyld[num_cmd]) {
+			IPAERR("fail construct dma_shared_mem imm cmd. IP %d\n",
+				ip);
+			goto fail_imm_cmd_construct;
+		}
+		desc[num_cmd].opcode =
+			ipahal_imm_cmd_get_opcode(IPA_IMM_CMD_DMA_SHARED_MEM);
+		desc[num_cmd].pyld = cmd_pyld[num_cmd]->data;
+		desc[num_cmd].len = cmd_pyld[num_cmd]->len;
+		desc[num_cmd].type = IPA_IMM_CMD_DESC;
+		num_cmd++;
 	}
-	desc[num_cmd].opcode =
-		ipahal_imm_cmd_get_opcode(IPA_IMM_CMD_DMA_SHARED_MEM);
-	desc[num_cmd].pyld = cmd_pyld[num_cmd]->data;
-	desc[num_cmd].len = cmd_pyld[num_cmd]->len;
-	desc[num_cmd].type = IPA_IMM_CMD_DESC;
-	num_cmd++;
 
-	if (lcl_nhash) {
+	if (nhash_bdy_chg) {
 		mem_cmd.is_read = false;
 		mem_cmd.skip_pipeline_clear = false;
 		mem_cmd.pipeline_clear_options = IPAHAL_HPS_CLEAR;
@@ -796,7 +860,7 @@ int __ipa_commit_rt_v3(enum ipa_ip_type ip)
 		desc[num_cmd].type = IPA_IMM_CMD_DESC;
 		num_cmd++;
 	}
-	if (lcl_hash) {
+	if (hash_bdy_chg) {
 		mem_cmd.is_read = false;
 		mem_cmd.skip_pipeline_clear = false;
 		mem_cmd.pipeline_clear_options = IPAHAL_HPS_CLEAR;
@@ -818,12 +882,26 @@ int __ipa_commit_rt_v3(enum ipa_ip_type ip)
 		num_cmd++;
 	}
 
-	if (ipa3_send_cmd(num_cmd, desc)) {
+	IPADBG_LOW("rt commit ip %d: %d imm cmds\n", ip, num_cmd);
+
+	if (num_cmd && ipa3_send_cmd(num_cmd, desc)) {
 		IPAERR("fail to send immediate command\n");
+		/* SRAM content is unknown, rewrite it all next time */
+		ipa3_fltrt_img_invalidate(hash_img);
+		ipa3_fltrt_img_invalidate(nhash_img);
 		rc = -EFAULT;
 		goto fail_imm_cmd_construct;
 	}
 
+	for (i = 0; i < hash_img->hdr_num; i++)
+		ipa3_fltrt_img_hdr_set(hash_img, &hash_hdr, i);
+	for (i = 0; i < nhash_img->hdr_num; i++)
+		ipa3_fltrt_img_hdr_set(nhash_img, &nhash_hdr, i);
+	if (hash_bdy_chg)
+		ipa3_fltrt_img_bdy_set(hash_img, &hash_bdy);
+	if (nhash_bdy_chg)
+		ipa3_fltrt_img_bdy_set(nhash_img, &nhash_bdy);
+
 	IPADBG_LOW("Hashable HEAD\n");
 	IPA_DUMP_BUFF(hash_hdr.base, hash_hdr.phys_base, hash_hdr.size);
 
@@ -1569,6 +1647,36 @@ bail:
 	return ret;
 }
 
+/**
+ * ipa3_commit_flt_rt() - commit the current SW filtering and routing tables
+ * of both IP families to IPA HW
+ *
+ * Lets a client apply a whole set of rule changes made with commit=0 at
+ * once. Tables that did not change are not written again.
+ *
+ * Returns:	0 on success, negative on failure
+ *
+ * Note:	Should not be called from atomic context
+ */
+int ipa3_commit_flt_rt(void)
+{
+	enum ipa_ip_type ip;
+	int ret = 0;
+
+	mutex_lock(&ipa3_ctx->lock);
+	for (ip = IPA_IP_v4; ip < IPA_IP_MAX; ip++) {
+		if (ipa3_ctx->ctrl->ipa3_commit_flt(ip) ||
+			ipa3_ctx->ctrl->ipa3_commit_rt(ip)) {
+			IPAERR("fail to commit flt/rt ip %d\n", ip);
+			ret = -EPERM;
+			break;
+		}
+	}
+	mutex_unlock(&ipa3_ctx->lock);
+
+	return ret;
+}
+
 /**
  * ipa3_reset_rt() - reset the current SW routing table of specified type
  * (does not commit to HW)
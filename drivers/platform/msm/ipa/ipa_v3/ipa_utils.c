@@ -1947,6 +1947,117 @@ bool ipa_is_ep_support_flt(int pipe_idx)
 	return ipa3_ctx->ep_flt_bitmap & (1U<<pipe_idx);
 }
 
+/**
+ * ipa3_fltrt_img_hdr_init() - prepare the header copy of a flt/rt image
+ * @img: the image copy
+ * @num: number of table header entries
+ *
+ * Keeps the entries already known, or marks all of them unknown if the
+ * number of entries changed.
+ *
+ * Return value: 0 on success, negative on failure
+ */
+int ipa3_fltrt_img_hdr_init(struct ipa3_fltrt_img *img, u32 num)
+{
+	u32 i;
+
+	if (img->hdr && img->hdr_num == num)
+		return 0;
+
+	kfree(img->hdr);
+	img->hdr_num = 0;
+	img->hdr = kmalloc_array(num, sizeof(*img->hdr), GFP_KERNEL);
+	if (!img->hdr)
+		return -ENOMEM;
+
+	for (i = 0; i < num; i++)
+		img->hdr[i] = IPA_FLTRT_IMG_HDR_INVAL;
+	img->hdr_num = num;
+
+	return 0;
+}
+
+/**
+ * ipa3_fltrt_img_hdr_changed() - check a table header entry against SRAM
+ * @img: the image copy
+ * @hdr: the newly generated table header
+ * @idx: index of the entry
+ *
+ * Return value: true if the entry needs to be written
+ */
+bool ipa3_fltrt_img_hdr_changed(struct ipa3_fltrt_img *img,
+	struct ipa_mem_buffer *hdr, u32 idx)
+{
+	if (!img->hdr || idx >= img->hdr_num)
+		return true;
+
+	return img->hdr[idx] != ((u64 *)hdr->base)[idx];
+}
+
+/**
+ * ipa3_fltrt_img_hdr_set() - record a table header entry written to SRAM
+ * @img: the image copy
+ * @hdr: the table header that was written
+ * @idx: index of the entry
+ */
+void ipa3_fltrt_img_hdr_set(struct ipa3_fltrt_img *img,
+	struct ipa_mem_buffer *hdr, u32 idx)
+{
+	if (img->hdr && idx < img->hdr_num)
+		img->hdr[idx] = ((u64 *)hdr->base)[idx];
+}
+
+/**
+ * ipa3_fltrt_img_bdy_changed() - check a local rules body against SRAM
+ * @img: the image copy
+ * @bdy: the newly generated local rules body
+ *
+ * Return value: true if the body needs to be written
+ */
+bool ipa3_fltrt_img_bdy_changed(struct ipa3_fltrt_img *img,
+	struct ipa_mem_buffer *bdy)
+{
+	if (!img->bdy_valid || img->bdy_sz != bdy->size)
+		return true;
+
+	return bdy->size && memcmp(img->bdy, bdy->base, bdy->size);
+}
+
+/**
+ * ipa3_fltrt_img_bdy_set() - record a local rules body written to SRAM
+ * @img: the image copy
+ * @bdy: the local rules body that was written
+ */
+void ipa3_fltrt_img_bdy_set(struct ipa3_fltrt_img *img,
+	struct ipa_mem_buffer *bdy)
+{
+	kfree(img->bdy);
+	img->bdy = NULL;
+	img->bdy_sz = 0;
+	img->bdy_valid = false;
+
+	if (bdy->size) {
+		img->bdy = kmemdup(bdy->base, bdy->size, GFP_KERNEL);
+		if (!img->bdy)
+			return;
+	}
+	img->bdy_sz = bdy->size;
+	img->bdy_valid = true;
+}
+
+/**
+ * ipa3_fltrt_img_invalidate() - forget what a flt/rt image holds in SRAM
+ * @img: the image copy
+ *
+ * The next commit will write the whole image.
+ */
+void ipa3_fltrt_img_invalidate(struct ipa3_fltrt_img *img)
+{
+	kfree(img->hdr);
+	kfree(img->bdy);
+	memset(img, 0, sizeof(*img));
+}
+
 /**
  * ipa3_write_64() - convert 64 bit value to byte array
  * @w: 64 bit integer
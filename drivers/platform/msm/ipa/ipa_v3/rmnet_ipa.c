@@ -52,6 +52,7 @@
 #define IPA_WWAN_DEV_NAME "rmnet_ipa%d"
 
 #define IPA_WWAN_RX_SOFTIRQ_THRESH 16
+#define IPA_WWAN_NAPI_WEIGHT 64
 
 #define INVALID_MUX_ID 0xFF
 #define IPA_QUOTA_REACH_ALERT_MAX_SIZE 64
@@ -83,6 +84,7 @@ struct ipa3_rmnet_plat_drv_res {
 	bool ipa_rmnet_ssr;
 	bool ipa_loaduC;
 	bool ipa_advertise_sg_support;
+	bool ipa_napi_enable;
 };
 
 /**
@@ -95,6 +97,7 @@ struct ipa3_rmnet_plat_drv_res {
  * @ch_id: channel id
  * @lock: spinlock for mutual exclusion
  * @device_status: holds device status
+ * @napi: NAPI context polling the IPA->APPS pipe, if enabled
  *
  * WWAN private - holds all relevant info about WWAN driver
  */
@@ -109,6 +112,7 @@ struct ipa3_wwan_private {
 	spinlock_t lock;
 	struct completion resource_granted_completion;
 	enum ipa3_wwan_device_status device_status;
+	struct napi_struct napi;
 };
 
 struct rmnet_ipa3_context {
@@ -1220,8 +1224,17 @@ static void apps_ipa_packet_receive_notify(void *priv,
 {
 	struct sk_buff *skb = (struct sk_buff *)data;
 	struct net_device *dev = (struct net_device *)priv;
+	struct ipa3_wwan_private *wwan_ptr = netdev_priv(dev);
 	int result;
-	unsigned int packet_len = skb->len;
+	unsigned int packet_len;
+
+	if (evt == IPA_CLIENT_START_POLL) {
+		napi_schedule(&wwan_ptr->napi);
+		return;
+	} else if (evt == IPA_CLIENT_COMP_NAPI) {
+		napi_complete(&wwan_ptr->napi);
+		return;
+	}
 
 	IPAWANDBG_LOW("Rx packet was received");
 	if (evt != IPA_RECEIVE) {
@@ -1229,10 +1242,18 @@ static void apps_ipa_packet_receive_notify(void *priv,
 		return;
 	}
 
+	packet_len = skb->len;
 	skb->dev = IPA_NETDEV();
 	skb->protocol = htons(ETH_P_MAP);
 
-	if (dev->stats.rx_packets % IPA_WWAN_RX_SOFTIRQ_THRESH == 0) {
+	/*
+	 * From the NAPI poll the packet goes straight up the stack, rmnet_data
+	 * then runs GRO on this NAPI context. Packets drained while the pipe
+	 * switches back to interrupt mode still arrive from process context.
+	 */
+	if (ipa3_rmnet_res.ipa_napi_enable && in_serving_softirq()) {
+		result = netif_receive_skb(skb);
+	} else if (dev->stats.rx_packets % IPA_WWAN_RX_SOFTIRQ_THRESH == 0) {
 		trace_rmnet_ipa_netifni3(dev->stats.rx_packets);
 		result = netif_rx_ni(skb);
 	} else {
@@ -1676,6 +1697,8 @@ static int ipa3_wwan_ioctl(struct net_device *dev, struct ifreq *ifr, int cmd)
 			rmnet_ipa3_ctx->ipa_to_apps_ep_cfg.desc_fifo_sz =
 				IPA_SYS_DESC_FIFO_SZ;
 			rmnet_ipa3_ctx->ipa_to_apps_ep_cfg.priv = dev;
+			rmnet_ipa3_ctx->ipa_to_apps_ep_cfg.napi_enabled =
+				ipa3_rmnet_res.ipa_napi_enable;
 
 			mutex_lock(&rmnet_ipa3_ctx->pipe_handle_guard);
 			if (atomic_read(&rmnet_ipa3_ctx->is_ssr)) {
@@ -2025,9 +2048,27 @@ static int get_ipa_rmnet_dts_configuration(struct platform_device *pdev,
 		"qcom,ipa-advertise-sg-support");
 	pr_info("IPA SG support = %s\n",
 		ipa_rmnet_drv_res->ipa_advertise_sg_support ? "True" : "False");
+
+	ipa_rmnet_drv_res->ipa_napi_enable =
+		of_property_read_bool(pdev->dev.of_node,
+		"qcom,ipa-napi-enable");
+	pr_info("IPA Napi Enable = %s\n",
+		ipa_rmnet_drv_res->ipa_napi_enable ? "True" : "False");
 	return 0;
 }
 
+/**
+ * ipa3_rmnet_poll() - NAPI poll of the IPA->APPS pipe
+ * @napi: NAPI context
+ * @budget: maximum number of buffers to handle
+ *
+ * Returns: number of buffers handled
+ */
+static int ipa3_rmnet_poll(struct napi_struct *napi, int budget)
+{
+	return ipa3_rx_poll(rmnet_ipa3_ctx->ipa3_to_apps_hdl, budget);
+}
+
 struct ipa3_rmnet_context ipa3_rmnet_ctx;
 static int ipa3_wwan_probe(struct platform_device *pdev);
 struct platform_device *m_pdev;
@@ -2205,6 +2246,12 @@ static int ipa3_wwan_probe(struct platform_device *pdev)
 	if (ipa3_rmnet_res.ipa_advertise_sg_support)
 		dev->hw_features |= NETIF_F_SG;
 
+	if (ipa3_rmnet_res.ipa_napi_enable) {
+		netif_napi_add(dev, &rmnet_ipa3_ctx->wwan_priv->napi,
+			ipa3_rmnet_poll, IPA_WWAN_NAPI_WEIGHT);
+		napi_enable(&rmnet_ipa3_ctx->wwan_priv->napi);
+	}
+
 	ret = register_netdev(dev);
 	if (ret) {
 		IPAWANERR("unable to register ipa_netdev %d rc=%d\n",
@@ -2284,6 +2331,8 @@ static int ipa3_wwan_remove(struct platform_device *pdev)
 	else
 		rmnet_ipa3_ctx->apps_to_ipa3_hdl = -1;
 	mutex_unlock(&rmnet_ipa3_ctx->pipe_handle_guard);
+	if (ipa3_rmnet_res.ipa_napi_enable)
+		napi_disable(&rmnet_ipa3_ctx->wwan_priv->napi);
 	unregister_netdev(IPA_NETDEV());
 	ret = ipa_rm_delete_dependency(IPA_RM_RESOURCE_WWAN_0_PROD,
 		IPA_RM_RESOURCE_Q6_CONS);
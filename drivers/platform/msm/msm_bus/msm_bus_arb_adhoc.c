@@ -16,6 +16,8 @@
 #include <linux/slab.h>
 #include <linux/rtmutex.h>
 #include <linux/clk.h>
+#include <linux/sched.h>
+#include <linux/workqueue.h>
 #include <linux/msm-bus.h>
 #include "msm_bus_core.h"
 #include "msm_bus_adhoc.h"
@@ -42,6 +44,20 @@ static LIST_HEAD(commit_list);
 
 DEFINE_RT_MUTEX(msm_bus_adhoc_lock);
 
+/*
+ * Client transactions. While the owning task has a transaction open, path
+ * updates only aggregate into the nodes and queue them on commit_list; the
+ * nodes are written once when the outermost transaction ends. The flush work
+ * bounds how long a vote can stay pending if a transaction is left open.
+ * Protected by msm_bus_adhoc_lock.
+ */
+static int txn_depth;
+static struct task_struct *txn_owner;
+static unsigned int txn_timeout_ms = 10;
+module_param(txn_timeout_ms, uint, S_IRUGO | S_IWUSR);
+static void txn_flush_fn(struct work_struct *work);
+static DECLARE_DELAYED_WORK(txn_flush_work, txn_flush_fn);
+
 static bool chk_bl_list(struct list_head *black_list, unsigned int id)
 {
 	struct msm_bus_node_device_type *bus_node = NULL;
@@ -654,7 +670,7 @@ static int msm_bus_apply_rules(struct list_head *list, bool after_clk_commit)
 	return ret;
 }
 
-static void commit_data(void)
+static void __commit_data(void)
 {
 	bool rules_registered = msm_rule_are_rules_registered();
 
@@ -675,6 +691,55 @@ static void commit_data(void)
 	INIT_LIST_HEAD(&commit_list);
 }
 
+static void commit_data(void)
+{
+	if (txn_depth && txn_owner == current) {
+		if (!delayed_work_pending(&txn_flush_work))
+			schedule_delayed_work(&txn_flush_work,
+					msecs_to_jiffies(txn_timeout_ms));
+		return;
+	}
+
+	/* Updates from other tasks also carry any pending transaction data */
+	__commit_data();
+}
+
+static void txn_flush_fn(struct work_struct *work)
+{
+	rt_mutex_lock(&msm_bus_adhoc_lock);
+	if (!list_empty(&commit_list)) {
+		MSM_BUS_DBG("%s: Flushing open transaction\n", __func__);
+		__commit_data();
+	}
+	rt_mutex_unlock(&msm_bus_adhoc_lock);
+}
+
+static void txn_begin_adhoc(void)
+{
+	rt_mutex_lock(&msm_bus_adhoc_lock);
+	if (!txn_depth)
+		txn_owner = current;
+	txn_depth++;
+	rt_mutex_unlock(&msm_bus_adhoc_lock);
+}
+
+static void txn_end_adhoc(void)
+{
+	rt_mutex_lock(&msm_bus_adhoc_lock);
+	if (WARN_ON(!txn_depth))
+		goto exit_txn_end;
+
+	if (--txn_depth)
+		goto exit_txn_end;
+
+	txn_owner = NULL;
+	cancel_delayed_work(&txn_flush_work);
+	if (!list_empty(&commit_list))
+		__commit_data();
+exit_txn_end:
+	rt_mutex_unlock(&msm_bus_adhoc_lock);
+}
+
 static void add_node_to_clist(struct msm_bus_node_device_type *node)
 {
 	struct msm_bus_node_device_type *node_parent =
@@ -1446,4 +1511,7 @@ void msm_bus_arb_setops_adhoc(struct msm_bus_arb_ops *arb_ops)
 	arb_ops->unregister = unregister_adhoc;
 	arb_ops->update_bw = update_bw_adhoc;
 	arb_ops->update_bw_context = update_bw_context;
+
+	arb_ops->txn_begin = txn_begin_adhoc;
+	arb_ops->txn_end = txn_end_adhoc;
 }
@@ -182,3 +182,29 @@ void msm_bus_scale_unregister(struct msm_bus_client_handle *cl)
 				__func__);
 }
 EXPORT_SYMBOL(msm_bus_scale_unregister);
+
+/**
+ * msm_bus_scale_txn_begin() - Start coalescing bus votes
+ *
+ * Votes placed by the calling task until the matching
+ * msm_bus_scale_txn_end() are aggregated but not sent to the hardware, so
+ * that each node touched is written once for the whole transaction.
+ * Transactions nest. Bus drivers without transaction support commit every
+ * vote immediately.
+ */
+void msm_bus_scale_txn_begin(void)
+{
+	if (arb_ops.txn_begin)
+		arb_ops.txn_begin();
+}
+EXPORT_SYMBOL(msm_bus_scale_txn_begin);
+
+/**
+ * msm_bus_scale_txn_end() - Commit the votes of the current transaction
+ */
+void msm_bus_scale_txn_end(void)
+{
+	if (arb_ops.txn_end)
+		arb_ops.txn_end();
+}
+EXPORT_SYMBOL(msm_bus_scale_txn_end);
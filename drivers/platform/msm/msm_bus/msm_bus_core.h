@@ -69,6 +69,8 @@ struct msm_bus_arb_ops {
 	void (*unregister)(struct msm_bus_client_handle *cl);
 	int (*update_bw_context)(struct msm_bus_client_handle *cl, u64 act_ab,
 				u64 act_ib, u64 slp_ib, u64 slp_ab);
+	void (*txn_begin)(void);
+	void (*txn_end)(void);
 };
 
 enum {
@@ -25,6 +25,7 @@
 #include <linux/delay.h>
 #include <linux/qpnp/qpnp-revid.h>
 #include <linux/qpnp/qpnp-haptic.h>
+#include <linux/input.h>
 #include "../../staging/android/timed_output.h"
 
 #define QPNP_IRQ_FLAGS	(IRQF_TRIGGER_RISING | \
@@ -152,6 +153,8 @@
 #define QPNP_HAP_MAX_RETRIES		5
 #define QPNP_HAP_CYCLS			5
 #define QPNP_TEST_TIMER_MS		5
+#define QPNP_HAP_MAX_EFFECTS		8
+#define QPNP_HAP_DISARM_MS		1000
 
 #define QPNP_HAP_TIME_REQ_FOR_BACK_EMF_GEN 20000
 
@@ -329,6 +332,19 @@ struct qpnp_pwm_info {
  *  @ misc_trim_error_rc19p2_clk_reg_present - if MISC Trim Error reg is present
  *  @ perform_lra_auto_resonance_search - whether lra auto resonance search
  *    algorithm should be performed or not.
+ *  @ effect_timer - timer to stop a pre-loaded effect
+ *  @ effect_stop_work - work to stop a pre-loaded effect
+ *  @ arm_work - work to arm the module on an interaction hint
+ *  @ disarm_work - delayed work to disable an idle armed module
+ *  @ input_nb - input interaction notifier
+ *  @ hint_time - time of the last interaction hint
+ *  @ lat - effect request to vibration start latency stats
+ *  @ effect_samp - wave samples of the pre-loaded effects
+ *  @ effect_ms - duration of the pre-loaded effects
+ *  @ nr_effects - number of pre-loaded effects
+ *  @ loaded_effect - effect in the wave sample registers, -1 if none
+ *  @ armed - module kept enabled so that an effect only needs PLAY
+ *  @ effect_playing - a pre-loaded effect is playing
  */
 struct qpnp_hap {
 	struct spmi_device *spmi;
@@ -393,6 +409,26 @@ struct qpnp_hap {
 	bool correct_lra_drive_freq;
 	bool misc_trim_error_rc19p2_clk_reg_present;
 	bool perform_lra_auto_resonance_search;
+	struct hrtimer effect_timer;
+	struct work_struct effect_stop_work;
+	struct work_struct arm_work;
+	struct delayed_work disarm_work;
+	struct notifier_block input_nb;
+	ktime_t hint_time;
+	struct {
+		u32 count;
+		u32 fast;
+		u32 last_us;
+		u32 max_us;
+		u64 total_us;
+		u32 hint_us;
+	} lat;
+	u8 effect_samp[QPNP_HAP_MAX_EFFECTS][QPNP_HAP_WAV_SAMP_LEN];
+	u32 effect_ms[QPNP_HAP_MAX_EFFECTS];
+	int nr_effects;
+	int loaded_effect;
+	bool armed;
+	bool effect_playing;
 };
 
 static struct qpnp_hap *ghap;
@@ -583,6 +619,9 @@ static irqreturn_t qpnp_hap_play_irq(int irq, void *_hap)
 
 	mutex_lock(&hap->wf_lock);
 
+	if (hap->wf_update)
+		hap->loaded_effect = -1;
+
 	/* Configure WAVE_SAMPLE1 to WAVE_SAMPLE8 register */
 	for (i = 0; i < QPNP_HAP_WAV_SAMP_LEN && hap->wf_update; i++) {
 		reg = hap->wave_samp[i] = hap->shadow_wave_samp[i];
@@ -669,6 +708,7 @@ static int qpnp_hap_buffer_config(struct qpnp_hap *hap)
 		if (rc)
 			return rc;
 	}
+	hap->loaded_effect = -1;
 
 	/* setup play irq */
 	if (hap->use_play_irq) {
@@ -867,6 +907,27 @@ static int qpnp_hap_parse_buffer_dt(struct qpnp_hap *hap)
 		memcpy(hap->wave_samp, prop->value, QPNP_HAP_WAV_SAMP_LEN);
 	}
 
+	/* effects are 8 samples each, effect 0 is pre-loaded at boot */
+	prop = of_find_property(spmi->dev.of_node,
+			"qcom,effect-wave-samples", &temp);
+	if (prop) {
+		if (!temp || temp % QPNP_HAP_WAV_SAMP_LEN ||
+		    temp / QPNP_HAP_WAV_SAMP_LEN > QPNP_HAP_MAX_EFFECTS) {
+			dev_err(&spmi->dev, "Invalid effect wave samples\n");
+			return -EINVAL;
+		}
+		hap->nr_effects = temp / QPNP_HAP_WAV_SAMP_LEN;
+		memcpy(hap->effect_samp, prop->value, temp);
+
+		rc = of_property_read_u32_array(spmi->dev.of_node,
+				"qcom,effect-durations-ms", hap->effect_ms,
+				hap->nr_effects);
+		if (rc) {
+			dev_err(&spmi->dev, "Unable to read effect durations\n");
+			return rc;
+		}
+	}
+
 	hap->use_play_irq = of_property_read_bool(spmi->dev.of_node,
 				"qcom,use-play-irq");
 	if (hap->use_play_irq) {
@@ -1409,6 +1470,70 @@ static ssize_t qpnp_hap_ramp_test_data_show(struct device *dev,
 
 }
 
+/* sysfs store to play a pre-loaded effect */
+static ssize_t qpnp_hap_effect_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	ktime_t req_time = ktime_get();
+	int id, rc;
+
+	if (sscanf(buf, "%d", &id) != 1)
+		return -EINVAL;
+
+	rc = qpnp_hap_play_effect(id, req_time);
+
+	return rc < 0 ? rc : count;
+}
+
+static ssize_t qpnp_hap_effect_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct timed_output_dev *timed_dev = dev_get_drvdata(dev);
+	struct qpnp_hap *hap = container_of(timed_dev, struct qpnp_hap,
+					 timed_dev);
+
+	return snprintf(buf, PAGE_SIZE, "loaded %d of %d, %sarmed\n",
+			hap->loaded_effect, hap->nr_effects,
+			hap->armed ? "" : "not ");
+}
+
+/* sysfs show effect latency stats, any write resets them */
+static ssize_t qpnp_hap_effect_latency_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct timed_output_dev *timed_dev = dev_get_drvdata(dev);
+	struct qpnp_hap *hap = container_of(timed_dev, struct qpnp_hap,
+					 timed_dev);
+	u32 avg_us = 0;
+	ssize_t count;
+
+	mutex_lock(&hap->lock);
+	if (hap->lat.count)
+		avg_us = div_u64(hap->lat.total_us, hap->lat.count);
+	count = snprintf(buf, PAGE_SIZE,
+			"count=%u fast=%u last_us=%u avg_us=%u max_us=%u "
+			"hint_us=%u\n", hap->lat.count, hap->lat.fast,
+			hap->lat.last_us, avg_us, hap->lat.max_us,
+			hap->lat.hint_us);
+	mutex_unlock(&hap->lock);
+
+	return count;
+}
+
+static ssize_t qpnp_hap_effect_latency_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct timed_output_dev *timed_dev = dev_get_drvdata(dev);
+	struct qpnp_hap *hap = container_of(timed_dev, struct qpnp_hap,
+					 timed_dev);
+
+	mutex_lock(&hap->lock);
+	memset(&hap->lat, 0, sizeof(hap->lat));
+	mutex_unlock(&hap->lock);
+
+	return count;
+}
+
 /* sysfs attributes */
 static struct device_attribute qpnp_hap_attrs[] = {
 	__ATTR(wf_s0, (S_IRUGO | S_IWUSR | S_IWGRP),
@@ -1459,6 +1584,12 @@ static struct device_attribute qpnp_hap_attrs[] = {
 	__ATTR(min_max_test, (S_IRUGO | S_IWUSR | S_IWGRP),
 			qpnp_hap_min_max_test_data_show,
 			qpnp_hap_min_max_test_data_store),
+	__ATTR(effect, (S_IRUGO | S_IWUSR | S_IWGRP),
+			qpnp_hap_effect_show,
+			qpnp_hap_effect_store),
+	__ATTR(effect_latency, (S_IRUGO | S_IWUSR | S_IWGRP),
+			qpnp_hap_effect_latency_show,
+			qpnp_hap_effect_latency_store),
 };
 
 static int calculate_lra_code(struct qpnp_hap *hap)
@@ -1721,6 +1852,8 @@ static void qpnp_hap_td_enable(struct timed_output_dev *dev, int value)
 		hrtimer_cancel(&hap->auto_res_err_poll_timer);
 
 	hrtimer_cancel(&hap->hap_timer);
+	hrtimer_cancel(&hap->effect_timer);
+	hap->effect_playing = false;
 
 	if (value == 0) {
 		if (hap->state == 0) {
@@ -1797,6 +1930,216 @@ int qpnp_hap_play_byte(u8 data, bool on)
 }
 EXPORT_SYMBOL(qpnp_hap_play_byte);
 
+/* load wave samples of a pre-loaded effect, or the default ones for -1 */
+static int qpnp_hap_load_effect(struct qpnp_hap *hap, int id)
+{
+	const u8 *samp = id < 0 ? hap->wave_samp : hap->effect_samp[id];
+	int rc = 0, i;
+	u8 reg;
+
+	mutex_lock(&hap->wf_lock);
+	for (i = 0; i < QPNP_HAP_WAV_SAMP_LEN; i++) {
+		reg = samp[i];
+		rc = qpnp_hap_write_reg(hap, &reg,
+			QPNP_HAP_WAV_S_REG_BASE(hap->base) + i);
+		if (rc) {
+			id = -1;
+			break;
+		}
+	}
+	hap->loaded_effect = id;
+	mutex_unlock(&hap->wf_lock);
+
+	return rc;
+}
+
+/* keep the module enabled, hap->lock held */
+static int qpnp_hap_arm(struct qpnp_hap *hap)
+{
+	int rc;
+
+	if (hap->armed)
+		return 0;
+
+	if (hap->vcc_pon && !hap->vcc_pon_enabled) {
+		rc = regulator_enable(hap->vcc_pon);
+		if (rc < 0)
+			return rc;
+		hap->vcc_pon_enabled = true;
+	}
+
+	rc = qpnp_hap_mod_enable(hap, true);
+	if (rc < 0)
+		return rc;
+
+	hap->armed = true;
+
+	return 0;
+}
+
+static void qpnp_hap_disarm_work(struct work_struct *work)
+{
+	struct qpnp_hap *hap = container_of(work, struct qpnp_hap,
+					 disarm_work.work);
+
+	mutex_lock(&hap->lock);
+	if (hap->armed && !hap->effect_playing && !hap->state) {
+		qpnp_hap_mod_enable(hap, false);
+		if (hap->vcc_pon && hap->vcc_pon_enabled &&
+				!regulator_disable(hap->vcc_pon))
+			hap->vcc_pon_enabled = false;
+		hap->armed = false;
+	}
+	mutex_unlock(&hap->lock);
+}
+
+static void qpnp_hap_effect_stop_work(struct work_struct *work)
+{
+	struct qpnp_hap *hap = container_of(work, struct qpnp_hap,
+					 effect_stop_work);
+
+	mutex_lock(&hap->lock);
+	if (hap->effect_playing) {
+		qpnp_hap_play(hap, false);
+		hap->effect_playing = false;
+		schedule_delayed_work(&hap->disarm_work,
+				msecs_to_jiffies(QPNP_HAP_DISARM_MS));
+	}
+	mutex_unlock(&hap->lock);
+}
+
+static enum hrtimer_restart qpnp_hap_effect_timer(struct hrtimer *timer)
+{
+	struct qpnp_hap *hap = container_of(timer, struct qpnp_hap,
+							 effect_timer);
+
+	schedule_work(&hap->effect_stop_work);
+
+	return HRTIMER_NORESTART;
+}
+
+static void qpnp_hap_effect_stats(struct qpnp_hap *hap, ktime_t req_time,
+				bool fast)
+{
+	ktime_t now = ktime_get();
+	u32 us = ktime_us_delta(now, req_time);
+
+	hap->lat.count++;
+	if (fast)
+		hap->lat.fast++;
+	hap->lat.last_us = us;
+	hap->lat.max_us = max(hap->lat.max_us, us);
+	hap->lat.total_us += us;
+	if (ktime_to_ns(hap->hint_time))
+		hap->lat.hint_us = ktime_us_delta(now, hap->hint_time);
+	hap->hint_time = ktime_set(0, 0);
+}
+
+/**
+ * qpnp_hap_play_effect() - play a pre-loaded effect
+ * @id: effect index in qcom,effect-wave-samples
+ * @req_time: time of the request for the latency stats, 0 for now
+ *
+ * When the effect is already in the wave sample registers and the module
+ * is armed, only the PLAY register is written. The LRA auto resonance
+ * start-up sequence of the timed output path is skipped, effects are
+ * expected to be short clicks. May sleep.
+ */
+int qpnp_hap_play_effect(int id, ktime_t req_time)
+{
+	struct qpnp_hap *hap = ghap;
+	bool fast;
+	int rc;
+
+	if (!hap) {
+		pr_err("Haptics is not initialized\n");
+		return -EINVAL;
+	}
+
+	if (hap->play_mode != QPNP_HAP_BUFFER) {
+		dev_err(&hap->spmi->dev, "only buffer mode is supported\n");
+		return -EINVAL;
+	}
+
+	if (id < 0 || id >= hap->nr_effects)
+		return -EINVAL;
+
+	if (!ktime_to_ns(req_time))
+		req_time = ktime_get();
+
+	mutex_lock(&hap->lock);
+	/* the timed output interface owns the engine while it plays */
+	if (hap->state) {
+		rc = -EBUSY;
+		goto unlock;
+	}
+
+	hrtimer_cancel(&hap->effect_timer);
+	cancel_delayed_work(&hap->disarm_work);
+
+	fast = hap->armed && hap->loaded_effect == id && !hap->effect_playing;
+	if (hap->effect_playing) {
+		rc = qpnp_hap_play(hap, false);
+		if (rc < 0)
+			goto unlock;
+		hap->effect_playing = false;
+	}
+
+	if (hap->loaded_effect != id) {
+		rc = qpnp_hap_load_effect(hap, id);
+		if (rc < 0)
+			goto unlock;
+	}
+
+	rc = qpnp_hap_arm(hap);
+	if (rc < 0)
+		goto unlock;
+
+	rc = qpnp_hap_play(hap, true);
+	if (rc < 0)
+		goto unlock;
+
+	hap->effect_playing = true;
+	qpnp_hap_effect_stats(hap, req_time, fast);
+	hrtimer_start(&hap->effect_timer, ms_to_ktime(hap->effect_ms[id]),
+			HRTIMER_MODE_REL);
+unlock:
+	mutex_unlock(&hap->lock);
+
+	return rc;
+}
+EXPORT_SYMBOL(qpnp_hap_play_effect);
+
+/* a touch usually precedes keyboard haptics, get the engine ready */
+static void qpnp_hap_arm_work(struct work_struct *work)
+{
+	struct qpnp_hap *hap = container_of(work, struct qpnp_hap, arm_work);
+
+	mutex_lock(&hap->lock);
+	if (hap->state || hap->effect_playing)
+		goto unlock;
+
+	if (hap->loaded_effect < 0 && qpnp_hap_load_effect(hap, 0))
+		goto unlock;
+
+	if (!qpnp_hap_arm(hap))
+		mod_delayed_work(system_wq, &hap->disarm_work,
+				msecs_to_jiffies(QPNP_HAP_DISARM_MS));
+unlock:
+	mutex_unlock(&hap->lock);
+}
+
+static int qpnp_hap_input_notify(struct notifier_block *nb,
+				unsigned long val, void *data)
+{
+	struct qpnp_hap *hap = container_of(nb, struct qpnp_hap, input_nb);
+
+	hap->hint_time = *(ktime_t *)data;
+	schedule_work(&hap->arm_work);
+
+	return NOTIFY_OK;
+}
+
 /* worker to opeate haptics */
 static void qpnp_hap_worker(struct work_struct *work)
 {
@@ -1821,9 +2164,15 @@ static void qpnp_hap_worker(struct work_struct *work)
 		rc = qpnp_hap_write_reg(hap, &val,
 				QPNP_HAP_EN_CTL_REG(hap->base));
 	} else {
+		/* put back the default waveform a pre-loaded effect replaced */
+		if (hap->state && hap->play_mode == QPNP_HAP_BUFFER &&
+				hap->loaded_effect >= 0)
+			qpnp_hap_load_effect(hap, -1);
 		if (hap->play_mode == QPNP_HAP_PWM)
 			qpnp_hap_mod_enable(hap, hap->state);
 		qpnp_hap_set(hap, hap->state);
+		if (!hap->state)
+			hap->armed = false;
 	}
 
 	if (hap->vcc_pon && !hap->state && hap->vcc_pon_enabled) {
@@ -1880,8 +2229,14 @@ static int qpnp_haptic_suspend(struct device *dev)
 	struct qpnp_hap *hap = dev_get_drvdata(dev);
 	hrtimer_cancel(&hap->hap_timer);
 	cancel_work_sync(&hap->work);
+	hrtimer_cancel(&hap->effect_timer);
+	cancel_work_sync(&hap->effect_stop_work);
+	cancel_work_sync(&hap->arm_work);
+	cancel_delayed_work_sync(&hap->disarm_work);
 	/* turn-off haptic */
 	qpnp_hap_set(hap, 0);
+	hap->effect_playing = false;
+	hap->armed = false;
 
 	return 0;
 }
@@ -2585,6 +2940,7 @@ static int qpnp_haptic_probe(struct spmi_device *spmi)
 		return rc;
 	}
 
+	hap->loaded_effect = -1;
 	rc = qpnp_hap_config(hap);
 	if (rc) {
 		dev_err(&spmi->dev, "hap config failed\n");
@@ -2596,6 +2952,11 @@ static int qpnp_haptic_probe(struct spmi_device *spmi)
 	INIT_WORK(&hap->work, qpnp_hap_worker);
 	INIT_DELAYED_WORK(&hap->sc_work, qpnp_handle_sc_irq);
 	init_completion(&hap->completion);
+	INIT_WORK(&hap->effect_stop_work, qpnp_hap_effect_stop_work);
+	INIT_WORK(&hap->arm_work, qpnp_hap_arm_work);
+	INIT_DELAYED_WORK(&hap->disarm_work, qpnp_hap_disarm_work);
+	hrtimer_init(&hap->effect_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	hap->effect_timer.function = qpnp_hap_effect_timer;
 
 	hrtimer_init(&hap->hap_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
 	hap->hap_timer.function = qpnp_hap_timer;
@@ -2640,6 +3001,13 @@ static int qpnp_haptic_probe(struct spmi_device *spmi)
 		hap->vcc_pon = vcc_pon;
 	}
 
+	if (hap->nr_effects && hap->play_mode == QPNP_HAP_BUFFER) {
+		if (qpnp_hap_load_effect(hap, 0))
+			dev_err(&spmi->dev, "Unable to pre-load effect\n");
+		hap->input_nb.notifier_call = qpnp_hap_input_notify;
+		input_register_interaction_notifier(&hap->input_nb);
+	}
+
 	ghap = hap;
 
 	return 0;
@@ -2670,6 +3038,12 @@ static int qpnp_haptic_remove(struct spmi_device *spmi)
 		sysfs_remove_file(&hap->timed_dev.dev->kobj,
 				&qpnp_hap_attrs[i].attr);
 
+	if (hap->input_nb.notifier_call)
+		input_unregister_interaction_notifier(&hap->input_nb);
+	hrtimer_cancel(&hap->effect_timer);
+	cancel_work_sync(&hap->effect_stop_work);
+	cancel_work_sync(&hap->arm_work);
+	cancel_delayed_work_sync(&hap->disarm_work);
 	cancel_work_sync(&hap->work);
 	if (hap->act_type == QPNP_HAP_LRA && hap->correct_lra_drive_freq &&
 						!hap->lra_hw_auto_resonance)
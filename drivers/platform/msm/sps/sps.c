@@ -1645,6 +1645,56 @@ int sps_transfer(struct sps_pipe *h, struct sps_transfer *transfer)
 }
 EXPORT_SYMBOL(sps_transfer);
 
+/**
+ * Submit a batch of descriptors on an SPS connection end point
+ *
+ */
+int sps_transfer_batch(struct sps_pipe *h, struct sps_iovec *iovec,
+		       void **user, u32 count)
+{
+	struct sps_pipe *pipe = h;
+	struct sps_bam *bam;
+	int result;
+	u32 i;
+
+	if (h == NULL) {
+		SPS_ERR(sps, "sps:%s:pipe is NULL.\n", __func__);
+		return SPS_ERROR;
+	} else if (iovec == NULL) {
+		SPS_ERR(sps, "sps:%s:iovec list is NULL.\n", __func__);
+		return SPS_ERROR;
+	} else if (count == 0) {
+		SPS_ERR(sps, "sps:%s:iovec list is empty.\n", __func__);
+		return SPS_ERROR;
+	}
+
+	/* Verify content of IOVECs */
+	for (i = 0; i < count; i++) {
+		if (iovec[i].size > SPS_IOVEC_MAX_SIZE) {
+			SPS_ERR(sps,
+				"sps:%s:iovec size is invalid.\n", __func__);
+			return SPS_ERROR;
+		}
+
+		if (sps_check_iovec_flags(iovec[i].flags))
+			return SPS_ERROR;
+	}
+
+	bam = sps_bam_lock(pipe);
+	if (bam == NULL)
+		return SPS_ERROR;
+
+	SPS_DBG(bam, "sps:%s; count:%d.\n", __func__, count);
+
+	result = sps_bam_pipe_transfer_batch(bam, pipe->pipe_index, iovec,
+					     user, count);
+
+	sps_bam_unlock(bam);
+
+	return result;
+}
+EXPORT_SYMBOL(sps_transfer_batch);
+
 /**
  * Perform a single DMA transfer on an SPS connection end point
  *
@@ -2367,6 +2417,43 @@ int sps_get_iovec(struct sps_pipe *h, struct sps_iovec *iovec)
 }
 EXPORT_SYMBOL(sps_get_iovec);
 
+/**
+ * Get a batch of processed I/O vectors (completed transfers)
+ *
+ */
+int sps_get_iovecs(struct sps_pipe *h, struct sps_iovec *iovec, u32 budget,
+		   u32 *count)
+{
+	struct sps_pipe *pipe = h;
+	struct sps_bam *bam;
+	int result;
+
+	if (h == NULL) {
+		SPS_ERR(sps, "sps:%s:pipe is NULL.\n", __func__);
+		return SPS_ERROR;
+	} else if (iovec == NULL || count == NULL) {
+		SPS_ERR(sps, "sps:%s:iovec or count pointer is NULL.\n",
+			__func__);
+		return SPS_ERROR;
+	}
+
+	bam = sps_bam_lock(pipe);
+	if (bam == NULL) {
+		SPS_ERR(sps, "sps:%s:BAM is not found by handle.\n", __func__);
+		return SPS_ERROR;
+	}
+
+	SPS_DBG(bam, "sps:%s; BAM: %pa; pipe index:%d; budget:%d.\n",
+		__func__, BAM_ID(bam), pipe->pipe_index, budget);
+
+	result = sps_bam_pipe_get_iovecs(bam, pipe->pipe_index, iovec, budget,
+					 count);
+	sps_bam_unlock(bam);
+
+	return result;
+}
+EXPORT_SYMBOL(sps_get_iovecs);
+
 /**
  * Perform timer control
  *
@@ -1554,6 +1554,33 @@ int sps_bam_pipe_transfer_one(struct sps_bam *dev,
 	return 0;
 }
 
+/*
+ * Check that the descriptor FIFO of a BAM pipe has room for count more
+ * descriptors.
+ */
+static int sps_bam_pipe_check_free(struct sps_bam *dev, u32 pipe_index,
+				   u32 desc_count)
+{
+	u32 count;
+	struct sps_pipe *pipe = dev->pipes[pipe_index];
+
+	if (!pipe->sys.ack_xfers && pipe->polled) {
+		sps_bam_pipe_get_unused_desc_num(dev, pipe_index,
+					&count);
+		count = pipe->desc_size / sizeof(struct sps_iovec) - count - 1;
+	} else
+		sps_bam_get_free_count(dev, pipe_index, &count);
+
+	if (count < desc_count) {
+		SPS_ERR(dev,
+			"sps:Insufficient free desc: BAM %pa pipe %d: %d\n",
+			BAM_ID(dev), pipe_index, count);
+		return SPS_ERROR;
+	}
+
+	return 0;
+}
+
 /**
  * Submit a transfer to a BAM pipe
  *
@@ -1562,32 +1589,18 @@ int sps_bam_pipe_transfer(struct sps_bam *dev,
 			 u32 pipe_index, struct sps_transfer *transfer)
 {
 	struct sps_iovec *iovec;
-	u32 count;
 	u32 flags;
 	void *user;
 	int n;
 	int result;
-	struct sps_pipe *pipe = dev->pipes[pipe_index];
-
 	if (transfer->iovec_count == 0) {
 		SPS_ERR(dev, "sps:iovec count zero: BAM %pa pipe %d\n",
 			BAM_ID(dev), pipe_index);
 		return SPS_ERROR;
 	}
 
-	if (!pipe->sys.ack_xfers && pipe->polled) {
-		sps_bam_pipe_get_unused_desc_num(dev, pipe_index,
-					&count);
-		count = pipe->desc_size / sizeof(struct sps_iovec) - count - 1;
-	} else
-		sps_bam_get_free_count(dev, pipe_index, &count);
-
-	if (count < transfer->iovec_count) {
-		SPS_ERR(dev,
-			"sps:Insufficient free desc: BAM %pa pipe %d: %d\n",
-			BAM_ID(dev), pipe_index, count);
+	if (sps_bam_pipe_check_free(dev, pipe_index, transfer->iovec_count))
 		return SPS_ERROR;
-	}
 
 	user = NULL;		/* NULL for all except last descriptor */
 	for (n = (int)transfer->iovec_count - 1, iovec = transfer->iovec;
@@ -1611,6 +1624,58 @@ int sps_bam_pipe_transfer(struct sps_bam *dev,
 	return 0;
 }
 
+/**
+ * Submit a batch of descriptors to a BAM pipe
+ *
+ */
+int sps_bam_pipe_transfer_batch(struct sps_bam *dev, u32 pipe_index,
+				struct sps_iovec *iovec, void **user,
+				u32 count)
+{
+	struct sps_pipe *pipe = dev->pipes[pipe_index];
+	u32 flags;
+	u32 n;
+	int result;
+
+	if (count == 0) {
+		SPS_ERR(dev, "sps:iovec count zero: BAM %pa pipe %d\n",
+			BAM_ID(dev), pipe_index);
+		return SPS_ERROR;
+	}
+
+	/* Fail the whole batch up front rather than half way through it */
+	if ((pipe->state & (BAM_STATE_BAM2BAM | BAM_STATE_REMOTE))) {
+		SPS_ERR(dev, "sps:Transfer on BAM-to-BAM: BAM %pa pipe %d\n",
+			BAM_ID(dev), pipe_index);
+		return SPS_ERROR;
+	}
+
+	if (pipe->sys.no_queue && user != NULL) {
+		SPS_ERR(dev, "sps:User pointer arg non-NULL: BAM %pa pipe %d\n",
+			BAM_ID(dev), pipe_index);
+		return SPS_ERROR;
+	}
+
+	if (sps_bam_pipe_check_free(dev, pipe_index, count))
+		return SPS_ERROR;
+
+	for (n = 0; n < count; n++, iovec++) {
+		flags = iovec->flags;
+		/* Only the last descriptor updates the write pointer */
+		if (n < count - 1)
+			flags |= SPS_IOVEC_FLAG_NO_SUBMIT;
+
+		result = sps_bam_pipe_transfer_one(dev, pipe_index,
+						   iovec->addr, iovec->size,
+						   user ? user[n] : NULL,
+						   flags);
+		if (result)
+			return SPS_ERROR;
+	}
+
+	return 0;
+}
+
 int sps_bam_pipe_inject_zlt(struct sps_bam *dev, u32 pipe_index)
 {
 	struct sps_pipe *pipe = dev->pipes[pipe_index];
@@ -2247,6 +2312,60 @@ int sps_bam_pipe_get_iovec(struct sps_bam *dev, u32 pipe_index,
 	return 0;
 }
 
+/**
+ * Get a batch of processed I/O vectors
+ *
+ */
+int sps_bam_pipe_get_iovecs(struct sps_bam *dev, u32 pipe_index,
+			    struct sps_iovec *iovec, u32 budget, u32 *count)
+{
+	struct sps_pipe *pipe = dev->pipes[pipe_index];
+	struct sps_iovec *desc;
+	u32 read_offset;
+	u32 n;
+
+	*count = 0;
+
+	/* Is this a valid pipe configured for get_iovec use? */
+	if (!pipe->sys.ack_xfers ||
+	    (pipe->state & BAM_STATE_BAM2BAM) != 0 ||
+	    (pipe->state & BAM_STATE_REMOTE)) {
+		return SPS_ERROR;
+	}
+
+	/* If pipe is polled and queue is enabled, perform polling operation */
+	if ((pipe->polled || pipe->hybrid) && !pipe->sys.no_queue)
+		pipe_handler_eot(dev, pipe);
+
+	if (pipe->sys.no_queue)
+		read_offset =
+		bam_pipe_get_desc_read_offset(&dev->base, pipe_index);
+	else
+		read_offset = pipe->sys.cache_offset;
+
+	for (n = 0; n < budget && read_offset != pipe->sys.acked_offset;
+	     n++) {
+		desc = (struct sps_iovec *) (pipe->sys.desc_buf +
+					     pipe->sys.acked_offset);
+		iovec[n] = *desc;
+#ifdef SPS_BAM_STATISTICS
+		pipe->sys.get_iovecs++;
+#endif /* SPS_BAM_STATISTICS */
+
+		pipe->sys.acked_offset += sizeof(struct sps_iovec);
+		if (pipe->sys.acked_offset >= pipe->desc_size)
+			pipe->sys.acked_offset = 0;
+	}
+
+	*count = n;
+
+	SPS_DBG(dev,
+		"sps:%s; pipe index:%d; fetched %d iovecs; acked_offset:0x%x.\n",
+		__func__, pipe->pipe_index, n, pipe->sys.acked_offset);
+
+	return 0;
+}
+
 /**
  * Determine whether a BAM pipe descriptor FIFO is empty
  *
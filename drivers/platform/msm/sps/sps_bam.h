@@ -461,6 +461,29 @@ int sps_bam_pipe_transfer_one(struct sps_bam *dev, u32 pipe_index, u32 addr,
 int sps_bam_pipe_transfer(struct sps_bam *dev, u32 pipe_index,
 			 struct sps_transfer *transfer);
 
+/**
+ * Submit a batch of descriptors to a BAM pipe
+ *
+ * This function queues a number of descriptors, each with its own user
+ * pointer, and updates the descriptor FIFO write pointer once.
+ *
+ * @dev - pointer to BAM device descriptor
+ *
+ * @pipe_index - pipe index
+ *
+ * @iovec - array of I/O vectors
+ *
+ * @user - array of user pointers, or NULL
+ *
+ * @count - number of I/O vectors
+ *
+ * @return 0 on success, negative value on error
+ *
+ */
+int sps_bam_pipe_transfer_batch(struct sps_bam *dev, u32 pipe_index,
+				struct sps_iovec *iovec, void **user,
+				u32 count);
+
 /**
  * Get a BAM pipe event
  *
@@ -495,6 +518,26 @@ int sps_bam_pipe_get_event(struct sps_bam *dev, u32 pipe_index,
 int sps_bam_pipe_get_iovec(struct sps_bam *dev, u32 pipe_index,
 			   struct sps_iovec *iovec);
 
+/**
+ * Get a batch of processed I/O vectors
+ *
+ * This function fetches up to budget processed I/O vectors.
+ *
+ * @dev - pointer to BAM device descriptor
+ *
+ * @pipe_index - pipe index
+ *
+ * @iovec - array of I/O vector structs (output)
+ *
+ * @budget - maximum number of I/O vectors to fetch
+ *
+ * @count - number of I/O vectors fetched (output)
+ *
+ * @return 0 on success, negative value on error
+ */
+int sps_bam_pipe_get_iovecs(struct sps_bam *dev, u32 pipe_index,
+			    struct sps_iovec *iovec, u32 budget, u32 *count);
+
 /**
  * Determine whether a BAM pipe descriptor FIFO is empty
  *
@@ -47,6 +47,12 @@
 #define BATTERY_VOLTAGE_MIN 3400
 #define BTM_8084_FREQ_MITIG_LIMIT 1958400
 #define MAX_CPU_NAME 10
+/*
+ * Graduated mitigation: re-evaluate Ibat/Vbat every 100 msec and step back
+ * up one OPP after 5 consecutive evaluations with both of them clear.
+ */
+#define BCL_STEP_POLL_MS 100
+#define BCL_STEP_RECOVER_POLLS 5
 
 #define BCL_FETCH_DT_U32(_dev, _key, _search_str, _ret, _out, _exit) do { \
 		_key = _search_str; \
@@ -188,6 +194,20 @@ struct bcl_context {
 	struct device_clnt_data *hotplug_handle;
 	struct device_clnt_data *cpufreq_handle[NR_CPUS];
 	bool bcl_charger_mitigate_enabe;
+
+	/* Graduated mitigation, one OPP at a time, instead of a full cap */
+	bool bcl_step_enabled;
+	/* Number of OPPs below the max currently requested */
+	int step_level;
+	/* Consecutive evaluations with Ibat and Vbat both clear */
+	int step_clear_cnt;
+	/* Every controlled CPU is down to bcl_p_freq_max */
+	bool step_exhausted;
+	/* Ibat or Vbat beyond its trip threshold at the last evaluation */
+	bool step_beyond;
+	uint32_t step_poll_ms;
+	uint32_t step_recover_polls;
+	struct delayed_work step_work;
 };
 
 enum bcl_threshold_state {
@@ -219,6 +239,48 @@ static uint32_t soc_low_threshold;
 static struct power_supply bcl_psy;
 static const char bcl_psy_name[] = "bcl";
 
+static bool bcl_step_mode(void)
+{
+	return gbcl->bcl_step_enabled
+		&& gbcl->bcl_monitor_type == BCL_IBAT_PERIPH_MONITOR_TYPE;
+}
+
+/*
+ * Max frequency of @cpu @level OPPs below its highest one, never going below
+ * the full mitigation frequency. @at_floor is set once that is reached.
+ */
+static uint32_t bcl_step_freq(int cpu, int level, bool *at_floor)
+{
+	struct cpufreq_frequency_table *table, *pos;
+	uint32_t cap = UINT_MAX, next;
+
+	*at_floor = false;
+	if (!level)
+		return UINT_MAX;
+
+	table = cpufreq_frequency_get_table(cpu);
+	if (!table) {
+		*at_floor = true;
+		return gbcl->bcl_p_freq_max;
+	}
+
+	/* The first pass only finds the highest OPP */
+	for (level++; level; level--) {
+		next = 0;
+		cpufreq_for_each_valid_entry(pos, table) {
+			if (pos->frequency < cap && pos->frequency > next)
+				next = pos->frequency;
+		}
+		if (next <= gbcl->bcl_p_freq_max) {
+			*at_floor = true;
+			return gbcl->bcl_p_freq_max;
+		}
+		cap = next;
+	}
+
+	return cap;
+}
+
 static void bcl_handle_hotplug(struct work_struct *work)
 {
 	int ret = 0, cpu = 0;
@@ -230,6 +292,10 @@ static void bcl_handle_hotplug(struct work_struct *work)
 	if  (bcl_soc_state == BCL_LOW_THRESHOLD
 		&& bcl_charger_state != BCL_CHARGER_ACTIVE)
 		bcl_hotplug_request = bcl_soc_hotplug_mask;
+	else if (bcl_step_mode()
+		&& !(gbcl->step_exhausted && gbcl->step_beyond))
+		/* Hotplug only once stepping down frequency is not enough */
+		bcl_hotplug_request = 0;
 	else if (bcl_vph_state == BCL_LOW_THRESHOLD)
 		bcl_hotplug_request = bcl_soc_hotplug_mask;
 	else if (bcl_ibat_state == BCL_HIGH_THRESHOLD)
@@ -260,7 +326,8 @@ handle_hotplug_exit:
 
 static void update_cpu_freq(void)
 {
-	int cpu, ret = 0;
+	int cpu, ret = 0, step_level = 0;
+	bool at_floor, exhausted = true;
 	union device_request cpufreq_req;
 
 	trace_bcl_sw_mitigation_event("Start Frequency Mitigate");
@@ -268,18 +335,27 @@ static void update_cpu_freq(void)
 	cpufreq_req.freq.max_freq = UINT_MAX;
 	cpufreq_req.freq.min_freq = CPUFREQ_MIN_NO_MITIGATION;
 
-	if (bcl_vph_state == BCL_LOW_THRESHOLD
-		|| bcl_ibat_state == BCL_HIGH_THRESHOLD
+	if ((!bcl_step_mode() && (bcl_vph_state == BCL_LOW_THRESHOLD
+		|| bcl_ibat_state == BCL_HIGH_THRESHOLD))
 		|| (bcl_soc_state == BCL_LOW_THRESHOLD
 		&& bcl_charger_state !=  BCL_CHARGER_ACTIVE)) {
 		cpufreq_req.freq.max_freq = (gbcl->bcl_monitor_type
 			== BCL_IBAT_MONITOR_TYPE) ? gbcl->btm_freq_max
 			: gbcl->bcl_p_freq_max;
+	} else if (bcl_step_mode()) {
+		step_level = gbcl->step_level;
 	}
 
 	for_each_possible_cpu(cpu) {
 		if (!(bcl_frequency_mask & BIT(cpu)))
 			continue;
+		if (step_level) {
+			cpufreq_req.freq.max_freq = bcl_step_freq(cpu,
+				step_level, &at_floor);
+			exhausted &= at_floor;
+			trace_bcl_sw_step_freq(cpu, step_level,
+				cpufreq_req.freq.max_freq);
+		}
 		pr_debug("Requesting Max freq:%u for CPU%d\n",
 			cpufreq_req.freq.max_freq, cpu);
 		trace_bcl_sw_mitigation("Frequency Mitigate CPU", cpu);
@@ -290,6 +366,7 @@ static void update_cpu_freq(void)
 			pr_err("Error updating freq for CPU%d. ret:%d\n",
 				cpu, ret);
 	}
+	gbcl->step_exhausted = step_level && exhausted;
 	mutex_unlock(&bcl_cpufreq_mutex);
 	trace_bcl_sw_mitigation_event("End Frequency Mitigation");
 }
@@ -476,12 +553,88 @@ static void bcl_iavail_work(struct work_struct *work)
 	}
 }
 
+/*
+ * Graduated mitigation. While Ibat or Vbat is beyond its trip threshold,
+ * step the max frequency down one OPP per evaluation, down to the full
+ * mitigation frequency, and only then fall back to hotplug. Once both are
+ * back past their clear thresholds for step_recover_polls evaluations in a
+ * row, step back up one OPP. The caps go through the same devmgr clients as
+ * the full caps, so msm_thermal keeps aggregating every request per CPU.
+ */
+static void bcl_step_mitigate(struct work_struct *work)
+{
+	int ibat = 0, vbat = 0, ret = 0, prev_level = gbcl->step_level;
+	bool clear, prev_hotplug;
+
+	if (gbcl->bcl_mode != BCL_DEVICE_ENABLED)
+		return;
+
+	ret = msm_bcl_read(BCL_PARAM_CURRENT, &ibat);
+	if (!ret)
+		ret = msm_bcl_read(BCL_PARAM_VOLTAGE, &vbat);
+	if (ret) {
+		pr_err("Error reading Ibat/Vbat. err:%d\n", ret);
+		goto reschedule;
+	}
+
+	prev_hotplug = gbcl->step_exhausted && gbcl->step_beyond;
+	gbcl->step_beyond = ibat >= gbcl->ibat_high_thresh.trip_value
+		|| vbat <= gbcl->vbat_low_thresh.trip_value;
+	clear = ibat < gbcl->ibat_low_thresh.trip_value
+		&& vbat >= gbcl->vbat_high_thresh.trip_value;
+
+	if (gbcl->step_beyond) {
+		gbcl->step_clear_cnt = 0;
+		if (!gbcl->step_exhausted)
+			gbcl->step_level++;
+	} else if (clear && gbcl->step_level) {
+		if (++gbcl->step_clear_cnt >= gbcl->step_recover_polls) {
+			gbcl->step_level--;
+			gbcl->step_clear_cnt = 0;
+		}
+	} else {
+		gbcl->step_clear_cnt = 0;
+	}
+
+	if (gbcl->step_level != prev_level)
+		update_cpu_freq();
+	trace_bcl_sw_step_eval(ibat, vbat, gbcl->step_level,
+		gbcl->step_clear_cnt, gbcl->step_exhausted);
+
+	if (bcl_hotplug_enabled && prev_hotplug !=
+		(gbcl->step_exhausted && gbcl->step_beyond))
+		queue_work(gbcl->bcl_hotplug_wq, &bcl_hotplug_work);
+
+reschedule:
+	if (gbcl->step_level || bcl_vph_state == BCL_LOW_THRESHOLD
+		|| bcl_ibat_state == BCL_HIGH_THRESHOLD)
+		queue_delayed_work(gbcl->bcl_hotplug_wq, &gbcl->step_work,
+			msecs_to_jiffies(gbcl->step_poll_ms));
+}
+
+static void bcl_step_reset(void)
+{
+	cancel_delayed_work_sync(&gbcl->step_work);
+	gbcl->step_level = 0;
+	gbcl->step_clear_cnt = 0;
+	gbcl->step_exhausted = false;
+	gbcl->step_beyond = false;
+}
+
+static void bcl_update_freq_mitigation(void)
+{
+	if (!bcl_step_mode())
+		update_cpu_freq();
+	else if (gbcl->bcl_mode == BCL_DEVICE_ENABLED)
+		mod_delayed_work(gbcl->bcl_hotplug_wq, &gbcl->step_work, 0);
+}
+
 static void bcl_ibat_notify(enum bcl_threshold_state thresh_type)
 {
 	bcl_ibat_state = thresh_type;
 	if (bcl_hotplug_enabled)
 		queue_work(gbcl->bcl_hotplug_wq, &bcl_hotplug_work);
-	update_cpu_freq();
+	bcl_update_freq_mitigation();
 }
 
 static void bcl_vph_notify(enum bcl_threshold_state thresh_type)
@@ -489,7 +642,7 @@ static void bcl_vph_notify(enum bcl_threshold_state thresh_type)
 	bcl_vph_state = thresh_type;
 	if (bcl_hotplug_enabled)
 		queue_work(gbcl->bcl_hotplug_wq, &bcl_hotplug_work);
-	update_cpu_freq();
+	bcl_update_freq_mitigation();
 }
 
 int bcl_voltage_notify(bool is_high_thresh)
@@ -737,9 +890,12 @@ static void bcl_periph_mode_set(enum bcl_device_mode mode)
 		gbcl->btm_mode = BCL_MONITOR_DISABLED;
 		bcl_soc_state = BCL_THRESHOLD_DISABLED;
 		bcl_charger_state = BCL_CHARGER_DISABLED;
+		bcl_step_reset();
 		bcl_vph_notify(BCL_HIGH_THRESHOLD);
 		bcl_ibat_notify(BCL_LOW_THRESHOLD);
 		bcl_handle_hotplug(NULL);
+		if (bcl_step_mode())
+			update_cpu_freq();
 	}
 }
 
@@ -905,6 +1061,8 @@ show_bcl(hotplug_mask, bcl_hotplug_mask, "%d\n")
 show_bcl(hotplug_soc_mask, bcl_soc_hotplug_mask, "%d\n")
 show_bcl(hotplug_status, bcl_hotplug_request, "%d\n")
 show_bcl(soc_low_thresh, soc_low_threshold, "%d\n")
+show_bcl(step_mode, gbcl->bcl_step_enabled, "%d\n")
+show_bcl(step_level, gbcl->step_level, "%d\n")
 
 static ssize_t
 mode_show(struct device *dev, struct device_attribute *attr, char *buf)
@@ -1219,6 +1377,23 @@ static ssize_t vph_high_store(struct device *dev,
 	return count;
 }
 
+static ssize_t step_mode_store(struct device *dev,
+				struct device_attribute *attr,
+				const char *buf, size_t count)
+{
+	int ret = 0, val = 0;
+
+	ret = convert_to_int(buf, &val);
+	if (ret)
+		return ret;
+
+	gbcl->bcl_step_enabled = !!val;
+	pr_info("bcl step mitigation %s\n",
+		gbcl->bcl_step_enabled ? "enabled" : "disabled");
+
+	return count;
+}
+
 static ssize_t hotplug_mask_store(struct device *dev,
 					struct device_attribute *attr,
 					const char *buf, size_t count)
@@ -1320,6 +1495,8 @@ static struct device_attribute btm_dev_attr[] = {
 	__ATTR(hotplug_soc_mask, 0644, hotplug_soc_mask_show,
 		hotplug_soc_mask_store),
 	__ATTR(soc_low_thresh, 0644, soc_low_thresh_show, soc_low_thresh_store),
+	__ATTR(step_mode, 0644, step_mode_show, step_mode_store),
+	__ATTR(step_level, 0444, step_level_show, NULL),
 };
 
 static int create_bcl_sysfs(struct bcl_context *bcl)
@@ -1562,6 +1739,15 @@ static int probe_bcl_periph_prop(struct bcl_context *bcl)
 	get_vdd_rstr_freq(bcl, ibat_node);
 	bcl->bcl_p_freq_max = max(bcl->bcl_p_freq_max, bcl->thermal_freq_limit);
 
+	bcl->bcl_step_enabled = of_property_read_bool(ibat_node,
+		"qcom,step-mitigation");
+	bcl->step_poll_ms = BCL_STEP_POLL_MS;
+	of_property_read_u32(ibat_node, "qcom,step-poll-ms",
+		&bcl->step_poll_ms);
+	bcl->step_recover_polls = BCL_STEP_RECOVER_POLLS;
+	of_property_read_u32(ibat_node, "qcom,step-recover-polls",
+		&bcl->step_recover_polls);
+
 	bcl->btm_mode = BCL_MONITOR_DISABLED;
 	bcl->bcl_monitor_type = BCL_IBAT_PERIPH_MONITOR_TYPE;
 	snprintf(bcl->bcl_type, BCL_NAME_LENGTH, "%s",
@@ -1817,6 +2003,7 @@ static int bcl_probe(struct platform_device *pdev)
 	platform_set_drvdata(pdev, bcl);
 	INIT_DEFERRABLE_WORK(&bcl->bcl_iavail_work, bcl_iavail_work);
 	INIT_WORK(&bcl_hotplug_work, bcl_handle_hotplug);
+	INIT_DELAYED_WORK(&bcl->step_work, bcl_step_mitigate);
 	if (bcl_mode == BCL_DEVICE_ENABLED)
 		bcl_mode_set(bcl_mode);
 
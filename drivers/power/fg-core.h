@@ -21,6 +21,7 @@
 #include <linux/err.h>
 #include <linux/interrupt.h>
 #include <linux/kernel.h>
+#include <linux/ktime.h>
 #include <linux/module.h>
 #include <linux/mutex.h>
 #include <linux/spmi.h>
@@ -69,6 +70,7 @@
 
 #define FG_SRAM_ADDRESS_MAX		255
 #define FG_SRAM_LEN			504
+#define FG_SRAM_SNAPSHOT_LEN		64
 #define PROFILE_LEN			224
 #define PROFILE_COMP_LEN		148
 #define BUCKET_COUNT			8
@@ -301,6 +303,21 @@ struct fg_cap_learning {
 	struct mutex	lock;
 };
 
+/*
+ * Copy of the SRAM words written by the FG algorithm, refreshed with a
+ * single burst read at most once every period_ms. The algorithm updates
+ * them once per FG cycle (~1.47 seconds).
+ */
+struct fg_sram_snapshot {
+	struct mutex	lock;
+	u16		address;
+	int		len;
+	int		*period_ms;
+	ktime_t		last_update;
+	bool		valid;
+	u8		data[FG_SRAM_SNAPSHOT_LEN];
+};
+
 struct fg_irq_info {
 	const char		*name;
 	const irq_handler_t	handler;
@@ -375,6 +392,7 @@ struct fg_chip {
 	struct fg_cyc_ctr_data	cyc_ctr;
 	struct notifier_block	nb;
 	struct fg_cap_learning  cl;
+	struct fg_sram_snapshot	sram_snap;
 	struct mutex		bus_lock;
 	struct mutex		sram_rw_lock;
 	struct mutex		batt_avg_lock;
@@ -456,6 +474,9 @@ extern int fg_sram_read(struct fg_chip *chip, u16 address, u8 offset,
 			u8 *val, int len, int flags);
 extern int fg_sram_masked_write(struct fg_chip *chip, u16 address, u8 offset,
 			u8 mask, u8 val, int flags);
+extern int fg_sram_cached_read(struct fg_chip *chip, u16 address, u8 offset,
+			u8 *val, int len);
+extern void fg_sram_snapshot_invalidate(struct fg_chip *chip);
 extern int fg_interleaved_mem_read(struct fg_chip *chip, u16 address,
 			u8 offset, u8 *val, int len);
 extern int fg_interleaved_mem_write(struct fg_chip *chip, u16 address,
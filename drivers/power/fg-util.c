@@ -226,6 +226,23 @@ static inline bool fg_sram_address_valid(u16 address, int len)
 	return true;
 }
 
+void fg_sram_snapshot_invalidate(struct fg_chip *chip)
+{
+	mutex_lock(&chip->sram_snap.lock);
+	chip->sram_snap.valid = false;
+	mutex_unlock(&chip->sram_snap.lock);
+}
+
+static bool fg_sram_snapshot_covers(struct fg_chip *chip, u16 address,
+			u8 offset, int len)
+{
+	struct fg_sram_snapshot *snap = &chip->sram_snap;
+	int start = (address - snap->address) * 4 + offset;
+
+	return snap->len && address >= snap->address &&
+		start + len <= snap->len;
+}
+
 #define SOC_UPDATE_WAIT_MS	1500
 int fg_sram_write(struct fg_chip *chip, u16 address, u8 offset,
 			u8 *val, int len, int flags)
@@ -243,6 +260,12 @@ int fg_sram_write(struct fg_chip *chip, u16 address, u8 offset,
 	if (!fg_sram_address_valid(address, len))
 		return -EFAULT;
 
+	if (chip->sram_snap.len && address < chip->sram_snap.address +
+			chip->sram_snap.len / 4 &&
+			address + DIV_ROUND_UP(offset + len, 4) >
+			chip->sram_snap.address)
+		fg_sram_snapshot_invalidate(chip);
+
 	if (!(flags & FG_IMA_NO_WLOCK))
 		vote(chip->awake_votable, SRAM_WRITE, true, 0);
 	mutex_lock(&chip->sram_rw_lock);
@@ -326,6 +349,43 @@ int fg_sram_read(struct fg_chip *chip, u16 address, u8 offset,
 	return rc;
 }
 
+/*
+ * Read from the SRAM snapshot when it covers the request, refreshing the
+ * whole snapshot in one burst if it is older than its period. Falls back
+ * to a direct read otherwise.
+ */
+int fg_sram_cached_read(struct fg_chip *chip, u16 address, u8 offset,
+			u8 *val, int len)
+{
+	struct fg_sram_snapshot *snap = &chip->sram_snap;
+	int rc = 0;
+
+	if (!snap->period_ms || *snap->period_ms <= 0 ||
+		!fg_sram_snapshot_covers(chip, address, offset, len))
+		return fg_sram_read(chip, address, offset, val, len,
+				FG_IMA_DEFAULT);
+
+	mutex_lock(&snap->lock);
+	if (!snap->valid || ktime_to_ms(ktime_sub(ktime_get(),
+			snap->last_update)) >= *snap->period_ms) {
+		rc = fg_sram_read(chip, snap->address, 0, snap->data,
+				snap->len, FG_IMA_DEFAULT);
+		if (rc < 0) {
+			snap->valid = false;
+			goto out;
+		}
+		snap->last_update = ktime_get();
+		snap->valid = true;
+		fg_dbg(chip, FG_SRAM_READ, "refreshed snapshot %d bytes at %d\n",
+			snap->len, snap->address);
+	}
+
+	memcpy(val, snap->data + (address - snap->address) * 4 + offset, len);
+out:
+	mutex_unlock(&snap->lock);
+	return rc;
+}
+
 int fg_sram_masked_write(struct fg_chip *chip, u16 address, u8 offset,
 			u8 mask, u8 val, int flags)
 {
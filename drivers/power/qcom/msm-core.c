@@ -13,6 +13,7 @@
 
 #include <linux/cpu.h>
 #include <linux/cpufreq.h>
+#include <linux/delay.h>
 #include <linux/err.h>
 #include <linux/fs.h>
 #include <linux/init.h>
@@ -28,6 +29,7 @@
 #include <linux/pm_opp.h>
 #include <linux/platform_device.h>
 #include <linux/pm_opp.h>
+#include <linux/power_supply.h>
 #include <linux/slab.h>
 #include <linux/suspend.h>
 #include <linux/thermal.h>
@@ -944,6 +946,330 @@ static int msm_core_params_init(struct platform_device *pdev)
 	return 0;
 }
 
+/*
+ * Power table calibration
+ *
+ * The voltage based power tables computed at probe time do not account
+ * for the leakage of a particular part or for the battery it runs from.
+ * In calibration mode each frequency of a cluster is pinned in turn and
+ * the battery current reported by the fuel gauge is sampled with the
+ * target CPU idle and then running a busy loop. The difference, scaled
+ * by the battery voltage, replaces the power value for that frequency.
+ * The resulting table is exported through sysfs so that userspace can
+ * persist it and restore it on the next boot.
+ */
+#define DEFAULT_CALIB_PSY_NAME "bms"
+#define CALIB_SETTLE_MS 100
+
+static const char *calib_psy_name = DEFAULT_CALIB_PSY_NAME;
+static unsigned int calib_pinned_freq[NR_CPUS];
+static DEFINE_MUTEX(calib_mutex);
+
+static int calib_sample_ms = 2000;
+module_param_named(calibration_sample_ms, calib_sample_ms, int,
+		S_IRUGO | S_IWUSR | S_IWGRP);
+
+static int calib_nr_samples = 10;
+module_param_named(calibration_samples, calib_nr_samples, int,
+		S_IRUGO | S_IWUSR | S_IWGRP);
+
+static int calib_policy_handler(struct notifier_block *nb,
+		unsigned long val, void *data)
+{
+	struct cpufreq_policy *policy = data;
+	unsigned int freq = calib_pinned_freq[policy->cpu];
+
+	if (val == CPUFREQ_ADJUST && freq)
+		cpufreq_verify_within_limits(policy, freq, freq);
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block calib_policy_nb = {
+	.notifier_call = calib_policy_handler
+};
+
+static int calib_pin_freq(struct cpufreq_policy *policy, unsigned int freq)
+{
+	int cpu;
+
+	for_each_cpu(cpu, policy->related_cpus)
+		calib_pinned_freq[cpu] = freq;
+
+	return cpufreq_update_policy(policy->cpu);
+}
+
+static int calib_busy_loop(void *data)
+{
+	while (!kthread_should_stop()) {
+		cpu_relax();
+		cond_resched();
+	}
+	return 0;
+}
+
+/*
+ * Return the average battery power draw, in uW, over one sampling period.
+ */
+static int calib_sample_power(struct power_supply *psy, s64 *power)
+{
+	union power_supply_propval cur, volt;
+	int samples = max(calib_nr_samples, 1);
+	s64 total = 0;
+	int i, ret;
+
+	for (i = 0; i < samples; i++) {
+		msleep(max(calib_sample_ms, 1) / samples);
+
+		ret = power_supply_get_property(psy,
+				POWER_SUPPLY_PROP_CURRENT_NOW, &cur);
+		if (ret)
+			return ret;
+
+		ret = power_supply_get_property(psy,
+				POWER_SUPPLY_PROP_VOLTAGE_NOW, &volt);
+		if (ret)
+			return ret;
+
+		/* uA * uV, sign depends on the fuel gauge convention */
+		total += div_s64((s64)abs(cur.intval) * volt.intval, 1000000);
+	}
+
+	*power = div_s64(total, samples);
+	return 0;
+}
+
+static int calib_measure_cpu(struct power_supply *psy, int cpu,
+		s64 *power)
+{
+	struct task_struct *busy;
+	s64 idle_power, busy_power;
+	int ret;
+
+	msleep(CALIB_SETTLE_MS);
+	ret = calib_sample_power(psy, &idle_power);
+	if (ret)
+		return ret;
+
+	busy = kthread_create(calib_busy_loop, NULL, "msm-core:calib/%d", cpu);
+	if (IS_ERR(busy))
+		return PTR_ERR(busy);
+	kthread_bind(busy, cpu);
+	wake_up_process(busy);
+
+	msleep(CALIB_SETTLE_MS);
+	ret = calib_sample_power(psy, &busy_power);
+	kthread_stop(busy);
+	if (ret)
+		return ret;
+
+	*power = max_t(s64, busy_power - idle_power, 0);
+	return 0;
+}
+
+static void calib_update_power(struct cpufreq_policy *policy,
+		const uint32_t *power)
+{
+	struct cpu_static_info *sp;
+	int cpu, i, j;
+
+	mutex_lock(&policy_update_mutex);
+	spin_lock(&update_lock);
+	for_each_cpu(cpu, policy->related_cpus) {
+		sp = activity[cpu].sp;
+		if (!sp || !sp->power)
+			continue;
+
+		/*
+		 * The calibration is done at the current temperature only,
+		 * use it for all the temperature points.
+		 */
+		for (i = 0; i < TEMP_DATA_POINTS; i++) {
+			for (j = 0; j < sp->num_of_freqs; j++)
+				if (power[j])
+					sp->power[i][j] = power[j];
+		}
+		cpu_stats[cpu].ptable = per_cpu(ptable, cpu);
+		repopulate_stats(cpu);
+	}
+	spin_unlock(&update_lock);
+	mutex_unlock(&policy_update_mutex);
+
+	for_each_cpu(cpu, policy->related_cpus)
+		blocking_notifier_call_chain(
+			&msm_core_stats_notifier_list, cpu, NULL);
+
+	activate_power_table = true;
+}
+
+static int calibrate_cluster(int cpu)
+{
+	struct cpufreq_policy *policy;
+	struct cpu_static_info *sp;
+	struct power_supply *psy;
+	uint32_t *power;
+	s64 sample;
+	int i, ret = 0;
+
+	if (!cpu_online(cpu))
+		return -EINVAL;
+
+	psy = power_supply_get_by_name(calib_psy_name);
+	if (!psy) {
+		pr_err("%s: no %s power supply\n", __func__, calib_psy_name);
+		return -ENODEV;
+	}
+
+	policy = cpufreq_cpu_get(cpu);
+	if (!policy)
+		return -ENODEV;
+
+	sp = activity[cpu].sp;
+	if (!sp || !sp->table || !sp->power) {
+		ret = -ENODEV;
+		goto put_policy;
+	}
+
+	power = kcalloc(sp->num_of_freqs, sizeof(*power), GFP_KERNEL);
+	if (!power) {
+		ret = -ENOMEM;
+		goto put_policy;
+	}
+
+	for (i = 0; i < sp->num_of_freqs; i++) {
+		if (sp->table[i].frequency == CPUFREQ_ENTRY_INVALID)
+			continue;
+
+		ret = calib_pin_freq(policy, sp->table[i].frequency);
+		if (ret)
+			break;
+
+		ret = calib_measure_cpu(psy, cpu, &sample);
+		if (ret)
+			break;
+
+		power[i] = min_t(s64, sample, U32_MAX);
+		pr_info("calibration: cpu%d %u KHz: %u uW\n", cpu,
+				sp->table[i].frequency, power[i]);
+	}
+
+	calib_pin_freq(policy, 0);
+	if (!ret)
+		calib_update_power(policy, power);
+
+	kfree(power);
+put_policy:
+	cpufreq_cpu_put(policy);
+	return ret;
+}
+
+static ssize_t store_calibrate(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	unsigned int cpu;
+	int ret;
+
+	ret = kstrtouint(buf, 0, &cpu);
+	if (ret)
+		return ret;
+
+	if (cpu >= num_possible_cpus())
+		return -EINVAL;
+
+	mutex_lock(&calib_mutex);
+	ret = calibrate_cluster(cpu);
+	mutex_unlock(&calib_mutex);
+
+	return ret ? ret : count;
+}
+
+static ssize_t show_power_table(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct cpu_pstate_pwr *pt;
+	ssize_t len = 0;
+	int cpu, i;
+
+	spin_lock(&update_lock);
+	for_each_possible_cpu(cpu) {
+		pt = per_cpu(ptable, cpu);
+		if (!pt)
+			continue;
+
+		for (i = 0; i < cpu_stats[cpu].len; i++)
+			len += scnprintf(buf + len, PAGE_SIZE - len,
+					"%d %u %u\n", cpu, pt[i].freq,
+					pt[i].power);
+	}
+	spin_unlock(&update_lock);
+
+	return len;
+}
+
+/*
+ * Restore a persisted "<cpu> <freq> <power>" entry, applied to every CPU
+ * of the cluster.
+ */
+static ssize_t store_power_table(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct cpufreq_policy *policy;
+	struct cpu_static_info *sp;
+	unsigned int cpu, freq;
+	uint32_t *power;
+	int i, ret = -EINVAL;
+	u32 val;
+
+	if (sscanf(buf, "%u %u %u", &cpu, &freq, &val) != 3)
+		return -EINVAL;
+
+	if (cpu >= num_possible_cpus() || !val)
+		return -EINVAL;
+
+	policy = cpufreq_cpu_get(cpu);
+	if (!policy)
+		return -ENODEV;
+
+	sp = activity[cpu].sp;
+	if (!sp || !sp->table || !sp->power)
+		goto put_policy;
+
+	power = kcalloc(sp->num_of_freqs, sizeof(*power), GFP_KERNEL);
+	if (!power) {
+		ret = -ENOMEM;
+		goto put_policy;
+	}
+
+	for (i = 0; i < sp->num_of_freqs; i++) {
+		if (sp->table[i].frequency != freq)
+			continue;
+
+		power[i] = val;
+		calib_update_power(policy, power);
+		ret = count;
+		break;
+	}
+
+	kfree(power);
+put_policy:
+	cpufreq_cpu_put(policy);
+	return ret;
+}
+
+static DEVICE_ATTR(calibrate, S_IWUSR, NULL, store_calibrate);
+static DEVICE_ATTR(power_table, S_IRUGO | S_IWUSR, show_power_table,
+		store_power_table);
+
+static struct attribute *msm_core_calib_attrs[] = {
+	&dev_attr_calibrate.attr,
+	&dev_attr_power_table.attr,
+	NULL,
+};
+
+static struct attribute_group msm_core_calib_group = {
+	.attrs = msm_core_calib_attrs,
+};
+
 static const struct file_operations msm_core_ops = {
 	.owner = THIS_MODULE,
 	.unlocked_ioctl = msm_core_ioctl,
@@ -1054,6 +1380,11 @@ static int msm_core_dev_probe(struct platform_device *pdev)
 	key = "qcom,throttling-temp";
 	ret = of_property_read_u32(node, key, &max_throttling_temp);
 
+	key = "qcom,calibration-psy-name";
+	ret = of_property_read_string(node, key, &calib_psy_name);
+	if (ret)
+		calib_psy_name = DEFAULT_CALIB_PSY_NAME;
+
 	ret = uio_init(pdev);
 	if (ret)
 		return ret;
@@ -1082,6 +1413,11 @@ static int msm_core_dev_probe(struct platform_device *pdev)
 
 	schedule_delayed_work(&sampling_work, msecs_to_jiffies(0));
 	cpufreq_register_notifier(&cpu_policy, CPUFREQ_POLICY_NOTIFIER);
+	cpufreq_register_notifier(&calib_policy_nb, CPUFREQ_POLICY_NOTIFIER);
+	ret = sysfs_create_group(&pdev->dev.kobj, &msm_core_calib_group);
+	if (ret)
+		pr_err("%s: Error creating calibration attrs %d\n",
+			__func__, ret);
 	pm_notifier(system_suspend_handler, 0);
 	return 0;
 failed:
@@ -1097,6 +1433,8 @@ static int msm_core_remove(struct platform_device *pdev)
 	struct uio_info *info = dev_get_drvdata(&pdev->dev);
 
 	uio_unregister_device(info);
+	sysfs_remove_group(&pdev->dev.kobj, &msm_core_calib_group);
+	cpufreq_unregister_notifier(&calib_policy_nb, CPUFREQ_POLICY_NOTIFIER);
 
 	for_each_possible_cpu(cpu) {
 		if (activity[cpu].sensor_id < 0)
@@ -396,6 +396,11 @@ module_param_named(
 	sram_dump_period_ms, fg_sram_dump_period_ms, int, S_IRUSR | S_IWUSR
 );
 
+static int fg_sram_snapshot_ms = 1000;
+module_param_named(
+	sram_snapshot_ms, fg_sram_snapshot_ms, int, S_IRUSR | S_IWUSR
+);
+
 static int fg_restart;
 static bool fg_sram_dump;
 
@@ -529,8 +534,8 @@ static int fg_get_sram_prop(struct fg_chip *chip, enum fg_sram_param_id id,
 	if (chip->battery_missing)
 		return -ENODATA;
 
-	rc = fg_sram_read(chip, chip->sp[id].addr_word, chip->sp[id].addr_byte,
-		buf, chip->sp[id].len, FG_IMA_DEFAULT);
+	rc = fg_sram_cached_read(chip, chip->sp[id].addr_word,
+		chip->sp[id].addr_byte, buf, chip->sp[id].len);
 	if (rc < 0) {
 		pr_err("Error reading address 0x%04x[%d] rc=%d\n",
 			chip->sp[id].addr_word, chip->sp[id].addr_byte, rc);
@@ -2497,6 +2502,7 @@ static int __fg_restart(struct fg_chip *chip)
 
 	chip->last_soc = msoc;
 	chip->fg_restarting = true;
+	fg_sram_snapshot_invalidate(chip);
 	reinit_completion(&chip->soc_ready);
 	rc = fg_masked_write(chip, BATT_SOC_RESTART(chip), RESTART_GO_BIT,
 			RESTART_GO_BIT);
@@ -3588,6 +3594,7 @@ static irqreturn_t fg_batt_missing_irq_handler(int irq, void *data)
 
 	fg_dbg(chip, FG_IRQ, "irq %d triggered sts:%d\n", irq, status);
 	chip->battery_missing = (status & BT_MISS_BIT);
+	fg_sram_snapshot_invalidate(chip);
 
 	if (chip->battery_missing) {
 		chip->profile_available = false;
@@ -3677,6 +3684,7 @@ static irqreturn_t fg_delta_bsoc_irq_handler(int irq, void *data)
 	int rc;
 
 	fg_dbg(chip, FG_IRQ, "irq %d triggered\n", irq);
+	fg_sram_snapshot_invalidate(chip);
 	rc = fg_charge_full_update(chip);
 	if (rc < 0)
 		pr_err("Error in charge_full_update, rc=%d\n", rc);
@@ -3690,6 +3698,7 @@ static irqreturn_t fg_delta_msoc_irq_handler(int irq, void *data)
 	int rc;
 
 	fg_dbg(chip, FG_IRQ, "irq %d triggered\n", irq);
+	fg_sram_snapshot_invalidate(chip);
 	if (chip->cyc_ctr.en)
 		schedule_work(&chip->cycle_count_work);
 
@@ -4473,6 +4482,10 @@ static int fg_gen3_probe(struct spmi_device *spmi)
 	mutex_init(&chip->cl.lock);
 	mutex_init(&chip->batt_avg_lock);
 	mutex_init(&chip->charge_full_lock);
+	mutex_init(&chip->sram_snap.lock);
+	chip->sram_snap.address = BATT_SOC_WORD;
+	chip->sram_snap.len = (RSLOW_WORD - BATT_SOC_WORD + 1) * 4;
+	chip->sram_snap.period_ms = &fg_sram_snapshot_ms;
 	init_completion(&chip->soc_update);
 	init_completion(&chip->soc_ready);
 	INIT_DELAYED_WORK(&chip->profile_load_work, profile_load_work);
@@ -349,6 +349,10 @@ int ufs_qcom_ice_cfg_start(struct ufs_qcom_host *qcom_host,
 		}
 	}
 
+	/* per-file data unit numbers replace the LBA */
+	if (ice_set.crypto_data.dun_valid)
+		lba = ice_set.crypto_data.dun;
+
 	cmd_op = cmd->cmnd[0];
 
 #define UFS_QCOM_DIR_WRITE	true
@@ -99,6 +99,8 @@ enum ufs_test_testcases {
 	UFS_TEST_PARALLEL_READ_AND_WRITE,
 	UFS_TEST_LUN_DEPTH,
 
+	UFS_TEST_BENCHMARK,
+
 	NUM_TESTS,
 };
 
@@ -254,6 +256,8 @@ static char *ufs_test_get_test_case_str(int testcase)
 		return "UFS parallel read and write test";
 	case UFS_TEST_LUN_DEPTH:
 		return "UFS LUN depth test";
+	case UFS_TEST_BENCHMARK:
+		return "UFS latency benchmark";
 	}
 	return "Unknown test";
 }
@@ -441,6 +445,16 @@ static int ufs_test_show(struct seq_file *file, int test_case)
 		 "The test will test for each iteration once only reads and "
 		 "once only writes.\n";
 		break;
+	case UFS_TEST_BENCHMARK:
+		test_description = "\nufs_test_benchmark\n"
+		 "=========\n"
+		 "Description:\n"
+		 "This test issues the request mix configured in the bench "
+		 "debugfs directory (read percentage, random or sequential "
+		 "offsets, queue depth, sync writes, request size) and "
+		 "accumulates p50/p99/p999 latencies and throughput in "
+		 "bench/results.\n";
+		break;
 	default:
 		test_description = "Unknown test";
 	}
@@ -1357,6 +1371,9 @@ static ssize_t ufs_test_write(struct file *file, const char __user *buf,
 	case UFS_TEST_LUN_DEPTH:
 		utd->test_info.run_test_fn = ufs_test_run_lun_depth_test;
 		break;
+	case UFS_TEST_BENCHMARK:
+		/* run and completion callbacks are set by test-iosched */
+		break;
 	default:
 		pr_err("%s: Unknown test-case: %d", __func__, test_case);
 		WARN_ON(true);
@@ -1368,8 +1385,12 @@ static ssize_t ufs_test_write(struct file *file, const char __user *buf,
 		pr_info("%s: ====================", __func__);
 
 		utd->test_info.test_byte_count = 0;
-		ret = test_iosched_start_test(utd->test_iosched,
-			&utd->test_info);
+		if (test_case == UFS_TEST_BENCHMARK)
+			ret = test_iosched_start_bench(utd->test_iosched,
+				&utd->test_info);
+		else
+			ret = test_iosched_start_test(utd->test_iosched,
+				&utd->test_info);
 		if (ret) {
 			pr_err("%s: Test failed, err=%d.", __func__, ret);
 			return ret;
@@ -1394,6 +1415,7 @@ TEST_OPS(long_sequential_write, LONG_SEQUENTIAL_WRITE);
 TEST_OPS(long_sequential_mixed, LONG_SEQUENTIAL_MIXED);
 TEST_OPS(parallel_read_and_write, PARALLEL_READ_AND_WRITE);
 TEST_OPS(lun_depth, LUN_DEPTH);
+TEST_OPS(benchmark, BENCHMARK);
 
 static void ufs_test_debugfs_cleanup(struct test_iosched *test_iosched)
 {
@@ -1462,6 +1484,9 @@ static int ufs_test_debugfs_init(struct ufs_test_data *utd)
 	if (ret)
 		goto exit_err;
 	add_test(utd, lun_depth, LUN_DEPTH);
+	if (ret)
+		goto exit_err;
+	ret = add_test(utd, benchmark, BENCHMARK);
 	if (ret)
 		goto exit_err;
 
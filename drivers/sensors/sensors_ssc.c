@@ -27,8 +27,14 @@
 #include <linux/delay.h>
 #include <linux/sysfs.h>
 #include <linux/workqueue.h>
+#include <linux/interrupt.h>
+#include <linux/poll.h>
+#include <linux/gpio.h>
+#include <linux/of_gpio.h>
+#include <linux/log2.h>
 
 #include <soc/qcom/subsystem_restart.h>
+#include <soc/qcom/smem.h>
 
 #define IMAGE_LOAD_CMD 1
 #define IMAGE_UNLOAD_CMD 0
@@ -38,6 +44,9 @@
 #ifdef CONFIG_COMPAT
 #define DSPS_IOCTL_READ_SLOW_TIMER32 _IOR(DSPS_IOCTL_MAGIC, 3, compat_uint_t)
 #endif
+#define BATCH_EVENTS_DEFAULT	1024
+#define BATCH_WAKE_MS		200
+#define BATCH_BOUNCE_EVENTS	(PAGE_SIZE / sizeof(struct dsps_batch_event))
 
 static void __iomem *qdsp6ss_qtmr_base;
 static uint32_t qdsp6ss_qtmr_hi_offset;
@@ -92,6 +101,21 @@ struct sns_ssc_control_s {
 };
 static struct sns_ssc_control_s sns_ctl;
 
+/* Shared-memory sensor batching, see msm_dsps.h */
+struct sns_batch_s {
+	struct device *dev;
+	struct dsps_batch_header *hdr;
+	struct dsps_batch_event *events;
+	struct dsps_batch_event *bounce;
+	u32 nr_events;
+	u32 tail;
+	int kick_gpio;
+	int kick_state;
+	struct mutex lock;	/* protects tail, ctl[] and kick_state */
+	wait_queue_head_t wait;
+};
+static struct sns_batch_s *sns_batch;
+
 static ssize_t slpi_boot_store(struct kobject *kobj,
 	struct kobj_attribute *attr,
 	const char *buf, size_t count);
@@ -349,6 +373,146 @@ static u32 sns_read_qtimer(void)
 	return (u32)val;
 }
 
+/* Tell the DSP to look at the shared header again */
+static void sns_batch_kick(struct sns_batch_s *b)
+{
+	if (!gpio_is_valid(b->kick_gpio))
+		return;
+
+	b->kick_state = !b->kick_state;
+	gpio_set_value(b->kick_gpio, b->kick_state);
+}
+
+static bool sns_batch_pending(struct sns_batch_s *b)
+{
+	return ACCESS_ONCE(b->hdr->head) != ACCESS_ONCE(b->tail);
+}
+
+static irqreturn_t sns_batch_irq(int irq, void *priv)
+{
+	struct sns_batch_s *b = priv;
+
+	/* give the sensors HAL time to drain the ring before suspending */
+	pm_wakeup_event(b->dev, BATCH_WAKE_MS);
+	wake_up_interruptible(&b->wait);
+
+	return IRQ_HANDLED;
+}
+
+static int sns_batch_set(struct sns_batch_s *b,
+			 const struct dsps_batch_ctl __user *arg)
+{
+	struct dsps_batch_ctl req;
+	struct dsps_batch_ctl *ctl, *slot = NULL;
+	int i;
+
+	if (copy_from_user(&req, arg, sizeof(req)))
+		return -EFAULT;
+
+	mutex_lock(&b->lock);
+	for (i = 0; i < DSPS_BATCH_MAX_SENSORS; i++) {
+		ctl = &b->hdr->ctl[i];
+		if (ctl->period_us && ctl->handle == req.handle) {
+			slot = ctl;
+			break;
+		}
+		if (!ctl->period_us && !slot)
+			slot = ctl;
+	}
+
+	if (!slot || (!slot->period_us && !req.period_us)) {
+		mutex_unlock(&b->lock);
+		return req.period_us ? -ENOSPC : 0;
+	}
+
+	slot->handle = req.handle;
+	slot->max_latency_ms = req.max_latency_ms;
+	slot->flags = req.flags;
+	slot->period_us = req.period_us;
+	wmb();
+	b->hdr->ctl_seq++;
+	sns_batch_kick(b);
+	mutex_unlock(&b->lock);
+
+	return 0;
+}
+
+static int sns_batch_flush(struct sns_batch_s *b)
+{
+	mutex_lock(&b->lock);
+	b->hdr->flush_seq++;
+	sns_batch_kick(b);
+	mutex_unlock(&b->lock);
+
+	return 0;
+}
+
+static ssize_t sensors_ssc_read(struct file *fp, char __user *buf,
+				size_t count, loff_t *pos)
+{
+	struct sns_batch_s *b = sns_batch;
+	size_t esize = sizeof(struct dsps_batch_event);
+	size_t read = 0;
+	u32 head, idx, n;
+	int ret;
+
+	if (!b)
+		return -ENODEV;
+
+	if (count < esize)
+		return -EINVAL;
+
+	while (!sns_batch_pending(b)) {
+		if (fp->f_flags & O_NONBLOCK)
+			return -EAGAIN;
+		ret = wait_event_interruptible(b->wait, sns_batch_pending(b));
+		if (ret)
+			return ret;
+	}
+
+	mutex_lock(&b->lock);
+	head = ACCESS_ONCE(b->hdr->head);
+	rmb();
+	if (head - b->tail > b->nr_events) {
+		dev_err(b->dev, "bad ring head %u (tail %u)\n", head, b->tail);
+		b->tail = head;
+	}
+
+	while (b->tail != head && read + esize <= count) {
+		idx = b->tail & (b->nr_events - 1);
+		n = min_t(u32, head - b->tail, b->nr_events - idx);
+		n = min_t(u32, n, BATCH_BOUNCE_EVENTS);
+		n = min_t(u32, n, (count - read) / esize);
+
+		memcpy(b->bounce, &b->events[idx], n * esize);
+		if (copy_to_user(buf + read, b->bounce, n * esize)) {
+			read = read ? read : -EFAULT;
+			break;
+		}
+		b->tail += n;
+		read += n * esize;
+	}
+
+	/* hand the consumed entries back to the DSP */
+	mb();
+	b->hdr->tail = b->tail;
+	mutex_unlock(&b->lock);
+
+	return read;
+}
+
+static unsigned int sensors_ssc_poll(struct file *fp, poll_table *wait)
+{
+	struct sns_batch_s *b = sns_batch;
+
+	if (!b)
+		return POLLERR;
+
+	poll_wait(fp, &b->wait, wait);
+
+	return sns_batch_pending(b) ? POLLIN | POLLRDNORM : 0;
+}
+
 static int sensors_ssc_open(struct inode *ip, struct file *fp)
 {
 	return 0;
@@ -374,6 +538,19 @@ static long sensors_ssc_ioctl(struct file *file,
 		ret = put_user(val, (u32 __user *) arg);
 		break;
 
+	case DSPS_IOCTL_SET_BATCH:
+		if (!sns_batch)
+			return -ENODEV;
+		ret = sns_batch_set(sns_batch,
+				    (struct dsps_batch_ctl __user *) arg);
+		break;
+
+	case DSPS_IOCTL_FLUSH_BATCH:
+		if (!sns_batch)
+			return -ENODEV;
+		ret = sns_batch_flush(sns_batch);
+		break;
+
 	default:
 		ret = -EINVAL;
 		break;
@@ -386,12 +563,98 @@ const struct file_operations sensors_ssc_fops = {
 	.owner = THIS_MODULE,
 	.open = sensors_ssc_open,
 	.release = sensors_ssc_release,
+	.read = sensors_ssc_read,
+	.poll = sensors_ssc_poll,
 #ifdef CONFIG_COMPAT
 	.compat_ioctl = sensors_ssc_ioctl,
 #endif
 	.unlocked_ioctl = sensors_ssc_ioctl
 };
 
+/*
+ * Batching is optional: it needs an SMEM item agreed with the DSP image
+ * ("qcom,batch-smem-id") and, to get one interrupt per batch, the inbound
+ * SMP2P interrupt named "batch". "qcom,batch-kick-gpio" is the outbound
+ * SMP2P bit toggled whenever the control block changes.
+ */
+static int sns_batch_init(struct platform_device *pdev)
+{
+	struct device_node *node = pdev->dev.of_node;
+	struct sns_batch_s *b;
+	u32 id, host = SMEM_Q6, nr = BATCH_EVENTS_DEFAULT;
+	int irq, ret;
+
+	if (of_property_read_u32(node, "qcom,batch-smem-id", &id))
+		return 0;
+
+	of_property_read_u32(node, "qcom,batch-smem-host", &host);
+	of_property_read_u32(node, "qcom,batch-events", &nr);
+	if (!is_power_of_2(nr)) {
+		dev_err(&pdev->dev, "%s: batch-events must be a power of 2\n",
+			__func__);
+		return -EINVAL;
+	}
+
+	b = devm_kzalloc(&pdev->dev, sizeof(*b), GFP_KERNEL);
+	if (!b)
+		return -ENOMEM;
+
+	b->bounce = devm_kzalloc(&pdev->dev, PAGE_SIZE, GFP_KERNEL);
+	if (!b->bounce)
+		return -ENOMEM;
+
+	b->hdr = smem_alloc(id, sizeof(*b->hdr) +
+			    nr * sizeof(struct dsps_batch_event), host, 0);
+	if (!b->hdr) {
+		dev_err(&pdev->dev, "%s: smem item %u alloc failed\n",
+			__func__, id);
+		return -ENOMEM;
+	}
+
+	b->dev = &pdev->dev;
+	b->events = (struct dsps_batch_event *)(b->hdr + 1);
+	b->nr_events = nr;
+	mutex_init(&b->lock);
+	init_waitqueue_head(&b->wait);
+
+	memset(b->hdr, 0, sizeof(*b->hdr));
+	b->hdr->nr_events = nr;
+	wmb();
+	b->hdr->version = DSPS_BATCH_VERSION;
+
+	b->kick_gpio = of_get_named_gpio(node, "qcom,batch-kick-gpio", 0);
+	if (gpio_is_valid(b->kick_gpio)) {
+		ret = devm_gpio_request_one(&pdev->dev, b->kick_gpio,
+					    GPIOF_OUT_INIT_LOW, "ssc-batch");
+		if (ret) {
+			dev_err(&pdev->dev, "%s: kick gpio request failed\n",
+				__func__);
+			return ret;
+		}
+	}
+
+	irq = platform_get_irq_byname(pdev, "batch");
+	if (irq >= 0) {
+		ret = devm_request_irq(&pdev->dev, irq, sns_batch_irq,
+				       IRQF_TRIGGER_RISING |
+				       IRQF_TRIGGER_FALLING,
+				       "ssc-batch", b);
+		if (ret) {
+			dev_err(&pdev->dev, "%s: irq request failed %d\n",
+				__func__, ret);
+			return ret;
+		}
+		device_init_wakeup(&pdev->dev, true);
+		enable_irq_wake(irq);
+	}
+
+	sns_batch = b;
+	dev_info(&pdev->dev, "%s: %u event batch ring in smem item %u\n",
+		 __func__, nr, id);
+
+	return 0;
+}
+
 static int sensors_ssc_probe(struct platform_device *pdev)
 {
 	int ret = slpi_loader_init_sysfs(pdev);
@@ -437,6 +700,11 @@ static int sensors_ssc_probe(struct platform_device *pdev)
 
 	INIT_WORK(&slpi_ldr_work, slpi_load_fw);
 
+	/* batching is an optimization, the device works without it */
+	if (sns_batch_init(pdev))
+		dev_err(&pdev->dev, "%s: sensor batching disabled\n",
+			__func__);
+
 	return 0;
 
 cdev_add_err:
@@ -453,6 +721,7 @@ res_err:
 
 static int sensors_ssc_remove(struct platform_device *pdev)
 {
+	sns_batch = NULL;
 	slpi_loader_remove(pdev);
 	cdev_del(sns_ctl.cdev);
 	kfree(sns_ctl.cdev);
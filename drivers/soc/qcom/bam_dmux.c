@@ -44,26 +44,13 @@
 
 #define LOW_WATERMARK		2
 #define HIGH_WATERMARK		4
-#define DEFAULT_POLLING_MIN_SLEEP (950)
-#define MAX_POLLING_SLEEP (6050)
-#define MIN_POLLING_SLEEP (950)
+#define BAM_DMUX_NAPI_WEIGHT	64
+#define BAM_DMUX_RX_BATCH	16
+#define BAM_DMUX_RX_LAT_BUCKETS	16
 
 static int msm_bam_dmux_debug_enable;
 module_param_named(debug_enable, msm_bam_dmux_debug_enable,
 		   int, S_IRUGO | S_IWUSR | S_IWGRP);
-static int POLLING_MIN_SLEEP = 2950;
-module_param_named(min_sleep, POLLING_MIN_SLEEP,
-		   int, S_IRUGO | S_IWUSR | S_IWGRP);
-static int POLLING_MAX_SLEEP = 3050;
-module_param_named(max_sleep, POLLING_MAX_SLEEP,
-		   int, S_IRUGO | S_IWUSR | S_IWGRP);
-static int POLLING_INACTIVITY = 1;
-module_param_named(inactivity, POLLING_INACTIVITY,
-		   int, S_IRUGO | S_IWUSR | S_IWGRP);
-static int bam_adaptive_timer_enabled;
-module_param_named(adaptive_timer_enabled,
-			bam_adaptive_timer_enabled,
-		   int, S_IRUGO | S_IWUSR | S_IWGRP);
 
 static struct bam_ops_if bam_default_ops = {
 	/* smsm */
@@ -86,6 +73,8 @@ static struct bam_ops_if bam_default_ops = {
 	.sps_transfer_one_ptr = &sps_transfer_one,
 	.sps_get_iovec_ptr = &sps_get_iovec,
 	.sps_get_unused_desc_num_ptr = &sps_get_unused_desc_num,
+	.sps_get_iovecs_ptr = &sps_get_iovecs,
+	.sps_is_pipe_empty_ptr = &sps_is_pipe_empty,
 
 	.dma_to = DMA_TO_DEVICE,
 	.dma_from = DMA_FROM_DEVICE,
@@ -194,6 +183,10 @@ static bool satellite_mode;
 static uint32_t num_buffers;
 static unsigned long long last_rx_pkt_timestamp;
 static struct device *dma_dev;
+/* zeroed padding appended to fragmented tx packets */
+#define BAM_MUX_TX_PAD_SIZE	4
+static void *tx_pad_buf;
+static dma_addr_t tx_pad_dma;
 static bool dynamic_mtu_enabled;
 static uint16_t ul_mtu = DEFAULT_BUFFER_SIZE;
 static uint16_t dl_mtu = DEFAULT_BUFFER_SIZE;
@@ -204,10 +197,19 @@ static struct bam_ch_info bam_ch[BAM_DMUX_NUM_CHANNELS];
 static int bam_mux_initialized;
 
 static int polling_mode;
-static unsigned long rx_timer_interval;
+
+/*
+ * rx is drained by a NAPI poll on a dummy netdev so that packets are handed
+ * to clients from softirq context, a budget at a time.
+ */
+static struct net_device bam_rx_napi_dev;
+static struct napi_struct bam_rx_napi;
+static bool bam_rx_in_poll;
+static unsigned long long bam_rx_irq_ts;
+static u32 bam_rx_lat_hist[BAM_DMUX_RX_LAT_BUCKETS];
 
 static LIST_HEAD(bam_rx_pool);
-static DEFINE_MUTEX(bam_rx_pool_mutexlock);
+static DEFINE_SPINLOCK(bam_rx_pool_spinlock);
 static int bam_rx_pool_len;
 static LIST_HEAD(bam_tx_pool);
 static DEFINE_SPINLOCK(bam_tx_pool_spinlock);
@@ -216,11 +218,9 @@ static DEFINE_MUTEX(bam_pdev_mutexlock);
 static void notify_all(int event, unsigned long data);
 static void bam_mux_write_done(struct work_struct *work);
 static void handle_bam_mux_cmd(struct work_struct *work);
-static void rx_timer_work_func(struct work_struct *work);
 static void queue_rx_work_func(struct work_struct *work);
 static int ssrestart_check(void);
 
-static DECLARE_WORK(rx_timer_work, rx_timer_work_func);
 static DECLARE_WORK(queue_rx_work, queue_rx_work_func);
 
 static struct workqueue_struct *bam_mux_rx_workqueue;
@@ -391,11 +391,12 @@ static void __queue_rx(gfp_t alloc_flags)
 	int ret;
 	int rx_len_cached;
 	uint16_t current_buffer_size;
+	unsigned long flags;
 
-	mutex_lock(&bam_rx_pool_mutexlock);
+	spin_lock_irqsave(&bam_rx_pool_spinlock, flags);
 	rx_len_cached = bam_rx_pool_len;
 	current_buffer_size = buffer_size;
-	mutex_unlock(&bam_rx_pool_mutexlock);
+	spin_unlock_irqrestore(&bam_rx_pool_spinlock, flags);
 
 	while (bam_connection_is_active && rx_len_cached < num_buffers) {
 		if (in_global_reset)
@@ -432,7 +433,7 @@ static void __queue_rx(gfp_t alloc_flags)
 			goto fail_skb;
 		}
 
-		mutex_lock(&bam_rx_pool_mutexlock);
+		spin_lock_irqsave(&bam_rx_pool_spinlock, flags);
 		list_add_tail(&info->list_node, &bam_rx_pool);
 		rx_len_cached = ++bam_rx_pool_len;
 		current_buffer_size = buffer_size;
@@ -441,7 +442,7 @@ static void __queue_rx(gfp_t alloc_flags)
 		if (ret) {
 			list_del(&info->list_node);
 			rx_len_cached = --bam_rx_pool_len;
-			mutex_unlock(&bam_rx_pool_mutexlock);
+			spin_unlock_irqrestore(&bam_rx_pool_spinlock, flags);
 			DMUX_LOG_KERR("%s: sps_transfer_one failed %d\n",
 				__func__, ret);
 
@@ -451,7 +452,7 @@ static void __queue_rx(gfp_t alloc_flags)
 
 			goto fail_skb;
 		}
-		mutex_unlock(&bam_rx_pool_mutexlock);
+		spin_unlock_irqrestore(&bam_rx_pool_spinlock, flags);
 
 	}
 	return;
@@ -497,6 +498,7 @@ static void queue_rx_work_func(struct work_struct *work)
 static void process_dynamic_mtu(bool current_state)
 {
 	static bool old_state;
+	unsigned long flags;
 
 	if (!dynamic_mtu_enabled)
 		return;
@@ -504,7 +506,7 @@ static void process_dynamic_mtu(bool current_state)
 	if (old_state == current_state)
 		return;
 
-	mutex_lock(&bam_rx_pool_mutexlock);
+	spin_lock_irqsave(&bam_rx_pool_spinlock, flags);
 	if (current_state) {
 		buffer_size = dl_mtu;
 		BAM_DMUX_LOG("%s: switching to large mtu %x\n", __func__,
@@ -514,7 +516,7 @@ static void process_dynamic_mtu(bool current_state)
 		BAM_DMUX_LOG("%s: switching to reg mtu %x\n", __func__,
 							DEFAULT_BUFFER_SIZE);
 	}
-	mutex_unlock(&bam_rx_pool_mutexlock);
+	spin_unlock_irqrestore(&bam_rx_pool_spinlock, flags);
 
 	old_state = current_state;
 }
@@ -666,8 +668,6 @@ static void handle_bam_mux_cmd(struct work_struct *work)
 
 	info = container_of(work, struct rx_pkt_info, work);
 	rx_skb = info->skb;
-	dma_unmap_single(dma_dev, info->dma_address, info->len,
-			bam_ops->dma_from);
 	sps_size = info->sps_size;
 	kfree(info);
 
@@ -858,7 +858,8 @@ static void bam_mux_write_done(struct work_struct *work)
 	DBG_INC_WRITE_CNT(skb->len);
 	/* Restore skb for client */
 	skb_pull(skb, sizeof(*hdr));
-	if (hdr->pad_len)
+	/* padding of fragmented packets is not part of the skb */
+	if (hdr->pad_len && !skb_is_nonlinear(skb))
 		skb_trim(skb, skb->len - hdr->pad_len);
 
 	event_data = (unsigned long)(skb);
@@ -873,6 +874,62 @@ static void bam_mux_write_done(struct work_struct *work)
 		dev_kfree_skb_any(skb);
 }
 
+static void bam_mux_tx_unmap(struct tx_pkt_info *pkt)
+{
+	struct sk_buff *skb = pkt->skb;
+	unsigned int i;
+
+	if (pkt->is_cmd) {
+		dma_unmap_single(dma_dev, pkt->dma_address, pkt->len,
+					bam_ops->dma_to);
+		return;
+	}
+
+	dma_unmap_single(dma_dev, pkt->dma_address, skb_headlen(skb),
+				bam_ops->dma_to);
+	for (i = 0; i < pkt->nr_frags; i++)
+		dma_unmap_page(dma_dev, pkt->frag_dma[i],
+			skb_frag_size(&skb_shinfo(skb)->frags[i]),
+			bam_ops->dma_to);
+}
+
+/*
+ * Queue a fragmented packet as a chain of descriptors.  Only the last one
+ * carries EOT, so the chain is seen as a single transfer and completes with
+ * a single event.  The fifo is checked up front since a chain cannot be
+ * withdrawn once partially queued.  Called with bam_tx_pool_spinlock held.
+ */
+static int bam_mux_tx_transfer_sg(struct tx_pkt_info *pkt, uint8_t pad_len)
+{
+	struct sk_buff *skb = pkt->skb;
+	u32 num_desc = 1 + pkt->nr_frags + (pad_len ? 1 : 0);
+	u32 unused = 0;
+	unsigned int i;
+	bool last;
+	int rc;
+
+	rc = bam_ops->sps_get_unused_desc_num_ptr(bam_tx_pipe, &unused);
+	if (rc)
+		return rc;
+	if (unused < num_desc)
+		return -ENOSPC;
+
+	rc = bam_ops->sps_transfer_one_ptr(bam_tx_pipe, pkt->dma_address,
+				skb_headlen(skb), pkt, 0);
+	for (i = 0; !rc && i < pkt->nr_frags; i++) {
+		last = (i == pkt->nr_frags - 1) && !pad_len;
+		rc = bam_ops->sps_transfer_one_ptr(bam_tx_pipe,
+				pkt->frag_dma[i],
+				skb_frag_size(&skb_shinfo(skb)->frags[i]),
+				pkt, last ? SPS_IOVEC_FLAG_EOT : 0);
+	}
+	if (!rc && pad_len)
+		rc = bam_ops->sps_transfer_one_ptr(bam_tx_pipe, tx_pad_dma,
+				pad_len, pkt, SPS_IOVEC_FLAG_EOT);
+
+	return rc;
+}
+
 int msm_bam_dmux_write(uint32_t id, struct sk_buff *skb)
 {
 	int rc = 0;
@@ -881,6 +938,7 @@ int msm_bam_dmux_write(uint32_t id, struct sk_buff *skb)
 	struct sk_buff *new_skb = NULL;
 	dma_addr_t dma_address;
 	struct tx_pkt_info *pkt;
+	unsigned int nr_frags, i;
 	int rcu_id;
 
 	if (id >= BAM_DMUX_NUM_CHANNELS)
@@ -930,9 +988,21 @@ int msm_bam_dmux_write(uint32_t id, struct sk_buff *skb)
 		atomic_dec(&ul_ondemand_vote);
 	}
 
+	/* fragments are sent as a descriptor chain, fall back to a copy
+	   only if that is not possible */
+	if (skb_is_nonlinear(skb) && (!tx_pad_buf || skb_has_frag_list(skb))) {
+		if (skb_linearize(skb)) {
+			pr_err("%s: cannot linearize skb\n", __func__);
+			goto write_fail;
+		}
+		DBG_INC_WRITE_CPY(skb->len);
+	}
+	nr_frags = skb_shinfo(skb)->nr_frags;
+
 	/* if skb do not have any tailroom for padding,
 	   copy the skb into a new expanded skb */
-	if ((skb->len & 0x3) && (skb_tailroom(skb) < (4 - (skb->len & 0x3)))) {
+	if (!nr_frags && (skb->len & 0x3) &&
+	    (skb_tailroom(skb) < (4 - (skb->len & 0x3)))) {
 		/* revisit, probably dev_alloc_skb and memcpy is effecient */
 		new_skb = skb_copy_expand(skb, skb_headroom(skb),
 					  4 - (skb->len & 0x3), GFP_ATOMIC);
@@ -954,22 +1024,29 @@ int msm_bam_dmux_write(uint32_t id, struct sk_buff *skb)
 	hdr->signal = 0;
 	hdr->ch_id = id;
 	hdr->pkt_len = skb->len - sizeof(struct bam_mux_hdr);
-	if (skb->len & 0x3)
-		skb_put(skb, 4 - (skb->len & 0x3));
+	if (nr_frags) {
+		/* padding is sent from tx_pad_buf */
+		hdr->pad_len = (4 - (skb->len & 0x3)) & 0x3;
+	} else {
+		if (skb->len & 0x3)
+			skb_put(skb, 4 - (skb->len & 0x3));
 
-	hdr->pad_len = skb->len - (sizeof(struct bam_mux_hdr) + hdr->pkt_len);
+		hdr->pad_len = skb->len -
+			(sizeof(struct bam_mux_hdr) + hdr->pkt_len);
+	}
 
 	DBG("%s: data %p, tail %p skb len %d pkt len %d pad len %d\n",
 	    __func__, skb->data, skb_tail_pointer(skb), skb->len,
 	    hdr->pkt_len, hdr->pad_len);
 
-	pkt = kmalloc(sizeof(struct tx_pkt_info), GFP_ATOMIC);
+	pkt = kmalloc(sizeof(struct tx_pkt_info) +
+			nr_frags * sizeof(dma_addr_t), GFP_ATOMIC);
 	if (pkt == NULL) {
 		pr_err("%s: mem alloc for tx_pkt_info failed\n", __func__);
 		goto write_fail2;
 	}
 
-	dma_address = dma_map_single(dma_dev, skb->data, skb->len,
+	dma_address = dma_map_single(dma_dev, skb->data, skb_headlen(skb),
 					bam_ops->dma_to);
 	if (!dma_address) {
 		pr_err("%s: dma_map_single() failed\n", __func__);
@@ -978,20 +1055,35 @@ int msm_bam_dmux_write(uint32_t id, struct sk_buff *skb)
 	pkt->skb = skb;
 	pkt->dma_address = dma_address;
 	pkt->is_cmd = 0;
+	pkt->nr_frags = 0;
+	for (i = 0; i < nr_frags; i++) {
+		pkt->frag_dma[i] = skb_frag_dma_map(dma_dev,
+				&skb_shinfo(skb)->frags[i], 0,
+				skb_frag_size(&skb_shinfo(skb)->frags[i]),
+				bam_ops->dma_to);
+		if (dma_mapping_error(dma_dev, pkt->frag_dma[i])) {
+			pr_err("%s: skb_frag_dma_map() failed\n", __func__);
+			bam_mux_tx_unmap(pkt);
+			goto write_fail3;
+		}
+		pkt->nr_frags++;
+	}
 	set_tx_timestamp(pkt);
 	INIT_WORK(&pkt->work, bam_mux_write_done);
 	spin_lock_irqsave(&bam_tx_pool_spinlock, flags);
 	list_add_tail(&pkt->list_node, &bam_tx_pool);
-	rc = bam_ops->sps_transfer_one_ptr(bam_tx_pipe, dma_address, skb->len,
-				pkt, SPS_IOVEC_FLAG_EOT);
+	if (nr_frags)
+		rc = bam_mux_tx_transfer_sg(pkt, hdr->pad_len);
+	else
+		rc = bam_ops->sps_transfer_one_ptr(bam_tx_pipe, dma_address,
+				skb->len, pkt, SPS_IOVEC_FLAG_EOT);
 	if (rc) {
 		DMUX_LOG_KERR("%s sps_transfer_one failed rc=%d\n",
 			__func__, rc);
 		list_del(&pkt->list_node);
 		DBG_INC_TX_SPS_FAILURE_CNT();
 		spin_unlock_irqrestore(&bam_tx_pool_spinlock, flags);
-		dma_unmap_single(dma_dev, pkt->dma_address,
-					pkt->skb->len,	bam_ops->dma_to);
+		bam_mux_tx_unmap(pkt);
 		kfree(pkt);
 		if (new_skb)
 			dev_kfree_skb_any(new_skb);
@@ -1257,11 +1349,45 @@ int msm_bam_dmux_is_ch_low(uint32_t id)
 	return ret;
 }
 
+/**
+ * rx_switch_to_polling_mode() - Mask the rx interrupt and schedule the poll
+ *
+ * Called from the EOT interrupt and whenever descriptors are found pending
+ * after the interrupt was re-enabled.  Ownership of the NAPI context decides
+ * who performs the switch, so concurrent callers are harmless.
+ */
+static void rx_switch_to_polling_mode(void)
+{
+	struct sps_connect cur_rx_conn;
+	int ret;
+
+	if (!napi_schedule_prep(&bam_rx_napi))
+		return;
+
+	ret = bam_ops->sps_get_config_ptr(bam_rx_pipe, &cur_rx_conn);
+	if (ret) {
+		pr_err("%s: sps_get_config() failed %d, interrupts not disabled\n",
+			__func__, ret);
+	} else {
+		cur_rx_conn.options = SPS_O_AUTO_ENABLE |
+			SPS_O_ACK_TRANSFERS | SPS_O_POLL;
+		ret = bam_ops->sps_set_config_ptr(bam_rx_pipe, &cur_rx_conn);
+		if (ret)
+			pr_err("%s: sps_set_config() failed %d, interrupts not disabled\n",
+				__func__, ret);
+	}
+
+	reinit_completion(&shutdown_completion);
+	grab_wakelock();
+	polling_mode = 1;
+	bam_rx_irq_ts = sched_clock();
+	__napi_schedule(&bam_rx_napi);
+}
+
 static void rx_switch_to_interrupt_mode(void)
 {
 	struct sps_connect cur_rx_conn;
-	struct sps_iovec iov;
-	struct rx_pkt_info *info;
+	u32 empty = 1;
 	int ret;
 
 	/*
@@ -1281,64 +1407,31 @@ static void rx_switch_to_interrupt_mode(void)
 		goto fail;
 	}
 
+	/*
+	 * Leave polling mode before unmasking the interrupt, an EOT taken
+	 * right after the unmask must not have its state undone here.
+	 */
+	polling_mode = 0;
 	cur_rx_conn.options = SPS_O_AUTO_ENABLE |
 		SPS_O_EOT | SPS_O_ACK_TRANSFERS;
 	ret = bam_ops->sps_set_config_ptr(bam_rx_pipe, &cur_rx_conn);
 	if (ret) {
 		pr_err("%s: sps_set_config() failed %d\n", __func__, ret);
+		polling_mode = 1;
 		goto fail;
 	}
-	polling_mode = 0;
 	complete_all(&shutdown_completion);
 	release_wakelock();
 
-	/* handle any rx packets before interrupt was enabled */
-	while (bam_connection_is_active && !polling_mode) {
-		ret = bam_ops->sps_get_iovec_ptr(bam_rx_pipe, &iov);
-		if (ret) {
-			pr_err("%s: sps_get_iovec failed %d\n",
-					__func__, ret);
-			break;
-		}
-		if (iov.addr == 0)
-			break;
-
-		mutex_lock(&bam_rx_pool_mutexlock);
-		if (unlikely(list_empty(&bam_rx_pool))) {
-			DMUX_LOG_KERR("%s: have iovec %p but rx pool empty\n",
-				__func__, (void *)(uintptr_t)iov.addr);
-			mutex_unlock(&bam_rx_pool_mutexlock);
-			continue;
-		}
-		info = list_first_entry(&bam_rx_pool, struct rx_pkt_info,
-							list_node);
-		if (info->dma_address != iov.addr) {
-			DMUX_LOG_KERR("%s: iovec %p != dma %p\n",
-				__func__,
-				(void *)(uintptr_t)iov.addr,
-				(void *)(uintptr_t)info->dma_address);
-			list_for_each_entry(info, &bam_rx_pool, list_node) {
-				DMUX_LOG_KERR("%s: dma %p\n", __func__,
-					(void *)(uintptr_t)info->dma_address);
-				if (iov.addr == info->dma_address)
-					break;
-			}
-		}
-		BUG_ON(info->dma_address != iov.addr);
-		list_del(&info->list_node);
-		--bam_rx_pool_len;
-		mutex_unlock(&bam_rx_pool_mutexlock);
-		info->sps_size = iov.size;
-		handle_bam_mux_cmd(&info->work);
-	}
+	/* rx packets completed before the interrupt was enabled raise no EOT */
+	ret = bam_ops->sps_is_pipe_empty_ptr(bam_rx_pipe, &empty);
+	if (!ret && !empty)
+		rx_switch_to_polling_mode();
 	return;
 
 fail:
 	pr_err("%s: reverting to polling\n", __func__);
-	if (no_cpu_affinity)
-		queue_work(bam_mux_rx_workqueue, &rx_timer_work);
-	else
-		queue_work_on(0, bam_mux_rx_workqueue, &rx_timer_work);
+	napi_schedule(&bam_rx_napi);
 }
 
 /**
@@ -1364,111 +1457,154 @@ static void log_rx_timestamp(void)
 								nanosec_rem);
 }
 
-static void rx_timer_work_func(struct work_struct *work)
+/**
+ * record_rx_latency() - Account rx packets in the latency histogram
+ * @now:	sched_clock() value at which the packets are being delivered
+ * @count:	number of packets
+ *
+ * Latency is measured from the EOT interrupt which started the current
+ * poll cycle.  Bucket n counts deliveries within [2^n, 2^(n+1)) usec, the
+ * last bucket is open ended.
+ */
+static void record_rx_latency(unsigned long long now, u32 count)
+{
+	unsigned long long delta;
+	int bucket = 0;
+
+	if (!bam_rx_irq_ts || now < bam_rx_irq_ts)
+		return;
+
+	delta = now - bam_rx_irq_ts;
+	do_div(delta, NSEC_PER_USEC);
+	if (delta)
+		bucket = min_t(int, ilog2(delta), BAM_DMUX_RX_LAT_BUCKETS - 1);
+	bam_rx_lat_hist[bucket] += count;
+}
+
+/**
+ * bam_rx_pool_dequeue() - Take the rx buffer matching a completed descriptor
+ * @addr:	address reported by the completed descriptor
+ *
+ * Return: the rx buffer, or NULL if the pool is unexpectedly empty
+ */
+static struct rx_pkt_info *bam_rx_pool_dequeue(phys_addr_t addr)
 {
-	struct sps_iovec iov;
 	struct rx_pkt_info *info;
-	int inactive_cycles = 0;
-	int ret;
-	u32 buffs_unused, buffs_used;
-
-	BAM_DMUX_LOG("%s: polling start\n", __func__);
-	while (bam_connection_is_active) { /* timer loop */
-		++inactive_cycles;
-		while (bam_connection_is_active) { /* deplete queue loop */
-			if (in_global_reset) {
-				BAM_DMUX_LOG(
-						"%s: polling exit, global reset detected\n",
-						__func__);
-				return;
-			}
+	unsigned long flags;
 
-			ret = bam_ops->sps_get_iovec_ptr(bam_rx_pipe, &iov);
-			if (ret) {
-				DMUX_LOG_KERR("%s: sps_get_iovec failed %d\n",
-						__func__, ret);
-				break;
-			}
-			if (iov.addr == 0)
+	spin_lock_irqsave(&bam_rx_pool_spinlock, flags);
+	if (unlikely(list_empty(&bam_rx_pool))) {
+		spin_unlock_irqrestore(&bam_rx_pool_spinlock, flags);
+		DMUX_LOG_KERR("%s: have iovec %p but rx pool empty\n",
+			__func__, (void *)(uintptr_t)addr);
+		return NULL;
+	}
+	info = list_first_entry(&bam_rx_pool, struct rx_pkt_info, list_node);
+	if (info->dma_address != addr) {
+		DMUX_LOG_KERR("%s: iovec %p != dma %p\n", __func__,
+			(void *)(uintptr_t)addr,
+			(void *)(uintptr_t)info->dma_address);
+		list_for_each_entry(info, &bam_rx_pool, list_node) {
+			DMUX_LOG_KERR("%s: dma %p\n", __func__,
+				(void *)(uintptr_t)info->dma_address);
+			if (addr == info->dma_address)
 				break;
-			store_rx_timestamp();
-			inactive_cycles = 0;
-			mutex_lock(&bam_rx_pool_mutexlock);
-			if (unlikely(list_empty(&bam_rx_pool))) {
-				DMUX_LOG_KERR(
-					"%s: have iovec %p but rx pool empty\n",
-					__func__, (void *)(uintptr_t)iov.addr);
-				mutex_unlock(&bam_rx_pool_mutexlock);
-				continue;
-			}
-			info = list_first_entry(&bam_rx_pool,
-					struct rx_pkt_info,	list_node);
-			if (info->dma_address != iov.addr) {
-				DMUX_LOG_KERR("%s: iovec %p != dma %p\n",
-					__func__,
-					(void *)(uintptr_t)iov.addr,
-					(void *)(uintptr_t)info->dma_address);
-				list_for_each_entry(info, &bam_rx_pool,
-						list_node) {
-					DMUX_LOG_KERR("%s: dma %p\n", __func__,
-						(void *)(uintptr_t)
-							info->dma_address);
-					if (iov.addr == info->dma_address)
-						break;
-				}
-			}
-			BUG_ON(info->dma_address != iov.addr);
-			list_del(&info->list_node);
-			--bam_rx_pool_len;
-			mutex_unlock(&bam_rx_pool_mutexlock);
-			info->sps_size = iov.size;
-			handle_bam_mux_cmd(&info->work);
 		}
+	}
+	BUG_ON(info->dma_address != addr);
+	list_del(&info->list_node);
+	--bam_rx_pool_len;
+	spin_unlock_irqrestore(&bam_rx_pool_spinlock, flags);
 
-		if (inactive_cycles >= POLLING_INACTIVITY) {
-			BAM_DMUX_LOG("%s: polling exit, no data\n", __func__);
-			rx_switch_to_interrupt_mode();
-			break;
-		}
+	return info;
+}
+
+/**
+ * bam_mux_rx_dispatch() - Hand a received buffer to its handler
+ * @info:	the rx buffer, already removed from the pool
+ *
+ * Data packets are processed in the poll.  Open and close commands
+ * register and unregister platform devices, which may sleep, so they are
+ * deferred to the rx workqueue.
+ */
+static void bam_mux_rx_dispatch(struct rx_pkt_info *info)
+{
+	struct bam_mux_hdr *rx_hdr;
 
-		if (bam_adaptive_timer_enabled) {
-			usleep_range(rx_timer_interval, rx_timer_interval + 50);
+	dma_unmap_single(dma_dev, info->dma_address, info->len,
+			bam_ops->dma_from);
+	rx_hdr = (struct bam_mux_hdr *)info->skb->data;
+	if (rx_hdr->cmd != BAM_MUX_HDR_CMD_DATA) {
+		queue_work(bam_mux_rx_workqueue, &info->work);
+		return;
+	}
 
-			ret = bam_ops->sps_get_unused_desc_num_ptr(bam_rx_pipe,
-						&buffs_unused);
+	handle_bam_mux_cmd(&info->work);
+}
 
-			if (ret) {
-				DMUX_LOG_KERR(
-					"%s: error getting num buffers unused after sleep\n",
-					__func__);
+static int bam_mux_rx_poll(struct napi_struct *napi, int budget)
+{
+	struct sps_iovec iov[BAM_DMUX_RX_BATCH];
+	struct rx_pkt_info *info;
+	u32 count, i;
+	int done = 0;
+	int ret;
 
-				break;
-			}
+	bam_rx_in_poll = true;
+	while (done < budget) {
+		if (in_global_reset || !bam_connection_is_active) {
+			/* reconnect_to_bam() re-enables the interrupt */
+			BAM_DMUX_LOG("%s: polling exit, %s\n", __func__,
+				in_global_reset ? "global reset detected" :
+				"disconnected");
+			bam_rx_in_poll = false;
+			napi_complete(napi);
+			return done;
+		}
 
-			buffs_used = num_buffers - buffs_unused;
-
-			if (buffs_unused == 0) {
-				rx_timer_interval = MIN_POLLING_SLEEP;
-			} else {
-				if (buffs_used > 0) {
-					rx_timer_interval =
-						(2 * num_buffers *
-							rx_timer_interval)/
-						(3 * buffs_used);
-				} else {
-					rx_timer_interval =
-						MAX_POLLING_SLEEP;
-				}
-			}
+		ret = bam_ops->sps_get_iovecs_ptr(bam_rx_pipe, iov,
+				min_t(u32, budget - done, BAM_DMUX_RX_BATCH),
+				&count);
+		if (ret) {
+			DMUX_LOG_KERR("%s: sps_get_iovecs failed %d\n",
+					__func__, ret);
+			break;
+		}
+		if (!count)
+			break;
 
-			if (rx_timer_interval > MAX_POLLING_SLEEP)
-				rx_timer_interval = MAX_POLLING_SLEEP;
-			else if (rx_timer_interval < MIN_POLLING_SLEEP)
-				rx_timer_interval = MIN_POLLING_SLEEP;
-		} else {
-			usleep_range(POLLING_MIN_SLEEP, POLLING_MAX_SLEEP);
+		store_rx_timestamp();
+		record_rx_latency(last_rx_pkt_timestamp, count);
+		for (i = 0; i < count; i++) {
+			info = bam_rx_pool_dequeue(iov[i].addr);
+			if (!info)
+				continue;
+			info->sps_size = iov[i].size;
+			bam_mux_rx_dispatch(info);
 		}
+		done += count;
 	}
+	bam_rx_in_poll = false;
+
+	if (done < budget) {
+		napi_complete(napi);
+		bam_rx_irq_ts = 0;
+		rx_switch_to_interrupt_mode();
+	}
+
+	return done;
+}
+
+/**
+ * msm_bam_dmux_rx_napi() - NAPI context of the current rx delivery
+ *
+ * Return: the NAPI context when called from a BAM_DMUX_RECEIVE notification
+ *	   delivered by the rx poll, NULL otherwise.  Clients may use it to
+ *	   pass packets to napi_gro_receive().
+ */
+struct napi_struct *msm_bam_dmux_rx_napi(void)
+{
+	return bam_rx_in_poll ? &bam_rx_napi : NULL;
 }
 
 static void bam_mux_tx_notify(struct sps_event_notify *notify)
@@ -1483,14 +1619,7 @@ static void bam_mux_tx_notify(struct sps_event_notify *notify)
 	switch (notify->event_id) {
 	case SPS_EVENT_EOT:
 		pkt = notify->data.transfer.user;
-		if (!pkt->is_cmd)
-			dma_unmap_single(dma_dev, pkt->dma_address,
-						pkt->skb->len,
-						bam_ops->dma_to);
-		else
-			dma_unmap_single(dma_dev, pkt->dma_address,
-						pkt->len,
-						bam_ops->dma_to);
+		bam_mux_tx_unmap(pkt);
 		queue_work(bam_mux_tx_workqueue, &pkt->work);
 		break;
 	default:
@@ -1501,9 +1630,6 @@ static void bam_mux_tx_notify(struct sps_event_notify *notify)
 
 static void bam_mux_rx_notify(struct sps_event_notify *notify)
 {
-	int ret;
-	struct sps_connect cur_rx_conn;
-
 	DBG("%s: event %d notified\n", __func__, notify->event_id);
 
 	if (in_global_reset)
@@ -1511,38 +1637,8 @@ static void bam_mux_rx_notify(struct sps_event_notify *notify)
 
 	switch (notify->event_id) {
 	case SPS_EVENT_EOT:
-		/* attempt to disable interrupts in this pipe */
-		if (!polling_mode) {
-			ret = bam_ops->sps_get_config_ptr(bam_rx_pipe,
-					&cur_rx_conn);
-			if (ret) {
-				pr_err("%s: sps_get_config() failed %d, interrupts not disabled\n",
-					__func__, ret);
-				break;
-			}
-			cur_rx_conn.options = SPS_O_AUTO_ENABLE |
-				SPS_O_ACK_TRANSFERS | SPS_O_POLL;
-			ret = bam_ops->sps_set_config_ptr(bam_rx_pipe,
-					&cur_rx_conn);
-			if (ret) {
-				pr_err("%s: sps_set_config() failed %d, interrupts not disabled\n",
-					__func__, ret);
-				break;
-			}
-			reinit_completion(&shutdown_completion);
-			grab_wakelock();
-			polling_mode = 1;
-			/*
-			 * run on core 0 so that netif_rx() in rmnet uses only
-			 * one queue if RPS enable use no_cpu_affinity
-			 */
-			if (no_cpu_affinity)
-				queue_work(bam_mux_rx_workqueue,
-							&rx_timer_work);
-			else
-				queue_work_on(0, bam_mux_rx_workqueue,
-							&rx_timer_work);
-		}
+		/* mask interrupts in this pipe until the poll is done */
+		rx_switch_to_polling_mode();
 		break;
 	default:
 		pr_err("%s: received unexpected event id %d\n", __func__,
@@ -1612,6 +1708,23 @@ static int debug_stats(char *buf, int max)
 	return i;
 }
 
+static int debug_rx_latency(char *buf, int max)
+{
+	int i = 0;
+	int j;
+
+	i += scnprintf(buf + i, max - i,
+			"rx EOT to delivery latency (usec)\n");
+	for (j = 0; j < BAM_DMUX_RX_LAT_BUCKETS - 1; ++j)
+		i += scnprintf(buf + i, max - i, "%7u - %7u: %u\n",
+				j ? 1U << j : 0, (1U << (j + 1)) - 1,
+				bam_rx_lat_hist[j]);
+	i += scnprintf(buf + i, max - i, "%7u -        : %u\n",
+			1U << j, bam_rx_lat_hist[j]);
+
+	return i;
+}
+
 #define DEBUG_BUFMAX 4096
 static char debug_buffer[DEBUG_BUFMAX];
 
@@ -2034,8 +2147,12 @@ static void reconnect_to_bam(void)
 									i);
 	bam_connection_is_active = 1;
 
-	if (polling_mode)
+	if (polling_mode) {
+		/* flush the poll raised by the switch from process context */
+		local_bh_disable();
 		rx_switch_to_interrupt_mode();
+		local_bh_enable();
+	}
 
 	toggle_apps_ack();
 	complete_all(&bam_connection_completion);
@@ -2062,6 +2179,8 @@ static void disconnect_to_bam(void)
 	}
 
 	bam_connection_is_active = 0;
+	/* the rx poll exits once it sees the connection is inactive */
+	napi_synchronize(&bam_rx_napi);
 
 	/* handle disconnect during active UL */
 	write_lock_irqsave(&ul_wakeup_lock, flags);
@@ -2090,7 +2209,7 @@ static void disconnect_to_bam(void)
 	}
 	unvote_dfab();
 
-	mutex_lock(&bam_rx_pool_mutexlock);
+	spin_lock_irqsave(&bam_rx_pool_spinlock, flags);
 	while (!list_empty(&bam_rx_pool)) {
 		node = bam_rx_pool.next;
 		list_del(node);
@@ -2101,7 +2220,7 @@ static void disconnect_to_bam(void)
 		kfree(info);
 	}
 	bam_rx_pool_len = 0;
-	mutex_unlock(&bam_rx_pool_mutexlock);
+	spin_unlock_irqrestore(&bam_rx_pool_spinlock, flags);
 	toggle_apps_ack();
 	verify_tx_queue_is_empty(__func__);
 }
@@ -2216,6 +2335,7 @@ static int restart_notifier_cb(struct notifier_block *this,
 		/* sync to ensure the driver sees SSR */
 		synchronize_srcu(&bam_dmux_srcu);
 		BAM_DMUX_LOG("%s: ssr signaling complete\n", __func__);
+		napi_synchronize(&bam_rx_napi);
 		flush_workqueue(bam_mux_rx_workqueue);
 	}
 	if (code == SUBSYS_BEFORE_POWERUP)
@@ -2265,17 +2385,11 @@ static int restart_notifier_cb(struct notifier_block *this,
 		list_del(node);
 		info = container_of(node, struct tx_pkt_info,
 							list_node);
-		if (!info->is_cmd) {
-			dma_unmap_single(dma_dev, info->dma_address,
-						info->skb->len,
-						bam_ops->dma_to);
+		bam_mux_tx_unmap(info);
+		if (!info->is_cmd)
 			dev_kfree_skb_any(info->skb);
-		} else {
-			dma_unmap_single(dma_dev, info->dma_address,
-						info->len,
-						bam_ops->dma_to);
+		else
 			kfree(info->skb);
-		}
 		kfree(info);
 	}
 	spin_unlock_irqrestore(&bam_tx_pool_spinlock, flags);
@@ -2727,6 +2841,14 @@ static int bam_dmux_probe(struct platform_device *pdev)
 	*dma_dev->dma_mask = DMA_BIT_MASK(32);
 	dma_dev->coherent_dma_mask = DMA_BIT_MASK(32);
 
+	tx_pad_buf = dma_alloc_coherent(dma_dev, BAM_MUX_TX_PAD_SIZE,
+					&tx_pad_dma, GFP_KERNEL);
+	if (tx_pad_buf)
+		memset(tx_pad_buf, 0, BAM_MUX_TX_PAD_SIZE);
+	else
+		BAM_DMUX_LOG("%s: no pad buffer, fragmented tx is copied\n",
+			__func__);
+
 	xo_clk = clk_get(&pdev->dev, "xo");
 	if (IS_ERR(xo_clk)) {
 		BAM_DMUX_LOG("%s: did not get xo clock\n", __func__);
@@ -2743,9 +2865,8 @@ static int bam_dmux_probe(struct platform_device *pdev)
 	}
 
 	/*
-	 * setup the workqueue so that it can be pinned to core 0 and not
-	 * block the watchdog pet function, so that netif_rx() in rmnet
-	 * only uses one queue.
+	 * setup the workqueue for rx control commands so that it can be
+	 * pinned to core 0 and not block the watchdog pet function.
 	 */
 	if (no_cpu_affinity)
 		bam_mux_rx_workqueue =
@@ -2785,8 +2906,14 @@ static int bam_dmux_probe(struct platform_device *pdev)
 	wakeup_source_init(&bam_wakelock, "bam_dmux_wakelock");
 	init_srcu_struct(&bam_dmux_srcu);
 
+	init_dummy_netdev(&bam_rx_napi_dev);
+	netif_napi_add(&bam_rx_napi_dev, &bam_rx_napi, bam_mux_rx_poll,
+			BAM_DMUX_NAPI_WEIGHT);
+	napi_enable(&bam_rx_napi);
+
 	subsys_h = subsys_notif_register_notifier("modem", &restart_notifier);
 	if (IS_ERR(subsys_h)) {
+		netif_napi_del(&bam_rx_napi);
 		destroy_workqueue(bam_mux_rx_workqueue);
 		destroy_workqueue(bam_mux_tx_workqueue);
 		rc = (int)PTR_ERR(subsys_h);
@@ -2800,6 +2927,7 @@ static int bam_dmux_probe(struct platform_device *pdev)
 
 	if (rc) {
 		subsys_notif_unregister_notifier(subsys_h, &restart_notifier);
+		netif_napi_del(&bam_rx_napi);
 		destroy_workqueue(bam_mux_rx_workqueue);
 		destroy_workqueue(bam_mux_tx_workqueue);
 		pr_err("%s: smsm cb register failed, rc: %d\n", __func__, rc);
@@ -2812,6 +2940,7 @@ static int bam_dmux_probe(struct platform_device *pdev)
 
 	if (rc) {
 		subsys_notif_unregister_notifier(subsys_h, &restart_notifier);
+		netif_napi_del(&bam_rx_napi);
 		destroy_workqueue(bam_mux_rx_workqueue);
 		destroy_workqueue(bam_mux_tx_workqueue);
 		bam_ops->smsm_state_cb_deregister_ptr(SMSM_MODEM_STATE,
@@ -2856,6 +2985,7 @@ static int __init bam_dmux_init(void)
 		debug_create("tbl", 0444, dent, debug_tbl);
 		debug_create("ul_pkt_cnt", 0444, dent, debug_ul_pkt_cnt);
 		debug_create("stats", 0444, dent, debug_stats);
+		debug_create("rx_latency", 0444, dent, debug_rx_latency);
 	}
 #endif
 
@@ -2864,8 +2994,6 @@ static int __init bam_dmux_init(void)
 	if (!bam_ipc_log_txt)
 		pr_err("%s : unable to create IPC Logging Context", __func__);
 
-	rx_timer_interval = DEFAULT_POLLING_MIN_SLEEP;
-
 	return platform_driver_register(&bam_dmux_driver);
 }
 
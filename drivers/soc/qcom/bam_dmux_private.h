@@ -52,6 +52,8 @@
  * @sps_transfer_one_ptr: pointer to sps_transfer_one function
  * @sps_get_iovec_ptr: pointer to sps_get_iovec function
  * @sps_get_unused_desc_num_ptr: pointer to sps_get_unused_desc_num function
+ * @sps_get_iovecs_ptr: pointer to sps_get_iovecs function
+ * @sps_is_pipe_empty_ptr: pointer to sps_is_pipe_empty function
  * @dma_to: enum for the direction of dma operations to device
  * @dma_from: enum for the direction of dma operations from device
  *
@@ -108,6 +110,11 @@ struct bam_ops_if {
 	int (*sps_get_unused_desc_num_ptr)(struct sps_pipe *h,
 		u32 *desc_num);
 
+	int (*sps_get_iovecs_ptr)(struct sps_pipe *h,
+		struct sps_iovec *iovec, u32 budget, u32 *count);
+
+	int (*sps_is_pipe_empty_ptr)(struct sps_pipe *h, u32 *empty);
+
 	enum dma_data_direction dma_to;
 
 	enum dma_data_direction dma_from;
@@ -160,6 +167,8 @@ struct rx_pkt_info {
  * @list_node: list_head for placing this on a list
  * @ts_sec: seconds portion of the timestamp
  * @ts_nsec: nanoseconds portion of the timestamp
+ * @nr_frags: number of skb fragments mapped in @frag_dma
+ * @frag_dma: dma mapped addresses of the skb fragments
  *
  */
 struct tx_pkt_info {
@@ -171,6 +180,8 @@ struct tx_pkt_info {
 	struct list_head list_node;
 	unsigned ts_sec;
 	unsigned long ts_nsec;
+	unsigned int nr_frags;
+	dma_addr_t frag_dma[0];
 };
 
 void msm_bam_dmux_set_bam_ops(struct bam_ops_if *ops);
@@ -0,0 +1,327 @@
+/* Copyright (c) 2016, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <linux/kernel.h>
+#include <linux/atomic.h>
+#include <linux/debugfs.h>
+#include <linux/fs.h>
+#include <linux/init.h>
+#include <linux/sched.h>
+#include <linux/seq_file.h>
+#include <linux/sort.h>
+#include <linux/string.h>
+#include <linux/vmalloc.h>
+#include <soc/qcom/boot_stats.h>
+#include <soc/qcom/boot_timeline.h>
+
+#define BOOT_TL_MAX_ENTRIES	1024
+#define BOOT_TL_NAME_LEN	32
+#define BOOT_TL_MAX_DEPTH	32
+#define BOOT_TL_CRIT_PID	1	/* kernel_init, then init */
+
+/*
+ * Spans are recorded with sched_clock(), which is cheap enough to take
+ * around every initcall and probe. They are converted to sclk ticks on
+ * read, against a reference pair of both clocks taken at that time, so
+ * that they line up with the bootloader markers.
+ */
+struct boot_tl_entry {
+	u64 start_ns;
+	u64 end_ns;		/* 0 while the span is open */
+	void *fn;
+	pid_t pid;
+	u8 phase;
+	char name[BOOT_TL_NAME_LEN];
+};
+
+/* Kept for the lifetime of the system, so it can be pulled from a dump */
+static struct boot_tl_entry boot_tl_entries[BOOT_TL_MAX_ENTRIES];
+static atomic_t boot_tl_next = ATOMIC_INIT(0);
+static bool boot_tl_stopped;
+
+static const char * const boot_tl_phase_names[BOOT_TL_NR_PHASES] = {
+	[BOOT_TL_INITCALL]		= "initcall",
+	[BOOT_TL_PROBE]			= "probe",
+	[BOOT_TL_DEFERRED_PROBE]	= "deferred-probe",
+	[BOOT_TL_PIL]			= "pil",
+	[BOOT_TL_DISPLAY]		= "display",
+	[BOOT_TL_MOUNT]			= "mount",
+};
+
+static struct boot_tl_entry *boot_tl_new(enum boot_tl_phase phase, int *id)
+{
+	struct boot_tl_entry *e;
+	int i;
+
+	if (ACCESS_ONCE(boot_tl_stopped))
+		return NULL;
+
+	i = atomic_inc_return(&boot_tl_next) - 1;
+	if (i >= BOOT_TL_MAX_ENTRIES) {
+		boot_tl_stopped = true;
+		return NULL;
+	}
+
+	e = &boot_tl_entries[i];
+	e->phase = phase;
+	e->pid = task_pid_nr(current);
+	e->start_ns = sched_clock();
+	*id = i;
+	return e;
+}
+
+int boot_timeline_begin(enum boot_tl_phase phase, const char *name)
+{
+	struct boot_tl_entry *e;
+	int id;
+
+	e = boot_tl_new(phase, &id);
+	if (!e)
+		return -ENOSPC;
+
+	strlcpy(e->name, name, sizeof(e->name));
+	return id;
+}
+EXPORT_SYMBOL(boot_timeline_begin);
+
+int boot_timeline_begin_fn(enum boot_tl_phase phase, void *fn)
+{
+	struct boot_tl_entry *e;
+	int id;
+
+	e = boot_tl_new(phase, &id);
+	if (!e)
+		return -ENOSPC;
+
+	e->fn = fn;
+	return id;
+}
+EXPORT_SYMBOL(boot_timeline_begin_fn);
+
+void boot_timeline_end(int id)
+{
+	if (id < 0 || id >= BOOT_TL_MAX_ENTRIES)
+		return;
+
+	boot_tl_entries[id].end_ns = sched_clock();
+}
+EXPORT_SYMBOL(boot_timeline_end);
+
+void boot_timeline_mark(enum boot_tl_phase phase, const char *name)
+{
+	int id = boot_timeline_begin(phase, name);
+
+	if (id >= 0)
+		boot_tl_entries[id].end_ns = boot_tl_entries[id].start_ns;
+}
+EXPORT_SYMBOL(boot_timeline_mark);
+
+static int boot_tl_nr_entries(void)
+{
+	return min(atomic_read(&boot_tl_next), BOOT_TL_MAX_ENTRIES);
+}
+
+static void boot_tl_print_name(struct seq_file *s, struct boot_tl_entry *e)
+{
+	if (e->fn)
+		seq_printf(s, "%pf\n", e->fn);
+	else
+		seq_printf(s, "%s\n", e->name);
+}
+
+static int boot_tl_show(struct seq_file *s, void *unused)
+{
+	unsigned long long ref_sclk = msm_timer_get_sclk_ticks();
+	u64 ref_ns = sched_clock();
+	int i, n = boot_tl_nr_entries();
+
+	/* sclk is a 32 bit counter; anything else is an error value */
+	if (ref_sclk > U32_MAX)
+		ref_sclk = 0;
+
+	seq_printf(s, "%10s %12s %10s %6s %-14s %s\n", "sclk", "start_ms",
+		   "dur_us", "pid", "phase", "name");
+	for (i = 0; i < n; i++) {
+		struct boot_tl_entry *e = &boot_tl_entries[i];
+		u64 sclk = div_u64((ref_ns - e->start_ns) * TIMER_KHZ,
+				   NSEC_PER_SEC);
+		u64 ms = div_u64(e->start_ns, USEC_PER_SEC);
+
+		sclk = ref_sclk > sclk ? ref_sclk - sclk : 0;
+		seq_printf(s, "%10llu %8llu.%03llu ", sclk,
+			   div_u64(ms, 1000), ms % 1000);
+		if (e->end_ns)
+			seq_printf(s, "%10llu ", div_u64(e->end_ns -
+				   e->start_ns, NSEC_PER_USEC));
+		else
+			seq_printf(s, "%10s ", "open");
+		seq_printf(s, "%6d %-14s ", e->pid,
+			   boot_tl_phase_names[e->phase]);
+		boot_tl_print_name(s, e);
+	}
+	if (boot_tl_stopped)
+		seq_puts(s, "recording stopped\n");
+	return 0;
+}
+
+static int boot_tl_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, boot_tl_show, NULL);
+}
+
+/* userspace writes anything once boot is complete to stop recording */
+static ssize_t boot_tl_write(struct file *file, const char __user *buf,
+			     size_t count, loff_t *ppos)
+{
+	boot_tl_stopped = true;
+	return count;
+}
+
+static const struct file_operations boot_tl_fops = {
+	.open		= boot_tl_open,
+	.read		= seq_read,
+	.write		= boot_tl_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+struct boot_tl_span {
+	u64 start_ns;
+	u64 end_ns;
+	u64 self_ns;
+	u64 crit_ns;
+	pid_t pid;
+	int id;
+};
+
+static int boot_tl_cmp_start(const void *a, const void *b)
+{
+	const struct boot_tl_span *x = a, *y = b;
+
+	if (x->pid != y->pid)
+		return x->pid < y->pid ? -1 : 1;
+	if (x->start_ns != y->start_ns)
+		return x->start_ns < y->start_ns ? -1 : 1;
+	/* the enclosing span of two starting together is the longer one */
+	return x->end_ns > y->end_ns ? -1 : x->end_ns < y->end_ns;
+}
+
+static int boot_tl_cmp_crit(const void *a, const void *b)
+{
+	const struct boot_tl_span *x = a, *y = b;
+
+	if (x->crit_ns != y->crit_ns)
+		return x->crit_ns > y->crit_ns ? -1 : 1;
+	if (x->self_ns != y->self_ns)
+		return x->self_ns > y->self_ns ? -1 : 1;
+	return 0;
+}
+
+/*
+ * Each span is charged its own time only, i.e. its duration minus that
+ * of the spans nested in it on the same task, such as the probes run by
+ * the initcall registering their driver. Only time spent on the task
+ * that runs the initcalls and then init counts towards the critical
+ * path; everything else ran in parallel with it.
+ */
+static int boot_tl_summary_show(struct seq_file *s, void *unused)
+{
+	struct boot_tl_span *spans, *stack[BOOT_TL_MAX_DEPTH];
+	int i, n = 0, depth = 0, nr = boot_tl_nr_entries();
+
+	spans = vmalloc(nr * sizeof(*spans));
+	if (!spans)
+		return -ENOMEM;
+
+	for (i = 0; i < nr; i++) {
+		struct boot_tl_entry *e = &boot_tl_entries[i];
+
+		if (!e->end_ns)
+			continue;
+		spans[n].start_ns = e->start_ns;
+		spans[n].end_ns = e->end_ns;
+		spans[n].self_ns = e->end_ns - e->start_ns;
+		spans[n].pid = e->pid;
+		spans[n].id = i;
+		n++;
+	}
+
+	sort(spans, n, sizeof(*spans), boot_tl_cmp_start, NULL);
+	for (i = 0; i < n; i++) {
+		struct boot_tl_span *sp = &spans[i];
+
+		while (depth && (stack[depth - 1]->pid != sp->pid ||
+				 stack[depth - 1]->end_ns <= sp->start_ns))
+			depth--;
+		if (depth) {
+			struct boot_tl_span *parent = stack[depth - 1];
+			u64 dur = sp->end_ns - sp->start_ns;
+
+			parent->self_ns -= min(parent->self_ns, dur);
+		}
+		if (depth < BOOT_TL_MAX_DEPTH)
+			stack[depth++] = sp;
+	}
+	for (i = 0; i < n; i++)
+		spans[i].crit_ns = spans[i].pid == BOOT_TL_CRIT_PID ?
+			spans[i].self_ns : 0;
+	sort(spans, n, sizeof(*spans), boot_tl_cmp_crit, NULL);
+
+	seq_printf(s, "%10s %10s %10s %6s %-14s %s\n", "crit_us", "self_us",
+		   "total_us", "pid", "phase", "name");
+	for (i = 0; i < n; i++) {
+		struct boot_tl_span *sp = &spans[i];
+		struct boot_tl_entry *e = &boot_tl_entries[sp->id];
+
+		seq_printf(s, "%10llu %10llu %10llu %6d %-14s ",
+			   div_u64(sp->crit_ns, NSEC_PER_USEC),
+			   div_u64(sp->self_ns, NSEC_PER_USEC),
+			   div_u64(sp->end_ns - sp->start_ns, NSEC_PER_USEC),
+			   sp->pid, boot_tl_phase_names[e->phase]);
+		boot_tl_print_name(s, e);
+	}
+
+	vfree(spans);
+	return 0;
+}
+
+static int boot_tl_summary_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, boot_tl_summary_show, NULL);
+}
+
+static const struct file_operations boot_tl_summary_fops = {
+	.open		= boot_tl_summary_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init boot_timeline_init(void)
+{
+	struct dentry *dent;
+
+	dent = debugfs_create_dir("boot_timeline", NULL);
+	if (IS_ERR_OR_NULL(dent))
+		return -ENODEV;
+
+	if (!debugfs_create_file("timeline", S_IRUGO | S_IWUSR, dent, NULL,
+				 &boot_tl_fops) ||
+	    !debugfs_create_file("summary", S_IRUGO, dent, NULL,
+				 &boot_tl_summary_fops)) {
+		pr_err("boot_timeline: Could not create debugfs files\n");
+		debugfs_remove_recursive(dent);
+		return -ENODEV;
+	}
+	return 0;
+}
+late_initcall(boot_timeline_init);
@@ -18,6 +18,7 @@
 #include <linux/kobject.h>
 #include <linux/stat.h>
 #include <soc/qcom/scm.h>
+#include <soc/qcom/hang_snapshot.h>
 #include <linux/platform_device.h>
 
 #define ACE_OFFSET	0
@@ -43,6 +44,7 @@ struct hang_detect {
 			 PCIO_threshold;
 	struct kobject kobj;
 	struct mutex lock;
+	struct notifier_block snapshot_nb;
 };
 
 /* interface for exporting attributes */
@@ -461,6 +463,35 @@ static struct attribute_group hang_attr_group = {
 	.attrs = hang_attrs,
 };
 
+/* records which ports were being watched and how, from the cached values */
+static int gladiator_hang_snapshot(struct notifier_block *nb,
+				   unsigned long action, void *data)
+{
+	static const char * const names[] = {
+		[ACE_OFFSET] = "ace", [IO_OFFSET] = "io", [M1_OFFSET] = "m1",
+		[M2_OFFSET] = "m2", [PCIO_OFFSET] = "pcio",
+	};
+	struct hang_detect *hang_dev = container_of(nb, struct hang_detect,
+						    snapshot_nb);
+	struct hang_snapshot_buf *b = data;
+	uint32_t enabled, threshold;
+	int i;
+
+	b->len += scnprintf(b->buf + b->len, b->size - b->len,
+			    "  gladiator:");
+	for (i = 0; i < ARRAY_SIZE(names); i++) {
+		if (!names[i])
+			continue;
+		get_enable(i, hang_dev, &enabled);
+		get_threshold(i, hang_dev, &threshold);
+		b->len += scnprintf(b->buf + b->len, b->size - b->len,
+				    " %s %s/%#x", names[i],
+				    enabled ? "on" : "off", threshold);
+	}
+	b->len += scnprintf(b->buf + b->len, b->size - b->len, "\n");
+	return NOTIFY_OK;
+}
+
 static const struct of_device_id msm_gladiator_hang_detect_table[] = {
 	{ .compatible = "qcom,gladiator-hang-detect" },
 	{}
@@ -515,6 +546,8 @@ static int msm_gladiator_hang_detect_probe(struct platform_device *pdev)
 		goto out_del_kobj;
 	}
 	mutex_init(&hang_det->lock);
+	hang_det->snapshot_nb.notifier_call = gladiator_hang_snapshot;
+	hang_snapshot_register_notifier(&hang_det->snapshot_nb);
 	platform_set_drvdata(pdev, hang_det);
 	return 0;
 
@@ -531,6 +564,7 @@ static int msm_gladiator_hang_detect_remove(struct platform_device *pdev)
 	struct hang_detect *hang_det = platform_get_drvdata(pdev);
 
 	platform_set_drvdata(pdev, NULL);
+	hang_snapshot_unregister_notifier(&hang_det->snapshot_nb);
 	sysfs_remove_group(&hang_det->kobj, &hang_attr_group);
 	kobject_del(&hang_det->kobj);
 	kobject_put(&hang_det->kobj);
@@ -194,6 +194,10 @@ static DEFINE_MUTEX(edge_list_lock_lhd0);
  * @int_req_complete:		Intent tracking completion - received intent
  * @rx_intent_req_timeout_jiffies:	Timeout for requesting an RX intent, in
  *			jiffies; if set to 0, timeout is infinite
+ * @rx_intent_pool:		RX intents queued when the channel connects
+ * @rx_intent_pool_buckets:	Number of valid entries in @rx_intent_pool
+ * @tx_intent_waits:		Transmits that had to request a remote intent
+ * @rx_intent_reqs:		Intent requests received from the remote side
  *
  * @local_rx_intent_lst_lock_lhc1:	RX intent list lock
  * @local_rx_intent_list:		Active RX Intents queued by client
@@ -216,6 +220,8 @@ static DEFINE_MUTEX(edge_list_lock_lhd0);
  * @pending_delete:			waiting for channel to be deleted
  * @no_migrate:				The local client does not want to
  *					migrate transports
+ * @tx_low_latency:			Packets are signalled to the remote
+ *					side without batching
  * @local_xprt_req:			The transport the local side requested
  * @local_xprt_resp:			The response to @local_xprt_req
  * @remote_xprt_req:			The transport the remote side requested
@@ -272,6 +278,11 @@ struct channel_ctx {
 	struct completion int_req_ack_complete;
 	struct completion int_req_complete;
 	unsigned long rx_intent_req_timeout_jiffies;
+	struct glink_rx_intent_bucket
+		rx_intent_pool[GLINK_RX_INTENT_POOL_MAX_BUCKETS];
+	unsigned int rx_intent_pool_buckets;
+	uint32_t tx_intent_waits;
+	uint32_t rx_intent_reqs;
 
 	spinlock_t local_rx_intent_lst_lock_lhc1;
 	struct list_head local_rx_intent_list;
@@ -295,6 +306,7 @@ struct channel_ctx {
 	bool pending_delete;
 
 	bool no_migrate;
+	bool tx_low_latency;
 	uint16_t local_xprt_req;
 	uint16_t local_xprt_resp;
 	uint16_t remote_xprt_req;
@@ -1332,6 +1344,7 @@ struct glink_core_rx_intent *ch_push_local_rx_intent(struct channel_ctx *ctx,
 	intent->write_offset = 0;
 	intent->pkt_size = 0;
 	intent->bounce_buf = NULL;
+	intent->pooled = false;
 
 	spin_lock_irqsave(&ctx->local_rx_intent_lst_lock_lhc1, flags);
 	list_add_tail(&intent->list, &ctx->local_rx_intent_list);
@@ -1625,6 +1638,49 @@ struct glink_core_rx_intent *ch_get_free_local_rx_intent(
 	return ptr_intent;
 }
 
+/**
+ * ch_queue_rx_intent_pool() - Queue the rx intent pool of a channel
+ * @ctx:	Local channel context
+ *
+ * Called when the channel becomes fully opened, before the client is notified,
+ * so the remote side can send right away instead of first requesting an
+ * intent.  Pooled intents are reused by glink_rx_done() and released with the
+ * rest of the intents when the channel closes.
+ */
+static void ch_queue_rx_intent_pool(struct channel_ctx *ctx)
+{
+	struct glink_core_rx_intent *intent;
+	unsigned int i;
+	uint32_t j;
+	size_t size;
+	int ret;
+
+	if (ctx->transport_ptr->capabilities & GCAP_INTENTLESS)
+		return;
+
+	for (i = 0; i < ctx->rx_intent_pool_buckets; i++) {
+		size = ctx->rx_intent_pool[i].size;
+		for (j = 0; j < ctx->rx_intent_pool[i].count; j++) {
+			intent = ch_push_local_rx_intent(ctx, NULL, size);
+			if (!intent) {
+				GLINK_ERR_CH(ctx,
+					"%s: Pool intent allocation failed size[%zu]\n",
+					__func__, size);
+				return;
+			}
+			intent->pooled = true;
+
+			ret = ctx->transport_ptr->ops->tx_cmd_local_rx_intent(
+				ctx->transport_ptr->ops, ctx->lcid, size,
+				intent->id);
+			if (ret) {
+				ch_remove_local_rx_intent(ctx, intent->id);
+				return;
+			}
+		}
+	}
+}
+
 /**
  * ch_purge_intent_lists() - Remove all intents for a channel
  *
@@ -2417,6 +2473,14 @@ static int dummy_power_unvote(struct glink_transport_if *if_ptr)
 	return -EOPNOTSUPP;
 }
 
+/**
+ * dummy_tx_flush() - Dummy tx flush operation
+ * @if_ptr:	The transport to flush.
+ */
+static void dummy_tx_flush(struct glink_transport_if *if_ptr)
+{
+}
+
 /**
  * notif_if_up_all_xprts() - Check and notify existing transport state if up
  * @notif_info:	Data structure containing transport information to be notified.
@@ -2544,6 +2608,12 @@ void *glink_open(const struct glink_open_config *cfg)
 		}
 	}
 
+	if (cfg->rx_intent_pool_buckets > GLINK_RX_INTENT_POOL_MAX_BUCKETS ||
+	    (cfg->rx_intent_pool_buckets && !cfg->rx_intent_pool)) {
+		GLINK_ERR("%s: Invalid rx intent pool\n", __func__);
+		return ERR_PTR(-EINVAL);
+	}
+
 	/* confirm required notification parameters */
 	if (!(cfg->notify_rx || cfg->notify_rxv) || !cfg->notify_tx_done
 		|| !cfg->notify_state
@@ -2598,6 +2668,13 @@ void *glink_open(const struct glink_open_config *cfg)
 	ctx->notify_tx_abort = cfg->notify_tx_abort;
 	ctx->notify_rx_tracer_pkt = cfg->notify_rx_tracer_pkt;
 	ctx->notify_remote_rx_intent = cfg->notify_remote_rx_intent;
+	ctx->rx_intent_pool_buckets = cfg->rx_intent_pool_buckets;
+	if (cfg->rx_intent_pool_buckets)
+		memcpy(ctx->rx_intent_pool, cfg->rx_intent_pool,
+		       cfg->rx_intent_pool_buckets *
+		       sizeof(*cfg->rx_intent_pool));
+	ctx->tx_intent_waits = 0;
+	ctx->rx_intent_reqs = 0;
 
 	if (!ctx->notify_rx_intent_req)
 		ctx->notify_rx_intent_req = glink_dummy_notify_rx_intent_req;
@@ -2614,6 +2691,7 @@ void *glink_open(const struct glink_open_config *cfg)
 	ctx->local_xprt_req = best_id;
 	ctx->no_migrate = cfg->transport &&
 				!(cfg->options & GLINK_OPT_INITIAL_XPORT);
+	ctx->tx_low_latency = cfg->options & GLINK_OPT_TX_LOW_LATENCY;
 	ctx->transport_ptr = transport_ptr;
 	ctx->local_open_state = GLINK_CHANNEL_OPENING;
 	GLINK_INFO_PERF_CH(ctx,
@@ -2914,6 +2992,7 @@ static int glink_tx_common(void *handle, void *pkt_priv,
 		}
 
 		/* request intent of correct size */
+		ctx->tx_intent_waits++;
 		reinit_completion(&ctx->int_req_ack_complete);
 		ret = ctx->transport_ptr->ops->tx_cmd_rx_intent_req(
 				ctx->transport_ptr->ops, ctx->lcid, size);
@@ -3008,6 +3087,7 @@ static int glink_tx_common(void *handle, void *pkt_priv,
 	tx_info->size = size;
 	tx_info->size_remaining = size;
 	tx_info->tracer_pkt = tx_flags & GLINK_TX_TRACER_PKT ? true : false;
+	tx_info->low_latency = ctx->tx_low_latency;
 	tx_info->iovec = iovec ? iovec : (void *)tx_info;
 	tx_info->vprovider = vbuf_provider;
 	tx_info->pprovider = pbuf_provider;
@@ -3173,6 +3253,9 @@ int glink_rx_done(void *handle, const void *ptr, bool reuse)
 	GLINK_INFO_PERF_CH(ctx, "%s: L[%u]: data[%p]. TID %u\n",
 			__func__, liid_ptr->id, ptr, current->pid);
 	id = liid_ptr->id;
+	/* Pooled intents always go back to the remote side */
+	if (liid_ptr->pooled)
+		reuse = true;
 	if (reuse) {
 		ret = ctx->transport_ptr->ops->reuse_rx_intent(
 					ctx->transport_ptr->ops, liid_ptr);
@@ -3948,6 +4031,8 @@ int glink_core_register_transport(struct glink_transport_if *if_ptr,
 		if_ptr->power_vote = dummy_power_vote;
 	if (!if_ptr->power_unvote)
 		if_ptr->power_unvote = dummy_power_unvote;
+	if (!if_ptr->tx_flush)
+		if_ptr->tx_flush = dummy_tx_flush;
 	xprt_ptr->capabilities = 0;
 	xprt_ptr->ops = if_ptr;
 	spin_lock_init(&xprt_ptr->xprt_ctx_lock_lhb1);
@@ -4831,8 +4916,10 @@ static void glink_core_rx_cmd_ch_remote_open(struct glink_transport_if *if_ptr,
 			__func__, req_xprt, xprt_resp);
 
 	if_ptr->tx_cmd_ch_remote_open_ack(if_ptr, rcid, xprt_resp);
-	if (!do_migrate && ch_is_fully_opened(ctx))
+	if (!do_migrate && ch_is_fully_opened(ctx)) {
+		ch_queue_rx_intent_pool(ctx);
 		ctx->notify_state(ctx, ctx->user_priv, GLINK_CONNECTED);
+	}
 
 
 	if (do_migrate)
@@ -4879,6 +4966,7 @@ static void glink_core_rx_cmd_ch_open_ack(struct glink_transport_if *if_ptr,
 			__func__);
 
 		if (ch_is_fully_opened(ctx)) {
+			ch_queue_rx_intent_pool(ctx);
 			ctx->notify_state(ctx, ctx->user_priv, GLINK_CONNECTED);
 			GLINK_INFO_PERF_CH(ctx,
 					"%s: notify state: GLINK_CONNECTED\n",
@@ -5048,6 +5136,7 @@ static void glink_core_rx_cmd_remote_rx_intent_req(
 				(unsigned)rcid);
 		return;
 	}
+	ctx->rx_intent_reqs++;
 	if (!ctx->notify_rx_intent_req) {
 		GLINK_ERR_CH(ctx,
 			"%s: Notify function not defined for local channel",
@@ -5328,6 +5417,7 @@ static int xprt_single_threaded_tx(struct glink_core_xprt_ctx *xprt_ptr,
 		ret = xprt_ptr->ops->tx(ch_ptr->transport_ptr->ops,
 					ch_ptr->lcid, tx_info);
 	} while (ret == -EAGAIN);
+	xprt_ptr->ops->tx_flush(xprt_ptr->ops);
 	if (ret < 0 || tx_info->size_remaining) {
 		GLINK_ERR_CH(ch_ptr, "%s: Error %d writing data\n",
 			     __func__, ret);
@@ -5527,6 +5617,7 @@ static void tx_func(struct kthread_work *work)
 			if (prio == 0) {
 				spin_unlock_irqrestore(
 					&xprt_ptr->tx_ready_lock_lhb3, flags);
+				xprt_ptr->ops->tx_flush(xprt_ptr->ops);
 				return;
 			}
 			prio--;
@@ -5602,6 +5693,8 @@ static void tx_func(struct kthread_work *work)
 		transmitted_successfully = true;
 		rwref_put(&ch_ptr->ch_state_lhb2);
 	}
+	/* Signal everything written in this pass with a single interrupt */
+	xprt_ptr->ops->tx_flush(xprt_ptr->ops);
 	glink_pm_qos_unvote(xprt_ptr);
 	GLINK_PERF("%s: worker exiting\n", __func__);
 }
@@ -6107,6 +6200,38 @@ int glink_get_ch_rintents_queued(struct channel_ctx *ch_ctx)
 }
 EXPORT_SYMBOL(glink_get_ch_rintents_queued);
 
+/**
+ * glink_get_ch_tx_intent_waits() - get the number of transmits that had to
+ *				    request an intent from the remote side
+ * @ch_ctx:	pointer to the channel context.
+ *
+ * Return: number of intent requests sent, -EINVAL in case of invalid input
+ */
+int glink_get_ch_tx_intent_waits(struct channel_ctx *ch_ctx)
+{
+	if (ch_ctx == NULL)
+		return -EINVAL;
+
+	return ch_ctx->tx_intent_waits;
+}
+EXPORT_SYMBOL(glink_get_ch_tx_intent_waits);
+
+/**
+ * glink_get_ch_rx_intent_reqs() - get the number of intent requests received
+ *				   from the remote side
+ * @ch_ctx:	pointer to the channel context.
+ *
+ * Return: number of intent requests received, -EINVAL in case of invalid input
+ */
+int glink_get_ch_rx_intent_reqs(struct channel_ctx *ch_ctx)
+{
+	if (ch_ctx == NULL)
+		return -EINVAL;
+
+	return ch_ctx->rx_intent_reqs;
+}
+EXPORT_SYMBOL(glink_get_ch_rx_intent_reqs);
+
 /**
  * glink_get_ch_intent_info() - get the intent details of a channel
  * @ch_ctx:	pointer to the channel context.
@@ -68,6 +68,7 @@ struct glink_core_version {
  * pkt_priv:	G-Link core owned packet-private data
  * list:	G-Link core owned list node
  * bounce_buf:	Pointer to the temporary/internal bounce buffer
+ * pooled:	Intent belongs to the channel's rx intent pool
  */
 struct glink_core_rx_intent {
 	void *data;
@@ -85,6 +86,7 @@ struct glink_core_rx_intent {
 	struct list_head list;
 	const void *pkt_priv;
 	void *bounce_buf;
+	bool pooled;
 };
 
 /**
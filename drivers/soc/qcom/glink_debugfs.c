@@ -298,8 +298,20 @@ static void glink_dfs_update_ch_intent(struct seq_file *s)
  */
 static void glink_dfs_update_ch_stats(struct seq_file *s)
 {
-	/* FUTURE:  add channel statistics */
-	seq_puts(s, "not yet implemented\n");
+	struct glink_dbgfs_data *dfs_d;
+	struct channel_ctx *ch_ctx;
+
+	dfs_d = s->private;
+	ch_ctx = dfs_d->priv_data;
+	if (ch_ctx == NULL)
+		return;
+
+	seq_printf(s, "%-20s|%-10s|%-10s|\n", "INTENT REQUESTS", "TX WAITS",
+						"RX REQS");
+	seq_puts(s, "------------------------------------------\n");
+	seq_printf(s, "%-20s|%-10d|%-10d|\n", glink_get_ch_name(ch_ctx),
+				glink_get_ch_tx_intent_waits(ch_ctx),
+				glink_get_ch_rx_intent_reqs(ch_ctx));
 }
 
 /**
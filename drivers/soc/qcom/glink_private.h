@@ -665,6 +665,24 @@ int glink_get_ch_lintents_queued(struct channel_ctx *ch_ctx);
  */
 int glink_get_ch_rintents_queued(struct channel_ctx *ch_ctx);
 
+/**
+ * glink_get_ch_tx_intent_waits() - get the number of transmits that had to
+ *				    request an intent from the remote side
+ * @ch_ctx:	pointer to the channel context.
+ *
+ * Return: number of intent requests sent, -EINVAL in case of invalid input
+ */
+int glink_get_ch_tx_intent_waits(struct channel_ctx *ch_ctx);
+
+/**
+ * glink_get_ch_rx_intent_reqs() - get the number of intent requests received
+ *				   from the remote side
+ * @ch_ctx:	pointer to the channel context.
+ *
+ * Return: number of intent requests received, -EINVAL in case of invalid input
+ */
+int glink_get_ch_rx_intent_reqs(struct channel_ctx *ch_ctx);
+
 /**
  * glink_get_ch_intent_info() - get the intent details of a channel
  * @ch_ctx:	pointer to the channel context.
@@ -148,6 +148,8 @@ struct mailbox_config_info {
  *				correct irq.
  * @irq_line:			The incoming interrupt line.
  * @tx_irq_count:		Number of interrupts triggered.
+ * @tx_irq_deferred:		Number of data packets whose interrupt was left
+ *				to tx_flush().
  * @rx_irq_count:		Number of interrupts received.
  * @tx_ch_desc:			Reference to the channel description structure
  *				for tx in SMEM for this edge.
@@ -168,6 +170,8 @@ struct mailbox_config_info {
  * @tx_blocked_signal_sent:	Flag to indicate the flush signal has already
  *				been sent, and a response is pending from the
  *				remote side.  Protected by @write_lock.
+ * @tx_irq_pending:		Data was written to @tx_fifo without signalling
+ *				the remote side.  Protected by @write_lock.
  * @kwork:			Work to be executed when an irq is received.
  * @kworker:			Handle to the entity processing of
 				deferred commands.
@@ -197,6 +201,7 @@ struct edge_info {
 	uint32_t out_irq_mask;
 	uint32_t irq_line;
 	uint32_t tx_irq_count;
+	uint32_t tx_irq_deferred;
 	uint32_t rx_irq_count;
 	struct channel_desc *tx_ch_desc;
 	struct channel_desc *rx_ch_desc;
@@ -210,6 +215,7 @@ struct edge_info {
 	wait_queue_head_t tx_blocked_queue;
 	bool tx_resume_needed;
 	bool tx_blocked_signal_sent;
+	bool tx_irq_pending;
 	struct kthread_work kwork;
 	struct kthread_worker kworker;
 	struct task_struct *task;
@@ -253,6 +259,9 @@ static struct glink_core_version versions[] = {
 	{1, TRACER_PKT_FEATURE, negotiate_features_v1},
 };
 
+static bool tx_irq_batching = true;
+module_param(tx_irq_batching, bool, S_IRUGO | S_IWUSR);
+
 /**
  * send_irq() - send an irq to a remote entity as an event signal
  * @einfo:	Which remote entity that should receive the irq.
@@ -533,6 +542,7 @@ static int fifo_write(struct edge_info *einfo, const void *data, int len)
 	len = fifo_write_body(einfo, data, len, &write_index);
 	einfo->tx_ch_desc->write_index = write_index;
 	send_irq(einfo);
+	einfo->tx_irq_pending = false;
 
 	return orig_len - len;
 }
@@ -552,6 +562,8 @@ static int fifo_write(struct edge_info *einfo, const void *data, int len)
  * This prevents the tx() usecase from calling fifo_write() multiple times.  The
  * alternative would be an allocation and additional memcpy to create a buffer
  * to copy all the data segments into one location before calling fifo_write().
+ * Unlike fifo_write(), the remote side is not signalled, the caller decides
+ * whether to do it now or leave it to tx_flush().
  *
  * Return: Number of bytes written to the edge.
  */
@@ -567,7 +579,6 @@ static int fifo_write_complex(struct edge_info *einfo,
 	len2 = fifo_write_body(einfo, data2, len2, &write_index);
 	len3 = fifo_write_body(einfo, data3, len3, &write_index);
 	einfo->tx_ch_desc->write_index = write_index;
-	send_irq(einfo);
 
 	return orig_len - len1 - len2 - len3;
 }
@@ -1483,6 +1494,7 @@ static int ssr(struct glink_transport_if *if_ptr)
 
 	einfo->tx_resume_needed = false;
 	einfo->tx_blocked_signal_sent = false;
+	einfo->tx_irq_pending = false;
 	einfo->rx_fifo = NULL;
 	einfo->rx_fifo_size = 0;
 	einfo->tx_ch_desc->write_index = 0;
@@ -1966,6 +1978,19 @@ static int tx_data(struct glink_transport_if *if_ptr, uint16_t cmd_id,
 
 	fifo_write_complex(einfo, &cmd, sizeof(cmd), data_start, size, zeros,
 								zeros_size);
+	/*
+	 * Batch the interrupt with the rest of the scheduler pass unless the
+	 * channel asked not to, or the remote side should start draining the
+	 * fifo already.
+	 */
+	if (!tx_irq_batching || pctx->low_latency ||
+	    fifo_write_avail(einfo) < einfo->tx_fifo_size / 2) {
+		send_irq(einfo);
+		einfo->tx_irq_pending = false;
+	} else {
+		einfo->tx_irq_pending = true;
+		einfo->tx_irq_deferred++;
+	}
 	GLINK_DBG("%s %s: lcid[%u] riid[%u] cmd[%d], size[%d], size_left[%d]\n",
 		"<SMEM>", __func__, cmd.lcid, cmd.riid, cmd.id, cmd.size,
 		cmd.size_left);
@@ -2012,6 +2037,28 @@ static int tx_cmd_tracer_pkt(struct glink_transport_if *if_ptr, uint32_t lcid,
 	return tx_data(if_ptr, TRACER_PKT_CMD, lcid, pctx);
 }
 
+/**
+ * tx_flush() - signal the remote side of data batched by tx_data()
+ * @if_ptr:	The transport to flush.
+ *
+ * Called by the core at the end of each transmit pass, so that all the packets
+ * written during the pass are covered by a single interrupt.
+ */
+static void tx_flush(struct glink_transport_if *if_ptr)
+{
+	struct edge_info *einfo;
+	unsigned long flags;
+
+	einfo = container_of(if_ptr, struct edge_info, xprt_if);
+
+	spin_lock_irqsave(&einfo->write_lock, flags);
+	if (einfo->tx_irq_pending && !einfo->in_ssr) {
+		send_irq(einfo);
+		einfo->tx_irq_pending = false;
+	}
+	spin_unlock_irqrestore(&einfo->write_lock, flags);
+}
+
 /**
  * get_power_vote_ramp_time() - Get the ramp time required for the power
  *				votes to be applied
@@ -2102,6 +2149,7 @@ static void init_xprt_if(struct edge_info *einfo)
 	einfo->xprt_if.get_power_vote_ramp_time = get_power_vote_ramp_time;
 	einfo->xprt_if.power_vote = power_vote;
 	einfo->xprt_if.power_unvote = power_unvote;
+	einfo->xprt_if.tx_flush = tx_flush;
 }
 
 /**
@@ -2940,10 +2988,12 @@ ID|EDGE      |TX READ   |TX WRITE  |TX SIZE   |RX READ   |RX WRITE  |RX SIZE
 						einfo->rx_fifo_size);
 
 	seq_puts(s, "\nInterrupt information:\n");
-	seq_printf(s, "%-10s|%-10s|%-10s\n", "EDGE", "TX INT", "RX INT");
-	seq_puts(s, "--------------------------------\n");
-	seq_printf(s, "%-10s|0x%08X|0x%08X\n", einfo->xprt_cfg.edge,
+	seq_printf(s, "%-10s|%-10s|%-10s|%-10s\n", "EDGE", "TX INT",
+						"TX BATCHED", "RX INT");
+	seq_puts(s, "-------------------------------------------\n");
+	seq_printf(s, "%-10s|0x%08X|0x%08X|0x%08X\n", einfo->xprt_cfg.edge,
 						einfo->tx_irq_count,
+						einfo->tx_irq_deferred,
 						einfo->rx_irq_count);
 }
 
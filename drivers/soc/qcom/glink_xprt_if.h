@@ -54,6 +54,8 @@ enum xprt_ids {
  * @size_remaining:	Remaining size of the data in the packet.
  * @intent_size:	Receive intent size queued by the remote side.
  * @tracer_pkt:		Flag to indicate if the packet is a tracer packet.
+ * @low_latency:	Flag to signal the remote side as soon as the packet is
+ *			written, instead of batching it with later packets.
  * @iovec:		Pointer to the vector buffer packet.
  * @vprovider:		Packet-specific virtual buffer provider function.
  * @pprovider:		Packet-specific physical buffer provider function.
@@ -72,6 +74,7 @@ struct glink_core_tx_pkt {
 	uint32_t size_remaining;
 	size_t intent_size;
 	bool tracer_pkt;
+	bool low_latency;
 	void *iovec;
 	void * (*vprovider)(void *iovec, size_t offset, size_t *size);
 	void * (*pprovider)(void *iovec, size_t offset, size_t *size);
@@ -141,6 +144,7 @@ struct glink_transport_if {
 			struct glink_transport_if *if_ptr, uint32_t state);
 	int (*power_vote)(struct glink_transport_if *if_ptr, uint32_t state);
 	int (*power_unvote)(struct glink_transport_if *if_ptr);
+	void (*tx_flush)(struct glink_transport_if *if_ptr);
 	/*
 	 * Keep data pointers at the end of the structure after all function
 	 * pointer to allow for in-place initialization.
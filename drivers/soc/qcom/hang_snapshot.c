@@ -0,0 +1,221 @@
+/* Copyright (c) 2016, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <linux/kernel.h>
+#include <linux/cpumask.h>
+#include <linux/debugfs.h>
+#include <linux/fs.h>
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/sched.h>
+#include <linux/seq_file.h>
+#include <linux/spinlock.h>
+#include <linux/stacktrace.h>
+#include <linux/string.h>
+#include <soc/qcom/hang_snapshot.h>
+
+#define HANG_SNAP_NR		4
+#define HANG_SNAP_DEPTH		16
+#define HANG_SNAP_REASON_LEN	32
+#define HANG_SNAP_EXTRA_LEN	512
+
+struct hang_snap_cpu {
+	struct sched_cpu_snapshot sched;
+	bool online;
+	bool stalled;
+	u64 recovered_ns;	/* 0 until the stalled cpu came back */
+	unsigned int nr_entries;
+	unsigned long stack[HANG_SNAP_DEPTH];
+};
+
+struct hang_snap {
+	u32 seq;
+	u64 ts_ns;
+	u64 stall_ns;
+	char reason[HANG_SNAP_REASON_LEN];
+	struct hang_snap_cpu cpu[NR_CPUS];
+	char extra[HANG_SNAP_EXTRA_LEN];
+};
+
+/*
+ * Static, so that nothing has to be allocated at the worst possible time
+ * and so that the last snapshots can still be pulled out of a ramdump if
+ * the stall did end in a watchdog bite after all.
+ */
+static struct hang_snap hang_snaps[HANG_SNAP_NR];
+static u32 hang_snap_seq;
+static struct hang_snap *hang_snap_cur;
+static struct cpumask hang_snap_pending;
+static DEFINE_SPINLOCK(hang_snap_lock);
+static ATOMIC_NOTIFIER_HEAD(hang_snap_notifier);
+
+int hang_snapshot_take(const char *reason, const struct cpumask *stalled,
+		       u64 stall_ns)
+{
+	struct hang_snapshot_buf b;
+	struct hang_snap *s;
+	unsigned long flags;
+	int cpu, seq;
+
+	spin_lock_irqsave(&hang_snap_lock, flags);
+	s = &hang_snaps[hang_snap_seq % HANG_SNAP_NR];
+	memset(s, 0, sizeof(*s));
+	seq = s->seq = ++hang_snap_seq;
+	s->ts_ns = sched_clock();
+	s->stall_ns = stall_ns;
+	strlcpy(s->reason, reason, sizeof(s->reason));
+
+	for_each_online_cpu(cpu) {
+		struct hang_snap_cpu *c = &s->cpu[cpu];
+
+		c->online = true;
+		c->stalled = stalled && cpumask_test_cpu(cpu, stalled);
+		sched_cpu_snapshot(cpu, &c->sched);
+	}
+
+	hang_snap_cur = s;
+	if (stalled)
+		cpumask_and(&hang_snap_pending, stalled, cpu_online_mask);
+	else
+		cpumask_clear(&hang_snap_pending);
+
+	b.buf = s->extra;
+	b.size = sizeof(s->extra);
+	b.len = 0;
+	atomic_notifier_call_chain(&hang_snap_notifier, 0, &b);
+	spin_unlock_irqrestore(&hang_snap_lock, flags);
+
+	return seq;
+}
+EXPORT_SYMBOL(hang_snapshot_take);
+
+void hang_snapshot_cpu_recovered(void)
+{
+	int cpu = smp_processor_id();
+	struct hang_snap_cpu *c;
+	struct stack_trace trace;
+	unsigned long flags;
+
+	if (likely(!cpumask_test_cpu(cpu, &hang_snap_pending)))
+		return;
+
+	spin_lock_irqsave(&hang_snap_lock, flags);
+	if (!cpumask_test_and_clear_cpu(cpu, &hang_snap_pending))
+		goto out;
+
+	c = &hang_snap_cur->cpu[cpu];
+	c->recovered_ns = sched_clock();
+	trace.nr_entries = 0;
+	trace.max_entries = HANG_SNAP_DEPTH;
+	trace.entries = c->stack;
+	trace.skip = 1;
+	save_stack_trace(&trace);
+	c->nr_entries = trace.nr_entries;
+out:
+	spin_unlock_irqrestore(&hang_snap_lock, flags);
+}
+EXPORT_SYMBOL(hang_snapshot_cpu_recovered);
+
+int hang_snapshot_register_notifier(struct notifier_block *nb)
+{
+	return atomic_notifier_chain_register(&hang_snap_notifier, nb);
+}
+EXPORT_SYMBOL(hang_snapshot_register_notifier);
+
+int hang_snapshot_unregister_notifier(struct notifier_block *nb)
+{
+	return atomic_notifier_chain_unregister(&hang_snap_notifier, nb);
+}
+EXPORT_SYMBOL(hang_snapshot_unregister_notifier);
+
+static void hang_snap_print_ns(struct seq_file *m, const char *name, u64 ns)
+{
+	unsigned long rem = do_div(ns, NSEC_PER_SEC);
+
+	seq_printf(m, " %s %llu.%06lu", name, ns, rem / NSEC_PER_USEC);
+}
+
+static void hang_snap_show_one(struct seq_file *m, struct hang_snap *s)
+{
+	int cpu;
+	unsigned int i;
+
+	seq_printf(m, "snapshot %u:", s->seq);
+	hang_snap_print_ns(m, "at", s->ts_ns);
+	seq_printf(m, " reason %s stall_ms %llu\n", s->reason,
+		   div_u64(s->stall_ns, NSEC_PER_MSEC));
+
+	for_each_possible_cpu(cpu) {
+		struct hang_snap_cpu *c = &s->cpu[cpu];
+
+		if (!c->online) {
+			seq_printf(m, "  cpu%d: offline\n", cpu);
+			continue;
+		}
+		seq_printf(m, "  cpu%d:%s curr %s/%d prio %d", cpu,
+			   c->stalled ? " STALLED" : "", c->sched.comm,
+			   c->sched.pid, c->sched.prio);
+		seq_printf(m, " nr_running %u rt %u", c->sched.nr_running,
+			   c->sched.rt_nr_running);
+		hang_snap_print_ns(m, "clock", c->sched.clock);
+		hang_snap_print_ns(m, "exec_start", c->sched.exec_start);
+		seq_puts(m, "\n");
+
+		if (!c->stalled)
+			continue;
+		if (!c->recovered_ns) {
+			seq_puts(m, "    not recovered\n");
+			continue;
+		}
+		seq_printf(m, "    recovered %llu ms later at:\n",
+			   div_u64(c->recovered_ns - s->ts_ns, NSEC_PER_MSEC));
+		for (i = 0; i < c->nr_entries; i++)
+			seq_printf(m, "      %pS\n", (void *)c->stack[i]);
+	}
+
+	if (s->extra[0])
+		seq_printf(m, "%s", s->extra);
+}
+
+static int hang_snap_show(struct seq_file *m, void *unused)
+{
+	u32 seq = ACCESS_ONCE(hang_snap_seq);
+	u32 i = seq > HANG_SNAP_NR ? seq - HANG_SNAP_NR : 0;
+
+	/* may race with a new snapshot, which is harmless to print */
+	for (; i < seq; i++)
+		hang_snap_show_one(m, &hang_snaps[i % HANG_SNAP_NR]);
+	return 0;
+}
+
+static int hang_snap_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, hang_snap_show, NULL);
+}
+
+static const struct file_operations hang_snap_fops = {
+	.open		= hang_snap_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init hang_snapshot_init(void)
+{
+	if (!debugfs_create_file("hang_snapshot", S_IRUSR, NULL, NULL,
+				 &hang_snap_fops)) {
+		pr_err("hang_snapshot: Could not create debugfs file\n");
+		return -ENODEV;
+	}
+	return 0;
+}
+late_initcall(hang_snapshot_init);
@@ -25,6 +25,7 @@
 #include <linux/module.h>
 #include <linux/input.h>
 #include <linux/kthread.h>
+#include <soc/qcom/memlat.h>
 
 static unsigned int use_input_evts_with_hi_slvt_detect;
 static struct mutex managed_cpus_lock;
@@ -46,6 +47,9 @@ struct cluster {
 	spinlock_t iowait_lock;
 	unsigned int cur_io_busy;
 	bool io_change;
+	/* Stalls, protected by iowait_lock */
+	u64 last_stall_check_ts;
+	unsigned int stall_bound;
 	/* CPU */
 	unsigned int mode;
 	bool mode_change;
@@ -146,6 +150,7 @@ static unsigned int workload_detect;
 #define IO_DETECT	1
 #define MODE_DETECT	2
 #define PERF_CL_PEAK_DETECT	4
+#define STALL_DETECT	8
 
 
 /* IOwait related tunables */
@@ -155,6 +160,14 @@ static u64 iowait_ceiling_pct = 25;
 static u64 iowait_floor_pct = 8;
 #define LAST_IO_CHECK_TOL	(3 * USEC_PER_MSEC)
 
+/*
+ * Stall related tunables. A cluster whose CPUs are all waiting on IO, or are
+ * stalled on memory, would not get any faster with more CPUs online.
+ */
+static unsigned int mem_stall_pct = 40;
+#define STALL_IO	1
+#define STALL_MEM	2
+
 static unsigned int aggr_iobusy;
 static unsigned int aggr_mode;
 
@@ -1383,6 +1396,31 @@ static const struct kernel_param_ops param_ops_iowait_ceiling_pct = {
 };
 device_param_cb(iowait_ceiling_pct, &param_ops_iowait_ceiling_pct, NULL, 0644);
 
+static int set_mem_stall_pct(const char *buf, const struct kernel_param *kp)
+{
+	unsigned int val;
+
+	if (sscanf(buf, "%u\n", &val) != 1)
+		return -EINVAL;
+	if (val > 100)
+		return -EINVAL;
+
+	mem_stall_pct = val;
+
+	return 0;
+}
+
+static int get_mem_stall_pct(char *buf, const struct kernel_param *kp)
+{
+	return snprintf(buf, PAGE_SIZE, "%u", mem_stall_pct);
+}
+
+static const struct kernel_param_ops param_ops_mem_stall_pct = {
+	.set = set_mem_stall_pct,
+	.get = get_mem_stall_pct,
+};
+device_param_cb(mem_stall_pct, &param_ops_mem_stall_pct, NULL, 0644);
+
 static int set_workload_detect(const char *buf, const struct kernel_param *kp)
 {
 	unsigned int val, i;
@@ -1435,6 +1473,17 @@ static int set_workload_detect(const char *buf, const struct kernel_param *kp)
 		}
 	}
 
+	if (!(workload_detect & STALL_DETECT)) {
+		for (i = 0; i < num_clusters; i++) {
+			i_cl = managed_clusters[i];
+			spin_lock_irqsave(&i_cl->iowait_lock, flags);
+			i_cl->stall_bound = 0;
+			spin_unlock_irqrestore(&i_cl->iowait_lock, flags);
+		}
+		/* Bring up any CPUs held back while clusters were stalled */
+		schedule_delayed_work(&evaluate_hotplug_work, 0);
+	}
+
 	wake_up_process(notify_thread);
 	return 0;
 }
@@ -1770,6 +1819,66 @@ static void check_cluster_iowait(struct cluster *cl, u64 now)
 		wake_up_process(notify_thread);
 }
 
+/*
+ * Track whether the cluster is bound by IO or memory stalls rather than by
+ * CPU, in which case onlining more of its CPUs would not help. IO-bound means
+ * the IO busy detection above has triggered or every online CPU has a task
+ * waiting on IO, the condition WALT accounts as busy time. Memory-bound means
+ * the memlat monitors report a high average backend stall, or every monitored
+ * CPU being below the memlat instructions-per-miss ceiling.
+ */
+static void check_cluster_stall(struct cluster *cl, u64 now)
+{
+	unsigned int cpu, nr_online = 0, nr_iowait = 0, nr_stats = 0;
+	unsigned int stall_pct, stall_sum = 0, mem_bound_cpus = 0;
+	unsigned int prev_stall_bound, stall_bound = 0;
+	unsigned long flags;
+	bool mem_bound;
+
+	spin_lock_irqsave(&cl->iowait_lock, flags);
+
+	if (((now - cl->last_stall_check_ts)
+		< (cl->timer_rate - LAST_IO_CHECK_TOL)) ||
+		!(workload_detect & STALL_DETECT)) {
+		spin_unlock_irqrestore(&cl->iowait_lock, flags);
+		return;
+	}
+
+	for_each_cpu(cpu, cl->cpus) {
+		if (!cpu_online(cpu))
+			continue;
+		nr_online++;
+		if (nr_iowait_cpu(cpu))
+			nr_iowait++;
+		if (memlat_get_cpu_stall(cpu, &stall_pct, &mem_bound))
+			continue;
+		nr_stats++;
+		stall_sum += stall_pct;
+		if (mem_bound)
+			mem_bound_cpus++;
+	}
+
+	if (cl->cur_io_busy || (nr_online && nr_iowait == nr_online))
+		stall_bound |= STALL_IO;
+	stall_pct = nr_stats ? stall_sum / nr_stats : 0;
+	if (nr_stats && (stall_pct >= mem_stall_pct
+				|| mem_bound_cpus == nr_stats))
+		stall_bound |= STALL_MEM;
+
+	prev_stall_bound = cl->stall_bound;
+	cl->stall_bound = stall_bound;
+	cl->last_stall_check_ts = now;
+	trace_track_stall(cpumask_first(cl->cpus), cl->cur_io_busy, nr_iowait,
+			nr_online, stall_pct, mem_bound_cpus, stall_bound);
+
+	spin_unlock_irqrestore(&cl->iowait_lock, flags);
+
+	/* Bring up the CPUs held back while the cluster was stalled */
+	if (prev_stall_bound && !stall_bound && cl->max_cpu_request > 0 &&
+		num_online_managed(cl->cpus) < cl->max_cpu_request)
+		schedule_delayed_work(&evaluate_hotplug_work, 0);
+}
+
 static void disable_timer(struct cluster *cl)
 {
 	unsigned long flags;
@@ -1925,9 +2034,41 @@ static void  msm_perf_input_disconnect(struct input_handle *handle)
 	kfree(handle);
 }
 
+/*
+ * A touch IRQ means more input is coming: keep the perf cluster peak mode
+ * instead of letting it expire while the touch data is being read.
+ */
+static int msm_perf_interaction_notify(struct notifier_block *nb,
+				       unsigned long val, void *data)
+{
+	struct cluster *cl;
+	unsigned long flags;
+	unsigned int i;
+
+	if (!clusters_inited)
+		return NOTIFY_DONE;
+
+	for (i = 0; i < num_clusters; i++) {
+		cl = managed_clusters[i];
+		spin_lock_irqsave(&cl->perf_cl_peak_lock, flags);
+		if (cl->perf_cl_peak & PERF_CL_PEAK) {
+			cl->perf_cl_peak_exit_cycle_cnt = 0;
+			disable_perf_cl_peak_timer(cl);
+		}
+		spin_unlock_irqrestore(&cl->perf_cl_peak_lock, flags);
+	}
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block msm_perf_interaction_nb = {
+	.notifier_call = msm_perf_interaction_notify,
+};
+
 static void unregister_input_handler(void)
 {
 	if (handler != NULL) {
+		input_unregister_interaction_notifier(&msm_perf_interaction_nb);
 		input_unregister_handler(handler);
 		input_events_handler_registered = false;
 	}
@@ -1954,6 +2095,7 @@ static int register_input_handler(void)
 		kfree(handler);
 	} else {
 		input_events_handler_registered = true;
+		input_register_interaction_notifier(&msm_perf_interaction_nb);
 	}
 	return rc;
 }
@@ -2181,6 +2323,7 @@ static void check_workload_stats(unsigned int cpu, unsigned int rate, u64 now)
 
 	cl->timer_rate = rate;
 	check_cluster_iowait(cl, now);
+	check_cluster_stall(cl, now);
 	check_cpu_load(cl, now);
 	check_perf_cl_peak_load(cl, now);
 }
@@ -2393,6 +2536,18 @@ static void __ref try_hotplug(struct cluster *data)
 				break;
 		}
 	} else {
+		/*
+		 * More CPUs would not help a stalled cluster. Keep what is
+		 * online until the stall clears.
+		 */
+		if (data->stall_bound && num_online_managed(data->cpus)) {
+			trace_hotplug_stall_gated(cpumask_bits(data->cpus)[0],
+				num_online_managed(data->cpus),
+				data->max_cpu_request, data->stall_bound);
+			mutex_unlock(&managed_cpus_lock);
+			return;
+		}
+
 		for_each_cpu(i, data->cpus) {
 			if (cpu_online(i))
 				continue;
@@ -29,6 +29,9 @@
 #include <linux/tick.h>
 #include <asm/smp_plat.h>
 #include <linux/suspend.h>
+#include <linux/miscdevice.h>
+#include <linux/mm.h>
+#include <linux/fs.h>
 
 #define MAX_LONG_SIZE 24
 #define DEFAULT_RQ_POLL_JIFFIES 1
@@ -337,6 +340,63 @@ static int init_rq_attribs(void)
 	return err;
 }
 
+static void rq_stats_vm_open(struct vm_area_struct *vma)
+{
+	sched_rq_stats_page_get();
+}
+
+static void rq_stats_vm_close(struct vm_area_struct *vma)
+{
+	sched_rq_stats_page_put();
+}
+
+static const struct vm_operations_struct rq_stats_vm_ops = {
+	.open = rq_stats_vm_open,
+	.close = rq_stats_vm_close,
+};
+
+/*
+ * Map the scheduler's run-queue statistics page read-only so that
+ * userspace can sample it without going through sysfs.
+ */
+static int rq_stats_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct page *page;
+	int ret;
+
+	if (vma->vm_pgoff || vma->vm_end - vma->vm_start > PAGE_SIZE)
+		return -EINVAL;
+
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+	vma->vm_flags &= ~VM_MAYWRITE;
+
+	page = sched_rq_stats_page_get();
+	if (!page)
+		return -ENODEV;
+
+	ret = remap_pfn_range(vma, vma->vm_start, page_to_pfn(page),
+			      PAGE_SIZE, vma->vm_page_prot);
+	if (ret) {
+		sched_rq_stats_page_put();
+		return ret;
+	}
+
+	vma->vm_ops = &rq_stats_vm_ops;
+	return 0;
+}
+
+static const struct file_operations rq_stats_fops = {
+	.owner = THIS_MODULE,
+	.mmap = rq_stats_mmap,
+};
+
+static struct miscdevice rq_stats_misc = {
+	.minor = MISC_DYNAMIC_MINOR,
+	.name = "rq_stats",
+	.fops = &rq_stats_fops,
+};
+
 static int __init msm_rq_stats_init(void)
 {
 	int ret;
@@ -378,6 +438,9 @@ static int __init msm_rq_stats_init(void)
 					CPUFREQ_TRANSITION_NOTIFIER);
 	register_hotcpu_notifier(&cpu_hotplug);
 
+	if (misc_register(&rq_stats_misc))
+		pr_err("rq_stats: failed to register misc device\n");
+
 	return ret;
 }
 late_initcall(msm_rq_stats_init);
@@ -32,9 +32,12 @@
 #include <linux/of_address.h>
 #include <linux/io.h>
 #include <linux/dma-mapping.h>
+#include <linux/ktime.h>
+#include <linux/vmalloc.h>
 #include <soc/qcom/ramdump.h>
 #include <soc/qcom/subsystem_restart.h>
 #include <soc/qcom/secure_buffer.h>
+#include <soc/qcom/boot_timeline.h>
 
 #include <asm/uaccess.h>
 #include <asm/setup.h>
@@ -66,6 +69,7 @@ static int proxy_timeout_ms = -1;
 module_param(proxy_timeout_ms, int, S_IRUGO | S_IWUSR);
 
 static bool disable_timeouts;
+static struct workqueue_struct *pil_wq;
 static const char firmware_error_msg[] = "firmware_error\n";
 /**
  * struct pil_mdt - Representation of <name>.mdt file in memory
@@ -113,6 +117,13 @@ struct pil_seg {
  * non-relocatable images
  * @region: region allocated for relocatable images
  * @unvoted_flag: flag to keep track if we have unvoted or not.
+ * @fw_cache_lock: held while a boot uses the firmware cache
+ * @fw_cache_mdt: metadata of the image the cached blobs belong to
+ * @fw_cache_mdt_size: size of @fw_cache_mdt
+ * @fw_cache: cached copy of each blob, indexed by segment number
+ * @fw_cache_nr: number of entries in @fw_cache
+ * @fw_cache_bytes: bytes of blob data held in @fw_cache
+ * @fw_cache_list: entry in pil_fw_cache_list
  *
  * This struct contains data for a pil_desc that should not be exposed outside
  * of this file. This structure points to the descriptor and the descriptor
@@ -134,6 +145,13 @@ struct pil_priv {
 	int id;
 	int unvoted_flag;
 	size_t region_size;
+	struct mutex fw_cache_lock;
+	void *fw_cache_mdt;
+	size_t fw_cache_mdt_size;
+	void **fw_cache;
+	int fw_cache_nr;
+	unsigned long fw_cache_bytes;
+	struct list_head fw_cache_list;
 };
 
 /**
@@ -657,6 +675,175 @@ static void unmap_fw_mem(void *vaddr, size_t size, void *data)
 	dma_unremap(info->dev, vaddr, size);
 }
 
+static LIST_HEAD(pil_fw_cache_list);
+static DEFINE_MUTEX(pil_fw_cache_list_lock);
+
+/* Called with fw_cache_lock held */
+static void pil_fw_cache_free(struct pil_priv *priv)
+{
+	int i;
+
+	if (priv->fw_cache) {
+		for (i = 0; i < priv->fw_cache_nr; i++)
+			vfree(priv->fw_cache[i]);
+		kfree(priv->fw_cache);
+	}
+	kfree(priv->fw_cache_mdt);
+	priv->fw_cache = NULL;
+	priv->fw_cache_nr = 0;
+	priv->fw_cache_mdt = NULL;
+	priv->fw_cache_mdt_size = 0;
+	priv->fw_cache_bytes = 0;
+}
+
+/*
+ * Blobs cached by an earlier boot are reused only if the metadata read from
+ * storage is unchanged. It carries the hash of every segment, so an identical
+ * .mdt means identical blobs. The cache stays locked until pil_fw_cache_put().
+ */
+static void pil_fw_cache_get(struct pil_desc *desc, const struct firmware *fw,
+			     int nr)
+{
+	struct pil_priv *priv = desc->priv;
+
+	if (!desc->fw_cache)
+		return;
+
+	mutex_lock(&priv->fw_cache_lock);
+	if (priv->fw_cache && priv->fw_cache_mdt_size == fw->size &&
+	    !memcmp(priv->fw_cache_mdt, fw->data, fw->size))
+		return;
+
+	pil_fw_cache_free(priv);
+	priv->fw_cache_mdt = kmemdup(fw->data, fw->size, GFP_KERNEL);
+	priv->fw_cache = kcalloc(nr, sizeof(*priv->fw_cache), GFP_KERNEL);
+	if (!priv->fw_cache_mdt || !priv->fw_cache) {
+		pil_fw_cache_free(priv);
+		return;
+	}
+	priv->fw_cache_mdt_size = fw->size;
+	priv->fw_cache_nr = nr;
+}
+
+/* Drop the cache if the image failed to boot, it may hold a bad blob */
+static void pil_fw_cache_put(struct pil_desc *desc, int ret)
+{
+	struct pil_priv *priv = desc->priv;
+	unsigned long bytes = 0;
+	struct pil_seg *seg;
+
+	if (!desc->fw_cache)
+		return;
+
+	if (ret) {
+		pil_fw_cache_free(priv);
+	} else if (priv->fw_cache) {
+		list_for_each_entry(seg, &priv->segs, list)
+			if (seg->num < priv->fw_cache_nr &&
+			    priv->fw_cache[seg->num])
+				bytes += seg->filesz;
+		priv->fw_cache_bytes = bytes;
+	}
+	mutex_unlock(&priv->fw_cache_lock);
+}
+
+static void **pil_fw_cache_slot(struct pil_desc *desc, struct pil_seg *seg)
+{
+	struct pil_priv *priv = desc->priv;
+
+	if (!desc->fw_cache || !priv->fw_cache || seg->num >= priv->fw_cache_nr)
+		return NULL;
+
+	return &priv->fw_cache[seg->num];
+}
+
+static int pil_fw_cache_copy(struct pil_desc *desc, struct pil_seg *seg,
+			     void *blob, bool to_region, void *map_data)
+{
+	unsigned long off;
+	size_t size;
+	void *buf;
+
+	for (off = 0; off < seg->filesz; off += size) {
+		size = min_t(size_t, IOMAP_SIZE, seg->filesz - off);
+		buf = desc->map_fw_mem(seg->paddr + off, size, map_data);
+		if (!buf) {
+			pil_err(desc, "Failed to map memory\n");
+			return -ENOMEM;
+		}
+		if (to_region)
+			memcpy(buf, blob + off, size);
+		else
+			memcpy(blob + off, buf, size);
+		desc->unmap_fw_mem(buf, size, map_data);
+	}
+
+	return 0;
+}
+
+static void *pil_fw_cache_store(struct pil_desc *desc, struct pil_seg *seg,
+				void *map_data)
+{
+	void *blob;
+
+	blob = __vmalloc(seg->filesz, GFP_KERNEL | __GFP_HIGHMEM |
+			 __GFP_NOWARN, PAGE_KERNEL);
+	if (!blob)
+		return NULL;
+
+	if (pil_fw_cache_copy(desc, seg, blob, false, map_data)) {
+		vfree(blob);
+		return NULL;
+	}
+
+	return blob;
+}
+
+static unsigned long pil_fw_cache_count(struct shrinker *shrinker,
+					struct shrink_control *sc)
+{
+	struct pil_priv *priv;
+	unsigned long pages = 0;
+
+	mutex_lock(&pil_fw_cache_list_lock);
+	list_for_each_entry(priv, &pil_fw_cache_list, fw_cache_list)
+		pages += ACCESS_ONCE(priv->fw_cache_bytes) >> PAGE_SHIFT;
+	mutex_unlock(&pil_fw_cache_list_lock);
+
+	return pages;
+}
+
+/* Caches in use by a boot are skipped, they are only dropped as a whole */
+static unsigned long pil_fw_cache_scan(struct shrinker *shrinker,
+				       struct shrink_control *sc)
+{
+	struct pil_priv *priv;
+	unsigned long freed = 0;
+
+	mutex_lock(&pil_fw_cache_list_lock);
+	list_for_each_entry(priv, &pil_fw_cache_list, fw_cache_list) {
+		if (freed >= sc->nr_to_scan)
+			break;
+		if (!mutex_trylock(&priv->fw_cache_lock))
+			continue;
+		if (priv->fw_cache_bytes) {
+			pil_info(priv->desc, "Dropping cached firmware\n");
+			freed += priv->fw_cache_bytes >> PAGE_SHIFT;
+			pil_fw_cache_free(priv);
+		}
+		mutex_unlock(&priv->fw_cache_lock);
+	}
+	mutex_unlock(&pil_fw_cache_list_lock);
+
+	return freed ? freed : SHRINK_STOP;
+}
+
+static struct shrinker pil_fw_cache_shrinker = {
+	.count_objects = pil_fw_cache_count,
+	.scan_objects = pil_fw_cache_scan,
+	.seeks = DEFAULT_SEEKS,
+};
+
 static int pil_load_seg(struct pil_desc *desc, struct pil_seg *seg)
 {
 	int ret = 0, count;
@@ -670,8 +857,13 @@ static int pil_load_seg(struct pil_desc *desc, struct pil_seg *seg)
 		.dev = desc->dev,
 	};
 	void *map_data = desc->map_data ? desc->map_data : &map_fw_info;
+	void **blob = pil_fw_cache_slot(desc, seg);
 
-	if (seg->filesz) {
+	if (seg->filesz && blob && *blob) {
+		ret = pil_fw_cache_copy(desc, seg, *blob, true, map_data);
+		if (ret)
+			return ret;
+	} else if (seg->filesz) {
 		snprintf(fw_name, ARRAY_SIZE(fw_name), "%s.b%02d",
 				desc->fw_name, num);
 		ret = request_firmware_into_buf(fw_name, desc->dev, seg->paddr,
@@ -691,6 +883,9 @@ static int pil_load_seg(struct pil_desc *desc, struct pil_seg *seg)
 			return -EPERM;
 		}
 		ret = 0;
+
+		if (blob)
+			*blob = pil_fw_cache_store(desc, seg, map_data);
 	}
 
 	/* Zero out trailing memory */
@@ -714,10 +909,18 @@ static int pil_load_seg(struct pil_desc *desc, struct pil_seg *seg)
 		paddr += size;
 	}
 
+	return ret;
+}
+
+static int pil_verify_seg(struct pil_desc *desc, struct pil_seg *seg)
+{
+	int ret = 0;
+
 	if (desc->ops->verify_blob) {
 		ret = desc->ops->verify_blob(desc, seg->paddr, seg->sz);
 		if (ret) {
-			pil_err(desc, "Blob%u failed verification\n", num);
+			pil_err(desc, "Blob%u failed verification\n",
+				seg->num);
 			subsys_set_error(desc->subsys_dev, firmware_error_msg);
 		}
 	}
@@ -725,6 +928,84 @@ static int pil_load_seg(struct pil_desc *desc, struct pil_seg *seg)
 	return ret;
 }
 
+/**
+ * struct pil_seg_data - state of a segment loaded from pil_wq
+ * @desc: descriptor the segment belongs to
+ * @seg: segment to load
+ * @work: work item loading the segment
+ * @ret: result of pil_load_seg()
+ */
+struct pil_seg_data {
+	struct pil_desc *desc;
+	struct pil_seg *seg;
+	struct work_struct work;
+	int ret;
+};
+
+static void pil_load_seg_work_fn(struct work_struct *work)
+{
+	struct pil_seg_data *data = container_of(work, struct pil_seg_data,
+						 work);
+
+	data->ret = pil_load_seg(data->desc, data->seg);
+}
+
+/*
+ * Segments are independent, so their blobs are read and copied into the
+ * region in parallel. verify_blob() has to see the segments in order, so
+ * each one is verified as soon as it and all segments before it are loaded,
+ * overlapping verification with the loads still in flight.
+ */
+static int pil_load_segs(struct pil_desc *desc)
+{
+	struct pil_priv *priv = desc->priv;
+	struct pil_seg_data *data;
+	struct pil_seg *seg;
+	int i, num_segs = 0, ret = 0;
+
+	if (!pil_wq || desc->sequential_loading)
+		goto sequential;
+
+	list_for_each_entry(seg, &priv->segs, list)
+		num_segs++;
+
+	data = kcalloc(num_segs, sizeof(*data), GFP_KERNEL);
+	if (!data)
+		goto sequential;
+
+	i = 0;
+	list_for_each_entry(seg, &priv->segs, list) {
+		data[i].desc = desc;
+		data[i].seg = seg;
+		INIT_WORK(&data[i].work, pil_load_seg_work_fn);
+		queue_work(pil_wq, &data[i].work);
+		i++;
+	}
+
+	/* Wait for every load, even after an error, as they use the region */
+	for (i = 0; i < num_segs; i++) {
+		flush_work(&data[i].work);
+		if (!ret)
+			ret = data[i].ret;
+		if (!ret)
+			ret = pil_verify_seg(desc, data[i].seg);
+	}
+
+	kfree(data);
+	return ret;
+
+sequential:
+	list_for_each_entry(seg, &priv->segs, list) {
+		ret = pil_load_seg(desc, seg);
+		if (!ret)
+			ret = pil_verify_seg(desc, seg);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
 static int pil_parse_devicetree(struct pil_desc *desc)
 {
 	struct device_node *ofnode = desc->dev->of_node;
@@ -733,6 +1014,10 @@ static int pil_parse_devicetree(struct pil_desc *desc)
 	if (!ofnode)
 		return -EINVAL;
 
+	desc->sequential_loading = of_property_read_bool(ofnode,
+						"qcom,sequential-fw-load");
+	desc->fw_cache = of_property_read_bool(ofnode, "qcom,fw-cache");
+
 	if (of_property_read_u32(ofnode, "qcom,mem-protect-id",
 					&desc->subsys_vmid))
 		pr_debug("Unable to read the addr-protect-id for %s\n",
@@ -778,11 +1063,16 @@ int pil_boot(struct pil_desc *desc)
 	char fw_name[30];
 	const struct pil_mdt *mdt;
 	const struct elf32_hdr *ehdr;
-	struct pil_seg *seg;
 	const struct firmware *fw;
 	struct pil_priv *priv = desc->priv;
 	bool mem_protect = false;
 	bool hyp_assign = false;
+	bool fw_cache_held = false;
+	ktime_t start, loaded;
+	int tl_id;
+
+	start = ktime_get();
+	tl_id = boot_timeline_begin(BOOT_TL_PIL, desc->name);
 
 	if (desc->shutdown_fail)
 		pil_err(desc, "Subsystem shutdown failed previously!\n");
@@ -870,11 +1160,13 @@ int pil_boot(struct pil_desc *desc)
 		hyp_assign = true;
 	}
 
-	list_for_each_entry(seg, &desc->priv->segs, list) {
-		ret = pil_load_seg(desc, seg);
-		if (ret)
-			goto err_deinit_image;
-	}
+	pil_fw_cache_get(desc, fw, ehdr->e_phnum);
+	fw_cache_held = true;
+
+	ret = pil_load_segs(desc);
+	if (ret)
+		goto err_deinit_image;
+	loaded = ktime_get();
 
 	if (desc->subsys_vmid > 0) {
 		ret =  pil_reclaim_mem(desc, priv->region_start,
@@ -894,7 +1186,9 @@ int pil_boot(struct pil_desc *desc)
 		subsys_set_error(desc->subsys_dev, firmware_error_msg);
 		goto err_auth_and_reset;
 	}
-	pil_info(desc, "Brought out of reset\n");
+	pil_info(desc, "Brought out of reset, load %lld ms, auth %lld ms\n",
+		ktime_to_ms(ktime_sub(loaded, start)),
+		ktime_to_ms(ktime_sub(ktime_get(), loaded)));
 	desc->modem_ssr = false;
 err_auth_and_reset:
 	if (ret && desc->subsys_vmid > 0) {
@@ -910,6 +1204,8 @@ err_boot:
 		disable_irq(desc->proxy_unvote_irq);
 	pil_proxy_unvote(desc, ret);
 release_fw:
+	if (fw_cache_held)
+		pil_fw_cache_put(desc, ret);
 	release_firmware(fw);
 out:
 	up_read(&pil_pm_rwsem);
@@ -931,6 +1227,7 @@ out:
 		}
 		pil_release_mmap(desc);
 	}
+	boot_timeline_end(tl_id);
 	return ret;
 }
 EXPORT_SYMBOL(pil_boot);
@@ -1054,6 +1351,12 @@ int pil_desc_init(struct pil_desc *desc)
 	wakeup_source_init(&priv->ws, priv->wname);
 	INIT_DELAYED_WORK(&priv->proxy, pil_proxy_unvote_work);
 	INIT_LIST_HEAD(&priv->segs);
+	mutex_init(&priv->fw_cache_lock);
+	if (desc->fw_cache) {
+		mutex_lock(&pil_fw_cache_list_lock);
+		list_add_tail(&priv->fw_cache_list, &pil_fw_cache_list);
+		mutex_unlock(&pil_fw_cache_list_lock);
+	}
 
 	/* Make sure mapping functions are set. */
 	if (!desc->map_fw_mem)
@@ -1080,6 +1383,12 @@ void pil_desc_release(struct pil_desc *desc)
 	struct pil_priv *priv = desc->priv;
 
 	if (priv) {
+		if (desc->fw_cache) {
+			mutex_lock(&pil_fw_cache_list_lock);
+			list_del(&priv->fw_cache_list);
+			mutex_unlock(&pil_fw_cache_list_lock);
+			pil_fw_cache_free(priv);
+		}
 		ida_simple_remove(&pil_ida, priv->id);
 		flush_delayed_work(&priv->proxy);
 		wakeup_source_trash(&priv->ws);
@@ -1134,6 +1443,12 @@ static int __init msm_pil_init(void)
 		writel_relaxed(0, pil_info_base + (i * sizeof(u32)));
 
 out:
+	pil_wq = alloc_workqueue("pil_workqueue", WQ_HIGHPRI | WQ_UNBOUND, 0);
+	if (!pil_wq)
+		pr_warn("pil: no workqueue, segments are loaded sequentially\n");
+
+	register_shrinker(&pil_fw_cache_shrinker);
+
 	return register_pm_notifier(&pil_pm_notifier);
 }
 device_initcall(msm_pil_init);
@@ -1141,6 +1456,9 @@ device_initcall(msm_pil_init);
 static void __exit msm_pil_exit(void)
 {
 	unregister_pm_notifier(&pil_pm_notifier);
+	unregister_shrinker(&pil_fw_cache_shrinker);
+	if (pil_wq)
+		destroy_workqueue(pil_wq);
 	if (pil_info_base)
 		iounmap(pil_info_base);
 }
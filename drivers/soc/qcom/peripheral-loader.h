@@ -39,6 +39,8 @@ struct pil_priv;
  * @modem_ssr: true if modem is restarting, false if booting for first time.
  * @subsys_vmid: memprot id for the subsystem.
  * @clear_fw_region: Clear fw region on failure in loading.
+ * @sequential_loading: Load the segments one after another.
+ * @fw_cache: Keep the loaded blobs in memory for the next boot.
  */
 struct pil_desc {
 	const char *name;
@@ -60,6 +62,8 @@ struct pil_desc {
 	bool modem_ssr;
 	u32 subsys_vmid;
 	bool clear_fw_region;
+	bool sequential_loading;
+	bool fw_cache;
 };
 
 /**
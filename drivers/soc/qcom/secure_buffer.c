@@ -20,8 +20,10 @@
 #include <linux/scatterlist.h>
 #include <linux/slab.h>
 #include <linux/dma-mapping.h>
+#include <linux/ktime.h>
 #include <soc/qcom/scm.h>
 #include <soc/qcom/secure_buffer.h>
+#include <trace/events/kmem.h>
 
 DEFINE_MUTEX(secure_buffer_mutex);
 
@@ -43,11 +45,6 @@ struct mem_prot_info {
 	u64 size;
 };
 
-struct info_list {
-	struct mem_prot_info *list_head;
-	u64 list_size;
-};
-
 #define MEM_PROT_ASSIGN_ID		0x16
 #define MEM_PROTECT_LOCK_ID2		0x0A
 #define MEM_PROTECT_LOCK_ID2_FLAT	0x11
@@ -61,11 +58,6 @@ struct dest_vm_and_perm_info {
 	u32 ctx_size;
 };
 
-struct dest_info_list {
-	struct dest_vm_and_perm_info *dest_info;
-	u64 list_size;
-};
-
 static void *qcom_secure_mem;
 #define QCOM_SECURE_MEM_SIZE (512*1024)
 #define PADDING 32
@@ -107,25 +99,22 @@ static int secure_buffer_change_chunk(u32 chunks,
 
 
 
+/*
+ * Build a single chunk list covering every entry of the table and change
+ * the state of all of it with one call.
+ */
 static int secure_buffer_change_table(struct sg_table *table, int lock)
 {
 	int i, j;
-	int ret = -EINVAL;
+	int ret;
+	int nchunks = 0;
 	u32 *chunk_list;
 	struct scatterlist *sg;
 
 	for_each_sg(table->sgl, sg, table->nents, i) {
-		int nchunks;
 		int size = sg->length;
-		int chunk_list_len;
-		phys_addr_t chunk_list_phys;
-
-		/*
-		 * This should theoretically be a phys_addr_t but the protocol
-		 * indicates this should be a u32.
-		 */
-		u32 base;
 		u64 tmp = sg_dma_address(sg);
+
 		WARN((tmp >> 32) & 0xffffffff,
 			"%s: there are ones in the upper 32 bits of the sg at %p! They will be truncated! Address: 0x%llx\n",
 			__func__, sg, tmp);
@@ -135,45 +124,54 @@ static int secure_buffer_change_table(struct sg_table *table, int lock)
 				__func__, i, size, V2_CHUNK_SIZE);
 			return -EINVAL;
 		}
+		nchunks += size / V2_CHUNK_SIZE;
+	}
 
-		base = (u32)tmp;
+	if (!nchunks)
+		return -EINVAL;
 
-		nchunks = size / V2_CHUNK_SIZE;
-		chunk_list_len = sizeof(u32)*nchunks;
+	chunk_list = kcalloc(nchunks, sizeof(u32), GFP_KERNEL);
+	if (!chunk_list)
+		return -ENOMEM;
 
-		chunk_list = kzalloc(chunk_list_len, GFP_KERNEL);
+	j = 0;
+	for_each_sg(table->sgl, sg, table->nents, i) {
+		/*
+		 * This should theoretically be a phys_addr_t but the protocol
+		 * indicates this should be a u32.
+		 */
+		u32 base = (u32)sg_dma_address(sg);
+		u32 off;
 
-		if (!chunk_list)
-			return -ENOMEM;
+		for (off = 0; off < sg->length; off += V2_CHUNK_SIZE)
+			chunk_list[j++] = base + off;
+	}
+
+	/*
+	 * Flush the chunk list before sending the memory to the
+	 * secure environment to ensure the data is actually present
+	 * in RAM
+	 */
+	dmac_flush_range(chunk_list, chunk_list + nchunks);
 
-		chunk_list_phys = virt_to_phys(chunk_list);
-		for (j = 0; j < nchunks; j++)
-			chunk_list[j] = base + j * V2_CHUNK_SIZE;
+	ret = secure_buffer_change_chunk(virt_to_phys(chunk_list),
+			nchunks, V2_CHUNK_SIZE, lock);
 
+	if (!ret) {
 		/*
-		 * Flush the chunk list before sending the memory to the
-		 * secure environment to ensure the data is actually present
-		 * in RAM
+		 * Set or clear the private page flag to communicate the
+		 * status of the chunks to other entities
 		 */
-		dmac_flush_range(chunk_list, chunk_list + chunk_list_len);
-
-		ret = secure_buffer_change_chunk(virt_to_phys(chunk_list),
-				nchunks, V2_CHUNK_SIZE, lock);
-
-		if (!ret) {
-			/*
-			 * Set or clear the private page flag to communicate the
-			 * status of the chunk to other entities
-			 */
+		for_each_sg(table->sgl, sg, table->nents, i) {
 			if (lock)
 				SetPagePrivate(sg_page(sg));
 			else
 				ClearPagePrivate(sg_page(sg));
 		}
-
-		kfree(chunk_list);
 	}
 
+	kfree(chunk_list);
+
 	return ret;
 }
 
@@ -201,62 +199,74 @@ int msm_unsecure_table(struct sg_table *table)
 }
 
 static void populate_dest_info(int *dest_vmids, int nelements,
-			int *dest_perms, struct dest_info_list **list,
-			void *current_qcom_secure_mem)
+			int *dest_perms,
+			struct dest_vm_and_perm_info *dest_info)
 {
-	struct dest_vm_and_perm_info *dest_info;
 	int i;
 
-	dest_info = (struct dest_vm_and_perm_info *)current_qcom_secure_mem;
-
 	for (i = 0; i < nelements; i++) {
 		dest_info[i].vm = dest_vmids[i];
 		dest_info[i].perm = dest_perms[i];
 		dest_info[i].ctx = NULL;
 		dest_info[i].ctx_size = 0;
 	}
-
-	*list = (struct dest_info_list *)&dest_info[i];
-
-	(*list)->dest_info = dest_info;
-	(*list)->list_size = nelements * sizeof(struct dest_vm_and_perm_info);
 }
 
-static void get_info_list_from_table(struct sg_table *table,
-					struct info_list **list)
+/*
+ * Issue one MEM_PROT_ASSIGN call for nentries memory ranges totalling size
+ * bytes. Only the part of the range list that is actually used is flushed.
+ */
+static int hyp_assign_info_list(struct mem_prot_info *info, int nentries,
+			u64 size, u32 *source_vm_copy, int source_nelems,
+			struct dest_vm_and_perm_info *dest_info,
+			int dest_nelems)
 {
-	int i;
-	struct scatterlist *sg;
-	struct mem_prot_info *info;
+	struct scm_desc desc = {0};
+	ktime_t start;
+	int ret;
 
-	info = (struct mem_prot_info *)qcom_secure_mem;
+	desc.args[0] = virt_to_phys(info);
+	desc.args[1] = nentries * sizeof(*info);
+	desc.args[2] = virt_to_phys(source_vm_copy);
+	desc.args[3] = sizeof(*source_vm_copy) * source_nelems;
+	desc.args[4] = virt_to_phys(dest_info);
+	desc.args[5] = dest_nelems * sizeof(*dest_info);
+	desc.args[6] = 0;
 
-	for_each_sg(table->sgl, sg, table->nents, i) {
-		info[i].addr = page_to_phys(sg_page(sg));
-		info[i].size = sg->length;
-	}
+	desc.arginfo = SCM_ARGS(7, SCM_RO, SCM_VAL, SCM_RO, SCM_VAL, SCM_RO,
+				SCM_VAL, SCM_VAL);
 
-	*list = (struct info_list *)&(info[i]);
+	dmac_flush_range(info, info + nentries);
 
-	(*list)->list_head = info;
-	(*list)->list_size = table->nents * sizeof(struct mem_prot_info);
+	start = ktime_get();
+	ret = scm_call2(SCM_SIP_FNID(SCM_SVC_MP,
+			MEM_PROT_ASSIGN_ID), &desc);
+	trace_hyp_assign_call(nentries, size,
+			ktime_to_ns(ktime_sub(ktime_get(), start)), ret);
+
+	return ret;
 }
 
+/*
+ * The destination list goes at the start of qcom_secure_mem and the memory
+ * ranges fill the rest of it. Physically adjacent scatterlist entries are
+ * merged into a single range, so that buffers built from many order-0 pages
+ * normally still need a single call. Only when the merged ranges do not fit
+ * is the table assigned in several calls of as many ranges as fit.
+ */
 int hyp_assign_table(struct sg_table *table,
 			u32 *source_vm_list, int source_nelems,
 			int *dest_vmids, int *dest_perms,
 			int dest_nelems)
 {
-	int ret;
-	struct info_list *info_list = NULL;
-	struct dest_info_list *dest_info_list = NULL;
-	struct scm_desc desc = {0};
+	int ret = 0;
+	int i, nentries = 0, max_entries;
+	u64 size = 0;
+	struct scatterlist *sg;
+	struct mem_prot_info *info;
+	struct dest_vm_and_perm_info *dest_info;
 	u32 *source_vm_copy;
-	void *current_qcom_secure_mem;
-
-	size_t reqd_size = dest_nelems * sizeof(struct dest_vm_and_perm_info) +
-			table->nents * sizeof(struct mem_prot_info) +
-			sizeof(dest_info_list) + sizeof(info_list) + PADDING;
+	size_t dest_size = ALIGN(dest_nelems * sizeof(*dest_info), PADDING);
 
 	if (!qcom_secure_mem) {
 		pr_err("%s is not functional as qcom_secure_mem is not allocated.\n",
@@ -264,11 +274,12 @@ int hyp_assign_table(struct sg_table *table,
 		return -ENOMEM;
 	}
 
-	if (QCOM_SECURE_MEM_SIZE < reqd_size) {
+	if (QCOM_SECURE_MEM_SIZE < dest_size + sizeof(*info)) {
 		pr_err("%s: Not enough memory allocated. Required size %zd\n",
-				__func__, reqd_size);
+				__func__, dest_size + sizeof(*info));
 		return -EINVAL;
 	}
+	max_entries = (QCOM_SECURE_MEM_SIZE - dest_size) / sizeof(*info);
 
 	/*
 	 * We can only pass cache-aligned sizes to hypervisor, so we need
@@ -285,32 +296,44 @@ int hyp_assign_table(struct sg_table *table,
 
 	mutex_lock(&secure_buffer_mutex);
 
-	get_info_list_from_table(table, &info_list);
+	dest_info = (struct dest_vm_and_perm_info *)qcom_secure_mem;
+	info = (struct mem_prot_info *)(qcom_secure_mem + dest_size);
+	populate_dest_info(dest_vmids, dest_nelems, dest_perms, dest_info);
 
-	current_qcom_secure_mem = &(info_list[1]);
-	populate_dest_info(dest_vmids, dest_nelems, dest_perms,
-				&dest_info_list, current_qcom_secure_mem);
+	dmac_flush_range(source_vm_copy, source_vm_copy + source_nelems);
+	dmac_flush_range(dest_info, dest_info + dest_nelems);
 
-	desc.args[0] = virt_to_phys(info_list->list_head);
-	desc.args[1] = info_list->list_size;
-	desc.args[2] = virt_to_phys(source_vm_copy);
-	desc.args[3] = sizeof(*source_vm_copy) * source_nelems;
-	desc.args[4] = virt_to_phys(dest_info_list->dest_info);
-	desc.args[5] = dest_info_list->list_size;
-	desc.args[6] = 0;
+	for_each_sg(table->sgl, sg, table->nents, i) {
+		phys_addr_t addr = page_to_phys(sg_page(sg));
 
-	desc.arginfo = SCM_ARGS(7, SCM_RO, SCM_VAL, SCM_RO, SCM_VAL, SCM_RO,
-				SCM_VAL, SCM_VAL);
+		if (nentries &&
+		    info[nentries - 1].addr + info[nentries - 1].size == addr) {
+			info[nentries - 1].size += sg->length;
+			size += sg->length;
+			continue;
+		}
 
-	dmac_flush_range(source_vm_copy, source_vm_copy + source_nelems);
-	dmac_flush_range(info_list->list_head, info_list->list_head +
-		(info_list->list_size / sizeof(*info_list->list_head)));
-	dmac_flush_range(dest_info_list->dest_info, dest_info_list->dest_info +
-		(dest_info_list->list_size /
-				sizeof(*dest_info_list->dest_info)));
+		if (nentries == max_entries) {
+			ret = hyp_assign_info_list(info, nentries, size,
+					source_vm_copy, source_nelems,
+					dest_info, dest_nelems);
+			if (ret)
+				goto out;
+			nentries = 0;
+			size = 0;
+		}
 
-	ret = scm_call2(SCM_SIP_FNID(SCM_SVC_MP,
-			MEM_PROT_ASSIGN_ID), &desc);
+		info[nentries].addr = addr;
+		info[nentries].size = sg->length;
+		nentries++;
+		size += sg->length;
+	}
+
+	if (nentries)
+		ret = hyp_assign_info_list(info, nentries, size,
+				source_vm_copy, source_nelems,
+				dest_info, dest_nelems);
+out:
 	if (ret)
 		pr_info("%s: Failed to assign memory protection, ret = %d\n",
 			__func__, ret);
@@ -22,6 +22,7 @@
 #include <linux/io.h>
 #include <linux/kthread.h>
 #include <linux/time.h>
+#include <linux/ktime.h>
 #include <linux/suspend.h>
 #include <linux/mutex.h>
 #include <linux/slab.h>
@@ -49,6 +50,16 @@ module_param(disable_restart_work, uint, S_IRUGO | S_IWUSR);
 static int enable_debug;
 module_param(enable_debug, int, S_IRUGO | S_IWUSR);
 
+/*
+ * Shut down and power up the members of a restart order concurrently, only
+ * honouring the qcom,restart-depends-on edges between them.
+ */
+static bool parallel_restart = true;
+module_param(parallel_restart, bool, S_IRUGO | S_IWUSR);
+
+/* Dependencies are tracked as a bitmask of restart order members */
+#define SUBSYS_ORDER_MAX_PARALLEL	32
+
 /* The maximum shutdown timeout is the product of MAX_LOOPS and DELAY_MS. */
 #define SHUTDOWN_ACK_MAX_LOOPS	100
 #define SHUTDOWN_ACK_DELAY_MS	100
@@ -117,6 +128,9 @@ struct subsys_tracking {
  * @count: number of subsystems in order
  * @track: state tracking and locking
  * @subsys_ptrs: pointers to subsystems in this restart order
+ * @deps: for each member, the mask of members which have to be powered up
+ *	  before it and shut down after it, or NULL if the order is too
+ *	  large to be restarted in parallel
  */
 struct subsys_soc_restart_order {
 	struct device_node **device_ptrs;
@@ -124,9 +138,30 @@ struct subsys_soc_restart_order {
 
 	struct subsys_tracking track;
 	struct subsys_device **subsys_ptrs;
+	u32 *deps;
 	struct list_head list;
 };
 
+/**
+ * struct subsys_order_work - one member's step of a parallel order restart
+ * @work: runs @fn once the members in @wait_mask have completed their step
+ * @dev: the member, NULL if it has not registered
+ * @fn: shutdown or powerup step
+ * @wait_mask: members whose step has to complete first
+ * @group: the steps of all members of the order
+ * @done: completed once this member's step has finished or was skipped
+ * @ret: result of the step
+ */
+struct subsys_order_work {
+	struct work_struct work;
+	struct subsys_device *dev;
+	int (*fn)(struct subsys_device *, void *);
+	u32 wait_mask;
+	struct subsys_order_work *group;
+	struct completion done;
+	int ret;
+};
+
 struct restart_log {
 	struct timeval time;
 	struct subsys_device *dev;
@@ -399,6 +434,7 @@ static int enable_mini_ramdumps;
 module_param(enable_mini_ramdumps, int, S_IRUGO | S_IWUSR);
 
 struct workqueue_struct *ssr_wq;
+static struct workqueue_struct *ssr_order_wq;
 static struct class *char_class;
 
 static LIST_HEAD(restart_log_list);
@@ -410,6 +446,30 @@ static DEFINE_MUTEX(subsys_list_lock);
 static DEFINE_MUTEX(char_device_lock);
 static DEFINE_MUTEX(ssr_order_mutex);
 
+static void update_restart_deps(struct subsys_soc_restart_order *order,
+				int idx, struct device_node *device)
+{
+	struct device_node *dep;
+	int i, j;
+
+	if (!order->deps)
+		return;
+
+	order->deps[idx] = 0;
+	for (i = 0; (dep = of_parse_phandle(device,
+				"qcom,restart-depends-on", i)); i++) {
+		for (j = 0; j < order->count; j++)
+			if (order->device_ptrs[j] == dep)
+				break;
+		if (j < order->count && j != idx)
+			order->deps[idx] |= BIT(j);
+		else
+			pr_warn("%s: %s is not in %s's restart group\n",
+				__func__, dep->name, device->name);
+		of_node_put(dep);
+	}
+}
+
 static struct subsys_soc_restart_order *
 update_restart_order(struct subsys_device *dev)
 {
@@ -422,6 +482,7 @@ update_restart_order(struct subsys_device *dev)
 		for (i = 0; i < order->count; i++) {
 			if (order->device_ptrs[i] == device) {
 				order->subsys_ptrs[i] = dev;
+				update_restart_deps(order, i, device);
 				goto found;
 			}
 		}
@@ -532,6 +593,115 @@ static int for_each_subsys_device(struct subsys_device **list, unsigned count,
 	return 0;
 }
 
+/*
+ * Fill @seq with the members of @order so that every member comes after
+ * the members it depends on.
+ */
+static int subsys_order_sort(struct subsys_soc_restart_order *order, u8 *seq)
+{
+	u32 placed = 0;
+	int n = 0, i;
+	bool progress;
+
+	while (n < order->count) {
+		progress = false;
+		for (i = 0; i < order->count; i++) {
+			if ((placed & BIT(i)) || (order->deps[i] & ~placed))
+				continue;
+			placed |= BIT(i);
+			seq[n++] = i;
+			progress = true;
+		}
+		if (!progress)
+			return -ELOOP;
+	}
+
+	return 0;
+}
+
+static void subsys_order_work_fn(struct work_struct *work)
+{
+	struct subsys_order_work *w = container_of(work,
+					struct subsys_order_work, work);
+	unsigned long pending = w->wait_mask;
+	int i;
+
+	w->ret = 0;
+	for_each_set_bit(i, &pending, SUBSYS_ORDER_MAX_PARALLEL) {
+		wait_for_completion(&w->group[i].done);
+		if (w->group[i].ret && !w->ret)
+			w->ret = w->group[i].ret;
+	}
+
+	/* Skip the step if something it depends on failed */
+	if (w->dev && !w->ret)
+		w->ret = w->fn(w->dev, NULL);
+	complete(&w->done);
+}
+
+/*
+ * Run @fn on all members of @order, each on its own worker. Members wait
+ * for the members they depend on when powering up, and for the members
+ * depending on them when shutting down, so independent subsystems proceed
+ * concurrently. Falls back to the serial walk of the order if the
+ * dependencies cannot be satisfied.
+ */
+static int for_each_order_device(struct subsys_soc_restart_order *order,
+		bool shutdown, int (*fn)(struct subsys_device *, void *))
+{
+	struct subsys_order_work *works;
+	u8 seq[SUBSYS_ORDER_MAX_PARALLEL];
+	int count = order->count;
+	int i, j, ret = 0;
+
+	if (!parallel_restart || !order->deps || count < 2)
+		goto serial;
+
+	if (subsys_order_sort(order, seq)) {
+		pr_warn_once("Restart group dependencies form a cycle, restarting serially\n");
+		goto serial;
+	}
+
+	works = kcalloc(count, sizeof(*works), GFP_KERNEL);
+	if (!works)
+		goto serial;
+
+	for (i = 0; i < count; i++) {
+		INIT_WORK(&works[i].work, subsys_order_work_fn);
+		init_completion(&works[i].done);
+		works[i].dev = order->subsys_ptrs[i];
+		works[i].fn = fn;
+		works[i].group = works;
+		if (!shutdown) {
+			works[i].wait_mask = order->deps[i];
+			continue;
+		}
+		for (j = 0; j < count; j++)
+			if (order->deps[j] & BIT(i))
+				works[i].wait_mask |= BIT(j);
+	}
+
+	/*
+	 * Queue in dependency order so that a worker only ever waits for
+	 * work which was queued before it.
+	 */
+	for (i = 0; i < count; i++)
+		queue_work(ssr_order_wq,
+			&works[seq[shutdown ? count - 1 - i : i]].work);
+
+	for (i = 0; i < count; i++) {
+		wait_for_completion(&works[i].done);
+		if (works[i].ret && !ret)
+			ret = works[i].ret;
+	}
+	kfree(works);
+
+	return ret;
+
+serial:
+	return for_each_subsys_device(order->subsys_ptrs, count, NULL, fn);
+}
+
 static void notify_each_subsys_device(struct subsys_device **list,
 		unsigned count,
 		enum subsys_notif_type notif, void *data)
@@ -949,6 +1119,7 @@ static void subsystem_restart_wq_func(struct work_struct *work)
 	struct subsys_tracking *track;
 	unsigned count;
 	unsigned long flags;
+	ktime_t start;
 	int ret;
 
 	/*
@@ -996,8 +1167,12 @@ static void subsystem_restart_wq_func(struct work_struct *work)
 
 	pr_debug("[%s:%d]: Starting restart sequence for %s\n",
 			current->comm, current->pid, desc->name);
+	start = ktime_get();
 	notify_each_subsys_device(list, count, SUBSYS_BEFORE_SHUTDOWN, NULL);
-	ret = for_each_subsys_device(list, count, NULL, subsystem_shutdown);
+	if (order)
+		ret = for_each_order_device(order, true, subsystem_shutdown);
+	else
+		ret = subsystem_shutdown(dev, NULL);
 	if (ret)
 		goto err;
 	notify_each_subsys_device(list, count, SUBSYS_AFTER_SHUTDOWN, NULL);
@@ -1015,13 +1190,17 @@ static void subsystem_restart_wq_func(struct work_struct *work)
 	for_each_subsys_device(list, count, NULL, subsystem_free_memory);
 
 	notify_each_subsys_device(list, count, SUBSYS_BEFORE_POWERUP, NULL);
-	ret = for_each_subsys_device(list, count, NULL, subsystem_powerup);
+	if (order)
+		ret = for_each_order_device(order, false, subsystem_powerup);
+	else
+		ret = subsystem_powerup(dev, NULL);
 	if (ret)
 		goto err;
 	notify_each_subsys_device(list, count, SUBSYS_AFTER_POWERUP, NULL);
 
-	pr_info("[%s:%d]: Restart sequence for %s completed.\n",
-			current->comm, current->pid, desc->name);
+	pr_info("[%s:%d]: Restart sequence for %s completed in %lld ms.\n",
+			current->comm, current->pid, desc->name,
+			ktime_to_ms(ktime_sub(ktime_get(), start)));
 
 err:
 	/* Reset subsys count */
@@ -1389,6 +1568,13 @@ static struct subsys_soc_restart_order *ssr_parse_restart_orders(struct
 	if (!order->device_ptrs)
 		return ERR_PTR(-ENOMEM);
 
+	if (count <= SUBSYS_ORDER_MAX_PARALLEL) {
+		order->deps = devm_kzalloc(dev, count * sizeof(u32),
+					GFP_KERNEL);
+		if (!order->deps)
+			return ERR_PTR(-ENOMEM);
+	}
+
 	for (i = 0; i < count; i++) {
 		ssr_node = of_parse_phandle(dev->of_node,
 						"qcom,restart-group", i);
@@ -1797,6 +1983,9 @@ static int __init subsys_restart_init(void)
 	ssr_wq = alloc_workqueue("ssr_wq", WQ_CPU_INTENSIVE, 0);
 	BUG_ON(!ssr_wq);
 
+	ssr_order_wq = alloc_workqueue("ssr_order_wq", WQ_UNBOUND, 0);
+	BUG_ON(!ssr_order_wq);
+
 	ret = bus_register(&subsys_bus_type);
 	if (ret)
 		goto err_bus;
@@ -1820,6 +2009,7 @@ err_soc:
 err_class:
 	bus_unregister(&subsys_bus_type);
 err_bus:
+	destroy_workqueue(ssr_order_wq);
 	destroy_workqueue(ssr_wq);
 	return ret;
 }
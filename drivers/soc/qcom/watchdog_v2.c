@@ -29,6 +29,7 @@
 #include <soc/qcom/scm.h>
 #include <soc/qcom/memory_dump.h>
 #include <soc/qcom/watchdog.h>
+#include <soc/qcom/hang_snapshot.h>
 #include "watchdog_cpu_ctx.h"
 
 #define MODULE_NAME "msm_watchdog"
@@ -107,6 +108,17 @@ module_param(WDT_HZ, long, 0);
 static int ipi_opt_en;
 module_param(ipi_opt_en, int, 0);
 
+/*
+ * On the kernel command line specify
+ * watchdog_v2.stall_snapshot_pct=<percent> to take a hang snapshot once
+ * a pet is that far into the margin between pet time and bark time.
+ * By default it is 50, 0 turns it off.
+ */
+static int stall_snapshot_pct = 50;
+module_param(stall_snapshot_pct, int, 0644);
+
+static DEFINE_PER_CPU(struct call_single_data, wdog_ping_csd);
+
 static void dump_cpu_alive_mask(struct msm_watchdog_data *wdog_dd)
 {
 	static char alive_mask_buf[MASK_SIZE];
@@ -293,17 +305,74 @@ static void keep_alive_response(void *info)
 	struct msm_watchdog_data *wdog_dd = (struct msm_watchdog_data *)info;
 	cpumask_set_cpu(cpu, &wdog_dd->alive_mask);
 	smp_mb();
+	hang_snapshot_cpu_recovered();
+}
+
+/* how long @now is past the pet being due, if further than the threshold */
+static u64 wdog_stall_ns(struct msm_watchdog_data *wdog_dd, u64 now)
+{
+	u64 due_ns, margin_ns;
+
+	if (!IS_ENABLED(CONFIG_MSM_HANG_SNAPSHOT) || stall_snapshot_pct <= 0 ||
+	    wdog_dd->bark_time <= wdog_dd->pet_time)
+		return 0;
+
+	due_ns = wdog_dd->last_pet + wdog_dd->pet_time * NSEC_PER_MSEC;
+	margin_ns = (wdog_dd->bark_time - wdog_dd->pet_time) * NSEC_PER_MSEC;
+	if (now <= due_ns ||
+	    now - due_ns < div_u64(margin_ns * stall_snapshot_pct, 100))
+		return 0;
+	return now - due_ns;
+}
+
+/*
+ * Pings with asynchronous IPIs and waits for all of them, so that a cpu
+ * which stays unresponsive still ends in a bark, but the wait can take
+ * a hang snapshot while it goes on.
+ */
+static void ping_other_cpus_snapshot(struct msm_watchdog_data *wdog_dd,
+				     bool snapped)
+{
+	cpumask_t pinged, stalled;
+	u64 stall_ns;
+	int cpu;
+
+	cpumask_clear(&pinged);
+	for_each_cpu(cpu, cpu_online_mask) {
+		struct call_single_data *csd = &per_cpu(wdog_ping_csd, cpu);
+
+		if (cpu_idle_pc_state[cpu])
+			continue;
+		csd->func = keep_alive_response;
+		csd->info = wdog_dd;
+		if (!smp_call_function_single_async(cpu, csd))
+			cpumask_set_cpu(cpu, &pinged);
+	}
+
+	while (!cpumask_subset(&pinged, &wdog_dd->alive_mask)) {
+		stall_ns = snapped ? 0 : wdog_stall_ns(wdog_dd, sched_clock());
+		if (stall_ns) {
+			cpumask_andnot(&stalled, &pinged, &wdog_dd->alive_mask);
+			hang_snapshot_take("ipi ping", &stalled, stall_ns);
+			snapped = true;
+		}
+		usleep_range(100, 200);
+	}
 }
 
 /*
  * If this function does not return, it implies one of the
  * other cpu's is not responsive.
  */
-static void ping_other_cpus(struct msm_watchdog_data *wdog_dd)
+static void ping_other_cpus(struct msm_watchdog_data *wdog_dd, bool snapped)
 {
 	int cpu;
 	cpumask_clear(&wdog_dd->alive_mask);
 	smp_mb();
+	if (IS_ENABLED(CONFIG_MSM_HANG_SNAPSHOT) && stall_snapshot_pct > 0) {
+		ping_other_cpus_snapshot(wdog_dd, snapped);
+		return;
+	}
 	for_each_cpu(cpu, cpu_online_mask) {
 		if (!cpu_idle_pc_state[cpu])
 			smp_call_function_single(cpu, keep_alive_response,
@@ -324,6 +393,7 @@ static __ref int watchdog_kthread(void *arg)
 		(struct msm_watchdog_data *)arg;
 	unsigned long delay_time = 0;
 	struct sched_param param = {.sched_priority = MAX_RT_PRIO-1};
+	u64 stall_ns;
 
 	sched_setscheduler(current, SCHED_FIFO, &param);
 	while (!kthread_should_stop()) {
@@ -333,8 +403,11 @@ static __ref int watchdog_kthread(void *arg)
 		reinit_completion(&wdog_dd->pet_complete);
 		if (enable) {
 			delay_time = msecs_to_jiffies(wdog_dd->pet_time);
+			stall_ns = wdog_stall_ns(wdog_dd, sched_clock());
+			if (stall_ns)
+				hang_snapshot_take("late pet", NULL, stall_ns);
 			if (wdog_dd->do_ipi_ping)
-				ping_other_cpus(wdog_dd);
+				ping_other_cpus(wdog_dd, stall_ns != 0);
 			pet_watchdog(wdog_dd);
 		}
 		/* Check again before scheduling *
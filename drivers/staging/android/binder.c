@@ -57,6 +57,7 @@
 #include <linux/file.h>
 #include <linux/freezer.h>
 #include <linux/fs.h>
+#include <linux/jhash.h>
 #include <linux/list.h>
 #include <linux/miscdevice.h>
 #include <linux/module.h>
@@ -71,6 +72,7 @@
 #include <linux/pid_namespace.h>
 #include <linux/security.h>
 #include <linux/spinlock.h>
+#include <linux/vmalloc.h>
 
 #include "binder.h"
 #include "binder_alloc.h"
@@ -145,6 +147,10 @@ module_param_named(debug_mask, binder_debug_mask, uint, S_IWUSR | S_IRUGO);
 static char *binder_devices_param = CONFIG_ANDROID_BINDER_DEVICES;
 module_param_named(devices, binder_devices_param, charp, S_IRUGO);
 
+static bool binder_latency_stats = true;
+module_param_named(latency_stats, binder_latency_stats, bool,
+		   S_IWUSR | S_IRUGO);
+
 static DECLARE_WAIT_QUEUE_HEAD(binder_user_error_wait);
 static int binder_stop_on_user_error;
 
@@ -216,6 +222,67 @@ static inline void binder_stats_created(enum binder_stat_types type)
 	atomic_inc(&binder_stats.obj_created[type]);
 }
 
+/*
+ * Per-interface latency histograms, see uapi/binder.h. Every CPU owns
+ * an open-addressed table that only it writes to, with preemption
+ * disabled, so recording takes no locks. Slots are claimed for good;
+ * once a CPU's table is full, samples for new interfaces are dropped
+ * until the tables are cleared through debugfs.
+ */
+#define BINDER_LAT_ENTRIES	128	/* per cpu, power of 2 */
+#define BINDER_LAT_PROBES	8
+
+static DEFINE_PER_CPU(struct binder_latency_entry *, binder_lat_table);
+static DEFINE_PER_CPU(u32, binder_lat_dropped);
+
+static inline u64 binder_lat_start(void)
+{
+	return binder_latency_stats ? ktime_get_ns() : 0;
+}
+
+static void binder_lat_record(kuid_t euid, u32 pid, unsigned int code,
+			      int stat, u64 start_ns)
+{
+	struct binder_latency_entry *table, *e = NULL;
+	u32 uid = from_kuid(&init_user_ns, euid);
+	u64 us;
+	u32 hash;
+	int i;
+
+	if (!binder_latency_stats || !start_ns)
+		return;
+
+	us = div_u64(ktime_get_ns() - start_ns, NSEC_PER_USEC);
+	hash = jhash_3words(uid, pid, code, 0);
+
+	table = get_cpu_var(binder_lat_table);
+	if (unlikely(!table))
+		goto out;
+
+	for (i = 0; i < BINDER_LAT_PROBES; i++) {
+		e = &table[(hash + i) & (BINDER_LAT_ENTRIES - 1)];
+		if (e->pid == pid && e->uid == uid && e->code == code)
+			break;
+		if (!e->pid) {
+			e->uid = uid;
+			e->code = code;
+			/* readers skip slots with no pid */
+			smp_wmb();
+			e->pid = pid;
+			break;
+		}
+		e = NULL;
+	}
+
+	if (e)
+		e->hist[stat][min_t(u64, fls64(us),
+				    BINDER_LATENCY_BUCKETS - 1)]++;
+	else
+		this_cpu_inc(binder_lat_dropped);
+out:
+	put_cpu_var(binder_lat_table);
+}
+
 struct binder_transaction_log_entry {
 	int debug_id;
 	int debug_id_done;
@@ -651,6 +718,7 @@ struct binder_transaction {
 	struct binder_priority	saved_priority;
 	bool    set_priority_called;
 	kuid_t	sender_euid;
+	u64	start_ns;	/* for the latency stats, 0 if off */
 	/**
 	 * @lock:  protects @from, @to_proc, and @to_thread
 	 *
@@ -3043,6 +3111,7 @@ static void binder_transaction(struct binder_proc *proc,
 
 	trace_binder_transaction(reply, t, target_node);
 
+	t->start_ns = binder_lat_start();
 	t->buffer = binder_alloc_new_buf(&target_proc->alloc, tr->data_size,
 		tr->offsets_size, extra_buffers_size,
 		!reply && (t->flags & TF_ONE_WAY));
@@ -3057,6 +3126,13 @@ static void binder_transaction(struct binder_proc *proc,
 		t->buffer = NULL;
 		goto err_binder_alloc_buf_failed;
 	}
+	if (reply)
+		binder_lat_record(in_reply_to->sender_euid, proc->pid,
+				  in_reply_to->code, BINDER_LATENCY_ALLOC,
+				  t->start_ns);
+	else
+		binder_lat_record(t->sender_euid, target_proc->pid, t->code,
+				  BINDER_LATENCY_ALLOC, t->start_ns);
 	t->buffer->allow_user_free = 0;
 	t->buffer->debug_id = t->debug_id;
 	t->buffer->transaction = t;
@@ -3269,6 +3345,9 @@ static void binder_transaction(struct binder_proc *proc,
 		binder_inner_proc_unlock(target_proc);
 		wake_up_interruptible_sync(&target_thread->wait);
 		binder_restore_priority(current, in_reply_to->saved_priority);
+		binder_lat_record(in_reply_to->sender_euid, proc->pid,
+				  in_reply_to->code, BINDER_LATENCY_REPLY,
+				  in_reply_to->start_ns);
 		binder_free_transaction(in_reply_to);
 	} else if (!(t->flags & TF_ONE_WAY)) {
 		BUG_ON(t->buffer->async_transaction != 0);
@@ -4221,6 +4300,9 @@ retry:
 
 		trace_binder_transaction_received(t);
 		binder_stat_br(proc, thread, cmd);
+		if (cmd == BR_TRANSACTION)
+			binder_lat_record(t->sender_euid, proc->pid, t->code,
+					  BINDER_LATENCY_QUEUE, t->start_ns);
 		binder_debug(BINDER_DEBUG_TRANSACTION,
 			     "%d:%d %s %d %d:%d, cmd %d size %zd-%zd ptr %016llx-%016llx\n",
 			     proc->pid, thread->pid,
@@ -5484,6 +5566,8 @@ static void print_binder_proc_stats(struct seq_file *m,
 
 	count = binder_alloc_get_allocated_count(&proc->alloc);
 	seq_printf(m, "  buffers: %d\n", count);
+	binder_alloc_print_pages(m, &proc->alloc);
+	binder_alloc_print_class_stats(m, &proc->alloc);
 
 	count = 0;
 	binder_inner_proc_lock(proc);
@@ -5646,6 +5730,113 @@ BINDER_DEBUG_ENTRY(stats);
 BINDER_DEBUG_ENTRY(transactions);
 BINDER_DEBUG_ENTRY(transaction_log);
 
+struct binder_lat_snapshot {
+	size_t size;
+	struct binder_latency_header hdr;
+	struct binder_latency_entry entry[0];
+};
+
+/*
+ * The tables are copied at open time, racing with the CPUs updating
+ * them, so a histogram may be off by the samples recorded meanwhile.
+ */
+static int binder_transaction_latency_open(struct inode *inode,
+					   struct file *file)
+{
+	struct binder_lat_snapshot *snap;
+	int cpu, i, n = 0;
+	u32 dropped = 0;
+
+	snap = vmalloc(sizeof(*snap) + num_possible_cpus() *
+		       BINDER_LAT_ENTRIES * sizeof(snap->entry[0]));
+	if (!snap)
+		return -ENOMEM;
+
+	for_each_possible_cpu(cpu) {
+		struct binder_latency_entry *table;
+
+		dropped += per_cpu(binder_lat_dropped, cpu);
+		table = per_cpu(binder_lat_table, cpu);
+		if (!table)
+			continue;
+		for (i = 0; i < BINDER_LAT_ENTRIES; i++) {
+			if (!ACCESS_ONCE(table[i].pid))
+				continue;
+			smp_rmb();
+			snap->entry[n] = table[i];
+			snap->entry[n].cpu = cpu;
+			n++;
+		}
+	}
+
+	memset(&snap->hdr, 0, sizeof(snap->hdr));
+	snap->hdr.version = BINDER_LATENCY_VERSION;
+	snap->hdr.nr_stats = BINDER_LATENCY_NR_STATS;
+	snap->hdr.nr_buckets = BINDER_LATENCY_BUCKETS;
+	snap->hdr.nr_entries = n;
+	snap->hdr.dropped = dropped;
+	snap->size = sizeof(snap->hdr) + n * sizeof(snap->entry[0]);
+
+	file->private_data = snap;
+	return 0;
+}
+
+static ssize_t binder_transaction_latency_read(struct file *file,
+					       char __user *ubuf,
+					       size_t count, loff_t *ppos)
+{
+	struct binder_lat_snapshot *snap = file->private_data;
+
+	return simple_read_from_buffer(ubuf, count, ppos, &snap->hdr,
+				       snap->size);
+}
+
+/* any write clears all tables, e.g. to make room for new interfaces */
+static ssize_t binder_transaction_latency_write(struct file *file,
+						const char __user *ubuf,
+						size_t count, loff_t *ppos)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct binder_latency_entry *table;
+
+		table = per_cpu(binder_lat_table, cpu);
+		if (table)
+			memset(table, 0, BINDER_LAT_ENTRIES * sizeof(*table));
+		per_cpu(binder_lat_dropped, cpu) = 0;
+	}
+	return count;
+}
+
+static int binder_transaction_latency_release(struct inode *inode,
+					      struct file *file)
+{
+	vfree(file->private_data);
+	return 0;
+}
+
+static const struct file_operations binder_transaction_latency_fops = {
+	.owner = THIS_MODULE,
+	.open = binder_transaction_latency_open,
+	.read = binder_transaction_latency_read,
+	.write = binder_transaction_latency_write,
+	.llseek = default_llseek,
+	.release = binder_transaction_latency_release,
+};
+
+static void __init binder_lat_init(void)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		per_cpu(binder_lat_table, cpu) = vzalloc(BINDER_LAT_ENTRIES *
+				sizeof(struct binder_latency_entry));
+		if (!per_cpu(binder_lat_table, cpu))
+			pr_warn("no latency stats table for cpu %d\n", cpu);
+	}
+}
+
 static int __init init_binder_device(const char *name)
 {
 	int ret;
@@ -5681,8 +5872,13 @@ static int __init binder_init(void)
 	struct binder_device *device;
 	struct hlist_node *tmp;
 
+	ret = binder_alloc_shrinker_init();
+	if (ret)
+		return ret;
+
 	atomic_set(&binder_transaction_log.cur, ~0U);
 	atomic_set(&binder_transaction_log_failed.cur, ~0U);
+	binder_lat_init();
 	binder_deferred_workqueue = create_singlethread_workqueue("binder");
 	if (!binder_deferred_workqueue)
 		return -ENOMEM;
@@ -5718,6 +5914,11 @@ static int __init binder_init(void)
 				    binder_debugfs_dir_entry_root,
 				    &binder_transaction_log_failed,
 				    &binder_transaction_log_fops);
+		debugfs_create_file("transaction_latency",
+				    S_IRUGO | S_IWUSR,
+				    binder_debugfs_dir_entry_root,
+				    NULL,
+				    &binder_transaction_latency_fops);
 	}
 
 	/*
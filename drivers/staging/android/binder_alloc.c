@@ -19,6 +19,7 @@
 
 #include <asm/cacheflush.h>
 #include <linux/list.h>
+#include <linux/list_lru.h>
 #include <linux/mm.h>
 #include <linux/module.h>
 #include <linux/rtmutex.h>
@@ -32,6 +33,8 @@
 
 #define BINDER_MIN_ALLOC (1 * PAGE_SIZE)
 
+struct list_lru binder_alloc_lru;
+
 static DEFINE_MUTEX(binder_alloc_mmap_lock);
 
 enum {
@@ -44,6 +47,15 @@ static uint32_t binder_alloc_debug_mask;
 module_param_named(debug_mask, binder_alloc_debug_mask,
 		   uint, S_IWUSR | S_IRUGO);
 
+/*
+ * Number of unused pages each proc may keep mapped, up to its own
+ * high-water mark of pages in use, before the shrinker reclaims them.
+ */
+static uint32_t binder_alloc_lru_keep_pages = 16;
+
+module_param_named(lru_keep_pages, binder_alloc_lru_keep_pages,
+		   uint, S_IWUSR | S_IRUGO);
+
 #define binder_alloc_debug(mask, x...) \
 	do { \
 		if (binder_alloc_debug_mask & mask) \
@@ -69,6 +81,60 @@ static size_t binder_alloc_buffer_size(struct binder_alloc *alloc,
 	return (u8 *)binder_buffer_next(buffer)->data - (u8 *)buffer->data;
 }
 
+static int binder_alloc_size_class(size_t size)
+{
+	int class = fls_long(size) - BINDER_ALLOC_CLASS_SHIFT;
+
+	return clamp(class, 0, BINDER_ALLOC_SIZE_CLASSES - 1);
+}
+
+/*
+ * Smallest size class whose free buffers are all guaranteed to be at
+ * least @size bytes. May be past the last class for large requests.
+ */
+static int binder_alloc_request_class(size_t size)
+{
+	int class = fls_long(size - 1) - BINDER_ALLOC_CLASS_SHIFT + 1;
+
+	return max(class, 1);
+}
+
+static void binder_erase_free_buffer(struct binder_alloc *alloc,
+				     struct binder_buffer *buffer)
+{
+	rb_erase(&buffer->rb_node, &alloc->free_buffers);
+	list_del_init(&buffer->class_entry);
+	if (list_empty(&alloc->free_class[buffer->size_class]))
+		__clear_bit(buffer->size_class, &alloc->free_class_mask);
+}
+
+/*
+ * binder_alloc_class_lookup() - O(1) lookup of a free buffer of at least
+ * @size bytes from the size-class lists. Returns NULL if no class that is
+ * guaranteed to fit has a free buffer, in which case the caller falls back
+ * to the best-fit walk of the free_buffers rb tree.
+ */
+static struct binder_buffer *binder_alloc_class_lookup(
+		struct binder_alloc *alloc, size_t size)
+{
+	int req_class = binder_alloc_request_class(size);
+	int stat_class = min(req_class, BINDER_ALLOC_SIZE_CLASSES - 1);
+	int class;
+
+	if (req_class < BINDER_ALLOC_SIZE_CLASSES) {
+		class = find_next_bit(&alloc->free_class_mask,
+				      BINDER_ALLOC_SIZE_CLASSES, req_class);
+		if (class < BINDER_ALLOC_SIZE_CLASSES) {
+			alloc->class_stats[stat_class].hits++;
+			return list_first_entry(&alloc->free_class[class],
+						struct binder_buffer,
+						class_entry);
+		}
+	}
+	alloc->class_stats[stat_class].misses++;
+	return NULL;
+}
+
 static void binder_insert_free_buffer(struct binder_alloc *alloc,
 				      struct binder_buffer *new_buffer)
 {
@@ -100,6 +166,11 @@ static void binder_insert_free_buffer(struct binder_alloc *alloc,
 	}
 	rb_link_node(&new_buffer->rb_node, parent, p);
 	rb_insert_color(&new_buffer->rb_node, &alloc->free_buffers);
+
+	new_buffer->size_class = binder_alloc_size_class(new_buffer_size);
+	list_add(&new_buffer->class_entry,
+		 &alloc->free_class[new_buffer->size_class]);
+	__set_bit(new_buffer->size_class, &alloc->free_class_mask);
 }
 
 static void binder_insert_allocated_buffer_locked(
@@ -190,8 +261,9 @@ static int __binder_update_page_range(struct binder_alloc *alloc, int allocate,
 {
 	void *page_addr;
 	unsigned long user_page_addr;
-	struct page **page;
-	struct mm_struct *mm;
+	struct binder_lru_page *page;
+	struct mm_struct *mm = NULL;
+	bool need_mm = false;
 
 	binder_alloc_debug(BINDER_DEBUG_BUFFER_ALLOC,
 		     "%d: %s pages %pK-%pK\n", alloc->pid,
@@ -202,9 +274,19 @@ static int __binder_update_page_range(struct binder_alloc *alloc, int allocate,
 
 	trace_binder_update_page_range(alloc, allocate, start, end);
 
-	if (vma)
-		mm = NULL;
-	else
+	if (allocate == 0)
+		goto free_range;
+
+	for (page_addr = start; page_addr < end; page_addr += PAGE_SIZE) {
+		page = &alloc->pages[(page_addr - alloc->buffer) / PAGE_SIZE];
+		if (!page->page_ptr) {
+			need_mm = true;
+			break;
+		}
+	}
+
+	/* Only take the mm if some page has to be faulted in */
+	if (need_mm && !vma)
 		mm = get_task_mm(alloc->tsk);
 
 	if (mm) {
@@ -217,10 +299,7 @@ static int __binder_update_page_range(struct binder_alloc *alloc, int allocate,
 		}
 	}
 
-	if (allocate == 0)
-		goto free_range;
-
-	if (vma == NULL) {
+	if (!vma && need_mm) {
 		pr_err("%d: binder_alloc_buf failed to map pages in userspace, no vma\n",
 			alloc->pid);
 		goto err_no_vma;
@@ -228,18 +307,30 @@ static int __binder_update_page_range(struct binder_alloc *alloc, int allocate,
 
 	for (page_addr = start; page_addr < end; page_addr += PAGE_SIZE) {
 		int ret;
+		bool on_lru;
 
 		page = &alloc->pages[(page_addr - alloc->buffer) / PAGE_SIZE];
 
-		BUG_ON(*page);
-		*page = alloc_page(GFP_KERNEL | __GFP_HIGHMEM | __GFP_ZERO);
-		if (*page == NULL) {
+		if (page->page_ptr) {
+			on_lru = list_lru_del(&binder_alloc_lru, &page->lru);
+			WARN_ON(!on_lru);
+			alloc->pages_lru--;
+			alloc->pages_reused++;
+			goto page_in_use;
+		}
+
+		page->alloc = alloc;
+		INIT_LIST_HEAD(&page->lru);
+		page->page_ptr = alloc_page(GFP_KERNEL | __GFP_HIGHMEM |
+					    __GFP_ZERO);
+		if (!page->page_ptr) {
 			pr_err("%d: binder_alloc_buf failed for page at %pK\n",
 				alloc->pid, page_addr);
 			goto err_alloc_page_failed;
 		}
 		ret = map_kernel_range_noflush((unsigned long)page_addr,
-					PAGE_SIZE, PAGE_KERNEL, page);
+					PAGE_SIZE, PAGE_KERNEL,
+					&page->page_ptr);
 		flush_cache_vmap((unsigned long)page_addr,
 				(unsigned long)page_addr + PAGE_SIZE);
 		if (ret != 1) {
@@ -249,13 +340,17 @@ static int __binder_update_page_range(struct binder_alloc *alloc, int allocate,
 		}
 		user_page_addr =
 			(uintptr_t)page_addr + alloc->user_buffer_offset;
-		ret = vm_insert_page(vma, user_page_addr, page[0]);
+		ret = vm_insert_page(vma, user_page_addr, page->page_ptr);
 		if (ret) {
 			pr_err("%d: binder_alloc_buf failed to map page at %lx in userspace\n",
 			       alloc->pid, user_page_addr);
 			goto err_vm_insert_page_failed;
 		}
 		/* vm_insert_page does not seem to increment the refcount */
+		alloc->pages_faulted++;
+page_in_use:
+		if (++alloc->pages_in_use > alloc->pages_high)
+			alloc->pages_high = alloc->pages_in_use;
 	}
 	if (mm) {
 		up_write(&mm->mmap_sem);
@@ -264,20 +359,32 @@ static int __binder_update_page_range(struct binder_alloc *alloc, int allocate,
 	return 0;
 
 free_range:
+	/*
+	 * Unused pages stay mapped on the lru and are only unmapped and
+	 * freed in batches by the binder_alloc shrinker.
+	 */
 	for (page_addr = end - PAGE_SIZE; page_addr >= start;
 	     page_addr -= PAGE_SIZE) {
+		bool ret;
+
 		page = &alloc->pages[(page_addr - alloc->buffer) / PAGE_SIZE];
-		if (vma)
-			zap_page_range(vma, (uintptr_t)page_addr +
-				alloc->user_buffer_offset, PAGE_SIZE, NULL);
+
+		ret = list_lru_add(&binder_alloc_lru, &page->lru);
+		WARN_ON(!ret);
+		alloc->pages_lru++;
+		alloc->pages_in_use--;
+		continue;
+
 err_vm_insert_page_failed:
 		unmap_kernel_range((unsigned long)page_addr, PAGE_SIZE);
 err_map_kernel_failed:
-		__free_page(*page);
-		*page = NULL;
+		__free_page(page->page_ptr);
+		page->page_ptr = NULL;
 err_alloc_page_failed:
 		;
 	}
+	if (allocate == 0)
+		return 0;
 err_no_vma:
 	if (mm) {
 		up_write(&mm->mmap_sem);
@@ -349,6 +456,15 @@ struct binder_buffer *binder_alloc_new_buf_locked(struct binder_alloc *alloc,
 	/* Pad 0-size buffers so they get assigned unique addresses */
 	size = max(size, sizeof(void *));
 
+	buffer = binder_alloc_class_lookup(alloc, size);
+	if (buffer) {
+		BUG_ON(!buffer->free);
+		best_fit = &buffer->rb_node;
+		buffer_size = binder_alloc_buffer_size(alloc, buffer);
+		n = buffer_size == size ? best_fit : NULL;
+		goto found;
+	}
+
 	while (n) {
 		buffer = rb_entry(n, struct binder_buffer, rb_node);
 		BUG_ON(!buffer->free);
@@ -402,6 +518,7 @@ struct binder_buffer *binder_alloc_new_buf_locked(struct binder_alloc *alloc,
 		buffer_size = binder_alloc_buffer_size(alloc, buffer);
 	}
 
+found:
 	binder_alloc_debug(BINDER_DEBUG_BUFFER_ALLOC,
 		     "%d: binder_alloc_buf size %zd got buffer %pK size %zd\n",
 		      alloc->pid, size, buffer, buffer_size);
@@ -434,7 +551,7 @@ struct binder_buffer *binder_alloc_new_buf_locked(struct binder_alloc *alloc,
 		binder_insert_free_buffer(alloc, new_buffer);
 	}
 
-	rb_erase(best_fit, &alloc->free_buffers);
+	binder_erase_free_buffer(alloc, buffer);
 	buffer->free = 0;
 	buffer->free_in_progress = 0;
 	binder_insert_allocated_buffer_locked(alloc, buffer);
@@ -588,7 +705,7 @@ static void binder_free_buf_locked(struct binder_alloc *alloc,
 		struct binder_buffer *next = binder_buffer_next(buffer);
 
 		if (next->free) {
-			rb_erase(&next->rb_node, &alloc->free_buffers);
+			binder_erase_free_buffer(alloc, next);
 			binder_delete_free_buffer(alloc, next);
 		}
 	}
@@ -597,7 +714,7 @@ static void binder_free_buf_locked(struct binder_alloc *alloc,
 
 		if (prev->free) {
 			binder_delete_free_buffer(alloc, buffer);
-			rb_erase(&prev->rb_node, &alloc->free_buffers);
+			binder_erase_free_buffer(alloc, prev);
 			buffer = prev;
 		}
 	}
@@ -705,6 +822,9 @@ int binder_alloc_mmap_handler(struct binder_alloc *alloc,
 	barrier();
 	alloc->vma = vma;
 	alloc->vma_vm_mm = vma->vm_mm;
+	/* Keep the mm_struct around for the shrinker after vma close */
+	alloc->mm = vma->vm_mm;
+	atomic_inc(&alloc->mm->mm_count);
 
 	return 0;
 
@@ -763,22 +883,28 @@ void binder_alloc_deferred_release(struct binder_alloc *alloc)
 
 		for (i = 0; i < alloc->buffer_size / PAGE_SIZE; i++) {
 			void *page_addr;
+			bool on_lru;
 
-			if (!alloc->pages[i])
+			if (!alloc->pages[i].page_ptr)
 				continue;
 
+			on_lru = list_lru_del(&binder_alloc_lru,
+					      &alloc->pages[i].lru);
 			page_addr = alloc->buffer + i * PAGE_SIZE;
 			binder_alloc_debug(BINDER_DEBUG_BUFFER_ALLOC,
-				     "%s: %d: page %d at %pK not freed\n",
-				     __func__, alloc->pid, i, page_addr);
+				     "%s: %d: page %d at %pK %s\n",
+				     __func__, alloc->pid, i, page_addr,
+				     on_lru ? "on lru" : "active");
 			unmap_kernel_range((unsigned long)page_addr, PAGE_SIZE);
-			__free_page(alloc->pages[i]);
+			__free_page(alloc->pages[i].page_ptr);
 			page_count++;
 		}
 		kfree(alloc->pages);
 		vfree(alloc->buffer);
 	}
 	mutex_unlock(&alloc->mutex);
+	if (alloc->mm)
+		mmdrop(alloc->mm);
 
 	binder_alloc_debug(BINDER_DEBUG_OPEN_CLOSE,
 		     "%s: %d buffers %d, pages %d\n",
@@ -815,6 +941,75 @@ void binder_alloc_print_allocated(struct seq_file *m,
 	mutex_unlock(&alloc->mutex);
 }
 
+/**
+ * binder_alloc_print_class_stats() - print size-class free list statistics
+ * @m:     seq_file for output via seq_printf()
+ * @alloc: binder_alloc for this proc
+ *
+ * Prints per size-class hit and miss counts of the free list fast path
+ */
+void binder_alloc_print_class_stats(struct seq_file *m,
+				    struct binder_alloc *alloc)
+{
+	size_t limit;
+	int i;
+
+	mutex_lock(&alloc->mutex);
+	for (i = 1; i < BINDER_ALLOC_SIZE_CLASSES; i++) {
+		struct binder_alloc_class_stats *stats = &alloc->class_stats[i];
+
+		if (!stats->hits && !stats->misses)
+			continue;
+		if (i < BINDER_ALLOC_SIZE_CLASSES - 1) {
+			limit = (size_t)1 << (i + BINDER_ALLOC_CLASS_SHIFT - 1);
+			seq_printf(m, "  alloc class <= %zu: hits %lu misses %lu\n",
+				   limit, stats->hits, stats->misses);
+		} else {
+			limit = (size_t)1 << (i + BINDER_ALLOC_CLASS_SHIFT - 2);
+			seq_printf(m, "  alloc class > %zu: hits %lu misses %lu\n",
+				   limit, stats->hits, stats->misses);
+		}
+	}
+	mutex_unlock(&alloc->mutex);
+}
+
+/**
+ * binder_alloc_print_pages() - print page usage
+ * @m:     seq_file for output via seq_printf()
+ * @alloc: binder_alloc for this proc
+ *
+ * Prints active, lru and free page counts along with the number of pages
+ * faulted in, reused from the lru and reclaimed by the shrinker
+ */
+void binder_alloc_print_pages(struct seq_file *m,
+			      struct binder_alloc *alloc)
+{
+	struct binder_lru_page *page;
+	int i;
+	int active = 0;
+	int lru = 0;
+	int free = 0;
+
+	mutex_lock(&alloc->mutex);
+	if (alloc->pages) {
+		for (i = 0; i < alloc->buffer_size / PAGE_SIZE; i++) {
+			page = &alloc->pages[i];
+			if (!page->page_ptr)
+				free++;
+			else if (list_empty(&page->lru))
+				active++;
+			else
+				lru++;
+		}
+	}
+	seq_printf(m, "  pages: %d:%d:%d\n", active, lru, free);
+	seq_printf(m, "  pages high watermark: %zu\n", alloc->pages_high);
+	seq_printf(m, "  pages faulted %lu reused %lu reclaimed %lu\n",
+		   alloc->pages_faulted, alloc->pages_reused,
+		   alloc->pages_reclaimed);
+	mutex_unlock(&alloc->mutex);
+}
+
 /**
  * binder_alloc_get_allocated_count() - return count of buffers
  * @alloc: binder_alloc for this proc
@@ -848,6 +1043,103 @@ void binder_alloc_vma_close(struct binder_alloc *alloc)
 	WRITE_ONCE(alloc->vma_vm_mm, NULL);
 }
 
+/**
+ * binder_alloc_free_page() - shrinker callback to free pages
+ * @item:   item to free
+ * @lock:   lock protecting the item
+ * @cb_arg: callback argument
+ *
+ * Called from list_lru_walk() in binder_shrink_scan() to free
+ * up pages when the system is under memory pressure. Pages below
+ * the owning proc's keep limit are rotated instead of freed.
+ */
+static enum lru_status binder_alloc_free_page(struct list_head *item,
+					      spinlock_t *lock,
+					      void *cb_arg)
+{
+	struct mm_struct *mm = NULL;
+	struct binder_lru_page *page = container_of(item,
+						    struct binder_lru_page,
+						    lru);
+	struct binder_alloc *alloc;
+	uintptr_t page_addr;
+	size_t index;
+	size_t keep;
+	struct vm_area_struct *vma;
+
+	alloc = page->alloc;
+	if (!mutex_trylock(&alloc->mutex))
+		return LRU_SKIP;
+
+	index = page - alloc->pages;
+	page_addr = (uintptr_t)alloc->buffer + index * PAGE_SIZE;
+	vma = alloc->vma;
+	if (vma) {
+		keep = min_t(size_t, alloc->pages_high,
+			     binder_alloc_lru_keep_pages);
+		if (alloc->pages_in_use + alloc->pages_lru <= keep) {
+			mutex_unlock(&alloc->mutex);
+			return LRU_ROTATE;
+		}
+		mm = alloc->mm;
+		if (!mm || !atomic_inc_not_zero(&mm->mm_users)) {
+			mm = NULL;
+			vma = NULL;
+		}
+	}
+	if (mm && !down_write_trylock(&mm->mmap_sem)) {
+		/* mmput() may sleep, so drop the lru lock first */
+		spin_unlock(lock);
+		mmput(mm);
+		spin_lock(lock);
+		mutex_unlock(&alloc->mutex);
+		return LRU_RETRY;
+	}
+
+	list_del_init(item);
+	alloc->pages_lru--;
+	alloc->pages_reclaimed++;
+	spin_unlock(lock);
+
+	if (mm) {
+		/* mmap_sem is held, so alloc->vma cannot go away under us */
+		vma = alloc->vma;
+		if (vma)
+			zap_page_range(vma, page_addr +
+				       alloc->user_buffer_offset,
+				       PAGE_SIZE, NULL);
+		up_write(&mm->mmap_sem);
+		mmput(mm);
+	}
+
+	unmap_kernel_range(page_addr, PAGE_SIZE);
+	__free_page(page->page_ptr);
+	page->page_ptr = NULL;
+
+	spin_lock(lock);
+	mutex_unlock(&alloc->mutex);
+	return LRU_REMOVED_RETRY;
+}
+
+static unsigned long
+binder_shrink_count(struct shrinker *shrink, struct shrink_control *sc)
+{
+	return list_lru_count(&binder_alloc_lru);
+}
+
+static unsigned long
+binder_shrink_scan(struct shrinker *shrink, struct shrink_control *sc)
+{
+	return list_lru_walk(&binder_alloc_lru, binder_alloc_free_page,
+			     NULL, sc->nr_to_scan);
+}
+
+static struct shrinker binder_shrinker = {
+	.count_objects = binder_shrink_count,
+	.scan_objects = binder_shrink_scan,
+	.seeks = DEFAULT_SEEKS,
+};
+
 /**
  * binder_alloc_init() - called by binder_open() for per-proc initialization
  * @alloc: binder_alloc for this proc
@@ -857,9 +1149,31 @@ void binder_alloc_vma_close(struct binder_alloc *alloc)
  */
 void binder_alloc_init(struct binder_alloc *alloc)
 {
+	int i;
+
 	alloc->tsk = current->group_leader;
 	alloc->pid = current->group_leader->pid;
 	mutex_init(&alloc->mutex);
 	INIT_LIST_HEAD(&alloc->buffers);
+	for (i = 0; i < BINDER_ALLOC_SIZE_CLASSES; i++)
+		INIT_LIST_HEAD(&alloc->free_class[i]);
 }
 
+/**
+ * binder_alloc_shrinker_init() - register the binder page shrinker
+ *
+ * Called from binder_init() before any proc can map pages
+ *
+ * Return: 0 on success, negative errno otherwise
+ */
+int binder_alloc_shrinker_init(void)
+{
+	int ret = list_lru_init(&binder_alloc_lru);
+
+	if (ret == 0) {
+		ret = register_shrinker(&binder_shrinker);
+		if (ret)
+			list_lru_destroy(&binder_alloc_lru);
+	}
+	return ret;
+}
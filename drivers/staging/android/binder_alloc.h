@@ -17,13 +17,25 @@
 
 #include <linux/rbtree.h>
 #include <linux/list.h>
+#include <linux/list_lru.h>
 #include <linux/mm.h>
 #include <linux/rtmutex.h>
 #include <linux/vmalloc.h>
 #include <linux/slab.h>
 
+extern struct list_lru binder_alloc_lru;
 struct binder_transaction;
 
+/*
+ * Free buffers are additionally kept on segregated size-class lists so
+ * that small allocations can be satisfied without walking the free_buffers
+ * rb tree. Class 0 holds buffers smaller than 1 << BINDER_ALLOC_CLASS_SHIFT,
+ * class n (n > 0) holds buffers in [1 << (n + SHIFT - 1), 1 << (n + SHIFT))
+ * and the last class holds everything larger.
+ */
+#define BINDER_ALLOC_CLASS_SHIFT	6
+#define BINDER_ALLOC_SIZE_CLASSES	10
+
 /**
  * struct binder_buffer - buffer used for binder transactions
  * @entry:              entry alloc->buffers
@@ -38,6 +50,8 @@ struct binder_transaction;
  * @offsets_size:       describe the second member of struct blah,
  * @extra_buffers_size: describe the second member of struct blah,
  * @data:i              describe the second member of struct blah,
+ * @class_entry:        entry in alloc->free_class[] while buffer is free
+ * @size_class:         index of the free_class[] list holding this buffer
  *
  * Bookkeeping structure for binder transaction buffers
  */
@@ -50,6 +64,9 @@ struct binder_buffer {
 	unsigned async_transaction:1;
 	unsigned free_in_progress:1;
 	unsigned debug_id:28;
+	unsigned size_class:8;
+
+	struct list_head class_entry;
 
 	struct binder_transaction *transaction;
 
@@ -60,6 +77,28 @@ struct binder_buffer {
 	void *data;
 };
 
+/**
+ * struct binder_lru_page - page object used for binder shrinker
+ * @page_ptr: pointer to physical page in mmap'd space
+ * @lru:      entry in binder_alloc_lru
+ * @alloc:    binder_alloc for a proc
+ */
+struct binder_lru_page {
+	struct list_head lru;
+	struct page *page_ptr;
+	struct binder_alloc *alloc;
+};
+
+/**
+ * struct binder_alloc_class_stats - per size-class allocation statistics
+ * @hits:               allocations served from a size-class free list
+ * @misses:             allocations that fell back to the rb tree walk
+ */
+struct binder_alloc_class_stats {
+	unsigned long hits;
+	unsigned long misses;
+};
+
 /**
  * struct binder_alloc - per-binder proc state for binder allocator
  * @vma:                vm_area_struct passed to mmap_handler
@@ -72,13 +111,25 @@ struct binder_buffer {
  * @buffers:            list of all buffers for this proc
  * @free_buffers:       rb tree of buffers available for allocation
  *                      sorted by size
+ * @free_class:         free buffers segregated by size class
+ * @free_class_mask:    bitmap of non-empty free_class[] lists
+ * @class_stats:        per size-class hit/miss counters
  * @allocated_buffers:  rb tree of allocated buffers sorted by address
  * @free_async_space:   VA space available for async buffers. This is
  *                      initialized at mmap time to 1/2 the full VA space
- * @pages:              array of physical page addresses for each
- *                      page of mmap'd space
+ * @pages:              array of binder_lru_page for each page of
+ *                      mmap'd space
  * @buffer_size:        size of address space specified via mmap
  * @pid:                pid for associated binder_proc (invariant after init)
+ * @mm:                 mm of the mmap'ing task, pinned until deferred release
+ *                      so the shrinker can safely zap user mappings
+ * @pages_in_use:       pages currently backing allocated buffers
+ * @pages_lru:          unused pages still mapped and sitting on the lru
+ * @pages_high:         high-water mark of @pages_in_use; up to this many
+ *                      mapped pages are kept back from the shrinker
+ * @pages_faulted:      pages that had to be allocated and mapped
+ * @pages_reused:       pages taken back off the lru without remapping
+ * @pages_reclaimed:    unused pages freed by the shrinker
  *
  * Bookkeeping structure for per-proc address space management for binder
  * buffers. It is normally initialized during binder_init() and binder_mmap()
@@ -94,12 +145,22 @@ struct binder_alloc {
 	ptrdiff_t user_buffer_offset;
 	struct list_head buffers;
 	struct rb_root free_buffers;
+	struct list_head free_class[BINDER_ALLOC_SIZE_CLASSES];
+	unsigned long free_class_mask;
+	struct binder_alloc_class_stats class_stats[BINDER_ALLOC_SIZE_CLASSES];
 	struct rb_root allocated_buffers;
 	size_t free_async_space;
-	struct page **pages;
+	struct binder_lru_page *pages;
 	size_t buffer_size;
 	uint32_t buffer_free;
 	int pid;
+	struct mm_struct *mm;
+	size_t pages_in_use;
+	size_t pages_lru;
+	size_t pages_high;
+	unsigned long pages_faulted;
+	unsigned long pages_reused;
+	unsigned long pages_reclaimed;
 };
 
 #ifdef CONFIG_ANDROID_BINDER_IPC_SELFTEST
@@ -113,6 +174,7 @@ extern struct binder_buffer *binder_alloc_new_buf(struct binder_alloc *alloc,
 						  size_t extra_buffers_size,
 						  int is_async);
 extern void binder_alloc_init(struct binder_alloc *alloc);
+extern int binder_alloc_shrinker_init(void);
 extern void binder_alloc_vma_close(struct binder_alloc *alloc);
 extern struct binder_buffer *
 binder_alloc_prepare_to_free(struct binder_alloc *alloc,
@@ -125,6 +187,10 @@ extern void binder_alloc_deferred_release(struct binder_alloc *alloc);
 extern int binder_alloc_get_allocated_count(struct binder_alloc *alloc);
 extern void binder_alloc_print_allocated(struct seq_file *m,
 					 struct binder_alloc *alloc);
+extern void binder_alloc_print_class_stats(struct seq_file *m,
+					   struct binder_alloc *alloc);
+extern void binder_alloc_print_pages(struct seq_file *m,
+				     struct binder_alloc *alloc);
 
 /**
  * binder_alloc_get_free_async_space() - get free space available for async
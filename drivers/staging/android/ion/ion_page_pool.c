@@ -25,8 +25,15 @@
 #include <linux/vmalloc.h>
 #include <linux/vmstat.h>
 #include <linux/mmzone.h>
+#include <linux/percpu.h>
 #include "ion_priv.h"
 
+/*
+ * Pages of order 0 each per-cpu cache may hold, scaled down by the order
+ * of the pool, so the largest orders are not cached per cpu at all.
+ */
+#define ION_PAGE_POOL_PCP_PAGES	128
+
 static void *ion_page_pool_alloc_pages(struct ion_page_pool *pool)
 {
 	struct page *page;
@@ -55,13 +62,19 @@ static void ion_page_pool_free_pages(struct ion_page_pool *pool,
 	__free_pages(page, pool->order);
 }
 
-static int ion_page_pool_add(struct ion_page_pool *pool, struct page *page,
-				bool prefetch)
+/* pooled pages are accounted as inactive file pages for reclaim */
+static void ion_page_pool_mod_state(struct ion_page_pool *pool,
+				    struct page *page, int sign)
 {
-	int page_count = 1 << pool->order;
+	int page_count = sign * (1 << pool->order);
 
-	mutex_lock(&pool->mutex);
+	mod_zone_page_state(page_zone(page), NR_FILE_PAGES, page_count);
+	mod_zone_page_state(page_zone(page), NR_INACTIVE_FILE, page_count);
+}
 
+static void __ion_page_pool_add(struct ion_page_pool *pool, struct page *page,
+				bool prefetch)
+{
 	if (PageHighMem(page)) {
 		list_add_tail(&page->lru, &pool->high_items);
 		pool->high_count++;
@@ -72,18 +85,39 @@ static int ion_page_pool_add(struct ion_page_pool *pool, struct page *page,
 	if (!prefetch)
 		pool->nr_unreserved++;
 
-	mod_zone_page_state(page_zone(page), NR_FILE_PAGES, page_count);
-	mod_zone_page_state(page_zone(page), NR_INACTIVE_FILE, page_count);
+	ion_page_pool_mod_state(pool, page, 1);
+}
 
+static int ion_page_pool_add(struct ion_page_pool *pool, struct page *page,
+				bool prefetch)
+{
+	mutex_lock(&pool->mutex);
+	__ion_page_pool_add(pool, page, prefetch);
 	mutex_unlock(&pool->mutex);
 	return 0;
 }
 
+/* Hand a batch of pages taken off a per-cpu cache back to the pool */
+static void ion_page_pool_add_list(struct ion_page_pool *pool,
+				   struct list_head *pages)
+{
+	struct page *page, *tmp;
+
+	if (list_empty(pages))
+		return;
+
+	mutex_lock(&pool->mutex);
+	list_for_each_entry_safe(page, tmp, pages, lru) {
+		list_del(&page->lru);
+		__ion_page_pool_add(pool, page, false);
+	}
+	mutex_unlock(&pool->mutex);
+}
+
 static struct page *ion_page_pool_remove(struct ion_page_pool *pool, bool high,
 					bool prefetch)
 {
 	struct page *page;
-	int page_count = 1 << pool->order;
 
 	if (high) {
 		BUG_ON(!pool->high_count);
@@ -104,26 +138,125 @@ static struct page *ion_page_pool_remove(struct ion_page_pool *pool, bool high,
 
 	list_del(&page->lru);
 
-	mod_zone_page_state(page_zone(page), NR_INACTIVE_FILE, -page_count);
-	mod_zone_page_state(page_zone(page), NR_FILE_PAGES, -page_count);
+	ion_page_pool_mod_state(pool, page, -1);
 
 	return page;
 }
 
-void *ion_page_pool_alloc(struct ion_page_pool *pool, bool *from_pool)
+static struct page *ion_page_pool_pcp_get(struct ion_page_pool *pool)
 {
+	struct ion_page_pool_pcp *pcp;
 	struct page *page = NULL;
 
+	pcp = get_cpu_ptr(pool->pcp);
+	spin_lock(&pcp->lock);
+	if (pcp->count) {
+		page = list_first_entry(&pcp->items, struct page, lru);
+		list_del(&page->lru);
+		pcp->count--;
+		pcp->hits++;
+	} else {
+		pcp->misses++;
+	}
+	spin_unlock(&pcp->lock);
+	put_cpu_ptr(pool->pcp);
+
+	if (page)
+		ion_page_pool_mod_state(pool, page, -1);
+	return page;
+}
+
+/*
+ * Cache @page on this cpu. A full cache first gives its oldest pcp_batch
+ * pages back to the pool, under a single hold of the pool mutex.
+ */
+static void ion_page_pool_pcp_put(struct ion_page_pool *pool,
+				  struct page *page)
+{
+	struct ion_page_pool_pcp *pcp;
+	struct page *old;
+	LIST_HEAD(flush);
+	int i;
+
+	ion_page_pool_mod_state(pool, page, 1);
+
+	pcp = get_cpu_ptr(pool->pcp);
+	spin_lock(&pcp->lock);
+	if (pcp->count >= pool->pcp_high) {
+		for (i = 0; i < pool->pcp_batch && pcp->count; i++) {
+			old = list_last_entry(&pcp->items, struct page, lru);
+			list_move(&old->lru, &flush);
+			pcp->count--;
+		}
+	}
+	list_add(&page->lru, &pcp->items);
+	pcp->count++;
+	spin_unlock(&pcp->lock);
+	put_cpu_ptr(pool->pcp);
+
+	list_for_each_entry(old, &flush, lru)
+		ion_page_pool_mod_state(pool, old, -1);
+	ion_page_pool_add_list(pool, &flush);
+}
+
+/* Move pages taken from the pool in one go into this cpu's cache */
+static void ion_page_pool_pcp_fill(struct ion_page_pool *pool,
+				   struct list_head *pages)
+{
+	struct ion_page_pool_pcp *pcp;
+	struct page *page;
+	int nr = 0;
+
+	if (list_empty(pages))
+		return;
+
+	list_for_each_entry(page, pages, lru) {
+		ion_page_pool_mod_state(pool, page, 1);
+		nr++;
+	}
+
+	pcp = get_cpu_ptr(pool->pcp);
+	spin_lock(&pcp->lock);
+	list_splice(pages, &pcp->items);
+	pcp->count += nr;
+	spin_unlock(&pcp->lock);
+	put_cpu_ptr(pool->pcp);
+}
+
+void *ion_page_pool_alloc(struct ion_page_pool *pool, bool *from_pool)
+{
+	struct page *page = NULL, *extra;
+	LIST_HEAD(batch);
+	int i;
+
 	BUG_ON(!pool);
 
 	*from_pool = true;
 
+	if (pool->pcp_high) {
+		page = ion_page_pool_pcp_get(pool);
+		if (page)
+			return page;
+	}
+
 	if (mutex_trylock(&pool->mutex)) {
 		if (pool->high_count)
 			page = ion_page_pool_remove(pool, true, false);
 		else if (pool->low_count)
 			page = ion_page_pool_remove(pool, false, false);
+		/* refill this cpu's cache while we hold the mutex anyway */
+		for (i = 1; page && i < pool->pcp_batch; i++) {
+			if (pool->high_count)
+				extra = ion_page_pool_remove(pool, true, false);
+			else if (pool->low_count)
+				extra = ion_page_pool_remove(pool, false,
+							     false);
+			else
+				break;
+			list_add_tail(&extra->lru, &batch);
+		}
 		mutex_unlock(&pool->mutex);
+		ion_page_pool_pcp_fill(pool, &batch);
 	}
 	if (!page) {
 		page = ion_page_pool_alloc_pages(pool);
@@ -153,6 +286,29 @@ void *ion_page_pool_prefetch(struct ion_page_pool *pool, bool *from_pool)
 	}
 	return page;
 }
+/*
+ * Add one freshly zeroed page to the shared lists. Used to prefill pools in
+ * the background, so it only takes memory that is free without reclaim.
+ */
+int ion_page_pool_refill_one(struct ion_page_pool *pool)
+{
+	gfp_t gfp_mask = (pool->gfp_mask & ~(__GFP_ZERO | __GFP_WAIT)) |
+			 __GFP_NO_KSWAPD | __GFP_NORETRY | __GFP_NOWARN;
+	struct page *page;
+
+	page = alloc_pages(gfp_mask, pool->order);
+	if (!page)
+		return -ENOMEM;
+
+	if (msm_ion_heap_high_order_page_zero(page, pool->order)) {
+		__free_pages(page, pool->order);
+		return -ENOMEM;
+	}
+	ion_page_pool_alloc_set_cache_policy(pool, page);
+
+	return ion_page_pool_add(pool, page, false);
+}
+
 /*
  * Tries to allocate from only the specified Pool and returns NULL otherwise
  */
@@ -180,6 +336,11 @@ void ion_page_pool_free(struct ion_page_pool *pool, struct page *page,
 
 	BUG_ON(pool->order != compound_order(page));
 
+	if (!prefetch && pool->pcp_high) {
+		ion_page_pool_pcp_put(pool, page);
+		return;
+	}
+
 	ret = ion_page_pool_add(pool, page, prefetch);
 	/* FIXME? For a secure page, not hyp unassigned in this err path */
 	if (ret)
@@ -191,9 +352,19 @@ void ion_page_pool_free_immediate(struct ion_page_pool *pool, struct page *page)
 	ion_page_pool_free_pages(pool, page);
 }
 
+int ion_page_pool_pcp_total(struct ion_page_pool *pool)
+{
+	int cpu, count = 0;
+
+	for_each_possible_cpu(cpu)
+		count += per_cpu_ptr(pool->pcp, cpu)->count;
+
+	return count;
+}
+
 int ion_page_pool_total(struct ion_page_pool *pool, bool high)
 {
-	int count = pool->low_count;
+	int count = pool->low_count + ion_page_pool_pcp_total(pool);
 
 	if (high)
 		count += pool->high_count;
@@ -201,6 +372,45 @@ int ion_page_pool_total(struct ion_page_pool *pool, bool high)
 	return count << pool->order;
 }
 
+/* Give every per-cpu cached page back to the pool, e.g. before shrinking */
+void ion_page_pool_drain(struct ion_page_pool *pool)
+{
+	struct ion_page_pool_pcp *pcp;
+	struct page *page;
+	LIST_HEAD(pages);
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		pcp = per_cpu_ptr(pool->pcp, cpu);
+		spin_lock(&pcp->lock);
+		list_splice_init(&pcp->items, &pages);
+		pcp->count = 0;
+		spin_unlock(&pcp->lock);
+	}
+
+	list_for_each_entry(page, &pages, lru)
+		ion_page_pool_mod_state(pool, page, -1);
+	ion_page_pool_add_list(pool, &pages);
+}
+
+void ion_page_pool_debug_show_pcp(struct ion_page_pool *pool,
+				  struct seq_file *s, const char *name)
+{
+	struct ion_page_pool_pcp *pcp;
+	int cpu;
+
+	if (!pool->pcp_high)
+		return;
+
+	for_each_possible_cpu(cpu) {
+		pcp = per_cpu_ptr(pool->pcp, cpu);
+		seq_printf(s,
+			"%s order %u cpu %d: %d pages cached, %lu hits %lu misses\n",
+			name, pool->order, cpu, pcp->count, pcp->hits,
+			pcp->misses);
+	}
+}
+
 int ion_page_pool_shrink(struct ion_page_pool *pool, gfp_t gfp_mask,
 				int nr_to_scan)
 {
@@ -215,6 +425,8 @@ int ion_page_pool_shrink(struct ion_page_pool *pool, gfp_t gfp_mask,
 	if (nr_to_scan == 0)
 		return ion_page_pool_total(pool, high);
 
+	ion_page_pool_drain(pool);
+
 	while (freed < nr_to_scan) {
 		struct page *page;
 
@@ -239,8 +451,26 @@ struct ion_page_pool *ion_page_pool_create(gfp_t gfp_mask, unsigned int order)
 {
 	struct ion_page_pool *pool = kmalloc(sizeof(struct ion_page_pool),
 					     GFP_KERNEL);
+	int cpu;
+
 	if (!pool)
 		return NULL;
+	pool->pcp = alloc_percpu(struct ion_page_pool_pcp);
+	if (!pool->pcp) {
+		kfree(pool);
+		return NULL;
+	}
+	for_each_possible_cpu(cpu) {
+		struct ion_page_pool_pcp *pcp = per_cpu_ptr(pool->pcp, cpu);
+
+		spin_lock_init(&pcp->lock);
+		INIT_LIST_HEAD(&pcp->items);
+		pcp->count = 0;
+		pcp->hits = 0;
+		pcp->misses = 0;
+	}
+	pool->pcp_high = ION_PAGE_POOL_PCP_PAGES >> order;
+	pool->pcp_batch = max(DIV_ROUND_UP(pool->pcp_high, 4), 1);
 	pool->high_count = 0;
 	pool->low_count = 0;
 	pool->nr_unreserved = 0;
@@ -256,6 +486,8 @@ struct ion_page_pool *ion_page_pool_create(gfp_t gfp_mask, unsigned int order)
 
 void ion_page_pool_destroy(struct ion_page_pool *pool)
 {
+	ion_page_pool_drain(pool);
+	free_percpu(pool->pcp);
 	kfree(pool);
 }
 
@@ -425,6 +425,10 @@ void ion_carveout_free(struct ion_heap *heap, ion_phys_addr_t addr,
  * @gfp_mask:		gfp_mask to use from alloc
  * @order:		order of pages in the pool
  * @list:		plist node for list of pools
+ * @pcp:		per-cpu caches of free pages in front of the lists
+ * @pcp_high:		most pages of this order a per-cpu cache may hold
+ * @pcp_batch:		number of pages moved at once between a per-cpu
+ *			cache and the lists
  *
  * Allows you to keep a pool of pre allocated pages to use from your heap.
  * Keeping a pool of pages that is ready for dma, ie any cached mapping have
@@ -441,6 +445,26 @@ struct ion_page_pool {
 	gfp_t gfp_mask;
 	unsigned int order;
 	struct plist_node list;
+	struct ion_page_pool_pcp __percpu *pcp;
+	int pcp_high;
+	int pcp_batch;
+};
+
+/**
+ * struct ion_page_pool_pcp - per-cpu page cache of a pool
+ * @lock:	protects the cache, only contended while it is drained
+ * @items:	cached pages
+ * @count:	number of cached pages
+ * @hits:	allocations served from this cache
+ * @misses:	allocations that went to the shared pool or the buddy
+ *		allocator
+ */
+struct ion_page_pool_pcp {
+	spinlock_t lock;
+	struct list_head items;
+	int count;
+	unsigned long hits;
+	unsigned long misses;
 };
 
 struct ion_page_pool *ion_page_pool_create(gfp_t gfp_mask, unsigned int order);
@@ -450,7 +474,12 @@ void *ion_page_pool_alloc_pool_only(struct ion_page_pool *);
 void ion_page_pool_free(struct ion_page_pool *, struct page *, bool prefetch);
 void ion_page_pool_free_immediate(struct ion_page_pool *, struct page *);
 int ion_page_pool_total(struct ion_page_pool *pool, bool high);
+int ion_page_pool_pcp_total(struct ion_page_pool *pool);
+void ion_page_pool_drain(struct ion_page_pool *pool);
+void ion_page_pool_debug_show_pcp(struct ion_page_pool *pool,
+				  struct seq_file *s, const char *name);
 void *ion_page_pool_prefetch(struct ion_page_pool *pool, bool *from_pool);
+int ion_page_pool_refill_one(struct ion_page_pool *pool);
 
 #ifdef CONFIG_ION_POOL_CACHE_POLICY
 static inline void ion_page_pool_alloc_set_cache_policy
@@ -19,12 +19,16 @@
 #include <linux/dma-mapping.h>
 #include <linux/err.h>
 #include <linux/highmem.h>
+#include <linux/freezer.h>
+#include <linux/kthread.h>
 #include <linux/mm.h>
+#include <linux/module.h>
 #include <linux/msm_ion.h>
 #include <linux/scatterlist.h>
 #include <linux/seq_file.h>
 #include <linux/slab.h>
 #include <linux/vmalloc.h>
+#include <linux/vmpressure.h>
 #include "ion.h"
 #include "ion_priv.h"
 #include <linux/dma-mapping.h>
@@ -42,6 +46,18 @@ static const unsigned int orders[] = {9, 8, 4, 0};
 static const unsigned int orders[] = {0};
 #endif
 
+/*
+ * Background prefill: each order's uncached and cached pool is kept topped
+ * up to prefill_kb worth of zeroed pages, backing off for prefill_backoff_ms
+ * whenever vmpressure reaches prefill_pressure or free memory runs out.
+ */
+static unsigned int prefill_kb;
+module_param(prefill_kb, uint, S_IRUGO | S_IWUSR);
+static unsigned int prefill_pressure = 60;
+module_param(prefill_pressure, uint, S_IRUGO | S_IWUSR);
+static unsigned int prefill_backoff_ms = 1000;
+module_param(prefill_backoff_ms, uint, S_IRUGO | S_IWUSR);
+
 static const int num_orders = ARRAY_SIZE(orders);
 static int order_to_index(unsigned int order)
 {
@@ -63,6 +79,10 @@ struct ion_system_heap {
 	struct ion_page_pool **uncached_pools;
 	struct ion_page_pool **cached_pools;
 	struct ion_page_pool **secure_pools[VMID_LAST];
+	struct task_struct *prefill_task;
+	wait_queue_head_t prefill_wait;
+	struct notifier_block prefill_nb;
+	unsigned long prefill_backoff;	/* jiffies until prefill may resume */
 };
 
 struct page_info {
@@ -199,6 +219,101 @@ static unsigned int process_info(struct page_info *info,
 	return i;
 }
 
+static int prefill_target(struct ion_page_pool *pool)
+{
+	return ((unsigned long)prefill_kb << 10) >> (PAGE_SHIFT + pool->order);
+}
+
+static bool prefill_pool_low(struct ion_page_pool *pool)
+{
+	return (ion_page_pool_total(pool, true) >> pool->order) <
+		prefill_target(pool);
+}
+
+static bool prefill_needed(struct ion_system_heap *heap)
+{
+	int i;
+
+	if (!prefill_kb)
+		return false;
+
+	for (i = 0; i < num_orders; i++)
+		if (prefill_pool_low(heap->uncached_pools[i]) ||
+		    prefill_pool_low(heap->cached_pools[i]))
+			return true;
+	return false;
+}
+
+static void prefill_backoff(struct ion_system_heap *heap)
+{
+	heap->prefill_backoff = jiffies + msecs_to_jiffies(prefill_backoff_ms);
+}
+
+static bool prefill_backing_off(struct ion_system_heap *heap)
+{
+	return time_before(jiffies, ACCESS_ONCE(heap->prefill_backoff));
+}
+
+/* Returns false once prefilling has to stop for a while */
+static bool prefill_pool(struct ion_system_heap *heap,
+			 struct ion_page_pool *pool)
+{
+	while (prefill_pool_low(pool)) {
+		if (kthread_should_stop() || prefill_backing_off(heap))
+			return false;
+		if (ion_page_pool_refill_one(pool)) {
+			prefill_backoff(heap);
+			return false;
+		}
+		cond_resched();
+	}
+	return true;
+}
+
+static int prefill_thread(void *data)
+{
+	struct ion_system_heap *heap = data;
+	long timeout;
+	int i;
+
+	set_freezable();
+	set_user_nice(current, MAX_NICE);
+
+	while (!kthread_should_stop()) {
+		wait_event_freezable(heap->prefill_wait,
+				     kthread_should_stop() ||
+				     prefill_needed(heap));
+		if (kthread_should_stop())
+			break;
+
+		timeout = (long)(ACCESS_ONCE(heap->prefill_backoff) - jiffies);
+		if (timeout > 0) {
+			schedule_timeout_interruptible(timeout);
+			continue;
+		}
+
+		/* smallest orders first, they are what an allocation ends on */
+		for (i = num_orders - 1; i >= 0; i--) {
+			if (!prefill_pool(heap, heap->uncached_pools[i]) ||
+			    !prefill_pool(heap, heap->cached_pools[i]))
+				break;
+		}
+	}
+
+	return 0;
+}
+
+static int prefill_vmpressure_notifier(struct notifier_block *nb,
+				       unsigned long action, void *data)
+{
+	struct ion_system_heap *heap = container_of(nb, struct ion_system_heap,
+						    prefill_nb);
+
+	if (action >= prefill_pressure)
+		prefill_backoff(heap);
+	return 0;
+}
+
 static int ion_system_heap_allocate(struct ion_heap *heap,
 				     struct ion_buffer *buffer,
 				     unsigned long size, unsigned long align,
@@ -325,6 +440,8 @@ static int ion_system_heap_allocate(struct ion_heap *heap,
 	if (nents_sync)
 		sg_free_table(&table_sync);
 	msm_ion_heap_free_pages_mem(&data);
+	if (sys_heap->prefill_task && prefill_needed(sys_heap))
+		wake_up(&sys_heap->prefill_wait);
 	return 0;
 
 err_free_sg2:
@@ -411,6 +528,8 @@ static int ion_secure_page_pool_shrink(
 	if (nr_to_scan == 0)
 		return ion_page_pool_total(pool, true);
 
+	ion_page_pool_drain(pool);
+
 	while (freed < nr_to_scan) {
 		page = ion_page_pool_alloc_pool_only(pool);
 		if (!page)
@@ -539,12 +658,15 @@ static int ion_system_heap_debug_show(struct ion_heap *heap, struct seq_file *s,
 				pool->low_count, pool->order,
 				(1 << pool->order) * PAGE_SIZE *
 					pool->low_count);
+			ion_page_pool_debug_show_pcp(pool, s, "uncached");
 		}
 
 		uncached_total += (1 << pool->order) * PAGE_SIZE *
 			pool->high_count;
 		uncached_total += (1 << pool->order) * PAGE_SIZE *
 			pool->low_count;
+		uncached_total += (1 << pool->order) * PAGE_SIZE *
+			ion_page_pool_pcp_total(pool);
 	}
 
 	for (i = 0; i < num_orders; i++) {
@@ -559,12 +681,15 @@ static int ion_system_heap_debug_show(struct ion_heap *heap, struct seq_file *s,
 				pool->low_count, pool->order,
 				(1 << pool->order) * PAGE_SIZE *
 					pool->low_count);
+			ion_page_pool_debug_show_pcp(pool, s, "cached");
 		}
 
 		cached_total += (1 << pool->order) * PAGE_SIZE *
 			pool->high_count;
 		cached_total += (1 << pool->order) * PAGE_SIZE *
 			pool->low_count;
+		cached_total += (1 << pool->order) * PAGE_SIZE *
+			ion_page_pool_pcp_total(pool);
 	}
 
 	for (i = 0; i < num_orders; i++) {
@@ -584,12 +709,15 @@ static int ion_system_heap_debug_show(struct ion_heap *heap, struct seq_file *s,
 					j, pool->low_count, pool->order,
 					(1 << pool->order) * PAGE_SIZE *
 						pool->low_count);
+				ion_page_pool_debug_show_pcp(pool, s, "secure");
 			}
 
 			secure_total += (1 << pool->order) * PAGE_SIZE *
 				pool->high_count;
 			secure_total += (1 << pool->order) * PAGE_SIZE *
 				pool->low_count;
+			secure_total += (1 << pool->order) * PAGE_SIZE *
+				ion_page_pool_pcp_total(pool);
 		}
 	}
 
@@ -688,6 +816,16 @@ struct ion_heap *ion_system_heap_create(struct ion_platform_heap *unused)
 		goto err_create_cached_pools;
 
 	heap->heap.debug_show = ion_system_heap_debug_show;
+
+	init_waitqueue_head(&heap->prefill_wait);
+	heap->prefill_backoff = jiffies;
+	heap->prefill_nb.notifier_call = prefill_vmpressure_notifier;
+	vmpressure_notifier_register(&heap->prefill_nb);
+	heap->prefill_task = kthread_run(prefill_thread, heap, "ion_prefill");
+	if (IS_ERR(heap->prefill_task)) {
+		pr_err("%s: failed to start prefill thread\n", __func__);
+		heap->prefill_task = NULL;
+	}
 	return &heap->heap;
 
 err_create_cached_pools:
@@ -715,6 +853,10 @@ void ion_system_heap_destroy(struct ion_heap *heap)
 							heap);
 	int i, j;
 
+	vmpressure_notifier_unregister(&sys_heap->prefill_nb);
+	if (sys_heap->prefill_task)
+		kthread_stop(sys_heap->prefill_task);
+
 	for (i = 0; i < VMID_LAST; i++) {
 		if (!is_secure_vmid_valid(i))
 			continue;
@@ -13,6 +13,10 @@
  * drops below 4096 pages and kill processes with a oom_score_adj value of 0 or
  * higher when the free memory drops below 1024 pages.
  *
+ * Alternatively, writing 1 to /sys/module/lowmemorykiller/parameters/trigger
+ * makes the kill level follow the time tasks spent stalled in direct reclaim
+ * and the number of refaulting pages over stall_window_ms instead of minfree.
+ *
  * The driver considers memory used for caches to be free, but if a large
  * percentage of the cached memory is locked this can be very inaccurate
  * and processes may not get killed until the normal oom killer is triggered.
@@ -41,6 +45,8 @@
 #include <linux/rcupdate.h>
 #include <linux/notifier.h>
 #include <linux/cpuset.h>
+#include <linux/spinlock.h>
+#include <linux/vmpressure.h>
 
 #define CREATE_TRACE_POINTS
 #include "trace/lowmemorykiller.h"
@@ -75,6 +81,45 @@ static int lowmem_per_minfree_count[6];
 
 static unsigned long lowmem_deathpending_timeout;
 
+/*
+ * Kill trigger selection. LMK_TRIGGER_MINFREE kills when free and file
+ * pages drop below the minfree thresholds. LMK_TRIGGER_STALL instead kills
+ * based on how long tasks stalled in direct reclaim and how many pages
+ * refaulted into the active list over a sliding window; every
+ * stall_threshold_ms of stall and every refault_threshold refaults raise
+ * the kill level by one step down the adj array.
+ */
+enum {
+	LMK_TRIGGER_MINFREE,
+	LMK_TRIGGER_STALL,
+};
+static int lowmem_trigger = LMK_TRIGGER_MINFREE;
+static unsigned int lowmem_stall_window_ms = 1000;
+static unsigned int lowmem_stall_threshold_ms = 100;
+static unsigned int lowmem_refault_threshold = 4096;
+
+/*
+ * This parameter tracks the kill count per adj level for stall triggered
+ * kills since boot.
+ */
+static int lowmem_per_stall_count[6];
+
+#define LMK_STALL_BUCKETS	10
+
+struct lowmem_stall_window {
+	spinlock_t lock;
+	unsigned long bucket_start;
+	int cur;
+	u64 last_stall_ns;
+	unsigned long last_refaults;
+	u64 stall_ns[LMK_STALL_BUCKETS];
+	unsigned long refaults[LMK_STALL_BUCKETS];
+};
+
+static struct lowmem_stall_window lowmem_stall = {
+	.lock = __SPIN_LOCK_UNLOCKED(lowmem_stall.lock),
+};
+
 #define lowmem_print(level, x...)			\
 	do {						\
 		if (lowmem_debug_level >= (level))	\
@@ -109,6 +154,81 @@ static int test_task_flag(struct task_struct *p, int flag)
 	return 0;
 }
 
+/*
+ * Fold the reclaim stall time and refaults seen since the last sample into
+ * the current bucket, retire buckets that fell out of the window and
+ * return the totals over the whole window.
+ */
+static void lowmem_stall_sample(u64 *stall_ns, unsigned long *refaults)
+{
+	struct lowmem_stall_window *w = &lowmem_stall;
+	unsigned long bucket_len;
+	u64 stall = vmpressure_reclaim_stall_ns();
+	unsigned long refault = global_page_state(WORKINGSET_ACTIVATE);
+	int i;
+
+	bucket_len = msecs_to_jiffies(lowmem_stall_window_ms) /
+		     LMK_STALL_BUCKETS;
+	if (!bucket_len)
+		bucket_len = 1;
+
+	spin_lock(&w->lock);
+	for (i = 0; i < LMK_STALL_BUCKETS &&
+	     time_after_eq(jiffies, w->bucket_start + bucket_len); i++) {
+		w->cur = (w->cur + 1) % LMK_STALL_BUCKETS;
+		w->stall_ns[w->cur] = 0;
+		w->refaults[w->cur] = 0;
+		w->bucket_start += bucket_len;
+	}
+	if (time_after_eq(jiffies, w->bucket_start + bucket_len))
+		w->bucket_start = jiffies;
+
+	w->stall_ns[w->cur] += stall - w->last_stall_ns;
+	w->refaults[w->cur] += refault - w->last_refaults;
+	w->last_stall_ns = stall;
+	w->last_refaults = refault;
+
+	*stall_ns = 0;
+	*refaults = 0;
+	for (i = 0; i < LMK_STALL_BUCKETS; i++) {
+		*stall_ns += w->stall_ns[i];
+		*refaults += w->refaults[i];
+	}
+	spin_unlock(&w->lock);
+}
+
+/* Forget the window after a kill so the same stall is not acted on twice */
+static void lowmem_stall_reset(void)
+{
+	struct lowmem_stall_window *w = &lowmem_stall;
+
+	spin_lock(&w->lock);
+	memset(w->stall_ns, 0, sizeof(w->stall_ns));
+	memset(w->refaults, 0, sizeof(w->refaults));
+	spin_unlock(&w->lock);
+}
+
+static short lowmem_stall_adj(int array_size, u64 stall_ns,
+			      unsigned long refaults, int *offset)
+{
+	int level = 0;
+
+	if (array_size <= 0)
+		return OOM_SCORE_ADJ_MAX + 1;
+
+	if (lowmem_stall_threshold_ms)
+		level += div64_u64(stall_ns,
+			(u64)lowmem_stall_threshold_ms * NSEC_PER_MSEC);
+	if (lowmem_refault_threshold)
+		level += refaults / lowmem_refault_threshold;
+	if (!level)
+		return OOM_SCORE_ADJ_MAX + 1;
+
+	level = min(level, array_size);
+	*offset = array_size - level;
+	return lowmem_adj[*offset];
+}
+
 #ifdef CONFIG_ANDROID_LMK_ADJ_RBTREE
 static struct task_struct *pick_next_from_adj_tree(struct task_struct *task);
 static struct task_struct *pick_first_task(void);
@@ -133,6 +253,10 @@ static unsigned long lowmem_scan(struct shrinker *s, struct shrink_control *sc)
 						global_page_state(NR_UNEVICTABLE) -
 						total_swapcache_pages();
 	int minfree_count_offset = 0;
+	u64 stall_ns;
+	unsigned long refaults;
+
+	lowmem_stall_sample(&stall_ns, &refaults);
 
 	rcu_read_lock();
 	tsk = current->group_leader;
@@ -147,19 +271,26 @@ static unsigned long lowmem_scan(struct shrinker *s, struct shrink_control *sc)
 		array_size = lowmem_adj_size;
 	if (lowmem_minfree_size < array_size)
 		array_size = lowmem_minfree_size;
-	for (i = 0; i < array_size; i++) {
-		minfree = lowmem_minfree[i] +
-			  ((extra_free_kbytes * 1024) / PAGE_SIZE);
-		if (other_free < minfree && other_file < minfree) {
-			min_score_adj = lowmem_adj[i];
-			minfree_count_offset = i;
-			break;
+	if (lowmem_trigger == LMK_TRIGGER_STALL) {
+		min_score_adj = lowmem_stall_adj(array_size, stall_ns,
+						 refaults,
+						 &minfree_count_offset);
+	} else {
+		for (i = 0; i < array_size; i++) {
+			minfree = lowmem_minfree[i] +
+				  ((extra_free_kbytes * 1024) / PAGE_SIZE);
+			if (other_free < minfree && other_file < minfree) {
+				min_score_adj = lowmem_adj[i];
+				minfree_count_offset = i;
+				break;
+			}
 		}
 	}
 
-	lowmem_print(3, "lowmem_scan %lu, %x, ofree %d %d, ma %hd\n",
+	lowmem_print(3, "lowmem_scan %lu, %x, ofree %d %d, stall %llums %lu, ma %hd\n",
 			sc->nr_to_scan, sc->gfp_mask, other_free,
-			other_file, min_score_adj);
+			other_file, div64_u64(stall_ns, NSEC_PER_MSEC),
+			refaults, min_score_adj);
 
 	if (min_score_adj == OOM_SCORE_ADJ_MAX + 1) {
 		lowmem_print(5, "lowmem_scan %lu, %x, return 0\n",
@@ -243,7 +374,15 @@ static unsigned long lowmem_scan(struct shrinker *s, struct shrink_control *sc)
 		long cache_limit = minfree * (long)(PAGE_SIZE / 1024);
 		long free = other_free * (long)(PAGE_SIZE / 1024);
 		trace_lowmemory_kill(selected, cache_size, cache_limit, free);
-		lowmem_per_minfree_count[minfree_count_offset]++;
+		if (lowmem_trigger == LMK_TRIGGER_STALL) {
+			lowmem_per_stall_count[minfree_count_offset]++;
+			lowmem_print(1, "Reclaim stall %llums and %lu refaults in %ums window\n",
+				     div64_u64(stall_ns, NSEC_PER_MSEC),
+				     refaults, lowmem_stall_window_ms);
+			lowmem_stall_reset();
+		} else {
+			lowmem_per_minfree_count[minfree_count_offset]++;
+		}
 		lowmem_print(1, "Killing '%s' (%d), adj %hd,\n" \
 				"   to free %ldkB on behalf of '%s' (%d) because\n" \
 				"   cache %ldkB is below limit %ldkB for oom_score_adj %hd\n" \
@@ -389,6 +528,9 @@ static struct shrinker lowmem_shrinker = {
 
 static int __init lowmem_init(void)
 {
+	lowmem_stall.bucket_start = jiffies;
+	lowmem_stall.last_stall_ns = vmpressure_reclaim_stall_ns();
+	lowmem_stall.last_refaults = global_page_state(WORKINGSET_ACTIVATE);
 	register_shrinker(&lowmem_shrinker);
 	return 0;
 }
@@ -489,6 +631,15 @@ module_param_array_named(minfree, lowmem_minfree, uint, &lowmem_minfree_size,
 module_param_array_named(lmk_count, lowmem_per_minfree_count, uint, NULL,
 			 S_IRUGO);
 module_param_named(debug_level, lowmem_debug_level, uint, S_IRUGO | S_IWUSR);
+module_param_named(trigger, lowmem_trigger, int, S_IRUGO | S_IWUSR);
+module_param_named(stall_window_ms, lowmem_stall_window_ms, uint,
+		   S_IRUGO | S_IWUSR);
+module_param_named(stall_threshold_ms, lowmem_stall_threshold_ms, uint,
+		   S_IRUGO | S_IWUSR);
+module_param_named(refault_threshold, lowmem_refault_threshold, uint,
+		   S_IRUGO | S_IWUSR);
+module_param_array_named(lmk_stall_count, lowmem_per_stall_count, uint, NULL,
+			 S_IRUGO);
 
 module_init(lowmem_init);
 module_exit(lowmem_exit);
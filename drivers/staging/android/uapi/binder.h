@@ -508,5 +508,47 @@ enum binder_driver_command_protocol {
 	 */
 };
 
+/*
+ * Binary layout of the binder debugfs "transaction_latency" file: a
+ * header followed by nr_entries entries. Each entry holds the latency
+ * histograms of one interface, i.e. one (caller euid, callee pid, code)
+ * triple, as seen by one CPU. An interface shows up once per CPU that
+ * recorded it; readers sum the entries themselves.
+ *
+ * BINDER_LATENCY_QUEUE:  send to pick up by a callee thread
+ * BINDER_LATENCY_REPLY:  send to reply, synchronous transactions only
+ * BINDER_LATENCY_ALLOC:  target buffer allocation, replies included
+ *
+ * Histogram bucket n counts latencies below 2^n us, the last bucket
+ * everything above. Samples that did not fit in a CPU's table are only
+ * counted in dropped.
+ */
+enum {
+	BINDER_LATENCY_QUEUE,
+	BINDER_LATENCY_REPLY,
+	BINDER_LATENCY_ALLOC,
+	BINDER_LATENCY_NR_STATS,
+};
+
+#define BINDER_LATENCY_BUCKETS	20
+#define BINDER_LATENCY_VERSION	1
+
+struct binder_latency_header {
+	__u32 version;
+	__u32 nr_stats;
+	__u32 nr_buckets;
+	__u32 nr_entries;
+	__u32 dropped;
+	__u32 reserved[3];
+};
+
+struct binder_latency_entry {
+	__u32 uid;
+	__u32 pid;
+	__u32 code;
+	__u32 cpu;
+	__u32 hist[BINDER_LATENCY_NR_STATS][BINDER_LATENCY_BUCKETS];
+};
+
 #endif /* _UAPI_LINUX_BINDER_H */
 
@@ -48,6 +48,7 @@
 #include <vos_list.h>
 #include <linux/skbuff.h>
 #include <linux/list.h>
+#include <linux/workqueue.h>
 
 #include <wlan_qct_pal_packet.h>
 #include <wlan_qct_wdi_ds.h>
@@ -186,6 +187,14 @@ typedef struct vos_pkt_context_s
    // Count for the number of packets that could not be replenished
    // because the memory allocation API failed
    v_SIZE_t rxReplenishFailCount;
+
+   // Count for the number of times the RX path found the Rx Raw pool
+   // empty and had to wait for a packet
+   v_SIZE_t rxRawStarveCount;
+
+   // Refills the Rx Raw pool from process context so that the RX path
+   // only allocates skbs itself once the pool has run dry
+   struct work_struct rxReplenishWork;
    //Existing list_size opearation traverse the list. Too slow for data path.
    //Add the field for a faster rx path
    v_SIZE_t rxRawFreeListCount;
@@ -47,6 +47,8 @@
 #include <vos_trace.h>
 #include <wlan_hdd_main.h>   
 #include <linux/wcnss_wlan.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 /*--------------------------------------------------------------------------
   Preprocessor definitions and constants
@@ -170,12 +172,45 @@ static VOS_STATUS vos_pkti_list_destroy( struct list_head *pList )
 }
 
 
+// hand the first free Rx Raw packet to the pending low resource callback.
+// called with rxReplenishListLock and rxRawFreeListLock held, releases both
+static void vos_pkti_rx_raw_notify_locked(void)
+{
+   struct vos_pkt_t *pVosPacket;
+   vos_pkt_get_packet_callback callback;
+
+   // remove the first record from the free pool
+   pVosPacket = list_first_entry(&gpVosPacketContext->rxRawFreeList,
+                                 struct vos_pkt_t, node);
+   list_del(&pVosPacket->node);
+   gpVosPacketContext->rxRawFreeListCount--;
+
+   // clear out the User Data pointers in the voss packet..
+   memset(&pVosPacket->pvUserData, 0, sizeof(pVosPacket->pvUserData));
+
+   // initialize the 'chain' pointer to NULL.
+   pVosPacket->pNext = NULL;
+
+   // timestamp the vos packet.
+   pVosPacket->timestamp = vos_timer_get_system_ticks();
+
+   VOS_TRACE(VOS_MODULE_ID_VOSS, VOS_TRACE_LEVEL_INFO,
+             "VPKT [%d]: [%pK] Packet replenish callback",
+             __LINE__, pVosPacket);
+
+   callback = gpVosPacketContext->rxRawLowResourceInfo.callback;
+   gpVosPacketContext->rxRawLowResourceInfo.callback = NULL;
+   mutex_unlock(&gpVosPacketContext->rxRawFreeListLock);
+   mutex_unlock(&gpVosPacketContext->rxReplenishListLock);
+   callback(pVosPacket, gpVosPacketContext->rxRawLowResourceInfo.userData);
+}
+
+
 static void vos_pkti_replenish_raw_pool(void)
 {
    struct sk_buff * pSkb;
    struct vos_pkt_t *pVosPacket;
    v_BOOL_t didOne = VOS_FALSE;
-   vos_pkt_get_packet_callback callback;
 
    // if there are no packets in the replenish pool then we can't do anything
    mutex_lock(&gpVosPacketContext->rxReplenishListLock);
@@ -185,16 +220,15 @@ static void vos_pkti_replenish_raw_pool(void)
       return;
    }
 
-   // we only replenish if the Rx Raw pool is empty or the Replenish pool
-   // reaches a high water mark
+   // we only replenish in line if the Rx Raw pool is empty, otherwise
+   // the worker refills it without allocating in the RX path
    mutex_lock(&gpVosPacketContext->rxRawFreeListLock);
 
-   if ((gpVosPacketContext->rxReplenishListCount <
-        gpVosPacketContext->numOfRxRawPackets/4) &&
-         (!list_empty(&gpVosPacketContext->rxRawFreeList)))
+   if (!list_empty(&gpVosPacketContext->rxRawFreeList))
    {
       mutex_unlock(&gpVosPacketContext->rxRawFreeListLock);
       mutex_unlock(&gpVosPacketContext->rxReplenishListLock);
+      schedule_work(&gpVosPacketContext->rxReplenishWork);
       return;
    }
 
@@ -240,39 +274,141 @@ static void vos_pkti_replenish_raw_pool(void)
    if ((VOS_TRUE == didOne) &&
        (gpVosPacketContext->rxRawLowResourceInfo.callback))
    {
-      // remove the first record from the free pool
-      pVosPacket = list_first_entry(&gpVosPacketContext->rxRawFreeList,
-                                    struct vos_pkt_t, node);
-      list_del(&pVosPacket->node);
-      gpVosPacketContext->rxRawFreeListCount--;
+      vos_pkti_rx_raw_notify_locked();
+   }
+   else
+   {
+      mutex_unlock(&gpVosPacketContext->rxRawFreeListLock);
+      mutex_unlock(&gpVosPacketContext->rxReplenishListLock);
+   }
+}
 
-      // clear out the User Data pointers in the voss packet..
-      memset(&pVosPacket->pvUserData, 0, sizeof(pVosPacket->pvUserData));
 
-      // initialize the 'chain' pointer to NULL.
-      pVosPacket->pNext = NULL;
+static void vos_pkti_replenish_work(struct work_struct *work)
+{
+   struct sk_buff * pSkb;
+   struct vos_pkt_t *pVosPacket;
+   v_BOOL_t didOne = VOS_FALSE;
 
-      // timestamp the vos packet.
-      pVosPacket->timestamp = vos_timer_get_system_ticks();
+   // allocate outside of the pool locks so that the RX path is never
+   // held up by memory reclaim
+   while (gpVosPacketContext->rxReplenishListCount)
+   {
+      pSkb = alloc_skb(VPKT_SIZE_BUFFER, GFP_KERNEL);
+      if (unlikely(NULL == pSkb))
+      {
+         mutex_lock(&gpVosPacketContext->rxReplenishListLock);
+         gpVosPacketContext->rxReplenishFailCount++;
+         mutex_unlock(&gpVosPacketContext->rxReplenishListLock);
+         break;
+      }
+      skb_reserve(pSkb, VPKT_SIZE_BUFFER);
 
-      VOS_TRACE(VOS_MODULE_ID_VOSS, VOS_TRACE_LEVEL_INFO,
-                "VPKT [%d]: [%pK] Packet replenish callback",
-                __LINE__, pVosPacket);
+      mutex_lock(&gpVosPacketContext->rxReplenishListLock);
+      if (0 == gpVosPacketContext->rxReplenishListCount)
+      {
+         // the RX path replenished in line meanwhile
+         mutex_unlock(&gpVosPacketContext->rxReplenishListLock);
+         kfree_skb(pSkb);
+         break;
+      }
+      pVosPacket = list_first_entry(&gpVosPacketContext->rxReplenishList,
+                                    struct vos_pkt_t, node);
+      list_del(&pVosPacket->node);
+      gpVosPacketContext->rxReplenishListCount--;
 
-      callback = gpVosPacketContext->rxRawLowResourceInfo.callback;
-      gpVosPacketContext->rxRawLowResourceInfo.callback = NULL;
+      pVosPacket->pSkb = pSkb;
+
+      mutex_lock(&gpVosPacketContext->rxRawFreeListLock);
+      list_add_tail(&pVosPacket->node, &gpVosPacketContext->rxRawFreeList);
+      gpVosPacketContext->rxRawFreeListCount++;
       mutex_unlock(&gpVosPacketContext->rxRawFreeListLock);
       mutex_unlock(&gpVosPacketContext->rxReplenishListLock);
-      callback(pVosPacket, gpVosPacketContext->rxRawLowResourceInfo.userData);
+
+      didOne = VOS_TRUE;
    }
-   else
+
+   // a waiter may have registered before the packets came back
+   if (VOS_TRUE == didOne)
    {
-      mutex_unlock(&gpVosPacketContext->rxRawFreeListLock);
-      mutex_unlock(&gpVosPacketContext->rxReplenishListLock);
+      mutex_lock(&gpVosPacketContext->rxReplenishListLock);
+      mutex_lock(&gpVosPacketContext->rxRawFreeListLock);
+      if ((gpVosPacketContext->rxRawLowResourceInfo.callback) &&
+          (!list_empty(&gpVosPacketContext->rxRawFreeList)))
+      {
+         vos_pkti_rx_raw_notify_locked();
+      }
+      else
+      {
+         mutex_unlock(&gpVosPacketContext->rxRawFreeListLock);
+         mutex_unlock(&gpVosPacketContext->rxReplenishListLock);
+      }
    }
 }
 
 
+#ifdef CONFIG_DEBUG_FS
+static struct dentry *gpVosPktDebugfsDir;
+
+static int vos_pkti_rx_pool_show(struct seq_file *s, void *unused)
+{
+   mutex_lock(&gpVosPacketContext->rxReplenishListLock);
+   mutex_lock(&gpVosPacketContext->rxRawFreeListLock);
+
+   seq_printf(s, "rx_raw_packets: %u\n",
+              gpVosPacketContext->numOfRxRawPackets);
+   seq_printf(s, "rx_raw_free: %u\n",
+              gpVosPacketContext->rxRawFreeListCount);
+   seq_printf(s, "rx_replenish_pending: %u\n",
+              gpVosPacketContext->rxReplenishListCount);
+   seq_printf(s, "rx_replenish_failures: %u\n",
+              gpVosPacketContext->rxReplenishFailCount);
+   seq_printf(s, "rx_starvation: %u\n",
+              gpVosPacketContext->rxRawStarveCount);
+
+   mutex_unlock(&gpVosPacketContext->rxRawFreeListLock);
+   mutex_unlock(&gpVosPacketContext->rxReplenishListLock);
+
+   return 0;
+}
+
+static int vos_pkti_rx_pool_open(struct inode *inode, struct file *file)
+{
+   return single_open(file, vos_pkti_rx_pool_show, NULL);
+}
+
+static const struct file_operations vos_pkti_rx_pool_fops = {
+   .owner = THIS_MODULE,
+   .open = vos_pkti_rx_pool_open,
+   .read = seq_read,
+   .llseek = seq_lseek,
+   .release = single_release,
+};
+
+static void vos_pkti_debugfs_init(void)
+{
+   gpVosPktDebugfsDir = debugfs_create_dir("wlan_vos_pkt", NULL);
+   if (IS_ERR_OR_NULL(gpVosPktDebugfsDir))
+   {
+      gpVosPktDebugfsDir = NULL;
+      return;
+   }
+
+   debugfs_create_file("rx_pool", S_IRUSR, gpVosPktDebugfsDir, NULL,
+                       &vos_pkti_rx_pool_fops);
+}
+
+static void vos_pkti_debugfs_exit(void)
+{
+   debugfs_remove_recursive(gpVosPktDebugfsDir);
+   gpVosPktDebugfsDir = NULL;
+}
+#else
+static inline void vos_pkti_debugfs_init(void) {}
+static inline void vos_pkti_debugfs_exit(void) {}
+#endif
+
+
 #if defined( WLAN_DEBUG )
 static char *vos_pkti_packet_type_str(VOS_PKT_TYPE pktType)
 {
@@ -388,6 +524,8 @@ VOS_STATUS vos_packet_open( v_VOID_t *pVosContext,
       mutex_init(&gpVosPacketContext->rxReplenishListLock);
       INIT_LIST_HEAD(&pVosPacketContext->rxReplenishList);
       pVosPacketContext->rxReplenishListCount = 0;
+      INIT_WORK(&pVosPacketContext->rxReplenishWork,
+                vos_pkti_replenish_work);
 
       // index into the packet context's vosPktBuffer[] array
       freePacketIndex = 0;
@@ -489,6 +627,8 @@ VOS_STATUS vos_packet_open( v_VOID_t *pVosContext,
          break;
       }
 
+      vos_pkti_debugfs_init();
+
    } while (0);
 
    return vosStatus;
@@ -536,6 +676,9 @@ VOS_STATUS vos_packet_close( v_PVOID_t pVosContext )
    }
 
 
+   vos_pkti_debugfs_exit();
+   cancel_work_sync(&gpVosPacketContext->rxReplenishWork);
+
    mutex_lock(&gpVosPacketContext->txMgmtFreeListLock);
    (void) vos_pkti_list_destroy(&gpVosPacketContext->txMgmtFreeList);
    mutex_unlock(&gpVosPacketContext->txMgmtFreeListLock);
@@ -721,6 +864,11 @@ VOS_STATUS vos_pkt_get_packet( vos_pkt_t **ppPacket,
    // are there vos packets on the associated free pool?
    if (unlikely(list_empty(pPktFreeList)))
    {
+      if (VOS_PKT_TYPE_RX_RAW == pktType)
+      {
+         gpVosPacketContext->rxRawStarveCount++;
+      }
+
       // allocation failed
       // did the caller specify a callback?
       if (unlikely(NULL == callback))
@@ -22,6 +22,7 @@
 #include <linux/err.h>
 #include <linux/of.h>
 #include <linux/mutex.h>
+#include <linux/sched.h>
 #include "lmh_interface.h"
 #include <linux/slab.h>
 #include <asm/cacheflush.h>
@@ -170,6 +171,8 @@ struct lmh_sensor_data {
 	int				sensor_sw_id;
 	struct lmh_sensor_ops		ops;
 	long				last_read_value;
+	cpumask_t			cpus;
+	unsigned long			pressure;
 	struct list_head		list_ptr;
 };
 
@@ -275,6 +278,27 @@ enable_exit:
 	return ret;
 }
 
+/*
+ * Throttling intensity is reported as a percentage of the maximum. Pass it
+ * to the scheduler as the capacity lost on the cpus the sensor limits.
+ */
+static void lmh_update_pressure(struct lmh_sensor_data *lmh_sensor)
+{
+	unsigned long pressure;
+
+	if (cpumask_empty(&lmh_sensor->cpus))
+		return;
+
+	pressure = (clamp_val(lmh_sensor->last_read_value, 0, 100)
+			* SCHED_CAPACITY_SCALE) / 100;
+	if (pressure == lmh_sensor->pressure)
+		return;
+
+	lmh_sensor->pressure = pressure;
+	sched_set_thermal_pressure(&lmh_sensor->cpus, SCHED_THERMAL_LMH,
+			pressure);
+}
+
 static void lmh_update(struct lmh_driver_data *lmh_dat,
 	struct lmh_sensor_data *lmh_sensor)
 {
@@ -294,6 +318,7 @@ static void lmh_update(struct lmh_driver_data *lmh_dat,
 
 		lmh_data->intr_status_val ^= BIT(lmh_sensor->sensor_sw_id);
 	}
+	lmh_update_pressure(lmh_sensor);
 	lmh_sensor->ops.new_value_notify(&lmh_sensor->ops,
 		lmh_sensor->last_read_value);
 }
@@ -583,6 +608,40 @@ static int lmh_check_tz_sensor_cmds(void)
 	return 0;
 }
 
+/*
+ * Optional "qcom,lmh-sensor-cpus" lists <node-id cpu-mask> pairs mapping the
+ * sensors that limit cpu clusters to the cpus they limit.
+ */
+static void lmh_get_sensor_cpus(struct lmh_sensor_data *lmh_sensor)
+{
+	struct device_node *node = lmh_data->dev->of_node;
+	char *key = "qcom,lmh-sensor-cpus";
+	uint32_t node_id = 0, mask = 0;
+	int idx = 0, cnt = 0, cpu = 0;
+
+	cpumask_clear(&lmh_sensor->cpus);
+	if (!of_get_property(node, key, &cnt) || cnt <= 0)
+		return;
+
+	cnt /= sizeof(__be32);
+	for (idx = 0; idx + 1 < cnt; idx += 2) {
+		if (of_property_read_u32_index(node, key, idx, &node_id)
+			|| of_property_read_u32_index(node, key, idx + 1,
+				&mask))
+			break;
+		if (node_id != lmh_sensor->sensor_hw_node_id)
+			continue;
+		for_each_possible_cpu(cpu) {
+			if (mask & BIT(cpu))
+				cpumask_set_cpu(cpu, &lmh_sensor->cpus);
+		}
+		pr_debug("Sensor:[%s] limits cpus:%*pbl\n",
+			lmh_sensor->sensor_name,
+			cpumask_pr_args(&lmh_sensor->cpus));
+		break;
+	}
+}
+
 static int lmh_parse_sensor(struct lmh_sensor_info *sens_info)
 {
 	int ret = 0, idx = 0, size = 0;
@@ -616,6 +675,7 @@ static int lmh_parse_sensor(struct lmh_sensor_info *sens_info)
 	lmh_sensor->sensor_sw_id = lmh_data->max_sensor_count++;
 	lmh_sensor->sensor_hw_name = sens_info->name;
 	lmh_sensor->sensor_hw_node_id = sens_info->node_id;
+	lmh_get_sensor_cpus(lmh_sensor);
 	ret = lmh_sensor_register(lmh_sensor->sensor_name, &lmh_sensor->ops);
 	if (ret) {
 		pr_err("Sensor:[%s] registration failed. err:%d\n",
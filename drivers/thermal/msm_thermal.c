@@ -41,6 +41,7 @@
 #include <soc/qcom/scm.h>
 #include <linux/debugfs.h>
 #include <linux/pm_opp.h>
+#include <linux/sched.h>
 #include <linux/sched/rt.h>
 #include <linux/notifier.h>
 #include <linux/reboot.h>
@@ -1004,11 +1005,32 @@ static struct notifier_block msm_thermal_cpufreq_notifier = {
 	.notifier_call = msm_thermal_cpufreq_callback,
 };
 
+/*
+ * Tell the scheduler how much capacity the new limit takes away, so that it
+ * moves work off the cpu without waiting for the policy update.
+ */
+static void update_cpu_thermal_pressure(int cpu)
+{
+	uint32_t max_freq = get_core_max_freq(cpu);
+	uint32_t limit = (SYNC_CORE(cpu)) ?
+		cpus[cpu].parent_ptr->limited_max_freq :
+		cpus[cpu].limited_max_freq;
+	unsigned long pressure = 0;
+
+	if (max_freq && limit < max_freq)
+		pressure = SCHED_CAPACITY_SCALE -
+			div_u64((u64)limit << SCHED_CAPACITY_SHIFT, max_freq);
+
+	sched_set_thermal_pressure(cpumask_of(cpu), SCHED_THERMAL_SW,
+			pressure);
+}
+
 static void update_cpu_freq(int cpu)
 {
 	int ret = 0;
 	cpumask_t mask;
 
+	update_cpu_thermal_pressure(cpu);
 	get_cluster_mask(cpu, &mask);
 	if (cpu_online(cpu)) {
 		if ((cpumask_intersects(&mask, &throttling_mask))
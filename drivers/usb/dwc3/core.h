@@ -585,6 +585,7 @@ struct dwc3_ep {
 	struct dwc3_ep_events	dbg_ep_events;
 	struct dwc3_ep_events	dbg_ep_events_diff;
 	struct timespec		dbg_ep_events_ts;
+	u64			dbg_ep_bytes;	/* completed since stats reset */
 	int			fifo_depth;
 };
 
@@ -1125,6 +1125,7 @@ static ssize_t dwc3_store_int_events(struct file *file,
 		memset(&dep->dbg_ep_events, 0, sizeof(dep->dbg_ep_events));
 		memset(&dep->dbg_ep_events_diff, 0, sizeof(dep->dbg_ep_events));
 		dep->dbg_ep_events_ts = ts;
+		dep->dbg_ep_bytes = 0;
 	}
 	memset(&dwc->dbg_gadget_events, 0, sizeof(dwc->dbg_gadget_events));
 
@@ -1204,6 +1205,10 @@ static int dwc3_gadget_int_events_show(struct seq_file *s, void *unused)
 			dep->dbg_ep_events.total,
 			ep_event_rate(total, dep->dbg_ep_events,
 				dep->dbg_ep_events_diff, ts_delta_ms));
+		seq_printf(s, "bytes:%llu interrupts/MB:%llu\n",
+			dep->dbg_ep_bytes, dep->dbg_ep_bytes ?
+			div64_u64((u64)dep->dbg_ep_events.total << 20,
+				dep->dbg_ep_bytes) : 0);
 
 		dep->dbg_ep_events_ts = ts_current;
 		dep->dbg_ep_events_diff = dep->dbg_ep_events;
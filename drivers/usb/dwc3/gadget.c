@@ -2600,6 +2600,7 @@ static int dwc3_cleanup_done_reqs(struct dwc3 *dwc, struct dwc3_ep *dep,
 					(trb->ctrl & DWC3_TRB_CTRL_IOC))
 				ret = 1;
 		}
+		dep->dbg_ep_bytes += req->request.actual;
 		dwc3_gadget_giveback(dep, req, status);
 
 		/* EP possibly disabled during giveback? */
@@ -2654,6 +2655,25 @@ static void dwc3_endpoint_transfer_complete(struct dwc3 *dwc,
 				usb_endpoint_xfer_isoc(dep->endpoint.desc)))
 		dep->flags &= ~DWC3_EP_BUSY;
 
+	/*
+	 * Requests queued while the transfer was active, including those
+	 * re-queued from the completion callbacks above, are chained into
+	 * a single new transfer right away instead of waiting for the host
+	 * to trigger XferNotReady. With nothing left to send, flag the
+	 * endpoint so the next queued request starts the transfer.
+	 */
+	if (is_xfer_complete && !(dep->flags & DWC3_EP_BUSY) &&
+			(dep->flags & DWC3_EP_ENABLED) &&
+			!usb_endpoint_xfer_isoc(dep->endpoint.desc) &&
+			!dep->stream_capable && list_empty(&dep->req_queued)) {
+		int ret;
+
+		ret = __dwc3_gadget_kick_transfer(dep, 0, 1);
+		if (ret && ret != -EBUSY)
+			dev_dbg(dwc->dev, "%s: failed to kick transfers\n",
+					dep->name);
+	}
+
 	/*
 	 * WORKAROUND: This is the 2nd half of U1/U2 -> U0 workaround.
 	 * See dwc3_gadget_linksts_change_interrupt() for 1st half.
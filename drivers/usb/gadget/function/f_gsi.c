@@ -36,6 +36,11 @@ module_param(gsi_in_rndis_aggr_size, uint, S_IRUGO | S_IWUSR);
 MODULE_PARM_DESC(gsi_in_rndis_aggr_size,
 		"Aggr size of bus transfer to host for RNDIS");
 
+static unsigned int gsi_out_max_pkts = DEFAULT_MAX_PKT_PER_XFER;
+module_param(gsi_out_max_pkts, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(gsi_out_max_pkts,
+		"Max packets per RNDIS bus transfer to device");
+
 static unsigned int num_in_bufs = GSI_NUM_IN_BUFFERS;
 module_param(num_in_bufs, uint, S_IRUGO | S_IWUSR);
 MODULE_PARM_DESC(num_in_bufs,
@@ -777,28 +782,34 @@ static int ipa_connect_channels(struct gsi_data_port *d_port)
 	conn_params->ipa_to_usb_xferrscidx_valid = true;
 	conn_params->teth_prot = gsi->prot_id;
 	conn_params->teth_prot_params.max_xfer_size_bytes_to_dev = 23700;
-	if (gsi_out_aggr_size)
+	/* an OUT transfer can't be larger than the buffer of its TRB */
+	if (gsi_out_aggr_size && d_port->out_ep)
 		conn_params->teth_prot_params.max_xfer_size_bytes_to_dev
-				= gsi_out_aggr_size;
+				= min_t(u32, gsi_out_aggr_size,
+					d_port->out_request.buf_len);
 	else
 		conn_params->teth_prot_params.max_xfer_size_bytes_to_dev
 				= d_port->out_aggr_size;
-	if (gsi_in_aggr_size) {
-		conn_params->teth_prot_params.max_xfer_size_bytes_to_host
-					= gsi_in_aggr_size;
-	} else {
 
-		if (gsi->prot_id == IPA_USB_RNDIS) {
-			dl_aggr_size = min_t(u32, d_port->in_aggr_size,
-				rndis_get_dl_max_xfer_size(gsi->config));
-		} else {
-			dl_aggr_size = d_port->in_aggr_size;
-		}
-		conn_params->teth_prot_params.max_xfer_size_bytes_to_host
-					= dl_aggr_size;
-	}
+	/* never aggregate more than the host said it can take */
+	dl_aggr_size = gsi_in_aggr_size ? : d_port->in_aggr_size;
+	if (gsi->prot_id == IPA_USB_RNDIS)
+		dl_aggr_size = min_t(u32, dl_aggr_size,
+			rndis_get_dl_max_xfer_size(gsi->config));
+	else if (gsi->prot_id == IPA_USB_MBIM &&
+		 d_port->ntb_info.ntb_input_size)
+		dl_aggr_size = min_t(u32, dl_aggr_size,
+			d_port->ntb_info.ntb_input_size);
+	conn_params->teth_prot_params.max_xfer_size_bytes_to_host
+				= dl_aggr_size;
 	conn_params->teth_prot_params.max_packet_number_to_dev =
+		gsi->prot_id == IPA_USB_RNDIS ? d_port->out_max_pkts :
 		DEFAULT_MAX_PKT_PER_XFER;
+
+	log_event_dbg("%s: aggr to_dev:%u pkts:%u to_host:%u", __func__,
+		conn_params->teth_prot_params.max_xfer_size_bytes_to_dev,
+		conn_params->teth_prot_params.max_packet_number_to_dev,
+		conn_params->teth_prot_params.max_xfer_size_bytes_to_host);
 	conn_params->max_supported_bandwidth_mbps =
 		(cdev->gadget->speed == USB_SPEED_SUPER) ? 3600 : 400;
 
@@ -2991,9 +3002,12 @@ static int gsi_bind(struct usb_configuration *c, struct usb_function *f)
 				gsi->manufacturer))
 			goto dereg_rndis;
 
+		/* the host is told this once, keep it for connect */
+		gsi->d_port.out_max_pkts = clamp_t(unsigned int,
+				gsi_out_max_pkts, 1, U8_MAX);
 		log_event_dbg("%s: max_pkt_per_xfer : %d", __func__,
-					DEFAULT_MAX_PKT_PER_XFER);
-		rndis_set_max_pkt_xfer(gsi->config, DEFAULT_MAX_PKT_PER_XFER);
+					gsi->d_port.out_max_pkts);
+		rndis_set_max_pkt_xfer(gsi->config, gsi->d_port.out_max_pkts);
 
 		/* In case of aggregated packets QC device will request
 		 * aliment to 4 (2^2).
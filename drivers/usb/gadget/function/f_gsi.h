@@ -191,6 +191,7 @@ struct gsi_data_port {
 	u16 cdc_filter;
 	u32 in_aggr_size;
 	u32 out_aggr_size;
+	u8 out_max_pkts;
 
 	bool ipa_ready;
 	bool net_ready_trigger;
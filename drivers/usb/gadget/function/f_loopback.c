@@ -247,11 +247,15 @@ static void loopback_complete(struct usb_ep *ep, struct usb_request *req)
 {
 	struct f_loopback	*loop = ep->driver_data;
 	struct usb_composite_dev *cdev = loop->function.config->cdev;
+	struct f_lb_opts	*opts = container_of(loop->function.fi,
+					struct f_lb_opts, func_inst);
 	int			status = req->status;
 
 	switch (status) {
 
 	case 0:				/* normal completion? */
+		atomic64_add(req->actual, ep == loop->out_ep ?
+			     &opts->bytes_out : &opts->bytes_in);
 		if (ep == loop->out_ep) {
 			req->zero = (req->actual < req->length);
 			req->length = req->actual;
@@ -513,9 +517,68 @@ static struct f_lb_opts_attribute f_lb_opts_bulk_buflen =
 			f_lb_opts_bulk_buflen_show,
 			f_lb_opts_bulk_buflen_store);
 
+/*
+ * With the host reading and writing at full speed, sampling these over
+ * time gives the throughput of each direction. Writing 0 clears them.
+ */
+static ssize_t f_lb_opts_bytes_show(atomic64_t *bytes, char *page)
+{
+	return sprintf(page, "%llu", (u64)atomic64_read(bytes));
+}
+
+static ssize_t f_lb_opts_bytes_store(atomic64_t *bytes,
+				     const char *page, size_t len)
+{
+	int ret;
+	u64 num;
+
+	ret = kstrtou64(page, 0, &num);
+	if (ret)
+		return ret;
+	if (num)
+		return -EINVAL;
+
+	atomic64_set(bytes, 0);
+	return len;
+}
+
+static ssize_t f_lb_opts_bytes_in_show(struct f_lb_opts *opts, char *page)
+{
+	return f_lb_opts_bytes_show(&opts->bytes_in, page);
+}
+
+static ssize_t f_lb_opts_bytes_in_store(struct f_lb_opts *opts,
+					const char *page, size_t len)
+{
+	return f_lb_opts_bytes_store(&opts->bytes_in, page, len);
+}
+
+static struct f_lb_opts_attribute f_lb_opts_bytes_in =
+	__CONFIGFS_ATTR(bytes_in, S_IRUGO | S_IWUSR,
+			f_lb_opts_bytes_in_show,
+			f_lb_opts_bytes_in_store);
+
+static ssize_t f_lb_opts_bytes_out_show(struct f_lb_opts *opts, char *page)
+{
+	return f_lb_opts_bytes_show(&opts->bytes_out, page);
+}
+
+static ssize_t f_lb_opts_bytes_out_store(struct f_lb_opts *opts,
+					 const char *page, size_t len)
+{
+	return f_lb_opts_bytes_store(&opts->bytes_out, page, len);
+}
+
+static struct f_lb_opts_attribute f_lb_opts_bytes_out =
+	__CONFIGFS_ATTR(bytes_out, S_IRUGO | S_IWUSR,
+			f_lb_opts_bytes_out_show,
+			f_lb_opts_bytes_out_store);
+
 static struct configfs_attribute *lb_attrs[] = {
 	&f_lb_opts_qlen.attr,
 	&f_lb_opts_bulk_buflen.attr,
+	&f_lb_opts_bytes_in.attr,
+	&f_lb_opts_bytes_out.attr,
 	NULL,
 };
 
@@ -296,6 +296,7 @@ struct fsg_common {
 	struct fsg_buffhd	*next_buffhd_to_drain;
 	struct fsg_buffhd	*buffhds;
 	unsigned int		fsg_num_buffers;
+	unsigned int		buflen;		/* size of each buffhd */
 	int			cmnd_size;
 	u8			cmnd[MAX_COMMAND_SIZE];
 
@@ -742,7 +743,7 @@ static int do_read(struct fsg_common *common)
 		 * But don't read more than the buffer size.
 		 * And don't try to read past the end of the file.
 		 */
-		amount = min(amount_left, FSG_BUFLEN);
+		amount = min(amount_left, common->buflen);
 		amount = min((loff_t)amount,
 			     curlun->file_length - file_offset);
 
@@ -909,7 +910,7 @@ static int do_write(struct fsg_common *common)
 			 * Try to get the remaining amount,
 			 * but not more than the buffer size.
 			 */
-			amount = min(amount_left_to_req, FSG_BUFLEN);
+			amount = min(amount_left_to_req, common->buflen);
 
 			/* Beyond the end of the backing file? */
 			if (usb_offset >= curlun->file_length) {
@@ -1166,7 +1167,7 @@ static int do_verify(struct fsg_common *common)
 		 * the buffer size.
 		 * And don't try to read past the end of the file.
 		 */
-		amount = min(amount_left, FSG_BUFLEN);
+		amount = min(amount_left, common->buflen);
 		amount = min((loff_t)amount,
 			     curlun->file_length - file_offset);
 		if (amount == 0) {
@@ -1714,7 +1715,7 @@ static int throw_away_data(struct fsg_common *common)
 		bh = common->next_buffhd_to_fill;
 		if (bh->state == BUF_STATE_EMPTY
 		 && common->usb_amount_left > 0) {
-			amount = min(common->usb_amount_left, FSG_BUFLEN);
+			amount = min(common->usb_amount_left, common->buflen);
 
 			/*
 			 * Except at the end of the transfer, amount will be
@@ -2987,13 +2988,33 @@ EXPORT_SYMBOL_GPL(fsg_common_put);
 /* check if fsg_num_buffers is within a valid range */
 static inline int fsg_num_buffers_validate(unsigned int fsg_num_buffers)
 {
-	if (fsg_num_buffers >= 2 && fsg_num_buffers <= 4)
+	if (fsg_num_buffers >= 2 && fsg_num_buffers <= FSG_MAX_NUM_BUFFERS)
 		return 0;
 	pr_err("fsg_num_buffers %u is out of range (%d to %d)\n",
-	       fsg_num_buffers, 2, 4);
+	       fsg_num_buffers, 2, FSG_MAX_NUM_BUFFERS);
 	return -EINVAL;
 }
 
+/*
+ * Size of each pipeline buffer, applied when the buffers are allocated.
+ * Larger buffers mean fewer, longer vfs_read()/vfs_write() calls and USB
+ * transfers per command.
+ */
+static unsigned int fsg_buflen = FSG_BUFLEN;
+module_param_named(buflen, fsg_buflen, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(buflen, "Size of each pipeline buffer in bytes");
+
+static unsigned int fsg_buflen_get(void)
+{
+	unsigned int buflen = ACCESS_ONCE(fsg_buflen);
+
+	if (buflen >= FSG_BUFLEN && buflen <= FSG_MAX_BUFLEN &&
+	    IS_ALIGNED(buflen, PAGE_SIZE))
+		return buflen;
+	pr_err("fsg_buflen %u is invalid, using %u\n", buflen, FSG_BUFLEN);
+	return FSG_BUFLEN;
+}
+
 static int disable_restarts;
 module_param(disable_restarts, int, S_IRUGO | S_IWUSR);
 MODULE_PARM_DESC(disable_restarts, "Disable SCSI Initiated Reboots");
@@ -3064,6 +3085,7 @@ int fsg_common_set_num_buffers(struct fsg_common *common, unsigned int n)
 	struct fsg_buffhd *bh, *buffhds;
 	int i, rc;
 	size_t extra_buf_alloc = 0;
+	unsigned int buflen;
 
 	if (common->gadget)
 		extra_buf_alloc = common->gadget->extra_buf_alloc;
@@ -3072,6 +3094,8 @@ int fsg_common_set_num_buffers(struct fsg_common *common, unsigned int n)
 	if (rc != 0)
 		return rc;
 
+	buflen = fsg_buflen_get();
+
 	buffhds = kcalloc(n, sizeof(*buffhds), GFP_KERNEL);
 	if (!buffhds)
 		return -ENOMEM;
@@ -3084,7 +3108,7 @@ int fsg_common_set_num_buffers(struct fsg_common *common, unsigned int n)
 		bh->next = bh + 1;
 		++bh;
 buffhds_first_it:
-		bh->buf = kmalloc(FSG_BUFLEN + extra_buf_alloc,
+		bh->buf = kmalloc(buflen + extra_buf_alloc,
 				GFP_KERNEL);
 		if (unlikely(!bh->buf))
 			goto error_release;
@@ -3093,6 +3117,7 @@ buffhds_first_it:
 
 	_fsg_common_free_buffers(common->buffhds, common->fsg_num_buffers);
 	common->fsg_num_buffers = n;
+	common->buflen = buflen;
 	common->buffhds = buffhds;
 
 	return 0;
@@ -3557,7 +3582,7 @@ static int fsg_bind(struct usb_configuration *c, struct usb_function *f)
 		fsg_fs_bulk_out_desc.bEndpointAddress;
 
 	/* Calculate bMaxBurst, we know packet size is 1024 */
-	max_burst = min_t(unsigned, FSG_BUFLEN / 1024, 15);
+	max_burst = min_t(unsigned, fsg->common->buflen / 1024, 15);
 
 	fsg_ss_bulk_in_desc.bEndpointAddress =
 		fsg_fs_bulk_in_desc.bEndpointAddress;
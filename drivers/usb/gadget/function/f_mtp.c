@@ -59,7 +59,8 @@
 
 /* number of tx and rx requests to allocate */
 #define MTP_TX_REQ_MAX 8
-#define RX_REQ_MAX 2
+#define RX_REQ_MIN 2
+#define MTP_RX_REQ_MAX 8
 #define INTR_REQ_MAX 5
 
 /* ID for Microsoft MTP OS String */
@@ -78,6 +79,10 @@
 
 #define MAX_ITERATION		100
 
+#define MTP_RX_DEQUEUE_TIMEOUT_MS	100
+/* upper bound of the readahead window used for file sends */
+#define MTP_TX_RA_MAX_BYTES		(4 * 1024 * 1024)
+
 unsigned int mtp_rx_req_len = MTP_RX_BUFFER_INIT_SIZE;
 module_param(mtp_rx_req_len, uint, S_IRUGO | S_IWUSR);
 
@@ -87,6 +92,10 @@ module_param(mtp_tx_req_len, uint, S_IRUGO | S_IWUSR);
 unsigned int mtp_tx_reqs = MTP_TX_REQ_MAX;
 module_param(mtp_tx_reqs, uint, S_IRUGO | S_IWUSR);
 
+/* depth of the receive ring, requests in flight while one is written */
+unsigned int mtp_rx_reqs = 4;
+module_param(mtp_rx_reqs, uint, S_IRUGO | S_IWUSR);
+
 static const char mtp_shortname[] = DRIVER_NAME "_usb";
 
 struct mtp_dev {
@@ -111,8 +120,9 @@ struct mtp_dev {
 	wait_queue_head_t read_wq;
 	wait_queue_head_t write_wq;
 	wait_queue_head_t intr_wq;
-	struct usb_request *rx_req[RX_REQ_MAX];
-	int rx_done;
+	struct usb_request *rx_req[MTP_RX_REQ_MAX];
+	int rx_reqs;
+	int rx_done;	/* completed rx requests since last reset */
 
 	/* for processing MTP_SEND_FILE, MTP_RECEIVE_FILE and
 	 * MTP_SEND_FILE_WITH_HEADER ioctls on a work queue
@@ -135,6 +145,12 @@ struct mtp_dev {
 	} perf[MAX_ITERATION];
 	unsigned dbg_read_index;
 	unsigned dbg_write_index;
+	struct mtp_xfer_stats {
+		u64 bytes;
+		u64 time_us;
+		u64 last_bytes;
+		u64 last_time_us;
+	} send_stats, receive_stats;
 	bool is_ptp;
 };
 
@@ -492,8 +508,10 @@ static void mtp_complete_out(struct usb_ep *ep, struct usb_request *req)
 {
 	struct mtp_dev *dev = _mtp_dev;
 
-	dev->rx_done = 1;
-	if (req->status != 0 && dev->state != STATE_OFFLINE)
+	dev->rx_done++;
+	/* requests we dequeue ourselves are not an error */
+	if (req->status != 0 && req->status != -ECONNRESET &&
+			dev->state != STATE_OFFLINE)
 		dev->state = STATE_ERROR;
 
 	wake_up(&dev->read_wq);
@@ -581,10 +599,16 @@ retry_tx_alloc:
 	if (mtp_rx_req_len % 1024)
 		mtp_rx_req_len = MTP_BULK_BUFFER_SIZE;
 
+	mtp_rx_reqs = clamp_t(unsigned int, mtp_rx_reqs, RX_REQ_MIN,
+			MTP_RX_REQ_MAX);
+
 retry_rx_alloc:
-	for (i = 0; i < RX_REQ_MAX; i++) {
+	for (i = 0; i < mtp_rx_reqs; i++) {
 		req = mtp_request_new(dev->ep_out, mtp_rx_req_len);
 		if (!req) {
+			/* a shallower ring of large buffers will do */
+			if (i >= RX_REQ_MIN)
+				break;
 			if (mtp_rx_req_len <= MTP_BULK_BUFFER_SIZE)
 				goto fail;
 			for (--i; i >= 0; i--)
@@ -595,6 +619,7 @@ retry_rx_alloc:
 		req->complete = mtp_complete_out;
 		dev->rx_req[i] = req;
 	}
+	dev->rx_reqs = i;
 	for (i = 0; i < INTR_REQ_MAX; i++) {
 		req = mtp_request_new(dev->ep_intr,
 				INTR_BUFFER_SIZE + extra_buf_alloc);
@@ -796,6 +821,33 @@ static ssize_t mtp_write(struct file *fp, const char __user *buf,
 	return r;
 }
 
+/* dequeue the @inflight rx requests starting at @head and reap them */
+static void mtp_rx_dequeue(struct mtp_dev *dev, int head, int inflight,
+		int reaped)
+{
+	int i;
+
+	for (i = 0; i < inflight; i++)
+		usb_ep_dequeue(dev->ep_out,
+				dev->rx_req[(head + i) % dev->rx_reqs]);
+
+	wait_event_timeout(dev->read_wq, dev->rx_done >= reaped + inflight,
+			msecs_to_jiffies(MTP_RX_DEQUEUE_TIMEOUT_MS));
+}
+
+static void mtp_xfer_stats_update(struct mtp_dev *dev,
+		struct mtp_xfer_stats *stats, int64_t bytes, ktime_t start)
+{
+	u64 time_us = ktime_to_us(ktime_sub(ktime_get(), start));
+
+	spin_lock_irq(&dev->lock);
+	stats->last_bytes = bytes;
+	stats->last_time_us = time_us;
+	stats->bytes += bytes;
+	stats->time_us += time_us;
+	spin_unlock_irq(&dev->lock);
+}
+
 /* read from a local file and write to USB */
 static void send_file_work(struct work_struct *data)
 {
@@ -806,11 +858,12 @@ static void send_file_work(struct work_struct *data)
 	struct mtp_data_header *header;
 	struct file *filp;
 	loff_t offset;
-	int64_t count;
+	int64_t count, total;
 	int xfer, ret, hdr_size;
 	int r = 0;
 	int sendZLP = 0;
-	ktime_t start_time;
+	unsigned long ra_pages;
+	ktime_t start_time, xfer_start;
 
 	/* read our parameters */
 	smp_rmb();
@@ -825,12 +878,26 @@ static void send_file_work(struct work_struct *data)
 
 	DBG(cdev, "send_file_work(%lld %lld)\n", offset, count);
 
+	/*
+	 * vfs_read() is synchronous; a readahead window covering the queued
+	 * tx requests lets the next chunks come in while USB drains these.
+	 */
+	ra_pages = min_t(unsigned long,
+			2UL * mtp_tx_reqs * mtp_tx_req_len,
+			MTP_TX_RA_MAX_BYTES) >> PAGE_SHIFT;
+	spin_lock(&filp->f_lock);
+	if (filp->f_ra.ra_pages < ra_pages)
+		filp->f_ra.ra_pages = ra_pages;
+	spin_unlock(&filp->f_lock);
+	xfer_start = ktime_get();
+
 	if (dev->xfer_send_header) {
 		hdr_size = sizeof(struct mtp_data_header);
 		count += hdr_size;
 	} else {
 		hdr_size = 0;
 	}
+	total = count;
 
 	/* we need to send a zero length packet to signal the end of transfer
 	 * if the transfer size is aligned to a packet boundary.
@@ -916,6 +983,10 @@ static void send_file_work(struct work_struct *data)
 	if (req)
 		mtp_req_put(dev, &dev->tx_idle, req);
 
+	if (!r)
+		mtp_xfer_stats_update(dev, &dev->send_stats, total,
+				xfer_start);
+
 	DBG(cdev, "send_file_work returning %d state:%d\n", r, dev->state);
 	/* write the result */
 	dev->xfer_result = r;
@@ -931,10 +1002,10 @@ static void receive_file_work(struct work_struct *data)
 	struct usb_request *read_req = NULL, *write_req = NULL;
 	struct file *filp;
 	loff_t offset;
-	int64_t count;
-	int ret, cur_buf = 0;
+	int64_t count, written = 0;
+	int ret, head = 0, tail = 0, inflight = 0, reaped = 0, depth;
 	int r = 0;
-	ktime_t start_time;
+	ktime_t start_time, xfer_start;
 
 	/* read our parameters */
 	smp_rmb();
@@ -952,23 +1023,34 @@ static void receive_file_work(struct work_struct *data)
 		DBG(cdev, "%s- count(%lld) not multiple of mtu(%d)\n", __func__,
 						count, dev->ep_out->maxpacket);
 
-	while (count > 0 || write_req) {
-		if (count > 0) {
-			/* queue a request */
-			read_req = dev->rx_req[cur_buf];
-			cur_buf = (cur_buf + 1) % RX_REQ_MAX;
+	/*
+	 * Keep up to rx_reqs requests queued so the host can stream into the
+	 * next buffers while the previous one is written out. With an
+	 * unknown length only a short packet ends the transfer, so never
+	 * read ahead of it.
+	 */
+	depth = (count == 0xFFFFFFFF) ? 1 : dev->rx_reqs;
+	xfer_start = ktime_get();
+	dev->rx_done = 0;
+
+	while (count > 0 || inflight || write_req) {
+		/* queue requests, but not beyond the end of the transfer */
+		while (inflight < depth &&
+				count > (int64_t)inflight * mtp_rx_req_len) {
+			read_req = dev->rx_req[tail];
 
 			/* some h/w expects size to be aligned to ep's MTU */
 			read_req->length = mtp_rx_req_len;
 
-			dev->rx_done = 0;
 			ret = usb_ep_queue(dev->ep_out, read_req, GFP_KERNEL);
 			if (ret < 0) {
 				r = -EIO;
 				if (dev->state != STATE_OFFLINE)
 					dev->state = STATE_ERROR;
-				break;
+				goto out_dequeue;
 			}
+			tail = (tail + 1) % dev->rx_reqs;
+			inflight++;
 		}
 
 		if (write_req) {
@@ -981,30 +1063,37 @@ static void receive_file_work(struct work_struct *data)
 				r = -EIO;
 				if (dev->state != STATE_OFFLINE)
 					dev->state = STATE_ERROR;
-				break;
+				goto out_dequeue;
 			}
 			dev->perf[dev->dbg_write_index].vfs_wtime =
 				ktime_to_us(ktime_sub(ktime_get(), start_time));
 			dev->perf[dev->dbg_write_index].vfs_wbytes = ret;
 			dev->dbg_write_index =
 				(dev->dbg_write_index + 1) % MAX_ITERATION;
+			written += ret;
 			write_req = NULL;
 		}
 
-		if (read_req) {
-			/* wait for our last read to complete */
+		if (inflight) {
+			/* requests complete in order, wait for the oldest */
+			read_req = dev->rx_req[head];
 			ret = wait_event_interruptible(dev->read_wq,
-				dev->rx_done || dev->state != STATE_BUSY);
+				dev->rx_done > reaped ||
+				dev->state != STATE_BUSY);
 			if (dev->state == STATE_CANCELED
 					|| dev->state == STATE_OFFLINE) {
 				if (dev->state == STATE_OFFLINE)
 					r = -EIO;
 				else
 					r = -ECANCELED;
-				if (!dev->rx_done)
-					usb_ep_dequeue(dev->ep_out, read_req);
-				break;
+				goto out_dequeue;
 			}
+			if (dev->rx_done <= reaped)
+				continue;
+			head = (head + 1) % dev->rx_reqs;
+			inflight--;
+			reaped++;
+
 			/* Check if we aligned the size due to MTU constraint */
 			if (count < read_req->length)
 				read_req->actual = (read_req->actual > count ?
@@ -1021,6 +1110,12 @@ static void receive_file_work(struct work_struct *data)
 				 */
 				DBG(cdev, "got short packet\n");
 				count = 0;
+				/* nothing more is coming for the rest */
+				if (inflight) {
+					mtp_rx_dequeue(dev, head, inflight,
+							reaped);
+					inflight = 0;
+				}
 			}
 
 			write_req = read_req;
@@ -1028,6 +1123,14 @@ static void receive_file_work(struct work_struct *data)
 		}
 	}
 
+out_dequeue:
+	if (inflight)
+		mtp_rx_dequeue(dev, head, inflight, reaped);
+
+	if (!r)
+		mtp_xfer_stats_update(dev, &dev->receive_stats, written,
+				xfer_start);
+
 	DBG(cdev, "receive_file_work returning %d\n", r);
 	/* write the result */
 	dev->xfer_result = r;
@@ -1458,8 +1561,9 @@ mtp_function_unbind(struct usb_configuration *c, struct usb_function *f)
 
 	while ((req = mtp_req_get(dev, &dev->tx_idle)))
 		mtp_request_free(req, dev->ep_in);
-	for (i = 0; i < RX_REQ_MAX; i++)
+	for (i = 0; i < dev->rx_reqs; i++)
 		mtp_request_free(dev->rx_req[i], dev->ep_out);
+	dev->rx_reqs = 0;
 	while ((req = mtp_req_get(dev, &dev->intr_idle)))
 		mtp_request_free(req, dev->ep_intr);
 	dev->state = STATE_OFFLINE;
@@ -1574,6 +1678,18 @@ static int mtp_bind_config(struct usb_configuration *c, bool ptp_config)
 	return usb_add_function(c, &dev->function);
 }
 
+static void debug_mtp_print_xfer(struct seq_file *s, const char *dir,
+				 struct mtp_xfer_stats *stats)
+{
+	seq_printf(s, "%s last: bytes:%llu\t time:%llu\t KB/s:%llu\n", dir,
+		stats->last_bytes, stats->last_time_us,
+		stats->last_time_us ?
+		div64_u64(stats->last_bytes * 1000, stats->last_time_us) : 0);
+	seq_printf(s, "%s total: bytes:%llu\t time:%llu\t KB/s:%llu\n", dir,
+		stats->bytes, stats->time_us, stats->time_us ?
+		div64_u64(stats->bytes * 1000, stats->time_us) : 0);
+}
+
 static int debug_mtp_read_stats(struct seq_file *s, void *unused)
 {
 	struct mtp_dev *dev = _mtp_dev;
@@ -1624,6 +1740,14 @@ static int debug_mtp_read_stats(struct seq_file *s, void *unused)
 
 	seq_printf(s, "vfs_read(time in usec) min:%d\t max:%d\t avg:%d\n",
 				min, max, (iteration ? (sum / iteration) : 0));
+
+	seq_puts(s, "\n=======================\n");
+	seq_puts(s, "MTP Throughput Stats:\n");
+	seq_puts(s, "\n=======================\n");
+	seq_printf(s, "rx reqs:%d\t rx req len:%u\n", dev->rx_reqs,
+				mtp_rx_req_len);
+	debug_mtp_print_xfer(s, "receive", &dev->receive_stats);
+	debug_mtp_print_xfer(s, "send", &dev->send_stats);
 	spin_unlock_irqrestore(&dev->lock, flags);
 	return 0;
 }
@@ -1658,6 +1782,8 @@ static ssize_t debug_mtp_reset_stats(struct file *file, const char __user *buf,
 	memset(&dev->perf[0], 0, MAX_ITERATION * sizeof(dev->perf[0]));
 	dev->dbg_read_index = 0;
 	dev->dbg_write_index = 0;
+	memset(&dev->send_stats, 0, sizeof(dev->send_stats));
+	memset(&dev->receive_stats, 0, sizeof(dev->receive_stats));
 	spin_unlock_irqrestore(&dev->lock, flags);
 
 	return count;
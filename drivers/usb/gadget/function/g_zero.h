@@ -55,6 +55,10 @@ struct f_lb_opts {
 	unsigned bulk_buflen;
 	unsigned qlen;
 
+	/* bytes moved in each direction, for throughput measurements */
+	atomic64_t			bytes_in;
+	atomic64_t			bytes_out;
+
 	/*
 	 * Read/write access to configfs attributes is handled by configfs.
 	 *
@@ -128,6 +128,11 @@ static inline bool fsg_lun_is_open(struct fsg_lun *curlun)
 
 /* Default size of buffer length. */
 #define FSG_BUFLEN	((u32)16384)
+/* Upper bound for the buflen module parameter */
+#define FSG_MAX_BUFLEN	((u32)131072)
+
+/* Maximal number of pipeline buffers */
+#define FSG_MAX_NUM_BUFFERS	32
 
 /* Maximal number of LUNs supported in mass storage function */
 #define FSG_MAX_LUNS	8
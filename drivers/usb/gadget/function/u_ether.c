@@ -27,6 +27,7 @@
 #include <linux/seq_file.h>
 #include <linux/notifier.h>
 #include <linux/cpufreq.h>
+#include <linux/hrtimer.h>
 #include "u_ether.h"
 
 
@@ -66,6 +67,11 @@ module_param(tx_stop_threshold, uint, S_IRUGO | S_IWUSR);
 MODULE_PARM_DESC(tx_stop_threshold,
 	"Threashold to stop network queue");
 
+static unsigned int tx_aggr_hold_us = 500;
+module_param(tx_aggr_hold_us, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(tx_aggr_hold_us,
+	"max time to hold packets for sg aggregation while a transfer is busy");
+
 static unsigned int min_cpu_freq;
 module_param(min_cpu_freq, uint, S_IRUGO | S_IWUSR);
 MODULE_PARM_DESC(min_cpu_freq,
@@ -108,6 +114,9 @@ struct eth_dev {
 	int			tx_skb_hold_count;
 	u32			tx_req_bufsize;
 	struct sk_buff_head	tx_skb_q;
+	atomic_t		tx_skb_q_bytes;
+	int			tx_sg_reqs_busy;
+	struct hrtimer		tx_aggr_timer;
 
 	struct sk_buff_head	rx_frames;
 
@@ -144,6 +153,8 @@ struct eth_dev {
 	unsigned int		tx_bytes_rcvd;
 	unsigned int		loop_brk_cnt;
 	unsigned long		skb_expand_cnt;
+	unsigned long		tx_aggr_timer_flush;
+	unsigned long		tx_aggr_limit_flush;
 	struct dentry		*uether_dent;
 
 	enum ifc_state		state;
@@ -768,6 +779,7 @@ static void tx_complete(struct usb_ep *ep, struct usb_request *req)
 	spin_lock(&dev->req_lock);
 
 	if (req->num_sgs) {
+		dev->tx_sg_reqs_busy--;
 		if (!req->status)
 			queue_work(uether_tx_wq, &dev->tx_work);
 
@@ -951,7 +963,9 @@ static void process_tx_w(struct work_struct *w)
 		req = list_first_entry(&dev->tx_reqs, struct usb_request,
 				list);
 		list_del(&req->list);
+		dev->tx_sg_reqs_busy++;
 		spin_unlock_irqrestore(&dev->req_lock, flags);
+		atomic_sub(skb->len, &dev->tx_skb_q_bytes);
 
 		req->num_sgs = 0;
 		req->zero = 1;
@@ -1009,6 +1023,7 @@ static void process_tx_w(struct work_struct *w)
 				skb_queue_head(&dev->tx_skb_q, skb);
 				break;
 			}
+			atomic_sub(skb->len, &dev->tx_skb_q_bytes);
 			count++;
 		} while (true);
 
@@ -1042,6 +1057,7 @@ static void process_tx_w(struct work_struct *w)
 
 			__skb_queue_purge(&sg_ctx->skbs);
 			list_add_tail(&req->list, &dev->tx_reqs);
+			dev->tx_sg_reqs_busy--;
 			break;
 		case 0:
 			net->trans_start = jiffies;
@@ -1062,6 +1078,51 @@ static void process_tx_w(struct work_struct *w)
 	spin_unlock_irqrestore(&dev->req_lock, flags);
 }
 
+static enum hrtimer_restart tx_aggr_timer_func(struct hrtimer *timer)
+{
+	struct eth_dev *dev = container_of(timer, struct eth_dev,
+						tx_aggr_timer);
+
+	dev->tx_aggr_timer_flush++;
+	queue_work(uether_tx_wq, &dev->tx_work);
+
+	return HRTIMER_NORESTART;
+}
+
+/*
+ * Decide whether the sg tx work should run now or wait for more packets.
+ * Packets are only held while a transfer is in flight, so an idle link
+ * sends immediately; a busy one fills the next transfer until the packet
+ * or byte limit is reached, the in flight transfer completes or the hold
+ * timer expires, whichever comes first.
+ */
+static void eth_kick_tx_sg(struct eth_dev *dev)
+{
+	unsigned int	max_pkts = dev->dl_max_pkts_per_xfer;
+	unsigned int	hold_us = ACCESS_ONCE(tx_aggr_hold_us);
+
+	if (!hold_us || max_pkts <= 1 ||
+			ACCESS_ONCE(dev->tx_sg_reqs_busy) <= 0)
+		goto kick;
+
+	if (skb_queue_len(&dev->tx_skb_q) >= max_pkts ||
+			atomic_read(&dev->tx_skb_q_bytes) +
+			max_pkts * dev->header_len >= dev->dl_max_xfer_size) {
+		dev->tx_aggr_limit_flush++;
+		hrtimer_try_to_cancel(&dev->tx_aggr_timer);
+		goto kick;
+	}
+
+	if (!hrtimer_active(&dev->tx_aggr_timer))
+		hrtimer_start(&dev->tx_aggr_timer,
+				ktime_set(0, hold_us * NSEC_PER_USEC),
+				HRTIMER_MODE_REL);
+	return;
+
+kick:
+	queue_work(uether_tx_wq, &dev->tx_work);
+}
+
 static netdev_tx_t eth_start_xmit(struct sk_buff *skb,
 					struct net_device *net)
 {
@@ -1121,13 +1182,14 @@ static netdev_tx_t eth_start_xmit(struct sk_buff *skb,
 	dev->tx_pkts_rcvd++;
 	dev->tx_bytes_rcvd += skb->len;
 	if (dev->sg_enabled) {
+		atomic_add(skb->len, &dev->tx_skb_q_bytes);
 		skb_queue_tail(&dev->tx_skb_q, skb);
 		if (dev->tx_skb_q.qlen > tx_stop_threshold) {
 			dev->tx_throttle++;
 			netif_stop_queue(net);
 		}
 
-		queue_work(uether_tx_wq, &dev->tx_work);
+		eth_kick_tx_sg(dev);
 		return NETDEV_TX_OK;
 	}
 
@@ -1734,6 +1796,8 @@ struct eth_dev *gether_setup_name(struct usb_gadget *g,
 	INIT_WORK(&dev->work, eth_work);
 	INIT_WORK(&dev->rx_work, process_rx_w);
 	INIT_WORK(&dev->tx_work, process_tx_w);
+	hrtimer_init(&dev->tx_aggr_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	dev->tx_aggr_timer.function = tx_aggr_timer_func;
 	INIT_LIST_HEAD(&dev->tx_reqs);
 	INIT_LIST_HEAD(&dev->rx_reqs);
 	INIT_WORK(&dev->cpu_policy_w, update_cpu_policy_w);
@@ -1811,6 +1875,8 @@ struct net_device *gether_setup_name_default(const char *netname)
 	INIT_WORK(&dev->work, eth_work);
 	INIT_WORK(&dev->rx_work, process_rx_w);
 	INIT_WORK(&dev->tx_work, process_tx_w);
+	hrtimer_init(&dev->tx_aggr_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	dev->tx_aggr_timer.function = tx_aggr_timer_func;
 	INIT_LIST_HEAD(&dev->tx_reqs);
 	INIT_LIST_HEAD(&dev->rx_reqs);
 	INIT_WORK(&dev->cpu_policy_w, update_cpu_policy_w);
@@ -2009,6 +2075,7 @@ void gether_cleanup(struct eth_dev *dev)
 	unregister_netdev(dev->net);
 	flush_work(&dev->work);
 	cancel_work_sync(&dev->rx_work);
+	hrtimer_cancel(&dev->tx_aggr_timer);
 	cancel_work_sync(&dev->tx_work);
 	free_netdev(dev->net);
 }
@@ -2129,6 +2196,7 @@ struct net_device *gether_connect(struct gether *link)
 		dev->tx_skb_hold_count = 0;
 		dev->no_tx_req_used = 0;
 		dev->tx_req_bufsize = 0;
+		dev->tx_sg_reqs_busy = 0;
 		dev->port_usb = link;
 		if (netif_running(dev->net)) {
 			if (link->open)
@@ -2230,7 +2298,9 @@ void gether_disconnect(struct gether *link)
 		link->header = NULL;
 		spin_unlock(&dev->req_lock);
 
+		hrtimer_cancel(&dev->tx_aggr_timer);
 		skb_queue_purge(&dev->tx_skb_q);
+		atomic_set(&dev->tx_skb_q_bytes, 0);
 
 		link->in_ep->driver_data = NULL;
 		link->in_ep->desc = NULL;
@@ -2298,6 +2368,10 @@ static int uether_stat_show(struct seq_file *s, void *unused)
 					dev->tx_pkts_rcvd);
 		seq_printf(s, "skb_expand_cnt = %lu\n",
 					dev->skb_expand_cnt);
+		seq_printf(s, "tx_aggr_timer_flush = %lu\n",
+					dev->tx_aggr_timer_flush);
+		seq_printf(s, "tx_aggr_limit_flush = %lu\n",
+					dev->tx_aggr_limit_flush);
 	}
 
 	return ret;
@@ -2320,6 +2394,8 @@ static ssize_t uether_stat_reset(struct file *file,
 	dev->tx_throttle = 0;
 	dev->rx_throttle = 0;
 	dev->skb_expand_cnt = 0;
+	dev->tx_aggr_timer_flush = 0;
+	dev->tx_aggr_limit_flush = 0;
 	spin_unlock_irqrestore(&dev->lock, flags);
 	return count;
 }
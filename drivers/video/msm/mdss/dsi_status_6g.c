@@ -126,8 +126,26 @@ void mdss_check_dsi_ctrl_status(struct work_struct *work, uint32_t interval)
 	 * command and data arbitration is possible in h/w
 	 */
 
-	if ((mipi->mode == DSI_CMD_MODE) && !ctrl_pdata->burst_mode_enabled)
-		mutex_lock(&mdp5_data->ov_lock);
+	if ((mipi->mode == DSI_CMD_MODE) && !ctrl_pdata->burst_mode_enabled) {
+		/*
+		 * A commit holds ov_lock until its frame is out. Rather than
+		 * stalling the next one behind the BTA, retry one frame later,
+		 * a bounded number of times.
+		 */
+		if (!mutex_trylock(&mdp5_data->ov_lock)) {
+			if (pstatus_data->deferred < MDSS_STATUS_DEFER_MAX) {
+				uint32_t fps = mdss_panel_get_framerate(
+					&pdata->panel_info, FPS_RESOLUTION_HZ);
+
+				pstatus_data->deferred++;
+				schedule_delayed_work(&pstatus_data->check_status,
+					msecs_to_jiffies(1000 / fps + 1));
+				return;
+			}
+			mutex_lock(&mdp5_data->ov_lock);
+		}
+		pstatus_data->deferred = 0;
+	}
 	mutex_lock(&ctl->mfd->param_lock);
 
 	if (mdss_panel_is_power_off(pstatus_data->mfd->panel_power_state) ||
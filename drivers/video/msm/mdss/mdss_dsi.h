@@ -63,6 +63,7 @@
 #define MDSS_DSI_HW_REV_STEP_2		0x2
 
 #define MDSS_STATUS_TE_WAIT_MAX		3
+#define MDSS_STATUS_DEFER_MAX		3
 #define NONE_PANEL "none"
 
 enum {		/* mipi dsi panel */
@@ -457,6 +458,7 @@ struct mdss_dsi_ctrl_pdata {
 	bool dmap_iommu_map;
 	bool dsi_irq_line;
 	bool dcs_cmd_insert;
+	bool bklt_dcs_async;	/* queue DCS brightness, don't wait for it */
 	atomic_t te_irq_ready;
 	bool idle;
 
@@ -575,6 +577,7 @@ struct dsi_status_data {
 	struct notifier_block fb_notifier;
 	struct delayed_work check_status;
 	struct msm_fb_data_type *mfd;
+	u32 deferred;	/* checks postponed for frame transfers in a row */
 };
 
 void mdss_dsi_read_hw_revision(struct mdss_dsi_ctrl_pdata *ctrl);
@@ -740,6 +740,8 @@ struct dcs_cmd_req *mdss_dsi_cmdlist_get(struct mdss_dsi_ctrl_pdata *ctrl,
 			mutex_unlock(&ctrl->cmdlist_mutex);
 			return NULL;
 		}
+		if (req->flags & CMD_REQ_ASYNC)
+			clist->busy = clist->get;
 		clist->get++;
 		clist->get %= CMD_REQ_MAX;
 		clist->tot--;
@@ -750,6 +752,168 @@ struct dcs_cmd_req *mdss_dsi_cmdlist_get(struct mdss_dsi_ctrl_pdata *ctrl,
 	return req;
 }
 
+/*
+ * mdss_dsi_cmdlist_release: the request returned by the last
+ * mdss_dsi_cmdlist_get() has been sent, its async slot may be reused
+ */
+void mdss_dsi_cmdlist_release(struct mdss_dsi_ctrl_pdata *ctrl)
+{
+	mutex_lock(&ctrl->cmdlist_mutex);
+	ctrl->cmdlist.busy = -1;
+	mutex_unlock(&ctrl->cmdlist_mutex);
+}
+
+static int mdss_dsi_cmdlist_pending(struct mdss_dsi_ctrl_pdata *ctrl)
+{
+	int tot;
+
+	mutex_lock(&ctrl->cmdlist_mutex);
+	tot = ctrl->cmdlist.tot;
+	mutex_unlock(&ctrl->cmdlist_mutex);
+
+	return tot;
+}
+
+/*
+ * mdss_dsi_cmdlist_flush: ctrl->cmd_mutex acquired by caller
+ *
+ * Sends all queued requests in order and returns the result of the
+ * last one. Bounded so that a commit which leaves its request queued
+ * (e.g. dsi off) cannot spin here.
+ */
+static int mdss_dsi_cmdlist_flush(struct mdss_dsi_ctrl_pdata *ctrl)
+{
+	int i, ret = 0;
+
+	if (!ctrl->cmdlist_commit) {
+		pr_err("cmdlist_commit not implemented!\n");
+		return -EINVAL;
+	}
+
+	for (i = 0; i < CMD_REQ_MAX && mdss_dsi_cmdlist_pending(ctrl); i++) {
+		ret = ctrl->cmdlist_commit(ctrl, 0);
+		mdss_dsi_cmdlist_release(ctrl);
+	}
+
+	return ret;
+}
+
+static bool mdss_dsi_cmd_mergeable(struct dcs_cmd_req *old,
+				struct dcs_cmd_req *new)
+{
+	struct dsi_ctrl_hdr *a, *b;
+
+	if (!(old->flags & CMD_REQ_ASYNC) || old->flags != new->flags ||
+	    old->cmds_cnt != 1 || new->cmds_cnt != 1 || old->cb != new->cb)
+		return false;
+
+	a = &old->cmds->dchdr;
+	b = &new->cmds->dchdr;
+	if (a->dtype != DTYPE_DCS_WRITE1 && a->dtype != DTYPE_DCS_LWRITE)
+		return false;
+
+	/* same DCS register, only the parameters differ */
+	return a->dtype == b->dtype && a->dlen == b->dlen &&
+		old->cmds->payload[0] == new->cmds->payload[0];
+}
+
+/*
+ * Queue a request to be sent by the next mdp kickoff, or by the async
+ * work if no frame comes within one frame time. The commands are copied,
+ * so the caller may reuse its buffers right away. A DCS write replacing
+ * the parameters of the last queued one is merged into it.
+ */
+static int mdss_dsi_cmdlist_put_async(struct mdss_dsi_ctrl_pdata *ctrl,
+				struct dcs_cmd_req *cmdreq)
+{
+	struct dcs_cmd_list *clist = &ctrl->cmdlist;
+	struct mdss_panel_info *pinfo = &ctrl->panel_data.panel_info;
+	struct dcs_cmd_req *req;
+	struct dcs_cmd_async *async;
+	unsigned long delay = 0;
+	char *payload;
+	int i, len = 0;
+
+	if (!clist->async_capable || (cmdreq->flags & CMD_REQ_RX) ||
+	    cmdreq->cmds_cnt > CMD_REQ_ASYNC_CMDS)
+		return -EAGAIN;
+
+	for (i = 0; i < cmdreq->cmds_cnt; i++)
+		len += cmdreq->cmds[i].dchdr.dlen;
+	if (len > CMD_REQ_ASYNC_LEN)
+		return -EAGAIN;
+
+	mutex_lock(&ctrl->cmdlist_mutex);
+	if (clist->tot) {
+		req = &clist->list[(clist->put + CMD_REQ_MAX - 1) % CMD_REQ_MAX];
+		if (mdss_dsi_cmd_mergeable(req, cmdreq)) {
+			memcpy(req->cmds->payload, cmdreq->cmds->payload, len);
+			pr_debug("%s: merged, tot=%d\n", __func__, clist->tot);
+			goto queued;
+		}
+	}
+
+	/* never overwrite a queued or in-flight request */
+	if (clist->tot >= CMD_REQ_MAX - 1 || clist->put == clist->busy) {
+		mutex_unlock(&ctrl->cmdlist_mutex);
+		return -EAGAIN;
+	}
+
+	req = &clist->list[clist->put];
+	async = &clist->async[clist->put];
+	*req = *cmdreq;
+	payload = async->payload;
+	for (i = 0; i < cmdreq->cmds_cnt; i++) {
+		async->cmds[i] = cmdreq->cmds[i];
+		async->cmds[i].payload = payload;
+		memcpy(payload, cmdreq->cmds[i].payload,
+			cmdreq->cmds[i].dchdr.dlen);
+		payload += cmdreq->cmds[i].dchdr.dlen;
+	}
+	req->cmds = async->cmds;
+
+	clist->put++;
+	clist->put %= CMD_REQ_MAX;
+	clist->tot++;
+	pr_debug("%s: tot=%d put=%d get=%d\n", __func__,
+		clist->tot, clist->put, clist->get);
+queued:
+	mutex_unlock(&ctrl->cmdlist_mutex);
+
+	/*
+	 * command mode panels get the request along with the next kickoff,
+	 * video mode transfers are already held off until vertical blanking
+	 */
+	if (ctrl->panel_mode == DSI_CMD_MODE)
+		delay = msecs_to_jiffies(1000 / mdss_panel_get_framerate(pinfo,
+				FPS_RESOLUTION_HZ) + 1);
+	schedule_delayed_work(&clist->async_work, delay);
+
+	return 0;
+}
+
+static void mdss_dsi_cmdlist_async_work(struct work_struct *work)
+{
+	struct dcs_cmd_list *clist = container_of(to_delayed_work(work),
+				struct dcs_cmd_list, async_work);
+	struct mdss_dsi_ctrl_pdata *ctrl = container_of(clist,
+				struct mdss_dsi_ctrl_pdata, cmdlist);
+
+	mutex_lock(&ctrl->cmd_mutex);
+	/* otherwise left for the next synchronous request or kickoff */
+	if (ctrl->ctrl_state & CTRL_STATE_PANEL_INIT)
+		mdss_dsi_cmdlist_flush(ctrl);
+	mutex_unlock(&ctrl->cmd_mutex);
+}
+
+void mdss_dsi_cmdlist_init(struct mdss_dsi_ctrl_pdata *ctrl)
+{
+	ctrl->cmdlist.busy = -1;
+	INIT_DELAYED_WORK(&ctrl->cmdlist.async_work,
+			mdss_dsi_cmdlist_async_work);
+	ctrl->cmdlist.async_capable = true;
+}
+
 int mdss_dsi_cmdlist_put(struct mdss_dsi_ctrl_pdata *ctrl,
 				struct dcs_cmd_req *cmdreq)
 {
@@ -757,6 +921,14 @@ int mdss_dsi_cmdlist_put(struct mdss_dsi_ctrl_pdata *ctrl,
 	struct dcs_cmd_list *clist;
 	int ret = 0;
 
+	if (cmdreq->flags & CMD_REQ_ASYNC) {
+		if (!mdss_dsi_cmdlist_put_async(ctrl, cmdreq))
+			return 0;
+		/* fall back to a synchronous transfer */
+		cmdreq->flags &= ~CMD_REQ_ASYNC;
+		cmdreq->flags |= CMD_REQ_COMMIT;
+	}
+
 	mutex_lock(&ctrl->cmd_mutex);
 	mutex_lock(&ctrl->cmdlist_mutex);
 	clist = &ctrl->cmdlist;
@@ -779,12 +951,9 @@ int mdss_dsi_cmdlist_put(struct mdss_dsi_ctrl_pdata *ctrl,
 
 	mutex_unlock(&ctrl->cmdlist_mutex);
 
-	if (req->flags & CMD_REQ_COMMIT) {
-		if (!ctrl->cmdlist_commit)
-			pr_err("cmdlist_commit not implemented!\n");
-		else
-			ret = ctrl->cmdlist_commit(ctrl, 0);
-	}
+	/* earlier queued requests go out first, in order */
+	if (req->flags & CMD_REQ_COMMIT)
+		ret = mdss_dsi_cmdlist_flush(ctrl);
 	mutex_unlock(&ctrl->cmd_mutex);
 
 	return ret;
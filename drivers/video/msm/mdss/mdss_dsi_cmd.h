@@ -14,6 +14,8 @@
 #ifndef MDSS_DSI_CMD_H
 #define MDSS_DSI_CMD_H
 
+#include <linux/workqueue.h>
+
 #include "mdss.h"
 
 struct mdss_dsi_ctrl_pdata;
@@ -103,6 +105,11 @@ struct dsi_cmd_desc {
 #define CMD_REQ_NO_MAX_PKT_SIZE 0x0008
 #define CMD_REQ_LP_MODE 0x0010
 #define CMD_REQ_HS_MODE 0x0020
+#define CMD_REQ_ASYNC   0x0080
+
+/* limits of the copies kept for CMD_REQ_ASYNC requests */
+#define CMD_REQ_ASYNC_CMDS	4
+#define CMD_REQ_ASYNC_LEN	64
 
 struct dcs_cmd_req {
 	struct dsi_cmd_desc *cmds;
@@ -113,11 +120,20 @@ struct dcs_cmd_req {
 	void (*cb)(int data);
 };
 
+struct dcs_cmd_async {
+	struct dsi_cmd_desc cmds[CMD_REQ_ASYNC_CMDS];
+	char payload[CMD_REQ_ASYNC_LEN];
+};
+
 struct dcs_cmd_list {
 	int put;
 	int get;
 	int tot;
+	int busy;	/* async slot being sent, -1 if none */
+	bool async_capable;
 	struct dcs_cmd_req list[CMD_REQ_MAX];
+	struct dcs_cmd_async async[CMD_REQ_MAX];
+	struct delayed_work async_work;
 };
 
 char *mdss_dsi_buf_reserve(struct dsi_buf *dp, int len);
@@ -136,4 +152,6 @@ struct dcs_cmd_req *mdss_dsi_cmdlist_get(struct mdss_dsi_ctrl_pdata *ctrl,
 				int from_mdp);
 int mdss_dsi_cmdlist_put(struct mdss_dsi_ctrl_pdata *ctrl,
 				struct dcs_cmd_req *cmdreq);
+void mdss_dsi_cmdlist_release(struct mdss_dsi_ctrl_pdata *ctrl);
+void mdss_dsi_cmdlist_init(struct mdss_dsi_ctrl_pdata *ctrl);
 #endif
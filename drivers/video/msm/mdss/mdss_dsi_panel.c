@@ -249,7 +249,11 @@ static void mdss_dsi_panel_bklt_dcs(struct mdss_dsi_ctrl_pdata *ctrl, int level)
 	memset(&cmdreq, 0, sizeof(cmdreq));
 	cmdreq.cmds = &backlight_cmd;
 	cmdreq.cmds_cnt = 1;
-	cmdreq.flags = CMD_REQ_COMMIT;
+	/* broadcast needs both controllers triggered together */
+	if (ctrl->bklt_dcs_async && !mdss_dsi_sync_wait_enable(ctrl))
+		cmdreq.flags = CMD_REQ_ASYNC;
+	else
+		cmdreq.flags = CMD_REQ_COMMIT;
 	cmdreq.rlen = 0;
 	cmdreq.cb = NULL;
 
@@ -2719,6 +2723,8 @@ int mdss_panel_parse_bl_settings(struct device_node *np,
 			}
 		} else if (!strcmp(data, "bl_ctrl_dcs")) {
 			ctrl_pdata->bklt_ctrl = BL_DCS_CMD;
+			ctrl_pdata->bklt_dcs_async = of_property_read_bool(np,
+				"qcom,mdss-dsi-bl-dcs-async");
 			pr_debug("%s: Configured DCS_CMD bklt ctrl\n",
 								__func__);
 		} else if (!strcmp(data, "bl_ctrl_mot")) {
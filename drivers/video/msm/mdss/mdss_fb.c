@@ -48,6 +48,7 @@
 #include <linux/file.h>
 #include <linux/kthread.h>
 #include <linux/dma-buf.h>
+#include <soc/qcom/boot_timeline.h>
 #include "mdss_fb.h"
 #include "mdss_mdp_splash_logo.h"
 #define CREATE_TRACE_POINTS
@@ -578,6 +579,43 @@ static ssize_t mdss_fb_set_idle_time(struct device *dev,
 	return count;
 }
 
+static ssize_t mdss_fb_get_commit_queue_depth(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct fb_info *fbi = dev_get_drvdata(dev);
+	struct msm_fb_data_type *mfd = fbi->par;
+
+	return scnprintf(buf, PAGE_SIZE, "%d\n", mfd->commit_queue_depth);
+}
+
+static ssize_t mdss_fb_set_commit_queue_depth(struct device *dev,
+	struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct fb_info *fbi = dev_get_drvdata(dev);
+	struct msm_fb_data_type *mfd = fbi->par;
+	u32 depth;
+	int rc;
+
+	rc = kstrtouint(buf, 10, &depth);
+	if (rc) {
+		pr_err("kstrtouint failed. rc=%d\n", rc);
+		return rc;
+	}
+
+	if (!depth || depth > MDSS_FB_MAX_COMMIT_QUEUE) {
+		pr_err("commit queue depth %d out of range 1..%d\n",
+			depth, MDSS_FB_MAX_COMMIT_QUEUE);
+		return -EINVAL;
+	}
+
+	mutex_lock(&mfd->mdp_sync_pt_data.sync_mutex);
+	mfd->commit_queue_depth = depth;
+	mutex_unlock(&mfd->mdp_sync_pt_data.sync_mutex);
+	wake_up_all(&mfd->idle_wait_q);
+
+	return count;
+}
+
 static ssize_t mdss_fb_get_idle_notify(struct device *dev,
 		struct device_attribute *attr, char *buf)
 {
@@ -910,6 +948,8 @@ static DEVICE_ATTR(show_blank_event, S_IRUGO, mdss_mdp_show_blank_event, NULL);
 static DEVICE_ATTR(idle_time, S_IRUGO | S_IWUSR | S_IWGRP,
 	mdss_fb_get_idle_time, mdss_fb_set_idle_time);
 static DEVICE_ATTR(idle_notify, S_IRUGO, mdss_fb_get_idle_notify, NULL);
+static DEVICE_ATTR(commit_queue_depth, S_IRUGO | S_IWUSR | S_IWGRP,
+	mdss_fb_get_commit_queue_depth, mdss_fb_set_commit_queue_depth);
 static DEVICE_ATTR(msm_fb_panel_info, S_IRUGO, mdss_fb_get_panel_info, NULL);
 static DEVICE_ATTR(msm_fb_src_split_info, S_IRUGO, mdss_fb_get_src_split_info,
 	NULL);
@@ -929,6 +969,7 @@ static struct attribute *mdss_fb_attrs[] = {
 	&dev_attr_show_blank_event.attr,
 	&dev_attr_idle_time.attr,
 	&dev_attr_idle_notify.attr,
+	&dev_attr_commit_queue_depth.attr,
 	&dev_attr_msm_fb_panel_info.attr,
 	&dev_attr_msm_fb_src_split_info.attr,
 	&dev_attr_msm_fb_thermal_level.attr,
@@ -1654,6 +1695,8 @@ static int mdss_fb_probe(struct platform_device *pdev)
 
 	INIT_DELAYED_WORK(&mfd->idle_notify_work, __mdss_fb_idle_notify_work);
 
+	device_enable_async_suspend(&pdev->dev);
+
 	return rc;
 }
 
@@ -2046,6 +2089,8 @@ static int mdss_fb_start_disp_thread(struct msm_fb_data_type *mfd)
 	mdss_fb_get_split(mfd);
 
 	atomic_set(&mfd->commits_pending, 0);
+	mfd->commit_queue_head = 0;
+	mfd->commit_queue_tail = 0;
 	mfd->disp_thread = kthread_run(__mdss_fb_display_thread,
 				mfd, "mdss_fb%d", mfd->index);
 
@@ -2980,6 +3025,7 @@ static int mdss_fb_register(struct msm_fb_data_type *mfd)
 	atomic_set(&mfd->commits_pending, 0);
 	atomic_set(&mfd->ioctl_ref_cnt, 0);
 	atomic_set(&mfd->kickoff_pending, 0);
+	mfd->commit_queue_depth = 1;
 
 	init_timer(&mfd->no_update.timer);
 	mfd->no_update.timer.function = mdss_fb_no_update_notify_timer_cb;
@@ -3461,6 +3507,51 @@ static int mdss_fb_pan_idle(struct msm_fb_data_type *mfd)
 	return ret;
 }
 
+/*
+ * mdss_fb_wait_for_commit_slot() - wait for room in the commit queue
+ * @mfd:	Framebuffer data structure for display
+ *
+ * Only commits that carry their whole state in the queue entry may be
+ * queued behind others, callers touching shared layer state must use
+ * mdss_fb_pan_idle() instead.
+ */
+static int mdss_fb_wait_for_commit_slot(struct msm_fb_data_type *mfd)
+{
+	int ret;
+
+	ret = wait_event_timeout(mfd->idle_wait_q,
+			((atomic_read(&mfd->commits_pending) <
+			  mfd->commit_queue_depth) ||
+			 mfd->shutdown_pending),
+			msecs_to_jiffies(WAIT_DISP_OP_TIMEOUT));
+	if (!ret) {
+		pr_err("%pS: wait for commit slot timeout commits=%d\n",
+				__builtin_return_address(0),
+				atomic_read(&mfd->commits_pending));
+		ret = -ETIMEDOUT;
+	} else if (mfd->shutdown_pending) {
+		pr_debug("Shutdown signalled\n");
+		ret = -ESHUTDOWN;
+	} else {
+		ret = 0;
+	}
+
+	return ret;
+}
+
+/* Hand the tail entry to the display thread, called with sync_mutex held */
+static void mdss_fb_queue_commit(struct msm_fb_data_type *mfd)
+{
+	mfd->commit_queue_tail = (mfd->commit_queue_tail + 1) %
+		MDSS_FB_MAX_COMMIT_QUEUE;
+
+	atomic_inc(&mfd->mdp_sync_pt_data.commit_cnt);
+	atomic_inc(&mfd->commits_pending);
+	atomic_inc(&mfd->kickoff_pending);
+	ATRACE_INT("fb_commit_queue", atomic_read(&mfd->commits_pending));
+	wake_up_all(&mfd->commit_wait_q);
+}
+
 static int mdss_fb_wait_for_kickoff(struct msm_fb_data_type *mfd)
 {
 	int ret = 0;
@@ -3496,6 +3587,7 @@ static int mdss_fb_pan_display_ex(struct fb_info *info,
 	struct msm_fb_data_type *mfd = (struct msm_fb_data_type *)info->par;
 	struct fb_var_screeninfo *var = &disp_commit->var;
 	u32 wait_for_finish = disp_commit->wait_for_finish;
+	struct msm_fb_backup_type *entry;
 	int ret = 0;
 
 	if (!mfd || (!mfd->op_enable))
@@ -3512,7 +3604,14 @@ static int mdss_fb_pan_display_ex(struct fb_info *info,
 	if (var->yoffset > (info->var.yres_virtual - info->var.yres))
 		return -EINVAL;
 
-	ret = mdss_fb_pan_idle(mfd);
+	/*
+	 * Overlay commits program the shared pipe state and need the queue
+	 * drained, plain pans carry everything in the queue entry.
+	 */
+	if (disp_commit->flags & MDP_DISPLAY_COMMIT_OVERLAY)
+		ret = mdss_fb_pan_idle(mfd);
+	else
+		ret = mdss_fb_wait_for_commit_slot(mfd);
 	if (ret) {
 		pr_err("wait_for_kick failed. rc=%d\n", ret);
 		return ret;
@@ -3536,13 +3635,12 @@ static int mdss_fb_pan_display_ex(struct fb_info *info,
 		info->var.yoffset =
 		(var->yoffset / info->fix.ypanstep) * info->fix.ypanstep;
 
-	mfd->msm_fb_backup.info = *info;
-	mfd->msm_fb_backup.disp_commit = *disp_commit;
+	entry = &mfd->commit_queue[mfd->commit_queue_tail];
+	entry->info = *info;
+	entry->disp_commit = *disp_commit;
+	entry->atomic_commit = false;
 
-	atomic_inc(&mfd->mdp_sync_pt_data.commit_cnt);
-	atomic_inc(&mfd->commits_pending);
-	atomic_inc(&mfd->kickoff_pending);
-	wake_up_all(&mfd->commit_wait_q);
+	mdss_fb_queue_commit(mfd);
 	mutex_unlock(&mfd->mdp_sync_pt_data.sync_mutex);
 	if (wait_for_finish) {
 		ret = mdss_fb_pan_idle(mfd);
@@ -3657,6 +3755,7 @@ int mdss_fb_atomic_commit(struct fb_info *info,
 	struct mdp_layer_commit_v1 *commit_v1;
 	struct mdp_output_layer *output_layer;
 	struct mdss_panel_info *pinfo;
+	struct msm_fb_backup_type *entry;
 	bool wait_for_finish, update = false, wb_change = false;
 	int ret = -EPERM;
 	u32 old_xres, old_yres, old_format;
@@ -3735,15 +3834,13 @@ int mdss_fb_atomic_commit(struct fb_info *info,
 	}
 
 	wait_for_finish = commit_v1->flags & MDP_COMMIT_WAIT_FOR_FINISH;
-	mfd->msm_fb_backup.atomic_commit = true;
-	mfd->msm_fb_backup.disp_commit.l_roi =  commit_v1->left_roi;
-	mfd->msm_fb_backup.disp_commit.r_roi =  commit_v1->right_roi;
 
 	mutex_lock(&mfd->mdp_sync_pt_data.sync_mutex);
-	atomic_inc(&mfd->mdp_sync_pt_data.commit_cnt);
-	atomic_inc(&mfd->commits_pending);
-	atomic_inc(&mfd->kickoff_pending);
-	wake_up_all(&mfd->commit_wait_q);
+	entry = &mfd->commit_queue[mfd->commit_queue_tail];
+	entry->atomic_commit = true;
+	entry->disp_commit.l_roi =  commit_v1->left_roi;
+	entry->disp_commit.r_roi =  commit_v1->right_roi;
+	mdss_fb_queue_commit(mfd);
 	mutex_unlock(&mfd->mdp_sync_pt_data.sync_mutex);
 
 	if (wait_for_finish)
@@ -3923,9 +4020,11 @@ void mdss_panelinfo_to_fb_var(struct mdss_panel_info *pinfo,
 static int __mdss_fb_perform_commit(struct msm_fb_data_type *mfd)
 {
 	struct msm_sync_pt_data *sync_pt_data = &mfd->mdp_sync_pt_data;
-	struct msm_fb_backup_type *fb_backup = &mfd->msm_fb_backup;
+	struct msm_fb_backup_type *fb_backup =
+		&mfd->commit_queue[mfd->commit_queue_head];
 	int ret = -ENOSYS;
 	u32 new_dsi_mode, dynamic_dsi_switch = 0;
+	static bool first_frame_done;
 
 	if (!sync_pt_data->async_wait_fences)
 		mdss_fb_wait_for_fence(sync_pt_data);
@@ -3975,6 +4074,11 @@ static int __mdss_fb_perform_commit(struct msm_fb_data_type *mfd)
 					mfd->index);
 	}
 
+	if (!ret && !mfd->index && !first_frame_done) {
+		boot_timeline_mark(BOOT_TL_DISPLAY, "first frame");
+		first_frame_done = true;
+	}
+
 skip_commit:
 	if (!ret)
 		mdss_fb_update_backlight(mfd);
@@ -4031,7 +4135,11 @@ static int __mdss_fb_display_thread(void *data)
 		ret = __mdss_fb_perform_commit(mfd);
 		MDSS_XLOG(mfd->index, XLOG_FUNC_EXIT);
 
+		mfd->commit_queue_head = (mfd->commit_queue_head + 1) %
+			MDSS_FB_MAX_COMMIT_QUEUE;
 		atomic_dec(&mfd->commits_pending);
+		ATRACE_INT("fb_commit_queue",
+			atomic_read(&mfd->commits_pending));
 		wake_up_all(&mfd->idle_wait_q);
 	}
 
@@ -249,6 +249,9 @@ struct mdss_fb_file_info {
 	struct list_head list;
 };
 
+/* Maximum number of plain pan display commits queued to the display thread */
+#define MDSS_FB_MAX_COMMIT_QUEUE	3
+
 struct msm_fb_backup_type {
 	struct fb_info info;
 	struct mdp_display_commit disp_commit;
@@ -343,7 +346,14 @@ struct msm_fb_data_type {
 	wait_queue_head_t ioctl_q;
 	atomic_t ioctl_ref_cnt;
 
-	struct msm_fb_backup_type msm_fb_backup;
+	/*
+	 * Commits handed to the display thread. The producer fills the tail
+	 * entry under sync_mutex, the display thread consumes from the head.
+	 */
+	struct msm_fb_backup_type commit_queue[MDSS_FB_MAX_COMMIT_QUEUE];
+	u32 commit_queue_head;
+	u32 commit_queue_tail;
+	u32 commit_queue_depth;
 	struct completion power_set_comp;
 	u32 is_power_setting;
 
@@ -2783,6 +2783,9 @@ static int mdss_mdp_probe(struct platform_device *pdev)
 		mdata->mdp_rev, num_of_display_on ? "on" : "off",
 		num_of_display_on, intf_sel);
 
+	/* fb devices are our children, so they wait for us on resume */
+	device_enable_async_suspend(&pdev->dev);
+
 probe_done:
 	if (IS_ERR_VALUE(rc)) {
 		if (!num_of_display_on)
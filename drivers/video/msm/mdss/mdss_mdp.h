@@ -911,6 +911,8 @@ struct mdss_mdp_pipe {
 	u8 vert_deci;
 	struct mdss_rect src;
 	struct mdss_rect dst;
+	/* dst programmed on the previous commit, for automatic ROI */
+	struct mdss_rect last_dst;
 	struct mdss_mdp_format_params *src_fmt;
 	struct mdss_mdp_plane_sizes src_planes;
 
@@ -962,6 +964,22 @@ struct mdss_mdp_writeback_arg {
 
 struct mdss_mdp_wfd;
 
+/**
+ * struct mdss_mdp_auto_dfps - refresh rate scaling from the commit cadence
+ * @enable: scale the refresh rate of the panel automatically
+ * @last_commit: time of the last commit
+ * @interval_us: moving average of the interval between commits
+ * @switches: number of refresh rate changes made
+ * @idle_work: drops to the minimum refresh rate once commits stop
+ */
+struct mdss_mdp_auto_dfps {
+	bool enable;
+	ktime_t last_commit;
+	u32 interval_us;
+	u32 switches;
+	struct delayed_work idle_work;
+};
+
 struct mdss_overlay_private {
 	ktime_t vsync_time;
 	ktime_t lineptr_time;
@@ -999,6 +1017,11 @@ struct mdss_overlay_private {
 	int ad_state;
 	int dyn_pu_state;
 
+	/* derive the ROI from changed layers when userspace gives none */
+	bool auto_roi;
+	u32 dsi_frame_bytes;
+	u64 dsi_total_bytes;
+
 	bool handoff;
 	u32 splash_mem_addr;
 	u32 splash_mem_size;
@@ -1018,6 +1041,7 @@ struct mdss_overlay_private {
 
 	/* video frame info used by deterministic frame rate control */
 	struct mdss_mdp_frc_fsm *frc_fsm;
+	struct mdss_mdp_auto_dfps auto_dfps;
 	u8 sd_transition_state;
 	struct kthread_worker worker;
 	struct kthread_work vsync_work;
@@ -55,6 +55,13 @@
 #define DFPS_DATA_MAX_FPS 0x7fffffff
 #define DFPS_DATA_MAX_CLK_RATE 250000
 
+/* no commit for this long means the screen is static */
+#define AUTO_DFPS_IDLE_MS 100
+/* keep the maximum refresh rate this long after an input event */
+#define AUTO_DFPS_INPUT_HOLD_US (500 * USEC_PER_MSEC)
+/* longest commit interval taken into the average */
+#define AUTO_DFPS_MAX_INTERVAL_US (USEC_PER_SEC / 10)
+
 static int mdss_mdp_overlay_free_fb_pipe(struct msm_fb_data_type *mfd);
 static int mdss_mdp_overlay_fb_parse_dt(struct msm_fb_data_type *mfd);
 static int mdss_mdp_overlay_off(struct msm_fb_data_type *mfd);
@@ -1911,6 +1918,134 @@ int mdss_mode_switch_post(struct msm_fb_data_type *mfd, u32 mode)
 	return rc;
 }
 
+static void __union_rect(struct mdss_rect *res, const struct mdss_rect *rect)
+{
+	int l, t, r, b;
+
+	if (!rect->w || !rect->h)
+		return;
+
+	if (!res->w || !res->h) {
+		*res = *rect;
+		return;
+	}
+
+	l = min(res->x, rect->x);
+	t = min(res->y, rect->y);
+	r = max(res->x + res->w, rect->x + rect->w);
+	b = max(res->y + res->h, rect->y + rect->h);
+
+	*res = (struct mdss_rect){l, t, (r - l), (b - t)};
+}
+
+static bool __pipe_has_update(struct mdss_mdp_pipe *pipe)
+{
+	struct mdss_mdp_data *buf;
+
+	if (pipe->params_changed || pipe->dirty)
+		return true;
+
+	if (memcmp(&pipe->dst, &pipe->last_dst, sizeof(pipe->dst)))
+		return true;
+
+	buf = list_first_entry_or_null(&pipe->buf_queue,
+			struct mdss_mdp_data, pipe_list);
+	if (!buf)
+		return false;
+
+	/* new buffer queued, or a flip still waiting to be latched */
+	return (buf->state == MDP_BUF_STATE_READY) ||
+		!list_is_singular(&pipe->buf_queue);
+}
+
+/*
+ * Compute the ROI of a command mode update from the layers that changed
+ * since the previous commit, for clients that do not supply damage. The
+ * result is aligned to the panel requirements and is left empty when a
+ * full frame update is needed.
+ */
+static void __compute_auto_roi(struct msm_fb_data_type *mfd,
+	struct mdss_rect *roi)
+{
+	struct mdss_mdp_ctl *ctl = mfd_to_ctl(mfd);
+	struct mdss_overlay_private *mdp5_data = mfd_to_mdp5_data(mfd);
+	struct mdss_panel_info *pinfo = &ctl->panel_data->panel_info;
+	struct mdss_panel_roi_alignment *align = &pinfo->roi_alignment;
+	struct mdss_rect full = {0, 0, ctl->mixer_left->width,
+		ctl->mixer_left->height};
+	struct mdss_rect damage = {0};
+	struct mdss_mdp_pipe *pipe;
+	int r, b;
+
+	*roi = (struct mdss_rect){0};
+
+	if (!mdp5_data->auto_roi || !pinfo->partial_update_enabled ||
+	    ctl->is_video_mode || is_split_lm(mfd) || !ctl->play_cnt ||
+	    (ctl->pending_mode_switch == SWITCH_RESOLUTION))
+		return;
+
+	list_for_each_entry(pipe, &mdp5_data->pipes_used, list) {
+		if (!__pipe_has_update(pipe))
+			continue;
+		__union_rect(&damage, &pipe->dst);
+		__union_rect(&damage, &pipe->last_dst);
+	}
+
+	list_for_each_entry(pipe, &mdp5_data->pipes_cleanup, list)
+		__union_rect(&damage, &pipe->last_dst);
+
+	mdss_mdp_intersect_rect(&damage, &damage, &full);
+	if (!damage.w || !damage.h)
+		return;
+
+	r = damage.x + damage.w;
+	b = damage.y + damage.h;
+
+	if (align->xstart_pix_align)
+		damage.x = rounddown(damage.x, align->xstart_pix_align);
+	if (align->ystart_pix_align)
+		damage.y = rounddown(damage.y, align->ystart_pix_align);
+
+	damage.w = r - damage.x;
+	damage.h = b - damage.y;
+
+	if (align->width_pix_align)
+		damage.w = roundup(damage.w, align->width_pix_align);
+	if (align->height_pix_align)
+		damage.h = roundup(damage.h, align->height_pix_align);
+
+	damage.w = max_t(u32, damage.w, align->min_width);
+	damage.h = max_t(u32, damage.h, align->min_height);
+
+	/* alignment pushed the ROI past the panel, update everything */
+	if ((damage.x + damage.w > full.w) || (damage.y + damage.h > full.h))
+		return;
+
+	*roi = damage;
+}
+
+static void __update_dsi_bytes(struct msm_fb_data_type *mfd)
+{
+	struct mdss_mdp_ctl *ctl = mfd_to_ctl(mfd);
+	struct mdss_mdp_ctl *sctl = mdss_mdp_get_split_ctl(ctl);
+	struct mdss_overlay_private *mdp5_data = mfd_to_mdp5_data(mfd);
+	struct mdss_panel_info *pinfo = &ctl->panel_data->panel_info;
+	u32 bpp = pinfo->bpp;
+	u64 pixels;
+
+	if (is_dsc_compression(pinfo))
+		bpp = pinfo->dsc.bpp;
+	else if (pinfo->fbc.enabled)
+		bpp = pinfo->fbc.target_bpp;
+
+	pixels = (u64)ctl->roi.w * ctl->roi.h;
+	if (sctl)
+		pixels += (u64)sctl->roi.w * sctl->roi.h;
+
+	mdp5_data->dsi_frame_bytes = (u32)div_u64(pixels * bpp, 8);
+	mdp5_data->dsi_total_bytes += mdp5_data->dsi_frame_bytes;
+}
+
 static void __validate_and_set_roi(struct msm_fb_data_type *mfd,
 	struct mdp_display_commit *commit)
 {
@@ -1921,15 +2056,15 @@ static void __validate_and_set_roi(struct msm_fb_data_type *mfd,
 	struct mdp_rect tmp_roi = {0};
 	bool skip_partial_update = true;
 
-	if (!commit)
-		goto set_roi;
-
-	if (!memcmp(&commit->l_roi, &tmp_roi, sizeof(tmp_roi)) &&
-	    !memcmp(&commit->r_roi, &tmp_roi, sizeof(tmp_roi)))
-		goto set_roi;
-
-	rect_copy_mdp_to_mdss(&commit->l_roi, &l_roi);
-	rect_copy_mdp_to_mdss(&commit->r_roi, &r_roi);
+	if (!commit || (!memcmp(&commit->l_roi, &tmp_roi, sizeof(tmp_roi)) &&
+	    !memcmp(&commit->r_roi, &tmp_roi, sizeof(tmp_roi)))) {
+		__compute_auto_roi(mfd, &l_roi);
+		if (!l_roi.w || !l_roi.h)
+			goto set_roi;
+	} else {
+		rect_copy_mdp_to_mdss(&commit->l_roi, &l_roi);
+		rect_copy_mdp_to_mdss(&commit->r_roi, &r_roi);
+	}
 
 	pr_debug("input: l_roi:-> %d %d %d %d r_roi:-> %d %d %d %d\n",
 		l_roi.x, l_roi.y, l_roi.w, l_roi.h,
@@ -2005,6 +2140,10 @@ set_roi:
 		r_roi.x, r_roi.y, r_roi.w, r_roi.h);
 
 	mdss_mdp_set_roi(ctl, &l_roi, &r_roi);
+	__update_dsi_bytes(mfd);
+
+	list_for_each_entry(pipe, &mdp5_data->pipes_used, list)
+		pipe->last_dst = pipe->dst;
 }
 
 static bool __is_supported_candence(int cadence)
@@ -2858,6 +2997,146 @@ static void mdss_mdp_overlay_update_frc(struct msm_fb_data_type *mfd)
 	}
 }
 
+static bool __auto_dfps_supported(struct mdss_panel_info *pinfo)
+{
+	if (pinfo->type != MIPI_VIDEO_PANEL || !pinfo->dynamic_fps ||
+		!pinfo->min_fps || pinfo->min_fps >= pinfo->max_fps)
+		return false;
+
+	/* the other modes need the porch values from userspace */
+	return pinfo->dfps_update == DFPS_IMMEDIATE_CLK_UPDATE_MODE ||
+		pinfo->dfps_update == DFPS_IMMEDIATE_PORCH_UPDATE_MODE_VFP ||
+		pinfo->dfps_update == DFPS_IMMEDIATE_PORCH_UPDATE_MODE_HFP;
+}
+
+/*
+ * Pick the lowest refresh rate within the panel limits that is a multiple
+ * of the content rate, so that every frame stays on screen for the same
+ * number of refreshes.
+ */
+static u32 __auto_dfps_pick_fps(struct mdss_panel_info *pinfo,
+	u32 interval_us)
+{
+	u32 content_fps, fps;
+
+	if (!interval_us)
+		return pinfo->max_fps;
+
+	content_fps = DIV_ROUND_CLOSEST(USEC_PER_SEC, interval_us);
+	if (!content_fps)
+		content_fps = 1;
+
+	for (fps = content_fps; fps <= pinfo->max_fps; fps += content_fps) {
+		if (fps >= pinfo->min_fps)
+			return fps;
+	}
+
+	return pinfo->max_fps;
+}
+
+static void __auto_dfps_set_fps(struct msm_fb_data_type *mfd,
+	struct mdss_panel_data *pdata, u32 fps)
+{
+	struct mdss_overlay_private *mdp5_data = mfd_to_mdp5_data(mfd);
+	struct dynamic_fps_data data = {0};
+
+	if (fps == mdss_panel_get_framerate(&pdata->panel_info,
+			FPS_RESOLUTION_DEFAULT))
+		return;
+
+	data.fps = fps;
+	if (mdss_mdp_dfps_update_params(mfd, pdata, &data))
+		return;
+
+	mdp5_data->auto_dfps.switches++;
+	pr_debug("fb%d: auto dfps %u\n", mfd->index, fps);
+}
+
+/*
+ * Track the commit cadence and pick the refresh rate for it. The new rate
+ * is programmed by the mdss_mdp_ctl_update_fps() call of the kickoff.
+ */
+static void mdss_mdp_auto_dfps_kickoff(struct msm_fb_data_type *mfd)
+{
+	struct mdss_overlay_private *mdp5_data = mfd_to_mdp5_data(mfd);
+	struct mdss_mdp_auto_dfps *auto_dfps = &mdp5_data->auto_dfps;
+	struct mdss_mdp_ctl *ctl = mdp5_data->ctl;
+	struct mdss_panel_data *pdata = ctl->panel_data;
+	ktime_t now = ktime_get();
+	u32 interval, fps, cur_fps;
+
+	if (!auto_dfps->enable || !pdata ||
+		!__auto_dfps_supported(&pdata->panel_info))
+		return;
+
+	interval = min_t(s64, ktime_us_delta(now, auto_dfps->last_commit),
+		AUTO_DFPS_MAX_INTERVAL_US);
+	auto_dfps->last_commit = now;
+
+	cur_fps = mdss_panel_get_framerate(&pdata->panel_info,
+		FPS_RESOLUTION_DEFAULT);
+
+	/*
+	 * Step down slowly through the moving average, but go straight back
+	 * up when the content gets faster than the panel.
+	 */
+	if (!auto_dfps->interval_us ||
+		interval < USEC_PER_SEC / cur_fps)
+		auto_dfps->interval_us = interval;
+	else
+		auto_dfps->interval_us = (auto_dfps->interval_us * 7 +
+			interval) / 8;
+
+	if ((ktime_to_us(now) - ctl->last_input_time) <
+			AUTO_DFPS_INPUT_HOLD_US)
+		fps = pdata->panel_info.max_fps;
+	else
+		fps = __auto_dfps_pick_fps(&pdata->panel_info,
+			auto_dfps->interval_us);
+
+	__auto_dfps_set_fps(mfd, pdata, fps);
+
+	mod_delayed_work(system_wq, &auto_dfps->idle_work,
+		msecs_to_jiffies(AUTO_DFPS_IDLE_MS));
+}
+
+static void mdss_mdp_auto_dfps_idle_work(struct work_struct *work)
+{
+	struct mdss_overlay_private *mdp5_data = container_of(work,
+		struct mdss_overlay_private, auto_dfps.idle_work.work);
+	struct mdss_mdp_ctl *ctl;
+	struct mdss_panel_data *pdata;
+	struct msm_fb_data_type *mfd;
+
+	mutex_lock(&mdp5_data->ov_lock);
+
+	ctl = mdp5_data->ctl;
+	if (!mdp5_data->auto_dfps.enable || !ctl || !ctl->mfd ||
+		!ctl->panel_data || !mdss_mdp_ctl_is_power_on(ctl))
+		goto exit;
+
+	mfd = ctl->mfd;
+	pdata = ctl->panel_data;
+	if (!__auto_dfps_supported(&pdata->panel_info))
+		goto exit;
+
+	/* a frame is likely on its way after an input event */
+	if ((ktime_to_us(ktime_get()) - ctl->last_input_time) <
+			AUTO_DFPS_INPUT_HOLD_US) {
+		mod_delayed_work(system_wq, &mdp5_data->auto_dfps.idle_work,
+			msecs_to_jiffies(AUTO_DFPS_IDLE_MS));
+		goto exit;
+	}
+
+	mdp5_data->auto_dfps.interval_us = AUTO_DFPS_MAX_INTERVAL_US;
+	__auto_dfps_set_fps(mfd, pdata, pdata->panel_info.min_fps);
+
+	if (mdss_mdp_ctl_update_fps(ctl))
+		pr_err("fb%d: failed to set idle fps\n", mfd->index);
+exit:
+	mutex_unlock(&mdp5_data->ov_lock);
+}
+
 int mdss_mdp_overlay_kickoff(struct msm_fb_data_type *mfd,
 				struct mdp_display_commit *data)
 {
@@ -2987,6 +3266,8 @@ int mdss_mdp_overlay_kickoff(struct msm_fb_data_type *mfd,
 	 * bit are set within the same vsync period
 	 * regardless of  mdp revision.
 	 */
+	mdss_mdp_auto_dfps_kickoff(mfd);
+
 	ATRACE_BEGIN("fps_update");
 	ret = mdss_mdp_ctl_update_fps(ctl);
 	ATRACE_END("fps_update");
@@ -3931,8 +4212,64 @@ static ssize_t dynamic_fps_sysfs_wta_dfps(struct device *dev,
 static DEVICE_ATTR(dynamic_fps, S_IRUGO | S_IWUSR, dynamic_fps_sysfs_rda_dfps,
 	dynamic_fps_sysfs_wta_dfps);
 
+static ssize_t dynamic_fps_auto_show(struct device *dev,
+	struct device_attribute *attr, char *buf)
+{
+	struct fb_info *fbi = dev_get_drvdata(dev);
+	struct msm_fb_data_type *mfd = (struct msm_fb_data_type *)fbi->par;
+	struct mdss_overlay_private *mdp5_data = mfd_to_mdp5_data(mfd);
+	struct mdss_mdp_auto_dfps *auto_dfps = &mdp5_data->auto_dfps;
+
+	return scnprintf(buf, PAGE_SIZE,
+		"enable=%d interval_us=%u switches=%u\n",
+		auto_dfps->enable, auto_dfps->interval_us,
+		auto_dfps->switches);
+}
+
+static ssize_t dynamic_fps_auto_store(struct device *dev,
+	struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct fb_info *fbi = dev_get_drvdata(dev);
+	struct msm_fb_data_type *mfd = (struct msm_fb_data_type *)fbi->par;
+	struct mdss_overlay_private *mdp5_data = mfd_to_mdp5_data(mfd);
+	struct mdss_panel_data *pdata;
+	bool enable;
+	int rc;
+
+	rc = strtobool(buf, &enable);
+	if (rc)
+		return rc;
+
+	pdata = dev_get_platdata(&mfd->pdev->dev);
+	if (!pdata) {
+		pr_err("no panel connected for fb%d\n", mfd->index);
+		return -ENODEV;
+	}
+
+	if (enable && !__auto_dfps_supported(&pdata->panel_info)) {
+		pr_err("fb%d: auto dfps not supported by the panel\n",
+			mfd->index);
+		return -EINVAL;
+	}
+
+	mutex_lock(&mdp5_data->ov_lock);
+	mdp5_data->auto_dfps.enable = enable;
+	mdp5_data->auto_dfps.interval_us = 0;
+	mdp5_data->auto_dfps.last_commit = ktime_get();
+	mutex_unlock(&mdp5_data->ov_lock);
+
+	if (!enable)
+		cancel_delayed_work_sync(&mdp5_data->auto_dfps.idle_work);
+
+	return count;
+}
+
+static DEVICE_ATTR(dynamic_fps_auto, S_IRUGO | S_IWUSR,
+	dynamic_fps_auto_show, dynamic_fps_auto_store);
+
 static struct attribute *dynamic_fps_fs_attrs[] = {
 	&dev_attr_dynamic_fps.attr,
+	&dev_attr_dynamic_fps_auto.attr,
 	NULL,
 };
 static struct attribute_group dynamic_fps_fs_attrs_group = {
@@ -4340,6 +4677,50 @@ static ssize_t mdss_mdp_dyn_pu_store(struct device *dev,
 
 	return count;
 }
+
+static ssize_t mdss_mdp_pu_auto_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct fb_info *fbi = dev_get_drvdata(dev);
+	struct msm_fb_data_type *mfd = fbi->par;
+	struct mdss_overlay_private *mdp5_data = mfd_to_mdp5_data(mfd);
+
+	return scnprintf(buf, PAGE_SIZE, "%d\n", mdp5_data->auto_roi);
+}
+
+static ssize_t mdss_mdp_pu_auto_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct fb_info *fbi = dev_get_drvdata(dev);
+	struct msm_fb_data_type *mfd = fbi->par;
+	struct mdss_overlay_private *mdp5_data = mfd_to_mdp5_data(mfd);
+	bool enable;
+	int ret;
+
+	ret = strtobool(buf, &enable);
+	if (ret) {
+		pr_err("Invalid input for auto partial update: ret = %d\n",
+			ret);
+		return ret;
+	}
+
+	mutex_lock(&mdp5_data->list_lock);
+	mdp5_data->auto_roi = enable;
+	mutex_unlock(&mdp5_data->list_lock);
+
+	return count;
+}
+
+static ssize_t mdss_mdp_dsi_bytes_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct fb_info *fbi = dev_get_drvdata(dev);
+	struct msm_fb_data_type *mfd = fbi->par;
+	struct mdss_overlay_private *mdp5_data = mfd_to_mdp5_data(mfd);
+
+	return scnprintf(buf, PAGE_SIZE, "last=%u total=%llu\n",
+		mdp5_data->dsi_frame_bytes, mdp5_data->dsi_total_bytes);
+}
 static ssize_t mdss_mdp_cmd_autorefresh_show(struct device *dev,
 	struct device_attribute *attr, char *buf)
 {
@@ -4541,6 +4922,9 @@ static DEVICE_ATTR(ad, S_IRUGO | S_IWUSR | S_IWGRP, mdss_mdp_ad_show,
 	mdss_mdp_ad_store);
 static DEVICE_ATTR(dyn_pu, S_IRUGO | S_IWUSR | S_IWGRP, mdss_mdp_dyn_pu_show,
 	mdss_mdp_dyn_pu_store);
+static DEVICE_ATTR(partial_update_auto, S_IRUGO | S_IWUSR | S_IWGRP,
+	mdss_mdp_pu_auto_show, mdss_mdp_pu_auto_store);
+static DEVICE_ATTR(dsi_bytes, S_IRUGO, mdss_mdp_dsi_bytes_show, NULL);
 static DEVICE_ATTR(hist_event, S_IRUGO, mdss_mdp_hist_show_event, NULL);
 static DEVICE_ATTR(bl_event, S_IRUGO, mdss_mdp_bl_show_event, NULL);
 static DEVICE_ATTR(ad_event, S_IRUGO, mdss_mdp_ad_show_event, NULL);
@@ -4552,6 +4936,8 @@ static struct attribute *mdp_overlay_sysfs_attrs[] = {
 	&dev_attr_lineptr_value.attr,
 	&dev_attr_ad.attr,
 	&dev_attr_dyn_pu.attr,
+	&dev_attr_partial_update_auto.attr,
+	&dev_attr_dsi_bytes.attr,
 	&dev_attr_msm_misr_en.attr,
 	&dev_attr_msm_cmd_autorefresh_en.attr,
 	&dev_attr_hist_event.attr,
@@ -6796,6 +7182,8 @@ int mdss_mdp_overlay_init(struct msm_fb_data_type *mfd)
 	mutex_init(&mdp5_data->list_lock);
 	mutex_init(&mdp5_data->ov_lock);
 	mutex_init(&mdp5_data->dfps_lock);
+	INIT_DELAYED_WORK(&mdp5_data->auto_dfps.idle_work,
+		mdss_mdp_auto_dfps_idle_work);
 	mdp5_data->hw_refresh = true;
 	mdp5_data->cursor_ndx[CURSOR_PIPE_LEFT] = MSMFB_NEW_REQUEST;
 	mdp5_data->cursor_ndx[CURSOR_PIPE_RIGHT] = MSMFB_NEW_REQUEST;
@@ -100,6 +100,8 @@ struct mdp_pp_feature_ops {
 
 struct mdp_pp_driver_ops {
 	struct mdp_pp_feature_ops pp_ops[PP_FEATURE_MAX];
+	/* forget which LUTs the hardware holds, e.g. after power collapse */
+	void (*lut_cache_invalidate)(void);
 	void (*pp_opmode_config)(int location, struct pp_sts_type *pp_sts,
 			u32 *opmode, int side);
 	int (*get_hist_offset)(u32 block, u32 *ctl_off);
@@ -108,6 +110,23 @@ struct mdp_pp_driver_ops {
 	void (*gamut_clk_gate_en)(char __iomem *base_addr);
 };
 
+/* Number of register ready GC LUTs kept per display */
+#define PGC_PROG_SLOTS 4
+
+/*
+ * GC LUT packed in the layout written to the LUT registers, keyed by the
+ * checksum of the source tables so that switching back to a previously
+ * used config needs no repacking and, if the LUT is already loaded, no
+ * register writes at all.
+ */
+struct pp_pgc_prog_v1_7 {
+	u32 key;
+	u32 age;
+	u32 c0[PGC_LUT_ENTRIES / 2];
+	u32 c1[PGC_LUT_ENTRIES / 2];
+	u32 c2[PGC_LUT_ENTRIES / 2];
+};
+
 struct mdss_pp_res_type_v1_7 {
 	u32 pgc_lm_table_c0[MDSS_BLOCK_DISP_NUM][PGC_LUT_ENTRIES];
 	u32 pgc_lm_table_c1[MDSS_BLOCK_DISP_NUM][PGC_LUT_ENTRIES];
@@ -128,6 +147,10 @@ struct mdss_pp_res_type_v1_7 {
 	struct mdp_gamut_data_v1_7 gamut_v17_data[MDSS_BLOCK_DISP_NUM];
 	struct mdp_pcc_data_v1_7 pcc_v17_data[MDSS_BLOCK_DISP_NUM];
 	struct mdp_pa_data_v1_7 pa_v17_data[MDSS_BLOCK_DISP_NUM];
+	/* DSPP GC payload cache, allocated on first use */
+	struct pp_pgc_prog_v1_7 *pgc_prog[MDSS_BLOCK_DISP_NUM];
+	struct pp_pgc_prog_v1_7 *pgc_prog_cur[MDSS_BLOCK_DISP_NUM];
+	u32 pgc_prog_age;
 };
 
 struct mdss_pp_res_type {
@@ -169,6 +192,8 @@ struct mdss_pp_res_type {
 
 void *pp_get_driver_ops_v1_7(struct mdp_pp_driver_ops *ops);
 void *pp_get_driver_ops_v3(struct mdp_pp_driver_ops *ops);
+void pp_pgc_prog_prepare_v1_7(struct mdss_pp_res_type_v1_7 *res,
+			      u32 disp_num);
 
 
 static inline void pp_sts_set_split_bits(u32 *sts, u32 bits)
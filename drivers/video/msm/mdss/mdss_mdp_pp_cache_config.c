@@ -1101,6 +1101,8 @@ static int pp_pgc_lut_cache_params_v1_7(struct mdp_pgc_lut_data *config,
 		goto bail_out;
 	}
 	v17_cache_data->len = PGC_LUT_ENTRIES;
+	if (location == DSPP)
+		pp_pgc_prog_prepare_v1_7(res_cache, disp_num);
 	return 0;
 bail_out:
 	if (location == DSPP)
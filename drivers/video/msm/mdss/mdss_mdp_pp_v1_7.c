@@ -15,6 +15,8 @@
 #define pr_fmt(fmt)	"%s: " fmt, __func__
 
 #include <linux/uaccess.h>
+#include <linux/vmalloc.h>
+#include <linux/crc32.h>
 #include "mdss_fb.h"
 #include "mdss_mdp.h"
 #include "mdss_mdp_pp.h"
@@ -183,6 +185,12 @@ static u32 dither_depth_map[DITHER_DEPTH_MAP_INDEX] = {
 
 static struct mdss_pp_res_type_v1_7 config_data;
 
+/* GC LUT currently loaded in each DSPP, key 0 when unknown */
+static struct {
+	char __iomem *base;
+	u32 key;
+} pgc_hw_state[MDSS_MDP_MAX_DSPP];
+
 static int pp_hist_lut_get_config(char __iomem *base_addr, void *cfg_data,
 			   u32 block_type, u32 disp_num);
 static int pp_hist_lut_set_config(char __iomem *base_addr,
@@ -242,6 +250,7 @@ static int pp_gamut_get_version(u32 *version);
 static int pp_dither_get_version(u32 *version);
 static int pp_hist_lut_get_version(u32 *version);
 static void pp_gamut_clock_gating_en(char __iomem *base_addr);
+static void pp_lut_cache_invalidate(void);
 
 void *pp_get_driver_ops_v1_7(struct mdp_pp_driver_ops *ops)
 {
@@ -301,6 +310,7 @@ void *pp_get_driver_ops_v1_7(struct mdp_pp_driver_ops *ops)
 	ops->get_hist_isr_info = pp_get_hist_isr;
 	ops->is_sspp_hist_supp = pp_is_sspp_hist_supp;
 	ops->gamut_clk_gate_en = pp_gamut_clock_gating_en;
+	ops->lut_cache_invalidate = pp_lut_cache_invalidate;
 	return &config_data;
 }
 
@@ -1869,14 +1879,104 @@ exit:
 }
 
 
+static void pp_lut_cache_invalidate(void)
+{
+	memset(pgc_hw_state, 0, sizeof(pgc_hw_state));
+}
+
+static u32 *pp_pgc_hw_key(char __iomem *base_addr)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(pgc_hw_state); i++) {
+		if (pgc_hw_state[i].base == base_addr)
+			return &pgc_hw_state[i].key;
+		if (!pgc_hw_state[i].base) {
+			pgc_hw_state[i].base = base_addr;
+			return &pgc_hw_state[i].key;
+		}
+	}
+	return NULL;
+}
+
+static void pp_pgc_pack(u32 *dst, u32 *src)
+{
+	int i;
+
+	for (i = 0; i < PGC_LUT_ENTRIES; i += 2)
+		dst[i / 2] = (src[i] & PGC_DATA_MASK) |
+			((src[i + 1] & PGC_DATA_MASK) << PGC_ODD_SHIFT);
+}
+
+/*
+ * Called once the DSPP GC tables of @disp_num have been cached, with the
+ * pp mutex held. Finds or builds the register ready copy of the tables so
+ * that the commit only has to stream it out.
+ */
+void pp_pgc_prog_prepare_v1_7(struct mdss_pp_res_type_v1_7 *res,
+			      u32 disp_num)
+{
+	struct mdp_pgc_lut_data_v1_7 *lut = &res->pgc_dspp_v17_data[disp_num];
+	struct pp_pgc_prog_v1_7 *slots, *prog = NULL;
+	u32 sz = PGC_LUT_ENTRIES * sizeof(u32);
+	u32 key;
+	int i;
+
+	res->pgc_prog_cur[disp_num] = NULL;
+	if (!res->pgc_prog[disp_num]) {
+		res->pgc_prog[disp_num] =
+			vzalloc(PGC_PROG_SLOTS * sizeof(*slots));
+		if (!res->pgc_prog[disp_num])
+			return;
+	}
+	slots = res->pgc_prog[disp_num];
+
+	key = crc32_le(~0, (u8 *)lut->c0_data, sz);
+	key = crc32_le(key, (u8 *)lut->c1_data, sz);
+	key = crc32_le(key, (u8 *)lut->c2_data, sz);
+	if (!key)
+		key = 1;
+
+	for (i = 0; i < PGC_PROG_SLOTS; i++) {
+		if (slots[i].key == key) {
+			prog = &slots[i];
+			break;
+		}
+		if (!prog || slots[i].age < prog->age)
+			prog = &slots[i];
+	}
+
+	if (prog->key != key) {
+		pp_pgc_pack(prog->c0, lut->c0_data);
+		pp_pgc_pack(prog->c1, lut->c1_data);
+		pp_pgc_pack(prog->c2, lut->c2_data);
+		prog->key = key;
+	}
+	prog->age = ++res->pgc_prog_age;
+	res->pgc_prog_cur[disp_num] = prog;
+}
+
+static struct pp_pgc_prog_v1_7 *pp_pgc_prog_get(
+		struct mdp_pgc_lut_data *pgc_data)
+{
+	u32 disp_num = PP_BLOCK(pgc_data->block) - MDP_LOGICAL_BLOCK_DISP_0;
+
+	if (disp_num >= MDSS_BLOCK_DISP_NUM ||
+	    pgc_data->cfg_payload != &config_data.pgc_dspp_v17_data[disp_num])
+		return NULL;
+
+	return config_data.pgc_prog_cur[disp_num];
+}
+
 static int pp_pgc_set_config(char __iomem *base_addr,
 		struct pp_sts_type *pp_sts, void *cfg_data,
 		u32 block_type)
 {
 	char __iomem *c0 = NULL, *c1 = NULL, *c2 = NULL;
-	u32 val = 0, i = 0, *sts = NULL;
+	u32 val = 0, i = 0, *sts = NULL, *hw_key = NULL;
 	struct mdp_pgc_lut_data *pgc_data = NULL;
 	struct mdp_pgc_lut_data_v1_7  *pgc_data_v17 = NULL;
+	struct pp_pgc_prog_v1_7 *prog = NULL;
 
 	if (!base_addr || !cfg_data || !pp_sts) {
 		pr_err("invalid params base_addr %pK cfg_data %pK pp_sts_type %pK\n",
@@ -1916,6 +2016,15 @@ static int pp_pgc_set_config(char __iomem *base_addr,
 			pgc_data_v17->c1_data, pgc_data_v17->c2_data);
 		return -EINVAL;
 	}
+	if (block_type == DSPP) {
+		prog = pp_pgc_prog_get(pgc_data);
+		hw_key = pp_pgc_hw_key(base_addr);
+	}
+	if (prog && hw_key && *hw_key == prog->key) {
+		pr_debug("GC LUT %08x already loaded\n", prog->key);
+		goto set_ops;
+	}
+
 	c0 = base_addr + PGC_C0_LUT_INDEX;
 	c1 = c0 + PGC_C1C2_LUT_OFF;
 	c2 = c1 + PGC_C1C2_LUT_OFF;
@@ -1923,7 +2032,12 @@ static int pp_pgc_set_config(char __iomem *base_addr,
 	writel_relaxed(0, c0 + PGC_INDEX_OFF);
 	writel_relaxed(0, c1 + PGC_INDEX_OFF);
 	writel_relaxed(0, c2 + PGC_INDEX_OFF);
-	for (i = 0; i < PGC_LUT_ENTRIES; i += 2) {
+	for (i = 0; prog && i < PGC_LUT_ENTRIES / 2; i++) {
+		writel_relaxed(prog->c0[i], c0);
+		writel_relaxed(prog->c1[i], c1);
+		writel_relaxed(prog->c2[i], c2);
+	}
+	for (i = 0; !prog && i < PGC_LUT_ENTRIES; i += 2) {
 		val = pgc_data_v17->c0_data[i] & PGC_DATA_MASK;
 		val |= (pgc_data_v17->c0_data[i + 1] & PGC_DATA_MASK) <<
 			PGC_ODD_SHIFT;
@@ -1941,6 +2055,8 @@ static int pp_pgc_set_config(char __iomem *base_addr,
 		val = PGC_SWAP;
 		writel_relaxed(val, base_addr + PGC_LUT_SWAP);
 	}
+	if (hw_key)
+		*hw_key = prog ? prog->key : 0;
 
 set_ops:
 	if (pgc_data->flags & MDP_PP_OPS_DISABLE) {
@@ -156,8 +156,12 @@ struct kioctx {
 static DEFINE_SPINLOCK(aio_nr_lock);
 unsigned long aio_nr;		/* current system wide number of aio requests */
 unsigned long aio_max_nr = 0x10000; /* system wide maximum number of aio requests */
+int aio_offload = 1;		/* punt O_DIRECT rw that would block to aio_wq */
+int aio_poll_us;		/* io_getevents() busy-polls this long first */
 /*----end sysctl variables---*/
 
+static struct workqueue_struct *aio_wq;
+
 static struct kmem_cache	*kiocb_cachep;
 static struct kmem_cache	*kioctx_cachep;
 
@@ -238,6 +242,10 @@ static int __init aio_setup(void)
 	kiocb_cachep = KMEM_CACHE(kiocb, SLAB_HWCACHE_ALIGN|SLAB_PANIC);
 	kioctx_cachep = KMEM_CACHE(kioctx,SLAB_HWCACHE_ALIGN|SLAB_PANIC);
 
+	aio_wq = alloc_workqueue("aio", WQ_UNBOUND | WQ_HIGHPRI, 0);
+	if (!aio_wq)
+		panic("Failed to create aio workqueue.");
+
 	pr_debug("sizeof(struct page) = %zu\n", sizeof(struct page));
 
 	return 0;
@@ -1217,6 +1225,38 @@ static bool aio_read_events(struct kioctx *ctx, long min_nr, long nr,
 	return ret < 0 || *i >= min_nr;
 }
 
+/*
+ * Spins on the ring for up to aio_poll_us before read_events() goes to
+ * sleep, which saves the wakeup latency for readers whose I/O completes
+ * within a few tens of microseconds. Returns true if it got enough events,
+ * and takes the time spent off a finite timeout otherwise.
+ */
+static bool aio_poll_events(struct kioctx *ctx, long min_nr, long nr,
+			    struct io_event __user *event, long *i,
+			    ktime_t *until)
+{
+	u64 poll_ns = (u64)ACCESS_ONCE(aio_poll_us) * NSEC_PER_USEC;
+	u64 start, now;
+
+	if (!poll_ns || (until->tv64 != KTIME_MAX &&
+			 ktime_to_ns(*until) <= poll_ns))
+		return false;
+
+	start = now = local_clock();
+	while (now - start < poll_ns) {
+		if (aio_read_events(ctx, min_nr, nr, event, i))
+			return true;
+		if (need_resched() || signal_pending(current))
+			break;
+		cpu_relax();
+		now = local_clock();
+	}
+
+	if (until->tv64 != KTIME_MAX)
+		*until = ktime_sub_ns(*until, now - start);
+	return false;
+}
+
 static long read_events(struct kioctx *ctx, long min_nr, long nr,
 			struct io_event __user *event,
 			struct timespec __user *timeout)
@@ -1233,6 +1273,9 @@ static long read_events(struct kioctx *ctx, long min_nr, long nr,
 		until = timespec_to_ktime(ts);
 	}
 
+	if (aio_poll_events(ctx, min_nr, nr, event, &ret, &until))
+		return ret;
+
 	/*
 	 * Note that aio_read_events() is being called as the conditional - i.e.
 	 * we're calling it after prepare_to_wait() has set task state to
@@ -1384,6 +1427,121 @@ static ssize_t aio_setup_single_vector(struct kiocb *kiocb,
 	return 0;
 }
 
+static ssize_t aio_do_rw(struct kiocb *req, int rw, aio_rw_op *rw_op,
+			 rw_iter_op *iter_op, struct iovec *iovec,
+			 unsigned long nr_segs)
+{
+	struct file *file = req->ki_filp;
+	struct iov_iter iter;
+	ssize_t ret;
+
+	if (rw == WRITE)
+		file_start_write(file);
+
+	if (iter_op) {
+		iov_iter_init(&iter, rw, iovec, nr_segs, req->ki_nbytes);
+		ret = iter_op(req, &iter);
+	} else {
+		ret = rw_op(req, iovec, nr_segs, req->ki_pos);
+	}
+
+	if (rw == WRITE)
+		file_end_write(file);
+	return ret;
+}
+
+static void aio_finish_iocb(struct kiocb *req, ssize_t ret)
+{
+	if (ret != -EIOCBQUEUED) {
+		/*
+		 * There's no easy way to restart the syscall since other AIO's
+		 * may be already running. Just fail this IO with EINTR.
+		 */
+		if (unlikely(ret == -ERESTARTSYS || ret == -ERESTARTNOINTR ||
+			     ret == -ERESTARTNOHAND ||
+			     ret == -ERESTART_RESTARTBLOCK))
+			ret = -EINTR;
+		aio_complete(req, ret, 0);
+	}
+}
+
+/*
+ * Direct I/O is only asynchronous once its bios are submitted. Before
+ * that the submitter writes back and invalidates any cached pages of the
+ * range under their page locks, and waits for a free request if the
+ * queue is congested; a write to a regular file also needs i_mutex.
+ * When any of that is likely, the whole rw is handed to aio_wq instead,
+ * so that io_submit() itself does not sleep.
+ */
+struct aio_offload {
+	struct work_struct	work;
+	struct kiocb		*req;
+	struct mm_struct	*mm;
+	int			rw;
+	aio_rw_op		*rw_op;
+	rw_iter_op		*iter_op;
+	unsigned long		nr_segs;
+	struct iovec		iovec[];
+};
+
+static bool aio_would_block(struct file *file, int rw)
+{
+	struct address_space *mapping = file->f_mapping;
+	struct inode *inode = mapping->host;
+	struct backing_dev_info *bdi = mapping->backing_dev_info;
+
+	if (!ACCESS_ONCE(aio_offload) || !(file->f_flags & O_DIRECT))
+		return false;
+	if (mapping->nrpages)
+		return true;
+	if (rw == READ)
+		return bdi_read_congested(bdi);
+	return bdi_write_congested(bdi) ||
+		(S_ISREG(inode->i_mode) && mutex_is_locked(&inode->i_mutex));
+}
+
+static void aio_offload_work(struct work_struct *work)
+{
+	struct aio_offload *o = container_of(work, struct aio_offload, work);
+	ssize_t ret;
+
+	use_mm(o->mm);
+	ret = aio_do_rw(o->req, o->rw, o->rw_op, o->iter_op, o->iovec,
+			o->nr_segs);
+	unuse_mm(o->mm);
+
+	aio_finish_iocb(o->req, ret);
+	mmput(o->mm);
+	kfree(o);
+}
+
+static bool aio_offload_rw(struct kiocb *req, int rw, aio_rw_op *rw_op,
+			   rw_iter_op *iter_op, struct iovec *iovec,
+			   unsigned long nr_segs)
+{
+	struct aio_offload *o;
+
+	o = kmalloc(sizeof(*o) + nr_segs * sizeof(*iovec), GFP_KERNEL);
+	if (!o)
+		return false;
+
+	o->mm = get_task_mm(current);
+	if (!o->mm) {
+		kfree(o);
+		return false;
+	}
+
+	INIT_WORK(&o->work, aio_offload_work);
+	o->req = req;
+	o->rw = rw;
+	o->rw_op = rw_op;
+	o->iter_op = iter_op;
+	o->nr_segs = nr_segs;
+	memcpy(o->iovec, iovec, nr_segs * sizeof(*iovec));
+	queue_work(aio_wq, &o->work);
+	return true;
+}
+
 /*
  * aio_run_iocb:
  *	Performs the initial checks and io submission.
@@ -1399,7 +1557,6 @@ static ssize_t aio_run_iocb(struct kiocb *req, unsigned opcode,
 	aio_rw_op *rw_op;
 	rw_iter_op *iter_op;
 	struct iovec inline_vecs[UIO_FASTIOV], *iovec = inline_vecs;
-	struct iov_iter iter;
 
 	switch (opcode) {
 	case IOCB_CMD_PREAD:
@@ -1447,18 +1604,12 @@ rw_common:
 			break;
 		}
 
-		if (rw == WRITE)
-			file_start_write(file);
-
-		if (iter_op) {
-			iov_iter_init(&iter, rw, iovec, nr_segs, req->ki_nbytes);
-			ret = iter_op(req, &iter);
-		} else {
-			ret = rw_op(req, iovec, nr_segs, req->ki_pos);
-		}
-
-		if (rw == WRITE)
-			file_end_write(file);
+		if (aio_would_block(file, rw) &&
+		    aio_offload_rw(req, rw, rw_op, iter_op, iovec, nr_segs))
+			ret = -EIOCBQUEUED;
+		else
+			ret = aio_do_rw(req, rw, rw_op, iter_op, iovec,
+					nr_segs);
 		break;
 
 	case IOCB_CMD_FDSYNC:
@@ -1483,18 +1634,7 @@ rw_common:
 	if (iovec != inline_vecs)
 		kfree(iovec);
 
-	if (ret != -EIOCBQUEUED) {
-		/*
-		 * There's no easy way to restart the syscall since other AIO's
-		 * may be already running. Just fail this IO with EINTR.
-		 */
-		if (unlikely(ret == -ERESTARTSYS || ret == -ERESTARTNOINTR ||
-			     ret == -ERESTARTNOHAND ||
-			     ret == -ERESTART_RESTARTBLOCK))
-			ret = -EINTR;
-		aio_complete(req, ret, 0);
-	}
-
+	aio_finish_iocb(req, ret);
 	return 0;
 }
 
@@ -2155,7 +2155,7 @@ static int elf_core_dump(struct coredump_params *cprm)
 #ifdef CONFIG_COREDUMP_GZ
 	/* For compressing in kernel, re-write the padding zero nums */
 	if (dump_compressed(cprm))
-		page_padding_num = dataoff - cprm->zstr.total_in;
+		page_padding_num = dataoff - cprm->gz_total_in;
 #endif
 	if (!dump_skip(cprm, page_padding_num))
 		goto end_coredump;
@@ -870,7 +870,7 @@ int dump_align(struct coredump_params *cprm, int align)
 	if (!dump_compressed(cprm))
 		mod = cprm->written & (align - 1);
 	else
-		mod = cprm->zstr.total_in & (align - 1);
+		mod = cprm->gz_total_in & (align - 1);
 #else
 	mod = cprm->written & (align - 1);
 #endif
@@ -1,124 +1,296 @@
 #include <linux/crc32.h>
+#include <linux/completion.h>
+#include <linux/cpumask.h>
 #include <linux/fs.h>
+#include <linux/lz4.h>
+#include <linux/slab.h>
 #include <linux/vmalloc.h>
+#include <linux/workqueue.h>
+#include <linux/zlib.h>
 
 #include "internal.h"
 #include "coredump_gz.h"
 
-#define  OUT_BUF_SIZE  (100*1024)
+/*
+ * The dump is cut into chunks of CHUNK_SIZE bytes, each compressed on
+ * its own by a worker on the unbound workqueue while the dumping task
+ * carries on filling the next one. Finished chunks are written out in
+ * order by the dumping task itself, so dump_interrupted() and the core
+ * limit keep working as before.
+ *
+ * For gzip every chunk is a complete gzip member; a concatenation of
+ * members is a valid gzip file. For LZ4 the file uses the legacy frame
+ * format, in which every chunk is one independently compressed block.
+ *
+ * At most MAX_CHUNKS chunks are in flight, which caps the memory taken
+ * by a compressed dump at about MAX_CHUNKS * (2 * CHUNK_SIZE + the
+ * deflate workspace), whatever the size of the process.
+ */
+#define  CHUNK_SIZE	(256*1024)
+#define  MAX_CHUNKS	4
+/* room for incompressible data, plus the gzip header and footer */
+#define  OUT_BUF_SIZE	(CHUNK_SIZE + CHUNK_SIZE/8 + 64)
+
+#define  GZ_HEADER_SIZE	10
+#define  GZ_FOOTER_SIZE	8
+#define  LZ4_LEGACY_MAGIC	0x184c2102
+
+struct gz_chunk {
+	struct work_struct work;
+	struct completion done;
+	int format;
+	bool busy;
+	bool failed;
+	unsigned char *in;
+	unsigned int in_len;
+	unsigned char *out;
+	size_t out_len;
+	void *workspace;
+	z_stream zstr;
+};
 
 void check_for_gz(int ispipe, const char *cp, struct coredump_params *cprm)
 {
-	if (!ispipe) {
-		char *str = strrchr(cp, '.');
+	char *str;
 
-		cprm->gz = str && !strcmp(str, ".gz");
-	} else {
-		cprm->gz = 0;
-	}
+	cprm->gz = 0;
+	if (ispipe)
+		return;
+
+	str = strrchr(cp, '.');
+	if (!str)
+		return;
+	if (!strcmp(str, ".gz"))
+		cprm->gz = DUMP_GZ;
+#ifdef CONFIG_COREDUMP_LZ4
+	else if (!strcmp(str, ".lz4"))
+		cprm->gz = DUMP_LZ4;
+#endif
 }
 
-int gz_init(struct coredump_params *cprm)
+static void put_le32(unsigned char *p, u32 val)
+{
+	p[0] = (val & 0x000000FF);
+	p[1] = (val & 0x0000FF00) >> 8;
+	p[2] = (val & 0x00FF0000) >> 16;
+	p[3] = (val & 0xFF000000) >> 24;
+}
+
+static int gz_compress_member(struct gz_chunk *c)
 {
-	unsigned char gz_magic[10] = { /* gzip magic header */
+	static const unsigned char gz_magic[GZ_HEADER_SIZE] = {
 		0x1f, 0x8b, Z_DEFLATED, 0, 0, 0, 0, 0, 0, 0x03 };
+	u32 crc = crc32_le(~0, c->in, c->in_len);
+	unsigned char *footer;
 
-	cprm->crc = ~0; /* init */
+	if (zlib_deflateReset(&c->zstr) != Z_OK)
+		return -EINVAL;
 
-	cprm->out_buf = vmalloc(OUT_BUF_SIZE);
-	if (!cprm->out_buf) {
-		pr_warn("Failed to allocate deflate buffer");
-		return 0;
+	memcpy(c->out, gz_magic, GZ_HEADER_SIZE);
+	c->zstr.next_in = c->in;
+	c->zstr.avail_in = c->in_len;
+	c->zstr.next_out = c->out + GZ_HEADER_SIZE;
+	c->zstr.avail_out = OUT_BUF_SIZE - GZ_HEADER_SIZE - GZ_FOOTER_SIZE;
+	if (zlib_deflate(&c->zstr, Z_FINISH) != Z_STREAM_END)
+		return -EOVERFLOW;
+
+	footer = c->zstr.next_out;
+	put_le32(footer, ~crc);
+	put_le32(footer + 4, c->in_len);
+	c->out_len = footer + GZ_FOOTER_SIZE - c->out;
+	return 0;
+}
+
+#ifdef CONFIG_COREDUMP_LZ4
+static int lz4_compress_block(struct gz_chunk *c)
+{
+	size_t len = OUT_BUF_SIZE - 4;
+
+	if (lz4_compress(c->in, c->in_len, c->out + 4, &len, c->workspace))
+		return -EINVAL;
+
+	put_le32(c->out, len);
+	c->out_len = len + 4;
+	return 0;
+}
+#else
+static int lz4_compress_block(struct gz_chunk *c) { return -EINVAL; }
+#endif
+
+static void gz_chunk_work(struct work_struct *work)
+{
+	struct gz_chunk *c = container_of(work, struct gz_chunk, work);
+
+	if (c->format == DUMP_LZ4)
+		c->failed = lz4_compress_block(c) != 0;
+	else
+		c->failed = gz_compress_member(c) != 0;
+
+	complete(&c->done);
+}
+
+static void gz_free_chunks(struct coredump_params *cprm)
+{
+	int i;
+
+	for (i = 0; i < cprm->gz_nr_chunks; i++) {
+		struct gz_chunk *c = &cprm->gz_chunks[i];
+
+		if (c->format == DUMP_GZ)
+			zlib_deflateEnd(&c->zstr);
+		vfree(c->workspace);
+		vfree(c->out);
+		vfree(c->in);
+	}
+	kfree(cprm->gz_chunks);
+	cprm->gz_chunks = NULL;
+	cprm->gz_nr_chunks = 0;
+}
+
+static int gz_alloc_chunk(struct gz_chunk *c, int format)
+{
+	size_t wsize;
+
+	c->in = vmalloc(CHUNK_SIZE);
+	c->out = vmalloc(OUT_BUF_SIZE);
+	if (format == DUMP_LZ4)
+		wsize = LZ4_MEM_COMPRESS;
+	else
+		wsize = zlib_deflate_workspacesize(-15, 6);
+	c->workspace = vmalloc(wsize);
+	if (!c->in || !c->out || !c->workspace)
+		return -ENOMEM;
+
+	if (format == DUMP_GZ) {
+		c->zstr.workspace = c->workspace;
+		if (Z_OK != zlib_deflateInit2(&c->zstr,
+					7, /* compression level */
+					Z_DEFLATED,
+					-15, /* window bits */
+					6, /* mem level */
+					Z_DEFAULT_STRATEGY))
+			return -EINVAL;
 	}
 
-	cprm->deflate_workspace = vmalloc(zlib_deflate_workspacesize(-15, 6));
-	if (!cprm->deflate_workspace) {
-		vfree(cprm->out_buf);
-		pr_warn("Failed to allocate deflate workspace\n");
+	/* only now is there anything for gz_free_chunks() to end */
+	c->format = format;
+	INIT_WORK(&c->work, gz_chunk_work);
+	init_completion(&c->done);
+	return 0;
+}
+
+int gz_init(struct coredump_params *cprm)
+{
+	int nr = clamp_t(int, num_online_cpus(), 1, MAX_CHUNKS);
+	unsigned char lz4_magic[4];
+
+	cprm->gz_total_in = 0;
+	cprm->gz_cur = 0;
+	cprm->gz_nr_chunks = 0;
+	cprm->gz_chunks = kcalloc(nr, sizeof(*cprm->gz_chunks), GFP_KERNEL);
+	if (!cprm->gz_chunks) {
+		pr_warn("Failed to allocate compression chunks\n");
 		return 0;
 	}
 
-	memset(&cprm->zstr, 0, sizeof(z_stream));
-	cprm->zstr.workspace = cprm->deflate_workspace;
-	if (Z_OK != zlib_deflateInit2(&cprm->zstr,
-				7, /* compression level */
-				Z_DEFLATED,
-				-15, /* window bits */
-				6, /* mem level */
-				Z_DEFAULT_STRATEGY)) {
-		pr_warn("deflateInit failed\n");
-		vfree(cprm->deflate_workspace);
-		vfree(cprm->out_buf);
+	/* fewer chunks only means less parallelism */
+	while (cprm->gz_nr_chunks < nr) {
+		struct gz_chunk *c = &cprm->gz_chunks[cprm->gz_nr_chunks];
+
+		if (gz_alloc_chunk(c, cprm->gz)) {
+			vfree(c->workspace);
+			vfree(c->out);
+			vfree(c->in);
+			break;
+		}
+		cprm->gz_nr_chunks++;
+	}
+	if (!cprm->gz_nr_chunks) {
+		pr_warn("Failed to allocate compression buffers\n");
+		gz_free_chunks(cprm);
 		return 0;
 	}
 
-	return __dump_emit(cprm, gz_magic, 10);
+	if (cprm->gz != DUMP_LZ4)
+		return 1;
+
+	put_le32(lz4_magic, LZ4_LEGACY_MAGIC);
+	return __dump_emit(cprm, lz4_magic, sizeof(lz4_magic));
+}
+
+static void gz_submit(struct gz_chunk *c)
+{
+	c->busy = true;
+	reinit_completion(&c->done);
+	queue_work(system_unbound_wq, &c->work);
+}
+
+/* waits for a chunk in flight, and writes it out if nothing failed yet */
+static int gz_collect(struct coredump_params *cprm, struct gz_chunk *c,
+		      int all_fine)
+{
+	if (!c->busy)
+		return all_fine;
+
+	wait_for_completion(&c->done);
+	c->busy = false;
+	c->in_len = 0;
+	if (c->failed) {
+		pr_warn("Failed to compress core dump chunk\n");
+		return 0;
+	}
+	return all_fine && __dump_emit(cprm, c->out, c->out_len);
 }
 
 int gz_dump_write(struct coredump_params *cprm, const void *addr, int nr)
 {
-	int all_fine = 1;
+	const unsigned char *src = addr;
 
-	cprm->crc = crc32_le(cprm->crc, addr, nr);
+	while (nr) {
+		struct gz_chunk *c = &cprm->gz_chunks[cprm->gz_cur];
+		unsigned int len;
 
-	cprm->zstr.next_in = (void *)addr;
-	cprm->zstr.avail_in = nr;
+		if (!gz_collect(cprm, c, 1))
+			return 0;
 
-	do {
-		cprm->zstr.next_out = cprm->out_buf;
-		cprm->zstr.avail_out = OUT_BUF_SIZE;
+		len = min_t(unsigned int, nr, CHUNK_SIZE - c->in_len);
+		memcpy(c->in + c->in_len, src, len);
+		c->in_len += len;
+		cprm->gz_total_in += len;
+		src += len;
+		nr -= len;
 
-		if (zlib_deflate(&cprm->zstr, Z_NO_FLUSH) == Z_OK) {
-			/* new output generated */
-			all_fine = __dump_emit(cprm, cprm->out_buf,
-					OUT_BUF_SIZE - cprm->zstr.avail_out);
+		if (c->in_len == CHUNK_SIZE) {
+			gz_submit(c);
+			cprm->gz_cur = (cprm->gz_cur + 1) % cprm->gz_nr_chunks;
 		}
-	} while ((cprm->zstr.avail_out != OUT_BUF_SIZE) && all_fine);
+	}
 
-	return all_fine;
+	return 1;
 }
 
 int gz_finish(struct coredump_params *cprm)
 {
-	unsigned char gz_footer[8];
+	struct gz_chunk *c;
 	int all_fine = 1;
-	int ret;
-
-	cprm->zstr.next_in = 0;
-	cprm->zstr.avail_in = 0;
+	int i;
 
-	do {
-		cprm->zstr.next_out  = cprm->out_buf;
-		cprm->zstr.avail_out = OUT_BUF_SIZE;
-
-		ret = zlib_deflate(&cprm->zstr, Z_FINISH);
-		if ((ret == Z_OK) || (ret == Z_STREAM_END)) {
-			/* new output generated */
-			all_fine = __dump_emit(cprm, cprm->out_buf,
-					OUT_BUF_SIZE - cprm->zstr.avail_out);
-		}
-	} while ((cprm->zstr.avail_out != OUT_BUF_SIZE)
-			&& all_fine && (ret != Z_STREAM_END));
-
-	zlib_deflateEnd(&cprm->zstr);
+	/* dump_init() failed */
+	if (!cprm->gz_chunks)
+		return 0;
 
-	if (!all_fine)
-		goto out;
+	c = &cprm->gz_chunks[cprm->gz_cur];
+	if (!c->busy && c->in_len)
+		gz_submit(c);
 
-	gz_footer[0] = (~cprm->crc & 0x000000FF);
-	gz_footer[1] = (~cprm->crc & 0x0000FF00) >> 8;
-	gz_footer[2] = (~cprm->crc & 0x00FF0000) >> 16;
-	gz_footer[3] = (~cprm->crc & 0xFF000000) >> 24;
-	gz_footer[4] = (cprm->zstr.total_in & 0x000000FF);
-	gz_footer[5] = (cprm->zstr.total_in & 0x0000FF00) >> 8;
-	gz_footer[6] = (cprm->zstr.total_in & 0x00FF0000) >> 16;
-	gz_footer[7] = (cprm->zstr.total_in & 0xFF000000) >> 24;
+	/* oldest first; nothing can be freed while a worker still runs */
+	for (i = 1; i <= cprm->gz_nr_chunks; i++) {
+		int idx = (cprm->gz_cur + i) % cprm->gz_nr_chunks;
 
-	all_fine =  __dump_emit(cprm, gz_footer, 8);
+		all_fine = gz_collect(cprm, &cprm->gz_chunks[idx], all_fine);
+	}
 
-out:
-	vfree(cprm->deflate_workspace);
-	vfree(cprm->out_buf);
+	gz_free_chunks(cprm);
 
 	return all_fine;
 }
@@ -4,6 +4,10 @@
 #include <linux/module.h>
 #include <linux/binfmts.h>
 
+/* cprm->gz */
+#define DUMP_GZ		1
+#define DUMP_LZ4	2
+
 #ifdef CONFIG_COREDUMP_GZ
 static inline int dump_compressed(struct coredump_params *cprm)
 {
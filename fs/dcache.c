@@ -119,6 +119,41 @@ struct dentry_stat_t dentry_stat = {
 static DEFINE_PER_CPU(long, nr_dentry);
 static DEFINE_PER_CPU(long, nr_dentry_unused);
 
+/* a chain this long means the hash is too small for the tree */
+#define D_LONG_CHAIN	8
+
+struct d_lookup_pcpu_stat {
+	unsigned long lookups;
+	unsigned long chain_steps;
+	unsigned long long_chains;
+	unsigned long max_chain;
+	unsigned long rcu_unlazy;
+	unsigned long rcu_restarts;
+};
+static DEFINE_PER_CPU(struct d_lookup_pcpu_stat, d_lookup_stats);
+
+struct dentry_lookup_stat_t dentry_lookup_stat;
+
+static inline void d_count_lookup(unsigned int steps)
+{
+	this_cpu_inc(d_lookup_stats.lookups);
+	this_cpu_add(d_lookup_stats.chain_steps, steps);
+	if (unlikely(steps > D_LONG_CHAIN)) {
+		this_cpu_inc(d_lookup_stats.long_chains);
+		if (steps > this_cpu_read(d_lookup_stats.max_chain))
+			this_cpu_write(d_lookup_stats.max_chain, steps);
+	}
+}
+
+/* called by namei.c whenever an rcu-walk has to give up */
+void d_count_rcu_fallback(bool restart)
+{
+	if (restart)
+		this_cpu_inc(d_lookup_stats.rcu_restarts);
+	else
+		this_cpu_inc(d_lookup_stats.rcu_unlazy);
+}
+
 #if defined(CONFIG_SYSCTL) && defined(CONFIG_PROC_FS)
 
 /*
@@ -158,6 +193,27 @@ int proc_nr_dentry(struct ctl_table *table, int write, void __user *buffer,
 	dentry_stat.nr_unused = get_nr_dentry_unused();
 	return proc_doulongvec_minmax(table, write, buffer, lenp, ppos);
 }
+
+int proc_dentry_lookup_stat(struct ctl_table *table, int write,
+			    void __user *buffer, size_t *lenp, loff_t *ppos)
+{
+	struct dentry_lookup_stat_t *s = &dentry_lookup_stat;
+	int i;
+
+	memset(s, 0, sizeof(*s));
+	for_each_possible_cpu(i) {
+		struct d_lookup_pcpu_stat *p = &per_cpu(d_lookup_stats, i);
+
+		s->lookups += p->lookups;
+		s->chain_steps += p->chain_steps;
+		s->long_chains += p->long_chains;
+		s->max_chain = max_t(long, s->max_chain, p->max_chain);
+		s->rcu_unlazy += p->rcu_unlazy;
+		s->rcu_restarts += p->rcu_restarts;
+	}
+	s->hash_buckets = 1L << d_hash_shift;
+	return proc_doulongvec_minmax(table, write, buffer, lenp, ppos);
+}
 #endif
 
 /*
@@ -2167,6 +2223,7 @@ struct dentry *__d_lookup_rcu(const struct dentry *parent,
 	struct hlist_bl_head *b = d_hash(parent, hashlen_hash(hashlen));
 	struct hlist_bl_node *node;
 	struct dentry *dentry;
+	unsigned int steps = 0;
 
 	/*
 	 * Note: There is significant duplication with __d_lookup_rcu which is
@@ -2191,6 +2248,7 @@ struct dentry *__d_lookup_rcu(const struct dentry *parent,
 	hlist_bl_for_each_entry_rcu(dentry, node, b, d_hash) {
 		unsigned seq;
 
+		steps++;
 seqretry:
 		/*
 		 * The dentry sequence count protects us from concurrent
@@ -2218,6 +2276,7 @@ seqretry:
 			*seqp = seq;
 			switch (slow_dentry_cmp(parent, dentry, seq, name)) {
 			case D_COMP_OK:
+				d_count_lookup(steps);
 				return dentry;
 			case D_COMP_NOMATCH:
 				continue;
@@ -2229,9 +2288,12 @@ seqretry:
 		if (dentry->d_name.hash_len != hashlen)
 			continue;
 		*seqp = seq;
-		if (!dentry_cmp(dentry, str, hashlen_len(hashlen)))
+		if (!dentry_cmp(dentry, str, hashlen_len(hashlen))) {
+			d_count_lookup(steps);
 			return dentry;
+		}
 	}
+	d_count_lookup(steps);
 	return NULL;
 }
 
@@ -2285,6 +2347,7 @@ struct dentry *__d_lookup(const struct dentry *parent, const struct qstr *name)
 	struct hlist_bl_node *node;
 	struct dentry *found = NULL;
 	struct dentry *dentry;
+	unsigned int steps = 0;
 
 	/*
 	 * Note: There is significant duplication with __d_lookup_rcu which is
@@ -2310,6 +2373,7 @@ struct dentry *__d_lookup(const struct dentry *parent, const struct qstr *name)
 	
 	hlist_bl_for_each_entry_rcu(dentry, node, b, d_hash) {
 
+		steps++;
 		if (dentry->d_name.hash != hash)
 			continue;
 
@@ -2343,6 +2407,7 @@ next:
 		spin_unlock(&dentry->d_lock);
  	}
  	rcu_read_unlock();
+	d_count_lookup(steps);
 
  	return found;
 }
@@ -3421,6 +3486,21 @@ static int __init set_dhash_entries(char *str)
 }
 __setup("dhash_entries=", set_dhash_entries);
 
+/*
+ * One bucket per 2^dhash_scale bytes of RAM when dhash_entries is not
+ * given. Devices with many more dentries than their RAM suggests, such
+ * as ones with hundreds of apps on a stacked filesystem, want it lower.
+ */
+static __initdata int dhash_scale = 13;
+static int __init set_dhash_scale(char *str)
+{
+	if (!str)
+		return 0;
+	dhash_scale = clamp_t(int, simple_strtol(str, &str, 0), 8, 16);
+	return 1;
+}
+__setup("dhash_scale=", set_dhash_scale);
+
 static void __init dcache_init_early(void)
 {
 	unsigned int loop;
@@ -3435,7 +3515,7 @@ static void __init dcache_init_early(void)
 		alloc_large_system_hash("Dentry cache",
 					sizeof(struct hlist_bl_head),
 					dhash_entries,
-					13,
+					dhash_scale,
 					HASH_EARLY,
 					&d_hash_shift,
 					&d_hash_mask,
@@ -3466,7 +3546,7 @@ static void __init dcache_init(void)
 		alloc_large_system_hash("Dentry cache",
 					sizeof(struct hlist_bl_head),
 					dhash_entries,
-					13,
+					dhash_scale,
 					0,
 					&d_hash_shift,
 					&d_hash_mask,
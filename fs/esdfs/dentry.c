@@ -48,6 +48,17 @@ static int esdfs_d_revalidate(struct dentry *dentry, unsigned int flags)
 	if (lower_parent_path.dentry != lower_parent_dentry)
 		goto drop;
 
+	/*
+	 * A cached miss holds until the lower directory changes.  Like vfat,
+	 * never hand it out for a create, which would take its spelling.
+	 */
+	if (!dentry->d_inode &&
+	    ((flags & (LOOKUP_CREATE | LOOKUP_RENAME_TARGET)) ||
+	     lower_dentry->d_inode ||
+	     !esdfs_dir_stamp_valid(lower_parent_dentry->d_inode,
+				    &ESDFS_D(dentry)->neg_stamp)))
+		goto drop;
+
 	/* can't do strcmp if lower is hashed */
 	spin_lock(&lower_dentry->d_lock);
 	if (d_unhashed(lower_dentry)) {
@@ -69,7 +80,7 @@ static int esdfs_d_revalidate(struct dentry *dentry, unsigned int flags)
 	spin_unlock(&lower_dentry->d_lock);
 
 	esdfs_revalidate_perms(dentry);
-	if (ESDFS_DERIVE_PERMS(ESDFS_SB(dentry->d_sb)) &&
+	if (ESDFS_DERIVE_PERMS(ESDFS_SB(dentry->d_sb)) && dentry->d_inode &&
 	    esdfs_derived_revalidate(dentry, parent_dentry))
 		goto drop;
 
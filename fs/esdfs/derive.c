@@ -523,6 +523,49 @@ int esdfs_derived_revalidate(struct dentry *dentry, struct dentry *parent)
 	return 0;
 }
 
+/*
+ * Look up an app's package list access rights.  The result for the last
+ * app is kept in the inode, as the same app tends to write to the same
+ * directory over and over, until the package list is replaced.
+ */
+static unsigned package_access(struct inode *inode, uid_t appid)
+{
+	struct esdfs_inode_info *inode_i = ESDFS_I(inode);
+	struct esdfs_package_list *package;
+	unsigned access = 0, version;
+
+	spin_lock(&inode->i_lock);
+	if (inode_i->access_appid == appid &&
+	    inode_i->access_version == esdfs_package_list_version) {
+		access = inode_i->access;
+		spin_unlock(&inode->i_lock);
+		return access;
+	}
+	spin_unlock(&inode->i_lock);
+
+	mutex_lock(&package_list_lock);
+	hash_for_each_possible(access_list_hash, package,
+			       access_node, appid) {
+		if (package->appid == appid) {
+			pr_debug("esdfs: %s: found appid %u, access: %u\n",
+				__func__, package->appid,
+				package->access);
+			access = package->access;
+			break;
+		}
+	}
+	version = esdfs_package_list_version;
+	mutex_unlock(&package_list_lock);
+
+	spin_lock(&inode->i_lock);
+	inode_i->access_appid = appid;
+	inode_i->access_version = version;
+	inode_i->access = access;
+	spin_unlock(&inode->i_lock);
+
+	return access;
+}
+
 /*
  * Implement the extra checking that is done based on the caller's package
  * list-based access rights.
@@ -530,9 +573,8 @@ int esdfs_derived_revalidate(struct dentry *dentry, struct dentry *parent)
 int esdfs_check_derived_permission(struct inode *inode, int mask)
 {
 	const struct cred *cred;
-	struct esdfs_package_list *package;
 	uid_t uid, appid;
-	unsigned access = 0;
+	unsigned access;
 
 	/*
 	 * If we don't need to restrict access based on app GIDs and confine
@@ -556,18 +598,7 @@ int esdfs_check_derived_permission(struct inode *inode, int mask)
 	 * know how to use extended attributes, we have to double-check write
 	 * requests against the list of apps that have been granted sdcard_rw.
 	 */
-	mutex_lock(&package_list_lock);
-	hash_for_each_possible(access_list_hash, package,
-			       access_node, appid) {
-		if (package->appid == appid) {
-			pr_debug("esdfs: %s: found appid %u, access: %u\n",
-				__func__, package->appid,
-				package->access);
-			access = package->access;
-			break;
-		}
-	}
-	mutex_unlock(&package_list_lock);
+	access = package_access(inode, appid);
 
 	/*
 	 * If we aren't restricting based on GID, always grant what was formerly
@@ -149,6 +149,16 @@ struct esdfs_inode_info {
 	int tree;		/* storage tree location */
 	uid_t userid;		/* Android User ID (not Linux UID) */
 	uid_t appid;		/* Linux UID for this app/user combo */
+	/* package list access of the last app checked, under i_lock */
+	unsigned access_version;
+	uid_t access_appid;
+	unsigned access;
+};
+
+/* state of a lower directory, to tell whether it changed since */
+struct esdfs_dir_stamp {
+	struct timespec ctime;
+	u64 version;
 };
 
 /* esdfs dentry data in memory */
@@ -157,6 +167,7 @@ struct esdfs_dentry_info {
 	struct path lower_path;
 	struct path lower_stub_path;
 	struct dentry *real_parent;
+	struct esdfs_dir_stamp neg_stamp;	/* of a cached miss */
 };
 
 /* esdfs super-block data in memory */
@@ -174,6 +185,11 @@ struct esdfs_sb_info {
 extern struct esdfs_perms esdfs_perms_table[ESDFS_PERMS_TABLE_SIZE];
 extern unsigned esdfs_package_list_version;
 
+extern bool esdfs_get_dir_stamp(struct inode *lower_dir,
+				struct esdfs_dir_stamp *stamp);
+extern bool esdfs_dir_stamp_valid(struct inode *lower_dir,
+				  const struct esdfs_dir_stamp *stamp);
+
 void esdfs_drop_shared_icache(struct super_block *, struct inode *);
 void esdfs_drop_sb_icache(struct super_block *, unsigned long);
 void esdfs_add_super(struct esdfs_sb_info *, struct super_block *);
@@ -196,7 +196,11 @@ int esdfs_interpose(struct dentry *dentry, struct super_block *sb,
 		goto out;
 	}
 
-	d_add(dentry, inode);
+	/* a cached miss being created is hashed already */
+	if (d_unhashed(dentry))
+		d_add(dentry, inode);
+	else
+		d_instantiate(dentry, inode);
 
 	if (ESDFS_DERIVE_PERMS(ESDFS_SB(sb)))
 		esdfs_derive_perms(dentry);
@@ -205,6 +209,32 @@ out:
 	return err;
 }
 
+/*
+ * Lookup misses are kept as negative dentries for as long as the lower
+ * directory they were looked up in does not change.  Any entry added to
+ * it, by us or directly on the lower filesystem, moves its ctime on.
+ * The stamp is taken before the lookup, and refused if the directory
+ * already changed within the current timestamp tick, as a change later
+ * in that same tick would then go unnoticed.
+ */
+bool esdfs_get_dir_stamp(struct inode *lower_dir, struct esdfs_dir_stamp *stamp)
+{
+	struct timespec now = current_fs_time(lower_dir->i_sb);
+
+	stamp->version = lower_dir->i_version;
+	stamp->ctime = lower_dir->i_ctime;
+	smp_rmb();	/* read the stamp before looking up the entry */
+
+	return timespec_compare(&stamp->ctime, &now) < 0;
+}
+
+bool esdfs_dir_stamp_valid(struct inode *lower_dir,
+			   const struct esdfs_dir_stamp *stamp)
+{
+	return timespec_equal(&lower_dir->i_ctime, &stamp->ctime) &&
+	       lower_dir->i_version == stamp->version;
+}
+
 static int esdfs_ci_filldir(void *dirent, const char *name, int namelen,
 		loff_t offset, u64 ino, unsigned int d_type)
 {
@@ -258,10 +288,12 @@ static int esdfs_ci_lookup(struct path *parent, const char *name,
  *
  * Returns: NULL (ok), ERR_PTR if an error occurred.
  * Fills in lower_parent_path with <dentry,mnt> on success.
+ * Sets *stamped if a miss may be cached as a negative dentry.
  */
 static struct dentry *__esdfs_lookup(struct dentry *dentry,
 				     unsigned int flags,
-				     struct path *lower_parent_path)
+				     struct path *lower_parent_path,
+				     bool *stamped)
 {
 	int err = 0;
 	struct vfsmount *lower_dir_mnt;
@@ -283,6 +315,9 @@ static struct dentry *__esdfs_lookup(struct dentry *dentry,
 	lower_dir_dentry = lower_parent_path->dentry;
 	lower_dir_mnt = lower_parent_path->mnt;
 
+	*stamped = esdfs_get_dir_stamp(lower_dir_dentry->d_inode,
+				       &ESDFS_D(dentry)->neg_stamp);
+
 	/* Use vfs_path_lookup to check if the dentry exists or not */
 	err = vfs_path_lookup(lower_dir_dentry, lower_dir_mnt, name,
 			      LOOKUP_NOCASE, &lower_path);
@@ -350,6 +385,7 @@ struct dentry *esdfs_lookup(struct inode *dir, struct dentry *dentry,
 			    unsigned int flags)
 {
 	int err;
+	bool stamped = false;
 	struct dentry *ret, *real_parent, *parent;
 	struct path lower_parent_path, old_lower_parent_path;
 	const struct cred *creds =
@@ -376,7 +412,18 @@ struct dentry *esdfs_lookup(struct inode *dir, struct dentry *dentry,
 
 	esdfs_get_lower_path(parent, &lower_parent_path);
 
-	ret = __esdfs_lookup(dentry, flags, &lower_parent_path);
+	ret = __esdfs_lookup(dentry, flags, &lower_parent_path, &stamped);
+
+	/*
+	 * Keep the miss around, so that probes for optional files stay
+	 * within esdfs; see esdfs_d_revalidate().  Not for pseudo hard
+	 * links, whose lower parent is not the one the stamp was taken on.
+	 */
+	if (ret == ERR_PTR(-ENOENT) && stamped && parent == real_parent &&
+	    ESDFS_D(dentry)->lower_path.dentry) {
+		d_add(dentry, NULL);
+		ret = NULL;
+	}
 	if (IS_ERR(ret))
 		goto out_put;
 	if (ret)
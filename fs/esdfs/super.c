@@ -191,6 +191,7 @@ static struct inode *esdfs_alloc_inode(struct super_block *sb)
 
 	/* memset everything up to the inode to 0 */
 	memset(i, 0, offsetof(struct esdfs_inode_info, vfs_inode));
+	i->access_appid = (uid_t)-1;
 
 	i->vfs_inode.i_version = 1;
 	return &i->vfs_inode;
@@ -35,6 +35,7 @@
 #include <linux/anon_inodes.h>
 #include <linux/device.h>
 #include <linux/freezer.h>
+#include <linux/hrtimer.h>
 #include <asm/uaccess.h>
 #include <asm/io.h>
 #include <asm/mman.h>
@@ -104,6 +105,12 @@
 
 #define EP_ITEM_COST (sizeof(struct epitem) + sizeof(struct eppoll_entry))
 
+/* epitem->revents: a callback had no key, so the item has to be polled */
+#define EP_REVENTS_POLL (1U << 31)
+
+/* Longest wakeup coalescing window accepted by EPIOCSCOALESCE */
+#define EP_MAX_COALESCE_US USEC_PER_SEC
+
 struct epoll_filefd {
 	struct file *file;
 	int fd;
@@ -157,6 +164,12 @@ struct epitem {
 	/* Number of active wait queue attached to poll operations */
 	int nwait;
 
+	/*
+	 * Events reported by the keys of the callbacks since the item was
+	 * last delivered, or EP_REVENTS_POLL if one came without a key.
+	 */
+	unsigned int revents;
+
 	/* List containing poll wait queues */
 	struct list_head pwqlist;
 
@@ -220,6 +233,16 @@ struct eventpoll {
 	/* used to optimize loop detection check */
 	int visited;
 	struct list_head visited_list_link;
+
+	/* Wakeup coalescing, see EPIOCSCOALESCE; protected by ->lock */
+	u64 coalesce_ns;
+	unsigned int coalesce_batch;
+	/* Items made ready since the ready list was last fetched */
+	unsigned int nr_batched;
+	int wait_maxevents;
+	struct hrtimer coalesce_timer;
+
+	struct epoll_stats stats;
 };
 
 /* Wait structure used by the poll hooks */
@@ -624,6 +647,7 @@ static int ep_scan_ready_list(struct eventpoll *ep,
 	spin_lock_irqsave(&ep->lock, flags);
 	list_splice_init(&ep->rdllist, &txlist);
 	ep->ovflist = NULL;
+	ep->nr_batched = 0;
 	spin_unlock_irqrestore(&ep->lock, flags);
 
 	/*
@@ -766,6 +790,9 @@ static void ep_free(struct eventpoll *ep)
 		cond_resched();
 	}
 
+	/* No callback is left to arm it again */
+	hrtimer_cancel(&ep->coalesce_timer);
+
 	/*
 	 * Walks through the whole tree by freeing each "struct epitem". At this
 	 * point we are sure no poll callbacks will be lingering around, and also by
@@ -898,6 +925,75 @@ static int ep_show_fdinfo(struct seq_file *m, struct file *f)
 }
 #endif
 
+static enum hrtimer_restart ep_coalesce_timer_fn(struct hrtimer *timer)
+{
+	struct eventpoll *ep = container_of(timer, struct eventpoll,
+					    coalesce_timer);
+	unsigned long flags;
+
+	spin_lock_irqsave(&ep->lock, flags);
+	if (waitqueue_active(&ep->wq) && ep_events_available(ep)) {
+		wake_up_locked(&ep->wq);
+		ep->stats.wakeups++;
+	}
+	spin_unlock_irqrestore(&ep->lock, flags);
+
+	return HRTIMER_NORESTART;
+}
+
+static int ep_set_coalesce(struct eventpoll *ep, struct epoll_coalesce *ec)
+{
+	if (ec->window_us > EP_MAX_COALESCE_US)
+		return -EINVAL;
+
+	spin_lock_irq(&ep->lock);
+	ep->coalesce_ns = (u64)ec->window_us * NSEC_PER_USEC;
+	ep->coalesce_batch = ec->max_batch;
+	spin_unlock_irq(&ep->lock);
+
+	/* a window being shortened or dropped must not hold back waiters */
+	if (hrtimer_try_to_cancel(&ep->coalesce_timer) > 0)
+		ep_coalesce_timer_fn(&ep->coalesce_timer);
+
+	return 0;
+}
+
+static long ep_eventpoll_ioctl(struct file *file, unsigned int cmd,
+			       unsigned long arg)
+{
+	struct eventpoll *ep = file->private_data;
+	void __user *argp = (void __user *)arg;
+	struct epoll_coalesce ec;
+	struct epoll_stats stats;
+
+	switch (cmd) {
+	case EPIOCSCOALESCE:
+		if (copy_from_user(&ec, argp, sizeof(ec)))
+			return -EFAULT;
+		return ep_set_coalesce(ep, &ec);
+	case EPIOCGCOALESCE:
+		spin_lock_irq(&ep->lock);
+		ec.window_us = div_u64(ep->coalesce_ns, NSEC_PER_USEC);
+		ec.max_batch = ep->coalesce_batch;
+		spin_unlock_irq(&ep->lock);
+		return copy_to_user(argp, &ec, sizeof(ec)) ? -EFAULT : 0;
+	case EPIOCGSTATS:
+		/* a consistent enough snapshot, the counters only grow */
+		stats = ep->stats;
+		return copy_to_user(argp, &stats, sizeof(stats)) ? -EFAULT : 0;
+	default:
+		return -ENOTTY;
+	}
+}
+
+#ifdef CONFIG_COMPAT
+static long ep_eventpoll_compat_ioctl(struct file *file, unsigned int cmd,
+				      unsigned long arg)
+{
+	return ep_eventpoll_ioctl(file, cmd, (unsigned long)compat_ptr(arg));
+}
+#endif
+
 /* File callbacks that implement the eventpoll file behaviour */
 static const struct file_operations eventpoll_fops = {
 #ifdef CONFIG_PROC_FS
@@ -905,6 +1001,10 @@ static const struct file_operations eventpoll_fops = {
 #endif
 	.release	= ep_eventpoll_release,
 	.poll		= ep_eventpoll_poll,
+	.unlocked_ioctl	= ep_eventpoll_ioctl,
+#ifdef CONFIG_COMPAT
+	.compat_ioctl	= ep_eventpoll_compat_ioctl,
+#endif
 	.llseek		= noop_llseek,
 };
 
@@ -961,6 +1061,8 @@ static int ep_alloc(struct eventpoll **pep)
 	ep->rbr = RB_ROOT;
 	ep->ovflist = EP_UNACTIVE_PTR;
 	ep->user = user;
+	hrtimer_init(&ep->coalesce_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	ep->coalesce_timer.function = ep_coalesce_timer_fn;
 
 	*pep = ep;
 
@@ -1000,6 +1102,32 @@ static struct epitem *ep_find(struct eventpoll *ep, struct file *file, int fd)
 	return epir;
 }
 
+/*
+ * Decides, with ep->lock held, whether waking up the epoll_wait() waiters
+ * for an event can wait for the coalescing window to end. The first event
+ * of a batch arms the window; a full batch ends it early.
+ */
+static bool ep_defer_wakeup(struct eventpoll *ep)
+{
+	unsigned int batch;
+
+	if (!ep->coalesce_ns)
+		return false;
+
+	batch = ep->coalesce_batch ? : ep->wait_maxevents;
+	if (ep->nr_batched >= batch) {
+		/* if it is already running, it waits for us and wakes nobody */
+		hrtimer_try_to_cancel(&ep->coalesce_timer);
+		return false;
+	}
+
+	if (!hrtimer_active(&ep->coalesce_timer))
+		hrtimer_start(&ep->coalesce_timer,
+			      ns_to_ktime(ep->coalesce_ns), HRTIMER_MODE_REL);
+	ep->stats.coalesced++;
+	return true;
+}
+
 /*
  * This is the callback that is passed to the wait queue wakeup
  * mechanism. It is called by the stored file descriptors when they
@@ -1032,6 +1160,15 @@ static int ep_poll_callback(wait_queue_t *wait, unsigned mode, int sync, void *k
 	if (key && !((unsigned long) key & epi->event.events))
 		goto out_unlock;
 
+	/*
+	 * Remember what the key says, so that delivering an edge triggered
+	 * item can do without polling its file again.
+	 */
+	if (key)
+		epi->revents |= (unsigned long) key & epi->event.events;
+	else
+		epi->revents |= EP_REVENTS_POLL;
+
 	/*
 	 * If we are transferring events to userspace, we can hold no locks
 	 * (because we're accessing user memory, and because of linux f_op->poll()
@@ -1058,14 +1195,18 @@ static int ep_poll_callback(wait_queue_t *wait, unsigned mode, int sync, void *k
 	if (!ep_is_linked(&epi->rdllink)) {
 		list_add_tail(&epi->rdllink, &ep->rdllist);
 		ep_pm_stay_awake_rcu(epi);
+		ep->nr_batched++;
 	}
 
 	/*
 	 * Wake up ( if active ) both the eventpoll wait list and the ->poll()
-	 * wait list.
+	 * wait list. Only the former is subject to coalescing; a nested
+	 * epoll set coalesces on its own.
 	 */
-	if (waitqueue_active(&ep->wq))
+	if (waitqueue_active(&ep->wq) && !ep_defer_wakeup(ep)) {
 		wake_up_locked(&ep->wq);
+		ep->stats.wakeups++;
+	}
 	if (waitqueue_active(&ep->poll_wait))
 		pwake++;
 
@@ -1299,6 +1440,7 @@ static int ep_insert(struct eventpoll *ep, struct epoll_event *event,
 	ep_set_ffd(&epi->ffd, tfile, fd);
 	epi->event = *event;
 	epi->nwait = 0;
+	epi->revents = 0;
 	epi->next = EP_UNACTIVE_PTR;
 	if (epi->event.events & EPOLLWAKEUP) {
 		error = ep_create_wakeup_source(epi);
@@ -1419,6 +1561,7 @@ static int ep_modify(struct eventpoll *ep, struct epitem *epi, struct epoll_even
 	 */
 	epi->event.events = event->events; /* need barrier below */
 	epi->event.data = event->data; /* protected by mtx */
+	epi->revents = EP_REVENTS_POLL;
 	if (epi->event.events & EPOLLWAKEUP) {
 		if (!ep_has_wakeup_source(epi))
 			ep_create_wakeup_source(epi);
@@ -1518,7 +1661,19 @@ static int ep_send_events_proc(struct eventpoll *ep, struct list_head *head,
 
 		list_del_init(&epi->rdllink);
 
-		revents = ep_item_poll(epi, &pt);
+		/*
+		 * An edge triggered item only has to report what happened
+		 * since its last delivery, which the callback keys tell.
+		 * Anything queued meanwhile brings it back through ovflist.
+		 */
+		revents = xchg(&epi->revents, 0);
+		if ((epi->event.events & EPOLLET) && revents &&
+		    !(revents & EP_REVENTS_POLL)) {
+			revents &= epi->event.events;
+			ep->stats.polls_skipped++;
+		} else {
+			revents = ep_item_poll(epi, &pt);
+		}
 
 		/*
 		 * If the event mask intersect the caller-requested one,
@@ -1555,6 +1710,11 @@ static int ep_send_events_proc(struct eventpoll *ep, struct list_head *head,
 		}
 	}
 
+	if (eventcnt) {
+		ep->stats.sends++;
+		ep->stats.events += eventcnt;
+	}
+
 	return eventcnt;
 }
 
@@ -1633,6 +1793,7 @@ fetch_events:
 		 */
 		init_waitqueue_entry(&wait, current);
 		__add_wait_queue_exclusive(&ep->wq, &wait);
+		ep->wait_maxevents = maxevents;
 
 		for (;;) {
 			/*
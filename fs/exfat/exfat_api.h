@@ -136,6 +136,15 @@ typedef struct {
 	u8       flags;
 } CHAIN_T;
 
+/* run of contiguous clusters, the fclu-th cluster of a file being dclu */
+#define MAX_CLU_EXTENTS		8
+
+typedef struct {
+	u32      fclu;
+	u32      dclu;
+	u32      len;
+} CLU_EXTENT_T;
+
 /* file id structure */
 typedef struct {
 	CHAIN_T     dir;
@@ -148,6 +157,10 @@ typedef struct {
 	s64       rwoffset;
 	s32       hint_last_off;
 	u32      hint_last_clu;
+	u32      extent_clu;     /* start_clu the extents belong to */
+	u8       nr_extents;
+	u8       next_extent;
+	CLU_EXTENT_T extents[MAX_CLU_EXTENTS];
 } FILE_ID_T;
 
 typedef struct {
@@ -126,6 +126,22 @@ s32 bdev_read(struct super_block *sb, u32 secno, struct buffer_head **bh, u32 nu
 	return FFS_MEDIAERR;
 }
 
+/* starts reading num_secs sectors into the buffer cache, without waiting */
+void bdev_readahead(struct super_block *sb, u32 secno, u32 num_secs)
+{
+	BD_INFO_T *p_bd = &(EXFAT_SB(sb)->bd_info);
+	struct blk_plug plug;
+	u32 i;
+
+	if (!p_bd->opened)
+		return;
+
+	blk_start_plug(&plug);
+	for (i = 0; i < num_secs; i++)
+		__breadahead(sb->s_bdev, secno + i, p_bd->sector_size);
+	blk_finish_plug(&plug);
+}
+
 s32 bdev_sync_dirty_buffer(struct buffer_head *bh,
 					struct super_block *sb, int sync)
 {
@@ -33,6 +33,8 @@
 /*                                                                      */
 /************************************************************************/
 
+#include <linux/log2.h>
+#include <linux/vmalloc.h>
 #include "exfat_config.h"
 #include "exfat_data.h"
 
@@ -49,6 +51,7 @@
 
 static s32 __FAT_read(struct super_block *sb, u32 loc, u32 *content);
 static s32 __FAT_write(struct super_block *sb, u32 loc, u32 content);
+static void FAT_readahead(struct super_block *sb, u32 sec);
 
 static BUF_CACHE_T *FAT_cache_find(struct super_block *sb, u32 sec);
 static BUF_CACHE_T *FAT_cache_get(struct super_block *sb, u32 sec);
@@ -74,13 +77,27 @@ static void move_to_lru(BUF_CACHE_T *bp, BUF_CACHE_T *list);
 s32 buf_init(struct super_block *sb)
 {
 	FS_INFO_T *p_fs = &(EXFAT_SB(sb)->fs_info);
+	u64 nr_entries;
 
 	int i;
 
+	/* larger cards have larger FATs, keep the cache share of them */
+	nr_entries = i_size_read(sb->s_bdev->bd_inode) >> FAT_CACHE_SIZE_SHIFT;
+	nr_entries = clamp_t(u64, nr_entries, FAT_CACHE_SIZE, FAT_CACHE_MAX_SIZE);
+
+	p_fs->FAT_cache_size = rounddown_pow_of_two((u32) nr_entries);
+	p_fs->FAT_cache_hash_size = p_fs->FAT_cache_size / 2;
+	p_fs->FAT_ra_end = 0;
+
+	p_fs->FAT_cache_array = vmalloc(p_fs->FAT_cache_size * sizeof(BUF_CACHE_T));
+	p_fs->FAT_cache_hash_list = vmalloc(p_fs->FAT_cache_hash_size * sizeof(BUF_CACHE_T));
+	if (!p_fs->FAT_cache_array || !p_fs->FAT_cache_hash_list)
+		return FFS_MEMORYERR;
+
 	/* LRU list */
 	p_fs->FAT_cache_lru_list.next = p_fs->FAT_cache_lru_list.prev = &p_fs->FAT_cache_lru_list;
 
-	for (i = 0; i < FAT_CACHE_SIZE; i++) {
+	for (i = 0; i < p_fs->FAT_cache_size; i++) {
 		p_fs->FAT_cache_array[i].drv = -1;
 		p_fs->FAT_cache_array[i].sec = ~0;
 		p_fs->FAT_cache_array[i].flag = 0;
@@ -101,13 +118,13 @@ s32 buf_init(struct super_block *sb)
 	}
 
 	/* HASH list */
-	for (i = 0; i < FAT_CACHE_HASH_SIZE; i++) {
+	for (i = 0; i < p_fs->FAT_cache_hash_size; i++) {
 		p_fs->FAT_cache_hash_list[i].drv = -1;
 		p_fs->FAT_cache_hash_list[i].sec = ~0;
 		p_fs->FAT_cache_hash_list[i].hash_next = p_fs->FAT_cache_hash_list[i].hash_prev = &(p_fs->FAT_cache_hash_list[i]);
 	}
 
-	for (i = 0; i < FAT_CACHE_SIZE; i++)
+	for (i = 0; i < p_fs->FAT_cache_size; i++)
 		FAT_cache_insert_hash(sb, &(p_fs->FAT_cache_array[i]));
 
 	for (i = 0; i < BUF_CACHE_HASH_SIZE; i++) {
@@ -124,6 +141,13 @@ s32 buf_init(struct super_block *sb)
 
 s32 buf_shutdown(struct super_block *sb)
 {
+	FS_INFO_T *p_fs = &(EXFAT_SB(sb)->fs_info);
+
+	vfree(p_fs->FAT_cache_array);
+	vfree(p_fs->FAT_cache_hash_list);
+	p_fs->FAT_cache_array = NULL;
+	p_fs->FAT_cache_hash_list = NULL;
+
 	return FFS_SUCCESS;
 } /* end of buf_shutdown */
 
@@ -413,9 +437,37 @@ u8 *FAT_getblk(struct super_block *sb, u32 sec)
 		return NULL;
 	}
 
+	FAT_readahead(sb, sec);
+
 	return bp->buf_bh->b_data;
 } /* end of FAT_getblk */
 
+/* chains mostly run forward through the FAT, so keep reading ahead of them */
+static void FAT_readahead(struct super_block *sb, u32 sec)
+{
+	u32 start, end;
+	FS_INFO_T *p_fs = &(EXFAT_SB(sb)->fs_info);
+
+	end = p_fs->FAT1_start_sector + p_fs->num_FAT_sectors;
+	if ((sec < p_fs->FAT1_start_sector) || (sec + 1 >= end))
+		return;
+
+	if ((sec < p_fs->FAT_ra_end) && (sec + FAT_RA_SECTORS >= p_fs->FAT_ra_end)) {
+		/* within the last window: only move on once half of it is used */
+		if (sec + FAT_RA_SECTORS/2 < p_fs->FAT_ra_end)
+			return;
+		start = p_fs->FAT_ra_end;
+	} else {
+		start = sec + 1;
+	}
+
+	if (start >= end)
+		return;
+
+	p_fs->FAT_ra_end = min(start + FAT_RA_SECTORS, end);
+	bdev_readahead(sb, start, p_fs->FAT_ra_end - start);
+} /* end of FAT_readahead */
+
 void FAT_modify(struct super_block *sb, u32 sec)
 {
 	BUF_CACHE_T *bp;
@@ -475,7 +527,7 @@ static BUF_CACHE_T *FAT_cache_find(struct super_block *sb, u32 sec)
 	BUF_CACHE_T *bp, *hp;
 	FS_INFO_T *p_fs = &(EXFAT_SB(sb)->fs_info);
 
-	off = (sec + (sec >> p_fs->sectors_per_clu_bits)) & (FAT_CACHE_HASH_SIZE - 1);
+	off = (sec + (sec >> p_fs->sectors_per_clu_bits)) & (p_fs->FAT_cache_hash_size - 1);
 
 	hp = &(p_fs->FAT_cache_hash_list[off]);
 	for (bp = hp->hash_next; bp != hp; bp = bp->hash_next) {
@@ -510,7 +562,7 @@ static void FAT_cache_insert_hash(struct super_block *sb, BUF_CACHE_T *bp)
 	FS_INFO_T *p_fs;
 
 	p_fs = &(EXFAT_SB(sb)->fs_info);
-	off = (bp->sec + (bp->sec >> p_fs->sectors_per_clu_bits)) & (FAT_CACHE_HASH_SIZE-1);
+	off = (bp->sec + (bp->sec >> p_fs->sectors_per_clu_bits)) & (p_fs->FAT_cache_hash_size - 1);
 
 	hp = &(p_fs->FAT_cache_hash_list[off]);
 	bp->hash_next = hp->hash_next;
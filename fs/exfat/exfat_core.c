@@ -351,6 +351,7 @@ s32 ffsLookupFile(struct inode *inode, char *path, FILE_ID_T *fid)
 		fid->type = TYPE_DIR;
 		fid->rwoffset = 0;
 		fid->hint_last_off = -1;
+		fid->nr_extents = 0;
 
 		fid->attr = ATTR_SUBDIR;
 		fid->flags = 0x01;
@@ -372,6 +373,7 @@ s32 ffsLookupFile(struct inode *inode, char *path, FILE_ID_T *fid)
 		fid->type = p_fs->fs_func->get_entry_type(ep);
 		fid->rwoffset = 0;
 		fid->hint_last_off = -1;
+		fid->nr_extents = 0;
 		fid->attr = p_fs->fs_func->get_entry_attr(ep);
 
 		fid->size = p_fs->fs_func->get_entry_size(ep2);
@@ -429,7 +431,7 @@ s32 ffsCreateFile(struct inode *inode, char *path, u8 mode, FILE_ID_T *fid)
 s32 ffsReadFile(struct inode *inode, FILE_ID_T *fid, void *buffer, u64 count, u64 *rcount)
 {
 	s32 offset, sec_offset, clu_offset;
-	u32 clu, LogSector;
+	u32 clu, last_clu, LogSector;
 	u64 oneblkread, read_bytes;
 	struct buffer_head *tmp_bh = NULL;
 	struct super_block *sb = inode->i_sb;
@@ -461,20 +463,8 @@ s32 ffsReadFile(struct inode *inode, FILE_ID_T *fid, void *buffer, u64 count, u6
 		if (fid->flags == 0x03) {
 			clu += clu_offset;
 		} else {
-			/* hint information */
-			if ((clu_offset > 0) && (fid->hint_last_off > 0) &&
-				(clu_offset >= fid->hint_last_off)) {
-				clu_offset -= fid->hint_last_off;
-				clu = fid->hint_last_clu;
-			}
-
-			while (clu_offset > 0) {
-				/* clu = FAT_read(sb, clu); */
-				if (FAT_read(sb, clu, &clu) == -1)
-					return FFS_MEDIAERR;
-
-				clu_offset--;
-			}
+			if (walk_fat_chain(sb, fid, clu_offset, &clu, &last_clu) != FFS_SUCCESS)
+				return FFS_MEDIAERR;
 		}
 
 		/* hint information */
@@ -569,21 +559,8 @@ s32 ffsWriteFile(struct inode *inode, FILE_ID_T *fid, void *buffer, u64 count, u
 					clu += clu_offset;
 			}
 		} else {
-			/* hint information */
-			if ((clu_offset > 0) && (fid->hint_last_off > 0) &&
-				(clu_offset >= fid->hint_last_off)) {
-				clu_offset -= fid->hint_last_off;
-				clu = fid->hint_last_clu;
-			}
-
-			while ((clu_offset > 0) && (clu != CLUSTER_32(~0))) {
-				last_clu = clu;
-				/* clu = FAT_read(sb, clu); */
-				if (FAT_read(sb, clu, &clu) == -1)
-					return FFS_MEDIAERR;
-
-				clu_offset--;
-			}
+			if (walk_fat_chain(sb, fid, clu_offset, &clu, &last_clu) != FFS_SUCCESS)
+				return FFS_MEDIAERR;
 		}
 
 		if (clu == CLUSTER_32(~0)) {
@@ -824,6 +801,7 @@ s32 ffsTruncateFile(struct inode *inode, u64 old_size, u64 new_size)
 
 	/* hint information */
 	fid->hint_last_off = -1;
+	fid->nr_extents = 0;
 	if (fid->rwoffset > fid->size)
 		fid->rwoffset = fid->size;
 
@@ -1312,19 +1290,8 @@ s32 ffsMapCluster(struct inode *inode, s32 clu_offset, u32 *clu)
 				*clu += clu_offset;
 		}
 	} else {
-		/* hint information */
-		if ((clu_offset > 0) && (fid->hint_last_off > 0) &&
-			(clu_offset >= fid->hint_last_off)) {
-			clu_offset -= fid->hint_last_off;
-			*clu = fid->hint_last_clu;
-		}
-
-		while ((clu_offset > 0) && (*clu != CLUSTER_32(~0))) {
-			last_clu = *clu;
-			if (FAT_read(sb, *clu, clu) == -1)
-				return FFS_MEDIAERR;
-			clu_offset--;
-		}
+		if (walk_fat_chain(sb, fid, clu_offset, clu, &last_clu) != FFS_SUCCESS)
+			return FFS_MEDIAERR;
 	}
 
 	if (*clu == CLUSTER_32(~0)) {
@@ -2120,6 +2087,122 @@ void exfat_chain_cont_cluster(struct super_block *sb, u32 chain, s32 len)
 	FAT_write(sb, chain, CLUSTER_32(~0));
 } /* end of exfat_chain_cont_cluster */
 
+static CLU_EXTENT_T *find_extent(FILE_ID_T *fid, u32 fclu)
+{
+	s32 i;
+	CLU_EXTENT_T *ext, *best = NULL;
+
+	for (i = 0; i < fid->nr_extents; i++) {
+		ext = &fid->extents[i];
+		if ((ext->fclu <= fclu) && (!best || (ext->fclu > best->fclu)))
+			best = ext;
+	}
+
+	return best;
+} /* end of find_extent */
+
+static void add_extent(FILE_ID_T *fid, u32 fclu, u32 dclu, u32 len)
+{
+	s32 i;
+	u32 end;
+	CLU_EXTENT_T *ext;
+
+	/* merge with an extent of the same run it overlaps or touches */
+	for (i = 0; i < fid->nr_extents; i++) {
+		ext = &fid->extents[i];
+		if ((ext->dclu - ext->fclu) != (dclu - fclu))
+			continue;
+		if ((fclu > ext->fclu + ext->len) || (ext->fclu > fclu + len))
+			continue;
+
+		end = max(ext->fclu + ext->len, fclu + len);
+		if (fclu < ext->fclu) {
+			ext->fclu = fclu;
+			ext->dclu = dclu;
+		}
+		ext->len = end - ext->fclu;
+		return;
+	}
+
+	if (fid->nr_extents < MAX_CLU_EXTENTS)
+		ext = &fid->extents[fid->nr_extents++];
+	else
+		ext = &fid->extents[fid->next_extent++ % MAX_CLU_EXTENTS];
+
+	ext->fclu = fclu;
+	ext->dclu = dclu;
+	ext->len = len;
+} /* end of add_extent */
+
+/* in : sb, fid (FAT chained), clu_offset
+  * out: clu, the clu_offset-th cluster of the file or CLUSTER_32(~0) past
+  *      the end of the chain, and last_clu, the last cluster walked through
+  *
+  * The walk starts from the closest of the hint and the extents cached
+  * in fid, and remembers the contiguous runs it goes through, so that
+  * seeking around a large file does not walk its chain from the start.
+  */
+s32 walk_fat_chain(struct super_block *sb, FILE_ID_T *fid, s32 clu_offset, u32 *clu, u32 *last_clu)
+{
+	u32 fclu = 0, dclu, next, run_fclu, run_dclu;
+	CLU_EXTENT_T *ext;
+
+	dclu = *last_clu = fid->start_clu;
+
+	if ((clu_offset <= 0) || (dclu == CLUSTER_32(~0))) {
+		*clu = dclu;
+		return FFS_SUCCESS;
+	}
+
+	if (fid->extent_clu != fid->start_clu) {
+		fid->extent_clu = fid->start_clu;
+		fid->nr_extents = 0;
+	}
+
+	/* hint information */
+	if ((fid->hint_last_off > 0) && (clu_offset >= fid->hint_last_off) &&
+		(fid->hint_last_clu != CLUSTER_32(~0))) {
+		fclu = fid->hint_last_off;
+		dclu = fid->hint_last_clu;
+	}
+
+	ext = find_extent(fid, clu_offset);
+	if (ext != NULL) {
+		if (clu_offset < ext->fclu + ext->len) {
+			*clu = ext->dclu + (clu_offset - ext->fclu);
+			return FFS_SUCCESS;
+		}
+		if (ext->fclu + ext->len - 1 > fclu) {
+			fclu = ext->fclu + ext->len - 1;
+			dclu = ext->dclu + ext->len - 1;
+		}
+	}
+
+	run_fclu = fclu;
+	run_dclu = dclu;
+
+	while ((fclu < clu_offset) && (dclu != CLUSTER_32(~0))) {
+		*last_clu = dclu;
+		if (FAT_read(sb, dclu, &next) == -1)
+			return FFS_MEDIAERR;
+		fclu++;
+
+		if (next != dclu + 1) {
+			if (fclu - run_fclu > 1)
+				add_extent(fid, run_fclu, run_dclu, fclu - run_fclu);
+			run_fclu = fclu;
+			run_dclu = next;
+		}
+		dclu = next;
+	}
+
+	if (dclu != CLUSTER_32(~0))
+		add_extent(fid, run_fclu, run_dclu, fclu - run_fclu + 1);
+
+	*clu = dclu;
+	return FFS_SUCCESS;
+} /* end of walk_fat_chain */
+
 /*
  *  Allocation Bitmap Management Functions
  */
@@ -4768,6 +4851,7 @@ s32 create_dir(struct inode *inode, CHAIN_T *p_dir, UNI_NAME_T *p_uniname, FILE_
 	fid->type = TYPE_DIR;
 	fid->rwoffset = 0;
 	fid->hint_last_off = -1;
+	fid->nr_extents = 0;
 
 	return FFS_SUCCESS;
 } /* end of create_dir */
@@ -4812,6 +4896,7 @@ s32 create_file(struct inode *inode, CHAIN_T *p_dir, UNI_NAME_T *p_uniname, u8 m
 	fid->type = TYPE_FILE;
 	fid->rwoffset = 0;
 	fid->hint_last_off = -1;
+	fid->nr_extents = 0;
 
 	return FFS_SUCCESS;
 } /* end of create_file */
@@ -485,10 +485,13 @@ typedef struct __FS_INFO_T {
 	FS_FUNC_T	*fs_func;
 	struct semaphore v_sem;
 
-	/* FAT cache */
-	BUF_CACHE_T FAT_cache_array[FAT_CACHE_SIZE];
+	/* FAT cache, sized by buf_init() */
+	BUF_CACHE_T *FAT_cache_array;
 	BUF_CACHE_T FAT_cache_lru_list;
-	BUF_CACHE_T FAT_cache_hash_list[FAT_CACHE_HASH_SIZE];
+	BUF_CACHE_T *FAT_cache_hash_list;
+	u32      FAT_cache_size;         /* num of FAT cache entries */
+	u32      FAT_cache_hash_size;    /* num of FAT cache hash lists */
+	u32      FAT_ra_end;             /* end of the last FAT readahead */
 
 	/* buf cache */
 	BUF_CACHE_T buf_cache_array[BUF_CACHE_SIZE];
@@ -561,6 +564,7 @@ s32  exfat_alloc_cluster(struct super_block *sb, s32 num_alloc, CHAIN_T *p_chain
 void   fat_free_cluster(struct super_block *sb, CHAIN_T *p_chain, s32 do_relse);
 void   exfat_free_cluster(struct super_block *sb, CHAIN_T *p_chain, s32 do_relse);
 u32 find_last_cluster(struct super_block *sb, CHAIN_T *p_chain);
+s32  walk_fat_chain(struct super_block *sb, FILE_ID_T *fid, s32 clu_offset, u32 *clu, u32 *last_clu);
 s32  count_num_clusters(struct super_block *sb, CHAIN_T *dir);
 s32  fat_count_used_clusters(struct super_block *sb);
 s32  exfat_count_used_clusters(struct super_block *sb);
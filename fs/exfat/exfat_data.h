@@ -55,4 +55,12 @@
 #define BUF_CACHE_SIZE          256
 #define BUF_CACHE_HASH_SIZE     64
 
+/* the FAT cache grows by a sector per 128MB of volume */
+/* from FAT_CACHE_SIZE, up to FAT_CACHE_MAX_SIZE       */
+#define FAT_CACHE_MAX_SIZE      1024
+#define FAT_CACHE_SIZE_SHIFT    27
+
+/* FAT sectors read ahead past a FAT cache miss        */
+#define FAT_RA_SECTORS          16
+
 #endif /* _EXFAT_DATA_H */
@@ -2269,6 +2269,7 @@ static int exfat_read_root(struct inode *inode)
 	EXFAT_I(inode)->fid.type = TYPE_DIR;
 	EXFAT_I(inode)->fid.rwoffset = 0;
 	EXFAT_I(inode)->fid.hint_last_off = -1;
+	EXFAT_I(inode)->fid.nr_extents = 0;
 
 	EXFAT_I(inode)->target = NULL;
 
@@ -36,6 +36,7 @@
 #include <linux/mempool.h>
 #include <linux/module.h>
 #include <linux/mutex.h>
+#include <linux/percpu.h>
 #include <linux/random.h>
 #include <linux/scatterlist.h>
 #include <linux/spinlock_types.h>
@@ -63,12 +64,47 @@ static mempool_t *f2fs_bounce_page_pool;
 static LIST_HEAD(f2fs_free_crypto_ctxs);
 static DEFINE_SPINLOCK(f2fs_crypto_ctx_lock);
 
+struct f2fs_ctx_cache {
+	unsigned int nr;
+	struct f2fs_crypto_ctx *ctxs[F2FS_CTX_CACHE_SIZE];
+	unsigned long stats[NR_F2FS_CTX_STATS];
+};
+static DEFINE_PER_CPU(struct f2fs_ctx_cache, f2fs_ctx_cache);
+
 static struct workqueue_struct *f2fs_read_workqueue;
 static DEFINE_MUTEX(crypto_init);
 
 static struct kmem_cache *f2fs_crypto_ctx_cachep;
 struct kmem_cache *f2fs_crypt_info_cachep;
 
+static void f2fs_free_crypto_ctx(struct f2fs_crypto_ctx *ctx)
+{
+	kzfree(ctx->req);
+	kmem_cache_free(f2fs_crypto_ctx_cachep, ctx);
+}
+
+static void f2fs_ctx_stat_inc(int item)
+{
+	this_cpu_inc(f2fs_ctx_cache.stats[item]);
+}
+
+/**
+ * f2fs_crypto_ctx_stats() - Sums up the crypto context pool counters
+ * @stats: Array of NR_F2FS_CTX_STATS entries to fill in
+ */
+void f2fs_crypto_ctx_stats(unsigned long *stats)
+{
+	int cpu, i;
+
+	memset(stats, 0, NR_F2FS_CTX_STATS * sizeof(*stats));
+	for_each_possible_cpu(cpu) {
+		struct f2fs_ctx_cache *cache = per_cpu_ptr(&f2fs_ctx_cache, cpu);
+
+		for (i = 0; i < NR_F2FS_CTX_STATS; i++)
+			stats[i] += cache->stats[i];
+	}
+}
+
 /**
  * f2fs_release_crypto_ctx() - Releases an encryption context
  * @ctx: The encryption context to release.
@@ -80,6 +116,7 @@ struct kmem_cache *f2fs_crypt_info_cachep;
  */
 void f2fs_release_crypto_ctx(struct f2fs_crypto_ctx *ctx)
 {
+	struct f2fs_ctx_cache *cache;
 	unsigned long flags;
 
 	if (ctx->flags & F2FS_WRITE_PATH_FL && ctx->w.bounce_page) {
@@ -88,12 +125,23 @@ void f2fs_release_crypto_ctx(struct f2fs_crypto_ctx *ctx)
 	}
 	ctx->w.control_page = NULL;
 	if (ctx->flags & F2FS_CTX_REQUIRES_FREE_ENCRYPT_FL) {
-		kmem_cache_free(f2fs_crypto_ctx_cachep, ctx);
-	} else {
-		spin_lock_irqsave(&f2fs_crypto_ctx_lock, flags);
-		list_add(&ctx->free_list, &f2fs_free_crypto_ctxs);
-		spin_unlock_irqrestore(&f2fs_crypto_ctx_lock, flags);
+		f2fs_free_crypto_ctx(ctx);
+		return;
 	}
+
+	/* Release may run from bio completion, so keep irqs off. */
+	local_irq_save(flags);
+	cache = this_cpu_ptr(&f2fs_ctx_cache);
+	if (cache->nr < F2FS_CTX_CACHE_SIZE) {
+		cache->ctxs[cache->nr++] = ctx;
+		local_irq_restore(flags);
+		return;
+	}
+	local_irq_restore(flags);
+
+	spin_lock_irqsave(&f2fs_crypto_ctx_lock, flags);
+	list_add(&ctx->free_list, &f2fs_free_crypto_ctxs);
+	spin_unlock_irqrestore(&f2fs_crypto_ctx_lock, flags);
 }
 
 /**
@@ -108,6 +156,7 @@ void f2fs_release_crypto_ctx(struct f2fs_crypto_ctx *ctx)
 struct f2fs_crypto_ctx *f2fs_get_crypto_ctx(struct inode *inode)
 {
 	struct f2fs_crypto_ctx *ctx = NULL;
+	struct f2fs_ctx_cache *cache;
 	unsigned long flags;
 	struct f2fs_crypt_info *ci = F2FS_I(inode)->i_crypt_info;
 
@@ -123,21 +172,39 @@ struct f2fs_crypto_ctx *f2fs_get_crypto_ctx(struct inode *inode)
 	 * as getting it from a list and because a cache of free pages
 	 * should generally be a "last resort" option for a filesystem
 	 * to be able to do its job.
+	 *
+	 * The per-cpu cache is tried before the global list so that
+	 * the common case never touches a shared lock.
 	 */
-	spin_lock_irqsave(&f2fs_crypto_ctx_lock, flags);
+	local_irq_save(flags);
+	cache = this_cpu_ptr(&f2fs_ctx_cache);
+	if (cache->nr) {
+		ctx = cache->ctxs[--cache->nr];
+		cache->stats[F2FS_CTX_HIT_LOCAL]++;
+	}
+	local_irq_restore(flags);
+	if (ctx)
+		goto out;
+
+	if (!spin_trylock_irqsave(&f2fs_crypto_ctx_lock, flags)) {
+		f2fs_ctx_stat_inc(F2FS_CTX_CONTENDED);
+		spin_lock_irqsave(&f2fs_crypto_ctx_lock, flags);
+	}
 	ctx = list_first_entry_or_null(&f2fs_free_crypto_ctxs,
 					struct f2fs_crypto_ctx, free_list);
 	if (ctx)
 		list_del(&ctx->free_list);
 	spin_unlock_irqrestore(&f2fs_crypto_ctx_lock, flags);
 	if (!ctx) {
+		f2fs_ctx_stat_inc(F2FS_CTX_ALLOC);
 		ctx = kmem_cache_zalloc(f2fs_crypto_ctx_cachep, GFP_NOFS);
 		if (!ctx)
 			return ERR_PTR(-ENOMEM);
 		ctx->flags |= F2FS_CTX_REQUIRES_FREE_ENCRYPT_FL;
-	} else {
-		ctx->flags &= ~F2FS_CTX_REQUIRES_FREE_ENCRYPT_FL;
+		goto out;
 	}
+	f2fs_ctx_stat_inc(F2FS_CTX_HIT_GLOBAL);
+out:
 	ctx->flags &= ~F2FS_WRITE_PATH_FL;
 	return ctx;
 }
@@ -179,9 +246,16 @@ void f2fs_end_io_crypto_work(struct f2fs_crypto_ctx *ctx, struct bio *bio)
 static void f2fs_crypto_destroy(void)
 {
 	struct f2fs_crypto_ctx *pos, *n;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct f2fs_ctx_cache *cache = per_cpu_ptr(&f2fs_ctx_cache, cpu);
 
+		while (cache->nr)
+			f2fs_free_crypto_ctx(cache->ctxs[--cache->nr]);
+	}
 	list_for_each_entry_safe(pos, n, &f2fs_free_crypto_ctxs, free_list)
-		kmem_cache_free(f2fs_crypto_ctx_cachep, pos);
+		f2fs_free_crypto_ctx(pos);
 	INIT_LIST_HEAD(&f2fs_free_crypto_ctxs);
 	if (f2fs_bounce_page_pool)
 		mempool_destroy(f2fs_bounce_page_pool);
@@ -320,6 +394,28 @@ typedef enum {
 	F2FS_ENCRYPT,
 } f2fs_direction_t;
 
+/*
+ * Returns the request cached in @ctx, bound to @tfm. The request is only
+ * reallocated when a tfm with a larger request size shows up, so a pooled
+ * context pays for the allocation once rather than on every page.
+ */
+static struct ablkcipher_request *f2fs_ctx_request(struct f2fs_crypto_ctx *ctx,
+					struct crypto_ablkcipher *tfm)
+{
+	unsigned int size = sizeof(struct ablkcipher_request) +
+				crypto_ablkcipher_reqsize(tfm);
+
+	if (!ctx->req || ctx->req_size < size) {
+		kzfree(ctx->req);
+		ctx->req = kmalloc(size, GFP_NOFS);
+		ctx->req_size = ctx->req ? size : 0;
+		if (!ctx->req)
+			return NULL;
+	}
+	ablkcipher_request_set_tfm(ctx->req, tfm);
+	return ctx->req;
+}
+
 static int f2fs_page_crypto(struct f2fs_crypto_ctx *ctx,
 				struct inode *inode,
 				f2fs_direction_t rw,
@@ -335,7 +431,7 @@ static int f2fs_page_crypto(struct f2fs_crypto_ctx *ctx,
 	struct crypto_ablkcipher *tfm = ci->ci_ctfm;
 	int res = 0;
 
-	req = ablkcipher_request_alloc(tfm, GFP_NOFS);
+	req = f2fs_ctx_request(ctx, tfm);
 	if (!req) {
 		printk_ratelimited(KERN_ERR
 				"%s: crypto_request_alloc() failed\n",
@@ -366,7 +462,6 @@ static int f2fs_page_crypto(struct f2fs_crypto_ctx *ctx,
 		wait_for_completion(&ecr.completion);
 		res = ecr.res;
 	}
-	ablkcipher_request_free(req);
 	if (res) {
 		printk_ratelimited(KERN_ERR
 			"%s: crypto_ablkcipher_encrypt() returned %d\n",
@@ -489,3 +584,53 @@ uint32_t f2fs_validate_encryption_key_size(uint32_t mode, uint32_t size)
 		return size;
 	return 0;
 }
+
+#ifdef CONFIG_F2FS_FS_ICE_ENCRYPTION
+static struct inode *f2fs_ice_page_inode(struct page *page)
+{
+	struct address_space *mapping = page_mapping(page);
+
+	if (!mapping || !f2fs_inode_uses_ice(mapping->host))
+		return NULL;
+	return mapping->host;
+}
+
+/**
+ * f2fs_ice_mergeable() - Check if a page can be appended to a bio
+ * @bio:  The bio being built.
+ * @page: The page that would go next into @bio.
+ *
+ * ICE takes the key and the data unit number of a whole request from its
+ * first page, so a bio must not mix pages encrypted by ICE with other
+ * pages, and its ICE pages must belong to one file with contiguous
+ * indexes.
+ */
+bool f2fs_ice_mergeable(struct bio *bio, struct page *page)
+{
+	struct page *first = bio->bi_io_vec[0].bv_page;
+	struct inode *inode = f2fs_ice_page_inode(page);
+
+	if (inode != f2fs_ice_page_inode(first))
+		return false;
+	return !inode || page->index == first->index + bio->bi_vcnt;
+}
+
+/*
+ * Called by PFK when it sets up ICE for a request, to find out whether
+ * @inode is one of ours and which key to load for it.
+ */
+bool f2fs_ice_inode(struct inode *inode)
+{
+	return inode->i_sb->s_magic == F2FS_SUPER_MAGIC &&
+		f2fs_inode_uses_ice(inode);
+}
+
+const unsigned char *f2fs_ice_get_key(struct inode *inode)
+{
+	struct f2fs_crypt_info *ci = ACCESS_ONCE(F2FS_I(inode)->i_crypt_info);
+
+	if (!ci || !ci->ci_ice_key_set)
+		return NULL;
+	return ci->ci_raw_key;
+}
+#endif
@@ -138,6 +138,47 @@ static int f2fs_fname_encrypt(struct inode *inode,
 	return res;
 }
 
+/*
+ * __f2fs_fname_decrypt()
+ *	Decrypts one filename using @req, whose completion callback has
+ *	been set up with @ecr. The request can be reused for the next name.
+ */
+static int __f2fs_fname_decrypt(struct ablkcipher_request *req,
+			struct f2fs_completion_result *ecr, unsigned lim,
+			const struct f2fs_str *iname, struct f2fs_str *oname)
+{
+	struct scatterlist src_sg, dst_sg;
+	int res = 0;
+	char iv[F2FS_CRYPTO_BLOCK_SIZE];
+
+	if (iname->len <= 0 || iname->len > lim)
+		return -EIO;
+
+	/* Initialize IV */
+	memset(iv, 0, F2FS_CRYPTO_BLOCK_SIZE);
+
+	/* Create decryption request */
+	sg_init_one(&src_sg, iname->name, iname->len);
+	sg_init_one(&dst_sg, oname->name, oname->len);
+	ablkcipher_request_set_crypt(req, &src_sg, &dst_sg, iname->len, iv);
+	reinit_completion(&ecr->completion);
+	res = crypto_ablkcipher_decrypt(req);
+	if (res == -EINPROGRESS || res == -EBUSY) {
+		BUG_ON(req->base.data != ecr);
+		wait_for_completion(&ecr->completion);
+		res = ecr->res;
+	}
+	if (res < 0) {
+		printk_ratelimited(KERN_ERR
+			"%s: Error in f2fs_fname_decrypt (error code %d)\n",
+			__func__, res);
+		return res;
+	}
+
+	oname->len = strnlen(oname->name, iname->len);
+	return oname->len;
+}
+
 /*
  * f2fs_fname_decrypt()
  *	This function decrypts the input filename, and returns
@@ -150,15 +191,9 @@ static int f2fs_fname_decrypt(struct inode *inode,
 {
 	struct ablkcipher_request *req = NULL;
 	DECLARE_F2FS_COMPLETION_RESULT(ecr);
-	struct scatterlist src_sg, dst_sg;
 	struct f2fs_crypt_info *ci = F2FS_I(inode)->i_crypt_info;
 	struct crypto_ablkcipher *tfm = ci->ci_ctfm;
-	int res = 0;
-	char iv[F2FS_CRYPTO_BLOCK_SIZE];
-	unsigned lim = max_name_len(inode);
-
-	if (iname->len <= 0 || iname->len > lim)
-		return -EIO;
+	int res;
 
 	/* Allocate request */
 	req = ablkcipher_request_alloc(tfm, GFP_NOFS);
@@ -171,29 +206,139 @@ static int f2fs_fname_decrypt(struct inode *inode,
 		CRYPTO_TFM_REQ_MAY_BACKLOG | CRYPTO_TFM_REQ_MAY_SLEEP,
 		f2fs_dir_crypt_complete, &ecr);
 
-	/* Initialize IV */
-	memset(iv, 0, F2FS_CRYPTO_BLOCK_SIZE);
+	res = __f2fs_fname_decrypt(req, &ecr, max_name_len(inode),
+							iname, oname);
+	ablkcipher_request_free(req);
+	return res;
+}
 
-	/* Create decryption request */
-	sg_init_one(&src_sg, iname->name, iname->len);
-	sg_init_one(&dst_sg, oname->name, oname->len);
-	ablkcipher_request_set_crypt(req, &src_sg, &dst_sg, iname->len, iv);
-	res = crypto_ablkcipher_decrypt(req);
-	if (res == -EINPROGRESS || res == -EBUSY) {
-		BUG_ON(req->base.data != &ecr);
-		wait_for_completion(&ecr.completion);
-		res = ecr.res;
+/*
+ * Decrypts every name of the dentry block @d into @db using a single
+ * cipher request. @tmp is a bounce buffer of at least F2FS_NAME_LEN bytes,
+ * since the dentry block itself may live in highmem.
+ */
+static int f2fs_fname_decrypt_block(struct inode *dir,
+			struct f2fs_dentry_ptr *d, struct f2fs_dname_block *db,
+			struct f2fs_str *tmp)
+{
+	struct crypto_ablkcipher *tfm = F2FS_I(dir)->i_crypt_info->ci_ctfm;
+	struct ablkcipher_request *req;
+	DECLARE_F2FS_COMPLETION_RESULT(ecr);
+	unsigned int bit_pos = 0;
+	int res = 0;
+
+	req = ablkcipher_request_alloc(tfm, GFP_NOFS);
+	if (!req)
+		return -ENOMEM;
+	ablkcipher_request_set_callback(req,
+		CRYPTO_TFM_REQ_MAY_BACKLOG | CRYPTO_TFM_REQ_MAY_SLEEP,
+		f2fs_dir_crypt_complete, &ecr);
+
+	while ((bit_pos = find_next_bit_le(d->bitmap, d->max, bit_pos)) <
+								d->max) {
+		struct f2fs_dir_entry *de = &d->dentry[bit_pos];
+		unsigned int len = le16_to_cpu(de->name_len);
+		unsigned int slots = GET_DENTRY_SLOTS(len);
+		struct f2fs_str iname = FSTR_INIT(tmp->name, len);
+		struct f2fs_str oname = FSTR_INIT(db->name[bit_pos],
+						slots * F2FS_SLOT_LEN);
+		const struct qstr qname = FSTR_TO_QSTR(&iname);
+
+		if (!len || len > F2FS_NAME_LEN || bit_pos + slots > d->max) {
+			res = -EIO;
+			break;
+		}
+		memcpy(tmp->name, d->filename[bit_pos], len);
+		if (is_dot_dotdot(&qname)) {
+			memcpy(oname.name, iname.name, len);
+			res = len;
+		} else {
+			res = __f2fs_fname_decrypt(req, &ecr, F2FS_NAME_LEN,
+							&iname, &oname);
+		}
+		if (res < 0)
+			break;
+		db->len[bit_pos] = res;
+		bit_pos += slots;
 	}
 	ablkcipher_request_free(req);
-	if (res < 0) {
-		printk_ratelimited(KERN_ERR
-			"%s: Error in f2fs_fname_decrypt (error code %d)\n",
-			__func__, res);
-		return res;
+	return res < 0 ? res : 0;
+}
+
+/**
+ * f2fs_fname_get_block() - returns the decrypted names of a dentry block
+ * @d:     The dentry block of an encrypted directory
+ * @index: Index of the block in the directory, 0 for inline dentries
+ * @tmp:   Bounce buffer of at least F2FS_NAME_LEN bytes
+ *
+ * Names are decrypted a whole block at a time and kept in a small
+ * per-directory cache, so a directory listed through many getdents calls,
+ * or listed repeatedly, is only decrypted once. The cache is protected by
+ * the directory's i_mutex, which readdir and all dentry updates hold.
+ *
+ * Return: the cached block, or NULL if the names could not be decrypted
+ * in one go and the caller has to fall back to f2fs_fname_disk_to_usr().
+ */
+struct f2fs_dname_block *f2fs_fname_get_block(struct f2fs_dentry_ptr *d,
+				unsigned long index, struct f2fs_str *tmp)
+{
+	struct f2fs_crypt_info *ci = F2FS_I(d->inode)->i_crypt_info;
+	struct f2fs_dname_block *db;
+
+	if (!ci || !tmp->name)
+		return NULL;
+
+	list_for_each_entry(db, &ci->ci_dname_cache, list) {
+		if (db->index == index && db->max == d->max) {
+			list_move(&db->list, &ci->ci_dname_cache);
+			return db;
+		}
 	}
 
-	oname->len = strnlen(oname->name, iname->len);
-	return oname->len;
+	if (ci->ci_dname_nr < F2FS_DNAME_CACHE_BLOCKS) {
+		db = kmalloc(sizeof(*db), GFP_NOFS);
+		if (!db)
+			return NULL;
+		ci->ci_dname_nr++;
+	} else {
+		db = list_last_entry(&ci->ci_dname_cache,
+					struct f2fs_dname_block, list);
+		list_del(&db->list);
+	}
+
+	db->index = index;
+	db->max = d->max;
+	if (f2fs_fname_decrypt_block(d->inode, d, db, tmp)) {
+		kzfree(db);
+		ci->ci_dname_nr--;
+		return NULL;
+	}
+	list_add(&db->list, &ci->ci_dname_cache);
+	return db;
+}
+
+void f2fs_fname_cache_free(struct f2fs_crypt_info *ci)
+{
+	struct f2fs_dname_block *db, *n;
+
+	list_for_each_entry_safe(db, n, &ci->ci_dname_cache, list)
+		kzfree(db);
+	INIT_LIST_HEAD(&ci->ci_dname_cache);
+	ci->ci_dname_nr = 0;
+}
+
+/**
+ * f2fs_fname_cache_invalidate() - drops the decrypted names of a directory
+ * @dir: The directory whose entries are being changed
+ *
+ * Called with the directory's i_mutex held.
+ */
+void f2fs_fname_cache_invalidate(struct inode *dir)
+{
+	struct f2fs_crypt_info *ci = F2FS_I(dir)->i_crypt_info;
+
+	if (ci && ci->ci_dname_nr)
+		f2fs_fname_cache_free(ci);
 }
 
 static const char *lookup_table =
@@ -16,6 +16,7 @@
 #include <uapi/linux/keyctl.h>
 #include <crypto/hash.h>
 #include <linux/f2fs_fs.h>
+#include <linux/pfk.h>
 
 #include "f2fs.h"
 #include "xattr.h"
@@ -92,8 +93,15 @@ static void f2fs_free_crypt_info(struct f2fs_crypt_info *ci)
 	if (!ci)
 		return;
 
+	f2fs_fname_cache_free(ci);
 	key_put(ci->ci_keyring_key);
 	crypto_free_ablkcipher(ci->ci_ctfm);
+#ifdef CONFIG_F2FS_FS_ICE_ENCRYPTION
+	if (ci->ci_ice_key_set) {
+		pfk_remove_key(ci->ci_raw_key, F2FS_AES_256_XTS_KEY_SIZE / 2);
+		memzero_explicit(ci->ci_raw_key, sizeof(ci->ci_raw_key));
+	}
+#endif
 	kmem_cache_free(f2fs_crypt_info_cachep, ci);
 }
 
@@ -160,6 +168,11 @@ retry:
 	crypt_info->ci_filename_mode = ctx.filenames_encryption_mode;
 	crypt_info->ci_ctfm = NULL;
 	crypt_info->ci_keyring_key = NULL;
+	INIT_LIST_HEAD(&crypt_info->ci_dname_cache);
+	crypt_info->ci_dname_nr = 0;
+#ifdef CONFIG_F2FS_FS_ICE_ENCRYPTION
+	crypt_info->ci_ice_key_set = false;
+#endif
 	memcpy(crypt_info->ci_master_key, ctx.master_key_descriptor,
 				sizeof(crypt_info->ci_master_key));
 	if (S_ISREG(inode->i_mode))
@@ -230,6 +243,14 @@ retry:
 	if (res)
 		goto out;
 
+#ifdef CONFIG_F2FS_FS_ICE_ENCRYPTION
+	/* ICE gets the same xts key, loaded through PFK at I/O time */
+	if (f2fs_inode_uses_ice(inode)) {
+		memcpy(crypt_info->ci_raw_key, raw_key,
+				F2FS_AES_256_XTS_KEY_SIZE);
+		crypt_info->ci_ice_key_set = true;
+	}
+#endif
 	memzero_explicit(raw_key, sizeof(raw_key));
 	if (cmpxchg(&fi->i_crypt_info, NULL, crypt_info) != NULL) {
 		f2fs_free_crypt_info(crypt_info);
@@ -181,8 +181,11 @@ void f2fs_submit_page_mbio(struct f2fs_io_info *fio)
 	if (!is_read)
 		inc_page_count(sbi, F2FS_WRITEBACK);
 
+	bio_page = fio->encrypted_page ? fio->encrypted_page : fio->page;
+
 	if (io->bio && (io->last_block_in_bio != fio->blk_addr - 1 ||
-						io->fio.rw != fio->rw))
+			io->fio.rw != fio->rw ||
+			!f2fs_ice_mergeable(io->bio, bio_page)))
 		__submit_merged_bio(io);
 alloc_new:
 	if (io->bio == NULL) {
@@ -192,8 +195,6 @@ alloc_new:
 		io->fio = *fio;
 	}
 
-	bio_page = fio->encrypted_page ? fio->encrypted_page : fio->page;
-
 	if (bio_add_page(io->bio, bio_page, PAGE_CACHE_SIZE, 0) <
 							PAGE_CACHE_SIZE) {
 		__submit_merged_bio(io);
@@ -291,7 +292,7 @@ struct page *get_read_data_page(struct inode *inode, pgoff_t index, int rw)
 		.encrypted_page = NULL,
 	};
 
-	if (f2fs_encrypted_inode(inode) && S_ISREG(inode->i_mode))
+	if (f2fs_sw_encrypted_data(inode))
 		return read_mapping_page(mapping, index, NULL);
 
 	page = grab_cache_page(mapping, index);
@@ -573,7 +574,7 @@ static int f2fs_map_blocks(struct inode *inode, struct f2fs_map_blocks *map,
 	struct dnode_of_data dn;
 	struct f2fs_sb_info *sbi = F2FS_I_SB(inode);
 	int mode = create ? ALLOC_NODE : LOOKUP_NODE_RA;
-	pgoff_t pgofs, end_offset;
+	pgoff_t pgofs, start_pgofs, end_offset;
 	int err = 0, ofs = 1;
 	struct extent_info ei;
 	bool allocated = false;
@@ -583,6 +584,7 @@ static int f2fs_map_blocks(struct inode *inode, struct f2fs_map_blocks *map,
 
 	/* it only supports block size == page size */
 	pgofs =	(pgoff_t)map->m_lblk;
+	start_pgofs = pgofs;
 
 	if (f2fs_lookup_extent_cache(inode, pgofs, &ei)) {
 		map->m_pblk = ei.blk + pgofs - ei.fofs;
@@ -698,6 +700,13 @@ get_next:
 sync_out:
 	if (allocated)
 		sync_inode_page(&dn);
+
+	/* reads don't populate the extent cache, unless asked to */
+	if (flag == F2FS_GET_BLOCK_PRECACHE &&
+			(map->m_flags & F2FS_MAP_MAPPED) &&
+			map->m_pblk != NEW_ADDR)
+		f2fs_update_extent_cache_range(&dn, start_pgofs,
+						map->m_pblk, map->m_len);
 put_out:
 	f2fs_put_dnode(&dn);
 unlock_out:
@@ -708,6 +717,41 @@ out:
 	return err;
 }
 
+/*
+ * Walk the whole block mapping of inode and add every mapped extent to
+ * its extent cache, so that subsequent reads don't need node pages to
+ * find their blocks.
+ */
+int f2fs_precache_extents(struct inode *inode)
+{
+	struct f2fs_map_blocks map;
+	block_t end;
+	int err;
+
+	if (is_inode_flag_set(F2FS_I(inode), FI_NO_EXTENT))
+		return -EOPNOTSUPP;
+
+	map.m_lblk = 0;
+	end = F2FS_BYTES_TO_BLK(i_size_read(inode) + PAGE_CACHE_SIZE - 1);
+
+	while (map.m_lblk < end) {
+		map.m_len = end - map.m_lblk;
+
+		err = f2fs_map_blocks(inode, &map, 0, F2FS_GET_BLOCK_PRECACHE);
+		if (err)
+			return err;
+
+		/* skip a hole one block at a time */
+		map.m_lblk += map.m_len ? map.m_len : 1;
+
+		if (fatal_signal_pending(current))
+			return -EINTR;
+		cond_resched();
+	}
+
+	return 0;
+}
+
 static int __get_data_block(struct inode *inode, sector_t iblock,
 			struct buffer_head *bh, int create, int flag)
 {
@@ -950,7 +994,8 @@ got_it:
 		 * This page will go to BIO.  Do we need to send this
 		 * BIO off first?
 		 */
-		if (bio && (last_block_in_bio != block_nr - 1)) {
+		if (bio && (last_block_in_bio != block_nr - 1 ||
+				!f2fs_ice_mergeable(bio, page))) {
 submit_and_realloc:
 			submit_bio(READ, bio);
 			bio = NULL;
@@ -962,9 +1007,11 @@ submit_and_realloc:
 					S_ISREG(inode->i_mode)) {
 				struct page *cpage;
 
-				ctx = f2fs_get_crypto_ctx(inode);
-				if (IS_ERR(ctx))
-					goto set_error_page;
+				if (!f2fs_inode_uses_ice(inode)) {
+					ctx = f2fs_get_crypto_ctx(inode);
+					if (IS_ERR(ctx))
+						goto set_error_page;
+				}
 
 				/* wait the page to be moved by cleaning */
 				cpage = find_lock_page(
@@ -1064,7 +1111,7 @@ int do_write_data_page(struct f2fs_io_info *fio)
 		goto out_writepage;
 	}
 
-	if (f2fs_encrypted_inode(inode) && S_ISREG(inode->i_mode)) {
+	if (f2fs_sw_encrypted_data(inode)) {
 		fio->encrypted_page = f2fs_encrypt(inode, fio->page);
 		if (IS_ERR(fio->encrypted_page)) {
 			err = PTR_ERR(fio->encrypted_page);
@@ -1490,7 +1537,7 @@ put_next:
 		}
 
 		/* avoid symlink page */
-		if (f2fs_encrypted_inode(inode) && S_ISREG(inode->i_mode)) {
+		if (f2fs_sw_encrypted_data(inode)) {
 			err = f2fs_decrypt_one(inode, page);
 			if (err)
 				goto fail;
@@ -202,6 +202,24 @@ get_cache:
 	si->page_mem += (unsigned long long)npages << PAGE_CACHE_SHIFT;
 }
 
+/*
+ * Blocks written by users and by GC over blocks written by users, in
+ * hundredths. Every allocated block counts as an LFS or SSR write, and
+ * blocks moved by GC are among them.
+ */
+static unsigned int gc_write_amp(struct f2fs_stat_info *si)
+{
+	unsigned long long total = (unsigned long long)si->block_count[LFS] +
+						si->block_count[SSR];
+	unsigned long long user;
+
+	if (total <= si->tot_blks)
+		return 100;
+	user = total - si->tot_blks;
+
+	return div64_u64(total * 100, user);
+}
+
 static int stat_show(struct seq_file *s, void *v)
 {
 	struct f2fs_stat_info *si;
@@ -281,6 +299,12 @@ static int stat_show(struct seq_file *s, void *v)
 				si->bg_data_blks);
 		seq_printf(s, "  - node blocks : %d (%d)\n", si->node_blks,
 				si->bg_node_blks);
+		seq_printf(s, "Victims: CB: %u, Greedy: %u, AT: %u\n",
+				si->victim_count[GC_CB],
+				si->victim_count[GC_GREEDY],
+				si->victim_count[GC_AT]);
+		seq_printf(s, "GC write amplification: %u.%02u\n",
+				gc_write_amp(si) / 100, gc_write_amp(si) % 100);
 		seq_puts(s, "\nExtent Cache:\n");
 		seq_printf(s, "  - Hit Count: L1-1:%d L1-2:%d L2:%d\n",
 				si->hit_largest, si->hit_cached,
@@ -341,6 +365,17 @@ static int stat_show(struct seq_file *s, void *v)
 		seq_printf(s, "  - paged : %llu KB\n",
 				si->page_mem >> 10);
 	}
+#ifdef CONFIG_F2FS_FS_ENCRYPTION
+	{
+		unsigned long cs[NR_F2FS_CTX_STATS];
+
+		f2fs_crypto_ctx_stats(cs);
+		seq_printf(s, "\nCrypto ctx: local %lu, global %lu, ",
+			   cs[F2FS_CTX_HIT_LOCAL], cs[F2FS_CTX_HIT_GLOBAL]);
+		seq_printf(s, "contended %lu, alloc %lu\n",
+			   cs[F2FS_CTX_CONTENDED], cs[F2FS_CTX_ALLOC]);
+	}
+#endif
 	mutex_unlock(&f2fs_stat_mutex);
 	return 0;
 }
@@ -300,6 +300,8 @@ void f2fs_set_link(struct inode *dir, struct f2fs_dir_entry *de,
 		struct page *page, struct inode *inode)
 {
 	enum page_type type = f2fs_has_inline_dentry(dir) ? NODE : DATA;
+
+	f2fs_fname_cache_invalidate(dir);
 	lock_page(page);
 	f2fs_wait_on_page_writeback(page, type);
 	de->ino = cpu_to_le32(inode->i_ino);
@@ -548,6 +550,8 @@ int __f2fs_add_link(struct inode *dir, const struct qstr *name,
 	new_name.name = fname_name(&fname);
 	new_name.len = fname_len(&fname);
 
+	f2fs_fname_cache_invalidate(dir);
+
 	if (f2fs_has_inline_dentry(dir)) {
 		err = f2fs_add_inline_entry(dir, &new_name, inode, ino, mode);
 		if (!err || err != -EAGAIN)
@@ -706,6 +710,8 @@ void f2fs_delete_entry(struct f2fs_dir_entry *dentry, struct page *page,
 	int slots = GET_DENTRY_SLOTS(le16_to_cpu(dentry->name_len));
 	int i;
 
+	f2fs_fname_cache_invalidate(dir);
+
 	if (f2fs_has_inline_dentry(dir))
 		return f2fs_delete_inline_entry(dentry, page, dir, inode);
 
@@ -784,9 +790,14 @@ bool f2fs_fill_dentries(struct dir_context *ctx, struct f2fs_dentry_ptr *d,
 	unsigned int bit_pos;
 	struct f2fs_dir_entry *de = NULL;
 	struct f2fs_str de_name = FSTR_INIT(NULL, 0);
+	struct f2fs_dname_block *db = NULL;
 
 	bit_pos = ((unsigned long)ctx->pos % d->max);
 
+	if (f2fs_encrypted_inode(d->inode))
+		db = f2fs_fname_get_block(d, start_pos / NR_DENTRY_IN_BLOCK,
+									fstr);
+
 	while (bit_pos < d->max) {
 		bit_pos = find_next_bit_le(d->bitmap, d->max, bit_pos);
 		if (bit_pos >= d->max)
@@ -801,7 +812,10 @@ bool f2fs_fill_dentries(struct dir_context *ctx, struct f2fs_dentry_ptr *d,
 		de_name.name = d->filename[bit_pos];
 		de_name.len = le16_to_cpu(de->name_len);
 
-		if (f2fs_encrypted_inode(d->inode)) {
+		if (db) {
+			de_name.name = db->name[bit_pos];
+			de_name.len = db->len[bit_pos];
+		} else if (f2fs_encrypted_inode(d->inode)) {
 			int save_len = fstr->len;
 			int ret;
 
@@ -53,6 +53,7 @@
 #define F2FS_MOUNT_NOBARRIER		0x00000800
 #define F2FS_MOUNT_FASTBOOT		0x00001000
 #define F2FS_MOUNT_EXTENT_CACHE		0x00002000
+#define F2FS_MOUNT_INLINECRYPT		0x00004000
 
 #define clear_opt(sbi, option)	(sbi->mount_opt.opt &= ~F2FS_MOUNT_##option)
 #define set_opt(sbi, option)	(sbi->mount_opt.opt |= F2FS_MOUNT_##option)
@@ -234,6 +235,7 @@ static inline bool __has_cursum_space(struct f2fs_summary_block *sum, int size,
 #define F2FS_IOC_RELEASE_VOLATILE_WRITE	_IO(F2FS_IOCTL_MAGIC, 4)
 #define F2FS_IOC_ABORT_VOLATILE_WRITE	_IO(F2FS_IOCTL_MAGIC, 5)
 #define F2FS_IOC_GARBAGE_COLLECT	_IO(F2FS_IOCTL_MAGIC, 6)
+#define F2FS_IOC_PRECACHE_EXTENTS	_IO(F2FS_IOCTL_MAGIC, 15)
 
 #define F2FS_IOC_SET_ENCRYPTION_POLICY					\
 		_IOR('f', 19, struct f2fs_encryption_policy)
@@ -375,6 +377,7 @@ struct f2fs_map_blocks {
 #define F2FS_GET_BLOCK_DIO		1
 #define F2FS_GET_BLOCK_FIEMAP		2
 #define F2FS_GET_BLOCK_BMAP		3
+#define F2FS_GET_BLOCK_PRECACHE		4
 
 /*
  * i_advise uses FADVISE_XXX_BIT. We can add additional hints later.
@@ -424,6 +427,7 @@ struct f2fs_inode_info {
 	unsigned int clevel;		/* maximum level of given file name */
 	nid_t i_xattr_nid;		/* node id that contains xattrs */
 	unsigned long long xattr_ver;	/* cp version of xattr modification */
+	unsigned long long created_ver;	/* cp version of inode creation */
 
 	struct list_head dirty_list;	/* linked in global dirty list */
 	struct list_head inmem_pages;	/* inmemory pages managed by f2fs */
@@ -702,6 +706,21 @@ enum {
 	SBI_NO_GC,				/* disable f2fs gc */
 };
 
+/*
+ * In the victim_sel_policy->gc_mode, there are three gc, aka cleaning, modes.
+ * GC_CB is based on cost-benefit algorithm.
+ * GC_GREEDY is based on greedy algorithm.
+ * GC_AT is based on age-threshold algorithm: sections younger than
+ * gc_age_threshold are not considered, and among up to gc_max_candidates
+ * older ones the one with the fewest valid blocks, then the oldest, wins.
+ */
+enum {
+	GC_CB = 0,
+	GC_GREEDY,
+	GC_AT,
+	MAX_GC_POLICY,
+};
+
 struct f2fs_sb_info {
 	struct super_block *sb;			/* pointer to VFS super block */
 	struct proc_dir_entry *s_proc;		/* proc entry */
@@ -783,6 +802,22 @@ struct f2fs_sb_info {
 	/* maximum # of trials to find a victim segment for SSR and GC */
 	unsigned int max_victim_search;
 
+	/* for GC_AT victim selection */
+	unsigned int gc_age_threshold;		/* min. age of victims (sec) */
+	unsigned int gc_max_candidates;		/* # of candidates per pick */
+
+	/* for GC statistics, updated under gc_mutex */
+	unsigned int bg_gc_time_ms;		/* time spent in background GC */
+	unsigned int fg_gc_time_ms;		/* time spent in foreground GC */
+	unsigned int fg_gc_blocked;		/* # of writers that ran FG GC */
+
+	/* for atomic commit statistics, updated under stat_lock */
+	unsigned int atomic_commits;		/* # of atomic commits */
+	unsigned int atomic_commit_cps;		/* # of them that did a CP */
+	unsigned int atomic_commit_time_ms;	/* time spent committing */
+	unsigned int atomic_data_blocks;	/* data blocks committed */
+	unsigned int atomic_node_blocks;	/* node blocks they wrote */
+
 	/*
 	 * for stat information.
 	 * one is for the LFS mode, and the other is for the SSR mode.
@@ -802,7 +837,7 @@ struct f2fs_sb_info {
 	int bg_gc;				/* background gc calls */
 	unsigned int n_dirty_dirs;		/* # of dir inodes */
 #endif
-	unsigned int last_victim[2];		/* last victim segment # */
+	unsigned int last_victim[MAX_GC_POLICY];	/* last victim segment # */
 	spinlock_t stat_lock;			/* lock for stat operations */
 
 	/* For sysfs suppport */
@@ -1389,6 +1424,7 @@ enum {
 	FI_DROP_CACHE,		/* drop dirty page cache */
 	FI_DATA_EXIST,		/* indicate data exists */
 	FI_INLINE_DOTS,		/* indicate inline dot dentries */
+	FI_ATOMIC_COMMIT,	/* atomic file is being committed */
 };
 
 static inline void set_inode_flag(struct f2fs_inode_info *fi, int flag)
@@ -1720,7 +1756,8 @@ void ra_node_page(struct f2fs_sb_info *, nid_t);
 struct page *get_node_page(struct f2fs_sb_info *, pgoff_t);
 struct page *get_node_page_ra(struct page *, int);
 void sync_inode_page(struct dnode_of_data *);
-int sync_node_pages(struct f2fs_sb_info *, nid_t, struct writeback_control *);
+int sync_node_pages(struct f2fs_sb_info *, nid_t, struct writeback_control *,
+								bool);
 bool alloc_nid(struct f2fs_sb_info *, nid_t *);
 void alloc_nid_done(struct f2fs_sb_info *, nid_t);
 void alloc_nid_failed(struct f2fs_sb_info *, nid_t);
@@ -1819,6 +1856,7 @@ struct page *get_lock_data_page(struct inode *, pgoff_t);
 struct page *get_new_data_page(struct inode *, struct page *, pgoff_t, bool);
 int do_write_data_page(struct f2fs_io_info *);
 int f2fs_fiemap(struct inode *inode, struct fiemap_extent_info *, u64, u64);
+int f2fs_precache_extents(struct inode *);
 void f2fs_invalidate_page(struct page *, unsigned int, unsigned int);
 int f2fs_release_page(struct page *, gfp_t);
 
@@ -1870,6 +1908,7 @@ struct f2fs_stat_info {
 	unsigned int segment_count[2];
 	unsigned int block_count[2];
 	unsigned int inplace_count;
+	unsigned int victim_count[MAX_GC_POLICY];
 	unsigned long long base_mem, cache_mem, page_mem;
 };
 
@@ -1923,6 +1962,8 @@ static inline struct f2fs_stat_info *F2FS_STAT(struct f2fs_sb_info *sbi)
 		((sbi)->block_count[(curseg)->alloc_type]++)
 #define stat_inc_inplace_blocks(sbi)					\
 		(atomic_inc(&(sbi)->inplace_count))
+#define stat_inc_victim_count(sbi, gc_mode)				\
+		(F2FS_STAT(sbi)->victim_count[gc_mode]++)
 #define stat_inc_seg_count(sbi, type, gc_type)				\
 	do {								\
 		struct f2fs_stat_info *si = F2FS_STAT(sbi);		\
@@ -1979,6 +2020,7 @@ void f2fs_destroy_root_stats(void);
 #define stat_inc_block_count(sbi, curseg)
 #define stat_inc_inplace_blocks(sbi)
 #define stat_inc_seg_count(sbi, type, gc_type)
+#define stat_inc_victim_count(sbi, gc_mode)
 #define stat_inc_tot_blk_count(si, blks)
 #define stat_inc_data_blk_count(sbi, blks, gc_type)
 #define stat_inc_node_blk_count(sbi, blks, gc_type)
@@ -2068,6 +2110,26 @@ static inline void f2fs_set_encrypted_inode(struct inode *inode)
 #endif
 }
 
+/*
+ * Data of encrypted regular files is encrypted by the Inline Crypto Engine
+ * on file systems mounted with inlinecrypt, and by the CPU otherwise.
+ */
+static inline bool f2fs_inode_uses_ice(struct inode *inode)
+{
+#ifdef CONFIG_F2FS_FS_ICE_ENCRYPTION
+	return f2fs_encrypted_inode(inode) && S_ISREG(inode->i_mode) &&
+		test_opt(F2FS_I_SB(inode), INLINECRYPT);
+#else
+	return false;
+#endif
+}
+
+static inline bool f2fs_sw_encrypted_data(struct inode *inode)
+{
+	return f2fs_encrypted_inode(inode) && S_ISREG(inode->i_mode) &&
+		!f2fs_inode_uses_ice(inode);
+}
+
 static inline bool f2fs_bio_encrypted(struct bio *bio)
 {
 #ifdef CONFIG_F2FS_FS_ENCRYPTION
@@ -2114,6 +2176,15 @@ struct page *f2fs_encrypt(struct inode *, struct page *);
 int f2fs_decrypt(struct f2fs_crypto_ctx *, struct page *);
 int f2fs_decrypt_one(struct inode *, struct page *);
 void f2fs_end_io_crypto_work(struct f2fs_crypto_ctx *, struct bio *);
+void f2fs_crypto_ctx_stats(unsigned long *);
+#ifdef CONFIG_F2FS_FS_ICE_ENCRYPTION
+bool f2fs_ice_mergeable(struct bio *, struct page *);
+#else
+static inline bool f2fs_ice_mergeable(struct bio *bio, struct page *page)
+{
+	return true;
+}
+#endif
 
 /* crypto_key.c */
 void f2fs_free_encryption_info(struct inode *, struct f2fs_crypt_info *);
@@ -2127,6 +2198,9 @@ int f2fs_fname_disk_to_usr(struct inode *, f2fs_hash_t *,
 			const struct f2fs_str *, struct f2fs_str *);
 int f2fs_fname_usr_to_disk(struct inode *, const struct qstr *,
 			struct f2fs_str *);
+struct f2fs_dname_block *f2fs_fname_get_block(struct f2fs_dentry_ptr *,
+					unsigned long, struct f2fs_str *);
+void f2fs_fname_cache_free(struct f2fs_crypt_info *);
 
 #ifdef CONFIG_F2FS_FS_ENCRYPTION
 void f2fs_restore_and_release_control_page(struct page **);
@@ -2155,6 +2229,7 @@ void f2fs_fname_crypto_free_buffer(struct f2fs_str *);
 int f2fs_fname_setup_filename(struct inode *, const struct qstr *,
 				int lookup, struct f2fs_filename *);
 void f2fs_fname_free_filename(struct f2fs_filename *);
+void f2fs_fname_cache_invalidate(struct inode *);
 #else
 static inline void f2fs_restore_and_release_control_page(struct page **p) { }
 static inline void f2fs_restore_control_page(struct page *p) { }
@@ -2178,5 +2253,6 @@ static inline int f2fs_fname_setup_filename(struct inode *dir,
 }
 
 static inline void f2fs_fname_free_filename(struct f2fs_filename *fname) { }
+static inline void f2fs_fname_cache_invalidate(struct inode *dir) { }
 #endif
 #endif
@@ -81,8 +81,31 @@ struct f2fs_crypt_info {
 	struct crypto_ablkcipher *ci_ctfm;
 	struct key	*ci_keyring_key;
 	char		ci_master_key[F2FS_KEY_DESCRIPTOR_SIZE];
+#ifdef CONFIG_F2FS_FS_ICE_ENCRYPTION
+	bool		ci_ice_key_set;	/* ci_raw_key holds the data key */
+	char		ci_raw_key[F2FS_MAX_KEY_SIZE];
+#endif
+	struct list_head ci_dname_cache;	/* decrypted dentry blocks */
+	unsigned int	ci_dname_nr;
 };
 
+/*
+ * Decrypted names of one dentry block of an encrypted directory. The name
+ * of the entry at bit_pos is stored at name[bit_pos]; a plaintext name is
+ * never longer than its ciphertext, so it fits in the slots the entry has
+ * on disk.
+ */
+struct f2fs_dname_block {
+	struct list_head list;
+	unsigned long index;		/* dentry block index, 0 if inline */
+	int max;			/* number of slots in the block */
+	u8 len[NR_DENTRY_IN_BLOCK];
+	u8 name[NR_DENTRY_IN_BLOCK][F2FS_SLOT_LEN];
+};
+
+/* Per-directory limit on cached dentry blocks, reused in LRU order */
+#define F2FS_DNAME_CACHE_BLOCKS	32
+
 #define F2FS_CTX_REQUIRES_FREE_ENCRYPT_FL             0x00000001
 #define F2FS_WRITE_PATH_FL			      0x00000002
 
@@ -98,9 +121,25 @@ struct f2fs_crypto_ctx {
 		} r;
 		struct list_head free_list;     /* Free list */
 	};
+	struct ablkcipher_request *req;  /* Reused across pages */
+	unsigned int req_size;           /* Allocated size of req */
 	char flags;                      /* Flags */
 };
 
+/*
+ * Crypto contexts are first taken from a small per-cpu stack, then from
+ * the global free list and only then from the slab.
+ */
+#define F2FS_CTX_CACHE_SIZE	8
+
+enum {
+	F2FS_CTX_HIT_LOCAL,	/* served from the per-cpu cache */
+	F2FS_CTX_HIT_GLOBAL,	/* served from the global free list */
+	F2FS_CTX_CONTENDED,	/* global free list lock was contended */
+	F2FS_CTX_ALLOC,		/* pools empty, allocated from the slab */
+	NR_F2FS_CTX_STATS,
+};
+
 struct f2fs_completion_result {
 	struct completion completion;
 	int res;
@@ -137,6 +137,19 @@ static int get_parent_ino(struct inode *inode, nid_t *pino)
 	return 1;
 }
 
+/*
+ * An atomic commit does not need its parent checkpointed as long as its
+ * own dentry is: that one was in the first checkpoint after its creation,
+ * and a rename would have lost its pino.
+ */
+static inline bool atomic_dentry_checkpointed(struct inode *inode)
+{
+	struct f2fs_sb_info *sbi = F2FS_I_SB(inode);
+
+	return is_inode_flag_set(F2FS_I(inode), FI_ATOMIC_COMMIT) &&
+		F2FS_I(inode)->created_ver != cur_cp_version(F2FS_CKPT(sbi));
+}
+
 static inline bool need_do_checkpoint(struct inode *inode)
 {
 	struct f2fs_sb_info *sbi = F2FS_I_SB(inode);
@@ -150,7 +163,8 @@ static inline bool need_do_checkpoint(struct inode *inode)
 		need_cp = true;
 	else if (!space_for_roll_forward(sbi))
 		need_cp = true;
-	else if (!is_checkpointed_node(sbi, F2FS_I(inode)->i_pino))
+	else if (!is_checkpointed_node(sbi, F2FS_I(inode)->i_pino) &&
+			!atomic_dentry_checkpointed(inode))
 		need_cp = true;
 	else if (F2FS_I(inode)->xattr_ver == cur_cp_version(F2FS_CKPT(sbi)))
 		need_cp = true;
@@ -201,6 +215,8 @@ int f2fs_sync_file(struct file *file, loff_t start, loff_t end, int datasync)
 	nid_t ino = inode->i_ino;
 	int ret = 0;
 	bool need_cp = false;
+	bool atomic = is_inode_flag_set(fi, FI_ATOMIC_COMMIT);
+	int nwritten;
 	struct writeback_control wbc = {
 		.sync_mode = WB_SYNC_ALL,
 		.nr_to_write = LONG_MAX,
@@ -257,6 +273,12 @@ go_write:
 	up_read(&fi->i_sem);
 
 	if (need_cp) {
+		if (atomic) {
+			spin_lock(&sbi->stat_lock);
+			sbi->atomic_commit_cps++;
+			spin_unlock(&sbi->stat_lock);
+		}
+
 		/* all the dirty node pages should be flushed for POR */
 		ret = f2fs_sync_fs(inode->i_sb, 1);
 
@@ -270,7 +292,12 @@ go_write:
 		goto out;
 	}
 sync_nodes:
-	sync_node_pages(sbi, ino, &wbc);
+	nwritten = sync_node_pages(sbi, ino, &wbc, atomic);
+	if (atomic) {
+		spin_lock(&sbi->stat_lock);
+		sbi->atomic_node_blocks += nwritten;
+		spin_unlock(&sbi->stat_lock);
+	}
 
 	/* if cp_error was enabled, we should avoid infinite loop */
 	if (unlikely(f2fs_cp_error(sbi)))
@@ -1414,6 +1441,8 @@ static int f2fs_ioc_start_atomic_write(struct file *filp)
 static int f2fs_ioc_commit_atomic_write(struct file *filp)
 {
 	struct inode *inode = file_inode(filp);
+	struct f2fs_sb_info *sbi = F2FS_I_SB(inode);
+	unsigned long start = jiffies;
 	int ret;
 
 	if (!inode_owner_or_capable(inode))
@@ -1427,6 +1456,8 @@ static int f2fs_ioc_commit_atomic_write(struct file *filp)
 		return ret;
 
 	if (f2fs_is_atomic_file(inode)) {
+		/* no in-place update until the commit is durable */
+		set_inode_flag(F2FS_I(inode), FI_ATOMIC_COMMIT);
 		clear_inode_flag(F2FS_I(inode), FI_ATOMIC_FILE);
 		ret = commit_inmem_pages(inode, false);
 		if (ret)
@@ -1434,7 +1465,15 @@ static int f2fs_ioc_commit_atomic_write(struct file *filp)
 	}
 
 	ret = f2fs_sync_file(filp, 0, LLONG_MAX, 0);
+
+	if (is_inode_flag_set(F2FS_I(inode), FI_ATOMIC_COMMIT)) {
+		spin_lock(&sbi->stat_lock);
+		sbi->atomic_commits++;
+		sbi->atomic_commit_time_ms += jiffies_to_msecs(jiffies - start);
+		spin_unlock(&sbi->stat_lock);
+	}
 err_out:
+	clear_inode_flag(F2FS_I(inode), FI_ATOMIC_COMMIT);
 	mnt_drop_write_file(filp);
 	return ret;
 }
@@ -1681,6 +1720,11 @@ static int f2fs_ioc_gc(struct file *filp, unsigned long arg)
 	return 0;
 }
 
+static int f2fs_ioc_precache_extents(struct file *filp)
+{
+	return f2fs_precache_extents(file_inode(filp));
+}
+
 long f2fs_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 {
 	switch (cmd) {
@@ -1712,6 +1756,8 @@ long f2fs_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 		return f2fs_ioc_get_encryption_pwsalt(filp, arg);
 	case F2FS_IOC_GARBAGE_COLLECT:
 		return f2fs_ioc_gc(filp, arg);
+	case F2FS_IOC_PRECACHE_EXTENTS:
+		return f2fs_ioc_precache_extents(filp);
 	default:
 		return -ENOTTY;
 	}
@@ -37,9 +37,14 @@ static int gc_thread_func(void *data)
 	do {
 
 		wait_event_interruptible_timeout(*wq,
-				kthread_should_stop() || freezing(current),
+				kthread_should_stop() || freezing(current) ||
+				gc_th->gc_wake,
 				msecs_to_jiffies(wait_ms));
 
+		/* give it a try one time */
+		if (gc_th->gc_wake)
+			gc_th->gc_wake = false;
+
 		if (try_to_freeze())
 			continue;
 
@@ -67,6 +72,27 @@ static int gc_thread_func(void *data)
 		if (!mutex_trylock(&sbi->gc_mutex))
 			continue;
 
+		/*
+		 * Urgent mode is requested from userspace while the system
+		 * is idle (e.g. screen off and charging). Keep collecting
+		 * with a short period whenever the device has no requests
+		 * queued, until the target number of free sections is met.
+		 */
+		if (gc_th->gc_urgent) {
+			wait_ms = gc_th->urgent_sleep_time;
+			if (!is_idle(sbi)) {
+				mutex_unlock(&sbi->gc_mutex);
+				continue;
+			}
+			if (urgent_gc_done(sbi, gc_th)) {
+				gc_th->gc_urgent = 0;
+				wait_ms = gc_th->min_sleep_time;
+				mutex_unlock(&sbi->gc_mutex);
+				continue;
+			}
+			goto do_gc;
+		}
+
 		if (!is_idle(sbi)) {
 			increase_sleep_time(gc_th, &wait_ms);
 			mutex_unlock(&sbi->gc_mutex);
@@ -77,12 +103,14 @@ static int gc_thread_func(void *data)
 			decrease_sleep_time(gc_th, &wait_ms);
 		else
 			increase_sleep_time(gc_th, &wait_ms);
-
+do_gc:
 		stat_inc_bggc_count(sbi);
 
 		/* if return value is not zero, no victim was selected */
-		if (f2fs_gc(sbi))
+		if (f2fs_gc(sbi)) {
+			gc_th->gc_urgent = 0;
 			wait_ms = gc_th->no_gc_sleep_time;
+		}
 
 		/* balancing f2fs's metadata periodically */
 		f2fs_balance_fs_bg(sbi);
@@ -109,6 +137,11 @@ int start_gc_thread(struct f2fs_sb_info *sbi)
 
 	gc_th->gc_idle = 0;
 
+	gc_th->gc_urgent = 0;
+	gc_th->urgent_sleep_time = DEF_GC_THREAD_URGENT_SLEEP_TIME;
+	gc_th->urgent_free_pct = DEF_GC_URGENT_FREE_PCT;
+	gc_th->gc_wake = false;
+
 	sbi->gc_thread = gc_th;
 	init_waitqueue_head(&sbi->gc_thread->gc_wait_queue_head);
 	sbi->gc_thread->f2fs_gc_task = kthread_run(gc_thread_func, sbi,
@@ -136,11 +169,17 @@ static int select_gc_type(struct f2fs_gc_kthread *gc_th, int gc_type)
 {
 	int gc_mode = (gc_type == BG_GC) ? GC_CB : GC_GREEDY;
 
+	/* urgent gc is about reclaiming cold sections while idle */
+	if (gc_th && gc_th->gc_urgent && gc_type == BG_GC)
+		return GC_CB;
+
 	if (gc_th && gc_th->gc_idle) {
 		if (gc_th->gc_idle == 1)
 			gc_mode = GC_CB;
 		else if (gc_th->gc_idle == 2)
 			gc_mode = GC_GREEDY;
+		else if (gc_th->gc_idle == 3 && gc_type == BG_GC)
+			gc_mode = GC_AT;
 	}
 	return gc_mode;
 }
@@ -176,7 +215,7 @@ static unsigned int get_max_cost(struct f2fs_sb_info *sbi,
 		return 1 << sbi->log_blocks_per_seg;
 	if (p->gc_mode == GC_GREEDY)
 		return (1 << sbi->log_blocks_per_seg) * p->ofs_unit;
-	else if (p->gc_mode == GC_CB)
+	else if (p->gc_mode == GC_CB || p->gc_mode == GC_AT)
 		return UINT_MAX;
 	else /* No other gc_mode */
 		return 0;
@@ -233,6 +272,53 @@ static unsigned int get_cb_cost(struct f2fs_sb_info *sbi, unsigned int segno)
 	return UINT_MAX - ((100 * (100 - u) * age) / (100 + u));
 }
 
+/*
+ * Add the section of segno to the GC_AT candidates if it is old enough and
+ * has anything to reclaim. The candidates are kept ordered by valid blocks
+ * and then by age, so that the leftmost one is the victim.
+ */
+static bool add_victim_entry(struct f2fs_sb_info *sbi, struct rb_root *root,
+			unsigned int segno, unsigned int idx)
+{
+	struct victim_entry *ve = &DIRTY_I(sbi)->victim_cand[idx];
+	struct rb_node **p = &root->rb_node, *parent = NULL;
+	unsigned int start = GET_SECNO(sbi, segno) * sbi->segs_per_sec;
+	unsigned long long mtime = 0, now = get_mtime(sbi);
+	unsigned int vblocks;
+	unsigned int i;
+
+	for (i = 0; i < sbi->segs_per_sec; i++)
+		mtime += get_seg_entry(sbi, start + i)->mtime;
+	mtime = div_u64(mtime, sbi->segs_per_sec);
+
+	if (mtime > now || now - mtime < sbi->gc_age_threshold)
+		return false;
+
+	vblocks = get_valid_blocks(sbi, segno, sbi->segs_per_sec);
+	if (vblocks >= sbi->segs_per_sec << sbi->log_blocks_per_seg)
+		return false;
+
+	ve->mtime = mtime;
+	ve->vblocks = vblocks;
+	ve->segno = segno;
+
+	while (*p) {
+		struct victim_entry *cur;
+
+		parent = *p;
+		cur = rb_entry(parent, struct victim_entry, rb_node);
+		if (vblocks < cur->vblocks ||
+		    (vblocks == cur->vblocks && mtime < cur->mtime))
+			p = &parent->rb_left;
+		else
+			p = &parent->rb_right;
+	}
+	rb_link_node(&ve->rb_node, parent, p);
+	rb_insert_color(&ve->rb_node, root);
+
+	return true;
+}
+
 static inline unsigned int get_gc_cost(struct f2fs_sb_info *sbi,
 			unsigned int segno, struct victim_sel_policy *p)
 {
@@ -261,6 +347,11 @@ static int get_victim_by_default(struct f2fs_sb_info *sbi,
 	struct victim_sel_policy p;
 	unsigned int secno, max_cost;
 	int nsearched = 0;
+	struct rb_root candidates = RB_ROOT;
+	unsigned int nr_cand = 0, max_cand;
+
+	max_cand = clamp_t(unsigned int, sbi->gc_max_candidates, 1,
+						MAX_GC_CANDIDATES);
 
 	mutex_lock(&dirty_i->seglist_lock);
 
@@ -301,6 +392,16 @@ static int get_victim_by_default(struct f2fs_sb_info *sbi,
 		if (gc_type == BG_GC && test_bit(secno, dirty_i->victim_secmap))
 			continue;
 
+		if (p.gc_mode == GC_AT) {
+			if (add_victim_entry(sbi, &candidates, segno, nr_cand))
+				nr_cand++;
+			if (nr_cand >= max_cand || nsearched++ >= p.max_search) {
+				sbi->last_victim[p.gc_mode] = segno;
+				break;
+			}
+			continue;
+		}
+
 		cost = get_gc_cost(sbi, segno, &p);
 
 		if (p.min_cost > cost) {
@@ -315,7 +416,13 @@ static int get_victim_by_default(struct f2fs_sb_info *sbi,
 			break;
 		}
 	}
+	if (p.gc_mode == GC_AT && !RB_EMPTY_ROOT(&candidates)) {
+		p.min_segno = rb_entry(rb_first(&candidates),
+					struct victim_entry, rb_node)->segno;
+		p.min_cost = max_cost;
+	}
 	if (p.min_segno != NULL_SEGNO) {
+		stat_inc_victim_count(sbi, p.gc_mode);
 got_it:
 		if (p.alloc_mode == LFS) {
 			secno = GET_SECNO(sbi, p.min_segno);
@@ -462,7 +569,7 @@ next_step:
 			.nr_to_write = LONG_MAX,
 			.for_reclaim = 0,
 		};
-		sync_node_pages(sbi, 0, &wbc);
+		sync_node_pages(sbi, 0, &wbc, false);
 
 		/* return 1 only if FG_GC succefully reclaimed one */
 		if (get_valid_blocks(sbi, segno, 1) == 0)
@@ -806,6 +913,7 @@ int f2fs_gc(struct f2fs_sb_info *sbi)
 	int gc_type = BG_GC;
 	int nfree = 0;
 	int ret = -1;
+	unsigned long start = jiffies;
 	struct cp_control cpc;
 	struct gc_inode_list gc_list = {
 		.ilist = LIST_HEAD_INIT(gc_list.ilist),
@@ -848,6 +956,10 @@ gc_more:
 	if (gc_type == FG_GC)
 		write_checkpoint(sbi, &cpc);
 stop:
+	if (gc_type == FG_GC)
+		sbi->fg_gc_time_ms += jiffies_to_msecs(jiffies - start);
+	else
+		sbi->bg_gc_time_ms += jiffies_to_msecs(jiffies - start);
 	mutex_unlock(&sbi->gc_mutex);
 
 	put_gc_inode(&gc_list);
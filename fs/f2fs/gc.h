@@ -16,6 +16,12 @@
 #define DEF_GC_THREAD_MIN_SLEEP_TIME	30000	/* milliseconds */
 #define DEF_GC_THREAD_MAX_SLEEP_TIME	60000
 #define DEF_GC_THREAD_NOGC_SLEEP_TIME	300000	/* wait 5 min */
+#define DEF_GC_THREAD_URGENT_SLEEP_TIME	100	/* milliseconds */
+#define DEF_GC_URGENT_FREE_PCT		20	/*
+						 * urgent GC stops once this
+						 * percentage of the sections
+						 * is free
+						 */
 #define LIMIT_INVALID_BLOCK	40 /* percentage over total user space */
 #define LIMIT_FREE_BLOCK	40 /* percentage over invalid + free space */
 
@@ -28,6 +34,11 @@
 /* Search max. number of dirty segments to select a victim segment */
 #define DEF_MAX_VICTIM_SEARCH 4096 /* covers 8GB */
 
+/* GC_AT ignores sections modified within this many seconds */
+#define DEF_GC_AGE_THRESHOLD	(60 * 60 * 24 * 7)	/* 7 days */
+/* GC_AT picks its victim among this many old enough sections */
+#define DEF_GC_MAX_CANDIDATES	16
+
 struct f2fs_gc_kthread {
 	struct task_struct *f2fs_gc_task;
 	wait_queue_head_t gc_wait_queue_head;
@@ -39,6 +50,12 @@ struct f2fs_gc_kthread {
 
 	/* for changing gc mode */
 	unsigned int gc_idle;
+
+	/* for urgent gc while the system is idle */
+	unsigned int gc_urgent;
+	unsigned int urgent_sleep_time;
+	unsigned int urgent_free_pct;
+	bool gc_wake;
 };
 
 struct gc_inode_list {
@@ -107,6 +124,13 @@ static inline bool has_enough_invalid_blocks(struct f2fs_sb_info *sbi)
 	return false;
 }
 
+static inline bool urgent_gc_done(struct f2fs_sb_info *sbi,
+				  struct f2fs_gc_kthread *gc_th)
+{
+	return free_sections(sbi) >=
+		div_u64((u64)MAIN_SECS(sbi) * gc_th->urgent_free_pct, 100);
+}
+
 static inline int is_idle(struct f2fs_sb_info *sbi)
 {
 	struct block_device *bdev = sbi->sb->s_bdev;
@@ -120,6 +120,7 @@ static struct inode *f2fs_new_inode(struct inode *dir, umode_t mode)
 	inode->i_blocks = 0;
 	inode->i_mtime = inode->i_atime = inode->i_ctime = CURRENT_TIME;
 	inode->i_generation = sbi->s_next_generation++;
+	F2FS_I(inode)->created_ver = cur_cp_version(F2FS_CKPT(sbi));
 
 	err = insert_inode_locked(inode);
 	if (err) {
@@ -1152,16 +1152,67 @@ void sync_inode_page(struct dnode_of_data *dn)
 	}
 }
 
+/*
+ * Returns the last dirty dnode of ino in the order fsync writes them, with
+ * a reference held, or NULL if there is none.
+ */
+static struct page *last_fsync_dnode(struct f2fs_sb_info *sbi, nid_t ino)
+{
+	pgoff_t index = 0, end = LONG_MAX;
+	struct pagevec pvec;
+	struct page *last_page = NULL;
+
+	pagevec_init(&pvec, 0);
+
+	while (index <= end) {
+		int i, nr_pages;
+		nr_pages = pagevec_lookup_tag(&pvec, NODE_MAPPING(sbi), &index,
+				PAGECACHE_TAG_DIRTY,
+				min(end - index, (pgoff_t)PAGEVEC_SIZE-1) + 1);
+		if (nr_pages == 0)
+			break;
+
+		for (i = 0; i < nr_pages; i++) {
+			struct page *page = pvec.pages[i];
+
+			if (!IS_DNODE(page) || !is_cold_node(page) ||
+					ino_of_node(page) != ino)
+				continue;
+
+			f2fs_put_page(last_page, 0);
+			get_page(page);
+			last_page = page;
+		}
+		pagevec_release(&pvec);
+		cond_resched();
+	}
+	return last_page;
+}
+
+/*
+ * With atomic set, only the last dnode written for ino gets the fsync
+ * mark. Roll-forward recovery replays the dnodes of an inode up to its
+ * last fsync mark, so an atomic commit cut short by a power loss is not
+ * recovered at all, instead of in part.
+ */
 int sync_node_pages(struct f2fs_sb_info *sbi, nid_t ino,
-					struct writeback_control *wbc)
+			struct writeback_control *wbc, bool atomic)
 {
 	pgoff_t index, end;
 	struct pagevec pvec;
 	int step = ino ? 2 : 0;
 	int nwritten = 0, wrote = 0;
+	struct page *last_page = NULL;
+	bool marked = false;
 
 	pagevec_init(&pvec, 0);
 
+	if (ino && atomic) {
+		last_page = last_fsync_dnode(sbi, ino);
+		if (!last_page)
+			atomic = false;
+	}
+
 next_step:
 	index = 0;
 	end = LONG_MAX;
@@ -1218,11 +1269,14 @@ continue_unlock:
 				goto continue_unlock;
 
 			/* called by fsync() */
-			if (ino && IS_DNODE(page)) {
+			if (ino && IS_DNODE(page) &&
+					(!atomic || page == last_page)) {
 				set_fsync_mark(page, 1);
 				if (IS_INODE(page))
 					set_dentry_mark(page,
 						need_dentry_mark(sbi, ino));
+				if (page == last_page)
+					marked = true;
 				nwritten++;
 			} else {
 				set_fsync_mark(page, 0);
@@ -1251,6 +1305,20 @@ continue_unlock:
 		goto next_step;
 	}
 
+	/* someone else wrote the last dnode without the mark, do it again */
+	if (atomic && !marked && wbc->nr_to_write) {
+		lock_page(last_page);
+		if (last_page->mapping == NODE_MAPPING(sbi)) {
+			f2fs_wait_on_page_writeback(last_page, NODE);
+			set_page_dirty(last_page);
+			unlock_page(last_page);
+			goto next_step;
+		}
+		unlock_page(last_page);
+	}
+
+	f2fs_put_page(last_page, 0);
+
 	if (wrote)
 		f2fs_submit_merged_bio(sbi, NODE, WRITE);
 	return nwritten;
@@ -1378,7 +1446,7 @@ static int f2fs_write_node_pages(struct address_space *mapping,
 
 	diff = nr_pages_to_write(sbi, NODE, wbc);
 	wbc->sync_mode = WB_SYNC_NONE;
-	sync_node_pages(sbi, 0, wbc);
+	sync_node_pages(sbi, 0, wbc, false);
 	wbc->nr_to_write = max((long)0, wbc->nr_to_write - diff);
 	return 0;
 
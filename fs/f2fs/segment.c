@@ -230,6 +230,7 @@ int commit_inmem_pages(struct inode *inode, bool abort)
 		.rw = WRITE_SYNC | REQ_PRIO,
 		.encrypted_page = NULL,
 	};
+	unsigned int nr_written = 0;
 	int err = 0;
 
 	/*
@@ -261,6 +262,7 @@ int commit_inmem_pages(struct inode *inode, bool abort)
 					unlock_page(cur->page);
 					break;
 				}
+				nr_written++;
 			}
 		} else {
 			trace_f2fs_commit_inmem_page(cur->page, INMEM_DROP);
@@ -279,6 +281,10 @@ int commit_inmem_pages(struct inode *inode, bool abort)
 		f2fs_unlock_op(sbi);
 		if (submit_bio)
 			f2fs_submit_merged_bio(sbi, DATA, WRITE);
+
+		spin_lock(&sbi->stat_lock);
+		sbi->atomic_data_blocks += nr_written;
+		spin_unlock(&sbi->stat_lock);
 	}
 	return err;
 }
@@ -296,6 +302,7 @@ void f2fs_balance_fs(struct f2fs_sb_info *sbi)
 	if (has_not_enough_free_secs(sbi, 0) &&
 			!is_sbi_flag_set(sbi, SBI_NO_GC)) {
 		mutex_lock(&sbi->gc_mutex);
+		sbi->fg_gc_blocked++;
 		f2fs_gc(sbi);
 	}
 }
@@ -123,16 +123,6 @@ enum {
 	SSR
 };
 
-/*
- * In the victim_sel_policy->gc_mode, there are two gc, aka cleaning, modes.
- * GC_CB is based on cost-benefit algorithm.
- * GC_GREEDY is based on greedy algorithm.
- */
-enum {
-	GC_CB = 0,
-	GC_GREEDY
-};
-
 /*
  * BG_GC means the background cleaning job.
  * FG_GC means the on-demand cleaning job.
@@ -145,7 +135,7 @@ enum {
 /* for a function parameter to select a victim segment */
 struct victim_sel_policy {
 	int alloc_mode;			/* LFS or SSR */
-	int gc_mode;			/* GC_CB or GC_GREEDY */
+	int gc_mode;			/* GC_CB, GC_GREEDY or GC_AT */
 	unsigned long *dirty_segmap;	/* dirty segment bitmap */
 	unsigned int max_search;	/* maximum # of segments to search */
 	unsigned int offset;		/* last scanned bitmap offset */
@@ -236,12 +226,24 @@ enum dirty_type {
 	NR_DIRTY_TYPE
 };
 
+/* victim candidate of GC_AT, ordered by valid blocks and then age */
+struct victim_entry {
+	struct rb_node rb_node;
+	unsigned long long mtime;	/* average mtime of the section */
+	unsigned int vblocks;		/* valid blocks of the section */
+	unsigned int segno;		/* first scanned segment # */
+};
+
+#define MAX_GC_CANDIDATES	64
+
 struct dirty_seglist_info {
 	const struct victim_selection *v_ops;	/* victim selction operation */
 	unsigned long *dirty_segmap[NR_DIRTY_TYPE];
 	struct mutex seglist_lock;		/* lock for segment bitmaps */
 	int nr_dirty[NR_DIRTY_TYPE];		/* # of dirty segments */
 	unsigned long *victim_secmap;		/* background GC victims */
+	/* GC_AT candidates, protected by seglist_lock */
+	struct victim_entry victim_cand[MAX_GC_CANDIDATES];
 };
 
 /* victim selection function for cleaning and SSR */
@@ -521,7 +523,8 @@ static inline bool need_inplace_update(struct inode *inode)
 	unsigned int policy = SM_I(sbi)->ipu_policy;
 
 	/* IPU can be done only for the user data */
-	if (S_ISDIR(inode->i_mode) || f2fs_is_atomic_file(inode))
+	if (S_ISDIR(inode->i_mode) || f2fs_is_atomic_file(inode) ||
+			is_inode_flag_set(F2FS_I(inode), FI_ATOMIC_COMMIT))
 		return false;
 
 	if (policy & (0x1 << F2FS_IPU_FORCE))
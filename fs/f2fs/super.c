@@ -24,6 +24,7 @@
 #include <linux/blkdev.h>
 #include <linux/f2fs_fs.h>
 #include <linux/sysfs.h>
+#include <linux/pfk.h>
 
 #include "f2fs.h"
 #include "node.h"
@@ -67,6 +68,7 @@ enum {
 	Opt_extent_cache,
 	Opt_noextent_cache,
 	Opt_noinline_data,
+	Opt_inlinecrypt,
 	Opt_err,
 };
 
@@ -91,6 +93,7 @@ static match_table_t f2fs_tokens = {
 	{Opt_extent_cache, "extent_cache"},
 	{Opt_noextent_cache, "noextent_cache"},
 	{Opt_noinline_data, "noinline_data"},
+	{Opt_inlinecrypt, "inlinecrypt"},
 	{Opt_err, NULL},
 };
 
@@ -158,6 +161,11 @@ static ssize_t f2fs_sbi_store(struct f2fs_attr *a,
 	if (ret < 0)
 		return ret;
 	*ui = t;
+
+	if (!strcmp(a->attr.name, "gc_urgent") && t && sbi->gc_thread) {
+		sbi->gc_thread->gc_wake = true;
+		wake_up_interruptible_all(&sbi->gc_thread->gc_wait_queue_head);
+	}
 	return count;
 }
 
@@ -202,10 +210,18 @@ static struct f2fs_attr f2fs_attr_##_name = {			\
 		f2fs_sbi_show, f2fs_sbi_store,			\
 		offsetof(struct struct_name, elname))
 
+#define F2FS_RO_ATTR(struct_type, struct_name, name, elname)	\
+	F2FS_ATTR_OFFSET(struct_type, name, 0444,		\
+		f2fs_sbi_show, NULL,				\
+		offsetof(struct struct_name, elname))
+
 F2FS_RW_ATTR(GC_THREAD, f2fs_gc_kthread, gc_min_sleep_time, min_sleep_time);
 F2FS_RW_ATTR(GC_THREAD, f2fs_gc_kthread, gc_max_sleep_time, max_sleep_time);
 F2FS_RW_ATTR(GC_THREAD, f2fs_gc_kthread, gc_no_gc_sleep_time, no_gc_sleep_time);
 F2FS_RW_ATTR(GC_THREAD, f2fs_gc_kthread, gc_idle, gc_idle);
+F2FS_RW_ATTR(GC_THREAD, f2fs_gc_kthread, gc_urgent, gc_urgent);
+F2FS_RW_ATTR(GC_THREAD, f2fs_gc_kthread, gc_urgent_sleep_time, urgent_sleep_time);
+F2FS_RW_ATTR(GC_THREAD, f2fs_gc_kthread, gc_urgent_free_pct, urgent_free_pct);
 F2FS_RW_ATTR(SM_INFO, f2fs_sm_info, reclaim_segments, rec_prefree_segments);
 F2FS_RW_ATTR(SM_INFO, f2fs_sm_info, max_small_discards, max_discards);
 F2FS_RW_ATTR(SM_INFO, f2fs_sm_info, batched_trim_sections, trim_sections);
@@ -214,7 +230,18 @@ F2FS_RW_ATTR(SM_INFO, f2fs_sm_info, min_ipu_util, min_ipu_util);
 F2FS_RW_ATTR(SM_INFO, f2fs_sm_info, min_fsync_blocks, min_fsync_blocks);
 F2FS_RW_ATTR(NM_INFO, f2fs_nm_info, ram_thresh, ram_thresh);
 F2FS_RW_ATTR(F2FS_SBI, f2fs_sb_info, max_victim_search, max_victim_search);
+F2FS_RW_ATTR(F2FS_SBI, f2fs_sb_info, gc_age_threshold, gc_age_threshold);
+F2FS_RW_ATTR(F2FS_SBI, f2fs_sb_info, gc_max_candidates, gc_max_candidates);
 F2FS_RW_ATTR(F2FS_SBI, f2fs_sb_info, dir_level, dir_level);
+F2FS_RO_ATTR(F2FS_SBI, f2fs_sb_info, bg_gc_time_ms, bg_gc_time_ms);
+F2FS_RO_ATTR(F2FS_SBI, f2fs_sb_info, fg_gc_time_ms, fg_gc_time_ms);
+F2FS_RO_ATTR(F2FS_SBI, f2fs_sb_info, fg_gc_blocked, fg_gc_blocked);
+F2FS_RO_ATTR(F2FS_SBI, f2fs_sb_info, atomic_commits, atomic_commits);
+F2FS_RO_ATTR(F2FS_SBI, f2fs_sb_info, atomic_commit_cps, atomic_commit_cps);
+F2FS_RO_ATTR(F2FS_SBI, f2fs_sb_info, atomic_commit_time_ms,
+						atomic_commit_time_ms);
+F2FS_RO_ATTR(F2FS_SBI, f2fs_sb_info, atomic_data_blocks, atomic_data_blocks);
+F2FS_RO_ATTR(F2FS_SBI, f2fs_sb_info, atomic_node_blocks, atomic_node_blocks);
 
 #define ATTR_LIST(name) (&f2fs_attr_##name.attr)
 static struct attribute *f2fs_attrs[] = {
@@ -222,6 +249,9 @@ static struct attribute *f2fs_attrs[] = {
 	ATTR_LIST(gc_max_sleep_time),
 	ATTR_LIST(gc_no_gc_sleep_time),
 	ATTR_LIST(gc_idle),
+	ATTR_LIST(gc_urgent),
+	ATTR_LIST(gc_urgent_sleep_time),
+	ATTR_LIST(gc_urgent_free_pct),
 	ATTR_LIST(reclaim_segments),
 	ATTR_LIST(max_small_discards),
 	ATTR_LIST(batched_trim_sections),
@@ -229,8 +259,18 @@ static struct attribute *f2fs_attrs[] = {
 	ATTR_LIST(min_ipu_util),
 	ATTR_LIST(min_fsync_blocks),
 	ATTR_LIST(max_victim_search),
+	ATTR_LIST(gc_age_threshold),
+	ATTR_LIST(gc_max_candidates),
 	ATTR_LIST(dir_level),
 	ATTR_LIST(ram_thresh),
+	ATTR_LIST(bg_gc_time_ms),
+	ATTR_LIST(fg_gc_time_ms),
+	ATTR_LIST(fg_gc_blocked),
+	ATTR_LIST(atomic_commits),
+	ATTR_LIST(atomic_commit_cps),
+	ATTR_LIST(atomic_commit_time_ms),
+	ATTR_LIST(atomic_data_blocks),
+	ATTR_LIST(atomic_node_blocks),
 	NULL,
 };
 
@@ -397,6 +437,19 @@ static int parse_options(struct super_block *sb, char *options)
 		case Opt_noinline_data:
 			clear_opt(sbi, INLINE_DATA);
 			break;
+		case Opt_inlinecrypt:
+#ifdef CONFIG_F2FS_FS_ICE_ENCRYPTION
+			if (pfk_ice_available()) {
+				set_opt(sbi, INLINECRYPT);
+				break;
+			}
+			f2fs_msg(sb, KERN_WARNING,
+				"ICE not available, using software encryption");
+#else
+			f2fs_msg(sb, KERN_INFO,
+				"inlinecrypt options not supported");
+#endif
+			break;
 		default:
 			f2fs_msg(sb, KERN_ERR,
 				"Unrecognized mount option \"%s\" or missing value",
@@ -684,6 +737,8 @@ static int f2fs_show_options(struct seq_file *seq, struct dentry *root)
 		seq_puts(seq, ",extent_cache");
 	else
 		seq_puts(seq, ",noextent_cache");
+	if (test_opt(sbi, INLINECRYPT))
+		seq_puts(seq, ",inlinecrypt");
 	seq_printf(seq, ",active_logs=%u", sbi->active_logs);
 
 	return 0;
@@ -754,6 +809,7 @@ static int f2fs_remount(struct super_block *sb, int *flags, char *data)
 	bool need_restart_gc = false;
 	bool need_stop_gc = false;
 	bool no_extent_cache = !test_opt(sbi, EXTENT_CACHE);
+	bool inlinecrypt = test_opt(sbi, INLINECRYPT);
 
 	sync_filesystem(sb);
 
@@ -772,6 +828,17 @@ static int f2fs_remount(struct super_block *sb, int *flags, char *data)
 	if (err)
 		goto restore_opts;
 
+	/*
+	 * disallow switching inlinecrypt, reads in flight have already been
+	 * set up for decryption by either the CPU or ICE
+	 */
+	if (inlinecrypt != !!test_opt(sbi, INLINECRYPT)) {
+		err = -EINVAL;
+		f2fs_msg(sbi->sb, KERN_WARNING,
+				"switch inlinecrypt option is not allowed");
+		goto restore_opts;
+	}
+
 	/*
 	 * Previous and new state of filesystem is RO,
 	 * so skip checking GC and FLUSH_MERGE conditions.
@@ -1043,6 +1110,8 @@ static void init_sb_info(struct f2fs_sb_info *sbi)
 	sbi->meta_ino_num = le32_to_cpu(raw_super->meta_ino);
 	sbi->cur_victim_sec = NULL_SECNO;
 	sbi->max_victim_search = DEF_MAX_VICTIM_SEARCH;
+	sbi->gc_age_threshold = DEF_GC_AGE_THRESHOLD;
+	sbi->gc_max_candidates = DEF_GC_MAX_CANDIDATES;
 
 	for (i = 0; i < NR_COUNT_TYPE; i++)
 		atomic_set(&sbi->nr_pages[i], 0);
@@ -196,6 +196,104 @@ static const struct file_operations fuse_conn_congestion_threshold_ops = {
 	.llseek = no_llseek,
 };
 
+static const char *const fuse_op_names[FUSE_NR_COUNTED_OPS] = {
+	[0]			= "OTHER",
+	[FUSE_LOOKUP]		= "LOOKUP",
+	[FUSE_FORGET]		= "FORGET",
+	[FUSE_GETATTR]		= "GETATTR",
+	[FUSE_SETATTR]		= "SETATTR",
+	[FUSE_READLINK]		= "READLINK",
+	[FUSE_SYMLINK]		= "SYMLINK",
+	[FUSE_MKNOD]		= "MKNOD",
+	[FUSE_MKDIR]		= "MKDIR",
+	[FUSE_UNLINK]		= "UNLINK",
+	[FUSE_RMDIR]		= "RMDIR",
+	[FUSE_RENAME]		= "RENAME",
+	[FUSE_LINK]		= "LINK",
+	[FUSE_OPEN]		= "OPEN",
+	[FUSE_READ]		= "READ",
+	[FUSE_WRITE]		= "WRITE",
+	[FUSE_STATFS]		= "STATFS",
+	[FUSE_RELEASE]		= "RELEASE",
+	[FUSE_FSYNC]		= "FSYNC",
+	[FUSE_SETXATTR]		= "SETXATTR",
+	[FUSE_GETXATTR]		= "GETXATTR",
+	[FUSE_LISTXATTR]	= "LISTXATTR",
+	[FUSE_REMOVEXATTR]	= "REMOVEXATTR",
+	[FUSE_FLUSH]		= "FLUSH",
+	[FUSE_INIT]		= "INIT",
+	[FUSE_OPENDIR]		= "OPENDIR",
+	[FUSE_READDIR]		= "READDIR",
+	[FUSE_RELEASEDIR]	= "RELEASEDIR",
+	[FUSE_FSYNCDIR]		= "FSYNCDIR",
+	[FUSE_GETLK]		= "GETLK",
+	[FUSE_SETLK]		= "SETLK",
+	[FUSE_SETLKW]		= "SETLKW",
+	[FUSE_ACCESS]		= "ACCESS",
+	[FUSE_CREATE]		= "CREATE",
+	[FUSE_INTERRUPT]	= "INTERRUPT",
+	[FUSE_BMAP]		= "BMAP",
+	[FUSE_DESTROY]		= "DESTROY",
+	[FUSE_IOCTL]		= "IOCTL",
+	[FUSE_POLL]		= "POLL",
+	[FUSE_NOTIFY_REPLY]	= "NOTIFY_REPLY",
+	[FUSE_BATCH_FORGET]	= "BATCH_FORGET",
+	[FUSE_FALLOCATE]	= "FALLOCATE",
+	[FUSE_READDIRPLUS]	= "READDIRPLUS",
+	[FUSE_RENAME2]		= "RENAME2",
+};
+
+/*
+ * One line per opcode that went to userspace at least once, queued
+ * forgets counted singly even when the daemon reads them as a batch,
+ * followed by the operations that shortcircuit kept in the kernel.
+ */
+static ssize_t fuse_conn_round_trips_read(struct file *file, char __user *buf,
+					  size_t len, loff_t *ppos)
+{
+	struct fuse_conn *fc;
+	char *tmp;
+	size_t size = 0;
+	ssize_t ret;
+	int i;
+
+	fc = fuse_ctl_file_conn_get(file);
+	if (!fc)
+		return 0;
+
+	tmp = (char *)__get_free_page(GFP_KERNEL);
+	if (!tmp) {
+		fuse_conn_put(fc);
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < FUSE_NR_COUNTED_OPS; i++) {
+		unsigned int count = atomic_read(&fc->req_count[i]);
+
+		if (count && fuse_op_names[i])
+			size += scnprintf(tmp + size, PAGE_SIZE - size,
+					  "%s %u\n", fuse_op_names[i], count);
+	}
+	size += scnprintf(tmp + size, PAGE_SIZE - size,
+			  "shortcircuit_read %u\nshortcircuit_write %u\n"
+			  "shortcircuit_mmap %u\nshortcircuit_getattr %u\n",
+			  atomic_read(&fc->sc_reads),
+			  atomic_read(&fc->sc_writes),
+			  atomic_read(&fc->sc_mmaps),
+			  atomic_read(&fc->sc_getattrs));
+	fuse_conn_put(fc);
+
+	ret = simple_read_from_buffer(buf, len, ppos, tmp, size);
+	free_page((unsigned long)tmp);
+	return ret;
+}
+
+static const struct file_operations fuse_conn_round_trips_ops = {
+	.open = nonseekable_open,
+	.read = fuse_conn_round_trips_read,
+	.llseek = no_llseek,
+};
+
 static struct dentry *fuse_ctl_add_dentry(struct dentry *parent,
 					  struct fuse_conn *fc,
 					  const char *name,
@@ -260,7 +358,9 @@ int fuse_ctl_add_conn(struct fuse_conn *fc)
 				 1, NULL, &fuse_conn_max_background_ops) ||
 	    !fuse_ctl_add_dentry(parent, fc, "congestion_threshold",
 				 S_IFREG | 0600, 1, NULL,
-				 &fuse_conn_congestion_threshold_ops))
+				 &fuse_conn_congestion_threshold_ops) ||
+	    !fuse_ctl_add_dentry(parent, fc, "round_trips", S_IFREG | 0400, 1,
+				 NULL, &fuse_conn_round_trips_ops))
 		goto err;
 
 	return 0;
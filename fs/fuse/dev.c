@@ -31,11 +31,14 @@ static struct kmem_cache *fuse_req_cachep;
 
 static struct fuse_conn *fuse_get_conn(struct file *file)
 {
+	struct fuse_dev *fud = file->private_data;
+
 	/*
 	 * Lockless access is OK, because file->private data is set
-	 * once during mount and is valid until the file is released.
+	 * once during mount or clone and is valid until the file is
+	 * released.
 	 */
-	return file->private_data;
+	return fud ? fud->fc : NULL;
 }
 
 static void fuse_request_init(struct fuse_req *req, struct page **pages,
@@ -312,17 +315,42 @@ static u64 fuse_get_unique(struct fuse_conn *fc)
 	return fc->reqctr;
 }
 
+static void fuse_count_request(struct fuse_conn *fc, u32 opcode)
+{
+	if (opcode >= FUSE_NR_COUNTED_OPS)
+		opcode = 0;
+	atomic_inc(&fc->req_count[opcode]);
+}
+
+/*
+ * The queue of the current CPU, if a device is bound to it.  Called
+ * with fc->lock held, so the CPU cannot change under us.
+ */
+static struct fuse_cpu_queue *fuse_cpu_queue(struct fuse_conn *fc)
+{
+	struct fuse_cpu_queue *q;
+
+	if (!fc->cpu_queues)
+		return NULL;
+
+	q = this_cpu_ptr(fc->cpu_queues);
+	return q->nr_devs ? q : NULL;
+}
+
 static void queue_request(struct fuse_conn *fc, struct fuse_req *req)
 {
+	struct fuse_cpu_queue *q = fuse_cpu_queue(fc);
+
+	fuse_count_request(fc, req->in.h.opcode);
 	req->in.h.len = sizeof(struct fuse_in_header) +
 		len_args(req->in.numargs, (struct fuse_arg *) req->in.args);
-	list_add_tail(&req->list, &fc->pending);
+	list_add_tail(&req->list, q ? &q->pending : &fc->pending);
 	req->state = FUSE_REQ_PENDING;
 	if (!req->waiting) {
 		req->waiting = 1;
 		atomic_inc(&fc->num_waiting);
 	}
-	wake_up(&fc->waitq);
+	wake_up(q ? &q->waitq : &fc->waitq);
 	kill_fasync(&fc->fasync, SIGIO, POLL_IN);
 }
 
@@ -334,6 +362,7 @@ void fuse_queue_forget(struct fuse_conn *fc, struct fuse_forget_link *forget,
 
 	spin_lock(&fc->lock);
 	if (fc->connected) {
+		fuse_count_request(fc, FUSE_FORGET);
 		fc->forget_list_tail->next = forget;
 		fc->forget_list_tail = forget;
 		wake_up(&fc->waitq);
@@ -1009,21 +1038,36 @@ static int forget_pending(struct fuse_conn *fc)
 	return fc->forget_list_head.next != NULL;
 }
 
-static int request_pending(struct fuse_conn *fc)
+/* The queue a device reads first, called with fc->lock held */
+static struct fuse_cpu_queue *fuse_dev_queue(struct fuse_dev *fud)
+{
+	if (fud->cpu < 0)
+		return NULL;
+
+	return per_cpu_ptr(fud->fc->cpu_queues, fud->cpu);
+}
+
+static int request_pending(struct fuse_conn *fc, struct fuse_cpu_queue *q)
 {
 	return !list_empty(&fc->pending) || !list_empty(&fc->interrupts) ||
-		forget_pending(fc);
+		forget_pending(fc) || (q && !list_empty(&q->pending));
 }
 
-/* Wait until a request is available on the pending list */
-static void request_wait(struct fuse_conn *fc)
+/*
+ * Wait until a request is available on the pending list, or on the list
+ * of the CPU the device is bound to
+ */
+static void request_wait(struct fuse_conn *fc, struct fuse_cpu_queue *q)
 __releases(fc->lock)
 __acquires(fc->lock)
 {
 	DECLARE_WAITQUEUE(wait, current);
+	DECLARE_WAITQUEUE(cpu_wait, current);
 
 	add_wait_queue_exclusive(&fc->waitq, &wait);
-	while (fc->connected && !request_pending(fc)) {
+	if (q)
+		add_wait_queue_exclusive(&q->waitq, &cpu_wait);
+	while (fc->connected && !request_pending(fc, q)) {
 		set_current_state(TASK_INTERRUPTIBLE);
 		if (signal_pending(current))
 			break;
@@ -1033,6 +1077,8 @@ __acquires(fc->lock)
 		spin_lock(&fc->lock);
 	}
 	set_current_state(TASK_RUNNING);
+	if (q)
+		remove_wait_queue(&q->waitq, &cpu_wait);
 	remove_wait_queue(&fc->waitq, &wait);
 }
 
@@ -1203,21 +1249,24 @@ static ssize_t fuse_dev_do_read(struct fuse_conn *fc, struct file *file,
 	int err;
 	struct fuse_req *req;
 	struct fuse_in *in;
+	struct fuse_cpu_queue *q;
+	struct list_head *pending;
 	unsigned reqsize;
 
  restart:
 	spin_lock(&fc->lock);
+	q = fuse_dev_queue(file->private_data);
 	err = -EAGAIN;
 	if ((file->f_flags & O_NONBLOCK) && fc->connected &&
-	    !request_pending(fc))
+	    !request_pending(fc, q))
 		goto err_unlock;
 
-	request_wait(fc);
+	request_wait(fc, q);
 	err = -ENODEV;
 	if (!fc->connected)
 		goto err_unlock;
 	err = -ERESTARTSYS;
-	if (!request_pending(fc))
+	if (!request_pending(fc, q))
 		goto err_unlock;
 
 	if (!list_empty(&fc->interrupts)) {
@@ -1226,15 +1275,20 @@ static ssize_t fuse_dev_do_read(struct fuse_conn *fc, struct file *file,
 		return fuse_read_interrupt(fc, cs, nbytes, req);
 	}
 
+	/* the CPU bound to goes first, then whatever is left to anybody */
+	pending = &fc->pending;
+	if (q && !list_empty(&q->pending))
+		pending = &q->pending;
+
 	if (forget_pending(fc)) {
-		if (list_empty(&fc->pending) || fc->forget_batch-- > 0)
+		if (list_empty(pending) || fc->forget_batch-- > 0)
 			return fuse_read_forget(fc, cs, nbytes);
 
 		if (fc->forget_batch <= -8)
 			fc->forget_batch = 16;
 	}
 
-	req = list_entry(fc->pending.next, struct fuse_req, list);
+	req = list_entry(pending->next, struct fuse_req, list);
 	req->state = FUSE_REQ_READING;
 	list_move(&req->list, &fc->io);
 
@@ -1993,15 +2047,22 @@ static unsigned fuse_dev_poll(struct file *file, poll_table *wait)
 {
 	unsigned mask = POLLOUT | POLLWRNORM;
 	struct fuse_conn *fc = fuse_get_conn(file);
+	struct fuse_cpu_queue *q;
 	if (!fc)
 		return POLLERR;
 
+	spin_lock(&fc->lock);
+	q = fuse_dev_queue(file->private_data);
+	spin_unlock(&fc->lock);
+
 	poll_wait(file, &fc->waitq, wait);
+	if (q)
+		poll_wait(file, &q->waitq, wait);
 
 	spin_lock(&fc->lock);
 	if (!fc->connected)
 		mask = POLLERR;
-	else if (request_pending(fc))
+	else if (request_pending(fc, q))
 		mask |= POLLIN | POLLRDNORM;
 	spin_unlock(&fc->lock);
 
@@ -2067,9 +2128,16 @@ static void end_queued_requests(struct fuse_conn *fc)
 __releases(fc->lock)
 __acquires(fc->lock)
 {
+	int cpu;
+
 	fc->max_background = UINT_MAX;
 	flush_bg_queue(fc);
 	end_requests(fc, &fc->pending);
+	if (fc->cpu_queues) {
+		for_each_possible_cpu(cpu)
+			end_requests(fc,
+				&per_cpu_ptr(fc->cpu_queues, cpu)->pending);
+	}
 	end_requests(fc, &fc->processing);
 	while (forget_pending(fc))
 		kfree(dequeue_forget(fc, 1, NULL));
@@ -2120,6 +2188,13 @@ void fuse_abort_conn(struct fuse_conn *fc)
 		end_queued_requests(fc);
 		end_polls(fc);
 		wake_up_all(&fc->waitq);
+		if (fc->cpu_queues) {
+			int cpu;
+
+			for_each_possible_cpu(cpu)
+				wake_up_all(&per_cpu_ptr(fc->cpu_queues,
+							 cpu)->waitq);
+		}
 		wake_up_all(&fc->blocked_waitq);
 		kill_fasync(&fc->fasync, SIGIO, POLL_IN);
 	}
@@ -2127,25 +2202,167 @@ void fuse_abort_conn(struct fuse_conn *fc)
 }
 EXPORT_SYMBOL_GPL(fuse_abort_conn);
 
+struct fuse_dev *fuse_dev_alloc(struct fuse_conn *fc)
+{
+	struct fuse_dev *fud;
+
+	fud = kzalloc(sizeof(struct fuse_dev), GFP_KERNEL);
+	if (fud) {
+		fud->fc = fuse_conn_get(fc);
+		fud->cpu = -1;
+
+		spin_lock(&fc->lock);
+		fc->nr_devs++;
+		spin_unlock(&fc->lock);
+	}
+
+	return fud;
+}
+EXPORT_SYMBOL_GPL(fuse_dev_alloc);
+
+void fuse_dev_free(struct fuse_dev *fud)
+{
+	fuse_conn_put(fud->fc);
+	kfree(fud);
+}
+EXPORT_SYMBOL_GPL(fuse_dev_free);
+
+/*
+ * The connection goes away with the last of its devices.  Requests
+ * still queued on the CPU of a device going away before that are left
+ * to the other devices, bound or not.
+ */
 int fuse_dev_release(struct inode *inode, struct file *file)
 {
-	struct fuse_conn *fc = fuse_get_conn(file);
-	if (fc) {
+	struct fuse_dev *fud = file->private_data;
+
+	if (fud) {
+		struct fuse_conn *fc = fud->fc;
+		struct fuse_cpu_queue *q;
+
 		spin_lock(&fc->lock);
-		fc->connected = 0;
-		fc->blocked = 0;
-		fc->initialized = 1;
-		end_queued_requests(fc);
-		end_polls(fc);
-		wake_up_all(&fc->blocked_waitq);
+		q = fuse_dev_queue(fud);
+		if (q && !--q->nr_devs) {
+			list_splice_tail_init(&q->pending, &fc->pending);
+			wake_up_all(&fc->waitq);
+		}
+		if (!--fc->nr_devs) {
+			fc->connected = 0;
+			fc->blocked = 0;
+			fc->initialized = 1;
+			end_queued_requests(fc);
+			end_polls(fc);
+			wake_up_all(&fc->blocked_waitq);
+		}
 		spin_unlock(&fc->lock);
-		fuse_conn_put(fc);
+		fuse_dev_free(fud);
 	}
 
 	return 0;
 }
 EXPORT_SYMBOL_GPL(fuse_dev_release);
 
+static int fuse_dev_clone(struct file *file, u32 __user *argp)
+{
+	struct fuse_conn *fc;
+	struct fuse_dev *fud;
+	struct file *old;
+	u32 oldfd;
+	int err;
+
+	if (get_user(oldfd, argp))
+		return -EFAULT;
+
+	old = fget(oldfd);
+	if (!old)
+		return -EINVAL;
+
+	/* CUSE channels share the ioctl, but cannot be cloned */
+	err = -EINVAL;
+	if (old->f_op != &fuse_dev_operations ||
+	    file->f_op != &fuse_dev_operations)
+		goto out_fput;
+
+	mutex_lock(&fuse_mutex);
+	fc = fuse_get_conn(old);
+	if (fc && !file->private_data) {
+		err = -ENOMEM;
+		fud = fuse_dev_alloc(fc);
+		if (fud) {
+			file->private_data = fud;
+			err = 0;
+		}
+	}
+	mutex_unlock(&fuse_mutex);
+
+ out_fput:
+	fput(old);
+	return err;
+}
+
+static int fuse_dev_bind_cpu(struct file *file, u32 __user *argp)
+{
+	struct fuse_dev *fud = file->private_data;
+	struct fuse_cpu_queue __percpu *queues = NULL;
+	struct fuse_conn *fc;
+	u32 cpu;
+	int i, err;
+
+	if (!fud)
+		return -EPERM;
+
+	if (get_user(cpu, argp))
+		return -EFAULT;
+
+	if (cpu >= nr_cpu_ids || !cpu_possible(cpu))
+		return -EINVAL;
+
+	fc = fud->fc;
+	if (!ACCESS_ONCE(fc->cpu_queues)) {
+		queues = alloc_percpu(struct fuse_cpu_queue);
+		if (!queues)
+			return -ENOMEM;
+
+		for_each_possible_cpu(i) {
+			struct fuse_cpu_queue *q = per_cpu_ptr(queues, i);
+
+			INIT_LIST_HEAD(&q->pending);
+			init_waitqueue_head(&q->waitq);
+		}
+	}
+
+	spin_lock(&fc->lock);
+	if (!fc->cpu_queues && queues) {
+		fc->cpu_queues = queues;
+		queues = NULL;
+	}
+	err = -EBUSY;
+	if (fud->cpu < 0) {
+		fud->cpu = cpu;
+		per_cpu_ptr(fc->cpu_queues, cpu)->nr_devs++;
+		err = 0;
+	}
+	spin_unlock(&fc->lock);
+
+	free_percpu(queues);
+	return err;
+}
+
+static long fuse_dev_ioctl(struct file *file, unsigned int cmd,
+			   unsigned long arg)
+{
+	switch (cmd) {
+	case FUSE_DEV_IOC_CLONE:
+		return fuse_dev_clone(file, (u32 __user *)arg);
+
+	case FUSE_DEV_IOC_BIND_CPU:
+		return fuse_dev_bind_cpu(file, (u32 __user *)arg);
+
+	default:
+		return -ENOTTY;
+	}
+}
+
 static int fuse_dev_fasync(int fd, struct file *file, int on)
 {
 	struct fuse_conn *fc = fuse_get_conn(file);
@@ -2168,6 +2385,8 @@ const struct file_operations fuse_dev_operations = {
 	.poll		= fuse_dev_poll,
 	.release	= fuse_dev_release,
 	.fasync		= fuse_dev_fasync,
+	.unlocked_ioctl	= fuse_dev_ioctl,
+	.compat_ioctl	= fuse_dev_ioctl,
 };
 EXPORT_SYMBOL_GPL(fuse_dev_operations);
 
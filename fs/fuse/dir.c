@@ -7,6 +7,7 @@
 */
 
 #include "fuse_i.h"
+#include "fuse_shortcircuit.h"
 
 #include <linux/pagemap.h>
 #include <linux/file.h>
@@ -1031,17 +1032,18 @@ int fuse_update_attributes(struct inode *inode, struct kstat *stat,
 	int err;
 	bool r;
 
+	r = false;
+	err = 0;
 	if (time_before64(fi->i_time, get_jiffies_64())) {
-		r = true;
-		err = fuse_do_getattr(inode, stat, file);
-	} else {
-		r = false;
-		err = 0;
-		if (stat) {
-			generic_fillattr(inode, stat);
-			stat->mode = fi->orig_i_mode;
-			stat->ino = fi->orig_ino;
+		/* not refreshed as such, the mode comes from the cache */
+		if (!fuse_shortcircuit_getattr(inode, stat)) {
+			r = true;
+			err = fuse_do_getattr(inode, stat, file);
 		}
+	} else if (stat) {
+		generic_fillattr(inode, stat);
+		stat->mode = fi->orig_i_mode;
+		stat->ino = fi->orig_ino;
 	}
 
 	if (refreshed != NULL)
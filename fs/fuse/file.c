@@ -239,6 +239,8 @@ void fuse_finish_open(struct inode *inode, struct file *file)
 	}
 	if ((file->f_mode & FMODE_WRITE) && fc->writeback_cache)
 		fuse_link_write_file(file);
+	if (ff->shortcircuit_enabled && ff->rw_lower_file)
+		fuse_shortcircuit_attach(inode, ff);
 }
 
 int fuse_open_common(struct inode *inode, struct file *file, bool isdir)
@@ -299,7 +301,7 @@ void fuse_release_common(struct file *file, int opcode)
 	if (unlikely(!ff))
 		return;
 
-	fuse_shortcircuit_release(ff);
+	fuse_shortcircuit_release(file_inode(file), ff);
 
 	req = ff->reserved_req;
 	fuse_prepare_release(ff, file->f_flags, opcode);
@@ -2201,8 +2203,16 @@ static const struct vm_operations_struct fuse_file_vm_ops = {
 static int fuse_file_mmap(struct file *file, struct vm_area_struct *vma)
 {
 	struct fuse_file *ff = file->private_data;
+	struct file *lower_file = ff->rw_lower_file;
+
+	if (ff->shortcircuit_enabled && lower_file &&
+	    lower_file->f_op->mmap &&
+	    (!(vma->vm_flags & VM_SHARED) || !(vma->vm_flags & VM_MAYWRITE) ||
+	     (lower_file->f_mode & FMODE_WRITE)))
+		return fuse_shortcircuit_mmap(file, vma);
 
 	ff->shortcircuit_enabled = 0;
+	fuse_shortcircuit_detach(file_inode(file), ff);
 	if ((vma->vm_flags & VM_SHARED) && (vma->vm_flags & VM_MAYWRITE))
 		fuse_link_write_file(file);
 
@@ -2216,6 +2226,7 @@ static int fuse_direct_mmap(struct file *file, struct vm_area_struct *vma)
 	struct fuse_file *ff = file->private_data;
 
 	ff->shortcircuit_enabled = 0;
+	fuse_shortcircuit_detach(file_inode(file), ff);
 
 	/* Can't provide the coherency needed for MAP_SHARED */
 	if (vma->vm_flags & VM_MAYSHARE)
@@ -33,7 +33,10 @@
 #define FUSE_NAME_MAX 1024
 
 /** Number of dentries for each connection in the control filesystem */
-#define FUSE_CTL_NUM_DENTRIES 5
+#define FUSE_CTL_NUM_DENTRIES 6
+
+/** Opcodes counted individually in fuse_conn->req_count, 0 is "other" */
+#define FUSE_NR_COUNTED_OPS (FUSE_RENAME2 + 1)
 
 /** If the FUSE_DEFAULT_PERMISSIONS flag is given, the filesystem
     module will check permissions based on the file mode.  Otherwise no
@@ -109,6 +112,13 @@ struct fuse_inode {
 
 	/** Miscellaneous bits describing inode state */
 	unsigned long state;
+
+	/** Lower inode of the shortcircuit opens, standing in for
+	    FUSE_GETATTR.  Protected by fc->lock */
+	struct inode *sc_lower_inode;
+
+	/** Number of open files attached to sc_lower_inode */
+	int sc_count;
 };
 
 /** FUSE inode state bits */
@@ -161,6 +171,9 @@ struct fuse_file {
 	/* the read write file */
 	struct file *rw_lower_file;
 	bool shortcircuit_enabled;
+
+	/* counted in fuse_inode->sc_count */
+	bool sc_attached;
 };
 
 /** One input argument of a request */
@@ -374,6 +387,35 @@ struct fuse_req {
 	struct file *private_lower_rw_file;
 };
 
+/**
+ * Requests queued on a CPU while a device is bound to that CPU
+ *
+ * They are read through the bound devices only, so the daemon threads
+ * serving different CPUs neither wake nor compete with each other.
+ */
+struct fuse_cpu_queue {
+	/** The list of pending requests */
+	struct list_head pending;
+
+	/** Readers of the bound devices are waiting on this */
+	wait_queue_head_t waitq;
+
+	/** Number of devices bound to this CPU */
+	int nr_devs;
+};
+
+/**
+ * An open /dev/fuse file: the one the connection was set up with, or a
+ * clone of it made with FUSE_DEV_IOC_CLONE
+ */
+struct fuse_dev {
+	/** The connection, referenced for the lifetime of the device */
+	struct fuse_conn *fc;
+
+	/** CPU whose requests are read first, or -1 if unbound */
+	int cpu;
+};
+
 /**
  * A Fuse connection.
  *
@@ -408,9 +450,15 @@ struct fuse_conn {
 	/** Readers of the connection are waiting on this */
 	wait_queue_head_t waitq;
 
-	/** The list of pending requests */
+	/** The list of pending requests not queued per CPU */
 	struct list_head pending;
 
+	/** Per-CPU request queues, allocated on the first bind */
+	struct fuse_cpu_queue __percpu *cpu_queues;
+
+	/** Number of open devices.  Protected by fc->lock */
+	int nr_devs;
+
 	/** The list of requests being processed */
 	struct list_head processing;
 
@@ -611,6 +659,15 @@ struct fuse_conn {
 
 	/** Read/write semaphore to hold when accessing sb. */
 	struct rw_semaphore killsb;
+
+	/** Requests sent to userspace, by opcode */
+	atomic_t req_count[FUSE_NR_COUNTED_OPS];
+
+	/** Operations served by shortcircuit without a round-trip */
+	atomic_t sc_reads;
+	atomic_t sc_writes;
+	atomic_t sc_mmaps;
+	atomic_t sc_getattrs;
 };
 
 static inline struct fuse_conn *get_fuse_conn_super(struct super_block *sb)
@@ -636,6 +693,16 @@ static inline u64 get_node_id(struct inode *inode)
 /** Device operations */
 extern const struct file_operations fuse_dev_operations;
 
+/**
+ * Allocate a device for the connection, taking a reference on it
+ */
+struct fuse_dev *fuse_dev_alloc(struct fuse_conn *fc);
+
+/**
+ * Free a device and put its reference on the connection
+ */
+void fuse_dev_free(struct fuse_dev *fud);
+
 extern const struct dentry_operations fuse_dentry_operations;
 
 /**
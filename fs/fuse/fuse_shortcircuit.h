@@ -26,6 +26,14 @@ ssize_t fuse_shortcircuit_read_iter(struct kiocb *iocb, struct iov_iter *to);
 
 ssize_t fuse_shortcircuit_write_iter(struct kiocb *iocb, struct iov_iter *from);
 
-void fuse_shortcircuit_release(struct fuse_file *ff);
+int fuse_shortcircuit_mmap(struct file *file, struct vm_area_struct *vma);
+
+void fuse_shortcircuit_attach(struct inode *inode, struct fuse_file *ff);
+
+void fuse_shortcircuit_detach(struct inode *inode, struct fuse_file *ff);
+
+bool fuse_shortcircuit_getattr(struct inode *inode, struct kstat *stat);
+
+void fuse_shortcircuit_release(struct inode *inode, struct fuse_file *ff);
 
 #endif /* _FS_FUSE_SHORCIRCUIT_H */
@@ -77,6 +77,7 @@ static ssize_t fuse_shortcircuit_read_write_iter(struct kiocb *iocb,
 		ret_val = lower_file->f_op->write_iter(iocb, iter);
 
 		if (ret_val >= 0 || ret_val == -EIOCBQUEUED) {
+			atomic_inc(&fc->sc_writes);
 			spin_lock(&fc->lock);
 			fsstack_copy_inode_size(fuse_inode, lower_inode);
 			spin_unlock(&fc->lock);
@@ -86,8 +87,10 @@ static ssize_t fuse_shortcircuit_read_write_iter(struct kiocb *iocb,
 		if (!lower_file->f_op->read_iter)
 			return -EIO;
 		ret_val = lower_file->f_op->read_iter(iocb, iter);
-		if (ret_val >= 0 || ret_val == -EIOCBQUEUED)
+		if (ret_val >= 0 || ret_val == -EIOCBQUEUED) {
+			atomic_inc(&fc->sc_reads);
 			fsstack_copy_attr_atime(fuse_inode, lower_inode);
+		}
 	}
 
 	iocb->ki_filp = fuse_file;
@@ -107,11 +110,106 @@ ssize_t fuse_shortcircuit_write_iter(struct kiocb *iocb, struct iov_iter *from)
 	return fuse_shortcircuit_read_write_iter(iocb, from, 1);
 }
 
-void fuse_shortcircuit_release(struct fuse_file *ff)
+/*
+ * The vma is handed over to the lower file, so that faults are served
+ * from its page cache like the shortcircuit reads and writes are, and
+ * the FUSE page cache is never populated for this file.
+ */
+int fuse_shortcircuit_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct fuse_file *ff = file->private_data;
+	struct file *lower_file = ff->rw_lower_file;
+	int ret_val;
+
+	if (WARN_ON(vma->vm_file != file))
+		return -EIO;
+
+	vma->vm_file = get_file(lower_file);
+	ret_val = lower_file->f_op->mmap(lower_file, vma);
+	if (ret_val) {
+		/* mmap_region() drops the reference of the file it passed */
+		vma->vm_file = file;
+		fput(lower_file);
+		return ret_val;
+	}
+	fput(file);
+
+	atomic_inc(&ff->fc->sc_mmaps);
+	file_accessed(file);
+	return 0;
+}
+
+/*
+ * The daemon handing out the lower file on open is taken as a lease on
+ * the size and times of the inode: for as long as a shortcircuit file is
+ * open, they are refreshed from the lower inode rather than by a
+ * FUSE_GETATTR. Ownership and mode are derived by the daemon and stay
+ * as it last reported them.
+ */
+void fuse_shortcircuit_attach(struct inode *inode, struct fuse_file *ff)
+{
+	struct fuse_conn *fc = get_fuse_conn(inode);
+	struct fuse_inode *fi = get_fuse_inode(inode);
+	struct inode *lower_inode = file_inode(ff->rw_lower_file);
+
+	spin_lock(&fc->lock);
+	if (!fi->sc_lower_inode)
+		fi->sc_lower_inode = lower_inode;
+	/* pinned by the lower files of all the attached opens */
+	if (fi->sc_lower_inode == lower_inode) {
+		fi->sc_count++;
+		ff->sc_attached = true;
+	}
+	spin_unlock(&fc->lock);
+}
+
+void fuse_shortcircuit_detach(struct inode *inode, struct fuse_file *ff)
+{
+	struct fuse_conn *fc = get_fuse_conn(inode);
+	struct fuse_inode *fi = get_fuse_inode(inode);
+
+	if (!ff->sc_attached)
+		return;
+
+	spin_lock(&fc->lock);
+	ff->sc_attached = false;
+	if (!--fi->sc_count)
+		fi->sc_lower_inode = NULL;
+	spin_unlock(&fc->lock);
+}
+
+bool fuse_shortcircuit_getattr(struct inode *inode, struct kstat *stat)
+{
+	struct fuse_conn *fc = get_fuse_conn(inode);
+	struct fuse_inode *fi = get_fuse_inode(inode);
+	struct inode *lower_inode;
+
+	spin_lock(&fc->lock);
+	lower_inode = fi->sc_lower_inode;
+	if (!lower_inode) {
+		spin_unlock(&fc->lock);
+		return false;
+	}
+	fsstack_copy_inode_size(inode, lower_inode);
+	fsstack_copy_attr_times(inode, lower_inode);
+	spin_unlock(&fc->lock);
+
+	atomic_inc(&fc->sc_getattrs);
+	if (stat) {
+		generic_fillattr(inode, stat);
+		stat->mode = fi->orig_i_mode;
+		stat->ino = fi->orig_ino;
+	}
+	return true;
+}
+
+void fuse_shortcircuit_release(struct inode *inode, struct fuse_file *ff)
 {
 	if (!(ff->rw_lower_file))
 		return;
 
+	fuse_shortcircuit_detach(inode, ff);
+
 	/* Release the lower file. */
 	fput(ff->rw_lower_file);
 	ff->rw_lower_file = NULL;
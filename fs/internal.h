@@ -140,6 +140,7 @@ extern struct dentry *__d_alloc(struct super_block *, const struct qstr *);
 extern int d_set_mounted(struct dentry *dentry);
 extern long prune_dcache_sb(struct super_block *sb, unsigned long nr_to_scan,
 			    int nid);
+extern void d_count_rcu_fallback(bool restart);
 
 /*
  * read_write.c
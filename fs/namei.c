@@ -548,6 +548,8 @@ static int unlazy_walk(struct nameidata *nd, struct dentry *dentry)
 
 	BUG_ON(!(nd->flags & LOOKUP_RCU));
 
+	d_count_rcu_fallback(false);
+
 	/*
 	 * After legitimizing the bastards, terminate_walk()
 	 * will do the right thing for non-RCU mode, and all our
@@ -2050,8 +2052,10 @@ static int filename_lookup(int dfd, struct filename *name,
 				unsigned int flags, struct nameidata *nd)
 {
 	int retval = path_lookupat(dfd, name->name, flags | LOOKUP_RCU, nd);
-	if (unlikely(retval == -ECHILD))
+	if (unlikely(retval == -ECHILD)) {
+		d_count_rcu_fallback(true);
 		retval = path_lookupat(dfd, name->name, flags, nd);
+	}
 	if (unlikely(retval == -ESTALE))
 		retval = path_lookupat(dfd, name->name,
 						flags | LOOKUP_REVAL, nd);
@@ -2398,8 +2402,10 @@ filename_mountpoint(int dfd, struct filename *s, struct path *path,
 			unsigned int flags)
 {
 	int error = path_mountpoint(dfd, s->name, path, flags | LOOKUP_RCU);
-	if (unlikely(error == -ECHILD))
+	if (unlikely(error == -ECHILD)) {
+		d_count_rcu_fallback(true);
 		error = path_mountpoint(dfd, s->name, path, flags);
+	}
 	if (unlikely(error == -ESTALE))
 		error = path_mountpoint(dfd, s->name, path, flags | LOOKUP_REVAL);
 	if (likely(!error))
@@ -3327,8 +3333,10 @@ struct file *do_filp_open(int dfd, struct filename *pathname,
 	struct file *filp;
 
 	filp = path_openat(dfd, pathname, &nd, op, flags | LOOKUP_RCU);
-	if (unlikely(filp == ERR_PTR(-ECHILD)))
+	if (unlikely(filp == ERR_PTR(-ECHILD))) {
+		d_count_rcu_fallback(true);
 		filp = path_openat(dfd, pathname, &nd, op, flags);
+	}
 	if (unlikely(filp == ERR_PTR(-ESTALE)))
 		filp = path_openat(dfd, pathname, &nd, op, flags | LOOKUP_REVAL);
 	return filp;
@@ -3349,8 +3357,10 @@ struct file *do_file_open_root(struct dentry *dentry, struct vfsmount *mnt,
 		return ERR_PTR(-ELOOP);
 
 	file = path_openat(-1, &filename, &nd, op, flags | LOOKUP_RCU);
-	if (unlikely(file == ERR_PTR(-ECHILD)))
+	if (unlikely(file == ERR_PTR(-ECHILD))) {
+		d_count_rcu_fallback(true);
 		file = path_openat(-1, &filename, &nd, op, flags);
+	}
 	if (unlikely(file == ERR_PTR(-ESTALE)))
 		file = path_openat(-1, &filename, &nd, op, flags | LOOKUP_REVAL);
 	return file;
@@ -24,6 +24,7 @@
 #include <linux/magic.h>
 #include <linux/bootmem.h>
 #include <linux/task_work.h>
+#include <soc/qcom/boot_timeline.h>
 #include "pnode.h"
 #include "internal.h"
 
@@ -2337,7 +2338,8 @@ static int do_new_mount(struct path *path, const char *fstype, int flags,
 	struct file_system_type *type;
 	struct user_namespace *user_ns = current->nsproxy->mnt_ns->user_ns;
 	struct vfsmount *mnt;
-	int err;
+	char tl_name[32];
+	int err, tl_id;
 
 	if (!fstype)
 		return -EINVAL;
@@ -2366,7 +2368,11 @@ static int do_new_mount(struct path *path, const char *fstype, int flags,
 		}
 	}
 
+	snprintf(tl_name, sizeof(tl_name), "%s %s", fstype,
+		 name ? kbasename(name) : "none");
+	tl_id = boot_timeline_begin(BOOT_TL_MOUNT, tl_name);
 	mnt = vfs_kern_mount(type, flags, name, data);
+	boot_timeline_end(tl_id);
 	if (!IS_ERR(mnt) && (type->fs_flags & FS_HAS_SUBTYPE) &&
 	    !mnt->mnt_sb->s_subtype)
 		mnt = fs_set_subtype(mnt, fstype);
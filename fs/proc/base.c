@@ -907,6 +907,8 @@ static ssize_t oom_adj_write(struct file *file, const char __user *buf,
 		  task_pid_nr(task));
 
 	delete_from_adj_tree(task);
+	if (task->signal->oom_score_adj <= 0 && oom_adj > 0)
+		task->signal->oom_bg_stamp = jiffies;
 	task->signal->oom_score_adj = oom_adj;
 	add_2_adj_tree(task);
 	trace_oom_score_adj_update(task);
@@ -995,6 +997,8 @@ static ssize_t oom_score_adj_write(struct file *file, const char __user *buf,
 	}
 
 	delete_from_adj_tree(task);
+	if (task->signal->oom_score_adj <= 0 && oom_score_adj > 0)
+		task->signal->oom_bg_stamp = jiffies;
 	task->signal->oom_score_adj = (short)oom_score_adj;
 	add_2_adj_tree(task);
 
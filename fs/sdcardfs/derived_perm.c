@@ -281,10 +281,34 @@ static int needs_fixup(perm_t perm)
 	return 0;
 }
 
-static void __fixup_perms_recursive(struct dentry *dentry, struct limit_search *limit, int depth)
+/*
+ * Only Android/ under a user root, and data/, obb/ and media/ under it,
+ * can lead to dentries that need fixing up. Skip their siblings without
+ * taking their locks. Called with the parent's d_lock held, which keeps
+ * the child's name stable.
+ */
+static int child_may_need_fixup(struct sdcardfs_inode_data *data,
+		struct dentry *child)
+{
+	struct qstr q_Android = QSTR_LITERAL("Android");
+	struct qstr q_data = QSTR_LITERAL("data");
+	struct qstr q_obb = QSTR_LITERAL("obb");
+	struct qstr q_media = QSTR_LITERAL("media");
+
+	if (data->perm == PERM_ROOT)
+		return qstr_case_eq(&child->d_name, &q_Android);
+	if (data->perm == PERM_ANDROID)
+		return qstr_case_eq(&child->d_name, &q_data) ||
+			qstr_case_eq(&child->d_name, &q_obb) ||
+			qstr_case_eq(&child->d_name, &q_media);
+	return 1;
+}
+
+static int __fixup_perms_recursive(struct dentry *dentry, struct limit_search *limit, int depth)
 {
 	struct dentry *child;
 	struct sdcardfs_inode_info *info;
+	int fixed = 0;
 
 	/*
 	 * All paths will terminate their recursion on hitting PERM_ANDROID_OBB,
@@ -295,7 +319,7 @@ static void __fixup_perms_recursive(struct dentry *dentry, struct limit_search *
 	spin_lock_nested(&dentry->d_lock, depth);
 	if (!dentry->d_inode) {
 		spin_unlock(&dentry->d_lock);
-		return;
+		return 0;
 	}
 	info = SDCARDFS_I(dentry->d_inode);
 
@@ -307,6 +331,7 @@ static void __fixup_perms_recursive(struct dentry *dentry, struct limit_search *
 					get_derived_permission(dentry, child);
 					fixup_tmp_permissions(child->d_inode);
 					spin_unlock(&child->d_lock);
+					fixed++;
 					break;
 				}
 			}
@@ -314,15 +339,20 @@ static void __fixup_perms_recursive(struct dentry *dentry, struct limit_search *
 		}
 	} else if (descendant_may_need_fixup(info->data, limit)) {
 		list_for_each_entry(child, &dentry->d_subdirs, d_child) {
-			__fixup_perms_recursive(child, limit, depth + 1);
+			if (child_may_need_fixup(info->data, child))
+				fixed += __fixup_perms_recursive(child, limit,
+								 depth + 1);
 		}
 	}
 	spin_unlock(&dentry->d_lock);
+
+	return fixed;
 }
 
-void fixup_perms_recursive(struct dentry *dentry, struct limit_search *limit)
+/* Returns the number of dentries whose derived permissions were updated */
+int fixup_perms_recursive(struct dentry *dentry, struct limit_search *limit)
 {
-	__fixup_perms_recursive(dentry, limit, 0);
+	return __fixup_perms_recursive(dentry, limit, 0);
 }
 
 /* main function for updating derived permission */
@@ -279,22 +279,39 @@ static int insert_userid_exclude_entry_locked(const struct qstr *key, userid_t v
 	return 0;
 }
 
+/*
+ * Number of dentries fixed up by the last package list update and by all
+ * of them, protected by sdcardfs_super_list_lock.
+ */
+static unsigned int fixup_last;
+static unsigned long fixup_total;
+
+static void fixup_account(unsigned int fixed)
+{
+	fixup_last = fixed;
+	fixup_total += fixed;
+}
+
 static void fixup_all_perms_name(const struct qstr *key)
 {
 	struct sdcardfs_sb_info *sbinfo;
+	unsigned int fixed = 0;
 	struct limit_search limit = {
 		.flags = BY_NAME,
 		.name = QSTR_INIT(key->name, key->len),
 	};
 	list_for_each_entry(sbinfo, &sdcardfs_super_list, list) {
 		if (sbinfo_has_sdcard_magic(sbinfo))
-			fixup_perms_recursive(sbinfo->sb->s_root, &limit);
+			fixed += fixup_perms_recursive(sbinfo->sb->s_root,
+								&limit);
 	}
+	fixup_account(fixed);
 }
 
 static void fixup_all_perms_name_userid(const struct qstr *key, userid_t userid)
 {
 	struct sdcardfs_sb_info *sbinfo;
+	unsigned int fixed = 0;
 	struct limit_search limit = {
 		.flags = BY_NAME | BY_USERID,
 		.name = QSTR_INIT(key->name, key->len),
@@ -302,21 +319,26 @@ static void fixup_all_perms_name_userid(const struct qstr *key, userid_t userid)
 	};
 	list_for_each_entry(sbinfo, &sdcardfs_super_list, list) {
 		if (sbinfo_has_sdcard_magic(sbinfo))
-			fixup_perms_recursive(sbinfo->sb->s_root, &limit);
+			fixed += fixup_perms_recursive(sbinfo->sb->s_root,
+								&limit);
 	}
+	fixup_account(fixed);
 }
 
 static void fixup_all_perms_userid(userid_t userid)
 {
 	struct sdcardfs_sb_info *sbinfo;
+	unsigned int fixed = 0;
 	struct limit_search limit = {
 		.flags = BY_USERID,
 		.userid = userid,
 	};
 	list_for_each_entry(sbinfo, &sdcardfs_super_list, list) {
 		if (sbinfo_has_sdcard_magic(sbinfo))
-			fixup_perms_recursive(sbinfo->sb->s_root, &limit);
+			fixed += fixup_perms_recursive(sbinfo->sb->s_root,
+								&limit);
 	}
+	fixup_account(fixed);
 }
 
 static int insert_packagelist_entry(const struct qstr *key, appid_t value)
@@ -823,12 +845,26 @@ static ssize_t packages_remove_userid_store(struct packages *packages,
 	return count;
 }
 
+static ssize_t packages_fixup_count_show(struct packages *packages,
+					 char *page)
+{
+	ssize_t ret;
+
+	mutex_lock(&sdcardfs_super_list_lock);
+	ret = scnprintf(page, PAGE_SIZE, "%u %lu\n", fixup_last, fixup_total);
+	mutex_unlock(&sdcardfs_super_list_lock);
+
+	return ret;
+}
+
 struct packages_attribute packages_attr_packages_gid_list = __CONFIGFS_ATTR_RO(packages_gid.list, packages_list_show);
 PACKAGES_ATTR(remove_userid, S_IWUGO, NULL, packages_remove_userid_store);
+PACKAGES_ATTR_RO(fixup_count, packages_fixup_count_show);
 
 static struct configfs_attribute *packages_attrs[] = {
 	&packages_attr_packages_gid_list.attr,
 	&packages_attr_remove_userid.attr,
+	&packages_attr_fixup_count.attr,
 	NULL,
 };
 
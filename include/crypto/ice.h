@@ -39,7 +39,12 @@ struct ice_crypto_setting {
 	enum ice_cryto_algo_mode	algo_mode;
 	enum ice_crpto_key_mode		key_mode;
 	short				key_index;
-
+	/*
+	 * Set when the data unit number comes from the file rather than
+	 * from the LBA: dun is then the number of the first 4KB data unit.
+	 */
+	bool				dun_valid;
+	u64				dun;
 };
 
 struct ice_data_setting {
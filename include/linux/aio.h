@@ -97,5 +97,7 @@ static inline struct kiocb *list_kiocb(struct list_head *h)
 /* for sysctl: */
 extern unsigned long aio_nr;
 extern unsigned long aio_max_nr;
+extern int aio_offload;
+extern int aio_poll_us;
 
 #endif /* __LINUX__AIO_H */
@@ -0,0 +1,22 @@
+#ifndef _LINUX_ANON_PREZERO_H
+#define _LINUX_ANON_PREZERO_H
+
+struct page;
+
+#ifdef CONFIG_ANON_FAULTAROUND
+extern unsigned int anon_faultaround_pages;
+
+extern struct page *prezero_page_get(void);
+extern void prezero_page_put(struct page *page);
+#else
+static inline struct page *prezero_page_get(void)
+{
+	return NULL;
+}
+
+static inline void prezero_page_put(struct page *page)
+{
+}
+#endif
+
+#endif /* _LINUX_ANON_PREZERO_H */
@@ -92,6 +92,12 @@ struct backing_dev_info {
 	unsigned int min_ratio;
 	unsigned int max_ratio, max_prop_frac;
 
+	/*
+	 * Completion latency of sync requests the block layer tries to keep
+	 * by limiting async writes in flight; 0 leaves them unlimited.
+	 */
+	unsigned int wb_lat_target_us;
+
 	struct bdi_writeback wb;  /* default writeback info for this bdi */
 	spinlock_t wb_lock;	  /* protects work_list & wb.dwork scheduling */
 
@@ -64,10 +64,10 @@ struct coredump_params {
 	loff_t written;
 #ifdef CONFIG_COREDUMP_GZ
 	int gz;
-	u32 crc;
-	z_stream zstr;
-	void *out_buf;
-	void *deflate_workspace;
+	u64 gz_total_in;
+	struct gz_chunk *gz_chunks;
+	int gz_nr_chunks;
+	int gz_cur;
 #endif
 };
 
@@ -164,6 +164,7 @@ struct request {
 	struct gendisk *rq_disk;
 	struct hd_struct *part;
 	unsigned long start_time;
+	u64 issue_time_ns;	/* started, with writeback throttling on */
 #ifdef CONFIG_BLK_CGROUP
 	struct request_list *rl;		/* rl this rq is alloced from */
 	unsigned long long start_time_ns;
@@ -415,6 +416,15 @@ struct request_queue {
 	unsigned int		nr_congestion_off;
 	unsigned int		nr_batching;
 
+	/*
+	 * Writeback throttling: async writes allowed in flight, and the
+	 * sync latency window it is adjusted from. Under queue_lock.
+	 */
+	unsigned int		wb_depth;
+	unsigned int		wb_win_samples;
+	u64			wb_win_start;
+	u64			wb_win_min_lat;
+
 	unsigned int		dma_drain_size;
 	void			*dma_drain_buffer;
 	unsigned int		dma_pad_mask;
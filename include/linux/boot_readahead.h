@@ -0,0 +1,23 @@
+#ifndef _LINUX_BOOT_READAHEAD_H
+#define _LINUX_BOOT_READAHEAD_H
+
+#include <linux/fs.h>
+
+#ifdef CONFIG_BOOT_READAHEAD
+extern bool boot_readahead_recording;
+void __boot_readahead_record(struct file *file, pgoff_t index,
+			     unsigned long nr);
+
+/* called on page cache misses, from contexts that may sleep */
+static inline void boot_readahead_record(struct file *file, pgoff_t index,
+					 unsigned long nr)
+{
+	if (unlikely(boot_readahead_recording))
+		__boot_readahead_record(file, index, nr);
+}
+#else
+static inline void boot_readahead_record(struct file *file, pgoff_t index,
+					 unsigned long nr) {}
+#endif
+
+#endif /* _LINUX_BOOT_READAHEAD_H */
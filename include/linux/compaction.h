@@ -50,6 +50,21 @@ extern unsigned long compaction_suitable(struct zone *zone, int order,
 /* Do not skip compaction more than 64 times */
 #define COMPACT_MAX_DEFER_SHIFT 6
 
+/* Lowest order kept available by proactive compaction */
+#define COMPACT_PROACTIVE_MIN_ORDER 4
+
+/*
+ * Account a high-order allocation served from the free lists without
+ * entering the slow path, out of blocks made by proactive compaction.
+ */
+static inline void compaction_proactive_alloc(struct page *page, int order)
+{
+	if (order >= COMPACT_PROACTIVE_MIN_ORDER &&
+	    atomic_add_unless(&page_zone(page)->compact_proactive_credit,
+			      -1, 0))
+		count_vm_event(COMPACTSTALL_AVOIDED);
+}
+
 /*
  * Compaction is deferred when compaction fails to result in a page
  * allocation success. 1 << compact_defer_limit compactions are skipped up
@@ -213,6 +228,10 @@ static inline bool compaction_deferred(struct zone *zone, int order)
 	return true;
 }
 
+static inline void compaction_proactive_alloc(struct page *page, int order)
+{
+}
+
 static inline bool mobile_page(struct page *page)
 {
 	return false;
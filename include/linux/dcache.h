@@ -65,6 +65,18 @@ struct dentry_stat_t {
 };
 extern struct dentry_stat_t dentry_stat;
 
+/* summed over all CPUs on read, see /proc/sys/fs/dentry-lookup-state */
+struct dentry_lookup_stat_t {
+	long lookups;		/* hash chain walks */
+	long chain_steps;	/* dentries visited by them */
+	long long_chains;	/* walks of more than D_LONG_CHAIN dentries */
+	long max_chain;		/* longest walk seen */
+	long rcu_unlazy;	/* rcu-walks switched to ref-walk midway */
+	long rcu_restarts;	/* rcu-walks redone from scratch in ref-walk */
+	long hash_buckets;
+};
+extern struct dentry_lookup_stat_t dentry_lookup_stat;
+
 /* Name hashing routines. Initial hash value */
 /* Hash courtesy of the R5 hash in reiserfs modulo sign bits */
 #define init_name_hash()		0
@@ -787,8 +787,21 @@ struct file_ra_state {
 	unsigned int ra_pages;		/* Maximum readahead window */
 	unsigned int mmap_miss;		/* Cache miss stat for mmap accesses */
 	loff_t prev_pos;		/* Cache last read() position */
+
+	pgoff_t mmap_prev;		/* Last mmap major fault offset */
+	unsigned short mmap_seq;	/* Run of forward mmap faults */
+	unsigned short mmap_rand;	/* Run of scattered mmap faults */
+	unsigned int mmap_mode;		/* RA_MMAP_* access pattern hint */
 };
 
+/*
+ * mmap access pattern of a file: learned from the faults taken on it unless
+ * pinned by POSIX_FADV_RANDOM / POSIX_FADV_SEQUENTIAL.
+ */
+#define RA_MMAP_AUTO		0
+#define RA_MMAP_RANDOM		1
+#define RA_MMAP_SEQUENTIAL	2
+
 /*
  * Check if @index falls in the readahead windows.
  */
@@ -2807,6 +2820,8 @@ int proc_nr_files(struct ctl_table *table, int write,
 		  void __user *buffer, size_t *lenp, loff_t *ppos);
 int proc_nr_dentry(struct ctl_table *table, int write,
 		  void __user *buffer, size_t *lenp, loff_t *ppos);
+int proc_dentry_lookup_stat(struct ctl_table *table, int write,
+		  void __user *buffer, size_t *lenp, loff_t *ppos);
 int proc_nr_inodes(struct ctl_table *table, int write,
 		   void __user *buffer, size_t *lenp, loff_t *ppos);
 int __init get_filesystem_list(char *buf);
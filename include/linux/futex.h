@@ -1,6 +1,7 @@
 #ifndef _LINUX_FUTEX_H
 #define _LINUX_FUTEX_H
 
+#include <linux/errno.h>
 #include <uapi/linux/futex.h>
 
 struct inode;
@@ -68,4 +69,17 @@ static inline void exit_pi_state_list(struct task_struct *curr)
 {
 }
 #endif
+
+#ifdef CONFIG_FUTEX_PRIVATE_HASH
+extern int futex_hash_prctl(unsigned long op, unsigned long slots);
+extern void futex_hash_free(struct mm_struct *mm);
+#else
+static inline int futex_hash_prctl(unsigned long op, unsigned long slots)
+{
+	return -EINVAL;
+}
+static inline void futex_hash_free(struct mm_struct *mm)
+{
+}
+#endif
 #endif
@@ -23,6 +23,7 @@
 #include <linux/fs.h>
 #include <linux/timer.h>
 #include <linux/mod_devicetable.h>
+#include <linux/irqreturn.h>
 
 /**
  * struct input_value - input value representation
@@ -384,6 +385,12 @@ int input_flush_device(struct input_handle *handle, struct file *file);
 void input_event(struct input_dev *dev, unsigned int type, unsigned int code, int value);
 void input_inject_event(struct input_handle *handle, unsigned int type, unsigned int code, int value);
 
+struct notifier_block;
+int input_register_interaction_notifier(struct notifier_block *nb);
+int input_unregister_interaction_notifier(struct notifier_block *nb);
+void input_interaction_imminent(void);
+irqreturn_t input_interaction_hardirq(int irq, void *dev_id);
+
 static inline void input_report_key(struct input_dev *dev, unsigned int code, int value)
 {
 	input_event(dev, EV_KEY, code, !!value);
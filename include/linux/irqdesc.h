@@ -86,6 +86,12 @@ struct irq_desc {
 	int			parent_irq;
 	struct module		*owner;
 	const char		*name;
+#ifdef CONFIG_IRQ_BALANCE
+	atomic64_t		hard_ns;	/* time in the hard handlers */
+	atomic64_t		thread_ns;	/* time in the irq threads */
+	u64			balance_snap;	/* both, at the last pass */
+	u64			balance_load;	/* both, in the last period */
+#endif
 } ____cacheline_internodealigned_in_smp;
 
 #ifndef CONFIG_SPARSE_IRQ
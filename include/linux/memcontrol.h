@@ -103,6 +103,10 @@ void mem_cgroup_iter_break(struct mem_cgroup *, struct mem_cgroup *);
  * For memory reclaim.
  */
 int mem_cgroup_inactive_anon_is_low(struct lruvec *lruvec);
+void mem_cgroup_workingset_refault(struct page *page, unsigned long distance,
+				   bool activate);
+unsigned int mem_cgroup_workingset_protection(struct lruvec *lruvec);
+unsigned long mem_cgroup_nr_refaults(struct mem_cgroup *memcg);
 int mem_cgroup_select_victim_node(struct mem_cgroup *memcg);
 unsigned long mem_cgroup_get_lru_size(struct lruvec *lruvec, enum lru_list);
 void mem_cgroup_update_lru_size(struct lruvec *, enum lru_list, int);
@@ -273,6 +277,23 @@ mem_cgroup_inactive_anon_is_low(struct lruvec *lruvec)
 	return 1;
 }
 
+static inline void
+mem_cgroup_workingset_refault(struct page *page, unsigned long distance,
+			      bool activate)
+{
+}
+
+static inline unsigned int
+mem_cgroup_workingset_protection(struct lruvec *lruvec)
+{
+	return 0;
+}
+
+static inline unsigned long mem_cgroup_nr_refaults(struct mem_cgroup *memcg)
+{
+	return 0;
+}
+
 static inline unsigned long
 mem_cgroup_get_lru_size(struct lruvec *lruvec, enum lru_list lru)
 {
@@ -123,6 +123,11 @@ extern unsigned int kobjsize(const void *objp);
 #define VM_MAYSHARE	0x00000080
 
 #define VM_GROWSDOWN	0x00000100	/* general info on the segment */
+#ifdef CONFIG_ANON_FAULTAROUND
+# define VM_ANON_FAULTAROUND 0x00000200	/* MADV_FAULTAROUND vma */
+#else
+# define VM_ANON_FAULTAROUND 0
+#endif
 #define VM_PFNMAP	0x00000400	/* Page-ranges managed without "struct page", just pure PFN */
 #define VM_DENYWRITE	0x00000800	/* ETXTBSY on write attempts.. */
 
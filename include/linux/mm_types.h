@@ -357,6 +357,7 @@ struct mm_rss_stat {
 };
 
 struct kioctx_table;
+struct futex_hash_bucket;
 struct mm_struct {
 	struct vm_area_struct *mmap;		/* list of VMAs */
 	struct rb_root mm_rb;
@@ -472,6 +473,11 @@ struct mm_struct {
 #ifdef CONFIG_MSM_APP_SETTINGS
 	int app_setting;
 #endif
+#ifdef CONFIG_FUTEX_PRIVATE_HASH
+	/* private futexes hash here instead of futex_queues when set */
+	struct futex_hash_bucket *futex_hash;
+	unsigned int futex_hash_slots;
+#endif
 
 };
 
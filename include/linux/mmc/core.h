@@ -109,6 +109,9 @@ struct mmc_request {
 	struct mmc_host		*host;
 	struct mmc_cmdq_req	*cmdq_req;
 	struct request *req;
+#ifdef CONFIG_MMC_REQ_TRACE
+	ktime_t			io_start;	/* issued to the host */
+#endif
 };
 
 struct mmc_bus_ops {
@@ -222,6 +225,13 @@ extern int mmc_simple_transfer(struct mmc_card *card,
 extern void mmc_blk_init_bkops_statistics(struct mmc_card *card);
 
 extern void mmc_deferred_scaling(struct mmc_host *host);
+
+enum mmc_clk_scaling_hint {
+	MMC_CLK_SCALING_HINT_SYNC,		/* sync read, flush or FUA */
+	MMC_CLK_SCALING_HINT_ASYNC_WRITE,	/* background writeback */
+};
+extern void mmc_clk_scaling_hint(struct mmc_host *host,
+	enum mmc_clk_scaling_hint hint);
 extern void mmc_cmdq_clk_scaling_start_busy(struct mmc_host *host,
 	bool lock_needed);
 extern void mmc_cmdq_clk_scaling_stop_busy(struct mmc_host *host,
@@ -22,6 +22,7 @@
 #include <linux/mmc/card.h>
 #include <linux/mmc/pm.h>
 #include <linux/mmc/ring_buffer.h>
+#include <linux/mmc/req_trace.h>
 
 #define MMC_AUTOSUSPEND_DELAY_MS	3000
 
@@ -380,6 +381,11 @@ struct mmc_devfeq_clk_scaling {
 	unsigned int	downthreshold;
 	unsigned int	lower_bus_speed_mode;
 #define MMC_SCALING_LOWER_DDR52_MODE	1
+	unsigned int	nr_sync_reqs;		/* in the current interval */
+	unsigned int	nr_async_write_reqs;	/* in the current interval */
+	unsigned long	boost_ms;		/* boost window after input */
+	unsigned long	boost_expires;		/* jiffies */
+	struct notifier_block	boost_nb;
 	bool		need_freq_change;
 	bool		clk_scaling_in_progress;
 	bool		is_busy_started;
@@ -617,6 +623,9 @@ struct mmc_host {
 	bool perf_enable;
 #endif
 	struct mmc_trace_buffer trace_buf;
+#ifdef CONFIG_MMC_REQ_TRACE
+	struct mmc_req_trace	req_trace;
+#endif
 	enum dev_state dev_status;
 	bool			wakeup_on_idle;
 	struct mmc_cmdq_context_info	cmdq_ctx;
@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2016, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#ifndef __MMC_REQ_TRACE__
+#define __MMC_REQ_TRACE__
+
+#include <linux/types.h>
+#include <linux/atomic.h>
+#include <linux/ktime.h>
+#include <linux/mmc/core.h>
+
+struct mmc_host;
+struct dentry;
+
+/*
+ * One completed request. The debugfs "req_ring" file is a struct
+ * mmc_req_ring_hdr followed by the raw ring of these, so the layout is
+ * fixed. Entry (head - 1) % nr_records is the most recent one.
+ */
+struct mmc_req_record {
+	__u64	issue_ns;	/* ktime_get() when issued to the host */
+	__u32	latency_us;	/* issue to completion */
+	__u32	arg;		/* command argument, or cmdq block address */
+	__u32	clock_khz;	/* bus clock at completion */
+	__u16	blocks;
+	__u8	opcode;		/* MMC_REQ_OPCODE_CMDQ for cmdq data */
+	__u8	tag;		/* cmdq task, or MMC_REQ_NO_TAG */
+	__s16	err;
+	__u16	flags;
+	__u32	reserved;
+};
+
+#define MMC_REQ_REC_READ	(1 << 0)
+#define MMC_REQ_REC_WRITE	(1 << 1)
+#define MMC_REQ_REC_CMDQ	(1 << 2)
+#define MMC_REQ_REC_DCMD	(1 << 3)
+
+#define MMC_REQ_OPCODE_CMDQ	0xff
+#define MMC_REQ_NO_TAG		0xff
+
+struct mmc_req_ring_hdr {
+	__u32	version;
+	__u32	nr_records;
+	__u32	head;		/* records written so far, wraps */
+	__u32	record_size;
+};
+
+#define MMC_REQ_RING_VERSION	1
+#define MMC_REQ_RING_SZ		1024	/* records, power of 2 */
+
+enum mmc_req_hist_op {
+	MMC_REQ_HIST_READ,
+	MMC_REQ_HIST_WRITE,
+	MMC_REQ_HIST_OTHER,
+	MMC_REQ_HIST_NR_OPS,
+};
+
+/* bucket n counts latencies below 2^n us, the last one everything above */
+#define MMC_REQ_HIST_BUCKETS	22
+
+struct mmc_req_trace {
+	struct mmc_req_record	*ring;
+	atomic_t		head;
+	atomic_t		hist[MMC_REQ_HIST_NR_OPS][MMC_REQ_HIST_BUCKETS];
+	atomic64_t		total_us[MMC_REQ_HIST_NR_OPS];
+	atomic_t		max_us[MMC_REQ_HIST_NR_OPS];
+};
+
+#ifdef CONFIG_MMC_REQ_TRACE
+static inline void mmc_req_trace_start(struct mmc_request *mrq)
+{
+	mrq->io_start = ktime_get();
+}
+void mmc_req_trace_done(struct mmc_host *host, struct mmc_request *mrq);
+void mmc_req_trace_init(struct mmc_host *host);
+void mmc_req_trace_free(struct mmc_host *host);
+void mmc_req_trace_add_debugfs(struct mmc_host *host, struct dentry *root);
+#else
+static inline void mmc_req_trace_start(struct mmc_request *mrq) {}
+static inline void mmc_req_trace_done(struct mmc_host *host,
+		struct mmc_request *mrq) {}
+static inline void mmc_req_trace_init(struct mmc_host *host) {}
+static inline void mmc_req_trace_free(struct mmc_host *host) {}
+static inline void mmc_req_trace_add_debugfs(struct mmc_host *host,
+		struct dentry *root) {}
+#endif
+
+#endif /* __MMC_REQ_TRACE__ */
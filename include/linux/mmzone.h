@@ -274,8 +274,16 @@ struct per_cpu_pages {
 	struct list_head lists[MIGRATE_PCPTYPES];
 };
 
+/* Highest order that is also cached on per-cpu lists */
+#define PCP_HIGH_ORDER		PAGE_ALLOC_COSTLY_ORDER
+
 struct per_cpu_pageset {
 	struct per_cpu_pages pcp;
+	/*
+	 * Per-cpu lists for orders 1..PCP_HIGH_ORDER, hpcp[order - 1].
+	 * Their count, high and batch are in blocks of that order.
+	 */
+	struct per_cpu_pages hpcp[PCP_HIGH_ORDER];
 #ifdef CONFIG_NUMA
 	s8 expire;
 #endif
@@ -537,6 +545,15 @@ struct zone {
 	unsigned int		compact_considered;
 	unsigned int		compact_defer_shift;
 	int			compact_order_failed;
+
+	/*
+	 * Proactive compaction skips the zone compact_proactive_skip more
+	 * times after failing to reach its target. compact_proactive_credit
+	 * counts the free blocks it made that are not allocated yet.
+	 */
+	unsigned int		compact_proactive_skip;
+	unsigned int		compact_proactive_shift;
+	atomic_t		compact_proactive_credit;
 #endif
 
 #if defined CONFIG_COMPACTION || defined CONFIG_CMA
@@ -910,6 +927,8 @@ int lowmem_reserve_ratio_sysctl_handler(struct ctl_table *, int,
 					void __user *, size_t *, loff_t *);
 int percpu_pagelist_fraction_sysctl_handler(struct ctl_table *, int,
 					void __user *, size_t *, loff_t *);
+int percpu_highorder_sysctl_handler(struct ctl_table *, int,
+					void __user *, size_t *, loff_t *);
 int sysctl_min_unmapped_ratio_sysctl_handler(struct ctl_table *, int,
 			void __user *, size_t *, loff_t *);
 int sysctl_min_slab_ratio_sysctl_handler(struct ctl_table *, int,
@@ -1108,6 +1108,59 @@ int sps_flow_off(struct sps_pipe *h, enum sps_flow_off mode);
  */
 int sps_transfer(struct sps_pipe *h, struct sps_transfer *transfer);
 
+/**
+ * Submit a batch of descriptors on an SPS connection end point
+ *
+ * This function queues a number of descriptors on a peripheral-to/from-memory
+ * connection end point and notifies the hardware only once, after the last
+ * descriptor, with a single descriptor FIFO write pointer update.
+ *
+ * Unlike sps_transfer(), each descriptor is registered with its own user
+ * pointer, so the descriptors may reference unrelated client buffers. The
+ * space for all the descriptors is checked before any of them is queued.
+ *
+ * The client may request the completion indication (SPS_IOVEC_FLAG_INT or
+ * SPS_IOVEC_FLAG_EOT) on the last descriptor only, to take one interrupt
+ * for the whole batch.
+ *
+ * @h - client context for SPS connection end point
+ *
+ * @iovec - array of I/O vectors to submit
+ *
+ * @user - array of user pointers, one per I/O vector, or NULL
+ *
+ * @count - number of I/O vectors
+ *
+ * @return 0 on success, negative value on error
+ *
+ */
+int sps_transfer_batch(struct sps_pipe *h, struct sps_iovec *iovec,
+		       void **user, u32 count);
+
+/**
+ * Get a batch of processed I/O vectors (completed transfers)
+ *
+ * This function fetches up to budget processed I/O vectors under a single
+ * acquisition of the BAM lock. Combined with SPS_O_POLL, it lets a client
+ * drain its completed descriptors from its own context and switch back to
+ * interrupt mode once fewer than budget I/O vectors are returned.
+ *
+ * The connection must have been set up with SPS_O_ACK_TRANSFERS.
+ *
+ * @h - client context for SPS connection end point
+ *
+ * @iovec - array of at least budget I/O vector structs (output)
+ *
+ * @budget - maximum number of I/O vectors to fetch
+ *
+ * @count - number of I/O vectors fetched (output)
+ *
+ * @return 0 on success, negative value on error
+ *
+ */
+int sps_get_iovecs(struct sps_pipe *h, struct sps_iovec *iovec, u32 budget,
+		   u32 *count);
+
 /**
  * Determine whether an SPS connection end point FIFO is empty
  *
@@ -1524,6 +1577,19 @@ static inline int sps_transfer(struct sps_pipe *h,
 	return -EPERM;
 }
 
+static inline int sps_transfer_batch(struct sps_pipe *h,
+				     struct sps_iovec *iovec, void **user,
+				     u32 count)
+{
+	return -EPERM;
+}
+
+static inline int sps_get_iovecs(struct sps_pipe *h, struct sps_iovec *iovec,
+				 u32 budget, u32 *count)
+{
+	return -EPERM;
+}
+
 static inline int sps_is_pipe_empty(struct sps_pipe *h, u32 *empty)
 {
 	return -EPERM;
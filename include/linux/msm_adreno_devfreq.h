@@ -23,6 +23,21 @@ struct xstats {
 	int mod;
 };
 
+/*
+ * Passed to the GPU governor in devfreq_dev_status.private_data.
+ * The frame fields describe the frames that ended since the last sample:
+ * the average busy time and length of a frame and how much of the frame
+ * budget (the frame length or the context deadline, whichever is shorter)
+ * was left once the GPU was done with it. They are 0 when no frames ended.
+ */
+struct msm_adreno_gpu_status {
+	int context_count;
+	u32 frames;
+	u32 frame_busy_us;
+	u32 frame_period_us;
+	s32 frame_slack_us;
+};
+
 struct devfreq_msm_adreno_tz_data {
 	struct notifier_block nb;
 	struct {
@@ -31,6 +46,11 @@ struct devfreq_msm_adreno_tz_data {
 		u32 ctxt_aware_target_pwrlevel;
 		u32 ctxt_aware_busy_penalty;
 	} bin;
+	struct {
+		bool enable;
+		u32 headroom;
+		ktime_t last;
+	} frame;
 	struct {
 		u64 total_time;
 		u64 ram_time;
@@ -24,6 +24,7 @@ int pfk_load_key_start(const struct bio *bio,
 int pfk_load_key_end(const struct bio *bio, bool *is_pfe);
 int pfk_remove_key(const unsigned char *key, size_t key_size);
 bool pfk_allow_merge_bio(struct bio *bio1, struct bio *bio2);
+bool pfk_ice_available(void);
 
 #else
 static inline int pfk_load_key_start(const struct bio *bio,
@@ -48,10 +49,21 @@ static inline bool pfk_allow_merge_bio(const struct bio *bio1,
 	return true;
 }
 
+static inline bool pfk_ice_available(void)
+{
+	return false;
+}
+
 static inline void pfk_remove_all_keys(void)
 {
 }
 
 #endif /* CONFIG_PFK */
 
+#ifdef CONFIG_F2FS_FS_ICE_ENCRYPTION
+/* f2fs files whose data is encrypted by ICE with a key kept by f2fs */
+bool f2fs_ice_inode(struct inode *inode);
+const unsigned char *f2fs_ice_get_key(struct inode *inode);
+#endif
+
 #endif /* PFK_H */
@@ -40,7 +40,10 @@
  * @relax_count: Number of times the wakeup source was deactivated.
  * @expire_count: Number of times the wakeup source's timeout has expired.
  * @wakeup_count: Number of times the wakeup source might abort suspend.
+ * @abort_count: Number of suspend attempts this source actually aborted.
+ * @abort_time: Time spent in those attempts, from start to full unwind.
  * @active: Status of the wakeup source.
+ * @abort_pending: Blamed for aborting the suspend attempt in progress.
  * @has_timeout: The wakeup source has been activated with a timeout.
  */
 struct wakeup_source {
@@ -60,8 +63,11 @@ struct wakeup_source {
 	unsigned long		relax_count;
 	unsigned long		expire_count;
 	unsigned long		wakeup_count;
+	unsigned long		abort_count;
+	ktime_t abort_time;
 	bool			active:1;
 	bool			autosleep_enabled:1;
+	bool			abort_pending:1;
 };
 
 #ifdef CONFIG_PM_SLEEP
@@ -12,13 +12,20 @@
 #ifndef __QPNP_HAPTIC_H
 #define __QPNP_HAPTIC_H
 
+#include <linux/ktime.h>
+
 /* interface for the other module to play different sequences */
 #ifdef CONFIG_QPNP_HAPTIC
 int qpnp_hap_play_byte(u8 data, bool on);
+int qpnp_hap_play_effect(int id, ktime_t req_time);
 #else
 static inline int qpnp_hap_play_byte(u8 data, bool on)
 {
 	return 0;
 }
+static inline int qpnp_hap_play_effect(int id, ktime_t req_time)
+{
+	return 0;
+}
 #endif
 #endif
@@ -181,6 +181,8 @@ extern void get_iowait_load(unsigned long *nr_waiters, unsigned long *load);
 
 extern void sched_update_nr_prod(int cpu, long delta, bool inc);
 extern void sched_get_nr_running_avg(int *avg, int *iowait_avg, int *big_avg);
+extern struct page *sched_rq_stats_page_get(void);
+extern void sched_rq_stats_page_put(void);
 
 extern void calc_global_load(unsigned long ticks);
 extern void update_cpu_load_nohz(void);
@@ -737,6 +739,9 @@ struct signal_struct {
 	short oom_score_adj;		/* OOM kill score adjustment */
 	short oom_score_adj_min;	/* OOM kill score adjustment min value.
 					 * Only settable by CAP_SYS_RESOURCE. */
+	unsigned long oom_bg_stamp;	/* jiffies when oom_score_adj last
+					 * left the foreground (<= 0), 0 if
+					 * it never did. */
 #ifdef CONFIG_ANDROID_LMK_ADJ_RBTREE
 	struct rb_node adj_node;
 #endif
@@ -838,6 +843,13 @@ struct sched_info {
 	/* timestamps */
 	unsigned long long last_arrival,/* when we last ran on a cpu */
 			   last_queued;	/* when we were last queued to run */
+
+#ifdef CONFIG_SCHEDSTATS
+	/* wakeup latency, from the wakeup to when we next run */
+	unsigned int woken;	      /* a wakeup is yet to be accounted */
+	int waker_cpu;		      /* cpu the last wakeup came from */
+	unsigned long long wakeup_delay; /* waited on rqs we migrated off */
+#endif
 };
 #endif /* defined(CONFIG_SCHEDSTATS) || defined(CONFIG_TASK_DELAY_ACCT) */
 
@@ -2259,6 +2271,20 @@ static inline int set_cpus_allowed_ptr(struct task_struct *p,
 }
 #endif
 
+#if defined(CONFIG_SMP) && !defined(CONFIG_SCHED_QHMP)
+extern int sched_isolate_cpu(int cpu);
+extern int sched_unisolate_cpu(int cpu);
+#else
+static inline int sched_isolate_cpu(int cpu)
+{
+	return -EINVAL;
+}
+static inline int sched_unisolate_cpu(int cpu)
+{
+	return -EINVAL;
+}
+#endif
+
 extern int sched_set_wake_up_idle(struct task_struct *p, int wake_up_idle);
 extern u32 sched_get_wake_up_idle(struct task_struct *p);
 extern int sched_set_group_id(struct task_struct *p, unsigned int group_id);
@@ -2273,6 +2299,9 @@ extern int sched_set_static_cpu_pwr_cost(int cpu, unsigned int cost);
 extern unsigned int sched_get_static_cpu_pwr_cost(int cpu);
 extern int sched_set_static_cluster_pwr_cost(int cpu, unsigned int cost);
 extern unsigned int sched_get_static_cluster_pwr_cost(int cpu);
+extern int sched_set_cluster_migration_cost(int cpu, int dst_cluster,
+					    unsigned int cost);
+extern int sched_get_cluster_migration_cost(int cpu, int dst_cluster);
 extern void sched_set_cpu_cstate(int cpu, int cstate,
 			 int wakeup_energy, int wakeup_latency);
 extern void sched_set_cluster_dstate(const cpumask_t *cluster_cpus, int dstate,
@@ -2310,6 +2339,23 @@ static inline void
 sched_update_cpu_freq_min_max(const cpumask_t *cpus, u32 fmin, u32 fmax) { }
 #endif
 
+/* Producers of thermal pressure, combined by taking the largest */
+enum sched_thermal_src {
+	SCHED_THERMAL_SW,	/* software thermal mitigation */
+	SCHED_THERMAL_LMH,	/* hardware limits management */
+	SCHED_THERMAL_NR,
+};
+
+#if defined(CONFIG_SMP) && !defined(CONFIG_SCHED_QHMP)
+extern void sched_set_thermal_pressure(const struct cpumask *cpus,
+				       enum sched_thermal_src src,
+				       unsigned long pressure);
+#else
+static inline void sched_set_thermal_pressure(const struct cpumask *cpus,
+					      enum sched_thermal_src src,
+					      unsigned long pressure) { }
+#endif
+
 #ifdef CONFIG_NO_HZ_COMMON
 void calc_load_enter_idle(void);
 void calc_load_exit_idle(void);
@@ -2466,6 +2512,18 @@ extern int sched_setscheduler_nocheck(struct task_struct *, int,
 extern int sched_setattr(struct task_struct *,
 			 const struct sched_attr *);
 extern struct task_struct *idle_task(int cpu);
+
+/* what a cpu was running, as seen from another cpu without locking */
+struct sched_cpu_snapshot {
+	pid_t pid;
+	int prio;
+	char comm[TASK_COMM_LEN];
+	unsigned int nr_running;
+	unsigned int rt_nr_running;
+	u64 clock;		/* rq clock at its last update */
+	u64 exec_start;		/* when curr last started running */
+};
+extern void sched_cpu_snapshot(int cpu, struct sched_cpu_snapshot *snap);
 /**
  * is_idle_task - is the specified task an idle task?
  * @p: the task in question.
@@ -3205,6 +3263,9 @@ struct migration_notify_data {
 };
 
 extern struct atomic_notifier_head load_alert_notifier_head;
+/* load_alert_notifier_head events, the notifier data is the cpu */
+#define LOAD_ALERT_FREQ_CHANGE		0
+#define LOAD_ALERT_WINDOW_ROLLOVER	1
 
 extern long sched_setaffinity(pid_t pid, const struct cpumask *new_mask);
 extern long sched_getaffinity(pid_t pid, struct cpumask *mask);
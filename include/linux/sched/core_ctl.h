@@ -0,0 +1,26 @@
+/* Copyright (c) 2016, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef _SCHED_CORE_CTL_H
+#define _SCHED_CORE_CTL_H
+
+#ifdef CONFIG_SCHED_CORE_CTL
+int core_ctl_set_boost_min_cpus(unsigned int cpu, unsigned int min_cpus);
+#else
+static inline int core_ctl_set_boost_min_cpus(unsigned int cpu,
+					      unsigned int min_cpus)
+{
+	return 0;
+}
+#endif
+
+#endif
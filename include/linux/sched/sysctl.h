@@ -63,6 +63,7 @@ extern int sysctl_sched_upmigrate_min_nice;
 extern unsigned int sysctl_sched_boost;
 extern unsigned int sysctl_sched_small_wakee_task_load_pct;
 extern unsigned int sysctl_sched_big_waker_task_load_pct;
+extern unsigned int sysctl_sched_small_task_pack_pct;
 extern unsigned int sysctl_sched_prefer_sync_wakee_to_waker;
 
 #ifdef CONFIG_SCHED_QHMP
@@ -84,6 +85,7 @@ extern unsigned int sysctl_sched_new_task_windows;
 extern unsigned int sysctl_sched_pred_alert_freq;
 extern unsigned int sysctl_sched_freq_aggregate;
 extern unsigned int sysctl_sched_freq_aggregate_threshold_pct;
+extern unsigned int sysctl_sched_pred_demand_placement;
 #endif
 #endif
 
@@ -382,6 +382,7 @@ extern bool pm_save_wakeup_count(unsigned int count);
 extern void pm_wakep_autosleep_enabled(bool set);
 extern void pm_print_active_wakeup_sources(void);
 extern void pm_get_active_wakeup_sources(char *pending_sources, size_t max);
+extern void pm_wakeup_account_abort(ktime_t cost);
 
 static inline void lock_system_sleep(void)
 {
@@ -427,6 +428,7 @@ static inline int unregister_pm_notifier(struct notifier_block *nb)
 static inline bool pm_wakeup_pending(void) { return false; }
 static inline void pm_system_wakeup(void) {}
 static inline void pm_wakeup_clear(void) {}
+static inline void pm_wakeup_account_abort(ktime_t cost) {}
 
 static inline void lock_system_sleep(void) {}
 static inline void unlock_system_sleep(void) {}
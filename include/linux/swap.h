@@ -258,11 +258,15 @@ struct swap_info_struct {
 	struct swap_cluster_info discard_cluster_tail; /* list tail of discard clusters */
 	unsigned int write_pending;
 	unsigned int max_writes;
+	int swap_ratio_policy;		/* SWAP_RATIO_* of the ratio group */
+	atomic_long_t swapin_count;	/* swap-ins timed */
+	atomic_long_t swapin_time_us;	/* their total latency */
+	unsigned long swapin_avg_us;	/* decaying average latency */
 };
 
 /* linux/mm/workingset.c */
 void *workingset_eviction(struct address_space *mapping, struct page *page);
-bool workingset_refault(void *shadow);
+bool workingset_refault(void *shadow, struct page *page);
 void workingset_activation(struct page *page);
 extern struct list_lru workingset_shadow_nodes;
 
@@ -343,6 +347,11 @@ extern unsigned long shrink_all_memory(unsigned long nr_pages);
 extern int vm_swappiness;
 extern int sysctl_swap_ratio;
 extern int sysctl_swap_ratio_enable;
+extern int sysctl_swap_ratio_policy;
+
+/* How swap_ratio splits writes between the fast and slow device */
+#define SWAP_RATIO_STATIC	0	/* fixed sysctl_swap_ratio */
+#define SWAP_RATIO_ADAPTIVE	1	/* follow CPU, memory and latency */
 extern int remove_mapping(struct address_space *mapping, struct page *page);
 extern unsigned long vm_total_pages;
 
@@ -12,7 +12,8 @@ extern struct plist_head swap_avail_head;
 extern struct swap_info_struct *swap_info[];
 extern int try_to_unuse(unsigned int, bool, unsigned long);
 extern int swap_ratio(struct swap_info_struct **si);
-extern void setup_swap_ratio(struct swap_info_struct *p, int prio);
+extern void setup_swap_ratio(struct swap_info_struct *p, int prio,
+			     int policy);
 extern bool is_swap_ratio_group(int prio);
 
 #endif /* _LINUX_SWAPFILE_H */
@@ -30,6 +30,15 @@
 #define BIO_U32_SIZE 1024
 #define TEST_BIO_SIZE		PAGE_SIZE	/* use one page bios */
 
+/*
+ * Benchmark latency histogram: values below 16us get a bucket each, above
+ * that every power of two is split into 8 buckets (12.5% resolution) up to
+ * 2^24us.
+ */
+#define TEST_BENCH_LAT_LINEAR	16
+#define TEST_BENCH_LAT_SUB_BITS	3
+#define TEST_BENCH_LAT_BUCKETS	176
+
 struct test_iosched;
 
 typedef int (prepare_test_fn) (struct test_iosched *);
@@ -92,6 +101,53 @@ struct test_debug {
 	struct dentry *sector_range;
 };
 
+/**
+ * struct test_bench_hist - benchmark results for one direction
+ * @bucket:		Completed requests per latency bucket
+ * @count:		Number of completed requests
+ * @bytes:		Number of bytes transferred
+ * @max_us:		Highest latency seen (in usec)
+ */
+struct test_bench_hist {
+	u64 bucket[TEST_BENCH_LAT_BUCKETS];
+	u64 count;
+	u64 bytes;
+	u64 max_us;
+};
+
+/**
+ * struct test_bench - latency/throughput benchmark state
+ * @read_pct:		Percentage of read requests in the mix
+ * @random:		Issue requests at random offsets inside the test
+ *			range instead of sequentially
+ * @queue_depth:	Maximum number of issued, uncompleted requests
+ * @sync:		Mark write requests as REQ_SYNC
+ * @req_pages:		Size of each request, in pages
+ * @nr_reqs:		Number of requests issued per round
+ * @issued:		Number of requests issued in the current round
+ * @outstanding:	Number of issued, uncompleted requests
+ * @next_sector:	Next offset for sequential requests
+ * @hist:		Per-direction results, accumulated over rounds
+ * @duration_us:	Accumulated duration of all rounds
+ * @rounds:		Number of completed rounds
+ * @debug_root:		The benchmark debugfs directory
+ */
+struct test_bench {
+	u32 read_pct;
+	u32 random;
+	u32 queue_depth;
+	u32 sync;
+	u32 req_pages;
+	u32 nr_reqs;
+	u32 issued;
+	atomic_t outstanding;
+	u32 next_sector;
+	struct test_bench_hist hist[2];
+	u64 duration_us;
+	u64 rounds;
+	struct dentry *debug_root;
+};
+
 /**
  * struct test_request - defines a test request
  * @queuelist:		The test requests list
@@ -110,6 +166,7 @@ struct test_debug {
  *			verify the data
  * @req_id:		A unique ID to identify a test request
  *			to ease the debugging of the test cases
+ * @dispatch_time:	Time the request was dispatched to the driver
  */
 struct test_request {
 	struct list_head queuelist;
@@ -121,6 +178,7 @@ struct test_request {
 	int is_err_expected;
 	int wr_rd_data_pattern;
 	int req_id;
+	ktime_t dispatch_time;
 };
 
 /**
@@ -213,6 +271,7 @@ struct blk_dev_test_type {
  *			flush request, therefore disqualifying
  *			the results
  * @blk_dev_test_data:	associated specific block device test utility
+ * @bench:		The latency/throughput benchmark
  */
 struct test_iosched {
 	struct list_head queue;
@@ -240,10 +299,13 @@ struct test_iosched {
 	bool ignore_round;
 	bool notified_urgent;
 	void *blk_dev_test_data;
+	struct test_bench bench;
 };
 
 extern int test_iosched_start_test(struct test_iosched *,
 	struct test_info *t_info);
+extern int test_iosched_start_bench(struct test_iosched *,
+	struct test_info *t_info);
 extern void test_iosched_mark_test_completion(struct test_iosched *);
 extern void check_test_completion(struct test_iosched *);
 extern int test_iosched_add_unique_test_req(struct test_iosched *,
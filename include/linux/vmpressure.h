@@ -13,11 +13,19 @@ struct vmpressure {
 	unsigned long scanned;
 	unsigned long reclaimed;
 	unsigned long stall;
+	/* Reclaim of this memcg's own LRUs, see vmpressure_local() */
+	unsigned long local_scanned;
+	unsigned long local_reclaimed;
 	/* The lock is used to keep the scanned/reclaimed above in sync. */
 	struct spinlock sr_lock;
 
+	/* Refaults of the memcg at the end of the last local window */
+	unsigned long local_refaults;
+
 	/* The list of vmpressure_event structs. */
 	struct list_head events;
+	/* Number of "local" events on the list */
+	unsigned int nr_local_events;
 	/* Have to grab the lock on events traversal or modifications. */
 	struct mutex events_lock;
 
@@ -30,7 +38,11 @@ extern int vmpressure_notifier_register(struct notifier_block *nb);
 extern int vmpressure_notifier_unregister(struct notifier_block *nb);
 extern void vmpressure(gfp_t gfp, struct mem_cgroup *memcg,
 		       unsigned long scanned, unsigned long reclaimed);
+extern void vmpressure_local(gfp_t gfp, struct mem_cgroup *memcg,
+			     unsigned long scanned, unsigned long reclaimed);
 extern void vmpressure_prio(gfp_t gfp, struct mem_cgroup *memcg, int prio);
+extern void vmpressure_account_reclaim_stall(u64 stall_ns);
+extern u64 vmpressure_reclaim_stall_ns(void);
 
 #ifdef CONFIG_MEMCG
 extern void vmpressure_init(struct vmpressure *vmpr);
@@ -39,6 +39,8 @@ struct zs_pool_stats {
 	unsigned long pages_compacted;
 	/* How many pages were migrated */
 	unsigned long pages_moved;
+	/* Time spent compacting, summed over all classes */
+	unsigned long compact_time_ms;
 };
 
 struct zs_pool;
@@ -1627,6 +1627,7 @@ int sock_no_mmap(struct file *file, struct socket *sock,
 		 struct vm_area_struct *vma);
 ssize_t sock_no_sendpage(struct socket *sock, struct page *page, int offset,
 			 size_t size, int flags);
+void sock_sendpage_account(ssize_t bytes, bool zerocopy);
 
 /*
  * Functions to fill in entries in struct proto_ops when a protocol
@@ -18,6 +18,8 @@
 
 #define BAM_DMUX_CH_NAME_MAX_LEN	20
 
+struct napi_struct;
+
 enum {
 	BAM_DMUX_DATA_RMNET_0,
 	BAM_DMUX_DATA_RMNET_1,
@@ -85,6 +87,8 @@ int msm_bam_dmux_is_ch_low(uint32_t id);
 int msm_bam_dmux_reg_notify(void *priv,
 		       void (*notify)(void *priv, int event_type,
 						unsigned long data));
+
+struct napi_struct *msm_bam_dmux_rx_napi(void);
 #else
 static inline int msm_bam_dmux_open(uint32_t id, void *priv,
 		       void (*notify)(void *priv, int event_type,
@@ -134,5 +138,10 @@ static inline int msm_bam_dmux_reg_notify(void *priv,
 {
 	return -ENODEV;
 }
+
+static inline struct napi_struct *msm_bam_dmux_rx_napi(void)
+{
+	return NULL;
+}
 #endif
 #endif /* _BAM_DMUX_H */
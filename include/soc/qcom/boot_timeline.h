@@ -0,0 +1,49 @@
+/* Copyright (c) 2016, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef __SOC_QCOM_BOOT_TIMELINE_H__
+#define __SOC_QCOM_BOOT_TIMELINE_H__
+
+enum boot_tl_phase {
+	BOOT_TL_INITCALL,
+	BOOT_TL_PROBE,
+	BOOT_TL_DEFERRED_PROBE,
+	BOOT_TL_PIL,
+	BOOT_TL_DISPLAY,
+	BOOT_TL_MOUNT,
+	BOOT_TL_NR_PHASES,
+};
+
+#ifdef CONFIG_MSM_BOOT_TIMELINE
+/*
+ * boot_timeline_begin() and boot_timeline_begin_fn() open a span and
+ * return its id, to be passed to boot_timeline_end(), or a negative
+ * value once recording has stopped. The name is copied and may be
+ * truncated; initcalls pass their function instead and are named by
+ * symbol when read back. boot_timeline_mark() records a single point
+ * in time. All of them may be called from atomic context.
+ */
+int boot_timeline_begin(enum boot_tl_phase phase, const char *name);
+int boot_timeline_begin_fn(enum boot_tl_phase phase, void *fn);
+void boot_timeline_end(int id);
+void boot_timeline_mark(enum boot_tl_phase phase, const char *name);
+#else
+static inline int boot_timeline_begin(enum boot_tl_phase phase,
+				      const char *name) { return -1; }
+static inline int boot_timeline_begin_fn(enum boot_tl_phase phase,
+					 void *fn) { return -1; }
+static inline void boot_timeline_end(int id) {}
+static inline void boot_timeline_mark(enum boot_tl_phase phase,
+				      const char *name) {}
+#endif
+
+#endif
@@ -38,6 +38,20 @@ enum {
 enum {
 	GLINK_OPT_INITIAL_XPORT = BIT(0),
 	GLINK_OPT_RX_INTENT_NOTIF = BIT(1),
+	GLINK_OPT_TX_LOW_LATENCY = BIT(2),
+};
+
+#define GLINK_RX_INTENT_POOL_MAX_BUCKETS	4
+
+/**
+ * RX intent pool bucket
+ *
+ * size:	Size of each intent in the bucket
+ * count:	Number of intents in the bucket
+ */
+struct glink_rx_intent_bucket {
+	size_t size;
+	uint32_t count;
 };
 
 /**
@@ -47,6 +61,10 @@ enum {
  * options:			Open option flags
  * rx_intent_req_timeout_ms:	Timeout for requesting an RX intent, in
  *			milliseconds; if set to 0, timeout is infinite
+ * rx_intent_pool:		RX intents queued by the core each time the channel
+ *			connects and reused on glink_rx_done() (optional)
+ * rx_intent_pool_buckets:	Number of entries in rx_intent_pool, at most
+ *			GLINK_RX_INTENT_POOL_MAX_BUCKETS
  * notify_rx:			Receive notification function (required)
  * notify_tx_done:		Transmit-done notification function (required)
  * notify_state:		State-change notification (required)
@@ -70,6 +88,8 @@ struct glink_open_config {
 	const char *edge;
 	const char *name;
 	unsigned int rx_intent_req_timeout_ms;
+	const struct glink_rx_intent_bucket *rx_intent_pool;
+	unsigned int rx_intent_pool_buckets;
 
 	void (*notify_rx)(void *handle, const void *priv, const void *pkt_priv,
 			const void *ptr, size_t size);
@@ -0,0 +1,54 @@
+/* Copyright (c) 2016, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef __SOC_QCOM_HANG_SNAPSHOT_H__
+#define __SOC_QCOM_HANG_SNAPSHOT_H__
+
+#include <linux/cpumask.h>
+#include <linux/notifier.h>
+
+/* handed to the notifiers, which append their state with snprintf */
+struct hang_snapshot_buf {
+	char *buf;
+	size_t size;
+	size_t len;
+};
+
+#ifdef CONFIG_MSM_HANG_SNAPSHOT
+/*
+ * hang_snapshot_take() records the runqueue state of every online cpu,
+ * and whatever the notifiers add, into a static ring without stopping
+ * anything. The cpus in @stalled, if any, also get their stack saved
+ * when they next call hang_snapshot_cpu_recovered(), typically from the
+ * interrupt they were not taking. The notifiers run in atomic context.
+ */
+int hang_snapshot_take(const char *reason, const struct cpumask *stalled,
+		       u64 stall_ns);
+void hang_snapshot_cpu_recovered(void);
+int hang_snapshot_register_notifier(struct notifier_block *nb);
+int hang_snapshot_unregister_notifier(struct notifier_block *nb);
+#else
+static inline int hang_snapshot_take(const char *reason,
+				     const struct cpumask *stalled,
+				     u64 stall_ns) { return -ENODEV; }
+static inline void hang_snapshot_cpu_recovered(void) {}
+static inline int hang_snapshot_register_notifier(struct notifier_block *nb)
+{
+	return 0;
+}
+static inline int hang_snapshot_unregister_notifier(struct notifier_block *nb)
+{
+	return 0;
+}
+#endif
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef __SOC_QCOM_MEMLAT_H
+#define __SOC_QCOM_MEMLAT_H
+
+#include <linux/errno.h>
+#include <linux/types.h>
+
+#ifdef CONFIG_DEVFREQ_GOV_MEMLAT
+int memlat_get_cpu_stall(int cpu, unsigned int *stall_pct, bool *mem_bound);
+#else
+static inline int memlat_get_cpu_stall(int cpu, unsigned int *stall_pct,
+					bool *mem_bound)
+{
+	return -ENODEV;
+}
+#endif
+
+#endif /* __SOC_QCOM_MEMLAT_H */
@@ -71,7 +71,8 @@
 #define show_victim_policy(type)					\
 	__print_symbolic(type,						\
 		{ GC_GREEDY,	"Greedy" },				\
-		{ GC_CB,	"Cost-Benefit" })
+		{ GC_CB,	"Cost-Benefit" },			\
+		{ GC_AT,	"Age-Threshold" })
 
 #define show_cpreason(type)						\
 	__print_symbolic(type,						\
@@ -84,6 +84,45 @@ TRACE_EVENT(irq_handler_exit,
 		  __entry->irq, __entry->ret ? "handled" : "unhandled")
 );
 
+/**
+ * irq_balance_move - the IRQ balancer moved an interrupt to another CPU
+ * @irq: irq number
+ * @from: the CPU the interrupt was targeted at
+ * @to: the CPU it is targeted at now
+ * @load: ns the interrupt took during the last balancing period
+ * @from_load: interrupt ns on @from during that period
+ * @to_load: interrupt ns on @to during that period
+ */
+TRACE_EVENT(irq_balance_move,
+
+	TP_PROTO(int irq, int from, int to, u64 load, u64 from_load,
+		 u64 to_load),
+
+	TP_ARGS(irq, from, to, load, from_load, to_load),
+
+	TP_STRUCT__entry(
+		__field(	int,	irq		)
+		__field(	int,	from		)
+		__field(	int,	to		)
+		__field(	u64,	load		)
+		__field(	u64,	from_load	)
+		__field(	u64,	to_load		)
+	),
+
+	TP_fast_assign(
+		__entry->irq		= irq;
+		__entry->from		= from;
+		__entry->to		= to;
+		__entry->load		= load;
+		__entry->from_load	= from_load;
+		__entry->to_load	= to_load;
+	),
+
+	TP_printk("irq=%d from=%d to=%d load=%llu from_load=%llu to_load=%llu",
+		  __entry->irq, __entry->from, __entry->to, __entry->load,
+		  __entry->from_load, __entry->to_load)
+);
+
 DECLARE_EVENT_CLASS(softirq,
 
 	TP_PROTO(unsigned int vec_nr),
@@ -849,6 +849,36 @@ DEFINE_EVENT(iommu_sec_ptbl_map_range, iommu_sec_ptbl_map_range_end,
 
 	TP_ARGS(sec_id, num, va, pa, len)
 	);
+
+TRACE_EVENT(hyp_assign_call,
+
+	TP_PROTO(int nentries,
+		u64 size,
+		u64 delta_ns,
+		int ret),
+
+	TP_ARGS(nentries, size, delta_ns, ret),
+
+	TP_STRUCT__entry(
+		__field(int, nentries)
+		__field(u64, size)
+		__field(u64, delta_ns)
+		__field(int, ret)
+	),
+
+	TP_fast_assign(
+		__entry->nentries = nentries;
+		__entry->size = size;
+		__entry->delta_ns = delta_ns;
+		__entry->ret = ret;
+	),
+
+	TP_printk("nentries=%d size=%llx delta_ns=%llu ret=%d",
+		__entry->nentries,
+		__entry->size,
+		__entry->delta_ns,
+		__entry->ret)
+	);
 #endif /* _TRACE_KMEM_H */
 
 /* This part must be outside protection */
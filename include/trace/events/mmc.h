@@ -176,6 +176,68 @@ TRACE_EVENT(mmc_clk,
 	)
 );
 
+TRACE_EVENT(mmc_clk_scaling_hint,
+	TP_PROTO(const char *dev_name, int hint, unsigned long curr_freq,
+		 unsigned long target_freq),
+
+	TP_ARGS(dev_name, hint, curr_freq, target_freq),
+
+	TP_STRUCT__entry(
+		__string(dev_name, dev_name)
+		__field(int, hint)
+		__field(unsigned long, curr_freq)
+		__field(unsigned long, target_freq)
+	),
+
+	TP_fast_assign(
+		__assign_str(dev_name, dev_name);
+		__entry->hint = hint;
+		__entry->curr_freq = curr_freq;
+		__entry->target_freq = target_freq;
+	),
+
+	TP_printk("%s: hint=%s curr_freq=%lu target_freq=%lu",
+		__get_str(dev_name),
+		__entry->hint == MMC_CLK_SCALING_HINT_SYNC ?
+			"sync" : "async_write",
+		__entry->curr_freq, __entry->target_freq)
+);
+
+TRACE_EVENT(mmc_clk_scaling_status,
+	TP_PROTO(const char *dev_name, unsigned long busy_time,
+		 unsigned long total_time, unsigned long curr_freq,
+		 unsigned int nr_sync, unsigned int nr_async_write,
+		 bool boosted),
+
+	TP_ARGS(dev_name, busy_time, total_time, curr_freq, nr_sync,
+		nr_async_write, boosted),
+
+	TP_STRUCT__entry(
+		__string(dev_name, dev_name)
+		__field(unsigned long, busy_time)
+		__field(unsigned long, total_time)
+		__field(unsigned long, curr_freq)
+		__field(unsigned int, nr_sync)
+		__field(unsigned int, nr_async_write)
+		__field(bool, boosted)
+	),
+
+	TP_fast_assign(
+		__assign_str(dev_name, dev_name);
+		__entry->busy_time = busy_time;
+		__entry->total_time = total_time;
+		__entry->curr_freq = curr_freq;
+		__entry->nr_sync = nr_sync;
+		__entry->nr_async_write = nr_async_write;
+		__entry->boosted = boosted;
+	),
+
+	TP_printk("%s: busy=%lu total=%lu clk=%lu sync=%u async_write=%u boosted=%d",
+		__get_str(dev_name), __entry->busy_time, __entry->total_time,
+		__entry->curr_freq, __entry->nr_sync, __entry->nr_async_write,
+		__entry->boosted)
+);
+
 DECLARE_EVENT_CLASS(mmc_pm_template,
 	TP_PROTO(const char *dev_name, int err, s64 usecs),
 
@@ -695,6 +695,73 @@ DEFINE_EVENT(kpm_module2, track_iowait,
 	TP_ARGS(cpu, enter_cycle_cnt, exit_cycle_cnt, io_busy, iowait)
 );
 
+TRACE_EVENT(track_stall,
+
+	TP_PROTO(unsigned int cpu, unsigned int io_busy,
+		unsigned int nr_iowait, unsigned int nr_online,
+		unsigned int stall_pct, unsigned int mem_bound_cpus,
+		unsigned int stall_bound),
+
+	TP_ARGS(cpu, io_busy, nr_iowait, nr_online, stall_pct,
+		mem_bound_cpus, stall_bound),
+
+	TP_STRUCT__entry(
+		__field(u32, cpu)
+		__field(u32, io_busy)
+		__field(u32, nr_iowait)
+		__field(u32, nr_online)
+		__field(u32, stall_pct)
+		__field(u32, mem_bound_cpus)
+		__field(u32, stall_bound)
+	),
+
+	TP_fast_assign(
+		__entry->cpu = cpu;
+		__entry->io_busy = io_busy;
+		__entry->nr_iowait = nr_iowait;
+		__entry->nr_online = nr_online;
+		__entry->stall_pct = stall_pct;
+		__entry->mem_bound_cpus = mem_bound_cpus;
+		__entry->stall_bound = stall_bound;
+	),
+
+	TP_printk("CPU:%u io_busy=%u nr_iowait=%u online=%u stall_pct=%u mem_bound_cpus=%u stall_bound=%x",
+		(unsigned int)__entry->cpu, (unsigned int)__entry->io_busy,
+		(unsigned int)__entry->nr_iowait,
+		(unsigned int)__entry->nr_online,
+		(unsigned int)__entry->stall_pct,
+		(unsigned int)__entry->mem_bound_cpus,
+		(unsigned int)__entry->stall_bound)
+);
+
+TRACE_EVENT(hotplug_stall_gated,
+
+	TP_PROTO(unsigned int managed_cpus, unsigned int online,
+		unsigned int max_cpus, unsigned int stall_bound),
+
+	TP_ARGS(managed_cpus, online, max_cpus, stall_bound),
+
+	TP_STRUCT__entry(
+		__field(u32, managed_cpus)
+		__field(u32, online)
+		__field(u32, max_cpus)
+		__field(u32, stall_bound)
+	),
+
+	TP_fast_assign(
+		__entry->managed_cpus = managed_cpus;
+		__entry->online = online;
+		__entry->max_cpus = max_cpus;
+		__entry->stall_bound = stall_bound;
+	),
+
+	TP_printk("managed:%x online=%u max_cpus=%u stall_bound=%x",
+		(unsigned int)__entry->managed_cpus,
+		(unsigned int)__entry->online,
+		(unsigned int)__entry->max_cpus,
+		(unsigned int)__entry->stall_bound)
+);
+
 DECLARE_EVENT_CLASS(cpu_modes,
 
 	TP_PROTO(unsigned int cpu, unsigned int max_load,
@@ -1034,6 +1101,21 @@ TRACE_EVENT(cache_hwmon_meas,
 		  __entry->busy_percent, __entry->us)
 );
 
+TRACE_EVENT(input_boost_latency,
+	TP_PROTO(s64 irq_to_event_us, s64 irq_to_boost_us),
+	TP_ARGS(irq_to_event_us, irq_to_boost_us),
+	TP_STRUCT__entry(
+		__field(s64, irq_to_event_us)
+		__field(s64, irq_to_boost_us)
+	),
+	TP_fast_assign(
+		__entry->irq_to_event_us = irq_to_event_us;
+		__entry->irq_to_boost_us = irq_to_boost_us;
+	),
+	TP_printk("irq_to_event=%lldus irq_to_boost=%lldus",
+		  __entry->irq_to_event_us, __entry->irq_to_boost_us)
+);
+
 TRACE_EVENT(cache_hwmon_update,
 	TP_PROTO(const char *name, unsigned long freq_mhz),
 	TP_ARGS(name, freq_mhz),
@@ -1051,9 +1133,11 @@ TRACE_EVENT(cache_hwmon_update,
 TRACE_EVENT(memlat_dev_meas,
 
 	TP_PROTO(const char *name, unsigned int dev_id, unsigned long inst,
-		 unsigned long mem, unsigned long freq, unsigned int ratio),
+		 unsigned long mem, unsigned long freq, unsigned int ratio,
+		 unsigned long wb, unsigned int stall_pct,
+		 unsigned int weight),
 
-	TP_ARGS(name, dev_id, inst, mem, freq, ratio),
+	TP_ARGS(name, dev_id, inst, mem, freq, ratio, wb, stall_pct, weight),
 
 	TP_STRUCT__entry(
 		__string(name, name)
@@ -1062,6 +1146,9 @@ TRACE_EVENT(memlat_dev_meas,
 		__field(unsigned long, mem)
 		__field(unsigned long, freq)
 		__field(unsigned int, ratio)
+		__field(unsigned long, wb)
+		__field(unsigned int, stall_pct)
+		__field(unsigned int, weight)
 	),
 
 	TP_fast_assign(
@@ -1071,15 +1158,61 @@ TRACE_EVENT(memlat_dev_meas,
 		__entry->mem = mem;
 		__entry->freq = freq;
 		__entry->ratio = ratio;
+		__entry->wb = wb;
+		__entry->stall_pct = stall_pct;
+		__entry->weight = weight;
 	),
 
-	TP_printk("dev: %s, id=%u, inst=%lu, mem=%lu, freq=%lu, ratio=%u",
+	TP_printk("dev: %s, id=%u, inst=%lu, mem=%lu, freq=%lu, ratio=%u, wb=%lu, stall=%u%%, weight=%u",
 		__get_str(name),
 		__entry->dev_id,
 		__entry->inst,
 		__entry->mem,
 		__entry->freq,
-		__entry->ratio)
+		__entry->ratio,
+		__entry->wb,
+		__entry->stall_pct,
+		__entry->weight)
+);
+
+TRACE_EVENT(memlat_dev_decision,
+
+	TP_PROTO(const char *name, unsigned long lat_mhz,
+		 unsigned long wb_mhz, unsigned long stall_mhz,
+		 unsigned long lat_vote, unsigned long wb_vote,
+		 unsigned long stall_vote),
+
+	TP_ARGS(name, lat_mhz, wb_mhz, stall_mhz, lat_vote, wb_vote,
+		stall_vote),
+
+	TP_STRUCT__entry(
+		__string(name, name)
+		__field(unsigned long, lat_mhz)
+		__field(unsigned long, wb_mhz)
+		__field(unsigned long, stall_mhz)
+		__field(unsigned long, lat_vote)
+		__field(unsigned long, wb_vote)
+		__field(unsigned long, stall_vote)
+	),
+
+	TP_fast_assign(
+		__assign_str(name, name);
+		__entry->lat_mhz = lat_mhz;
+		__entry->wb_mhz = wb_mhz;
+		__entry->stall_mhz = stall_mhz;
+		__entry->lat_vote = lat_vote;
+		__entry->wb_vote = wb_vote;
+		__entry->stall_vote = stall_vote;
+	),
+
+	TP_printk("dev: %s, lat=%lu->%lu, wb=%lu->%lu, stall=%lu->%lu",
+		__get_str(name),
+		__entry->lat_mhz,
+		__entry->lat_vote,
+		__entry->wb_mhz,
+		__entry->wb_vote,
+		__entry->stall_mhz,
+		__entry->stall_vote)
 );
 
 TRACE_EVENT(memlat_dev_update,
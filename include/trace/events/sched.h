@@ -137,6 +137,9 @@ TRACE_EVENT(sched_task_load,
 		__array(	char,	comm,	TASK_COMM_LEN	)
 		__field(	pid_t,	pid			)
 		__field(unsigned int,	demand			)
+#ifdef CONFIG_SCHED_FREQ_INPUT
+		__field(unsigned int,	pred_demand		)
+#endif
 		__field(	bool,	boost			)
 		__field(	int,	reason			)
 		__field(	bool,	sync			)
@@ -150,6 +153,9 @@ TRACE_EVENT(sched_task_load,
 		memcpy(__entry->comm, p->comm, TASK_COMM_LEN);
 		__entry->pid		= p->pid;
 		__entry->demand		= p->ravg.demand;
+#ifdef CONFIG_SCHED_FREQ_INPUT
+		__entry->pred_demand	= p->ravg.pred_demand;
+#endif
 		__entry->boost		= boost;
 		__entry->reason		= reason;
 		__entry->sync		= sync;
@@ -161,13 +167,55 @@ TRACE_EVENT(sched_task_load,
 						      p->ravg.mark_start : 0;
 	),
 
-	TP_printk("%d (%s): demand=%u boost=%d reason=%d sync=%d need_idle=%d fast_path=%d best_cpu=%d latency=%llu",
+	TP_printk("%d (%s): demand=%u"
+#ifdef CONFIG_SCHED_FREQ_INPUT
+		" pred_demand=%u"
+#endif
+		" boost=%d reason=%d sync=%d need_idle=%d fast_path=%d best_cpu=%d latency=%llu",
 		__entry->pid, __entry->comm, __entry->demand,
+#ifdef CONFIG_SCHED_FREQ_INPUT
+		__entry->pred_demand,
+#endif
 		__entry->boost, __entry->reason, __entry->sync,
 		__entry->need_idle, __entry->fast_path,
 		__entry->best_cpu, __entry->latency)
 );
 
+TRACE_EVENT(sched_migration_cost_suppressed,
+
+	TP_PROTO(struct task_struct *p, int prev_cpu, int target_cpu,
+		 unsigned int mig_cost, u64 gain, u64 cost),
+
+	TP_ARGS(p, prev_cpu, target_cpu, mig_cost, gain, cost),
+
+	TP_STRUCT__entry(
+		__array(	char,	comm,	TASK_COMM_LEN	)
+		__field(	pid_t,	pid			)
+		__field(unsigned int,	demand			)
+		__field(	int,	prev_cpu		)
+		__field(	int,	target_cpu		)
+		__field(unsigned int,	mig_cost		)
+		__field(	u64,	gain			)
+		__field(	u64,	cost			)
+	),
+
+	TP_fast_assign(
+		memcpy(__entry->comm, p->comm, TASK_COMM_LEN);
+		__entry->pid		= p->pid;
+		__entry->demand		= p->ravg.demand;
+		__entry->prev_cpu	= prev_cpu;
+		__entry->target_cpu	= target_cpu;
+		__entry->mig_cost	= mig_cost;
+		__entry->gain		= gain;
+		__entry->cost		= cost;
+	),
+
+	TP_printk("%d (%s): demand=%u prev_cpu=%d target_cpu=%d mig_cost=%u gain=%llu cost=%llu",
+		__entry->pid, __entry->comm, __entry->demand,
+		__entry->prev_cpu, __entry->target_cpu, __entry->mig_cost,
+		__entry->gain, __entry->cost)
+);
+
 TRACE_EVENT(sched_set_preferred_cluster,
 
 	TP_PROTO(struct related_thread_group *grp, u64 total_demand),
@@ -1269,6 +1317,34 @@ TRACE_EVENT(sched_get_nr_running_avg,
 		__entry->avg, __entry->big_avg, __entry->iowait_avg)
 );
 
+TRACE_EVENT(sched_thermal_pressure,
+
+	TP_PROTO(int cpu, int src, unsigned long src_pressure,
+		 unsigned long pressure, u64 loss),
+
+	TP_ARGS(cpu, src, src_pressure, pressure, loss),
+
+	TP_STRUCT__entry(
+		__field( int,		cpu			)
+		__field( int,		src			)
+		__field( unsigned long,	src_pressure		)
+		__field( unsigned long,	pressure		)
+		__field( u64,		loss			)
+	),
+
+	TP_fast_assign(
+		__entry->cpu		= cpu;
+		__entry->src		= src;
+		__entry->src_pressure	= src_pressure;
+		__entry->pressure	= pressure;
+		__entry->loss		= loss;
+	),
+
+	TP_printk("cpu=%d src=%d src_pressure=%lu pressure=%lu loss=%llu",
+		__entry->cpu, __entry->src, __entry->src_pressure,
+		__entry->pressure, __entry->loss)
+);
+
 TRACE_EVENT(core_ctl_eval_need,
 
 	TP_PROTO(unsigned int cpu, unsigned int old_need,
@@ -348,6 +348,55 @@ DEFINE_EVENT(msm_bcl_print_event, bcl_sw_mitigation_event,
 
 	TP_ARGS(event_name)
 );
+
+TRACE_EVENT(bcl_sw_step_eval,
+
+	TP_PROTO(int ibat, int vbat, int level, int clear_cnt, bool exhausted),
+
+	TP_ARGS(ibat, vbat, level, clear_cnt, exhausted),
+
+	TP_STRUCT__entry(
+		__field(int, ibat)
+		__field(int, vbat)
+		__field(int, level)
+		__field(int, clear_cnt)
+		__field(bool, exhausted)
+	),
+
+	TP_fast_assign(
+		__entry->ibat = ibat;
+		__entry->vbat = vbat;
+		__entry->level = level;
+		__entry->clear_cnt = clear_cnt;
+		__entry->exhausted = exhausted;
+	),
+
+	TP_printk("ibat=%d vbat=%d level=%d clear_cnt=%d exhausted=%d",
+		__entry->ibat, __entry->vbat, __entry->level,
+		__entry->clear_cnt, __entry->exhausted)
+);
+
+TRACE_EVENT(bcl_sw_step_freq,
+
+	TP_PROTO(int cpu, int level, unsigned int max_freq),
+
+	TP_ARGS(cpu, level, max_freq),
+
+	TP_STRUCT__entry(
+		__field(int, cpu)
+		__field(int, level)
+		__field(unsigned int, max_freq)
+	),
+
+	TP_fast_assign(
+		__entry->cpu = cpu;
+		__entry->level = level;
+		__entry->max_freq = max_freq;
+	),
+
+	TP_printk("cpu=%d level=%d max_freq=%u",
+		__entry->cpu, __entry->level, __entry->max_freq)
+);
 #endif /* _BCL_HW_TRACE */
 #else
 DECLARE_EVENT_CLASS(tsens,
@@ -16,6 +16,7 @@
 
 /* For O_CLOEXEC */
 #include <linux/fcntl.h>
+#include <linux/ioctl.h>
 #include <linux/types.h>
 
 /* Flags for epoll_create1.  */
@@ -57,6 +58,31 @@
 /* Set the Edge Triggered behaviour for the target file descriptor */
 #define EPOLLET (1 << 31)
 
+/*
+ * Wakeup coalescing, set on the epoll file with EPIOCSCOALESCE: the first
+ * event arriving for a sleeping epoll_wait() arms a timer of window_us,
+ * and the waiter is woken once it expires, or as soon as max_batch items
+ * are ready, whichever comes first.
+ */
+struct epoll_coalesce {
+	__u32 window_us;	/* 0 wakes on every event, the default */
+	__u32 max_batch;	/* 0 for the maxevents of the waiting call */
+};
+
+/* Counters of an epoll file, read with EPIOCGSTATS */
+struct epoll_stats {
+	__u64 wakeups;		/* waiters woken for new events */
+	__u64 coalesced;	/* events that did not wake a waiter at once */
+	__u64 sends;		/* fetches that returned events */
+	__u64 events;		/* events returned by those */
+	__u64 polls_skipped;	/* edge triggered events not polled again */
+};
+
+#define EPOLL_IOC_TYPE		0x8A
+#define EPIOCSCOALESCE		_IOW(EPOLL_IOC_TYPE, 0x01, struct epoll_coalesce)
+#define EPIOCGCOALESCE		_IOR(EPOLL_IOC_TYPE, 0x02, struct epoll_coalesce)
+#define EPIOCGSTATS		_IOR(EPOLL_IOC_TYPE, 0x03, struct epoll_stats)
+
 /* 
  * On x86-64 make the 64bit structure have the same alignment as the
  * 32bit structure. This makes 32bit emulation easier.
@@ -758,4 +758,11 @@ struct fuse_notify_retrieve_in {
 	uint64_t	dummy4;
 };
 
+/* Device ioctls: */
+#define FUSE_DEV_IOC_MAGIC		229
+/* on a freshly opened /dev/fuse, attach it to the connection of an fd */
+#define FUSE_DEV_IOC_CLONE		_IOR(FUSE_DEV_IOC_MAGIC, 0, uint32_t)
+/* read the requests queued on a CPU through this device first */
+#define FUSE_DEV_IOC_BIND_CPU		_IOW(FUSE_DEV_IOC_MAGIC, 32, uint32_t)
+
 #endif /* _LINUX_FUSE_H */
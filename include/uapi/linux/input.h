@@ -162,6 +162,58 @@ struct input_keymap_entry {
 
 #define EVIOCSCLOCKID		_IOW('E', 0xa0, int)			/* Set clockid to be used for timestamps */
 
+#define EVIOCGRINGSIZE		_IOR('E', 0xa1, int)			/* get size of the mmap event ring */
+#define EVIOCSRINGFD		_IOW('E', 0xa1, int)			/* set eventfd signalled on SYN_REPORT */
+
+/*
+ * Shared-memory event ring.
+ *
+ * Instead of read(), a client may mmap() EVIOCGRINGSIZE bytes at offset 0
+ * of its evdev file descriptor. From then on its events are written only
+ * to the ring and read() fails with EINVAL. The mapping starts with a
+ * struct input_ring_header followed by nr_events (a power of two) entries.
+ *
+ * Every event is stamped with a free-running sequence number; entry
+ * (seq & (nr_events - 1)) holds event seq. The kernel advances head before
+ * overwriting an entry and moves published up to head after each
+ * SYN_REPORT, so a reader consumes complete packets with:
+ *
+ *	end = ACCESS_ONCE(hdr->published);
+ *	rmb();
+ *	for (; tail != end; tail++) {
+ *		copy = ev[tail & (hdr->nr_events - 1)];
+ *		rmb();
+ *		if (ACCESS_ONCE(hdr->head) - tail > hdr->nr_events)
+ *			break;	(overrun, treat as SYN_DROPPED)
+ *	}
+ *	hdr->tail = tail;
+ *
+ * The tail field is owned by the reader and is only used by poll() to
+ * decide whether unconsumed events remain. A reader that wants to sleep
+ * without polling can register an eventfd with EVIOCSRINGFD, which is
+ * signalled once per SYN_REPORT. time_ns uses the clock set with
+ * EVIOCSCLOCKID. EVIOCSSUSPENDBLOCK has no effect on ring clients.
+ */
+struct input_ring_header {
+	__u32 version;
+	__u32 nr_events;
+	__u32 head;
+	__u32 published;
+	__u32 tail;
+	__u32 reserved[11];
+};
+
+struct input_ring_event {
+	__u32 seq;
+	__u16 type;
+	__u16 code;
+	__s32 value;
+	__u32 reserved;
+	__s64 time_ns;
+};
+
+#define INPUT_RING_VERSION	1
+
 /*
  * IDs.
  */
@@ -2,6 +2,7 @@
 #define _UAPI_DSPS_H_
 
 #include <linux/ioctl.h>
+#include <linux/types.h>
 
 #define DSPS_IOCTL_MAGIC 'd'
 
@@ -13,4 +14,55 @@
 
 #define DSPS_IOCTL_RESET _IO(DSPS_IOCTL_MAGIC, 5)
 
+/*
+ * Sensor batching through shared memory.
+ *
+ * Each sensor has a control entry giving its sample period and the max
+ * report latency. The DSP queues samples in the event ring of the shared
+ * SMEM item and raises a single interrupt once the oldest queued sample
+ * of a sensor reaches its latency, or when the ring gets full for a
+ * DSPS_BATCH_WAKEUP sensor. Non-wakeup sensors never interrupt a
+ * suspended AP; their samples wait in the ring and new ones are dropped
+ * once it is full. The DSP never overwrites entries between tail and
+ * head. A max_latency_ms of 0 disables batching for the sensor, and a
+ * period_us of 0 removes its entry.
+ *
+ * Events are read in bulk with read() on the sensors device, in multiples
+ * of struct dsps_batch_event. poll() reports POLLIN when events are
+ * queued.
+ */
+#define DSPS_BATCH_VERSION	1
+#define DSPS_BATCH_MAX_SENSORS	32
+
+#define DSPS_BATCH_WAKEUP	(1 << 0)
+
+struct dsps_batch_ctl {
+	__u32 handle;
+	__u32 period_us;
+	__u32 max_latency_ms;
+	__u32 flags;
+};
+
+struct dsps_batch_event {
+	__u64 timestamp;	/* QTimer ticks */
+	__u32 handle;
+	__u32 reserved;
+	__s32 data[4];
+};
+
+/* Written by the AP unless noted */
+struct dsps_batch_header {
+	__u32 version;
+	__u32 nr_events;	/* power of two */
+	__u32 head;		/* written by the DSP */
+	__u32 tail;
+	__u32 ctl_seq;		/* bumped when ctl[] changes */
+	__u32 flush_seq;	/* bumped to request a flush */
+	__u32 reserved[10];
+	struct dsps_batch_ctl ctl[DSPS_BATCH_MAX_SENSORS];
+};
+
+#define DSPS_IOCTL_SET_BATCH _IOW(DSPS_IOCTL_MAGIC, 6, struct dsps_batch_ctl)
+#define DSPS_IOCTL_FLUSH_BATCH _IO(DSPS_IOCTL_MAGIC, 7)
+
 #endif	/* _UAPI_DSPS_H_ */
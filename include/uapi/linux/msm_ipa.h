@@ -95,7 +95,9 @@
 #define IPA_IOCTL_ALLOC_IPV6CT_TABLE            53
 #define IPA_IOCTL_DEL_NAT_TABLE                 54
 #define IPA_IOCTL_DEL_IPV6CT_TABLE              55
-#define IPA_IOCTL_MAX                           56
+#define IPA_IOCTL_COMMIT_FLT_RT                 56
+#define IPA_IOCTL_NAT_GET_TIMESTAMPS            57
+#define IPA_IOCTL_MAX                           58
 
 /**
  * max size of the header to be inserted
@@ -1568,6 +1570,36 @@ struct ipa_ioc_nat_dma_cmd {
 
 };
 
+/**
+ * struct ipa_ioc_nat_ts_one - state of a single nat rule table entry
+ * @base_addr: input parameter, 0 for the base table, 1 for the
+ *		expansion table
+ * @enabled: output parameter, non zero if the entry is in use
+ * @entry_index: input parameter, index of the entry within the table
+ * @timestamp: output parameter, time stamp of the last packet that hit the
+ *		entry, as updated by IPA HW
+ */
+struct ipa_ioc_nat_ts_one {
+	uint8_t base_addr;
+	uint8_t enabled;
+	uint16_t entry_index;
+	uint32_t timestamp;
+};
+
+#define IPA_NAT_MAX_TS_ENTRIES 1024
+
+/**
+ * struct ipa_ioc_nat_get_ts - To read the state of multiple nat entries
+ * @table_index: input parameter, index of the nat table
+ * @entries: number of entries in use, at most IPA_NAT_MAX_TS_ENTRIES
+ * @ts: the entries to read
+ */
+struct ipa_ioc_nat_get_ts {
+	uint8_t table_index;
+	uint16_t entries;
+	struct ipa_ioc_nat_ts_one ts[0];
+};
+
 /**
  * struct ipa_ioc_vlan_iface_info - add vlan interface
  * @name: interface name
@@ -1833,6 +1865,12 @@ struct ipa_tether_device_info {
 #define IPA_IOC_RESET_FLT _IOW(IPA_IOC_MAGIC, \
 			IPA_IOCTL_RESET_FLT, \
 			enum ipa_ip_type)
+#define IPA_IOC_COMMIT_FLT_RT _IO(IPA_IOC_MAGIC,\
+					IPA_IOCTL_COMMIT_FLT_RT)
+
+#define IPA_IOC_NAT_GET_TIMESTAMPS _IOWR(IPA_IOC_MAGIC, \
+				IPA_IOCTL_NAT_GET_TIMESTAMPS, \
+				struct ipa_ioc_nat_get_ts *)
 #define IPA_IOC_DUMP _IO(IPA_IOC_MAGIC, \
 			IPA_IOCTL_DUMP)
 #define IPA_IOC_GET_RT_TBL _IOWR(IPA_IOC_MAGIC, \
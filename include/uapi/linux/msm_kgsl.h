@@ -134,6 +134,13 @@
 
 #define KGSL_MEMFLAGS_USE_CPU_MAP 0x10000000ULL
 
+/*
+ * Only reserve GPU address space at allocation time and populate the pages
+ * when the GPU or the CPU first touch them. Ignored if the MMU can't stall
+ * on faults.
+ */
+#define KGSL_MEMFLAGS_LAZY_ALLOC 0x20000000ULL
+
 /* Memory types for which allocations are made */
 #define KGSL_MEMTYPE_MASK		0x0000FF00
 #define KGSL_MEMTYPE_SHIFT		8
@@ -267,6 +274,11 @@ struct kgsl_devinfo {
  * @sbz4: Unused, kept for 8 byte alignment
  * @current_context: The current context the GPU is working on
  * @sbz5: Unused, kept for 8 byte alignment
+ *
+ * The memstore is mapped read only at the gpuaddr returned by
+ * KGSL_PROP_DEVICE_SHADOW. Any page aligned window of it may be mapped, so
+ * polling the timestamps of a context only needs the page holding
+ * KGSL_MEMSTORE_OFFSET(ctxt_id, soptimestamp).
  */
 struct kgsl_devmemstore {
 	volatile unsigned int soptimestamp;
@@ -311,6 +323,7 @@ enum kgsl_timestamp_type {
 #define KGSL_PROP_HIGHEST_BANK_BIT	0x17
 #define KGSL_PROP_DEVICE_BITNESS	0x18
 #define KGSL_PROP_DEVICE_QDSS_STM	0x19
+#define KGSL_PROP_CONTEXT_DEADLINE	0x1A
 
 struct kgsl_shadowprop {
 	unsigned long gpuaddr;
@@ -745,6 +758,17 @@ struct kgsl_timestamp_event_fence {
 	int fence_fd; /* Fence to signal */
 };
 
+/*
+ * An eventfd timestamp event adds one to the eventfd counter when the
+ * timestamp expires or the context is destroyed
+ */
+
+#define KGSL_TIMESTAMP_EVENT_EVENTFD 3
+
+struct kgsl_timestamp_event_eventfd {
+	int fd; /* eventfd to signal */
+};
+
 /*
  * Set a property within the kernel.  Uses the same structure as
  * IOCTL_KGSL_GETPROPERTY
@@ -774,6 +798,8 @@ struct kgsl_timestamp_event_fence {
  * KGSL_MEMALIGN*: alignment hint, may be ignored or adjusted by the kernel.
  * KGSL_MEMFLAGS_USE_CPU_MAP: If set on call and return, the returned GPU
  * address will be 0. Calling mmap() will set the GPU address.
+ * KGSL_MEMFLAGS_LAZY_ALLOC: If set on return, pages are allocated on first
+ * access instead of up front.
  */
 struct kgsl_gpumem_alloc_id {
 	unsigned int id;
@@ -1100,6 +1126,17 @@ struct kgsl_device_constraint_pwrlevel {
 	unsigned int level;
 };
 
+/**
+ * struct kgsl_context_deadline - argument to KGSL_PROP_CONTEXT_DEADLINE
+ * @context_id: KGSL context ID
+ * @deadline_us: time in microseconds from submission by which each
+ * command of the context should retire, 0 to clear
+ */
+struct kgsl_context_deadline {
+	unsigned int context_id;
+	unsigned int deadline_us;
+};
+
 /**
  * struct kgsl_syncsource_create - Argument to IOCTL_KGSL_SYNCSOURCE_CREATE
  * @id: returned id for the syncsource that was created.
@@ -1459,4 +1496,72 @@ struct kgsl_gpuobj_set_info {
 #define IOCTL_KGSL_GPUOBJ_SET_INFO \
 	_IOW(KGSL_IOC_TYPE, 0x4C, struct kgsl_gpuobj_set_info)
 
+/**
+ * struct kgsl_perfcounter_sample - argument for IOCTL_KGSL_PERFCOUNTER_SAMPLE
+ * @counters: Pointer to an array of struct kgsl_perfcounter_read_group
+ * holding the groupid/countable pairs to sample (the values are ignored)
+ * @count: Number of entries in @counters, 0 to stop sampling
+ * @period_us: Sampling period in microseconds
+ * @id: ID of the GPU memory object to write the samples to
+ * @__pad: Reserved, must be 0
+ *
+ * Periodically sample a set of performance counters into a GPU memory object
+ * that userspace can map. The object starts with a struct
+ * kgsl_perfcounter_sample_header followed by a ring of records. Each record
+ * is a struct kgsl_perfcounter_sample_record followed by @count 64 bit
+ * counter values in the order of @counters. Only one sampling session can
+ * be active on the device at a time and it stops when the memory object is
+ * freed.
+ */
+struct kgsl_perfcounter_sample {
+	uint64_t __user counters;
+	unsigned int count;
+	unsigned int period_us;
+	unsigned int id;
+	unsigned int __pad;
+};
+
+#define KGSL_PERFCOUNTER_SAMPLE_MAX 32
+
+/**
+ * struct kgsl_perfcounter_sample_header - Header of a sample ring
+ * @head: Number of records written so far
+ * @records: Number of records in the ring
+ * @record_size: Size of each record in bytes
+ * @count: Number of counter values in each record
+ * @dropped: Number of samples that could not be taken
+ *
+ * Record n lives at slot n % @records. @head is only incremented once the
+ * record is complete, so a reader that samples @head, copies records up to
+ * it and then finds that @head has advanced by less than @records since its
+ * copy started has read consistent data.
+ */
+struct kgsl_perfcounter_sample_header {
+	unsigned int head;
+	unsigned int records;
+	unsigned int record_size;
+	unsigned int count;
+	unsigned int dropped;
+	unsigned int __pad[3];
+};
+
+/* The GPU was powered down, values are the ones saved at power collapse */
+#define KGSL_PERFCOUNTER_SAMPLE_IDLE 0x00000001
+
+/**
+ * struct kgsl_perfcounter_sample_record - Header of each sample record
+ * @ticks: GPU always-on counter when the sample was taken, 0 when idle
+ * @ktime: CLOCK_MONOTONIC time when the sample was taken in nanoseconds
+ * @flags: KGSL_PERFCOUNTER_SAMPLE_* flags
+ */
+struct kgsl_perfcounter_sample_record {
+	uint64_t ticks;
+	uint64_t ktime;
+	unsigned int flags;
+	unsigned int __pad;
+};
+
+#define IOCTL_KGSL_PERFCOUNTER_SAMPLE \
+	_IOW(KGSL_IOC_TYPE, 0x4D, struct kgsl_perfcounter_sample)
+
 #endif /* _UAPI_MSM_KGSL_H */
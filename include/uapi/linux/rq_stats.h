@@ -0,0 +1,52 @@
+#ifndef _UAPI_LINUX_RQ_STATS_H
+#define _UAPI_LINUX_RQ_STATS_H
+
+#include <linux/types.h>
+
+/*
+ * Per-CPU run-queue statistics shared with userspace through a read-only
+ * page mapped from /dev/rq_stats.
+ *
+ * Each entry is protected by its own sequence counter: the kernel makes it
+ * odd while updating the entry and even again once done. Readers retry
+ * until they observe the same even value before and after reading:
+ *
+ *	do {
+ *		seq = ACCESS_ONCE(s->seq);
+ *		rmb();
+ *		copy = *s;
+ *		rmb();
+ *	} while ((seq & 1) || seq != ACCESS_ONCE(s->seq));
+ *
+ * The *_prod_sum fields accumulate count * nanoseconds on CLOCK_MONOTONIC
+ * up to last_update_ns. The average over an interval is the difference of
+ * two samples, each extended to the read time with the current count:
+ *
+ *	sum + nr_running * (clock_gettime(CLOCK_MONOTONIC) - last_update_ns)
+ *
+ * Accumulation starts when the page is first mapped.
+ */
+struct rq_stats_cpu {
+	__u32 seq;
+	__u32 nr_running;
+	__u64 last_update_ns;
+	__u64 nr_prod_sum;
+	__u64 nr_big_prod_sum;
+	__u64 iowait_prod_sum;
+	__u64 window_start;	/* Start of the current scheduler window, ns */
+	__u32 prev_busy_us;	/* Busy time in the previous window */
+	__u32 cur_freq;		/* kHz */
+	__u32 nr_iowait;
+	__u32 nr_big;
+} __attribute__((aligned(64)));
+
+#define RQ_STATS_PAGE_VERSION	1
+
+struct rq_stats_page {
+	__u32 version;
+	__u32 nr_cpus;
+	__u8 reserved[56];
+	struct rq_stats_cpu cpu[0];
+};
+
+#endif /* _UAPI_LINUX_RQ_STATS_H */
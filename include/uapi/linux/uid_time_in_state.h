@@ -0,0 +1,35 @@
+#ifndef _UAPI_LINUX_UID_TIME_IN_STATE_H
+#define _UAPI_LINUX_UID_TIME_IN_STATE_H
+
+#include <linux/types.h>
+
+/*
+ * Binary layout of /proc/uid_time_in_state_bin.
+ *
+ * The file starts with a header, followed by nr_freqs __u32 frequencies in
+ * kHz, in the same order as the columns of /proc/uid_time_in_state. Then
+ * come one record per uid, each followed by nr_freqs __u64 times in clock
+ * ticks (USER_HZ), one per frequency:
+ *
+ *	struct uid_tis_header hdr;
+ *	__u32 freqs[hdr.nr_freqs];
+ *	struct {
+ *		struct uid_tis_record rec;
+ *		__u64 time[hdr.nr_freqs];
+ *	} uids[];
+ *
+ * Records are not sorted, and a uid appears at most once per read.
+ */
+struct uid_tis_header {
+	__u32 version;
+	__u32 nr_freqs;
+};
+
+struct uid_tis_record {
+	__u32 uid;
+	__u32 reserved;
+};
+
+#define UID_TIS_VERSION		1
+
+#endif /* _UAPI_LINUX_UID_TIME_IN_STATE_H */
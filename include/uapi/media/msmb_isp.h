@@ -462,6 +462,13 @@ struct msm_vfe_smmu_attach_cmd {
 	uint32_t iommu_attach_mode;
 };
 
+/*
+ * composite_flag value asking for the stats of a stream to be reported
+ * together with the other such streams, in one ISP_EVENT_COMP_STATS_NOTIFY
+ * per PIX SOF, instead of one ISP_EVENT_STATS_NOTIFY per buffer.
+ */
+#define MSM_ISP_STATS_COMPOSITE_SOF 0xFF
+
 struct msm_vfe_stats_stream_request_cmd {
 	uint32_t session_id;
 	uint32_t stream_id;
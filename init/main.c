@@ -78,6 +78,7 @@
 #include <linux/context_tracking.h>
 #include <linux/random.h>
 #include <linux/list.h>
+#include <soc/qcom/boot_timeline.h>
 
 #include <asm/io.h>
 #include <asm/bugs.h>
@@ -786,16 +787,18 @@ static int __init_or_module do_one_initcall_debug(initcall_t fn)
 int __init_or_module do_one_initcall(initcall_t fn)
 {
 	int count = preempt_count();
-	int ret;
+	int ret, tl_id;
 	char msgbuf[64];
 
 	if (initcall_blacklisted(fn))
 		return -EPERM;
 
+	tl_id = boot_timeline_begin_fn(BOOT_TL_INITCALL, fn);
 	if (initcall_debug)
 		ret = do_one_initcall_debug(fn);
 	else
 		ret = fn();
+	boot_timeline_end(tl_id);
 
 	msgbuf[0] = 0;
 
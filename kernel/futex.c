@@ -50,6 +50,8 @@
 #include <linux/file.h>
 #include <linux/jhash.h>
 #include <linux/init.h>
+#include <linux/log2.h>
+#include <linux/prctl.h>
 #include <linux/futex.h>
 #include <linux/mount.h>
 #include <linux/pagemap.h>
@@ -311,9 +313,86 @@ static struct futex_hash_bucket *hash_futex(union futex_key *key)
 	u32 hash = jhash2((u32*)&key->both.word,
 			  (sizeof(key->both.word)+sizeof(key->both.ptr))/4,
 			  key->both.offset);
+
+#ifdef CONFIG_FUTEX_PRIVATE_HASH
+	if (!(key->both.offset & (FUT_OFF_INODE | FUT_OFF_MMSHARED))) {
+		struct mm_struct *mm = key->private.mm;
+
+		if (mm->futex_hash)
+			return &mm->futex_hash[hash &
+					       (mm->futex_hash_slots - 1)];
+	}
+#endif
 	return &futex_queues[hash & (futex_hashsize - 1)];
 }
 
+static void futex_hash_init(struct futex_hash_bucket *hb, unsigned long nr)
+{
+	unsigned long i;
+
+	for (i = 0; i < nr; i++) {
+		atomic_set(&hb[i].waiters, 0);
+		plist_head_init(&hb[i].chain);
+		spin_lock_init(&hb[i].lock);
+	}
+}
+
+#ifdef CONFIG_FUTEX_PRIVATE_HASH
+#define FUTEX_PRIVATE_HASH_MAX	1024
+
+/*
+ * Private keys are only ever built from current->mm, so as long as the
+ * caller is the only user of its mm nobody can be queued on the table
+ * that is being replaced, nor be looking one up.
+ */
+static int futex_hash_set_slots(unsigned long slots)
+{
+	struct mm_struct *mm = current->mm;
+	struct futex_hash_bucket *hb = NULL, *old;
+
+	if (slots && (slots < 2 || slots > FUTEX_PRIVATE_HASH_MAX ||
+		      !is_power_of_2(slots)))
+		return -EINVAL;
+	if (atomic_read(&mm->mm_users) != 1)
+		return -EBUSY;
+
+	if (slots) {
+		hb = kcalloc(slots, sizeof(*hb), GFP_KERNEL);
+		if (!hb)
+			return -ENOMEM;
+		futex_hash_init(hb, slots);
+	}
+
+	old = mm->futex_hash;
+	mm->futex_hash = hb;
+	mm->futex_hash_slots = slots;
+	kfree(old);
+	return 0;
+}
+
+int futex_hash_prctl(unsigned long op, unsigned long slots)
+{
+	if (!current->mm)
+		return -EINVAL;
+
+	switch (op) {
+	case PR_FUTEX_HASH_SET_SLOTS:
+		return futex_hash_set_slots(slots);
+	case PR_FUTEX_HASH_GET_SLOTS:
+		if (slots)
+			return -EINVAL;
+		return current->mm->futex_hash_slots;
+	}
+	return -EINVAL;
+}
+
+void futex_hash_free(struct mm_struct *mm)
+{
+	kfree(mm->futex_hash);
+	mm->futex_hash = NULL;
+}
+#endif
+
 /*
  * Return 1 if two futex_keys are equal, 0 otherwise.
  */
@@ -3143,7 +3222,6 @@ __attribute__((optnone))
 static int __init futex_init(void)
 {
 	unsigned int futex_shift;
-	unsigned long i;
 
 #if CONFIG_BASE_SMALL
 	futex_hashsize = 16;
@@ -3160,11 +3238,7 @@ static int __init futex_init(void)
 
 	futex_detect_cmpxchg();
 
-	for (i = 0; i < futex_hashsize; i++) {
-		atomic_set(&futex_queues[i].waiters, 0);
-		plist_head_init(&futex_queues[i].chain);
-		spin_lock_init(&futex_queues[i].lock);
-	}
+	futex_hash_init(futex_queues, futex_hashsize);
 
 	return 0;
 }
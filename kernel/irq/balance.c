@@ -0,0 +1,238 @@
+/*
+ * linux/kernel/irq/balance.c
+ *
+ * In-kernel interrupt affinity balancing.
+ *
+ * Every pass takes the time each interrupt spent in its hard handlers and
+ * irq threads since the previous pass, and adds it up per target CPU.  It
+ * then moves at most one interrupt off the busiest allowed CPU onto the
+ * least loaded one, if the two differ by more than imbalance_pct of the
+ * period.  Targets in a cluster that has a CPU awake are preferred, so
+ * that an interrupt does not drag a cluster out of deep idle.  The
+ * interrupt moved is the heaviest one that still lowers the imbalance;
+ * moving one at a time keeps the rest where their caches are.
+ */
+
+#include <linux/cpumask.h>
+#include <linux/interrupt.h>
+#include <linux/irq.h>
+#include <linux/moduleparam.h>
+#include <linux/sched.h>
+#include <linux/string.h>
+#include <linux/topology.h>
+#include <linux/workqueue.h>
+
+#include <trace/events/irq.h>
+
+#include "internals.h"
+
+#ifdef MODULE_PARAM_PREFIX
+#undef MODULE_PARAM_PREFIX
+#endif
+#define MODULE_PARAM_PREFIX "irq_balance."
+
+bool irq_balance_enabled __read_mostly;
+
+static unsigned int interval_ms = 1000;
+module_param(interval_ms, uint, 0644);
+
+static unsigned int imbalance_pct = 2;
+module_param(imbalance_pct, uint, 0644);
+
+/* comma separated action names never to move, e.g. touch and display */
+static char pinned[256];
+module_param_string(pinned, pinned, sizeof(pinned), 0644);
+
+/* CPUs interrupts may be moved between, empty for all online CPUs */
+static struct cpumask allowed_cpus;
+
+static void irq_balance_fn(struct work_struct *work);
+static DECLARE_DEFERRABLE_WORK(irq_balance_work, irq_balance_fn);
+static bool irq_balance_ready;
+
+/* only touched by irq_balance_fn(), which never runs concurrently */
+static struct cpumask balance_mask;
+static u64 cpu_load[NR_CPUS];
+static char pinned_copy[sizeof(pinned)];
+
+static bool irq_balance_name_pinned(const char *name)
+{
+	size_t len = strlen(name), n;
+	const char *p = pinned_copy;
+
+	while (*p) {
+		n = strcspn(p, ",\n");
+		if (n == len && !strncmp(p, name, len))
+			return true;
+		p += n;
+		if (*p)
+			p++;
+	}
+	return false;
+}
+
+/* Called with desc->lock held. */
+static bool irq_balance_movable(struct irq_desc *desc)
+{
+	struct irq_data *d = &desc->irq_data;
+	struct irqaction *action;
+
+	if (!desc->action || !irqd_can_balance(d) || irqd_irq_disabled(d) ||
+	    !d->chip || !d->chip->irq_set_affinity)
+		return false;
+
+	for (action = desc->action; action; action = action->next)
+		if (action->name && irq_balance_name_pinned(action->name))
+			return false;
+	return true;
+}
+
+static bool irq_balance_cluster_awake(int cpu)
+{
+	int i;
+
+	for_each_cpu_and(i, topology_core_cpumask(cpu), cpu_online_mask)
+		if (!idle_cpu(i))
+			return true;
+	return false;
+}
+
+/* is @cpu a better target than @best? */
+static bool irq_balance_better(int cpu, int best)
+{
+	bool awake = irq_balance_cluster_awake(cpu);
+
+	if (best < 0)
+		return true;
+	if (awake != irq_balance_cluster_awake(best))
+		return awake;
+	return cpu_load[cpu] < cpu_load[best];
+}
+
+static inline int irq_balance_target(struct irq_desc *desc)
+{
+	return cpumask_first_and(desc->irq_data.affinity, cpu_online_mask);
+}
+
+static void irq_balance_fn(struct work_struct *work)
+{
+	static u64 last_pass;
+	int irq, cpu, from = -1, to = -1, move = -1;
+	u64 now = local_clock(), period, gap, best = 0;
+	struct irq_desc *desc;
+	unsigned long flags;
+
+	period = now - last_pass;
+	last_pass = now;
+
+	memset(cpu_load, 0, sizeof(cpu_load));
+	irq_lock_sparse();
+	for_each_irq_desc(irq, desc) {
+		u64 total;
+
+		raw_spin_lock_irqsave(&desc->lock, flags);
+		total = atomic64_read(&desc->hard_ns) +
+			atomic64_read(&desc->thread_ns);
+		desc->balance_load = total - desc->balance_snap;
+		desc->balance_snap = total;
+		cpu = irq_balance_target(desc);
+		if (cpu < nr_cpu_ids)
+			cpu_load[cpu] += desc->balance_load;
+		raw_spin_unlock_irqrestore(&desc->lock, flags);
+	}
+
+	if (cpumask_empty(&allowed_cpus))
+		cpumask_copy(&balance_mask, cpu_online_mask);
+	else
+		cpumask_and(&balance_mask, &allowed_cpus, cpu_online_mask);
+
+	for_each_cpu(cpu, &balance_mask)
+		if (from < 0 || cpu_load[cpu] > cpu_load[from])
+			from = cpu;
+	for_each_cpu(cpu, &balance_mask)
+		if (cpu != from && irq_balance_better(cpu, to))
+			to = cpu;
+
+	if (to < 0 || cpu_load[from] <= cpu_load[to])
+		goto unlock;
+	gap = cpu_load[from] - cpu_load[to];
+	if (gap * 100 <= period * imbalance_pct)
+		goto unlock;
+
+	kparam_block_sysfs_write(pinned);
+	strlcpy(pinned_copy, pinned, sizeof(pinned_copy));
+	kparam_unblock_sysfs_write(pinned);
+
+	for_each_irq_desc(irq, desc) {
+		raw_spin_lock_irqsave(&desc->lock, flags);
+		if (desc->balance_load > best && desc->balance_load < gap &&
+		    irq_balance_target(desc) == from &&
+		    irq_balance_movable(desc)) {
+			best = desc->balance_load;
+			move = irq;
+		}
+		raw_spin_unlock_irqrestore(&desc->lock, flags);
+	}
+unlock:
+	irq_unlock_sparse();
+
+	if (move >= 0 && !irq_set_affinity(move, cpumask_of(to)))
+		trace_irq_balance_move(move, from, to, best, cpu_load[from],
+				       cpu_load[to]);
+
+	if (ACCESS_ONCE(irq_balance_enabled))
+		queue_delayed_work(system_power_efficient_wq, &irq_balance_work,
+				   msecs_to_jiffies(interval_ms));
+}
+
+static int irq_balance_set_enable(const char *val,
+				  const struct kernel_param *kp)
+{
+	int ret = param_set_bool(val, kp);
+
+	/* the work stops requeueing itself once disabled */
+	if (!ret && irq_balance_ready && irq_balance_enabled)
+		mod_delayed_work(system_power_efficient_wq, &irq_balance_work,
+				 0);
+	return ret;
+}
+
+static struct kernel_param_ops irq_balance_enable_ops = {
+	.set = irq_balance_set_enable,
+	.get = param_get_bool,
+};
+module_param_cb(enable, &irq_balance_enable_ops, &irq_balance_enabled, 0644);
+
+static int irq_balance_set_cpus(const char *val, const struct kernel_param *kp)
+{
+	static struct cpumask new;
+	int ret;
+
+	/* serialized by the module param lock */
+	ret = cpulist_parse(val, &new);
+	if (ret)
+		return ret;
+	cpumask_and(&allowed_cpus, &new, cpu_possible_mask);
+	return 0;
+}
+
+static int irq_balance_get_cpus(char *buffer, const struct kernel_param *kp)
+{
+	return cpulist_scnprintf(buffer, PAGE_SIZE - 1, &allowed_cpus);
+}
+
+static struct kernel_param_ops irq_balance_cpus_ops = {
+	.set = irq_balance_set_cpus,
+	.get = irq_balance_get_cpus,
+};
+module_param_cb(cpus, &irq_balance_cpus_ops, NULL, 0644);
+
+static int __init irq_balance_init(void)
+{
+	irq_balance_ready = true;
+	if (irq_balance_enabled)
+		queue_delayed_work(system_power_efficient_wq, &irq_balance_work,
+				   msecs_to_jiffies(interval_ms));
+	return 0;
+}
+late_initcall(irq_balance_init);
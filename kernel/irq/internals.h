@@ -199,6 +199,27 @@ static inline void kstat_incr_irqs_this_cpu(unsigned int irq, struct irq_desc *d
 	__this_cpu_inc(kstat.irqs_sum);
 }
 
+#ifdef CONFIG_IRQ_BALANCE
+extern bool irq_balance_enabled;
+
+static inline u64 irq_balance_clock(void)
+{
+	return irq_balance_enabled ? local_clock() : 0;
+}
+
+static inline void irq_balance_account(struct irq_desc *desc, u64 start,
+				       bool thread)
+{
+	if (start)
+		atomic64_add(local_clock() - start,
+			     thread ? &desc->thread_ns : &desc->hard_ns);
+}
+#else
+static inline u64 irq_balance_clock(void) { return 0; }
+static inline void irq_balance_account(struct irq_desc *desc, u64 start,
+				       bool thread) { }
+#endif
+
 #ifdef CONFIG_PM_SLEEP
 bool irq_pm_check_wakeup(struct irq_desc *desc);
 void irq_pm_install_action(struct irq_desc *desc, struct irqaction *action);
@@ -250,6 +250,44 @@ int irq_set_affinity_hint(unsigned int irq, const struct cpumask *m)
 }
 EXPORT_SYMBOL_GPL(irq_set_affinity_hint);
 
+/**
+ *	irq_migrate_isolated - re-steer interrupts after a cpu's isolation changed
+ *	@cpu:	cpu whose bit in cpu_isolated_mask was just set or cleared
+ *
+ *	Every interrupt whose affinity includes @cpu is routed to the online,
+ *	unisolated cpus of its affinity. The affinity itself is left alone so
+ *	the interrupt returns to @cpu once it is unisolated. Interrupts that
+ *	are only affine to isolated cpus are not moved.
+ *
+ *	Must be called in process context.
+ */
+void irq_migrate_isolated(unsigned int cpu)
+{
+	struct irq_desc *desc;
+	unsigned long flags;
+	cpumask_t avail;
+	unsigned int irq;
+
+	for_each_irq_desc(irq, desc) {
+		struct irq_data *data = irq_desc_get_irq_data(desc);
+		struct irq_chip *chip;
+
+		raw_spin_lock_irqsave(&desc->lock, flags);
+		chip = irq_data_get_irq_chip(data);
+		if (irqd_is_per_cpu(data) || !chip || !chip->irq_set_affinity ||
+		    !irq_can_move_pcntxt(data) ||
+		    !cpumask_test_cpu(cpu, data->affinity))
+			goto next;
+
+		cpumask_andnot(&avail, data->affinity, cpu_isolated_mask);
+		cpumask_and(&avail, &avail, cpu_online_mask);
+		if (!cpumask_empty(&avail))
+			chip->irq_set_affinity(data, &avail, false);
+next:
+		raw_spin_unlock_irqrestore(&desc->lock, flags);
+	}
+}
+
 static void irq_affinity_notify(struct work_struct *work)
 {
 	struct irq_affinity_notify *notify =
@@ -898,10 +936,13 @@ static int irq_thread(void *data)
 
 	while (!irq_wait_for_interrupt(action)) {
 		irqreturn_t action_ret;
+		u64 start;
 
 		irq_thread_check_affinity(desc, action);
 
+		start = irq_balance_clock();
 		action_ret = handler_fn(desc, action);
+		irq_balance_account(desc, start, true);
 		if (action_ret == IRQ_HANDLED)
 			atomic_inc(&desc->threads_handled);
 
@@ -23,9 +23,43 @@ static struct workqueue_struct *autosleep_wq;
 static DEFINE_MUTEX(autosleep_lock);
 static struct wakeup_source *autosleep_ws;
 
+/*
+ * Back-off after repeated aborted attempts. Each abort costs a full freeze
+ * and device suspend/resume cycle, so once wakeup events keep arriving during
+ * suspend, wait increasingly long before trying again. The first few aborts
+ * are retried immediately.
+ */
+#define AUTOSLEEP_ABORTS_FREE		2
+#define AUTOSLEEP_BACKOFF_MIN		(HZ / 50)
+#define AUTOSLEEP_BACKOFF_MAX		(HZ / 2)
+
+static unsigned int autosleep_aborts;
+
+static void autosleep_backoff(int error)
+{
+	unsigned int shift;
+	long timeout;
+
+	if (error != -EBUSY) {
+		autosleep_aborts = 0;
+		return;
+	}
+
+	if (++autosleep_aborts <= AUTOSLEEP_ABORTS_FREE)
+		return;
+
+	shift = min(autosleep_aborts - AUTOSLEEP_ABORTS_FREE - 1, 8U);
+	timeout = min_t(long, AUTOSLEEP_BACKOFF_MIN << shift,
+			AUTOSLEEP_BACKOFF_MAX);
+	pr_debug("PM: %u aborted suspends in a row, backing off %u ms\n",
+		 autosleep_aborts, jiffies_to_msecs(timeout));
+	schedule_timeout_uninterruptible(timeout);
+}
+
 static void try_to_suspend(struct work_struct *work)
 {
 	unsigned int initial_count, final_count;
+	int error;
 
 	if (!pm_get_wakeup_count(&initial_count, true))
 		goto out;
@@ -43,12 +77,14 @@ static void try_to_suspend(struct work_struct *work)
 		return;
 	}
 	if (autosleep_state >= PM_SUSPEND_MAX)
-		hibernate();
+		error = hibernate();
 	else
-		pm_suspend(autosleep_state);
+		error = pm_suspend(autosleep_state);
 
 	mutex_unlock(&autosleep_lock);
 
+	autosleep_backoff(error);
+
 	if (!pm_get_wakeup_count(&final_count, false))
 		goto out;
 
@@ -230,10 +230,29 @@ static const struct file_operations suspend_stats_operations = {
 	.release        = single_release,
 };
 
+static int resume_times_show(struct seq_file *s, void *unused)
+{
+	return dpm_show_resume_times(s);
+}
+
+static int resume_times_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, resume_times_show, NULL);
+}
+
+static const struct file_operations resume_times_operations = {
+	.open           = resume_times_open,
+	.read           = seq_read,
+	.llseek         = seq_lseek,
+	.release        = single_release,
+};
+
 static int __init pm_debugfs_init(void)
 {
 	debugfs_create_file("suspend_stats", S_IFREG | S_IRUGO,
 			NULL, NULL, &suspend_stats_operations);
+	debugfs_create_file("resume_times", S_IFREG | S_IRUGO,
+			NULL, NULL, &resume_times_operations);
 	return 0;
 }
 
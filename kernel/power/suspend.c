@@ -288,6 +288,23 @@ static int suspend_prepare(suspend_state_t state)
 	return error;
 }
 
+/*
+ * Check for wakeup events between suspend phases, so that an attempt which is
+ * going to be aborted anyway does not go on to run the more expensive phases
+ * only to unwind them again.
+ */
+static bool suspend_wakeup_abort(const char *phase)
+{
+	char suspend_abort[MAX_SUSPEND_ABORT_LEN];
+
+	if (!pm_wakeup_pending())
+		return false;
+
+	pm_get_active_wakeup_sources(suspend_abort, MAX_SUSPEND_ABORT_LEN);
+	log_suspend_abort_reason("Wakeup pending %s: %s", phase, suspend_abort);
+	return true;
+}
+
 /* default implementation */
 void __weak arch_suspend_disable_irqs(void)
 {
@@ -312,6 +329,9 @@ static int suspend_enter(suspend_state_t state, bool *wakeup)
 	char suspend_abort[MAX_SUSPEND_ABORT_LEN];
 	int error, last_dev;
 
+	if (suspend_wakeup_abort("before late suspend"))
+		return -EBUSY;
+
 	error = platform_suspend_prepare(state);
 	if (error)
 		goto Platform_finish;
@@ -358,6 +378,11 @@ static int suspend_enter(suspend_state_t state, bool *wakeup)
 		goto Platform_wake;
 	}
 
+	if (suspend_wakeup_abort("before disabling non-boot cpus")) {
+		error = -EBUSY;
+		goto Platform_wake;
+	}
+
 #ifdef CONFIG_SUSPEND_DEBUG
 	vreg_before_sleep_save_configs();
 	tlmm_before_sleep_set_configs();
@@ -487,6 +512,7 @@ static void suspend_finish(void)
  */
 static int enter_state(suspend_state_t state)
 {
+	ktime_t starttime = ktime_get();
 	int error;
 
 	trace_suspend_resume(TPS("suspend_enter"), state, true);
@@ -515,6 +541,11 @@ static int enter_state(suspend_state_t state)
 	trace_suspend_resume(TPS("sync_filesystems"), 0, false);
 #endif
 
+	if (suspend_wakeup_abort("before suspend notifiers")) {
+		error = -EBUSY;
+		goto Unlock;
+	}
+
 	pr_debug("PM: Preparing system for %s sleep\n", pm_states[state]);
 	suspend_watchdog_set();
 	error = suspend_prepare(state);
@@ -537,6 +568,7 @@ static int enter_state(suspend_state_t state)
 	suspend_finish();
 	suspend_watchdog_clear();
  Unlock:
+	pm_wakeup_account_abort(ktime_sub(ktime_get(), starttime));
 	mutex_unlock(&pm_mutex);
 	return error;
 }
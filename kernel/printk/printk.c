@@ -46,6 +46,7 @@
 #include <linux/irq_work.h>
 #include <linux/utsname.h>
 #include <linux/ctype.h>
+#include <linux/kthread.h>
 
 #include <asm/uaccess.h>
 
@@ -1511,6 +1512,59 @@ static int console_trylock_for_printk(void)
 	return 1;
 }
 
+/*
+ * Once it is up, the printk kthread flushes the log buffer to the consoles
+ * and vprintk_emit() only stores the message and wakes it, so that a slow
+ * console does not stall whatever task happened to print. Oopses, panics,
+ * early boot and shutdown still print synchronously, from the caller.
+ */
+static bool __read_mostly printk_async = true;
+module_param_named(async, printk_async, bool, S_IRUGO | S_IWUSR);
+
+static struct task_struct *printk_kthread __read_mostly;
+static bool printk_kthread_pending;
+
+static bool printk_offload(void)
+{
+	if (!printk_kthread || !ACCESS_ONCE(printk_async) ||
+	    oops_in_progress || system_state != SYSTEM_RUNNING)
+		return false;
+
+	ACCESS_ONCE(printk_kthread_pending) = true;
+	wake_up_process(printk_kthread);
+	return true;
+}
+
+static int printk_kthread_func(void *unused)
+{
+	while (!kthread_should_stop()) {
+		set_current_state(TASK_INTERRUPTIBLE);
+		if (!xchg(&printk_kthread_pending, false)) {
+			schedule();
+			continue;
+		}
+		__set_current_state(TASK_RUNNING);
+
+		console_lock();
+		console_unlock();
+	}
+	return 0;
+}
+
+static int __init printk_kthread_init(void)
+{
+	struct task_struct *t;
+
+	t = kthread_run(printk_kthread_func, NULL, "printk");
+	if (IS_ERR(t)) {
+		pr_err("printk: failed to start the printk kthread\n");
+		return PTR_ERR(t);
+	}
+	printk_kthread = t;
+	return 0;
+}
+early_initcall(printk_kthread_init);
+
 int printk_delay_msec __read_mostly;
 
 static inline void printk_delay(void)
@@ -1791,7 +1845,7 @@ asmlinkage int vprintk_emit(int facility, int level,
 	local_irq_restore(flags);
 
 	/* If called from the scheduler, we can not call up(). */
-	if (!in_sched) {
+	if (!in_sched && !printk_offload()) {
 		lockdep_off();
 		/*
 		 * Disable preemption to avoid being preempted while holding
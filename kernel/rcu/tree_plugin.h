@@ -2167,6 +2167,77 @@ static int __init parse_rcu_nocb_poll(char *arg)
 }
 early_param("rcu_nocb_poll", parse_rcu_nocb_poll);
 
+/* Callbacks an rcuo kthread invokes between cond_resched()s, 0: no limit. */
+static int rcu_nocb_batch;
+module_param(rcu_nocb_batch, int, 0644);
+
+/*
+ * CPUs the rcuo kthreads run on, empty for no restriction.  Pointing
+ * this at the little cluster keeps callback invocation for no-CBs CPUs
+ * off the big cores.  Writes are serialized by the module param lock.
+ */
+static struct cpumask rcu_nocb_affinity;
+
+static const struct cpumask *rcu_nocb_kthread_mask(void)
+{
+	if (cpumask_empty(&rcu_nocb_affinity))
+		return cpu_possible_mask;
+	return &rcu_nocb_affinity;
+}
+
+static void rcu_nocb_set_affinity(void)
+{
+	struct rcu_state *rsp;
+	struct task_struct *t;
+	int cpu;
+
+	if (!have_rcu_nocb_mask)
+		return;
+
+	/* Excludes rcu_spawn_one_nocb_kthread() from CPU hotplug. */
+	get_online_cpus();
+	for_each_rcu_flavor(rsp) {
+		for_each_cpu(cpu, rcu_nocb_mask) {
+			t = per_cpu_ptr(rsp->rda, cpu)->nocb_kthread;
+			if (t)
+				set_cpus_allowed_ptr(t, rcu_nocb_kthread_mask());
+		}
+	}
+	put_online_cpus();
+}
+
+static int param_set_nocb_affinity(const char *val,
+				   const struct kernel_param *kp)
+{
+	static struct cpumask new;
+	int ret;
+
+	ret = cpulist_parse(val, &new);
+	if (ret)
+		return ret;
+	if (!cpumask_empty(&new) && !cpumask_intersects(&new, cpu_possible_mask))
+		return -EINVAL;
+	cpumask_and(&rcu_nocb_affinity, &new, cpu_possible_mask);
+
+	/* Until then there are no kthreads and spawning applies the mask. */
+	if (rcu_scheduler_fully_active)
+		rcu_nocb_set_affinity();
+	return 0;
+}
+
+static int param_get_nocb_affinity(char *buffer,
+				   const struct kernel_param *kp)
+{
+	return cpulist_scnprintf(buffer, PAGE_SIZE - 1,
+				 rcu_nocb_kthread_mask());
+}
+
+static struct kernel_param_ops nocb_affinity_ops = {
+	.set = param_set_nocb_affinity,
+	.get = param_get_nocb_affinity,
+};
+module_param_cb(rcu_nocb_affinity, &nocb_affinity_ops, NULL, 0644);
+
 /*
  * Wake up any no-CBs CPUs' kthreads that were waiting on the just-ended
  * grace period.
@@ -2567,7 +2638,7 @@ static void nocb_follower_wait(struct rcu_data *rdp)
  */
 static int rcu_nocb_kthread(void *arg)
 {
-	int c, cl;
+	int c, cl, batch;
 	struct rcu_head *list;
 	struct rcu_head *next;
 	struct rcu_head **tail;
@@ -2595,6 +2666,7 @@ static int rcu_nocb_kthread(void *arg)
 		/* Each pass through the following loop invokes a callback. */
 		trace_rcu_batch_start(rdp->rsp->name, cl, c, -1);
 		c = cl = 0;
+		batch = ACCESS_ONCE(rcu_nocb_batch);
 		while (list) {
 			next = list->next;
 			/* Wait for enqueuing to complete, if needed. */
@@ -2613,6 +2685,8 @@ static int rcu_nocb_kthread(void *arg)
 			c++;
 			local_bh_enable();
 			list = next;
+			if (batch > 0 && !(c % batch))
+				cond_resched();
 		}
 		trace_rcu_batch_end(rdp->rsp->name, c, !!list, 0, 0, 1);
 		ACCESS_ONCE(rdp->nocb_p_count) = rdp->nocb_p_count - c;
@@ -2756,6 +2830,7 @@ static void rcu_spawn_one_nocb_kthread(struct rcu_state *rsp, int cpu)
 	t = kthread_run(rcu_nocb_kthread, rdp_spawn,
 			"rcuo%c/%d", rsp->abbr, cpu);
 	BUG_ON(IS_ERR(t));
+	set_cpus_allowed_ptr(t, rcu_nocb_kthread_mask());
 	ACCESS_ONCE(rdp_spawn->nocb_kthread) = t;
 }
 
@@ -702,13 +702,14 @@ int get_nohz_timer_target(int pinned)
 	int i;
 	struct sched_domain *sd;
 
-	if (pinned || !get_sysctl_timer_migration() || !idle_cpu(cpu))
+	if (pinned || !get_sysctl_timer_migration() ||
+	    (!idle_cpu(cpu) && !cpu_isolated(cpu)))
 		return cpu;
 
 	rcu_read_lock();
 	for_each_domain(cpu, sd) {
 		for_each_cpu(i, sched_domain_span(sd)) {
-			if (!idle_cpu(i)) {
+			if (!idle_cpu(i) && !cpu_isolated(i)) {
 				cpu = i;
 				goto unlock;
 			}
@@ -1000,6 +1001,8 @@ static inline void enqueue_task(struct rq *rq, struct task_struct *p, int flags)
 	update_rq_clock(rq);
 	if (!(flags & ENQUEUE_RESTORE))
 		sched_info_queued(rq, p);
+	if (flags & ENQUEUE_WAKEUP)
+		sched_info_woken(p);
 	p->sched_class->enqueue_task(rq, p, flags);
 	trace_sched_enq_deq_task(p, 1, cpumask_bits(&p->cpus_allowed)[0]);
 }
@@ -1681,6 +1684,116 @@ unsigned int sched_get_static_cluster_pwr_cost(int cpu)
 	return cpu_rq(cpu)->cluster->static_cluster_pwr_cost;
 }
 
+int sched_set_cluster_migration_cost(int cpu, int dst_cluster,
+				     unsigned int cost)
+{
+	struct sched_cluster *cluster = cpu_rq(cpu)->cluster;
+
+	if (dst_cluster < 0 || dst_cluster >= num_clusters)
+		return -EINVAL;
+
+	cluster->migration_cost[dst_cluster] = cost;
+	return 0;
+}
+
+int sched_get_cluster_migration_cost(int cpu, int dst_cluster)
+{
+	if (dst_cluster < 0 || dst_cluster >= num_clusters)
+		return -EINVAL;
+
+	return cpu_rq(cpu)->cluster->migration_cost[dst_cluster];
+}
+
+/*
+ * Cross-cluster migration cost is estimated at boot by dirtying a buffer
+ * the size of a cluster's L2 on one cluster and timing a walk over it on
+ * another, less the time the same walk takes once the buffer is warm in
+ * the destination cluster.
+ */
+#define MIGRATION_COST_BUF_SIZE		(512 * 1024)
+#define MIGRATION_COST_ITERATIONS	3
+
+static long migration_cost_walk(void *data)
+{
+	unsigned long *buf = data;
+	unsigned int stride = cache_line_size() / sizeof(*buf);
+	unsigned int i, n = MIGRATION_COST_BUF_SIZE / sizeof(*buf);
+	u64 start, end;
+
+	preempt_disable();
+	start = sched_clock();
+	for (i = 0; i < n; i += stride)
+		buf[i]++;
+	end = sched_clock();
+	preempt_enable();
+
+	return (long)(end - start);
+}
+
+static u64 measure_migration_cost(int src_cpu, int dst_cpu, void *buf)
+{
+	u64 cost = U64_MAX;
+	long cold, warm;
+	int i;
+
+	for (i = 0; i < MIGRATION_COST_ITERATIONS; i++) {
+		work_on_cpu(src_cpu, migration_cost_walk, buf);
+		cold = work_on_cpu(dst_cpu, migration_cost_walk, buf);
+		warm = work_on_cpu(dst_cpu, migration_cost_walk, buf);
+
+		if (cold < warm)
+			cold = warm;
+		cost = min_t(u64, cost, cold - warm);
+	}
+
+	return cost;
+}
+
+static int __init sched_init_migration_cost(void)
+{
+	struct sched_cluster *src, *dst;
+	void *buf;
+
+	if (num_clusters < 2)
+		return 0;
+
+	buf = vmalloc(MIGRATION_COST_BUF_SIZE);
+	if (!buf)
+		return -ENOMEM;
+	memset(buf, 0, MIGRATION_COST_BUF_SIZE);
+
+	get_online_cpus();
+	for_each_sched_cluster(src) {
+		int src_cpu = cpumask_first_and(&src->cpus, cpu_online_mask);
+
+		if (src_cpu >= nr_cpu_ids)
+			continue;
+
+		for_each_sched_cluster(dst) {
+			int dst_cpu;
+
+			if (dst == src)
+				continue;
+
+			dst_cpu = cpumask_first_and(&dst->cpus,
+						    cpu_online_mask);
+			if (dst_cpu >= nr_cpu_ids)
+				continue;
+
+			src->migration_cost[dst->id] =
+				measure_migration_cost(src_cpu, dst_cpu, buf);
+			pr_info("sched: cluster %d -> %d migration cost %u ns\n",
+				src->id, dst->id,
+				src->migration_cost[dst->id]);
+		}
+	}
+	put_online_cpus();
+
+	vfree(buf);
+	return 0;
+}
+late_initcall(sched_init_migration_cost);
+
 #else
 
 static inline int got_boost_kick(void)
@@ -2076,7 +2189,7 @@ void check_for_freq_change(struct rq *rq, bool check_pred, bool check_groups)
 		return;
 
 	atomic_notifier_call_chain(
-		&load_alert_notifier_head, 0,
+		&load_alert_notifier_head, LOAD_ALERT_FREQ_CHANGE,
 		(void *)(long)cpu);
 }
 
@@ -4666,6 +4779,22 @@ EXPORT_SYMBOL_GPL(kick_process);
 #endif /* CONFIG_SMP */
 
 #ifdef CONFIG_SMP
+/*
+ * Pick a cpu other than @cpu for @p, avoiding isolated cpus. Returns @cpu
+ * if @p is not allowed to run anywhere else.
+ */
+static int select_unisolated_cpu(int cpu, struct task_struct *p)
+{
+	int dest_cpu;
+
+	for_each_cpu_and(dest_cpu, tsk_cpus_allowed(p), cpu_active_mask) {
+		if (dest_cpu != cpu && !cpu_isolated(dest_cpu))
+			return dest_cpu;
+	}
+
+	return cpu;
+}
+
 /*
  * ->cpus_allowed is protected by both rq->lock and p->pi_lock
  */
@@ -4760,6 +4889,8 @@ int select_task_rq(struct task_struct *p, int cpu, int sd_flags, int wake_flags)
 	if (unlikely(!cpumask_test_cpu(cpu, tsk_cpus_allowed(p)) ||
 		     !cpu_online(cpu)))
 		cpu = select_fallback_rq(task_cpu(p), p);
+	else if (unlikely(cpu_isolated(cpu)))
+		cpu = select_unisolated_cpu(cpu, p);
 
 	return cpu;
 }
@@ -5063,6 +5194,7 @@ try_to_wake_up(struct task_struct *p, unsigned int state, int wake_flags)
 		goto out;
 
 	success = 1; /* we're going to change ->state */
+	sched_info_set_waker(p);
 
 	if (p->on_rq && ttwu_remote(p, wake_flags))
 		goto stat;
@@ -5190,6 +5322,7 @@ static void try_to_wake_up_local(struct task_struct *p)
 
 		update_task_ravg(rq->curr, rq, TASK_UPDATE, wallclock, 0);
 		update_task_ravg(p, rq, TASK_WAKE, wallclock, 0);
+		sched_info_set_waker(p);
 		ttwu_activate(rq, p, ENQUEUE_WAKEUP);
 		set_task_last_wake(p, wallclock);
 	}
@@ -6025,11 +6158,21 @@ static bool early_detection_notify(struct rq *rq, u64 wallclock)
 
 	return 0;
 }
+
+static inline u64 rq_window_start(struct rq *rq)
+{
+	return rq->window_start;
+}
 #else /* CONFIG_SCHED_HMP */
 static bool early_detection_notify(struct rq *rq, u64 wallclock)
 {
 	return 0;
 }
+
+static inline u64 rq_window_start(struct rq *rq)
+{
+	return 0;
+}
 #endif /* CONFIG_SCHED_HMP */
 
 /*
@@ -6041,8 +6184,8 @@ void scheduler_tick(void)
 	int cpu = smp_processor_id();
 	struct rq *rq = cpu_rq(cpu);
 	struct task_struct *curr = rq->curr;
-	u64 wallclock;
-	bool early_notif;
+	u64 wallclock, window_start;
+	bool early_notif, window_rollover;
 	u32 old_load;
 	struct related_thread_group *grp;
 
@@ -6051,17 +6194,29 @@ void scheduler_tick(void)
 	raw_spin_lock(&rq->lock);
 	old_load = task_load(curr);
 	set_window_start(rq);
+	window_start = rq_window_start(rq);
 	update_rq_clock(rq);
 	curr->sched_class->task_tick(rq, curr, 0);
 	update_cpu_load_active(rq);
 	wallclock = sched_ktime_clock();
 	update_task_ravg(rq->curr, rq, TASK_UPDATE, wallclock, 0);
 	early_notif = early_detection_notify(rq, wallclock);
+	window_rollover = window_start && rq_window_start(rq) != window_start;
 	raw_spin_unlock(&rq->lock);
 
 	if (early_notif)
 		atomic_notifier_call_chain(&load_alert_notifier_head,
-					0, (void *)(long)cpu);
+					LOAD_ALERT_FREQ_CHANGE,
+					(void *)(long)cpu);
+
+	/*
+	 * Let governors evaluate the window that just completed right away
+	 * instead of waiting for their own sampling timer.
+	 */
+	if (window_rollover)
+		atomic_notifier_call_chain(&load_alert_notifier_head,
+					LOAD_ALERT_WINDOW_ROLLOVER,
+					(void *)(long)cpu);
 
 	perf_event_task_tick();
 
@@ -6802,6 +6957,34 @@ struct task_struct *idle_task(int cpu)
 	return cpu_rq(cpu)->idle;
 }
 
+/**
+ * sched_cpu_snapshot - peek at the runqueue of a given cpu.
+ * @cpu: the processor in question.
+ * @snap: filled in with the current task and runqueue counts.
+ *
+ * Takes no rq lock so that it works on a cpu stuck with it held. The
+ * result may be inconsistent and is for hang diagnostics only. A stale
+ * rq clock on a busy cpu means that it has not taken a tick since.
+ */
+void sched_cpu_snapshot(int cpu, struct sched_cpu_snapshot *snap)
+{
+	struct rq *rq = cpu_rq(cpu);
+	struct task_struct *p;
+
+	rcu_read_lock();
+	p = ACCESS_ONCE(rq->curr);
+	snap->pid = task_pid_nr(p);
+	snap->prio = p->prio;
+	memcpy(snap->comm, p->comm, sizeof(snap->comm));
+	snap->comm[sizeof(snap->comm) - 1] = '\0';
+	snap->exec_start = p->se.exec_start;
+	rcu_read_unlock();
+
+	snap->nr_running = ACCESS_ONCE(rq->nr_running);
+	snap->rt_nr_running = ACCESS_ONCE(rq->rt.rt_nr_running);
+	snap->clock = ACCESS_ONCE(rq->clock);
+}
+
 /**
  * find_process_by_pid - find a process with a matching PID value.
  * @pid: the pid in question.
@@ -8455,6 +8638,127 @@ static int migration_cpu_stop(void *data)
 	return 0;
 }
 
+/*
+ * CPU isolation keeps a cpu online but stops placing unpinned tasks,
+ * interrupts and migratable timers on it. Unlike hotplug it doesn't need
+ * stop_machine() or the cpu_hotplug lock, so a cpu can be taken out of
+ * and put back into service cheaply.
+ */
+static DEFINE_MUTEX(cpu_isolation_mutex);
+
+#define ISOLATION_MIGRATE_BATCH 16
+
+/*
+ * Push the queued fair tasks that may run elsewhere off an isolated cpu.
+ * Tasks pinned to it stay, sleeping tasks are kept off it by
+ * select_task_rq() when they wake up.
+ */
+static int do_isolation_work_cpu_stop(void *data)
+{
+	int cpu = smp_processor_id();
+	struct rq *rq = cpu_rq(cpu);
+	struct task_struct *tasks[ISOLATION_MIGRATE_BATCH];
+	struct sched_entity *se;
+	int i, nr;
+
+	local_irq_disable();
+	sched_ttwu_pending();
+
+	do {
+		nr = 0;
+		raw_spin_lock(&rq->lock);
+		list_for_each_entry(se, &rq->cfs_tasks, group_node) {
+			struct task_struct *p =
+				container_of(se, struct task_struct, se);
+
+			if (select_unisolated_cpu(cpu, p) == cpu)
+				continue;
+
+			get_task_struct(p);
+			tasks[nr++] = p;
+			if (nr == ISOLATION_MIGRATE_BATCH)
+				break;
+		}
+		raw_spin_unlock(&rq->lock);
+
+		for (i = 0; i < nr; i++) {
+			__migrate_task(tasks[i], cpu,
+				       select_unisolated_cpu(cpu, tasks[i]));
+			put_task_struct(tasks[i]);
+		}
+	} while (nr == ISOLATION_MIGRATE_BATCH);
+
+	local_irq_enable();
+	return 0;
+}
+
+/**
+ * sched_isolate_cpu - stop using an online cpu for unpinned work
+ * @cpu: the cpu to isolate
+ *
+ * Marks @cpu in cpu_isolated_mask, steers interrupts away from it and
+ * migrates the tasks queued on it that are allowed to run elsewhere.
+ * At least one online cpu is always left unisolated.
+ *
+ * Return: 0 on success, -EINVAL if @cpu is offline, already isolated or
+ * the last unisolated cpu.
+ */
+int sched_isolate_cpu(int cpu)
+{
+	cpumask_t avail;
+	int ret = 0;
+
+	get_online_cpus();
+	mutex_lock(&cpu_isolation_mutex);
+
+	cpumask_andnot(&avail, cpu_online_mask, cpu_isolated_mask);
+	if (!cpumask_test_cpu(cpu, &avail) || cpumask_weight(&avail) == 1) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	set_cpu_isolated(cpu, true);
+	irq_migrate_isolated(cpu);
+	stop_one_cpu(cpu, do_isolation_work_cpu_stop, NULL);
+
+out:
+	mutex_unlock(&cpu_isolation_mutex);
+	put_online_cpus();
+	return ret;
+}
+
+/**
+ * sched_unisolate_cpu - return an isolated cpu to service
+ * @cpu: the cpu to unisolate
+ *
+ * This can be called on an offline cpu, e.g. from a CPU_DEAD notifier,
+ * so the cpu does not come back online isolated.
+ *
+ * Return: 0 on success, -EINVAL if @cpu is not isolated.
+ */
+int sched_unisolate_cpu(int cpu)
+{
+	int ret = 0;
+
+	mutex_lock(&cpu_isolation_mutex);
+
+	if (!cpu_isolated(cpu)) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	set_cpu_isolated(cpu, false);
+	if (cpu_online(cpu)) {
+		irq_migrate_isolated(cpu);
+		/* let the idle cpu pull work through the next idle balance */
+		wake_up_if_idle(cpu);
+	}
+
+out:
+	mutex_unlock(&cpu_isolation_mutex);
+	return ret;
+}
+
 #ifdef CONFIG_HOTPLUG_CPU
 
 /*
@@ -20,6 +20,8 @@
 #include <linux/sched.h>
 #include <linux/sched/rt.h>
 #include <linux/mutex.h>
+#include <linux/module.h>
+#include <linux/sched/core_ctl.h>
 
 #include <trace/events/sched.h>
 
@@ -29,6 +31,7 @@ struct cpu_data {
 	/* Per CPU data. */
 	bool	inited;
 	bool	online;
+	bool	isolated;
 	bool	rejected;
 	bool	is_busy;
 	bool    not_preferred;
@@ -41,10 +44,12 @@ struct cpu_data {
 	/* Per cluster data set only on first CPU */
 	unsigned int min_cpus;
 	unsigned int max_cpus;
+	unsigned int boost_min_cpus;
 	unsigned int offline_delay_ms;
 	unsigned int busy_up_thres[MAX_CPUS_PER_GROUP];
 	unsigned int busy_down_thres[MAX_CPUS_PER_GROUP];
 	unsigned int online_cpus;
+	unsigned int nr_isolated;
 	unsigned int avail_cpus;
 	unsigned int num_cpus;
 	unsigned int need_cpus;
@@ -61,6 +66,7 @@ struct cpu_data {
 	struct kobject kobj;
 	struct list_head pending_lru;
 	bool disabled;
+	bool use_isolation;
 };
 
 static DEFINE_PER_CPU(struct cpu_data, cpu_state);
@@ -73,6 +79,12 @@ static void wake_up_hotplug_thread(struct cpu_data *state);
 static void add_to_pending_lru(struct cpu_data *state);
 static void update_lru(struct cpu_data *state);
 
+/* CPUs that are online and not isolated, i.e. available to the scheduler */
+static unsigned int get_active_cpu_count(const struct cpu_data *f)
+{
+	return f->online_cpus - f->nr_isolated;
+}
+
 /* ========================= sysfs interface =========================== */
 
 static ssize_t store_min_cpus(struct cpu_data *state,
@@ -247,7 +259,8 @@ static ssize_t show_cpus(struct cpu_data *state, char *buf)
 	list_for_each_entry(c, &state->lru, sib) {
 		count += snprintf(buf + count, PAGE_SIZE - count,
 					"CPU%u (%s)\n", c->cpu,
-					c->online ? "Online" : "Offline");
+					!c->online ? "Offline" :
+					c->isolated ? "Isolated" : "Online");
 	}
 	spin_unlock_irqrestore(&state_lock, flags);
 	return count;
@@ -279,6 +292,8 @@ static ssize_t show_global_state(struct cpu_data *state, char *buf)
 					"\tCPU: %u\n", c->cpu);
 		count += snprintf(buf + count, PAGE_SIZE - count,
 					"\tOnline: %u\n", c->online);
+		count += snprintf(buf + count, PAGE_SIZE - count,
+					"\tIsolated: %u\n", c->isolated);
 		count += snprintf(buf + count, PAGE_SIZE - count,
 					"\tRejected: %u\n", c->rejected);
 		count += snprintf(buf + count, PAGE_SIZE - count,
@@ -293,8 +308,14 @@ static ssize_t show_global_state(struct cpu_data *state, char *buf)
 					"\tNr running: %u\n", c->nrrun);
 		count += snprintf(buf + count, PAGE_SIZE - count,
 					"\tAvail CPUs: %u\n", c->avail_cpus);
+		count += snprintf(buf + count, PAGE_SIZE - count,
+					"\tActive CPUs: %u\n",
+					get_active_cpu_count(c));
 		count += snprintf(buf + count, PAGE_SIZE - count,
 					"\tNeed CPUs: %u\n", c->need_cpus);
+		count += snprintf(buf + count, PAGE_SIZE - count,
+					"\tBoost min CPUs: %u\n",
+					c->boost_min_cpus);
 		count += snprintf(buf + count, PAGE_SIZE - count,
 					"\tStatus: %s\n",
 					c->disabled ? "disabled" : "enabled");
@@ -371,6 +392,30 @@ static ssize_t show_disable(struct cpu_data *state, char *buf)
 	return snprintf(buf, PAGE_SIZE, "%u\n", state->disabled);
 }
 
+static ssize_t store_use_isolation(struct cpu_data *state,
+				const char *buf, size_t count)
+{
+	unsigned int val;
+
+	if (sscanf(buf, "%u\n", &val) != 1)
+		return -EINVAL;
+
+	val = !!val;
+
+	if (state->use_isolation == val)
+		return count;
+
+	state->use_isolation = val;
+	wake_up_hotplug_thread(state);
+
+	return count;
+}
+
+static ssize_t show_use_isolation(struct cpu_data *state, char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%u\n", state->use_isolation);
+}
+
 struct core_ctl_attr {
 	struct attribute attr;
 	ssize_t (*show)(struct cpu_data *, char *);
@@ -398,6 +443,7 @@ core_ctl_attr_ro(online_cpus);
 core_ctl_attr_ro(global_state);
 core_ctl_attr_rw(not_preferred);
 core_ctl_attr_rw(disable);
+core_ctl_attr_rw(use_isolation);
 
 static struct attribute *default_attrs[] = {
 	&min_cpus.attr,
@@ -413,6 +459,7 @@ static struct attribute *default_attrs[] = {
 	&global_state.attr,
 	&not_preferred.attr,
 	&disable.attr,
+	&use_isolation.attr,
 	NULL
 };
 
@@ -555,7 +602,9 @@ static void rq_avg_timer_func(unsigned long not_used)
 
 static unsigned int apply_limits(struct cpu_data *f, unsigned int need_cpus)
 {
-	return min(max(f->min_cpus, need_cpus), f->max_cpus);
+	unsigned int min_cpus = max(f->min_cpus, f->boost_min_cpus);
+
+	return min(max(min_cpus, need_cpus), f->max_cpus);
 }
 
 static bool eval_need(struct cpu_data *f)
@@ -571,7 +620,7 @@ static bool eval_need(struct cpu_data *f)
 		return 0;
 
 	spin_lock_irqsave(&state_lock, flags);
-	thres_idx = f->online_cpus ? f->online_cpus - 1 : 0;
+	thres_idx = get_active_cpu_count(f) ? get_active_cpu_count(f) - 1 : 0;
 	list_for_each_entry(c, &f->lru, sib) {
 		if (c->busy >= f->busy_up_thres[thres_idx])
 			c->is_busy = true;
@@ -643,6 +692,37 @@ static int core_ctl_set_busy(unsigned int cpu, unsigned int busy)
 	return 0;
 }
 
+/**
+ * core_ctl_set_boost_min_cpus - raise the minimum active CPUs of a cluster
+ * @cpu:	any CPU of the cluster
+ * @min_cpus:	minimum number of active CPUs, 0 to drop the boost
+ *
+ * This is a temporary floor on top of the min_cpus tunable, for callers
+ * that boost a cluster for a short time such as cpu-boost.
+ */
+int core_ctl_set_boost_min_cpus(unsigned int cpu, unsigned int min_cpus)
+{
+	struct cpu_data *c, *f;
+
+	if (cpu >= nr_cpu_ids)
+		return -EINVAL;
+
+	c = &per_cpu(cpu_state, cpu);
+	if (!c->inited)
+		return -EINVAL;
+
+	f = &per_cpu(cpu_state, c->first_cpu);
+	min_cpus = min(min_cpus, f->num_cpus);
+	if (f->boost_min_cpus == min_cpus)
+		return 0;
+
+	f->boost_min_cpus = min_cpus;
+	wake_up_hotplug_thread(f);
+
+	return 0;
+}
+EXPORT_SYMBOL(core_ctl_set_boost_min_cpus);
+
 /* ========================= core count enforcement ==================== */
 
 /*
@@ -731,6 +811,58 @@ static int core_ctl_offline_core(unsigned int cpu)
 	return ret;
 }
 
+static void core_ctl_clear_isolated(struct cpu_data *f, struct cpu_data *c)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&state_lock, flags);
+	if (c->isolated) {
+		c->isolated = false;
+		f->nr_isolated--;
+	}
+	spin_unlock_irqrestore(&state_lock, flags);
+}
+
+/*
+ * Take a CPU out of service. With use_isolation the CPU stays online and
+ * is only isolated from the scheduler, which is much cheaper to undo than
+ * a hotplug cycle; if isolation is refused fall back to offlining it.
+ */
+static void core_ctl_deactivate_core(struct cpu_data *f, struct cpu_data *c)
+{
+	unsigned long flags;
+
+	if (f->use_isolation) {
+		pr_debug("Trying to Isolate CPU%u\n", c->cpu);
+		if (!sched_isolate_cpu(c->cpu)) {
+			spin_lock_irqsave(&state_lock, flags);
+			c->isolated = true;
+			f->nr_isolated++;
+			spin_unlock_irqrestore(&state_lock, flags);
+			return;
+		}
+		pr_debug("Unable to Isolate CPU%u\n", c->cpu);
+	}
+
+	pr_debug("Trying to Offline CPU%u\n", c->cpu);
+	if (core_ctl_offline_core(c->cpu))
+		pr_debug("Unable to Offline CPU%u\n", c->cpu);
+}
+
+static void core_ctl_activate_core(struct cpu_data *f, struct cpu_data *c)
+{
+	if (c->isolated) {
+		pr_debug("Trying to Unisolate CPU%u\n", c->cpu);
+		sched_unisolate_cpu(c->cpu);
+		core_ctl_clear_isolated(f, c);
+		return;
+	}
+
+	pr_debug("Trying to Online CPU%u\n", c->cpu);
+	if (core_ctl_online_core(c->cpu))
+		pr_debug("Unable to Online CPU%u\n", c->cpu);
+}
+
 static void update_lru(struct cpu_data *f)
 {
 	struct cpu_data *c, *tmp;
@@ -758,66 +890,79 @@ static void __ref do_hotplug(struct cpu_data *f)
 	pr_debug("Trying to adjust group %u to %u\n", f->first_cpu, need);
 
 	mutex_lock(&lru_lock);
-	if (f->online_cpus > need) {
+
+	/* Isolation was turned off, hand isolated CPUs back first */
+	if (!f->use_isolation && f->nr_isolated) {
+		list_for_each_entry_safe(c, tmp, &f->lru, sib) {
+			if (c->isolated)
+				core_ctl_activate_core(f, c);
+		}
+	}
+
+	if (get_active_cpu_count(f) > need) {
 		list_for_each_entry_safe(c, tmp, &f->lru, sib) {
-			if (!c->online)
+			if (!c->online || c->isolated)
 				continue;
 
-			if (f->online_cpus == need)
+			if (get_active_cpu_count(f) == need)
 				break;
 
-			/* Don't offline busy CPUs. */
+			/* Don't deactivate busy CPUs. */
 			if (c->is_busy)
 				continue;
 
-			pr_debug("Trying to Offline CPU%u\n", c->cpu);
-			if (core_ctl_offline_core(c->cpu))
-				pr_debug("Unable to Offline CPU%u\n", c->cpu);
+			core_ctl_deactivate_core(f, c);
 		}
 
 		/*
-		 * If the number of online CPUs is within the limits, then
-		 * don't force any busy CPUs offline.
+		 * If the number of active CPUs is within the limits, then
+		 * don't force any busy CPUs out of service.
 		 */
-		if (f->online_cpus <= f->max_cpus)
+		if (get_active_cpu_count(f) <= f->max_cpus)
 			goto done;
 
 		list_for_each_entry_safe(c, tmp, &f->lru, sib) {
-			if (!c->online)
+			if (!c->online || c->isolated)
 				continue;
 
-			if (f->online_cpus <= f->max_cpus)
+			if (get_active_cpu_count(f) <= f->max_cpus)
+				break;
+
+			core_ctl_deactivate_core(f, c);
+		}
+	} else if (get_active_cpu_count(f) < need) {
+		/* Isolated CPUs come back far quicker than offline ones */
+		list_for_each_entry_safe(c, tmp, &f->lru, sib) {
+			if (!c->isolated || c->not_preferred)
+				continue;
+			if (get_active_cpu_count(f) == need)
 				break;
 
-			pr_debug("Trying to Offline CPU%u\n", c->cpu);
-			if (core_ctl_offline_core(c->cpu))
-				pr_debug("Unable to Offline CPU%u\n", c->cpu);
+			core_ctl_activate_core(f, c);
 		}
-	} else if (f->online_cpus < need) {
+
 		list_for_each_entry_safe(c, tmp, &f->lru, sib) {
-			if (c->online || c->rejected || c->not_preferred)
+			if ((c->online && !c->isolated) || c->rejected ||
+			    c->not_preferred)
 				continue;
-			if (f->online_cpus == need)
+			if (get_active_cpu_count(f) == need)
 				break;
 
-			pr_debug("Trying to Online CPU%u\n", c->cpu);
-			if (core_ctl_online_core(c->cpu))
-				pr_debug("Unable to Online CPU%u\n", c->cpu);
+			core_ctl_activate_core(f, c);
 		}
 
-		if (f->online_cpus == need)
+		if (get_active_cpu_count(f) == need)
 			goto done;
 
 
 		list_for_each_entry_safe(c, tmp, &f->lru, sib) {
-			if (c->online || c->rejected || !c->not_preferred)
+			if ((c->online && !c->isolated) || c->rejected ||
+			    !c->not_preferred)
 				continue;
-			if (f->online_cpus == need)
+			if (get_active_cpu_count(f) == need)
 				break;
 
-			pr_debug("Trying to Online CPU%u\n", c->cpu);
-			if (core_ctl_online_core(c->cpu))
-				pr_debug("Unable to Online CPU%u\n", c->cpu);
+			core_ctl_activate_core(f, c);
 		}
 	}
 done:
@@ -903,7 +1048,8 @@ static int __ref cpu_callback(struct notifier_block *nfb,
 		 * CPUs than necessary.
 		 */
 		if (!f->disabled &&
-			apply_limits(f, f->need_cpus) <= f->online_cpus) {
+			apply_limits(f, f->need_cpus) <=
+					get_active_cpu_count(f)) {
 			pr_debug("Prevent CPU%d onlining\n", cpu);
 			ret = NOTIFY_BAD;
 		} else {
@@ -964,14 +1110,20 @@ static int __ref cpu_callback(struct notifier_block *nfb,
 			f->avail_cpus--;
 		}
 
+		/* Don't let an isolated CPU come back online isolated. */
+		if (state->isolated) {
+			sched_unisolate_cpu(cpu);
+			core_ctl_clear_isolated(f, state);
+		}
+
 		state->online = false;
 		state->busy = 0;
 		f->online_cpus--;
 		break;
 	}
 
-	if (f->online_cpus < apply_limits(f, f->need_cpus)
-	    && f->online_cpus < f->avail_cpus
+	if (get_active_cpu_count(f) < apply_limits(f, f->need_cpus)
+	    && get_active_cpu_count(f) < f->avail_cpus
 	    && action == CPU_DEAD)
 		wake_up_hotplug_thread(f);
 
@@ -1013,6 +1165,7 @@ static int group_init(struct cpumask *mask)
 	f->avail_cpus  = f->num_cpus;
 	f->offline_delay_ms = 100;
 	f->task_thres = UINT_MAX;
+	f->use_isolation = true;
 	f->nrrun = f->num_cpus;
 	INIT_LIST_HEAD(&f->lru);
 	INIT_LIST_HEAD(&f->pending_lru);
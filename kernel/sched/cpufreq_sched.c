@@ -18,6 +18,7 @@
 #include <trace/events/cpufreq_sched.h>
 
 #include "sched.h"
+#include "tune.h"
 
 #define THROTTLE_DOWN_NSEC	50000000 /* 50ms default */
 #define THROTTLE_UP_NSEC	500000 /* 500us default */
@@ -240,6 +241,8 @@ void update_cpu_capacity_request(int cpu, bool request)
 	new_capacity = scr->cfs + scr->rt;
 	new_capacity = new_capacity * capacity_margin
 		/ SCHED_CAPACITY_SCALE;
+	/* Honour the utilization clamps of the groups RUNNABLE here */
+	new_capacity = schedtune_cpu_util_clamp(cpu, new_capacity);
 	new_capacity += scr->dl;
 
 	if (new_capacity == scr->total)
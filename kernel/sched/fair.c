@@ -32,6 +32,7 @@
 #include <linux/task_work.h>
 
 #include "sched.h"
+#include "tune.h"
 #include <trace/events/sched.h>
 
 /*
@@ -2368,6 +2369,13 @@ unsigned int __read_mostly sysctl_sched_spill_nr_run = 10;
 unsigned int __read_mostly sched_small_wakee_task_load;
 unsigned int __read_mostly sysctl_sched_small_wakee_task_load_pct = 10;
 
+/*
+ * Wake tasks with less than configured demand on a cluster that is not in
+ * a cluster low power mode, so that idle clusters can stay collapsed.
+ */
+unsigned int __read_mostly sched_small_task_pack_load;
+unsigned int __read_mostly sysctl_sched_small_task_pack_pct = 10;
+
 unsigned int __read_mostly sched_big_waker_task_load;
 unsigned int __read_mostly sysctl_sched_big_waker_task_load_pct = 25;
 
@@ -2448,6 +2456,48 @@ sched_long_cpu_selection_threshold = 100 * NSEC_PER_MSEC;
 
 unsigned int __read_mostly sysctl_sched_restrict_cluster_spill;
 
+#ifdef CONFIG_CGROUP_SCHEDTUNE
+/*
+ * Apply the task's schedtune utilization clamps to its placement load.
+ * The clamps are expressed in SCHED_CAPACITY_SCALE units, while window
+ * based loads are scaled to max_task_load().
+ */
+static inline u32 task_clamped_load(struct task_struct *p, u32 load)
+{
+	unsigned long util, clamped;
+
+	util = div64_u64((u64)load << SCHED_CAPACITY_SHIFT, max_task_load());
+	clamped = schedtune_task_util_clamp(p, util);
+	if (clamped == util)
+		return load;
+
+	return ((u64)clamped * max_task_load()) >> SCHED_CAPACITY_SHIFT;
+}
+#else
+#define task_clamped_load(p, load) (load)
+#endif
+
+#ifdef CONFIG_SCHED_FREQ_INPUT
+/*
+ * Size tasks by max(demand, pred_demand) when selecting a cluster, so a
+ * task whose busy-time buckets predict a heavy window is placed on a
+ * cluster that fits it before its windowed demand has caught up.
+ */
+unsigned int __read_mostly sysctl_sched_pred_demand_placement = 1;
+
+static inline u32 task_placement_load(struct task_struct *p)
+{
+	u32 load = task_load(p);
+
+	if (sysctl_sched_pred_demand_placement && !sched_use_pelt)
+		load = max(load, p->ravg.pred_demand);
+
+	return task_clamped_load(p, load);
+}
+#else
+#define task_placement_load(p) task_clamped_load(p, task_load(p))
+#endif
+
 void update_up_down_migrate(void)
 {
 	unsigned int up_migrate = pct_to_real(sysctl_sched_upmigrate_pct);
@@ -2512,6 +2562,10 @@ void set_hmp_defaults(void)
 	sched_big_waker_task_load =
 		div64_u64((u64)sysctl_sched_big_waker_task_load_pct *
 			  (u64)sched_ravg_window, 100);
+
+	sched_small_task_pack_load =
+		div64_u64((u64)sysctl_sched_small_task_pack_pct *
+			  (u64)sched_ravg_window, 100);
 }
 
 u32 sched_get_init_task_load(struct task_struct *p)
@@ -2921,7 +2975,7 @@ select_least_power_cluster(struct cpu_select_env *env)
 	struct sched_cluster *cluster;
 
 	if (env->rtg) {
-		env->task_load = scale_load_to_cpu(task_load(env->p),
+		env->task_load = scale_load_to_cpu(task_placement_load(env->p),
 			cluster_first_cpu(env->rtg->preferred_cluster));
 		return env->rtg->preferred_cluster;
 	}
@@ -2930,8 +2984,8 @@ select_least_power_cluster(struct cpu_select_env *env)
 		if (!skip_cluster(cluster, env)) {
 			int cpu = cluster_first_cpu(cluster);
 
-			env->task_load = scale_load_to_cpu(task_load(env->p),
-									 cpu);
+			env->task_load = scale_load_to_cpu(
+					task_placement_load(env->p), cpu);
 			if (task_load_will_fit(env->p, env->task_load, cpu))
 				return cluster;
 
@@ -3031,7 +3085,7 @@ next_best_cluster(struct sched_cluster *cluster, struct cpu_select_env *env,
 		}
 	} while (!next);
 
-	env->task_load = scale_load_to_cpu(task_load(env->p),
+	env->task_load = scale_load_to_cpu(task_placement_load(env->p),
 					cluster_first_cpu(next));
 	return next;
 }
@@ -3150,6 +3204,7 @@ static void find_best_cpu_in_cluster(struct sched_cluster *c,
 	struct cpumask search_cpus;
 
 	cpumask_and(&search_cpus, tsk_cpus_allowed(env->p), &c->cpus);
+	cpumask_andnot(&search_cpus, &search_cpus, cpu_isolated_mask);
 	if (env->ignore_prev_cpu)
 		cpumask_clear_cpu(env->prev_cpu, &search_cpus);
 
@@ -3217,7 +3272,7 @@ bias_to_prev_cpu(struct cpu_select_env *env, struct cluster_cpu_stats *stats)
 
 	prev_cpu = env->prev_cpu;
 	if (!cpumask_test_cpu(prev_cpu, tsk_cpus_allowed(task)) ||
-					unlikely(!cpu_active(prev_cpu)))
+	    unlikely(!cpu_active(prev_cpu)) || cpu_isolated(prev_cpu))
 		return false;
 
 	if (task->ravg.mark_start - task->last_cpu_selected_ts >=
@@ -3234,7 +3289,8 @@ bias_to_prev_cpu(struct cpu_select_env *env, struct cluster_cpu_stats *stats)
 					sched_short_sleep_task_threshold)
 		return false;
 
-	env->task_load = scale_load_to_cpu(task_load(task), prev_cpu);
+	env->task_load = scale_load_to_cpu(task_placement_load(task),
+					   prev_cpu);
 	cluster = cpu_rq(prev_cpu)->cluster;
 
 	if (!task_load_will_fit(task, env->task_load, prev_cpu)) {
@@ -3271,16 +3327,108 @@ cluster_allowed(struct task_struct *p, struct sched_cluster *cluster)
 
 	cpumask_and(&tmp_mask, &cluster->cpus, cpu_active_mask);
 	cpumask_and(&tmp_mask, &tmp_mask, &p->cpus_allowed);
+	cpumask_andnot(&tmp_mask, &tmp_mask, cpu_isolated_mask);
 
 	return !cpumask_empty(&tmp_mask);
 }
 
 
+/*
+ * A wakeup that moves a cache-hot task to another cluster has to refill
+ * its working set there. Keep the task on prev_cpu unless the energy saved
+ * by running its demand on the new cpu exceeds the energy spent running
+ * at the new cpu's power for the cluster pair's migration cost.
+ */
+static bool
+migration_cost_exceeds_gain(struct cpu_select_env *env, int target)
+{
+	struct task_struct *p = env->p;
+	int prev_cpu = env->prev_cpu;
+	struct sched_cluster *src = cpu_rq(prev_cpu)->cluster;
+	struct sched_cluster *dst = cpu_rq(target)->cluster;
+	unsigned int mig_cost = src->migration_cost[dst->id];
+	u64 gain, cost;
+	int prev_pc, target_pc;
+
+	if (src == dst || !mig_cost || env->reason || env->boost ||
+	    env->need_idle || env->rtg)
+		return false;
+
+	if (!p->ravg.mark_start || p->ravg.mark_start -
+	    p->last_switch_out_ts >= sched_short_sleep_task_threshold)
+		return false;
+
+	if (!cpumask_test_cpu(prev_cpu, tsk_cpus_allowed(p)) ||
+	    unlikely(!cpu_active(prev_cpu)) || cpu_isolated(prev_cpu))
+		return false;
+
+	env->task_load = scale_load_to_cpu(task_placement_load(p), prev_cpu);
+	env->cpu_load = cpu_load_sync(prev_cpu, env->sync);
+	if (!task_load_will_fit(p, env->task_load, prev_cpu) ||
+	    sched_cpu_high_irqload(prev_cpu) ||
+	    spill_threshold_crossed(env, cpu_rq(prev_cpu)))
+		return false;
+
+	prev_pc = power_cost(prev_cpu, task_load(p) +
+			     cpu_cravg_sync(prev_cpu, env->sync));
+	target_pc = power_cost(target, task_load(p) +
+			       cpu_cravg_sync(target, env->sync));
+
+	gain = prev_pc > target_pc ?
+		(u64)(prev_pc - target_pc) * task_load(p) : 0;
+	cost = (u64)target_pc * mig_cost;
+
+	if (gain > cost)
+		return false;
+
+	trace_sched_migration_cost_suppressed(p, prev_cpu, target, mig_cost,
+					      gain, cost);
+	return true;
+}
+
+/*
+ * If the cluster picked for a small task has entered a cluster low power
+ * mode (dstate is set by the LPM driver), look for another candidate
+ * cluster that is still awake and can fit the task.
+ */
+static struct sched_cluster *
+small_task_pack_cluster(struct cpu_select_env *env,
+			struct sched_cluster *cluster)
+{
+	struct sched_cluster *c;
+	u64 load;
+
+	if (!cluster->dstate || !sched_small_task_pack_load ||
+	    env->reason || env->boost || env->need_idle || env->rtg ||
+	    env->need_waker_cluster ||
+	    task_load(env->p) >= sched_small_task_pack_load)
+		return NULL;
+
+	for_each_sched_cluster(c) {
+		if (c == cluster || c->dstate ||
+		    !test_bit(c->id, env->candidate_list) ||
+		    !cluster_allowed(env->p, c))
+			continue;
+
+		load = scale_load_to_cpu(task_placement_load(env->p),
+					      cluster_first_cpu(c));
+		if (!task_load_will_fit(env->p, load,
+					cluster_first_cpu(c)))
+			continue;
+
+		env->task_load = load;
+		return c;
+	}
+
+	return NULL;
+}
+
 /* return cheapest cpu that can fit this task */
 static int select_best_cpu(struct task_struct *p, int target, int reason,
 			   int sync)
 {
 	struct sched_cluster *cluster, *pref_cluster = NULL;
+	struct sched_cluster *pack_cluster;
 	struct cluster_cpu_stats stats;
 	bool fast_path = false;
 	struct related_thread_group *grp;
@@ -3347,9 +3495,17 @@ retry:
 	 * mostly_idle/idle cpus
 	 */
 
+	pack_cluster = small_task_pack_cluster(&env, cluster);
+	if (pack_cluster)
+		cluster = pack_cluster;
+
 	do {
 		find_best_cpu_in_cluster(cluster, &env, &stats);
 
+		/* Don't wake the collapsed cluster if the awake one will do */
+		if (pack_cluster && stats.best_cpu >= 0)
+			break;
+
 	} while ((cluster = next_best_cluster(cluster, &env, &stats)));
 
 	if (env.need_idle) {
@@ -3363,6 +3519,9 @@ retry:
 			stats.best_cpu = stats.best_sibling_cpu;
 
 		target = stats.best_cpu;
+		if (target != env.prev_cpu &&
+		    migration_cost_exceeds_gain(&env, target))
+			target = env.prev_cpu;
 	} else {
 		if (env.rtg) {
 			env.rtg = NULL;
@@ -7365,7 +7524,8 @@ int can_migrate_task(struct task_struct *p, struct lb_env *env)
 
 		/* Prevent to re-select dst_cpu via env's cpus */
 		for_each_cpu_and(cpu, env->dst_grpmask, env->cpus) {
-			if (cpumask_test_cpu(cpu, tsk_cpus_allowed(p))) {
+			if (cpumask_test_cpu(cpu, tsk_cpus_allowed(p)) &&
+			    !cpu_isolated(cpu)) {
 				env->flags |= LBF_DST_PINNED;
 				env->new_dst_cpu = cpu;
 				break;
@@ -7950,9 +8110,118 @@ static unsigned long scale_rt_capacity(int cpu)
 	return div_u64(available, total);
 }
 
+/*
+ * Capacity lost to thermal limits, in SCHED_CAPACITY_SCALE units of the
+ * cpu's maximum. The limit drivers publish it when they decide on a new
+ * limit, so placement and load balancing react before the cpufreq cap has
+ * been applied and shows up in the frequency scaling. 'loss' integrates
+ * the pressure over time, in capacity units * us.
+ */
+struct thermal_pressure {
+	unsigned long src[SCHED_THERMAL_NR];
+	unsigned long pressure;
+	u64 loss;
+	u64 stamp;
+};
+
+static DEFINE_PER_CPU(struct thermal_pressure, thermal_pressure);
+static DEFINE_SPINLOCK(thermal_pressure_lock);
+
+static inline unsigned long thermal_capacity(int cpu)
+{
+	return SCHED_CAPACITY_SCALE -
+		ACCESS_ONCE(per_cpu(thermal_pressure, cpu).pressure);
+}
+
+#ifdef CONFIG_SCHED_HMP
+/*
+ * HMP sizes clusters from their maximum frequency, so express the pressure
+ * as a thermal frequency limit. The cpufreq policy update that follows
+ * will report the same limit once it is applied.
+ */
+static void thermal_pressure_update_clusters(const struct cpumask *cpus)
+{
+	struct sched_cluster *cluster;
+	struct cpumask cpumask;
+	unsigned long pressure;
+	u32 fmax;
+	int i;
+
+	cpumask_copy(&cpumask, cpus);
+	for_each_cpu(i, &cpumask) {
+		cluster = cpu_rq(i)->cluster;
+		cpumask_andnot(&cpumask, &cpumask, &cluster->cpus);
+
+		if (!cluster->freq_init_done)
+			continue;
+
+		pressure = SCHED_CAPACITY_SCALE - thermal_capacity(i);
+		fmax = pressure ? mult_frac(cluster->max_possible_freq,
+					    SCHED_CAPACITY_SCALE - pressure,
+					    SCHED_CAPACITY_SCALE) : UINT_MAX;
+		sched_update_cpu_freq_min_max(&cluster->cpus, 0, fmax);
+	}
+}
+#else
+static inline void thermal_pressure_update_clusters(const struct cpumask *cpus)
+{
+}
+#endif
+
+/**
+ * sched_set_thermal_pressure
+ * @cpus: The cpus whose capacity is limited.
+ * @src: The limit driver publishing the value.
+ * @pressure: Capacity lost, in SCHED_CAPACITY_SCALE units of the maximum.
+ *
+ * Must be called from process context.
+ */
+void sched_set_thermal_pressure(const struct cpumask *cpus,
+				enum sched_thermal_src src,
+				unsigned long pressure)
+{
+	struct thermal_pressure *tp;
+	unsigned long flags, old;
+	bool changed = false;
+	u64 now;
+	int cpu, i;
+
+	if (src >= SCHED_THERMAL_NR)
+		return;
+
+	pressure = min_t(unsigned long, pressure, SCHED_CAPACITY_SCALE - 1);
+
+	spin_lock_irqsave(&thermal_pressure_lock, flags);
+	now = ktime_get_ns();
+	for_each_cpu(cpu, cpus) {
+		tp = &per_cpu(thermal_pressure, cpu);
+		tp->loss += (u64)tp->pressure *
+			div64_u64(now - tp->stamp, NSEC_PER_USEC);
+		tp->stamp = now;
+		tp->src[src] = pressure;
+
+		old = tp->pressure;
+		tp->pressure = 0;
+		for (i = 0; i < SCHED_THERMAL_NR; i++)
+			tp->pressure = max(tp->pressure, tp->src[i]);
+
+		if (tp->pressure != old) {
+			changed = true;
+			trace_sched_thermal_pressure(cpu, src, pressure,
+						     tp->pressure, tp->loss);
+		}
+	}
+	spin_unlock_irqrestore(&thermal_pressure_lock, flags);
+
+	if (changed)
+		thermal_pressure_update_clusters(cpus);
+}
+EXPORT_SYMBOL(sched_set_thermal_pressure);
+
 static void update_cpu_capacity(struct sched_domain *sd, int cpu)
 {
 	unsigned long capacity = SCHED_CAPACITY_SCALE;
+	unsigned long freq_capacity;
 	struct sched_group *sdg = sd->groups;
 
 	if (sched_feat(ARCH_CAPACITY))
@@ -7965,10 +8234,15 @@ static void update_cpu_capacity(struct sched_domain *sd, int cpu)
 	sdg->sgc->capacity_orig = capacity;
 
 	if (sched_feat(ARCH_CAPACITY))
-		capacity *= arch_scale_freq_capacity(sd, cpu);
+		freq_capacity = arch_scale_freq_capacity(sd, cpu);
 	else
-		capacity *= default_scale_capacity(sd, cpu);
+		freq_capacity = default_scale_capacity(sd, cpu);
 
+	/*
+	 * Once the thermal cap is applied the frequency scaling reflects it
+	 * as well, don't count it twice.
+	 */
+	capacity *= min(freq_capacity, thermal_capacity(cpu));
 	capacity >>= SCHED_CAPACITY_SHIFT;
 
 	capacity *= scale_rt_capacity(cpu);
@@ -9263,7 +9537,7 @@ static int idle_balance(struct rq *this_rq)
 	this_rq->idle_stamp = rq_clock(this_rq);
 
 	if (this_rq->avg_idle < sysctl_sched_migration_cost ||
-	    !this_rq->rd->overload) {
+	    !this_rq->rd->overload || cpu_isolated(this_cpu)) {
 		rcu_read_lock();
 		sd = rcu_dereference_check_sched_domain(this_rq->sd);
 		if (sd)
@@ -9732,7 +10006,9 @@ static void rebalance_domains(struct rq *rq, enum cpu_idle_type idle)
 		}
 
 		if (time_after_eq(jiffies, sd->last_balance + interval)) {
-			if (load_balance(cpu, rq, sd, idle, &continue_balancing)) {
+			/* an isolated cpu doesn't pull, it only gets pulled from */
+			if (!cpu_isolated(cpu) &&
+			    load_balance(cpu, rq, sd, idle, &continue_balancing)) {
 				/*
 				 * The LBF_DST_PINNED logic could have changed
 				 * env->dst_cpu, so we can't know our idle
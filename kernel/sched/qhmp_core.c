@@ -894,6 +894,8 @@ static inline void enqueue_task(struct rq *rq, struct task_struct *p, int flags)
 	update_rq_clock(rq);
 	if (!(flags & ENQUEUE_RESTORE))
 		sched_info_queued(rq, p);
+	if (flags & ENQUEUE_WAKEUP)
+		sched_info_woken(p);
 	p->sched_class->enqueue_task(rq, p, flags);
 	trace_sched_enq_deq_task(p, 1, cpumask_bits(&p->cpus_allowed)[0]);
 }
@@ -3463,6 +3465,7 @@ try_to_wake_up(struct task_struct *p, unsigned int state, int wake_flags)
 		goto out;
 
 	success = 1; /* we're going to change ->state */
+	sched_info_set_waker(p);
 
 	if (p->on_rq && ttwu_remote(p, wake_flags))
 		goto stat;
@@ -3582,6 +3585,7 @@ static void try_to_wake_up_local(struct task_struct *p)
 
 		update_task_ravg(rq->curr, rq, TASK_UPDATE, wallclock, 0);
 		update_task_ravg(p, rq, TASK_WAKE, wallclock, 0);
+		sched_info_set_waker(p);
 		ttwu_activate(rq, p, ENQUEUE_WAKEUP);
 	}
 
@@ -5122,6 +5126,34 @@ struct task_struct *idle_task(int cpu)
 	return cpu_rq(cpu)->idle;
 }
 
+/**
+ * sched_cpu_snapshot - peek at the runqueue of a given cpu.
+ * @cpu: the processor in question.
+ * @snap: filled in with the current task and runqueue counts.
+ *
+ * Takes no rq lock so that it works on a cpu stuck with it held. The
+ * result may be inconsistent and is for hang diagnostics only. A stale
+ * rq clock on a busy cpu means that it has not taken a tick since.
+ */
+void sched_cpu_snapshot(int cpu, struct sched_cpu_snapshot *snap)
+{
+	struct rq *rq = cpu_rq(cpu);
+	struct task_struct *p;
+
+	rcu_read_lock();
+	p = ACCESS_ONCE(rq->curr);
+	snap->pid = task_pid_nr(p);
+	snap->prio = p->prio;
+	memcpy(snap->comm, p->comm, sizeof(snap->comm));
+	snap->comm[sizeof(snap->comm) - 1] = '\0';
+	snap->exec_start = p->se.exec_start;
+	rcu_read_unlock();
+
+	snap->nr_running = ACCESS_ONCE(rq->nr_running);
+	snap->rt_nr_running = ACCESS_ONCE(rq->rt.rt_nr_running);
+	snap->clock = ACCESS_ONCE(rq->clock);
+}
+
 /**
  * find_process_by_pid - find a process with a matching PID value.
  * @pid: the pid in question.
@@ -528,6 +528,13 @@ extern struct root_domain def_root_domain;
 
 #endif /* CONFIG_SMP */
 
+#ifdef CONFIG_SCHEDSTATS
+/* rt, top-app, background, other */
+#define SCHED_WAKEUP_NR_CLASSES		4
+/* log2 buckets of 1024ns, the last one open ended */
+#define SCHED_WAKEUP_LAT_BUCKETS	16
+#endif
+
 /*
  * This is the main, per-CPU runqueue data structure.
  *
@@ -699,6 +706,10 @@ struct rq {
 	/* try_to_wake_up() stats */
 	unsigned int ttwu_count;
 	unsigned int ttwu_local;
+
+	/* wakeup to run latency, see rq_sched_wakeup_account() */
+	unsigned int wakeup_lat[SCHED_WAKEUP_NR_CLASSES][2]
+			       [SCHED_WAKEUP_LAT_BUCKETS];
 #endif
 
 #ifdef CONFIG_SMP
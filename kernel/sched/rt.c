@@ -1706,6 +1706,11 @@ static int find_lowest_rq_hmp(struct task_struct *task)
 	if (!cpupri_find(&task_rq(task)->rd->cpupri, task, lowest_mask))
 		return best_cpu; /* No targets found */
 
+	/* Don't push to isolated cpus */
+	cpumask_andnot(lowest_mask, lowest_mask, cpu_isolated_mask);
+	if (cpumask_empty(lowest_mask))
+		return best_cpu;
+
 	/*
 	 * At this point we have built a mask of cpus representing the
 	 * lowest priority tasks in the system.  Now we want to elect
@@ -1770,6 +1775,11 @@ static int find_lowest_rq(struct task_struct *task)
 	if (!cpupri_find(&task_rq(task)->rd->cpupri, task, lowest_mask))
 		return -1; /* No targets found */
 
+	/* Don't push to isolated cpus */
+	cpumask_andnot(lowest_mask, lowest_mask, cpu_isolated_mask);
+	if (cpumask_empty(lowest_mask))
+		return -1;
+
 	/*
 	 * At this point we have built a mask of cpus representing the
 	 * lowest priority tasks in the system.  Now we want to elect
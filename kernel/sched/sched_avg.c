@@ -18,6 +18,10 @@
 #include <linux/hrtimer.h>
 #include <linux/sched.h>
 #include <linux/math64.h>
+#include <linux/gfp.h>
+#include <linux/mm.h>
+#include <linux/mutex.h>
+#include <uapi/linux/rq_stats.h>
 
 #include "sched.h"
 #include <trace/events/sched.h>
@@ -31,6 +35,10 @@ static DEFINE_PER_CPU(unsigned long, iowait_prod_sum);
 static DEFINE_PER_CPU(spinlock_t, nr_lock) = __SPIN_LOCK_UNLOCKED(nr_lock);
 static s64 last_get_time;
 
+static struct rq_stats_page *rq_stats_page;
+static atomic_t rq_stats_page_users = ATOMIC_INIT(0);
+static DEFINE_MUTEX(rq_stats_page_lock);
+
 /**
  * sched_get_nr_running_avg
  * @return: Average nr_running, iowait and nr_big_tasks value since last poll.
@@ -96,6 +104,95 @@ void sched_get_nr_running_avg(int *avg, int *iowait_avg, int *big_avg)
 }
 EXPORT_SYMBOL(sched_get_nr_running_avg);
 
+/*
+ * Publish the current state of @cpu in the shared stats page. The counts
+ * accumulated over the elapsed interval are the ones published by the
+ * previous update, i.e. the ones that were in effect during it.
+ * Called with the cpu's nr_lock held.
+ */
+static void rq_stats_page_update(int cpu, u64 now)
+{
+	struct rq_stats_cpu *s = &rq_stats_page->cpu[cpu];
+	u64 diff = now - s->last_update_ns;
+#if defined(CONFIG_SCHED_HMP) || defined(CONFIG_SCHED_FREQ_INPUT)
+	struct rq *rq = cpu_rq(cpu);
+#endif
+
+	s->seq++;
+	smp_wmb();
+
+	s->nr_prod_sum += (u64)s->nr_running * diff;
+	s->nr_big_prod_sum += (u64)s->nr_big * diff;
+	s->iowait_prod_sum += (u64)s->nr_iowait * diff;
+	s->last_update_ns = now;
+
+	s->nr_running = per_cpu(nr, cpu);
+	s->nr_big = nr_eligible_big_tasks(cpu);
+	s->nr_iowait = nr_iowait_cpu(cpu);
+#ifdef CONFIG_SCHED_HMP
+	s->window_start = rq->window_start;
+	s->cur_freq = cpu_cur_freq(cpu);
+#endif
+#ifdef CONFIG_SCHED_FREQ_INPUT
+	s->prev_busy_us = div64_u64(rq->prev_runnable_sum, NSEC_PER_USEC);
+#endif
+
+	smp_wmb();
+	s->seq++;
+}
+
+/**
+ * sched_rq_stats_page_get
+ * @return: The page holding the shared run-queue statistics, or NULL.
+ *
+ * Takes a reference on the shared stats page. The page is only kept up to
+ * date while at least one reference is held; the first reference restarts
+ * accumulation from the current time.
+ */
+struct page *sched_rq_stats_page_get(void)
+{
+	int cpu;
+
+	if (!rq_stats_page)
+		return NULL;
+
+	mutex_lock(&rq_stats_page_lock);
+	if (!atomic_read(&rq_stats_page_users)) {
+		u64 now = ktime_get_ns();
+
+		for_each_possible_cpu(cpu) {
+			struct rq_stats_cpu *s = &rq_stats_page->cpu[cpu];
+			unsigned long flags;
+
+			spin_lock_irqsave(&per_cpu(nr_lock, cpu), flags);
+			s->nr_prod_sum = 0;
+			s->nr_big_prod_sum = 0;
+			s->iowait_prod_sum = 0;
+			s->last_update_ns = now;
+			rq_stats_page_update(cpu, now);
+			spin_unlock_irqrestore(&per_cpu(nr_lock, cpu), flags);
+		}
+	}
+	atomic_inc(&rq_stats_page_users);
+	mutex_unlock(&rq_stats_page_lock);
+
+	return virt_to_page(rq_stats_page);
+}
+EXPORT_SYMBOL(sched_rq_stats_page_get);
+
+/**
+ * sched_rq_stats_page_put
+ *
+ * Drops a reference taken by sched_rq_stats_page_get().
+ */
+void sched_rq_stats_page_put(void)
+{
+	mutex_lock(&rq_stats_page_lock);
+	WARN_ON(atomic_dec_return(&rq_stats_page_users) < 0);
+	mutex_unlock(&rq_stats_page_lock);
+}
+EXPORT_SYMBOL(sched_rq_stats_page_put);
+
 /**
  * sched_update_nr_prod
  * @cpu: The core id of the nr running driver.
@@ -124,6 +221,25 @@ void sched_update_nr_prod(int cpu, long delta, bool inc)
 	per_cpu(nr_prod_sum, cpu) += nr_running * diff;
 	per_cpu(nr_big_prod_sum, cpu) += nr_eligible_big_tasks(cpu) * diff;
 	per_cpu(iowait_prod_sum, cpu) += nr_iowait_cpu(cpu) * diff;
+
+	if (atomic_read(&rq_stats_page_users))
+		rq_stats_page_update(cpu, ktime_get_ns());
 	spin_unlock_irqrestore(&per_cpu(nr_lock, cpu), flags);
 }
 EXPORT_SYMBOL(sched_update_nr_prod);
+
+static int __init sched_rq_stats_page_init(void)
+{
+	BUILD_BUG_ON(sizeof(struct rq_stats_page) +
+		     NR_CPUS * sizeof(struct rq_stats_cpu) > PAGE_SIZE);
+
+	rq_stats_page = (struct rq_stats_page *)get_zeroed_page(GFP_KERNEL);
+	if (!rq_stats_page)
+		return -ENOMEM;
+
+	rq_stats_page->version = RQ_STATS_PAGE_VERSION;
+	rq_stats_page->nr_cpus = nr_cpu_ids;
+
+	return 0;
+}
+early_initcall(sched_rq_stats_page_init);
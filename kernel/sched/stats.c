@@ -5,12 +5,77 @@
 #include <linux/proc_fs.h>
 
 #include "sched.h"
+#include "tune.h"
 
 /*
  * bump this up when changing the output format or the meaning of an existing
  * format, so that tools can adapt (or abort)
  */
-#define SCHEDSTAT_VERSION 15
+#define SCHEDSTAT_VERSION 16
+
+enum sched_wakeup_class {
+	SCHED_WAKEUP_RT,
+	SCHED_WAKEUP_TOP_APP,
+	SCHED_WAKEUP_BACKGROUND,
+	SCHED_WAKEUP_OTHER,
+};
+
+static const char * const sched_wakeup_class_names[] = {
+	[SCHED_WAKEUP_RT]		= "rt",
+	[SCHED_WAKEUP_TOP_APP]		= "top-app",
+	[SCHED_WAKEUP_BACKGROUND]	= "background",
+	[SCHED_WAKEUP_OTHER]		= "other",
+};
+
+/*
+ * Tasks in a boosted schedtune group are what the framework places in
+ * the foreground (top-app); background is any niced fair task.
+ */
+static enum sched_wakeup_class sched_wakeup_class(struct task_struct *t)
+{
+	if (rt_task(t))
+		return SCHED_WAKEUP_RT;
+#ifdef CONFIG_CGROUP_SCHEDTUNE
+	if (schedtune_task_boost(t) > 0)
+		return SCHED_WAKEUP_TOP_APP;
+#endif
+	if (task_nice(t) > 0)
+		return SCHED_WAKEUP_BACKGROUND;
+	return SCHED_WAKEUP_OTHER;
+}
+
+/*
+ * Called with the rq lock held when a woken task first gets the cpu,
+ * with the time it spent runnable since the wakeup. The wakeup crossed
+ * clusters if it was issued from a cpu of another cluster than the one
+ * the task now runs on.
+ */
+void rq_sched_wakeup_account(struct rq *rq, struct task_struct *t,
+			     unsigned long long delta)
+{
+	int remote = topology_physical_package_id(t->sched_info.waker_cpu) !=
+		     topology_physical_package_id(cpu_of(rq));
+	int bucket = min(fls64(delta >> 10), SCHED_WAKEUP_LAT_BUCKETS - 1);
+
+	rq->wakeup_lat[sched_wakeup_class(t)][remote][bucket]++;
+}
+
+static void show_wakeup_lat(struct seq_file *seq, struct rq *rq)
+{
+	int class, remote, i;
+
+	for (class = 0; class < SCHED_WAKEUP_NR_CLASSES; class++) {
+		for (remote = 0; remote < 2; remote++) {
+			seq_printf(seq, "wakeup_lat %s %s",
+				   sched_wakeup_class_names[class],
+				   remote ? "cross" : "local");
+			for (i = 0; i < SCHED_WAKEUP_LAT_BUCKETS; i++)
+				seq_printf(seq, " %u",
+					   rq->wakeup_lat[class][remote][i]);
+			seq_printf(seq, "\n");
+		}
+	}
+}
 
 static int show_schedstat(struct seq_file *seq, void *v)
 {
@@ -43,6 +108,7 @@ static int show_schedstat(struct seq_file *seq, void *v)
 		    rq->rq_sched_info.run_delay, rq->rq_sched_info.pcount);
 
 		seq_printf(seq, "\n");
+		show_wakeup_lat(seq, rq);
 
 #ifdef CONFIG_SMP
 		/* domain-specific stats */
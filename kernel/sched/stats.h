@@ -32,6 +32,43 @@ rq_sched_info_dequeued(struct rq *rq, unsigned long long delta)
 # define schedstat_inc(rq, field)	do { (rq)->field++; } while (0)
 # define schedstat_add(rq, field, amt)	do { (rq)->field += (amt); } while (0)
 # define schedstat_set(var, val)	do { var = (val); } while (0)
+
+void rq_sched_wakeup_account(struct rq *rq, struct task_struct *t,
+			     unsigned long long delta);
+
+/*
+ * Called from try_to_wake_up(), before the task may be queued on a
+ * remote cpu, so this is the cpu that did the wakeup.
+ */
+static inline void sched_info_set_waker(struct task_struct *t)
+{
+	t->sched_info.waker_cpu = smp_processor_id();
+}
+
+/* Called from enqueue_task() for ENQUEUE_WAKEUP */
+static inline void sched_info_woken(struct task_struct *t)
+{
+	t->sched_info.woken = 1;
+	t->sched_info.wakeup_delay = 0;
+}
+
+static inline void
+sched_wakeup_dequeued(struct task_struct *t, unsigned long long delta)
+{
+	if (t->sched_info.woken)
+		t->sched_info.wakeup_delay += delta;
+}
+
+static inline void
+sched_wakeup_arrive(struct rq *rq, struct task_struct *t,
+		    unsigned long long delta)
+{
+	if (t->sched_info.woken) {
+		t->sched_info.woken = 0;
+		rq_sched_wakeup_account(rq, t,
+					t->sched_info.wakeup_delay + delta);
+	}
+}
 #else /* !CONFIG_SCHEDSTATS */
 static inline void
 rq_sched_info_arrive(struct rq *rq, unsigned long long delta)
@@ -45,6 +82,15 @@ rq_sched_info_depart(struct rq *rq, unsigned long long delta)
 # define schedstat_inc(rq, field)	do { } while (0)
 # define schedstat_add(rq, field, amt)	do { } while (0)
 # define schedstat_set(var, val)	do { } while (0)
+static inline void sched_info_set_waker(struct task_struct *t) {}
+static inline void sched_info_woken(struct task_struct *t) {}
+static inline void
+sched_wakeup_dequeued(struct task_struct *t, unsigned long long delta)
+{}
+static inline void
+sched_wakeup_arrive(struct rq *rq, struct task_struct *t,
+		    unsigned long long delta)
+{}
 #endif
 
 #if defined(CONFIG_SCHEDSTATS) || defined(CONFIG_TASK_DELAY_ACCT)
@@ -70,6 +116,7 @@ static inline void sched_info_dequeued(struct rq *rq, struct task_struct *t)
 	t->sched_info.run_delay += delta;
 
 	rq_sched_info_dequeued(rq, delta);
+	sched_wakeup_dequeued(t, delta);
 }
 
 /*
@@ -89,6 +136,7 @@ static void sched_info_arrive(struct rq *rq, struct task_struct *t)
 	t->sched_info.pcount++;
 
 	rq_sched_info_arrive(rq, delta);
+	sched_wakeup_arrive(rq, t, delta);
 }
 
 /*
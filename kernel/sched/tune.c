@@ -129,6 +129,10 @@ struct schedtune {
 	/* Hint to bias scheduling of tasks on that SchedTune CGroup
 	 * towards idle CPUs */
 	int prefer_idle;
+
+	/* Utilization clamps for tasks on that SchedTune CGroup */
+	unsigned int util_min;
+	unsigned int util_max;
 };
 
 static inline struct schedtune *css_st(struct cgroup_subsys_state *css)
@@ -161,6 +165,8 @@ root_schedtune = {
 	.perf_boost_idx = 0,
 	.perf_constrain_idx = 0,
 	.prefer_idle = 0,
+	.util_min = 0,
+	.util_max = SCHED_CAPACITY_SCALE,
 };
 
 int
@@ -225,9 +231,15 @@ struct boost_groups {
 	/* Maximum boost value for all RUNNABLE tasks on a CPU */
 	bool idle;
 	int boost_max;
+	/* Utilization clamps aggregated over all RUNNABLE boost groups */
+	unsigned int util_min;
+	unsigned int util_max;
 	struct {
 		/* The boost for tasks on that boost group */
 		int boost;
+		/* The utilization clamps for tasks on that boost group */
+		unsigned int util_min;
+		unsigned int util_max;
 		/* Count of RUNNABLE tasks on that boost group */
 		unsigned tasks;
 	} group[BOOSTGROUPS_COUNT];
@@ -238,6 +250,36 @@ struct boost_groups {
 /* Boost groups affecting each CPU in the system */
 static DEFINE_PER_CPU(struct boost_groups, cpu_boost_groups);
 
+static void
+schedtune_cpu_clamp_update(struct boost_groups *bg)
+{
+	unsigned int util_min = 0;
+	unsigned int util_max = 0;
+	bool active = false;
+	int idx;
+
+	/*
+	 * A CPU is clamped by the most permissive RUNNABLE group: the
+	 * highest minimum and the highest maximum, so that a capped
+	 * background group never throttles a co-scheduled foreground one.
+	 */
+	for (idx = 0; idx < BOOSTGROUPS_COUNT; ++idx) {
+		if (bg->group[idx].tasks == 0)
+			continue;
+
+		util_min = max(util_min, bg->group[idx].util_min);
+		util_max = max(util_max, bg->group[idx].util_max);
+		active = true;
+	}
+
+	/* An idle CPU is not clamped at all */
+	if (!active)
+		util_max = SCHED_CAPACITY_SCALE;
+
+	bg->util_min = min(util_min, util_max);
+	bg->util_max = util_max;
+}
+
 static void
 schedtune_cpu_update(int cpu)
 {
@@ -247,6 +289,8 @@ schedtune_cpu_update(int cpu)
 
 	bg = &per_cpu(cpu_boost_groups, cpu);
 
+	schedtune_cpu_clamp_update(bg);
+
 	/* The root boost group is always active */
 	boost_max = bg->group[0].boost;
 	for (idx = 1; idx < BOOSTGROUPS_COUNT; ++idx) {
@@ -309,6 +353,31 @@ schedtune_boostgroup_update(int idx, int boost)
 	return 0;
 }
 
+static int
+schedtune_clampgroup_update(int idx, unsigned int util_min,
+			    unsigned int util_max)
+{
+	struct boost_groups *bg;
+	unsigned long irq_flags;
+	int cpu;
+
+	/* Update per CPU boost groups */
+	for_each_possible_cpu(cpu) {
+		bg = &per_cpu(cpu_boost_groups, cpu);
+
+		raw_spin_lock_irqsave(&bg->lock, irq_flags);
+		bg->group[idx].util_min = util_min;
+		bg->group[idx].util_max = util_max;
+
+		/* Only CPUs where this group is RUNNABLE are affected */
+		if (bg->group[idx].tasks)
+			schedtune_cpu_clamp_update(bg);
+		raw_spin_unlock_irqrestore(&bg->lock, irq_flags);
+	}
+
+	return 0;
+}
+
 #define ENQUEUE_TASK  1
 #define DEQUEUE_TASK -1
 
@@ -535,6 +604,45 @@ int schedtune_task_boost(struct task_struct *p)
 	return task_boost;
 }
 
+/*
+ * Clamp a CPU utilization (in SCHED_CAPACITY_SCALE units) within the
+ * limits of the boost groups currently RUNNABLE on that CPU.
+ * This only reads the per-CPU aggregate, which is refreshed when a boost
+ * group is activated or deactivated on the CPU, thus it is cheap enough
+ * to be used on every capacity request.
+ */
+unsigned long schedtune_cpu_util_clamp(int cpu, unsigned long util)
+{
+	struct boost_groups *bg;
+
+	if (!unlikely(schedtune_initialized))
+		return util;
+
+	bg = &per_cpu(cpu_boost_groups, cpu);
+	return clamp(util, (unsigned long)READ_ONCE(bg->util_min),
+		     (unsigned long)READ_ONCE(bg->util_max));
+}
+
+unsigned long schedtune_task_util_clamp(struct task_struct *p,
+					unsigned long util)
+{
+	struct schedtune *st;
+	unsigned long util_min;
+	unsigned long util_max;
+
+	if (!unlikely(schedtune_initialized))
+		return util;
+
+	/* Get task utilization clamps */
+	rcu_read_lock();
+	st = task_schedtune(p);
+	util_min = st->util_min;
+	util_max = st->util_max;
+	rcu_read_unlock();
+
+	return clamp(util, util_min, util_max);
+}
+
 int schedtune_prefer_idle(struct task_struct *p)
 {
 	struct schedtune *st;
@@ -567,6 +675,54 @@ prefer_idle_write(struct cgroup_subsys_state *css, struct cftype *cft,
 	return 0;
 }
 
+static u64
+util_min_read(struct cgroup_subsys_state *css, struct cftype *cft)
+{
+	struct schedtune *st = css_st(css);
+
+	return st->util_min;
+}
+
+static int
+util_min_write(struct cgroup_subsys_state *css, struct cftype *cft,
+	       u64 util_min)
+{
+	struct schedtune *st = css_st(css);
+
+	if (util_min > st->util_max)
+		return -EINVAL;
+	st->util_min = util_min;
+
+	/* Update CPU clamps */
+	schedtune_clampgroup_update(st->idx, st->util_min, st->util_max);
+
+	return 0;
+}
+
+static u64
+util_max_read(struct cgroup_subsys_state *css, struct cftype *cft)
+{
+	struct schedtune *st = css_st(css);
+
+	return st->util_max;
+}
+
+static int
+util_max_write(struct cgroup_subsys_state *css, struct cftype *cft,
+	       u64 util_max)
+{
+	struct schedtune *st = css_st(css);
+
+	if (util_max > SCHED_CAPACITY_SCALE || util_max < st->util_min)
+		return -EINVAL;
+	st->util_max = util_max;
+
+	/* Update CPU clamps */
+	schedtune_clampgroup_update(st->idx, st->util_min, st->util_max);
+
+	return 0;
+}
+
 static s64
 boost_read(struct cgroup_subsys_state *css, struct cftype *cft)
 {
@@ -627,6 +783,16 @@ static struct cftype files[] = {
 		.read_u64 = prefer_idle_read,
 		.write_u64 = prefer_idle_write,
 	},
+	{
+		.name = "util_min",
+		.read_u64 = util_min_read,
+		.write_u64 = util_min_write,
+	},
+	{
+		.name = "util_max",
+		.read_u64 = util_max_read,
+		.write_u64 = util_max_write,
+	},
 	{ }	/* terminate */
 };
 
@@ -643,6 +809,8 @@ schedtune_boostgroup_init(struct schedtune *st)
 	for_each_possible_cpu(cpu) {
 		bg = &per_cpu(cpu_boost_groups, cpu);
 		bg->group[st->idx].boost = 0;
+		bg->group[st->idx].util_min = st->util_min;
+		bg->group[st->idx].util_max = st->util_max;
 		bg->group[st->idx].tasks = 0;
 	}
 
@@ -680,6 +848,7 @@ schedtune_css_alloc(struct cgroup_subsys_state *parent_css)
 
 	/* Initialize per CPUs boost group support */
 	st->idx = idx;
+	st->util_max = SCHED_CAPACITY_SCALE;
 	if (schedtune_boostgroup_init(st))
 		goto release;
 
@@ -696,6 +865,7 @@ schedtune_boostgroup_release(struct schedtune *st)
 {
 	/* Reset this boost group */
 	schedtune_boostgroup_update(st->idx, 0);
+	schedtune_clampgroup_update(st->idx, 0, SCHED_CAPACITY_SCALE);
 
 	/* Keep track of allocated boost groups */
 	allocated_group[st->idx] = NULL;
@@ -729,6 +899,9 @@ schedtune_init_cgroups(void)
 	for_each_possible_cpu(cpu) {
 		bg = &per_cpu(cpu_boost_groups, cpu);
 		memset(bg, 0, sizeof(struct boost_groups));
+		bg->util_max = SCHED_CAPACITY_SCALE;
+		bg->group[0].util_min = root_schedtune.util_min;
+		bg->group[0].util_max = root_schedtune.util_max;
 		raw_spin_lock_init(&bg->lock);
 	}
 
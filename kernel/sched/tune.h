@@ -19,6 +19,10 @@ int schedtune_task_boost(struct task_struct *tsk);
 
 int schedtune_prefer_idle(struct task_struct *tsk);
 
+unsigned long schedtune_cpu_util_clamp(int cpu, unsigned long util);
+unsigned long schedtune_task_util_clamp(struct task_struct *tsk,
+					unsigned long util);
+
 void schedtune_exit_task(struct task_struct *tsk);
 
 void schedtune_enqueue_task(struct task_struct *p, int cpu);
@@ -29,6 +33,9 @@ void schedtune_dequeue_task(struct task_struct *p, int cpu);
 #define schedtune_cpu_boost(cpu)  get_sysctl_sched_cfs_boost()
 #define schedtune_task_boost(tsk) get_sysctl_sched_cfs_boost()
 
+#define schedtune_cpu_util_clamp(cpu, util) (util)
+#define schedtune_task_util_clamp(tsk, util) (util)
+
 #define schedtune_exit_task(task) do { } while (0)
 
 #define schedtune_enqueue_task(task, cpu) do { } while (0)
@@ -44,6 +51,9 @@ int schedtune_accept_deltas(int nrg_delta, int cap_delta,
 #define schedtune_cpu_boost(cpu)  0
 #define schedtune_task_boost(tsk) 0
 
+#define schedtune_cpu_util_clamp(cpu, util) (util)
+#define schedtune_task_util_clamp(tsk, util) (util)
+
 #define schedtune_exit_task(task) do { } while (0)
 
 #define schedtune_enqueue_task(task, cpu) do { } while (0)
@@ -108,6 +108,8 @@ extern int extra_free_kbytes;
 extern int min_free_order_shift;
 extern int pid_max_min, pid_max_max;
 extern int percpu_pagelist_fraction;
+extern int percpu_highorder_high;
+extern int percpu_highorder_batch;
 extern int compat_log;
 extern int latencytop_enabled;
 extern int sysctl_nr_open_min, sysctl_nr_open_max;
@@ -128,6 +130,7 @@ static int __maybe_unused two = 2;
 static int __maybe_unused four = 4;
 static unsigned long one_ul = 1;
 static int one_hundred = 100;
+static int __maybe_unused one_thousand = 1000;
 #ifdef CONFIG_PRINTK
 static int ten_thousand = 10000;
 #endif
@@ -480,6 +483,13 @@ static struct ctl_table kern_table[] = {
 		.mode		= 0644,
 		.proc_handler   = sched_hmp_proc_update_handler,
 	},
+	{
+		.procname	= "sched_small_task_pack",
+		.data		= &sysctl_sched_small_task_pack_pct,
+		.maxlen		= sizeof(unsigned int),
+		.mode		= 0644,
+		.proc_handler   = sched_hmp_proc_update_handler,
+	},
 	{
 		.procname       = "sched_enable_thread_grouping",
 		.data           = &sysctl_sched_enable_thread_grouping,
@@ -519,6 +529,15 @@ static struct ctl_table kern_table[] = {
 		.mode           = 0644,
 		.proc_handler   = sched_window_update_handler,
 	},
+	{
+		.procname	= "sched_pred_demand_placement",
+		.data		= &sysctl_sched_pred_demand_placement,
+		.maxlen		= sizeof(unsigned int),
+		.mode		= 0644,
+		.proc_handler	= proc_dointvec_minmax,
+		.extra1		= &zero,
+		.extra2		= &one,
+	},
 	{
 		.procname	= "sched_freq_aggregate_threshold",
 		.data		= &sysctl_sched_freq_aggregate_threshold_pct,
@@ -1650,6 +1669,22 @@ static struct ctl_table vm_table[] = {
 		.proc_handler	= percpu_pagelist_fraction_sysctl_handler,
 		.extra1		= &zero,
 	},
+	{
+		.procname	= "percpu_highorder_high",
+		.data		= &percpu_highorder_high,
+		.maxlen		= sizeof(percpu_highorder_high),
+		.mode		= 0644,
+		.proc_handler	= percpu_highorder_sysctl_handler,
+		.extra1		= &zero,
+	},
+	{
+		.procname	= "percpu_highorder_batch",
+		.data		= &percpu_highorder_batch,
+		.maxlen		= sizeof(percpu_highorder_batch),
+		.mode		= 0644,
+		.proc_handler	= percpu_highorder_sysctl_handler,
+		.extra1		= &zero,
+	},
 #ifdef CONFIG_MMU
 	{
 		.procname	= "max_map_count",
@@ -1833,6 +1868,15 @@ static struct ctl_table vm_table[] = {
 		.mode		= 0644,
 		.proc_handler	= proc_dointvec_minmax,
 	},
+	{
+		.procname	= "swap_ratio_policy",
+		.data		= &sysctl_swap_ratio_policy,
+		.maxlen		= sizeof(sysctl_swap_ratio_policy),
+		.mode		= 0644,
+		.proc_handler	= proc_dointvec_minmax,
+		.extra1		= &zero,
+		.extra2		= &one,
+	},
 #endif
 #ifdef CONFIG_HAVE_ARCH_MMAP_RND_BITS
 	{
@@ -1910,6 +1954,13 @@ static struct ctl_table fs_table[] = {
 		.mode		= 0444,
 		.proc_handler	= proc_nr_dentry,
 	},
+	{
+		.procname	= "dentry-lookup-state",
+		.data		= &dentry_lookup_stat,
+		.maxlen		= sizeof(dentry_lookup_stat),
+		.mode		= 0444,
+		.proc_handler	= proc_dentry_lookup_stat,
+	},
 	{
 		.procname	= "overflowuid",
 		.data		= &fs_overflowuid,
@@ -1971,6 +2022,24 @@ static struct ctl_table fs_table[] = {
 		.mode		= 0644,
 		.proc_handler	= proc_doulongvec_minmax,
 	},
+	{
+		.procname	= "aio-offload",
+		.data		= &aio_offload,
+		.maxlen		= sizeof(aio_offload),
+		.mode		= 0644,
+		.proc_handler	= proc_dointvec_minmax,
+		.extra1		= &zero,
+		.extra2		= &one,
+	},
+	{
+		.procname	= "aio-poll-us",
+		.data		= &aio_poll_us,
+		.maxlen		= sizeof(aio_poll_us),
+		.mode		= 0644,
+		.proc_handler	= proc_dointvec_minmax,
+		.extra1		= &zero,
+		.extra2		= &one_thousand,
+	},
 #endif /* CONFIG_AIO */
 #ifdef CONFIG_INOTIFY_USER
 	{
@@ -27,6 +27,7 @@
 #include <linux/wait.h>
 #include <linux/delay.h>
 #include <linux/completion.h>
+#include <linux/percpu.h>
 #include <linux/ipc_logging.h>
 
 #include "ipc_logging_private.h"
@@ -34,6 +35,15 @@
 #define LOG_PAGE_DATA_SIZE	sizeof(((struct ipc_log_page *)0)->data)
 #define LOG_PAGE_FLAG (1 << 31)
 
+/*
+ * Write ownership of a page, kept in ipc_log_page_header::state. A page
+ * is free, owned by a CPU that may append to it without taking the
+ * context lock, or busy while its owner is appending.
+ */
+#define LOG_PAGE_FREE		0
+#define LOG_PAGE_IDLE(cpu)	(((cpu) + 1) << 1)
+#define LOG_PAGE_BUSY(cpu)	(LOG_PAGE_IDLE(cpu) | 1)
+
 static LIST_HEAD(ipc_log_context_list);
 static DEFINE_RWLOCK(context_list_lock_lha1);
 static void *get_deserialization_func(struct ipc_log_context *ilctxt,
@@ -53,179 +63,85 @@ static struct ipc_log_page *get_first_page(struct ipc_log_context *ilctxt)
 }
 
 /**
- * is_nd_read_empty - Returns true if no data is available to read in log
+ * msg_timestamp - Returns the time a message was logged
  *
- * @ilctxt: logging context
- * @returns: > 1 if context is empty; 0 if not empty; <0 for failure
+ * @pg:  page holding the message
+ * @offset:  offset of the message in the page
+ * @write_offset:  end of the valid data in the page
  *
- * This is for the debugfs read pointer which allows for a non-destructive read.
- * There may still be data in the log, but it may have already been read.
+ * Messages logged by ipc_log_string() start with a timestamp.  Anything
+ * else is ordered by the time its page was started.
  */
-static int is_nd_read_empty(struct ipc_log_context *ilctxt)
+static uint64_t msg_timestamp(struct ipc_log_page *pg, uint16_t offset,
+			      uint16_t write_offset)
 {
-	if (!ilctxt)
-		return -EINVAL;
+	struct tsv_header hdr;
+	uint64_t t;
 
-	return ((ilctxt->nd_read_page == ilctxt->write_page) &&
-		(ilctxt->nd_read_page->hdr.nd_read_offset ==
-		 ilctxt->write_page->hdr.write_offset));
-}
+	if (offset + 2 * sizeof(hdr) + sizeof(t) > write_offset)
+		return pg->hdr.start_time;
 
-/**
- * is_read_empty - Returns true if no data is available in log
- *
- * @ilctxt: logging context
- * @returns: > 1 if context is empty; 0 if not empty; <0 for failure
- *
- * This is for the actual log contents.  If it is empty, then there
- * is no data at all in the log.
- */
-static int is_read_empty(struct ipc_log_context *ilctxt)
-{
-	if (!ilctxt)
-		return -EINVAL;
+	memcpy(&hdr, pg->data + offset + sizeof(hdr), sizeof(hdr));
+	if (hdr.type != TSV_TYPE_TIMESTAMP || hdr.size != sizeof(t))
+		return pg->hdr.start_time;
 
-	return ((ilctxt->read_page == ilctxt->write_page) &&
-		(ilctxt->read_page->hdr.read_offset ==
-		 ilctxt->write_page->hdr.write_offset));
+	memcpy(&t, pg->data + offset + 2 * sizeof(hdr), sizeof(t));
+	return t;
 }
 
 /**
- * is_nd_read_equal_read - Return true if the non-destructive read is equal to
- * the destructive read
+ * get_nd_read_page - Returns the page holding the oldest unread message
  *
  * @ilctxt: logging context
- * @returns: true if nd read is equal to read; false otherwise
- */
-static bool is_nd_read_equal_read(struct ipc_log_context *ilctxt)
-{
-	uint16_t read_offset;
-	uint16_t nd_read_offset;
-
-	if (ilctxt->nd_read_page == ilctxt->read_page) {
-		read_offset = ilctxt->read_page->hdr.read_offset;
-		nd_read_offset = ilctxt->nd_read_page->hdr.nd_read_offset;
-
-		if (read_offset == nd_read_offset)
-			return true;
-	}
-
-	return false;
-}
-
-
-static struct ipc_log_page *get_next_page(struct ipc_log_context *ilctxt,
-					  struct ipc_log_page *cur_pg)
-{
-	struct ipc_log_page_header *p_pghdr;
-	struct ipc_log_page *pg = NULL;
-
-	if (!ilctxt || !cur_pg)
-		return NULL;
-
-	if (ilctxt->last_page == cur_pg)
-		return ilctxt->first_page;
-
-	p_pghdr = list_first_entry(&cur_pg->hdr.list,
-			struct ipc_log_page_header, list);
-	pg = container_of(p_pghdr, struct ipc_log_page, hdr);
-
-	return pg;
-}
-
-/**
- * ipc_log_read - do non-destructive read of the log
- *
- * @ilctxt:  Logging context
- * @data:  Data pointer to receive the data
- * @data_size:  Number of bytes to read (must be <= bytes available in log)
+ * @returns: page or NULL if all messages have been read
  *
- * This read will update a runtime read pointer, but will not affect the actual
- * contents of the log which allows for reading the logs continuously while
- * debugging and if the system crashes, then the full logs can still be
- * extracted.
+ * Each CPU appends to its own page, so the pages are merged on read by
+ * message timestamp.  Called with the context lock held, which keeps
+ * pages from being recycled under the reader; the write offset of a
+ * page that is being appended to is only trusted once read.
  */
-static void ipc_log_read(struct ipc_log_context *ilctxt,
-			 void *data, int data_size)
+static struct ipc_log_page *get_nd_read_page(struct ipc_log_context *ilctxt)
 {
-	int bytes_to_read;
-
-	bytes_to_read = MIN(LOG_PAGE_DATA_SIZE
-				- ilctxt->nd_read_page->hdr.nd_read_offset,
-			      data_size);
-
-	memcpy(data, (ilctxt->nd_read_page->data +
-		ilctxt->nd_read_page->hdr.nd_read_offset), bytes_to_read);
-
-	if (bytes_to_read != data_size) {
-		/* not enough space, wrap read to next page */
-		ilctxt->nd_read_page->hdr.nd_read_offset = 0;
-		ilctxt->nd_read_page = get_next_page(ilctxt,
-			ilctxt->nd_read_page);
-		BUG_ON(ilctxt->nd_read_page == NULL);
-
-		memcpy((data + bytes_to_read),
-			   (ilctxt->nd_read_page->data +
-			ilctxt->nd_read_page->hdr.nd_read_offset),
-			   (data_size - bytes_to_read));
-		bytes_to_read = (data_size - bytes_to_read);
+	struct ipc_log_page_header *p_pghdr;
+	struct ipc_log_page *pg, *oldest = NULL;
+	uint64_t t, t_oldest = 0;
+	uint16_t write_offset;
+
+	list_for_each_entry(p_pghdr, &ilctxt->page_list, list) {
+		write_offset = ACCESS_ONCE(p_pghdr->write_offset);
+		if (p_pghdr->nd_read_offset >= write_offset)
+			continue;
+		/* pairs with smp_wmb() in ipc_log_write() */
+		smp_rmb();
+
+		pg = container_of(p_pghdr, struct ipc_log_page, hdr);
+		t = msg_timestamp(pg, p_pghdr->nd_read_offset, write_offset);
+		if (!oldest || t < t_oldest) {
+			oldest = pg;
+			t_oldest = t;
+		}
 	}
-	ilctxt->nd_read_page->hdr.nd_read_offset += bytes_to_read;
+	return oldest;
 }
 
 /**
- * ipc_log_drop - do destructive read of the log
+ * ipc_log_has_unread - Returns true if a message has not been read yet
+ *
+ * @ilctxt: logging context
  *
- * @ilctxt:  Logging context
- * @data:  Data pointer to receive the data (or NULL)
- * @data_size:  Number of bytes to read (must be <= bytes available in log)
+ * Lockless hint used to wait for new data; ipc_log_extract() has the
+ * final word.
  */
-static void ipc_log_drop(struct ipc_log_context *ilctxt, void *data,
-		int data_size)
+bool ipc_log_has_unread(struct ipc_log_context *ilctxt)
 {
-	int bytes_to_read;
-	bool push_nd_read;
-
-	bytes_to_read = MIN(LOG_PAGE_DATA_SIZE
-				- ilctxt->read_page->hdr.read_offset,
-			      data_size);
-	if (data)
-		memcpy(data, (ilctxt->read_page->data +
-			ilctxt->read_page->hdr.read_offset), bytes_to_read);
-
-	if (bytes_to_read != data_size) {
-		/* not enough space, wrap read to next page */
-		push_nd_read = is_nd_read_equal_read(ilctxt);
-
-		ilctxt->read_page->hdr.read_offset = 0;
-		if (push_nd_read) {
-			ilctxt->read_page->hdr.nd_read_offset = 0;
-			ilctxt->read_page = get_next_page(ilctxt,
-				ilctxt->read_page);
-			BUG_ON(ilctxt->read_page == NULL);
-			ilctxt->nd_read_page = ilctxt->read_page;
-		} else {
-			ilctxt->read_page = get_next_page(ilctxt,
-				ilctxt->read_page);
-			BUG_ON(ilctxt->read_page == NULL);
-		}
-
-		if (data)
-			memcpy((data + bytes_to_read),
-				   (ilctxt->read_page->data +
-				ilctxt->read_page->hdr.read_offset),
-				   (data_size - bytes_to_read));
+	struct ipc_log_page_header *p_pghdr;
 
-		bytes_to_read = (data_size - bytes_to_read);
+	list_for_each_entry(p_pghdr, &ilctxt->page_list, list) {
+		if (p_pghdr->nd_read_offset <
+				ACCESS_ONCE(p_pghdr->write_offset))
+			return true;
 	}
-
-	/* update non-destructive read pointer if necessary */
-	push_nd_read = is_nd_read_equal_read(ilctxt);
-	ilctxt->read_page->hdr.read_offset += bytes_to_read;
-	ilctxt->write_avail += data_size;
-
-	if (push_nd_read)
-		ilctxt->nd_read_page->hdr.nd_read_offset += bytes_to_read;
+	return false;
 }
 
 /**
@@ -236,6 +152,11 @@ static void ipc_log_drop(struct ipc_log_context *ilctxt, void *data,
  *     .hdr    message header .size and .type values
  *     .offset beginning of message data
  *
+ * This read will update a runtime read pointer, but will not affect the
+ * actual contents of the log which allows for reading the logs
+ * continuously while debugging and if the system crashes, then the full
+ * logs can still be extracted.
+ *
  * @ilctxt	Logging context
  * @ectxt   Message context
  *
@@ -244,87 +165,124 @@ static void ipc_log_drop(struct ipc_log_context *ilctxt, void *data,
 static int msg_read(struct ipc_log_context *ilctxt,
 	     struct encode_context *ectxt)
 {
+	struct ipc_log_page *pg;
 	struct tsv_header hdr;
 
 	if (!ectxt)
 		return -EINVAL;
 
-	if (is_nd_read_empty(ilctxt))
+	pg = get_nd_read_page(ilctxt);
+	if (!pg)
 		return 0;
 
-	ipc_log_read(ilctxt, &hdr, sizeof(hdr));
+	memcpy(&hdr, pg->data + pg->hdr.nd_read_offset, sizeof(hdr));
 	ectxt->hdr.type = hdr.type;
 	ectxt->hdr.size = hdr.size;
 	ectxt->offset = sizeof(hdr);
-	ipc_log_read(ilctxt, (ectxt->buff + ectxt->offset),
-			 (int)hdr.size);
+	memcpy(ectxt->buff + ectxt->offset,
+	       pg->data + pg->hdr.nd_read_offset + sizeof(hdr), hdr.size);
+	pg->hdr.nd_read_offset += sizeof(hdr) + hdr.size;
 
 	return sizeof(hdr) + (int)hdr.size;
 }
 
 /**
- * msg_drop - Drops a message.
+ * get_write_page - Hands out a new page for @cpu to append to
  *
- * @ilctxt	Logging context
+ * @ilctxt: logging context
+ * @cpu: current CPU
+ * @returns: wiped page, marked busy for @cpu
+ *
+ * The page written to least recently is recycled, dropping its messages,
+ * unless its owner is appending to it right now.  Called with interrupts
+ * disabled.  Busy pages never wait on the context lock, so spinning on
+ * them here is bounded by the copy of a single message.
  */
-static void msg_drop(struct ipc_log_context *ilctxt)
+static struct ipc_log_page *get_write_page(struct ipc_log_context *ilctxt,
+					   int cpu)
 {
-	struct tsv_header hdr;
+	struct ipc_log_page_header *p_pghdr, *oldest;
+	uint64_t t_now;
+	int state;
 
-	if (!is_read_empty(ilctxt)) {
-		ipc_log_drop(ilctxt, &hdr, sizeof(hdr));
-		ipc_log_drop(ilctxt, NULL, (int)hdr.size);
+	spin_lock(&ilctxt->context_lock_lhb1);
+	for (;;) {
+		oldest = NULL;
+		list_for_each_entry(p_pghdr, &ilctxt->page_list, list) {
+			if (atomic_read(&p_pghdr->state) & 1)
+				continue;
+			if (!oldest || p_pghdr->end_time < oldest->end_time)
+				oldest = p_pghdr;
+		}
+		if (oldest) {
+			state = atomic_read(&oldest->state);
+			if (!(state & 1) &&
+			    atomic_cmpxchg(&oldest->state, state,
+					   LOG_PAGE_BUSY(cpu)) == state)
+				break;
+		}
+		cpu_relax();
 	}
+
+	t_now = sched_clock();
+	oldest->write_offset = 0;
+	oldest->read_offset = 0;
+	oldest->nd_read_offset = 0;
+	oldest->start_time = t_now;
+	oldest->end_time = t_now;
+	spin_unlock(&ilctxt->context_lock_lhb1);
+
+	return container_of(oldest, struct ipc_log_page, hdr);
 }
 
 /*
- * Commits messages to the FIFO.  If the FIFO is full, then enough
- * messages are dropped to create space for the new message.
+ * Commits messages to the log.  Each CPU appends to a page of its own
+ * without taking the context lock.  Once that page is full, the oldest
+ * page of the log is recycled for it.
  */
 void ipc_log_write(void *ctxt, struct encode_context *ectxt)
 {
 	struct ipc_log_context *ilctxt = (struct ipc_log_context *)ctxt;
-	int bytes_to_write;
+	struct ipc_log_page *pg;
 	unsigned long flags;
+	int cpu;
 
 	if (!ilctxt || !ectxt) {
 		pr_err("%s: Invalid ipc_log or encode context\n", __func__);
 		return;
 	}
 
-	read_lock_irqsave(&context_list_lock_lha1, flags);
-	spin_lock(&ilctxt->context_lock_lhb1);
-	while (ilctxt->write_avail <= ectxt->offset)
-		msg_drop(ilctxt);
-
-	bytes_to_write = MIN(LOG_PAGE_DATA_SIZE
-				- ilctxt->write_page->hdr.write_offset,
-				ectxt->offset);
-	memcpy((ilctxt->write_page->data +
-		ilctxt->write_page->hdr.write_offset),
-		ectxt->buff, bytes_to_write);
-
-	if (bytes_to_write != ectxt->offset) {
-		uint64_t t_now = sched_clock();
-
-		ilctxt->write_page->hdr.write_offset += bytes_to_write;
-		ilctxt->write_page->hdr.end_time = t_now;
-
-		ilctxt->write_page = get_next_page(ilctxt, ilctxt->write_page);
-		BUG_ON(ilctxt->write_page == NULL);
-		ilctxt->write_page->hdr.write_offset = 0;
-		ilctxt->write_page->hdr.start_time = t_now;
-		memcpy((ilctxt->write_page->data +
-			ilctxt->write_page->hdr.write_offset),
-		       (ectxt->buff + bytes_to_write),
-		       (ectxt->offset - bytes_to_write));
-		bytes_to_write = (ectxt->offset - bytes_to_write);
+	local_irq_save(flags);
+	cpu = smp_processor_id();
+	pg = *this_cpu_ptr(ilctxt->cpu_write_page);
+	if (pg && atomic_cmpxchg(&pg->hdr.state, LOG_PAGE_IDLE(cpu),
+				 LOG_PAGE_BUSY(cpu)) != LOG_PAGE_IDLE(cpu))
+		pg = NULL;	/* recycled by another CPU */
+
+	if (pg && ectxt->offset >
+			LOG_PAGE_DATA_SIZE - pg->hdr.write_offset) {
+		atomic_set(&pg->hdr.state, LOG_PAGE_FREE);
+		pg = NULL;
 	}
-	ilctxt->write_page->hdr.write_offset += bytes_to_write;
-	ilctxt->write_avail -= ectxt->offset;
-	complete(&ilctxt->read_avail);
-	spin_unlock(&ilctxt->context_lock_lhb1);
-	read_unlock_irqrestore(&context_list_lock_lha1, flags);
+
+	if (!pg) {
+		pg = get_write_page(ilctxt, cpu);
+		*this_cpu_ptr(ilctxt->cpu_write_page) = pg;
+	}
+
+	memcpy(pg->data + pg->hdr.write_offset, ectxt->buff, ectxt->offset);
+	pg->hdr.end_time = sched_clock();
+	/* the message must be visible before the offset covering it */
+	smp_wmb();
+	pg->hdr.write_offset += ectxt->offset;
+	smp_mb__before_atomic();
+	atomic_set(&pg->hdr.state, LOG_PAGE_IDLE(cpu));
+	local_irq_restore(flags);
+
+	/* pairs with the barrier in wait_event_interruptible() */
+	smp_mb();
+	if (waitqueue_active(&ilctxt->read_wq))
+		wake_up_interruptible(&ilctxt->read_wq);
 }
 EXPORT_SYMBOL(ipc_log_write);
 
@@ -526,9 +484,8 @@ EXPORT_SYMBOL(ipc_log_string);
  * @size:    size of the buffer
  * @returns: 0 if no data read; >0 number of bytes read; < 0 error
  *
- * If no data is available to be read, then the ilctxt::read_avail
- * completion is reinitialized.  This allows clients to block
- * until new log data is save.
+ * Messages logged on different CPUs are returned in timestamp order.
+ * Clients can block on ilctxt::read_wq until new log data is saved.
  */
 int ipc_log_extract(void *ctxt, char *buff, int size)
 {
@@ -548,8 +505,7 @@ int ipc_log_extract(void *ctxt, char *buff, int size)
 	read_lock_irqsave(&context_list_lock_lha1, flags);
 	spin_lock(&ilctxt->context_lock_lhb1);
 	while (dctxt.size >= MAX_MSG_DECODED_SIZE &&
-	       !is_nd_read_empty(ilctxt)) {
-		msg_read(ilctxt, &ectxt);
+	       msg_read(ilctxt, &ectxt) > 0) {
 		deserialize_func = get_deserialization_func(ilctxt,
 							ectxt.hdr.type);
 		spin_unlock(&ilctxt->context_lock_lhb1);
@@ -562,8 +518,6 @@ int ipc_log_extract(void *ctxt, char *buff, int size)
 		read_lock_irqsave(&context_list_lock_lha1, flags);
 		spin_lock(&ilctxt->context_lock_lhb1);
 	}
-	if ((size - dctxt.size) == 0)
-		reinit_completion(&ilctxt->read_avail);
 	spin_unlock(&ilctxt->context_lock_lhb1);
 	read_unlock_irqrestore(&context_list_lock_lha1, flags);
 	return size - dctxt.size;
@@ -776,7 +730,14 @@ void *ipc_log_context_create(int max_num_pages,
 		return 0;
 	}
 
-	init_completion(&ctxt->read_avail);
+	ctxt->cpu_write_page = alloc_percpu(struct ipc_log_page *);
+	if (!ctxt->cpu_write_page) {
+		pr_err("%s: cannot create ipc_log_context\n", __func__);
+		kfree(ctxt);
+		return 0;
+	}
+
+	init_waitqueue_head(&ctxt->read_wq);
 	INIT_LIST_HEAD(&ctxt->page_list);
 	INIT_LIST_HEAD(&ctxt->dfunc_info_list);
 	spin_lock_init(&ctxt->context_lock_lhb1);
@@ -804,12 +765,6 @@ void *ipc_log_context_create(int max_num_pages,
 	ctxt->version = IPC_LOG_VERSION;
 	strlcpy(ctxt->name, mod_name, IPC_LOG_MAX_CONTEXT_NAME_LEN);
 	ctxt->user_version = user_version;
-	ctxt->first_page = get_first_page(ctxt);
-	ctxt->last_page = pg;
-	ctxt->write_page = ctxt->first_page;
-	ctxt->read_page = ctxt->first_page;
-	ctxt->nd_read_page = ctxt->first_page;
-	ctxt->write_avail = max_num_pages * LOG_PAGE_DATA_SIZE;
 	ctxt->header_size = sizeof(struct ipc_log_page_header);
 	create_ctx_debugfs(ctxt, mod_name);
 
@@ -828,6 +783,7 @@ release_ipc_log_context:
 		list_del(&pg->hdr.list);
 		kfree(pg);
 	}
+	free_percpu(ctxt->cpu_write_page);
 	kfree(ctxt);
 	return 0;
 }
@@ -859,6 +815,7 @@ int ipc_log_context_destroy(void *ctxt)
 
 	debugfs_remove_recursive(ilctxt->dent);
 
+	free_percpu(ilctxt->cpu_write_page);
 	kfree(ilctxt);
 	return 0;
 }
@@ -15,7 +15,7 @@
 
 #include <linux/ipc_logging.h>
 
-#define IPC_LOG_VERSION 0x0003
+#define IPC_LOG_VERSION 0x0004
 #define IPC_LOG_MAX_CONTEXT_NAME_LEN 32
 
 /**
@@ -34,6 +34,11 @@
  *
  * @list:  Linked list of pages that make up a log
  * @nd_read_offset:  Non-destructive read offset used for debugfs
+ * @state:  Write ownership of the page, see ipc_log_write()
+ *
+ * Since version 4, every page is appended to by a single CPU at a time and
+ * only holds whole messages.  Pages are no longer filled in list order, so
+ * messages are put back in order by their timestamps.
  *
  * The first part of the structure defines data that is used to extract the
  * logs from a memory dump and elements in this section should not be changed
@@ -54,6 +59,7 @@ struct ipc_log_page_header {
 	/* add local data structures after this point */
 	struct list_head list;
 	uint16_t nd_read_offset;
+	atomic_t state;
 };
 
 /**
@@ -84,17 +90,13 @@ struct ipc_log_page {
  *
  * @list:  List of log contexts (struct ipc_log_context)
  * @page_list:  List of log pages (struct ipc_log_page)
- * @first_page:  First page in list of logging pages
- * @last_page:  Last page in list of logging pages
- * @write_page:  Current write page
- * @read_page:  Current read page (for internal reads)
- * @nd_read_page:  Current debugfs extraction page (non-destructive)
+ * @cpu_write_page:  Page each CPU is appending to
  *
- * @write_avail:  Number of bytes available to write in all pages
  * @dent:  Debugfs node for run-time log extraction
  * @dfunc_info_list:  List of deserialization functions
- * @context_lock_lhb1:  Lock for entire structure
- * @read_avail:  Completed when new data is added to the log
+ * @context_lock_lhb1:  Serializes readers and page recycling; appending
+ *                      to a page owned by the CPU does not take it
+ * @read_wq:  Woken up when new data is added to the log
  */
 struct ipc_log_context {
 	uint32_t magic;
@@ -108,17 +110,12 @@ struct ipc_log_context {
 	/* add local data structures after this point */
 	struct list_head list;
 	struct list_head page_list;
-	struct ipc_log_page *first_page;
-	struct ipc_log_page *last_page;
-	struct ipc_log_page *write_page;
-	struct ipc_log_page *read_page;
-	struct ipc_log_page *nd_read_page;
+	struct ipc_log_page * __percpu *cpu_write_page;
 
-	uint32_t write_avail;
 	struct dentry *dent;
 	struct list_head dfunc_info_list;
 	spinlock_t context_lock_lhb1;
-	struct completion read_avail;
+	wait_queue_head_t read_wq;
 };
 
 struct dfunc_info {
@@ -147,6 +144,8 @@ enum {
 			((x) < TSV_TYPE_MSG_END))
 #define MAX_MSG_DECODED_SIZE (MAX_MSG_SIZE*4)
 
+bool ipc_log_has_unread(struct ipc_log_context *ilctxt);
+
 #if (defined(CONFIG_DEBUG_FS))
 void check_and_create_debugfs(void);
 
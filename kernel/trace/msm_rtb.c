@@ -25,6 +25,7 @@
 #include <linux/of.h>
 #include <linux/of_address.h>
 #include <linux/io.h>
+#include <linux/percpu.h>
 #include <asm-generic/sizes.h>
 #include <linux/msm_rtb.h>
 #include <asm/timex.h>
@@ -35,6 +36,8 @@
 
 #define RTB_COMPAT_STR	"qcom,msm-rtb"
 
+#define RTB_MAX_ADDR_RANGES	8
+
 /* Write
  * 1) 3 bytes sentinel
  * 2) 1 bytes of log type
@@ -57,6 +60,11 @@ struct msm_rtb_layout {
 } __attribute__ ((__packed__));
 
 
+struct msm_rtb_addr_range {
+	unsigned long start;
+	unsigned long end;
+};
+
 struct msm_rtb_state {
 	struct msm_rtb_layout *rtb;
 	phys_addr_t phys;
@@ -66,6 +74,9 @@ struct msm_rtb_state {
 	int initialized;
 	uint32_t filter;
 	int step_size;
+	unsigned int sample_rate;
+	int nr_addr_ranges;
+	struct msm_rtb_addr_range addr_ranges[RTB_MAX_ADDR_RANGES];
 };
 
 #if defined(CONFIG_MSM_RTB_SEPARATE_CPUS)
@@ -74,14 +85,98 @@ DEFINE_PER_CPU(atomic_t, msm_rtb_idx_cpu);
 static atomic_t msm_rtb_idx;
 #endif
 
+static DEFINE_PER_CPU(unsigned int, msm_rtb_sample_cnt);
+
 static struct msm_rtb_state msm_rtb = {
 	.filter = 1 << LOGK_LOGBUF,
 	.enabled = 1,
+	.sample_rate = 1,
 };
 
 module_param_named(filter, msm_rtb.filter, uint, 0644);
 module_param_named(enable, msm_rtb.enabled, int, 0644);
 
+static int msm_rtb_set_sample_rate(const char *val,
+				   const struct kernel_param *kp)
+{
+	unsigned int rate;
+	int ret;
+
+	ret = kstrtouint(val, 0, &rate);
+	if (ret)
+		return ret;
+
+	msm_rtb.sample_rate = max(rate, 1U);
+	return 0;
+}
+
+static const struct kernel_param_ops msm_rtb_sample_rate_ops = {
+	.set = msm_rtb_set_sample_rate,
+	.get = param_get_uint,
+};
+module_param_cb(sample_rate, &msm_rtb_sample_rate_ops,
+		&msm_rtb.sample_rate, 0644);
+
+/*
+ * addr_ranges restricts LOGK_READL and LOGK_WRITEL to accesses within the
+ * given kernel virtual address ranges, as "start-end" in hex with the end
+ * exclusive, e.g. taken from the ioremap entries of /proc/vmallocinfo.
+ * Up to RTB_MAX_ADDR_RANGES comma separated ranges. An empty string logs
+ * all addresses again.
+ */
+static int msm_rtb_set_addr_ranges(const char *val,
+				   const struct kernel_param *kp)
+{
+	struct msm_rtb_addr_range ranges[RTB_MAX_ADDR_RANGES];
+	char *buf, *cur, *tok;
+	int n = 0, ret = 0;
+
+	buf = kstrdup(val, GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+
+	cur = strim(buf);
+	while ((tok = strsep(&cur, ",")) != NULL) {
+		if (!*tok)
+			continue;
+		if (n == RTB_MAX_ADDR_RANGES ||
+		    sscanf(tok, "%lx-%lx", &ranges[n].start,
+			   &ranges[n].end) != 2 ||
+		    ranges[n].start >= ranges[n].end) {
+			ret = -EINVAL;
+			goto out;
+		}
+		n++;
+	}
+
+	/* loggers read the ranges locklessly, hide them while updating */
+	msm_rtb.nr_addr_ranges = 0;
+	smp_wmb();
+	memcpy(msm_rtb.addr_ranges, ranges, n * sizeof(ranges[0]));
+	smp_wmb();
+	msm_rtb.nr_addr_ranges = n;
+out:
+	kfree(buf);
+	return ret;
+}
+
+static int msm_rtb_get_addr_ranges(char *buf, const struct kernel_param *kp)
+{
+	int i, len = 0;
+
+	for (i = 0; i < msm_rtb.nr_addr_ranges; i++)
+		len += scnprintf(buf + len, PAGE_SIZE - len, "%s%#lx-%#lx",
+				 i ? "," : "", msm_rtb.addr_ranges[i].start,
+				 msm_rtb.addr_ranges[i].end);
+	return len;
+}
+
+static const struct kernel_param_ops msm_rtb_addr_ranges_ops = {
+	.set = msm_rtb_set_addr_ranges,
+	.get = msm_rtb_get_addr_ranges,
+};
+module_param_cb(addr_ranges, &msm_rtb_addr_ranges_ops, NULL, 0644);
+
 static int msm_rtb_panic_notifier(struct notifier_block *this,
 					unsigned long event, void *ptr)
 {
@@ -101,6 +196,37 @@ int notrace msm_rtb_event_should_log(enum logk_event_type log_type)
 }
 EXPORT_SYMBOL(msm_rtb_event_should_log);
 
+/*
+ * Register accesses are additionally subject to the address ranges and
+ * sampling, which is what keeps logging cheap for busy drivers.
+ */
+static int notrace msm_rtb_access_should_log(enum logk_event_type log_type,
+					     void *data)
+{
+	unsigned long addr = (unsigned long)data;
+	unsigned int rate;
+	int i, n;
+
+	log_type &= ~LOGTYPE_NOPC;
+	if (log_type != LOGK_READL && log_type != LOGK_WRITEL)
+		return 1;
+
+	n = ACCESS_ONCE(msm_rtb.nr_addr_ranges);
+	if (n) {
+		smp_rmb();
+		for (i = 0; i < n; i++)
+			if (addr >= msm_rtb.addr_ranges[i].start &&
+			    addr < msm_rtb.addr_ranges[i].end)
+				break;
+		if (i == n)
+			return 0;
+	}
+
+	/* an occasional miscount from preemption does not matter here */
+	rate = ACCESS_ONCE(msm_rtb.sample_rate);
+	return rate <= 1 || !(raw_cpu_inc_return(msm_rtb_sample_cnt) % rate);
+}
+
 static void msm_rtb_emit_sentinel(struct msm_rtb_layout *start)
 {
 	start->sentinel[0] = SENTINEL_BYTE_1;
@@ -226,6 +352,9 @@ int notrace uncached_logk_pc(enum logk_event_type log_type, void *caller,
 	if (!msm_rtb_event_should_log(log_type))
 		return 0;
 
+	if (!msm_rtb_access_should_log(log_type, data))
+		return 0;
+
 	i = msm_rtb_get_idx();
 	uncached_logk_pc_idx(log_type, (uint64_t)((unsigned long) caller),
 				(uint64_t)((unsigned long) data), i);
@@ -49,6 +49,9 @@
 #include <linux/moduleparam.h>
 #include <linux/uaccess.h>
 #include <linux/bug.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/topology.h>
 
 #include "workqueue_internal.h"
 
@@ -203,6 +206,11 @@ struct pool_workqueue {
 	struct list_head	delayed_works;	/* L: delayed works */
 	struct list_head	pwqs_node;	/* WR: node on wq->pwqs */
 	struct list_head	mayday_node;	/* MD: node on wq->maydays */
+#ifdef CONFIG_WQ_LATENCY_STATS
+	u64			nr_started;	/* L: works picked up */
+	u64			latency_sum;	/* L: queueing to start, ns */
+	u64			latency_max;	/* L: worst of the above */
+#endif
 
 	/*
 	 * Release of unbound pwq is punted to system_wq.  See put_pwq()
@@ -1271,6 +1279,29 @@ fail:
  * CONTEXT:
  * spin_lock_irq(pool->lock).
  */
+#ifdef CONFIG_WQ_LATENCY_STATS
+static inline void wq_stat_queued(struct work_struct *work)
+{
+	work->queued_ns = local_clock();
+}
+
+/* called with pool->lock held as a worker picks up @work */
+static inline void wq_stat_started(struct pool_workqueue *pwq,
+				   struct work_struct *work)
+{
+	u64 latency = local_clock() - work->queued_ns;
+
+	pwq->nr_started++;
+	pwq->latency_sum += latency;
+	if (latency > pwq->latency_max)
+		pwq->latency_max = latency;
+}
+#else
+static inline void wq_stat_queued(struct work_struct *work) { }
+static inline void wq_stat_started(struct pool_workqueue *pwq,
+				   struct work_struct *work) { }
+#endif
+
 static void insert_work(struct pool_workqueue *pwq, struct work_struct *work,
 			struct list_head *head, unsigned int extra_flags)
 {
@@ -1278,6 +1309,7 @@ static void insert_work(struct pool_workqueue *pwq, struct work_struct *work,
 
 	/* we own @work, set data and link */
 	set_work_pwq(work, pwq, extra_flags);
+	wq_stat_queued(work);
 	list_add_tail(&work->entry, head);
 	get_pwq(pwq);
 
@@ -2002,6 +2034,7 @@ __acquires(&pool->lock)
 	worker->current_work = work;
 	worker->current_func = work->func;
 	worker->current_pwq = pwq;
+	wq_stat_started(pwq, work);
 	work_color = get_work_color(work);
 
 	list_del_init(&work->entry);
@@ -3168,6 +3201,29 @@ static ssize_t wq_cpumask_store(struct device *dev,
 	return ret ?: count;
 }
 
+static ssize_t wq_cluster_show(struct device *dev,
+			       struct device_attribute *attr, char *buf)
+{
+	struct workqueue_struct *wq = dev_to_wq(dev);
+
+	return scnprintf(buf, PAGE_SIZE, "%d\n", workqueue_get_cluster(wq));
+}
+
+static ssize_t wq_cluster_store(struct device *dev,
+				struct device_attribute *attr,
+				const char *buf, size_t count)
+{
+	struct workqueue_struct *wq = dev_to_wq(dev);
+	int cluster, ret;
+
+	if (sscanf(buf, "%d", &cluster) == 1)
+		ret = workqueue_set_cluster(wq, cluster);
+	else
+		ret = -EINVAL;
+
+	return ret ?: count;
+}
+
 static ssize_t wq_numa_show(struct device *dev, struct device_attribute *attr,
 			    char *buf)
 {
@@ -3207,6 +3263,7 @@ static struct device_attribute wq_sysfs_unbound_attrs[] = {
 	__ATTR(pool_ids, 0444, wq_pool_ids_show, NULL),
 	__ATTR(nice, 0644, wq_nice_show, wq_nice_store),
 	__ATTR(cpumask, 0644, wq_cpumask_show, wq_cpumask_store),
+	__ATTR(cluster, 0644, wq_cluster_show, wq_cluster_store),
 	__ATTR(numa, 0644, wq_numa_show, wq_numa_store),
 	__ATTR_NULL,
 };
@@ -3317,6 +3374,63 @@ static void workqueue_sysfs_unregister(struct workqueue_struct *wq)
 static void workqueue_sysfs_unregister(struct workqueue_struct *wq)	{ }
 #endif	/* CONFIG_SYSFS */
 
+#ifdef CONFIG_WQ_LATENCY_STATS
+static int wq_latency_show(struct seq_file *m, void *v)
+{
+	struct workqueue_struct *wq;
+	struct pool_workqueue *pwq;
+
+	seq_printf(m, "%-24s %12s %10s %10s\n", "workqueue", "started",
+		   "avg_us", "max_us");
+
+	mutex_lock(&wq_pool_mutex);
+	list_for_each_entry(wq, &workqueues, list) {
+		u64 nr = 0, sum = 0, max = 0;
+
+		mutex_lock(&wq->mutex);
+		for_each_pwq(pwq, wq) {
+			spin_lock_irq(&pwq->pool->lock);
+			nr += pwq->nr_started;
+			sum += pwq->latency_sum;
+			max = max(max, pwq->latency_max);
+			spin_unlock_irq(&pwq->pool->lock);
+		}
+		mutex_unlock(&wq->mutex);
+
+		/* unbound pwqs replaced by an attrs change take theirs along */
+		if (!nr)
+			continue;
+		seq_printf(m, "%-24s %12llu %10llu %10llu\n", wq->name, nr,
+			   div64_u64(sum, nr * NSEC_PER_USEC),
+			   div_u64(max, NSEC_PER_USEC));
+	}
+	mutex_unlock(&wq_pool_mutex);
+
+	return 0;
+}
+
+static int wq_latency_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, wq_latency_show, NULL);
+}
+
+static const struct file_operations wq_latency_fops = {
+	.open		= wq_latency_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init wq_latency_init(void)
+{
+	if (!debugfs_create_file("workqueue_latency", S_IRUSR, NULL, NULL,
+				 &wq_latency_fops))
+		return -ENOMEM;
+	return 0;
+}
+late_initcall(wq_latency_init);
+#endif	/* CONFIG_WQ_LATENCY_STATS */
+
 /**
  * free_workqueue_attrs - free a workqueue_attrs
  * @attrs: workqueue_attrs to free
@@ -3925,6 +4039,83 @@ enomem:
 	goto out_free;
 }
 
+/**
+ * workqueue_set_cluster - confine an unbound workqueue to one CPU cluster
+ * @wq: the target workqueue
+ * @cluster: topology_physical_package_id() of the cluster, or WQ_CLUSTER_ANY
+ *
+ * Sets the cpumask of @wq to the CPUs of @cluster, or back to all possible
+ * CPUs for WQ_CLUSTER_ANY.  For work that should run cheaply rather than
+ * fast, pointing @wq at the little cluster keeps it from waking a big
+ * core or pulling the other cluster out of deep idle; which CPU of the
+ * cluster picks it up is left to the scheduler's wakeup placement.
+ *
+ * Performs GFP_KERNEL allocations.
+ *
+ * Return: 0 on success and -errno on failure.
+ */
+int workqueue_set_cluster(struct workqueue_struct *wq, int cluster)
+{
+	struct workqueue_attrs *attrs;
+	int cpu, ret;
+
+	if (!(wq->flags & WQ_UNBOUND))
+		return -EINVAL;
+
+	attrs = alloc_workqueue_attrs(GFP_KERNEL);
+	if (!attrs)
+		return -ENOMEM;
+
+	mutex_lock(&wq->mutex);
+	copy_workqueue_attrs(attrs, wq->unbound_attrs);
+	mutex_unlock(&wq->mutex);
+
+	ret = -EINVAL;
+	if (cluster == WQ_CLUSTER_ANY) {
+		cpumask_copy(attrs->cpumask, cpu_possible_mask);
+		ret = apply_workqueue_attrs(wq, attrs);
+	} else {
+		for_each_possible_cpu(cpu) {
+			if (topology_physical_package_id(cpu) != cluster)
+				continue;
+			cpumask_copy(attrs->cpumask,
+				     topology_core_cpumask(cpu));
+			ret = apply_workqueue_attrs(wq, attrs);
+			break;
+		}
+	}
+
+	free_workqueue_attrs(attrs);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(workqueue_set_cluster);
+
+/**
+ * workqueue_get_cluster - the cluster an unbound workqueue is confined to
+ * @wq: the target workqueue
+ *
+ * Return: the cluster whose CPUs make up exactly the cpumask of @wq, or
+ * WQ_CLUSTER_ANY if there is none.
+ */
+int workqueue_get_cluster(struct workqueue_struct *wq)
+{
+	int cpu, cluster = WQ_CLUSTER_ANY;
+
+	if (!(wq->flags & WQ_UNBOUND))
+		return WQ_CLUSTER_ANY;
+
+	mutex_lock(&wq->mutex);
+	cpu = cpumask_first(wq->unbound_attrs->cpumask);
+	if (cpu < nr_cpu_ids &&
+	    cpumask_equal(wq->unbound_attrs->cpumask,
+			  topology_core_cpumask(cpu)))
+		cluster = topology_physical_package_id(cpu);
+	mutex_unlock(&wq->mutex);
+
+	return cluster;
+}
+EXPORT_SYMBOL_GPL(workqueue_get_cluster);
+
 /**
  * wq_update_unbound_numa - update NUMA affinity of a wq for CPU hot[un]plug
  * @wq: the target workqueue
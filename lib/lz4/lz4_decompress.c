@@ -52,6 +52,16 @@ static const int dec32table[] = {0, 3, 2, 3, 0, 0, 0, 0};
 static const int dec64table[] = {0, 0, 0, -1, 0, 1, 2, 3};
 #endif
 
+/*
+ * Input and output room needed by the short sequence fast path: 16 bytes
+ * of literals plus the offset must be readable with at least one byte
+ * left for the next token, and 16 bytes of literals followed by up to
+ * 18 bytes of match (the most a non-extended match length encodes) must
+ * be writable.
+ */
+#define LZ4_SHORT_IN	16
+#define LZ4_SHORT_OUT	(16 + 18)
+
 static int lz4_uncompress(const char *source, char *dest, int osize)
 {
 	const BYTE *ip = (const BYTE *) source;
@@ -191,6 +201,37 @@ static int lz4_uncompress_unknownoutputsize(const char *source, char *dest,
 		/* get runlength */
 		token = *ip++;
 		length = (token >> ML_BITS);
+
+		/*
+		 * Fast path for the common case of a short literal run followed
+		 * by a short match, far enough from both buffer ends: copy the
+		 * literals and the match with fixed size copies. Matches closer
+		 * than 8 bytes overlap the copy and take the regular path, as
+		 * does anything that needs extended length bytes.
+		 */
+		if (length != RUN_MASK &&
+		    likely(iend - ip > LZ4_SHORT_IN &&
+			   oend - op >= LZ4_SHORT_OUT)) {
+			LZ4_COPY16(ip, op);
+			ip += length;
+			op += length;
+
+			cpy = op;
+			LZ4_READ_LITTLEENDIAN_16(ref, cpy, ip);
+			ip += 2;
+
+			length = token & ML_MASK;
+			if (length != ML_MASK && (op - ref) >= 8 &&
+			    ref >= (BYTE * const) dest) {
+				LZ4_COPY16(ref, op);
+				op[16] = ref[16];
+				op[17] = ref[17];
+				op += length + MINMATCH;
+				continue;
+			}
+			goto _match;
+		}
+
 		if (length == RUN_MASK) {
 			int s = 255;
 			while ((ip < iend) && (s == 255)) {
@@ -225,6 +266,7 @@ static int lz4_uncompress_unknownoutputsize(const char *source, char *dest,
 		/* get offset */
 		LZ4_READ_LITTLEENDIAN_16(ref, cpy, ip);
 		ip += 2;
+_match:
 		if (ref < (BYTE * const) dest)
 			goto _output_error;
 			/*
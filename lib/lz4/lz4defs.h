@@ -146,6 +146,16 @@ typedef struct _U64_S { u64 v; } U64_S;
 
 #endif
 
+/*
+ * Copy 16 bytes without advancing the pointers. With efficient unaligned
+ * access this is a pair of 64-bit loads and stores (ldp/stp on arm64).
+ */
+#define LZ4_COPY16(s, d)			\
+	do {					\
+		PUT8(s, d);			\
+		PUT8(((s) + 8), ((d) + 8));	\
+	} while (0)
+
 #define LZ4_WILDCOPY(s, d, e)		\
 	do {				\
 		LZ4_COPYPACKET(s, d);	\
@@ -0,0 +1,105 @@
+/*
+ * Kernel module measuring memcpy and copy_to/from_user throughput.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <linux/ktime.h>
+#include <linux/mman.h>
+#include <linux/module.h>
+#include <linux/sched.h>
+#include <linux/uaccess.h>
+#include <linux/vmalloc.h>
+
+#define BUF_SIZE	(1024 * 1024)
+#define MIN_COPY	16
+/* each size is copied until about this many bytes have gone through */
+#define BYTES_PER_SIZE	(64 * 1024 * 1024)
+
+enum copy_kind {
+	COPY_MEMCPY,
+	COPY_TO_USER,
+	COPY_FROM_USER,
+};
+
+static unsigned long copy_mbps(enum copy_kind kind, char *kbuf,
+			       char __user *ubuf, size_t size)
+{
+	unsigned long loops = BYTES_PER_SIZE / size, i;
+	size_t off = 0;
+	u64 start, ns;
+
+	start = ktime_get_ns();
+	for (i = 0; i < loops; i++) {
+		/* walk the buffers, so large sizes do not just hit the cache */
+		switch (kind) {
+		case COPY_MEMCPY:
+			memcpy(kbuf + off, kbuf + BUF_SIZE / 2 + off, size);
+			break;
+		case COPY_TO_USER:
+			if (copy_to_user(ubuf + off, kbuf + off, size))
+				return 0;
+			break;
+		case COPY_FROM_USER:
+			if (copy_from_user(kbuf + off, ubuf + off, size))
+				return 0;
+			break;
+		}
+		off += size;
+		if (off + size > BUF_SIZE / 2)
+			off = 0;
+	}
+	ns = ktime_get_ns() - start;
+
+	return ns ? div64_u64((u64)loops * size * NSEC_PER_SEC,
+			      ns * 1024 * 1024) : 0;
+}
+
+static int __init test_copy_speed_init(void)
+{
+	unsigned long user_addr;
+	char __user *ubuf;
+	char *kbuf;
+	size_t size;
+
+	kbuf = vmalloc(BUF_SIZE);
+	if (!kbuf)
+		return -ENOMEM;
+
+	user_addr = vm_mmap(NULL, 0, BUF_SIZE, PROT_READ | PROT_WRITE,
+			    MAP_ANONYMOUS | MAP_PRIVATE | MAP_POPULATE, 0);
+	if (user_addr >= (unsigned long)(TASK_SIZE)) {
+		pr_warn("Failed to allocate user memory\n");
+		vfree(kbuf);
+		return -ENOMEM;
+	}
+	ubuf = (char __user *)user_addr;
+	memset(kbuf, 0x5a, BUF_SIZE);
+
+	pr_info("%8s %10s %10s %10s (MB/s)\n", "size", "memcpy",
+		"to_user", "from_user");
+	for (size = MIN_COPY; size <= BUF_SIZE / 4; size *= 4)
+		pr_info("%8zu %10lu %10lu %10lu\n", size,
+			copy_mbps(COPY_MEMCPY, kbuf, ubuf, size),
+			copy_mbps(COPY_TO_USER, kbuf, ubuf, size),
+			copy_mbps(COPY_FROM_USER, kbuf, ubuf, size));
+
+	vm_munmap(user_addr, BUF_SIZE);
+	vfree(kbuf);
+
+	/* nothing to keep loaded */
+	return -EAGAIN;
+}
+
+module_init(test_copy_speed_init);
+
+MODULE_LICENSE("GPL");
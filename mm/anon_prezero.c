@@ -0,0 +1,167 @@
+/*
+ * mm/anon_prezero.c
+ *
+ * Pool of pre-zeroed pages for anonymous fault-around.
+ *
+ * Write faults in VMAs marked MADV_FAULTAROUND, typically the heap and
+ * stack ranges zygote sets up before it forks an app, map a small aligned
+ * window of pages around the faulting address instead of a single page.
+ * Those pages come from this pool, which kprezerod refills and clears at
+ * the lowest priority, so that the fault path neither zeroes nor goes
+ * into the page allocator for them.  The pool is given back to the page
+ * allocator under memory pressure, and refilling then backs off a while.
+ */
+
+#include <linux/freezer.h>
+#include <linux/gfp.h>
+#include <linux/highmem.h>
+#include <linux/init.h>
+#include <linux/jiffies.h>
+#include <linux/kthread.h>
+#include <linux/list.h>
+#include <linux/mm.h>
+#include <linux/moduleparam.h>
+#include <linux/sched.h>
+#include <linux/spinlock.h>
+#include <linux/wait.h>
+#include <linux/anon_prezero.h>
+
+/* how long refilling stays off after the shrinker emptied the pool */
+#define PREZERO_BACKOFF		(10 * HZ)
+
+static unsigned int pool_pages = 1024;
+module_param(pool_pages, uint, 0644);
+
+unsigned int anon_faultaround_pages = 16;
+module_param_named(faultaround_pages, anon_faultaround_pages, uint, 0644);
+
+static LIST_HEAD(prezero_list);
+static unsigned long nr_prezero;
+static DEFINE_SPINLOCK(prezero_lock);
+static DECLARE_WAIT_QUEUE_HEAD(prezero_wait);
+static unsigned long prezero_backoff_until;
+
+static struct page *prezero_take(void)
+{
+	struct page *page = NULL;
+
+	spin_lock(&prezero_lock);
+	if (nr_prezero) {
+		page = list_first_entry(&prezero_list, struct page, lru);
+		list_del(&page->lru);
+		nr_prezero--;
+	}
+	spin_unlock(&prezero_lock);
+	return page;
+}
+
+static bool prezero_low(void)
+{
+	return ACCESS_ONCE(nr_prezero) < ACCESS_ONCE(pool_pages) / 2;
+}
+
+/*
+ * Returns a zeroed order-0 page with a single reference, or NULL if the
+ * pool is empty.  The caller falls back to allocating and clearing one.
+ */
+struct page *prezero_page_get(void)
+{
+	struct page *page = prezero_take();
+
+	if (prezero_low() && waitqueue_active(&prezero_wait))
+		wake_up(&prezero_wait);
+	return page;
+}
+
+/*
+ * Gives back a page taken with prezero_page_get() that was never mapped,
+ * so is still zero, or frees it if the pool is full.
+ */
+void prezero_page_put(struct page *page)
+{
+	spin_lock(&prezero_lock);
+	if (nr_prezero < ACCESS_ONCE(pool_pages)) {
+		list_add(&page->lru, &prezero_list);
+		nr_prezero++;
+		page = NULL;
+	}
+	spin_unlock(&prezero_lock);
+
+	if (page)
+		put_page(page);
+}
+
+static int prezero_thread(void *unused)
+{
+	struct page *page;
+	long backoff;
+
+	set_freezable();
+	set_user_nice(current, MAX_NICE);
+
+	while (!kthread_should_stop()) {
+		wait_event_freezable(prezero_wait,
+				     prezero_low() || kthread_should_stop());
+
+		backoff = ACCESS_ONCE(prezero_backoff_until) - jiffies;
+		if (backoff > 0) {
+			schedule_timeout_interruptible(backoff);
+			continue;
+		}
+
+		while (ACCESS_ONCE(nr_prezero) < ACCESS_ONCE(pool_pages) &&
+		       !kthread_should_stop()) {
+			page = alloc_page(GFP_HIGHUSER_MOVABLE | __GFP_NORETRY |
+					  __GFP_NOWARN);
+			if (!page) {
+				prezero_backoff_until = jiffies + PREZERO_BACKOFF;
+				break;
+			}
+			clear_highpage(page);
+			prezero_page_put(page);
+			cond_resched();
+		}
+	}
+	return 0;
+}
+
+static unsigned long prezero_shrink_count(struct shrinker *shrinker,
+					  struct shrink_control *sc)
+{
+	return ACCESS_ONCE(nr_prezero);
+}
+
+static unsigned long prezero_shrink_scan(struct shrinker *shrinker,
+					 struct shrink_control *sc)
+{
+	unsigned long freed = 0;
+	struct page *page;
+
+	prezero_backoff_until = jiffies + PREZERO_BACKOFF;
+	while (freed < sc->nr_to_scan && (page = prezero_take())) {
+		put_page(page);
+		freed++;
+	}
+	return freed ? freed : SHRINK_STOP;
+}
+
+static struct shrinker prezero_shrinker = {
+	.count_objects	= prezero_shrink_count,
+	.scan_objects	= prezero_shrink_scan,
+	.seeks		= DEFAULT_SEEKS,
+};
+
+static int __init anon_prezero_init(void)
+{
+	struct task_struct *task;
+
+	register_shrinker(&prezero_shrinker);
+	task = kthread_run(prezero_thread, NULL, "kprezerod");
+	if (IS_ERR(task)) {
+		pr_err("anon_prezero: Could not start kprezerod\n");
+		unregister_shrinker(&prezero_shrinker);
+		return PTR_ERR(task);
+	}
+	return 0;
+}
+late_initcall(anon_prezero_init);
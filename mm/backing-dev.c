@@ -228,6 +228,23 @@ static ssize_t max_ratio_store(struct device *dev,
 }
 BDI_SHOW(max_ratio, bdi->max_ratio)
 
+static ssize_t wb_lat_target_us_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct backing_dev_info *bdi = dev_get_drvdata(dev);
+	unsigned int target;
+	ssize_t ret;
+
+	ret = kstrtouint(buf, 10, &target);
+	if (ret < 0)
+		return ret;
+
+	bdi->wb_lat_target_us = target;
+
+	return count;
+}
+BDI_SHOW(wb_lat_target_us, bdi->wb_lat_target_us)
+
 static ssize_t stable_pages_required_show(struct device *dev,
 					  struct device_attribute *attr,
 					  char *page)
@@ -243,6 +260,7 @@ static struct attribute *bdi_dev_attrs[] = {
 	&dev_attr_read_ahead_kb.attr,
 	&dev_attr_min_ratio.attr,
 	&dev_attr_max_ratio.attr,
+	&dev_attr_wb_lat_target_us.attr,
 	&dev_attr_stable_pages_required.attr,
 	NULL,
 };
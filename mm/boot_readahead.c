@@ -0,0 +1,473 @@
+/* Copyright (c) 2016, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/atomic.h>
+#include <linux/backing-dev.h>
+#include <linux/boot_readahead.h>
+#include <linux/fs.h>
+#include <linux/hashtable.h>
+#include <linux/ioprio.h>
+#include <linux/jiffies.h>
+#include <linux/kthread.h>
+#include <linux/mm.h>
+#include <linux/proc_fs.h>
+#include <linux/sched.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/string.h>
+#include <linux/string_helpers.h>
+#include <linux/uaccess.h>
+#include <linux/vmalloc.h>
+
+#undef MODULE_PARAM_PREFIX
+#define MODULE_PARAM_PREFIX "boot_readahead."
+
+#define BRA_MAX_FILES		2048
+#define BRA_MAX_RANGES		8192
+#define BRA_HASH_BITS		10
+/* misses this many pages apart are cheaper read as one range */
+#define BRA_MERGE_GAP		8
+#define BRA_MAX_TRACE		(1024 * 1024)
+#define BRA_MAX_THREADS		8
+
+/*
+ * With boot_readahead.record=1 on the command line, every page cache miss
+ * on a block backed regular file is logged as a page range of that file,
+ * until boot_readahead.record_ms after boot or until the tables are full.
+ * Reading /proc/boot_readahead returns the ranges in the order they were
+ * first missed, one "path start nr" line each.
+ *
+ * Writing such a trace back to /proc/boot_readahead, e.g. from init as
+ * soon as /system and /data are mounted, replays it once the file is
+ * closed: a few kernel threads open the files and read the ranges ahead
+ * with force_page_cache_readahead(), which only submits the I/O. They
+ * back off while the device is read congested and stop altogether
+ * boot_readahead.budget_ms after the write, so that they do not compete
+ * with the foreground for long once the boot has caught up with them.
+ */
+
+static bool bra_record;
+module_param_named(record, bra_record, bool, S_IRUGO);
+
+/* writing 0 stops the recording */
+static unsigned int bra_record_ms = 60000;
+module_param_named(record_ms, bra_record_ms, uint, S_IRUGO | S_IWUSR);
+
+static unsigned int bra_budget_ms = 5000;
+module_param_named(budget_ms, bra_budget_ms, uint, S_IRUGO | S_IWUSR);
+
+static unsigned int bra_threads = 4;
+module_param_named(threads, bra_threads, uint, S_IRUGO | S_IWUSR);
+
+struct bra_file {
+	struct hlist_node node;
+	dev_t dev;
+	unsigned long ino;
+	char *path;
+	unsigned int last;	/* its last range, the one misses merge into */
+};
+
+struct bra_range {
+	pgoff_t start;
+	unsigned int nr;
+	unsigned int file;
+};
+
+bool boot_readahead_recording;
+
+static DEFINE_SPINLOCK(bra_lock);
+static DEFINE_HASHTABLE(bra_hash, BRA_HASH_BITS);
+static struct bra_file *bra_files;
+static struct bra_range *bra_ranges;
+static unsigned int bra_nr_files;
+static unsigned int bra_nr_ranges;
+
+static struct bra_file *bra_lookup(dev_t dev, unsigned long ino)
+{
+	struct bra_file *f;
+
+	hash_for_each_possible(bra_hash, f, node, ino ^ dev)
+		if (f->ino == ino && f->dev == dev)
+			return f;
+	return NULL;
+}
+
+static bool bra_add_range(struct bra_file *f, pgoff_t index, unsigned long nr)
+{
+	struct bra_range *r;
+
+	if (f->last != UINT_MAX) {
+		r = &bra_ranges[f->last];
+		if (index >= r->start &&
+		    index <= r->start + r->nr + BRA_MERGE_GAP) {
+			if (index + nr > r->start + r->nr)
+				r->nr = index + nr - r->start;
+			return true;
+		}
+	}
+
+	if (bra_nr_ranges == BRA_MAX_RANGES)
+		return false;
+
+	r = &bra_ranges[bra_nr_ranges];
+	r->start = index;
+	r->nr = nr;
+	r->file = f - bra_files;
+	f->last = bra_nr_ranges++;
+	return true;
+}
+
+static char *bra_file_path(struct file *file)
+{
+	char *buf, *p, *path = NULL;
+
+	if (d_unlinked(file->f_path.dentry))
+		return NULL;
+
+	buf = __getname();
+	if (!buf)
+		return NULL;
+	p = d_path(&file->f_path, buf, PATH_MAX);
+	if (!IS_ERR(p))
+		path = kstrdup(p, GFP_KERNEL);
+	__putname(buf);
+	return path;
+}
+
+void __boot_readahead_record(struct file *file, pgoff_t index,
+			     unsigned long nr)
+{
+	struct inode *inode = file->f_mapping->host;
+	dev_t dev = inode->i_sb->s_dev;
+	struct bra_file *f;
+	char *path = NULL;
+	bool full = false;
+
+	if (!S_ISREG(inode->i_mode) || !inode->i_sb->s_bdev || !nr)
+		return;
+
+	if (jiffies_to_msecs(jiffies - INITIAL_JIFFIES) >=
+	    ACCESS_ONCE(bra_record_ms)) {
+		boot_readahead_recording = false;
+		return;
+	}
+
+	spin_lock(&bra_lock);
+	f = bra_lookup(dev, inode->i_ino);
+	if (!f) {
+		/* the path has to be taken where we may sleep */
+		spin_unlock(&bra_lock);
+		path = bra_file_path(file);
+		if (!path)
+			return;
+		spin_lock(&bra_lock);
+		f = bra_lookup(dev, inode->i_ino);
+	}
+	if (!f) {
+		if (bra_nr_files == BRA_MAX_FILES) {
+			full = true;
+			goto out;
+		}
+		f = &bra_files[bra_nr_files++];
+		f->dev = dev;
+		f->ino = inode->i_ino;
+		f->path = path;
+		f->last = UINT_MAX;
+		hash_add(bra_hash, &f->node, f->ino ^ f->dev);
+		path = NULL;
+	}
+	full = !bra_add_range(f, index, nr);
+out:
+	if (full)
+		boot_readahead_recording = false;
+	spin_unlock(&bra_lock);
+	kfree(path);
+}
+
+static int bra_trace_show(struct seq_file *m, void *unused)
+{
+	unsigned int i, n;
+
+	/* ranges are only ever appended, and the files they point at first */
+	spin_lock(&bra_lock);
+	n = bra_nr_ranges;
+	spin_unlock(&bra_lock);
+
+	for (i = 0; i < n; i++) {
+		struct bra_range *r = &bra_ranges[i];
+
+		seq_escape(m, bra_files[r->file].path, " \t\n\\");
+		seq_printf(m, " %lu %u\n", r->start, ACCESS_ONCE(r->nr));
+	}
+	return 0;
+}
+
+struct bra_item {
+	pgoff_t start;
+	unsigned long nr;
+};
+
+/* consecutive lines on the same file, read by one thread */
+struct bra_group {
+	const char *path;
+	unsigned int first;
+	unsigned int nr;
+};
+
+struct bra_replay {
+	char *buf;		/* the written trace, parsed in place */
+	size_t len;
+	struct bra_item *items;
+	struct bra_group *groups;
+	unsigned int nr_groups;
+	atomic_t next;
+	atomic_t running;
+	unsigned long start;
+	unsigned long deadline;
+	atomic_t files;
+	atomic_long_t pages;
+	bool expired;
+};
+
+static atomic_t bra_replaying = ATOMIC_INIT(0);
+
+static void bra_replay_free(struct bra_replay *r)
+{
+	vfree(r->groups);
+	vfree(r->items);
+	vfree(r->buf);
+	kfree(r);
+}
+
+/* returns false once the budget is spent */
+static bool bra_wait_uncongested(struct bra_replay *r,
+				 struct backing_dev_info *bdi)
+{
+	while (bdi_read_congested(bdi)) {
+		if (time_after(jiffies, r->deadline))
+			return false;
+		congestion_wait(BLK_RW_SYNC, HZ / 50);
+	}
+	return !time_after(jiffies, r->deadline);
+}
+
+static void bra_replay_group(struct bra_replay *r, struct bra_group *g)
+{
+	struct backing_dev_info *bdi;
+	struct file *filp;
+	unsigned int i;
+
+	filp = filp_open(g->path, O_RDONLY | O_LARGEFILE, 0);
+	if (IS_ERR(filp))
+		return;
+
+	bdi = filp->f_mapping->backing_dev_info;
+	for (i = g->first; i < g->first + g->nr; i++) {
+		struct bra_item *it = &r->items[i];
+
+		if (!bra_wait_uncongested(r, bdi)) {
+			r->expired = true;
+			break;
+		}
+		force_page_cache_readahead(filp->f_mapping, filp, it->start,
+					   it->nr);
+		atomic_long_add(it->nr, &r->pages);
+	}
+	atomic_inc(&r->files);
+	filp_close(filp, NULL);
+}
+
+static int bra_replay_fn(void *data)
+{
+	struct bra_replay *r = data;
+	int i;
+
+	/* behind any foreground reader of the same priority class */
+	set_task_ioprio(current, IOPRIO_PRIO_VALUE(IOPRIO_CLASS_BE, 7));
+
+	while (!ACCESS_ONCE(r->expired)) {
+		i = atomic_inc_return(&r->next) - 1;
+		if (i >= r->nr_groups)
+			break;
+		bra_replay_group(r, &r->groups[i]);
+	}
+
+	if (atomic_dec_and_test(&r->running)) {
+		pr_info("boot_readahead: %d files, %ld pages in %u ms%s\n",
+			atomic_read(&r->files), atomic_long_read(&r->pages),
+			jiffies_to_msecs(jiffies - r->start),
+			r->expired ? ", budget spent" : "");
+		bra_replay_free(r);
+		atomic_set(&bra_replaying, 0);
+	}
+	return 0;
+}
+
+/* "path start nr" lines; anything else is skipped */
+static int bra_parse(struct bra_replay *r)
+{
+	unsigned int nr_lines = 0, n = 0;
+	const char *prev = NULL;
+	char *p = r->buf, *line;
+	size_t i;
+
+	for (i = 0; i < r->len; i++)
+		if (r->buf[i] == '\n')
+			nr_lines++;
+	nr_lines++;
+
+	r->items = vmalloc(nr_lines * sizeof(*r->items));
+	r->groups = vmalloc(nr_lines * sizeof(*r->groups));
+	if (!r->items || !r->groups)
+		return -ENOMEM;
+
+	while ((line = strsep(&p, "\n"))) {
+		char *path = strsep(&line, " ");
+		struct bra_item *it = &r->items[n];
+
+		if (!line || !*path ||
+		    sscanf(line, "%lu %lu", &it->start, &it->nr) != 2 ||
+		    !it->nr)
+			continue;
+
+		string_unescape_inplace(path, UNESCAPE_OCTAL);
+		if (!prev || strcmp(prev, path)) {
+			struct bra_group *g = &r->groups[r->nr_groups++];
+
+			g->path = path;
+			g->first = n;
+			g->nr = 0;
+			prev = path;
+		}
+		r->groups[r->nr_groups - 1].nr++;
+		n++;
+	}
+	return 0;
+}
+
+static int bra_replay_start(struct bra_replay *r)
+{
+	unsigned int i, nr = clamp_t(unsigned int, bra_threads, 1,
+				     BRA_MAX_THREADS);
+	int ret;
+
+	ret = bra_parse(r);
+	if (ret)
+		return ret;
+	if (!r->nr_groups)
+		return -EINVAL;
+
+	r->start = jiffies;
+	r->deadline = r->start + msecs_to_jiffies(bra_budget_ms);
+	atomic_set(&r->running, nr);
+	for (i = 0; i < nr; i++) {
+		struct task_struct *t;
+
+		t = kthread_run(bra_replay_fn, r, "boot_ra/%u", i);
+		if (IS_ERR(t)) {
+			/* the threads already running carry on without it */
+			if (atomic_sub_and_test(nr - i, &r->running))
+				return PTR_ERR(t);
+			break;
+		}
+	}
+	return 0;
+}
+
+static int bra_open(struct inode *inode, struct file *file)
+{
+	struct bra_replay *r;
+
+	if (file->f_mode & FMODE_READ) {
+		if (file->f_mode & FMODE_WRITE)
+			return -EINVAL;
+		if (!bra_ranges)
+			return -ENODATA;
+		return single_open(file, bra_trace_show, NULL);
+	}
+
+	if (atomic_cmpxchg(&bra_replaying, 0, 1))
+		return -EBUSY;
+
+	r = kzalloc(sizeof(*r), GFP_KERNEL);
+	if (r)
+		r->buf = vmalloc(BRA_MAX_TRACE + 1);
+	if (!r || !r->buf) {
+		kfree(r);
+		atomic_set(&bra_replaying, 0);
+		return -ENOMEM;
+	}
+	file->private_data = r;
+	return 0;
+}
+
+static ssize_t bra_write(struct file *file, const char __user *buf,
+			 size_t count, loff_t *ppos)
+{
+	struct bra_replay *r = file->private_data;
+
+	if (count > BRA_MAX_TRACE - r->len)
+		return -EFBIG;
+	if (copy_from_user(r->buf + r->len, buf, count))
+		return -EFAULT;
+	r->len += count;
+	return count;
+}
+
+/* the trace is only complete, and replayed, once it is closed */
+static int bra_release(struct inode *inode, struct file *file)
+{
+	struct bra_replay *r = file->private_data;
+
+	if (file->f_mode & FMODE_READ)
+		return single_release(inode, file);
+
+	r->buf[r->len] = '\0';
+	if (bra_replay_start(r)) {
+		bra_replay_free(r);
+		atomic_set(&bra_replaying, 0);
+	}
+	return 0;
+}
+
+static const struct file_operations bra_fops = {
+	.open		= bra_open,
+	.read		= seq_read,
+	.write		= bra_write,
+	.llseek		= seq_lseek,
+	.release	= bra_release,
+};
+
+static int __init boot_readahead_init(void)
+{
+	if (bra_record) {
+		bra_files = vzalloc(BRA_MAX_FILES * sizeof(*bra_files));
+		bra_ranges = vzalloc(BRA_MAX_RANGES * sizeof(*bra_ranges));
+		if (bra_files && bra_ranges) {
+			boot_readahead_recording = true;
+		} else {
+			vfree(bra_files);
+			vfree(bra_ranges);
+			bra_files = NULL;
+			bra_ranges = NULL;
+			pr_err("boot_readahead: no memory to record\n");
+		}
+	}
+
+	if (!proc_create("boot_readahead", S_IRUSR | S_IWUSR, NULL, &bra_fops))
+		return -ENOMEM;
+	return 0;
+}
+core_initcall(boot_readahead_init);
@@ -36,6 +36,9 @@
 #include <linux/highmem.h>
 #include <linux/delay.h>
 #include <linux/kmemleak.h>
+#include <linux/ktime.h>
+#include <linux/jiffies.h>
+#include <linux/pagemap.h>
 #include <trace/events/cma.h>
 #include <linux/io.h>
 
@@ -45,6 +48,9 @@ struct cma cma_areas[MAX_CMA_AREAS];
 unsigned cma_area_count;
 static DEFINE_MUTEX(cma_mutex);
 
+/* How long a pageblock that failed migration is left out of the search */
+#define CMA_BUSY_EXPIRE		HZ
+
 phys_addr_t cma_get_base(const struct cma *cma)
 {
 	return PFN_PHYS(cma->base_pfn);
@@ -93,6 +99,97 @@ static void cma_clear_bitmap(struct cma *cma, unsigned long pfn,
 	mutex_unlock(&cma->lock);
 }
 
+/*
+ * Pages whose references are not all accounted for by their mappings and
+ * page cache are pinned, and migrating them will keep failing for a while.
+ * This is the test compaction uses to skip such pages.
+ */
+static bool cma_page_pinned(struct page *page)
+{
+	int refs;
+
+	if (PageBuddy(page) || !page_count(page))
+		return false;
+
+	refs = page_mapcount(page);
+	if (page_mapping(page))
+		refs += 1 + page_has_private(page);
+
+	return page_count(page) > refs;
+}
+
+/*
+ * After migration of [pfn, pfn + count) failed, leave the pageblocks holding
+ * pinned pages out of the next searches instead of retrying them right away.
+ */
+static void cma_mark_busy(struct cma *cma, unsigned long pfn,
+			  unsigned long count)
+{
+	unsigned long end = pfn + count;
+	unsigned long block;
+
+	mutex_lock(&cma->lock);
+#ifdef CONFIG_CMA_DEBUGFS
+	cma->nr_busy_retry++;
+#endif
+	while (pfn < end) {
+		block = (pfn - cma->base_pfn) >> pageblock_order;
+		if (cma_page_pinned(pfn_to_page(pfn))) {
+			cma->busy_until[block] = jiffies + CMA_BUSY_EXPIRE;
+			pfn = cma->base_pfn + ((block + 1) << pageblock_order);
+			continue;
+		}
+		pfn++;
+	}
+	mutex_unlock(&cma->lock);
+}
+
+/*
+ * Returns the bitmap position right after the last pageblock of the given
+ * bitmap range that recently failed migration, or 0 if there is none.
+ * Called with cma->lock held.
+ */
+static unsigned long cma_busy_skip(struct cma *cma, unsigned long bitmap_no,
+				   unsigned long bitmap_count)
+{
+	unsigned long first = (bitmap_no << cma->order_per_bit) >>
+				pageblock_order;
+	unsigned long last = (((bitmap_no + bitmap_count) <<
+				cma->order_per_bit) - 1) >> pageblock_order;
+	unsigned long block, next = 0;
+
+	for (block = first; block <= last; block++) {
+		unsigned long until = cma->busy_until[block];
+
+		if (until && time_before(jiffies, until))
+			next = ((block + 1) << pageblock_order) >>
+				cma->order_per_bit;
+		else
+			cma->busy_until[block] = 0;
+	}
+
+	return next;
+}
+
+#ifdef CONFIG_CMA_DEBUGFS
+static void cma_account_alloc(struct cma *cma, ktime_t start, bool success)
+{
+	s64 ms = ktime_to_ms(ktime_sub(ktime_get(), start));
+	int bucket = min_t(int, fls64(ms), CMA_LATENCY_BUCKETS - 1);
+
+	mutex_lock(&cma->lock);
+	cma->alloc_latency[bucket]++;
+	if (!success)
+		cma->nr_alloc_fail++;
+	mutex_unlock(&cma->lock);
+}
+#else
+static inline void cma_account_alloc(struct cma *cma, ktime_t start,
+				     bool success)
+{
+}
+#endif
+
 static int __init cma_activate_area(struct cma *cma)
 {
 	int bitmap_size = BITS_TO_LONGS(cma_bitmap_maxno(cma)) * sizeof(long);
@@ -105,6 +202,12 @@ static int __init cma_activate_area(struct cma *cma)
 	if (!cma->bitmap)
 		return -ENOMEM;
 
+	cma->busy_until = kcalloc(i, sizeof(*cma->busy_until), GFP_KERNEL);
+	if (!cma->busy_until) {
+		kfree(cma->bitmap);
+		return -ENOMEM;
+	}
+
 	WARN_ON_ONCE(!pfn_valid(pfn));
 	zone = page_zone(pfn_to_page(pfn));
 
@@ -140,6 +243,7 @@ static int __init cma_activate_area(struct cma *cma)
 	return 0;
 
 err:
+	kfree(cma->busy_until);
 	kfree(cma->bitmap);
 	cma->count = 0;
 	return -EINVAL;
@@ -367,9 +471,12 @@ struct page *cma_alloc(struct cma *cma, size_t count, unsigned int align)
 {
 	unsigned long mask, offset, pfn, start = 0;
 	unsigned long bitmap_maxno, bitmap_no, bitmap_count;
+	unsigned long next;
 	struct page *page = NULL;
 	int ret;
 	int retry_after_sleep = 0;
+	bool skip_busy = true, skipped = false;
+	ktime_t start_time;
 
 	if (!cma || !cma->count)
 		return NULL;
@@ -390,12 +497,35 @@ struct page *cma_alloc(struct cma *cma, size_t count, unsigned int align)
 	if (bitmap_count > bitmap_maxno)
 		return NULL;
 
+	start_time = ktime_get();
 	for (;;) {
 		mutex_lock(&cma->lock);
-		bitmap_no = bitmap_find_next_zero_area_off(cma->bitmap,
-				bitmap_maxno, start, bitmap_count, mask,
-				offset);
+		for (;;) {
+			bitmap_no = bitmap_find_next_zero_area_off(cma->bitmap,
+					bitmap_maxno, start, bitmap_count,
+					mask, offset);
+			if (bitmap_no >= bitmap_maxno || !skip_busy)
+				break;
+			next = cma_busy_skip(cma, bitmap_no, bitmap_count);
+			if (!next)
+				break;
+#ifdef CONFIG_CMA_DEBUGFS
+			cma->nr_busy_skip++;
+#endif
+			skipped = true;
+			start = next;
+		}
 		if (bitmap_no >= bitmap_maxno) {
+			if (skipped && skip_busy) {
+				/*
+				 * Only ranges that recently failed migration
+				 * are left, try those before sleeping.
+				 */
+				mutex_unlock(&cma->lock);
+				skip_busy = false;
+				start = 0;
+				continue;
+			}
 			if (retry_after_sleep < 2) {
 				start = 0;
 				/*
@@ -436,6 +566,8 @@ struct page *cma_alloc(struct cma *cma, size_t count, unsigned int align)
 		if (ret != -EBUSY)
 			break;
 
+		cma_mark_busy(cma, pfn, count);
+
 		pr_debug("%s(): memory range at %p is busy, retrying\n",
 			 __func__, pfn_to_page(pfn));
 
@@ -444,6 +576,7 @@ struct page *cma_alloc(struct cma *cma, size_t count, unsigned int align)
 		start = bitmap_no + mask + 1;
 	}
 
+	cma_account_alloc(cma, start_time, page != NULL);
 	trace_cma_alloc(page ? pfn : -1UL, page, count, align);
 
 	pr_debug("%s(): returned %p\n", __func__, page);
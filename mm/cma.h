@@ -1,15 +1,24 @@
 #ifndef __MM_CMA_H__
 #define __MM_CMA_H__
 
+#define CMA_LATENCY_BUCKETS	12
+
 struct cma {
 	unsigned long   base_pfn;
 	unsigned long   count;
 	unsigned long   *bitmap;
 	unsigned int order_per_bit; /* Order of pages represented by one bit */
 	struct mutex    lock;
+	/* Per pageblock, jiffies until which failed migration is not retried */
+	unsigned long   *busy_until;
 #ifdef CONFIG_CMA_DEBUGFS
 	struct hlist_head mem_head;
 	spinlock_t mem_head_lock;
+	/* cma_alloc() latency, bucket i counts [2^(i-1), 2^i) ms */
+	unsigned long alloc_latency[CMA_LATENCY_BUCKETS];
+	unsigned long nr_alloc_fail;
+	unsigned long nr_busy_retry;	/* ranges that failed migration */
+	unsigned long nr_busy_skip;	/* ranges skipped as recently busy */
 #endif
 };
 
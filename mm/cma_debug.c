@@ -11,6 +11,7 @@
 #include <linux/kernel.h>
 #include <linux/slab.h>
 #include <linux/mm_types.h>
+#include <linux/seq_file.h>
 
 #include "cma.h"
 
@@ -69,6 +70,38 @@ static int cma_maxchunk_get(void *data, u64 *val)
 }
 DEFINE_SIMPLE_ATTRIBUTE(cma_maxchunk_fops, cma_maxchunk_get, NULL, "%llu\n");
 
+static int cma_latency_show(struct seq_file *m, void *unused)
+{
+	struct cma *cma = m->private;
+	int i;
+
+	mutex_lock(&cma->lock);
+	seq_printf(m, "<1ms: %lu\n", cma->alloc_latency[0]);
+	for (i = 1; i < CMA_LATENCY_BUCKETS - 1; i++)
+		seq_printf(m, "%u-%ums: %lu\n", 1U << (i - 1), (1U << i) - 1,
+			   cma->alloc_latency[i]);
+	seq_printf(m, ">=%ums: %lu\n", 1U << (CMA_LATENCY_BUCKETS - 2),
+		   cma->alloc_latency[CMA_LATENCY_BUCKETS - 1]);
+	seq_printf(m, "failed: %lu\n", cma->nr_alloc_fail);
+	seq_printf(m, "busy_retry: %lu\n", cma->nr_busy_retry);
+	seq_printf(m, "busy_skip: %lu\n", cma->nr_busy_skip);
+	mutex_unlock(&cma->lock);
+
+	return 0;
+}
+
+static int cma_latency_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, cma_latency_show, inode->i_private);
+}
+
+static const struct file_operations cma_latency_fops = {
+	.open		= cma_latency_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 static void cma_add_to_cma_mem_list(struct cma *cma, struct cma_mem *mem)
 {
 	spin_lock(&cma->mem_head_lock);
@@ -185,6 +218,8 @@ static void cma_debugfs_add_one(struct cma *cma, int idx)
 				&cma->order_per_bit, &cma_debugfs_fops);
 	debugfs_create_file("used", S_IRUGO, tmp, cma, &cma_used_fops);
 	debugfs_create_file("maxchunk", S_IRUGO, tmp, cma, &cma_maxchunk_fops);
+	debugfs_create_file("alloc_latency", S_IRUGO, tmp, cma,
+				&cma_latency_fops);
 
 	u32s = DIV_ROUND_UP(cma_bitmap_maxno(cma), BITS_PER_BYTE * sizeof(u32));
 	debugfs_create_u32_array("bitmap", S_IRUGO, tmp, (u32*)cma->bitmap, u32s);
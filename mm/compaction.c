@@ -1121,6 +1121,18 @@ static isolate_migrate_t isolate_migratepages(struct zone *zone,
 	return cc->nr_migratepages ? ISOLATE_SUCCESS : ISOLATE_NONE;
 }
 
+/* Number of free blocks of @order the zone could hand out */
+static unsigned long zone_free_blocks(struct zone *zone, int order)
+{
+	unsigned long nr = 0;
+	int o;
+
+	for (o = order; o < MAX_ORDER; o++)
+		nr += zone->free_area[o].nr_free << (o - order);
+
+	return nr;
+}
+
 static int compact_finished(struct zone *zone, struct compact_control *cc,
 			    const int migratetype)
 {
@@ -1163,6 +1175,11 @@ static int compact_finished(struct zone *zone, struct compact_control *cc,
 							cc->alloc_flags))
 		return COMPACT_CONTINUE;
 
+	/* Proactive compactor: Are there enough free blocks? */
+	if (cc->nr_target)
+		return zone_free_blocks(zone, cc->order) >= cc->nr_target ?
+			COMPACT_PARTIAL : COMPACT_CONTINUE;
+
 	/* Direct compactor: Is a suitable page free? */
 	for (order = cc->order; order < MAX_ORDER; order++) {
 		struct free_area *area = &zone->free_area[order];
@@ -1245,6 +1262,11 @@ static int compact_zone(struct zone *zone, struct compact_control *cc)
 
 	ret = compaction_suitable(zone, cc->order, cc->alloc_flags,
 							cc->classzone_idx);
+	/* A proactive compactor wants more than a single free block */
+	if (ret == COMPACT_PARTIAL && cc->nr_target &&
+	    zone_free_blocks(zone, cc->order) < cc->nr_target)
+		ret = COMPACT_CONTINUE;
+
 	switch (ret) {
 	case COMPACT_PARTIAL:
 	case COMPACT_SKIPPED:
@@ -1483,19 +1505,49 @@ static struct compact_thread {
 	struct task_struct *task;
 	struct timer_list timer;
 	atomic_t should_run;
+	struct timer_list proactive_timer;
+	atomic_t proactive_should_run;
 } compact_thread;
 
 static uint compact_interval_sec = 1800;
 module_param_named(interval, compact_interval_sec, uint,
 			S_IRUGO | S_IWUSR | S_IWGRP);
 
+/*
+ * Proactive compaction keeps, per zone index, a number of free blocks of
+ * the orders ION, KGSL and WLAN allocate so that these allocations do not
+ * have to stall in direct compaction. A target of 0 disables it.
+ */
+static const int compact_proactive_orders[] = { 8,
+						COMPACT_PROACTIVE_MIN_ORDER };
+static uint compact_order8_target[MAX_NR_ZONES] = {
+	[0 ... MAX_NR_ZONES - 1] = 4
+};
+static uint compact_order4_target[MAX_NR_ZONES] = {
+	[0 ... MAX_NR_ZONES - 1] = 32
+};
+module_param_array_named(order8_target, compact_order8_target, uint, NULL,
+			S_IRUGO | S_IWUSR | S_IWGRP);
+module_param_array_named(order4_target, compact_order4_target, uint, NULL,
+			S_IRUGO | S_IWUSR | S_IWGRP);
+
+static uint compact_proactive_interval_ms = 1000;
+module_param_named(proactive_interval_ms, compact_proactive_interval_ms, uint,
+			S_IRUGO | S_IWUSR | S_IWGRP);
+
 static void compact_nodes(void);
+static void compact_proactive(void);
 
 static int compact_thread_should_run(void)
 {
 	return atomic_read(&compact_thread.should_run);
 }
 
+static int compact_thread_proactive_should_run(void)
+{
+	return atomic_read(&compact_thread.proactive_should_run);
+}
+
 static void compact_thread_wakeup(void)
 {
 	atomic_set(&compact_thread.should_run, 1);
@@ -1509,16 +1561,29 @@ static void compact_thread_timer_func(unsigned long data)
 			jiffies + (HZ * compact_interval_sec));
 }
 
+static void compact_thread_proactive_timer_func(unsigned long data)
+{
+	atomic_set(&compact_thread.proactive_should_run, 1);
+	wake_up(&compact_thread.waitqueue);
+	mod_timer(&compact_thread.proactive_timer, jiffies +
+		msecs_to_jiffies(max(compact_proactive_interval_ms, 100U)));
+}
+
 static int compact_thread_func(void *data)
 {
 	set_freezable();
 	for (;;) {
 		wait_event_freezable(compact_thread.waitqueue,
-				compact_thread_should_run());
+				compact_thread_should_run() ||
+				compact_thread_proactive_should_run());
 		if (compact_thread_should_run()) {
 			compact_nodes();
 			atomic_set(&compact_thread.should_run, 0);
 		}
+		if (compact_thread_proactive_should_run()) {
+			compact_proactive();
+			atomic_set(&compact_thread.proactive_should_run, 0);
+		}
 	}
 	return 0;
 }
@@ -1613,6 +1678,91 @@ static void compact_node(int nid)
 	__compact_pgdat(NODE_DATA(nid), &cc);
 }
 
+static uint compact_proactive_target(struct zone *zone, int i)
+{
+	if (compact_proactive_orders[i] == COMPACT_PROACTIVE_MIN_ORDER)
+		return compact_order4_target[zone_idx(zone)];
+	return compact_order8_target[zone_idx(zone)];
+}
+
+/*
+ * Top up the free high-order blocks of each zone to their targets, largest
+ * order first as those also count towards the smaller one. Only runs from
+ * kcompact, which gets the CPU when nothing else wants it, and backs off
+ * from zones where compaction could not reach the target.
+ */
+static void compact_proactive(void)
+{
+	struct zone *zone;
+	bool drained = false;
+	int i;
+
+	for_each_populated_zone(zone) {
+		if (zone->compact_proactive_skip) {
+			zone->compact_proactive_skip--;
+			continue;
+		}
+
+		for (i = 0; i < ARRAY_SIZE(compact_proactive_orders); i++) {
+			int order = compact_proactive_orders[i];
+			unsigned long target, before, after, credit;
+			struct compact_control cc = {
+				.order = order,
+				.mode = MIGRATE_SYNC_LIGHT,
+				.zone = zone,
+				.classzone_idx = zone_idx(zone),
+			};
+
+			target = compact_proactive_target(zone, i);
+			if (!target)
+				continue;
+			cc.nr_target = target;
+
+			before = zone_free_blocks(zone, order);
+			if (before >= target)
+				continue;
+
+			/* Blocks are made of free memory, keep the reserve */
+			if (!zone_watermark_ok(zone, 0, high_wmark_pages(zone) +
+					(target << order), 0, 0))
+				break;
+
+			if (!drained) {
+				lru_add_drain_all();
+				drained = true;
+			}
+
+			count_vm_event(COMPACTPROACTIVE);
+			INIT_LIST_HEAD(&cc.freepages);
+			INIT_LIST_HEAD(&cc.migratepages);
+			compact_zone(zone, &cc);
+
+			VM_BUG_ON(!list_empty(&cc.freepages));
+			VM_BUG_ON(!list_empty(&cc.migratepages));
+
+			after = zone_free_blocks(zone, order);
+			if (after > before) {
+				credit = atomic_read(
+					&zone->compact_proactive_credit);
+				atomic_set(&zone->compact_proactive_credit,
+					min(credit + after - before, after));
+			}
+
+			if (after < target) {
+				if (zone->compact_proactive_shift <
+						COMPACT_MAX_DEFER_SHIFT)
+					zone->compact_proactive_shift++;
+				zone->compact_proactive_skip =
+					1U << zone->compact_proactive_shift;
+				break;
+			}
+
+			count_vm_event(COMPACTPROACTIVE_SUCCESS);
+			zone->compact_proactive_shift = 0;
+		}
+	}
+}
+
 /* Compact all nodes in the system */
 static void compact_nodes(void)
 {
@@ -1693,11 +1843,17 @@ static int  __init mem_compaction_init(void)
 
 	init_timer_deferrable(&compact_thread.timer);
 	compact_thread.timer.function = compact_thread_timer_func;
+	init_timer_deferrable(&compact_thread.proactive_timer);
+	compact_thread.proactive_timer.function =
+				compact_thread_proactive_timer_func;
 	init_waitqueue_head(&compact_thread.waitqueue);
 	compact_thread.task = kthread_run(compact_thread_func, NULL,
 				"%s", "kcompact");
-	if (!IS_ERR(compact_thread.task))
+	if (!IS_ERR(compact_thread.task)) {
 		sched_setscheduler(compact_thread.task, SCHED_IDLE, &param);
+		mod_timer(&compact_thread.proactive_timer, jiffies +
+			msecs_to_jiffies(compact_proactive_interval_ms));
+	}
 
 	fb_register_client(&compact_notifier_block);
 	return 0;
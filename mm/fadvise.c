@@ -78,17 +78,22 @@ SYSCALL_DEFINE4(fadvise64_64, int, fd, loff_t, offset, loff_t, len, int, advice)
 	switch (advice) {
 	case POSIX_FADV_NORMAL:
 		f.file->f_ra.ra_pages = bdi->ra_pages;
+		f.file->f_ra.mmap_mode = RA_MMAP_AUTO;
+		f.file->f_ra.mmap_seq = 0;
+		f.file->f_ra.mmap_rand = 0;
 		spin_lock(&f.file->f_lock);
 		f.file->f_mode &= ~FMODE_RANDOM;
 		spin_unlock(&f.file->f_lock);
 		break;
 	case POSIX_FADV_RANDOM:
+		f.file->f_ra.mmap_mode = RA_MMAP_RANDOM;
 		spin_lock(&f.file->f_lock);
 		f.file->f_mode |= FMODE_RANDOM;
 		spin_unlock(&f.file->f_lock);
 		break;
 	case POSIX_FADV_SEQUENTIAL:
 		f.file->f_ra.ra_pages = bdi->ra_pages * 2;
+		f.file->f_ra.mmap_mode = RA_MMAP_SEQUENTIAL;
 		spin_lock(&f.file->f_lock);
 		f.file->f_mode &= ~FMODE_RANDOM;
 		spin_unlock(&f.file->f_lock);
@@ -35,6 +35,7 @@
 #include <linux/memcontrol.h>
 #include <linux/cleancache.h>
 #include <linux/rmap.h>
+#include <linux/boot_readahead.h>
 #include "internal.h"
 
 #define CREATE_TRACE_POINTS
@@ -630,7 +631,7 @@ int add_to_page_cache_lru(struct page *page, struct address_space *mapping,
 		 * recently, in which case it should be activated like
 		 * any other repeatedly accessed page.
 		 */
-		if (shadow && workingset_refault(shadow)) {
+		if (shadow && workingset_refault(shadow, page)) {
 			SetPageActive(page);
 			workingset_activation(page);
 		} else
@@ -1491,6 +1492,7 @@ static ssize_t do_generic_file_read(struct file *filp, loff_t *ppos,
 find_page:
 		page = find_get_page(mapping, index);
 		if (!page) {
+			boot_readahead_record(filp, index, last_index - index);
 			page_cache_sync_readahead(mapping,
 					ra, filp,
 					index, last_index - index);
@@ -1774,6 +1776,28 @@ static int page_cache_read(struct file *file, pgoff_t offset)
 
 #define MMAP_LOTSAMISS  (100)
 
+/* Read-around window used once a file is known to be randomly accessed */
+#define MMAP_RAND_READAROUND	(4)
+
+/*
+ * Learn the access pattern of an mmap'd file from its major faults. A fault
+ * landing shortly after the previous one extends the sequential run, any
+ * other fault extends the random run; each run resets the other.
+ */
+static void mmap_ra_track(struct file_ra_state *ra, pgoff_t offset)
+{
+	if (offset > ra->mmap_prev && offset - ra->mmap_prev <= ra->ra_pages) {
+		if (ra->mmap_seq < MMAP_SEQ_RUN)
+			ra->mmap_seq++;
+		ra->mmap_rand = 0;
+	} else {
+		if (ra->mmap_rand < MMAP_RAND_RUN)
+			ra->mmap_rand++;
+		ra->mmap_seq = 0;
+	}
+	ra->mmap_prev = offset;
+}
+
 /*
  * Synchronous readahead happens when we don't even find
  * a page in the page cache at all.
@@ -1789,10 +1813,14 @@ static void do_sync_mmap_readahead(struct vm_area_struct *vma,
 	/* If we don't want any read-ahead, don't bother */
 	if (vma->vm_flags & VM_RAND_READ)
 		return;
+	if (ra->mmap_mode == RA_MMAP_RANDOM)
+		return;
 	if (!ra->ra_pages)
 		return;
 
-	if (vma->vm_flags & VM_SEQ_READ) {
+	mmap_ra_track(ra, offset);
+
+	if (ra_mmap_sequential(vma, ra)) {
 		page_cache_sync_readahead(mapping, ra, file, offset,
 					  ra->ra_pages);
 		return;
@@ -1810,9 +1838,12 @@ static void do_sync_mmap_readahead(struct vm_area_struct *vma,
 		return;
 
 	/*
-	 * mmap read-around
+	 * mmap read-around, shrunk to a few pages around the fault once
+	 * the faults are known to be scattered over the file.
 	 */
 	ra_pages = max_sane_readahead(ra->ra_pages);
+	if (ra_mmap_random(vma, ra))
+		ra_pages = min_t(unsigned long, ra_pages, MMAP_RAND_READAROUND);
 	ra->start = max_t(long, 0, offset - ra_pages / 2);
 	ra->size = ra_pages;
 	ra->async_size = ra_pages / 4;
@@ -1834,6 +1865,8 @@ static void do_async_mmap_readahead(struct vm_area_struct *vma,
 	/* If we don't want any read-ahead, don't bother */
 	if (vma->vm_flags & VM_RAND_READ)
 		return;
+	if (ra->mmap_mode == RA_MMAP_RANDOM)
+		return;
 	if (ra->mmap_miss > 0)
 		ra->mmap_miss--;
 	if (PageReadahead(page))
@@ -1893,6 +1926,7 @@ int filemap_fault(struct vm_area_struct *vma, struct vm_fault *vmf)
 		do_async_mmap_readahead(vma, ra, file, page, offset);
 	} else if (!page) {
 		/* No page in the page cache at all */
+		boot_readahead_record(file, offset, 1);
 		do_sync_mmap_readahead(vma, ra, file, offset);
 		count_vm_event(PGMAJFAULT);
 		mem_cgroup_count_vm_event(vma->vm_mm, PGMAJFAULT);
@@ -36,6 +36,37 @@ static inline unsigned long ra_submit(struct file_ra_state *ra,
 					ra->start, ra->size, ra->async_size);
 }
 
+/*
+ * Number of consecutive forward (resp. scattered) major faults after which
+ * an mmap'd file is treated as sequentially (resp. randomly) accessed.
+ */
+#define MMAP_SEQ_RUN	4
+#define MMAP_RAND_RUN	8
+
+static inline bool ra_mmap_random(struct vm_area_struct *vma,
+				  struct file_ra_state *ra)
+{
+	if (vma->vm_flags & VM_RAND_READ)
+		return true;
+	if (vma->vm_flags & VM_SEQ_READ)
+		return false;
+	if (ra->mmap_mode != RA_MMAP_AUTO)
+		return ra->mmap_mode == RA_MMAP_RANDOM;
+	return ra->mmap_rand >= MMAP_RAND_RUN;
+}
+
+static inline bool ra_mmap_sequential(struct vm_area_struct *vma,
+				      struct file_ra_state *ra)
+{
+	if (vma->vm_flags & VM_SEQ_READ)
+		return true;
+	if (vma->vm_flags & VM_RAND_READ)
+		return false;
+	if (ra->mmap_mode != RA_MMAP_AUTO)
+		return ra->mmap_mode == RA_MMAP_SEQUENTIAL;
+	return ra->mmap_seq >= MMAP_SEQ_RUN;
+}
+
 /*
  * Turn a non-refcounted page (->_count == 0) into refcounted with
  * a count of one.
@@ -179,6 +210,9 @@ struct compact_control {
 #define COMPACTION_PASSES_MAX 4
 	int passes;			/* Number of passes for this search */
 	bool retry;			/* True if another pass is suggested */
+	unsigned long nr_target;	/* Free blocks of order wanted by a
+					 * proactive compactor, else 0
+					 */
 };
 
 unsigned long
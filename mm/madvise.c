@@ -93,6 +93,16 @@ static long madvise_behavior(struct vm_area_struct *vma,
 		if (error)
 			goto out;
 		break;
+	case MADV_FAULTAROUND:
+		if (vma->vm_file || (new_flags & (VM_SHARED | VM_SPECIAL))) {
+			error = -EINVAL;
+			goto out;
+		}
+		new_flags |= VM_ANON_FAULTAROUND;
+		break;
+	case MADV_NOFAULTAROUND:
+		new_flags &= ~VM_ANON_FAULTAROUND;
+		break;
 	}
 
 	if (new_flags == vma->vm_flags) {
@@ -410,6 +420,10 @@ madvise_behavior_valid(int behavior)
 #endif
 	case MADV_DONTDUMP:
 	case MADV_DODUMP:
+#ifdef CONFIG_ANON_FAULTAROUND
+	case MADV_FAULTAROUND:
+	case MADV_NOFAULTAROUND:
+#endif
 		return 1;
 
 	default:
@@ -102,6 +102,8 @@ enum mem_cgroup_events_index {
 	MEM_CGROUP_EVENTS_PGPGOUT,	/* # of pages paged out */
 	MEM_CGROUP_EVENTS_PGFAULT,	/* # of page-faults */
 	MEM_CGROUP_EVENTS_PGMAJFAULT,	/* # of major page-faults */
+	MEM_CGROUP_EVENTS_WORKINGSET_REFAULT,	/* # of page cache refaults */
+	MEM_CGROUP_EVENTS_WORKINGSET_ACTIVATE,	/* # of refaults activated */
 	MEM_CGROUP_EVENTS_NSTATS,
 };
 
@@ -110,6 +112,8 @@ static const char * const mem_cgroup_events_names[] = {
 	"pgpgout",
 	"pgfault",
 	"pgmajfault",
+	"workingset_refault",
+	"workingset_activate",
 };
 
 static const char * const mem_cgroup_lru_names[] = {
@@ -370,6 +374,16 @@ struct mem_cgroup {
 	struct list_head event_list;
 	spinlock_t event_list_lock;
 
+	/*
+	 * Workingset refault tracking, see mem_cgroup_workingset_refault().
+	 * The rate is updated at most once per second under refault_lock.
+	 */
+	spinlock_t refault_lock;
+	unsigned long refault_stamp;		/* jiffies of the last update */
+	unsigned long refault_snapshot;		/* refault events at the stamp */
+	unsigned long refault_rate;		/* decaying refaults per second */
+	unsigned long refault_distance;		/* decaying refault distance */
+
 	struct mem_cgroup_per_node *nodeinfo[0];
 	/* WARNING: nodeinfo must be the last member here */
 };
@@ -1454,6 +1468,122 @@ bool task_in_mem_cgroup(struct task_struct *task,
 	return ret;
 }
 
+/*
+ * Refault rate at which a group gets the full protection of its refault
+ * distance from page cache reclaim, less frequent refaults are protected
+ * proportionally less.
+ */
+#define WORKINGSET_REFAULT_RATE_HIGH	256
+
+/**
+ * mem_cgroup_workingset_refault - account a page cache refault
+ * @page: the refaulting page
+ * @distance: refault distance of the page, in pages
+ * @activate: whether the page is activated on refault
+ */
+void mem_cgroup_workingset_refault(struct page *page, unsigned long distance,
+				   bool activate)
+{
+	struct mem_cgroup *memcg;
+	struct page_cgroup *pc;
+	unsigned long avg;
+
+	if (mem_cgroup_disabled())
+		return;
+
+	pc = lookup_page_cgroup(page);
+	if (!PageCgroupUsed(pc))
+		return;
+	memcg = pc->mem_cgroup;
+
+	this_cpu_inc(memcg->stat->events[MEM_CGROUP_EVENTS_WORKINGSET_REFAULT]);
+	if (activate)
+		this_cpu_inc(memcg->stat->events[MEM_CGROUP_EVENTS_WORKINGSET_ACTIVATE]);
+
+	/*
+	 * Moving average over the last ~8 refaults. Concurrent updates can
+	 * lose a sample, which doesn't matter for a heuristic like this.
+	 */
+	avg = ACCESS_ONCE(memcg->refault_distance);
+	ACCESS_ONCE(memcg->refault_distance) = avg - (avg >> 3) +
+					      (distance >> 3);
+}
+
+/*
+ * Fold the refaults since the last update into the refault rate. Each
+ * elapsed second halves the weight of the previous rate.
+ */
+static unsigned long mem_cgroup_refault_rate(struct mem_cgroup *memcg)
+{
+	unsigned long now = jiffies;
+	unsigned long elapsed, refaults, rate;
+	unsigned int shift;
+
+	if (time_before(now, memcg->refault_stamp + HZ) ||
+	    !spin_trylock(&memcg->refault_lock))
+		return ACCESS_ONCE(memcg->refault_rate);
+
+	elapsed = now - memcg->refault_stamp;
+	if (elapsed >= HZ) {
+		refaults = mem_cgroup_read_events(memcg,
+					MEM_CGROUP_EVENTS_WORKINGSET_REFAULT);
+		rate = (refaults - memcg->refault_snapshot) * HZ / elapsed;
+		shift = min_t(unsigned long, elapsed / HZ, 8);
+		memcg->refault_rate = (memcg->refault_rate +
+				       rate * ((1 << shift) - 1)) >> shift;
+		memcg->refault_snapshot = refaults;
+		memcg->refault_stamp = now;
+	}
+	rate = memcg->refault_rate;
+	spin_unlock(&memcg->refault_lock);
+
+	return rate;
+}
+
+/**
+ * mem_cgroup_workingset_protection - page cache share to spare from reclaim
+ * @lruvec: the lruvec about to be scanned
+ *
+ * A group that keeps refaulting its page cache is losing its working set
+ * to the reclaim caused by others. Protect as much of its file LRU as its
+ * recent refault distance, the cache size it was short of, scaled by how
+ * often it refaults and capped at half of the lists.
+ *
+ * Returns the share of the file lists to leave unscanned, in 1/1024ths.
+ */
+unsigned int mem_cgroup_workingset_protection(struct lruvec *lruvec)
+{
+	struct mem_cgroup_per_zone *mz;
+	unsigned long file, rate;
+	u64 protect;
+
+	if (mem_cgroup_disabled())
+		return 0;
+
+	mz = container_of(lruvec, struct mem_cgroup_per_zone, lruvec);
+	rate = mem_cgroup_refault_rate(mz->memcg);
+	file = mz->lru_size[LRU_INACTIVE_FILE] + mz->lru_size[LRU_ACTIVE_FILE];
+	if (!rate || !file)
+		return 0;
+
+	protect = ACCESS_ONCE(mz->memcg->refault_distance);
+	protect = div_u64(protect * min_t(unsigned long, rate,
+					  WORKINGSET_REFAULT_RATE_HIGH),
+			  WORKINGSET_REFAULT_RATE_HIGH);
+
+	return min_t(u64, div64_u64(protect << 10, file), 512);
+}
+
+/**
+ * mem_cgroup_nr_refaults - page cache refaults of @memcg so far
+ * @memcg: the memcg
+ */
+unsigned long mem_cgroup_nr_refaults(struct mem_cgroup *memcg)
+{
+	return mem_cgroup_read_events(memcg,
+				      MEM_CGROUP_EVENTS_WORKINGSET_REFAULT);
+}
+
 int mem_cgroup_inactive_anon_is_low(struct lruvec *lruvec)
 {
 	unsigned long inactive_ratio;
@@ -4358,6 +4488,11 @@ static int memcg_stat_show(struct seq_file *m, void *v)
 		seq_printf(m, "%s %lu\n", mem_cgroup_lru_names[i],
 			   mem_cgroup_nr_lru_pages(memcg, BIT(i)) * PAGE_SIZE);
 
+	seq_printf(m, "workingset_refault_rate %lu\n",
+		   mem_cgroup_refault_rate(memcg));
+	seq_printf(m, "workingset_refault_distance %lu\n",
+		   ACCESS_ONCE(memcg->refault_distance) * PAGE_SIZE);
+
 	/* Hierarchical information */
 	{
 		unsigned long long limit, memsw_limit;
@@ -5377,6 +5512,8 @@ mem_cgroup_css_alloc(struct cgroup_subsys_state *parent_css)
 	vmpressure_init(&memcg->vmpressure);
 	INIT_LIST_HEAD(&memcg->event_list);
 	spin_lock_init(&memcg->event_list_lock);
+	spin_lock_init(&memcg->refault_lock);
+	memcg->refault_stamp = jiffies;
 
 	return &memcg->css;
 
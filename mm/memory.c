@@ -61,6 +61,7 @@
 #include <linux/string.h>
 #include <linux/dma-debug.h>
 #include <linux/debugfs.h>
+#include <linux/anon_prezero.h>
 
 #include <asm/io.h>
 #include <asm/pgalloc.h>
@@ -2188,7 +2189,12 @@ gotten:
 		goto oom;
 
 	if (is_zero_pfn(pte_pfn(orig_pte))) {
-		new_page = alloc_zeroed_user_highpage_movable(vma, address);
+		new_page = NULL;
+		if (vma->vm_flags & VM_ANON_FAULTAROUND)
+			new_page = prezero_page_get();
+		if (!new_page)
+			new_page = alloc_zeroed_user_highpage_movable(vma,
+								      address);
 		if (!new_page)
 			goto oom;
 	} else {
@@ -2580,6 +2586,120 @@ out_release:
 	return ret;
 }
 
+#ifdef CONFIG_ANON_FAULTAROUND
+#define ANON_FAULTAROUND_MAX	16
+
+/* Pool pages charged up front for the neighbours of an anonymous fault */
+struct anon_around {
+	int nr;
+	unsigned long window;
+	struct page *pages[ANON_FAULTAROUND_MAX - 1];
+	struct mem_cgroup *memcgs[ANON_FAULTAROUND_MAX - 1];
+};
+
+/*
+ * Takes and charges enough pre-zeroed pages for the rest of the aligned
+ * window around the fault.  Nothing is allocated here: if the pool runs
+ * dry or the memcg would have to reclaim, the window just shrinks.
+ */
+static void anon_fault_around_prepare(struct mm_struct *mm,
+				      struct anon_around *fa)
+{
+	unsigned int want = min_t(unsigned int,
+				  ACCESS_ONCE(anon_faultaround_pages),
+				  ANON_FAULTAROUND_MAX);
+	struct page *page;
+
+	if (want < 2)
+		return;
+	fa->window = rounddown_pow_of_two(want);
+	while (fa->nr < fa->window - 1) {
+		page = prezero_page_get();
+		if (!page)
+			break;
+		if (mem_cgroup_try_charge(page, mm, GFP_NOWAIT,
+					  &fa->memcgs[fa->nr])) {
+			prezero_page_put(page);
+			break;
+		}
+		fa->pages[fa->nr++] = page;
+	}
+}
+
+/*
+ * Maps the prepared pages on the empty ptes of the window, which never
+ * crosses the page table @page_table (the pte of @address) is in.
+ * Called with the pte lock held; returns how many pages were used.
+ */
+static int anon_fault_around_map(struct mm_struct *mm,
+				 struct vm_area_struct *vma,
+				 unsigned long address, pte_t *page_table,
+				 struct anon_around *fa)
+{
+	unsigned long start, end, addr;
+	struct page *page;
+	pte_t *pte, entry;
+	int used = 0;
+
+	start = address & ~(fa->window * PAGE_SIZE - 1);
+	end = min(start + fa->window * PAGE_SIZE, vma->vm_end);
+	start = max(start, vma->vm_start);
+	pte = page_table - ((address - start) >> PAGE_SHIFT);
+
+	for (addr = start; addr < end && used < fa->nr;
+	     addr += PAGE_SIZE, pte++) {
+		if (addr == address || !pte_none(*pte))
+			continue;
+		page = fa->pages[used];
+		__SetPageUptodate(page);
+		entry = mk_pte(page, vma->vm_page_prot);
+		if (vma->vm_flags & VM_WRITE)
+			entry = pte_mkwrite(pte_mkdirty(entry));
+
+		inc_mm_counter_fast(mm, MM_ANONPAGES);
+		page_add_new_anon_rmap(page, vma, addr);
+		mem_cgroup_commit_charge(page, fa->memcgs[used], false);
+		lru_cache_add_active_or_unevictable(page, vma);
+		set_pte_at(mm, addr, pte, entry);
+		update_mmu_cache(vma, addr, pte);
+		used++;
+	}
+	return used;
+}
+
+/* Uncharges and gives back the prepared pages from @used on. */
+static void anon_fault_around_release(struct anon_around *fa, int used)
+{
+	for (; used < fa->nr; used++) {
+		mem_cgroup_cancel_charge(fa->pages[used], fa->memcgs[used]);
+		prezero_page_put(fa->pages[used]);
+	}
+}
+#else
+struct anon_around {
+	int nr;
+};
+
+static inline void anon_fault_around_prepare(struct mm_struct *mm,
+					     struct anon_around *fa)
+{
+}
+
+static inline int anon_fault_around_map(struct mm_struct *mm,
+					struct vm_area_struct *vma,
+					unsigned long address,
+					pte_t *page_table,
+					struct anon_around *fa)
+{
+	return 0;
+}
+
+static inline void anon_fault_around_release(struct anon_around *fa,
+					     int used)
+{
+}
+#endif
+
 /*
  * We enter with non-exclusive mmap_sem (to exclude vma changes,
  * but allow concurrent faults), and pte mapped but not yet locked.
@@ -2590,11 +2710,14 @@ static int do_anonymous_page(struct mm_struct *mm, struct vm_area_struct *vma,
 		unsigned int flags)
 {
 	struct mem_cgroup *memcg;
+	struct anon_around fa;
 	struct page *page;
 	spinlock_t *ptl;
 	pte_t entry;
+	int used = 0;
 
 	pte_unmap(page_table);
+	fa.nr = 0;
 
 	/* File mapping without ->vm_ops ? */
 	if (vma->vm_flags & VM_SHARED)
@@ -2613,7 +2736,11 @@ static int do_anonymous_page(struct mm_struct *mm, struct vm_area_struct *vma,
 	/* Allocate our own private page. */
 	if (unlikely(anon_vma_prepare(vma)))
 		goto oom;
-	page = alloc_zeroed_user_highpage_movable(vma, address);
+	page = NULL;
+	if (vma->vm_flags & VM_ANON_FAULTAROUND)
+		page = prezero_page_get();
+	if (!page)
+		page = alloc_zeroed_user_highpage_movable(vma, address);
 	if (!page)
 		goto oom;
 	/*
@@ -2626,6 +2753,9 @@ static int do_anonymous_page(struct mm_struct *mm, struct vm_area_struct *vma,
 	if (mem_cgroup_try_charge(page, mm, GFP_KERNEL, &memcg))
 		goto oom_free_page;
 
+	if (vma->vm_flags & VM_ANON_FAULTAROUND)
+		anon_fault_around_prepare(mm, &fa);
+
 	entry = mk_pte(page, vma->vm_page_prot);
 	if (vma->vm_flags & VM_WRITE)
 		entry = pte_mkwrite(pte_mkdirty(entry));
@@ -2643,8 +2773,12 @@ setpte:
 
 	/* No need to invalidate - it was non-present before */
 	update_mmu_cache(vma, address, page_table);
+	if (fa.nr)
+		used = anon_fault_around_map(mm, vma, address, page_table,
+					     &fa);
 unlock:
 	pte_unmap_unlock(page_table, ptl);
+	anon_fault_around_release(&fa, used);
 	return 0;
 release:
 	mem_cgroup_cancel_charge(page, memcg);
@@ -2795,15 +2929,36 @@ late_initcall(fault_around_debugfs);
  * fault_around_pages() value (and therefore to page order).  This way it's
  * easier to guarantee that we don't cross page table boundaries.
  */
+static unsigned long fault_around_pages(struct vm_area_struct *vma)
+{
+	unsigned long nr_pages = ACCESS_ONCE(fault_around_bytes) >> PAGE_SHIFT;
+	struct file_ra_state *ra;
+
+	if (!vma->vm_file)
+		return nr_pages;
+
+	/*
+	 * Mapping the neighbours of a random fault only inflates RSS, while
+	 * a sequential reader is about to touch them: scale the window to
+	 * the access pattern seen on the file, keeping it a power of two.
+	 */
+	ra = &vma->vm_file->f_ra;
+	if (ra_mmap_random(vma, ra))
+		return 1;
+	if (ra_mmap_sequential(vma, ra))
+		return min_t(unsigned long, nr_pages * 4, PTRS_PER_PTE);
+	return nr_pages;
+}
+
 static void do_fault_around(struct vm_area_struct *vma, unsigned long address,
-		pte_t *pte, pgoff_t pgoff, unsigned int flags)
+		pte_t *pte, pgoff_t pgoff, unsigned int flags,
+		unsigned long nr_pages)
 {
-	unsigned long start_addr, nr_pages, mask;
+	unsigned long start_addr, mask;
 	pgoff_t max_pgoff;
 	struct vm_fault vmf;
 	int off;
 
-	nr_pages = ACCESS_ONCE(fault_around_bytes) >> PAGE_SHIFT;
 	mask = ~(nr_pages * PAGE_SIZE - 1) & PAGE_MASK;
 
 	start_addr = max(address & mask, vma->vm_start);
@@ -2845,6 +3000,7 @@ static int do_read_fault(struct mm_struct *mm, struct vm_area_struct *vma,
 	struct page *fault_page;
 	spinlock_t *ptl;
 	pte_t *pte;
+	unsigned long nr_pages;
 	int ret = 0;
 
 	/*
@@ -2852,10 +3008,10 @@ static int do_read_fault(struct mm_struct *mm, struct vm_area_struct *vma,
 	 * if page by the offset is not ready to be mapped (cold cache or
 	 * something).
 	 */
-	if (vma->vm_ops->map_pages && !(flags & FAULT_FLAG_NONLINEAR) &&
-	    fault_around_bytes >> PAGE_SHIFT > 1) {
+	nr_pages = vma->vm_ops->map_pages ? fault_around_pages(vma) : 0;
+	if (nr_pages > 1 && !(flags & FAULT_FLAG_NONLINEAR)) {
 		pte = pte_offset_map_lock(mm, pmd, address, &ptl);
-		do_fault_around(vma, address, pte, pgoff, flags);
+		do_fault_around(vma, address, pte, pgoff, flags, nr_pages);
 		if (!pte_same(*pte, orig_pte))
 			goto unlock_out;
 		pte_unmap_unlock(pte, ptl);
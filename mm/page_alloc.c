@@ -60,6 +60,7 @@
 #include <linux/page-debug-flags.h>
 #include <linux/hugetlb.h>
 #include <linux/sched/rt.h>
+#include <linux/vmpressure.h>
 
 #include <asm/sections.h>
 #include <asm/tlbflush.h>
@@ -121,6 +122,12 @@ unsigned long totalcma_pages __read_mostly;
 unsigned long dirty_balance_reserve __read_mostly;
 
 int percpu_pagelist_fraction;
+/*
+ * Limits of the order 1..PCP_HIGH_ORDER per-cpu lists, in blocks of each
+ * order. 0 derives them from the order-0 batch of the zone.
+ */
+int percpu_highorder_high;
+int percpu_highorder_batch;
 gfp_t gfp_allowed_mask __read_mostly = GFP_BOOT_MASK;
 
 #ifdef CONFIG_PM_SLEEP
@@ -698,7 +705,7 @@ static inline int free_pages_check(struct page *page)
 /*
  * Frees a number of pages from the PCP lists
  * Assumes all pages on list are in same zone, and of same order.
- * count is the number of pages to free.
+ * count is the number of blocks of @order to free.
  *
  * If the zone was previously in an "all pages pinned" state then look to
  * see if this freeing clears that state.
@@ -707,7 +714,7 @@ static inline int free_pages_check(struct page *page)
  * pinned" detection logic.
  */
 static void free_pcppages_bulk(struct zone *zone, int count,
-					struct per_cpu_pages *pcp)
+				struct per_cpu_pages *pcp, unsigned int order)
 {
 	int migratetype = 0;
 	int batch_free = 0;
@@ -756,8 +763,9 @@ static void free_pcppages_bulk(struct zone *zone, int count,
 				mt = get_pageblock_migratetype(page);
 
 			/* MIGRATE_MOVABLE list may include MIGRATE_RESERVEs */
-			__free_one_page(page, page_to_pfn(page), zone, 0, mt);
-			trace_mm_page_pcpu_drain(page, 0, mt);
+			__free_one_page(page, page_to_pfn(page), zone, order,
+					mt);
+			trace_mm_page_pcpu_drain(page, order, mt);
 		} while (--to_free && --batch_free && !list_empty(list));
 	}
 	spin_unlock(&zone->lock);
@@ -782,6 +790,51 @@ static void free_one_page(struct zone *zone,
 	spin_unlock(&zone->lock);
 }
 
+static inline struct per_cpu_pages *pcp_order(struct per_cpu_pageset *pset,
+					      unsigned int order)
+{
+	return order ? &pset->hpcp[order - 1] : &pset->pcp;
+}
+
+/*
+ * Put a block of @order on this cpu's list for it, spilling a batch back
+ * to the buddy allocator once the list reaches its high mark. Must be
+ * called with interrupts disabled.
+ */
+static void free_pcp_page(struct zone *zone, struct page *page,
+			  unsigned long pfn, unsigned int order,
+			  int migratetype, bool cold)
+{
+	struct per_cpu_pages *pcp;
+
+	/*
+	 * We only track unmovable, reclaimable and movable on pcp lists.
+	 * Free ISOLATE pages back to the allocator because they are being
+	 * offlined but treat RESERVE as movable pages so we can get those
+	 * areas back if necessary. Otherwise, we may have to free
+	 * excessively into the page allocator
+	 */
+	if (migratetype >= MIGRATE_PCPTYPES) {
+		if (unlikely(is_migrate_isolate(migratetype))) {
+			free_one_page(zone, page, pfn, order, migratetype);
+			return;
+		}
+		migratetype = MIGRATE_MOVABLE;
+	}
+
+	pcp = pcp_order(this_cpu_ptr(zone->pageset), order);
+	if (!cold)
+		list_add(&page->lru, &pcp->lists[migratetype]);
+	else
+		list_add_tail(&page->lru, &pcp->lists[migratetype]);
+	pcp->count++;
+	if (pcp->count >= pcp->high) {
+		unsigned long batch = ACCESS_ONCE(pcp->batch);
+		free_pcppages_bulk(zone, batch, pcp, order);
+		pcp->count -= batch;
+	}
+}
+
 static bool free_pages_prepare(struct page *page, unsigned int order)
 {
 	int i;
@@ -823,7 +876,21 @@ static void __free_pages_ok(struct page *page, unsigned int order)
 	local_irq_save(flags);
 	__count_vm_events(PGFREE, 1 << order);
 	set_freepage_migratetype(page, migratetype);
-	free_one_page(page_zone(page), page, pfn, order, migratetype);
+	if (order <= PCP_HIGH_ORDER) {
+		/*
+		 * __free_one_page() only sees the block once it is drained,
+		 * so tear a compound page down before it is reused from the
+		 * list.
+		 */
+		if (unlikely(PageCompound(page)) &&
+		    unlikely(destroy_compound_page(page, order)))
+			goto out;
+		free_pcp_page(page_zone(page), page, pfn, order,
+			      migratetype, false);
+	} else {
+		free_one_page(page_zone(page), page, pfn, order, migratetype);
+	}
+out:
 	local_irq_restore(flags);
 }
 
@@ -1427,7 +1494,7 @@ void drain_zone_pages(struct zone *zone, struct per_cpu_pages *pcp)
 	batch = ACCESS_ONCE(pcp->batch);
 	to_drain = min(pcp->count, batch);
 	if (to_drain > 0) {
-		free_pcppages_bulk(zone, to_drain, pcp);
+		free_pcppages_bulk(zone, to_drain, pcp, 0);
 		pcp->count -= to_drain;
 	}
 	local_irq_restore(flags);
@@ -1449,14 +1516,18 @@ static void drain_pages(unsigned int cpu)
 	for_each_populated_zone(zone) {
 		struct per_cpu_pageset *pset;
 		struct per_cpu_pages *pcp;
+		unsigned int order;
 
 		local_irq_save(flags);
 		pset = per_cpu_ptr(zone->pageset, cpu);
 
-		pcp = &pset->pcp;
-		if (pcp->count) {
-			free_pcppages_bulk(zone, pcp->count, pcp);
-			pcp->count = 0;
+		for (order = 0; order <= PCP_HIGH_ORDER; order++) {
+			pcp = pcp_order(pset, order);
+			if (pcp->count) {
+				free_pcppages_bulk(zone, pcp->count, pcp,
+						   order);
+				pcp->count = 0;
+			}
 		}
 		local_irq_restore(flags);
 	}
@@ -1500,11 +1571,17 @@ void drain_all_pages(void)
 	for_each_online_cpu(cpu) {
 		bool has_pcps = false;
 		for_each_populated_zone(zone) {
+			unsigned int order;
+
 			pcp = per_cpu_ptr(zone->pageset, cpu);
-			if (pcp->pcp.count) {
-				has_pcps = true;
-				break;
+			for (order = 0; order <= PCP_HIGH_ORDER; order++) {
+				if (pcp_order(pcp, order)->count) {
+					has_pcps = true;
+					break;
+				}
 			}
+			if (has_pcps)
+				break;
 		}
 		if (has_pcps)
 			cpumask_set_cpu(cpu, &cpus_with_pcps);
@@ -1557,7 +1634,6 @@ void mark_free_pages(struct zone *zone)
 void free_hot_cold_page(struct page *page, bool cold)
 {
 	struct zone *zone = page_zone(page);
-	struct per_cpu_pages *pcp;
 	unsigned long flags;
 	unsigned long pfn = page_to_pfn(page);
 	int migratetype;
@@ -1569,35 +1645,7 @@ void free_hot_cold_page(struct page *page, bool cold)
 	set_freepage_migratetype(page, migratetype);
 	local_irq_save(flags);
 	__count_vm_event(PGFREE);
-
-	/*
-	 * We only track unmovable, reclaimable and movable on pcp lists.
-	 * Free ISOLATE pages back to the allocator because they are being
-	 * offlined but treat RESERVE as movable pages so we can get those
-	 * areas back if necessary. Otherwise, we may have to free
-	 * excessively into the page allocator
-	 */
-	if (migratetype >= MIGRATE_PCPTYPES) {
-		if (unlikely(is_migrate_isolate(migratetype))) {
-			free_one_page(zone, page, pfn, 0, migratetype);
-			goto out;
-		}
-		migratetype = MIGRATE_MOVABLE;
-	}
-
-	pcp = &this_cpu_ptr(zone->pageset)->pcp;
-	if (!cold)
-		list_add(&page->lru, &pcp->lists[migratetype]);
-	else
-		list_add_tail(&page->lru, &pcp->lists[migratetype]);
-	pcp->count++;
-	if (pcp->count >= pcp->high) {
-		unsigned long batch = ACCESS_ONCE(pcp->batch);
-		free_pcppages_bulk(zone, batch, pcp);
-		pcp->count -= batch;
-	}
-
-out:
+	free_pcp_page(zone, page, pfn, 0, migratetype, cold);
 	local_irq_restore(flags);
 }
 
@@ -1727,17 +1775,17 @@ struct page *buffered_rmqueue(struct zone *preferred_zone,
 	bool cold = ((gfp_flags & __GFP_COLD) != 0);
 
 again:
-	if (likely(order == 0)) {
+	if (likely(order <= PCP_HIGH_ORDER)) {
 		struct per_cpu_pages *pcp;
 		struct list_head *list = NULL;
 
 		local_irq_save(flags);
-		pcp = &this_cpu_ptr(zone->pageset)->pcp;
+		pcp = pcp_order(this_cpu_ptr(zone->pageset), order);
 
 		/* First try to get CMA pages */
 		if (migratetype == MIGRATE_MOVABLE &&
 			gfp_flags & __GFP_CMA) {
-			list = get_populated_pcp_list(zone, 0, pcp,
+			list = get_populated_pcp_list(zone, order, pcp,
 					get_cma_migrate_type(), cold);
 		}
 
@@ -1746,7 +1794,7 @@ again:
 			 * Either CMA is not suitable or there are no free CMA
 			 * pages.
 			 */
-			list = get_populated_pcp_list(zone, 0, pcp,
+			list = get_populated_pcp_list(zone, order, pcp,
 				migratetype, cold);
 			if (unlikely(list == NULL) ||
 				unlikely(list_empty(list)))
@@ -2577,6 +2625,7 @@ __perform_reclaim(gfp_t gfp_mask, unsigned int order, struct zonelist *zonelist,
 {
 	struct reclaim_state reclaim_state;
 	int progress;
+	u64 stall_start;
 
 	cond_resched();
 
@@ -2587,7 +2636,9 @@ __perform_reclaim(gfp_t gfp_mask, unsigned int order, struct zonelist *zonelist,
 	reclaim_state.reclaimed_slab = 0;
 	current->reclaim_state = &reclaim_state;
 
+	stall_start = ktime_get_ns();
 	progress = try_to_free_pages(zonelist, order, gfp_mask, nodemask);
+	vmpressure_account_reclaim_stall(ktime_get_ns() - stall_start);
 
 	current->reclaim_state = NULL;
 	lockdep_clear_current_reclaim_state();
@@ -3052,7 +3103,8 @@ retry_cpuset:
 		page = __alloc_pages_slowpath(gfp_mask, order,
 				zonelist, high_zoneidx, nodemask,
 				preferred_zone, classzone_idx, migratetype);
-	}
+	} else
+		compaction_proactive_alloc(page, order);
 
 	trace_mm_page_alloc(page, order, gfp_mask, migratetype);
 
@@ -4462,23 +4514,51 @@ static void pageset_update(struct per_cpu_pages *pcp, unsigned long high,
 	pcp->batch = batch;
 }
 
+/*
+ * Size the order 1..PCP_HIGH_ORDER lists after the order-0 one: each order
+ * moves about half the base pages of an order-0 batch at a time and holds
+ * two batches, so a cpu caches a fraction of what its order-0 list does.
+ * A pageset that does not cache order-0 pages does not cache these either.
+ */
+static void pageset_set_high_orders(struct per_cpu_pageset *p)
+{
+	unsigned int order;
+
+	for (order = 1; order <= PCP_HIGH_ORDER; order++) {
+		unsigned long batch, high;
+
+		batch = percpu_highorder_batch ?:
+			max(1UL, (unsigned long)p->pcp.batch >> (order + 1));
+		high = percpu_highorder_high ?: 2 * batch;
+		if (!p->pcp.high)
+			high = 0;
+		pageset_update(&p->hpcp[order - 1], high,
+			       max(1UL, min(batch, high)));
+	}
+}
+
 /* a companion to pageset_set_high() */
 static void pageset_set_batch(struct per_cpu_pageset *p, unsigned long batch)
 {
 	pageset_update(&p->pcp, 6 * batch, max(1UL, 1 * batch));
+	pageset_set_high_orders(p);
 }
 
 static void pageset_init(struct per_cpu_pageset *p)
 {
-	struct per_cpu_pages *pcp;
+	unsigned int order;
 	int migratetype;
 
 	memset(p, 0, sizeof(*p));
 
-	pcp = &p->pcp;
-	pcp->count = 0;
-	for (migratetype = 0; migratetype < MIGRATE_PCPTYPES; migratetype++)
-		INIT_LIST_HEAD(&pcp->lists[migratetype]);
+	for (order = 0; order <= PCP_HIGH_ORDER; order++) {
+		struct per_cpu_pages *pcp = pcp_order(p, order);
+
+		pcp->count = 0;
+		for (migratetype = 0; migratetype < MIGRATE_PCPTYPES;
+		     migratetype++)
+			INIT_LIST_HEAD(&pcp->lists[migratetype]);
+	}
 }
 
 static void setup_pageset(struct per_cpu_pageset *p, unsigned long batch)
@@ -4499,6 +4579,7 @@ static void pageset_set_high(struct per_cpu_pageset *p,
 		batch = PAGE_SHIFT * 8;
 
 	pageset_update(&p->pcp, high, batch);
+	pageset_set_high_orders(p);
 }
 
 static void pageset_set_high_and_batch(struct zone *zone,
@@ -6166,6 +6247,33 @@ out:
 	return ret;
 }
 
+/*
+ * percpu_highorder_{high,batch} - override the limits of the order
+ * 1..PCP_HIGH_ORDER per-cpu lists, in blocks of each order.
+ */
+int percpu_highorder_sysctl_handler(struct ctl_table *table, int write,
+	void __user *buffer, size_t *length, loff_t *ppos)
+{
+	struct zone *zone;
+	int ret;
+
+	mutex_lock(&pcp_batch_high_lock);
+	ret = proc_dointvec_minmax(table, write, buffer, length, ppos);
+	if (!write || ret < 0)
+		goto out;
+
+	for_each_populated_zone(zone) {
+		unsigned int cpu;
+
+		for_each_possible_cpu(cpu)
+			pageset_set_high_orders(per_cpu_ptr(zone->pageset,
+							    cpu));
+	}
+out:
+	mutex_unlock(&pcp_batch_high_lock);
+	return ret;
+}
+
 int hashdist = HASHDIST_DEFAULT;
 
 #ifdef CONFIG_NUMA
@@ -139,6 +139,29 @@ out:
 	bio_put(bio);
 }
 
+/* Account the latency of a swap-in from @sis, in microseconds */
+static void swap_account_swapin(struct swap_info_struct *sis,
+				unsigned long us)
+{
+	unsigned long avg = ACCESS_ONCE(sis->swapin_avg_us);
+
+	atomic_long_inc(&sis->swapin_count);
+	atomic_long_add(us, &sis->swapin_time_us);
+	ACCESS_ONCE(sis->swapin_avg_us) = avg ? avg - (avg >> 3) + (us >> 3) :
+					   us;
+}
+
+/* Swap-in bios carry their submission time, in us, in bi_private */
+static void end_swap_bio_read_timed(struct bio *bio, int err)
+{
+	struct page *page = bio->bi_io_vec[0].bv_page;
+	unsigned long start = (unsigned long)bio->bi_private;
+
+	swap_account_swapin(page_swap_info(page),
+			    (unsigned long)ktime_to_us(ktime_get()) - start);
+	end_swap_bio_read(bio, err);
+}
+
 int generic_swapfile_activate(struct swap_info_struct *sis,
 				struct file *swap_file,
 				sector_t *span)
@@ -342,6 +365,7 @@ out:
 int swap_readpage(struct page *page)
 {
 	struct bio *bio;
+	ktime_t start;
 	int ret = 0;
 	struct swap_info_struct *sis = page_swap_info(page);
 
@@ -363,19 +387,22 @@ int swap_readpage(struct page *page)
 		return ret;
 	}
 
+	start = ktime_get();
 	ret = bdev_read_page(sis->bdev, swap_page_sector(page), page);
 	if (!ret) {
+		swap_account_swapin(sis, ktime_us_delta(ktime_get(), start));
 		count_vm_event(PSWPIN);
 		return 0;
 	}
 
 	ret = 0;
-	bio = get_swap_bio(GFP_KERNEL, page, end_swap_bio_read);
+	bio = get_swap_bio(GFP_KERNEL, page, end_swap_bio_read_timed);
 	if (bio == NULL) {
 		unlock_page(page);
 		ret = -ENOMEM;
 		goto out;
 	}
+	bio->bi_private = (void *)(unsigned long)ktime_to_us(ktime_get());
 	count_vm_event(PSWPIN);
 	submit_bio(READ, bio);
 out:
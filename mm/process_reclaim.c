@@ -20,6 +20,11 @@
 #include <linux/rcupdate.h>
 #include <linux/notifier.h>
 #include <linux/vmpressure.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/spinlock.h>
+#include <linux/jiffies.h>
+#include <linux/ktime.h>
 
 #define CREATE_TRACE_POINTS
 #include <trace/events/process_reclaim.h>
@@ -67,9 +72,59 @@ static atomic_t skip_reclaim = ATOMIC_INIT(0);
 /* Not atomic since only a single instance of swap_fn run at a time */
 static int monitor_eff;
 
+/* The max time spent reclaiming per vmpressure event, 0 for no limit */
+static int reclaim_budget_ms = 20;
+module_param_named(reclaim_budget_ms, reclaim_budget_ms, int,
+	S_IRUGO | S_IWUSR);
+
+/*
+ * Tasks that swapped back in refault_stop_pct or more of what was last
+ * reclaimed from them are left alone for refault_backoff_sec, reclaiming
+ * their pages only costs IO.
+ */
+static int refault_stop_pct = 50;
+module_param_named(refault_stop_pct, refault_stop_pct, int,
+	S_IRUGO | S_IWUSR);
+
+static int refault_backoff_sec = 60;
+module_param_named(refault_backoff_sec, refault_backoff_sec, int,
+	S_IRUGO | S_IWUSR);
+
+/*
+ * Tasks that have just left the foreground are weighted at half their
+ * anon size, growing to the full size after bg_age_max_sec.
+ */
+static int bg_age_max_sec = 120;
+module_param_named(bg_age_max_sec, bg_age_max_sec, int, S_IRUGO | S_IWUSR);
+
+/*
+ * Reclaim history of recently reclaimed tasks, used to weigh their
+ * selection and shown in debugfs. Only swap_fn adds and updates entries,
+ * the lock keeps them consistent for the debugfs reader.
+ */
+struct task_reclaim_stat {
+	pid_t tgid;
+	u64 start_time;
+	char comm[TASK_COMM_LEN];
+	unsigned long last_reclaim;	/* jiffies */
+	unsigned long swapents;		/* MM_SWAPENTS after last reclaim */
+	int last_reclaimed;
+	bool measure;			/* refaults of last reclaim pending */
+	int refault_pct;		/* moving average */
+	int swapin_rate;		/* pages per second, moving average */
+	u64 nr_reclaimed;
+	u64 nr_scanned;
+	u64 reclaim_ns;
+};
+
+#define MAX_RECLAIM_STATS 64
+static struct task_reclaim_stat reclaim_stats[MAX_RECLAIM_STATS];
+static DEFINE_SPINLOCK(reclaim_stats_lock);
+
 struct selected_task {
 	struct task_struct *p;
 	int tasksize;
+	int score;
 	short oom_score_adj;
 };
 
@@ -79,11 +134,116 @@ int selected_cmp(const void *a, const void *b)
 	const struct selected_task *y = b;
 	int ret;
 
-	ret = x->tasksize < y->tasksize ? -1 : 1;
+	ret = x->score < y->score ? -1 : 1;
 
 	return ret;
 }
 
+/*
+ * Find the entry of @p, or if @create, recycle the least recently
+ * reclaimed entry for it. Called with reclaim_stats_lock held.
+ */
+static struct task_reclaim_stat *find_reclaim_stat(struct task_struct *p,
+						   bool create)
+{
+	u64 start_time = p->group_leader->start_time;
+	struct task_reclaim_stat *s, *victim = NULL;
+
+	for (s = reclaim_stats; s < reclaim_stats + MAX_RECLAIM_STATS; s++) {
+		if (s->tgid == p->tgid && s->start_time == start_time)
+			return s;
+		if (!victim || (victim->tgid && (!s->tgid ||
+			time_before(s->last_reclaim, victim->last_reclaim))))
+			victim = s;
+	}
+
+	if (!create)
+		return NULL;
+
+	memset(victim, 0, sizeof(*victim));
+	victim->tgid = p->tgid;
+	victim->start_time = start_time;
+	get_task_comm(victim->comm, p->group_leader);
+
+	return victim;
+}
+
+/*
+ * Weigh the anon size of @p by how long it has been in the background and
+ * by how fast it swapped in again what was reclaimed from it last time.
+ * The swap entries freed since then are taken as refaults, pages the task
+ * unmapped in between are counted as well.
+ *
+ * Returns 0 for tasks to leave alone for now.
+ */
+static int task_reclaim_score(struct task_struct *p, int tasksize,
+			      unsigned long swapents, unsigned long bg_stamp,
+			      unsigned long now)
+{
+	struct task_reclaim_stat *s;
+	unsigned long age;
+	u64 score = tasksize;
+
+	spin_lock(&reclaim_stats_lock);
+	s = find_reclaim_stat(p, false);
+	if (s && s->measure) {
+		unsigned long elapsed = max(now - s->last_reclaim, 1UL);
+		unsigned long refaulted = 0;
+
+		if (s->swapents > swapents)
+			refaulted = min(s->swapents - swapents,
+					(unsigned long)s->last_reclaimed);
+		s->refault_pct = (s->refault_pct +
+				  refaulted * 100 / s->last_reclaimed) / 2;
+		s->swapin_rate = (s->swapin_rate +
+				  refaulted * HZ / elapsed) / 2;
+		s->measure = false;
+	}
+	if (s && s->refault_pct >= refault_stop_pct &&
+	    time_before(now, s->last_reclaim + refault_backoff_sec * HZ)) {
+		spin_unlock(&reclaim_stats_lock);
+		return 0;
+	}
+	if (s)
+		score = div_u64(score * 100, 100 + s->swapin_rate);
+	spin_unlock(&reclaim_stats_lock);
+
+	if (bg_age_max_sec > 0) {
+		age = bg_stamp ? (now - bg_stamp) / HZ : bg_age_max_sec;
+		age = min(age, (unsigned long)bg_age_max_sec);
+		score = div_u64(score * (bg_age_max_sec + age),
+				2 * bg_age_max_sec);
+	}
+
+	return score;
+}
+
+static void update_reclaim_stat(struct task_struct *p,
+				struct reclaim_param *rp, s64 reclaim_ns,
+				unsigned long now)
+{
+	struct task_reclaim_stat *s;
+	struct mm_struct *mm;
+	unsigned long swapents = 0;
+
+	mm = get_task_mm(p);
+	if (mm) {
+		swapents = get_mm_counter(mm, MM_SWAPENTS);
+		mmput(mm);
+	}
+
+	spin_lock(&reclaim_stats_lock);
+	s = find_reclaim_stat(p, true);
+	s->last_reclaim = now;
+	s->swapents = swapents;
+	s->last_reclaimed = rp->nr_reclaimed;
+	s->measure = rp->nr_reclaimed > 0;
+	s->nr_reclaimed += rp->nr_reclaimed;
+	s->nr_scanned += rp->nr_scanned;
+	s->reclaim_ns += reclaim_ns;
+	spin_unlock(&reclaim_stats_lock);
+}
+
 static int test_task_flag(struct task_struct *p, int flag)
 {
 	struct task_struct *t = p;
@@ -119,6 +279,11 @@ static void swap_fn(struct work_struct *work)
 	int total_reclaimed = 0;
 	int nr_to_reclaim;
 	int efficiency;
+	int score;
+	int total_score = 0;
+	unsigned long now = jiffies;
+	unsigned long swapents, bg_stamp;
+	ktime_t start, budget;
 
 	rcu_read_lock();
 	for_each_process(tsk) {
@@ -142,30 +307,40 @@ static void swap_fn(struct work_struct *work)
 		}
 
 		tasksize = get_mm_counter(p->mm, MM_ANONPAGES);
+		swapents = get_mm_counter(p->mm, MM_SWAPENTS);
+		bg_stamp = p->signal->oom_bg_stamp;
 		task_unlock(p);
 
 		if (tasksize <= 0)
 			continue;
 
+		score = task_reclaim_score(p, tasksize, swapents, bg_stamp, now);
+		if (score <= 0)
+			continue;
+
 		if (si == MAX_SWAP_TASKS) {
 			sort(&selected[0], MAX_SWAP_TASKS,
 					sizeof(struct selected_task),
 					&selected_cmp, NULL);
-			if (tasksize < selected[0].tasksize)
+			if (score < selected[0].score)
 				continue;
 			selected[0].p = p;
 			selected[0].oom_score_adj = oom_score_adj;
 			selected[0].tasksize = tasksize;
+			selected[0].score = score;
 		} else {
 			selected[si].p = p;
 			selected[si].oom_score_adj = oom_score_adj;
 			selected[si].tasksize = tasksize;
+			selected[si].score = score;
 			si++;
 		}
 	}
 
-	for (i = 0; i < si; i++)
+	for (i = 0; i < si; i++) {
 		total_sz += selected[i].tasksize;
+		total_score += selected[i].score;
+	}
 
 	/* Skip reclaim if total size is too less */
 	if (total_sz < SWAP_CLUSTER_MAX) {
@@ -178,14 +353,28 @@ static void swap_fn(struct work_struct *work)
 
 	rcu_read_unlock();
 
+	/* Best candidates first, in case the time budget runs out */
+	sort(&selected[0], si, sizeof(struct selected_task),
+			&selected_cmp, NULL);
+
+	start = ktime_get();
+	budget = ktime_add_ms(start, reclaim_budget_ms);
 	while (si--) {
+		if (reclaim_budget_ms > 0 && ktime_after(start, budget)) {
+			put_task_struct(selected[si].p);
+			continue;
+		}
+
 		nr_to_reclaim =
-			(selected[si].tasksize * per_swap_size) / total_sz;
+			(selected[si].score * per_swap_size) / total_score;
 		/* scan atleast a page */
 		if (!nr_to_reclaim)
 			nr_to_reclaim = 1;
 
 		rp = reclaim_task_anon(selected[si].p, nr_to_reclaim);
+		update_reclaim_stat(selected[si].p, &rp,
+				ktime_to_ns(ktime_sub(ktime_get(), start)), now);
+		start = ktime_get();
 
 		trace_process_reclaim(selected[si].tasksize,
 				selected[si].oom_score_adj, rp.nr_scanned,
@@ -238,8 +427,47 @@ static struct notifier_block vmpr_nb = {
 	.notifier_call = vmpressure_notifier,
 };
 
+static int reclaim_stats_show(struct seq_file *m, void *unused)
+{
+	struct task_reclaim_stat *s;
+	u64 per_ms;
+
+	seq_puts(m, "pid comm reclaimed scanned time_ms pages_per_ms refault_pct swapin_rate\n");
+
+	spin_lock(&reclaim_stats_lock);
+	for (s = reclaim_stats; s < reclaim_stats + MAX_RECLAIM_STATS; s++) {
+		if (!s->tgid)
+			continue;
+		per_ms = s->reclaim_ns ? div64_u64(s->nr_reclaimed *
+					NSEC_PER_MSEC, s->reclaim_ns) : 0;
+		seq_printf(m, "%d %s %llu %llu %llu %llu %d %d\n",
+			   s->tgid, s->comm, s->nr_reclaimed, s->nr_scanned,
+			   div_u64(s->reclaim_ns, NSEC_PER_MSEC), per_ms,
+			   s->refault_pct, s->swapin_rate);
+	}
+	spin_unlock(&reclaim_stats_lock);
+
+	return 0;
+}
+
+static int reclaim_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, reclaim_stats_show, NULL);
+}
+
+static const struct file_operations reclaim_stats_fops = {
+	.open		= reclaim_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static struct dentry *reclaim_stats_dentry;
+
 static int __init process_reclaim_init(void)
 {
+	reclaim_stats_dentry = debugfs_create_file("process_reclaim_stats",
+			S_IRUGO, NULL, NULL, &reclaim_stats_fops);
 	vmpressure_notifier_register(&vmpr_nb);
 	return 0;
 }
@@ -247,6 +475,7 @@ static int __init process_reclaim_init(void)
 static void __exit process_reclaim_exit(void)
 {
 	vmpressure_notifier_unregister(&vmpr_nb);
+	debugfs_remove(reclaim_stats_dentry);
 }
 
 module_init(process_reclaim_init);
@@ -14,6 +14,8 @@
 #include <linux/mm_types.h>
 #include <linux/swapfile.h>
 #include <linux/swap.h>
+#include <linux/sched.h>
+#include <linux/vmstat.h>
 
 #define SWAP_RATIO_GROUP_START (SWAP_FLAG_PRIO_MASK - 9) /* 32758 */
 #define SWAP_RATIO_GROUP_END (SWAP_FLAG_PRIO_MASK) /* 32767 */
@@ -30,6 +32,9 @@ int sysctl_swap_ratio = 100;
 /* Enable the swap ratio feature */
 int sysctl_swap_ratio_enable;
 
+/* Policy given to swap devices of a ratio group at swapon, SWAP_RATIO_* */
+int sysctl_swap_ratio_policy = SWAP_RATIO_STATIC;
+
 static bool is_same_group(struct swap_info_struct *a,
 		struct swap_info_struct *b)
 {
@@ -45,6 +50,46 @@ static bool is_same_group(struct swap_info_struct *a,
 	return false;
 }
 
+/*
+ * Scale down the share of the fast (compressing) device from @ratio:
+ * - by the share of CPUs that are busy, as compression runs in the
+ *   context of the task swapping out,
+ * - by how close free memory is to the reserve, as compressed pages are
+ *   stored in memory,
+ * - by how much slower its swap-ins have been than the slow device's.
+ */
+static int adaptive_ratio(struct swap_info_struct *si,
+			struct swap_info_struct *n, int ratio)
+{
+	unsigned long cpus = num_online_cpus();
+	unsigned long running = nr_running();
+	unsigned long reserve = max(totalreserve_pages, 1UL);
+	unsigned long free = global_page_state(NR_FREE_PAGES);
+	unsigned long fast_us = ACCESS_ONCE(si->swapin_avg_us);
+	unsigned long slow_us = ACCESS_ONCE(n->swapin_avg_us);
+	unsigned long idle_pct, headroom_pct;
+
+	/* The swapping task itself is running */
+	running = running ? running - 1 : 0;
+	idle_pct = running >= cpus ? 0 : 100 - running * 100 / cpus;
+
+	/* Full headroom from four times the reserve, none at the reserve */
+	if (free >= 4 * reserve)
+		headroom_pct = 100;
+	else if (free <= reserve)
+		headroom_pct = 0;
+	else
+		headroom_pct = (free - reserve) * 100 / (3 * reserve);
+
+	ratio = ratio * min(idle_pct, headroom_pct) / 100;
+
+	if (fast_us && slow_us && fast_us > slow_us)
+		ratio = ratio * slow_us / fast_us;
+
+	/* A zero ratio stops the fast device from being restarted */
+	return max(ratio, 1);
+}
+
 /* Caller must hold swap_avail_lock */
 static int calculate_write_pending(struct swap_info_struct *si,
 			struct swap_info_struct *n)
@@ -54,6 +99,9 @@ static int calculate_write_pending(struct swap_info_struct *si,
 	if ((ratio < 0) || (ratio > 100))
 		return -EINVAL;
 
+	if (si->swap_ratio_policy == SWAP_RATIO_ADAPTIVE)
+		ratio = adaptive_ratio(si, n, ratio);
+
 	if (WARN_ON(!(si->flags & SWP_FAST)))
 		return -ENODEV;
 
@@ -176,10 +224,11 @@ bool is_swap_ratio_group(int prio)
 		(prio <= SWAP_RATIO_GROUP_END)) ? true : false;
 }
 
-void setup_swap_ratio(struct swap_info_struct *p, int prio)
+void setup_swap_ratio(struct swap_info_struct *p, int prio, int policy)
 {
 	/* Used only if sysctl_swap_ratio_enable is set */
 	if (is_swap_ratio_group(prio)) {
+		p->swap_ratio_policy = policy;
 		if (p->flags & SWP_FAST)
 			p->write_pending = SWAP_FAST_WRITES;
 		else
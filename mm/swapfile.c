@@ -2157,9 +2157,49 @@ static const struct file_operations proc_swaps_operations = {
 	.poll		= swaps_poll,
 };
 
+static int swap_latency_show(struct seq_file *swap, void *v)
+{
+	struct swap_info_struct *si = v;
+	unsigned long count, time_us;
+	int len;
+
+	if (si == SEQ_START_TOKEN) {
+		seq_puts(swap, "Filename\t\t\t\tSwapIns\tTotalUs\tAvgUs\n");
+		return 0;
+	}
+
+	count = atomic_long_read(&si->swapin_count);
+	time_us = atomic_long_read(&si->swapin_time_us);
+	len = seq_path(swap, &si->swap_file->f_path, " \t\n\\");
+	seq_printf(swap, "%*s%lu\t%lu\t%lu\n",
+			len < 40 ? 40 - len : 1, " ",
+			count, time_us, ACCESS_ONCE(si->swapin_avg_us));
+	return 0;
+}
+
+static const struct seq_operations swap_latency_op = {
+	.start =	swap_start,
+	.next =		swap_next,
+	.stop =		swap_stop,
+	.show =		swap_latency_show
+};
+
+static int swap_latency_open(struct inode *inode, struct file *file)
+{
+	return seq_open(file, &swap_latency_op);
+}
+
+static const struct file_operations proc_swap_latency_operations = {
+	.open		= swap_latency_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= seq_release,
+};
+
 static int __init procswaps_init(void)
 {
 	proc_create("swaps", 0, NULL, &proc_swaps_operations);
+	proc_create("swap_latency", 0, NULL, &proc_swap_latency_operations);
 	return 0;
 }
 __initcall(procswaps_init);
@@ -2601,7 +2641,7 @@ SYSCALL_DEFINE2(swapon, const char __user *, specialfile, int, swap_flags)
 	if (swap_flags & SWAP_FLAG_PREFER) {
 		prio =
 		  (swap_flags & SWAP_FLAG_PRIO_MASK) >> SWAP_FLAG_PRIO_SHIFT;
-		setup_swap_ratio(p, prio);
+		setup_swap_ratio(p, prio, sysctl_swap_ratio_policy);
 	}
 	enable_swap_info(p, prio, swap_map, cluster_info, frontswap_map);
 
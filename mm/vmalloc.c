@@ -664,6 +664,29 @@ static unsigned long lazy_max_pages(void)
 
 static atomic_t vmap_lazy_nr = ATOMIC_INIT(0);
 
+/*
+ * Lazily freed areas wait on a list of the cpu that freed them, so that
+ * frequent vunmap() callers don't all bounce one cacheline and the purge
+ * doesn't have to walk every vmap area to find them.
+ */
+static DEFINE_PER_CPU(struct llist_head, vmap_purge_list);
+
+/*
+ * A purge whose areas add up to at most this many pages flushes each area
+ * on its own instead of the span covering all of them, which may be most
+ * of the vmalloc space and is then turned into a full TLB flush.
+ */
+#define VMAP_PURGE_RANGE_PAGES	64
+
+/* Updated under purge_lock, shown at the end of /proc/vmallocinfo */
+static struct {
+	unsigned long runs;
+	unsigned long areas;
+	unsigned long pages;
+	unsigned long range_flushes;
+	unsigned long span_flushes;
+} vmap_purge_stats;
+
 /* for per-CPU blocks */
 static void purge_fragmented_blocks_allcpus(void);
 
@@ -690,10 +713,11 @@ static void __purge_vmap_area_lazy(unsigned long *start, unsigned long *end,
 					int sync, int force_flush)
 {
 	static DEFINE_SPINLOCK(purge_lock);
-	LIST_HEAD(valist);
+	struct llist_node *valist = NULL;
 	struct vmap_area *va;
 	struct vmap_area *n_va;
-	int nr = 0;
+	int nr = 0, nr_areas = 0;
+	int cpu;
 
 	/*
 	 * If sync is 0 but force_flush is 1, we'll go sync anyway but callers
@@ -709,32 +733,49 @@ static void __purge_vmap_area_lazy(unsigned long *start, unsigned long *end,
 	if (sync)
 		purge_fragmented_blocks_allcpus();
 
-	rcu_read_lock();
-	list_for_each_entry_rcu(va, &vmap_area_list, list) {
-		if (va->flags & VM_LAZY_FREE) {
+	for_each_possible_cpu(cpu) {
+		struct llist_node *head;
+
+		head = llist_del_all(&per_cpu(vmap_purge_list, cpu));
+		llist_for_each_entry_safe(va, n_va, head, purge_list) {
 			if (va->va_start < *start)
 				*start = va->va_start;
 			if (va->va_end > *end)
 				*end = va->va_end;
 			nr += (va->va_end - va->va_start) >> PAGE_SHIFT;
-			list_add_tail(&va->purge_list, &valist);
+			nr_areas++;
+			va->purge_list.next = valist;
+			valist = &va->purge_list;
 			va->flags |= VM_LAZY_FREEING;
 			va->flags &= ~VM_LAZY_FREE;
 		}
 	}
-	rcu_read_unlock();
 
 	if (nr)
 		atomic_sub(nr, &vmap_lazy_nr);
 
-	if (nr || force_flush)
+	/*
+	 * Callers forcing a flush need their own range covered too, so they
+	 * always get the whole span.
+	 */
+	if (nr && !force_flush && nr <= VMAP_PURGE_RANGE_PAGES) {
+		llist_for_each_entry(va, valist, purge_list)
+			flush_tlb_kernel_range(va->va_start, va->va_end);
+		vmap_purge_stats.range_flushes++;
+	} else if (nr || force_flush) {
 		flush_tlb_kernel_range(*start, *end);
+		vmap_purge_stats.span_flushes++;
+	}
 
 	if (nr) {
 		spin_lock(&vmap_area_lock);
-		list_for_each_entry_safe(va, n_va, &valist, purge_list)
+		llist_for_each_entry_safe(va, n_va, valist, purge_list)
 			__free_vmap_area(va);
 		spin_unlock(&vmap_area_lock);
+
+		vmap_purge_stats.runs++;
+		vmap_purge_stats.areas += nr_areas;
+		vmap_purge_stats.pages += nr;
 	}
 	spin_unlock(&purge_lock);
 }
@@ -769,6 +810,8 @@ static void free_vmap_area_noflush(struct vmap_area *va)
 {
 	va->flags |= VM_LAZY_FREE;
 	atomic_add((va->va_end - va->va_start) >> PAGE_SHIFT, &vmap_lazy_nr);
+	/* llist_add() is safe against a migration to another cpu */
+	llist_add(&va->purge_list, raw_cpu_ptr(&vmap_purge_list));
 	if (unlikely(atomic_read(&vmap_lazy_nr) > lazy_max_pages()))
 		try_purge_vmap_area_lazy();
 }
@@ -2813,9 +2856,8 @@ static void show_numa_info(struct seq_file *m, struct vm_struct *v)
 	}
 }
 
-static int s_show(struct seq_file *m, void *p)
+static void show_vmap_area(struct seq_file *m, struct vmap_area *va)
 {
-	struct vmap_area *va = p;
 	struct vm_struct *v;
 
 	/*
@@ -2823,12 +2865,12 @@ static int s_show(struct seq_file *m, void *p)
 	 * behalf of vmap area is being tear down or vm_map_ram allocation.
 	 */
 	if (!(va->flags & VM_VM_AREA))
-		return 0;
+		return;
 
 	v = va->vm;
 
 	if (v->flags & VM_LOWMEM)
-		return 0;
+		return;
 
 	seq_printf(m, "0x%pK-0x%pK %7ld",
 		v->addr, v->addr + v->size, v->size);
@@ -2859,6 +2901,28 @@ static int s_show(struct seq_file *m, void *p)
 
 	show_numa_info(m, v);
 	seq_putc(m, '\n');
+}
+
+static void show_purge_info(struct seq_file *m)
+{
+	seq_printf(m, "purge: runs=%lu areas=%lu pages=%lu range_flushes=%lu span_flushes=%lu lazy_pages=%d\n",
+		   ACCESS_ONCE(vmap_purge_stats.runs),
+		   ACCESS_ONCE(vmap_purge_stats.areas),
+		   ACCESS_ONCE(vmap_purge_stats.pages),
+		   ACCESS_ONCE(vmap_purge_stats.range_flushes),
+		   ACCESS_ONCE(vmap_purge_stats.span_flushes),
+		   atomic_read(&vmap_lazy_nr));
+}
+
+static int s_show(struct seq_file *m, void *p)
+{
+	struct vmap_area *va = p;
+
+	show_vmap_area(m, va);
+
+	/* The lazy purge statistics close the listing */
+	if (list_is_last(&va->list, &vmap_area_list))
+		show_purge_info(m);
 	return 0;
 }
 
@@ -26,6 +26,7 @@
 #include <linux/init.h>
 #include <linux/module.h>
 #include <linux/vmpressure.h>
+#include <linux/memcontrol.h>
 
 /*
  * The window size (vmpressure_win) is the number of scanned pages before
@@ -79,6 +80,22 @@ void vmpressure_notify(unsigned long pressure)
 	blocking_notifier_call_chain(&vmpressure_notifier, pressure, NULL);
 }
 
+/*
+ * Cumulative time tasks have spent stalled in direct reclaim. Consumers
+ * such as the lowmemorykiller sample it to derive stall rates.
+ */
+static atomic64_t vmpressure_reclaim_stall = ATOMIC64_INIT(0);
+
+void vmpressure_account_reclaim_stall(u64 stall_ns)
+{
+	atomic64_add(stall_ns, &vmpressure_reclaim_stall);
+}
+
+u64 vmpressure_reclaim_stall_ns(void)
+{
+	return atomic64_read(&vmpressure_reclaim_stall);
+}
+
 /*
  * When there are too little pages left to scan, vmpressure() may miss the
  * critical pressure as number of pages will be less than "window size".
@@ -116,11 +133,23 @@ static struct vmpressure *vmpressure_parent(struct vmpressure *vmpr)
 		return NULL;
 	return memcg_to_vmpressure(memcg);
 }
+
+static unsigned long vmpressure_refaults(struct vmpressure *vmpr)
+{
+	struct cgroup_subsys_state *css = vmpressure_to_css(vmpr);
+
+	return mem_cgroup_nr_refaults(mem_cgroup_from_css(css));
+}
 #else
 static struct vmpressure *vmpressure_parent(struct vmpressure *vmpr)
 {
 	return NULL;
 }
+
+static unsigned long vmpressure_refaults(struct vmpressure *vmpr)
+{
+	return 0;
+}
 #endif
 
 enum vmpressure_levels {
@@ -136,6 +165,26 @@ static const char * const vmpressure_str_levels[] = {
 	[VMPRESSURE_CRITICAL] = "critical",
 };
 
+/*
+ * default:	pressure of the memcg and of its descendants, unless a
+ *		descendant already signalled it.
+ * hierarchy:	pressure of the memcg and of all of its descendants.
+ * local:	pressure on the memcg's own LRUs only, whichever reclaim
+ *		caused it. This is what an app cgroup sees of global reclaim.
+ */
+enum vmpressure_modes {
+	VMPRESSURE_NO_PASSTHROUGH = 0,
+	VMPRESSURE_HIERARCHY,
+	VMPRESSURE_LOCAL,
+	VMPRESSURE_NUM_MODES,
+};
+
+static const char * const vmpressure_str_modes[] = {
+	[VMPRESSURE_NO_PASSTHROUGH] = "default",
+	[VMPRESSURE_HIERARCHY] = "hierarchy",
+	[VMPRESSURE_LOCAL] = "local",
+};
+
 static enum vmpressure_levels vmpressure_level(unsigned long pressure)
 {
 	if (pressure >= vmpressure_level_critical)
@@ -183,16 +232,20 @@ static unsigned long vmpressure_account_stall(unsigned long pressure,
 struct vmpressure_event {
 	struct eventfd_ctx *efd;
 	enum vmpressure_levels level;
+	enum vmpressure_modes mode;
+	/* Count refaults as pages that reclaim failed to free ("local") */
+	bool refault;
 	struct list_head node;
 };
 
 static bool vmpressure_event(struct vmpressure *vmpr,
-			     unsigned long scanned, unsigned long reclaimed)
+			     unsigned long scanned, unsigned long reclaimed,
+			     bool signalled)
 {
 	struct vmpressure_event *ev;
 	enum vmpressure_levels level;
 	unsigned long pressure;
-	bool signalled = false;
+	bool ret = false;
 
 	pressure = vmpressure_calc_pressure(scanned, reclaimed);
 	level = vmpressure_level(pressure);
@@ -200,22 +253,57 @@ static bool vmpressure_event(struct vmpressure *vmpr,
 	mutex_lock(&vmpr->events_lock);
 
 	list_for_each_entry(ev, &vmpr->events, node) {
+		if (ev->mode == VMPRESSURE_LOCAL)
+			continue;
+		if (signalled && ev->mode == VMPRESSURE_NO_PASSTHROUGH)
+			continue;
 		if (level >= ev->level) {
 			eventfd_signal(ev->efd, 1);
-			signalled = true;
+			ret = true;
 		}
 	}
 
 	mutex_unlock(&vmpr->events_lock);
 
-	return signalled;
+	return ret;
+}
+
+/*
+ * A page cache page that refaults was reclaimed in vain: with the refault
+ * option those refaults are taken off the reclaimed pages of the window,
+ * so a memcg that is thrashing reports the pressure it is really under.
+ */
+static void vmpressure_event_local(struct vmpressure *vmpr,
+				   unsigned long scanned,
+				   unsigned long reclaimed,
+				   unsigned long refaults)
+{
+	struct vmpressure_event *ev;
+	enum vmpressure_levels level, refault_level;
+
+	level = vmpressure_level(vmpressure_calc_pressure(scanned, reclaimed));
+	reclaimed -= min(reclaimed, refaults);
+	refault_level = vmpressure_level(vmpressure_calc_pressure(scanned,
+								  reclaimed));
+
+	mutex_lock(&vmpr->events_lock);
+
+	list_for_each_entry(ev, &vmpr->events, node) {
+		if (ev->mode != VMPRESSURE_LOCAL)
+			continue;
+		if ((ev->refault ? refault_level : level) >= ev->level)
+			eventfd_signal(ev->efd, 1);
+	}
+
+	mutex_unlock(&vmpr->events_lock);
 }
 
 static void vmpressure_work_fn(struct work_struct *work)
 {
 	struct vmpressure *vmpr = work_to_vmpressure(work);
-	unsigned long scanned;
-	unsigned long reclaimed;
+	unsigned long scanned, local_scanned;
+	unsigned long reclaimed, local_reclaimed;
+	bool signalled = false;
 
 	spin_lock(&vmpr->sr_lock);
 	/*
@@ -225,25 +313,47 @@ static void vmpressure_work_fn(struct work_struct *work)
 	 * just after the old work returns, but then scanned might be zero
 	 * here. No need for any locks here since we don't care if
 	 * vmpr->reclaimed is in sync.
+	 *
+	 * The work serves both the hierarchical and the local window, so
+	 * only consume the ones that are complete.
 	 */
 	scanned = vmpr->scanned;
-	if (!scanned) {
-		spin_unlock(&vmpr->sr_lock);
-		return;
+	reclaimed = vmpr->reclaimed;
+	if (scanned >= vmpressure_win) {
+		vmpr->scanned = 0;
+		vmpr->reclaimed = 0;
+	} else {
+		scanned = 0;
 	}
 
-	reclaimed = vmpr->reclaimed;
-	vmpr->scanned = 0;
-	vmpr->reclaimed = 0;
+	local_scanned = vmpr->local_scanned;
+	local_reclaimed = vmpr->local_reclaimed;
+	if (local_scanned >= vmpressure_win) {
+		vmpr->local_scanned = 0;
+		vmpr->local_reclaimed = 0;
+	} else {
+		local_scanned = 0;
+	}
 	spin_unlock(&vmpr->sr_lock);
 
+	if (local_scanned) {
+		unsigned long refaults = vmpressure_refaults(vmpr);
+
+		vmpressure_event_local(vmpr, local_scanned, local_reclaimed,
+				       refaults - vmpr->local_refaults);
+		vmpr->local_refaults = refaults;
+	}
+
+	if (!scanned)
+		return;
+
+	/*
+	 * Propagate the event upward into the hierarchy. Once it has been
+	 * handled, only "hierarchy" listeners of the ancestors see it.
+	 */
 	do {
-		if (vmpressure_event(vmpr, scanned, reclaimed))
-			break;
-		/*
-		 * If not handled, propagate the event upward into the
-		 * hierarchy.
-		 */
+		if (vmpressure_event(vmpr, scanned, reclaimed, signalled))
+			signalled = true;
 	} while ((vmpr = vmpressure_parent(vmpr)));
 }
 
@@ -290,6 +400,47 @@ void vmpressure_memcg(gfp_t gfp, struct mem_cgroup *memcg,
 	schedule_work(&vmpr->work);
 }
 
+/**
+ * vmpressure_local() - Account reclaim of a memcg's own LRUs
+ * @gfp:	reclaimer's gfp mask
+ * @memcg:	memcg whose LRUs were just shrunk
+ * @scanned:	number of pages scanned from them
+ * @reclaimed:	number of pages reclaimed from them
+ *
+ * Called for every memcg visited by the reclaimer, global reclaim
+ * included, so that "local" listeners learn about the pressure on their
+ * own group rather than the system or hierarchy average.
+ */
+void vmpressure_local(gfp_t gfp, struct mem_cgroup *memcg,
+		      unsigned long scanned, unsigned long reclaimed)
+{
+	struct vmpressure *vmpr;
+
+	if (!memcg)
+		return;
+
+	if (!(gfp & (__GFP_HIGHMEM | __GFP_MOVABLE | __GFP_IO | __GFP_FS)))
+		return;
+
+	if (!scanned)
+		return;
+
+	vmpr = memcg_to_vmpressure(memcg);
+	/* Nobody listens to this memcg alone, don't bother */
+	if (!vmpr || !ACCESS_ONCE(vmpr->nr_local_events))
+		return;
+
+	spin_lock(&vmpr->sr_lock);
+	vmpr->local_scanned += scanned;
+	vmpr->local_reclaimed += reclaimed;
+	scanned = vmpr->local_scanned;
+	spin_unlock(&vmpr->sr_lock);
+
+	if (scanned < vmpressure_win)
+		return;
+	schedule_work(&vmpr->work);
+}
+
 void vmpressure_global(gfp_t gfp, unsigned long scanned,
 		unsigned long reclaimed)
 {
@@ -390,9 +541,12 @@ void vmpressure_prio(gfp_t gfp, struct mem_cgroup *memcg, int prio)
  *
  * This function associates eventfd context with the vmpressure
  * infrastructure, so that the notifications will be delivered to the
- * @eventfd. The @args parameter is a string that denotes pressure level
- * threshold (one of vmpressure_str_levels, i.e. "low", "medium", or
- * "critical").
+ * @eventfd. The @args parameter is a string of the form
+ * "<level>[,<mode>[,refault]]": the pressure level threshold (one of
+ * vmpressure_str_levels, i.e. "low", "medium", or "critical"), then
+ * optionally one of vmpressure_str_modes ("default", "hierarchy" or
+ * "local"). "local" listeners may also ask for refaults to count as
+ * failed reclaim.
  *
  * To be used as memcg event method.
  */
@@ -401,30 +555,70 @@ int vmpressure_register_event(struct mem_cgroup *memcg,
 {
 	struct vmpressure *vmpr = memcg_to_vmpressure(memcg);
 	struct vmpressure_event *ev;
+	enum vmpressure_modes mode = VMPRESSURE_NO_PASSTHROUGH;
+	bool refault = false;
+	char *spec, *spec_orig, *token;
 	int level;
+	int ret = 0;
 
 	BUG_ON(!vmpr);
 
+	spec_orig = spec = kstrndup(args, 64, GFP_KERNEL);
+	if (!spec)
+		return -ENOMEM;
+
+	token = strsep(&spec, ",");
 	for (level = 0; level < VMPRESSURE_NUM_LEVELS; level++) {
-		if (!strcmp(vmpressure_str_levels[level], args))
+		if (!strcmp(vmpressure_str_levels[level], token))
 			break;
 	}
 
-	if (level >= VMPRESSURE_NUM_LEVELS)
-		return -EINVAL;
+	if (level >= VMPRESSURE_NUM_LEVELS) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	token = strsep(&spec, ",");
+	if (token) {
+		for (mode = 0; mode < VMPRESSURE_NUM_MODES; mode++) {
+			if (!strcmp(vmpressure_str_modes[mode], token))
+				break;
+		}
+		if (mode >= VMPRESSURE_NUM_MODES) {
+			ret = -EINVAL;
+			goto out;
+		}
+	}
+
+	token = strsep(&spec, ",");
+	if (token) {
+		if (mode != VMPRESSURE_LOCAL || strcmp(token, "refault") ||
+		    spec) {
+			ret = -EINVAL;
+			goto out;
+		}
+		refault = true;
+	}
 
 	ev = kzalloc(sizeof(*ev), GFP_KERNEL);
-	if (!ev)
-		return -ENOMEM;
+	if (!ev) {
+		ret = -ENOMEM;
+		goto out;
+	}
 
 	ev->efd = eventfd;
 	ev->level = level;
+	ev->mode = mode;
+	ev->refault = refault;
 
 	mutex_lock(&vmpr->events_lock);
 	list_add(&ev->node, &vmpr->events);
+	if (mode == VMPRESSURE_LOCAL && !vmpr->nr_local_events++)
+		vmpr->local_refaults = vmpressure_refaults(vmpr);
 	mutex_unlock(&vmpr->events_lock);
-
-	return 0;
+out:
+	kfree(spec_orig);
+	return ret;
 }
 
 /**
@@ -451,6 +645,8 @@ void vmpressure_unregister_event(struct mem_cgroup *memcg,
 		if (ev->efd != eventfd)
 			continue;
 		list_del(&ev->node);
+		if (ev->mode == VMPRESSURE_LOCAL)
+			vmpr->nr_local_events--;
 		kfree(ev);
 		break;
 	}
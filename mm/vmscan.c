@@ -2001,6 +2001,7 @@ static void get_scan_count(struct lruvec *lruvec, int swappiness,
 	unsigned long anon, file;
 	bool force_scan = false;
 	unsigned long ap, fp;
+	unsigned int protect = 0;
 	enum lru_list lru;
 	bool some_scanned;
 	int pass;
@@ -2020,6 +2021,14 @@ static void get_scan_count(struct lruvec *lruvec, int swappiness,
 	if (!global_reclaim(sc))
 		force_scan = true;
 
+	/*
+	 * Spare part of the page cache of groups that are refaulting
+	 * their working set, unless reclaim is getting desperate.
+	 * Limit reclaim keeps scanning the group it was asked to.
+	 */
+	if (global_reclaim(sc) && sc->priority > DEF_PRIORITY / 2)
+		protect = mem_cgroup_workingset_protection(lruvec);
+
 	/* If we have no swap space, do not bother scanning anon pages. */
 	if (!sc->may_swap || (get_nr_swap_pages() <= 0)) {
 		scan_balance = SCAN_FILE;
@@ -2120,6 +2129,8 @@ out:
 			unsigned long scan;
 
 			size = get_lru_size(lruvec, lru);
+			if (file && protect)
+				size -= (size * protect) >> 10;
 			scan = size >> sc->priority;
 
 			if (!scan && pass && force_scan)
@@ -2368,6 +2379,8 @@ static bool shrink_zone(struct zone *zone, struct scan_control *sc)
 
 		memcg = mem_cgroup_iter(root, NULL, &reclaim);
 		do {
+			unsigned long scanned = sc->nr_scanned;
+			unsigned long reclaimed = sc->nr_reclaimed;
 			struct lruvec *lruvec;
 			int swappiness;
 
@@ -2376,6 +2389,10 @@ static bool shrink_zone(struct zone *zone, struct scan_control *sc)
 
 			shrink_lruvec(lruvec, swappiness, sc);
 
+			vmpressure_local(sc->gfp_mask, memcg,
+					 sc->nr_scanned - scanned,
+					 sc->nr_reclaimed - reclaimed);
+
 			/*
 			 * Direct reclaim and kswapd have to scan all memory
 			 * cgroups to fulfill the overall scan target for the
@@ -860,6 +860,9 @@ const char * const vmstat_text[] = {
 	"compact_stall",
 	"compact_fail",
 	"compact_success",
+	"compact_proactive",
+	"compact_proactive_success",
+	"compact_stall_avoided",
 #endif
 
 #ifdef CONFIG_HUGETLB_PAGE
@@ -1182,7 +1185,7 @@ static const struct file_operations pagetypeinfo_file_ops = {
 static void zoneinfo_show_print(struct seq_file *m, pg_data_t *pgdat,
 							struct zone *zone)
 {
-	int i;
+	int i, order;
 	seq_printf(m, "Node %d, zone %8s", pgdat->node_id, zone->name);
 	seq_printf(m,
 		   "\n  pages free     %lu"
@@ -1227,6 +1230,14 @@ static void zoneinfo_show_print(struct seq_file *m, pg_data_t *pgdat,
 			   pageset->pcp.count,
 			   pageset->pcp.high,
 			   pageset->pcp.batch);
+		for (order = 1; order <= PCP_HIGH_ORDER; order++) {
+			struct per_cpu_pages *hpcp;
+
+			hpcp = &pageset->hpcp[order - 1];
+			seq_printf(m,
+				   "\n       order-%d: count: %i high: %i batch: %i",
+				   order, hpcp->count, hpcp->high, hpcp->batch);
+		}
 #ifdef CONFIG_SMP
 		seq_printf(m, "\n  vm stats threshold: %d",
 				pageset->stat_threshold);
@@ -150,6 +150,12 @@
  *
  * On cache misses for which there are shadow entries, an eligible
  * refault distance will immediately activate the refaulting page.
+ *
+ * Refaults are also charged to the memory cgroup of the refaulting
+ * page, which keeps a decaying average of its refault rate and
+ * distance.  Reclaim uses these to spare part of the page cache of
+ * groups whose working set is being pushed out by others, see
+ * mem_cgroup_workingset_protection().
  */
 
 static void *pack_shadow(unsigned long eviction, struct zone *zone)
@@ -222,25 +228,37 @@ void *workingset_eviction(struct address_space *mapping, struct page *page)
 /**
  * workingset_refault - evaluate the refault of a previously evicted page
  * @shadow: shadow entry of the evicted page
+ * @page: the refaulting page, already charged to its memory cgroup
  *
  * Calculates and evaluates the refault distance of the previously
  * evicted page in the context of the zone it was allocated in.
  *
  * Returns %true if the page should be activated, %false otherwise.
  */
-bool workingset_refault(void *shadow)
+bool workingset_refault(void *shadow, struct page *page)
 {
 	unsigned long refault_distance;
+	unsigned long active_file;
 	struct zone *zone;
+	bool activate;
 
 	unpack_shadow(shadow, &zone, &refault_distance);
 	inc_zone_state(zone, WORKINGSET_REFAULT);
 
-	if (refault_distance <= zone_page_state(zone, NR_ACTIVE_FILE)) {
+	active_file = zone_page_state(zone, NR_ACTIVE_FILE);
+	activate = refault_distance <= active_file;
+	if (activate)
 		inc_zone_state(zone, WORKINGSET_ACTIVATE);
-		return true;
-	}
-	return false;
+
+	/*
+	 * Distances beyond the whole page cache could never be
+	 * satisfied, don't let them dominate the cgroup average.
+	 */
+	refault_distance = min(refault_distance, active_file +
+			       zone_page_state(zone, NR_INACTIVE_FILE));
+	mem_cgroup_workingset_refault(page, refault_distance, activate);
+
+	return activate;
 }
 
 /**
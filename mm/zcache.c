@@ -60,6 +60,52 @@ module_param_named(max_pool_percent, zcache_max_pool_percent, uint, 0644);
 
 static unsigned int zcache_clear_percent = 4;
 module_param_named(clear_percent, zcache_clear_percent, uint, 0644);
+
+/*
+ * Admission control: once a file has stored admit_min_stores pages in
+ * zcache, further pages are refused unless at least admit_hit_pct percent
+ * of them were read back. 0 admits every (active) page.
+ */
+static unsigned int zcache_admit_min_stores = 64;
+module_param_named(admit_min_stores, zcache_admit_min_stores, uint, 0644);
+
+static unsigned int zcache_admit_hit_pct = 1;
+module_param_named(admit_hit_pct, zcache_admit_hit_pct, uint, 0644);
+
+/*
+ * Give pages of mmap()ed files one more trip around the zbud LRU before
+ * evicting them.
+ */
+static bool zcache_spare_mapped = true;
+module_param_named(spare_mapped, zcache_spare_mapped, bool, 0644);
+
+/*
+ * Pages are classified by the file they belong to when they are stored:
+ * files that are mapped somewhere hold code and mmap()ed data that is
+ * likely to come back, the others are mostly read() streams.
+ */
+enum zcache_file_class {
+	ZCACHE_CLASS_MAPPED,
+	ZCACHE_CLASS_UNMAPPED,
+	ZCACHE_NR_CLASSES,
+};
+
+static const char * const zcache_class_names[ZCACHE_NR_CLASSES] = {
+	[ZCACHE_CLASS_MAPPED] = "mapped",
+	[ZCACHE_CLASS_UNMAPPED] = "unmapped",
+};
+
+struct zcache_class_stat {
+	atomic_t stored_pages;
+	atomic_long_t stored_bytes;	/* Compressed */
+	u64 stores;
+	u64 refused;			/* By admission control */
+	u64 hits;
+	u64 evicted;
+	u64 spared;
+};
+
+static struct zcache_class_stat zcache_class_stats[ZCACHE_NR_CLASSES];
 /*
  * zcache statistics
  */
@@ -74,6 +120,7 @@ static u64 zcache_pool_shrink;
 static u64 zcache_pool_shrink_fail;
 static u64 zcache_pool_shrink_pages;
 static u64 zcache_store_failed;
+static u64 zcache_load_miss;
 static atomic_t zcache_stored_pages = ATOMIC_INIT(0);
 static atomic_t zcache_stored_zero_pages = ATOMIC_INIT(0);
 
@@ -141,6 +188,9 @@ struct zcache_rbnode {
 	struct radix_tree_root ratree; /* Page radix tree per inode rbtree */
 	spinlock_t ra_lock;		/* Protects radix tree */
 	struct kref refcount;
+	/* Admission history, updated under ra_lock */
+	unsigned int stores;
+	unsigned int hits;
 };
 
 /*
@@ -150,6 +200,8 @@ struct zcache_ra_handle {
 	int rb_index;			/* Redblack tree index */
 	int ra_index;			/* Radix tree index */
 	int zlen;			/* Compressed page size */
+	unsigned short fclass;		/* enum zcache_file_class */
+	unsigned short spared;		/* Survived one eviction attempt */
 	struct zcache_pool *zpool;	/* Finding zcache_pool during evict */
 };
 
@@ -407,6 +459,23 @@ static bool zcache_is_full(void)
 			file));
 }
 
+/*
+ * Account a compressed entry of @zpool leaving zcache. @zaddr must still
+ * be allocated.
+ */
+static void zcache_dec_stored(struct zcache_pool *zpool, unsigned long zaddr)
+{
+	struct zcache_ra_handle *zhandle;
+	struct zcache_class_stat *stat;
+
+	zhandle = (struct zcache_ra_handle *)zbud_map(zpool->pool, zaddr);
+	stat = &zcache_class_stats[zhandle->fclass];
+	atomic_dec(&stat->stored_pages);
+	atomic_long_sub(zhandle->zlen, &stat->stored_bytes);
+	zbud_unmap(zpool->pool, zaddr);
+	atomic_dec(&zcache_stored_pages);
+}
+
 /*
  * The caller must hold zpool->rb_lock at least
  */
@@ -530,6 +599,8 @@ static int zcache_store_zaddr(struct zcache_pool *zpool,
 		INIT_RADIX_TREE(&rbnode->ratree, GFP_ATOMIC|__GFP_NOWARN);
 		spin_lock_init(&rbnode->ra_lock);
 		rbnode->rb_index = rb_index;
+		rbnode->stores = 0;
+		rbnode->hits = 0;
 		kref_init(&rbnode->refcount);
 		RB_CLEAR_NODE(&rbnode->rb_node);
 
@@ -559,8 +630,8 @@ static int zcache_store_zaddr(struct zcache_pool *zpool,
 		if (dup_zaddr == ZERO_HANDLE) {
 			atomic_dec(&zcache_stored_zero_pages);
 		} else {
+			zcache_dec_stored(zpool, (unsigned long)dup_zaddr);
 			zbud_free(zpool->pool, (unsigned long)dup_zaddr);
-			atomic_dec(&zcache_stored_pages);
 			zpool->size = zbud_get_pool_size(zpool->pool);
 		}
 		zcache_dup_entry++;
@@ -569,6 +640,8 @@ static int zcache_store_zaddr(struct zcache_pool *zpool,
 	/* Insert zcache_ra_handle to ratree */
 	ret = radix_tree_insert(&rbnode->ratree, ra_index,
 				(void *)zaddr);
+	if (!ret)
+		rbnode->stores++;
 	spin_unlock_irqrestore(&rbnode->ra_lock, flags);
 	if (unlikely(ret)) {
 		write_lock_irqsave(&zpool->rb_lock, flags);
@@ -589,9 +662,10 @@ static int zcache_store_zaddr(struct zcache_pool *zpool,
  * Load zaddr and delete it from radix tree.
  * If the radix tree of the corresponding rbnode is empty, delete the rbnode
  * from zpool->rbtree also.
+ * @hit tells whether the page is being read back, for admission control.
  */
 static void *zcache_load_delete_zaddr(struct zcache_pool *zpool,
-				int rb_index, int ra_index)
+				int rb_index, int ra_index, bool hit)
 {
 	struct zcache_rbnode *rbnode;
 	void *zaddr = NULL;
@@ -605,6 +679,8 @@ static void *zcache_load_delete_zaddr(struct zcache_pool *zpool,
 
 	spin_lock_irqsave(&rbnode->ra_lock, flags);
 	zaddr = radix_tree_delete(&rbnode->ratree, ra_index);
+	if (zaddr && hit)
+		rbnode->hits++;
 	spin_unlock_irqrestore(&rbnode->ra_lock, flags);
 
 	/* rb_lock and ra_lock must be taken again in the given sequence */
@@ -636,6 +712,31 @@ out:
 	return ret;
 }
 
+/*
+ * A file that keeps sending pages to zcache without reading any of them
+ * back is being streamed: compressing more of it only pushes out entries
+ * that would have been hit.
+ */
+static bool zcache_file_streaming(struct zcache_pool *zpool, int rb_index)
+{
+	struct zcache_rbnode *rbnode;
+	unsigned int stores, hits;
+
+	if (!zcache_admit_min_stores)
+		return false;
+
+	rbnode = zcache_find_get_rbnode(zpool, rb_index);
+	if (!rbnode)
+		return false;
+
+	stores = ACCESS_ONCE(rbnode->stores);
+	hits = ACCESS_ONCE(rbnode->hits);
+	kref_put(&rbnode->refcount, zcache_rbnode_release);
+
+	return stores >= zcache_admit_min_stores &&
+		(u64)hits * 100 < (u64)stores * zcache_admit_hit_pct;
+}
+
 static void zcache_store_page(int pool_id, struct cleancache_filekey key,
 		pgoff_t index, struct page *page)
 {
@@ -646,6 +747,7 @@ static void zcache_store_page(int pool_id, struct cleancache_filekey key,
 	unsigned int zlen = PAGE_SIZE;
 	bool zero = 0;
 	int ret;
+	enum zcache_file_class fclass;
 
 	struct zcache_pool *zpool = zcache.pools[pool_id];
 
@@ -660,6 +762,13 @@ static void zcache_store_page(int pool_id, struct cleancache_filekey key,
 		return;
 	}
 
+	fclass = page->mapping && mapping_mapped(page->mapping) ?
+		ZCACHE_CLASS_MAPPED : ZCACHE_CLASS_UNMAPPED;
+	if (zcache_file_streaming(zpool, key.u.ino)) {
+		zcache_class_stats[fclass].refused++;
+		return;
+	}
+
 	zero = zero_page(page);
 	if (zero)
 		goto zero;
@@ -703,6 +812,10 @@ static void zcache_store_page(int pool_id, struct cleancache_filekey key,
 	/* Compressed page data stored at the end of zcache_ra_handle */
 	zpage = (u8 *)(zhandle + 1);
 	memcpy(zpage, dst, zlen);
+	/* Seen by zcache_dec_stored() as soon as the entry is in the tree */
+	zhandle->zlen = zlen;
+	zhandle->fclass = fclass;
+	zhandle->spared = 0;
 	zbud_unmap(zpool->pool, zaddr);
 	put_cpu_var(zcache_dstmem);
 
@@ -725,9 +838,11 @@ zero:
 	} else {
 		zhandle->ra_index = index;
 		zhandle->rb_index = key.u.ino;
-		zhandle->zlen = zlen;
 		zhandle->zpool = zpool;
 		atomic_inc(&zcache_stored_pages);
+		zcache_class_stats[fclass].stores++;
+		atomic_inc(&zcache_class_stats[fclass].stored_pages);
+		atomic_long_add(zlen, &zcache_class_stats[fclass].stored_bytes);
 		zpool->size = zbud_get_pool_size(zpool->pool);
 	}
 
@@ -744,10 +859,11 @@ static int zcache_load_page(int pool_id, struct cleancache_filekey key,
 	struct zcache_ra_handle *zhandle;
 	struct zcache_pool *zpool = zcache.pools[pool_id];
 
-	zaddr = zcache_load_delete_zaddr(zpool, key.u.ino, index);
-	if (!zaddr)
+	zaddr = zcache_load_delete_zaddr(zpool, key.u.ino, index, true);
+	if (!zaddr) {
+		zcache_load_miss++;
 		return -ENOENT;
-	else if (zaddr == ZERO_HANDLE)
+	} else if (zaddr == ZERO_HANDLE)
 		goto map;
 
 	zhandle = (struct zcache_ra_handle *)zbud_map(zpool->pool,
@@ -769,14 +885,15 @@ map:
 		goto out;
 	}
 	kunmap_atomic(dst);
+	zcache_class_stats[zhandle->fclass].hits++;
 	zbud_unmap(zpool->pool, (unsigned long)zaddr);
+	zcache_dec_stored(zpool, (unsigned long)zaddr);
 	zbud_free(zpool->pool, (unsigned long)zaddr);
 
 	BUG_ON(ret);
 	BUG_ON(dlen != PAGE_SIZE);
 
 	/* update stats */
-	atomic_dec(&zcache_stored_pages);
 	zpool->size = zbud_get_pool_size(zpool->pool);
 out:
 	SetPageWasActive(page);
@@ -789,10 +906,10 @@ static void zcache_flush_page(int pool_id, struct cleancache_filekey key,
 	struct zcache_pool *zpool = zcache.pools[pool_id];
 	void *zaddr = NULL;
 
-	zaddr = zcache_load_delete_zaddr(zpool, key.u.ino, index);
+	zaddr = zcache_load_delete_zaddr(zpool, key.u.ino, index, false);
 	if (zaddr && (zaddr != ZERO_HANDLE)) {
+		zcache_dec_stored(zpool, (unsigned long)zaddr);
 		zbud_free(zpool->pool, (unsigned long)zaddr);
-		atomic_dec(&zcache_stored_pages);
 		zpool->size = zbud_get_pool_size(zpool->pool);
 	} else if (zaddr == ZERO_HANDLE) {
 		atomic_dec(&zcache_stored_zero_pages);
@@ -834,8 +951,8 @@ static void zcache_flush_ratree(struct zcache_pool *zpool,
 			if (!zaddr)
 				continue;
 			zbud_unmap(zpool->pool, (unsigned long)zaddrs[i]);
+			zcache_dec_stored(zpool, (unsigned long)zaddrs[i]);
 			zbud_free(zpool->pool, (unsigned long)zaddrs[i]);
-			atomic_dec(&zcache_stored_pages);
 			zpool->size = zbud_get_pool_size(zpool->pool);
 		}
 
@@ -933,13 +1050,26 @@ static int zcache_evict_zpage(struct zbud_pool *pool, unsigned long zaddr)
 
 	BUG_ON(pool != zpool->pool);
 
+	/*
+	 * Rotate a mapped file's page once; zbud_reclaim_page() moves on to
+	 * the next LRU entry.
+	 */
+	if (zcache_spare_mapped && zhandle->fclass == ZCACHE_CLASS_MAPPED &&
+	    !zhandle->spared) {
+		zhandle->spared = 1;
+		zcache_class_stats[ZCACHE_CLASS_MAPPED].spared++;
+		zbud_unmap(pool, zaddr);
+		return -EAGAIN;
+	}
+
 	zaddr_intree = zcache_load_delete_zaddr(zpool, zhandle->rb_index,
-			zhandle->ra_index);
+			zhandle->ra_index, false);
 	if (zaddr_intree) {
 		BUG_ON((unsigned long)zaddr_intree != zaddr);
+		zcache_class_stats[zhandle->fclass].evicted++;
 		zbud_unmap(pool, zaddr);
+		zcache_dec_stored(zpool, zaddr);
 		zbud_free(pool, zaddr);
-		atomic_dec(&zcache_stored_pages);
 		zpool->size = zbud_get_pool_size(pool);
 		zcache_evict_zpages++;
 	}
@@ -1057,6 +1187,7 @@ static struct cleancache_ops zcache_ops = {
  */
 #ifdef CONFIG_DEBUG_FS
 #include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 static int pool_pages_get(void *_data, u64 *val)
 {
@@ -1066,6 +1197,52 @@ static int pool_pages_get(void *_data, u64 *val)
 
 DEFINE_SIMPLE_ATTRIBUTE(pool_page_fops, pool_pages_get, NULL, "%llu\n");
 
+/* Hits per MB of @bytes of memory spent on them */
+static u64 zcache_hits_per_mb(u64 hits, u64 bytes)
+{
+	if (!bytes)
+		return 0;
+	return div64_u64(hits << 20, bytes);
+}
+
+static int zcache_class_stats_show(struct seq_file *m, void *v)
+{
+	u64 hits = 0;
+	int i;
+
+	seq_printf(m, "%-9s %8s %10s %10s %10s %10s %10s %8s %11s\n",
+		   "class", "pages", "bytes", "stores", "refused", "hits",
+		   "evicted", "spared", "hits_per_mb");
+	for (i = 0; i < ZCACHE_NR_CLASSES; i++) {
+		struct zcache_class_stat *stat = &zcache_class_stats[i];
+		long bytes = atomic_long_read(&stat->stored_bytes);
+
+		seq_printf(m, "%-9s %8d %10ld %10llu %10llu %10llu %10llu %8llu %11llu\n",
+			   zcache_class_names[i],
+			   atomic_read(&stat->stored_pages), bytes,
+			   stat->stores, stat->refused, stat->hits,
+			   stat->evicted, stat->spared,
+			   zcache_hits_per_mb(stat->hits, max(bytes, 0L)));
+		hits += stat->hits;
+	}
+	/* What the whole pool costs, zbud fragmentation included */
+	seq_printf(m, "pool hits_per_mb: %llu\n",
+		   zcache_hits_per_mb(hits, zcache_pages() << PAGE_SHIFT));
+	return 0;
+}
+
+static int zcache_class_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, zcache_class_stats_show, NULL);
+}
+
+static const struct file_operations zcache_class_stats_fops = {
+	.open		= zcache_class_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 static struct dentry *zcache_debugfs_root;
 
 static int __init zcache_debugfs_init(void)
@@ -1105,6 +1282,10 @@ static int __init zcache_debugfs_init(void)
 			zcache_debugfs_root, &zcache_pool_shrink_pages);
 	debugfs_create_u64("store_fail", S_IRUGO,
 			zcache_debugfs_root, &zcache_store_failed);
+	debugfs_create_u64("load_miss", S_IRUGO,
+			zcache_debugfs_root, &zcache_load_miss);
+	debugfs_create_file("class_stats", S_IRUGO, zcache_debugfs_root, NULL,
+			&zcache_class_stats_fops);
 	return 0;
 }
 
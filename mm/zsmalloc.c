@@ -60,6 +60,7 @@
 #include <linux/anon_inodes.h>
 #include <linux/migrate.h>
 #include <linux/compaction.h>
+#include <linux/workqueue.h>
 #include <linux/zsmalloc.h>
 #include <linux/zpool.h>
 
@@ -194,6 +195,24 @@ static struct dentry *zs_stat_root;
  */
 static int zs_size_classes;
 
+static struct workqueue_struct *zs_compact_wq;
+
+/*
+ * Objects migrated per class->lock hold. Compaction drops the lock after
+ * this many so that zs_malloc()/zs_free() on a busy class are not stalled
+ * behind a whole run of zspages.
+ */
+static int zs_compact_batch = 32;
+module_param_named(compact_batch, zs_compact_batch, int, 0644);
+
+/*
+ * Queue background compaction of a class once zs_can_compact() reports at
+ * least this many reclaimable pages in it. 0 leaves compaction to the
+ * shrinker and to explicit zs_compact() calls.
+ */
+static unsigned long zs_compact_threshold = 64;
+module_param_named(compact_threshold, zs_compact_threshold, ulong, 0644);
+
 /*
  * We assign a page to ZS_ALMOST_EMPTY fullness group when:
  *	n <= N / f, where
@@ -229,6 +248,9 @@ struct size_class {
 
 	/* huge object: pages_per_zspage == 1 && maxobj_per_zspage == 1 */
 	bool huge;
+
+	/* Compacts this class on zs_compact_wq */
+	struct work_struct compact_work;
 };
 
 /*
@@ -257,7 +279,10 @@ struct zs_pool {
 	gfp_t flags;	/* allocation flags used when growing pool */
 	atomic_long_t pages_allocated;
 
-	struct zs_pool_stats stats;
+	/* Classes compact in parallel, so the stats are updated atomically */
+	atomic_long_t pages_compacted;
+	atomic_long_t pages_moved;
+	atomic64_t compact_time_ns;
 
 	/* Compact classes */
 	struct shrinker shrinker;
@@ -274,6 +299,8 @@ struct zs_pool {
 #endif
 };
 
+static void zs_compact_check(struct size_class *class);
+
 /*
  * In this implementation, a free_idx, zspage's class index, fullness group,
  * inuse object count are encoded in its (first)page->freelist
@@ -1645,6 +1672,8 @@ void zs_free(struct zs_pool *pool, unsigned long handle)
 	unpin_tag(handle);
 
 	free_handle(pool, handle);
+
+	zs_compact_check(class);
 }
 EXPORT_SYMBOL_GPL(zs_free);
 
@@ -1755,6 +1784,8 @@ struct zs_compact_control {
 	 /* Starting object index within @s_page which used for live object
 	  * in the subpage. */
 	int index;
+	/* Objects that may still be moved before class->lock is dropped */
+	int nr_budget;
 };
 
 static int migrate_zspage(struct zs_pool *pool, struct size_class *class,
@@ -1784,6 +1815,14 @@ static int migrate_zspage(struct zs_pool *pool, struct size_class *class,
 			break;
 		}
 
+		/* Let the caller drop the lock, we resume from @index */
+		if (!cc->nr_budget) {
+			unpin_tag(handle);
+			ret = -EAGAIN;
+			break;
+		}
+		cc->nr_budget--;
+
 		used_obj = handle_to_obj(handle);
 		free_obj = obj_malloc(d_page, class, handle);
 		zs_object_copy(free_obj, used_obj, class);
@@ -1885,6 +1924,8 @@ static void __zs_compact(struct zs_pool *pool, struct size_class *class)
 	struct zs_compact_control cc;
 	struct page *src_page;
 	struct page *dst_page = NULL;
+	u64 start = local_clock();
+	int ret;
 
 	spin_lock(&class->lock);
 	while ((src_page = isolate_source_page(class))) {
@@ -1896,14 +1937,27 @@ static void __zs_compact(struct zs_pool *pool, struct size_class *class)
 
 		cc.index = 0;
 		cc.s_page = src_page;
+		cc.nr_budget = max(zs_compact_batch, 1);
 
 		while ((dst_page = isolate_target_page(class))) {
 			cc.d_page = dst_page;
+			/*
+			 * Both zspages stay isolated while the lock is dropped,
+			 * so zs_free() and page migration leave them alone and
+			 * zs_malloc() cannot pick them.
+			 */
+			while ((ret = migrate_zspage(pool, class, &cc)) ==
+					-EAGAIN) {
+				spin_unlock(&class->lock);
+				cond_resched();
+				spin_lock(&class->lock);
+				cc.nr_budget = max(zs_compact_batch, 1);
+			}
 			/*
 			 * If there is no more space in dst_page, resched
 			 * and see if anyone had allocated another zspage.
 			 */
-			if (!migrate_zspage(pool, class, &cc))
+			if (!ret)
 				break;
 
 			putback_zspage(pool, class, dst_page);
@@ -1915,7 +1969,8 @@ static void __zs_compact(struct zs_pool *pool, struct size_class *class)
 
 		putback_zspage(pool, class, dst_page);
 		if (putback_zspage(pool, class, src_page) == ZS_EMPTY)
-			pool->stats.pages_compacted += class->pages_per_zspage;
+			atomic_long_add(class->pages_per_zspage,
+					&pool->pages_compacted);
 		spin_unlock(&class->lock);
 		cond_resched();
 		spin_lock(&class->lock);
@@ -1925,8 +1980,36 @@ static void __zs_compact(struct zs_pool *pool, struct size_class *class)
 		putback_zspage(pool, class, src_page);
 
 	spin_unlock(&class->lock);
+
+	atomic64_add(local_clock() - start, &pool->compact_time_ns);
+}
+
+static void zs_compact_work(struct work_struct *work)
+{
+	struct size_class *class = container_of(work, struct size_class,
+						compact_work);
+
+	__zs_compact(class->pool, class);
 }
 
+/*
+ * Called after an object of @class was freed: fragmentation only grows
+ * on free, so this is where the class is queued for background compaction
+ * once it could give back zs_compact_threshold pages.
+ */
+static void zs_compact_check(struct size_class *class)
+{
+	if (!zs_compact_threshold)
+		return;
+
+	if (zs_can_compact(class) >= zs_compact_threshold)
+		queue_work(zs_compact_wq, &class->compact_work);
+}
+
+/*
+ * Compact every class of @pool, each one from its own work item so that
+ * classes are compacted in parallel, and return once all of them are done.
+ */
 unsigned long zs_compact(struct zs_pool *pool)
 {
 	int i;
@@ -1938,16 +2021,29 @@ unsigned long zs_compact(struct zs_pool *pool)
 			continue;
 		if (class->index != i)
 			continue;
-		__zs_compact(pool, class);
+		if (zs_can_compact(class))
+			queue_work(zs_compact_wq, &class->compact_work);
 	}
 
-	return pool->stats.pages_compacted;
+	for (i = zs_size_classes - 1; i >= 0; i--) {
+		class = pool->size_class[i];
+		if (!class)
+			continue;
+		if (class->index != i)
+			continue;
+		flush_work(&class->compact_work);
+	}
+
+	return atomic_long_read(&pool->pages_compacted);
 }
 EXPORT_SYMBOL_GPL(zs_compact);
 
 void zs_pool_stats(struct zs_pool *pool, struct zs_pool_stats *stats)
 {
-	memcpy(stats, &pool->stats, sizeof(struct zs_pool_stats));
+	stats->pages_compacted = atomic_long_read(&pool->pages_compacted);
+	stats->pages_moved = atomic_long_read(&pool->pages_moved);
+	stats->compact_time_ms = div_u64(atomic64_read(&pool->compact_time_ns),
+					 NSEC_PER_MSEC);
 }
 EXPORT_SYMBOL_GPL(zs_pool_stats);
 
@@ -1958,7 +2054,7 @@ static unsigned long zs_shrinker_scan(struct shrinker *shrinker,
 	struct zs_pool *pool = container_of(shrinker, struct zs_pool,
 			shrinker);
 
-	pages_freed = pool->stats.pages_compacted;
+	pages_freed = atomic_long_read(&pool->pages_compacted);
 	/*
 	 * Compact classes and calculate compaction delta.
 	 * Can run concurrently with a manually triggered
@@ -2558,7 +2654,7 @@ static int zs_migrate_page(struct address_space *mapping,
 	zs_stat_inc(class, PAGES_MOVED, 1);
 	spin_unlock(&class->lock);
 
-	pool->stats.pages_moved++;
+	atomic_long_inc(&pool->pages_moved);
 
 	return MIGRATEPAGE_MOBILE_SUCCESS;	/* failure is not an option! */
 }
@@ -2654,6 +2750,7 @@ struct zs_pool *zs_create_pool(char *name, gfp_t flags)
 			get_maxobj_per_zspage(size, pages_per_zspage) == 1)
 			class->huge = true;
 		spin_lock_init(&class->lock);
+		INIT_WORK(&class->compact_work, zs_compact_work);
 		pool->size_class[i] = class;
 
 		prev_class = class;
@@ -2710,6 +2807,7 @@ void zs_destroy_pool(struct zs_pool *pool)
 					class->size, fg);
 			}
 		}
+		cancel_work_sync(&class->compact_work);
 		kfree(class);
 	}
 
@@ -2727,6 +2825,13 @@ static int __init zs_init(void)
 	if (ret)
 		goto notifier_fail;
 
+	zs_compact_wq = alloc_workqueue("zs_compact",
+					WQ_UNBOUND | WQ_MEM_RECLAIM, 0);
+	if (!zs_compact_wq) {
+		ret = -ENOMEM;
+		goto notifier_fail;
+	}
+
 	BUILD_BUG_ON(sizeof(unsigned long) * 8 < (FREE_OBJ_IDX_BITS +
 		CLASS_IDX_BITS + FULLNESS_BITS + INUSE_BITS + ETC_BITS));
 
@@ -2747,6 +2852,7 @@ stat_fail:
 #ifdef CONFIG_ZPOOL
 	zpool_unregister_driver(&zs_zpool_driver);
 #endif
+	destroy_workqueue(zs_compact_wq);
 notifier_fail:
 	zs_unregister_cpu_notifier();
 
@@ -2761,6 +2867,7 @@ static void __exit zs_exit(void)
 	zs_unregister_cpu_notifier();
 
 	zs_stat_exit();
+	destroy_workqueue(zs_compact_wq);
 }
 
 module_init(zs_init);
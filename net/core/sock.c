@@ -2188,10 +2188,30 @@ ssize_t sock_no_sendpage(struct socket *sock, struct page *page, int offset, siz
 	iov.iov_len = size;
 	res = kernel_sendmsg(sock, &msg, &iov, 1, size);
 	kunmap(page);
+	sock_sendpage_account(res, false);
 	return res;
 }
 EXPORT_SYMBOL(sock_no_sendpage);
 
+struct sendpage_stat {
+	u64	zerocopy;
+	u64	copied;
+};
+
+/* bytes ->sendpage() queued by page reference and bytes it had to copy */
+static DEFINE_PER_CPU(struct sendpage_stat, sendpage_stat);
+
+void sock_sendpage_account(ssize_t bytes, bool zerocopy)
+{
+	if (bytes <= 0)
+		return;
+	if (zerocopy)
+		this_cpu_add(sendpage_stat.zerocopy, bytes);
+	else
+		this_cpu_add(sendpage_stat.copied, bytes);
+}
+EXPORT_SYMBOL(sock_sendpage_account);
+
 /*
  *	Default Socket Callbacks
  */
@@ -2923,16 +2943,53 @@ static const struct file_operations proto_seq_fops = {
 	.release	= seq_release_net,
 };
 
+static int sendpage_seq_show(struct seq_file *seq, void *v)
+{
+	u64 zerocopy = 0, copied = 0;
+	int cpu;
+
+	/* not per namespace: the counters are global */
+	for_each_possible_cpu(cpu) {
+		struct sendpage_stat *s = per_cpu_ptr(&sendpage_stat, cpu);
+
+		zerocopy += s->zerocopy;
+		copied += s->copied;
+	}
+	seq_printf(seq, "zerocopy_bytes %llu\ncopied_bytes %llu\n",
+		   zerocopy, copied);
+	return 0;
+}
+
+static int sendpage_seq_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, sendpage_seq_show, NULL);
+}
+
+static const struct file_operations sendpage_seq_fops = {
+	.owner		= THIS_MODULE,
+	.open		= sendpage_seq_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 static __net_init int proto_init_net(struct net *net)
 {
 	if (!proc_create("protocols", S_IRUGO, net->proc_net, &proto_seq_fops))
 		return -ENOMEM;
 
+	if (!proc_create("sendpage", S_IRUGO, net->proc_net,
+			 &sendpage_seq_fops)) {
+		remove_proc_entry("protocols", net->proc_net);
+		return -ENOMEM;
+	}
+
 	return 0;
 }
 
 static __net_exit void proto_exit_net(struct net *net)
 {
+	remove_proc_entry("sendpage", net->proc_net);
 	remove_proc_entry("protocols", net->proc_net);
 }
 
@@ -1034,6 +1034,7 @@ int tcp_sendpage(struct sock *sk, struct page *page, int offset,
 	lock_sock(sk);
 	res = do_tcp_sendpages(sk, page, offset, size, flags);
 	release_sock(sk);
+	sock_sendpage_account(res, true);
 	return res;
 }
 EXPORT_SYMBOL(tcp_sendpage);
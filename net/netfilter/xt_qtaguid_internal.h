@@ -11,8 +11,11 @@
 #define __XT_QTAGUID_INTERNAL_H__
 
 #include <linux/types.h>
+#include <linux/hashtable.h>
+#include <linux/percpu.h>
 #include <linux/rbtree.h>
 #include <linux/spinlock_types.h>
+#include <linux/string.h>
 #include <linux/workqueue.h>
 
 /* Iface handling */
@@ -197,6 +200,34 @@ static inline uint64_t dc_sum_packets(struct data_counters *counters,
 		+ counters->bpc[set][direction][IFS_PROTO_OTHER].packets;
 }
 
+/*
+ * The counters updated from the packet path are per cpu.
+ * Readers sum them up into a private struct data_counters.
+ */
+static inline void dc_fold(struct data_counters *res,
+			   struct data_counters __percpu *pcpu_counters)
+{
+	struct data_counters *dc;
+	int cpu, set, dir, proto;
+
+	memset(res, 0, sizeof(*res));
+	if (!pcpu_counters)
+		return;
+
+	for_each_possible_cpu(cpu) {
+		dc = per_cpu_ptr(pcpu_counters, cpu);
+		for (set = 0; set < IFS_MAX_COUNTER_SETS; set++)
+			for (dir = 0; dir < IFS_MAX_DIRECTIONS; dir++)
+				for (proto = 0; proto < IFS_MAX_PROTOS;
+				     proto++) {
+					res->bpc[set][dir][proto].bytes +=
+						dc->bpc[set][dir][proto].bytes;
+					res->bpc[set][dir][proto].packets +=
+						dc->bpc[set][dir][proto].packets;
+				}
+	}
+}
+
 
 /* Generic X based nodes used as a base for rb_tree ops */
 struct tag_node {
@@ -206,14 +237,19 @@ struct tag_node {
 
 struct tag_stat {
 	struct tag_node tn;
-	struct data_counters counters;
+	/* For lockless lookups from the packet path */
+	struct hlist_node hash_node;   /* in iface_stat.tag_stat_hash */
+	struct data_counters __percpu *counters;
 	/*
 	 * If this tag is acct_tag based, we need to count against the
 	 * matching parent uid_tag.
 	 */
-	struct data_counters *parent_counters;
+	struct data_counters __percpu *parent_counters;
+	struct rcu_head rcu;
 };
 
+#define TAG_STAT_HASH_BITS 6
+
 struct iface_stat {
 	struct list_head list;  /* in iface_stat_list */
 	char *ifname;
@@ -222,7 +258,7 @@ struct iface_stat {
 	struct net_device *net_dev;
 
 	struct byte_packet_counters totals_via_dev[IFS_MAX_DIRECTIONS];
-	struct data_counters totals_via_skb;
+	struct data_counters __percpu *totals_via_skb;
 	/*
 	 * We keep the last_known, because some devices reset their counters
 	 * just before NETDEV_UP, while some will reset just before
@@ -238,6 +274,8 @@ struct iface_stat {
 	struct proc_dir_entry *proc_ptr;
 
 	struct rb_root tag_stat_tree;
+	/* Same entries as tag_stat_tree, searched under RCU */
+	DECLARE_HASHTABLE(tag_stat_hash, TAG_STAT_HASH_BITS);
 	spinlock_t tag_stat_list_lock;
 };
 
@@ -255,6 +293,8 @@ struct iface_stat_work {
  */
 struct sock_tag {
 	struct rb_node sock_node;
+	struct hlist_node hash_node;  /* in sock_tag_hash, searched under RCU */
+	struct rcu_head rcu;
 	struct sock *sk;  /* Only used as a number, never dereferenced */
 	/* Used to associate with a given pid */
 	struct list_head list;   /* in proc_qtu_data.sock_tag_list */
@@ -298,6 +338,8 @@ struct qtaguid_event_counts {
 /* Track the set active_set for the given tag. */
 struct tag_counter_set {
 	struct tag_node tn;
+	struct hlist_node hash_node;  /* in tag_counter_set_hash */
+	struct rcu_head rcu;
 	int active_set;
 };
 
@@ -38,7 +38,6 @@ struct rmnet_logical_ep_conf_s {
 	uint8_t refcount;
 	uint8_t rmnet_mode;
 	uint8_t mux_id;
-	struct timespec flush_time;
 	struct net_device *egress_dev;
 };
 
@@ -61,6 +60,7 @@ struct rmnet_logical_ep_conf_s {
  * @tail_spacing: Guaranteed padding (bytes) when de-aggregating ingress frames
  * @agg_time: Wall clock time when aggregated frame was created
  * @agg_last: Last time the aggregation routing was invoked
+ * @agg_gap_avg: Moving average of the time (ns) between egress packets
  */
 struct rmnet_phys_ep_conf_s {
 	struct net_device *dev;
@@ -83,6 +83,7 @@ struct rmnet_phys_ep_conf_s {
 	uint8_t agg_count;
 	struct timespec agg_time;
 	struct timespec agg_last;
+	long agg_gap_avg;
 };
 
 int rmnet_config_init(void);
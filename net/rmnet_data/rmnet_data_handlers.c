@@ -45,11 +45,6 @@ module_param(dump_pkt_tx, uint, S_IRUGO | S_IWUSR);
 MODULE_PARM_DESC(dump_pkt_tx, "Dump packets exiting egress handler");
 #endif /* CONFIG_RMNET_DATA_DEBUG_PKT */
 
-/* Time in nano seconds. This number must be less that a second. */
-long gro_flush_time __read_mostly = 10000L;
-module_param(gro_flush_time, long, S_IRUGO | S_IWUSR);
-MODULE_PARM_DESC(gro_flush_time, "Flush GRO when spaced more than this");
-
 #define RMNET_DATA_IP_VERSION_4 0x40
 #define RMNET_DATA_IP_VERSION_6 0x60
 
@@ -194,8 +189,8 @@ static void rmnet_reset_mac_header(struct sk_buff *skb)
 /**
  * rmnet_check_skb_can_gro() - Check is skb can be passed through GRO handler
  *
- * Determines whether to pass the skb to the GRO handler napi_gro_receive() or
- * handle normally by passing to netif_receive_skb().
+ * Determines whether to pass the skb to the GRO handler of the VND through
+ * rmnet_vnd_gro_receive() or handle normally by passing to netif_receive_skb().
  *
  * Warning:
  * This assumes that only TCP packets can be coalesced by the GRO handler which
@@ -222,35 +217,6 @@ static int rmnet_check_skb_can_gro(struct sk_buff *skb)
 	return RMNET_DATA_GRO_RCV_FAIL;
 }
 
-/**
- * rmnet_optional_gro_flush() - Check if GRO handler needs to flush now
- *
- * Determines whether GRO handler needs to flush packets which it has
- * coalesced so far.
- *
- * Tuning this parameter will trade TCP slow start performance for GRO coalesce
- * ratio.
- */
-static void rmnet_optional_gro_flush(struct napi_struct *napi,
-				     struct rmnet_logical_ep_conf_s *ep)
-{
-	struct timespec curr_time, diff;
-
-	if (!gro_flush_time)
-		return;
-
-	if (unlikely(ep->flush_time.tv_sec == 0)) {
-		getnstimeofday(&ep->flush_time);
-	} else {
-		getnstimeofday(&(curr_time));
-		diff = timespec_sub(curr_time, ep->flush_time);
-		if ((diff.tv_sec > 0) || (diff.tv_nsec > gro_flush_time)) {
-			napi_gro_flush(napi, false);
-			getnstimeofday(&ep->flush_time);
-		}
-	}
-}
-
 /**
  * __rmnet_deliver_skb() - Deliver skb
  *
@@ -264,9 +230,6 @@ static void rmnet_optional_gro_flush(struct napi_struct *napi,
 static rx_handler_result_t __rmnet_deliver_skb(struct sk_buff *skb,
 					 struct rmnet_logical_ep_conf_s *ep)
 {
-	struct napi_struct *napi = NULL;
-	gro_result_t gro_res;
-
 	trace___rmnet_deliver_skb(skb);
 	switch (ep->rmnet_mode) {
 	case RMNET_EPMODE_NONE:
@@ -286,19 +249,10 @@ static rx_handler_result_t __rmnet_deliver_skb(struct sk_buff *skb,
 			skb->pkt_type = PACKET_HOST;
 			rmnet_reset_mac_header(skb);
 			if (rmnet_check_skb_can_gro(skb) &&
-			    (skb->dev->features & NETIF_F_GRO)) {
-				napi = get_current_napi_context();
-				if (napi != NULL) {
-					gro_res = napi_gro_receive(napi, skb);
-					trace_rmnet_gro_downlink(gro_res);
-					rmnet_optional_gro_flush(napi, ep);
-				} else {
-					WARN_ONCE(1, "current napi is NULL\n");
-					netif_receive_skb(skb);
-				}
-			} else {
+			    (skb->dev->features & NETIF_F_GRO))
+				rmnet_vnd_gro_receive(skb);
+			else
 				netif_receive_skb(skb);
-			}
 			return RX_HANDLER_CONSUMED;
 		}
 		return RX_HANDLER_PASS;
@@ -424,6 +378,8 @@ static rx_handler_result_t _rmnet_map_ingress_handler(struct sk_buff *skb,
 	skb_pull(skb, sizeof(struct rmnet_map_header_s));
 	skb_trim(skb, len);
 	__rmnet_data_set_skb_proto(skb);
+	skb_reset_network_header(skb);
+	rmnet_map_set_flow_hash(skb, mux_id);
 	return __rmnet_deliver_skb(skb, ep);
 }
 
@@ -32,6 +32,9 @@ enum rmnet_deagg_e {
 	RMNET_STATS_AGG_MAX
 };
 
+/* Aggregated frames by packet count: 1, 2-3, 4-7, ..., 128 and above */
+#define RMNET_STATS_AGG_HIST_MAX 8
+
 static DEFINE_SPINLOCK(rmnet_skb_free_lock);
 unsigned long int skb_free[RMNET_STATS_SKBFREE_MAX];
 module_param_array(skb_free, ulong, 0, S_IRUGO);
@@ -47,11 +50,20 @@ unsigned long int deagg_count[RMNET_STATS_AGG_MAX];
 module_param_array(deagg_count, ulong, 0, S_IRUGO);
 MODULE_PARM_DESC(deagg_count, "SKBs De-aggregated");
 
+/* Only ever updated by the CPU owning the entry, no lock needed */
+unsigned long int deagg_cpu_pkts[NR_CPUS];
+module_param_array(deagg_cpu_pkts, ulong, 0, S_IRUGO);
+MODULE_PARM_DESC(deagg_cpu_pkts, "SKBs De-aggregated per CPU");
+
 static DEFINE_SPINLOCK(rmnet_agg_count);
 unsigned long int agg_count[RMNET_STATS_AGG_MAX];
 module_param_array(agg_count, ulong, 0, S_IRUGO);
 MODULE_PARM_DESC(agg_count, "SKBs Aggregated");
 
+unsigned long int agg_hist[RMNET_STATS_AGG_HIST_MAX];
+module_param_array(agg_hist, ulong, 0, S_IRUGO);
+MODULE_PARM_DESC(agg_hist, "Aggregated frames by log2 of packet count");
+
 static DEFINE_SPINLOCK(rmnet_checksum_dl_stats);
 unsigned long int checksum_dl_stats[RMNET_MAP_CHECKSUM_ENUM_LENGTH];
 module_param_array(checksum_dl_stats, ulong, 0, S_IRUGO);
@@ -98,6 +110,8 @@ void rmnet_stats_agg_pkts(int aggcount)
 	spin_lock_irqsave(&rmnet_agg_count, flags);
 	agg_count[RMNET_STATS_AGG_BUFF]++;
 	agg_count[RMNET_STATS_AGG_PKT] += aggcount;
+	if (aggcount > 0)
+		agg_hist[min(fls(aggcount) - 1, RMNET_STATS_AGG_HIST_MAX - 1)]++;
 	spin_unlock_irqrestore(&rmnet_agg_count, flags);
 }
 
@@ -109,6 +123,8 @@ void rmnet_stats_deagg_pkts(int aggcount)
 	deagg_count[RMNET_STATS_AGG_BUFF]++;
 	deagg_count[RMNET_STATS_AGG_PKT] += aggcount;
 	spin_unlock_irqrestore(&rmnet_deagg_count, flags);
+
+	deagg_cpu_pkts[raw_smp_processor_id()] += aggcount;
 }
 
 void rmnet_stats_dl_checksum(unsigned int rc)
@@ -62,8 +62,13 @@ struct rmnet_vnd_private_s {
 	rwlock_t flow_map_lock;
 	struct list_head flow_head;
 	struct rmnet_map_flow_mapping_s root_flow;
+
+	struct napi_struct napi;
+	struct sk_buff_head gro_q;
 };
 
+#define RMNET_VND_NAPI_WEIGHT 64
+
 #define RMNET_VND_FC_QUEUED      0
 #define RMNET_VND_FC_NOT_ENABLED 1
 #define RMNET_VND_FC_KMALLOC_ERR 2
@@ -154,6 +159,82 @@ int rmnet_vnd_tx_fixup(struct sk_buff *skb, struct net_device *dev)
 	return RX_HANDLER_PASS;
 }
 
+/**
+ * rmnet_vnd_gro_receive() - Queue a packet for the GRO engine of the VND
+ * @skb:        Packet to queue. skb->dev is the virtual network device
+ *
+ * Deaggregated packets are queued to the NAPI context of the VND they belong
+ * to, so TCP flows of different VNDs are coalesced independently and batches
+ * are flushed only once the whole receive burst has been processed.
+ */
+void rmnet_vnd_gro_receive(struct sk_buff *skb)
+{
+	struct rmnet_vnd_private_s *dev_conf;
+
+	dev_conf = (struct rmnet_vnd_private_s *) netdev_priv(skb->dev);
+
+	if (unlikely(skb_queue_len(&dev_conf->gro_q) > netdev_max_backlog)) {
+		skb->dev->stats.rx_dropped++;
+		rmnet_kfree_skb(skb, RMNET_STATS_SKBFREE_VND_GRO_BACKLOG);
+		return;
+	}
+
+	skb_queue_tail(&dev_conf->gro_q, skb);
+	napi_schedule(&dev_conf->napi);
+}
+
+/**
+ * rmnet_vnd_gro_poll() - NAPI poll callback of the virtual network device
+ * @napi:       NAPI context of the virtual network device
+ * @budget:     Maximum number of packets to process
+ *
+ * Feeds the packets queued by rmnet_vnd_gro_receive() to the GRO engine.
+ * Coalesced packets are pushed up the stack once the queue is drained.
+ *
+ * Return:
+ *      - Number of packets processed
+ */
+static int rmnet_vnd_gro_poll(struct napi_struct *napi, int budget)
+{
+	struct rmnet_vnd_private_s *dev_conf;
+	struct sk_buff *skb;
+	int work_done = 0;
+
+	dev_conf = container_of(napi, struct rmnet_vnd_private_s, napi);
+
+	while (work_done < budget) {
+		skb = skb_dequeue(&dev_conf->gro_q);
+		if (!skb)
+			break;
+		trace_rmnet_gro_downlink(napi_gro_receive(napi, skb));
+		work_done++;
+	}
+
+	if (work_done < budget) {
+		napi_complete(napi);
+		/* Packets queued while the poll was running */
+		if (!skb_queue_empty(&dev_conf->gro_q))
+			napi_schedule(napi);
+	}
+
+	return work_done;
+}
+
+/**
+ * rmnet_vnd_gro_stop() - Stop the NAPI context of the virtual network device
+ * @dev:        Virtual network device
+ *
+ * Must be called before the device is unregistered.
+ */
+static void rmnet_vnd_gro_stop(struct net_device *dev)
+{
+	struct rmnet_vnd_private_s *dev_conf;
+
+	dev_conf = (struct rmnet_vnd_private_s *) netdev_priv(dev);
+	napi_disable(&dev_conf->napi);
+	skb_queue_purge(&dev_conf->gro_q);
+}
+
 /* ***************** Network Device Operations ****************************** */
 
 /**
@@ -500,6 +581,11 @@ static void rmnet_vnd_setup(struct net_device *dev)
 	/* Flow control */
 	rwlock_init(&dev_conf->flow_map_lock);
 	INIT_LIST_HEAD(&dev_conf->flow_head);
+
+	/* GRO */
+	skb_queue_head_init(&dev_conf->gro_q);
+	netif_napi_add(dev, &dev_conf->napi, rmnet_vnd_gro_poll,
+		       RMNET_VND_NAPI_WEIGHT);
 }
 
 /**
@@ -527,6 +613,7 @@ void rmnet_vnd_exit(void)
 	int i;
 	for (i = 0; i < RMNET_DATA_MAX_VND; i++)
 		if (rmnet_devices[i]) {
+			rmnet_vnd_gro_stop(rmnet_devices[i]);
 			unregister_netdev(rmnet_devices[i]);
 			free_netdev(rmnet_devices[i]);
 	}
@@ -629,6 +716,8 @@ int rmnet_vnd_create_dev(int id, struct net_device **new_device,
 		*new_device = dev;
 	}
 
+	napi_enable(&((struct rmnet_vnd_private_s *)netdev_priv(dev))->napi);
+
 	rmnet_vnd_disable_offload(dev);
 
 	LOGM("Registered device %s", dev->name);
@@ -674,6 +763,7 @@ int rmnet_vnd_free_dev(int id)
 	rtnl_unlock();
 
 	if (dev) {
+		rmnet_vnd_gro_stop(dev);
 		unregister_netdev(dev);
 		free_netdev(dev);
 		return 0;
@@ -28,7 +28,9 @@
 #include <linux/udp.h>
 #include <linux/tcp.h>
 #include <linux/in.h>
+#include <linux/jhash.h>
 #include <net/ip.h>
+#include <net/flow_keys.h>
 #include <net/checksum.h>
 #include <net/ip6_checksum.h>
 #include "rmnet_data_config.h"
@@ -49,6 +51,13 @@ long agg_bypass_time __read_mostly = 10000000L;
 module_param(agg_bypass_time, long, S_IRUGO | S_IWUSR);
 MODULE_PARM_DESC(agg_bypass_time, "Skip agg when apart spaced more than this");
 
+int agg_ack_prio __read_mostly;
+module_param(agg_ack_prio, int, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(agg_ack_prio, "Flush the agg buf as soon as a TCP ACK is in");
+
+/* Weight of the latest packet spacing in the moving average, as a shift */
+#define RMNET_MAP_AGG_GAP_SHIFT 3
+
 
 struct agg_work {
 	struct delayed_work work;
@@ -223,6 +232,61 @@ static void rmnet_map_flush_packet_queue(struct work_struct *work)
 	kfree(work);
 }
 
+/**
+ * rmnet_map_is_tcp_ack() - Checks if an egress packet is a pure TCP ACK
+ * @skb:        MAP encapsulated packet
+ * @config:     Physical endpoint configuration of the egress device
+ *
+ * Return:
+ *      - true if the packet carries a TCP segment with ACK set and no payload
+ *      - false otherwise
+ */
+static bool rmnet_map_is_tcp_ack(struct sk_buff *skb,
+				 struct rmnet_phys_ep_conf_s *config)
+{
+	unsigned int offset = sizeof(struct rmnet_map_header_s);
+	unsigned int ip_len, len;
+	struct tcphdr *tp;
+	uint8_t *ip;
+
+	if ((config->egress_data_format & RMNET_EGRESS_FORMAT_MAP_CKSUMV3) ||
+	    (config->egress_data_format & RMNET_EGRESS_FORMAT_MAP_CKSUMV4))
+		offset += sizeof(struct rmnet_map_ul_checksum_header_s);
+
+	if (skb_headlen(skb) < offset + sizeof(struct ipv6hdr) +
+			       sizeof(struct tcphdr))
+		return false;
+
+	ip = skb->data + offset;
+	switch (*ip & 0xF0) {
+	case 0x40:
+		if (((struct iphdr *)ip)->protocol != IPPROTO_TCP)
+			return false;
+		offset += ((struct iphdr *)ip)->ihl * 4;
+		ip_len = ntohs(((struct iphdr *)ip)->tot_len);
+		len = ((struct iphdr *)ip)->ihl * 4;
+		break;
+	case 0x60:
+		if (((struct ipv6hdr *)ip)->nexthdr != IPPROTO_TCP)
+			return false;
+		offset += sizeof(struct ipv6hdr);
+		ip_len = ntohs(((struct ipv6hdr *)ip)->payload_len);
+		len = 0;
+		break;
+	default:
+		return false;
+	}
+
+	if (skb_headlen(skb) < offset + sizeof(struct tcphdr))
+		return false;
+
+	tp = (struct tcphdr *)(skb->data + offset);
+	if (!tp->ack || tp->syn || tp->fin || tp->rst)
+		return false;
+
+	return ip_len == len + tp->doff * 4;
+}
+
 /**
  * rmnet_map_aggregate() - Software aggregates multiple packets.
  * @skb:        current packet being transmitted
@@ -231,6 +295,11 @@ static void rmnet_map_flush_packet_queue(struct work_struct *work)
  * Aggregates multiple SKBs into a single large SKB for transmission. MAP
  * protocol is used to separate the packets in the buffer. This funcion consumes
  * the argument SKB and should not be further processed by any other function.
+ *
+ * Aggregation adapts to the packet rate: a new buffer is only started once the
+ * average spacing between packets is below agg_bypass_time, so sparse
+ * interactive traffic is sent right away while bulk transfers fill the buffer
+ * up to its limits. With agg_ack_prio set, pure TCP ACKs are not held back.
  */
 void rmnet_map_aggregate(struct sk_buff *skb,
 			 struct rmnet_phys_ep_conf_s *config) {
@@ -240,6 +309,8 @@ void rmnet_map_aggregate(struct sk_buff *skb,
 	struct sk_buff *agg_skb;
 	struct timespec diff, last;
 	int size, rc, agg_count = 0;
+	bool ack = false;
+	long gap;
 
 
 	if (!skb || !config)
@@ -251,19 +322,30 @@ void rmnet_map_aggregate(struct sk_buff *skb,
 		return;
 	}
 
+	if (agg_ack_prio)
+		ack = rmnet_map_is_tcp_ack(skb, config);
+
 new_packet:
 	spin_lock_irqsave(&config->agg_lock, flags);
 
 	memcpy(&last, &(config->agg_last), sizeof(struct timespec));
 	getnstimeofday(&(config->agg_last));
 
+	diff = timespec_sub(config->agg_last, last);
+	if ((diff.tv_sec > 0) || (diff.tv_nsec > 2 * agg_bypass_time))
+		gap = 2 * agg_bypass_time;
+	else
+		gap = diff.tv_nsec;
+	config->agg_gap_avg += (gap - config->agg_gap_avg) >>
+			       RMNET_MAP_AGG_GAP_SHIFT;
+
 	if (!config->agg_skb) {
 		/* Check to see if we should agg first. If the traffic is very
-		 * sparse, don't aggregate. We will need to tune this later
+		 * sparse, or has not been dense for long enough, or the packet
+		 * is an ACK to be prioritized, don't aggregate.
 		 */
-		diff = timespec_sub(config->agg_last, last);
-
-		if ((diff.tv_sec > 0) || (diff.tv_nsec > agg_bypass_time)) {
+		if ((diff.tv_sec > 0) || (diff.tv_nsec > agg_bypass_time) ||
+		    (config->agg_gap_avg > agg_bypass_time) || ack) {
 			spin_unlock_irqrestore(&config->agg_lock, flags);
 			LOGL("delta t: %ld.%09lu\tcount: bypass", diff.tv_sec,
 			     diff.tv_nsec);
@@ -320,6 +402,21 @@ new_packet:
 	config->agg_count++;
 	rmnet_kfree_skb(skb, RMNET_STATS_SKBFREE_AGG_INTO_BUFF);
 
+	if (ack) {
+		/* The pending flush work finds the buffer empty and goes idle */
+		rmnet_stats_agg_pkts(config->agg_count);
+		agg_skb = config->agg_skb;
+		agg_count = config->agg_count;
+		config->agg_skb = 0;
+		config->agg_count = 0;
+		memset(&(config->agg_time), 0, sizeof(struct timespec));
+		spin_unlock_irqrestore(&config->agg_lock, flags);
+		trace_rmnet_map_flush_packet_queue(agg_skb, agg_count);
+		rc = dev_queue_xmit(agg_skb);
+		rmnet_stats_queue_xmit(rc, RMNET_STATS_QUEUE_XMIT_AGG_ACK_PRIO);
+		return;
+	}
+
 schedule:
 	if (config->agg_state != RMNET_MAP_TXFER_SCHEDULED) {
 		work = kmalloc(sizeof(*work), GFP_ATOMIC);
@@ -754,3 +851,23 @@ sw_checksum:
 	ul_header->udp_ip4_ind = 0;
 	return ret;
 }
+
+/**
+ * rmnet_map_set_flow_hash() - Set the flow hash of a deaggregated packet
+ * @skb:        Packet with its network header set, MAP header removed
+ * @mux_id:     MAP mux id the packet was received on
+ *
+ * Hashes the packet on its 5-tuple and mux id so that RPS on the rmnet_data
+ * device spreads flows across the CPUs set in its rps_cpus, instead of
+ * processing every packet on the CPU that deaggregated it.
+ */
+void rmnet_map_set_flow_hash(struct sk_buff *skb, uint8_t mux_id)
+{
+	struct flow_keys keys;
+
+	if (!skb_flow_dissect(skb, &keys))
+		return;
+
+	skb_set_hash(skb, jhash_2words(flow_hash_from_keys(&keys), mux_id, 0),
+		     keys.ports ? PKT_HASH_TYPE_L4 : PKT_HASH_TYPE_L3);
+}
@@ -184,6 +184,58 @@ static struct inode *pfk_bio_get_inode(const struct bio *bio)
 	return bio->bi_io_vec->bv_page->mapping->host;
 }
 
+/**
+ * pfk_is_f2fs_inode() - inode of a f2fs file encrypted through ICE
+ * @inode: inode pointer, can be NULL
+ *
+ * Such files do not go through eCryptfs: f2fs keeps the key in the inode
+ * and the data unit number is the page index within the file.
+ */
+static inline bool pfk_is_f2fs_inode(struct inode *inode)
+{
+#ifdef CONFIG_F2FS_FS_ICE_ENCRYPTION
+	return inode && f2fs_ice_inode(inode);
+#else
+	return false;
+#endif
+}
+
+/**
+ * pfk_bio_dun() - get the data unit number of a f2fs bio
+ * @bio: Pointer to BIO structure.
+ *
+ * Return: the index of the first page of the bio within its file.
+ */
+static u64 pfk_bio_dun(const struct bio *bio)
+{
+	struct bio_vec bv = bio_iter_iovec(bio, bio->bi_iter);
+
+	return bv.bv_page->index;
+}
+
+static int pfk_f2fs_bio_to_key(struct inode *inode, unsigned char const **key,
+		size_t *key_size, unsigned char const **salt, size_t *salt_size)
+{
+#ifdef CONFIG_F2FS_FS_ICE_ENCRYPTION
+	const unsigned char *raw_key = f2fs_ice_get_key(inode);
+
+	/* the xts key is the data key followed by the tweak key */
+	if (!raw_key) {
+		pr_debug("no key for f2fs file %s\n", inode_to_filename(inode));
+		return -ENOKEY;
+	}
+
+	*key = raw_key;
+	*key_size = PFK_SUPPORTED_KEY_SIZE;
+	*salt = raw_key + PFK_SUPPORTED_KEY_SIZE;
+	*salt_size = PFK_SUPPORTED_SALT_SIZE;
+
+	return 0;
+#else
+	return -EINVAL;
+#endif
+}
+
 /**
  * pfk_get_ecryptfs_data() - retrieves ecryptfs data stored inside node
  * @inode: inode
@@ -323,6 +375,10 @@ static int pfk_bio_to_key(const struct bio *bio, unsigned char const **key,
 		return -EINVAL;
 	}
 
+	if (pfk_is_f2fs_inode(inode))
+		return pfk_f2fs_bio_to_key(inode, key, key_size, salt,
+				salt_size);
+
 	ecryptfs_data = pfk_get_ecryptfs_data(inode);
 	if (!ecryptfs_data) {
 		*is_pfe = false;
@@ -436,16 +492,20 @@ int pfk_load_key_start(const struct bio *bio,
 		return -EINVAL;
 	}
 
-	ecryptfs_data = pfk_get_ecryptfs_data(inode);
-	if (!ecryptfs_data) {
-		*is_pfe = false;
-		return -EPERM;
-	}
+	if (pfk_is_f2fs_inode(inode)) {
+		algo_mode = ICE_CRYPTO_ALGO_MODE_AES_XTS;
+	} else {
+		ecryptfs_data = pfk_get_ecryptfs_data(inode);
+		if (!ecryptfs_data) {
+			*is_pfe = false;
+			return -EPERM;
+		}
 
-	ret = pfk_parse_cipher(ecryptfs_data, &algo_mode);
-	if (ret != 0) {
-		pr_err("not supported cipher\n");
-		return ret;
+		ret = pfk_parse_cipher(ecryptfs_data, &algo_mode);
+		if (ret != 0) {
+			pr_err("not supported cipher\n");
+			return ret;
+		}
 	}
 
 	ret = pfk_key_size_to_key_type(key_size, &key_size_type);
@@ -468,6 +528,15 @@ int pfk_load_key_start(const struct bio *bio,
 	ice_setting->key_mode = ICE_CRYPTO_USE_LUT_SW_KEY;
 	ice_setting->key_index = key_index;
 
+	/*
+	 * f2fs moves encrypted blocks around on cleaning, so its data unit
+	 * number must not depend on the LBA.
+	 */
+	if (pfk_is_f2fs_inode(inode)) {
+		ice_setting->dun_valid = true;
+		ice_setting->dun = pfk_bio_dun(bio);
+	}
+
 	return 0;
 }
 
@@ -563,6 +632,7 @@ bool pfk_allow_merge_bio(struct bio *bio1, struct bio *bio2)
 	int ret;
 	void *ecryptfs_data1 = NULL;
 	void *ecryptfs_data2 = NULL;
+	struct inode *inode1, *inode2;
 	pgoff_t offset1, offset2;
 	bool res = false;
 
@@ -573,6 +643,21 @@ bool pfk_allow_merge_bio(struct bio *bio1, struct bio *bio2)
 	if (!bio1 || !bio2)
 		return false;
 
+	/*
+	 * f2fs ICE files: same file, and the data unit numbers must be as
+	 * far apart as the sectors, in units of 4KB pages.
+	 */
+	inode1 = pfk_bio_get_inode(bio1);
+	inode2 = pfk_bio_get_inode(bio2);
+	if (pfk_is_f2fs_inode(inode1) || pfk_is_f2fs_inode(inode2)) {
+		s64 sectors = (s64)(bio2->bi_iter.bi_sector -
+				bio1->bi_iter.bi_sector);
+		s64 pages = (s64)(pfk_bio_dun(bio2) - pfk_bio_dun(bio1));
+
+		return inode1 == inode2 &&
+			sectors == pages << (PAGE_SHIFT - 9);
+	}
+
 	ecryptfs_data1 = pfk_get_ecryptfs_data(pfk_bio_get_inode(bio1));
 	ecryptfs_data2 = pfk_get_ecryptfs_data(pfk_bio_get_inode(bio2));
 
@@ -625,6 +710,17 @@ end:
 	return res;
 }
 
+/**
+ * pfk_ice_available() - PFK can load per-file keys into ICE
+ *
+ * Used by file systems which hand their keys to ICE through PFK to
+ * decide between ICE and software encryption.
+ */
+bool pfk_ice_available(void)
+{
+	return pfk_is_ready();
+}
+
 /**
  * pfk_open_cb() - callback function for file open event
  * @inode: file inode
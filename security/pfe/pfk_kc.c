@@ -21,6 +21,8 @@
  * cache eviction are simple, linear and based on last usage timestamp, i.e
  * the node that will be evicted is the one with the oldest timestamp.
  * Empty entries always have the oldest timestamp.
+ * An entry stays locked for as long as at least one request is using its
+ * key, so that a key used by requests in flight is never evicted.
  */
 
 #include <linux/mutex.h>
@@ -31,6 +33,7 @@
 #include <linux/jiffies.h>
 #include <linux/slab.h>
 #include <linux/printk.h>
+#include <linux/debugfs.h>
 
 #include "pfk_kc.h"
 #include "pfk_ice.h"
@@ -55,6 +58,12 @@ static DEFINE_SPINLOCK(kc_lock);
 static unsigned long flags;
 static bool kc_ready;
 
+/* cache statistics, updated under kc_lock */
+static u64 kc_hits;
+static u64 kc_misses;
+static u64 kc_evictions;
+static struct dentry *kc_debugfs;
+
 enum pfk_kc_entry_state {
 	/* Entry is free */
 	FREE,
@@ -105,6 +114,9 @@ struct kc_entry {
 
 	 enum pfk_kc_entry_state state;
 	 int scm_error;
+
+	 /* number of requests using the key while in ACTIVE_ICE_LOADED */
+	 unsigned int users;
 };
 
 static struct kc_entry kc_table[PFK_KC_TABLE_SIZE];
@@ -429,6 +441,14 @@ int pfk_kc_init(void)
 	kc_ready = true;
 	kc_spin_unlock();
 
+	kc_debugfs = debugfs_create_dir("pfk_kc", NULL);
+	if (!IS_ERR_OR_NULL(kc_debugfs)) {
+		debugfs_create_u64("hits", S_IRUGO, kc_debugfs, &kc_hits);
+		debugfs_create_u64("misses", S_IRUGO, kc_debugfs, &kc_misses);
+		debugfs_create_u64("evictions", S_IRUGO, kc_debugfs,
+				   &kc_evictions);
+	}
+
 	return 0;
 }
 
@@ -442,6 +462,9 @@ int pfk_kc_deinit(void)
 	int res = pfk_kc_clear();
 	kc_ready = false;
 
+	debugfs_remove_recursive(kc_debugfs);
+	kc_debugfs = NULL;
+
 	return res;
 }
 
@@ -521,11 +544,16 @@ int pfk_kc_load_key_start(const unsigned char *key, size_t key_size,
 	switch (entry->state) {
 	case (INACTIVE):
 		if (entry_exists) {
+			kc_hits++;
 			kc_update_timestamp(entry);
 			entry->state = ACTIVE_ICE_LOADED;
+			entry->users = 1;
 			break;
 		}
+		kc_evictions++;
+		/* fall through */
 	case (FREE):
+		kc_misses++;
 		ret = kc_update_entry(entry, key, key_size, salt, salt_size);
 		if (ret) {
 			entry->state = SCM_ERROR;
@@ -533,6 +561,7 @@ int pfk_kc_load_key_start(const unsigned char *key, size_t key_size,
 			pr_err("%s: key load error (%d)\n", __func__, ret);
 		} else {
 			entry->state = ACTIVE_ICE_LOADED;
+			entry->users = 1;
 			kc_update_timestamp(entry);
 		}
 		break;
@@ -541,6 +570,8 @@ int pfk_kc_load_key_start(const unsigned char *key, size_t key_size,
 		ret = -EAGAIN;
 		break;
 	case (ACTIVE_ICE_LOADED):
+		kc_hits++;
+		entry->users++;
 		kc_update_timestamp(entry);
 		break;
 	case(SCM_ERROR):
@@ -596,6 +627,14 @@ void pfk_kc_load_key_end(const unsigned char *key, size_t key_size,
 		pr_err("internal error, there should an entry to unlock\n");
 		return;
 	}
+
+	/* other requests in flight still use the key */
+	if (entry->users > 1) {
+		entry->users--;
+		kc_spin_unlock();
+		return;
+	}
+	entry->users = 0;
 	entry->state = INACTIVE;
 
 	/* wake-up invalidation if it's waiting for the entry to be released */
@@ -35,6 +35,7 @@
 #include "classmap.h"
 
 #define AVC_CACHE_SLOTS			512
+#define AVC_CACHE_MAX_SLOTS		32768
 #define AVC_DEF_CACHE_THRESHOLD		512
 #define AVC_CACHE_RECLAIM		16
 
@@ -69,13 +70,29 @@ struct avc_xperms_node {
 };
 
 struct avc_cache {
-	struct hlist_head	slots[AVC_CACHE_SLOTS]; /* head for avc_node->list */
-	spinlock_t		slots_lock[AVC_CACHE_SLOTS]; /* lock for writes */
+	struct hlist_head	*slots; /* head for avc_node->list */
+	spinlock_t		*slots_lock; /* lock for writes */
+	unsigned int		nr_slots;	/* power of two, fixed at boot */
 	atomic_t		lru_hint;	/* LRU hint for reclaim scan */
 	atomic_t		active_nodes;
+	atomic_t		generation;	/* bumped when decisions change */
 	u32			latest_notif;	/* latest revocation notification */
 };
 
+/*
+ * Per-cpu copy of the last binder decision. Binder checks are made from
+ * process context only, so disabling preemption is enough to keep the
+ * entry consistent. The entry is only valid while its generation matches
+ * avc_cache.generation.
+ */
+struct avc_last_decision {
+	u32			ssid;
+	u32			tsid;
+	u16			tclass;
+	int			generation;
+	struct av_decision	avd;
+};
+
 struct avc_callback_node {
 	int (*callback) (u32 event);
 	u32 events;
@@ -90,6 +107,7 @@ DEFINE_PER_CPU(struct avc_cache_stats, avc_cache_stats) = { 0 };
 #endif
 
 static struct avc_cache avc_cache;
+static DEFINE_PER_CPU(struct avc_last_decision, avc_last_decision);
 static struct avc_callback_node *avc_callbacks;
 static struct kmem_cache *avc_node_cachep;
 static struct kmem_cache *avc_xperms_data_cachep;
@@ -98,9 +116,24 @@ static struct kmem_cache *avc_xperms_cachep;
 
 static inline int avc_hash(u32 ssid, u32 tsid, u16 tclass)
 {
-	return (ssid ^ (tsid<<2) ^ (tclass<<4)) & (AVC_CACHE_SLOTS - 1);
+	return (ssid ^ (tsid<<2) ^ (tclass<<4)) & (avc_cache.nr_slots - 1);
 }
 
+/*
+ * "avc_cache_threshold=" sets the initial number of cached decisions. The
+ * hash table is sized to match at boot and does not grow if the threshold
+ * is raised later through selinuxfs.
+ */
+static int __init avc_cache_threshold_setup(char *str)
+{
+	unsigned long val;
+
+	if (!kstrtoul(str, 0, &val) && val && val <= UINT_MAX)
+		avc_cache_threshold = val;
+	return 1;
+}
+__setup("avc_cache_threshold=", avc_cache_threshold_setup);
+
 /**
  * avc_dump_av - Display an access vector in human-readable form.
  * @tclass: target security class
@@ -177,12 +210,24 @@ void __init avc_init(void)
 {
 	int i;
 
-	for (i = 0; i < AVC_CACHE_SLOTS; i++) {
+	avc_cache.nr_slots = clamp_t(unsigned int,
+				     roundup_pow_of_two(avc_cache_threshold),
+				     AVC_CACHE_SLOTS, AVC_CACHE_MAX_SLOTS);
+	avc_cache.slots = kcalloc(avc_cache.nr_slots,
+				  sizeof(*avc_cache.slots), GFP_KERNEL);
+	avc_cache.slots_lock = kcalloc(avc_cache.nr_slots,
+				       sizeof(*avc_cache.slots_lock),
+				       GFP_KERNEL);
+	if (!avc_cache.slots || !avc_cache.slots_lock)
+		panic("SELinux: cannot allocate the AVC hash table\n");
+
+	for (i = 0; i < avc_cache.nr_slots; i++) {
 		INIT_HLIST_HEAD(&avc_cache.slots[i]);
 		spin_lock_init(&avc_cache.slots_lock[i]);
 	}
 	atomic_set(&avc_cache.active_nodes, 0);
 	atomic_set(&avc_cache.lru_hint, 0);
+	atomic_set(&avc_cache.generation, 1);
 
 	avc_node_cachep = kmem_cache_create("avc_node", sizeof(struct avc_node),
 					0, SLAB_PANIC, NULL);
@@ -210,7 +255,7 @@ int avc_get_hash_stats(char *page)
 
 	slots_used = 0;
 	max_chain_len = 0;
-	for (i = 0; i < AVC_CACHE_SLOTS; i++) {
+	for (i = 0; i < avc_cache.nr_slots; i++) {
 		head = &avc_cache.slots[i];
 		if (!hlist_empty(head)) {
 			slots_used++;
@@ -227,7 +272,7 @@ int avc_get_hash_stats(char *page)
 	return scnprintf(page, PAGE_SIZE, "entries: %d\nbuckets used: %d/%d\n"
 			 "longest chain: %d\n",
 			 atomic_read(&avc_cache.active_nodes),
-			 slots_used, AVC_CACHE_SLOTS, max_chain_len);
+			 slots_used, avc_cache.nr_slots, max_chain_len);
 }
 
 /*
@@ -519,8 +564,9 @@ static inline int avc_reclaim_node(void)
 	struct hlist_head *head;
 	spinlock_t *lock;
 
-	for (try = 0, ecx = 0; try < AVC_CACHE_SLOTS; try++) {
-		hvalue = atomic_inc_return(&avc_cache.lru_hint) & (AVC_CACHE_SLOTS - 1);
+	for (try = 0, ecx = 0; try < avc_cache.nr_slots; try++) {
+		hvalue = atomic_inc_return(&avc_cache.lru_hint) &
+			 (avc_cache.nr_slots - 1);
 		head = &avc_cache.slots[hvalue];
 		lock = &avc_cache.slots_lock[hvalue];
 
@@ -545,6 +591,29 @@ out:
 	return ecx;
 }
 
+/*
+ * Make room for a node just added to @head by dropping the oldest other
+ * node of the same chain. Called with the chain's lock held. Returns 0 if
+ * the chain holds nothing else, in which case the caller falls back to
+ * avc_reclaim_node() once the lock is dropped.
+ */
+static inline int avc_reclaim_bucket(struct hlist_head *head,
+				     struct avc_node *keep)
+{
+	struct avc_node *node, *victim = NULL;
+
+	hlist_for_each_entry(node, head, list) {
+		if (node != keep)
+			victim = node;
+	}
+	if (!victim)
+		return 0;
+
+	avc_node_delete(victim);
+	avc_cache_stats_incr(reclaims);
+	return 1;
+}
+
 static struct avc_node *avc_alloc_node(void)
 {
 	struct avc_node *node;
@@ -556,13 +625,51 @@ static struct avc_node *avc_alloc_node(void)
 	INIT_HLIST_NODE(&node->list);
 	avc_cache_stats_incr(allocations);
 
-	if (atomic_inc_return(&avc_cache.active_nodes) > avc_cache_threshold)
-		avc_reclaim_node();
+	atomic_inc(&avc_cache.active_nodes);
 
 out:
 	return node;
 }
 
+/*
+ * Invalidate the per-cpu last decisions after cached decisions changed.
+ */
+static inline void avc_bump_generation(void)
+{
+	smp_mb__before_atomic();
+	atomic_inc(&avc_cache.generation);
+}
+
+static inline bool avc_last_decision_lookup(u32 ssid, u32 tsid, u16 tclass,
+					    struct av_decision *avd)
+{
+	struct avc_last_decision *ld = &get_cpu_var(avc_last_decision);
+	bool hit = false;
+
+	if (ld->generation == atomic_read(&avc_cache.generation) &&
+	    ld->ssid == ssid && ld->tsid == tsid && ld->tclass == tclass) {
+		memcpy(avd, &ld->avd, sizeof(*avd));
+		hit = true;
+	}
+	put_cpu_var(avc_last_decision);
+
+	return hit;
+}
+
+static inline void avc_last_decision_store(u32 ssid, u32 tsid, u16 tclass,
+					   struct av_decision *avd,
+					   int generation)
+{
+	struct avc_last_decision *ld = &get_cpu_var(avc_last_decision);
+
+	ld->ssid = ssid;
+	ld->tsid = tsid;
+	ld->tclass = tclass;
+	memcpy(&ld->avd, avd, sizeof(*avd));
+	ld->generation = generation;
+	put_cpu_var(avc_last_decision);
+}
+
 static void avc_node_populate(struct avc_node *node, u32 ssid, u32 tsid, u16 tclass, struct av_decision *avd)
 {
 	node->ae.ssid = ssid;
@@ -664,6 +771,7 @@ static struct avc_node *avc_insert(u32 ssid, u32 tsid, u16 tclass,
 	struct avc_node *pos, *node = NULL;
 	int hvalue;
 	unsigned long flag;
+	bool reclaim = false;
 
 	if (avc_latest_notif_update(avd->seqno, 1))
 		goto out;
@@ -694,8 +802,12 @@ static struct avc_node *avc_insert(u32 ssid, u32 tsid, u16 tclass,
 			}
 		}
 		hlist_add_head_rcu(&node->list, head);
+		if (atomic_read(&avc_cache.active_nodes) > avc_cache_threshold)
+			reclaim = !avc_reclaim_bucket(head, node);
 found:
 		spin_unlock_irqrestore(lock, flag);
+		if (reclaim)
+			avc_reclaim_node();
 	}
 out:
 	return node;
@@ -903,6 +1015,7 @@ static int avc_update_node(u32 event, u32 perms, u8 driver, u8 xperm, u32 ssid,
 		break;
 	}
 	avc_node_replace(node, orig);
+	avc_bump_generation();
 out_unlock:
 	spin_unlock_irqrestore(lock, flag);
 out:
@@ -920,7 +1033,7 @@ static void avc_flush(void)
 	unsigned long flag;
 	int i;
 
-	for (i = 0; i < AVC_CACHE_SLOTS; i++) {
+	for (i = 0; i < avc_cache.nr_slots; i++) {
 		head = &avc_cache.slots[i];
 		lock = &avc_cache.slots_lock[i];
 
@@ -935,6 +1048,7 @@ static void avc_flush(void)
 		rcu_read_unlock();
 		spin_unlock_irqrestore(lock, flag);
 	}
+	avc_bump_generation();
 }
 
 /**
@@ -1108,17 +1222,37 @@ inline int avc_has_perm_noaudit(u32 ssid, u32 tsid,
 	struct avc_xperms_node xp_node;
 	int rc = 0;
 	u32 denied;
+	int generation = 0;
 
 	BUG_ON(!requested);
 
+	/*
+	 * Binder transactions repeat the same few checks back to back, so
+	 * try the per-cpu copy of the last binder decision first.
+	 */
+	if (tclass == SECCLASS_BINDER) {
+		if (avc_last_decision_lookup(ssid, tsid, tclass, avd)) {
+			avc_cache_stats_incr(lookups);
+			rcu_read_lock();
+			goto check;
+		}
+		generation = atomic_read(&avc_cache.generation);
+		smp_rmb();
+	}
+
 	rcu_read_lock();
 
 	node = avc_lookup(ssid, tsid, tclass);
-	if (unlikely(!node))
+	if (unlikely(!node)) {
 		node = avc_compute_av(ssid, tsid, tclass, avd, &xp_node);
-	else
+	} else {
 		memcpy(avd, &node->ae.avd, sizeof(*avd));
+		if (generation)
+			avc_last_decision_store(ssid, tsid, tclass, avd,
+						generation);
+	}
 
+check:
 	denied = requested & ~(avd->allowed);
 	if (unlikely(denied))
 		rc = avc_denied(ssid, tsid, tclass, requested, 0, 0, flags, avd);
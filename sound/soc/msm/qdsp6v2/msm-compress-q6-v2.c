@@ -67,6 +67,9 @@
 #define COMPR_PLAYBACK_MAX_NUM_FRAGMENTS (16 * 4)
 #define COMPR_PLAYBACK_DSP_FRAGMENT_SIZE (32 * 1024)
 
+/* Deep buffer mode, up to COMPR_PLAYBACK_MAX_NUM_FRAGMENTS dsp fragments */
+#define COMPR_DEEP_BUFFER_MAX_FRAGMENT_SIZE (512 * 1024)
+
 #define COMPRESSED_LR_VOL_MAX_STEPS	0x2000
 const DECLARE_TLV_DB_LINEAR(msm_compr_vol_gain, 0,
 				COMPRESSED_LR_VOL_MAX_STEPS);
@@ -104,6 +107,7 @@ struct msm_compr_pdata {
 	uint32_t volume[MSM_FRONTEND_DAI_MAX][2]; /* For both L & R */
 	struct msm_compr_audio_effects *audio_effects[MSM_FRONTEND_DAI_MAX];
 	bool use_dsp_gapless_mode;
+	bool use_deep_buffer;
 	bool use_legacy_api; /* indicates use older asm apis*/
 	struct msm_compr_dec_params *dec_params[MSM_FRONTEND_DAI_MAX];
 	struct msm_compr_ch_map *ch_map[MSM_FRONTEND_DAI_MAX];
@@ -178,6 +182,8 @@ struct msm_compr_audio {
 	uint32_t dsp_fragments;
 	uint32_t dsp_fragment_ratio;
 	uint32_t dsp_fragments_sent;
+	uint32_t dsp_write_size; /* max bytes per DSP write */
+	bool deep_buffer;
 
 	spinlock_t lock;
 };
@@ -335,8 +341,8 @@ static int msm_compr_send_buffer(struct msm_compr_audio *prtd)
 
 	if (bytes_available < prtd->dsp_fragment_size)
 		buffer_length = bytes_available;
-	else if (bytes_available > prtd->cstream->runtime->fragment_size)
-		buffer_length = prtd->cstream->runtime->fragment_size;
+	else if (bytes_available > prtd->dsp_write_size)
+		buffer_length = prtd->dsp_write_size;
 	else {
 		/*
 		 * do_div divides in place and bytes_available is modified
@@ -751,7 +757,8 @@ static void populate_codec_list(struct msm_compr_audio *prtd)
 	prtd->compr_cap.direction = SND_COMPRESS_PLAYBACK;
 	prtd->compr_cap.min_fragment_size =
 			COMPR_PLAYBACK_MIN_FRAGMENT_SIZE;
-	prtd->compr_cap.max_fragment_size =
+	prtd->compr_cap.max_fragment_size = prtd->deep_buffer ?
+			COMPR_DEEP_BUFFER_MAX_FRAGMENT_SIZE :
 			COMPR_PLAYBACK_MAX_FRAGMENT_SIZE;
 	prtd->compr_cap.min_fragments =
 			COMPR_PLAYBACK_MIN_NUM_FRAGMENTS;
@@ -1211,6 +1218,21 @@ static int msm_compr_configure_dsp_for_playback
 	prtd->buffer_paddr = ac->port[dir].buf[0].phys;
 	prtd->buffer_size  = runtime->fragments * runtime->fragment_size;
 
+	/*
+	 * The DSP acks each write once it has consumed all of it, and has
+	 * no watermark events for compressed push mode. In deep buffer mode
+	 * hand it half of the buffer per write, so that the ack of one half
+	 * is the low watermark and the AP wakes twice per buffer instead of
+	 * once per fragment.
+	 */
+	prtd->dsp_write_size = runtime->fragment_size;
+	if (prtd->deep_buffer)
+		prtd->dsp_write_size = max_t(uint32_t, runtime->fragment_size,
+				rounddown(prtd->buffer_size / 2,
+					  prtd->dsp_fragment_size));
+	pr_debug("%s: dsp write size %d, deep buffer %d\n", __func__,
+		 prtd->dsp_write_size, prtd->deep_buffer);
+
 	ret = msm_compr_send_media_format_block(cstream, ac->stream_id, false);
 	if (ret < 0) {
 		pr_err("%s, failed to send media format block\n", __func__);
@@ -1383,6 +1405,8 @@ static int msm_compr_playback_open(struct snd_compr_stream *cstream)
 
 	pr_debug("%s: gapless mode %d", __func__, pdata->use_dsp_gapless_mode);
 
+	prtd->deep_buffer = pdata->use_deep_buffer;
+
 	spin_lock_init(&prtd->lock);
 
 	atomic_set(&prtd->eos, 0);
@@ -3374,11 +3398,40 @@ static int msm_compr_gapless_get(struct snd_kcontrol *kcontrol,
 	return 0;
 }
 
+static int msm_compr_deep_buffer_put(struct snd_kcontrol *kcontrol,
+				struct snd_ctl_elem_value *ucontrol)
+{
+	struct snd_soc_component *comp = snd_kcontrol_chip(kcontrol);
+	struct msm_compr_pdata *pdata = (struct msm_compr_pdata *)
+		snd_soc_component_get_drvdata(comp);
+	pdata->use_deep_buffer = ucontrol->value.integer.value[0];
+	pr_debug("%s: value: %ld\n", __func__,
+		ucontrol->value.integer.value[0]);
+
+	return 0;
+}
+
+static int msm_compr_deep_buffer_get(struct snd_kcontrol *kcontrol,
+				struct snd_ctl_elem_value *ucontrol)
+{
+	struct snd_soc_component *comp = snd_kcontrol_chip(kcontrol);
+	struct msm_compr_pdata *pdata =
+		snd_soc_component_get_drvdata(comp);
+	pr_debug("%s: deep buffer %d\n", __func__, pdata->use_deep_buffer);
+	ucontrol->value.integer.value[0] = pdata->use_deep_buffer;
+
+	return 0;
+}
+
 static const struct snd_kcontrol_new msm_compr_gapless_controls[] = {
 	SOC_SINGLE_EXT("Compress Gapless Playback",
 			0, 0, 1, 0,
 			msm_compr_gapless_get,
 			msm_compr_gapless_put),
+	SOC_SINGLE_EXT("Compress Deep Buffer Playback",
+			0, 0, 1, 0,
+			msm_compr_deep_buffer_get,
+			msm_compr_deep_buffer_put),
 };
 
 static int msm_compr_probe(struct snd_soc_platform *platform)
@@ -729,6 +729,83 @@ static int msm_pcm_add_chmap_control(struct snd_soc_pcm_runtime *rtd)
 	return 0;
 }
 
+static int msm_pcm_position_ctl_info(struct snd_kcontrol *kcontrol,
+				     struct snd_ctl_elem_info *uinfo)
+{
+	uinfo->type = SNDRV_CTL_ELEM_TYPE_INTEGER64;
+	uinfo->count = 2;
+	uinfo->value.integer64.min = 0;
+	uinfo->value.integer64.max = LLONG_MAX;
+	return 0;
+}
+
+/*
+ * Reports the DSP side of the shared position buffer: the byte offset the
+ * DSP is reading from or writing to and the ADSP wall clock in us at which
+ * it got there. It is read straight from shared memory, without an APR
+ * round trip, so MMAP clients can poll it as often as they need.
+ */
+static int msm_pcm_position_ctl_get(struct snd_kcontrol *kcontrol,
+				    struct snd_ctl_elem_value *ucontrol)
+{
+	struct snd_pcm_substream *substream = snd_kcontrol_chip(kcontrol);
+	uint32_t index, wall_clk_msw, wall_clk_lsw;
+	struct msm_audio *prtd;
+	int ret;
+
+	memset(ucontrol->value.integer64.value, 0,
+		2 * sizeof(ucontrol->value.integer64.value[0]));
+	if (!substream->runtime)
+		return 0;
+
+	prtd = substream->runtime->private_data;
+	if (!prtd || !prtd->enabled)
+		return 0;
+
+	ret = q6asm_get_shared_pos(prtd->audio_client, &index,
+				   &wall_clk_msw, &wall_clk_lsw);
+	if (ret)
+		return ret;
+
+	ucontrol->value.integer64.value[0] = index;
+	ucontrol->value.integer64.value[1] =
+		((u64)wall_clk_msw << 32) | wall_clk_lsw;
+	return 0;
+}
+
+static int msm_pcm_add_position_controls(struct snd_soc_pcm_runtime *rtd)
+{
+	struct snd_pcm *pcm = rtd->pcm;
+	struct snd_kcontrol_new knew = {
+		.iface = SNDRV_CTL_ELEM_IFACE_MIXER,
+		.access = SNDRV_CTL_ELEM_ACCESS_READ |
+			  SNDRV_CTL_ELEM_ACCESS_VOLATILE,
+		.info = msm_pcm_position_ctl_info,
+		.get = msm_pcm_position_ctl_get,
+	};
+	char name[SNDRV_CTL_ELEM_ID_NAME_MAXLEN];
+	int stream, ret;
+
+	for (stream = 0; stream < 2; stream++) {
+		struct snd_pcm_substream *substream =
+			pcm->streams[stream].substream;
+
+		if (!substream)
+			continue;
+		snprintf(name, sizeof(name), "%s %d Shared Position",
+			 stream == SNDRV_PCM_STREAM_PLAYBACK ?
+			 "Playback" : "Capture", pcm->device);
+		knew.name = name;
+		ret = snd_ctl_add(pcm->card, snd_ctl_new1(&knew, substream));
+		if (ret < 0) {
+			pr_err("%s: failed to add %s, err %d\n",
+			       __func__, name, ret);
+			return ret;
+		}
+	}
+	return 0;
+}
+
 static int msm_asoc_pcm_new(struct snd_soc_pcm_runtime *rtd)
 {
 	struct snd_card *card = rtd->card->snd_card;
@@ -749,6 +826,10 @@ static int msm_asoc_pcm_new(struct snd_soc_pcm_runtime *rtd)
 		pr_err("%s: Could not add pcm Volume Control %d\n",
 			__func__, ret);
 	}
+	ret = msm_pcm_add_position_controls(rtd);
+	if (ret)
+		pr_err("%s: Could not add position controls %d\n",
+			__func__, ret);
 	pcm->nonatomic = true;
 exit:
 	return ret;
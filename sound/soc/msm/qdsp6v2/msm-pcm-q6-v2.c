@@ -19,6 +19,10 @@
 #include <linux/wait.h>
 #include <linux/platform_device.h>
 #include <linux/slab.h>
+#include <linux/debugfs.h>
+#include <linux/ktime.h>
+#include <linux/seq_file.h>
+#include <linux/workqueue.h>
 #include <sound/core.h>
 #include <sound/soc.h>
 #include <sound/soc-dapm.h>
@@ -148,15 +152,220 @@ static void msm_pcm_route_event_handler(enum msm_pcm_routing_event event,
 	}
 }
 
+/*
+ * Pool of pre-armed playback sessions.
+ *
+ * Opening a stream costs several APR round trips before the first sample
+ * can be written: open write, calibration and mapping the buffers. When a
+ * playback stream closes cleanly its session is flushed and parked here,
+ * still opened and mapped, and the next stream with the same perf mode,
+ * sample width and buffer geometry claims it in hw_params. Only the media
+ * format, which may differ, is sent again. Parked sessions are closed
+ * after MSM_PCM_ASM_POOL_TIMEOUT so they do not hold on to one of the
+ * few ASM sessions for long.
+ */
+#define MSM_PCM_ASM_POOL_SIZE		2
+#define MSM_PCM_ASM_POOL_TIMEOUT	msecs_to_jiffies(5000)
+
+struct msm_pcm_asm_slot {
+	struct audio_client *ac;
+	int perf_mode;
+	uint16_t bits_per_sample;
+	unsigned int period_bytes;
+	unsigned int periods;
+};
+
+static struct {
+	struct mutex lock;
+	struct msm_pcm_asm_slot slot[MSM_PCM_ASM_POOL_SIZE];
+	struct delayed_work reap_work;
+	atomic_t reset;
+} msm_pcm_asm_pool;
+
+/* Stream start latency, hw_params to trigger start, in 5 ms buckets */
+#define MSM_PCM_START_LAT_BUCKETS	16
+#define MSM_PCM_START_LAT_BUCKET_US	5000
+
+static atomic_t msm_pcm_start_lat[2][MSM_PCM_START_LAT_BUCKETS];
+static struct dentry *msm_pcm_start_latency_dentry;
+
+static void msm_pcm_asm_slot_free(struct msm_pcm_asm_slot *slot, bool reset)
+{
+	struct audio_client *ac = slot->ac;
+
+	slot->ac = NULL;
+	if (!reset)
+		q6asm_cmd(ac, CMD_CLOSE);
+	q6asm_audio_client_buf_free_contiguous(IN, ac);
+	q6asm_audio_client_free(ac);
+}
+
+static void msm_pcm_asm_pool_drain(void)
+{
+	bool reset = atomic_xchg(&msm_pcm_asm_pool.reset, 0);
+	int i;
+
+	mutex_lock(&msm_pcm_asm_pool.lock);
+	for (i = 0; i < MSM_PCM_ASM_POOL_SIZE; i++)
+		if (msm_pcm_asm_pool.slot[i].ac)
+			msm_pcm_asm_slot_free(&msm_pcm_asm_pool.slot[i],
+					      reset);
+	mutex_unlock(&msm_pcm_asm_pool.lock);
+}
+
+static void msm_pcm_asm_pool_reap(struct work_struct *work)
+{
+	msm_pcm_asm_pool_drain();
+}
+
+/* ADSP went down, parked sessions are gone with it */
+static void msm_pcm_asm_pool_reset(void)
+{
+	atomic_set(&msm_pcm_asm_pool.reset, 1);
+	mod_delayed_work(system_wq, &msm_pcm_asm_pool.reap_work, 0);
+}
+
+static struct audio_client *msm_pcm_asm_pool_claim(struct msm_audio *prtd,
+		int perf_mode, unsigned int period_bytes, unsigned int periods)
+{
+	struct audio_client *ac = NULL;
+	int i;
+
+	if (atomic_read(&msm_pcm_asm_pool.reset))
+		return NULL;
+
+	mutex_lock(&msm_pcm_asm_pool.lock);
+	for (i = 0; i < MSM_PCM_ASM_POOL_SIZE; i++) {
+		struct msm_pcm_asm_slot *slot = &msm_pcm_asm_pool.slot[i];
+
+		if (slot->ac && slot->perf_mode == perf_mode &&
+		    slot->bits_per_sample == prtd->bits_per_sample &&
+		    slot->period_bytes == period_bytes &&
+		    slot->periods == periods) {
+			ac = slot->ac;
+			slot->ac = NULL;
+			ac->priv = prtd;
+			break;
+		}
+	}
+	mutex_unlock(&msm_pcm_asm_pool.lock);
+	return ac;
+}
+
+/*
+ * Flushes the session of a cleanly stopped playback stream and parks it in
+ * the pool. Returns false if the session has to be closed as usual.
+ */
+static bool msm_pcm_asm_pool_put(struct msm_audio *prtd)
+{
+	struct snd_pcm_runtime *runtime = prtd->substream->runtime;
+	struct audio_client *ac = prtd->audio_client;
+	struct msm_pcm_asm_slot *slot = NULL;
+	int i;
+
+	if (!prtd->enabled || prtd->reset_event || prtd->mmap_flag ||
+	    prtd->volume_set || atomic_read(&ac->reset) ||
+	    atomic_read(&msm_pcm_asm_pool.reset))
+		return false;
+
+	mutex_lock(&msm_pcm_asm_pool.lock);
+	for (i = 0; i < MSM_PCM_ASM_POOL_SIZE; i++) {
+		if (!msm_pcm_asm_pool.slot[i].ac) {
+			slot = &msm_pcm_asm_pool.slot[i];
+			break;
+		}
+	}
+	if (!slot)
+		goto fail;
+
+	/* from now on events for this session are dropped */
+	ac->priv = NULL;
+	smp_wmb();
+	if (q6asm_cmd(ac, CMD_PAUSE) < 0 || q6asm_cmd(ac, CMD_FLUSH) < 0) {
+		ac->priv = prtd;
+		goto fail;
+	}
+	q6asm_audio_client_buf_reset(IN, ac);
+
+	slot->ac = ac;
+	slot->perf_mode = ac->perf_mode;
+	slot->bits_per_sample = prtd->bits_per_sample;
+	slot->period_bytes = prtd->pcm_count;
+	slot->periods = runtime->periods;
+	mutex_unlock(&msm_pcm_asm_pool.lock);
+
+	mod_delayed_work(system_wq, &msm_pcm_asm_pool.reap_work,
+			 MSM_PCM_ASM_POOL_TIMEOUT);
+	return true;
+fail:
+	mutex_unlock(&msm_pcm_asm_pool.lock);
+	return false;
+}
+
+static void msm_pcm_start_latency_record(struct msm_audio *prtd)
+{
+	s64 us;
+	int bucket;
+
+	if (!prtd->start_ktime.tv64)
+		return;
+
+	us = ktime_us_delta(ktime_get(), prtd->start_ktime);
+	prtd->start_ktime.tv64 = 0;
+	bucket = min_t(s64, us / MSM_PCM_START_LAT_BUCKET_US,
+		       MSM_PCM_START_LAT_BUCKETS - 1);
+	atomic_inc(&msm_pcm_start_lat[prtd->prearmed][bucket]);
+}
+
+static int msm_pcm_start_latency_show(struct seq_file *s, void *unused)
+{
+	int i;
+
+	seq_puts(s, "start latency (ms)   cold  pre-armed\n");
+	for (i = 0; i < MSM_PCM_START_LAT_BUCKETS; i++) {
+		int lo = i * MSM_PCM_START_LAT_BUCKET_US / 1000;
+
+		if (i == MSM_PCM_START_LAT_BUCKETS - 1)
+			seq_printf(s, "%4d+     ", lo);
+		else
+			seq_printf(s, "%4d-%-4d ", lo,
+				   lo + MSM_PCM_START_LAT_BUCKET_US / 1000);
+		seq_printf(s, "%15d %10d\n",
+			   atomic_read(&msm_pcm_start_lat[0][i]),
+			   atomic_read(&msm_pcm_start_lat[1][i]));
+	}
+	return 0;
+}
+
+static int msm_pcm_start_latency_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, msm_pcm_start_latency_show, NULL);
+}
+
+static const struct file_operations msm_pcm_start_latency_fops = {
+	.open = msm_pcm_start_latency_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 static void event_handler(uint32_t opcode,
 		uint32_t token, uint32_t *payload, void *priv)
 {
 	struct msm_audio *prtd = priv;
-	struct snd_pcm_substream *substream = prtd->substream;
+	struct snd_pcm_substream *substream;
 	uint32_t *ptrmem = (uint32_t *)payload;
 	uint32_t idx = 0;
 	uint32_t size = 0;
 
+	/* parked in the pre-armed session pool */
+	if (!prtd) {
+		if (opcode == RESET_EVENTS)
+			msm_pcm_asm_pool_reset();
+		return;
+	}
+	substream = prtd->substream;
+
 	switch (opcode) {
 	case ASM_DATA_EVENT_WRITE_DONE_V2: {
 		pr_debug("ASM_DATA_EVENT_WRITE_DONE_V2\n");
@@ -336,6 +545,10 @@ static int msm_pcm_playback_prepare(struct snd_pcm_substream *substream)
 		break;
 	}
 
+	/* a pre-armed session is already opened and calibrated */
+	if (prtd->prearmed)
+		goto routing;
+
 	ret = q6asm_open_write_v3(prtd->audio_client,
 				  FORMAT_LINEAR_PCM, bits_per_sample);
 
@@ -350,6 +563,7 @@ static int msm_pcm_playback_prepare(struct snd_pcm_substream *substream)
 	if (ret < 0)
 		pr_debug("%s : Send cal failed : %d", __func__, ret);
 
+routing:
 	pr_debug("%s: session ID %d\n", __func__,
 			prtd->audio_client->session);
 	prtd->session_id = prtd->audio_client->session;
@@ -510,6 +724,8 @@ static int msm_pcm_trigger(struct snd_pcm_substream *substream, int cmd)
 	case SNDRV_PCM_TRIGGER_PAUSE_RELEASE:
 		pr_debug("%s: Trigger start\n", __func__);
 		ret = q6asm_run_nowait(prtd->audio_client, 0, 0, 0);
+		if (!ret && substream->stream == SNDRV_PCM_STREAM_PLAYBACK)
+			msm_pcm_start_latency_record(prtd);
 		break;
 	case SNDRV_PCM_TRIGGER_STOP:
 		pr_debug("SNDRV_PCM_TRIGGER_STOP\n");
@@ -558,6 +774,12 @@ static int msm_pcm_open(struct snd_pcm_substream *substream)
 	prtd->substream = substream;
 	prtd->audio_client = q6asm_audio_client_alloc(
 				(app_cb)event_handler, prtd);
+	if (!prtd->audio_client) {
+		/* parked sessions may be holding the last free ones */
+		msm_pcm_asm_pool_drain();
+		prtd->audio_client = q6asm_audio_client_alloc(
+				(app_cb)event_handler, prtd);
+	}
 	if (!prtd->audio_client) {
 		pr_info("%s: Could not allocate memory\n", __func__);
 		kfree(prtd);
@@ -762,10 +984,12 @@ static int msm_pcm_playback_close(struct snd_pcm_substream *substream)
 		if (!ret)
 			pr_err("%s: CMD_EOS failed, cmd_pending 0x%lx\n",
 			       __func__, prtd->cmd_pending);
-		q6asm_cmd(prtd->audio_client, CMD_CLOSE);
-		q6asm_audio_client_buf_free_contiguous(dir,
-					prtd->audio_client);
-		q6asm_audio_client_free(prtd->audio_client);
+		if (!ret || !msm_pcm_asm_pool_put(prtd)) {
+			q6asm_cmd(prtd->audio_client, CMD_CLOSE);
+			q6asm_audio_client_buf_free_contiguous(dir,
+						prtd->audio_client);
+			q6asm_audio_client_free(prtd->audio_client);
+		}
 	}
 	msm_pcm_routing_dereg_phy_stream(soc_prtd->dai_link->be_id,
 						SNDRV_PCM_STREAM_PLAYBACK);
@@ -991,6 +1215,35 @@ static int msm_pcm_hw_params(struct snd_pcm_substream *substream,
 		/* use the default from the device tree */
 		pdata->perf_mode_set = pdata->perf_mode;
 
+	if (dir == IN && !prtd->enabled) {
+		struct audio_client *ac;
+
+		prtd->start_ktime = ktime_get();
+		switch (params_format(params)) {
+		case SNDRV_PCM_FORMAT_S24_LE:
+		case SNDRV_PCM_FORMAT_S24_3LE:
+			prtd->bits_per_sample = 24;
+			break;
+		default:
+			prtd->bits_per_sample = 16;
+			break;
+		}
+		ac = prtd->prearmed ? NULL :
+			msm_pcm_asm_pool_claim(prtd, pdata->perf_mode_set,
+				params_buffer_bytes(params) /
+				params_periods(params),
+				params_periods(params));
+		if (ac) {
+			ac->dev = prtd->audio_client->dev;
+			q6asm_audio_client_free(prtd->audio_client);
+			prtd->audio_client = ac;
+			prtd->prearmed = true;
+		}
+	}
+
+	if (prtd->prearmed)
+		goto set_buffer;
+
 	ret = q6asm_audio_client_buf_alloc_contiguous(dir,
 			prtd->audio_client,
 			(params_buffer_bytes(params) / params_periods(params)),
@@ -1000,6 +1253,7 @@ static int msm_pcm_hw_params(struct snd_pcm_substream *substream,
 							ret);
 		return -ENOMEM;
 	}
+set_buffer:
 	buf = prtd->audio_client->port[dir].buf;
 	if (buf == NULL || buf[0].data == NULL)
 		return -ENOMEM;
@@ -1092,6 +1346,7 @@ static int msm_pcm_volume_ctl_put(struct snd_kcontrol *kcontrol,
 	if (prtd) {
 		rc = msm_pcm_set_volume(prtd, volume);
 		prtd->volume = volume;
+		prtd->volume_set = true;
 	}
 	return rc;
 }
@@ -1702,6 +1957,12 @@ static int __init msm_soc_platform_init(void)
 	init_waitqueue_head(&the_locks.write_wait);
 	init_waitqueue_head(&the_locks.read_wait);
 
+	mutex_init(&msm_pcm_asm_pool.lock);
+	INIT_DELAYED_WORK(&msm_pcm_asm_pool.reap_work, msm_pcm_asm_pool_reap);
+	msm_pcm_start_latency_dentry = debugfs_create_file(
+				"msm_pcm_start_latency", S_IRUGO, NULL, NULL,
+				&msm_pcm_start_latency_fops);
+
 	return platform_driver_register(&msm_pcm_driver);
 }
 module_init(msm_soc_platform_init);
@@ -1709,6 +1970,9 @@ module_init(msm_soc_platform_init);
 static void __exit msm_soc_platform_exit(void)
 {
 	platform_driver_unregister(&msm_pcm_driver);
+	cancel_delayed_work_sync(&msm_pcm_asm_pool.reap_work);
+	msm_pcm_asm_pool_drain();
+	debugfs_remove(msm_pcm_start_latency_dentry);
 }
 module_exit(msm_soc_platform_exit);
 
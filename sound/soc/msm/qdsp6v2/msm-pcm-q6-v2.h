@@ -109,6 +109,11 @@ struct msm_audio {
 	int cmd_interrupt;
 	bool meta_data_mode;
 	uint32_t volume;
+	bool volume_set;
+	/* session was taken from the pool of pre-armed sessions */
+	bool prearmed;
+	uint16_t bits_per_sample;
+	ktime_t start_ktime;		/* hw_params, for start latency */
 	/* array of frame info */
 	struct msm_audio_in_frame_info in_frame_info[CAPTURE_MAX_NUM_PERIODS];
 };
@@ -19,6 +19,7 @@
 #include <linux/mutex.h>
 #include <linux/of_device.h>
 #include <linux/slab.h>
+#include <linux/workqueue.h>
 #include <sound/core.h>
 #include <sound/soc.h>
 #include <sound/soc-dapm.h>
@@ -46,6 +47,7 @@
 #include "sound/q6lsm.h"
 
 static int get_cal_path(int path_type);
+static void msm_pcm_routing_batch_commit(void);
 
 static struct mutex routing_lock;
 
@@ -1337,6 +1339,7 @@ void msm_pcm_routing_dereg_phy_stream(int fedai_id, int stream_type)
 	}
 
 	mutex_lock(&routing_lock);
+	msm_pcm_routing_batch_commit();
 	for (i = 0; i < MSM_BACKEND_DAI_MAX; i++) {
 		if (!is_be_dai_extproc(i) &&
 		   (afe_get_port_type(msm_bedais[i].port_id) == port_type) &&
@@ -1395,7 +1398,13 @@ static bool msm_pcm_routing_route_is_set(u16 be_id, u16 fe_id)
 	return rc;
 }
 
-static void msm_pcm_routing_process_audio(u16 reg, u16 val, int set)
+/*
+ * Apply a single FE/BE route change. When build_matrix is false the caller
+ * is responsible for sending the matrix map of the FE afterwards.
+ * Called with routing_lock held.
+ */
+static void msm_pcm_routing_update_audio(u16 reg, u16 val, int set,
+					 bool build_matrix)
 {
 	int session_type, path_type, topology;
 	u32 channels, sample_rate;
@@ -1404,20 +1413,6 @@ static void msm_pcm_routing_process_audio(u16 reg, u16 val, int set)
 	uint32_t passthr_mode;
 	bool is_lsm;
 
-	pr_debug("%s: reg %x val %x set %x\n", __func__, reg, val, set);
-
-	if (!is_mm_lsm_fe_id(val)) {
-		/* recheck FE ID in the mixer control defined in this file */
-		pr_err("%s: bad MM ID\n", __func__);
-		return;
-	}
-
-	if (!route_check_fe_id_adm_support(val)) {
-		/* ignore adm open if not supported for fe_id */
-		pr_debug("%s: No ADM support for fe id %d\n", __func__, val);
-		return;
-	}
-
 	passthr_mode = msm_bedais[reg].passthr_mode[val];
 	if (afe_get_port_type(msm_bedais[reg].port_id) ==
 		MSM_AFE_PORT_TYPE_RX) {
@@ -1433,7 +1428,6 @@ static void msm_pcm_routing_process_audio(u16 reg, u16 val, int set)
 	is_lsm = (val >= MSM_FRONTEND_DAI_LSM1) &&
 			 (val <= MSM_FRONTEND_DAI_LSM8);
 
-	mutex_lock(&routing_lock);
 	if (set) {
 		if (!test_bit(val, &msm_bedais[reg].fe_sessions) &&
 			((msm_bedais[reg].port_id == VOICE_PLAYBACK_TX) ||
@@ -1495,7 +1489,6 @@ static void msm_pcm_routing_process_audio(u16 reg, u16 val, int set)
 			if ((copp_idx < 0) ||
 			    (copp_idx >= MAX_COPPS_PER_PORT)) {
 				pr_err("%s: adm open failed\n", __func__);
-				mutex_unlock(&routing_lock);
 				return;
 			}
 			pr_debug("%s: setting idx bit of fe:%d, type: %d, be:%d\n",
@@ -1515,10 +1508,11 @@ static void msm_pcm_routing_process_audio(u16 reg, u16 val, int set)
 					MSM_PCM_RT_EVT_DEVSWITCH,
 					fdai->event_info.priv_data);
 
-			msm_pcm_routing_build_matrix(val, session_type,
-						     path_type,
-						     fdai->perf_mode,
-						     passthr_mode);
+			if (build_matrix)
+				msm_pcm_routing_build_matrix(val, session_type,
+							     path_type,
+							     fdai->perf_mode,
+							     passthr_mode);
 			if ((fdai->perf_mode == LEGACY_PCM_MODE) &&
 				(passthr_mode == LEGACY_PCM))
 				msm_pcm_routing_cfg_pp(port_id, copp_idx,
@@ -1555,16 +1549,185 @@ static void msm_pcm_routing_process_audio(u16 reg, u16 val, int set)
 			    (fdai->perf_mode == LEGACY_PCM_MODE) &&
 			    (passthr_mode == LEGACY_PCM))
 				msm_pcm_routing_deinit_pp(port_id, topology);
+			if (build_matrix)
+				msm_pcm_routing_build_matrix(val, session_type,
+							     path_type,
+							     fdai->perf_mode,
+							     passthr_mode);
+		}
+	}
+	if ((msm_bedais[reg].port_id == VOICE_RECORD_RX)
+			|| (msm_bedais[reg].port_id == VOICE_RECORD_TX))
+		voc_start_record(msm_bedais[reg].port_id, set, voc_session_id);
+}
+
+/*
+ * Routing batch: while "Routing Batch Update" is set, mixer changes only
+ * update fe_sessions and mark the route dirty. Clearing the control diffs
+ * the requested routes against the open COPPs, closes the routes that went
+ * away before opening the new ones, and sends one matrix map per affected
+ * FE. A batch left open is committed after MSM_ROUTING_BATCH_TIMEOUT_MS,
+ * or as soon as an FE or BE involved in routing is closed.
+ */
+#define MSM_ROUTING_BATCH_TIMEOUT_MS	1000
+
+static bool routing_batch;
+static unsigned long routing_batch_dirty[MSM_BACKEND_DAI_MAX];
+static unsigned long routing_batch_fe[2][BITS_TO_LONGS(MSM_FRONTEND_DAI_MAX)];
+static u32 routing_batch_passthr[2][MSM_FRONTEND_DAI_MAX];
+static struct delayed_work routing_batch_work;
+
+static bool msm_pcm_routing_batchable(u16 reg)
+{
+	switch (msm_bedais[reg].port_id) {
+	case VOICE_PLAYBACK_TX:
+	case VOICE2_PLAYBACK_TX:
+	case VOICE_RECORD_RX:
+	case VOICE_RECORD_TX:
+		return false;
+	default:
+		return true;
+	}
+}
+
+static void msm_pcm_routing_batch_apply(bool set)
+{
+	int reg, val, session_type;
+
+	for (reg = 0; reg < MSM_BACKEND_DAI_MAX; reg++) {
+		for_each_set_bit(val, &routing_batch_dirty[reg],
+				 MSM_FRONTEND_DAI_MAX) {
+			bool want, have;
+
+			if (afe_get_port_type(msm_bedais[reg].port_id) ==
+			    MSM_AFE_PORT_TYPE_RX)
+				session_type = SESSION_TYPE_RX;
+			else
+				session_type = SESSION_TYPE_TX;
+
+			want = test_bit(val, &msm_bedais[reg].fe_sessions);
+			have = session_copp_map[val][session_type][reg] != 0;
+			if (want != set || want == have)
+				continue;
+
+			msm_pcm_routing_update_audio(reg, val, set, false);
+			if (have == !!session_copp_map[val][session_type][reg])
+				continue;
+			set_bit(val, routing_batch_fe[session_type]);
+			routing_batch_passthr[session_type][val] =
+				msm_bedais[reg].passthr_mode[val];
+		}
+	}
+}
+
+/* Called with routing_lock held */
+static void msm_pcm_routing_batch_commit(void)
+{
+	struct msm_pcm_routing_fdai_data *fdai;
+	int session_type, path_type, val;
+	u32 passthr_mode;
+
+	if (!routing_batch)
+		return;
+
+	routing_batch = false;
+	cancel_delayed_work(&routing_batch_work);
+
+	msm_pcm_routing_batch_apply(false);
+	msm_pcm_routing_batch_apply(true);
+	memset(routing_batch_dirty, 0, sizeof(routing_batch_dirty));
+
+	for (session_type = SESSION_TYPE_RX; session_type <= SESSION_TYPE_TX;
+	     session_type++) {
+		for_each_set_bit(val, routing_batch_fe[session_type],
+				 MSM_FRONTEND_DAI_MAX) {
+			fdai = &fe_dai_map[val][session_type];
+			if (fdai->strm_id == INVALID_SESSION)
+				continue;
+
+			passthr_mode = routing_batch_passthr[session_type][val];
+			if (session_type == SESSION_TYPE_TX)
+				path_type = ADM_PATH_LIVE_REC;
+			else if (passthr_mode != LEGACY_PCM)
+				path_type = ADM_PATH_COMPRESSED_RX;
+			else
+				path_type = ADM_PATH_PLAYBACK;
+
 			msm_pcm_routing_build_matrix(val, session_type,
 						     path_type,
 						     fdai->perf_mode,
 						     passthr_mode);
 		}
 	}
-	if ((msm_bedais[reg].port_id == VOICE_RECORD_RX)
-			|| (msm_bedais[reg].port_id == VOICE_RECORD_TX))
-		voc_start_record(msm_bedais[reg].port_id, set, voc_session_id);
+	memset(routing_batch_fe, 0, sizeof(routing_batch_fe));
+}
+
+static void msm_pcm_routing_batch_timeout(struct work_struct *work)
+{
+	mutex_lock(&routing_lock);
+	if (routing_batch)
+		pr_warn("%s: committing stale routing batch\n", __func__);
+	msm_pcm_routing_batch_commit();
+	mutex_unlock(&routing_lock);
+}
+
+static int msm_routing_get_batch_control(struct snd_kcontrol *kcontrol,
+					 struct snd_ctl_elem_value *ucontrol)
+{
+	ucontrol->value.integer.value[0] = routing_batch;
+	return 0;
+}
+
+static int msm_routing_put_batch_control(struct snd_kcontrol *kcontrol,
+					 struct snd_ctl_elem_value *ucontrol)
+{
+	mutex_lock(&routing_lock);
+	if (ucontrol->value.integer.value[0]) {
+		if (!routing_batch) {
+			routing_batch = true;
+			schedule_delayed_work(&routing_batch_work,
+				msecs_to_jiffies(MSM_ROUTING_BATCH_TIMEOUT_MS));
+		}
+	} else {
+		msm_pcm_routing_batch_commit();
+	}
+	mutex_unlock(&routing_lock);
+
+	return 0;
+}
+
+static const struct snd_kcontrol_new routing_batch_controls[] = {
+	SOC_SINGLE_EXT("Routing Batch Update", SND_SOC_NOPM, 0, 1, 0,
+		       msm_routing_get_batch_control,
+		       msm_routing_put_batch_control),
+};
+
+static void msm_pcm_routing_process_audio(u16 reg, u16 val, int set)
+{
+	pr_debug("%s: reg %x val %x set %x\n", __func__, reg, val, set);
 
+	if (!is_mm_lsm_fe_id(val)) {
+		/* recheck FE ID in the mixer control defined in this file */
+		pr_err("%s: bad MM ID\n", __func__);
+		return;
+	}
+
+	if (!route_check_fe_id_adm_support(val)) {
+		/* ignore adm open if not supported for fe_id */
+		pr_debug("%s: No ADM support for fe id %d\n", __func__, val);
+		return;
+	}
+
+	mutex_lock(&routing_lock);
+	if (routing_batch && msm_pcm_routing_batchable(reg)) {
+		if (set)
+			set_bit(val, &msm_bedais[reg].fe_sessions);
+		else
+			clear_bit(val, &msm_bedais[reg].fe_sessions);
+		set_bit(val, &routing_batch_dirty[reg]);
+	} else {
+		msm_pcm_routing_update_audio(reg, val, set, true);
+	}
 	mutex_unlock(&routing_lock);
 }
 
@@ -11544,6 +11707,7 @@ static int msm_pcm_routing_close(struct snd_pcm_substream *substream)
 		path_type = ADM_PATH_LIVE_REC;
 
 	mutex_lock(&routing_lock);
+	msm_pcm_routing_batch_commit();
 	for_each_set_bit(i, &bedai->fe_sessions, MSM_FRONTEND_DAI_MAX) {
 		if (!is_mm_lsm_fe_id(i))
 			continue;
@@ -12001,6 +12165,9 @@ static int msm_routing_probe(struct snd_soc_platform *platform)
 			adm_topology_controls,
 			ARRAY_SIZE(adm_topology_controls));
 
+	snd_soc_add_platform_controls(platform, routing_batch_controls,
+				      ARRAY_SIZE(routing_batch_controls));
+
 	return 0;
 }
 
@@ -12130,6 +12297,7 @@ err:
 static int __init msm_soc_routing_platform_init(void)
 {
 	mutex_init(&routing_lock);
+	INIT_DELAYED_WORK(&routing_batch_work, msm_pcm_routing_batch_timeout);
 	if (msm_routing_init_cal_data())
 		pr_err("%s: could not init cal data!\n", __func__);
 
@@ -12139,6 +12307,7 @@ module_init(msm_soc_routing_platform_init);
 
 static void __exit msm_soc_routing_platform_exit(void)
 {
+	cancel_delayed_work_sync(&routing_batch_work);
 	msm_routing_delete_cal_data();
 	platform_driver_unregister(&msm_routing_pcm_driver);
 }
@@ -129,6 +129,9 @@ static long in_enable_flag;
 static struct dentry *out_dentry;
 static struct dentry *in_dentry;
 static int in_cont_index;
+/* Bytes captured so far and last DSP index seen by a push mode session */
+static uint32_t in_push_bytes;
+static uint32_t in_push_index;
 /*This var is used to keep track of first write done for cold output latency */
 static int out_cold_index;
 static char *out_buffer;
@@ -281,6 +284,31 @@ static void config_debug_fs_read_cb(void)
 static void config_debug_fs_reset_index(void)
 {
 	in_cont_index = 0;
+	in_push_bytes = 0;
+	in_push_index = 0;
+}
+
+static void config_debug_fs_push_pos(struct audio_client *ac, uint32_t index)
+{
+	uint32_t circ_size = ac->config.bufsz * ac->config.bufcnt;
+
+	if (!in_enable_flag || in_cont_index > 7 || !circ_size)
+		return;
+
+	/*
+	 * Push mode sessions get no read done events, so follow the
+	 * DSP write index instead and tap the timestamp once it starts
+	 * filling the 8th 512 byte block, as config_debug_fs_read_cb()
+	 * does for buffered capture.
+	 */
+	in_push_bytes += (index + circ_size - in_push_index) % circ_size;
+	in_push_index = index;
+	if (in_push_bytes >= 7 * 512) {
+		do_gettimeofday(&in_cont_tv);
+		pr_info("%s: push mode at %ld sec %ld microsec\n", __func__,
+			in_cont_tv.tv_sec, in_cont_tv.tv_usec);
+		in_cont_index = 8;
+	}
 }
 
 static void config_debug_fs_run(void)
@@ -369,6 +397,10 @@ static void config_debug_fs_reset_index(void)
 {
 	return;
 }
+static void config_debug_fs_push_pos(struct audio_client *ac, uint32_t index)
+{
+	return;
+}
 static void config_debug_fs_read_cb(void)
 {
 	return;
@@ -933,6 +965,28 @@ int q6asm_audio_client_buf_free(unsigned int dir,
 	return 0;
 }
 
+/*
+ * q6asm_audio_client_buf_reset: Hands all buffers of a port back to the
+ * CPU side, as right after allocation, so that a flushed session can be
+ * reused without remapping its buffers.
+ */
+void q6asm_audio_client_buf_reset(unsigned int dir, struct audio_client *ac)
+{
+	struct audio_port_data *port = &ac->port[dir];
+	unsigned long flags;
+	int cnt;
+
+	mutex_lock(&port->lock);
+	spin_lock_irqsave(&port->dsp_lock, flags);
+	for (cnt = 0; port->buf && cnt < port->max_buf_cnt; cnt++)
+		port->buf[cnt].used = dir ^ 1;
+	port->cpu_buf = 0;
+	port->dsp_buf = 0;
+	spin_unlock_irqrestore(&port->dsp_lock, flags);
+	mutex_unlock(&port->lock);
+}
+EXPORT_SYMBOL(q6asm_audio_client_buf_reset);
+
 int q6asm_audio_client_buf_free_contiguous(unsigned int dir,
 			struct audio_client *ac)
 {
@@ -3197,6 +3251,8 @@ int q6asm_open_shared_io(struct audio_client *ac,
 	num_watermarks = 0;
 
 	ac->config = *config;
+	if (dir == OUT)
+		config_debug_fs_reset_index();
 
 	if (ac->session <= 0 || ac->session > SESSION_MAX) {
 		pr_err("%s: Session %d is out of bounds\n",
@@ -3430,6 +3486,8 @@ int q6asm_get_shared_pos(struct audio_client *ac, uint32_t *read_index,
 
 		if (frame_cnt1 != frame_cnt2)
 			continue;
+		if (ac->port[OUT].buf && frame_cnt1)
+			config_debug_fs_push_pos(ac, *read_index);
 		return 0;
 	}
 	pr_err("%s out of tries trying to get a good read, try again\n",
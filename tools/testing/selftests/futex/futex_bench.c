@@ -0,0 +1,149 @@
+/*
+ * Futex microbenchmark: the cost of a FUTEX_WAKE nobody waits for, and
+ * the round trip rate of thread pairs ping-ponging on private futexes.
+ *
+ *   futex_bench [-t pairs] [-s slots] [-d seconds]
+ *
+ * -s gives the process a private futex hash of that many slots with
+ * prctl(PR_FUTEX_HASH) before any thread starts, to compare against the
+ * global hash table shared with every other process.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <errno.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifndef PR_FUTEX_HASH
+#define PR_FUTEX_HASH			78
+# define PR_FUTEX_HASH_SET_SLOTS	1
+# define PR_FUTEX_HASH_GET_SLOTS	2
+#endif
+
+#define WAKE_LOOPS	1000000
+#define MAX_PAIRS	64
+
+struct pair {
+	int word;		/* whose turn: 0 ping, 1 pong */
+	unsigned long trips;
+	pthread_t ping, pong;
+} __attribute__((aligned(64)));
+
+static struct pair pairs[MAX_PAIRS];
+static volatile int stop;
+
+static long futex(int *uaddr, int op, int val)
+{
+	return syscall(SYS_futex, uaddr, op, val, NULL, NULL, 0);
+}
+
+static long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* wait for our turn, then hand it to the other side */
+static void turn(struct pair *p, int mine)
+{
+	while (__atomic_load_n(&p->word, __ATOMIC_ACQUIRE) != mine) {
+		if (stop)
+			return;
+		futex(&p->word, FUTEX_WAIT_PRIVATE, !mine);
+	}
+	__atomic_store_n(&p->word, !mine, __ATOMIC_RELEASE);
+	futex(&p->word, FUTEX_WAKE_PRIVATE, 1);
+}
+
+static void *ping(void *arg)
+{
+	struct pair *p = arg;
+
+	while (!stop) {
+		turn(p, 0);
+		p->trips++;
+	}
+	return NULL;
+}
+
+static void *pong(void *arg)
+{
+	struct pair *p = arg;
+
+	while (!stop)
+		turn(p, 1);
+	return NULL;
+}
+
+int main(int argc, char **argv)
+{
+	int nr_pairs = 4, seconds = 5, slots = -1;
+	unsigned long trips = 0;
+	long long start;
+	int opt, i, word = 0;
+
+	while ((opt = getopt(argc, argv, "t:s:d:")) != -1) {
+		switch (opt) {
+		case 't':
+			nr_pairs = atoi(optarg);
+			break;
+		case 's':
+			slots = atoi(optarg);
+			break;
+		case 'd':
+			seconds = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-t pairs] [-s slots] "
+				"[-d seconds]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (nr_pairs < 1 || nr_pairs > MAX_PAIRS)
+		nr_pairs = 4;
+
+	if (slots >= 0 &&
+	    prctl(PR_FUTEX_HASH, PR_FUTEX_HASH_SET_SLOTS, slots, 0, 0)) {
+		fprintf(stderr, "PR_FUTEX_HASH: %s\n", strerror(errno));
+		return 1;
+	}
+	printf("private hash slots: %d\n",
+	       prctl(PR_FUTEX_HASH, PR_FUTEX_HASH_GET_SLOTS, 0, 0, 0));
+
+	start = now_ns();
+	for (i = 0; i < WAKE_LOOPS; i++)
+		futex(&word, FUTEX_WAKE_PRIVATE, 1);
+	printf("uncontended FUTEX_WAKE: %.1f ns/call\n",
+	       (double)(now_ns() - start) / WAKE_LOOPS);
+
+	for (i = 0; i < nr_pairs; i++) {
+		pthread_create(&pairs[i].ping, NULL, ping, &pairs[i]);
+		pthread_create(&pairs[i].pong, NULL, pong, &pairs[i]);
+	}
+	sleep(seconds);
+	stop = 1;
+	for (i = 0; i < nr_pairs; i++) {
+		/* kick anybody still asleep */
+		__atomic_store_n(&pairs[i].word, 2, __ATOMIC_RELEASE);
+		futex(&pairs[i].word, FUTEX_WAKE_PRIVATE, INT_MAX);
+		pthread_join(pairs[i].ping, NULL);
+		pthread_join(pairs[i].pong, NULL);
+		trips += pairs[i].trips;
+	}
+	printf("%d pairs: %lu round trips/s\n", nr_pairs, trips / seconds);
+
+	return 0;
+}
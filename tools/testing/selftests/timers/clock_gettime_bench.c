@@ -0,0 +1,65 @@
+/*
+ * Measures the cost of clock_gettime() for each clock id, once through
+ * the vDSO and once through the raw system call, so that clock ids the
+ * vDSO does not handle stand out as costing about a syscall either way.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#define LOOPS	1000000
+
+static const struct {
+	clockid_t id;
+	const char *name;
+} clocks[] = {
+	{ CLOCK_REALTIME,		"REALTIME" },
+	{ CLOCK_MONOTONIC,		"MONOTONIC" },
+	{ CLOCK_MONOTONIC_RAW,		"MONOTONIC_RAW" },
+	{ CLOCK_BOOTTIME,		"BOOTTIME" },
+	{ CLOCK_REALTIME_COARSE,	"REALTIME_COARSE" },
+	{ CLOCK_MONOTONIC_COARSE,	"MONOTONIC_COARSE" },
+};
+
+static long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static double ns_per_call(clockid_t id, int use_syscall)
+{
+	struct timespec ts;
+	long long start;
+	int i;
+
+	start = now_ns();
+	for (i = 0; i < LOOPS; i++) {
+		if (use_syscall)
+			syscall(SYS_clock_gettime, id, &ts);
+		else
+			clock_gettime(id, &ts);
+	}
+	return (double)(now_ns() - start) / LOOPS;
+}
+
+int main(void)
+{
+	unsigned int i;
+
+	printf("%-18s %10s %10s (ns/call)\n", "clock", "vdso", "syscall");
+	for (i = 0; i < sizeof(clocks) / sizeof(clocks[0]); i++)
+		printf("%-18s %10.1f %10.1f\n", clocks[i].name,
+		       ns_per_call(clocks[i].id, 0),
+		       ns_per_call(clocks[i].id, 1));
+	return 0;
+}